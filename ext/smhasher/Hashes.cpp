@@ -6,6 +6,10 @@
 #include <stdlib.h>
 //#include <stdint.h>
 #include <assert.h>
+#include <string.h>
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
 //#include <emmintrin.h>
 //#include <xmmintrin.h>
 
@@ -153,3 +157,74 @@ void Crap8_test ( const void * key, int len, uint32_t seed, void * out )
 {
   *(uint32_t*)out = Crap8((const uint8_t*)key,len,seed);
 }
+
+//-----------------------------------------------------------------------------
+// Fixed width k-mer distribution hashes.  Must match bliss::kmer::hash::multiply_shift
+// and bliss::kmer::hash::crc32c with Prefix = false.
+
+static inline uint64_t kmer_fmix64 ( uint64_t k )
+{
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+static inline uint64_t kmer_fold ( uint64_t x )
+{
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 r = (unsigned __int128)x * 0x9E3779B97F4A7C15ULL;
+  return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+  x *= 0x9E3779B97F4A7C15ULL;
+  return x ^ (x >> 32) ^ (x >> 56);
+#endif
+}
+
+void kmer_multiply_shift_64 ( const void * key, int len, uint32_t seed, void * out )
+{
+  const uint8_t * data = (const uint8_t*)key;
+  uint64_t h = kmer_fmix64(seed);
+  uint64_t w;
+
+  int i = 0;
+  for(; i + 8 <= len; i += 8)
+  {
+    memcpy(&w,data+i,8);
+    h = kmer_fold(h ^ w);
+  }
+  if(i < len)
+  {
+    w = 0;
+    memcpy(&w,data+i,len-i);
+    h = kmer_fold(h ^ w);
+  }
+
+  *(uint64_t*)out = h;
+}
+
+#if defined(__SSE4_2__)
+void kmer_crc32c_64 ( const void * key, int len, uint32_t seed, void * out )
+{
+  const uint8_t * data = (const uint8_t*)key;
+  uint64_t crc = (uint32_t)kmer_fmix64(seed);
+  uint64_t w;
+
+  int i = 0;
+  for(; i + 8 <= len; i += 8)
+  {
+    memcpy(&w,data+i,8);
+    crc = _mm_crc32_u64(crc,w);
+  }
+  if(i < len)
+  {
+    w = 0;
+    memcpy(&w,data+i,len-i);
+    crc = _mm_crc32_u64(crc,w);
+  }
+
+  *(uint64_t*)out = crc * 0x9E3779B97F4A7C15ULL;
+}
+#endif
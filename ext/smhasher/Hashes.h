@@ -43,6 +43,15 @@ void SpookyHash128_test    ( const void * key, int len, uint32_t seed, void * ou
 
 uint32_t MurmurOAAT ( const void * key, int len, uint32_t seed );
 
+//----------
+// Fixed width k-mer distribution hashes, as in bliss::kmer::hash (src/index/kmer_hash.hpp).
+// Keys are hashed as 64-bit words, the last one zero padded.
+
+void kmer_multiply_shift_64 ( const void * key, int len, uint32_t seed, void * out );
+#if defined(__SSE4_2__)
+void kmer_crc32c_64        ( const void * key, int len, uint32_t seed, void * out );
+#endif
+
 //----------
 // MurmurHash2
 
@@ -11,7 +11,8 @@
 #include "Stats.h"
 #include "Random.h"   // for rand_p
 
-#include <algorithm>  // for std::swap
+#include <algorithm>  // for std::swap, sort, unique
+#include <vector>
 #include <assert.h>
 
 //-----------------------------------------------------------------------------
@@ -437,3 +438,77 @@ bool SeedTest ( pfHash hash, int keycount, bool drawDiagram )
 }
 
 //-----------------------------------------------------------------------------
+// Keyset 'DNA' - distinct 2-bit packed k-mers from a skewed genome-like sequence:
+// AT rich background, with every 4th block of 97 bases replaced by a copy of a
+// motif with 5% substitutions.  Packed as in bliss, most recent base in the low bits.
+
+template < typename hashtype >
+bool DNAKeyTest ( pfHash hash, const int k, const int keycount, bool drawDiagram )
+{
+  printf("Keyset 'DNA' - %d-mers, AT rich with tandem repeats - %d keys\n",k,keycount);
+
+  Rand r(729184);
+
+  const int motiflen = 97;
+  const int words = (2 * k + 63) / 64;
+  const int keybytes = (2 * k + 7) / 8;
+
+  // A=0, C=1, G=2, T=3.  P(A) = P(T) = 0.4
+  uint8_t motif[motiflen];
+  for(int i = 0; i < motiflen; i++)
+  {
+    uint32_t x = r.rand_u32() % 10;
+    motif[i] = (x < 4) ? 0 : ((x < 6) ? (uint8_t)(x - 3) : 3);
+  }
+
+  std::vector<uint64_t> kmers;
+  std::vector<uint64_t> kmer(words, 0);
+
+  for(long i = 0; (long)kmers.size() < (long)keycount * words; i++)
+  {
+    uint32_t x = r.rand_u32() % 10;
+    uint8_t c = (x < 4) ? 0 : ((x < 6) ? (uint8_t)(x - 3) : 3);
+    if((i / motiflen) % 4 == 0)
+    {
+      c = ((r.rand_u32() % 100) < 5) ? (uint8_t)(r.rand_u32() & 0x3) : motif[i % motiflen];
+    }
+
+    // shift the whole k-mer left by 1 base, then mask to 2k bits.
+    for(int w = words - 1; w > 0; w--) kmer[w] = (kmer[w] << 2) | (kmer[w-1] >> 62);
+    kmer[0] = (kmer[0] << 2) | c;
+    if((2 * k) % 64) kmer[words-1] &= (~0ULL) >> (64 - (2 * k) % 64);
+
+    if(i >= k - 1) kmers.insert(kmers.end(),kmer.begin(),kmer.end());
+  }
+
+  // keep the distinct ones.  repeats hash the same by design.
+  std::vector<std::vector<uint64_t> > keys;
+  for(size_t i = 0; i < kmers.size(); i += words)
+  {
+    keys.push_back(std::vector<uint64_t>(kmers.begin() + i, kmers.begin() + i + words));
+  }
+  std::sort(keys.begin(),keys.end());
+  keys.erase(std::unique(keys.begin(),keys.end()),keys.end());
+
+  printf("%d distinct\n",(int)keys.size());
+
+  //----------
+
+  std::vector<hashtype> hashes;
+  hashes.resize(keys.size());
+
+  for(size_t i = 0; i < keys.size(); i++)
+  {
+    hash(&keys[i][0],keybytes,0,&hashes[i]);
+  }
+
+  bool result = true;
+
+  result &= TestHashList(hashes,true,true,drawDiagram);
+
+  printf("\n");
+
+  return result;
+}
+
+//-----------------------------------------------------------------------------
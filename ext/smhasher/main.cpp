@@ -28,6 +28,7 @@ bool g_testWindow      = false;
 bool g_testText        = false;
 bool g_testZeroes      = false;
 bool g_testSeed        = false;
+bool g_testDNA         = false;
 
 //-----------------------------------------------------------------------------
 // This is the list of all hashes that SMHasher can test.
@@ -80,6 +81,13 @@ HashInfo g_hashes[] =
   { MurmurHash3_x64_128, 128, 0x6384BA69, "Murmur3F",    "MurmurHash3 for x64, 128-bit" },
 
   { PMurHash32_test,      32, 0xB0F57EE3, "PMurHash32",  "Shane Day's portable-ized MurmurHash3 for x86, 32-bit." },
+
+  // bliss k-mer distribution hashes
+
+  { kmer_multiply_shift_64, 64, 0x97E9A855, "KmerMulShift", "bliss k-mer multiply-shift, 64-bit" },
+#if defined(__SSE4_2__)
+  { kmer_crc32c_64,       64, 0xEDD57609, "KmerCRC32C",  "bliss k-mer SSE4.2 CRC32C, 64-bit" },
+#endif
 };
 
 HashInfo * findHash ( const char * name )
@@ -473,6 +481,24 @@ void test ( hashfunc<hashtype> hash, HashInfo * info )
     printf("\n");
   }
 
+  //-----------------------------------------------------------------------------
+  // Keyset 'DNA'
+
+  if(g_testDNA || g_testAll)
+  {
+    printf("[[[ Keyset 'DNA' Tests ]]]\n\n");
+
+    bool result = true;
+    bool drawDiagram = false;
+
+    result &= DNAKeyTest<hashtype>( hash, 21, 1000000, drawDiagram );
+    result &= DNAKeyTest<hashtype>( hash, 31, 1000000, drawDiagram );
+    result &= DNAKeyTest<hashtype>( hash, 63, 1000000, drawDiagram );
+
+    if(!result) printf("*********FAIL*********\n");
+    printf("\n");
+  }
+
   //-----------------------------------------------------------------------------
   // Keyset 'Seed'
 
@@ -582,6 +608,7 @@ int main ( int argc, char ** argv )
   //g_testPermutation = true;
   //g_testWindow = true;
   //g_testZeroes = true;
+  //g_testDNA = true;
 
   testHash(hashToTest);
 
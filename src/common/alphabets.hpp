@@ -33,7 +33,6 @@
 // TODO add the following alphabets:
 // D/RNA
 // D/RNA5
-// AA (IUPAC amino acid.)
 // CUSTOM (no definition right now)
 
 // TODO add function calls for auto generation into documentation
@@ -739,6 +738,237 @@ namespace bliss
       constexpr std::array<uint8_t, DNA16_T<DUMMY>::SIZE> DNA16_T<DUMMY>::TO_COMPLEMENT;
 
 
+      /// IUPAC amino acid alphabet:  the 20 standard residues in one letter code order, the ambiguity codes B, Z, J and X,
+      /// selenocysteine U, pyrrolysine O, stop '*' and gap '-'.  28 values, 5 bits per residue, so a 64 bit k-mer word
+      /// holds 12 residues.  characters that are not amino acids map to X.  there is no complement (see TO_COMPLEMENT).
+      template <typename DUMMY = void>
+      struct AA_T : BaseAlphabetChar
+      {
+        // This should make char and AA useable interchangebly
+        AA_T& operator=(const CharType& c){ BaseAlphabetChar::operator=(c); return *this;}
+        AA_T(const CharType& c) : BaseAlphabetChar(c) {}
+        AA_T() : BaseAlphabetChar() {}
+
+        /// alphabet size
+        static constexpr AlphabetSizeType SIZE = 28;
+
+        /// ascii to alphabet lookup table.  upper and lower case map to the same value.
+        static constexpr std::array<uint8_t, 256> FROM_ASCII =
+        {{
+        0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19,
+        0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19,
+      //                                                            '*'               '-'   '.'
+        0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x1A, 0x19, 0x19, 0x1B, 0x1B, 0x19,
+        0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19,
+      //      'A'   'B'   'C'   'D'   'E'   'F'   'G'   'H'   'I'   'J'   'K'   'L'   'M'   'N'   'O'
+        0x19, 0x00, 0x14, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x16, 0x08, 0x09, 0x0A, 0x0B, 0x18,
+      //'P'   'Q'   'R'   'S'   'T'   'U'   'V'   'W'   'X'   'Y'   'Z'
+        0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x17, 0x11, 0x12, 0x19, 0x13, 0x15, 0x19, 0x19, 0x19, 0x19, 0x19,
+      //      'a'   'b'   'c'   'd'   'e'   'f'   'g'   'h'   'i'   'j'   'k'   'l'   'm'   'n'   'o'
+        0x19, 0x00, 0x14, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x16, 0x08, 0x09, 0x0A, 0x0B, 0x18,
+      //'p'   'q'   'r'   's'   't'   'u'   'v'   'w'   'x'   'y'   'z'
+        0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x17, 0x11, 0x12, 0x19, 0x13, 0x15, 0x19, 0x19, 0x19, 0x19, 0x19,
+        0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19,
+        0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19,
+        0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19,
+        0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19,
+        0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19,
+        0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19,
+        0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19,
+        0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19, 0x19
+        }};
+
+        /// alphabet to ascii lookup table
+        static constexpr std::array<char, SIZE> TO_ASCII =
+        {{
+        'A',  // = 0
+        'C',  // = 1
+        'D',  // = 2
+        'E',  // = 3
+        'F',  // = 4
+        'G',  // = 5
+        'H',  // = 6
+        'I',  // = 7
+        'K',  // = 8
+        'L',  // = 9
+        'M',  // = 10
+        'N',  // = 11
+        'P',  // = 12
+        'Q',  // = 13
+        'R',  // = 14
+        'S',  // = 15
+        'T',  // = 16
+        'V',  // = 17
+        'W',  // = 18
+        'Y',  // = 19
+        'B',  // = 20   D or N
+        'Z',  // = 21   E or Q
+        'J',  // = 22   I or L
+        'U',  // = 23   selenocysteine
+        'O',  // = 24   pyrrolysine
+        'X',  // = 25   any.  also all unrecognized characters
+        '*',  // = 26   stop
+        '-'   // = 27   gap.  also '.'
+        }};
+
+        /// complement lookup table.  amino acids have no complement, so this is identity, as in ASCII.
+        static constexpr std::array<uint8_t, SIZE> TO_COMPLEMENT = bliss::utils::make_array<uint8_t, SIZE>();
+
+        static inline uint8_t to_complement(uint8_t const & x) {
+          return x;
+        }
+      };
+
+      template <typename DUMMY>
+      constexpr std::array<uint8_t, 256> AA_T<DUMMY>::FROM_ASCII;
+      template <typename DUMMY>
+      constexpr std::array<char, AA_T<DUMMY>::SIZE> AA_T<DUMMY>::TO_ASCII;
+      template <typename DUMMY>
+      constexpr std::array<uint8_t, AA_T<DUMMY>::SIZE> AA_T<DUMMY>::TO_COMPLEMENT;
+
+      /// reduced amino acid alphabet, 10 groups of residues that substitute for each other (Murphy, Wallqvist and Levy 2000,
+      /// Protein Eng. 13: 149-152), plus X.  4 bits per residue, 16 residues per 64 bit k-mer word.  each group decodes to
+      /// its first residue.  ambiguity codes within a group map to it, the rest, stop and gap map to X.
+      template <typename DUMMY = void>
+      struct AA_MURPHY10_T : BaseAlphabetChar
+      {
+        // This should make char and AA useable interchangebly
+        AA_MURPHY10_T& operator=(const CharType& c){ BaseAlphabetChar::operator=(c); return *this;}
+        AA_MURPHY10_T(const CharType& c) : BaseAlphabetChar(c) {}
+        AA_MURPHY10_T() : BaseAlphabetChar() {}
+
+        /// alphabet size
+        static constexpr AlphabetSizeType SIZE = 11;
+
+        /// ascii to alphabet lookup table.  upper and lower case map to the same value.
+        static constexpr std::array<uint8_t, 256> FROM_ASCII =
+        {{
+        0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A,
+        0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A,
+        0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A,
+        0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A,
+      //      'A'   'B'   'C'   'D'   'E'   'F'   'G'   'H'   'I'   'J'   'K'   'L'   'M'   'N'   'O'
+        0x0A, 0x00, 0x08, 0x01, 0x08, 0x08, 0x07, 0x02, 0x03, 0x05, 0x05, 0x09, 0x05, 0x05, 0x08, 0x09,
+      //'P'   'Q'   'R'   'S'   'T'   'U'   'V'   'W'         'Y'   'Z'
+        0x04, 0x08, 0x09, 0x06, 0x06, 0x01, 0x05, 0x07, 0x0A, 0x07, 0x08, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A,
+      //      'a'   'b'   'c'   'd'   'e'   'f'   'g'   'h'   'i'   'j'   'k'   'l'   'm'   'n'   'o'
+        0x0A, 0x00, 0x08, 0x01, 0x08, 0x08, 0x07, 0x02, 0x03, 0x05, 0x05, 0x09, 0x05, 0x05, 0x08, 0x09,
+      //'p'   'q'   'r'   's'   't'   'u'   'v'   'w'         'y'   'z'
+        0x04, 0x08, 0x09, 0x06, 0x06, 0x01, 0x05, 0x07, 0x0A, 0x07, 0x08, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A,
+        0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A,
+        0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A,
+        0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A,
+        0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A,
+        0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A,
+        0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A,
+        0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A,
+        0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A
+        }};
+
+        /// alphabet to ascii lookup table
+        static constexpr std::array<char, SIZE> TO_ASCII =
+        {{
+        'A',  // = 0    A
+        'C',  // = 1    C U
+        'G',  // = 2    G
+        'H',  // = 3    H
+        'P',  // = 4    P
+        'L',  // = 5    L V I M J
+        'S',  // = 6    S T
+        'F',  // = 7    F Y W
+        'E',  // = 8    E D N Q B Z
+        'K',  // = 9    K R O
+        'X'   // = 10   X, stop, gap, and all unrecognized characters
+        }};
+
+        /// complement lookup table.  amino acids have no complement, so this is identity, as in ASCII.
+        static constexpr std::array<uint8_t, SIZE> TO_COMPLEMENT = bliss::utils::make_array<uint8_t, SIZE>();
+
+        static inline uint8_t to_complement(uint8_t const & x) {
+          return x;
+        }
+      };
+
+      template <typename DUMMY>
+      constexpr std::array<uint8_t, 256> AA_MURPHY10_T<DUMMY>::FROM_ASCII;
+      template <typename DUMMY>
+      constexpr std::array<char, AA_MURPHY10_T<DUMMY>::SIZE> AA_MURPHY10_T<DUMMY>::TO_ASCII;
+      template <typename DUMMY>
+      constexpr std::array<uint8_t, AA_MURPHY10_T<DUMMY>::SIZE> AA_MURPHY10_T<DUMMY>::TO_COMPLEMENT;
+
+      /// reduced amino acid alphabet, the 15 group version of AA_MURPHY10_T, plus X.  4 bits per residue.
+      template <typename DUMMY = void>
+      struct AA_MURPHY15_T : BaseAlphabetChar
+      {
+        // This should make char and AA useable interchangebly
+        AA_MURPHY15_T& operator=(const CharType& c){ BaseAlphabetChar::operator=(c); return *this;}
+        AA_MURPHY15_T(const CharType& c) : BaseAlphabetChar(c) {}
+        AA_MURPHY15_T() : BaseAlphabetChar() {}
+
+        /// alphabet size
+        static constexpr AlphabetSizeType SIZE = 16;
+
+        /// ascii to alphabet lookup table.  upper and lower case map to the same value.
+        static constexpr std::array<uint8_t, 256> FROM_ASCII =
+        {{
+        0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+        0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+        0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+        0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+      //      'A'         'C'   'D'   'E'   'F'   'G'   'H'   'I'   'J'   'K'   'L'   'M'   'N'   'O'
+        0x0F, 0x00, 0x0F, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x08, 0x08, 0x07, 0x08, 0x08, 0x09, 0x07,
+      //'P'   'Q'   'R'   'S'   'T'   'U'   'V'   'W'         'Y'
+        0x0A, 0x0B, 0x07, 0x0C, 0x0D, 0x01, 0x08, 0x0E, 0x0F, 0x04, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+      //      'a'         'c'   'd'   'e'   'f'   'g'   'h'   'i'   'j'   'k'   'l'   'm'   'n'   'o'
+        0x0F, 0x00, 0x0F, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x08, 0x08, 0x07, 0x08, 0x08, 0x09, 0x07,
+      //'p'   'q'   'r'   's'   't'   'u'   'v'   'w'         'y'
+        0x0A, 0x0B, 0x07, 0x0C, 0x0D, 0x01, 0x08, 0x0E, 0x0F, 0x04, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+        0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+        0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+        0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+        0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+        0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+        0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+        0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+        0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F
+        }};
+
+        /// alphabet to ascii lookup table
+        static constexpr std::array<char, SIZE> TO_ASCII =
+        {{
+        'A',  // = 0    A
+        'C',  // = 1    C U
+        'D',  // = 2    D
+        'E',  // = 3    E
+        'F',  // = 4    F Y
+        'G',  // = 5    G
+        'H',  // = 6    H
+        'K',  // = 7    K R O
+        'L',  // = 8    L V I M J
+        'N',  // = 9    N
+        'P',  // = 10   P
+        'Q',  // = 11   Q
+        'S',  // = 12   S
+        'T',  // = 13   T
+        'W',  // = 14   W
+        'X'   // = 15   X, B, Z, stop, gap, and all unrecognized characters
+        }};
+
+        /// complement lookup table.  amino acids have no complement, so this is identity, as in ASCII.
+        static constexpr std::array<uint8_t, SIZE> TO_COMPLEMENT = bliss::utils::make_array<uint8_t, SIZE>();
+
+        static inline uint8_t to_complement(uint8_t const & x) {
+          return x;
+        }
+      };
+
+      template <typename DUMMY>
+      constexpr std::array<uint8_t, 256> AA_MURPHY15_T<DUMMY>::FROM_ASCII;
+      template <typename DUMMY>
+      constexpr std::array<char, AA_MURPHY15_T<DUMMY>::SIZE> AA_MURPHY15_T<DUMMY>::TO_ASCII;
+      template <typename DUMMY>
+      constexpr std::array<uint8_t, AA_MURPHY15_T<DUMMY>::SIZE> AA_MURPHY15_T<DUMMY>::TO_COMPLEMENT;
+
     } // namespace alphabet
 
       using ASCII = ::bliss::common::alphabet::ASCII_T<>;
@@ -750,6 +980,9 @@ namespace bliss
       using RNA6 = ::bliss::common::alphabet::RNA6_T<>;
       using DNA16 = ::bliss::common::alphabet::DNA16_T<>;
       using DNA_IUPAC = ::bliss::common::alphabet::DNA_IUPAC_T<>;
+      using AA = ::bliss::common::alphabet::AA_T<>;
+      using AA_MURPHY10 = ::bliss::common::alphabet::AA_MURPHY10_T<>;
+      using AA_MURPHY15 = ::bliss::common::alphabet::AA_MURPHY15_T<>;
 
 
   } // namespace common
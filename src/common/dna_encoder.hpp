@@ -0,0 +1,376 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    dna_encoder.hpp
+ * @ingroup common
+ * @author  tpan
+ * @brief   bulk conversion of ASCII DNA to 2 bit DNA values, and rolling k-mer generation from the converted values.
+ * @details The per-character path (KmerGenerationIterator over a filter and a transform iterator) does 1 table lookup
+ *          and 1 multiword shift per base, behind 3 layers of iterators.  here a block of characters is converted at once
+ *          using SSSE3 or AVX2 shuffles (NEON table lookups on aarch64), with EOL characters removed, then k-mers are generated by shifting the values into
+ *          the k-mer.  for k-mers that fit in a single word, the shift is done directly on the word.
+ *
+ *          conversion is identical to DNA::FROM_ASCII:  A/a = 0, C/c = 1, G/g = 2, T/t = 3, everything else = 0.
+ *          '\n' and '\r' are skipped, same as ::bliss::utils::file::NotEOL.
+ *
+ *          SIMD dispatch follows bitgroup_ops:  dna_encoder is parameterized by the BIT_REV_* SIMD value, and
+ *          DNAEncoder uses BITREV_AVX2::SIMDVal, which falls back to SSSE3, or NEON on aarch64, then scalar depending on compiler flags.
+ *          with BLISS_SIMD_DISPATCH, DNAEncoder instead picks AVX2, SSSE3, or scalar at runtime.  see utils/cpu_features.hpp.
+ */
+#ifndef SRC_COMMON_DNA_ENCODER_HPP_
+#define SRC_COMMON_DNA_ENCODER_HPP_
+
+#include <algorithm>   // min
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "utils/bitgroup_ops.hpp"
+#include "utils/cpu_features.hpp"
+
+namespace bliss {
+
+  namespace common {
+
+    /**
+     * @brief  convert ASCII DNA to 2 bit values, skipping EOL characters.  scalar version.
+     * @tparam SIMD  one of the ::bliss::utils::bit_ops::BIT_REV_* values.
+     */
+    template <unsigned char SIMD = ::bliss::utils::bit_ops::BIT_REV_SEQ>
+    struct dna_encoder {
+        static constexpr unsigned char simd_type = SIMD;
+
+        /// convert a single character.
+        static inline uint8_t convert(unsigned char const c) {
+          return ::bliss::common::DNA::FROM_ASCII[c];
+        }
+
+        /**
+         * @brief convert n characters from in, writing to out.  '\n' and '\r' are removed.
+         * @param out   needs to have space for n values.
+         * @return number of values written to out.
+         */
+        inline size_t operator()(unsigned char const * in, size_t const & n, uint8_t * out) const {
+          uint8_t * o = out;
+          for (size_t i = 0; i < n; ++i) {
+            if ((in[i] != '\n') && (in[i] != '\r')) {
+              *o = convert(in[i]);
+              ++o;
+            }
+          }
+          return o - out;
+        }
+    };
+
+#if defined(__SSSE3__) || defined(BLISS_SIMD_DISPATCH_X86)
+    namespace detail {
+
+      /**
+       * @brief  SSSE3 kernel.  16 characters are converted at a time, using the low nibble to index 2 shuffle tables:
+       *         one for the 2 bit value, and one for the expected lower case character.  characters that do not match are set to 0.
+       *         a 16 byte block that contains EOL is converted with the scalar code.
+       */
+      BLISS_TARGET("ssse3")
+      inline size_t encode_ssse3(unsigned char const * in, size_t const & n, uint8_t * out) {
+        dna_encoder<::bliss::utils::bit_ops::BIT_REV_SEQ> seq;
+
+        // nibble 1 = A, 3 = C, 4 = T, 7 = G.
+        const __m128i code_lut = _mm_setr_epi8(0, 0, 0, 1, 3, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0);
+        const __m128i char_lut = _mm_setr_epi8(-1, 'a', -1, 'c', 't', -1, -1, 'g', -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i lo_mask = _mm_set1_epi8(0x0F);
+        const __m128i case_mask = _mm_set1_epi8(0x20);
+        const __m128i nl = _mm_set1_epi8('\n');
+        const __m128i cr = _mm_set1_epi8('\r');
+
+        uint8_t * o = out;
+        size_t i = 0;
+        for (; (i + 16) <= n; i += 16) {
+          __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i));
+          __m128i eol = _mm_or_si128(_mm_cmpeq_epi8(v, nl), _mm_cmpeq_epi8(v, cr));
+          if (_mm_movemask_epi8(eol) != 0) {
+            o += seq(in + i, 16, o);
+            continue;
+          }
+
+          __m128i lo = _mm_and_si128(v, lo_mask);
+          __m128i valid = _mm_cmpeq_epi8(_mm_or_si128(v, case_mask), _mm_shuffle_epi8(char_lut, lo));
+          _mm_storeu_si128(reinterpret_cast<__m128i *>(o), _mm_and_si128(_mm_shuffle_epi8(code_lut, lo), valid));
+          o += 16;
+        }
+        // remainder
+        o += seq(in + i, n - i, o);
+
+        return o - out;
+      }
+
+    } // namespace detail
+#endif
+
+#if defined(__AVX2__) || defined(BLISS_SIMD_DISPATCH_X86)
+    namespace detail {
+
+      /**
+       * @brief  AVX2 kernel.  32 characters at a time.  same as SSSE3 kernel, with the tables replicated in both lanes.
+       */
+      BLISS_TARGET("avx2")
+      inline size_t encode_avx2(unsigned char const * in, size_t const & n, uint8_t * out) {
+        const __m256i code_lut = _mm256_broadcastsi128_si256(
+            _mm_setr_epi8(0, 0, 0, 1, 3, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0));
+        const __m256i char_lut = _mm256_broadcastsi128_si256(
+            _mm_setr_epi8(-1, 'a', -1, 'c', 't', -1, -1, 'g', -1, -1, -1, -1, -1, -1, -1, -1));
+        const __m256i lo_mask = _mm256_set1_epi8(0x0F);
+        const __m256i case_mask = _mm256_set1_epi8(0x20);
+        const __m256i nl = _mm256_set1_epi8('\n');
+        const __m256i cr = _mm256_set1_epi8('\r');
+
+        uint8_t * o = out;
+        size_t i = 0;
+        for (; (i + 32) <= n; i += 32) {
+          __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(in + i));
+          __m256i eol = _mm256_or_si256(_mm256_cmpeq_epi8(v, nl), _mm256_cmpeq_epi8(v, cr));
+          if (_mm256_movemask_epi8(eol) != 0) {
+            o += encode_ssse3(in + i, 32, o);
+            continue;
+          }
+
+          __m256i lo = _mm256_and_si256(v, lo_mask);
+          __m256i valid = _mm256_cmpeq_epi8(_mm256_or_si256(v, case_mask), _mm256_shuffle_epi8(char_lut, lo));
+          _mm256_storeu_si256(reinterpret_cast<__m256i *>(o), _mm256_and_si256(_mm256_shuffle_epi8(code_lut, lo), valid));
+          o += 32;
+        }
+        // remainder
+        o += encode_ssse3(in + i, n - i, o);
+
+        return o - out;
+      }
+
+    } // namespace detail
+#endif
+
+#if defined(__SSSE3__)
+    /**
+     * @brief  SSSE3 version.  see detail::encode_ssse3.
+     */
+    template <>
+    struct dna_encoder<::bliss::utils::bit_ops::BIT_REV_SSSE3> {
+        static constexpr unsigned char simd_type = ::bliss::utils::bit_ops::BIT_REV_SSSE3;
+
+        inline size_t operator()(unsigned char const * in, size_t const & n, uint8_t * out) const {
+          return detail::encode_ssse3(in, n, out);
+        }
+    };
+#endif
+
+#if defined(__AVX2__)
+    /**
+     * @brief  AVX2 version.  see detail::encode_avx2.
+     */
+    template <>
+    struct dna_encoder<::bliss::utils::bit_ops::BIT_REV_AVX2> {
+        static constexpr unsigned char simd_type = ::bliss::utils::bit_ops::BIT_REV_AVX2;
+
+        inline size_t operator()(unsigned char const * in, size_t const & n, uint8_t * out) const {
+          return detail::encode_avx2(in, n, out);
+        }
+    };
+#endif
+
+#if defined(BLISS_BITREV_NEON)
+    /**
+     * @brief  NEON version.  16 characters at a time.  same tables as the SSSE3 version, looked up with TBL.
+     *         NEON has no movemask, so the EOL check uses the across vector max.
+     */
+    template <>
+    struct dna_encoder<::bliss::utils::bit_ops::BIT_REV_NEON> {
+        static constexpr unsigned char simd_type = ::bliss::utils::bit_ops::BIT_REV_NEON;
+
+        inline size_t operator()(unsigned char const * in, size_t const & n, uint8_t * out) const {
+          dna_encoder<::bliss::utils::bit_ops::BIT_REV_SEQ> seq;
+
+          // nibble 1 = A, 3 = C, 4 = T, 7 = G.
+          static const uint8_t code_tbl[16] = {0, 0, 0, 1, 3, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0};
+          static const uint8_t char_tbl[16] = {0xFF, 'a', 0xFF, 'c', 't', 0xFF, 0xFF, 'g', 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+          const uint8x16_t code_lut = vld1q_u8(code_tbl);
+          const uint8x16_t char_lut = vld1q_u8(char_tbl);
+          const uint8x16_t lo_mask = vdupq_n_u8(0x0F);
+          const uint8x16_t case_mask = vdupq_n_u8(0x20);
+          const uint8x16_t nl = vdupq_n_u8('\n');
+          const uint8x16_t cr = vdupq_n_u8('\r');
+
+          uint8_t * o = out;
+          size_t i = 0;
+          for (; (i + 16) <= n; i += 16) {
+            uint8x16_t v = vld1q_u8(in + i);
+            uint8x16_t eol = vorrq_u8(vceqq_u8(v, nl), vceqq_u8(v, cr));
+            if (vmaxvq_u8(eol) != 0) {
+              o += seq(in + i, 16, o);
+              continue;
+            }
+
+            uint8x16_t lo = vandq_u8(v, lo_mask);
+            uint8x16_t valid = vceqq_u8(vorrq_u8(v, case_mask), vqtbl1q_u8(char_lut, lo));
+            vst1q_u8(o, vandq_u8(vqtbl1q_u8(code_lut, lo), valid));
+            o += 16;
+          }
+          // remainder
+          o += seq(in + i, n - i, o);
+
+          return o - out;
+        }
+    };
+#endif
+
+#if defined(BLISS_SIMD_DISPATCH_X86)
+    /**
+     * @brief  runtime dispatched encoder:  AVX2, SSSE3, or scalar, depending on the CPU the process runs on.
+     */
+    struct dna_encoder_dispatch {
+        /// not known at compile time.  see ::bliss::utils::cpu::get_features().
+        static constexpr unsigned char simd_type = 0xFF;
+
+        inline size_t operator()(unsigned char const * in, size_t const & n, uint8_t * out) const {
+          if (::bliss::utils::cpu::has_avx2()) return detail::encode_avx2(in, n, out);
+          if (::bliss::utils::cpu::has_ssse3()) return detail::encode_ssse3(in, n, out);
+          return dna_encoder<::bliss::utils::bit_ops::BIT_REV_SEQ>()(in, n, out);
+        }
+    };
+
+    /// best available DNA encoder for the CPU.
+    using DNAEncoder = dna_encoder_dispatch;
+#else
+    /// best available DNA encoder for the compiler flags.
+    using DNAEncoder = dna_encoder<::bliss::utils::bit_ops::BITREV_AVX2::SIMDVal>;
+#endif
+
+
+    /// trait to detect iterators over contiguous single byte characters, for which the bulk encoder can be used.
+    template <typename Iter>
+    struct is_contiguous_char_iterator : public ::std::false_type {};
+    template <typename T>
+    struct is_contiguous_char_iterator<T*> :
+      public ::std::integral_constant<bool, (sizeof(T) == 1) && ::std::is_integral<T>::value> {};
+    template <>
+    struct is_contiguous_char_iterator<typename ::std::vector<unsigned char>::iterator> : public ::std::true_type {};
+    template <>
+    struct is_contiguous_char_iterator<typename ::std::vector<unsigned char>::const_iterator> : public ::std::true_type {};
+    template <>
+    struct is_contiguous_char_iterator<typename ::std::vector<char>::iterator> : public ::std::true_type {};
+    template <>
+    struct is_contiguous_char_iterator<typename ::std::vector<char>::const_iterator> : public ::std::true_type {};
+    template <>
+    struct is_contiguous_char_iterator<typename ::std::string::iterator> : public ::std::true_type {};
+    template <>
+    struct is_contiguous_char_iterator<typename ::std::string::const_iterator> : public ::std::true_type {};
+
+
+    /**
+     * @brief generate all k-mers from an ASCII character array, skipping EOL characters.
+     * @details  produces the same k-mers as KmerGenerationIterator over NotEOL filtered, ASCII2<Alphabet> transformed characters.
+     *           characters are converted in tiles so the intermediate buffer stays in L1.
+     * @tparam Kmer     k-mer type.
+     * @tparam Encoder  bulk encoder for the k-mer's alphabet.
+     */
+    template <typename Kmer, typename Encoder>
+    struct EncodedKmerGenerator {
+        using WORD_TYPE = typename Kmer::KmerWordType;
+
+        /// number of characters converted at a time.
+        static constexpr size_t tile_size = 1024;
+
+        /// mask for the used bits when the kmer fits in a single word.
+        static constexpr WORD_TYPE word_mask = (Kmer::nBits >= (sizeof(WORD_TYPE) * 8)) ?
+            ~(static_cast<WORD_TYPE>(0)) :
+            static_cast<WORD_TYPE>((static_cast<WORD_TYPE>(1) << (Kmer::nBits % (sizeof(WORD_TYPE) * 8))) - 1);
+
+        /**
+         * @brief  generate k-mers from [begin, end) and write to output.
+         * @return new position of output iterator.
+         */
+        template <typename OutputIt>
+        OutputIt operator()(unsigned char const * begin, unsigned char const * end, OutputIt output) const {
+          if (end <= begin) return output;
+
+          Encoder encode;
+          uint8_t buf[tile_size];
+
+          Kmer km(true);
+          size_t filled = 0;   // number of characters in km, up to k - 1.
+
+          size_t len, n, i;
+          for (unsigned char const * it = begin; it < end; it += len) {
+            len = ::std::min(tile_size, static_cast<size_t>(end - it));
+            n = encode(it, len, buf);
+
+            // fill first k-1 characters
+            for (i = 0; (filled < (Kmer::size - 1)) && (i < n); ++i, ++filled) {
+              km.nextFromChar(buf[i]);
+            }
+
+            output = roll(km, buf + i, buf + n, output);
+          }
+
+          return output;
+        }
+
+      protected:
+
+        /// shift each value into the kmer and output the kmer.  single word version works directly on the word.
+        template <typename OutputIt>
+        inline OutputIt roll(Kmer & km, uint8_t const * first, uint8_t const * last, OutputIt output) const {
+          if (Kmer::nWords == 1) {
+            WORD_TYPE w = km.getData()[0];
+            for (; first != last; ++first, ++output) {
+              w = static_cast<WORD_TYPE>((w << Kmer::bitsPerChar) | static_cast<WORD_TYPE>(*first)) & word_mask;
+              km.getDataRef()[0] = w;
+              *output = km;
+            }
+          } else {
+            for (; first != last; ++first, ++output) {
+              km.nextFromChar(*first);
+              *output = km;
+            }
+          }
+          return output;
+        }
+    };
+
+    template <typename Kmer, typename Encoder>
+    constexpr size_t EncodedKmerGenerator<Kmer, Encoder>::tile_size;
+    template <typename Kmer, typename Encoder>
+    constexpr typename EncodedKmerGenerator<Kmer, Encoder>::WORD_TYPE EncodedKmerGenerator<Kmer, Encoder>::word_mask;
+
+
+    /**
+     * @brief generate all k-mers from an ASCII DNA character array, skipping EOL characters.
+     * @tparam Kmer     DNA k-mer type.
+     * @tparam Encoder  bulk encoder, default to best available.
+     */
+    template <typename Kmer, typename Encoder = DNAEncoder>
+    struct DNAKmerGenerator : public EncodedKmerGenerator<Kmer, Encoder> {
+        static_assert(::std::is_same<typename Kmer::KmerAlphabet, ::bliss::common::DNA>::value,
+                      "DNAKmerGenerator only supports DNA alphabet");
+    };
+
+  } // namespace common
+} // namespace bliss
+
+#endif /* SRC_COMMON_DNA_ENCODER_HPP_ */
@@ -157,6 +157,22 @@ namespace bliss
     /// number of allocated bytes
     static constexpr unsigned int nAllocBytes = nWords * bitstream::bytesPerWord;
 
+    /*
+     * storage layouts with specialized shift and compare paths, selected at compile time.
+     * most k-mers in use (k = 21, 31) fit in 1 word, and k <= 64 DNA fits in 2 64 bit words,
+     * which are shifted and compared as a single __uint128_t instead of looping over words.
+     */
+    struct multi_word_storage {};
+    struct single_word_storage {};
+    struct double_word_storage {};
+#if defined(__SIZEOF_INT128__)
+    static constexpr bool use_uint128 = (nWords == 2) && (sizeof(WORD_TYPE) == sizeof(uint64_t));
+#else
+    static constexpr bool use_uint128 = false;
+#endif
+    using storage_type = typename ::std::conditional<(nWords == 1), single_word_storage,
+        typename ::std::conditional<use_uint128, double_word_storage, multi_word_storage>::type>::type;
+
     /*
      * last character offsets (and whether or not it is split accord storage
      * words)
@@ -790,7 +806,7 @@ namespace bliss
     KMER_INLINE bool operator==(const Kmer& rhs) const
     {
       // MUST COMPARE ALL BITS, INCLUDING UNUSED
-    	return ::bliss::utils::bit_ops::equal<WORD_TYPE, nWords>(data, rhs.data);
+    	return equal_impl(rhs, storage_type());
     }
 
     /**
@@ -819,7 +835,7 @@ namespace bliss
      */
     KMER_INLINE bool operator<(const Kmer& rhs) const
     {
-    	return ::bliss::utils::bit_ops::less<WORD_TYPE, nWords>(data, rhs.data);
+    	return less_impl(rhs, storage_type());
     }
   
     /**
@@ -861,7 +877,7 @@ namespace bliss
   
 
     KMER_INLINE int8_t compare(const Kmer& rhs) const {
-      return ::bliss::utils::bit_ops::compare<WORD_TYPE, nWords>(data, rhs.data);
+      return compare_impl(rhs, storage_type());
     }
 
     /* bit operators */
@@ -1417,9 +1433,13 @@ namespace bliss
      */
     template <unsigned int shift = bitsPerChar, typename WType>
     KMER_INLINE void nextFromWordInternal(WType w)
+    {
+      nextFromWordInternal<shift>(w, storage_type());
+    }
+    template <unsigned int shift, typename WType>
+    KMER_INLINE void nextFromWordInternal(WType w, multi_word_storage)
     {
       // left shift k-mer
-      // TODO: replace by single shift operation
       this->template left_shift_bits<shift>();
   
       // add character to least significant end (requires least shifting)
@@ -1428,6 +1448,18 @@ namespace bliss
 
       std::atomic_thread_fence(std::memory_order_relaxed);
     }
+    template <unsigned int shift, typename WType>
+    KMER_INLINE void nextFromWordInternal(WType w, single_word_storage)
+    {
+      data[0] = static_cast<WORD_TYPE>(((data[0] << shift) | (static_cast<WORD_TYPE>(w) &
+          getLeastSignificantBitsMask<WORD_TYPE>(shift))));
+    }
+    template <unsigned int shift, typename WType>
+    KMER_INLINE void nextFromWordInternal(WType w, double_word_storage)
+    {
+      store_uint128(((load_uint128() << shift) | (static_cast<WORD_TYPE>(w) &
+          getLeastSignificantBitsMask<WORD_TYPE>(shift))));
+    }
 
     /**
      * @brief internal method to add one more character to the kmer at the MSB side
@@ -1436,16 +1468,73 @@ namespace bliss
     template <unsigned int shift = bitsPerChar, typename WType>
     KMER_INLINE void nextReverseFromWordInternal(WType w)
     {
-      // left shift k-mer
-      // TODO: replace by single shift operation
+      nextReverseFromWordInternal<shift>(w, storage_type());
+    }
+    template <unsigned int shift, typename WType>
+    KMER_INLINE void nextReverseFromWordInternal(WType w, multi_word_storage)
+    {
+      // right shift k-mer
       this->template right_shift_bits<shift>();
 
-      // add character to least significant end (requires least shifting)
+      // add character to most significant end
       data[nWords - 1] |= (static_cast<WORD_TYPE>(w) &
           getLeastSignificantBitsMask<WORD_TYPE>(shift)) << (bitstream::invPadBits - shift);
 
       std::atomic_thread_fence(std::memory_order_relaxed);
     }
+    template <unsigned int shift, typename WType>
+    KMER_INLINE void nextReverseFromWordInternal(WType w, single_word_storage)
+    {
+      data[0] = static_cast<WORD_TYPE>((data[0] >> shift) | ((static_cast<WORD_TYPE>(w) &
+          getLeastSignificantBitsMask<WORD_TYPE>(shift)) << (bitstream::invPadBits - shift)));
+    }
+    template <unsigned int shift, typename WType>
+    KMER_INLINE void nextReverseFromWordInternal(WType w, double_word_storage)
+    {
+      store_uint128((load_uint128() >> shift) | (static_cast<unsigned __int128>(static_cast<WORD_TYPE>(w) &
+          getLeastSignificantBitsMask<WORD_TYPE>(shift)) << (bitstream::bitsPerWord + bitstream::invPadBits - shift)));
+    }
+
+    // ======== compare for each storage layout.  k-mers are sanitized, so the pad bits are 0 and compare equal.
+    KMER_INLINE bool equal_impl(Kmer const & rhs, multi_word_storage) const {
+      return ::bliss::utils::bit_ops::equal<WORD_TYPE, nWords>(data, rhs.data);
+    }
+    KMER_INLINE bool equal_impl(Kmer const & rhs, single_word_storage) const {
+      return data[0] == rhs.data[0];
+    }
+    KMER_INLINE bool equal_impl(Kmer const & rhs, double_word_storage) const {
+      return ((data[0] ^ rhs.data[0]) | (data[1] ^ rhs.data[1])) == 0;
+    }
+    KMER_INLINE bool less_impl(Kmer const & rhs, multi_word_storage) const {
+      return ::bliss::utils::bit_ops::less<WORD_TYPE, nWords>(data, rhs.data);
+    }
+    KMER_INLINE bool less_impl(Kmer const & rhs, single_word_storage) const {
+      return data[0] < rhs.data[0];
+    }
+    /// ordering of 2 words stays with bit_ops:  its branchless SIMD compare beats both __uint128_t and per-word compares.
+    KMER_INLINE bool less_impl(Kmer const & rhs, double_word_storage) const {
+      return less_impl(rhs, multi_word_storage());
+    }
+    KMER_INLINE int8_t compare_impl(Kmer const & rhs, multi_word_storage) const {
+      return ::bliss::utils::bit_ops::compare<WORD_TYPE, nWords>(data, rhs.data);
+    }
+    KMER_INLINE int8_t compare_impl(Kmer const & rhs, single_word_storage) const {
+      return static_cast<int8_t>(static_cast<int>(data[0] > rhs.data[0]) - static_cast<int>(data[0] < rhs.data[0]));
+    }
+    KMER_INLINE int8_t compare_impl(Kmer const & rhs, double_word_storage) const {
+      return compare_impl(rhs, multi_word_storage());
+    }
+
+#if defined(__SIZEOF_INT128__)
+    /// the 2 words as 1 128 bit value, data[1] is the high half.  only for double_word_storage.
+    KMER_INLINE unsigned __int128 load_uint128() const {
+      return (static_cast<unsigned __int128>(data[1]) << 64) | static_cast<unsigned __int128>(data[0]);
+    }
+    KMER_INLINE void store_uint128(unsigned __int128 const & x) {
+      data[0] = static_cast<WORD_TYPE>(x);
+      data[1] = static_cast<WORD_TYPE>(x >> 64);
+    }
+#endif
   
     /**
      * @brief Sets all unused bits of the underlying k-mer data to 0.
@@ -1738,7 +1827,7 @@ namespace bliss
                                       WORD_TYPE, nWords
           >(result.data, src.data,
               [&op](typename SIMDType::MachineWord const & src){
-          return bliss::utils::bit_ops::bit_not(op.reverse(src));
+          return bliss::utils::bit_ops::reverse_not(op, src);
         });
       } else if (left_shift == -1) {  // right shift
         bliss::utils::bit_ops::reverse_transform<SIMDType,
@@ -1747,7 +1836,7 @@ namespace bliss
                                       WORD_TYPE, nWords
           >(result.data, src.data,
               [&op](typename SIMDType::MachineWord const & src){
-          return bliss::utils::bit_ops::bit_not(op.reverse(src));
+          return bliss::utils::bit_ops::reverse_not(op, src);
         });
       } else if (left_shift == 1) {  // left shift
         if (bitsPerChar == bitstream::padBits) {
@@ -1757,7 +1846,7 @@ namespace bliss
                                       WORD_TYPE, nWords
             >(result.data, src.data,
                 [&op](typename SIMDType::MachineWord const & src){
-            return bliss::utils::bit_ops::bit_not(op.reverse(src));
+            return bliss::utils::bit_ops::reverse_not(op, src);
           });
 	  result.data[0] &= ~(getLeastSignificantBitsMask<WORD_TYPE>(bitstream::padBits)); // clear the pad bits that would have been shifted.
 
@@ -1771,7 +1860,7 @@ namespace bliss
                                       WORD_TYPE, nWords
             >(temp.data, src.data,
                 [&op](typename SIMDType::MachineWord const & src){
-            return bliss::utils::bit_ops::bit_not(op.reverse(src));
+            return bliss::utils::bit_ops::reverse_not(op, src);
           });
 	  temp.data[0] &= ~(getLeastSignificantBitsMask<WORD_TYPE>(bitstream::padBits)); // clear the pad bits that would have been shifted.
 
@@ -1791,7 +1880,7 @@ namespace bliss
                                       WORD_TYPE, nWords
           >(result.data, src.data,
               [&op](typename SIMDType::MachineWord const & src){
-          return bliss::utils::bit_ops::bit_not(op.reverse(src));
+          return bliss::utils::bit_ops::reverse_not(op, src);
         });
 	result.data[0] &= ~(getLeastSignificantBitsMask<WORD_TYPE>(bitstream::padBits)); // clear the pad bits that would have been shifted.
 
@@ -2055,6 +2144,8 @@ namespace bliss
   constexpr unsigned int Kmer<KMER_SIZE, ALPHABET, WORD_TYPE>::nBytes;
   template<unsigned int KMER_SIZE, typename ALPHABET, typename WORD_TYPE>
   constexpr unsigned int Kmer<KMER_SIZE, ALPHABET, WORD_TYPE>::nWords;
+  template<unsigned int KMER_SIZE, typename ALPHABET, typename WORD_TYPE>
+  constexpr bool Kmer<KMER_SIZE, ALPHABET, WORD_TYPE>::use_uint128;
 
   /**
    * @brief print kmer to output stream
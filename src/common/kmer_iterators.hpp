@@ -20,7 +20,7 @@
  * @author  Patrick Flick
  * @author  Tony Pan <tpan7@gatech.edu>
  * @brief   iterator to generate kmers from a sequence of characters in alphabet (DNA, etc)
- * @details include support for Kmer and reverse Kmer (for reverse complement)
+ * @details include support for Kmer and reverse Kmer (for reverse complement), and spaced (gapped) Kmer
  *
  *          These classes DO NOT perform translation from ASCII to selected alphabet.
  *          To handle that, use "bliss::utils::ASCII2<ALPHABET>" functor with a transform iterator
@@ -34,8 +34,15 @@
 #include <cstdlib>
 
 // C++ STL includes:
+#include <array>
 #include <iterator>
+#include <limits>
 #include <type_traits>
+#include <utility>
+
+#if defined(__BMI2__)
+#include <immintrin.h>  // pext
+#endif
 
 // own includes
 #include "common/base_types.hpp"
@@ -180,6 +187,95 @@ namespace bliss
   };
   
   
+  /**
+   * @brief The sliding window operator for canonical k-mer generation from character data.
+   * @details  maintains the forward k-mer and its reverse complement together.  each new character
+   *           is shifted into the forward k-mer at the least significant end, and its complement is
+   *           shifted into the reverse complement k-mer at the most significant end, so both are O(1)
+   *           per character instead of a full reverse complement per position.
+   *           value is the lexicographically smaller of the two, same as bliss::kmer::transform::lex_less.
+   *
+   * @tparam BaseIterator Type of the underlying base iterator, which returns
+   *                      characters.
+   * @tparam Kmer         The k-mer type, must be of type bliss::Kmer
+   */
+  template <class BaseIterator, class Kmer>
+  class CanonicalKmerSlidingWindow {};
+
+  template <typename BaseIterator, unsigned int KMER_SIZE,
+            typename ALPHABET, typename word_type>
+  class CanonicalKmerSlidingWindow<BaseIterator, bliss::common::Kmer<KMER_SIZE, ALPHABET, word_type> >
+  {
+  public:
+    /// The Kmer type (same as the `value_type` of this iterator)
+    typedef bliss::common::Kmer<KMER_SIZE, ALPHABET, word_type> kmer_type;
+    typedef BaseIterator  base_iterator_type;
+    /// The value_type of the underlying iterator
+    typedef typename std::iterator_traits<BaseIterator>::value_type base_value_type;
+
+    /**
+     * @brief Initializes the sliding window.
+     *
+     * @param it[in|out]  The current base iterator position. This will be set to
+     *                    the last read position.
+     */
+    inline void init(BaseIterator& it)
+    {
+      // shifting in KMER_SIZE characters replaces all previous content, so no need to clear.
+      for (unsigned int i = 0; i < KMER_SIZE; ++i) {
+        this->add(*it);
+        // stop on last, same as fillFromChars(it, true)
+        if (i < (KMER_SIZE - 1)) ++it;
+      }
+    }
+
+    /**
+     * @brief Slides the window by one character taken from the given iterator.
+     *
+     * This will read the current character of the iterator and then advance the
+     * iterator by one.
+     *
+     * @param it[in|out]  The underlying iterator position, this will be read
+     *                    and then advanced.
+     */
+    inline void next(BaseIterator& it)
+    {
+      this->add(*it);
+      ++it;
+    }
+
+    /**
+     * @brief Returns the value of the current sliding window, i.e., the
+     *        canonical (lexicographically smaller) of the current k-mer and its reverse complement.
+     *
+     * @return The current canonical k-mer value.
+     */
+    inline kmer_type getValue()
+    {
+      return (this->kmer < this->revcomp) ? this->kmer : this->revcomp;
+    }
+
+    /// the current forward k-mer
+    inline kmer_type const & getKmer() const { return this->kmer; }
+
+    /// the current reverse complement k-mer
+    inline kmer_type const & getReverseComplement() const { return this->revcomp; }
+
+  private:
+    /// shift one character into both windows.
+    inline void add(base_value_type const & c)
+    {
+      kmer.nextFromChar(c);
+      revcomp.nextReverseFromChar(ALPHABET::to_complement(c));
+    }
+
+    /// The forward kmer buffer
+    kmer_type kmer;
+    /// The reverse complement kmer buffer
+    kmer_type revcomp;
+  };
+
+
   /**
    * @brief Iterator that generates k-mers from character data.
    *
@@ -276,6 +372,368 @@ namespace bliss
   /// reverse KmerGenerationIterator for generating kmers from a sequence of alphabet characters.  can be used for reverse complements.
   template <class BaseIterator, class Kmer>
   using ReverseKmerGenerationIterator = KmerGenerationIteratorBase<ReverseKmerSlidingWindow<BaseIterator, Kmer > >;
+
+  /// canonical KmerGenerationIterator, generates min(kmer, revcomp) with rolling forward and reverse complement windows.
+  template <class BaseIterator, class Kmer>
+  using CanonicalKmerGenerationIterator = KmerGenerationIteratorBase<CanonicalKmerSlidingWindow<BaseIterator, Kmer > >;
+
+  /**
+   * @brief The sliding window operator for k-mer generation with a rolling hash, e.g. bliss::kmer::hash::nthash.
+   * @details  the hash is updated in O(1) per character alongside the k-mer, so a precomputed hash is available
+   *           without hashing the k-mer again.  the value is (k-mer, hash).
+   *           RollingHash provides state, init(kmer) -> state, roll(state &, out char, in char), and value(state) -> uint64_t,
+   *           with value(init(kmer)) the hash of kmer.
+   *
+   * @tparam BaseIterator Type of the underlying base iterator, which returns
+   *                      characters.
+   * @tparam Kmer         The k-mer type, must be of type bliss::Kmer
+   * @tparam RollingHash  rolling hash functor type.
+   */
+  template <class BaseIterator, class Kmer, class RollingHash>
+  class RollingHashKmerSlidingWindow {};
+
+  template <typename BaseIterator, unsigned int KMER_SIZE,
+            typename ALPHABET, typename word_type, typename RollingHash>
+  class RollingHashKmerSlidingWindow<BaseIterator, bliss::common::Kmer<KMER_SIZE, ALPHABET, word_type>, RollingHash>
+  {
+  public:
+    typedef bliss::common::Kmer<KMER_SIZE, ALPHABET, word_type> kmer_type;
+    typedef ::std::pair<kmer_type, uint64_t> value_type;
+    typedef BaseIterator  base_iterator_type;
+    /// The value_type of the underlying iterator
+    typedef typename std::iterator_traits<BaseIterator>::value_type base_value_type;
+
+    RollingHashKmerSlidingWindow(RollingHash const & _hash = RollingHash()) : hash(_hash) {}
+
+    inline void init(BaseIterator& it)
+    {
+      kmer.fillFromChars(it, true);
+      st = hash.init(kmer);
+    }
+
+    inline void next(BaseIterator& it)
+    {
+      uint64_t out = static_cast<uint64_t>(kmer.getCharsAtPos(KMER_SIZE - 1, 1));
+      base_value_type c = *it;
+      kmer.nextFromChar(c);
+      hash.roll(st, out, static_cast<uint64_t>(c));
+      ++it;
+    }
+
+    /// the current k-mer and its hash.
+    inline value_type getValue()
+    {
+      return value_type(this->kmer, hash.value(st));
+    }
+
+    /// the current hash only.
+    inline uint64_t getHash() const { return hash.value(st); }
+
+  private:
+    RollingHash hash;
+    kmer_type kmer;
+    typename RollingHash::state st;
+  };
+
+  /// KmerGenerationIterator that also yields a rolling hash:  the value is std::pair<Kmer, uint64_t>.
+  template <class BaseIterator, class Kmer, class RollingHash>
+  using RollingHashKmerGenerationIterator = KmerGenerationIteratorBase<RollingHashKmerSlidingWindow<BaseIterator, Kmer, RollingHash > >;
+
+  /**
+   * @brief (w, k)-minimizer selection over the consecutive k-mers of a read, with a monotone deque.
+   * @details  of every W consecutive k-mers, the one with the smallest hash (the first one on ties) is selected, and
+   *           each selected k-mer is output once, by the first window that selects it.  for random sequence about
+   *           2 / (W + 1) of the k-mers are selected, and 2 sequences sharing W + k - 1 characters share a minimizer.
+   *
+   *           the deque holds the k-mers of the current window with increasing hashes, so each k-mer is pushed and
+   *           popped once.  the hash is rolled with RollingHash, as in RollingHashKmerSlidingWindow, so the input has to
+   *           be the consecutive k-mers of 1 read, e.g. 1 KmerGenerationIterator range.  fewer than W k-mers output nothing.
+   * @tparam Kmer         The k-mer type, must be of type bliss::Kmer
+   * @tparam W            window, in k-mers.
+   * @tparam RollingHash  rolling hash functor type, e.g. bliss::kmer::hash::nthash.  canonical for a canonical index.
+   */
+  template <class Kmer, unsigned int W, class RollingHash>
+  class WindowedMinimizer {
+    static_assert(W > 0, "minimizer window has to have at least 1 k-mer.");
+
+  protected:
+    RollingHash hash;
+
+    struct identity_key {
+      inline Kmer const & operator()(Kmer const & x) const { return x; }
+    };
+
+  public:
+    static constexpr unsigned int window = W;
+
+    WindowedMinimizer(RollingHash const & _hash = RollingHash()) : hash(_hash) {}
+
+    /**
+     * @brief output the minimizers of the consecutive k-mers in [first, last).
+     * @param get_kmer  gives the k-mer of an input element, e.g. the first of a (k-mer, position) pair.
+     * @return  new position for output.  the elements themselves are output, in input order.
+     */
+    template <typename It, typename OutputIt, typename GetKmer>
+    OutputIt operator()(It first, It last, OutputIt output, GetKmer const & get_kmer) const {
+      typedef typename std::iterator_traits<It>::value_type V;
+      struct entry {
+        uint64_t h;
+        size_t i;
+        V v;
+      };
+
+      // deque in a ring buffer.  entries have positions in (i - W, i], so at most W of them.
+      ::std::array<entry, W> q;
+      size_t head = 0, count = 0;
+      size_t last_out = ::std::numeric_limits<size_t>::max();
+
+      typename RollingHash::state st;
+      Kmer prev;
+      uint64_t h;
+      for (size_t i = 0; first != last; ++first, ++i) {
+        V v = *first;
+        Kmer const & km = get_kmer(v);
+        if (i == 0) st = hash.init(km);
+        else hash.roll(st, prev.getCharsAtPos(Kmer::size - 1, 1), km.getCharsAtPos(0, 1));
+        prev = km;
+        h = hash.value(st);
+
+        // the front leaves the window, then larger hashes can never be the minimum again.
+        if ((count > 0) && ((q[head].i + W) <= i)) {
+          head = (head + 1) % W;
+          --count;
+        }
+        while ((count > 0) && (q[(head + count - 1) % W].h > h)) --count;
+        q[(head + count) % W] = entry{h, i, v};
+        ++count;
+
+        // full window:  output the minimum if it is new.
+        if (((i + 1) >= W) && (q[head].i != last_out)) {
+          last_out = q[head].i;
+          *output = q[head].v;
+          ++output;
+        }
+      }
+      return output;
+    }
+
+    /// output the minimizers of the consecutive k-mers in [first, last).
+    template <typename It, typename OutputIt>
+    OutputIt operator()(It first, It last, OutputIt output) const {
+      return this->operator()(first, last, output, identity_key());
+    }
+  };
+  template <class Kmer, unsigned int W, class RollingHash>
+  constexpr unsigned int WindowedMinimizer<Kmer, W, RollingHash>::window;
+
+
+
+  namespace spaced {
+    /// number of binary digits of s.
+    constexpr unsigned int count_span(uint64_t s) {
+      return (s == 0) ? 0 : 1 + count_span(s >> 1);
+    }
+    /// number of 1s in s.
+    constexpr unsigned int count_weight(uint64_t s) {
+      return (s == 0) ? 0 : static_cast<unsigned int>(s & 1) + count_weight(s >> 1);
+    }
+    /// s with each bit expanded to bits bits.  bits past 64 are dropped.
+    constexpr uint64_t expand(uint64_t s, unsigned int bits, unsigned int pos = 0) {
+      return ((s == 0) || ((pos + 1) * bits > 64)) ? 0 :
+          ((((s & 1) == 0) ? 0 : (((bits == 64) ? ~(0ULL) : ((1ULL << bits) - 1)) << (pos * bits))) |
+           expand(s >> 1, bits, pos + 1));
+    }
+    constexpr unsigned int max_span(unsigned int s) { return s; }
+    template <typename... Rest>
+    constexpr unsigned int max_span(unsigned int s, unsigned int t, Rest... rest) {
+      return max_span((s > t) ? s : t, rest...);
+    }
+  } // namespace spaced
+
+  /**
+   * @brief compile time spaced seed.  the binary digits of SEED, most significant first, are the positions of the
+   *        span, first to last, and a 1 keeps that character:  0xD (1101) keeps characters 0, 1 and 3 of 4.
+   * @details  the first and last characters are always kept, so the span is the number of binary digits, up to 64,
+   *        and the weight, the size of the gapped k-mer, is the number of 1s.
+   *
+   *        bit b of SEED is also character b of a span length k-mer counting from the least significant (most
+   *        recently added) end, so extract() is a parallel bit extract of the k-mer word with SEED expanded to
+   *        bitsPerChar bits per character.  that is 1 pext with BMI2 when the span fits in 1 word.  without BMI2,
+   *        each run of kept characters is shifted into place.  multiword spans copy 1 character at a time.
+   */
+  template <uint64_t SEED>
+  struct spaced_seed {
+      static_assert((SEED & 1) == 1, "the last character of a spaced seed has to be kept.");
+
+      static constexpr uint64_t value = SEED;
+
+      /// number of characters spanned by the seed.
+      static constexpr unsigned int span = spaced::count_span(SEED);
+      /// number of characters kept by the seed.
+      static constexpr unsigned int weight = spaced::count_weight(SEED);
+
+    protected:
+      static inline uint64_t low_bits(unsigned int n) {
+        return (n >= 64) ? ~(0ULL) : ((1ULL << n) - 1);
+      }
+
+      /// single word:  pext or shifted runs.
+      template <uint64_t S, typename OutKmer, typename SpanKmer>
+      static inline OutKmer do_extract(SpanKmer const & window, ::std::true_type const &) {
+        constexpr unsigned int bits = SpanKmer::bitsPerChar;
+        uint64_t w = static_cast<uint64_t>(window.getData()[0]);
+        uint64_t r;
+#if defined(__BMI2__)
+        r = _pext_u64(w, spaced::expand(S, bits));
+#else
+        r = 0;
+        uint64_t s = S;
+        unsigned int pos = 0, out = 0, run;
+        while (s != 0) {
+          // skip the gap, then copy the run of 1s.
+          run = __builtin_ctzll(s);
+          pos += run;
+          s >>= run;
+          run = (s == ~(0ULL)) ? 64 : __builtin_ctzll(~s);
+          r |= ((w >> (pos * bits)) & low_bits(run * bits)) << (out * bits);
+          pos += run;
+          out += run;
+          s = (run >= 64) ? 0 : (s >> run);
+        }
+#endif
+        OutKmer km(true);
+        km.getDataRef()[0] = static_cast<typename OutKmer::KmerWordType>(r);
+        return km;
+      }
+
+      /// multiple words:  1 character at a time, from the first (most significant).
+      template <uint64_t S, typename OutKmer, typename SpanKmer>
+      static inline OutKmer do_extract(SpanKmer const & window, ::std::false_type const &) {
+        OutKmer km(true);
+        for (int b = static_cast<int>(spaced::count_span(S)) - 1; b >= 0; --b) {
+          if ((S >> b) & 1) km.nextFromChar(window.getCharsAtPos(b, 1));
+        }
+        return km;
+      }
+
+    public:
+      /**
+       * @brief  the gapped k-mer of window, for a seed that is aligned to the start of the window and shifted by
+       *         offset characters towards its end.  SpanKmer::size >= span + offset.
+       */
+      template <typename OutKmer, unsigned int offset = 0, typename SpanKmer>
+      static inline OutKmer extract(SpanKmer const & window) {
+        static_assert(OutKmer::size == weight, "spaced seed weight and output k-mer size differ.");
+        static_assert(SpanKmer::size >= span + offset, "window is shorter than the spaced seed.");
+        constexpr unsigned int shift = SpanKmer::size - span - offset;
+        return do_extract<(SEED << shift), OutKmer>(window,
+            ::std::integral_constant<bool, (SpanKmer::nWords == 1) && (OutKmer::nWords == 1)>());
+      }
+  };
+
+  template <uint64_t SEED>
+  constexpr uint64_t spaced_seed<SEED>::value;
+  template <uint64_t SEED>
+  constexpr unsigned int spaced_seed<SEED>::span;
+  template <uint64_t SEED>
+  constexpr unsigned int spaced_seed<SEED>::weight;
+
+
+  /**
+   * @brief The sliding window operator for spaced (gapped) k-mer generation from character data.
+   * @details  keeps a k-mer of the seed's span, and extracts the gapped k-mer from it.  the gapped k-mer at a position
+   *           starts there and has the seed's span, so a read of n characters gives n - span + 1 of them.
+   *
+   * @tparam BaseIterator Type of the underlying base iterator, which returns
+   *                      characters.
+   * @tparam Kmer         The output k-mer type, must be of type bliss::Kmer, of size Seed::weight.
+   * @tparam Seed         spaced_seed type.
+   */
+  template <class BaseIterator, class Kmer, class Seed>
+  class SpacedKmerSlidingWindow {};
+
+  template <typename BaseIterator, unsigned int KMER_SIZE,
+            typename ALPHABET, typename word_type, uint64_t SEED>
+  class SpacedKmerSlidingWindow<BaseIterator, bliss::common::Kmer<KMER_SIZE, ALPHABET, word_type>, spaced_seed<SEED> >
+  {
+  public:
+    /// The Kmer type (same as the `value_type` of this iterator)
+    typedef bliss::common::Kmer<KMER_SIZE, ALPHABET, word_type> kmer_type;
+    typedef spaced_seed<SEED> seed_type;
+    /// the k-mer spanned by the seed.
+    typedef bliss::common::Kmer<seed_type::span, ALPHABET, word_type> span_kmer_type;
+    typedef BaseIterator  base_iterator_type;
+    /// The value_type of the underlying iterator
+    typedef typename std::iterator_traits<BaseIterator>::value_type base_value_type;
+
+    static_assert(KMER_SIZE == seed_type::weight, "spaced seed weight and k-mer size differ.");
+
+    inline void init(BaseIterator& it)
+    {
+      window.fillFromChars(it, true);
+    }
+
+    inline void next(BaseIterator& it)
+    {
+      window.nextFromChar(*it);
+      ++it;
+    }
+
+    inline kmer_type getValue()
+    {
+      return seed_type::template extract<kmer_type>(window);
+    }
+  private:
+    /// The full (ungapped) window
+    span_kmer_type window;
+  };
+
+  /**
+   * @brief The sliding window operator for several spaced seeds of the same weight, in 1 pass.
+   * @details  the window has the longest span.  every seed starts at the window's start, so a seed with a shorter
+   *           span does not produce the last (longest span - its span) gapped k-mers of a read.
+   *           the value is an std::array with 1 k-mer per seed, in the order of Seeds.
+   */
+  template <class BaseIterator, class Kmer, class... Seeds>
+  class MultiSpacedKmerSlidingWindow {};
+
+  template <typename BaseIterator, unsigned int KMER_SIZE,
+            typename ALPHABET, typename word_type, uint64_t... SEEDS>
+  class MultiSpacedKmerSlidingWindow<BaseIterator, bliss::common::Kmer<KMER_SIZE, ALPHABET, word_type>, spaced_seed<SEEDS>... >
+  {
+  public:
+    typedef bliss::common::Kmer<KMER_SIZE, ALPHABET, word_type> kmer_type;
+    typedef ::std::array<kmer_type, sizeof...(SEEDS)> value_type;
+    typedef bliss::common::Kmer<spaced::max_span(spaced_seed<SEEDS>::span...), ALPHABET, word_type> span_kmer_type;
+    typedef BaseIterator  base_iterator_type;
+    typedef typename std::iterator_traits<BaseIterator>::value_type base_value_type;
+
+    inline void init(BaseIterator& it)
+    {
+      window.fillFromChars(it, true);
+    }
+
+    inline void next(BaseIterator& it)
+    {
+      window.nextFromChar(*it);
+      ++it;
+    }
+
+    inline value_type getValue()
+    {
+      return value_type{{ spaced_seed<SEEDS>::template extract<kmer_type>(window)... }};
+    }
+  private:
+    span_kmer_type window;
+  };
+
+  /// spaced KmerGenerationIterator.  Seed is a spaced_seed, and Kmer has its weight.
+  template <class BaseIterator, class Kmer, class Seed>
+  using SpacedKmerGenerationIterator = KmerGenerationIteratorBase<SpacedKmerSlidingWindow<BaseIterator, Kmer, Seed > >;
+
+  /// spaced KmerGenerationIterator for several seeds in 1 pass.  the value is an array of Kmer, 1 per seed.
+  template <class BaseIterator, class Kmer, class... Seeds>
+  using MultiSpacedKmerGenerationIterator = KmerGenerationIteratorBase<MultiSpacedKmerSlidingWindow<BaseIterator, Kmer, Seeds... > >;
   
   
   
@@ -62,6 +62,7 @@
 #include <type_traits>  // enable_if
 
 #include "common/kmer.hpp"
+#include "utils/cpu_features.hpp"
 
 namespace bliss {
 
@@ -145,6 +146,202 @@ namespace bliss {
       };
 
 
+      namespace detail {
+
+        /// true if a batch of KMERs can be reverse complemented with per-lane AVX2 ops:  DNA/RNA, single 16/32/64 bit word.
+        template <typename KMER>
+        struct is_simd_batchable {
+          static constexpr bool value =
+#if defined(__AVX2__) || defined(BLISS_SIMD_DISPATCH_X86)
+              (::std::is_same<typename KMER::KmerAlphabet, ::bliss::common::DNA>::value ||
+               ::std::is_same<typename KMER::KmerAlphabet, ::bliss::common::RNA>::value) &&
+              (KMER::nWords == 1) &&
+              (sizeof(typename KMER::KmerWordType) >= 2) &&
+              (sizeof(KMER) == sizeof(typename KMER::KmerWordType));
+#else
+              false;
+#endif
+        };
+
+#if defined(__AVX2__) || defined(BLISS_SIMD_DISPATCH_X86)
+        // the AVX2 code is self contained with target attributes (see utils/cpu_features.hpp), so that it can be
+        // compiled into a baseline binary and called after a runtime check.
+
+        /// per lane logical right shift, for the padding bits.
+        template <uint16_t SHIFT>
+        BLISS_TARGET("avx2")
+        inline __m256i srli(__m256i const & v, ::std::integral_constant<size_t, 2>) { return _mm256_srli_epi16(v, SHIFT); }
+        template <uint16_t SHIFT>
+        BLISS_TARGET("avx2")
+        inline __m256i srli(__m256i const & v, ::std::integral_constant<size_t, 4>) { return _mm256_srli_epi32(v, SHIFT); }
+        template <uint16_t SHIFT>
+        BLISS_TARGET("avx2")
+        inline __m256i srli(__m256i const & v, ::std::integral_constant<size_t, 8>) { return _mm256_srli_epi64(v, SHIFT); }
+
+        /// per lane unsigned min.  no epu64 min in AVX2, so flip the sign bits and use signed compare.
+        BLISS_TARGET("avx2")
+        inline __m256i min_epu(__m256i const & x, __m256i const & y, ::std::integral_constant<size_t, 2>) { return _mm256_min_epu16(x, y); }
+        BLISS_TARGET("avx2")
+        inline __m256i min_epu(__m256i const & x, __m256i const & y, ::std::integral_constant<size_t, 4>) { return _mm256_min_epu32(x, y); }
+        BLISS_TARGET("avx2")
+        inline __m256i min_epu(__m256i const & x, __m256i const & y, ::std::integral_constant<size_t, 8>) {
+          __m256i sign = _mm256_set1_epi64x(0x8000000000000000LL);
+          __m256i gt = _mm256_cmpgt_epi64(_mm256_xor_si256(x, sign), _mm256_xor_si256(y, sign));
+          return _mm256_blendv_epi8(x, y, gt);
+        }
+
+        /// byte shuffle index that reverses the bytes within each WORD_BYTES wide lane.  lanes do not cross the 128 bit boundary.
+        template <size_t WORD_BYTES>
+        BLISS_TARGET("avx2")
+        inline __m256i lane_byte_rev_idx() {
+          return (WORD_BYTES == 8) ?
+              _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                               7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8) :
+              (WORD_BYTES == 4) ?
+              _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                               3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12) :
+              _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                               1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+        }
+
+        /// nibble lookup that swaps the 2 characters in a nibble and complements them.  result in the low nibble.
+        /// shift left by 4 (epi16 is fine, all entries are < 16) for the high nibble version.
+        BLISS_TARGET("avx2")
+        inline __m256i revcomp_nibble_lut() {
+          return _mm256_setr_epi8(0x0F, 0x0B, 0x07, 0x03, 0x0E, 0x0A, 0x06, 0x02, 0x0D, 0x09, 0x05, 0x01, 0x0C, 0x08, 0x04, 0x00,
+                                  0x0F, 0x0B, 0x07, 0x03, 0x0E, 0x0A, 0x06, 0x02, 0x0D, 0x09, 0x05, 0x01, 0x0C, 0x08, 0x04, 0x00);
+        }
+
+        /**
+         * @brief reverse complement of the k-mers packed in one __m256i, each in its own lane.
+         * @details  byte reverse within each lane (in-lane shuffle, so no cross lane permute as in the whole register reverse),
+         *           then reverse and complement the characters in each byte with 2 nibble lookups, and shift out the padding.
+         *           the shuffle index and tables are passed in so the caller can keep them in registers across the batch.
+         */
+        template <typename KMER>
+        BLISS_TARGET("avx2")
+        inline __m256i reverse_complement_lanes(__m256i const & v, __m256i const & rev_idx,
+                                                __m256i const & lut_lo, __m256i const & lut_hi) {
+          using WORD_TYPE = typename KMER::KmerWordType;
+          constexpr uint16_t pad_bits = sizeof(WORD_TYPE) * 8 - KMER::nBits;
+
+          __m256i const mask_lo = _mm256_set1_epi8(0x0F);
+          __m256i r = _mm256_shuffle_epi8(v, rev_idx);
+          // low nibble goes to the high nibble and vice versa.
+          r = _mm256_or_si256(_mm256_shuffle_epi8(lut_hi, _mm256_and_si256(r, mask_lo)),
+                              _mm256_shuffle_epi8(lut_lo, _mm256_and_si256(_mm256_srli_epi16(r, 4), mask_lo)));
+          return srli<pad_bits>(r, ::std::integral_constant<size_t, sizeof(WORD_TYPE)>());
+        }
+
+        /// AVX2 part of the batched reverse complement.  returns the number of k-mers done, a multiple of k-mers per __m256i.
+        template <typename KMER>
+        BLISS_TARGET("avx2")
+        inline size_t reverse_complement_avx2(KMER const * begin, KMER const * end, KMER * out) {
+          constexpr size_t per_vec = sizeof(__m256i) / sizeof(KMER);
+          __m256i const rev_idx = lane_byte_rev_idx<sizeof(KMER)>();
+          __m256i const lut_lo = revcomp_nibble_lut();
+          __m256i const lut_hi = _mm256_slli_epi16(lut_lo, 4);
+
+          size_t n = end - begin;
+          size_t i = 0;
+          for (; (i + per_vec) <= n; i += per_vec) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(begin + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), reverse_complement_lanes<KMER>(v, rev_idx, lut_lo, lut_hi));
+          }
+          return i;
+        }
+
+        /// AVX2 part of the batched canonicalization.  returns the number of k-mers done.
+        template <typename KMER>
+        BLISS_TARGET("avx2")
+        inline size_t canonicalize_avx2(KMER * begin, KMER * end) {
+          constexpr size_t per_vec = sizeof(__m256i) / sizeof(KMER);
+          __m256i const rev_idx = lane_byte_rev_idx<sizeof(KMER)>();
+          __m256i const lut_lo = revcomp_nibble_lut();
+          __m256i const lut_hi = _mm256_slli_epi16(lut_lo, 4);
+
+          size_t n = end - begin;
+          size_t i = 0;
+          for (; (i + per_vec) <= n; i += per_vec) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(begin + i));
+            v = min_epu(v, reverse_complement_lanes<KMER>(v, rev_idx, lut_lo, lut_hi),
+                        ::std::integral_constant<size_t, sizeof(KMER)>());
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(begin + i), v);
+          }
+          return i;
+        }
+#endif
+
+      } // namespace detail
+
+
+      /**
+       * @brief batched reverse complement.  out[i] = begin[i].reverse_complement().  out may be the same as begin.
+       * @details  for single word DNA/RNA k-mers with AVX2, processes 32 bytes of k-mers per iteration.  otherwise per k-mer.
+       *           AVX2 is checked at runtime if built with BLISS_SIMD_DISPATCH.
+       */
+      template <typename KMER, typename ::std::enable_if<detail::is_simd_batchable<KMER>::value, int>::type = 0>
+      inline void reverse_complement(KMER const * begin, KMER const * end, KMER * out) {
+#if defined(__AVX2__) || defined(BLISS_SIMD_DISPATCH_X86)
+        if (::bliss::utils::cpu::has_avx2()) {
+          size_t done = detail::reverse_complement_avx2(begin, end, out);
+          begin += done;
+          out += done;
+        }
+#endif
+        for (; begin != end; ++begin, ++out) {
+          *out = begin->reverse_complement();
+        }
+      }
+      template <typename KMER, typename ::std::enable_if<!detail::is_simd_batchable<KMER>::value, int>::type = 0>
+      inline void reverse_complement(KMER const * begin, KMER const * end, KMER * out) {
+        for (; begin != end; ++begin, ++out) {
+          begin->reverse_complement(*out);
+        }
+      }
+
+      /**
+       * @brief batched, in place canonicalization,  x = min(x, revcomp(x)).  same result as lex_less, over an array.
+       * @details  for single word DNA/RNA k-mers with AVX2, the reverse complement and the min-select are both vectorized.
+       */
+      template <typename KMER, typename ::std::enable_if<detail::is_simd_batchable<KMER>::value, int>::type = 0>
+      inline void canonicalize(KMER * begin, KMER * end) {
+#if defined(__AVX2__) || defined(BLISS_SIMD_DISPATCH_X86)
+        if (::bliss::utils::cpu::has_avx2()) {
+          begin += detail::canonicalize_avx2(begin, end);
+        }
+#endif
+        lex_less<KMER> trans;
+        for (; begin != end; ++begin) {
+          *begin = trans(*begin);
+        }
+      }
+      template <typename KMER, typename ::std::enable_if<!detail::is_simd_batchable<KMER>::value, int>::type = 0>
+      inline void canonicalize(KMER * begin, KMER * end) {
+        KMER rc;
+        for (; begin != end; ++begin) {
+          begin->reverse_complement(rc);
+          if (rc < *begin) *begin = rc;
+        }
+      }
+
+      /// batched forms for ::bliss::transform::transform_in_place, e.g. a map's input transform over a vector of keys.
+      template <typename KMER>
+      inline void transform_range(KMER * begin, KMER * end, lex_less<KMER> const *) {
+        canonicalize(begin, end);
+      }
+      template <typename KMER>
+      inline void transform_range(KMER * begin, KMER * end, xor_rev_comp<KMER> const *) {
+        constexpr size_t block = 64;
+        KMER rc[block];
+        size_t m;
+        for (; begin != end; begin += m) {
+          m = ::std::min(block, static_cast<size_t>(end - begin));
+          reverse_complement(begin, begin + m, rc);
+          for (size_t i = 0; i < m; ++i) begin[i] ^= rc[i];
+        }
+      }
+
 //      template <typename KMER, template <typename> class TRANS>
 //      struct tuple_transform {
 //          TRANS<KMER> transform;
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    packed_pair.hpp
+ * @ingroup common
+ * @author  tpan
+ * @brief   flat, trivially copyable 2-tuple with no padding, for the (position, quality) values of a k-mer index.
+ * @details std::pair is never trivially copyable (its assignment is user provided), and std::pair<ShortSequenceKmerId, T>
+ *          with a 1, 2 or 4 byte T is 16 bytes, 7, 6 or 4 of them padding.  packed_pair<A, B> is sizeof(A) + sizeof(B) bytes,
+ *          is trivially copyable when A and B are, and has the same first/second members, tuple_size and tuple_element
+ *          as std::pair, so it replaces the inner pair of a k-mer position-quality tuple from the parser through
+ *          the wire to the map.  it converts to and from std::pair for the iterator based parsers.
+ *
+ *          with flat but not trivially copyable members such as Kmer, it is still sizeof(A) + sizeof(B) bytes:  a
+ *          (k-mer, count) entry of 12 instead of 16 bytes.  imxx::packed_entry_all2allv sends such std::pairs as packed_pairs.
+ *
+ *          members may be unaligned.  read them by value, do not keep pointers to them.
+ */
+#ifndef BLISS_COMMON_PACKED_PAIR_HPP_
+#define BLISS_COMMON_PACKED_PAIR_HPP_
+
+#include <cstddef>
+#include <ostream>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace bliss
+{
+  namespace common
+  {
+
+#pragma pack(push, 1)
+    template <typename A, typename B>
+    struct packed_pair {
+        using first_type = A;
+        using second_type = B;
+
+        A first;
+        B second;
+
+        packed_pair() = default;
+        packed_pair(A const & a, B const & b) : first(a), second(b) {}
+        packed_pair(::std::pair<A, B> const & other) : first(other.first), second(other.second) {}
+
+        operator ::std::pair<A, B>() const {
+          return ::std::pair<A, B>(first, second);
+        }
+
+        bool operator==(packed_pair const & other) const {
+          A a = first, oa = other.first;
+          B b = second, ob = other.second;
+          return (a == oa) && (b == ob);
+        }
+        bool operator!=(packed_pair const & other) const {
+          return !(*this == other);
+        }
+        /// lexicographic, as std::pair.
+        bool operator<(packed_pair const & other) const {
+          A a = first, oa = other.first;
+          B b = second, ob = other.second;
+          return (a < oa) || (!(oa < a) && (b < ob));
+        }
+
+        friend ::std::ostream & operator<<(::std::ostream & ost, packed_pair const & x) {
+          A a = x.first;
+          B b = x.second;
+          return ost << "(" << a << ", " << b << ")";
+        }
+    };
+#pragma pack(pop)
+
+  } // namespace common
+} // namespace bliss
+
+
+namespace std
+{
+  template <typename A, typename B>
+  struct tuple_size<::bliss::common::packed_pair<A, B> > : public ::std::integral_constant<size_t, 2> {};
+
+  template <size_t I, typename A, typename B>
+  struct tuple_element<I, ::bliss::common::packed_pair<A, B> > : public tuple_element<I, ::std::pair<A, B> > {};
+} // namespace std
+
+#endif /* BLISS_COMMON_PACKED_PAIR_HPP_ */
@@ -0,0 +1,432 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    packed_sequence_arena.hpp
+ * @ingroup common
+ * @author  tpan
+ * @brief   many sequences packed into one word array, as PackedStringImpl packs one.
+ * @details each sequence starts on a word boundary, so PackedKmerGenerationIterator can be started at each sequence
+ *          (its sliding window requires a 0 starting offset).  characters are packed from the least significant bits,
+ *          PackingTraits<WordType, bits>::chars_per_word per word, same as PackedStringImpl and PackingIterator.
+ *          EOL characters are dropped while packing.  the line structure of sequences that had EOL characters is kept
+ *          compactly (first line length, line width and EOL length when the lines are uniform, as in FASTA files),
+ *          so that a character can be mapped back to its source position.
+ */
+#ifndef BLISS_COMMON_PACKED_SEQUENCE_ARENA_HPP
+#define BLISS_COMMON_PACKED_SEQUENCE_ARENA_HPP
+
+#include <cstdint>
+#include <vector>
+#include <iterator>
+#include <type_traits>
+#include <algorithm>
+#include <utility>
+#include <cstring>  // memchr
+
+#include "common/alphabets.hpp"
+#include "common/alphabet_traits.hpp"
+#include "common/padding.hpp"
+#include "common/kmer_iterators.hpp"
+#include "common/dna_encoder.hpp"
+
+namespace bliss
+{
+  namespace common
+  {
+
+  /**
+   * @brief  append only arena of packed sequences.
+   * @tparam ALPHABET   alphabet of the sequences, e.g. DNA (2 bits), DNA5 (3 bits).
+   * @tparam WordType   storage word type.
+   */
+  template <typename ALPHABET, typename WordType = uint64_t>
+  class PackedSequenceArena
+  {
+  public:
+    /// packing traits of the storage
+    typedef PackingTraits<WordType, AlphabetTraits<ALPHABET>::getBitsPerChar()> padtraits;
+
+    /// iterator over the packed words, usable as base iterator of PackedKmerGenerationIterator
+    typedef typename std::vector<WordType>::const_iterator const_iterator;
+
+    /// a packed sequence
+    struct record {
+      /// index of the first word
+      size_t word_offset;
+      /// number of characters
+      size_t length;
+      /// position of the first character in the source (e.g. file offset).  characters are contiguous only if source had no EOL.
+      size_t offset;
+    };
+
+    /// k-mer generation iterator for a packed sequence.
+    template <typename Kmer>
+    using kmer_iterator = PackedKmerGenerationIterator<const_iterator, Kmer>;
+
+  protected:
+    /// line structure of a sequence that had EOL characters in the source.
+    struct line_layout {
+      /// index of the record
+      size_t rec;
+      /// number of characters before the first EOL
+      size_t first;
+      /// number of characters per line after the first
+      size_t width;
+      /// number of EOL characters between lines
+      size_t eol;
+      /// irregular lines:  [brk_begin, brk_end) in breaks.  empty if the lines are uniform.
+      size_t brk_begin;
+      size_t brk_end;
+    };
+
+    /// packed characters
+    std::vector<WordType> words;
+
+    /// sequences
+    std::vector<record> records;
+
+    /// line structure of the records with EOL, ordered by record
+    std::vector<line_layout> layouts;
+
+    /// (character index, source offset from record offset) of each line start, for irregular layouts
+    std::vector<std::pair<size_t, size_t> > breaks;
+
+    /// number of words for n characters
+    static size_t words_needed(size_t const & n) {
+      return (n + padtraits::chars_per_word - 1) / padtraits::chars_per_word;
+    }
+
+    /// pack already converted values into the tail of words, starting at character pos of the last record.
+    template <typename ValIter>
+    void pack(ValIter first, ValIter last, size_t pos) {
+      size_t w = records.back().word_offset + pos / padtraits::chars_per_word;
+      unsigned int shift = (pos % padtraits::chars_per_word) * padtraits::bits_per_char;
+
+      for (; first != last; ++first) {
+        if (w >= words.size()) words.push_back(0);
+        words[w] |= static_cast<WordType>(*first) << shift;
+        shift += padtraits::bits_per_char;
+        if (shift >= padtraits::data_bits) {
+          shift = 0;
+          ++w;
+        }
+      }
+    }
+
+    /// generic: filter EOL and translate via ASCII2 one character at a time.
+    template <typename Iter>
+    size_t append_chars(Iter begin, Iter end, ::std::false_type const &) {
+      ASCII2<ALPHABET> to_val;
+      size_t n = 0;
+      uint8_t buf[256];
+      size_t i = 0;
+      for (; begin != end; ++begin) {
+        if ((*begin == '\n') || (*begin == '\r')) continue;
+        buf[i++] = static_cast<uint8_t>(to_val(*begin));
+        if (i == 256) {
+          pack(buf, buf + i, n);
+          n += i;
+          i = 0;
+        }
+      }
+      pack(buf, buf + i, n);
+      return n + i;
+    }
+
+    /// DNA from contiguous characters: bulk convert with the SIMD encoder, a tile at a time.
+    template <typename Iter>
+    size_t append_chars(Iter begin, Iter end, ::std::true_type const &) {
+      if (begin == end) return 0;
+
+      DNAEncoder encode;
+      uint8_t buf[1024];
+      unsigned char const * it = reinterpret_cast<unsigned char const *>(&(*begin));
+      unsigned char const * e = it + ::std::distance(begin, end);
+
+      size_t n = 0, len, m;
+      for (; it < e; it += len) {
+        len = ::std::min(static_cast<size_t>(1024), static_cast<size_t>(e - it));
+        m = encode(it, len, buf);
+        pack(buf, buf + m, n);
+        n += m;
+      }
+      return n;
+    }
+
+    /// quick check for EOL characters.
+    template <typename Iter>
+    static bool has_eol(Iter begin, Iter end, ::std::false_type const &) {
+      return ::std::find_if(begin, end, [](char const & c) { return (c == '\n') || (c == '\r'); }) != end;
+    }
+    template <typename Iter>
+    static bool has_eol(Iter begin, Iter end, ::std::true_type const &) {
+      if (begin == end) return false;
+      void const * p = reinterpret_cast<void const *>(&(*begin));
+      size_t len = ::std::distance(begin, end);
+      return (memchr(p, '\n', len) != nullptr) || (memchr(p, '\r', len) != nullptr);
+    }
+
+    /// record the line structure of the last appended sequence, [begin, end) with n non-EOL characters.
+    template <typename Iter>
+    void add_lines(Iter begin, Iter end, size_t const & n) {
+      // first character after each EOL run:  (character index, source offset)
+      std::vector<std::pair<size_t, size_t> > starts;
+      size_t c = 0, src = 0;
+      bool eol = false;
+      for (; begin != end; ++begin, ++src) {
+        if ((*begin == '\n') || (*begin == '\r')) {
+          eol = true;
+          continue;
+        }
+        if (eol) {
+          starts.emplace_back(c, src);
+          eol = false;
+        }
+        ++c;
+      }
+      if (starts.empty()) return;   // only trailing EOL.
+
+      line_layout l;
+      l.rec = records.size() - 1;
+      l.first = starts[0].first;
+      l.eol = starts[0].second - starts[0].first;
+      // with a single break, any width that reaches the end works.
+      l.width = (starts.size() > 1) ? (starts[1].first - starts[0].first) : (n - l.first);
+      l.brk_begin = l.brk_end = breaks.size();
+
+      // the last line may be shorter, not longer.
+      bool uniform = (n - starts.back().first) <= l.width;
+      for (size_t t = 1; uniform && (t < starts.size()); ++t) {
+        uniform = (starts[t].first == l.first + t * l.width) &&
+                  (starts[t].second == starts[t].first + (t + 1) * l.eol);
+      }
+      if (!uniform) {
+        breaks.insert(breaks.end(), starts.begin(), starts.end());
+        l.brk_end = breaks.size();
+      }
+      layouts.push_back(l);
+    }
+
+  public:
+
+    /// number of sequences
+    size_t size() const {
+      return records.size();
+    }
+
+    /// total number of characters
+    size_t chars() const {
+      size_t n = 0;
+      for (auto const & r : records) n += r.length;
+      return n;
+    }
+
+    /// bytes used by the packed data
+    size_t bytes() const {
+      return words.size() * sizeof(WordType);
+    }
+
+    /// reserve space for approximately n_chars characters in n_seqs sequences.
+    void reserve(size_t const & n_chars, size_t const & n_seqs) {
+      words.reserve(words_needed(n_chars) + n_seqs);
+      records.reserve(n_seqs);
+    }
+
+    void clear() {
+      words.clear();
+      records.clear();
+      layouts.clear();
+      breaks.clear();
+    }
+
+    /// access sequence record
+    record const & operator[](size_t const & i) const {
+      return records[i];
+    }
+
+    /// packed words of sequence i
+    const_iterator begin(size_t const & i) const {
+      return words.cbegin() + records[i].word_offset;
+    }
+
+    /// character j of sequence i, as alphabet value.
+    uint8_t get(size_t const & i, size_t const & j) const {
+      WordType w = words[records[i].word_offset + j / padtraits::chars_per_word];
+      return static_cast<uint8_t>((w >> ((j % padtraits::chars_per_word) * padtraits::bits_per_char)) &
+                                  getLeastSignificantBitsMask<WordType>(padtraits::bits_per_char));
+    }
+
+    /// replace character j of sequence i with alphabet value v, e.g. to correct a base in place.
+    void set(size_t const & i, size_t const & j, uint8_t const & v) {
+      WordType & w = words[records[i].word_offset + j / padtraits::chars_per_word];
+      unsigned int shift = (j % padtraits::chars_per_word) * padtraits::bits_per_char;
+      WordType mask = getLeastSignificantBitsMask<WordType>(padtraits::bits_per_char) << shift;
+      w = (w & ~mask) | ((static_cast<WordType>(v) << shift) & mask);
+    }
+
+    /**
+     * @brief  append the ASCII sequence [begin, end), skipping EOL.
+     * @param offset   source position of the first character, stored in the record.
+     * @return number of characters packed.
+     */
+    template <typename Iter>
+    size_t append(Iter begin, Iter end, size_t const & offset = 0) {
+      record r;
+      r.word_offset = words.size();
+      r.length = 0;
+      r.offset = offset;
+      records.push_back(r);
+
+      using use_encoder = ::std::integral_constant<bool,
+          ::std::is_same<ALPHABET, DNA>::value && is_contiguous_char_iterator<Iter>::value>;
+
+      size_t n = append_chars(begin, end, use_encoder());
+      if (has_eol(begin, end, use_encoder())) add_lines(begin, end, n);
+
+      // words holds exactly the sequence, so the next one starts on a word boundary
+      words.resize(records.back().word_offset + words_needed(n), 0);
+      records.back().length = n;
+      return n;
+    }
+
+    /**
+     * @brief  append a sequence of alphabet values (not ASCII), e.g. decoded from another packed format.
+     * @return number of characters packed.
+     */
+    template <typename ValIter>
+    size_t append_values(ValIter begin, ValIter end, size_t const & offset = 0) {
+      record r;
+      r.word_offset = words.size();
+      r.length = ::std::distance(begin, end);
+      r.offset = offset;
+      records.push_back(r);
+
+      pack(begin, end, 0);
+      words.resize(r.word_offset + words_needed(r.length), 0);
+      return r.length;
+    }
+
+    /**
+     * @brief  append a sequence that is already packed the way this arena packs it, e.g. translated bytewise from
+     *         another 2 bit format.  the words are assembled with shifts, no per character work.
+     * @details  bits_per_char has to divide 8.  assumes a little endian host, as the words are loaded from the bytes.
+     * @param src    packed characters, least significant bits of each byte first.
+     * @param skip   number of characters in src before the sequence.
+     * @param n      number of characters.
+     * @return number of characters packed.
+     */
+    size_t append_packed(uint8_t const * src, size_t const & skip, size_t const & n, size_t const & offset = 0) {
+      static_assert((8 % padtraits::bits_per_char) == 0, "append_packed requires characters that do not straddle bytes");
+      static_assert(padtraits::data_bits == sizeof(WordType) * 8, "append_packed requires words without padding");
+
+      record r;
+      r.word_offset = words.size();
+      r.length = n;
+      r.offset = offset;
+      records.push_back(r);
+
+      size_t nw = words_needed(n);
+      words.resize(r.word_offset + nw, 0);
+
+      size_t bit = skip * padtraits::bits_per_char;
+      size_t src_bytes = (bit + n * padtraits::bits_per_char + 7) / 8;
+      for (size_t w = 0; w < nw; ++w, bit += padtraits::data_bits) {
+        size_t byte = bit / 8;
+        unsigned int sh = bit % 8;
+        WordType v = 0;
+        memcpy(&v, src + byte, ::std::min(sizeof(WordType), src_bytes - byte));
+        if (sh > 0) {
+          v >>= sh;
+          if (byte + sizeof(WordType) < src_bytes)
+            v |= static_cast<WordType>(src[byte + sizeof(WordType)]) << (padtraits::data_bits - sh);
+        }
+        words[r.word_offset + w] = v;
+      }
+      // clear the characters past the end, as pack leaves them.
+      size_t rem = n % padtraits::chars_per_word;
+      if (rem > 0) words.back() &= getLeastSignificantBitsMask<WordType>(rem * padtraits::bits_per_char);
+      return n;
+    }
+
+    /// bytes used by the line structure of sequences with EOL.
+    size_t line_bytes() const {
+      return layouts.size() * sizeof(line_layout) + breaks.size() * sizeof(std::pair<size_t, size_t>);
+    }
+
+    /// source position of character j of sequence i, i.e. record offset plus the EOL characters skipped before j.
+    size_t source_offset(size_t const & i, size_t const & j) const {
+      size_t off = records[i].offset;
+      auto l = ::std::lower_bound(layouts.begin(), layouts.end(), i,
+                                  [](line_layout const & x, size_t const & r) { return x.rec < r; });
+      if ((l == layouts.end()) || (l->rec != i)) return off + j;
+
+      if (l->brk_begin == l->brk_end) {
+        if (j < l->first) return off + j;
+        return off + j + ((j - l->first) / l->width + 1) * l->eol;
+      }
+
+      // irregular:  the last line start at or before j.
+      auto b = breaks.begin() + l->brk_begin;
+      auto p = ::std::upper_bound(b, breaks.begin() + l->brk_end, j,
+                                  [](size_t const & c, std::pair<size_t, size_t> const & x) { return c < x.first; });
+      if (p == b) return off + j;
+      --p;
+      return off + p->second + (j - p->first);
+    }
+
+    /// first k-mer of sequence i.  sequence has to be at least Kmer::size long.
+    template <typename Kmer>
+    kmer_iterator<Kmer> kmer_begin(size_t const & i) const {
+      return kmer_iterator<Kmer>(begin(i));
+    }
+
+    /// end of k-mers of sequence i.
+    template <typename Kmer>
+    kmer_iterator<Kmer> kmer_end(size_t const & i) const {
+      return kmer_iterator<Kmer>(begin(i), records[i].length);
+    }
+
+    /// number of k-mers that generate<Kmer>(output, first) produces.
+    template <typename Kmer>
+    size_t num_kmers(size_t const & first = 0) const {
+      size_t n = 0;
+      for (size_t i = first; i < records.size(); ++i) {
+        if (records[i].length >= Kmer::size) n += records[i].length - Kmer::size + 1;
+      }
+      return n;
+    }
+
+    /**
+     * @brief  generate k-mers of sequences [first, size()), in order, into output.  sequences shorter than k are skipped.
+     * @return new position of output iterator.
+     */
+    template <typename Kmer, typename OutputIt>
+    OutputIt generate(OutputIt output, size_t const & first = 0) const {
+      static_assert(::std::is_same<typename Kmer::KmerAlphabet, ALPHABET>::value, "kmer alphabet has to match arena alphabet");
+
+      for (size_t i = first; i < records.size(); ++i) {
+        if (records[i].length < Kmer::size) continue;
+        output = ::std::copy(kmer_begin<Kmer>(i), kmer_end<Kmer>(i), output);
+      }
+      return output;
+    }
+  };
+
+  } // namespace common
+} // namespace bliss
+
+#endif // BLISS_COMMON_PACKED_SEQUENCE_ARENA_HPP
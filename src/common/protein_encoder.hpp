@@ -0,0 +1,367 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    protein_encoder.hpp
+ * @ingroup common
+ * @author  tpan
+ * @brief   bulk conversion of ASCII amino acids to alphabet values, amino acid k-mer generation, and six frame
+ *          translation of DNA into amino acid k-mers.
+ * @details the amino acid alphabets (AA, AA_MURPHY10, AA_MURPHY15) map letters case insensitively, so the value of a
+ *          letter depends only on its low 5 bits.  the encoder looks up FROM_ASCII['@' .. '_'], 32 entries, with 2
+ *          SSSE3 shuffles (or AVX2, 2 lanes) selected by bit 4.  a block that contains anything other than a letter
+ *          (EOL, '*', '-', digits) is converted with the scalar code, which skips '\n' and '\r' as dna_encoder does.
+ *          there is no NEON kernel, aarch64 uses the scalar code.
+ *
+ *          TranslatedKmerGenerator produces the amino acid k-mers of all 6 reading frames of a DNA sequence.  a k-mer
+ *          spans 3k nucleotides, and each nucleotide position starts 1 k-mer on each strand, so the k-mers do not depend
+ *          on where the frames are counted from, and a sequence can be split anywhere with k-mers assigned by their
+ *          first nucleotide, as KmerParser does.
+ */
+#ifndef SRC_COMMON_PROTEIN_ENCODER_HPP_
+#define SRC_COMMON_PROTEIN_ENCODER_HPP_
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include "common/alphabets.hpp"
+#include "common/dna_encoder.hpp"
+#include "common/kmer.hpp"
+#include "utils/bitgroup_ops.hpp"
+#include "utils/cpu_features.hpp"
+
+namespace bliss {
+
+  namespace common {
+
+    /// trait for the amino acid alphabets.
+    template <typename Alphabet>
+    struct is_amino_acid_alphabet : public ::std::integral_constant<bool,
+      ::std::is_same<Alphabet, ::bliss::common::AA>::value ||
+      ::std::is_same<Alphabet, ::bliss::common::AA_MURPHY10>::value ||
+      ::std::is_same<Alphabet, ::bliss::common::AA_MURPHY15>::value> {};
+
+
+    /**
+     * @brief  convert ASCII amino acids to alphabet values, skipping EOL characters.  scalar version.
+     * @tparam Alphabet  amino acid alphabet.
+     * @tparam SIMD      one of the ::bliss::utils::bit_ops::BIT_REV_* values.
+     */
+    template <typename Alphabet, unsigned char SIMD = ::bliss::utils::bit_ops::BIT_REV_SEQ>
+    struct aa_encoder {
+        static_assert(is_amino_acid_alphabet<Alphabet>::value, "aa_encoder only supports amino acid alphabets");
+
+        static constexpr unsigned char simd_type = SIMD;
+
+        /// convert a single character.
+        static inline uint8_t convert(unsigned char const c) {
+          return Alphabet::FROM_ASCII[c];
+        }
+
+        /**
+         * @brief convert n characters from in, writing to out.  '\n' and '\r' are removed.
+         * @param out   needs to have space for n values.
+         * @return number of values written to out.
+         */
+        inline size_t operator()(unsigned char const * in, size_t const & n, uint8_t * out) const {
+          uint8_t * o = out;
+          for (size_t i = 0; i < n; ++i) {
+            if ((in[i] != '\n') && (in[i] != '\r')) {
+              *o = convert(in[i]);
+              ++o;
+            }
+          }
+          return o - out;
+        }
+    };
+
+#if defined(__SSSE3__) || defined(BLISS_SIMD_DISPATCH_X86)
+    namespace detail {
+
+      /**
+       * @brief  SSSE3 kernel.  16 characters at a time.  the low nibble indexes FROM_ASCII['@' .. 'O'] and
+       *         FROM_ASCII['P' .. '_'], and bit 4 picks one.  a block with a non-letter is converted with the scalar code.
+       */
+      template <typename Alphabet>
+      BLISS_TARGET("ssse3")
+      inline size_t encode_aa_ssse3(unsigned char const * in, size_t const & n, uint8_t * out) {
+        aa_encoder<Alphabet, ::bliss::utils::bit_ops::BIT_REV_SEQ> seq;
+
+        const __m128i lut_lo = _mm_loadu_si128(reinterpret_cast<__m128i const *>(Alphabet::FROM_ASCII.data() + 0x40));
+        const __m128i lut_hi = _mm_loadu_si128(reinterpret_cast<__m128i const *>(Alphabet::FROM_ASCII.data() + 0x50));
+        const __m128i lo_mask = _mm_set1_epi8(0x0F);
+        const __m128i hi_bit = _mm_set1_epi8(0x10);
+        const __m128i case_mask = _mm_set1_epi8(0x20);
+        const __m128i before_a = _mm_set1_epi8('a' - 1);
+        const __m128i after_z = _mm_set1_epi8('z' + 1);
+
+        uint8_t * o = out;
+        size_t i = 0;
+        for (; (i + 16) <= n; i += 16) {
+          __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i));
+          // letters, lower cased.  bytes >= 0x80 are negative and fail the first compare.
+          __m128i l = _mm_or_si128(v, case_mask);
+          __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(l, before_a), _mm_cmpgt_epi8(after_z, l));
+          if (_mm_movemask_epi8(letter) != 0xFFFF) {
+            o += seq(in + i, 16, o);
+            continue;
+          }
+
+          __m128i lo = _mm_and_si128(v, lo_mask);
+          __m128i hi = _mm_cmpeq_epi8(_mm_and_si128(v, hi_bit), hi_bit);
+          _mm_storeu_si128(reinterpret_cast<__m128i *>(o),
+                           _mm_or_si128(_mm_and_si128(hi, _mm_shuffle_epi8(lut_hi, lo)),
+                                        _mm_andnot_si128(hi, _mm_shuffle_epi8(lut_lo, lo))));
+          o += 16;
+        }
+        // remainder
+        o += seq(in + i, n - i, o);
+
+        return o - out;
+      }
+
+    } // namespace detail
+#endif
+
+#if defined(__AVX2__) || defined(BLISS_SIMD_DISPATCH_X86)
+    namespace detail {
+
+      /**
+       * @brief  AVX2 kernel.  32 characters at a time.  same as the SSSE3 kernel, with the tables in both lanes.
+       */
+      template <typename Alphabet>
+      BLISS_TARGET("avx2")
+      inline size_t encode_aa_avx2(unsigned char const * in, size_t const & n, uint8_t * out) {
+        const __m256i lut_lo = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<__m128i const *>(Alphabet::FROM_ASCII.data() + 0x40)));
+        const __m256i lut_hi = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<__m128i const *>(Alphabet::FROM_ASCII.data() + 0x50)));
+        const __m256i lo_mask = _mm256_set1_epi8(0x0F);
+        const __m256i hi_bit = _mm256_set1_epi8(0x10);
+        const __m256i case_mask = _mm256_set1_epi8(0x20);
+        const __m256i before_a = _mm256_set1_epi8('a' - 1);
+        const __m256i after_z = _mm256_set1_epi8('z' + 1);
+
+        uint8_t * o = out;
+        size_t i = 0;
+        for (; (i + 32) <= n; i += 32) {
+          __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(in + i));
+          __m256i l = _mm256_or_si256(v, case_mask);
+          __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(l, before_a), _mm256_cmpgt_epi8(after_z, l));
+          if (_mm256_movemask_epi8(letter) != -1) {
+            o += encode_aa_ssse3<Alphabet>(in + i, 32, o);
+            continue;
+          }
+
+          __m256i lo = _mm256_and_si256(v, lo_mask);
+          __m256i hi = _mm256_cmpeq_epi8(_mm256_and_si256(v, hi_bit), hi_bit);
+          _mm256_storeu_si256(reinterpret_cast<__m256i *>(o),
+                              _mm256_blendv_epi8(_mm256_shuffle_epi8(lut_lo, lo), _mm256_shuffle_epi8(lut_hi, lo), hi));
+          o += 32;
+        }
+        // remainder
+        o += encode_aa_ssse3<Alphabet>(in + i, n - i, o);
+
+        return o - out;
+      }
+
+    } // namespace detail
+#endif
+
+#if defined(__SSSE3__)
+    /**
+     * @brief  SSSE3 version.  see detail::encode_aa_ssse3.
+     */
+    template <typename Alphabet>
+    struct aa_encoder<Alphabet, ::bliss::utils::bit_ops::BIT_REV_SSSE3> {
+        static constexpr unsigned char simd_type = ::bliss::utils::bit_ops::BIT_REV_SSSE3;
+
+        inline size_t operator()(unsigned char const * in, size_t const & n, uint8_t * out) const {
+          return detail::encode_aa_ssse3<Alphabet>(in, n, out);
+        }
+    };
+#endif
+
+#if defined(__AVX2__)
+    /**
+     * @brief  AVX2 version.  see detail::encode_aa_avx2.
+     */
+    template <typename Alphabet>
+    struct aa_encoder<Alphabet, ::bliss::utils::bit_ops::BIT_REV_AVX2> {
+        static constexpr unsigned char simd_type = ::bliss::utils::bit_ops::BIT_REV_AVX2;
+
+        inline size_t operator()(unsigned char const * in, size_t const & n, uint8_t * out) const {
+          return detail::encode_aa_avx2<Alphabet>(in, n, out);
+        }
+    };
+#endif
+
+#if defined(BLISS_SIMD_DISPATCH_X86)
+    /**
+     * @brief  runtime dispatched encoder:  AVX2, SSSE3, or scalar, depending on the CPU the process runs on.
+     */
+    template <typename Alphabet>
+    struct aa_encoder_dispatch {
+        /// not known at compile time.  see ::bliss::utils::cpu::get_features().
+        static constexpr unsigned char simd_type = 0xFF;
+
+        inline size_t operator()(unsigned char const * in, size_t const & n, uint8_t * out) const {
+          if (::bliss::utils::cpu::has_avx2()) return detail::encode_aa_avx2<Alphabet>(in, n, out);
+          if (::bliss::utils::cpu::has_ssse3()) return detail::encode_aa_ssse3<Alphabet>(in, n, out);
+          return aa_encoder<Alphabet, ::bliss::utils::bit_ops::BIT_REV_SEQ>()(in, n, out);
+        }
+    };
+
+    /// best available amino acid encoder for the CPU.
+    template <typename Alphabet>
+    using AAEncoder = aa_encoder_dispatch<Alphabet>;
+#else
+    /// best available amino acid encoder for the compiler flags.
+    template <typename Alphabet>
+    using AAEncoder = aa_encoder<Alphabet, ::bliss::utils::bit_ops::BITREV_AVX2::SIMDVal>;
+#endif
+
+
+    /**
+     * @brief generate all k-mers from an ASCII amino acid character array, skipping EOL characters.
+     * @tparam Kmer     amino acid k-mer type.
+     * @tparam Encoder  bulk encoder, default to best available.
+     */
+    template <typename Kmer, typename Encoder = AAEncoder<typename Kmer::KmerAlphabet> >
+    struct AAKmerGenerator : public EncodedKmerGenerator<Kmer, Encoder> {
+        static_assert(is_amino_acid_alphabet<typename Kmer::KmerAlphabet>::value,
+                      "AAKmerGenerator only supports amino acid alphabets");
+    };
+
+
+    /**
+     * @brief generate the amino acid k-mers of the 6 reading frames of an ASCII DNA character array, skipping EOL characters.
+     * @details  a k-mer is output for every nucleotide position i with 3k nucleotides from i on:  the translation
+     *           of [i, i + 3k), then, after all of those, the translation of the reverse complement of [i, i + 3k).
+     *           forward k-mers are in frame order (+1, +2, +3), then by position, and reverse k-mers likewise (-1, -2, -3),
+     *           from the end of the sequence.  n nucleotides give 2 * (n - 3k + 1) k-mers.
+     *
+     *           codons use the standard genetic code.  a codon with a character other than ACGTU (case insensitive)
+     *           translates to X, a stop codon to '*', each then mapped by the k-mer's alphabet.
+     *
+     *           the nucleotides and the codons of both strands are kept in member buffers, reused between calls.
+     * @tparam Kmer     amino acid k-mer type.
+     */
+    template <typename Kmer>
+    class TranslatedKmerGenerator {
+        static_assert(is_amino_acid_alphabet<typename Kmer::KmerAlphabet>::value,
+                      "TranslatedKmerGenerator only supports amino acid alphabets");
+
+        using Alphabet = typename Kmer::KmerAlphabet;
+
+        /// nucleotide value for a non ACGTU character.
+        static constexpr uint8_t other = 4;
+
+      public:
+        /// amino acids of the standard genetic code, codons in AAA, AAC, AAG, AAT, ACA, ... TTT order.
+        static constexpr char const * standard_code = "KNKNTTTTRSRSIIMIQHQHPPPPRRRRLLLLEDEDAAAAGGGGVVVV*Y*YSSSS*CWCLFLF";
+
+      protected:
+        /// ASCII to nucleotide value, A = 0, C = 1, G = 2, T/U = 3, other = 4.
+        ::std::array<uint8_t, 256> nucleotide;
+        /// 3 nucleotide values, as a base 5 number, to alphabet value.
+        ::std::array<uint8_t, 125> codon;
+
+        ::std::vector<uint8_t> nts;
+        ::std::vector<uint8_t> fwd;
+        ::std::vector<uint8_t> rev;
+
+        static inline uint8_t complement(uint8_t x) {
+          return (x == other) ? other : static_cast<uint8_t>(3 - x);
+        }
+
+        /// shift count values, vals[0], vals[step], vals[2 * step], ..., into the kmer, and output each complete kmer.
+        template <typename OutputIt>
+        static OutputIt roll(uint8_t const * vals, size_t count, ptrdiff_t step, OutputIt output) {
+          Kmer km(true);
+          for (size_t i = 0; i < count; ++i) {
+            km.nextFromChar(vals[static_cast<ptrdiff_t>(i) * step]);
+            if (i >= (Kmer::size - 1)) {
+              *output = km;
+              ++output;
+            }
+          }
+          return output;
+        }
+
+      public:
+        TranslatedKmerGenerator() {
+          nucleotide.fill(other);
+          nucleotide['A'] = nucleotide['a'] = 0;
+          nucleotide['C'] = nucleotide['c'] = 1;
+          nucleotide['G'] = nucleotide['g'] = 2;
+          nucleotide['T'] = nucleotide['t'] = 3;
+          nucleotide['U'] = nucleotide['u'] = 3;
+
+          for (uint8_t x = 0; x <= other; ++x) {
+            for (uint8_t y = 0; y <= other; ++y) {
+              for (uint8_t z = 0; z <= other; ++z) {
+                char aa = ((x == other) || (y == other) || (z == other)) ? 'X' : standard_code[x * 16 + y * 4 + z];
+                codon[x * 25 + y * 5 + z] = Alphabet::FROM_ASCII[static_cast<unsigned char>(aa)];
+              }
+            }
+          }
+        }
+
+        /**
+         * @brief  generate k-mers from [begin, end) and write to output.
+         * @return new position of output iterator.
+         */
+        template <typename OutputIt>
+        OutputIt operator()(unsigned char const * begin, unsigned char const * end, OutputIt output) {
+          nts.clear();
+          for (; begin < end; ++begin) {
+            if ((*begin != '\n') && (*begin != '\r')) nts.push_back(nucleotide[*begin]);
+          }
+          if (nts.size() < 3 * Kmer::size) return output;
+
+          size_t m = nts.size() - 2;  // codons, 1 per position.
+          fwd.resize(m);
+          rev.resize(m);
+          for (size_t i = 0; i < m; ++i) {
+            fwd[i] = codon[nts[i] * 25 + nts[i + 1] * 5 + nts[i + 2]];
+            rev[i] = codon[complement(nts[i + 2]) * 25 + complement(nts[i + 1]) * 5 + complement(nts[i])];
+          }
+
+          for (size_t f = 0; (f < 3) && (f < m); ++f) {
+            output = roll(fwd.data() + f, (m - 1 - f) / 3 + 1, 3, output);
+          }
+          // the reverse strand k-mer at i reads the codons at i + 3(k-1), ..., i + 3, i.
+          for (size_t f = 0; (f < 3) && (f < m); ++f) {
+            size_t last = m - 1 - f;
+            output = roll(rev.data() + last, last / 3 + 1, -3, output);
+          }
+          return output;
+        }
+    };
+
+    template <typename Kmer>
+    constexpr uint8_t TranslatedKmerGenerator<Kmer>::other;
+    template <typename Kmer>
+    constexpr char const * TranslatedKmerGenerator<Kmer>::standard_code;
+
+  } // namespace common
+} // namespace bliss
+
+#endif /* SRC_COMMON_PROTEIN_ENCODER_HPP_ */
@@ -150,16 +150,14 @@ namespace bliss
         ShortSequenceKmerId(size_t const & file_pos, uint8_t file_id = 0, uint16_t const & pos_in_seq = 0 ) :
           id(((file_pos & 0x000000FFFFFFFFFF) << 16) | (static_cast<size_t>(file_id) << 56) | static_cast<size_t>(pos_in_seq) ) {}
         ShortSequenceKmerId(SequenceId const & other) : ShortSequenceKmerId(other.pos_in_file, other.file_id) {}
-        ShortSequenceKmerId(ShortSequenceKmerId const & other) : id(other.id) {}
+        // default copies keep the id types trivially copyable, see packed_pair.hpp.
+        ShortSequenceKmerId(ShortSequenceKmerId const & other) = default;
 
         ShortSequenceKmerId& operator=(SequenceId const & other) {
           this->id = ((other.pos_in_file & 0x000000FFFFFFFFFF) << 16) | (static_cast<size_t>(other.file_id) << 56) ;
           return *this;
         }
-        ShortSequenceKmerId& operator=(ShortSequenceKmerId const & other) {
-          this->id = other.id;
-          return *this;
-        }
+        ShortSequenceKmerId& operator=(ShortSequenceKmerId const & other) = default;
 
         bool operator==(ShortSequenceKmerId const & other) const {
           return id == other.id;
@@ -252,16 +250,13 @@ namespace bliss
         LongSequenceKmerId(size_t const & file_pos, uint8_t file_id = 0, uint16_t const & seq_id = 0) :
           id((file_pos & 0x000000FFFFFFFFFF) | (static_cast<size_t>(file_id) << 56) | (static_cast<size_t>(seq_id) << 40)) {}
         LongSequenceKmerId(SequenceId const & other) : LongSequenceKmerId(other.pos_in_file, other.file_id, other.seq_id) {}
-        LongSequenceKmerId(LongSequenceKmerId const & other) : id(other.id) {}
+        LongSequenceKmerId(LongSequenceKmerId const & other) = default;
 
         LongSequenceKmerId& operator=(SequenceId const & other) {
           this->id = (other.pos_in_file & 0x000000FFFFFFFFFF) | (static_cast<size_t>(other.file_id) << 56) | (static_cast<size_t>(other.seq_id) << 40);
           return *this;
         }
-        LongSequenceKmerId& operator=(LongSequenceKmerId const & other) {
-          this->id = other.id;
-          return *this;
-        }
+        LongSequenceKmerId& operator=(LongSequenceKmerId const & other) = default;
 
         bool operator==(LongSequenceKmerId const & other) const {
           return id == other.id;
@@ -303,6 +298,233 @@ namespace bliss
     };
 
 
+    /**
+     * @brief  bit widths of the fields of a PackedSequenceKmerId, from the most significant:  file id, sequence id, position in sequence.
+     */
+    struct packed_id_layout {
+        uint8_t file_bits;
+        uint8_t seq_bits;
+        uint8_t pos_bits;
+
+        packed_id_layout(uint8_t const & _file_bits = 0, uint8_t const & _seq_bits = 0, uint8_t const & _pos_bits = 0) :
+          file_bits(_file_bits), seq_bits(_seq_bits), pos_bits(_pos_bits) {}
+
+        size_t total() const { return static_cast<size_t>(file_bits) + seq_bits + pos_bits; }
+
+        /// number of bits to store values in [0, max].
+        static uint8_t bits_for(size_t const & max) {
+          uint8_t b = 0;
+          while ((b < 64) && ((max >> b) > 0)) ++b;
+          return b;
+        }
+    };
+
+
+    /**
+     * @class     bliss::common::PackedSequenceKmerId
+     * @brief     an Id in a file, like ShortSequenceKmerId, with field widths chosen at runtime and a configurable word size.
+     * @details   the file id, the sequence id (== file position of the record) and the position within the sequence are packed
+     *            into a single WORD, most significant first, so ids order by (file, record, position) as ShortSequenceKmerId does.
+     *            the widths are the same for all ids of a WORD type in a process.  set them once, before any id is created, from
+     *            the globally reduced maxima of the input (see ::bliss::io::set_packed_id_layout), so that all ranks agree.
+     *
+     *            with uint32_t, and when the file positions and read lengths fit, a position index entry of a Kmer<21, DNA, uint16_t>
+     *            is 12 bytes instead of 16 (ShortSequenceKmerId) or 32 (SequenceId), and of a Kmer<15, DNA, uint32_t> 8 bytes
+     *            instead of 16.  with 64 bit k-mer words, std::pair pads the id back to 8 bytes.
+     *
+     *            the default layout has 1/8 of the bits for the file id and 1/4 for the position in the sequence, which for
+     *            uint64_t is the ShortSequenceKmerId layout.
+     *
+     * @tparam WORD   unsigned integer type holding the id.
+     */
+    template <typename WORD = uint64_t>
+    class PackedSequenceKmerId
+    {
+        static_assert(::std::is_integral<WORD>::value && !::std::is_signed<WORD>::value, "WORD has to be an unsigned integer type");
+
+      public:
+        static constexpr size_t word_bits = sizeof(WORD) * 8;
+
+        /// packed file id, sequence id and position in sequence.
+        WORD id;
+
+        /// the field widths of all ids of this type.
+        static packed_id_layout const & layout() {
+          return mutable_layout();
+        }
+
+        /**
+         * @brief  set the field widths from the largest file id, sequence id (file position of a record), and position in a
+         *         sequence.  ids created before the call are invalid.  throws if the fields do not fit in WORD.
+         */
+        static void set_layout(size_t const & max_file_id, size_t const & max_seq_id, size_t const & max_pos_in_seq) {
+          packed_id_layout l(packed_id_layout::bits_for(max_file_id), packed_id_layout::bits_for(max_seq_id),
+                             packed_id_layout::bits_for(max_pos_in_seq));
+          if (l.total() > word_bits) {
+            throw std::invalid_argument("PackedSequenceKmerId: file id, sequence id and position need more bits than the id word has.");
+          }
+          mutable_layout() = l;
+        }
+
+      protected:
+        static packed_id_layout & mutable_layout() {
+          static packed_id_layout l(word_bits / 8, word_bits - word_bits / 8 - word_bits / 4, word_bits / 4);
+          return l;
+        }
+
+        static WORD mask(uint8_t const & bits) {
+          return (bits >= word_bits) ? ~static_cast<WORD>(0) : static_cast<WORD>((static_cast<WORD>(1) << bits) - 1);
+        }
+
+        static WORD pack(size_t const & file_pos, size_t const & file_id, size_t const & pos_in_seq) {
+          packed_id_layout const & l = layout();
+          return (l.file_bits == 0 ? 0 : (static_cast<WORD>(file_id) & mask(l.file_bits)) << (l.seq_bits + l.pos_bits)) |
+                 (l.seq_bits == 0 ? 0 : (static_cast<WORD>(file_pos) & mask(l.seq_bits)) << l.pos_bits) |
+                 (static_cast<WORD>(pos_in_seq) & mask(l.pos_bits));
+        }
+
+      public:
+        friend std::ostream& operator<<(std::ostream& ost, const PackedSequenceKmerId & seq_id)
+        {
+          ost << " PackedSeqId: file=" << seq_id.get_file_id() << " id=" << seq_id.get_id() << " pos=" << seq_id.get_pos();
+
+          return ost;
+        }
+
+        PackedSequenceKmerId() : id(0) {};
+
+        PackedSequenceKmerId(size_t const & file_pos, uint16_t const & file_id = 0, size_t const & pos_in_seq = 0) :
+          id(pack(file_pos, file_id, pos_in_seq)) {}
+        PackedSequenceKmerId(SequenceId const & other) : PackedSequenceKmerId(other.pos_in_file, other.file_id) {}
+        PackedSequenceKmerId(PackedSequenceKmerId const & other) = default;
+
+        PackedSequenceKmerId& operator=(SequenceId const & other) {
+          this->id = pack(other.pos_in_file, other.file_id, 0);
+          return *this;
+        }
+        PackedSequenceKmerId& operator=(PackedSequenceKmerId const & other) = default;
+
+        bool operator==(PackedSequenceKmerId const & other) const {
+          return id == other.id;
+        }
+
+        bool operator>(PackedSequenceKmerId const & other) const {
+          return id > other.id;
+        }
+
+        bool operator<(PackedSequenceKmerId const & other) const {
+          return id < other.id;
+        }
+
+
+        void operator+=(size_t dist) {
+          if ((static_cast<size_t>(id & mask(layout().pos_bits)) + dist) > static_cast<size_t>(mask(layout().pos_bits)))
+            throw std::invalid_argument("PackedSequenceKmerId increment overflow.  please check the layout.");
+          id += static_cast<WORD>(dist);
+        }
+
+        void operator-=(size_t dist) {
+          if (static_cast<size_t>(id & mask(layout().pos_bits)) < dist)
+            throw std::invalid_argument("PackedSequenceKmerId decrement underflow.  please check dist parameter");
+          id -= static_cast<WORD>(dist);
+        }
+
+        std::ptrdiff_t operator-(PackedSequenceKmerId const & other) {
+          return (id >= other.id) ? static_cast<std::ptrdiff_t>(id - other.id) :
+              -(static_cast<std::ptrdiff_t>(other.id - id));
+        }
+
+        /// getter for sequence id  (== file position of the record)
+        size_t get_id() const {
+          return (layout().seq_bits == 0) ? 0 : static_cast<size_t>((this->id >> layout().pos_bits) & mask(layout().seq_bits));
+        }
+
+        /// get position in file
+        size_t get_pos() const { return get_id() + static_cast<size_t>(this->id & mask(layout().pos_bits)); }
+
+        /// getter for file id
+        uint16_t get_file_id() const {
+          return static_cast<uint16_t>((layout().seq_bits + layout().pos_bits >= word_bits) ? 0 :
+                                       (this->id >> (layout().seq_bits + layout().pos_bits)));
+        }
+
+    };
+    template <typename WORD>
+    constexpr size_t PackedSequenceKmerId<WORD>::word_bits;
+
+
+    /**
+     * @class     bliss::common::ReadKmerId
+     * @brief     a k-mer occurrence as a global read number and the k-mer's offset from the start of the read's record.
+     * @details   read | offset, offset in the low OFFSET_BITS bits, so ids order by (read, offset).  the offset is the same
+     *            as the position field of ShortSequenceKmerId.  the file position of the read is not stored.  it is looked
+     *            up on demand in a read table, e.g. ::bliss::index::kmer::ReadOffsetTable.
+     *
+     *            e.g. uint32_t with 8 bit offsets holds 16M reads of up to 255 characters per record, at half the size of a
+     *            ShortSequenceKmerId.
+     *
+     * @tparam WORD          unsigned integer type holding the id.
+     * @tparam OFFSET_BITS   bits for the offset in the record.
+     */
+    template <typename WORD = uint64_t, unsigned int OFFSET_BITS = 16>
+    class ReadKmerId
+    {
+        static_assert(::std::is_integral<WORD>::value && !::std::is_signed<WORD>::value, "WORD has to be an unsigned integer type");
+        static_assert((OFFSET_BITS > 0) && (OFFSET_BITS < sizeof(WORD) * 8), "OFFSET_BITS has to leave bits for the read");
+
+      public:
+        static constexpr WORD offset_mask = static_cast<WORD>((static_cast<WORD>(1) << OFFSET_BITS) - 1);
+        /// largest read number.
+        static constexpr size_t max_read = static_cast<size_t>(~static_cast<WORD>(0) >> OFFSET_BITS);
+
+        /// packed read number and offset.
+        WORD id;
+
+        friend std::ostream& operator<<(std::ostream& ost, const ReadKmerId & read_id)
+        {
+          ost << " ReadKmerId: read=" << read_id.get_read() << " offset=" << read_id.get_offset();
+          return ost;
+        }
+
+        ReadKmerId() : id(0) {};
+
+        ReadKmerId(size_t const & read, size_t const & offset = 0) :
+          id((static_cast<WORD>(read) << OFFSET_BITS) | (static_cast<WORD>(offset) & offset_mask)) {}
+        ReadKmerId(ReadKmerId const & other) = default;
+
+        ReadKmerId& operator=(ReadKmerId const & other) = default;
+
+        bool operator==(ReadKmerId const & other) const {
+          return id == other.id;
+        }
+
+        bool operator>(ReadKmerId const & other) const {
+          return id > other.id;
+        }
+
+        bool operator<(ReadKmerId const & other) const {
+          return id < other.id;
+        }
+
+        void operator+=(size_t dist) {
+          if ((static_cast<size_t>(id & offset_mask) + dist) > static_cast<size_t>(offset_mask))
+            throw std::invalid_argument("ReadKmerId increment overflow.  the record is longer than OFFSET_BITS allows.");
+          id += static_cast<WORD>(dist);
+        }
+
+        /// global number of the read.
+        size_t get_read() const { return static_cast<size_t>(id >> OFFSET_BITS); }
+
+        /// offset of the k-mer from the start of the read's record.
+        size_t get_offset() const { return static_cast<size_t>(id & offset_mask); }
+
+    };
+    template <typename WORD, unsigned int OFFSET_BITS>
+    constexpr WORD ReadKmerId<WORD, OFFSET_BITS>::offset_mask;
+    template <typename WORD, unsigned int OFFSET_BITS>
+    constexpr size_t ReadKmerId<WORD, OFFSET_BITS>::max_read;
+
+
     /**
      * @class     bliss::io::Sequence
      * @brief     represents a biological sequence, and provides iterators for traversing the sequence.
@@ -22,6 +22,9 @@
 #include "common/alphabet_traits.hpp"
 #include "common/packing_iterators.hpp"
 #include "common/kmer_iterators.hpp"
+#include "common/dna_encoder.hpp"
+#include "common/kmer_transform.hpp"
+#include "iterators/transform_iterator.hpp"
 #include "utils/generator.hpp"
 #include "utils/logging.h"
 
@@ -126,3 +129,119 @@ TEST(Benchmark_KmerGeneration, BenchmarkKmer1)
     EXPECT_EQ(kmer_arr[j], kmer_arr2[j]);
   }
 }
+
+
+/// output iterator that writes into a small circular buffer, so timing is not dominated by memory writes.
+template <typename T, size_t N = 1000>
+struct ring_output_iterator : public std::iterator<std::output_iterator_tag, T> {
+    std::array<T, N> * arr;
+    size_t * count;
+    ring_output_iterator(std::array<T, N> & _arr, size_t & _count) : arr(&_arr), count(&_count) {}
+    ring_output_iterator & operator*() { return *this; }
+    ring_output_iterator & operator=(T const & v) { (*arr)[*count % N] = v; ++(*count); return *this; }
+    ring_output_iterator & operator++() { return *this; }
+    ring_output_iterator & operator++(int) { return *this; }
+};
+
+TEST(Benchmark_KmerGeneration, BenchmarkDNAEncoder)
+{
+  // generate a random piece of DNA, in ascii
+  std::vector<unsigned char> dna = bliss::utils::random_dna(100000000);
+
+  typedef bliss::common::Kmer<31, bliss::common::DNA, uint64_t> Kmer;
+  std::size_t nKmers = dna.size() - Kmer::size + 1;
+
+  /* bulk conversion only */
+  std::vector<uint8_t> codes(dna.size());
+  bliss::common::DNAEncoder encode;
+  auto start = std::chrono::high_resolution_clock::now();
+  std::size_t n = encode(dna.data(), dna.size(), codes.data());
+  auto stop = std::chrono::high_resolution_clock::now();
+  EXPECT_EQ(n, dna.size());
+  BL_INFO( "Duration of bulk DNA conversion (simd = " << static_cast<int>(bliss::common::DNAEncoder::simd_type) << "): " << std::chrono::duration_cast<std::chrono::milliseconds>(stop-start).count() << "ms" );
+
+  /* iterator based: transform + sliding window */
+  typedef bliss::iterator::transform_iterator<std::vector<unsigned char>::iterator, bliss::common::ASCII2<bliss::common::DNA> > char_it_t;
+  typedef bliss::common::KmerGenerationIterator<char_it_t, Kmer> kmer_char_gen_it_t;
+
+  kmer_char_gen_it_t kmerGenIt(char_it_t(dna.begin(), bliss::common::ASCII2<bliss::common::DNA>()), true);
+  kmer_char_gen_it_t kmerGenEnd(char_it_t(dna.end(), bliss::common::ASCII2<bliss::common::DNA>()), false);
+
+  std::array<Kmer, 1000> kmer_arr;
+  size_t i = 0;
+  start = std::chrono::high_resolution_clock::now();
+  std::copy(kmerGenIt, kmerGenEnd, ring_output_iterator<Kmer>(kmer_arr, i));
+  stop = std::chrono::high_resolution_clock::now();
+  EXPECT_EQ(i, nKmers);
+  BL_INFO( "Duration of iterator kmer generation (i = " << i << "): " << std::chrono::duration_cast<std::chrono::milliseconds>(stop-start).count() << "ms" );
+
+  /* bulk conversion + rolling word shift */
+  std::array<Kmer, 1000> kmer_arr2;
+  size_t j = 0;
+  bliss::common::DNAKmerGenerator<Kmer> gen;
+  start = std::chrono::high_resolution_clock::now();
+  gen(dna.data(), dna.data() + dna.size(), ring_output_iterator<Kmer>(kmer_arr2, j));
+  stop = std::chrono::high_resolution_clock::now();
+  EXPECT_EQ(j, nKmers);
+  BL_INFO( "Duration of encoder kmer generation (i = " << j << "): " << std::chrono::duration_cast<std::chrono::milliseconds>(stop-start).count() << "ms" );
+
+  // last 1000 kmers should be identical
+  for (unsigned int k = 0; k < 1000; ++k)
+  {
+    EXPECT_EQ(kmer_arr[k], kmer_arr2[k]);
+  }
+}
+
+
+TEST(Benchmark_KmerGeneration, BenchmarkCanonicalKmer)
+{
+  std::vector<unsigned char> dna = bliss::utils::random_dna(100000000);
+  bliss::common::AlphabetTraits<bliss::common::DNA>::translateFromAscii(dna.begin(), dna.end(), dna.begin());
+
+  typedef bliss::common::Kmer<31, bliss::common::DNA, uint64_t> Kmer;
+  std::size_t nKmers = dna.size() - Kmer::size + 1;
+
+  /* forward only */
+  typedef bliss::common::KmerGenerationIterator<std::vector<unsigned char>::iterator, Kmer> kmer_gen_it_t;
+  std::array<Kmer, 1000> kmer_arr;
+  unsigned int i = 0;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (kmer_gen_it_t it(dna.begin(), true), end(dna.end(), false); it != end; ++it, ++i) {
+    kmer_arr[i % 1000] = *it;
+  }
+  auto stop = std::chrono::high_resolution_clock::now();
+  EXPECT_EQ(i, nKmers);
+  BL_INFO( "Duration of forward kmer generation (i = " << i << "): " << std::chrono::duration_cast<std::chrono::milliseconds>(stop-start).count() << "ms" );
+
+  /* forward, then reverse complement per k-mer */
+  bliss::kmer::transform::lex_less<Kmer> lex;
+  std::array<Kmer, 1000> kmer_arr1;
+  i = 0;
+
+  start = std::chrono::high_resolution_clock::now();
+  for (kmer_gen_it_t it(dna.begin(), true), end(dna.end(), false); it != end; ++it, ++i) {
+    kmer_arr1[i % 1000] = lex(*it);
+  }
+  stop = std::chrono::high_resolution_clock::now();
+  EXPECT_EQ(i, nKmers);
+  BL_INFO( "Duration of forward + lex_less kmer generation (i = " << i << "): " << std::chrono::duration_cast<std::chrono::milliseconds>(stop-start).count() << "ms" );
+
+  /* rolling forward and reverse complement */
+  typedef bliss::common::CanonicalKmerGenerationIterator<std::vector<unsigned char>::iterator, Kmer> canon_gen_it_t;
+  std::array<Kmer, 1000> kmer_arr2;
+  i = 0;
+
+  start = std::chrono::high_resolution_clock::now();
+  for (canon_gen_it_t it(dna.begin(), true), end(dna.end(), false); it != end; ++it, ++i) {
+    kmer_arr2[i % 1000] = *it;
+  }
+  stop = std::chrono::high_resolution_clock::now();
+  EXPECT_EQ(i, nKmers);
+  BL_INFO( "Duration of canonical kmer generation (i = " << i << "): " << std::chrono::duration_cast<std::chrono::milliseconds>(stop-start).count() << "ms" );
+
+  for (unsigned int j = 0; j < 1000; ++j)
+  {
+    EXPECT_EQ(kmer_arr1[j], kmer_arr2[j]);
+  }
+}
@@ -41,6 +41,7 @@
 #include <cstdint>
 
 #include "common/kmer.hpp"
+#include "common/kmer_transform.hpp"
 #include "common/test/kmer_reverse_helper.hpp"
 
 #include "common/alphabets.hpp"
@@ -112,7 +113,7 @@ class KmerReverseBenchmark : public ::testing::Test {
 
     	template <typename WORD_TYPE>
     	inline WORD_TYPE operator()(WORD_TYPE const & src) const {
-    		return bliss::utils::bit_ops::bit_not(op.reverse(src));
+    		return bliss::utils::bit_ops::reverse_not(op, src);
     	}
     };
     template <unsigned int BITS, unsigned char SIMD>
@@ -331,6 +332,11 @@ TYPED_TEST_P(KmerReverseBenchmark, reverse)
     this->template benchmark<bliss::utils::bit_ops::BITREV_AVX2>();
     BL_TIMER_END(km, "revop avx2", KmerReverseBenchmark<TypeParam>::iterations);
 #endif
+#ifdef BLISS_BITREV_AVX512
+    BL_TIMER_START(km);
+    this->template benchmark<bliss::utils::bit_ops::BITREV_AVX512>();
+    BL_TIMER_END(km, "revop avx512", KmerReverseBenchmark<TypeParam>::iterations);
+#endif
 
 BL_TIMER_START(km);
 	constexpr size_t bytes = sizeof(typename TypeParam::KmerWordType) * TypeParam::nWords;
@@ -384,6 +390,11 @@ TYPED_TEST_P(KmerReverseBenchmark, revcomp)
     this->template benchmark_c<bliss::utils::bit_ops::BITREV_AVX2>();
     BL_TIMER_END(km, "revopc avx2", KmerReverseBenchmark<TypeParam>::iterations);
 #endif
+#ifdef BLISS_BITREV_AVX512
+    BL_TIMER_START(km);
+    this->template benchmark_c<bliss::utils::bit_ops::BITREV_AVX512>();
+    BL_TIMER_END(km, "revopc avx512", KmerReverseBenchmark<TypeParam>::iterations);
+#endif
 
 
 
@@ -406,11 +417,37 @@ TYPED_TEST_P(KmerReverseBenchmark, revcomp)
 
 
 
+TYPED_TEST_P(KmerReverseBenchmark, canonical)
+{
+  BL_TIMER_INIT(km);
+
+  ::bliss::kmer::transform::lex_less<TypeParam> lex;
+  TEST_REV("canon lex_less", lex, TypeParam);
+
+  // batched, in place.  copy first so each version sees the same input.
+  std::copy(KmerReverseBenchmark<TypeParam>::kmers.begin(), KmerReverseBenchmark<TypeParam>::kmers.end(),
+            KmerReverseBenchmark<TypeParam>::outputs.begin());
+  BL_TIMER_START(km);
+  ::bliss::kmer::transform::canonicalize(KmerReverseBenchmark<TypeParam>::outputs.data(),
+                                         KmerReverseBenchmark<TypeParam>::outputs.data() + KmerReverseBenchmark<TypeParam>::iterations);
+  BL_TIMER_END(km, "canon batch", KmerReverseBenchmark<TypeParam>::iterations);
+
+  BL_TIMER_START(km);
+  ::bliss::kmer::transform::reverse_complement(KmerReverseBenchmark<TypeParam>::kmers.data(),
+                                               KmerReverseBenchmark<TypeParam>::kmers.data() + KmerReverseBenchmark<TypeParam>::iterations,
+                                               KmerReverseBenchmark<TypeParam>::outputs.data());
+  BL_TIMER_END(km, "revc batch", KmerReverseBenchmark<TypeParam>::iterations);
+
+  BL_TIMER_REPORT(km);
+}
+
+
 
 
 //REGISTER_TYPED_TEST_CASE_P(KmerReverseBenchmark, rev_seq, rev_seq2, revcomp_seq, rev_bswap, revcomp_bswap, rev_swar, revcomp_swar, rev, revcomp, rev_ssse3, revcomp_ssse3);
 
 REGISTER_TYPED_TEST_CASE_P(KmerReverseBenchmark,
 		reverse,
-		revcomp);
+		revcomp,
+		canonical);
 
@@ -89,7 +89,7 @@ class KmerReverseOpTest : public ::testing::Test {
 
     	template <typename WORD_TYPE>
     	inline WORD_TYPE operator()(WORD_TYPE const & src) const {
-    		return bliss::utils::bit_ops::bit_not(op.reverse(src));
+    		return bliss::utils::bit_ops::reverse_not(op, src);
     	}
     };
     template <unsigned int BITS, unsigned char SIMD>
@@ -254,6 +254,24 @@ TYPED_TEST_P(KmerReverseOpTest, reverse_avx2)
 #endif
 }
 
+TYPED_TEST_P(KmerReverseOpTest, reverse_avx512)
+{
+#ifdef BLISS_BITREV_AVX512
+  this->template test<bliss::utils::bit_ops::BITREV_AVX512>();
+#else
+  BL_WARNINGF("AVX512 VBMI and GFNI are not enabled or not available.");
+#endif
+}
+
+TYPED_TEST_P(KmerReverseOpTest, reverse_neon)
+{
+#ifdef BLISS_BITREV_NEON
+  this->template test<bliss::utils::bit_ops::BITREV_NEON>();
+#else
+  BL_WARNINGF("NEON is not enabled or not available.");
+#endif
+}
+
 TYPED_TEST_P(KmerReverseOpTest, reverse_auto)
 {
 	constexpr size_t bytes = sizeof(typename TypeParam::KmerWordType) * TypeParam::nWords;
@@ -283,6 +301,24 @@ TYPED_TEST_P(KmerReverseOpTest, revcomp_avx2)
 #endif
 }
 
+TYPED_TEST_P(KmerReverseOpTest, revcomp_avx512)
+{
+#ifdef BLISS_BITREV_AVX512
+  this->template testc<bliss::utils::bit_ops::BITREV_AVX512>();
+#else
+  BL_WARNINGF("AVX512 VBMI and GFNI are not enabled or not available.");
+#endif
+}
+
+TYPED_TEST_P(KmerReverseOpTest, revcomp_neon)
+{
+#ifdef BLISS_BITREV_NEON
+  this->template testc<bliss::utils::bit_ops::BITREV_NEON>();
+#else
+  BL_WARNINGF("NEON is not enabled or not available.");
+#endif
+}
+
 TYPED_TEST_P(KmerReverseOpTest, revcomp_auto)
 {
 	constexpr size_t bytes = sizeof(typename TypeParam::KmerWordType) * TypeParam::nWords;
@@ -291,5 +327,5 @@ TYPED_TEST_P(KmerReverseOpTest, revcomp_auto)
 
 
 
-REGISTER_TYPED_TEST_CASE_P(KmerReverseOpTest,  reverse_swar, reverse_ssse3, reverse_avx2, reverse_auto, revcomp_swar, revcomp_ssse3, revcomp_avx2, revcomp_auto);
+REGISTER_TYPED_TEST_CASE_P(KmerReverseOpTest,  reverse_swar, reverse_ssse3, reverse_avx2, reverse_avx512, reverse_neon, reverse_auto, revcomp_swar, revcomp_ssse3, revcomp_avx2, revcomp_avx512, revcomp_neon, revcomp_auto);
 
@@ -32,6 +32,7 @@
 
 #include <random>
 #include <cstdint>
+#include <vector>
 
 #include "common/kmer.hpp"
 #include "common/alphabets.hpp"
@@ -215,8 +216,69 @@ TYPED_TEST_P(KmerTransformTest, lex_greater)
 
 
 
+TYPED_TEST_P(KmerTransformTest, batch)
+{
+  // sizes chosen to leave a partial vector at the end.
+  std::vector<TypeParam> kmers;
+  auto km = this->kmer;
+  for (size_t i = 0; i < 1021; ++i) {
+    kmers.push_back(km);
+    km.nextFromChar(rand() % TypeParam::KmerAlphabet::SIZE);
+  }
+
+  std::vector<TypeParam> revs(kmers.size());
+  bliss::kmer::transform::reverse_complement(kmers.data(), kmers.data() + kmers.size(), revs.data());
+  for (size_t i = 0; i < kmers.size(); ++i) {
+    ASSERT_EQ(kmers[i].reverse_complement(), revs[i]) << " at " << i;
+  }
+
+  bliss::kmer::transform::lex_less<TypeParam> op;
+  std::vector<TypeParam> canon(kmers);
+  bliss::kmer::transform::canonicalize(canon.data(), canon.data() + canon.size());
+  for (size_t i = 0; i < kmers.size(); ++i) {
+    ASSERT_EQ(op(kmers[i]), canon[i]) << " at " << i;
+  }
+}
+
+
+
+TYPED_TEST_P(KmerTransformTest, in_place)
+{
+  std::vector<TypeParam> kmers;
+  std::vector<std::pair<TypeParam, int> > pairs;
+  auto km = this->kmer;
+  for (size_t i = 0; i < 1021; ++i) {
+    kmers.push_back(km);
+    pairs.emplace_back(km, i);
+    km.nextFromChar(rand() % TypeParam::KmerAlphabet::SIZE);
+  }
+
+  std::vector<TypeParam> out(kmers);
+  bliss::transform::transform_in_place<bliss::transform::identity<TypeParam> >(out.data(), out.data() + out.size());
+  ASSERT_TRUE(kmers == out);
+
+  bliss::kmer::transform::lex_less<TypeParam> canon;
+  bliss::transform::transform_in_place<bliss::kmer::transform::lex_less<TypeParam> >(out.data(), out.data() + out.size());
+  for (size_t i = 0; i < kmers.size(); ++i) {
+    ASSERT_EQ(canon(kmers[i]), out[i]) << " at " << i;
+  }
+
+  bliss::kmer::transform::xor_rev_comp<TypeParam> xor_op;
+  out = kmers;
+  bliss::transform::transform_in_place<bliss::kmer::transform::xor_rev_comp<TypeParam> >(out.data(), out.data() + out.size());
+  for (size_t i = 0; i < kmers.size(); ++i) {
+    ASSERT_EQ(xor_op(kmers[i]), out[i]) << " at " << i;
+  }
+
+  bliss::transform::transform_in_place<bliss::kmer::transform::lex_less<TypeParam> >(pairs.data(), pairs.data() + pairs.size());
+  for (size_t i = 0; i < kmers.size(); ++i) {
+    ASSERT_EQ(canon(kmers[i]), pairs[i].first) << " at " << i;
+    ASSERT_EQ(static_cast<int>(i), pairs[i].second);
+  }
+}
+
 
-REGISTER_TYPED_TEST_CASE_P(KmerTransformTest, identity, trans_xor, lex_less, lex_greater);
+REGISTER_TYPED_TEST_CASE_P(KmerTransformTest, identity, trans_xor, lex_less, lex_greater, batch, in_place);
 
 //////////////////// RUN the tests with different types.
 
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+// include classes to test
+#include "common/dna_encoder.hpp"
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/alphabet_traits.hpp"
+#include "common/kmer_iterators.hpp"
+#include "iterators/transform_iterator.hpp"
+#include "iterators/filter_iterator.hpp"
+#include "utils/file_utils.hpp"
+
+
+// random DNA with some lower case, non-ACGT characters and EOLs.
+std::string make_dna_input(size_t len) {
+  static const char chars[] = "ACGTACGTACGTacgtNn\n";
+  std::string input(len, 'A');
+  for (size_t i = 0; i < len; ++i) {
+    input[i] = chars[rand() % (sizeof(chars) - 1)];
+  }
+  return input;
+}
+
+template <typename Encoder>
+void check_encoder(std::string const & input) {
+  std::vector<uint8_t> gold;
+  for (size_t i = 0; i < input.size(); ++i) {
+    if ((input[i] != '\n') && (input[i] != '\r'))
+      gold.push_back(bliss::common::DNA::FROM_ASCII[static_cast<unsigned char>(input[i])]);
+  }
+
+  std::vector<uint8_t> out(input.size());
+  Encoder encode;
+  size_t n = encode(reinterpret_cast<unsigned char const *>(input.data()), input.size(), out.data());
+  out.resize(n);
+
+  ASSERT_EQ(gold.size(), out.size());
+  EXPECT_TRUE(std::equal(gold.begin(), gold.end(), out.begin()));
+}
+
+template <typename KmerType>
+void check_kmer_generator(std::string const & input) {
+  using BaseIterator = std::string::const_iterator;
+  using CharIter = bliss::iterator::filter_iterator<bliss::utils::file::NotEOL, BaseIterator>;
+  using BaseCharIterator = bliss::iterator::transform_iterator<CharIter, bliss::common::ASCII2<bliss::common::DNA> >;
+  using KmerIterator = bliss::common::KmerGenerationIterator<BaseCharIterator, KmerType>;
+
+  // gold from iterators.  need at least k valid characters.
+  std::vector<KmerType> gold;
+  size_t valid = 0;
+  for (size_t i = 0; i < input.size(); ++i) {
+    if ((input[i] != '\n') && (input[i] != '\r')) ++valid;
+  }
+  if (valid >= KmerType::size) {
+    bliss::utils::file::NotEOL neol;
+    KmerIterator start(BaseCharIterator(CharIter(neol, input.cbegin(), input.cend()), bliss::common::ASCII2<bliss::common::DNA>()), true);
+    KmerIterator end(BaseCharIterator(CharIter(neol, input.cend()), bliss::common::ASCII2<bliss::common::DNA>()), false);
+    gold.assign(start, end);
+  }
+
+  std::vector<KmerType> out;
+  bliss::common::DNAKmerGenerator<KmerType> gen;
+  unsigned char const * b = reinterpret_cast<unsigned char const *>(input.data());
+  gen(b, b + input.size(), std::back_inserter(out));
+
+  ASSERT_EQ(gold.size(), out.size());
+  for (size_t i = 0; i < gold.size(); ++i) {
+    EXPECT_EQ(gold[i], out[i]) << " at " << i;
+  }
+}
+
+
+TEST(DNAEncoder, AllChars)
+{
+  std::string input(256, 0);
+  for (int i = 0; i < 256; ++i) input[i] = static_cast<char>(i);
+
+  check_encoder<bliss::common::dna_encoder<bliss::utils::bit_ops::BIT_REV_SEQ> >(input);
+  check_encoder<bliss::common::DNAEncoder>(input);
+}
+
+TEST(DNAEncoder, RandomWithEOL)
+{
+  srand(23);
+  for (size_t len : {0, 1, 15, 16, 17, 31, 32, 33, 100, 1000, 4099}) {
+    std::string input = make_dna_input(len);
+    check_encoder<bliss::common::dna_encoder<bliss::utils::bit_ops::BIT_REV_SEQ> >(input);
+    check_encoder<bliss::common::DNAEncoder>(input);
+  }
+}
+
+TEST(DNAKmerGenerator, SingleWord)
+{
+  srand(23);
+  for (size_t len : {0, 10, 21, 22, 100, 1023, 1024, 1025, 5000}) {
+    std::string input = make_dna_input(len);
+    check_kmer_generator<bliss::common::Kmer<21, bliss::common::DNA, uint64_t> >(input);
+    check_kmer_generator<bliss::common::Kmer<32, bliss::common::DNA, uint64_t> >(input);
+    check_kmer_generator<bliss::common::Kmer<1, bliss::common::DNA, uint8_t> >(input);
+    check_kmer_generator<bliss::common::Kmer<4, bliss::common::DNA, uint8_t> >(input);
+  }
+}
+
+TEST(DNAKmerGenerator, MultiWord)
+{
+  srand(23);
+  for (size_t len : {0, 10, 35, 36, 100, 1023, 1024, 1025, 5000}) {
+    std::string input = make_dna_input(len);
+    check_kmer_generator<bliss::common::Kmer<35, bliss::common::DNA, uint32_t> >(input);
+    check_kmer_generator<bliss::common::Kmer<63, bliss::common::DNA, uint64_t> >(input);
+    check_kmer_generator<bliss::common::Kmer<31, bliss::common::DNA, uint16_t> >(input);
+  }
+}
@@ -16,6 +16,8 @@
 
 // include google test
 #include <gtest/gtest.h>
+
+#include <algorithm>
 //#include <boost/concept_check.hpp>
 
 // include classes to test
@@ -23,6 +25,7 @@
 #include "common/alphabets.hpp"
 #include "iterators/transform_iterator.hpp"
 #include "common/kmer_iterators.hpp"
+#include "common/kmer_transform.hpp"
 #include "utils/kmer_utils.hpp"
 #include "utils/logging.h"
 
@@ -63,6 +66,38 @@ void compute_kmer_iter(std::string input) {
 }
 
 
+template<typename Alphabet, int K>
+void compute_canonical_kmer_iter(std::string input) {
+
+  using KmerType = bliss::common::Kmer<K, Alphabet>;
+
+  using BaseIterator = std::string::const_iterator;
+
+  using Decoder = bliss::common::ASCII2<Alphabet, typename BaseIterator::value_type>;
+  using BaseCharIterator = bliss::iterator::transform_iterator<BaseIterator, Decoder>;
+
+  BaseCharIterator charStart(input.cbegin(), Decoder());
+  BaseCharIterator charEnd  (input.cend(),   Decoder());
+
+  using KmerIterator = bliss::common::KmerGenerationIterator<BaseCharIterator, KmerType>;
+  using CanonicalIterator = bliss::common::CanonicalKmerGenerationIterator<BaseCharIterator, KmerType>;
+
+  KmerIterator start(charStart, true);
+  KmerIterator end(charEnd, false);
+  CanonicalIterator cstart(charStart, true);
+  CanonicalIterator cend(charEnd, false);
+
+  bliss::kmer::transform::lex_less<KmerType> lex;
+
+  int i = 0;
+  for (; start != end; ++start, ++cstart, ++i) {
+    ASSERT_TRUE(cstart != cend);
+    EXPECT_EQ(lex(*start), *cstart) << " at " << i;
+  }
+  EXPECT_TRUE(cstart == cend);
+}
+
+
 /**
  * Test k-mer generation with 2 bits for each character
  */
@@ -120,3 +155,122 @@ TEST(KmerIterator, TestKmerIteratorDNA5MultiWord)
 }
 
 
+/**
+ * Test canonical k-mer generation against lex_less of the forward k-mers
+ */
+TEST(KmerIterator, TestCanonicalKmerIterator)
+{
+  // test sequence: GATTTGGGGTTCAAAGCAGTATCGATCAAATAGTAAATCCATTTGTTCAACTCACAGTTT
+  std::string input = "GATTTGGGGTTCAAAGCAGT"
+                         "ATCGATCAAATAGTAAATCC"
+                         "ATTTGTTCAACTCACAGTTT";
+
+  compute_canonical_kmer_iter<bliss::common::DNA, 21>(input);
+  compute_canonical_kmer_iter<bliss::common::DNA, 32>(input);
+  compute_canonical_kmer_iter<bliss::common::DNA, 33>(input);
+  compute_canonical_kmer_iter<bliss::common::DNA5, 21>(input);
+  compute_canonical_kmer_iter<bliss::common::DNA5, 33>(input);
+  compute_canonical_kmer_iter<bliss::common::DNA16, 21>(input);
+}
+
+
+template<typename Alphabet, uint64_t SEED>
+void compute_spaced_kmer_iter(std::string input) {
+
+  using Seed = bliss::common::spaced_seed<SEED>;
+  using KmerType = bliss::common::Kmer<Seed::weight, Alphabet>;
+
+  using BaseIterator = std::string::const_iterator;
+
+  using Decoder = bliss::common::ASCII2<Alphabet, typename BaseIterator::value_type>;
+  using BaseCharIterator = bliss::iterator::transform_iterator<BaseIterator, Decoder>;
+
+  BaseCharIterator charStart(input.cbegin(), Decoder());
+  BaseCharIterator charEnd  (input.cend(),   Decoder());
+
+  using KmerIterator = bliss::common::SpacedKmerGenerationIterator<BaseCharIterator, KmerType, Seed>;
+
+  KmerIterator start(charStart, true);
+  KmerIterator end(charEnd, false);
+
+  size_t i = 0;
+  for (; start != end; ++start, ++i) {
+    // keep the characters of the span whose seed digit is 1, most significant digit first.
+    std::string gold;
+    for (unsigned int j = 0; j < Seed::span; ++j) {
+      if ((SEED >> (Seed::span - 1 - j)) & 1) gold.push_back(input[i + j]);
+    }
+
+    EXPECT_EQ(gold, bliss::utils::KmerUtils::toASCIIString(*start)) << " at " << i;
+  }
+  EXPECT_EQ(input.size() - Seed::span + 1, i);
+}
+
+template<typename Alphabet, uint64_t SEED1, uint64_t SEED2>
+void compute_multi_spaced_kmer_iter(std::string input) {
+
+  using Seed1 = bliss::common::spaced_seed<SEED1>;
+  using Seed2 = bliss::common::spaced_seed<SEED2>;
+  using KmerType = bliss::common::Kmer<Seed1::weight, Alphabet>;
+
+  using BaseIterator = std::string::const_iterator;
+
+  using Decoder = bliss::common::ASCII2<Alphabet, typename BaseIterator::value_type>;
+  using BaseCharIterator = bliss::iterator::transform_iterator<BaseIterator, Decoder>;
+
+  BaseCharIterator charStart(input.cbegin(), Decoder());
+  BaseCharIterator charEnd  (input.cend(),   Decoder());
+
+  using MultiIterator = bliss::common::MultiSpacedKmerGenerationIterator<BaseCharIterator, KmerType, Seed1, Seed2>;
+  using Iterator1 = bliss::common::SpacedKmerGenerationIterator<BaseCharIterator, KmerType, Seed1>;
+  using Iterator2 = bliss::common::SpacedKmerGenerationIterator<BaseCharIterator, KmerType, Seed2>;
+
+  MultiIterator start(charStart, true);
+  MultiIterator end(charEnd, false);
+  Iterator1 start1(charStart, true);
+  Iterator2 start2(charStart, true);
+
+  // each seed gives the same k-mers as on its own, up to the longer span.
+  size_t i = 0;
+  for (; start != end; ++start, ++start1, ++start2, ++i) {
+    auto kmers = *start;
+    EXPECT_EQ(*start1, kmers[0]) << " at " << i;
+    EXPECT_EQ(*start2, kmers[1]) << " at " << i;
+  }
+  EXPECT_EQ(input.size() - std::max(Seed1::span, Seed2::span) + 1, i);
+}
+
+/**
+ * Test spaced k-mer generation against the characters picked from the input.
+ */
+TEST(KmerIterator, TestSpacedKmerIterator)
+{
+  // test sequence: GATTTGGGGTTCAAAGCAGTATCGATCAAATAGTAAATCCATTTGTTCAACTCACAGTTT
+  std::string input = "GATTTGGGGTTCAAAGCAGT"
+                         "ATCGATCAAATAGTAAATCC"
+                         "ATTTGTTCAACTCACAGTTT";
+
+  EXPECT_EQ(7U, (bliss::common::spaced_seed<0x6D>::span));
+  EXPECT_EQ(5U, (bliss::common::spaced_seed<0x6D>::weight));
+
+  compute_spaced_kmer_iter<bliss::common::DNA, 0x6D>(input);             // 1101101
+  compute_spaced_kmer_iter<bliss::common::DNA, 0x3A537>(input);          // 111010010100110111
+  compute_spaced_kmer_iter<bliss::common::DNA, 0xB6DB6DB6DB>(input);     // span 40, multiword window
+  compute_spaced_kmer_iter<bliss::common::DNA5, 0x3A537>(input);
+  compute_spaced_kmer_iter<bliss::common::DNA16, 0x3A537>(input);
+  compute_spaced_kmer_iter<bliss::common::DNA, 0x1FFFFF>(input);         // no gaps
+}
+
+/**
+ * Test spaced k-mer generation for 2 seeds in 1 pass against each seed on its own.
+ */
+TEST(KmerIterator, TestMultiSpacedKmerIterator)
+{
+  // test sequence: GATTTGGGGTTCAAAGCAGTATCGATCAAATAGTAAATCCATTTGTTCAACTCACAGTTT
+  std::string input = "GATTTGGGGTTCAAAGCAGT"
+                         "ATCGATCAAATAGTAAATCC"
+                         "ATTTGTTCAACTCACAGTTT";
+
+  compute_multi_spaced_kmer_iter<bliss::common::DNA, 0x3A537, 0x3B2B3>(input);   // 111010010100110111, 111011001010110011
+  compute_multi_spaced_kmer_iter<bliss::common::DNA, 0x6D, 0x1D1>(input);        // 1101101, 111010001
+}
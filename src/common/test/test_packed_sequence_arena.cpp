@@ -0,0 +1,185 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+#include <random>
+
+// include files to test
+#include "common/packed_sequence_arena.hpp"
+#include "common/alphabets.hpp"
+#include "common/alphabet_traits.hpp"
+#include "common/kmer.hpp"
+#include "common/kmer_iterators.hpp"
+#include "utils/filter_utils.hpp"
+#include "utils/file_utils.hpp"
+#include "iterators/filter_iterator.hpp"
+#include "iterators/transform_iterator.hpp"
+
+
+template <typename Kmer>
+class PackedSequenceArenaTest : public ::testing::Test
+{
+  protected:
+    using Alphabet = typename Kmer::KmerAlphabet;
+
+    std::vector<std::string> seqs;
+
+    virtual void SetUp()
+    {
+      std::mt19937 gen(17);
+      std::uniform_int_distribution<int> len_dist(0, 300);
+      std::uniform_int_distribution<int> char_dist(0, 99);
+
+      char const * chars = "ACGTacgtN";
+      for (int i = 0; i < 50; ++i) {
+        std::string s;
+        int len = len_dist(gen);
+        // include lengths at word boundaries
+        if (i < 4) len = 32 * i + 21 * (i % 2);
+        for (int j = 0; j < len; ++j) {
+          int c = char_dist(gen);
+          s.push_back((c < 3) ? '\n' : chars[c % 9]);
+        }
+        seqs.push_back(s);
+      }
+    }
+
+    /// k-mers of s, computed from the ASCII characters.
+    static std::vector<Kmer> gold_kmers(std::string const & s) {
+      using CharIter = ::bliss::iterator::filter_iterator<::bliss::utils::file::NotEOL, std::string::const_iterator>;
+      using ValIter = ::bliss::iterator::transform_iterator<CharIter, ::bliss::common::ASCII2<Alphabet, char> >;
+      using KmerIter = ::bliss::common::KmerGenerationIterator<ValIter, Kmer>;
+
+      std::vector<Kmer> out;
+      ::bliss::utils::file::NotEOL neol;
+      size_t n = std::count_if(s.begin(), s.end(), neol);
+      if (n < Kmer::size) return out;
+
+      KmerIter it(ValIter(CharIter(neol, s.begin(), s.end()), ::bliss::common::ASCII2<Alphabet, char>()), true);
+      KmerIter end(ValIter(CharIter(neol, s.end()), ::bliss::common::ASCII2<Alphabet, char>()), false);
+      std::copy(it, end, std::back_inserter(out));
+      return out;
+    }
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(PackedSequenceArenaTest);
+
+
+TYPED_TEST_P(PackedSequenceArenaTest, pack)
+{
+  using Alphabet = typename TypeParam::KmerAlphabet;
+  ::bliss::common::PackedSequenceArena<Alphabet> arena;
+
+  for (size_t i = 0; i < this->seqs.size(); ++i) {
+    arena.append(this->seqs[i].begin(), this->seqs[i].end(), i * 1000);
+  }
+  ASSERT_EQ(this->seqs.size(), arena.size());
+
+  ::bliss::common::ASCII2<Alphabet, char> to_val;
+  size_t total = 0;
+  for (size_t i = 0; i < this->seqs.size(); ++i) {
+    EXPECT_EQ(i * 1000, arena[i].offset);
+
+    size_t j = 0;
+    for (char c : this->seqs[i]) {
+      if (c == '\n') continue;
+      ASSERT_EQ(to_val(c), arena.get(i, j));
+      ++j;
+    }
+    EXPECT_EQ(j, arena[i].length);
+    total += j;
+  }
+  EXPECT_EQ(total, arena.chars());
+}
+
+TYPED_TEST_P(PackedSequenceArenaTest, kmers)
+{
+  using Alphabet = typename TypeParam::KmerAlphabet;
+  ::bliss::common::PackedSequenceArena<Alphabet> arena;
+
+  std::vector<TypeParam> gold;
+  for (auto const & s : this->seqs) {
+    arena.append(s.begin(), s.end());
+
+    std::vector<TypeParam> g = this->gold_kmers(s);
+    gold.insert(gold.end(), g.begin(), g.end());
+  }
+
+  std::vector<TypeParam> result;
+  arena.template generate<TypeParam>(std::back_inserter(result));
+
+  ASSERT_EQ(gold.size(), result.size());
+  EXPECT_TRUE(std::equal(gold.begin(), gold.end(), result.begin()));
+
+  // reuse after clear
+  arena.clear();
+  EXPECT_EQ(0UL, arena.size());
+  arena.append(this->seqs[3].begin(), this->seqs[3].end());
+  result.clear();
+  arena.template generate<TypeParam>(std::back_inserter(result));
+  EXPECT_EQ(this->gold_kmers(this->seqs[3]).size(), result.size());
+}
+
+
+TYPED_TEST_P(PackedSequenceArenaTest, source_offset)
+{
+  using Alphabet = typename TypeParam::KmerAlphabet;
+  ::bliss::common::PackedSequenceArena<Alphabet> arena;
+
+  // irregular lines from the random sequences, plus uniform lines with 2 character EOL and a short last line.
+  std::vector<std::string> seqs(this->seqs);
+  std::string fasta;
+  for (int i = 0; i < 400; ++i) {
+    fasta.push_back("ACGT"[(i * 7) % 4]);
+    if ((i % 60) == 59) fasta.append("\r\n");
+  }
+  seqs.push_back(fasta);
+  seqs.push_back(fasta.substr(17));
+  seqs.push_back("\nACGT\n");
+
+  for (size_t i = 0; i < seqs.size(); ++i) {
+    arena.append(seqs[i].begin(), seqs[i].end(), i * 1000);
+  }
+
+  for (size_t i = 0; i < seqs.size(); ++i) {
+    size_t j = 0;
+    for (size_t p = 0; p < seqs[i].size(); ++p) {
+      if ((seqs[i][p] == '\n') || (seqs[i][p] == '\r')) continue;
+      ASSERT_EQ(i * 1000 + p, arena.source_offset(i, j)) << "seq " << i << " char " << j;
+      ++j;
+    }
+  }
+}
+
+
+// now register the test cases
+REGISTER_TYPED_TEST_CASE_P(PackedSequenceArenaTest, pack, kmers, source_offset);
+
+
+typedef ::testing::Types<
+    ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>,
+    ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>,
+    ::bliss::common::Kmer<35, ::bliss::common::DNA, uint32_t>,
+    ::bliss::common::Kmer<35, ::bliss::common::DNA5, uint64_t>,
+    ::bliss::common::Kmer<21, ::bliss::common::DNA16, uint16_t>
+> PackedSequenceArenaTestTypes;
+
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, PackedSequenceArenaTest, PackedSequenceArenaTestTypes);
@@ -0,0 +1,266 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+// include classes to test
+#include "common/protein_encoder.hpp"
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/alphabet_traits.hpp"
+#include "common/kmer_iterators.hpp"
+#include "iterators/transform_iterator.hpp"
+#include "iterators/filter_iterator.hpp"
+#include "utils/file_utils.hpp"
+
+
+// random protein with some lower case, ambiguity codes, stops, gaps and EOLs.
+std::string make_aa_input(size_t len) {
+  static const char chars[] = "ACDEFGHIKLMNPQRSTVWYACDEFGHIKLMNPQRSTVWYacdefghiklmnpqrstvwyBZJXUO*-\n";
+  std::string input(len, 'A');
+  for (size_t i = 0; i < len; ++i) {
+    input[i] = chars[rand() % (sizeof(chars) - 1)];
+  }
+  return input;
+}
+
+// random DNA with some lower case, N and EOLs.
+std::string make_nt_input(size_t len) {
+  static const char chars[] = "ACGTACGTACGTACGTacgtN\n";
+  std::string input(len, 'A');
+  for (size_t i = 0; i < len; ++i) {
+    input[i] = chars[rand() % (sizeof(chars) - 1)];
+  }
+  return input;
+}
+
+template <typename Alphabet, typename Encoder>
+void check_encoder(std::string const & input) {
+  std::vector<uint8_t> gold;
+  for (size_t i = 0; i < input.size(); ++i) {
+    if ((input[i] != '\n') && (input[i] != '\r'))
+      gold.push_back(Alphabet::FROM_ASCII[static_cast<unsigned char>(input[i])]);
+  }
+
+  std::vector<uint8_t> out(input.size());
+  Encoder encode;
+  size_t n = encode(reinterpret_cast<unsigned char const *>(input.data()), input.size(), out.data());
+  out.resize(n);
+
+  ASSERT_EQ(gold.size(), out.size());
+  EXPECT_TRUE(std::equal(gold.begin(), gold.end(), out.begin()));
+}
+
+template <typename Alphabet>
+void check_encoders(std::string const & input) {
+  check_encoder<Alphabet, bliss::common::aa_encoder<Alphabet, bliss::utils::bit_ops::BIT_REV_SEQ> >(input);
+  check_encoder<Alphabet, bliss::common::AAEncoder<Alphabet> >(input);
+#if defined(__SSSE3__)
+  check_encoder<Alphabet, bliss::common::aa_encoder<Alphabet, bliss::utils::bit_ops::BIT_REV_SSSE3> >(input);
+#endif
+}
+
+template <typename KmerType>
+void check_kmer_generator(std::string const & input) {
+  using Alphabet = typename KmerType::KmerAlphabet;
+  using BaseIterator = std::string::const_iterator;
+  using CharIter = bliss::iterator::filter_iterator<bliss::utils::file::NotEOL, BaseIterator>;
+  using BaseCharIterator = bliss::iterator::transform_iterator<CharIter, bliss::common::ASCII2<Alphabet> >;
+  using KmerIterator = bliss::common::KmerGenerationIterator<BaseCharIterator, KmerType>;
+
+  // gold from iterators.  need at least k valid characters.
+  std::vector<KmerType> gold;
+  size_t valid = 0;
+  for (size_t i = 0; i < input.size(); ++i) {
+    if ((input[i] != '\n') && (input[i] != '\r')) ++valid;
+  }
+  if (valid >= KmerType::size) {
+    bliss::utils::file::NotEOL neol;
+    KmerIterator start(BaseCharIterator(CharIter(neol, input.cbegin(), input.cend()), bliss::common::ASCII2<Alphabet>()), true);
+    KmerIterator end(BaseCharIterator(CharIter(neol, input.cend()), bliss::common::ASCII2<Alphabet>()), false);
+    gold.assign(start, end);
+  }
+
+  std::vector<KmerType> out;
+  bliss::common::AAKmerGenerator<KmerType> gen;
+  unsigned char const * b = reinterpret_cast<unsigned char const *>(input.data());
+  gen(b, b + input.size(), std::back_inserter(out));
+
+  ASSERT_EQ(gold.size(), out.size());
+  for (size_t i = 0; i < gold.size(); ++i) {
+    EXPECT_EQ(gold[i], out[i]) << " at " << i;
+  }
+}
+
+// standard genetic code, from the usual TCAG ordered table.
+char translate_codon(std::string const & codon) {
+  static const std::string bases("TCAG");
+  static const std::string aas("FFLLSSSSYY**CC*WLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG");
+  size_t idx = 0;
+  for (char c : codon) {
+    c = static_cast<char>(toupper(c));
+    if (c == 'U') c = 'T';
+    size_t p = bases.find(c);
+    if (p == std::string::npos) return 'X';
+    idx = idx * 4 + p;
+  }
+  return aas[idx];
+}
+
+template <typename KmerType>
+KmerType translate_kmer(std::string const & nts) {
+  KmerType km(true);
+  for (size_t i = 0; i + 3 <= nts.size(); i += 3) {
+    km.nextFromChar(KmerType::KmerAlphabet::FROM_ASCII[static_cast<unsigned char>(translate_codon(nts.substr(i, 3)))]);
+  }
+  return km;
+}
+
+std::string reverse_complement(std::string const & nts) {
+  std::string rc(nts.rbegin(), nts.rend());
+  for (auto & c : rc) {
+    switch (toupper(c)) {
+      case 'A': c = 'T'; break;
+      case 'C': c = 'G'; break;
+      case 'G': c = 'C'; break;
+      case 'T': c = 'A'; break;
+      default: c = 'N'; break;
+    }
+  }
+  return rc;
+}
+
+template <typename KmerType>
+void check_translation(std::string const & input) {
+  std::string nts;
+  for (char c : input) if ((c != '\n') && (c != '\r')) nts.push_back(c);
+
+  // gold:  translation of every 3k window, forward then reverse complement.
+  constexpr size_t w = 3 * KmerType::size;
+  std::vector<KmerType> fwd, rev;
+  for (size_t i = 0; i + w <= nts.size(); ++i) {
+    fwd.push_back(translate_kmer<KmerType>(nts.substr(i, w)));
+    rev.push_back(translate_kmer<KmerType>(reverse_complement(nts.substr(i, w))));
+  }
+
+  std::vector<KmerType> out;
+  bliss::common::TranslatedKmerGenerator<KmerType> gen;
+  unsigned char const * b = reinterpret_cast<unsigned char const *>(input.data());
+  gen(b, b + input.size(), std::back_inserter(out));
+
+  ASSERT_EQ(fwd.size() + rev.size(), out.size());
+  if (out.size() == 0) return;
+
+  // forward frames first, frame +1 starts at position 0.
+  EXPECT_EQ(fwd[0], out[0]);
+  std::vector<KmerType> out_fwd(out.begin(), out.begin() + fwd.size());
+  std::vector<KmerType> out_rev(out.begin() + fwd.size(), out.end());
+  std::sort(fwd.begin(), fwd.end());
+  std::sort(rev.begin(), rev.end());
+  std::sort(out_fwd.begin(), out_fwd.end());
+  std::sort(out_rev.begin(), out_rev.end());
+  EXPECT_TRUE(std::equal(fwd.begin(), fwd.end(), out_fwd.begin()));
+  EXPECT_TRUE(std::equal(rev.begin(), rev.end(), out_rev.begin()));
+}
+
+
+TEST(AAAlphabet, Tables)
+{
+  using AA = bliss::common::AA;
+  // round trip, and case insensitive.
+  for (size_t i = 0; i < AA::SIZE; ++i) {
+    char c = AA::TO_ASCII[i];
+    EXPECT_EQ(i, AA::FROM_ASCII[static_cast<unsigned char>(c)]);
+    EXPECT_EQ(i, AA::FROM_ASCII[static_cast<unsigned char>(tolower(c))]);
+  }
+  EXPECT_EQ(AA::FROM_ASCII['X'], AA::FROM_ASCII['#']);
+  EXPECT_EQ(AA::FROM_ASCII['-'], AA::FROM_ASCII['.']);
+
+  // reduced alphabets:  groups share a value, and each value decodes to a member of its group.
+  using M10 = bliss::common::AA_MURPHY10;
+  EXPECT_EQ(M10::FROM_ASCII['L'], M10::FROM_ASCII['i']);
+  EXPECT_EQ(M10::FROM_ASCII['E'], M10::FROM_ASCII['B']);
+  EXPECT_NE(M10::FROM_ASCII['E'], M10::FROM_ASCII['K']);
+  for (size_t i = 0; i < M10::SIZE; ++i)
+    EXPECT_EQ(i, M10::FROM_ASCII[static_cast<unsigned char>(M10::TO_ASCII[i])]);
+  using M15 = bliss::common::AA_MURPHY15;
+  EXPECT_EQ(M15::FROM_ASCII['F'], M15::FROM_ASCII['Y']);
+  EXPECT_NE(M15::FROM_ASCII['E'], M15::FROM_ASCII['D']);
+  for (size_t i = 0; i < M15::SIZE; ++i)
+    EXPECT_EQ(i, M15::FROM_ASCII[static_cast<unsigned char>(M15::TO_ASCII[i])]);
+
+  // 12 residues per 64 bit word.
+  EXPECT_EQ(5U, static_cast<unsigned int>(bliss::common::Kmer<12, AA, uint64_t>::bitsPerChar));
+  EXPECT_EQ(1U, static_cast<unsigned int>(bliss::common::Kmer<12, AA, uint64_t>::nWords));
+  EXPECT_EQ(2U, static_cast<unsigned int>(bliss::common::Kmer<13, AA, uint64_t>::nWords));
+  EXPECT_EQ(4U, static_cast<unsigned int>(bliss::common::Kmer<16, M10, uint64_t>::bitsPerChar));
+  EXPECT_EQ(1U, static_cast<unsigned int>(bliss::common::Kmer<16, M10, uint64_t>::nWords));
+}
+
+TEST(AAEncoder, AllChars)
+{
+  std::string input(256, 0);
+  for (int i = 0; i < 256; ++i) input[i] = static_cast<char>(i);
+
+  check_encoders<bliss::common::AA>(input);
+  check_encoders<bliss::common::AA_MURPHY10>(input);
+  check_encoders<bliss::common::AA_MURPHY15>(input);
+}
+
+TEST(AAEncoder, Random)
+{
+  srand(23);
+  for (size_t len : {0, 1, 15, 16, 17, 31, 32, 33, 100, 1000, 4099}) {
+    std::string input = make_aa_input(len);
+    check_encoders<bliss::common::AA>(input);
+    check_encoders<bliss::common::AA_MURPHY10>(input);
+
+    // letters only, for the SIMD path.
+    input.erase(std::remove_if(input.begin(), input.end(), [](char c) { return !isalpha(c); }), input.end());
+    check_encoders<bliss::common::AA>(input);
+    check_encoders<bliss::common::AA_MURPHY15>(input);
+  }
+}
+
+TEST(AAKmerGenerator, Random)
+{
+  srand(23);
+  for (size_t len : {0, 10, 12, 13, 100, 1023, 1024, 1025, 5000}) {
+    std::string input = make_aa_input(len);
+    check_kmer_generator<bliss::common::Kmer<12, bliss::common::AA, uint64_t> >(input);
+    check_kmer_generator<bliss::common::Kmer<7, bliss::common::AA, uint64_t> >(input);
+    check_kmer_generator<bliss::common::Kmer<20, bliss::common::AA, uint64_t> >(input);
+    check_kmer_generator<bliss::common::Kmer<16, bliss::common::AA_MURPHY10, uint64_t> >(input);
+  }
+}
+
+TEST(TranslatedKmerGenerator, Random)
+{
+  srand(23);
+  for (size_t len : {0, 10, 35, 36, 37, 38, 39, 100, 1000}) {
+    std::string input = make_nt_input(len);
+    check_translation<bliss::common::Kmer<12, bliss::common::AA, uint64_t> >(input);
+    check_translation<bliss::common::Kmer<5, bliss::common::AA, uint64_t> >(input);
+    check_translation<bliss::common::Kmer<1, bliss::common::AA, uint8_t> >(input);
+    check_translation<bliss::common::Kmer<16, bliss::common::AA_MURPHY10, uint64_t> >(input);
+  }
+}
@@ -0,0 +1,346 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    compressed_multimap.hpp
+ * @ingroup containers
+ * @author  tpan
+ * @brief   build-once multimap that stores each frequent key once, with its sorted values Elias-Fano encoded.
+ * @details position indices store one std::pair<Kmer, ShortSequenceKmerId> per occurrence, so a k-mer that occurs
+ *          10^5 times in a repeat is stored 10^5 times.  here, a key with at least min_run values is a posting list:
+ *
+ *      header  key, first value, bit offset, value count, low bit width.  sorted by key.
+ *      lists   one bit array for all lists.  a list of n values in [first, last] with u = last - first + 1 has
+ *              l = floor(log2(u / n)) low bits per value, packed, followed by the high parts in unary,
+ *              n + (u >> l) + 1 bits.  at most 2 + log2(u / n) bits per value.
+ *
+ *          keys with fewer values stay as plain pairs in an unordered_grouped_multimap, where a header would cost more.
+ *
+ *          values are mapped to uint64_t with posting_codec:  integral types directly, and sequence ids such as
+ *          ShortSequenceKmerId through their id field, whose order is file position order.  find returns values in
+ *          that order, not insertion order.
+ *
+ *          decoding reads the low bits 64 bits at a time, and the high parts a word at a time with count trailing zeros.
+ *
+ *          inserted entries are staged, and the map is rebuilt on the next query, as in unordered_grouped_multimap.
+ */
+#ifndef SRC_CONTAINERS_COMPRESSED_MULTIMAP_HPP_
+#define SRC_CONTAINERS_COMPRESSED_MULTIMAP_HPP_
+
+#include <vector>
+#include <functional>  // hash, equal_to, less
+#include <utility>     // pair
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+#include "containers/unordered_grouped_multimap.hpp"
+#include "utils/logging.h"
+
+namespace fsc {  // fast standard container
+
+  /// order preserving map of a value to uint64_t, for Elias-Fano encoding.
+  template <typename T, typename Enable = void>
+  struct posting_codec;
+
+  template <typename T>
+  struct posting_codec<T, typename ::std::enable_if<::std::is_integral<T>::value>::type> {
+      static inline uint64_t encode(T const & v) { return static_cast<uint64_t>(v); }
+      static inline T decode(uint64_t const & v) { return static_cast<T>(v); }
+  };
+
+  /// sequence ids (ShortSequenceKmerId, LongSequenceKmerId):  the packed id field.
+  template <typename T>
+  struct posting_codec<T, typename ::std::enable_if<::std::is_integral<decltype(::std::declval<T>().id)>::value>::type> {
+      static inline uint64_t encode(T const & v) { return static_cast<uint64_t>(v.id); }
+      static inline T decode(uint64_t const & v) {
+        T t;
+        t.id = v;
+        return t;
+      }
+  };
+
+
+  /**
+   * @brief  multimap with Elias-Fano compressed values for frequent keys.  see file comment.
+   * @details  interface follows unordered_grouped_multimap where the semantic allows.  find appends (key, value) pairs
+   *           to an output iterator instead of returning a range, since values are decoded.
+   * @tparam Less  orders keys, for the posting list headers.
+   */
+  template <typename Key,
+  typename T,
+  typename Hash = ::std::hash<Key>,
+  typename Less = ::std::less<Key>,
+  typename Equal = ::std::equal_to<Key>
+  >
+  class compressed_multimap {
+
+    protected:
+      using entry_type = ::std::pair<Key, T>;
+      using codec = posting_codec<T>;
+
+      struct header {
+          Key key;
+          uint64_t first;
+          /// bit offset of the list in bits.
+          uint64_t offset;
+          uint32_t count;
+          uint8_t low_bits;
+      };
+
+      /// keys with fewer values are kept as pairs.
+      size_t min_run;
+
+      mutable ::std::vector<header> headers;
+      mutable ::std::vector<uint64_t> bits;
+      /// end of the used bits.
+      mutable size_t bits_end;
+      mutable ::fsc::unordered_grouped_multimap<Key, T, Hash, Equal> small;
+      mutable ::std::vector<entry_type> staged;
+      /// number of values in posting lists.
+      mutable size_t n_listed;
+
+      Less lt;
+      Equal eq;
+
+      static inline void put_bits(::std::vector<uint64_t> & words, size_t const & pos, uint64_t const & v, unsigned int const & w) {
+        if (w == 0) return;
+        size_t i = pos >> 6;
+        unsigned int o = pos & 63;
+        words[i] |= v << o;
+        if ((o + w) > 64) words[i + 1] |= v >> (64 - o);
+      }
+
+      static inline uint64_t get_bits(uint64_t const * words, size_t const & pos, unsigned int const & w) {
+        if (w == 0) return 0;
+        size_t i = pos >> 6;
+        unsigned int o = pos & 63;
+        uint64_t x = words[i] >> o;
+        if ((o + w) > 64) x |= words[i + 1] << (64 - o);
+        return (w >= 64) ? x : (x & ((1ULL << w) - 1));
+      }
+
+      static inline unsigned int floor_log2(uint64_t const & v) {
+        return 63 - __builtin_clzll(v);
+      }
+
+      /// bits of a list of n values with range u and l low bits.
+      static inline size_t list_bits(size_t const & n, uint64_t const & u, unsigned int const & l) {
+        return n * l + n + (u >> l) + 1;
+      }
+
+      /// append the encoded values [first, last) of one key to bits.
+      template <typename It>
+      void encode(It first, It last) const {
+        size_t n = ::std::distance(first, last);
+        uint64_t lo = codec::encode(first->second);
+        uint64_t u = codec::encode((last - 1)->second) - lo + 1;
+        unsigned int l = (u > n) ? floor_log2(u / n) : 0;
+
+        header h;
+        h.key = first->first;
+        h.first = lo;
+        h.offset = bits_end;
+        h.count = n;
+        h.low_bits = l;
+
+        bits_end += list_bits(n, u, l);
+        bits.resize((bits_end + 63) / 64 + 1, 0);
+
+        size_t low_pos = h.offset;
+        size_t high_pos = h.offset + n * l;
+        size_t i = 0;
+        for (It it = first; it != last; ++it, ++i) {
+          uint64_t v = codec::encode(it->second) - lo;
+          put_bits(bits, low_pos + i * l, (l == 0) ? 0 : (v & ((1ULL << l) - 1)), l);
+          size_t p = high_pos + (v >> l) + i;
+          bits[p >> 6] |= 1ULL << (p & 63);
+        }
+        headers.emplace_back(h);
+      }
+
+      /// merge staged entries with the current content and rebuild.
+      void build_lists() const {
+        // decode the current lists back into staged.
+        for (auto const & h : headers) decode(h, ::std::back_inserter(staged));
+        staged.insert(staged.end(), small.cbegin(), small.cend());
+        headers.clear();
+        ::std::vector<uint64_t>().swap(bits);
+        bits_end = 0;
+        n_listed = 0;
+        small.clear();
+
+        ::std::sort(staged.begin(), staged.end(), [this](entry_type const & x, entry_type const & y) {
+          return lt(x.first, y.first) || (!lt(y.first, x.first) && (codec::encode(x.second) < codec::encode(y.second)));
+        });
+
+        ::std::vector<entry_type> rest;
+        auto start = staged.begin();
+        while (start != staged.end()) {
+          auto end = start + 1;
+          while ((end != staged.end()) && eq(end->first, start->first)) ++end;
+          size_t n = ::std::distance(start, end);
+          if (n >= min_run) {
+            encode(start, end);
+            n_listed += n;
+          } else {
+            rest.insert(rest.end(), start, end);
+          }
+          start = end;
+        }
+        bits.shrink_to_fit();
+        small.insert(rest.begin(), rest.end());
+        small.build();
+
+        ::std::vector<entry_type>().swap(staged);
+      }
+
+      inline void ensure_built() const {
+        if (!staged.empty()) build_lists();
+      }
+
+      /// append the values of a list, in order.
+      template <typename OutputIt>
+      OutputIt decode(header const & h, OutputIt out) const {
+        uint64_t const * words = bits.data();
+        unsigned int l = h.low_bits;
+        size_t low_pos = h.offset;
+        size_t high_pos = h.offset + static_cast<size_t>(h.count) * l;
+
+        size_t i = 0;
+        size_t w = high_pos >> 6;
+        // ones before high_pos in the first word are not part of this list.
+        uint64_t word = words[w] & (~(0ULL) << (high_pos & 63));
+        while (i < h.count) {
+          while (word == 0) word = words[++w];
+          size_t p = (w << 6) + __builtin_ctzll(word) - high_pos;
+          word &= word - 1;
+
+          uint64_t v = h.first + (((p - i) << l) | get_bits(words, low_pos + i * l, l));
+          *out = entry_type(h.key, codec::decode(v));
+          ++out;
+          ++i;
+        }
+        return out;
+      }
+
+      /// header of key, or nullptr.
+      header const * find_header(Key const & key) const {
+        auto it = ::std::lower_bound(headers.begin(), headers.end(), key, [this](header const & h, Key const & k) {
+          return lt(h.key, k);
+        });
+        return ((it != headers.end()) && eq(it->key, key)) ? &(*it) : nullptr;
+      }
+
+    public:
+      using key_type              = Key;
+      using mapped_type           = T;
+      using value_type            = entry_type;
+      using size_type             = size_t;
+
+      /// keys with at least _min_run values are posting lists.
+      compressed_multimap(size_t const & _min_run = 8) :
+        min_run(::std::max(_min_run, static_cast<size_t>(1))), bits_end(0), n_listed(0) {}
+
+      template<class InputIt, typename = typename ::std::enable_if<!::std::is_integral<InputIt>::value>::type>
+      compressed_multimap(InputIt first, InputIt last, size_t const & _min_run = 8) :
+        compressed_multimap(_min_run) {
+        this->insert(first, last);
+      }
+
+      /// build now.  otherwise the map is built on the first query after insertion.
+      void build() const {
+        ensure_built();
+      }
+
+      template <class InputIt>
+      void insert(InputIt first, InputIt last) {
+        staged.insert(staged.end(), first, last);
+      }
+
+      void insert(entry_type const & value) {
+        staged.emplace_back(value);
+      }
+
+      bool empty() const {
+        return size() == 0;
+      }
+
+      size_type size() const {
+        return n_listed + small.size() + staged.size();
+      }
+
+      size_type unique_size() const {
+        ensure_built();
+        return headers.size() + small.unique_size();
+      }
+
+      void clear() {
+        headers.clear();
+        ::std::vector<uint64_t>().swap(bits);
+        bits_end = 0;
+        n_listed = 0;
+        small.clear();
+        staged.clear();
+      }
+
+      size_type count(Key const & key) const {
+        ensure_built();
+        header const * h = find_header(key);
+        return (h == nullptr) ? small.count(key) : h->count;
+      }
+
+      /// append the (key, value) entries of key to out, in value order.
+      template <typename OutputIt>
+      OutputIt find(Key const & key, OutputIt out) const {
+        ensure_built();
+        header const * h = find_header(key);
+        if (h != nullptr) return decode(*h, out);
+
+        auto range = small.equal_range(key);
+        return ::std::copy(range.first, range.second, out);
+      }
+
+      /// all entries, keys grouped.
+      void to_vector(::std::vector<entry_type> & result) const {
+        ensure_built();
+        result.clear();
+        result.reserve(size());
+        for (auto const & h : headers) decode(h, ::std::back_inserter(result));
+        result.insert(result.end(), small.cbegin(), small.cend());
+      }
+
+      /// bytes of the posting lists, headers included.
+      size_t list_bytes() const {
+        ensure_built();
+        return bits.size() * sizeof(uint64_t) + headers.size() * sizeof(header);
+      }
+
+      /// bytes used, excluding staged entries and the small key index.
+      size_t bytes() const {
+        return list_bytes() + small.size() * sizeof(entry_type);
+      }
+
+      void report() const {
+        ensure_built();
+        BL_INFOF("compressed multimap posting lists: %lu keys, %lu values, %lu bytes\n", headers.size(), n_listed, list_bytes());
+        small.report();
+      }
+  };
+
+} // end namespace fsc.
+
+#endif /* SRC_CONTAINERS_COMPRESSED_MULTIMAP_HPP_ */
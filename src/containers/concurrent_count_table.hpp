@@ -0,0 +1,253 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    concurrent_count_table.hpp
+ * @ingroup fsc::containers
+ * @author  tpan
+ * @brief   fixed capacity open addressing table of (key, count), incremented by many threads at once without locks.
+ * @details each slot has a state byte, the key, and an atomic count.  a thread adding a new key claims the first empty
+ *          slot on the key's linear probe path by CAS of the state from empty to busy, writes the key, and publishes it
+ *          by storing full.  a thread adding an existing key waits out a busy slot, compares keys, and fetch_adds the
+ *          count.  slots are never freed, so a key occupies exactly one slot.  k-mers can be wider than a machine
+ *          word, so the CAS is on the state byte rather than on the key.
+ *
+ *          the capacity is fixed at reserve(), e.g. from a HyperLogLog estimate, since the table cannot grow while
+ *          threads use it.  once the distinct keys reach max_load of the capacity, new keys are refused (add returns
+ *          false) and the caller counts them in a serial fallback, e.g. ::fsc::densehash_map.  a key refused by one
+ *          thread may be added concurrently by another, so refused keys must be merged with the table's entries by key.
+ *
+ *          a slot is the key, then the count, then the state byte, so that the state byte fits in the padding that
+ *          a count narrower than the key leaves.
+ *
+ *          contention is per slot:  threads only collide on the counts of the same key, and on the slot count when
+ *          adding new keys.  with OpenMP, see ::fsc::parallel_count.
+ */
+#ifndef SRC_CONTAINERS_CONCURRENT_COUNT_TABLE_HPP_
+#define SRC_CONTAINERS_CONCURRENT_COUNT_TABLE_HPP_
+
+#include <algorithm>  // min
+#include <atomic>
+#include <cstdint>
+#include <memory>      // unique_ptr
+#include <type_traits>
+#include <utility>     // pair
+#include <vector>
+
+#if defined(USE_OPENMP)
+#include <omp.h>
+#endif
+
+#include "containers/fsc_container_utils.hpp"
+#include "utils/filter_utils.hpp"
+#include "utils/sketch_utils.hpp"
+
+namespace fsc {  // fast standard container
+
+/**
+ * @brief  lock-free insert-or-increment counting table.  see file description.
+ * @tparam Hash   64 bit hash of a key.  the low bits index the table.
+ * @tparam Equal  key equality, consistent with Hash.
+ */
+template <typename Key, typename T, typename Hash, typename Equal>
+class concurrent_count_table {
+    static_assert(::std::is_integral<T>::value, "count type has to be integral");
+
+  protected:
+    enum : uint8_t { EMPTY = 0, BUSY = 1, FULL = 2 };
+
+    /// the state byte last, in the padding after the count:  16 bytes instead of 24 for a 64 bit key and 32 bit count.
+    struct slot {
+        Key key;
+        ::std::atomic<T> count;
+        ::std::atomic<uint8_t> state;
+    };
+
+    ::std::unique_ptr<slot[]> slots;
+    size_t mask;
+    /// distinct keys are refused once used reaches this.
+    size_t limit;
+    ::std::atomic<size_t> used;
+
+    double max_load;
+    Hash hash;
+    Equal eq;
+
+  public:
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = ::std::pair<Key, T>;
+
+    /// @param expected  distinct keys to hold without refusal.  see reserve.
+    explicit concurrent_count_table(size_t expected = 0, double _max_load = 0.5) :
+      mask(0), limit(0), used(0), max_load(_max_load) {
+      this->reserve(expected);
+    }
+
+    concurrent_count_table(concurrent_count_table const & other) = delete;
+    concurrent_count_table & operator=(concurrent_count_table const & other) = delete;
+
+    /// empty the table, sized for expected distinct keys at max_load.  not thread safe.
+    void reserve(size_t expected) {
+      size_t n = 16;
+      while (static_cast<double>(n) * max_load < static_cast<double>(expected)) n <<= 1;
+
+      slots.reset(new slot[n]);
+      // first touch by the threads that will use the table.
+      slot * ss = slots.get();
+      ::fsc::detail::for_each_part(n, ::fsc::detail::scan_threads(n), [ss](size_t first, size_t last, int) {
+        for (size_t i = first; i < last; ++i) {
+          ss[i].state.store(EMPTY, ::std::memory_order_relaxed);
+          ss[i].count.store(0, ::std::memory_order_relaxed);
+        }
+      });
+      mask = n - 1;
+      limit = static_cast<size_t>(static_cast<double>(n) * max_load);
+      used.store(0, ::std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief  add c to the count of key, inserting key if new.  thread safe.
+     * @return  false if key is new and the table is at max_load.  key is then not counted.
+     */
+    bool add(Key const & key, T const & c) {
+      size_t i = hash(key) & mask;
+      for (size_t p = 0; p <= mask; ++p, i = (i + 1) & mask) {
+        slot & s = slots[i];
+        uint8_t st = s.state.load(::std::memory_order_acquire);
+        if (st == EMPTY) {
+          if (used.load(::std::memory_order_relaxed) >= limit) return false;
+          if (s.state.compare_exchange_strong(st, BUSY, ::std::memory_order_acq_rel, ::std::memory_order_acquire)) {
+            s.key = key;
+            s.count.store(c, ::std::memory_order_relaxed);
+            s.state.store(FULL, ::std::memory_order_release);
+            used.fetch_add(1, ::std::memory_order_relaxed);
+            return true;
+          }
+          // lost the slot to another thread.  st is now BUSY or FULL.
+        }
+        while (st == BUSY) st = s.state.load(::std::memory_order_acquire);
+        if (eq(s.key, key)) {
+          s.count.fetch_add(c, ::std::memory_order_relaxed);
+          return true;
+        }
+      }
+      return false;
+    }
+
+    /// number of distinct keys.  exact once no thread is adding.
+    size_t size() const {
+      return used.load(::std::memory_order_relaxed);
+    }
+    size_t capacity() const {
+      return mask + 1;
+    }
+    /// bytes per slot, so memory use is capacity() * slot_bytes().
+    static constexpr size_t slot_bytes() {
+      return sizeof(slot);
+    }
+
+    /// op(key, count) on each entry.  not concurrent with add.
+    template <typename Op>
+    void visit(Op & op) const {
+      for (size_t i = 0; i <= mask; ++i) {
+        if (slots[i].state.load(::std::memory_order_acquire) == FULL)
+          op(slots[i].key, slots[i].count.load(::std::memory_order_relaxed));
+      }
+    }
+
+    /// append the entries to output.  not concurrent with add.
+    void to_vector(::std::vector<value_type> & output) const {
+      output.reserve(output.size() + this->size());
+      auto op = [&output](Key const & k, T const & c) { output.emplace_back(k, c); };
+      this->visit(op);
+    }
+};
+
+
+/**
+ * @brief  count the keys in input for which pred((key, 1)) holds, into (key, count) pairs, using all OpenMP threads.
+ * @details  2 parallel passes.  the first estimates the distinct keys with per-thread HyperLogLog sketches of
+ *           hash(key), merged by max, and sizes a concurrent_count_table from the estimate plus 3 standard errors.
+ *           the second adds the keys to the table.  keys the table refuses (estimate too low) are collected per thread
+ *           and, with the table's entries, counted by fallback, a serial map with insert((key, count)) and to_vector, e.g. an
+ *           empty ::fsc::densehash_map.  output is overwritten, in no particular order.
+ * @return  false without USE_OPENMP or with 1 thread, and nothing is done:  the caller should count serially.
+ */
+template <typename Hash, typename Equal, typename Key, typename T, typename Predicate, typename Fallback>
+bool parallel_count(::std::vector<Key> const & input, Predicate const & pred, ::std::vector<::std::pair<Key, T> > & output,
+                    Fallback & fallback) {
+#if defined(USE_OPENMP)
+  int nthreads = omp_get_max_threads();
+  if (nthreads < 2) return false;
+
+  bool filter = !::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value;
+  Hash hash;
+  size_t n = input.size();
+
+  // sizing pass.
+  ::std::vector<::bliss::utils::sketch::hyperloglog<> > sketches(nthreads);
+  ::fsc::detail::for_each_part(n, nthreads, [&](size_t first, size_t last, int tid) {
+    auto & hll = sketches[tid];
+    ::std::pair<Key, T> v(Key(), T(1));
+    for (size_t i = first; i < last; ++i) {
+      v.first = input[i];
+      if (filter && !pred(v)) continue;
+      hll.update(hash(input[i]));
+    }
+  });
+  for (int t = 1; t < nthreads; ++t) sketches[0].merge(sketches[t]);
+  double est = sketches[0].estimate() * (1.0 + 3.0 * sketches[0].error());
+
+  // counting pass.
+  concurrent_count_table<Key, T, Hash, Equal> table(::std::min(n, static_cast<size_t>(est) + 1));
+  ::std::vector<::std::vector<Key> > refused(nthreads);
+  ::fsc::detail::for_each_part(n, nthreads, [&](size_t first, size_t last, int tid) {
+    ::std::pair<Key, T> v(Key(), T(1));
+    for (size_t i = first; i < last; ++i) {
+      v.first = input[i];
+      if (filter && !pred(v)) continue;
+      if (!table.add(input[i], T(1))) refused[tid].emplace_back(input[i]);
+    }
+  });
+
+  output.clear();
+  table.to_vector(output);
+
+  size_t nrefused = 0;
+  for (auto const & r : refused) nrefused += r.size();
+  if (nrefused == 0) return true;
+
+  // fallback:  merge refused keys with the table's entries by key.
+  for (auto const & x : output) fallback.insert(x);
+  for (auto const & r : refused) {
+    for (auto const & k : r) {
+      auto result = fallback.insert(::std::make_pair(k, T(1)));
+      if (!result.second) result.first->second += T(1);
+    }
+  }
+  output.clear();
+  fallback.to_vector(output);
+  return true;
+#else
+  (void)input; (void)pred; (void)output; (void)fallback;
+  return false;
+#endif
+}
+
+}  // namespace fsc
+
+#endif // SRC_CONTAINERS_CONCURRENT_COUNT_TABLE_HPP_
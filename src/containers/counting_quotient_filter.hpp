@@ -0,0 +1,450 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    counting_quotient_filter.hpp
+ * @ingroup containers
+ * @author  tpan
+ * @brief   approximate count store:  a counting quotient filter over key fingerprints.
+ * @details a key is reduced to an f bit fingerprint, the top bits of its mixed hash.  the high q bits of the fingerprint
+ *          (the quotient) select a slot, and the low r = f - q bits (the remainder) are stored, with a c bit counter,
+ *          in a packed array of 2^q slots.  the remainders of one quotient form a sorted run of adjacent slots, shifted
+ *          right by linear probing when their home slot is taken.  3 bits per slot (occupied, continuation, shifted)
+ *          recover each remainder's quotient, as in the quotient filter of Bender et al.
+ *
+ *          keys are not stored.  2 keys with the same fingerprint share a counter, so a count is never less than the
+ *          true count, and an absent key has a nonzero count with probability about load * 2^-r <= fp_rate.
+ *          fingerprints and counts are exact:  insert_fingerprint and count_fingerprint behave as a map.
+ *
+ *          counters saturate at 2^c - 1.  the full counts of the few saturated fingerprints are kept in a hash map.
+ *
+ *          a slot takes 3 + r + c bits.  for fp_rate 1/256 and 8 bit counters that is 19 bits, about 2.6 bytes per
+ *          distinct key at 0.9 load, instead of 16 or more for a hash table of k-mer counts.
+ *
+ *          the table grows by doubling when the load exceeds max_load.  the fingerprint length is fixed, so a
+ *          remainder bit becomes a quotient bit, and the false positive rate doubles.  reserve on an empty filter
+ *          instead sizes it for the requested fp_rate.
+ */
+#ifndef SRC_CONTAINERS_COUNTING_QUOTIENT_FILTER_HPP_
+#define SRC_CONTAINERS_COUNTING_QUOTIENT_FILTER_HPP_
+
+#include <vector>
+#include <unordered_map>
+#include <functional>  // hash
+#include <utility>     // pair
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace fsc {  // fast standard container
+
+  /**
+   * @brief  approximate counts of keys in a counting quotient filter.  see file comment.
+   * @details  not thread safe.  interface follows the local counting maps:  insert adds 1 per key, or the given counts
+   *           for (key, count) pairs, and count returns the (approximate) count, 0 for most absent keys.
+   * @tparam Hash  hash of the key.  mixed before use, so the identity or a hash that also distributes keys is fine.
+   */
+  template <typename Key,
+  typename T,
+  typename Hash = ::std::hash<Key>
+  >
+  class counting_quotient_filter {
+      static_assert(::std::is_integral<T>::value, "count type has to be integral");
+
+    public:
+      using key_type = Key;
+      using mapped_type = T;
+      using size_type = size_t;
+      using hasher = Hash;
+
+      /// fraction of the slots in use before the table grows.
+      static constexpr double max_load = 0.9;
+      /// smallest table, 2^min_quotient_bits slots.
+      static constexpr unsigned int min_quotient_bits = 6;
+
+    protected:
+      static constexpr uint64_t OCCUPIED = 1;      // a run for this slot's quotient exists (it may be shifted)
+      static constexpr uint64_t CONTINUATION = 2;  // not the first remainder of its run
+      static constexpr uint64_t SHIFTED = 4;       // not in its home slot
+      static constexpr unsigned int flag_bits = 3;
+
+      Hash hash;
+      double fp_rate;
+
+      unsigned int qbits;
+      unsigned int rbits;
+      unsigned int cbits;
+      unsigned int width;
+      size_t nslots;
+      uint64_t rmask;
+      uint64_t cmax;
+
+      /// nslots packed slots of width bits, and 1 word of padding for reads that span 2 words.
+      ::std::vector<uint64_t> slots;
+      /// number of distinct fingerprints, i.e. used slots.
+      size_t distinct;
+      /// full counts of the fingerprints whose counters are saturated.
+      ::std::unordered_map<uint64_t, uint64_t> overflow;
+
+      /// 64 bit finalizer of MurmurHash3.
+      static inline uint64_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+      }
+
+      static unsigned int bits_for(size_t n) {
+        unsigned int b = 0;
+        while ((static_cast<size_t>(1) << b) < n) ++b;
+        return b;
+      }
+
+      /// an empty table of 2^q slots with r bit remainders.
+      void layout(unsigned int q, unsigned int r) {
+        if ((r < 1) || (q + r > 64) || (flag_bits + r + cbits > 64))
+          throw ::std::length_error("counting_quotient_filter: fingerprints too short or slots too wide.");
+        qbits = q;
+        rbits = r;
+        width = flag_bits + rbits + cbits;
+        nslots = static_cast<size_t>(1) << qbits;
+        rmask = (static_cast<uint64_t>(1) << rbits) - 1;
+        ::std::vector<uint64_t> tmp((nslots * width + 63) / 64 + 1, 0);
+        slots.swap(tmp);
+        distinct = 0;
+        overflow.clear();
+      }
+
+      /// quotient and remainder bits for n distinct keys at the target fp_rate.
+      void layout_for(size_t n) {
+        unsigned int q = bits_for(static_cast<size_t>(::std::ceil(n / max_load)));
+        if (q < min_quotient_bits) q = min_quotient_bits;
+        unsigned int r = ::std::max(1, static_cast<int>(::std::ceil(-::std::log2(fp_rate))));
+        layout(q, r);
+      }
+
+      inline uint64_t get(size_t i) const {
+        size_t bit = i * width;
+        size_t w = bit >> 6;
+        unsigned int off = bit & 63;
+        uint64_t v = slots[w] >> off;
+        if (off + width > 64) v |= slots[w + 1] << (64 - off);
+        return (width == 64) ? v : (v & ((static_cast<uint64_t>(1) << width) - 1));
+      }
+      inline void set(size_t i, uint64_t v) {
+        size_t bit = i * width;
+        size_t w = bit >> 6;
+        unsigned int off = bit & 63;
+        uint64_t mask = (width == 64) ? ~static_cast<uint64_t>(0) : ((static_cast<uint64_t>(1) << width) - 1);
+        slots[w] = (slots[w] & ~(mask << off)) | (v << off);
+        if (off + width > 64) {
+          unsigned int hi = 64 - off;
+          slots[w + 1] = (slots[w + 1] & ~(mask >> hi)) | (v >> hi);
+        }
+      }
+
+      inline size_t incr(size_t i) const { return (i + 1) & (nslots - 1); }
+      inline size_t decr(size_t i) const { return (i - 1) & (nslots - 1); }
+
+      static inline bool is_empty(uint64_t v) { return (v & (OCCUPIED | CONTINUATION | SHIFTED)) == 0; }
+      inline uint64_t remainder_of(uint64_t v) const { return (v >> flag_bits) & rmask; }
+      inline uint64_t counter_of(uint64_t v) const { return v >> (flag_bits + rbits); }
+      inline uint64_t with_counter(uint64_t v, uint64_t c) const {
+        return (v & ((static_cast<uint64_t>(1) << (flag_bits + rbits)) - 1)) | (c << (flag_bits + rbits));
+      }
+
+      /// slot of the first remainder of quotient fq's run.  fq must be occupied.
+      size_t run_start(size_t fq) const {
+        // back to the start of the cluster, then forward 1 run per occupied quotient.
+        size_t b = fq;
+        while (get(b) & SHIFTED) b = decr(b);
+        size_t s = b;
+        while (b != fq) {
+          do { s = incr(s); } while (get(s) & CONTINUATION);
+          do { b = incr(b); } while (!(get(b) & OCCUPIED));
+        }
+        return s;
+      }
+
+      /// put entry in slot s, and shift the following slots up to the next empty one right by 1.
+      /// occupied bits belong to the slots and stay in place.
+      void shift_in(size_t s, uint64_t entry) {
+        uint64_t curr = entry;
+        while (true) {
+          uint64_t prev = get(s);
+          bool empty = is_empty(prev);
+          if (!empty) {
+            prev |= SHIFTED;
+            if (prev & OCCUPIED) {
+              curr |= OCCUPIED;
+              prev &= ~OCCUPIED;
+            }
+          }
+          set(s, curr);
+          if (empty) break;
+          curr = prev;
+          s = incr(s);
+        }
+      }
+
+      /// counter value for a new fingerprint with count w.
+      inline uint64_t store(uint64_t fp, uint64_t w) {
+        if (w < cmax) return w;
+        overflow[fp] = w;
+        return cmax;
+      }
+      /// counter value after adding w to counter c.
+      inline uint64_t bump(uint64_t fp, uint64_t c, uint64_t w) {
+        if (c == cmax) {
+          overflow[fp] += w;
+          return cmax;
+        }
+        return store(fp, c + w);
+      }
+      inline uint64_t total(uint64_t fp, uint64_t c) const {
+        if (c < cmax) return c;
+        auto it = overflow.find(fp);
+        return (it == overflow.end()) ? c : it->second;
+      }
+
+      /// double the table.  the fingerprints are reinserted in sorted order with 1 fewer remainder bit.
+      void grow() {
+        if (rbits <= 1) throw ::std::length_error("counting_quotient_filter: fingerprints too short to grow further.");
+        ::std::vector<::std::pair<uint64_t, uint64_t> > entries;
+        entries.reserve(distinct);
+        this->for_each([&entries](uint64_t fp, uint64_t c) { entries.emplace_back(fp, c); });
+        ::std::sort(entries.begin(), entries.end());
+        layout(qbits + 1, rbits - 1);
+        for (auto const & e : entries) add(e.first, e.second);
+      }
+
+      /// add w to the count of fingerprint fp.  the table has room for 1 more fingerprint.
+      void add(uint64_t fp, uint64_t w) {
+        size_t fq = fp >> rbits;
+        uint64_t fr = fp & rmask;
+        uint64_t t = get(fq);
+
+        if (is_empty(t)) {
+          set(fq, with_counter(OCCUPIED | (fr << flag_bits), store(fp, w)));
+          ++distinct;
+          return;
+        }
+
+        bool had_run = t & OCCUPIED;
+        if (!had_run) set(fq, t | OCCUPIED);
+
+        size_t start = run_start(fq);
+        size_t s = start;
+        uint64_t entry = fr << flag_bits;
+        if (had_run) {
+          // runs are sorted.  find fr, or the first larger remainder.
+          do {
+            uint64_t v = get(s);
+            uint64_t rem = remainder_of(v);
+            if (rem == fr) {
+              set(s, with_counter(v, bump(fp, counter_of(v), w)));
+              return;
+            }
+            if (rem > fr) break;
+            s = incr(s);
+          } while (get(s) & CONTINUATION);
+
+          // a new first remainder makes the old one a continuation.
+          if (s == start) set(start, get(start) | CONTINUATION);
+          else entry |= CONTINUATION;
+        }
+        if (s != fq) entry |= SHIFTED;
+        shift_in(s, with_counter(entry, store(fp, w)));
+        ++distinct;
+      }
+
+    public:
+      /**
+       * @param expected  distinct keys to size the table for.  it grows past that, at a higher fp rate.
+       * @param _fp_rate  largest false positive rate at full load.  sets the remainder bits to ceil(log2(1/fp_rate)).
+       * @param count_bits  bits of the per slot counter, 1 to 32.  counts that do not fit are kept aside.
+       */
+      counting_quotient_filter(size_t expected = 0, double _fp_rate = 1.0 / 256, unsigned int count_bits = 8,
+                               Hash const & _hash = Hash()) :
+        hash(_hash), fp_rate(_fp_rate), qbits(0), rbits(0), cbits(count_bits), width(0), nslots(0), rmask(0),
+        cmax(0), distinct(0) {
+        if ((fp_rate <= 0.0) || (fp_rate >= 1.0))
+          throw ::std::invalid_argument("counting_quotient_filter: fp_rate has to be in (0, 1).");
+        if ((cbits < 1) || (cbits > 32))
+          throw ::std::invalid_argument("counting_quotient_filter: count_bits has to be in [1, 32].");
+        cmax = (static_cast<uint64_t>(1) << cbits) - 1;
+        layout_for(expected);
+      }
+
+      /// fingerprint of a key.  the top quotient + remainder bits of its mixed hash.
+      inline uint64_t fingerprint(Key const & k) const {
+        uint64_t h = mix(static_cast<uint64_t>(hash(k)));
+        return h >> (64 - fingerprint_bits());
+      }
+
+      unsigned int fingerprint_bits() const { return qbits + rbits; }
+      unsigned int quotient_bits() const { return qbits; }
+      unsigned int remainder_bits() const { return rbits; }
+      unsigned int count_bits() const { return cbits; }
+      size_t capacity() const { return static_cast<size_t>(nslots * max_load); }
+
+      /// false positive rate at the current load, load * 2^-r.
+      double false_positive_rate() const {
+        return static_cast<double>(distinct) / nslots / static_cast<double>(static_cast<uint64_t>(1) << rbits);
+      }
+
+      /// number of distinct fingerprints.  at most the number of distinct keys.
+      size_t size() const { return distinct; }
+      bool empty() const { return distinct == 0; }
+
+      /// bytes of the slots and of the saturated counts.
+      size_t memory_bytes() const {
+        return slots.capacity() * sizeof(uint64_t) +
+            overflow.size() * (2 * sizeof(uint64_t) + sizeof(void*)) + overflow.bucket_count() * sizeof(void*);
+      }
+
+      /// removes all counts, and keeps the table.
+      void clear() {
+        ::std::fill(slots.begin(), slots.end(), 0);
+        distinct = 0;
+        overflow.clear();
+      }
+
+      /// room for n distinct fingerprints.  an empty filter is resized for fp_rate, a nonempty one grows.
+      void reserve(size_t n) {
+        if (n <= capacity()) return;
+        if (distinct == 0) {
+          layout_for(n);
+          return;
+        }
+        while (n > capacity()) grow();
+      }
+
+      /// add w to the count of fingerprint fp, fp < 2^fingerprint_bits().
+      void insert_fingerprint(uint64_t fp, uint64_t w = 1) {
+        if (w == 0) return;
+        // growth keeps the fingerprint length, so fp is still valid.
+        if (distinct + 1 > capacity()) grow();
+        add(fp, w);
+      }
+
+      /// count of fingerprint fp, 0 if absent.
+      uint64_t count_fingerprint(uint64_t fp) const {
+        size_t fq = fp >> rbits;
+        uint64_t fr = fp & rmask;
+        if (!(get(fq) & OCCUPIED)) return 0;
+        size_t s = run_start(fq);
+        do {
+          uint64_t v = get(s);
+          uint64_t rem = remainder_of(v);
+          if (rem == fr) return total(fp, counter_of(v));
+          if (rem > fr) return 0;
+          s = incr(s);
+        } while (get(s) & CONTINUATION);
+        return 0;
+      }
+
+      /**
+       * @brief add (fingerprint, count) pairs.  sorts them first, so equal fingerprints are added once and the table
+       *        is visited in order.
+       */
+      void insert_fingerprints(::std::vector<::std::pair<uint64_t, uint64_t> > & fps) {
+        ::std::sort(fps.begin(), fps.end());
+        for (size_t i = 0; i < fps.size(); ) {
+          uint64_t fp = fps[i].first;
+          uint64_t w = 0;
+          for (; (i < fps.size()) && (fps[i].first == fp); ++i) w += fps[i].second;
+          insert_fingerprint(fp, w);
+        }
+      }
+
+      /// count each key once.
+      template <typename Iter>
+      void insert(Iter first, Iter last) {
+        ::std::vector<::std::pair<uint64_t, uint64_t> > fps;
+        fps.reserve(::std::distance(first, last));
+        for (; first != last; ++first) fps.emplace_back(fingerprint(*first), 1);
+        insert_fingerprints(fps);
+      }
+
+      /// add the counts of (key, count) pairs.
+      template <typename V>
+      void insert(::std::vector<::std::pair<Key, V> > const & input) {
+        ::std::vector<::std::pair<uint64_t, uint64_t> > fps;
+        fps.reserve(input.size());
+        for (auto const & x : input) fps.emplace_back(fingerprint(x.first), static_cast<uint64_t>(x.second));
+        insert_fingerprints(fps);
+      }
+
+      void insert(::std::vector<Key> const & input) {
+        this->insert(input.begin(), input.end());
+      }
+
+      /// add the counts of another filter with the same fingerprint length, e.g. from another rank.
+      void merge(counting_quotient_filter const & other) {
+        if (other.fingerprint_bits() != fingerprint_bits())
+          throw ::std::invalid_argument("counting_quotient_filter: merge needs the same fingerprint length.");
+        ::std::vector<::std::pair<uint64_t, uint64_t> > fps;
+        fps.reserve(other.size());
+        other.for_each([&fps](uint64_t fp, uint64_t c) { fps.emplace_back(fp, c); });
+        insert_fingerprints(fps);
+      }
+
+      /// approximate count of k, at least its true count.  saturates at the largest T.
+      T count(Key const & k) const {
+        uint64_t c = count_fingerprint(fingerprint(k));
+        return (c > static_cast<uint64_t>(::std::numeric_limits<T>::max())) ? ::std::numeric_limits<T>::max() : static_cast<T>(c);
+      }
+
+      /// op(fingerprint, count) for every fingerprint, in slot order.
+      template <typename Op>
+      void for_each(Op op) const {
+        if (distinct == 0) return;
+
+        // start at a cluster start:  used and in its home slot.  the table is never full.
+        size_t s = 0;
+        for (uint64_t v = get(s); is_empty(v) || (v & SHIFTED); v = get(s)) s = incr(s);
+
+        size_t q = s;
+        for (size_t i = 0; i < nslots; ++i, s = incr(s)) {
+          uint64_t v = get(s);
+          if (is_empty(v)) continue;
+          if (!(v & SHIFTED)) q = s;
+          else if (!(v & CONTINUATION)) {
+            // a shifted run belongs to the next occupied quotient.
+            do { q = incr(q); } while (!(get(q) & OCCUPIED));
+          }
+          uint64_t fp = (static_cast<uint64_t>(q) << rbits) | remainder_of(v);
+          op(fp, total(fp, counter_of(v)));
+        }
+      }
+
+      /// sum of all counts.
+      uint64_t total_count() const {
+        uint64_t s = 0;
+        this->for_each([&s](uint64_t, uint64_t c) { s += c; });
+        return s;
+      }
+  };
+
+}  // namespace fsc
+
+#endif /* SRC_CONTAINERS_COUNTING_QUOTIENT_FILTER_HPP_ */
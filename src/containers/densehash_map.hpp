@@ -28,6 +28,7 @@
 #include <sparsehash/dense_hash_map>
 #include <vector>
 #include <functional>  // hash, equal_to, etc
+#include <initializer_list>
 #include <tuple>   // pair
 #include <scoped_allocator>
 #include <algorithm>
@@ -58,7 +59,7 @@ namespace sparsehash {
       Comparator<Key> comp;
       Transform<Key> trans;
 
-      mutable Key upper_bound;
+      Key upper_bound;
 
       bool operator()(Key const & x) const {
         return comp(trans(x), upper_bound); // lower is positive
@@ -76,8 +77,8 @@ namespace sparsehash {
       Comparator<Key> comp;
       Transform<Key> trans;
 
-      mutable Key empty;
-      mutable Key deleted;
+      Key empty;
+      Key deleted;
 
       //====  since dense hash table makes copies of equal operators left and right
       // we need these constructors and assignment operators.
@@ -144,8 +145,8 @@ namespace sparsehash {
   struct compare<Key, ::std::equal_to, Transform> {
       Transform<Key> trans;
 
-      mutable Key empty;
-      mutable Key deleted;
+      Key empty;
+      Key deleted;
 
       //====  since dense hash table makes copies of equal operators left and right
       // we need these constructors and assignment operators.
@@ -349,6 +350,145 @@ namespace sparsehash {
 	static constexpr bool need_to_split = false;
   };
 
+  /**
+   * @brief prefetch the home bucket of a key in a google dense_hash_map, for batched lookups.
+   * @details the home bucket is hash(key) & (bucket_count - 1), as in dense_hashtable::find_position.  the bucket array
+   *          is not exposed, but end() is an iterator whose public pos member is one past the last bucket.
+   *          an empty table has no bucket array.
+   */
+  template <typename Map, typename Key>
+  inline void prefetch_bucket(Map const & map, Key const & key) {
+    if (map.bucket_count() == 0) return;
+    typename Map::size_type b = map.hash_funct()(key) & (map.bucket_count() - 1);
+    __builtin_prefetch(&(*(map.end().pos - map.bucket_count() + b)), 0, 1);
+  }
+
+  /**
+   * @brief call op on each (key, value) pair in [first, last), with the bucket of the key dist entries ahead prefetched.
+   * @details for batched inserts.  each insert probes a random bucket, so keep dist bucket loads in flight.
+   *          an insert that grows the table makes the outstanding prefetches useless, but not wrong.
+   */
+  template <typename Container, typename InputIt, typename Op>
+  inline void prefetched_for_each(Container const & c, InputIt first, InputIt last, Op op, size_t dist = 16) {
+    InputIt pf = first;
+    for (size_t i = 0; (i < dist) && (pf != last); ++i, ++pf) {
+      c.prefetch((*pf).first);
+    }
+    for (auto it = first; it != last; ++it) {
+      if (pf != last) {
+        c.prefetch((*pf).first);
+        ++pf;
+      }
+      op(*it);
+    }
+  }
+
+  /// bytes of table per insert group of locality_order:  about a per-core L2 cache.
+  static constexpr size_t locality_group_bytes = 1UL << 20;
+  /// at most 2^locality_max_bits groups, so the group counts stay in L1.
+  static constexpr unsigned int locality_max_bits = 12;
+
+  /**
+   * @brief  log2 of the number of cache sized regions of a table that an insert of n entries should be grouped by.
+   * @details  0 if the table fits in a group, or if n is too small to give each region a few inserts, i.e. when the
+   *           extra pass over the input does not pay.
+   */
+  template <typename Map>
+  inline unsigned int locality_bits(Map const & map, size_t n) {
+    size_t table_bytes = map.bucket_count() * sizeof(typename Map::value_type);
+    unsigned int bits = 0;
+    while ((bits < locality_max_bits) && ((locality_group_bytes << (bits + 1)) <= table_bytes) &&
+           ((16UL << (bits + 1)) <= n)) ++bits;
+    return bits;
+  }
+
+  /**
+   * @brief  region of key's home bucket in map, out of 2^bits.  the top bits of the bucket index.
+   * @details  the home bucket is hash(key) & (bucket_count - 1), see prefetch_bucket.  probing stays near it.
+   *           a bucket count that is not a power of 2 (not a dense_hash_map) is split evenly instead.
+   */
+  template <typename Map, typename Key>
+  inline size_t bucket_region(Map const & map, Key const & key, unsigned int bits) {
+    if (bits == 0) return 0;
+    size_t n = map.bucket_count();
+    size_t h = map.hash_funct()(key);
+    if ((n & (n - 1)) == 0) return (h & (n - 1)) >> (__builtin_ctzll(n) - bits);
+    return ((h % n) << bits) / n;
+  }
+
+  /// key of an entry, or the key itself, for batches of keys.
+  template <typename Key, typename T>
+  inline Key const & entry_key(::std::pair<Key, T> const & x) {
+    return x.first;
+  }
+  template <typename Key>
+  inline Key const & entry_key(Key const & x) {
+    return x;
+  }
+
+  /**
+   * @brief  stable counting sort of [first, last) by group_of(element), in [0, ngroups).
+   * @details  for locality_order:  entries of 1 key stay in order, so the first of duplicate keys is still inserted
+   *           first.  uses a buffer as large as the input.
+   */
+  template <typename Iter, typename GroupOf>
+  void group_stable(Iter first, Iter last, size_t ngroups, GroupOf const & group_of) {
+    using V = typename ::std::iterator_traits<Iter>::value_type;
+    size_t n = ::std::distance(first, last);
+    if ((ngroups < 2) || (n < 2)) return;
+
+    ::std::vector<uint32_t> groups(n);
+    ::std::vector<size_t> offsets(ngroups + 1, 0);
+    size_t i = 0;
+    for (Iter it = first; it != last; ++it, ++i) {
+      groups[i] = static_cast<uint32_t>(group_of(*it));
+      ++offsets[groups[i] + 1];
+    }
+    for (size_t g = 1; g <= ngroups; ++g) offsets[g] += offsets[g - 1];
+
+    ::std::vector<V> buffer(n);
+    i = 0;
+    for (Iter it = first; it != last; ++it, ++i) buffer[offsets[groups[i]]++] = ::std::move(*it);
+    ::std::move(buffer.begin(), buffer.end(), first);
+  }
+
+  /**
+   * @brief rebuild a dense_hash_map without its deleted-key tombstones.
+   * @details erase only marks buckets deleted, and the table drops them when it next grows or shrinks on insert.
+   *          after a large erase with no inserts, probes keep walking the tombstones.  the copy constructor inserts
+   *          only the live entries, into the smallest table that holds them, with the same keys and load factors.
+   */
+  template <typename Map>
+  inline void compact(Map & map) {
+    Map(map).swap(map);
+  }
+
+  /// rebuild a dense_hash_map with only the entries for which pred is true, in one pass.  see compact.
+  template <typename Map, typename Pred>
+  inline void retain_if(Map & map, Pred const & pred) {
+    Map kept(0, map.hash_funct(), map.key_eq());
+    kept.set_empty_key(map.empty_key());
+    kept.set_deleted_key(map.deleted_key());
+    kept.max_load_factor(map.max_load_factor());
+    kept.min_load_factor(map.min_load_factor());
+
+    for (auto it = map.begin(); it != map.end(); ++it) {
+      if (pred(*it)) kept.insert(*it);
+    }
+    kept.swap(map);
+  }
+
+  /// do f(0) and f(1), in parallel if USE_OPENMP and n is large.  for the 2 sub-tables of a split map.
+  template <typename Func>
+  inline void for_both_tables(size_t n, Func const & f) {
+#if defined(USE_OPENMP)
+#pragma omp parallel for num_threads(2) schedule(static, 1) if (n >= (1UL << 16))
+#else
+    (void)n;
+#endif
+    for (int i = 0; i < 2; ++i) f(i);
+  }
+
 }  // namespace sparsehash
 
 
@@ -402,6 +542,10 @@ namespace sparsehash {
    *
    *
    *  this file contains the GOOGLE DENSE HASH MAP version of map and multimap that are compatible with kmer indexing.
+   *
+   *  thread safety:  the const members (count, equal_range, exists, prefetch, const iterators) read the tables and the
+   *  hash, comparator and splitter functors, and write nothing, in the split and unsplit versions alike.  so once a
+   *  map is no longer modified, any number of threads may query it concurrently without locks.  see ::fsc::frozen.
    */
 // key values span entire key space.
 template <typename Key,
@@ -430,6 +574,20 @@ protected:
     container_type lower_map;
     container_type upper_map;
 
+    /// entries erased since the bucket count was last erased_buckets.  bounds the tombstones, see deleted_ratio.
+    size_t erased;
+    size_t erased_buckets;
+
+    void note_erased(size_t count) {
+      if (count == 0) return;
+      // a table that grew or shrank since was rebuilt, without tombstones.
+      if (bucket_count() != erased_buckets) {
+        erased = 0;
+        erased_buckets = bucket_count();
+      }
+      erased += count;
+    }
+
     using container_iterator = typename container_type::iterator;
     using container_const_iterator = typename container_type::const_iterator;
     using container_range = ::std::pair<container_iterator, container_iterator>;
@@ -463,7 +621,8 @@ protected:
 	   lower_map(bucket_count / 2, Hash(),
 			   Equal(specials.generate(0), specials.generate(1))),
 	   upper_map(bucket_count / 2, Hash(),
-			   Equal(specials.invert(specials.generate(0)), specials.invert(specials.generate(1))))
+			   Equal(specials.invert(specials.generate(0)), specials.invert(specials.generate(1)))),
+	   erased(0), erased_buckets(0)
     {
     	lower_map.set_empty_key(specials.generate(0));
     	lower_map.set_deleted_key(specials.generate(1));
@@ -493,6 +652,12 @@ protected:
     	return lower_map.max_load_factor();
     }
 
+    /// max load factor of both tables, at which they grow.  default 0.7.  e.g. for load factor benchmarks.
+    void set_max_load_factor(float const lf) {
+      lower_map.max_load_factor(lf);
+      upper_map.max_load_factor(lf);
+    }
+
     iterator begin() {
       return iterator(std::vector<container_range> { container_range{lower_map.begin(), lower_map.end()},
                                                     container_range{upper_map.begin(), upper_map.end()} });
@@ -557,6 +722,13 @@ protected:
 
     }
 
+    /// call op on each entry, in the order of to_vector, without a copy of the whole content.
+    template <typename Op>
+    void visit(Op & op) const {
+      for (auto it = lower_map.begin(); it != lower_map.end(); ++it) op(*it);
+      for (auto it = upper_map.begin(); it != upper_map.end(); ++it) op(*it);
+    }
+
 
 
     bool empty() const {
@@ -574,11 +746,43 @@ protected:
     void reset() {
     	lower_map.clear();
     	upper_map.clear();
+      erased = 0;
     }
 
     void clear() {
       lower_map.clear_no_resize();
       upper_map.clear_no_resize();
+      erased = 0;
+    }
+
+    /// upper bound of the fraction of buckets holding deleted-key tombstones.
+    double deleted_ratio() const {
+      size_t n = bucket_count();
+      if ((n == 0) || (n != erased_buckets)) return 0.0;
+      return static_cast<double>(erased) / static_cast<double>(n);
+    }
+
+    /// rebuild both tables without tombstones, in parallel with USE_OPENMP.  iterators are invalidated.
+    void compact() {
+      sparsehash::for_both_tables(size(), [this](int i) {
+        sparsehash::compact((i == 0) ? lower_map : upper_map);
+      });
+      erased = 0;
+    }
+
+    /**
+     * @brief keep only the entries for which pred is true, rebuilding both tables compactly in one pass.
+     * @note  the 2 tables are filtered in parallel with USE_OPENMP, so pred must be safe to call concurrently.
+     * @return number of entries removed.
+     */
+    template <typename Pred>
+    size_t retain_if(Pred const & pred) {
+      size_t before = size();
+      sparsehash::for_both_tables(before, [this, &pred](int i) {
+        sparsehash::retain_if((i == 0) ? lower_map : upper_map, pred);
+      });
+      erased = 0;
+      return before - size();
     }
 
     void resize(size_t const n) {
@@ -592,12 +796,20 @@ protected:
     }
 
     /// bucket count.  same as underlying buckets
-    size_type bucket_count() {
+    size_type bucket_count() const {
 //      std::cout << " dense hash map - split " << std::endl;
 
       return lower_map.bucket_count() + upper_map.bucket_count();
     }
 
+    /// entries in bucket n, at most 1.  buckets are numbered through the lower, then the upper table.  for parallel scans.
+    typename container_type::const_local_iterator begin(size_type n) const {
+      return (n < lower_map.bucket_count()) ? lower_map.begin(n) : upper_map.begin(n - lower_map.bucket_count());
+    }
+    typename container_type::const_local_iterator end(size_type n) const {
+      return (n < lower_map.bucket_count()) ? lower_map.end(n) : upper_map.end(n - lower_map.bucket_count());
+    }
+
     /// max load factor.  this is the map's max load factor (vectors per bucket) x multiplicity = elements per bucket.  side effect is multiplicity is updated.
     float load_factor() {
       return  static_cast<float>(size()) / static_cast<float>(bucket_count());
@@ -623,14 +835,37 @@ protected:
 //    	lower_map.resize(static_cast<float>(lower_map.size() + count) ) ;
 //    	upper_map.resize(static_cast<float>(upper_map.size() + (std::distance(first, last) - count)) ) ;
 
-    	for (auto it = first; it != last; ++it) {
-    		static_cast<void>(this->insert(*it));
-    	}
+    	using V = typename ::std::iterator_traits<InputIt>::value_type;
+    	::fsc::sparsehash::prefetched_for_each(*this, first, last, [this](V const & x) {
+    		static_cast<void>(this->insert(x));
+    	});
 
     }
 
-    /// inserting a vector
+    /**
+     * @brief  reorder entries or keys [first, last) by the cache sized table region each key goes to, lower then upper table.
+     * @details  a batch larger than the cache then inserts region by region, so the probed buckets stay cached,
+     *           instead of each insert missing to DRAM.  entries of a key keep their order.  no-op for small tables.
+     *           best after the table is sized for the batch, as a resize during the insert changes the regions.
+     */
+    template <typename Iter>
+    void locality_order(Iter first, Iter last) const {
+      size_t n = ::std::distance(first, last);
+      unsigned int lb = ::fsc::sparsehash::locality_bits(lower_map, n);
+      unsigned int ub = ::fsc::sparsehash::locality_bits(upper_map, n);
+      if ((lb == 0) && (ub == 0)) return;
+      size_t lgroups = 1UL << lb;
+      using V = typename ::std::iterator_traits<Iter>::value_type;
+      ::fsc::sparsehash::group_stable(first, last, lgroups + (1UL << ub), [this, lb, ub, lgroups](V const & x) {
+        Key const & k = ::fsc::sparsehash::entry_key(x);
+        return splitter(k) ? ::fsc::sparsehash::bucket_region(lower_map, k, lb) :
+            (lgroups + ::fsc::sparsehash::bucket_region(upper_map, k, ub));
+      });
+    }
+
+    /// inserting a vector.  reordered for cache locality, see locality_order.
     void insert(::std::vector<::std::pair<Key, T> > & input) {
+    	locality_order(input.begin(), input.end());
     	insert(input.begin(), input.end());
     }
 
@@ -791,7 +1026,7 @@ protected:
     	  }
       }
 
-
+      note_erased(count);
       return count;
     }
 
@@ -843,6 +1078,7 @@ protected:
       	  }
         }
 
+        note_erased(count);
         return count;
     }
 
@@ -859,6 +1095,7 @@ protected:
     				upper_map.erase(it);
     	}
 
+    	note_erased(before - size());
     	return before - size();
     }
 
@@ -887,6 +1124,14 @@ protected:
     		return upper_map.equal_range(key);
     	}
     }
+    /// prefetch the bucket of key, so a following find, count, or equal_range of key does not wait on memory.
+    inline void prefetch(Key const & key) const {
+    	if (splitter(key))
+    		::fsc::sparsehash::prefetch_bucket(lower_map, key);
+    	else
+    		::fsc::sparsehash::prefetch_bucket(upper_map, key);
+    }
+
     // NO bucket interfaces
 
     iterator find(Key const &key) {
@@ -909,7 +1154,7 @@ protected:
 
     inline bool exists(Key const & key) const {
       if (splitter(key)) {
-        return upper_map.find(key) != upper_map.end();
+        return lower_map.find(key) != lower_map.end();
       } else {
         return upper_map.find(key) != upper_map.end();
       }
@@ -939,6 +1184,19 @@ class densehash_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, fals
 
     container_type map;
 
+    /// entries erased since the bucket count was last erased_buckets.  bounds the tombstones, see deleted_ratio.
+    size_t erased;
+    size_t erased_buckets;
+
+    void note_erased(size_t count) {
+      if (count == 0) return;
+      // a table that grew or shrank since was rebuilt, without tombstones.
+      if (map.bucket_count() != erased_buckets) {
+        erased = 0;
+        erased_buckets = map.bucket_count();
+      }
+      erased += count;
+    }
 
 
   public:
@@ -960,7 +1218,8 @@ class densehash_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, fals
     densehash_map(size_type bucket_count = 128) :
 		   specials(),
 		   map(bucket_count, Hash(),
-				   Equal(specials.generate(0), specials.generate(1)))
+				   Equal(specials.generate(0), specials.generate(1))),
+		   erased(0), erased_buckets(0)
 		{
 		map.set_empty_key(specials.generate(0));
 		map.set_deleted_key(specials.generate(1));
@@ -985,6 +1244,11 @@ class densehash_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, fals
     	return map.max_load_factor();
     }
 
+    /// max load factor of the table, at which it grows.  default 0.7.  e.g. for load factor benchmarks.
+    void set_max_load_factor(float const lf) {
+      map.max_load_factor(lf);
+    }
+
     iterator begin() {
       return map.begin();
     }
@@ -1040,6 +1304,12 @@ class densehash_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, fals
       }
     }
 
+    /// call op on each entry, in the order of to_vector, without a copy of the whole content.
+    template <typename Op>
+    void visit(Op & op) const {
+      for (auto it = map.begin(); it != map.end(); ++it) op(*it);
+    }
+
 
     bool empty() const {
       return map.empty();
@@ -1054,10 +1324,34 @@ class densehash_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, fals
 
     void reset() {
     	map.clear();
+      erased = 0;
     }
 
     void clear() {
       map.clear_no_resize();
+      erased = 0;
+    }
+
+    /// upper bound of the fraction of buckets holding deleted-key tombstones.
+    double deleted_ratio() const {
+      size_t n = map.bucket_count();
+      if ((n == 0) || (n != erased_buckets)) return 0.0;
+      return static_cast<double>(erased) / static_cast<double>(n);
+    }
+
+    /// rebuild the table without tombstones.  iterators are invalidated.
+    void compact() {
+      sparsehash::compact(map);
+      erased = 0;
+    }
+
+    /// keep only the entries for which pred is true, rebuilding the table compactly in one pass.  returns number removed.
+    template <typename Pred>
+    size_t retain_if(Pred const & pred) {
+      size_t before = map.size();
+      sparsehash::retain_if(map, pred);
+      erased = 0;
+      return before - map.size();
     }
 
     void resize(size_t const n) {
@@ -1070,11 +1364,19 @@ class densehash_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, fals
     }
 
     /// bucket count.  same as underlying buckets
-    size_type bucket_count() {
+    size_type bucket_count() const {
 //      std::cout << " dense hash map - single " << map.bucket_count() << " max/min load factors " << map.max_load_factor() << "/" << map.min_load_factor() << std::endl;
       return map.bucket_count();
     }
 
+    /// entries in bucket n, at most 1.  for parallel scans.
+    typename container_type::const_local_iterator begin(size_type n) const {
+      return map.begin(n);
+    }
+    typename container_type::const_local_iterator end(size_type n) const {
+      return map.end(n);
+    }
+
     /// max load factor.  this is the map's max load factor (vectors per bucket) x multiplicity = elements per bucket.  side effect is multiplicity is updated.
     float load_factor() {
       return  static_cast<float>(map.size()) / static_cast<float>(map.bucket_count());
@@ -1087,11 +1389,28 @@ class densehash_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, fals
     	// this could waste a lot of space
     	// this->resize(map.size() + std::distance(first, last));
 
-      map.insert(first, last);
+      using V = typename ::std::iterator_traits<InputIt>::value_type;
+      ::fsc::sparsehash::prefetched_for_each(*this, first, last, [this](V const & x) {
+        static_cast<void>(map.insert(x));
+      });
     }
 
-    /// inserting sorted range
+    /**
+     * @brief  reorder [first, last) by the cache sized table region each key goes to.  see the split version.
+     */
+    template <typename Iter>
+    void locality_order(Iter first, Iter last) const {
+      unsigned int bits = ::fsc::sparsehash::locality_bits(map, ::std::distance(first, last));
+      if (bits == 0) return;
+      using V = typename ::std::iterator_traits<Iter>::value_type;
+      ::fsc::sparsehash::group_stable(first, last, 1UL << bits, [this, bits](V const & x) {
+        return ::fsc::sparsehash::bucket_region(map, ::fsc::sparsehash::entry_key(x), bits);
+      });
+    }
+
+    /// inserting a vector.  reordered for cache locality, see locality_order.
     void insert(::std::vector<::std::pair<Key, T> > & input) {
+      locality_order(input.begin(), input.end());
       insert(input.begin(), input.end());
     }
 
@@ -1165,6 +1484,7 @@ class densehash_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, fals
           ++count;
         }
       }
+      note_erased(count);
       return count;
     }
 
@@ -1185,6 +1505,7 @@ class densehash_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, fals
             map.erase(iter);
             ++count;
         }
+        note_erased(count);
         return count;
     }
 
@@ -1197,6 +1518,7 @@ class densehash_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, fals
             map.erase(it);
       }
 
+      note_erased(before - map.size());
       return before - map.size();
     }
 
@@ -1211,6 +1533,11 @@ class densehash_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, fals
     ::std::pair<const_iterator, const_iterator> equal_range(Key const & key) const {
       return map.equal_range(key);
     }
+    /// prefetch the bucket of key, so a following find, count, or equal_range of key does not wait on memory.
+    inline void prefetch(Key const & key) const {
+      ::fsc::sparsehash::prefetch_bucket(map, key);
+    }
+
     // NO bucket interfaces
 
 
@@ -1229,6 +1556,433 @@ class densehash_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, fals
 };
 
 
+/**
+ * @brief densehash_map for keys that span the entire key space, in 1 table.
+ * @details the split densehash_map keeps 2 tables with different empty and deleted keys, and picks one by comparing
+ *          each key against a splitter, a branch that is taken at random.  this keeps 1 table with the empty and
+ *          deleted keys of the lower table, and puts the few real keys equal to these, at most 2, in a side stash:
+ *          a tiny dense_hash_map with the inverted empty and deleted keys.  each operation compares the key with the
+ *          2 reserved keys, a branch that is almost never taken, and then probes the 1 table.  the table grows as
+ *          one, and iterators run over the table, then the stash.
+ *
+ *          interface and template parameters follow densehash_map, so it can be the Container of the distributed
+ *          maps.  split is ignored.  with a Transform, keys equal to a reserved key after transform are stashed too.
+ */
+template <typename Key,
+typename T,
+typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
+template<typename> class Transform = ::bliss::transform::identity,
+typename Hash =  ::fsc::TransformedHash<Key, ::std::hash, Transform>,
+typename Equal = ::fsc::sparsehash::compare<Key, ::std::equal_to, Transform>,
+typename Allocator = ::std::allocator<::std::pair<const Key, T> >,
+bool split = SpecialKeys::need_to_split >
+class stashed_densehash_map {
+
+  protected:
+    using container_type =
+        ::google::dense_hash_map<Key, T,
+                       Hash, Equal, Allocator >;
+
+    SpecialKeys specials;
+
+    container_type map;
+    /// entries whose keys are the empty or deleted key of map.
+    container_type stash;
+
+    /// entries erased since the bucket count was last erased_buckets.  bounds the tombstones, see deleted_ratio.
+    size_t erased;
+    size_t erased_buckets;
+
+    void note_erased(size_t count) {
+      if (count == 0) return;
+      // a table that grew or shrank since was rebuilt, without tombstones.
+      if (map.bucket_count() != erased_buckets) {
+        erased = 0;
+        erased_buckets = map.bucket_count();
+      }
+      erased += count;
+    }
+
+    /// map's comparator and its empty and deleted keys.
+    Equal eq;
+    Key empty_key;
+    Key deleted_key;
+
+    /// true if key is a reserved key of map, under map's comparator.
+    inline bool stashed(Key const & key) const {
+      return eq(key, empty_key) || eq(key, deleted_key);
+    }
+
+    inline container_type & table(Key const & key) {
+      return stashed(key) ? stash : map;
+    }
+    inline container_type const & table(Key const & key) const {
+      return stashed(key) ? stash : map;
+    }
+
+    using container_iterator = typename container_type::iterator;
+    using container_const_iterator = typename container_type::const_iterator;
+    using container_range = ::std::pair<container_iterator, container_iterator>;
+    using container_const_range = ::std::pair<container_const_iterator, container_const_iterator>;
+
+  public:
+    using key_type              = Key;
+    using mapped_type           = T;
+    using value_type            = ::std::pair<const Key, T>;
+    using hasher                = Hash;
+    using key_equal             = Equal;
+    using allocator_type        = Allocator;
+    using reference             = value_type&;
+    using const_reference       = const value_type&;
+    using pointer               = typename std::allocator_traits<Allocator>::pointer;
+    using const_pointer         = typename std::allocator_traits<Allocator>::const_pointer;
+    using iterator              = ::bliss::iterator::ConcatenatingIterator<container_iterator >;
+    using const_iterator        = ::bliss::iterator::ConcatenatingIterator<container_const_iterator >;
+    using size_type             = size_t;
+    using difference_type       = ptrdiff_t;
+
+    stashed_densehash_map(size_type bucket_count = 128) :
+      specials(),
+      map(bucket_count, Hash(),
+          Equal(specials.generate(0), specials.generate(1))),
+      stash(4, Hash(),
+          Equal(specials.invert(specials.generate(0)), specials.invert(specials.generate(1)))),
+      erased(0), erased_buckets(0),
+      eq(specials.generate(0), specials.generate(1)),
+      empty_key(specials.generate(0)), deleted_key(specials.generate(1))
+    {
+      map.set_empty_key(specials.generate(0));
+      map.set_deleted_key(specials.generate(1));
+      stash.set_empty_key(specials.invert(specials.generate(0)));
+      stash.set_deleted_key(specials.invert(specials.generate(1)));
+
+      map.max_load_factor(0.7);
+      map.min_load_factor(0.3);
+    };
+
+    template<class InputIt>
+    stashed_densehash_map(InputIt first, InputIt last) :
+      stashed_densehash_map(std::distance(first, last)) {
+      this->insert(first, last);
+    };
+
+    virtual ~stashed_densehash_map() {};
+
+    float get_max_load_factor() const {
+      return map.max_load_factor();
+    }
+
+    iterator begin() {
+      if (empty()) return this->end();
+      return iterator(std::vector<container_range> { container_range{map.begin(), map.end()},
+                                                    container_range{stash.begin(), stash.end()} });
+    }
+    const_iterator begin() const {
+      return cbegin();
+    }
+    const_iterator cbegin() const {
+      if (empty()) return this->cend();
+      return const_iterator(std::vector<container_const_range> { container_const_range{map.begin(), map.end()},
+                                                                 container_const_range{stash.begin(), stash.end()} });
+    }
+
+    iterator end() {
+      return iterator( stash.end() );
+    }
+    const_iterator end() const {
+      return cend();
+    }
+    const_iterator cend() const {
+      return const_iterator( stash.end() );
+    }
+
+    std::vector<Key> keys() const  {
+      std::vector<Key> ks;
+      keys(ks);
+      return ks;
+    }
+    void keys(std::vector<Key> & ks) const  {
+      ks.clear();
+      ks.reserve(size());
+      for (auto it = map.begin(); it != map.end(); ++it) ks.emplace_back(it->first);
+      for (auto it = stash.begin(); it != stash.end(); ++it) ks.emplace_back(it->first);
+    }
+
+    std::vector<std::pair<Key, T>> to_vector() const  {
+      std::vector<std::pair<Key, T>> vs;
+      to_vector(vs);
+      return vs;
+    }
+    void to_vector(  std::vector<std::pair<Key, T>> & vs) const  {
+      vs.clear();
+      vs.reserve(size());
+      for (auto it = map.begin(); it != map.end(); ++it) vs.emplace_back(*it);
+      for (auto it = stash.begin(); it != stash.end(); ++it) vs.emplace_back(*it);
+    }
+
+    /// call op on each entry, in the order of to_vector, without a copy of the whole content.
+    template <typename Op>
+    void visit(Op & op) const {
+      for (auto it = map.begin(); it != map.end(); ++it) op(*it);
+      for (auto it = stash.begin(); it != stash.end(); ++it) op(*it);
+    }
+
+    bool empty() const {
+      return map.empty() && stash.empty();
+    }
+
+    size_type size() const {
+      return map.size() + stash.size();
+    }
+
+    size_type unique_size() const {
+      return map.size() + stash.size();
+    }
+
+    /// number of entries in the stash, at most 2.
+    size_type stash_size() const {
+      return stash.size();
+    }
+
+    void reset() {
+      map.clear();
+      stash.clear();
+      erased = 0;
+    }
+
+    void clear() {
+      map.clear_no_resize();
+      stash.clear_no_resize();
+      erased = 0;
+    }
+
+    /// upper bound of the fraction of buckets holding deleted-key tombstones.
+    double deleted_ratio() const {
+      size_t n = map.bucket_count();
+      if ((n == 0) || (n != erased_buckets)) return 0.0;
+      return static_cast<double>(erased) / static_cast<double>(n);
+    }
+
+    /// rebuild the table without tombstones.  iterators are invalidated.
+    void compact() {
+      sparsehash::compact(map);
+      sparsehash::compact(stash);
+      erased = 0;
+    }
+
+    /// keep only the entries for which pred is true, rebuilding the table compactly in one pass.  returns number removed.
+    template <typename Pred>
+    size_t retain_if(Pred const & pred) {
+      size_t before = size();
+      sparsehash::retain_if(map, pred);
+      sparsehash::retain_if(stash, pred);
+      erased = 0;
+      return before - size();
+    }
+
+    void resize(size_t const n) {
+      map.resize(n);
+    }
+
+    /// rehash for new count number of BUCKETS.  iterators are invalidated.
+    void rehash(size_type count) {
+      this->resize(count);
+    }
+
+    /// bucket count, of the table and the stash.
+    size_type bucket_count() const {
+      return map.bucket_count() + stash.bucket_count();
+    }
+
+    /// entries in bucket n, at most 1.  buckets are numbered through the table, then the stash.  for parallel scans.
+    typename container_type::const_local_iterator begin(size_type n) const {
+      return (n < map.bucket_count()) ? map.begin(n) : stash.begin(n - map.bucket_count());
+    }
+    typename container_type::const_local_iterator end(size_type n) const {
+      return (n < map.bucket_count()) ? map.end(n) : stash.end(n - map.bucket_count());
+    }
+
+    float load_factor() {
+      return  static_cast<float>(size()) / static_cast<float>(bucket_count());
+    }
+
+
+    template <class InputIt>
+    void insert(InputIt first, InputIt last) {
+      using V = typename ::std::iterator_traits<InputIt>::value_type;
+      ::fsc::sparsehash::prefetched_for_each(*this, first, last, [this](V const & x) {
+        static_cast<void>(this->insert(x));
+      });
+    }
+
+    /**
+     * @brief  reorder [first, last) by the cache sized table region each key goes to.  see densehash_map::locality_order.
+     */
+    template <typename Iter>
+    void locality_order(Iter first, Iter last) const {
+      unsigned int bits = ::fsc::sparsehash::locality_bits(map, ::std::distance(first, last));
+      if (bits == 0) return;
+      using V = typename ::std::iterator_traits<Iter>::value_type;
+      ::fsc::sparsehash::group_stable(first, last, 1UL << bits, [this, bits](V const & x) {
+        return ::fsc::sparsehash::bucket_region(map, ::fsc::sparsehash::entry_key(x), bits);
+      });
+    }
+
+    /// inserting a vector.  reordered for cache locality, see locality_order.
+    void insert(::std::vector<::std::pair<Key, T> > & input) {
+      locality_order(input.begin(), input.end());
+      insert(input.begin(), input.end());
+    }
+
+    /// inserting a vector
+    void insert(::std::vector<value_type > & input) {
+      insert(input.begin(), input.end());
+    }
+
+    template <typename K = Key, typename = typename std::enable_if<!std::is_const<Key>::value> >
+    std::pair<typename container_type::iterator, bool> insert(::std::pair<Key, T> const & x) {
+      return table(x.first).insert(x);
+    }
+
+    std::pair<typename container_type::iterator, bool> insert(::std::pair<const Key, T> const & x) {
+      return table(x.first).insert(x);
+    }
+
+
+    template <typename V, typename Updater>
+    size_t update(::std::vector<::std::pair<Key, V> > & input, Updater const & op) {
+      size_t count = 0;
+      for (auto iit = input.begin(); iit != input.end(); ++iit) {
+        container_type & t = table(iit->first);
+        auto iter = t.find(iit->first);
+        if (iter == t.end()) continue;
+
+        // update the entry
+        count += op((*iter).second, iit->second );
+      }
+      return count;
+    }
+
+    // non distributed version
+    template <typename Filter, typename Updater>
+    size_t update(Filter const & fop, Updater const & op) {
+      size_t count = 0;
+      for (auto iter = map.begin(); iter != map.end(); ++iter) {
+        if (fop(*iter)) count += op((*iter).second);
+      }
+      for (auto iter = stash.begin(); iter != stash.end(); ++iter) {
+        if (fop(*iter)) count += op((*iter).second);
+      }
+      return count;
+    }
+
+
+    template <typename InputIt, typename Pred>
+    size_t erase(InputIt first, InputIt last, Pred const & pred) {
+      static_assert(::std::is_convertible<Key, typename ::std::iterator_traits<InputIt>::value_type>::value,
+                    "InputIt value type for erase cannot be converted to key type");
+
+      size_t count = 0;
+      size_t stash_count = 0;
+      for (auto iit = first; iit != last; ++iit) {
+        Key k = *iit;
+        bool s = stashed(k);
+        container_type & t = s ? stash : map;
+        auto iter = t.find(k);
+        if (iter == t.end()) continue;
+
+        if (pred(*iter)) {
+          t.erase(iter);
+          if (s) ++stash_count;
+          else ++count;
+        }
+      }
+
+      note_erased(count);
+      return count + stash_count;
+    }
+
+    template <typename InputIt>
+    size_t erase(InputIt first, InputIt last) {
+      static_assert(::std::is_convertible<Key, typename ::std::iterator_traits<InputIt>::value_type>::value,
+                    "InputIt value type for erase cannot be converted to key type");
+
+      size_t count = 0;
+      size_t stash_count = 0;
+      for (auto iit = first; iit != last; ++iit) {
+        Key k = *iit;
+        if (stashed(k)) stash_count += stash.erase(k);
+        else count += map.erase(k);
+      }
+
+      note_erased(count);
+      return count + stash_count;
+    }
+
+    template <typename Pred>
+    size_t erase(Pred const & pred) {
+      size_t before = map.size();
+      for (auto it = map.begin(); it != map.end(); ++it) {
+        if (pred(*it)) map.erase(it);
+      }
+      size_t count = before - map.size();
+      note_erased(count);
+
+      before = stash.size();
+      for (auto it = stash.begin(); it != stash.end(); ++it) {
+        if (pred(*it)) stash.erase(it);
+      }
+      return count + before - stash.size();
+    }
+
+    size_type count(Key const & key) const {
+      return table(key).count(key);
+    }
+
+    container_range equal_range(Key const & key) {
+      return table(key).equal_range(key);
+    }
+    container_const_range equal_range(Key const & key) const {
+      return table(key).equal_range(key);
+    }
+
+    /// prefetch the bucket of key, so a following find, count, or equal_range of key does not wait on memory.
+    inline void prefetch(Key const & key) const {
+      ::fsc::sparsehash::prefetch_bucket(map, key);
+    }
+
+    /// iterator at key, which continues through the rest of the table and the stash, or end().
+    iterator find(Key const &key) {
+      if (stashed(key)) {
+        auto it = stash.find(key);
+        if (it == stash.end()) return this->end();
+        return iterator(std::vector<container_range> { container_range{it, stash.end()} });
+      }
+      auto it = map.find(key);
+      if (it == map.end()) return this->end();
+      return iterator(std::vector<container_range> { container_range{it, map.end()},
+                                                    container_range{stash.begin(), stash.end()} });
+    }
+
+    const_iterator find(Key const &key) const {
+      if (stashed(key)) {
+        auto it = stash.find(key);
+        if (it == stash.end()) return this->cend();
+        return const_iterator(std::vector<container_const_range> { container_const_range{it, stash.end()} });
+      }
+      auto it = map.find(key);
+      if (it == map.end()) return this->cend();
+      return const_iterator(std::vector<container_const_range> { container_const_range{it, map.end()},
+                                                                 container_const_range{stash.begin(), stash.end()} });
+    }
+
+    inline bool exists(Key const & key) const {
+      container_type const & t = table(key);
+      return t.find(key) != t.end();
+    }
+};
+
+
 
 
 // lookup new left
@@ -1702,7 +2456,7 @@ class densehash_multimap {
       if (iter->second >= 0)  return ::std::make_pair(vec1.cbegin() + iter->second, vec1.cbegin() + iter->second + 1);
 
       // found, has multiple values
-      subcontainer_type & vec = vecX[iter->second & ::std::numeric_limits<int64_t>::max()];
+      subcontainer_type const & vec = vecX[iter->second & ::std::numeric_limits<int64_t>::max()];
 
       return std::make_pair(vec.cbegin(), vec.cend());
 
@@ -1804,6 +2558,21 @@ class densehash_multimap {
       }
     }
 
+    /// call op on each entry, in the order of to_vector, without a copy of the whole content.
+    template <typename Op>
+    void visit(Op & op) const {
+      for (auto const * m : {&lower_map, &upper_map}) {
+        for (auto it = m->begin(); it != m->end(); ++it) {
+          if (it->second < 0) {
+            auto const & v = vecX[it->second & ::std::numeric_limits<int64_t>::max()];
+            for (auto it2 = v.begin(); it2 != v.end(); ++it2) op(*it2);
+          } else {  // singleton
+            op(vec1[it->second]);
+          }
+        }
+      }
+    }
+
 
     bool empty() const {
       return lower_map.empty() && upper_map.empty();
@@ -1886,10 +2655,11 @@ class densehash_multimap {
     	lower_map.resize(static_cast<float>(lower_map.size() + count) ) ;
     	upper_map.resize(static_cast<float>(upper_map.size() + (std::distance(first, last) - count)) ) ;
 
-    	for (auto it = first; it != last; ++it) {
-    		if (splitter((*it).first)) this->insert1_impl(*it, lower_map);
-    		else this->insert1_impl(*it, upper_map);
-    	}
+    	using V = typename ::std::iterator_traits<InputIt>::value_type;
+    	::fsc::sparsehash::prefetched_for_each(*this, first, last, [this](V const & x) {
+    		if (splitter(x.first)) this->insert1_impl(x, lower_map);
+    		else this->insert1_impl(x, upper_map);
+    	});
     }
 
     /// inserting sorted range
@@ -1975,7 +2745,7 @@ class densehash_multimap {
 
     inline bool exists(Key const & key) const {
       if (splitter(key)) {
-        return upper_map.find(key) != upper_map.end();
+        return lower_map.find(key) != lower_map.end();
       } else {
         return upper_map.find(key) != upper_map.end();
       }
@@ -1995,6 +2765,19 @@ class densehash_multimap {
         return equal_range_impl(key, upper_map);
       }
     }
+    /// the entries of key, in place, without copying.  valid until the map is modified.
+    ::fsc::span<::std::pair<Key, T> > equal_range_span(Key const & key) const {
+      auto range = this->equal_range(key);
+      return ::fsc::make_span(range.first, range.second);
+    }
+    /// prefetch the bucket of key, so a following find, count, or equal_range of key does not wait on memory.
+    inline void prefetch(Key const & key) const {
+      if (splitter(key))
+        ::fsc::sparsehash::prefetch_bucket(lower_map, key);
+      else
+        ::fsc::sparsehash::prefetch_bucket(upper_map, key);
+    }
+
     // NO bucket interfaces
 
 };
@@ -2132,6 +2915,19 @@ class densehash_multimap<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator,
       }
     }
 
+    /// call op on each entry, in the order of to_vector, without a copy of the whole content.
+    template <typename Op>
+    void visit(Op & op) const {
+      for (auto it = map.begin(); it != map.end(); ++it) {
+        if (it->second < 0) {
+          auto const & v = vecX[it->second & ::std::numeric_limits<int64_t>::max()];
+          for (auto it2 = v.begin(); it2 != v.end(); ++it2) op(*it2);
+        } else {  // singleton
+          op(vec1[it->second]);
+        }
+      }
+    }
+
 
 
     bool empty() const {
@@ -2209,7 +3005,16 @@ class densehash_multimap<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator,
         std::pair<typename supercontainer_type::iterator, bool> insert_result;
         Key k;
         int64_t idx;
+        InputIt pf = first;
+        for (size_t i = 0; (i < 16) && (pf != last); ++i, ++pf) {
+          this->prefetch((*pf).first);
+        }
         for (InputIt it = first, max = last; it != max; ++it) {
+          // keep 16 bucket loads in flight.  see ::fsc::sparsehash::prefetched_for_each
+          if (pf != last) {
+            this->prefetch((*pf).first);
+            ++pf;
+          }
           k = (*it).first;
 
           // try inserting
@@ -2469,6 +3274,16 @@ class densehash_multimap<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator,
 
 
     }
+    /// the entries of key, in place, without copying.  valid until the map is modified.
+    ::fsc::span<::std::pair<Key, T> > equal_range_span(Key const & key) const {
+      auto range = this->equal_range(key);
+      return ::fsc::make_span(range.first, range.second);
+    }
+    /// prefetch the bucket of key, so a following find, count, or equal_range of key does not wait on memory.
+    inline void prefetch(Key const & key) const {
+      ::fsc::sparsehash::prefetch_bucket(map, key);
+    }
+
     // NO bucket interfaces
 
 };
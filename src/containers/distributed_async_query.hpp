@@ -0,0 +1,397 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    distributed_async_query.hpp
+ * @ingroup containers
+ * @author  tpan
+ * @brief   non-blocking distributed query:  the exchanges of find and count as a chain of MPI non-blocking collectives.
+ * @details a query goes through 4 exchanges:  key counts (MPI_Ialltoall), keys (MPI_Ialltoallv), result counts and
+ *          results.  each step is posted when the previous one completes, as seen by test() or wait(), and the keys
+ *          received from each rank are answered locally in between.  the caller can parse the next batch meanwhile,
+ *          calling test() now and then so the chain moves on.  count skips the result count exchange, since there is
+ *          one answer per key.
+ *
+ *          MPI requires collectives on a communicator to be started in the same order on all ranks, but steps of
+ *          different queries start whenever a rank polls them.  so each outstanding query has its own communicator
+ *          from a fixed set of channels, and a query waits for the previous query on its channel before it starts.
+ *
+ *          progress happens in test() and wait(), and in MPI's own progress engine, which for many MPI libraries
+ *          only runs inside MPI calls.  with an async_progress_thread, a background thread calls test() on all
+ *          outstanding queries, so steps are posted and answered while the caller computes.  that needs
+ *          MPI_THREAD_MULTIPLE.
+ */
+#ifndef SRC_CONTAINERS_DISTRIBUTED_ASYNC_QUERY_HPP_
+#define SRC_CONTAINERS_DISTRIBUTED_ASYNC_QUERY_HPP_
+
+#include <cstdint>
+#include <cassert>
+#include <vector>
+#include <memory>      // shared_ptr, weak_ptr
+#include <functional>  // function
+#include <numeric>     // accumulate
+#include <limits>
+#include <algorithm>   // max, remove_if
+#include <utility>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <mpi.h>
+#include <mxx/comm.hpp>
+#include <mxx/datatypes.hpp>
+
+namespace dsc
+{
+
+  /// progress interface of a non-blocking query, for the channel set.
+  class async_query_base {
+    public:
+      virtual ~async_query_base() {}
+
+      /// advance without blocking.  true when the results are ready.
+      virtual bool test() = 0;
+
+      /// advance until the results are ready.
+      virtual void wait() = 0;
+  };
+
+
+  /**
+   * @brief one non-blocking query.  see file comment.
+   * @tparam Result  answer type, e.g. (key, value) for find and (key, count) for count.
+   */
+  template <typename Key, typename Result>
+  class async_query : public async_query_base {
+    public:
+      /// appends the local answers for the received keys [first, last) to the output.
+      using answer_func = ::std::function<void(Key const *, Key const *, ::std::vector<Result> &)>;
+
+    protected:
+      enum stage_type { QUERY_COUNTS, QUERIES, RESULT_COUNTS, RESULTS, DONE };
+
+      MPI_Comm comm;
+      int p;
+      stage_type stage;
+      /// exactly one answer per key, so result counts are not exchanged.
+      bool one_per_query;
+      answer_func answer;
+
+      ::mxx::datatype size_dt;
+      ::mxx::datatype key_dt;
+      ::mxx::datatype result_dt;
+      MPI_Request req;
+
+      ::std::vector<Key> keys;
+      ::std::vector<size_t> send_counts;
+      ::std::vector<size_t> recv_counts;
+      ::std::vector<Key> queries;
+      ::std::vector<size_t> answer_counts;
+      ::std::vector<size_t> result_counts;
+      ::std::vector<Result> answers;
+      ::std::vector<Result> results;
+
+      // int counts and displacements of the pending all2allv.  they must live until it completes.
+      ::std::vector<int> scnts, sdispls, rcnts, rdispls;
+
+      /// held while advancing, so a progress thread and the caller do not advance at the same time.
+      ::std::mutex progress_mutex;
+      ::std::atomic<bool> finished;
+
+      template <typename V>
+      void post_all2allv(::std::vector<V> const & in, ::std::vector<size_t> const & in_counts,
+                         ::std::vector<V> & out, ::std::vector<size_t> const & out_counts, ::mxx::datatype const & dt) {
+        size_t total = ::std::accumulate(out_counts.begin(), out_counts.end(), static_cast<size_t>(0));
+        assert((::std::max(total, in.size()) < static_cast<size_t>(::std::numeric_limits<int>::max())) &&
+               "batch too large for MPI_Ialltoallv");
+        out.resize(total);
+
+        scnts.assign(p, 0);  sdispls.assign(p, 0);
+        rcnts.assign(p, 0);  rdispls.assign(p, 0);
+        for (int i = 0; i < p; ++i) {
+          scnts[i] = in_counts[i];
+          rcnts[i] = out_counts[i];
+          if (i > 0) {
+            sdispls[i] = sdispls[i - 1] + scnts[i - 1];
+            rdispls[i] = rdispls[i - 1] + rcnts[i - 1];
+          }
+        }
+        MPI_Ialltoallv(const_cast<V*>(in.data()), scnts.data(), sdispls.data(), dt.type(),
+                       out.data(), rcnts.data(), rdispls.data(), dt.type(), comm, &req);
+      }
+
+      /// answer the received keys, one source rank at a time.
+      void answer_queries() {
+        answer_counts.assign(p, 0);
+        Key const * first = queries.data();
+        for (int i = 0; i < p; ++i) {
+          size_t before = answers.size();
+          answer(first, first + recv_counts[i], answers);
+          first += recv_counts[i];
+          answer_counts[i] = answers.size() - before;
+        }
+        ::std::vector<Key>().swap(queries);
+      }
+
+      /// the current step completed:  post the next one.
+      void advance() {
+        switch (stage) {
+          case QUERY_COUNTS:
+            post_all2allv(keys, send_counts, queries, recv_counts, key_dt);
+            stage = QUERIES;
+            break;
+          case QUERIES:
+            ::std::vector<Key>().swap(keys);
+            answer_queries();
+            if (one_per_query) {
+              post_all2allv(answers, recv_counts, results, send_counts, result_dt);
+              stage = RESULTS;
+            } else {
+              result_counts.assign(p, 0);
+              MPI_Ialltoall(answer_counts.data(), 1, size_dt.type(), result_counts.data(), 1, size_dt.type(), comm, &req);
+              stage = RESULT_COUNTS;
+            }
+            break;
+          case RESULT_COUNTS:
+            post_all2allv(answers, answer_counts, results, result_counts, result_dt);
+            stage = RESULTS;
+            break;
+          case RESULTS:
+            ::std::vector<Result>().swap(answers);
+            stage = DONE;
+            break;
+          default:
+            break;
+        }
+      }
+
+    public:
+      /**
+       * @brief start a query.  collective on _comm, which no other outstanding query may use.
+       * @param bucketed  keys grouped by owner rank.
+       * @param counts    keys for each rank.
+       */
+      async_query(MPI_Comm _comm, ::std::vector<Key> && bucketed, ::std::vector<size_t> && counts,
+                  answer_func const & _answer, bool _one_per_query) :
+        comm(_comm), stage(QUERY_COUNTS), one_per_query(_one_per_query), answer(_answer),
+        size_dt(::mxx::get_datatype<size_t>()), key_dt(::mxx::get_datatype<Key>()),
+        result_dt(::mxx::get_datatype<Result>()), req(MPI_REQUEST_NULL),
+        keys(::std::move(bucketed)), send_counts(::std::move(counts)), finished(false) {
+        MPI_Comm_size(comm, &p);
+
+        if (p == 1) {
+          answer(keys.data(), keys.data() + keys.size(), results);
+          ::std::vector<Key>().swap(keys);
+          stage = DONE;
+          finished = true;
+          return;
+        }
+
+        recv_counts.assign(p, 0);
+        MPI_Ialltoall(send_counts.data(), 1, size_dt.type(), recv_counts.data(), 1, size_dt.type(), comm, &req);
+      }
+
+      async_query(async_query const &) = delete;
+      async_query & operator=(async_query const &) = delete;
+
+      /// completes the query, so its collectives are matched on all ranks.
+      virtual ~async_query() {
+        wait();
+      }
+
+      /// advance without blocking.  if another thread is advancing the query, only reports whether it is done.
+      virtual bool test() {
+        if (finished) return true;
+        ::std::unique_lock<::std::mutex> lock(progress_mutex, ::std::try_to_lock);
+        if (!lock.owns_lock()) return finished;
+
+        while (stage != DONE) {
+          int flag = 0;
+          MPI_Test(&req, &flag, MPI_STATUS_IGNORE);
+          if (!flag) return false;
+          advance();
+        }
+        finished = true;
+        return true;
+      }
+
+      virtual void wait() {
+        if (finished) return;
+        ::std::lock_guard<::std::mutex> lock(progress_mutex);
+        while (stage != DONE) {
+          MPI_Wait(&req, MPI_STATUS_IGNORE);
+          advance();
+        }
+        finished = true;
+      }
+
+      /// results, in no particular order.  waits.
+      ::std::vector<Result> & get() {
+        wait();
+        return results;
+      }
+  };
+
+
+  /**
+   * @brief handle of a non-blocking find or count.  copies share the query.
+   * @details  the map must not be changed or destroyed until the query completes.
+   */
+  template <typename Key, typename Result>
+  class query_handle {
+    protected:
+      ::std::shared_ptr<async_query<Key, Result> > q;
+
+    public:
+      query_handle() {}
+      explicit query_handle(::std::shared_ptr<async_query<Key, Result> > const & _q) : q(_q) {}
+
+      bool valid() const { return static_cast<bool>(q); }
+
+      /// advance without blocking.  true when the results are ready.
+      bool test() { return q->test(); }
+
+      void wait() { q->wait(); }
+
+      /// results, in no particular order.  waits.
+      ::std::vector<Result> & get() { return q->get(); }
+  };
+
+
+  /**
+   * @brief background thread that advances outstanding queries by calling their test().
+   * @details  the thread sleeps while there is nothing to advance.  on destruction it finishes the queries it holds,
+   *           then joins.  MPI is called from this thread and the caller's at once, so MPI_THREAD_MULTIPLE is required,
+   *           see supported().
+   */
+  class async_progress_thread {
+    protected:
+      ::std::mutex m;
+      ::std::condition_variable cv;
+      ::std::vector<::std::shared_ptr<async_query_base> > incoming;
+      bool stopping;
+      ::std::thread worker;
+
+      void run() {
+        ::std::vector<::std::shared_ptr<async_query_base> > active;
+        while (true) {
+          {
+            ::std::unique_lock<::std::mutex> lock(m);
+            if (active.empty()) cv.wait(lock, [this]() { return stopping || !incoming.empty(); });
+            active.insert(active.end(), incoming.begin(), incoming.end());
+            incoming.clear();
+            if (stopping && active.empty()) return;
+          }
+
+          active.erase(::std::remove_if(active.begin(), active.end(),
+                                        [](::std::shared_ptr<async_query_base> const & q) { return q->test(); }),
+                       active.end());
+          if (!active.empty()) ::std::this_thread::yield();
+        }
+      }
+
+    public:
+      /// true if MPI was initialized with MPI_THREAD_MULTIPLE.
+      static bool supported() {
+        int provided = MPI_THREAD_SINGLE;
+        MPI_Query_thread(&provided);
+        return provided == MPI_THREAD_MULTIPLE;
+      }
+
+      async_progress_thread() : stopping(false) {
+        worker = ::std::thread(&async_progress_thread::run, this);
+      }
+
+      async_progress_thread(async_progress_thread const &) = delete;
+      async_progress_thread & operator=(async_progress_thread const &) = delete;
+
+      ~async_progress_thread() {
+        {
+          ::std::lock_guard<::std::mutex> lock(m);
+          stopping = true;
+        }
+        cv.notify_all();
+        worker.join();
+      }
+
+      /// advance q in the background until it is done.
+      void add(::std::shared_ptr<async_query_base> const & q) {
+        {
+          ::std::lock_guard<::std::mutex> lock(m);
+          incoming.emplace_back(q);
+        }
+        cv.notify_one();
+      }
+  };
+
+
+  /**
+   * @brief communicators for concurrent non-blocking queries, one per outstanding query.
+   * @details  the n-th query started uses channel n mod size.  queries are started collectively in the same order on
+   *           all ranks, so each rank picks the same channel, and waiting for the previous query on the channel keeps
+   *           the collectives on it in order.
+   */
+  class async_query_channels {
+    protected:
+      ::std::vector<::mxx::comm> comms;
+      ::std::vector<::std::weak_ptr<async_query_base> > last;
+      size_t next;
+      /// advances the queries in the background, if enabled.  destroyed before the communicators.
+      ::std::unique_ptr<async_progress_thread> progress;
+
+    public:
+      explicit async_query_channels(size_t n = 4) : last(::std::max(n, static_cast<size_t>(1))), next(0) {}
+
+      /// communicator for the next query, after the previous query on it completes.  collective.
+      MPI_Comm acquire(::mxx::comm const & parent) {
+        if (comms.empty()) {
+          for (size_t i = 0; i < last.size(); ++i) comms.emplace_back(parent.copy());
+        }
+        size_t i = next % last.size();
+        ::std::shared_ptr<async_query_base> prev = last[i].lock();
+        if (prev) prev->wait();
+        return comms[i];
+      }
+
+      /// record the query started on the channel returned by the last acquire.
+      void attach(::std::shared_ptr<async_query_base> const & q) {
+        last[next % last.size()] = q;
+        ++next;
+        if (progress) progress->add(q);
+      }
+
+      /**
+       * @brief  start or stop the background progress thread.  stopping finishes the queries it holds.
+       * @return  true if the thread runs.  false if MPI does not provide MPI_THREAD_MULTIPLE.
+       */
+      bool set_progress_thread(bool v) {
+        if (!v) {
+          progress.reset();
+          return false;
+        }
+        if (!async_progress_thread::supported()) return false;
+        if (!progress) progress.reset(new async_progress_thread());
+        return true;
+      }
+      bool is_progress_thread() const {
+        return static_cast<bool>(progress);
+      }
+  };
+
+} /* namespace dsc */
+
+#endif /* SRC_CONTAINERS_DISTRIBUTED_ASYNC_QUERY_HPP_ */
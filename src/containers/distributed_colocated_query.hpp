@@ -0,0 +1,236 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    distributed_colocated_query.hpp
+ * @ingroup containers
+ * @author  tpan
+ * @brief   query several distributed maps that place every key on the same rank, with 1 query distribution.
+ * @details a count map and a position map built with the same DistHash and DistTrans params own the same keys on each
+ *          rank.  querying each separately transforms, hashes and distributes the same keys once per map.
+ *          colocated_count and colocated_find do that once, look the received keys up in every map's local
+ *          container, and send the results back:  1 all2allv for counts of all maps together, and 1 per map for finds,
+ *          since each map returns a different number of entries.
+ *
+ *          the maps must have the same key type and input transform (checked at compile time), and the same key to
+ *          rank mapping (checked at run time on a sample of the query keys).  the maps' query filters are not used.
+ */
+#ifndef SRC_CONTAINERS_DISTRIBUTED_COLOCATED_QUERY_HPP_
+#define SRC_CONTAINERS_DISTRIBUTED_COLOCATED_QUERY_HPP_
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <mxx/collective.hpp>
+#include <mxx/reduction.hpp>
+
+#include "containers/dsc_container_utils.hpp"
+#include "io/incremental_mxx.hpp"
+#include "io/scratch_pool.hpp"
+#include "utils/benchmark_utils.hpp"
+#include "utils/comm_stats.hpp"
+
+
+namespace dsc
+{
+
+  namespace detail
+  {
+    /// true if the maps have the same key type and input transform.
+    template <typename... Maps>
+    struct same_query;
+    template <typename M>
+    struct same_query<M> : ::std::true_type {};
+    template <typename M1, typename M2, typename... Maps>
+    struct same_query<M1, M2, Maps...> : ::std::integral_constant<bool,
+      ::std::is_same<typename M1::key_type, typename M2::key_type>::value &&
+      ::std::is_same<typename M1::input_transform_type, typename M2::input_transform_type>::value &&
+      same_query<M2, Maps...>::value> {};
+
+    /// number of query keys per rank used to check that the maps agree on the key to rank mapping.
+    constexpr size_t colocated_check_samples = 64;
+
+    template <typename Key, typename KeyToRank>
+    bool same_ranks(::std::vector<Key> const &, KeyToRank const &) { return true; }
+    template <typename Key, typename KeyToRank, typename Map, typename... Maps>
+    bool same_ranks(::std::vector<Key> const & keys, KeyToRank const & key_to_rank, Map const & map, Maps const &... maps) {
+      auto const & other = map.get_key_to_rank();
+      for (size_t i = 0; i < ::std::min(keys.size(), colocated_check_samples); ++i)
+        if (other(keys[i]) != key_to_rank(keys[i])) return false;
+      return same_ranks(keys, key_to_rank, maps...);
+    }
+
+    /// transform the keys with the first map's input transform, check the maps are colocated, and distribute the keys
+    /// to their owners.  collective.  returns the number of keys received from each rank.
+    template <typename Key, typename Map, typename... Maps>
+    ::std::vector<size_t> colocated_distribute(::std::vector<Key> & keys, Map const & map, Maps const &... maps) {
+      auto const & comm = map.get_comm();
+      map.transform_input(keys);
+
+      ::std::vector<size_t> recv_counts;
+      if (comm.size() == 1) {
+        recv_counts.emplace_back(keys.size());
+        return recv_counts;
+      }
+
+      if (!::mxx::all_of(same_ranks(keys, map.get_key_to_rank(), maps...), comm))
+        throw ::std::invalid_argument("colocated query:  maps do not place keys on the same ranks.");
+
+      ::imxx::scratch::buffer<size_t> i2o(comm);
+      ::imxx::scratch::buffer<Key> buffer(comm);
+      i2o.reserve(keys.size());
+      buffer.reserve(keys.size());
+      ::imxx::distribute(keys, map.get_key_to_rank(), recv_counts, *i2o, *buffer, comm);
+      keys.swap(*buffer);
+      return recv_counts;
+    }
+
+    /// local count of the received keys in each map, into column I onward.
+    template <size_t I, typename Key, typename Result>
+    void colocated_local_count(::std::vector<Key> const &, Result &) {}
+    template <size_t I, typename Key, typename Result, typename Map, typename... Maps>
+    void colocated_local_count(::std::vector<Key> const & keys, Result & results, Map const & map, Maps const &... maps) {
+      auto const & c = map.get_local_container();
+      for (size_t i = 0; i < keys.size(); ++i) {
+        results[i].second[I] = c.count(keys[i]);
+      }
+      colocated_local_count<I + 1>(keys, results, maps...);
+    }
+
+    /// local find of the received keys in each map, then return the entries to the querying ranks.  collective.
+    template <size_t I, typename Key, typename Result>
+    void colocated_local_find(::std::vector<Key> const &, ::std::vector<size_t> const &, Result &) {}
+    template <size_t I, typename Key, typename Result, typename Map, typename... Maps>
+    void colocated_local_find(::std::vector<Key> const & keys, ::std::vector<size_t> const & recv_counts,
+                              Result & results, Map const & map, Maps const &... maps) {
+      auto const & comm = map.get_comm();
+      auto const & c = map.get_local_container();
+      auto & found = ::std::get<I>(results);
+      found.clear();
+      found.reserve(keys.size());
+
+      ::std::vector<size_t> send_counts(recv_counts.size(), 0);
+      auto it = keys.begin();
+      for (size_t r = 0; r < recv_counts.size(); ++r) {
+        size_t before = found.size();
+        for (size_t j = 0; j < recv_counts[r]; ++j, ++it) {
+          auto range = c.equal_range(*it);
+          for (auto f = range.first; f != range.second; ++f) found.emplace_back(f->first, f->second);
+        }
+        send_counts[r] = found.size() - before;
+      }
+
+      if (comm.size() > 1) {
+        ::mxx::all2allv(found, send_counts, comm).swap(found);
+        BL_COMM_RECORD("respond", sizeof(typename ::std::decay<decltype(found)>::type::value_type), send_counts, found.size());
+      }
+      colocated_local_find<I + 1>(keys, recv_counts, results, maps...);
+    }
+
+  } // namespace detail
+
+
+  /**
+   * @brief count each key in several colocated maps.  collective.
+   * @details  see file description.  results are in the distributed order of the keys, as with count.
+   * @param keys  content is transformed and reordered.
+   * @return  (key, count in each map, in argument order), 1 per key.
+   */
+  template <typename Map, typename... Maps>
+  ::std::vector<::std::pair<typename Map::key_type, ::std::array<size_t, 1 + sizeof...(Maps)> > >
+  colocated_count(::std::vector<typename Map::key_type> & keys, Map const & map, Maps const &... maps) {
+    static_assert(detail::same_query<Map, Maps...>::value,
+                  "colocated maps need the same key type and input transform.");
+    using Key = typename Map::key_type;
+
+    BL_BENCH_INIT(count);
+    BL_COMM_SCOPE(colocated_count);
+    auto const & comm = map.get_comm();
+    ::std::vector<::std::pair<Key, ::std::array<size_t, 1 + sizeof...(Maps)> > > results;
+
+    if (::dsc::empty(keys, comm)) {
+      BL_BENCH_REPORT_MPI_NAMED(count, "colocated:count", comm);
+      return results;
+    }
+
+    BL_BENCH_COLLECTIVE_START(count, "dist_query", comm);
+    ::std::vector<size_t> recv_counts = detail::colocated_distribute(keys, map, maps...);
+    BL_BENCH_END(count, "dist_query", keys.size());
+
+    BL_BENCH_START(count);
+    results.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) results[i].first = keys[i];
+    detail::colocated_local_count<0>(keys, results, map, maps...);
+    BL_BENCH_END(count, "local_count", results.size());
+
+    BL_BENCH_COLLECTIVE_START(count, "a2a2", comm);
+    // one result per query, so the receive counts are the query send counts.
+    if (comm.size() > 1) {
+      ::mxx::all2allv(results, recv_counts, comm).swap(results);
+      BL_COMM_RECORD("respond", sizeof(results[0]), recv_counts, results.size());
+    }
+    BL_BENCH_END(count, "a2a2", results.size());
+
+    BL_BENCH_REPORT_MPI_NAMED(count, "colocated:count", comm);
+    return results;
+  }
+
+  /**
+   * @brief find each key in several colocated maps.  collective.
+   * @details  see file description.  the keys are distributed once, and the entries of each map are returned with 1
+   *           all2allv per map.
+   * @param keys  content is transformed and reordered.  should be unique, as with find.
+   * @return  tuple of the found (key, value) entries of each map, in argument order.
+   */
+  template <typename Map, typename... Maps>
+  ::std::tuple<::std::vector<::std::pair<typename Map::key_type, typename Map::mapped_type> >,
+               ::std::vector<::std::pair<typename Maps::key_type, typename Maps::mapped_type> >...>
+  colocated_find(::std::vector<typename Map::key_type> & keys, Map const & map, Maps const &... maps) {
+    static_assert(detail::same_query<Map, Maps...>::value,
+                  "colocated maps need the same key type and input transform.");
+
+    BL_BENCH_INIT(find);
+    BL_COMM_SCOPE(colocated_find);
+    auto const & comm = map.get_comm();
+    ::std::tuple<::std::vector<::std::pair<typename Map::key_type, typename Map::mapped_type> >,
+                 ::std::vector<::std::pair<typename Maps::key_type, typename Maps::mapped_type> >...> results;
+
+    if (::dsc::empty(keys, comm)) {
+      BL_BENCH_REPORT_MPI_NAMED(find, "colocated:find", comm);
+      return results;
+    }
+
+    BL_BENCH_COLLECTIVE_START(find, "dist_query", comm);
+    ::std::vector<size_t> recv_counts = detail::colocated_distribute(keys, map, maps...);
+    BL_BENCH_END(find, "dist_query", keys.size());
+
+    BL_BENCH_COLLECTIVE_START(find, "find_a2a2", comm);
+    detail::colocated_local_find<0>(keys, recv_counts, results, map, maps...);
+    BL_BENCH_END(find, "find_a2a2", ::std::get<0>(results).size());
+
+    BL_BENCH_REPORT_MPI_NAMED(find, "colocated:find", comm);
+    return results;
+  }
+
+} // namespace dsc
+
+
+#endif /* SRC_CONTAINERS_DISTRIBUTED_COLOCATED_QUERY_HPP_ */
@@ -0,0 +1,390 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    distributed_cqf_count_map.hpp
+ * @ingroup containers
+ * @author  tpan
+ * @brief   distributed approximate k-mer counter:  a counting quotient filter per rank.
+ * @details for screening spectra where the exact keys are not needed.  keys go to their ranks with the DistHash, as in
+ *          counting_densehash_map, and each rank counts them in a ::fsc::counting_quotient_filter over the StoreHash,
+ *          at a few bytes per distinct key.  received keys are hashed and sorted, and merged into the filter as 1 batch.
+ *
+ *          counts are never less than the true counts.  a key that was not inserted has a nonzero count with
+ *          probability at most the filter's fp_rate (doubled for each time a filter grew past its reserved size).
+ *
+ *          the interface follows counting_densehash_map for insert, find, count, find_aligned and count_aligned.
+ *          keys are not stored, so to_vector, keys, save, and redistribute throw std::logic_error, and erase and update
+ *          are not provided.  sizes are numbers of distinct fingerprints.
+ */
+#ifndef SRC_CONTAINERS_DISTRIBUTED_CQF_COUNT_MAP_HPP_
+#define SRC_CONTAINERS_DISTRIBUTED_CQF_COUNT_MAP_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <mxx/collective.hpp>
+#include <mxx/reduction.hpp>
+
+#include "containers/distributed_map_base.hpp"
+#include "containers/dsc_container_utils.hpp"
+#include "containers/counting_quotient_filter.hpp"
+#include "common/bit_ops.hpp"
+#include "utils/benchmark_utils.hpp"
+#include "utils/comm_stats.hpp"
+#include "utils/filter_utils.hpp"
+#include "io/incremental_mxx.hpp"
+
+
+namespace dsc  // distributed std container
+{
+
+  /**
+   * @brief distributed approximate count map, with a counting quotient filter per rank.  see file description.
+   * @tparam Key        key type.
+   * @tparam T          count type.
+   * @tparam MapParams  same parameters as for the hash maps.  keys are distributed with the DistHash, and fingerprinted
+   *                    with the StoreHash.
+   */
+  template<typename Key, typename T,
+    template <typename> class MapParams,
+    class Alloc = ::std::allocator< ::std::pair<const Key, T> >
+  >
+  class cqf_count_map : public ::dsc::map_base<Key, T, MapParams, Alloc> {
+      static_assert(::std::is_integral<T>::value, "count type has to be integral");
+
+    protected:
+      using Base = ::dsc::map_base<Key, T, MapParams, Alloc>;
+
+    public:
+      using local_container_type = ::fsc::counting_quotient_filter<Key, T, typename Base::StoreTransformedFunc>;
+      using key_type              = Key;
+      using mapped_type           = T;
+      using value_type            = ::std::pair<const Key, T>;
+      using size_type             = size_t;
+
+      /// same distribution as counting_densehash_map.
+      struct KeyToRank {
+          typename Base::DistTransformedFunc proc_trans_hash;
+          const int p;
+
+          KeyToRank(int comm_size) :
+            proc_trans_hash(typename Base::DistFunc(ceilLog2(comm_size)),
+                            typename Base::DistTrans()),
+            p(comm_size) {};
+
+          inline int operator()(Key const & x) const {
+            return proc_trans_hash(x) % p;
+          }
+          template<typename V>
+          inline int operator()(::std::pair<Key, V> const & x) const {
+            return this->operator()(x.first);
+          }
+          template<typename V>
+          inline int operator()(::std::pair<const Key, V> const & x) const {
+            return this->operator()(x.first);
+          }
+      };
+
+    protected:
+      KeyToRank key_to_rank;
+
+      local_container_type c;
+
+      /// fingerprints of the keys, with count 1, or of the pairs, with their counts, and merge them into the filter.
+      void local_insert(::std::vector<Key> const & input) {
+        ::std::vector<::std::pair<uint64_t, uint64_t> > fps;
+        fps.reserve(input.size());
+        for (auto const & k : input) fps.emplace_back(c.fingerprint(k), 1);
+        c.insert_fingerprints(fps);
+      }
+      void local_insert(::std::vector<::std::pair<Key, T> > const & input) {
+        ::std::vector<::std::pair<uint64_t, uint64_t> > fps;
+        fps.reserve(input.size());
+        for (auto const & x : input) fps.emplace_back(c.fingerprint(x.first), static_cast<uint64_t>(x.second));
+        c.insert_fingerprints(fps);
+      }
+
+      /// send the entries to their ranks and count them.  input is already transformed.  collective.
+      template <typename V>
+      size_t add(::std::vector<V> & input) {
+        BL_BENCH_INIT(add);
+
+        if (this->comm.size() == 1) {
+          BL_BENCH_START(add);
+          local_insert(input);
+          BL_BENCH_END(add, "local", input.size());
+
+          BL_BENCH_REPORT_MPI_NAMED(add, "cqf_count_map:add", this->comm);
+          return input.size();
+        }
+
+        BL_BENCH_START(add);
+        ::std::vector<size_t> recv_counts;
+        ::std::vector<V> buffer;
+        ::imxx::distribute(input, key_to_rank, recv_counts, buffer, this->comm);
+        BL_BENCH_END(add, "distribute", buffer.size());
+
+        BL_BENCH_START(add);
+        local_insert(buffer);
+        BL_BENCH_END(add, "local", buffer.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(add, "cqf_count_map:add", this->comm);
+        return buffer.size();
+      }
+
+      /// approximate counts of the keys, in input order.  keys are already transformed.  collective.
+      ::std::vector<T> query_aligned(::std::vector<Key> & keys) const {
+        ::std::vector<T> results;
+        if (this->comm.size() == 1) {
+          results.resize(keys.size());
+          for (size_t i = 0; i < keys.size(); ++i) results[i] = c.count(keys[i]);
+          return results;
+        }
+
+        ::std::vector<size_t> recv_counts;
+        ::std::vector<size_t> i2o;
+        ::std::vector<Key> buffer;
+        ::imxx::distribute(keys, key_to_rank, recv_counts, i2o, buffer, this->comm, true);
+
+        ::std::vector<T> ans(buffer.size());
+        for (size_t i = 0; i < buffer.size(); ++i) ans[i] = c.count(buffer[i]);
+
+        ::imxx::undistribute(ans, recv_counts, i2o, results, this->comm, true);
+        return results;
+      }
+
+      virtual void local_reset() {
+        c.clear();
+      }
+      virtual void local_clear() {
+        c.clear();
+      }
+      /// n distinct keys on this rank.
+      virtual void local_reserve(size_t n) {
+        c.reserve(n);
+      }
+
+      virtual void local_load(::std::pair<Key, T> const * first, ::std::pair<Key, T> const * last) {
+        local_insert(::std::vector<::std::pair<Key, T> >(first, last));
+      }
+
+      virtual void load_distribute(::std::vector<::std::pair<Key, T> > & input) {
+        this->add(input);
+      }
+
+      /// keys are not stored.
+      virtual void local_batches(size_t const & batch_size, typename Base::batch_op_type const & op) const {
+        throw ::std::logic_error("cqf_count_map does not store keys.");
+      }
+
+    public:
+      /**
+       * @param fp_rate     false positive rate of each rank's filter, at its reserved size.
+       * @param count_bits  bits of a filter counter.  see ::fsc::counting_quotient_filter.
+       */
+      cqf_count_map(const mxx::comm& _comm, double fp_rate = 1.0 / 256, unsigned int count_bits = 8) :
+        Base(_comm), key_to_rank(_comm.size()), c(0, fp_rate, count_bits) {}
+
+      virtual ~cqf_count_map() {};
+
+      KeyToRank const & get_key_to_rank() const { return key_to_rank; }
+
+      local_container_type const & get_local_container() const { return c; }
+
+      /// bytes of this rank's filter.
+      size_t local_memory_bytes() const { return c.memory_bytes(); }
+
+      // ============= data access.  keys are not stored.
+
+      virtual void to_vector(::std::vector<::std::pair<Key, T> > & result) const {
+        throw ::std::logic_error("cqf_count_map does not store keys.");
+      }
+
+      virtual void keys(::std::vector<Key> & result) const {
+        throw ::std::logic_error("cqf_count_map does not store keys.");
+      }
+
+      using Base::to_vector;
+      using Base::keys;
+
+      virtual bool local_empty() const {
+        return c.empty();
+      }
+      /// number of distinct fingerprints on this rank.
+      virtual size_t local_size() const {
+        return c.size();
+      }
+      virtual size_t local_unique_size() const {
+        return c.size();
+      }
+
+      // ============= modifiers.  collective.
+
+      /**
+       * @brief count the keys.  input is transformed in place.  collective.
+       * @return  number of keys counted on this rank.
+       */
+      template <typename Predicate = ::bliss::filter::TruePredicate>
+      size_t insert(::std::vector<Key>& input, bool sorted_input = false, Predicate const & pred = Predicate()) {
+        BL_BENCH_INIT(insert);
+        BL_COMM_SCOPE(insert);
+
+        if (::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(insert, "cqf_count_map:insert", this->comm);
+          return 0;
+        }
+
+        BL_BENCH_START(insert);
+        this->transform_input(input);
+        if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          input.erase(::std::remove_if(input.begin(), input.end(), [&pred](Key const & k) { return !pred(k); }), input.end());
+        BL_BENCH_END(insert, "transform_input", input.size());
+
+        BL_BENCH_START(insert);
+        size_t count = this->add(input);
+        BL_BENCH_END(insert, "add", count);
+
+        BL_BENCH_REPORT_MPI_NAMED(insert, "cqf_count_map:insert", this->comm);
+        return count;
+      }
+
+      /// add the given counts.  input is transformed in place.  collective.
+      template <typename Predicate = ::bliss::filter::TruePredicate>
+      size_t insert(::std::vector<::std::pair<Key, T> >& input, bool sorted_input = false, Predicate const & pred = Predicate()) {
+        BL_BENCH_INIT(insert);
+        BL_COMM_SCOPE(insert);
+
+        if (::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(insert, "cqf_count_map:insert", this->comm);
+          return 0;
+        }
+
+        BL_BENCH_START(insert);
+        this->transform_input(input);
+        if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          input.erase(::std::remove_if(input.begin(), input.end(),
+                                       [&pred](::std::pair<Key, T> const & x) { return !pred(x); }), input.end());
+        BL_BENCH_END(insert, "transform_input", input.size());
+
+        BL_BENCH_START(insert);
+        size_t count = this->add(input);
+        BL_BENCH_END(insert, "add", count);
+
+        BL_BENCH_REPORT_MPI_NAMED(insert, "cqf_count_map:insert", this->comm);
+        return count;
+      }
+
+      // ============= queries.  collective.  keys are transformed as in insert.
+
+      /// approximate counts, with values[i] for keys[i], or missing if keys[i] has count 0.  keys is not modified.
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<T> find_aligned(::std::vector<Key> const & keys, T const & missing = T(),
+                                    Predicate const& pred = Predicate()) const {
+        ::std::vector<T> results;
+        if (::dsc::empty(keys, this->comm)) return results;
+
+        ::std::vector<Key> transformed;
+        this->transform_input(keys, transformed);
+        results = this->query_aligned(transformed);
+        for (size_t i = 0; i < results.size(); ++i) {
+          if ((results[i] == T(0)) ||
+              (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value &&
+               !pred(::std::make_pair(transformed[i], results[i])))) results[i] = missing;
+        }
+        return results;
+      }
+
+      /// 1 if keys[i] has a nonzero count, else 0.  keys is not modified.
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<size_type> count_aligned(::std::vector<Key> const & keys, Predicate const& pred = Predicate()) const {
+        ::std::vector<T> found = this->find_aligned(keys, T(0), pred);
+        ::std::vector<size_type> results(found.size());
+        for (size_t i = 0; i < found.size(); ++i) results[i] = (found[i] == T(0)) ? 0 : 1;
+        return results;
+      }
+
+      /**
+       * @brief (key, count) of the keys with nonzero counts.  keys are returned transformed, once per query unless
+       *        remove_duplicate.  keys is not modified.
+       */
+      template <bool remove_duplicate = false, class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, T> > find(::std::vector<Key>& keys, bool sorted_input = false,
+                                               Predicate const& pred = Predicate()) const {
+        BL_BENCH_INIT(find);
+        BL_COMM_SCOPE(find);
+        ::std::vector<::std::pair<Key, T> > results;
+
+        if (::dsc::empty(keys, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(find, "cqf_count_map:find", this->comm);
+          return results;
+        }
+
+        BL_BENCH_START(find);
+        ::std::vector<Key> transformed;
+        this->transform_input(keys, transformed);
+        if (remove_duplicate) ::fsc::unique(transformed, sorted_input, typename Base::StoreTransformedFunc(),
+                                            typename Base::StoreTransformedEqual());
+        BL_BENCH_END(find, "transform_input", transformed.size());
+
+        BL_BENCH_START(find);
+        ::std::vector<T> found = this->query_aligned(transformed);
+        BL_BENCH_END(find, "query", found.size());
+
+        BL_BENCH_START(find);
+        for (size_t i = 0; i < found.size(); ++i) {
+          if (found[i] == T(0)) continue;
+          ::std::pair<Key, T> x(transformed[i], found[i]);
+          if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value || pred(x)) results.emplace_back(x);
+        }
+        BL_BENCH_END(find, "results", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(find, "cqf_count_map:find", this->comm);
+        return results;
+      }
+
+      /// (key, 0 or 1) per query.  keys are returned transformed, once per query unless remove_duplicate.
+      template <bool remove_duplicate = false, class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, size_type> > count(::std::vector<Key>& keys, bool sorted_input = false,
+                                                        Predicate const& pred = Predicate() ) const {
+        ::std::vector<::std::pair<Key, size_type> > results;
+        if (::dsc::empty(keys, this->comm)) return results;
+
+        ::std::vector<Key> transformed;
+        this->transform_input(keys, transformed);
+        if (remove_duplicate) ::fsc::unique(transformed, sorted_input, typename Base::StoreTransformedFunc(),
+                                            typename Base::StoreTransformedEqual());
+        ::std::vector<T> found = this->query_aligned(transformed);
+
+        results.reserve(found.size());
+        for (size_t i = 0; i < found.size(); ++i) {
+          bool in = (found[i] != T(0)) &&
+              (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value || pred(::std::make_pair(transformed[i], found[i])));
+          results.emplace_back(transformed[i], in ? 1 : 0);
+        }
+        return results;
+      }
+  };
+
+
+} /* namespace dsc */
+
+
+#endif /* SRC_CONTAINERS_DISTRIBUTED_CQF_COUNT_MAP_HPP_ */
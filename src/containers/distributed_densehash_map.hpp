@@ -51,8 +51,10 @@
 #include <iterator>  // advance, distance
 
 #include <cstdint>  // for uint8, etc.
+#include <limits>   // numeric_limits
 
 #include <type_traits>
+#include <memory>     // shared_ptr
 
 #include <mxx/collective.hpp>
 #include <mxx/reduction.hpp>
@@ -60,11 +62,19 @@
 
 #include "containers/distributed_map_base.hpp"
 #include "containers/densehash_map.hpp"
+#include "containers/concurrent_count_table.hpp"
+#include "containers/distributed_rma_index.hpp"
+#include "containers/distributed_mphf_index.hpp"
+#include "containers/distributed_shm_index.hpp"
+#include "containers/distributed_async_query.hpp"
+#include "containers/group_hash_map.hpp"
 
 #include "utils/benchmark_utils.hpp"  // for timing.
+#include "utils/comm_stats.hpp"     // for communication volume.
 #include "utils/logging.h"
 #include "utils/transform_utils.hpp"
 #include "utils/filter_utils.hpp"
+#include "utils/sketch_utils.hpp"
 
 
 #include "common/kmer_transform.hpp"
@@ -167,6 +177,28 @@ namespace dsc  // distributed std container
           inline int operator()(::std::pair<const Key, V> const & x) const {
             return this->operator()(x.first);
           }
+
+          /// batch version, out[i] = operator()(in[i]).  hashes a block at a time with the batch hash.
+          template <typename ID>
+          inline void ranks(Key const * in, size_t n, ID * out) const {
+            uint64_t h[256];
+            size_t m;
+            for (size_t i = 0; i < n; i += m) {
+              m = ::std::min(static_cast<size_t>(256), n - i);
+              proc_trans_hash.hash(in + i, m, h);
+              for (size_t j = 0; j < m; ++j) out[i + j] = h[j] % p;
+            }
+          }
+
+          /// rank from a precomputed hash, e.g. from RollingHashKmerSlidingWindow, without hashing the key again.
+          /// same as operator() when the hash is DistHash of the DistTrans transformed key, e.g. a canonical nthash with lex_less.
+          inline int rank_of_hash(uint64_t const & h) const {
+            return h % p;
+          }
+          template <typename ID>
+          inline void ranks_from_hashes(uint64_t const * h, size_t n, ID * out) const {
+            for (size_t i = 0; i < n; ++i) out[i] = h[i] % p;
+          }
       } key_to_rank;
 
       /**
@@ -178,6 +210,40 @@ namespace dsc  // distributed std container
        */
       struct QueryProcessor {  // assume unique, always.
 
+          /// number of queries whose buckets are prefetched ahead of the one being resolved.
+          static constexpr size_t prefetch_distance = 16;
+
+          template <class DB, class QueryIter, class OutputIter, class Operator, class Predicate, class Transform>
+          static size_t process_impl(DB &db, QueryIter query_begin, QueryIter query_end,
+                                     OutputIter &output, Operator & op,
+                                     Predicate const & pred, Transform const & trans, ::std::false_type) {
+              size_t count = 0;  // before size.
+				for (auto it = query_begin; it != query_end; ++it) {
+				  count += op(db, *it, output, pred, trans);
+				}
+              return count;
+          }
+          /// pipelined:  each lookup is a likely cache miss on a large table, so keep prefetch_distance bucket loads in flight.
+          template <class DB, class QueryIter, class OutputIter, class Operator, class Predicate, class Transform>
+          static size_t process_impl(DB &db, QueryIter query_begin, QueryIter query_end,
+                                     OutputIter &output, Operator & op,
+                                     Predicate const & pred, Transform const & trans, ::std::true_type) {
+              QueryIter pf = query_begin;
+              for (size_t i = 0; (i < prefetch_distance) && (pf != query_end); ++i, ++pf) {
+                db.prefetch(*pf);
+              }
+
+              size_t count = 0;  // before size.
+              for (auto it = query_begin; it != query_end; ++it) {
+                if (pf != query_end) {
+                  db.prefetch(*pf);
+                  ++pf;
+                }
+                count += op(db, *it, output, pred, trans);
+              }
+              return count;
+          }
+
           // assumes that container is sorted. and exact overlap region is provided.  do not filter output here since it's an output iterator.
           template <class DB, class QueryIter, class OutputIter, class Operator,
 		  	  class Predicate = ::bliss::filter::TruePredicate,
@@ -191,15 +257,62 @@ namespace dsc  // distributed std container
 
               if (query_begin == query_end) return 0;
 
-              size_t count = 0;  // before size.
-				for (auto it = query_begin; it != query_end; ++it) {
-				  count += op(db, *it, output, pred, trans);
-				}
-              return count;
+              return process_impl(db, query_begin, query_end, output, op, pred, trans,
+                                  ::std::integral_constant<bool, ::fsc::detail::has_prefetch<DB, Key>::value>());
+          }
+
+          /// process, split among threads for a large query range.  results are appended in query order.  see ::fsc::parallel_lookup.
+          template <class DB, class QueryIter, class Result, class Operator,
+		  	  class Predicate = ::bliss::filter::TruePredicate,
+		  	  class Transform = ::bliss::transform::identity<Key> >
+          static size_t process_parallel(DB const &db,
+                                         QueryIter query_begin, QueryIter query_end,
+                                         ::std::vector<Result> & results, Operator const & op,
+                                         bool sorted_query = false,
+                                         Predicate const & pred = Predicate(),
+                                         Transform const & trans = Transform() ) {
+              using View = ::fsc::frozen<DB>;
+              using Output = ::fsc::back_emplace_iterator<::std::vector<Result> >;
+              return ::fsc::parallel_lookup(::fsc::freeze(db), query_begin, query_end, results,
+                  [&op, sorted_query, &pred, &trans](View const & view, QueryIter first, QueryIter last, Output & output) {
+                    return process(view, first, last, output, op, sorted_query, pred, trans);
+                  });
           }
 
       };
 
+      template <typename InputIt, typename Op>
+      void for_each_prefetched_impl(InputIt first, InputIt last, Op op, ::std::false_type) const {
+        for (auto it = first; it != last; ++it) op(*it);
+      }
+      template <typename InputIt, typename Op>
+      void for_each_prefetched_impl(InputIt first, InputIt last, Op op, ::std::true_type) const {
+        ::fsc::sparsehash::prefetched_for_each(this->c, first, last, op, QueryProcessor::prefetch_distance);
+      }
+      /// op on each (key, value) pair in [first, last), prefetching the local container buckets ahead if it can.  for local inserts.
+      template <typename InputIt, typename Op>
+      void for_each_prefetched(InputIt first, InputIt last, Op op) const {
+        for_each_prefetched_impl(first, last, op,
+                                 ::std::integral_constant<bool, ::fsc::detail::has_prefetch<local_container_type, Key>::value>());
+      }
+
+      template <typename Iter>
+      void locality_order_impl(Iter first, Iter last, ::std::true_type) const {
+        this->c.locality_order(first, last);
+      }
+      template <typename Iter>
+      void locality_order_impl(Iter, Iter, ::std::false_type) const {}
+      /**
+       * @brief  reorder received entries or keys [first, last) by the region of the local table they go to, if the local
+       *         container can, so a large local insert walks the table a cache sized region at a time.  see
+       *         ::fsc::densehash_map::locality_order.  for the insert paths that do not go through c.insert(vector).
+       */
+      template <typename Iter>
+      void locality_order(Iter first, Iter last) const {
+        locality_order_impl(first, last,
+                            ::std::integral_constant<bool, ::fsc::detail::has_locality_order<local_container_type, Iter>::value>());
+      }
+
       template <typename K>
       using StoreTrans = typename MapParams<Key>::template StorageTransform<K>;
       template <typename K>
@@ -214,6 +327,15 @@ namespace dsc  // distributed std container
 		  ::fsc::sparsehash::compare<Key, StoreEqual, StoreTrans>,
 		  Alloc, SpecialKeys::need_to_split>;
 
+      /// local container with the same key handling but a different mapped type, e.g. for sample counts.
+      template <typename V>
+      using local_container_of = Container<Key, V,
+          SpecialKeys,
+          StoreTrans,
+          typename Base::StoreTransformedFunc,
+          ::fsc::sparsehash::compare<Key, StoreEqual, StoreTrans>,
+          ::std::allocator< ::std::pair<const Key, V> >, SpecialKeys::need_to_split>;
+
       // std::densehash_multimap public members.
       using key_type              = typename local_container_type::key_type;
       using mapped_type           = typename local_container_type::mapped_type;
@@ -226,11 +348,574 @@ namespace dsc  // distributed std container
       using size_type             = typename local_container_type::size_type;
       using difference_type       = typename local_container_type::difference_type;
 
+      /// a query key set routed once, for repeated count, find and update calls on the same keys.  see prepare_query.
+      struct prepared_query {
+          ::std::shared_ptr<::imxx::routing_plan<size_t> > plan;
+          /// the transformed keys routed to this rank, grouped by source rank.
+          ::std::vector<Key> keys;
+      };
+
     protected:
       local_container_type c;
 
       mutable bool local_changed;
 
+      /// estimate distinct keys arriving at this rank and reserve once before local insert.  see presize.
+      bool presize_local;
+      /// global distinct key estimate from the last presize, merged over all ranks.
+      size_t distinct_estimate;
+
+      /// keep query buffers and a persistent count exchange across find and count calls.  see set_reuse_query_buffers.
+      bool reuse_query;
+
+      /// buffers kept between find and count calls when reuse_query is set.
+      struct QueryBuffers {
+          ::std::shared_ptr<::imxx::persistent_counts<size_t> > counts;
+          ::std::vector<size_t> i2o;
+          ::std::vector<Key> keys;
+          ::std::vector<::std::pair<Key, T> > found;
+          ::std::vector<::std::pair<Key, size_type> > counted;
+      };
+      mutable QueryBuffers qbuf;
+
+      /// max query keys per rank for find_overlap to use the sparse exchange.  0 disables.  see set_sparse_query_max.
+      size_t sparse_query_max;
+      /// alternates the sparse exchange tags between consecutive calls.
+      mutable int sparse_epoch;
+      /// answer the keys this rank owns locally, outside the query exchange.  see set_split_self_query.
+      bool split_self;
+
+      /// communicators of outstanding find_async and count_async queries.  shared, so the map stays copyable.
+      mutable ::std::shared_ptr<::dsc::async_query_channels> async_channels;
+
+      /// transform, deduplicate and group the keys by owner for a non-blocking query.  returns keys per rank.  local.
+      template <bool remove_duplicate>
+      ::std::vector<size_t> async_prepare(::std::vector<Key> & keys) const {
+        this->transform_input(keys);
+        if (remove_duplicate) {
+          bool sorted_input = false;
+          ::fsc::unique(keys, sorted_input,
+                        typename Base::StoreTransformedFunc(),
+                        typename Base::StoreTransformedEqual());
+        }
+
+        ::std::vector<size_t> send_counts;
+        ::imxx::local::count_buckets(keys, this->key_to_rank, this->comm.size(), send_counts);
+        ::imxx::local::partition_inplace(keys, this->key_to_rank, send_counts);
+        return send_counts;
+      }
+
+      /// start a non-blocking query.  collective.
+      template <typename R>
+      ::dsc::query_handle<Key, R> async_start(::std::vector<Key> && keys, ::std::vector<size_t> && send_counts,
+                                              typename ::dsc::async_query<Key, R>::answer_func const & answer,
+                                              bool one_per_query) const {
+        if (!async_channels) async_channels.reset(new ::dsc::async_query_channels());
+        MPI_Comm qcomm = async_channels->acquire(this->comm);
+        ::std::shared_ptr<::dsc::async_query<Key, R> > q(
+            new ::dsc::async_query<Key, R>(qcomm, ::std::move(keys), ::std::move(send_counts), answer, one_per_query));
+        async_channels->attach(q);
+        return ::dsc::query_handle<Key, R>(q);
+      }
+
+      /**
+       * @brief  query with the keys this rank owns kept out of the exchange.  see imxx::distribute_split_self.  collective.
+       * @details  own keys are answered from c, straight into results, while the other keys are exchanged.  the answers to
+       *           the received keys are then returned into results after them, so results hold this rank's own answers
+       *           first and the remote answers by owner rank.
+       * @param one_per_key  element gives exactly 1 result per key, as for count, so no result counts are exchanged.
+       */
+      template <typename R, typename Element, typename Predicate>
+      void query_split_self(::std::vector<Key> & keys, ::std::vector<R> & results, Element & element, bool one_per_key,
+                            bool sorted_input, Predicate const & pred) const {
+        ::std::vector<size_t> send_counts, recv_counts;
+        ::fsc::back_emplace_iterator<::std::vector<R> > emplace_iter(results);
+        auto own = [&](typename ::std::vector<Key>::iterator first, typename ::std::vector<Key>::iterator last) {
+          size_t sent = ::std::accumulate(send_counts.begin(), send_counts.end(), static_cast<size_t>(0));
+          results.reserve(::std::distance(first, last) + (one_per_key ? sent : 0));
+          QueryProcessor::process(c, first, last, emplace_iter, element, sorted_input, pred);
+        };
+        ::imxx::scratch::buffer<Key> received(this->comm);
+        ::imxx::distribute_split_self(keys, this->key_to_rank, send_counts, recv_counts, *received, own, this->comm);
+
+        // answer the received keys, grouped by source rank.
+        ::std::vector<R> answers;
+        answers.reserve(received->size());
+        ::fsc::back_emplace_iterator<::std::vector<R> > answer_iter(answers);
+        ::std::vector<size_t> answer_counts(this->comm.size(), 0);
+        auto start = received->begin();
+        auto end = start;
+        for (int i = 0; i < this->comm.size(); ++i) {
+          ::std::advance(end, recv_counts[i]);
+          answer_counts[i] = QueryProcessor::process(c, start, end, answer_iter, element, sorted_input, pred);
+          start = end;
+        }
+
+        // return the answers.  with 1 per key, each rank gets back as many as it sent.
+        ::std::vector<size_t> result_counts(send_counts);
+        if (!one_per_key) ::imxx::counts_all2all(answer_counts.data(), 1, result_counts.data(), this->comm);
+        size_t own_size = results.size();
+        results.resize(own_size + ::std::accumulate(result_counts.begin(), result_counts.end(), static_cast<size_t>(0)));
+        ::imxx::wire_all2allv(answers.data(), answer_counts, results.data() + own_size, result_counts, this->comm);
+        BL_COMM_RECORD("respond", sizeof(R), answer_counts, results.size() - own_size);
+      }
+
+      /**
+       * @brief  start a non-blocking find.  collective.  see find_async in the subclasses.
+       * @param keys  taken over by the query.
+       */
+      template <bool remove_duplicate = false, class LocalFind, typename Predicate = ::bliss::filter::TruePredicate>
+      ::dsc::query_handle<Key, ::std::pair<Key, T> > find_async(LocalFind const & find_element, ::std::vector<Key> keys,
+                                                                Predicate const & pred = Predicate()) const {
+        ::std::vector<size_t> send_counts = this->template async_prepare<remove_duplicate>(keys);
+
+        LocalFind const * fe = &find_element;
+        auto answer = [this, fe, pred](Key const * first, Key const * last, ::std::vector<::std::pair<Key, T> > & out) {
+          ::fsc::back_emplace_iterator<::std::vector<::std::pair<Key, T> > > emplace_iter(out);
+          QueryProcessor::process(this->c, first, last, emplace_iter, *fe, false, pred);
+        };
+        return this->template async_start<::std::pair<Key, T> >(::std::move(keys), ::std::move(send_counts), answer, false);
+      }
+
+      /// Bloom filter of the keys of all ranks, replicated.  see set_query_filter.
+      ::bliss::utils::sketch::bloom_filter query_filter;
+      /// query_filter was built.  it is skipped once the map changes, see use_query_filter.
+      bool query_filtered;
+
+      /// tombstone fraction above which erase rebuilds the local table.  0 disables.  see set_compact_ratio.
+      double compact_ratio;
+
+      template <typename C>
+      void maybe_compact_impl(C &, ::std::false_type) {}
+      template <typename C>
+      void maybe_compact_impl(C & cc, ::std::true_type) {
+        if ((compact_ratio > 0.0) && (cc.deleted_ratio() > compact_ratio)) cc.compact();
+      }
+      /// after a local erase:  rebuild the local table if tombstones exceed compact_ratio.  local.
+      void maybe_compact() {
+        maybe_compact_impl(c, ::std::integral_constant<bool, ::fsc::detail::has_compact<local_container_type>::value>());
+      }
+
+      template <typename C, typename Pred>
+      static auto retain_if_impl(C & cc, Pred const & pred, int) -> decltype(cc.retain_if(pred)) {
+        return cc.retain_if(pred);
+      }
+      template <typename C, typename Pred>
+      static size_t retain_if_impl(C & cc, Pred const & pred, long) {
+        return cc.erase([&pred](typename C::value_type const & x) { return !pred(x); });
+      }
+
+      /// true if the query filter is built and no rank changed since.  collective.
+      bool use_query_filter() const {
+        if (!query_filtered || (this->comm.size() == 1)) return false;
+        return ::mxx::all_of(!local_changed, this->comm);
+      }
+
+      /**
+       * @brief  drop transformed query keys that the query filter rules out, i.e. keys not in the map on any rank.
+       * @param absent  if not null, dropped keys are appended.
+       * @return  number of keys dropped.
+       */
+      size_t query_prefilter(::std::vector<Key> & keys, ::std::vector<Key> * absent = nullptr) const {
+        ::std::vector<uint64_t> hashes;
+        this->sketch_hashes(keys, hashes);
+
+        size_t out = 0;
+        for (size_t i = 0; i < keys.size(); ++i) {
+          if (query_filter.test(hashes[i])) {
+            if (out != i) keys[out] = keys[i];
+            ++out;
+          } else if (absent != nullptr) {
+            absent->emplace_back(keys[i]);
+          }
+        }
+        size_t dropped = keys.size() - out;
+        keys.erase(keys.begin() + out, keys.end());
+        return dropped;
+      }
+
+      /// true if every rank has at most sparse_query_max keys.  collective.
+      bool use_sparse_query(size_t const nkeys) const {
+        if (sparse_query_max == 0) return false;
+        bool small = (nkeys <= sparse_query_max);
+        return ::mxx::all_of(small, this->comm);
+      }
+
+      /**
+       * @brief  find for small batches: keys go out with imxx::sparse_distribute, results come back point to point.
+       * @details  only ranks that were sent queries answer, and only to the ranks that queried them, so the latency
+       *           follows the number of actual destinations rather than comm size.  results are in source rank order.
+       */
+      template <class LocalFind, typename Predicate>
+      ::std::vector<::std::pair<Key, T> > find_sparse(LocalFind & find_element, ::std::vector<Key>& keys,
+                                                      bool sorted_input, Predicate const& pred) const {
+        // above the tags used by find_overlap's point to point messages.
+        int qtag = 32760 + (sparse_epoch & 1);
+        int rtag = 32762 + (sparse_epoch & 1);
+        ++sparse_epoch;
+
+        std::vector<size_t> send_counts, recv_counts;
+        {
+          std::vector<Key> buffer;
+          ::imxx::sparse_distribute(keys, this->key_to_rank, send_counts, recv_counts, buffer, this->comm, qtag);
+          keys.swap(buffer);
+        }
+
+        // answer each querying rank.
+        int p = this->comm.size();
+        size_t nsrc = ::std::count_if(recv_counts.begin(), recv_counts.end(), [](size_t x) { return x > 0; });
+        ::std::vector<::std::vector<::std::pair<Key, T> > > answers(nsrc);
+        auto start = keys.begin();
+        size_t j = 0;
+        for (int i = 0; i < p; ++i) {
+          if (recv_counts[i] == 0) continue;
+          auto end = start + recv_counts[i];
+          ::fsc::back_emplace_iterator<::std::vector<::std::pair<Key, T> > > emplace_iter(answers[j]);
+          QueryProcessor::process(this->c, start, end, emplace_iter, find_element, sorted_input, pred);
+          start = end;
+          ++j;
+        }
+
+        mxx::datatype dt = mxx::get_datatype<::std::pair<Key, T> >();
+        ::std::vector<MPI_Request> reqs(nsrc);
+        j = 0;
+        for (int i = 0; i < p; ++i) {
+          if (recv_counts[i] == 0) continue;
+          MPI_Isend(answers[j].data(), answers[j].size(), dt.type(), i, rtag, this->comm, &reqs[j]);
+          ++j;
+        }
+
+        // every queried rank replies, possibly with nothing.
+        ::std::vector<::std::pair<Key, T> > results;
+        for (int i = 0; i < p; ++i) {
+          if (send_counts[i] == 0) continue;
+          MPI_Status status;
+          int count = 0;
+          MPI_Probe(i, rtag, this->comm, &status);
+          MPI_Get_count(&status, dt.type(), &count);
+          size_t offset = results.size();
+          results.resize(offset + count);
+          MPI_Recv(&(results[offset]), count, dt.type(), i, rtag, this->comm, MPI_STATUS_IGNORE);
+        }
+        MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+
+        return results;
+      }
+
+      /**
+       * @brief  query with the answers passed to visitor in chunks as they are produced or arrive, instead of returned.  collective.
+       * @details  keys are distributed as for find.  the answers to this rank's own keys are passed to visitor first.  then
+       *           each rank answers the other ranks' keys a few at a time into 2 send buffers of about chunk_size answers,
+       *           sent point to point and refilled once the send completes.  an empty message ends the answers to a rank.
+       *           meanwhile, arriving chunks are received into 1 reused buffer and passed to visitor in arrival order.  so
+       *           about 3 chunks of answers are held at a time, however many the query has.  a chunk ends on a key boundary,
+       *           so a key with more than chunk_size answers gives a larger chunk.
+       *
+       *           the key exchange of the next query cannot complete before this rank receives all its answers, so 1 tag
+       *           is enough.
+       * @param visitor      visitor(R const * first, R const * last), called on the calling thread.
+       * @param one_per_key  element gives 1 answer per key, as for count.  keys are then answered even if the map is empty,
+       *                     and the query filter is not applied.
+       * @return  number of answers passed to visitor on this rank.
+       */
+      template <typename R, bool remove_duplicate, class Element, class Visitor, typename Predicate>
+      size_t query_each(Element & element, ::std::vector<Key>& keys, Visitor & visitor, size_t const chunk_size,
+                        bool one_per_key, bool sorted_input, Predicate const & pred) const {
+        BL_BENCH_INIT(query_each);
+        BL_COMM_SCOPE(query_each);
+
+        if ((!one_per_key && this->empty()) || ::dsc::empty(keys, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(query_each, "base_densehash:query_each", this->comm);
+          return 0;
+        }
+
+        BL_BENCH_START(query_each);
+        this->transform_input(keys);
+        if (remove_duplicate)
+          ::fsc::unique(keys, sorted_input,
+                        typename Base::StoreTransformedFunc(),
+                        typename Base::StoreTransformedEqual());
+        if (!one_per_key && this->use_query_filter()) this->query_prefilter(keys);
+        BL_BENCH_END(query_each, "transform_input", keys.size());
+
+        // answers for [next, end) into buf, a few keys at a time, until about chunk_size.  empty only once next == end.
+        using KeyIter = typename ::std::vector<Key>::iterator;
+        auto fill = [this, &element, chunk_size, sorted_input, &pred](::std::vector<R> & buf, KeyIter & next, KeyIter end) {
+          buf.clear();
+          ::fsc::back_emplace_iterator<::std::vector<R> > emplace_iter(buf);
+          while ((next != end) && (buf.size() < chunk_size)) {
+            KeyIter last = next + ::std::min(static_cast<size_t>(::std::distance(next, end)), QueryProcessor::prefetch_distance);
+            QueryProcessor::process(this->c, next, last, emplace_iter, element, sorted_input, pred);
+            next = last;
+          }
+        };
+
+        size_t total = 0;
+        ::std::vector<R> sbuf[2];
+        KeyIter next = keys.begin();
+        KeyIter end = keys.end();
+
+        if (this->comm.size() == 1) {
+          BL_BENCH_START(query_each);
+          while (next != end) {
+            fill(sbuf[0], next, end);
+            if (sbuf[0].empty()) continue;
+            visitor(sbuf[0].data(), sbuf[0].data() + sbuf[0].size());
+            total += sbuf[0].size();
+          }
+          BL_BENCH_END(query_each, "local_visit", total);
+
+          BL_BENCH_REPORT_MPI_NAMED(query_each, "base_densehash:query_each", this->comm);
+          return total;
+        }
+
+        BL_BENCH_COLLECTIVE_START(query_each, "dist_query", this->comm);
+        std::vector<size_t> recv_counts;
+        {
+          ::imxx::scratch::buffer<size_t> i2o(this->comm);
+          ::imxx::scratch::buffer<Key> buffer(this->comm);
+          i2o.reserve(keys.size());
+          buffer.reserve(keys.size());
+          ::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+          keys.swap(*buffer);
+        }
+        BL_BENCH_END(query_each, "dist_query", keys.size());
+
+        int p = this->comm.size();
+        int rank = this->comm.rank();
+        auto recv_displs = mxx::impl::get_displacements(recv_counts);
+        auto range = [&](int r) {
+          next = keys.begin() + recv_displs[r];
+          end = next + recv_counts[r];
+        };
+
+        // own keys.
+        BL_BENCH_START(query_each);
+        range(rank);
+        while (next != end) {
+          fill(sbuf[0], next, end);
+          if (sbuf[0].empty()) continue;
+          visitor(sbuf[0].data(), sbuf[0].data() + sbuf[0].size());
+          total += sbuf[0].size();
+        }
+        BL_BENCH_END(query_each, "local_visit", total);
+        size_t own = total;
+
+        // other ranks' keys, in the same order as find_overlap, while receiving.
+        BL_BENCH_START(query_each);
+        int const tag = 32764;
+        mxx::datatype dt = mxx::get_datatype<R>();
+        MPI_Request sreq[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+        ::std::vector<R> rbuf;
+        ::std::vector<size_t> sent(p, 0);
+        int dest = 1;     // offset of the rank being answered.  p when all are answered.
+        int ended = 0;    // ranks whose answers all arrived.
+        range((rank + dest) % p);
+        while ((dest < p) || (ended < p - 1)) {
+          for (int s = 0; (s < 2) && (dest < p); ++s) {
+            int free = 1;
+            if (sreq[s] != MPI_REQUEST_NULL) MPI_Test(&sreq[s], &free, MPI_STATUS_IGNORE);
+            if (!free) continue;
+
+            int to = (rank + dest) % p;
+            fill(sbuf[s], next, end);
+            MPI_Isend(sbuf[s].data(), sbuf[s].size(), dt.type(), to, tag, this->comm, &sreq[s]);
+            sent[to] += sbuf[s].size();
+            if (sbuf[s].empty()) {   // ended.
+              if (++dest < p) range((rank + dest) % p);
+            }
+          }
+
+          while (ended < p - 1) {
+            int flag = 0;
+            MPI_Status status;
+            MPI_Iprobe(MPI_ANY_SOURCE, tag, this->comm, &flag, &status);
+            if (!flag) break;
+
+            int count = 0;
+            MPI_Get_count(&status, dt.type(), &count);
+            rbuf.resize(count);
+            MPI_Recv(rbuf.data(), count, dt.type(), status.MPI_SOURCE, tag, this->comm, MPI_STATUS_IGNORE);
+            if (count == 0) {
+              ++ended;
+            } else {
+              visitor(rbuf.data(), rbuf.data() + count);
+              total += count;
+            }
+          }
+        }
+        MPI_Waitall(2, sreq, MPI_STATUSES_IGNORE);
+        BL_BENCH_END(query_each, "stream", total);
+        BL_COMM_RECORD("respond", sizeof(R), sent, total - own);
+
+        BL_BENCH_REPORT_MPI_NAMED(query_each, "base_densehash:query_each", this->comm);
+        return total;
+      }
+
+      /// distribute query keys through the kept buffers.  receive counts are left in qbuf.counts.  collective.
+      void query_distribute(::std::vector<Key> & keys) const {
+        if (!qbuf.counts) qbuf.counts.reset(new ::imxx::persistent_counts<size_t>(this->comm));
+        ::imxx::distribute(keys, this->key_to_rank, *(qbuf.counts), qbuf.i2o, qbuf.keys, this->comm);
+        keys.swap(qbuf.keys);
+      }
+
+      /// send query results back, receiving into a kept buffer.  the old results storage is kept in its place.  collective.
+      template <typename V>
+      void query_return(::std::vector<V> & results, ::std::vector<size_t> const & send_counts,
+                        ::std::vector<size_t> const & recv_counts, ::std::vector<V> & buffer) const {
+        size_t total = ::std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0));
+        if (buffer.capacity() < total) buffer.clear();
+        buffer.resize(total);
+        ::imxx::wire_all2allv(results.data(), send_counts, buffer.data(), recv_counts, this->comm);
+        results.swap(buffer);
+      }
+
+      /// sketch hash.  sketches remix the bits, so the distribution prefix bits do not matter.
+      typename Base::StoreTransformedFarmHash sketch_hash;
+
+      static inline Key const & sketch_key(Key const & x) { return x; }
+      template <typename V>
+      static inline Key const & sketch_key(::std::pair<Key, V> const & x) { return x.first; }
+
+      /// sketch hash of every entry.  computed once per insert and shared by sketch_filter and presize.
+      template <typename V>
+      void sketch_hashes(::std::vector<V> const & input, ::std::vector<uint64_t> & hashes) const {
+        hashes.resize(input.size());
+        for (size_t i = 0; i < input.size(); ++i) hashes[i] = sketch_hash(sketch_key(input[i]));
+      }
+      /// keys are contiguous, so use the batch hash.
+      void sketch_hashes(::std::vector<Key> const & input, ::std::vector<uint64_t> & hashes) const {
+        hashes.resize(input.size());
+        sketch_hash.hash(input.data(), input.size(), hashes.data());
+      }
+
+      /**
+       * @brief  HyperLogLog pass over the already distributed input, then a single resize of the local container.
+       * @details  registers are merged with allreduce to get the global distinct estimate.  collective.
+       *           the container is sized for its current size plus the estimate (inflated by 3 standard errors),
+       *           so keys already in the container are counted twice.  that errs on the side of not rehashing.
+       * @param hashes  sketch hashes of input.
+       */
+      void presize(size_t input_size, ::std::vector<uint64_t> const & hashes) {
+        if (!presize_local) return;
+
+        ::bliss::utils::sketch::hyperloglog<> hll;
+        for (auto const & h : hashes) hll.update(h);
+
+        double est = hll.estimate();
+        size_t n = ::std::min(input_size,
+                              static_cast<size_t>(::std::ceil(est * (1.0 + 3.0 * hll.error()))));
+        if (n > 0) this->c.resize(this->c.size() + n);
+
+        if (this->comm.size() > 1) {
+          hll.registers() = ::mxx::allreduce(hll.registers(), [](uint8_t const & x, uint8_t const & y) {
+            return ::std::max(x, y);
+          }, this->comm);
+        }
+        distinct_estimate = static_cast<size_t>(hll.estimate());
+      }
+      template <typename V>
+      void presize(::std::vector<V> const & input) {
+        if (!presize_local) return;
+
+        ::std::vector<uint64_t> hashes;
+        sketch_hashes(input, hashes);
+        presize(input.size(), hashes);
+      }
+
+      /// sketch hash of an entry, for the per destination sketches of imxx::distribute.
+      struct SketchHasher {
+          typename Base::StoreTransformedFarmHash const & h;
+          inline uint64_t operator()(Key const & x) const { return h(x); }
+          template <typename V>
+          inline uint64_t operator()(::std::pair<Key, V> const & x) const { return h(x.first); }
+      };
+
+      /**
+       * @brief  distribute input for insert.  with presize on, the receivers' distinct counts are estimated from
+       *         sketches exchanged with the send counts, and the local container is resized once from that.  collective.
+       * @details  replaces the HyperLogLog pass over the received input in presize.  the global estimate is the sum over
+       *           ranks, since each key is received by 1 rank.
+       */
+      template <typename V>
+      void distribute_presize(::std::vector<V> & input) {
+        std::vector<size_t> recv_counts;
+        std::vector<size_t> i2o;
+        std::vector<V> buffer;
+        if (!presize_local) {
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          input.swap(buffer);
+          return;
+        }
+
+        double est = 0;
+        ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm, SketchHasher{sketch_hash}, est);
+        input.swap(buffer);
+
+        double error = ::bliss::utils::sketch::hyperloglog< ::imxx::distinct_sketch_precision>::error();
+        size_t n = ::std::min(input.size(), static_cast<size_t>(::std::ceil(est * (1.0 + 3.0 * error))));
+        if (n > 0) this->c.resize(this->c.size() + n);
+        distinct_estimate = ::mxx::allreduce(static_cast<size_t>(est), this->comm);
+      }
+
+      static inline size_t sketch_weight(Key const &) { return 1; }
+      template <typename V>
+      static inline size_t sketch_weight(::std::pair<Key, V> const & x) { return x.second; }
+
+      /**
+       * @brief  drop entries whose key occurs fewer than min_count times in input, using a count-min sketch.  local.
+       * @details  input is already distributed.  for (key, count) pairs the count is the weight.  count-min never
+       *           undercounts, so no key with at least min_count occurrences is dropped, but some rarer keys remain.
+       *           keys already in the local container are kept.  the sketch is 2x the estimated distinct keys wide, 4 deep,
+       *           with 1 byte counters, so min_count is capped at 255.
+       * @param hashes  sketch hashes of input.  compacted along with input.
+       * @return  number of entries removed.
+       */
+      template <typename V>
+      size_t sketch_filter(::std::vector<V> & input, size_t min_count, ::std::vector<uint64_t> & hashes) {
+        if ((min_count < 2) || input.empty()) return 0;
+        min_count = ::std::min(min_count, static_cast<size_t>(::std::numeric_limits<uint8_t>::max()));
+
+        ::bliss::utils::sketch::hyperloglog<> hll;
+        for (auto const & h : hashes) hll.update(h);
+
+        ::bliss::utils::sketch::count_min<uint8_t> cms(2 * static_cast<size_t>(hll.estimate()) + 1, 4);
+        for (size_t i = 0; i < input.size(); ++i) cms.update(hashes[i], sketch_weight(input[i]));
+
+        size_t out = 0;
+        for (size_t i = 0; i < input.size(); ++i) {
+          if ((cms.estimate(hashes[i]) < min_count) && (this->c.count(sketch_key(input[i])) == 0)) continue;
+          if (out != i) {
+            input[out] = ::std::move(input[i]);
+            hashes[out] = hashes[i];
+          }
+          ++out;
+        }
+        size_t removed = input.size() - out;
+        input.erase(input.begin() + out, input.end());
+        hashes.resize(out);
+        return removed;
+      }
+      template <typename V>
+      size_t sketch_filter(::std::vector<V> & input, size_t min_count) {
+        if ((min_count < 2) || input.empty()) return 0;
+
+        ::std::vector<uint64_t> hashes;
+        sketch_hashes(input, hashes);
+        return sketch_filter(input, min_count, hashes);
+      }
+
+      /// sketch_filter then presize, hashing each entry once for both.
+      template <typename V>
+      void sketch_filter_presize(::std::vector<V> & input, size_t min_count) {
+        if ((min_count < 2) && !presize_local) return;
+
+        ::std::vector<uint64_t> hashes;
+        sketch_hashes(input, hashes);
+        sketch_filter(input, min_count, hashes);
+        presize(input.size(), hashes);
+      }
+
       struct LocalCount {
           // filtered element-wise.
           template<class DB, typename Query, class OutputIter,
@@ -330,6 +1015,7 @@ namespace dsc  // distributed std container
 				   bool sorted_input = false,
 				   Predicate const& pred = Predicate()) const {
           BL_BENCH_INIT(find);
+          BL_COMM_SCOPE(find);
 
           ::std::vector<::std::pair<Key, T> > results;
 
@@ -352,16 +1038,36 @@ namespace dsc  // distributed std container
   						typename Base::StoreTransformedEqual());
   		BL_BENCH_END(find, "unique", keys.size());
 
-            if (this->comm.size() > 1) {
+          if (this->use_query_filter()) {
+            BL_BENCH_START(find);
+            this->query_prefilter(keys);
+            BL_BENCH_END(find, "query_filter", keys.size());
+          }
+
+            if ((this->comm.size() > 1) && this->split_self && !this->reuse_query) {
+
+              BL_BENCH_COLLECTIVE_START(find, "split_self", this->comm);
+              this->query_split_self(keys, results, find_element, false, sorted_input, pred);
+              BL_BENCH_END(find, "split_self", results.size());
+
+            } else if (this->comm.size() > 1) {
 
               BL_BENCH_COLLECTIVE_START(find, "dist_query", this->comm);
               // distribute (communication part)
               std::vector<size_t> recv_counts;
-              {
-				  std::vector<size_t> i2o;
-				  std::vector<Key > buffer;
-				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-				  keys.swap(buffer);
+              if (this->reuse_query) {
+                this->query_distribute(keys);
+                recv_counts = this->qbuf.counts->recv_counts();
+                results.swap(this->qbuf.found);
+                results.clear();
+              } else {
+				  // scratch buffers from the communicator's pool, reused across queries.
+				  ::imxx::scratch::buffer<size_t> i2o(this->comm);
+				  ::imxx::scratch::buffer<Key> buffer(this->comm);
+				  i2o.reserve(keys.size());
+				  buffer.reserve(keys.size());
+				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+				  keys.swap(*buffer);
 	  //            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
 	  //            				typename Base::StoreTransformedFunc(),
 	  //            				typename Base::StoreTransformedEqual()).swap(recv_counts);
@@ -401,7 +1107,7 @@ namespace dsc  // distributed std container
               req_sofar += recv_counts[i];
 
               // work on query from process i.
-              send_counts[i] = QueryProcessor::process(c, start, end, emplace_iter, find_element, sorted_input, pred);
+              send_counts[i] = QueryProcessor::process_parallel(c, start, end, results, find_element, sorted_input, pred);
               // if (this->comm.rank() == 0) BL_DEBUGF("R %d added %d results for %d queries for process %d\n", this->comm.rank(), send_counts[i], recv_counts[i], i);
 
               start = end;
@@ -412,7 +1118,14 @@ namespace dsc  // distributed std container
 
             BL_BENCH_COLLECTIVE_START(find, "a2a2", this->comm);
             // send back using the constructed recv count
-            mxx::all2allv(results, send_counts, this->comm).swap(results);
+            if (this->reuse_query) {
+              auto & pc = *(this->qbuf.counts);
+              ::std::copy(send_counts.begin(), send_counts.end(), pc.send_counts().begin());
+              pc.exchange();
+              this->query_return(results, send_counts, pc.recv_counts(), this->qbuf.found);
+            } else
+              mxx::all2allv(results, send_counts, this->comm).swap(results);
+              BL_COMM_RECORD("respond", sizeof(results[0]), send_counts, results.size());
             BL_BENCH_END(find, "a2a2", results.size());
 
           } else {
@@ -434,7 +1147,7 @@ namespace dsc  // distributed std container
             BL_BENCH_END(find, "reserve_est", results.capacity());
 
             BL_BENCH_START(find);
-            QueryProcessor::process(c, keys.begin() + estimating, keys.end(), emplace_iter, find_element, sorted_input, pred);
+            QueryProcessor::process_parallel(c, keys.begin() + estimating, keys.end(), results, find_element, sorted_input, pred);
             BL_BENCH_END(find, "local_find", results.size());
 
             if (this->comm.rank() == 0) printf("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
@@ -449,6 +1162,198 @@ namespace dsc  // distributed std container
 
 
 
+      /**
+       * @brief find the keys of a prepared query.  collective.
+       * @details  the number of results per key varies, so only the result counts are exchanged.
+       */
+      template <class LocalFind>
+      ::std::vector<::std::pair<Key, T> > find(LocalFind & find_element, prepared_query const & q) const {
+        BL_BENCH_INIT(find);
+        BL_COMM_SCOPE(find);
+        ::std::vector<::std::pair<Key, T> > results;
+
+        BL_BENCH_START(find);
+        results.reserve(q.keys.size());
+        ::fsc::back_emplace_iterator<::std::vector<::std::pair<Key, T> > > emplace_iter(results);
+        ::std::vector<size_t> const & recv_counts = q.plan->recv_counts();
+        std::vector<size_t> send_counts(this->comm.size(), 0);
+        auto start = q.keys.begin();
+        auto end = start;
+        for (int i = 0; i < this->comm.size(); ++i) {
+          ::std::advance(end, recv_counts[i]);
+          send_counts[i] = QueryProcessor::process(c, start, end, emplace_iter, find_element);
+          start = end;
+        }
+        BL_BENCH_END(find, "local_find", results.size());
+
+        if (this->comm.size() > 1) {
+          BL_BENCH_COLLECTIVE_START(find, "a2a2", this->comm);
+          std::vector<size_t> result_counts(this->comm.size(), 0);
+          ::imxx::counts_all2all(send_counts.data(), 1, result_counts.data(), this->comm);
+          ::std::vector<::std::pair<Key, T> > buffer(::std::accumulate(result_counts.begin(), result_counts.end(), static_cast<size_t>(0)));
+          ::imxx::wire_all2allv(results.data(), send_counts, buffer.data(), result_counts, this->comm);
+          BL_COMM_RECORD("respond", sizeof(results[0]), send_counts, result_counts);
+          results.swap(buffer);
+          BL_BENCH_END(find, "a2a2", results.size());
+        }
+
+        BL_BENCH_REPORT_MPI_NAMED(find, "base_densehash:find_prepared", this->comm);
+        return results;
+      }
+
+      /**
+       * @brief  the values for the keys of a prepared query, without the keys.  collective.
+       * @details  the answers are counted first, as in find_overlap, and the counts (as uint32_t) and then the values are
+       *           returned.  a (Key, T) response repeats the key the querying rank already has, so this sends about
+       *           sizeof(T) + 4 instead of sizeof((Key, T)) bytes per answer.  see routing_plan::respond_variable.
+       * @param offsets  values for the i-th prepared key are [offsets[i], offsets[i + 1]).
+       */
+      template <class LocalFind, typename Predicate>
+      ::std::vector<T> find_values(LocalFind & find_element, prepared_query const & q, ::std::vector<size_t> & offsets,
+                                   Predicate const & pred) const {
+        BL_BENCH_INIT(find_values);
+        BL_COMM_SCOPE(find_values);
+
+        BL_BENCH_START(find_values);
+        ::std::vector<uint32_t> counts;
+        ::std::vector<T> values;
+        this->local_values(find_element, q.keys, counts, values, pred,
+                           ::std::integral_constant<bool, ::fsc::detail::has_equal_range_span<local_container_type, Key>::value &&
+                                                          ::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value>());
+        BL_BENCH_END(find_values, "local_find", values.size());
+
+        BL_BENCH_COLLECTIVE_START(find_values, "a2a2", this->comm);
+        ::std::vector<T> results;
+        q.plan->respond_variable(values, counts, results, offsets);
+        BL_BENCH_END(find_values, "a2a2", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(find_values, "base_densehash:find_values", this->comm);
+        return results;
+      }
+
+      /// counts, as in local_counts, and then the values of keys, in the order of keys.  for find_values.
+      template <class LocalFind, typename Predicate>
+      void local_values(LocalFind & find_element, ::std::vector<Key> const & keys, ::std::vector<uint32_t> & counts,
+                        ::std::vector<T> & values, Predicate const & pred, ::std::false_type) const {
+        this->local_counts(keys, counts, pred);
+
+        ::std::vector<::std::pair<Key, T> > found;
+        found.reserve(::std::accumulate(counts.begin(), counts.end(), static_cast<size_t>(0)));
+        ::fsc::back_emplace_iterator<::std::vector<::std::pair<Key, T> > > emplace_iter(found);
+        QueryProcessor::process(c, keys.begin(), keys.end(), emplace_iter, find_element, false, pred);
+        values.reserve(found.size());
+        for (auto const & x : found) values.emplace_back(x.second);
+      }
+      /// local_values for containers that keep the entries of a key contiguous:  1 pass over the spans, without the
+      /// counting pass and the intermediate (Key, T) copies.
+      template <class LocalFind, typename Predicate>
+      void local_values(LocalFind &, ::std::vector<Key> const & keys, ::std::vector<uint32_t> & counts,
+                        ::std::vector<T> & values, Predicate const & pred, ::std::true_type) const {
+        using Output = ::fsc::back_emplace_iterator<::std::vector<T> >;
+        counts.reserve(keys.size());
+        values.reserve(keys.size());
+        Output emplace_iter(values);
+        auto span_values = [&counts](local_container_type const & db, Key const & k, Output & output,
+                                     Predicate const &, ::bliss::transform::identity<Key> const &) -> size_t {
+          auto entries = db.equal_range_span(k);
+          uint32_t n = static_cast<uint32_t>(::std::min(entries.size(), static_cast<size_t>(::std::numeric_limits<uint32_t>::max())));
+          counts.emplace_back(n);
+          for (uint32_t i = 0; i < n; ++i, ++output) *output = entries[i].second;
+          return n;
+        };
+        QueryProcessor::process(c, keys.begin(), keys.end(), emplace_iter, span_values, false, pred);
+      }
+
+      /// count of each key, as uint32_t, saturated.  1 per key, in the order of keys.
+      template <typename Predicate>
+      void local_counts(::std::vector<Key> const & keys, ::std::vector<uint32_t> & counts, Predicate const & pred) const {
+        ::std::vector<::std::pair<Key, size_type> > counted;
+        counted.reserve(keys.size());
+        ::fsc::back_emplace_iterator<::std::vector<::std::pair<Key, size_type> > > emplace_iter(counted);
+        QueryProcessor::process(c, keys.begin(), keys.end(), emplace_iter, count_element, false, pred);
+
+        counts.resize(counted.size());
+        for (size_t i = 0; i < counted.size(); ++i) {
+          counts[i] = static_cast<uint32_t>(::std::min(static_cast<size_t>(counted[i].second),
+                                                       static_cast<size_t>(::std::numeric_limits<uint32_t>::max())));
+        }
+      }
+
+      /**
+       * @brief update the entries of a prepared query's keys.  collective.
+       * @param values  1 per prepared key, in the order the keys were given to prepare_query.
+       * @param op      updater, as for update.
+       */
+      template <typename V, typename Updater>
+      size_t update(prepared_query const & q, ::std::vector<V> const & values, Updater const & op) {
+        BL_BENCH_INIT(update);
+
+        BL_BENCH_COLLECTIVE_START(update, "route", this->comm);
+        ::std::vector<V> routed;
+        q.plan->route(values, routed);
+        ::std::vector<::std::pair<Key, V> > input;
+        input.reserve(routed.size());
+        for (size_t i = 0; i < routed.size(); ++i) input.emplace_back(q.keys[i], routed[i]);
+        BL_BENCH_END(update, "route", input.size());
+
+        BL_BENCH_START(update);
+        size_t count = this->c.update(input, op);
+        BL_BENCH_END(update, "update", count);
+
+        BL_BENCH_REPORT_MPI_NAMED(update, "base_densehash:update_prepared", this->comm);
+        return count;
+      }
+
+      /**
+       * @brief apply op(value, v) to every existing entry with key k, for each (k, v) in input, at the owner.  collective.
+       * @details  no data is returned, so iterative updates, e.g. abundance re-estimation, need no find and insert
+       *           round trip.  absent keys are skipped.  op returns the number of entries it changed (0 or 1).
+       * @param input  transformed and redistributed in place.
+       * @return  number of entries updated on this rank.
+       */
+      template <typename V, typename Updater>
+      size_t update(std::vector<::std::pair<Key, V> >& input, bool sorted_input, Updater const & op ) {
+        BL_BENCH_INIT(update);
+        BL_COMM_SCOPE(update);
+
+        if (this->empty() || ::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(update, "base_densehash:update", this->comm);
+          return 0;
+        }
+
+        BL_BENCH_START(update);
+        this->transform_input(input);
+        BL_BENCH_END(update, "transform_intput", input.size());
+
+        if (this->comm.size() > 1) {
+          BL_BENCH_COLLECTIVE_START(update, "distribute", this->comm);
+          std::vector<size_t> recv_counts;
+          std::vector<size_t> i2o;
+          std::vector<::std::pair<Key, V> > buffer;
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          input.swap(buffer);
+          BL_BENCH_END(update, "distribute", input.size());
+        }
+
+        BL_BENCH_START(update);
+        size_t count = 0;
+        for (auto const & x : input) {
+          auto range = this->c.equal_range(x.first);
+          for (auto it = range.first; it != range.second; ++it) count += op((*it).second, x.second);
+        }
+        BL_BENCH_END(update, "update", count);
+
+        BL_BENCH_REPORT_MPI_NAMED(update, "base_densehash:update", this->comm);
+        return count;
+      }
+
+      /// update with values[i] for keys[i].  see update(input, sorted_input, op).  collective.
+      template <typename V, typename Updater>
+      size_t update(std::vector<Key> const & keys, std::vector<V> const & values, Updater const & op ) {
+        std::vector<::std::pair<Key, V> > input = ::dsc::zip(keys, values);
+        return this->update(input, false, op);
+      }
+
       /**
        * @brief find elements with the specified keys in the distributed densehash_multimap.
        *
@@ -461,6 +1366,7 @@ namespace dsc  // distributed std container
       template <bool remove_duplicate = false, class LocalFind, typename Predicate = ::bliss::filter::TruePredicate>
       ::std::vector<::std::pair<Key, T> > find_overlap(LocalFind & find_element, ::std::vector<Key>& keys, bool sorted_input = false, Predicate const& pred = Predicate()) const {
           BL_BENCH_INIT(find);
+          BL_COMM_SCOPE(find_overlap);
 
           ::std::vector<::std::pair<Key, T> > results;
 
@@ -482,16 +1388,43 @@ namespace dsc  // distributed std container
 						typename Base::StoreTransformedEqual());
 		BL_BENCH_END(find, "unique", keys.size());
 
+          if (this->use_query_filter()) {
+            BL_BENCH_START(find);
+            this->query_prefilter(keys);
+            BL_BENCH_END(find, "query_filter", keys.size());
+          }
+
+          if ((this->comm.size() > 1) && this->use_sparse_query(keys.size())) {
+            BL_BENCH_COLLECTIVE_START(find, "sparse_find", this->comm);
+            results = this->find_sparse(find_element, keys, sorted_input, pred);
+            BL_BENCH_END(find, "sparse_find", results.size());
+
+            BL_BENCH_REPORT_MPI_NAMED(find, "base_densehash:find_overlap", this->comm);
+            return results;
+          }
+
+          if ((this->comm.size() > 1) && this->split_self) {
+            BL_BENCH_COLLECTIVE_START(find, "split_self", this->comm);
+            this->query_split_self(keys, results, find_element, false, sorted_input, pred);
+            BL_BENCH_END(find, "split_self", results.size());
+
+            BL_BENCH_REPORT_MPI_NAMED(find, "base_densehash:find_overlap", this->comm);
+            return results;
+          }
+
           if (this->comm.size() > 1) {
 
             BL_BENCH_COLLECTIVE_START(find, "dist_query", this->comm);
             // distribute (communication part)
             std::vector<size_t> recv_counts;
             {
-				std::vector<size_t> i2o;
-				std::vector<Key > buffer;
-				::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-				keys.swap(buffer);
+				// scratch buffers from the communicator's pool, reused across queries.
+				::imxx::scratch::buffer<size_t> i2o(this->comm);
+				::imxx::scratch::buffer<Key> buffer(this->comm);
+				i2o.reserve(keys.size());
+				buffer.reserve(keys.size());
+				::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+				keys.swap(*buffer);
 	//            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
 	//            				typename Base::StoreTransformedFunc(),
 	//            				typename Base::StoreTransformedEqual()).swap(recv_counts);
@@ -605,6 +1538,7 @@ namespace dsc  // distributed std container
 
             // wait for all the receives
             MPI_Waitall(this->comm.size(), &(recv_reqs[0]), MPI_STATUSES_IGNORE);
+            BL_COMM_RECORD("respond", sizeof(results[0]), send_counts, resp_counts);
 
 
             //printf("Rank %d total find %lu\n", this->comm.rank(), total);
@@ -666,6 +1600,7 @@ namespace dsc  // distributed std container
 				   Predicate const & pred = Predicate(),
 				   Transform const & trans = Transform()) const {
           BL_BENCH_INIT(find);
+          BL_COMM_SCOPE(find_transform);
 
           ::std::vector<typename ::bliss::functional::function_traits<Transform, std::pair<Key, T> >::return_type > results;
 
@@ -692,16 +1627,25 @@ namespace dsc  // distributed std container
     						typename Base::StoreTransformedEqual());
     		BL_BENCH_END(find, "unique", keys.size());
 
+          if (this->use_query_filter()) {
+            BL_BENCH_START(find);
+            this->query_prefilter(keys);
+            BL_BENCH_END(find, "query_filter", keys.size());
+          }
+
               if (this->comm.size() > 1) {
 
                 BL_BENCH_COLLECTIVE_START(find, "dist_query", this->comm);
                 // distribute (communication part)
                 std::vector<size_t> recv_counts;
                 {
-					std::vector<size_t> i2o;
-					std::vector<Key > buffer;
-					::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-					keys.swap(buffer);
+					// scratch buffers from the communicator's pool, reused across queries.
+					::imxx::scratch::buffer<size_t> i2o(this->comm);
+					::imxx::scratch::buffer<Key> buffer(this->comm);
+					i2o.reserve(keys.size());
+					buffer.reserve(keys.size());
+					::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+					keys.swap(*buffer);
 		//            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
 		//            				typename Base::StoreTransformedFunc(),
 		//            				typename Base::StoreTransformedEqual()).swap(recv_counts);
@@ -755,6 +1699,7 @@ namespace dsc  // distributed std container
             BL_BENCH_COLLECTIVE_START(find, "a2a2", this->comm);
             // send back using the constructed recv count
             mxx::all2allv(results, send_counts, this->comm).swap(results);
+            BL_COMM_RECORD("respond", sizeof(results[0]), send_counts, results.size());
             BL_BENCH_END(find, "a2a2", results.size());
 
           } else {
@@ -1046,7 +1991,9 @@ namespace dsc  // distributed std container
 
       densehash_map_base(const mxx::comm& _comm) :
 		    Base(_comm), key_to_rank(_comm.size()),
-		    local_changed(false) {}
+		    local_changed(false), presize_local(false), distinct_estimate(0), reuse_query(false),
+		    sparse_query_max(_comm.size() / 8), sparse_epoch(0), split_self(true), query_filter(1), query_filtered(false),
+		    compact_ratio(0.25) {}
 
 
       // ================ local overrides
@@ -1062,9 +2009,93 @@ namespace dsc  // distributed std container
         c.clear();
       }
 
+      /// see map_base::local_load.  the table is sized once for all loaded entries.
+      virtual void local_load(std::pair<Key, T> const * first, std::pair<Key, T> const * last) {
+        size_t before = c.size();
+        c.resize(before + ::std::distance(first, last));
+        c.insert(first, last);
+        if (c.size() != before) local_changed = true;
+      }
 
-
-    public:
+      /// see map_base::load_distribute
+      virtual void load_distribute(std::vector<std::pair<Key, T> > & input) {
+        if (this->comm.size() > 1) {
+          std::vector<size_t> recv_counts;
+          std::vector<size_t> i2o;
+          std::vector<::std::pair<Key, T> > buffer;
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          input.swap(buffer);
+        }
+        this->local_load(input.data(), input.data() + input.size());
+      }
+
+      /// see map_base::local_batches
+      virtual void local_batches(size_t const & batch_size, typename Base::batch_op_type const & op) const {
+        typename Base::batch_buffer buffer(batch_size, op);
+        c.visit(buffer);
+        buffer.flush();
+      }
+
+
+
+      /**
+       * @brief  one answer per query key, in the order of keys.  collective.
+       * @details  the keys are bucketed by imxx::distribute, answered on their owners, and the answers are sent back with
+       *           the same counts, so they arrive in bucketed order.  the i2o permutation from distribute then puts them
+       *           back in query order.  neither side sorts.  duplicate keys are sent and answered once per occurrence.
+       * @param keys     queries.  not modified.
+       * @param answer   R answer(Key const &), called on the owner rank with the transformed key.
+       */
+      template <typename R, typename Answer>
+      ::std::vector<R> query_aligned(::std::vector<Key> const & keys, Answer const & answer) const {
+        BL_BENCH_INIT(aligned);
+        ::std::vector<R> results;
+
+        if (::dsc::empty(keys, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(aligned, "base_densehash:query_aligned", this->comm);
+          return results;
+        }
+
+        BL_BENCH_START(aligned);
+        ::std::vector<Key> query(keys);
+        this->transform_input(query);
+        BL_BENCH_END(aligned, "transform_input", query.size());
+
+        std::vector<size_t> i2o;
+        std::vector<size_t> recv_counts;
+        if (this->comm.size() > 1) {
+          BL_BENCH_COLLECTIVE_START(aligned, "dist_query", this->comm);
+          std::vector<Key> buffer;
+          ::imxx::distribute(query, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          query.swap(buffer);
+          BL_BENCH_END(aligned, "dist_query", query.size());
+        }
+
+        BL_BENCH_START(aligned);
+        results.reserve(query.size());
+        for (auto it = query.begin(); it != query.end(); ++it) {
+          results.emplace_back(answer(*it));
+        }
+        BL_BENCH_END(aligned, "local_query", results.size());
+
+        if (this->comm.size() > 1) {
+          BL_BENCH_START(aligned);
+          auto bucketed = ::mxx::all2allv(results, recv_counts, this->comm);
+          BL_BENCH_END(aligned, "a2a2", bucketed.size());
+
+          BL_BENCH_START(aligned);
+          results.resize(bucketed.size());
+          ::imxx::local::unpermute(bucketed.begin(), bucketed.end(), i2o.begin(), results.begin(), 0);
+          BL_BENCH_END(aligned, "unbucket", results.size());
+        }
+
+        BL_BENCH_REPORT_MPI_NAMED(aligned, "base_densehash:query_aligned", this->comm);
+
+        return results;
+      }
+
+
+    public:
       /// reserve space.  n is the local container size.  this allows different processes to individually adjust its own size.
       virtual void local_reserve( size_t n) {
         c.resize(n); 
@@ -1080,10 +2111,154 @@ namespace dsc  // distributed std container
 
       virtual ~densehash_map_base() {};
 
+      /// enable or disable the distinct-count pass that sizes the local container once per insert.
+      void set_presize(bool v) {
+        presize_local = v;
+      }
+      bool is_presize() const {
+        return presize_local;
+      }
+      /// global distinct key estimate from the last presized insert.  0 if presize is off.
+      size_t get_distinct_estimate() const {
+        return distinct_estimate;
+      }
+
+      /**
+       * @brief  keep the query send/receive buffers and a persistent count exchange between find and count calls.
+       * @details  for services that issue many similar sized query batches: buffers keep their capacity, so later
+       *           batches do not allocate or page fault, and the count all2all becomes a started persistent request
+       *           (MPI 4).  buffers hold up to one batch of keys and results.  turning it off releases them.  collective.
+       */
+      void set_reuse_query_buffers(bool v) {
+        reuse_query = v;
+        if (!v) qbuf = QueryBuffers();
+      }
+      bool is_reuse_query_buffers() const {
+        return reuse_query;
+      }
+
+      /**
+       * @brief  route keys to their owners once, for iterative algorithms that query the same keys repeatedly.
+       * @details  count, find and update with the returned object skip the input transform, the bucketing and
+       *           permutation, and the key exchange.  count and update also skip the count exchange.  the plan depends
+       *           only on the keys and the communicator, so it stays valid when the map changes.  collective.
+       * @param keys  not modified.
+       */
+      prepared_query prepare_query(::std::vector<Key> const & keys) const {
+        BL_BENCH_INIT(prepare);
+        prepared_query q;
+
+        BL_BENCH_START(prepare);
+        ::std::vector<Key> transformed;
+        this->transform_input(keys, transformed);
+        BL_BENCH_END(prepare, "input_transform", transformed.size());
+
+        BL_BENCH_COLLECTIVE_START(prepare, "route", this->comm);
+        q.plan = ::std::make_shared<::imxx::routing_plan<size_t> >(transformed, this->key_to_rank, this->comm);
+        q.plan->route(transformed, q.keys);
+        BL_BENCH_END(prepare, "route", q.keys.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(prepare, "base_densehash:prepare_query", this->comm);
+        return q;
+      }
+
+      /**
+       * @brief  largest per-rank batch for which find_overlap uses a sparse exchange instead of visiting every rank.
+       * @details  small batches touch few ranks, so the NBX exchange in imxx::sparse_all2allv is cheaper than O(p)
+       *           messages and count arrays.  defaults to comm size / 8.  0 always uses the dense path.
+       */
+      void set_sparse_query_max(size_t n) {
+        sparse_query_max = n;
+      }
+      size_t get_sparse_query_max() const {
+        return sparse_query_max;
+      }
+
+      /**
+       * @brief  answer the query keys this rank owns from the local container while the other keys are exchanged.
+       * @details  the own keys then skip the send and receive buffers of both exchanges of count and find.  worthwhile
+       *           when many queries are local, e.g. with locality-aware distribution.  the answers to the own keys come
+       *           first in the results.  on by default.  not used with reuse_query buffers.
+       */
+      void set_split_self_query(bool v) {
+        split_self = v;
+      }
+      bool is_split_self_query() const {
+        return split_self;
+      }
+
+      /**
+       * @brief  build a Bloom filter of all keys and replicate it, so find and count drop absent keys before sending them.
+       * @details  for query batches that mostly miss, e.g. read mapping, where most k-mers of a read are not in the
+       *           index:  query volume drops with the miss rate.  the filter takes about 1.44 log2(1/fp) bits per global
+       *           key on every rank, 9.6 bits at 1%.  results are unchanged, count reports dropped keys with count 0.
+       *           once the map changes on any rank the filter is skipped until it is built again.  only used with more
+       *           than 1 rank.  turning it off releases the filter.  collective.
+       * @param fp  false positive rate of the filter.
+       */
+      void set_query_filter(bool v, double fp = 0.01) {
+        query_filtered = v;
+        if (!v) {
+          query_filter = ::bliss::utils::sketch::bloom_filter(1);
+          return;
+        }
+
+        ::std::vector<Key> local_keys;
+        this->keys(local_keys);
+        size_t n = ::mxx::allreduce(local_keys.size(), this->comm);
+        query_filter = ::bliss::utils::sketch::bloom_filter(n, fp);
+
+        ::std::vector<uint64_t> hashes;
+        this->sketch_hashes(local_keys, hashes);
+        for (auto const & h : hashes) query_filter.insert(h);
+
+        if (this->comm.size() > 1) {
+          query_filter.words() = ::mxx::allreduce(query_filter.words(), [](uint64_t const & x, uint64_t const & y) {
+            return x | y;
+          }, this->comm);
+        }
+        local_changed = false;
+      }
+      bool is_query_filter() const {
+        return query_filtered;
+      }
+
+      /**
+       * @brief  advance find_async and count_async queries on a background thread, so their exchanges and local
+       *         lookups proceed while the caller computes, without the caller polling test().
+       * @details  requires MPI initialized with MPI_THREAD_MULTIPLE, otherwise nothing changes.  turning it off
+       *           finishes the queries the thread holds.
+       * @return  true if the thread runs.
+       */
+      bool set_async_progress_thread(bool v) {
+        if (!async_channels) async_channels.reset(new ::dsc::async_query_channels());
+        return async_channels->set_progress_thread(v);
+      }
+      bool is_async_progress_thread() const {
+        return async_channels && async_channels->is_progress_thread();
+      }
+
+      /**
+       * @brief  rebuild the local table after erase once more than this fraction of its buckets are tombstones.
+       * @details  densehash erase only marks buckets deleted, so lookups keep probing through them until the next
+       *           insert resizes the table.  defaults to 0.25.  0 never compacts.  local.
+       */
+      void set_compact_ratio(double r) {
+        compact_ratio = r;
+      }
+      double get_compact_ratio() const {
+        return compact_ratio;
+      }
+
 
       /// returns the local storage.  please use sparingly.
       local_container_type& get_local_container() { return c; }
       local_container_type const & get_local_container() const { return c; }
+      /// read-only handle on the local storage, for lookups from several threads once the map is no longer modified.
+      ::fsc::frozen<local_container_type> freeze_local() const { return ::fsc::freeze(c); }
+
+      /// returns the key to owner rank mapping, e.g. to bucket keys by destination before insert.
+      KeyToRank const & get_key_to_rank() const { return key_to_rank; }
 
 //      const_iterator cbegin() const
 //      {
@@ -1112,7 +2287,159 @@ namespace dsc  // distributed std container
         c.keys(result);
       }
 
+      /// read-only one-sided lookup index, see distributed_rma_index.hpp.
+      using rma_index_type = ::dsc::rma_index<Key, T, KeyToRank, typename Base::InputTransform,
+          typename Base::StoreTransformedFunc, typename Base::StoreTransformedEqual>;
+
+      /**
+       * @brief  snapshot the map into an MPI window for lookups that do not need all ranks to call find.  collective.
+       * @details  the snapshot is a flat copy of the local entries, so it costs about 2x the local memory.  changes to
+       *           the map after this call are not visible through the index.
+       */
+      rma_index_type make_rma_index() const {
+        ::std::vector<::std::pair<Key, T> > entries;
+        this->to_vector(entries);
+        return rma_index_type(entries, key_to_rank, this->comm);
+      }
+
+      /// frozen compact index, see distributed_mphf_index.hpp.
+      using mphf_index_type = ::dsc::mphf_index<Key, T, KeyToRank, typename Base::InputTransform,
+          typename Base::StoreTransformedFunc, typename Base::StoreTransformedEqual>;
+
+      /**
+       * @brief  convert the map into a minimal perfect hash index for a reference that is not inserted into again.  collective.
+       * @details  about 3.5 bits per key for the hash, plus fingerprint_bits and the packed value per key.  no keys are
+       *           stored, so absent keys are found with probability 2^-fingerprint_bits.  clear the map afterwards to
+       *           release its memory.
+       */
+      mphf_index_type make_mphf_index(unsigned int const & fingerprint_bits = 16) const {
+        ::std::vector<::std::pair<Key, T> > entries;
+        this->to_vector(entries);
+        return mphf_index_type(entries, key_to_rank, this->comm, fingerprint_bits);
+      }
+
+      /// node shared memory index, see distributed_shm_index.hpp.
+      using shm_index_type = ::dsc::shm_index<Key, T, KeyToRank, typename Base::InputTransform,
+          typename Base::StoreTransformedFunc, typename Base::StoreTransformedEqual>;
+
+      /**
+       * @brief  snapshot the map into node shared memory for read-only queries.  collective.
+       * @details  lookups of keys owned on the same node are loads instead of messages.  with full, every node holds a
+       *           copy of the whole map and queries need no communication at all, at 2x the global map size per node.
+       */
+      shm_index_type make_shm_index(bool full = false) const {
+        ::std::vector<::std::pair<Key, T> > entries;
+        this->to_vector(entries);
+        return shm_index_type(entries, key_to_rank, this->comm, full);
+      }
+
+
+
+      /**
+       * @brief  start a non-blocking count, for overlapping the query with other work.  collective.
+       * @details  the exchanges are MPI non-blocking collectives, advanced by test() and wait() on the handle, or by
+       *           the progress thread (see set_async_progress_thread), and the local count runs inside one of those calls.  up to 4 queries can be outstanding, and starting a 5th
+       *           completes the oldest.  the map must not change until the query completes.  the query filter is not
+       *           applied, as checking that it is current would need a blocking collective.
+       * @param keys  taken over by the query.
+       * @return  handle whose get() gives (key, count) pairs, one for each key.
+       */
+      template <bool remove_duplicate = false, class Predicate = ::bliss::filter::TruePredicate>
+      ::dsc::query_handle<Key, ::std::pair<Key, size_type> > count_async(::std::vector<Key> keys,
+                                                                         Predicate const & pred = Predicate()) const {
+        ::std::vector<size_t> send_counts = this->template async_prepare<remove_duplicate>(keys);
+
+        auto answer = [this, pred](Key const * first, Key const * last, ::std::vector<::std::pair<Key, size_type> > & out) {
+          ::fsc::back_emplace_iterator<::std::vector<::std::pair<Key, size_type> > > emplace_iter(out);
+          QueryProcessor::process(this->c, first, last, emplace_iter, this->count_element, false, pred);
+        };
+        return this->template async_start<::std::pair<Key, size_type> >(::std::move(keys), ::std::move(send_counts), answer, true);
+      }
+
+      /**
+       * @brief count the keys of a prepared query.  collective.
+       * @return  1 (key, count) per prepared key, in the order the keys were given to prepare_query.
+       */
+      ::std::vector<::std::pair<Key, size_type> > count(prepared_query const & q) const {
+        BL_BENCH_INIT(count);
+        BL_COMM_SCOPE(count);
+        ::std::vector<::std::pair<Key, size_type> > local;
+        ::std::vector<::std::pair<Key, size_type> > results;
+
+        BL_BENCH_START(count);
+        local.reserve(q.keys.size());
+        ::fsc::back_emplace_iterator<::std::vector<::std::pair<Key, size_type> > > emplace_iter(local);
+        QueryProcessor::process(c, q.keys.begin(), q.keys.end(), emplace_iter, count_element);
+        BL_BENCH_END(count, "local_count", local.size());
+
+        BL_BENCH_COLLECTIVE_START(count, "a2a2", this->comm);
+        q.plan->respond(local, results);
+        BL_BENCH_END(count, "a2a2", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(count, "base_densehash:count_prepared", this->comm);
+        return results;
+      }
+
+      /**
+       * @brief  count of each key of a prepared query, without the keys, as uint32_t.  collective.
+       * @details  saturates at the uint32_t max.  sends 4 bytes per key instead of sizeof((Key, size_type)).
+       * @return  counts[i] for the i-th prepared key.
+       */
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<uint32_t> count_values(prepared_query const & q, Predicate const & pred = Predicate()) const {
+        BL_BENCH_INIT(count_values);
+        BL_COMM_SCOPE(count_values);
+
+        BL_BENCH_START(count_values);
+        ::std::vector<uint32_t> local;
+        this->local_counts(q.keys, local, pred);
+        BL_BENCH_END(count_values, "local_count", local.size());
+
+        BL_BENCH_COLLECTIVE_START(count_values, "a2a2", this->comm);
+        ::std::vector<uint32_t> results;
+        q.plan->respond(local, results);
+        BL_BENCH_END(count_values, "a2a2", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(count_values, "base_densehash:count_values", this->comm);
+        return results;
+      }
+      /// count_values for keys, in the order of keys.  keys is not modified.  collective.
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<uint32_t> count_values(::std::vector<Key> const & keys, Predicate const & pred = Predicate()) const {
+        return this->count_values(this->prepare_query(keys), pred);
+      }
 
+      /**
+       * @brief  whether each key of a prepared query is in the map, as a bitmap.  collective.
+       * @details  the answers are sent packed 64 to a word, so about 1 bit per key instead of sizeof((Key, size_type))
+       *           bytes.  see routing_plan::respond_bits.
+       * @return  bit i for the i-th prepared key.
+       */
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<bool> exists_bitmap(prepared_query const & q, Predicate const & pred = Predicate()) const {
+        BL_BENCH_INIT(exists_bitmap);
+        BL_COMM_SCOPE(exists_bitmap);
+
+        BL_BENCH_START(exists_bitmap);
+        ::std::vector<uint32_t> counts;
+        this->local_counts(q.keys, counts, pred);
+        ::std::vector<bool> local(counts.size());
+        for (size_t i = 0; i < counts.size(); ++i) local[i] = (counts[i] > 0);
+        BL_BENCH_END(exists_bitmap, "local_count", local.size());
+
+        BL_BENCH_COLLECTIVE_START(exists_bitmap, "a2a2", this->comm);
+        ::std::vector<bool> results;
+        q.plan->respond_bits(local, results);
+        BL_BENCH_END(exists_bitmap, "a2a2", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(exists_bitmap, "base_densehash:exists_bitmap", this->comm);
+        return results;
+      }
+      /// exists_bitmap for keys, in the order of keys.  keys is not modified.  collective.
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<bool> exists_bitmap(::std::vector<Key> const & keys, Predicate const & pred = Predicate()) const {
+        return this->exists_bitmap(this->prepare_query(keys), pred);
+      }
 
       /**
        * @brief count elements with the specified keys in the distributed densehash_multimap.
@@ -1123,6 +2450,7 @@ namespace dsc  // distributed std container
       ::std::vector<::std::pair<Key, size_type> > count(::std::vector<Key>& keys, bool sorted_input = false,
                                                         Predicate const& pred = Predicate() ) const {
           BL_BENCH_INIT(count);
+          BL_COMM_SCOPE(count);
           ::std::vector<::std::pair<Key, size_type> > results;
 
           // process even if local container is empty.
@@ -1144,8 +2472,21 @@ namespace dsc  // distributed std container
       						typename Base::StoreTransformedEqual());
       		BL_BENCH_END(count, "unique", keys.size());
 
+          // keys ruled out by the query filter are answered here with count 0.
+          ::std::vector<Key> absent;
+          if (this->use_query_filter()) {
+            BL_BENCH_START(count);
+            this->query_prefilter(keys, &absent);
+            BL_BENCH_END(count, "query_filter", keys.size());
+          }
+
+          if ((this->comm.size() > 1) && this->split_self && !this->reuse_query) {
 
-          if (this->comm.size() > 1) {
+            BL_BENCH_COLLECTIVE_START(count, "split_self", this->comm);
+            this->query_split_self(keys, results, count_element, true, sorted_input, pred);
+            BL_BENCH_END(count, "split_self", results.size());
+
+          } else if (this->comm.size() > 1) {
 
             // distribute (communication part)
 
@@ -1154,11 +2495,19 @@ namespace dsc  // distributed std container
             BL_BENCH_COLLECTIVE_START(count, "dist_query", this->comm);
             // distribute (communication part)
             std::vector<size_t> recv_counts;
-            {
-            	std::vector<size_t> i2o;
-                std::vector<Key > buffer;
-                ::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-                keys.swap(buffer);
+            if (this->reuse_query) {
+              this->query_distribute(keys);
+              recv_counts = this->qbuf.counts->recv_counts();
+              results.swap(this->qbuf.counted);
+              results.clear();
+            } else {
+            	// scratch buffers from the communicator's pool, reused across queries.
+            	::imxx::scratch::buffer<size_t> i2o(this->comm);
+            	::imxx::scratch::buffer<Key> buffer(this->comm);
+            	i2o.reserve(keys.size());
+            	buffer.reserve(keys.size());
+            	::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+            	keys.swap(*buffer);
             }
 //            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
 //            				typename Base::StoreTransformedFunc(),
@@ -1168,30 +2517,24 @@ namespace dsc  // distributed std container
 
 
             // local count. memory utilization a potential problem.
-            // do for each src proc one at a time.
             BL_BENCH_START(count);
             results.reserve(keys.size() );                   // TODO:  should estimate coverage.
             BL_BENCH_END(count, "reserve", results.capacity());
 
             BL_BENCH_START(count);
-            auto start = keys.begin();
-            auto end = start;
-            for (int i = 0; i < this->comm.size(); ++i) {
-              ::std::advance(end, recv_counts[i]);
-
-              // within start-end, values are unique, so don't need to set unique to true.
-              QueryProcessor::process(c, start, end, emplace_iter, count_element, sorted_input, pred);
-
-              if (this->comm.rank() == 0)
-                BL_DEBUGF("R %d added %lu results for %lu queries for process %d\n", this->comm.rank(), send_counts[i], recv_counts[i], i);
-
-              start = end;
-            }
+            // one result per query, in query order, so the queries from all processes are counted in 1 call.
+            // within each process' range, values are unique, so don't need to set unique to true.
+            QueryProcessor::process_parallel(c, keys.begin(), keys.end(), results, count_element, sorted_input, pred);
             BL_BENCH_END(count, "local_count", results.size());
 
             // send back using the constructed recv count
             BL_BENCH_COLLECTIVE_START(count, "a2a2", this->comm);
-            mxx::all2allv(results, recv_counts, this->comm).swap(results);
+            // one result per query, so the receive counts are the query send counts.
+            if (this->reuse_query)
+              this->query_return(results, recv_counts, this->qbuf.counts->send_counts(), this->qbuf.counted);
+            else
+              mxx::all2allv(results, recv_counts, this->comm).swap(results);
+              BL_COMM_RECORD("respond", sizeof(results[0]), recv_counts, results.size());
             BL_BENCH_END(count, "a2a2", results.size());
 
 
@@ -1205,16 +2548,30 @@ namespace dsc  // distributed std container
 
             BL_BENCH_START(count);
             // within start-end, values are unique, so don't need to set unique to true.
-            QueryProcessor::process(c, keys.begin(), keys.end(), emplace_iter, count_element, sorted_input, pred);
+            QueryProcessor::process_parallel(c, keys.begin(), keys.end(), results, count_element, sorted_input, pred);
             BL_BENCH_END(count, "local_count", results.size());
           }
 
+          for (auto const & k : absent) results.emplace_back(k, 0);
+
           BL_BENCH_REPORT_MPI_NAMED(count, "base_densehash:count", this->comm);
 
           return results;
 
       }
 
+      /**
+       * @brief  count, with the (key, count) pairs passed to visitor(first, last) in chunks of about chunk_size instead of
+       *         returned.  keys ruled out by the query filter are not skipped.  see query_each.  collective.
+       * @return  number of pairs passed to visitor on this rank.
+       */
+      template <bool remove_duplicate = false, class Visitor, class Predicate = ::bliss::filter::TruePredicate>
+      size_t count_each(::std::vector<Key>& keys, Visitor && visitor, size_t const chunk_size = (1UL << 16),
+                        bool sorted_input = false, Predicate const& pred = Predicate() ) const {
+          return this->template query_each<::std::pair<Key, size_type>, remove_duplicate>(count_element, keys, visitor, chunk_size,
+                                                                                         true, sorted_input, pred);
+      }
+
 
 
       /**
@@ -1231,6 +2588,7 @@ namespace dsc  // distributed std container
       count_transform(::std::vector<Key>& keys, bool sorted_input = false,
                                                         Predicate const& pred = Predicate(), Transform const & trans = Transform() ) const {
           BL_BENCH_INIT(count);
+          BL_COMM_SCOPE(count_transform);
           ::std::vector<typename ::bliss::functional::function_traits<Transform, ::std::pair<Key, size_type> >::return_type> results;
 
           // process even if local container is empty.
@@ -1261,10 +2619,13 @@ namespace dsc  // distributed std container
               // distribute (communication part)
               std::vector<size_t> recv_counts;
               {
-				  std::vector<size_t> i2o;
-				  std::vector<Key > buffer;
-				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-				  keys.swap(buffer);
+				  // scratch buffers from the communicator's pool, reused across queries.
+				  ::imxx::scratch::buffer<size_t> i2o(this->comm);
+				  ::imxx::scratch::buffer<Key> buffer(this->comm);
+				  i2o.reserve(keys.size());
+				  buffer.reserve(keys.size());
+				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+				  keys.swap(*buffer);
 	  //            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
 	  //            				typename Base::StoreTransformedFunc(),
 	  //            				typename Base::StoreTransformedEqual()).swap(recv_counts);
@@ -1298,6 +2659,7 @@ namespace dsc  // distributed std container
             // send back using the constructed recv count
             BL_BENCH_COLLECTIVE_START(count, "a2a2", this->comm);
             mxx::all2allv(results, recv_counts, this->comm).swap(results);
+            BL_COMM_RECORD("respond", sizeof(results[0]), recv_counts, results.size());
             BL_BENCH_END(count, "a2a2", results.size());
           } else {
 
@@ -1354,6 +2716,33 @@ namespace dsc  // distributed std container
 
 
 
+      /**
+       * @brief count with duplicate keys sent once.  one (transformed key, count) per query, in query order.  collective.
+       * @details  see map_base::fanout_query.  for batches with many duplicates, e.g. read mapping.
+       */
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, size_type> > count_fanout(::std::vector<Key> const & keys,
+                                                               Predicate const& pred = Predicate()) const {
+        return this->template fanout_query<size_type>(keys, size_type(0), [this, &pred](::std::vector<Key> & unique) {
+          return this->template count<false>(unique, false, pred);
+        });
+      }
+
+      /**
+       * @brief count, with counts[i] for keys[i].  keys is not modified.  collective.
+       * @details  see densehash_map_base::query_aligned.  for callers that need the answers in query (e.g. read) order.
+       */
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<size_type> count_aligned(::std::vector<Key> const & keys, Predicate const& pred = Predicate()) const {
+        return this->template query_aligned<size_type>(keys, [this, &pred](Key const & k) -> size_type {
+          if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value) return static_cast<size_type>(this->c.count(k));
+
+          auto range = this->c.equal_range(k);
+          if (!pred(range.first, range.second)) return size_type(0);
+          return static_cast<size_type>(::std::count_if(range.first, range.second, pred));
+        });
+      }
+
 
       template <typename Predicate = ::bliss::filter::TruePredicate>
       ::std::vector<::std::pair<Key, size_type> > count(Predicate const & pred = Predicate()) const {
@@ -1605,6 +2994,7 @@ namespace dsc  // distributed std container
           size_t before = this->c.size();
 
           BL_BENCH_INIT(erase);
+          BL_COMM_SCOPE(erase);
 
           if (this->empty() || ::dsc::empty(keys, this->comm)) {
             BL_BENCH_REPORT_MPI_NAMED(erase, "base_densehash:erase", this->comm);
@@ -1653,6 +3043,10 @@ namespace dsc  // distributed std container
           }
           BL_BENCH_END(erase, "erase", keys.size());
 
+          BL_BENCH_START(erase);
+          this->maybe_compact();
+          BL_BENCH_END(erase, "compact", this->c.size());
+
 
 
           BL_BENCH_REPORT_MPI_NAMED(erase, "base_densehash:erase", this->comm);
@@ -1677,6 +3071,30 @@ namespace dsc  // distributed std container
             this->local_clear();
           }
 
+          if (count > 0) {
+            local_changed = true;
+            this->maybe_compact();
+          }
+        }
+
+        if (this->comm.size() > 1) this->comm.barrier();
+
+        return count;
+      }
+
+      /**
+       * @brief keep only the elements for which pred is true.  the opposite of erase(pred), but the local table is
+       *        rebuilt in one pass, leaving no tombstones.
+       * @return number of elements removed on this rank.
+       */
+      template <typename Predicate>
+      size_t retain_if(Predicate const & pred) {
+
+        size_t count = 0;
+
+        if (! this->local_empty()) {
+          count = retain_if_impl(this->c, pred, 0);
+
           if (count > 0) local_changed = true;
         }
 
@@ -1733,16 +3151,20 @@ namespace dsc  // distributed std container
    * @tparam Hash   hash function for local and distribution.  requires a template arugment (Key), and a bool (prefix, chooses the MSBs of hash instead of LSBs)
    * @tparam Equal   default to ::std::equal_to<Key>   equal function for the local storage.
    * @tparam Alloc  default to ::std::allocator< ::std::pair<const Key, T> >    allocator for local storage.
+   * @tparam Container  local container.  default ::fsc::densehash_map.  ::fsc::group_hash_map does not reserve keys, so it does not split.
+   *                    ::fsc::stashed_densehash_map keeps 1 table for keys that span the key space, instead of 2.
    */
   template<typename Key, typename T,
   	  template <typename> class MapParams,
     typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
-	  class Alloc = ::std::allocator< ::std::pair<const Key, T> >
+	  class Alloc = ::std::allocator< ::std::pair<const Key, T> >,
+    template <typename, typename, typename, template <typename> class,
+      typename, typename, typename, bool> class Container = ::fsc::densehash_map
   >
   class densehash_map : 
-    public densehash_map_base<Key, T, ::fsc::densehash_map, MapParams, SpecialKeys, Alloc> {
+    public densehash_map_base<Key, T, Container, MapParams, SpecialKeys, Alloc> {
     protected:
-      using Base = densehash_map_base<Key, T, ::fsc::densehash_map, MapParams, SpecialKeys, Alloc>;
+      using Base = densehash_map_base<Key, T, Container, MapParams, SpecialKeys, Alloc>;
 
 
     public:
@@ -1818,6 +3240,7 @@ namespace dsc  // distributed std container
       using Base::count;
       using Base::erase;
       using Base::unique_size;
+      using Base::update;
 
 
       template <bool remove_duplicate = false, class Predicate = ::bliss::filter::TruePredicate>
@@ -1825,6 +3248,77 @@ namespace dsc  // distributed std container
                                                           Predicate const& pred = Predicate()) const {
           return Base::template find<remove_duplicate>(find_element, keys, sorted_input, pred);
       }
+      /// find the keys of a prepared query.  see prepare_query.  collective.
+      ::std::vector<::std::pair<Key, T> > find(typename Base::prepared_query const & q) const {
+          return Base::find(find_element, q);
+      }
+      /**
+       * @brief  values only, in the order of keys:  values for keys[i] are [offsets[i], offsets[i + 1]).  collective.
+       * @details  see densehash_map_base::find_values.
+       */
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<T> find_values(typename Base::prepared_query const & q, ::std::vector<size_t> & offsets,
+                                   Predicate const& pred = Predicate()) const {
+          return Base::find_values(find_element, q, offsets, pred);
+      }
+      /// find_values for keys.  keys is not modified.  collective.
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<T> find_values(::std::vector<Key> const & keys, ::std::vector<size_t> & offsets,
+                                   Predicate const& pred = Predicate()) const {
+          return Base::find_values(find_element, this->prepare_query(keys), offsets, pred);
+      }
+      /**
+       * @brief  find, with the results passed to visitor(first, last) in chunks of about chunk_size as they arrive from
+       *         each rank, instead of returned.  see densehash_map_base::query_each.  collective.
+       * @return  number of results passed to visitor on this rank.
+       */
+      template <bool remove_duplicate = false, class Visitor, class Predicate = ::bliss::filter::TruePredicate>
+      size_t find_each(::std::vector<Key>& keys, Visitor && visitor, size_t const chunk_size = (1UL << 16),
+                       bool sorted_input = false, Predicate const& pred = Predicate()) const {
+          return Base::template query_each<::std::pair<Key, T>, remove_duplicate>(find_element, keys, visitor, chunk_size,
+                                                                                 false, sorted_input, pred);
+      }
+      /// find with point to point exchange, overlapping the local finds with the communication.  collective.
+      template <bool remove_duplicate = false, class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, T> > find_overlap(::std::vector<Key>& keys, bool sorted_input = false,
+                                                       Predicate const& pred = Predicate()) const {
+          return Base::template find_overlap<remove_duplicate>(find_element, keys, sorted_input, pred);
+      }
+      /**
+       * @brief find with duplicate keys sent once.  results for keys[i] are [offsets[i], offsets[i+1]).  collective.
+       * @details  see map_base::fanout_query.
+       */
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, T> > find_fanout(::std::vector<Key> const & keys, ::std::vector<size_t> & offsets,
+                                                      Predicate const& pred = Predicate()) const {
+          return this->template fanout_query<T>(keys, offsets, [this, &pred](::std::vector<Key> & unique) {
+            return this->template find<false>(unique, false, pred);
+          });
+      }
+      /**
+       * @brief find, with values[i] for keys[i], or missing if keys[i] is not in the map.  keys is not modified.  collective.
+       * @details  see densehash_map_base::query_aligned.  the answers are a pure map from queries to values, so callers
+       *           that need them in query (e.g. read) order do not have to sort the (key, value) pairs from find.
+       */
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<T> find_aligned(::std::vector<Key> const & keys, T const & missing = T(),
+                                    Predicate const& pred = Predicate()) const {
+          return this->template query_aligned<T>(keys, [this, &missing, &pred](Key const & k) -> T {
+            auto iters = this->c.equal_range(k);
+            if (iters.first == iters.second) return missing;
+
+            if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate >::value)
+              if (!pred(iters.first, iters.second) || !pred(*(iters.first)) ) return missing;
+
+            return iters.first->second;
+          });
+      }
+      /// start a non-blocking find.  see densehash_map_base::count_async.  collective.
+      template <bool remove_duplicate = false, class Predicate = ::bliss::filter::TruePredicate>
+      ::dsc::query_handle<Key, ::std::pair<Key, T> > find_async(::std::vector<Key> keys,
+                                                                Predicate const& pred = Predicate()) const {
+          return Base::template find_async<remove_duplicate>(find_element, ::std::move(keys), pred);
+      }
       template <bool remove_duplicate = false, class Transform = ::bliss::transform::identity<Key>, class Predicate = ::bliss::filter::TruePredicate>
       ::std::vector<typename ::bliss::functional::function_traits<Transform, ::std::pair<Key, T> >::return_type>
       find_transform(::std::vector<Key>& keys, bool sorted_input = false,
@@ -1911,6 +3405,7 @@ namespace dsc  // distributed std container
       size_t insert(std::vector<::std::pair<Key, T> >& input, bool sorted_input = false, Predicate const & pred = Predicate()) {
         // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
         BL_BENCH_INIT(insert);
+        BL_COMM_SCOPE(insert);
 
         if (::dsc::empty(input, this->comm)) {
           BL_BENCH_REPORT_MPI_NAMED(insert, "hashmap:insert", this->comm);
@@ -1928,15 +3423,15 @@ namespace dsc  // distributed std container
           // TODO: keep unique only may not be needed - comm speed may be faster than we can compute unique.
 //          auto recv_counts(::dsc::distribute(input, this->key_to_rank, sorted_input, this->comm));
 //          BLISS_UNUSED(recv_counts);
-          std::vector<size_t> recv_counts;
-			  std::vector<size_t> i2o;
-			  std::vector<::std::pair<Key, T> > buffer;
-			  ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-			  input.swap(buffer);
+          // with presize on, also sizes the local container from the sketches sent with the counts.
+          this->distribute_presize(input);
           BL_BENCH_END(insert, "dist_data", input.size());
+        } else if (this->presize_local) {
+          BL_BENCH_START(insert);
+          this->presize(input);
+          BL_BENCH_END(insert, "presize", this->c.bucket_count());
         }
 
-
         BL_BENCH_START(insert);
         // local compute part.  called by the communicator.
         //this->c.resize(input.size() / 2);
@@ -1967,51 +3462,49 @@ namespace dsc  // distributed std container
       }
 
       /**
-       * @brief insert new elements in the distributed densehash_multimap.
-       * @param first
-       * @param last
+       * @brief insert new elements in the distributed densehash_map, overlapping communication and local insertion.
+       * @details  input is split into rounds of at most batch_size elements.  while round i+1 is in flight,
+       *           round i is inserted locally.  see imxx::distribute_compute_overlap.
+       * @param input  content will be changed and reordered.
+       * @param batch_size  number of elements per round per process.  0 means 1 round.
        */
-      template <typename V, typename Updater>
-      size_t update(std::vector<::std::pair<Key, V> >& input, bool sorted_input, Updater const & op ) {
-        // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
-        BL_BENCH_INIT(update);
+      template <typename Predicate = ::bliss::filter::TruePredicate>
+      size_t insert_overlap(std::vector<::std::pair<Key, T> >& input, size_t batch_size,
+                            bool sorted_input = false, Predicate const & pred = Predicate()) {
+        BL_BENCH_INIT(insert);
+        BL_COMM_SCOPE(insert_overlap);
 
-        if (this->empty() || ::dsc::empty(input, this->comm)) {
-          BL_BENCH_REPORT_MPI_NAMED(update, "hashmap:update", this->comm);
+        if (::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(insert, "hashmap:insert_overlap", this->comm);
           return 0;
         }
 
-        BL_BENCH_START(update);
+        BL_BENCH_START(insert);
         this->transform_input(input);
-        BL_BENCH_END(update, "transform_intput", input.size());
-
-        // communication part
-
-        if (this->comm.size() > 1) {
-//          // TODO: keep unique only is not needed - overhead is high.
+        BL_BENCH_END(insert, "transform_intput", input.size());
 
-			// and distribute the data.
-			BL_BENCH_START(update);
-//			::dsc::distribute_bucketed(input, recv_counts, this->comm).swap(input);
-			std::vector<size_t> recv_counts;
-			  std::vector<size_t> i2o;
-			  std::vector<::std::pair<Key, V> > buffer;
-			  ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-			  input.swap(buffer);
+        size_t before = this->c.size();
 
-			BL_BENCH_END(update, "distribute_(localcnt)", recv_counts[this->comm.rank()]);
+        auto inserter = [this, &pred](typename ::std::vector<::std::pair<Key, T> >::iterator first,
+                                      typename ::std::vector<::std::pair<Key, T> >::iterator last) {
+          if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+            last = ::std::partition(first, last, pred);
+          this->c.insert(first, last);
+        };
 
+        BL_BENCH_START(insert);
+        if (this->comm.size() > 1) {
+          ::imxx::distribute_compute_overlap(input, this->key_to_rank, inserter, batch_size, this->comm);
+        } else {
+          inserter(input.begin(), input.end());
         }
+        BL_BENCH_END(insert, "dist_insert", this->c.size());
 
+        if (this->c.size() != before) this->local_changed = true;
 
-        BL_BENCH_START(update);
-        // local compute part.
-        size_t count = this->c.update(input, op);
-        BL_BENCH_END(update, "update", count);
-
-        BL_BENCH_REPORT_MPI_NAMED(update, "hashmap:update", this->comm);
+        BL_BENCH_REPORT_MPI_NAMED(insert, "hashmap:insert_overlap", this->comm);
 
-        return count;
+        return this->c.size() - before;
       }
 
       template <typename Filter, typename Updater>
@@ -2027,6 +3520,23 @@ namespace dsc  // distributed std container
         return count;
       }
 
+      /**
+       * @brief  merge entries that are already on their owner rank, e.g. from a colocated map.  local.
+       * @details  op(stored, x) for keys present, insert for keys absent.  input keys should be transformed.
+       * @return  number of keys inserted.
+       */
+      template <typename V, typename Reducer>
+      size_t local_merge(::std::vector<::std::pair<Key, V> > const & input, Reducer const & op) {
+        size_t before = this->c.size();
+        for (auto const & x : input) {
+          auto it = this->c.find(x.first);
+          if (it == this->c.end()) this->c.insert(::std::make_pair(x.first, static_cast<T>(x.second)));
+          else op(it->second, x.second);
+        }
+        if (this->c.size() != before) this->local_changed = true;
+        return this->c.size() - before;
+      }
+
   };
 
 
@@ -2108,6 +3618,13 @@ namespace dsc  // distributed std container
 
             if (iters.first == iters.second) return 0;
 
+            // the entries of a key are contiguous, so unfiltered results go into the (send) buffer as 1 range.
+            if (::std::is_same<Predicate, ::bliss::filter::TruePredicate >::value &&
+                ::std::is_same<Transform, ::bliss::transform::identity<Key> >::value) {
+              ::fsc::append_range(iters.first, iters.second, output);
+              return ::std::distance(iters.first, iters.second);
+            }
+
             // predicate is not a TruePredicate and does not satisfy the predicate
             if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate >::value)
             	if (!pred(iters.first, iters.second)) return 0;
@@ -2153,16 +3670,72 @@ namespace dsc  // distributed std container
       using Base::erase;
       using Base::unique_size;
 
+      /**
+       * @brief  the (key, value) entries of key on this rank, in place, without copying.  not collective.
+       * @details  for local consumers of keys this rank owns, e.g. of keys from the local container's own iteration.
+       *           key is input transformed, as by find.  valid until the map is modified.  see ::fsc::span.
+       */
+      ::fsc::span<::std::pair<Key, T> > local_equal_range(Key const & key) const {
+          return this->c.equal_range_span(typename Base::InputTransform()(key));
+      }
 
       template <bool remove_duplicate = false, class Predicate = ::bliss::filter::TruePredicate>
       ::std::vector<::std::pair<Key, T> > find(::std::vector<Key>& keys, bool sorted_input = false,
                                                Predicate const& pred = Predicate()) const {
           return Base::template find_overlap<remove_duplicate>(find_element, keys, sorted_input, pred);
       }
-      template <bool remove_duplicate = false, class Predicate = ::bliss::filter::TruePredicate, class Transform = ::bliss::transform::identity<Key>>
-      ::std::vector<typename ::bliss::functional::function_traits<Transform, ::std::pair<Key, T> >::return_type>
-      find_transform(::std::vector<Key>& keys, bool sorted_input = false,
-    		  Predicate const& pred = Predicate(),
+      /**
+       * @brief  find, with the results passed to visitor(first, last) in chunks of about chunk_size as they arrive from
+       *         each rank, instead of returned.  for keys with many values, the results need not fit in memory at once.
+       *         see densehash_map_base::query_each.  collective.
+       * @return  number of results passed to visitor on this rank.
+       */
+      template <bool remove_duplicate = false, class Visitor, class Predicate = ::bliss::filter::TruePredicate>
+      size_t find_each(::std::vector<Key>& keys, Visitor && visitor, size_t const chunk_size = (1UL << 16),
+                       bool sorted_input = false, Predicate const& pred = Predicate()) const {
+          return Base::template query_each<::std::pair<Key, T>, remove_duplicate>(find_element, keys, visitor, chunk_size,
+                                                                                 false, sorted_input, pred);
+      }
+      /// find the keys of a prepared query.  see prepare_query.  collective.
+      ::std::vector<::std::pair<Key, T> > find(typename Base::prepared_query const & q) const {
+          return Base::find(find_element, q);
+      }
+      /**
+       * @brief  values only, in the order of keys:  values for keys[i] are [offsets[i], offsets[i + 1]).  collective.
+       * @details  see densehash_map_base::find_values.
+       */
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<T> find_values(typename Base::prepared_query const & q, ::std::vector<size_t> & offsets,
+                                   Predicate const& pred = Predicate()) const {
+          return Base::find_values(find_element, q, offsets, pred);
+      }
+      /// find_values for keys.  keys is not modified.  collective.
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<T> find_values(::std::vector<Key> const & keys, ::std::vector<size_t> & offsets,
+                                   Predicate const& pred = Predicate()) const {
+          return Base::find_values(find_element, this->prepare_query(keys), offsets, pred);
+      }
+      /**
+       * @brief find with duplicate keys sent once.  results for keys[i] are [offsets[i], offsets[i+1]).  collective.
+       * @details  see map_base::fanout_query.
+       */
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, T> > find_fanout(::std::vector<Key> const & keys, ::std::vector<size_t> & offsets,
+                                                      Predicate const& pred = Predicate()) const {
+          return this->template fanout_query<T>(keys, offsets, [this, &pred](::std::vector<Key> & unique) {
+            return this->template find<false>(unique, false, pred);
+          });
+      }
+      /// start a non-blocking find.  see densehash_map_base::count_async.  collective.
+      template <bool remove_duplicate = false, class Predicate = ::bliss::filter::TruePredicate>
+      ::dsc::query_handle<Key, ::std::pair<Key, T> > find_async(::std::vector<Key> keys,
+                                                                Predicate const& pred = Predicate()) const {
+          return Base::template find_async<remove_duplicate>(find_element, ::std::move(keys), pred);
+      }
+      template <bool remove_duplicate = false, class Predicate = ::bliss::filter::TruePredicate, class Transform = ::bliss::transform::identity<Key>>
+      ::std::vector<typename ::bliss::functional::function_traits<Transform, ::std::pair<Key, T> >::return_type>
+      find_transform(::std::vector<Key>& keys, bool sorted_input = false,
+    		  Predicate const& pred = Predicate(),
     		  Transform const & trans = Transform()) const {
           return Base::template find<remove_duplicate>(find_element, keys, sorted_input, pred, trans);
       }
@@ -2330,6 +3903,7 @@ namespace dsc  // distributed std container
       size_t insert(std::vector<::std::pair<Key, T> >& input, bool sorted_input = false, Predicate const & pred = Predicate()) {
         // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
         BL_BENCH_INIT(insert);
+        BL_COMM_SCOPE(insert);
 
         if (::dsc::empty(input, this->comm)) {
           BL_BENCH_REPORT_MPI_NAMED(insert, "hash_multimap:insert", this->comm);
@@ -2419,19 +3993,22 @@ namespace dsc  // distributed std container
    * @tparam Reduc  default to ::std::plus<key>    reduction operator
    * @tparam Equal   default to ::std::equal_to<Key>   equal function for the local storage.
    * @tparam Alloc  default to ::std::allocator< ::std::pair<const Key, T> >    allocator for local storage.
+   * @tparam Container  local container.  default ::fsc::densehash_map.  ::fsc::group_hash_map does not reserve keys, so it does not split.
    */
   template<typename Key, typename T,
   template <typename> class MapParams,
     typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
   typename Reduc = ::std::plus<T>,
-  class Alloc = ::std::allocator< ::std::pair<const Key, T> >
+  class Alloc = ::std::allocator< ::std::pair<const Key, T> >,
+    template <typename, typename, typename, template <typename> class,
+      typename, typename, typename, bool> class Container = ::fsc::densehash_map
   >
   class reduction_densehash_map : 
-    public densehash_map<Key, T, MapParams, SpecialKeys, Alloc> {
+    public densehash_map<Key, T, MapParams, SpecialKeys, Alloc, Container> {
       //static_assert(::std::is_arithmetic<T>::value, "mapped type has to be arithmetic");
 
     protected:
-      using Base = densehash_map<Key, T, MapParams, SpecialKeys, Alloc>;
+      using Base = densehash_map<Key, T, MapParams, SpecialKeys, Alloc, Container>;
 
     public:
       using local_container_type = typename Base::local_container_type;
@@ -2455,6 +4032,12 @@ namespace dsc  // distributed std container
     protected:
       Reduc r;
 
+      /// combine duplicate keys locally before distributing.  see local_combine.
+      bool combine_local;
+      /// cumulative local element counts before and after local combine.
+      size_t combine_in;
+      size_t combine_out;
+
       /**
        * @brief insert new elements in the distributed densehash_multimap.
        * @param first
@@ -2466,21 +4049,25 @@ namespace dsc  // distributed std container
 
           //this->local_reserve(before + ::std::distance(first, last));
 
-          for (auto it = first; it != last; ++it) {
-            auto v = *it;
-
+          this->for_each_prefetched(first, last, [this](::std::pair<Key, T> const & v) {
             auto result = this->c.insert(v);
             if (!(result.second)) {
               // failed insertion - means an entry is already there, so reduce
               result.first->second = r(result.first->second, v.second);
             }
-          }
+          });
 
           if (this->c.size() != before) this->local_changed = true;
 
           return this->c.size() - before;
       }
 
+      /// see map_base::local_load.  reduces with existing entries.
+      virtual void local_load(std::pair<Key, T> const * first, std::pair<Key, T> const * last) {
+        this->c.resize(this->c.size() + ::std::distance(first, last));
+        this->local_insert(first, last);
+      }
+
       /**
        * @brief insert new elements in the distributed densehash_multimap.
        * @param first
@@ -2492,8 +4079,7 @@ namespace dsc  // distributed std container
 
           //this->local_reserve(before + ::std::distance(first, last));
 
-          for (auto it = first; it != last; ++it) {
-            auto v = *it;
+          this->for_each_prefetched(first, last, [this, &pred](::std::pair<Key, T> const & v) {
             if (pred(v)) {
               auto result = this->c.insert(v);
               if (!(result.second)) {
@@ -2501,7 +4087,7 @@ namespace dsc  // distributed std container
                 result.first->second = r(result.first->second, v.second);
               }
             }
-          }
+          });
 
           if (this->c.size() != before) this->local_changed = true;
 
@@ -2543,14 +4129,68 @@ namespace dsc  // distributed std container
         BL_BENCH_REPORT_MPI_NAMED(reduce_tuple, "reduction_densehash:local_reduce", this->comm);
       }
 
+      /**
+       * @brief combine duplicate keys locally with the reduction operator, so that only unique (key, value) pairs are distributed.
+       * @details  each input key is treated as (key, T(1)).  pred is applied to that tuple before combining.
+       *           output is overwritten.  input is left unchanged.
+       */
+      template <typename Predicate = ::bliss::filter::TruePredicate>
+      void local_combine(::std::vector<Key> const & input, ::std::vector<::std::pair<Key, T> > & output,
+                         Predicate const & pred = Predicate()) {
+        output.clear();
+        if (input.size() == 0) return;
+
+        // not reserving to input size: with high coverage data, the unique keys are a small fraction of the input.
+        local_container_type temp;
+
+        bool filter = !::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value;
+        ::std::pair<Key, T> v;
+        v.second = T(1);
+        auto max = input.end();
+        for (auto it = input.begin(); it != max; ++it) {
+          v.first = *it;
+          if (filter && !pred(v)) continue;
+
+          auto result = temp.insert(v);
+          if (!(result.second)) {
+            // failed insertion - means an entry is already there, so reduce
+            result.first->second = r(result.first->second, v.second);
+          }
+        }
+        temp.to_vector(output);
+
+        this->combine_in += input.size();
+        this->combine_out += output.size();
+      }
+
 
     public:
       reduction_densehash_map(const mxx::comm& _comm) :
-	  	  Base(_comm) {}
+	  	  Base(_comm), combine_local(false), combine_in(0), combine_out(0) {}
 
 
       virtual ~reduction_densehash_map() {};
 
+      /// the reduction operator, e.g. to give a stateful one (TaxonLCA) its data before inserting.
+      Reduc & get_reducer() {
+        return r;
+      }
+      Reduc const & get_reducer() const {
+        return r;
+      }
+
+      /// enable or disable local combining of duplicate keys before distribution, for key-only inserts.
+      void set_local_combine(bool v) {
+        combine_local = v;
+      }
+      bool is_local_combine() const {
+        return combine_local;
+      }
+      /// ratio of local element counts before vs after local combine, cumulative over all inserts.  0 if nothing was combined.
+      double get_combine_ratio() const {
+        return (combine_out == 0) ? 0.0 : static_cast<double>(combine_in) / static_cast<double>(combine_out);
+      }
+
       using Base::count;
       using Base::find;
       using Base::erase;
@@ -2566,6 +4206,7 @@ namespace dsc  // distributed std container
       size_t insert(std::vector<::std::pair<Key, T> >& input, bool sorted_input = false, Predicate const & pred = Predicate()) {
         // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
         BL_BENCH_INIT(insert);
+        BL_COMM_SCOPE(insert);
 
         if (::dsc::empty(input, this->comm)) {
           BL_BENCH_REPORT_MPI_NAMED(insert, "reduction_densehash:insert", this->comm);
@@ -2582,15 +4223,16 @@ namespace dsc  // distributed std container
         if (this->comm.size() > 1) {
           BL_BENCH_START(insert);
           // first remove duplicates.  sort, then get unique, finally remove the rest.  may not be needed
-          std::vector<size_t> recv_counts;
-          std::vector<size_t> i2o;
-          std::vector<::std::pair<Key, T> > buffer;
-          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-          input.swap(buffer);
+          // with presize on, also sizes the local container from the sketches sent with the counts.
+          this->distribute_presize(input);
 
 //          auto recv_counts = ::dsc::distribute(input, this->key_to_rank, sorted_input, this->comm);
 //          BLISS_UNUSED(recv_counts);
           BL_BENCH_END(insert, "dist_data", input.size());
+        } else if (this->presize_local) {
+          BL_BENCH_START(insert);
+          this->presize(input);
+          BL_BENCH_END(insert, "presize", this->c.bucket_count());
         }
 
         //
@@ -2605,6 +4247,7 @@ namespace dsc  // distributed std container
           " BEFORE input=" << input.size() << " size=" << this->local_size() << " buckets=" << this->c.bucket_count() << std::endl;
 
         size_t count = 0;
+        this->locality_order(input.begin(), input.end());
         if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
           count = this->local_insert(input.begin(), input.end(), pred);
         else
@@ -2627,6 +4270,50 @@ namespace dsc  // distributed std container
         return count;
       }
 
+      /**
+       * @brief insert new elements in the distributed reduction densehash_map, overlapping communication and local reduction.
+       * @details  see densehash_map::insert_overlap.
+       * @param input  content will be changed and reordered.
+       * @param batch_size  number of elements per round per process.  0 means 1 round.
+       */
+      template <typename Predicate = ::bliss::filter::TruePredicate>
+      size_t insert_overlap(std::vector<::std::pair<Key, T> >& input, size_t batch_size,
+                            bool sorted_input = false, Predicate const & pred = Predicate()) {
+        BL_BENCH_INIT(insert);
+        BL_COMM_SCOPE(insert_overlap);
+
+        if (::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(insert, "reduction_densehash:insert_overlap", this->comm);
+          return 0;
+        }
+
+        BL_BENCH_START(insert);
+        this->transform_input(input);
+        BL_BENCH_END(insert, "transform_input", input.size());
+
+        size_t count = 0;
+        auto inserter = [this, &pred, &count](typename ::std::vector<::std::pair<Key, T> >::iterator first,
+                                              typename ::std::vector<::std::pair<Key, T> >::iterator last) {
+          this->locality_order(first, last);
+          if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+            count += this->local_insert(first, last, pred);
+          else
+            count += this->local_insert(first, last);
+        };
+
+        BL_BENCH_START(insert);
+        if (this->comm.size() > 1) {
+          ::imxx::distribute_compute_overlap(input, this->key_to_rank, inserter, batch_size, this->comm);
+        } else {
+          inserter(input.begin(), input.end());
+        }
+        BL_BENCH_END(insert, "dist_insert", this->local_size());
+
+        BL_BENCH_REPORT_MPI_NAMED(insert, "reduction_densehash:insert_overlap", this->comm);
+
+        return count;
+      }
+
 
   };
 
@@ -2659,19 +4346,289 @@ namespace dsc  // distributed std container
    * @tparam Hash   hash function for local and distribution.  requires a template arugment (Key), and a bool (prefix, chooses the MSBs of hash instead of LSBs)
    * @tparam Equal   default to ::std::equal_to<Key>   equal function for the local storage.
    * @tparam Alloc  default to ::std::allocator< ::std::pair<const Key, T> >    allocator for local storage.
+   * @tparam Container  local container.  default ::fsc::densehash_map.  ::fsc::group_hash_map does not reserve keys, so it does not split.
    */
   template<
     typename Key, typename T,
     template <typename> class MapParams,
     typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
-    class Alloc = ::std::allocator< ::std::pair<const Key, T> >
+    class Alloc = ::std::allocator< ::std::pair<const Key, T> >,
+    template <typename, typename, typename, template <typename> class,
+      typename, typename, typename, bool> class Container = ::fsc::densehash_map
   >
   class counting_densehash_map : 
-    public reduction_densehash_map<Key, T, MapParams, SpecialKeys, ::std::plus<T>, Alloc> {
+    public reduction_densehash_map<Key, T, MapParams, SpecialKeys, ::std::plus<T>, Alloc, Container> {
       static_assert(::std::is_integral<T>::value, "count type has to be integral");
 
     protected:
-      using Base = reduction_densehash_map<Key, T, MapParams, SpecialKeys, ::std::plus<T>, Alloc>;
+      using Base = reduction_densehash_map<Key, T, MapParams, SpecialKeys, ::std::plus<T>, Alloc, Container>;
+
+      /// keys seen fewer times than this in one insert, and not yet in the map, are dropped.  see sketch_filter.
+      size_t min_count;
+
+      /// solid k-mer mode: a key is stored on its second occurrence, so singletons (mostly errors) never enter the map.
+      bool solid;
+      /// Bloom filter sizing.  0 expected keys means size from a HyperLogLog estimate at the first insert.
+      size_t solid_expected;
+      double solid_fp;
+      bool solid_sized;
+      /// keys seen exactly once over all previous inserts (up to false positives), and not in the map.
+      ::bliss::utils::sketch::bloom_filter seen_once;
+
+      /// heavy hitter mode: very frequent keys are counted on every rank instead of being sent to their owner.
+      bool heavy;
+      /// a key is heavy if it is at least this fraction of all keys in an insert call.
+      double heavy_fraction;
+      /// keys sampled per rank per insert call to detect heavy keys.
+      size_t heavy_sample;
+      /// heavy keys, in the same order on all ranks.
+      ::std::vector<Key> heavy_keys;
+      /// this rank's counts of heavy keys since the last heavy_sync.
+      typename Base::local_container_type heavy_delta;
+      /// replicated total counts of heavy keys.  the owner rank also holds the total in the local container.
+      typename Base::local_container_type heavy_total;
+
+      /// count the local stage with all OpenMP threads in a concurrent_count_table.  see set_concurrent_local.
+      bool concurrent_local;
+
+      /**
+       * @brief  local_combine, counted by all OpenMP threads at once when concurrent_local is set.
+       * @details  see ::fsc::parallel_count.  falls back to the serial local_combine without USE_OPENMP or with 1 thread.
+       */
+      template <typename Predicate>
+      void count_combine(::std::vector<Key> const & input, ::std::vector<::std::pair<Key, T> > & output,
+                         Predicate const & pred) {
+        typename Base::local_container_type fallback;
+        if (this->concurrent_local &&
+            ::fsc::parallel_count<typename Base::StoreTransformedFarmHash, typename Base::StoreTransformedEqual>(
+                input, pred, output, fallback)) {
+          this->combine_in += input.size();
+          this->combine_out += output.size();
+          return;
+        }
+        this->Base::local_combine(input, output, pred);
+      }
+
+      /**
+       * @brief  sample input to find globally heavy keys, then move their occurrences out of input into heavy_delta.  collective.
+       * @details  a key that is at least heavy_fraction of all input is at least that fraction on some rank, so each rank
+       *           nominates keys estimated at half the fraction locally, and the nominations are summed over all ranks.
+       *           input is already transformed and not yet distributed.  heavy keys found earlier stay heavy.
+       */
+      template <typename V>
+      void heavy_split(::std::vector<V> & input) {
+        size_t n = input.size();
+        size_t stride = ::std::max(static_cast<size_t>(1), (n + heavy_sample - 1) / heavy_sample);
+
+        // sampled, weighted counts.  estimated count is the sampled count times stride.
+        typename Base::template local_container_of<size_t> sample;
+        for (size_t i = 0; i < n; i += stride) {
+          auto result = sample.insert(::std::make_pair(this->sketch_key(input[i]), this->sketch_weight(input[i])));
+          if (!(result.second)) result.first->second += this->sketch_weight(input[i]);
+        }
+        size_t local_total = 0;
+        for (auto const & x : input) local_total += this->sketch_weight(x);
+
+        ::std::vector<::std::pair<Key, size_t> > candidates;
+        double local_bar = 0.5 * heavy_fraction * static_cast<double>(local_total);
+        for (auto it = sample.begin(); it != sample.end(); ++it) {
+          size_t est = it->second * stride;
+          if (static_cast<double>(est) >= local_bar) candidates.emplace_back(it->first, est);
+        }
+
+        size_t total = local_total;
+        if (this->comm.size() > 1) {
+          candidates = ::mxx::allgatherv(candidates, this->comm);
+          total = ::mxx::allreduce(local_total, this->comm);
+        }
+
+        // sum nominations in the gathered order, which is the same on all ranks.
+        typename Base::template local_container_of<size_t> sums;
+        ::std::vector<Key> order;
+        for (auto const & x : candidates) {
+          auto result = sums.insert(x);
+          if (result.second) order.emplace_back(x.first);
+          else result.first->second += x.second;
+        }
+        size_t before = heavy_keys.size();
+        double bar = heavy_fraction * static_cast<double>(total);
+        for (auto const & k : order) {
+          if ((static_cast<double>(sums.find(k)->second) >= bar) && (heavy_total.count(k) == 0)) {
+            heavy_keys.emplace_back(k);
+            heavy_total.insert(::std::make_pair(k, T(0)));
+          }
+        }
+        // new heavy keys start from the counts their owners already hold.
+        if (heavy_keys.size() > before) heavy_refresh();
+
+        if (heavy_keys.empty()) return;
+
+        // keep the non-heavy entries in input, count the heavy ones here.
+        size_t out = 0;
+        for (size_t i = 0; i < n; ++i) {
+          auto it = heavy_delta.find(this->sketch_key(input[i]));
+          if (it == heavy_delta.end()) {
+            if (heavy_total.count(this->sketch_key(input[i])) == 0) {
+              if (out != i) input[out] = ::std::move(input[i]);
+              ++out;
+              continue;
+            }
+            it = heavy_delta.insert(::std::make_pair(this->sketch_key(input[i]), T(0))).first;
+          }
+          it->second += static_cast<T>(this->sketch_weight(input[i]));
+        }
+        input.erase(input.begin() + out, input.end());
+      }
+
+      /**
+       * @brief  sum heavy_delta over all ranks into the replicated totals and the owners' local containers.  collective.
+       * @return  number of heavy keys newly added to this rank's local container.
+       */
+      size_t heavy_sync() {
+        if (heavy_keys.empty()) return 0;
+
+        ::std::vector<T> d(heavy_keys.size(), T(0));
+        for (size_t i = 0; i < heavy_keys.size(); ++i) {
+          auto it = heavy_delta.find(heavy_keys[i]);
+          if (it != heavy_delta.end()) d[i] = it->second;
+        }
+        heavy_delta.clear();
+        if (this->comm.size() > 1) d = ::mxx::allreduce(d, ::std::plus<T>(), this->comm);
+
+        size_t before = this->c.size();
+        for (size_t i = 0; i < heavy_keys.size(); ++i) {
+          if (d[i] == T(0)) continue;
+          heavy_total.find(heavy_keys[i])->second += d[i];
+
+          if (this->key_to_rank(heavy_keys[i]) == this->comm.rank()) {
+            auto result = this->c.insert(::std::make_pair(heavy_keys[i], d[i]));
+            if (!(result.second)) result.first->second += d[i];
+            this->local_changed = true;
+          }
+        }
+        return this->c.size() - before;
+      }
+
+      /// reload the replicated heavy totals from the owners' local containers, e.g. after erase or update.  collective.
+      void heavy_refresh() {
+        if (heavy_keys.empty()) return;
+
+        ::std::vector<T> v(heavy_keys.size(), T(0));
+        for (size_t i = 0; i < heavy_keys.size(); ++i) {
+          if (this->key_to_rank(heavy_keys[i]) != this->comm.rank()) continue;
+          auto it = this->c.find(heavy_keys[i]);
+          if (it != this->c.end()) v[i] = it->second;
+        }
+        if (this->comm.size() > 1) v = ::mxx::allreduce(v, ::std::plus<T>(), this->comm);
+
+        for (size_t i = 0; i < heavy_keys.size(); ++i) {
+          heavy_total.find(heavy_keys[i])->second = v[i];
+        }
+      }
+
+      /// move heavy keys out of a (transformed) query and answer them from the replicated totals.  local.
+      template <typename R, typename Op>
+      void heavy_query(::std::vector<Key> & keys, bool remove_duplicate, ::std::vector<::std::pair<Key, R> > & results, Op const & op) const {
+        local_container_type answered;
+        size_t out = 0;
+        for (size_t i = 0; i < keys.size(); ++i) {
+          auto it = heavy_total.find(keys[i]);
+          if (it == heavy_total.end()) {
+            if (out != i) keys[out] = ::std::move(keys[i]);
+            ++out;
+            continue;
+          }
+          if (remove_duplicate && !(answered.insert(*it).second)) continue;
+          op(*it, results);
+        }
+        keys.erase(keys.begin() + out, keys.end());
+      }
+
+      /**
+       * @brief  one answer per key, in key order.  heavy keys are answered by op from heavy_total, the others by query,
+       *         which is given them in order.  collective.
+       */
+      template <typename R, typename Op, typename Query>
+      ::std::vector<R> heavy_aligned(::std::vector<Key> const & keys, Op const & op, Query const & query) const {
+        ::std::vector<Key> trans(keys);
+        this->transform_input(trans);
+
+        // the light keys, in order, go through the distributed query.
+        ::std::vector<Key> light;
+        light.reserve(trans.size());
+        for (size_t i = 0; i < trans.size(); ++i) {
+          if (heavy_total.count(trans[i]) == 0) light.emplace_back(trans[i]);
+        }
+        ::std::vector<R> light_results = query(light);
+
+        ::std::vector<R> results;
+        results.reserve(trans.size());
+        size_t j = 0;
+        for (size_t i = 0; i < trans.size(); ++i) {
+          auto it = heavy_total.find(trans[i]);
+          if (it == heavy_total.end()) results.emplace_back(light_results[j++]);
+          else results.emplace_back(op(*it));
+        }
+        return results;
+      }
+
+      /**
+       * @brief  insert with singleton removal.  local, input is already distributed.
+       * @details  pass 1 promotes a key absent from the map into it when its weight is at least 2, when it was seen
+       *           once in an earlier insert (seen_once), or on its second sighting in this input.  a key promoted via
+       *           seen_once carries 1 for that earlier occurrence.  pass 2 adds every entry whose key is in the map, so
+       *           counts are exact except for seen_once false positives, which overcount by 1.  keys promoted on a
+       *           false positive of the per-call filter have count 1 after pass 2 and are erased again.
+       * @return  number of new keys in the map.
+       */
+      template <typename V>
+      size_t solid_insert(::std::vector<V> & input) {
+        if (!solid_sized) {
+          size_t n = solid_expected;
+          if (n == 0) {
+            ::bliss::utils::sketch::hyperloglog<> hll;
+            for (auto const & x : input) hll.update(this->sketch_hash(this->sketch_key(x)));
+            n = 2 * static_cast<size_t>(hll.estimate()) + 1;
+          }
+          seen_once = ::bliss::utils::sketch::bloom_filter(n, solid_fp);
+          solid_sized = true;
+        }
+        if (input.empty()) return 0;
+
+        size_t before = this->c.size();
+
+        // first sightings in this call.  same size as seen_once, so they can be merged.
+        ::bliss::utils::sketch::bloom_filter seen_now(seen_once);
+        seen_now.clear();
+
+        ::std::vector<Key> promoted;
+        for (auto const & x : input) {
+          Key const & k = this->sketch_key(x);
+          if (this->c.count(k) > 0) continue;
+
+          uint64_t h = this->sketch_hash(k);
+          bool earlier = seen_once.test(h);
+          if (earlier || (this->sketch_weight(x) > 1) || seen_now.test_and_insert(h)) {
+            this->c.insert(::std::make_pair(k, T(earlier ? 1 : 0)));
+            promoted.emplace_back(k);
+          }
+        }
+
+        for (auto const & x : input) {
+          auto it = this->c.find(this->sketch_key(x));
+          if (it != this->c.end()) it->second += static_cast<T>(this->sketch_weight(x));
+        }
+
+        if (!promoted.empty()) {
+          this->c.erase(promoted.begin(), promoted.end(), [](typename Base::local_container_type::value_type const & x) {
+            return x.second < 2;
+          });
+        }
+        seen_once.merge(seen_now);
+
+        if (this->c.size() != before) this->local_changed = true;
+        return this->c.size() - before;
+      }
 
     public:
       using local_container_type = typename Base::local_container_type;
@@ -2694,11 +4651,114 @@ namespace dsc  // distributed std container
 
 
       counting_densehash_map(const mxx::comm& _comm) :
-	  	  Base(_comm) {}
+	  	  Base(_comm), min_count(0), solid(false), solid_expected(0), solid_fp(0.01), solid_sized(false), seen_once(1, 0.01),
+	  	  heavy(false), heavy_fraction(0.001), heavy_sample(1UL << 16), concurrent_local(false) {}
 
 
       virtual ~counting_densehash_map() {};
 
+      /**
+       * @brief  k-mer count spectrum, e.g. for genome size estimation.  collective.
+       * @details  hist[i] is the number of distinct keys with count i for i < max_count, and hist[max_count] the number
+       *           with count at least max_count.  one scan of the local table, split among OpenMP threads when enabled,
+       *           then a reduction.  see dsc::count_histogram.
+       * @return  the histogram on root, empty on the other ranks.
+       */
+      ::std::vector<size_t> histogram(size_t max_count, int root = 0) const {
+        BL_BENCH_INIT(histogram);
+
+        BL_BENCH_START(histogram);
+        ::std::vector<size_t> hist = ::dsc::count_histogram(this->c, max_count, root, this->comm);
+        BL_BENCH_END(histogram, "histogram", hist.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(histogram, "count_densehash_map:histogram", this->comm);
+        return hist;
+      }
+
+      /**
+       * @brief  the k most abundant keys, e.g. adapters and contaminants.  collective.
+       * @details  one scan of the local table, split among OpenMP threads when enabled,
+       *           then O(log max count) scalar allreduces to find the k-th count, and only the k winners are gathered.
+       *           of keys tied at the k-th count, those on lower ranks are kept.  see dsc::count_top_k.
+       * @return  on root, min(k, size()) (key, count) pairs by descending count.  empty on the other ranks.
+       */
+      ::std::vector<::std::pair<Key, T> > top_k(size_t k, int root = 0) const {
+        BL_BENCH_INIT(top_k);
+
+        BL_BENCH_START(top_k);
+        ::std::vector<::std::pair<Key, T> > result = ::dsc::count_top_k(this->c, k, root, this->comm);
+        BL_BENCH_END(top_k, "top_k", result.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(top_k, "count_densehash_map:top_k", this->comm);
+        return result;
+      }
+
+      /**
+       * @brief  drop k-mers occurring fewer than c times per insert call (e.g. 2 removes singletons), before they are inserted.
+       * @details  uses a count-min sketch after distribution, so some rare keys may remain.  0 or 1 disables.
+       */
+      void set_min_count(size_t c) {
+        min_count = c;
+      }
+      size_t get_min_count() const {
+        return min_count;
+      }
+
+      /**
+       * @brief  solid k-mer mode: drop singleton k-mers before they are stored.  see solid_insert.
+       * @details  first occurrences are held in a per-rank Bloom filter for expected_distinct keys at false positive
+       *           rate fp, and only repeated k-mers enter the map.  the filter persists across insert calls, so a k-mer
+       *           seen once in each of 2 calls is kept.  0 expected_distinct sizes the filter at the first insert.
+       */
+      void set_solid(bool s, size_t expected_distinct = 0, double fp = 0.01) {
+        solid = s;
+        solid_expected = expected_distinct;
+        solid_fp = fp;
+        solid_sized = false;
+      }
+      bool is_solid() const {
+        return solid;
+      }
+
+      /**
+       * @brief  heavy hitter mode, for skewed inputs (repeats, adapters, poly-A) that overload the owner rank.
+       * @details  each insert samples up to sample_size keys per rank.  keys that are at least fraction of the input
+       *           are not sent to their owners any more: every rank counts its own occurrences, and the small per-key
+       *           counts are summed with one allreduce per insert.  totals are replicated on all ranks, so find and
+       *           count answer heavy keys locally.  the owner rank also stores the total, so iteration, size, erase,
+       *           and update see the usual contents.  collective: use the same settings on all ranks.
+       */
+      void set_heavy_hitters(bool h, double fraction = 0.001, size_t sample_size = (1UL << 16)) {
+        heavy = h;
+        heavy_fraction = fraction;
+        heavy_sample = ::std::max(static_cast<size_t>(1), sample_size);
+        if (!h) {
+          ::std::vector<Key>().swap(heavy_keys);
+          heavy_delta.clear();
+          heavy_total.clear();
+        }
+      }
+      bool is_heavy_hitters() const {
+        return heavy;
+      }
+
+      /**
+       * @brief  count keys in a concurrent_count_table shared by all OpenMP threads of the rank, instead of 1 thread.
+       * @details  applies to the local combine before distribution, and to the received keys before they are added to
+       *           the local container, which then only sees each distinct key once per insert.  the table is sized from a
+       *           HyperLogLog pass, and keys beyond its capacity are counted serially.  no effect without USE_OPENMP.
+       */
+      void set_concurrent_local(bool v) {
+        concurrent_local = v;
+      }
+      bool is_concurrent_local() const {
+        return concurrent_local;
+      }
+      /// keys currently treated as heavy hitters.
+      ::std::vector<Key> const & get_heavy_keys() const {
+        return heavy_keys;
+      }
+
       using Base::insert;
       using Base::count;
       using Base::find;
@@ -2706,6 +4766,143 @@ namespace dsc  // distributed std container
       using Base::unique_size;
       using Base::update;
 
+      /// find.  heavy keys are answered from the replicated totals when there is no predicate.
+      template <bool remove_duplicate = false, class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, T> > find(::std::vector<Key>& keys, bool sorted_input = false,
+                                                          Predicate const& pred = Predicate()) const {
+        if (this->heavy_keys.empty() || !::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          return Base::template find<remove_duplicate>(keys, sorted_input, pred);
+
+        // transforms are idempotent, so the base find transforms the remaining keys again harmlessly.
+        this->transform_input(keys);
+        ::std::vector<::std::pair<Key, T> > heavy_results;
+        this->heavy_query(keys, remove_duplicate, heavy_results,
+                          [](value_type const & x, ::std::vector<::std::pair<Key, T> > & out) {
+          if (x.second > T(0)) out.emplace_back(x.first, x.second);
+        });
+        auto results = Base::template find<remove_duplicate>(keys, sorted_input, pred);
+        results.insert(results.end(), heavy_results.begin(), heavy_results.end());
+        return results;
+      }
+
+      /// count.  heavy keys are answered from the replicated totals when there is no predicate.
+      template <bool remove_duplicate = false, class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, size_type> > count(::std::vector<Key>& keys, bool sorted_input = false,
+                                                        Predicate const& pred = Predicate() ) const {
+        if (this->heavy_keys.empty() || !::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          return Base::template count<remove_duplicate>(keys, sorted_input, pred);
+
+        this->transform_input(keys);
+        ::std::vector<::std::pair<Key, size_type> > heavy_results;
+        this->heavy_query(keys, remove_duplicate, heavy_results,
+                          [](value_type const & x, ::std::vector<::std::pair<Key, size_type> > & out) {
+          out.emplace_back(x.first, (x.second > T(0)) ? 1 : 0);
+        });
+        auto results = Base::template count<remove_duplicate>(keys, sorted_input, pred);
+        results.insert(results.end(), heavy_results.begin(), heavy_results.end());
+        return results;
+      }
+
+      /// find_fanout, with heavy keys answered from the replicated totals.
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, T> > find_fanout(::std::vector<Key> const & keys, ::std::vector<size_t> & offsets,
+                                                      Predicate const& pred = Predicate()) const {
+        return this->template fanout_query<T>(keys, offsets, [this, &pred](::std::vector<Key> & unique) {
+          return this->template find<false>(unique, false, pred);
+        });
+      }
+
+      /// count_fanout, with heavy keys answered from the replicated totals.
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, size_type> > count_fanout(::std::vector<Key> const & keys,
+                                                               Predicate const& pred = Predicate()) const {
+        return this->template fanout_query<size_type>(keys, size_type(0), [this, &pred](::std::vector<Key> & unique) {
+          return this->template count<false>(unique, false, pred);
+        });
+      }
+
+      /// find_aligned, with heavy keys answered from the replicated totals when there is no predicate.
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<T> find_aligned(::std::vector<Key> const & keys, T const & missing = T(),
+                                    Predicate const& pred = Predicate()) const {
+        if (this->heavy_keys.empty() || !::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          return Base::find_aligned(keys, missing, pred);
+
+        return this->template heavy_aligned<T>(keys, [&missing](value_type const & x) {
+          return (x.second > T(0)) ? x.second : missing;
+        }, [this, &missing, &pred](::std::vector<Key> const & light) {
+          return Base::find_aligned(light, missing, pred);
+        });
+      }
+
+      /// count_aligned, with heavy keys answered from the replicated totals when there is no predicate.
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<size_type> count_aligned(::std::vector<Key> const & keys, Predicate const& pred = Predicate()) const {
+        if (this->heavy_keys.empty() || !::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          return Base::count_aligned(keys, pred);
+
+        return this->template heavy_aligned<size_type>(keys, [](value_type const & x) {
+          return (x.second > T(0)) ? size_type(1) : size_type(0);
+        }, [this, &pred](::std::vector<Key> const & light) {
+          return Base::count_aligned(light, pred);
+        });
+      }
+
+      /// erase, then reload the heavy key totals.
+      template <bool remove_duplicate = false, class Predicate = ::bliss::filter::TruePredicate>
+      size_t erase(::std::vector<Key>& keys, bool sorted_input = false, Predicate const& pred = Predicate() ) {
+        size_t n = Base::template erase<remove_duplicate>(keys, sorted_input, pred);
+        this->heavy_refresh();
+        return n;
+      }
+
+      /// erase by predicate, then reload the heavy key totals.
+      template <typename Predicate>
+      size_t erase(Predicate const & pred = Predicate()) {
+        size_t n = Base::erase(pred);
+        this->heavy_refresh();
+        return n;
+      }
+
+      /// retain by predicate, then reload the heavy key totals.
+      template <typename Predicate>
+      size_t retain_if(Predicate const & pred) {
+        size_t n = Base::retain_if(pred);
+        this->heavy_refresh();
+        return n;
+      }
+
+      /// update, then reload the heavy key totals.
+      template <typename V, typename Updater>
+      size_t update(std::vector<::std::pair<Key, V> >& input, bool sorted_input, Updater const & op ) {
+        size_t n = Base::update(input, sorted_input, op);
+        this->heavy_refresh();
+        return n;
+      }
+
+      /// update by filter, then reload the heavy key totals.
+      template <typename Filter, typename Updater>
+      size_t update(Filter const & fop, Updater const & op ) {
+        size_t n = Base::update(fop, op);
+        this->heavy_refresh();
+        return n;
+      }
+
+      /// update with values[i] for keys[i], then reload the heavy key totals.
+      template <typename V, typename Updater>
+      size_t update(std::vector<Key> const & keys, std::vector<V> const & values, Updater const & op ) {
+        std::vector<::std::pair<Key, V> > input = ::dsc::zip(keys, values);
+        return this->update(input, false, op);
+      }
+
+      /// local merge, then reload the heavy key totals.  collective, unlike the base version.
+      template <typename V, typename Reducer>
+      size_t local_merge(::std::vector<::std::pair<Key, V> > const & input, Reducer const & op) {
+        size_t n = Base::local_merge(input, op);
+        this->heavy_refresh();
+        return n;
+      }
+
       /**
        * @brief insert new elements in the distributed densehash_multimap.
        * @param first
@@ -2715,6 +4912,7 @@ namespace dsc  // distributed std container
       size_t insert(std::vector< Key >& input, bool sorted_input = false, Predicate const &pred = Predicate()) {
         // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
         BL_BENCH_INIT(insert);
+        BL_COMM_SCOPE(insert);
 
         if (::dsc::empty(input, this->comm)) {
           BL_BENCH_REPORT_MPI_NAMED(insert, "count_densehash_map:insert", this->comm);
@@ -2768,15 +4966,67 @@ namespace dsc  // distributed std container
         this->transform_input(input);
         BL_BENCH_END(insert, "transform_input", input.size());
 
+        if (this->combine_local) {
+          // pre-aggregate locally, then only send the unique (key, count) pairs.
+          ::std::vector<::std::pair<Key, T> > combined;
+          BL_BENCH_START(insert);
+          this->count_combine(input, combined, pred);
+          ::std::vector<Key>().swap(input);  // raw keys no longer needed.
+          BL_BENCH_END(insert, "local_combine", combined.size());
+
+          if (this->heavy) {
+            BL_BENCH_START(insert);
+            this->heavy_split(combined);
+            BL_BENCH_END(insert, "heavy_split", combined.size());
+          }
+
+          if (this->comm.size() > 1) {
+            BL_BENCH_START(insert);
+            std::vector<size_t> recv_counts;
+            std::vector<::std::pair<Key, T> > buffer;
+            ::imxx::distribute(combined, this->key_to_rank, recv_counts, buffer, this->comm);  // counts commute, so bucket in place.
+            combined.swap(buffer);
+            BL_BENCH_END(insert, "dist_data", combined.size());
+          }
+
+          if ((this->min_count > 1) || this->presize_local) {
+            BL_BENCH_START(insert);
+            this->sketch_filter_presize(combined, this->min_count);
+            BL_BENCH_END(insert, "sketch", combined.size());
+          }
+
+          // predicate was already applied during combine.
+          BL_BENCH_START(insert);
+          this->locality_order(combined.begin(), combined.end());
+          size_t count = this->solid ? this->solid_insert(combined) :
+              this->Base::local_insert(combined.begin(), combined.end());
+          BL_BENCH_END(insert, "local_insert", this->local_size());
+
+          if (this->heavy) {
+            BL_BENCH_START(insert);
+            count += this->heavy_sync();
+            BL_BENCH_END(insert, "heavy_sync", this->heavy_keys.size());
+          }
+
+          BL_BENCH_REPORT_MPI_NAMED(insert, "count_densehash_map:insert_key", this->comm);
+
+          return count;
+        }
+
+        if (this->heavy) {
+          BL_BENCH_START(insert);
+          this->heavy_split(input);
+          BL_BENCH_END(insert, "heavy_split", input.size());
+        }
+
         // then send the raw k-mers.
         // communication part
         if (this->comm.size() > 1) {
           BL_BENCH_START(insert);
           // first remove duplicates.  sort, then get unique, finally remove the rest.  may not be needed
           std::vector<size_t> recv_counts;
-          std::vector<size_t> i2o;
           std::vector< Key > buffer;
-          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);  // counts commute, so bucket in place.
           input.swap(buffer);
 
 //          auto recv_counts = ::dsc::distribute(input, this->key_to_rank, sorted_input, this->comm);
@@ -2862,6 +5112,54 @@ namespace dsc  // distributed std container
 //        std::cout << "rank " << this->comm.rank() << " step_size=" << step_size << " init count=" << init_count <<
 //            " input=" << input.size() << " estimate=" << estimate << " size=" << this->local_size() << " buckets=" << this->c.bucket_count() << std::endl;
 
+          if ((this->min_count > 1) || this->presize_local) {
+            BL_BENCH_START(insert);
+            this->sketch_filter_presize(input, this->min_count);
+            BL_BENCH_END(insert, "sketch", input.size());
+          }
+
+          if (this->solid) {
+            BL_BENCH_START(insert);
+            if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value) {
+              input.erase(::std::partition(input.begin(), input.end(), [&pred](Key const & x) {
+                return pred(::std::make_pair(x, T(1)));
+              }), input.end());
+            }
+            count = this->solid_insert(input);
+            BL_BENCH_END(insert, "solid_insert", this->local_size());
+
+            if (this->heavy) {
+              BL_BENCH_START(insert);
+              count += this->heavy_sync();
+              BL_BENCH_END(insert, "heavy_sync", this->heavy_keys.size());
+            }
+
+            BL_BENCH_REPORT_MPI_NAMED(insert, "count_densehash_map:insert_key", this->comm);
+            return count;
+          }
+
+          if (this->concurrent_local) {
+            BL_BENCH_START(insert);
+            ::std::vector<::std::pair<Key, T> > combined;
+            this->count_combine(input, combined, pred);
+            BL_BENCH_END(insert, "concurrent_count", combined.size());
+
+            // predicate was already applied during combine.
+            BL_BENCH_START(insert);
+            this->locality_order(combined.begin(), combined.end());
+            count = this->Base::local_insert(combined.begin(), combined.end());
+            BL_BENCH_END(insert, "local_insert", this->local_size());
+
+            if (this->heavy) {
+              BL_BENCH_START(insert);
+              count += this->heavy_sync();
+              BL_BENCH_END(insert, "heavy_sync", this->heavy_keys.size());
+            }
+
+            BL_BENCH_REPORT_MPI_NAMED(insert, "count_densehash_map:insert_key", this->comm);
+            return count;
+          }
+
           BL_BENCH_START(insert);
           // preallocate.  easy way out - estimate to be 1/2 of input.  then at the end, resize if significantly less.
           //this->c.resize(input.size() / 2);
@@ -2870,6 +5168,7 @@ namespace dsc  // distributed std container
             " BEFORE input=" << input.size() << " size=" << this->local_size() << " buckets=" << this->c.bucket_count() << std::endl;
 
           // then insert all the rest,
+          this->locality_order(input.begin(), input.end());
           auto local_start = ::bliss::iterator::make_transform_iterator(input.begin(), trans);
           auto local_end = ::bliss::iterator::make_transform_iterator(input.end(), trans);
           // insert
@@ -2890,6 +5189,11 @@ namespace dsc  // distributed std container
 
           BL_BENCH_END(insert, "local_insert", this->local_size());
 
+          if (this->heavy) {
+            BL_BENCH_START(insert);
+            count += this->heavy_sync();
+            BL_BENCH_END(insert, "heavy_sync", this->heavy_keys.size());
+          }
 
 
         BL_BENCH_REPORT_MPI_NAMED(insert, "count_densehash_map:insert_key", this->comm);
@@ -2937,20 +5241,26 @@ namespace dsc  // distributed std container
    * @tparam Hash   hash function for local and distribution.  requires a template arugment (Key), and a bool (prefix, chooses the MSBs of hash instead of LSBs)
    * @tparam Equal   default to ::std::equal_to<Key>   equal function for the local storage.
    * @tparam Alloc  default to ::std::allocator< ::std::pair<const Key, T> >    allocator for local storage.
+   * @tparam Container  local container.  default ::fsc::densehash_map.  ::fsc::group_hash_map does not reserve keys, so it does not split.
    */
   template<
     typename Key, typename T,
     template <typename> class MapParams,
     typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
-    class Alloc = ::std::allocator< ::std::pair<const Key, T> >
+    class Alloc = ::std::allocator< ::std::pair<const Key, T> >,
+    template <typename, typename, typename, template <typename> class,
+      typename, typename, typename, bool> class Container = ::fsc::densehash_map
   >
   class saturating_counting_densehash_map :
-    public reduction_densehash_map<Key, T, MapParams, SpecialKeys, sat_plus<T>, Alloc> {
+    public reduction_densehash_map<Key, T, MapParams, SpecialKeys, sat_plus<T>, Alloc, Container> {
       static_assert(!::std::is_signed<T>::value &&
                     ::std::is_integral<T>::value, "only supports unsigned integer types for count");
 
     protected:
-      using Base = reduction_densehash_map<Key, T, MapParams, SpecialKeys, sat_plus<T>, Alloc>;
+      using Base = reduction_densehash_map<Key, T, MapParams, SpecialKeys, sat_plus<T>, Alloc, Container>;
+
+      /// keys seen fewer times than this in one insert, and not yet in the map, are dropped.  see sketch_filter.
+      size_t min_count;
 
     public:
       using local_container_type = typename Base::local_container_type;
@@ -2973,11 +5283,58 @@ namespace dsc  // distributed std container
 
 
       saturating_counting_densehash_map(const mxx::comm& _comm) :
-	  	  Base(_comm) {}
+	  	  Base(_comm), min_count(0) {}
 
 
       virtual ~saturating_counting_densehash_map() {};
 
+      /**
+       * @brief  k-mer count spectrum, e.g. for genome size estimation.  collective.
+       * @details  hist[i] is the number of distinct keys with count i for i < max_count, and hist[max_count] the number
+       *           with count at least max_count.  one scan of the local table, split among OpenMP threads when enabled,
+       *           then a reduction.  see dsc::count_histogram.
+       * @return  the histogram on root, empty on the other ranks.
+       */
+      ::std::vector<size_t> histogram(size_t max_count, int root = 0) const {
+        BL_BENCH_INIT(histogram);
+
+        BL_BENCH_START(histogram);
+        ::std::vector<size_t> hist = ::dsc::count_histogram(this->c, max_count, root, this->comm);
+        BL_BENCH_END(histogram, "histogram", hist.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(histogram, "saturating_count_densehash_map:histogram", this->comm);
+        return hist;
+      }
+
+      /**
+       * @brief  the k most abundant keys, e.g. adapters and contaminants.  collective.
+       * @details  one scan of the local table, split among OpenMP threads when enabled,
+       *           then O(log max count) scalar allreduces to find the k-th count, and only the k winners are gathered.
+       *           of keys tied at the k-th count, those on lower ranks are kept.  see dsc::count_top_k.
+       * @return  on root, min(k, size()) (key, count) pairs by descending count.  empty on the other ranks.
+       */
+      ::std::vector<::std::pair<Key, T> > top_k(size_t k, int root = 0) const {
+        BL_BENCH_INIT(top_k);
+
+        BL_BENCH_START(top_k);
+        ::std::vector<::std::pair<Key, T> > result = ::dsc::count_top_k(this->c, k, root, this->comm);
+        BL_BENCH_END(top_k, "top_k", result.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(top_k, "saturating_count_densehash_map:top_k", this->comm);
+        return result;
+      }
+
+      /**
+       * @brief  drop k-mers occurring fewer than c times per insert call (e.g. 2 removes singletons), before they are inserted.
+       * @details  uses a count-min sketch after distribution, so some rare keys may remain.  0 or 1 disables.
+       */
+      void set_min_count(size_t c) {
+        min_count = c;
+      }
+      size_t get_min_count() const {
+        return min_count;
+      }
+
       using Base::insert;
       using Base::count;
       using Base::find;
@@ -2994,6 +5351,7 @@ namespace dsc  // distributed std container
       size_t insert(std::vector< Key >& input, bool sorted_input = false, Predicate const &pred = Predicate()) {
         // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
         BL_BENCH_INIT(insert);
+        BL_COMM_SCOPE(insert);
 
         if (::dsc::empty(input, this->comm)) {
           BL_BENCH_REPORT_MPI_NAMED(insert, "saturating_count_densehash_map:insert", this->comm);
@@ -3010,17 +5368,49 @@ namespace dsc  // distributed std container
         this->transform_input(input);
         BL_BENCH_END(insert, "transform_input", input.size());
 
+        if (this->combine_local) {
+          // pre-aggregate locally, then only send the unique (key, count) pairs.
+          ::std::vector<::std::pair<Key, T> > combined;
+          BL_BENCH_START(insert);
+          this->Base::local_combine(input, combined, pred);
+          ::std::vector<Key>().swap(input);  // raw keys no longer needed.
+          BL_BENCH_END(insert, "local_combine", combined.size());
+
+          if (this->comm.size() > 1) {
+            BL_BENCH_START(insert);
+            std::vector<size_t> recv_counts;
+            std::vector<::std::pair<Key, T> > buffer;
+            ::imxx::distribute(combined, this->key_to_rank, recv_counts, buffer, this->comm);  // counts commute, so bucket in place.
+            combined.swap(buffer);
+            BL_BENCH_END(insert, "dist_data", combined.size());
+          }
+
+          if ((this->min_count > 1) || this->presize_local) {
+            BL_BENCH_START(insert);
+            this->sketch_filter_presize(combined, this->min_count);
+            BL_BENCH_END(insert, "sketch", combined.size());
+          }
+
+          // predicate was already applied during combine.
+          BL_BENCH_START(insert);
+          this->locality_order(combined.begin(), combined.end());
+          size_t count = this->Base::local_insert(combined.begin(), combined.end());
+          BL_BENCH_END(insert, "local_insert", this->local_size());
+
+          BL_BENCH_REPORT_MPI_NAMED(insert, "saturating_count_densehash_map:insert_key", this->comm);
+
+          return count;
+        }
+
         // then send the raw k-mers.
         // communication part
         if (this->comm.size() > 1) {
           BL_BENCH_START(insert);
           // first remove duplicates.  sort, then get unique, finally remove the rest.  may not be needed
           std::vector<size_t> recv_counts;
-          std::vector<size_t> i2o;
-
           std::vector<Key > buffer;
           //::imxx::destructive_distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
-          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);  // counts commute, so bucket in place.
           input.swap(buffer);
 
 //          auto recv_counts = ::dsc::distribute(input, this->key_to_rank, sorted_input, this->comm);
@@ -3033,6 +5423,12 @@ namespace dsc  // distributed std container
             return ::std::make_pair(x, T(1));
           };
 
+          if ((this->min_count > 1) || this->presize_local) {
+            BL_BENCH_START(insert);
+            this->sketch_filter_presize(input, this->min_count);
+            BL_BENCH_END(insert, "sketch", input.size());
+          }
+
           BL_BENCH_START(insert);
           // preallocate.  easy way out - estimate to be 1/2 of input.  then at the end, resize if significantly less.
           // this->c.resize(input.size() / 2);
@@ -3043,6 +5439,7 @@ namespace dsc  // distributed std container
 
 
           // then insert all the rest,
+          this->locality_order(input.begin(), input.end());
           auto local_start = ::bliss::iterator::make_transform_iterator(input.begin(), trans);
           auto local_end = ::bliss::iterator::make_transform_iterator(input.end(), trans);
           // insert
@@ -3069,6 +5466,53 @@ namespace dsc  // distributed std container
   };
 
 
+  /// distributed map with ::fsc::group_hash_map as local container.  SpecialKeys are used only by the comparator.
+  template<typename Key, typename T,
+    template <typename> class MapParams,
+    typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
+    class Alloc = ::std::allocator< ::std::pair<const Key, T> > >
+  using group_hash_map = densehash_map<Key, T, MapParams, SpecialKeys, Alloc, ::fsc::group_hash_map>;
+
+  template<typename Key, typename T,
+    template <typename> class MapParams,
+    typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
+    typename Reduc = ::std::plus<T>,
+    class Alloc = ::std::allocator< ::std::pair<const Key, T> > >
+  using reduction_group_hash_map = reduction_densehash_map<Key, T, MapParams, SpecialKeys, Reduc, Alloc, ::fsc::group_hash_map>;
+
+  template<typename Key, typename T,
+    template <typename> class MapParams,
+    typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
+    class Alloc = ::std::allocator< ::std::pair<const Key, T> > >
+  using counting_group_hash_map = counting_densehash_map<Key, T, MapParams, SpecialKeys, Alloc, ::fsc::group_hash_map>;
+
+  template<typename Key, typename T,
+    template <typename> class MapParams,
+    typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
+    class Alloc = ::std::allocator< ::std::pair<const Key, T> > >
+  using saturating_counting_group_hash_map = saturating_counting_densehash_map<Key, T, MapParams, SpecialKeys, Alloc, ::fsc::group_hash_map>;
+
+
+  /// distributed map with ::fsc::stashed_densehash_map as local container:  1 table, and a stash for the reserved keys.
+  template<typename Key, typename T,
+    template <typename> class MapParams,
+    typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
+    class Alloc = ::std::allocator< ::std::pair<const Key, T> > >
+  using stashed_densehash_map = densehash_map<Key, T, MapParams, SpecialKeys, Alloc, ::fsc::stashed_densehash_map>;
+
+  template<typename Key, typename T,
+    template <typename> class MapParams,
+    typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
+    typename Reduc = ::std::plus<T>,
+    class Alloc = ::std::allocator< ::std::pair<const Key, T> > >
+  using reduction_stashed_densehash_map = reduction_densehash_map<Key, T, MapParams, SpecialKeys, Reduc, Alloc, ::fsc::stashed_densehash_map>;
+
+  template<typename Key, typename T,
+    template <typename> class MapParams,
+    typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
+    class Alloc = ::std::allocator< ::std::pair<const Key, T> > >
+  using counting_stashed_densehash_map = counting_densehash_map<Key, T, MapParams, SpecialKeys, Alloc, ::fsc::stashed_densehash_map>;
+
 } /* namespace dsc */
 
 
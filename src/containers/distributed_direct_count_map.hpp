@@ -0,0 +1,717 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    distributed_direct_count_map.hpp
+ * @ingroup containers
+ * @author  tpan
+ * @brief   distributed k-mer counter for small k:  a flat array of counts indexed by the 2-bit k-mer value.
+ * @details for k up to about 14 (DNA) there are at most 4^k distinct k-mers, so hashing and probing are wasted work.
+ *          the counts live in an array of 4^k entries, and a k-mer's value is its index.
+ *
+ *          distributed mode (default):  rank r owns the r-th contiguous block of indices.  an insert either sends
+ *          the indices to their owners (sparse, few k-mers per insert), or counts every k-mer into a full local
+ *          histogram and sums the histograms with MPI_Reduce_scatter_block, so that each rank receives only its
+ *          block (dense, when a rank's input is at least as large as the table).
+ *
+ *          replicated mode (set_replicated(true)):  every rank holds the whole table, inserts sum per-rank deltas
+ *          with an allreduce, and queries are answered locally without communication.  for tables that fit in
+ *          each rank's memory and query heavy workloads.
+ *
+ *          local counting uses per-thread private counts when a thread's copy of the target fits in cache
+ *          (direct_count_private_bytes), and relaxed atomic adds otherwise.  both only with OpenMP.
+ *
+ *          the interface follows counting_densehash_map (insert, find, count, erase, update, find_aligned, count_aligned,
+ *          save, load), so it can stand in for it in the count index.  k-mers with count 0 are absent.
+ */
+#ifndef SRC_CONTAINERS_DISTRIBUTED_DIRECT_COUNT_MAP_HPP_
+#define SRC_CONTAINERS_DISTRIBUTED_DIRECT_COUNT_MAP_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <mxx/collective.hpp>
+#include <mxx/reduction.hpp>
+
+#include "containers/distributed_map_base.hpp"
+#include "containers/dsc_container_utils.hpp"
+#include "common/kmer.hpp"
+#include "utils/benchmark_utils.hpp"
+#include "utils/comm_stats.hpp"
+#include "utils/filter_utils.hpp"
+#include "io/incremental_mxx.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+namespace dsc  // distributed std container
+{
+
+  /// largest k-mer, in bits, for the direct count map.  2^28 counts is 1GB for 4 byte counts.
+  constexpr unsigned int direct_count_max_bits = 28;
+
+  /// per-thread private counts are used while a thread's copy of the target range is at most this size.
+  constexpr size_t direct_count_private_bytes = 256 * 1024;
+
+  /**
+   * @brief distributed count map for small k-mers, as a direct indexed array.  see file description.
+   * @tparam Key        k-mer type, Key::nBits <= direct_count_max_bits.
+   * @tparam T          count type.
+   * @tparam MapParams  same parameters as for the hash maps.  InputTransform (e.g. canonicalization) is applied
+   *                    before indexing.  the distribution and storage hash functions are not used.
+   */
+  template<typename Key, typename T,
+    template <typename> class MapParams,
+    class Alloc = ::std::allocator< ::std::pair<const Key, T> >
+  >
+  class direct_count_map : public ::dsc::map_base<Key, T, MapParams, Alloc> {
+      static_assert(::std::is_integral<T>::value, "count type has to be integral");
+      static_assert(::bliss::common::is_kmer<Key>::value, "direct_count_map requires a k-mer key");
+      static_assert(Key::nBits <= direct_count_max_bits, "k-mer too large for direct_count_map.  use counting_densehash_map.");
+
+    protected:
+      using Base = ::dsc::map_base<Key, T, MapParams, Alloc>;
+      using Word = typename Key::KmerWordType;
+
+      static constexpr unsigned int word_bits = 8 * sizeof(Word);
+
+    public:
+      using local_container_type = ::std::vector<T>;
+      using key_type              = Key;
+      using mapped_type           = T;
+      using value_type            = ::std::pair<const Key, T>;
+      using size_type             = size_t;
+
+      /// number of distinct keys.
+      static constexpr size_t table_size = static_cast<size_t>(1) << Key::nBits;
+
+      /// k-mer value as array index.
+      static inline uint32_t index(Key const & k) {
+        uint64_t v = 0;
+        for (unsigned int i = 0; i < Key::nWords; ++i)
+          v |= static_cast<uint64_t>(k.getData()[i]) << (i * word_bits);
+        return static_cast<uint32_t>(v & (table_size - 1));
+      }
+
+      /// array index as k-mer.
+      static inline Key key_at(size_t idx) {
+        Key k;
+        for (unsigned int i = 0; i < Key::nWords; ++i)
+          k.getDataRef()[i] = static_cast<Word>(static_cast<uint64_t>(idx) >> (i * word_bits));
+        return k;
+      }
+
+      /// block partition of the indices.  rank r owns [r * block, (r+1) * block).
+      struct KeyToRank {
+          typename Base::InputTransform trans;
+          size_t block;
+          int p;
+
+          KeyToRank(int comm_size) : block((table_size + comm_size - 1) / comm_size), p(comm_size) {}
+
+          /// owner of an index.
+          inline int operator()(uint32_t const & x) const {
+            return static_cast<int>(x / block);
+          }
+          template<typename V>
+          inline int operator()(::std::pair<uint32_t, V> const & x) const {
+            return static_cast<int>(x.first / block);
+          }
+          /// owner of an input key.  applies the input transform, as insert does.
+          inline int operator()(Key const & x) const {
+            return static_cast<int>(index(trans(x)) / block);
+          }
+          template<typename V>
+          inline int operator()(::std::pair<Key, V> const & x) const {
+            return this->operator()(x.first);
+          }
+          template<typename V>
+          inline int operator()(::std::pair<const Key, V> const & x) const {
+            return this->operator()(x.first);
+          }
+
+          template <typename ID>
+          inline void ranks(Key const * in, size_t n, ID * out) const {
+            for (size_t i = 0; i < n; ++i) out[i] = this->operator()(in[i]);
+          }
+      };
+
+      /// iterates over the (key, count) entries of the owned block with nonzero count.  dereferences to a value.
+      class const_iterator : public ::std::iterator<::std::forward_iterator_tag, ::std::pair<Key, T> > {
+          T const * counts;
+          size_t pos, end, base;
+
+          void skip() {
+            while ((pos < end) && (counts[pos - base] == T(0))) ++pos;
+          }
+        public:
+          const_iterator(T const * _counts, size_t _pos, size_t _end, size_t _base) :
+            counts(_counts), pos(_pos), end(_end), base(_base) {
+            skip();
+          }
+
+          ::std::pair<Key, T> operator*() const {
+            return ::std::pair<Key, T>(key_at(pos), counts[pos - base]);
+          }
+          const_iterator & operator++() {
+            ++pos;
+            skip();
+            return *this;
+          }
+          const_iterator operator++(int) {
+            const_iterator out(*this);
+            ++(*this);
+            return out;
+          }
+          bool operator==(const_iterator const & other) const { return pos == other.pos; }
+          bool operator!=(const_iterator const & other) const { return pos != other.pos; }
+      };
+
+    protected:
+      KeyToRank key_to_rank;
+
+      /// counts of the owned block, or of all keys in replicated mode.
+      local_container_type c;
+      /// index of c[0]:  0 when replicated, else the start of the owned block.
+      size_t offset;
+      /// owned block of indices.  reported by to_vector, keys, and local_size in both modes.
+      size_t lo, hi;
+      bool replicated;
+
+      /// resize c for the current mode.  clears the counts.
+      void layout() {
+        lo = ::std::min(table_size, static_cast<size_t>(this->comm.rank()) * key_to_rank.block);
+        hi = ::std::min(table_size, lo + key_to_rank.block);
+        offset = replicated ? 0 : lo;
+        local_container_type tmp(replicated ? table_size : (hi - lo), T(0));
+        c.swap(tmp);
+      }
+
+      static inline uint32_t id_of(uint32_t const & x) { return x; }
+      static inline uint32_t id_of(::std::pair<uint32_t, T> const & x) { return x.first; }
+      static inline T weight_of(uint32_t const &) { return T(1); }
+      static inline T weight_of(::std::pair<uint32_t, T> const & x) { return x.second; }
+
+      /**
+       * @brief  table[id - first] += weight for each input.  all ids are in [first, first + len).
+       * @details  threads count into private copies when the range fits in cache, then sum the copies.
+       *           otherwise relaxed atomic adds directly into the table.
+       */
+      template <typename V>
+      static void accumulate(::std::vector<V> const & input, size_t const first, T * table, size_t const len) {
+        size_t n = input.size();
+#ifdef _OPENMP
+        int nthreads = ::imxx::local::bucketing_threads(n);
+        if (nthreads > 1) {
+          if (len * sizeof(T) <= direct_count_private_bytes) {
+            ::std::vector<T> priv(static_cast<size_t>(nthreads) * len, T(0));
+#pragma omp parallel num_threads(nthreads)
+            {
+              int tid = omp_get_thread_num();
+              T * mine = priv.data() + tid * len;
+              size_t e = n * (tid + 1) / nthreads;
+              for (size_t i = n * tid / nthreads; i < e; ++i) mine[id_of(input[i]) - first] += weight_of(input[i]);
+
+#pragma omp barrier
+
+#pragma omp for schedule(static)
+              for (size_t j = 0; j < len; ++j) {
+                T s = table[j];
+                for (int t = 0; t < nthreads; ++t) s += priv[t * len + j];
+                table[j] = s;
+              }
+            }
+          } else {
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+            for (size_t i = 0; i < n; ++i)
+              __atomic_fetch_add(table + (id_of(input[i]) - first), weight_of(input[i]), __ATOMIC_RELAXED);
+          }
+          return;
+        }
+#endif
+        for (size_t i = 0; i < n; ++i) table[id_of(input[i]) - first] += weight_of(input[i]);
+      }
+
+      /// add indexed counts to the map.  collective.  returns the number of inputs counted on this rank.
+      template <typename V>
+      size_t add(::std::vector<V> & input) {
+        BL_BENCH_INIT(add);
+
+        size_t count = 0;
+        int p = this->comm.size();
+
+        if (p == 1) {
+          BL_BENCH_START(add);
+          accumulate(input, offset, c.data(), c.size());
+          count = input.size();
+          BL_BENCH_END(add, "local", count);
+
+        } else if (replicated) {
+          BL_BENCH_START(add);
+          local_container_type delta(table_size, T(0));
+          accumulate(input, 0, delta.data(), delta.size());
+          BL_BENCH_END(add, "local_delta", input.size());
+
+          BL_BENCH_START(add);
+          delta = ::mxx::allreduce(delta, ::std::plus<T>(), this->comm);
+          for (size_t j = 0; j < table_size; ++j) c[j] += delta[j];
+          count = input.size();
+          BL_BENCH_END(add, "allreduce", table_size);
+
+        } else {
+          // dense if the largest input costs more to send than a full histogram.
+          BL_BENCH_COLLECTIVE_START(add, "choose", this->comm);
+          size_t mx = ::mxx::allreduce(input.size(), ::mxx::max<size_t>(), this->comm);
+          bool dense = (mx * sizeof(V)) >= (table_size * sizeof(T));
+          BL_BENCH_END(add, "choose", dense);
+
+          if (dense) {
+            BL_BENCH_START(add);
+            size_t block = key_to_rank.block;
+            local_container_type hist(block * p, T(0));
+            accumulate(input, 0, hist.data(), hist.size());
+            BL_BENCH_END(add, "histogram", input.size());
+
+            BL_BENCH_START(add);
+            local_container_type delta(block, T(0));
+            ::mxx::datatype dt = ::mxx::get_datatype<T>();
+            MPI_Reduce_scatter_block(hist.data(), delta.data(), block, dt.type(), MPI_SUM, this->comm);
+            for (size_t j = 0; j < c.size(); ++j) c[j] += delta[j];
+            count = ::std::count_if(delta.begin(), delta.end(), [](T const & x) { return x != T(0); });
+            BL_COMM_RECORD("reduce_scatter", sizeof(T), ::std::vector<size_t>(p, block), ::std::vector<size_t>(p, block));
+            BL_BENCH_END(add, "reduce_scatter", count);
+
+          } else {
+            BL_BENCH_START(add);
+            ::std::vector<size_t> recv_counts;
+            ::std::vector<V> buffer;
+            ::imxx::distribute(input, key_to_rank, recv_counts, buffer, this->comm);
+            BL_BENCH_END(add, "distribute", buffer.size());
+
+            BL_BENCH_START(add);
+            accumulate(buffer, offset, c.data(), c.size());
+            count = buffer.size();
+            BL_BENCH_END(add, "local", count);
+          }
+        }
+
+        BL_BENCH_REPORT_MPI_NAMED(add, "direct_count_map:add", this->comm);
+        return count;
+      }
+
+      /// transform the keys, and return their indices.
+      ::std::vector<uint32_t> indices(::std::vector<Key> const & keys) const {
+        ::std::vector<Key> transformed;
+        this->transform_input(keys, transformed);
+        ::std::vector<uint32_t> ids(transformed.size());
+        for (size_t i = 0; i < transformed.size(); ++i) ids[i] = index(transformed[i]);
+        return ids;
+      }
+
+      /**
+       * @brief answer(count) for each index, in input order.  collective.
+       * @details  replicated or single rank maps answer locally.  otherwise the indices go to their owners and the
+       *           answers come back in the original order.
+       */
+      template <typename R, typename Answer>
+      ::std::vector<R> query_aligned(::std::vector<uint32_t> & ids, Answer const & answer) const {
+        ::std::vector<R> results;
+        if (replicated || (this->comm.size() == 1)) {
+          results.resize(ids.size());
+          for (size_t i = 0; i < ids.size(); ++i) results[i] = answer(c[ids[i] - offset]);
+          return results;
+        }
+
+        ::std::vector<size_t> recv_counts;
+        ::std::vector<size_t> i2o;
+        ::std::vector<uint32_t> buffer;
+        ::imxx::distribute(ids, key_to_rank, recv_counts, i2o, buffer, this->comm, true);
+
+        ::std::vector<R> ans(buffer.size());
+        for (size_t i = 0; i < buffer.size(); ++i) ans[i] = answer(c[buffer[i] - offset]);
+
+        ::imxx::undistribute(ans, recv_counts, i2o, results, this->comm, true);
+        return results;
+      }
+
+      /// sort and deduplicate the indices.
+      static void unique_ids(::std::vector<uint32_t> & ids) {
+        ::std::sort(ids.begin(), ids.end());
+        ids.erase(::std::unique(ids.begin(), ids.end()), ids.end());
+      }
+
+      /// nonzero entries in the owned block.
+      size_t owned_nonzero() const {
+        return ::std::count_if(c.begin() + (lo - offset), c.begin() + (hi - offset), [](T const & x) { return x != T(0); });
+      }
+
+      virtual void local_reset() {
+        ::std::fill(c.begin(), c.end(), T(0));
+      }
+      virtual void local_clear() {
+        ::std::fill(c.begin(), c.end(), T(0));
+      }
+      /// the table is allocated at construction.
+      virtual void local_reserve(size_t n) {}
+
+      /// segments hold the owned blocks.  in replicated mode the blocks of all ranks are summed, so this is collective.
+      virtual void local_load(::std::pair<Key, T> const * first, ::std::pair<Key, T> const * last) {
+        ::std::vector<::std::pair<uint32_t, T> > input;
+        input.reserve(::std::distance(first, last));
+        for (; first != last; ++first) input.emplace_back(index(first->first), first->second);
+        if (replicated) this->add(input);
+        else accumulate(input, offset, c.data(), c.size());
+      }
+
+      virtual void load_distribute(::std::vector<::std::pair<Key, T> > & input) {
+        ::std::vector<::std::pair<uint32_t, T> > ids;
+        ids.reserve(input.size());
+        for (auto const & x : input) ids.emplace_back(index(x.first), x.second);
+        this->add(ids);
+      }
+
+      /// see map_base::local_batches.  the owned block, as to_vector.
+      virtual void local_batches(size_t const & batch_size, typename Base::batch_op_type const & op) const {
+        Base::visit_batches(this->cbegin(), this->cend(), batch_size, op);
+      }
+
+    public:
+      direct_count_map(const mxx::comm& _comm) : Base(_comm), key_to_rank(_comm.size()),
+          offset(0), lo(0), hi(0), replicated(false) {
+        layout();
+      }
+
+      virtual ~direct_count_map() {};
+
+      /// switch between distributed and replicated tables.  clears the map.  collective.
+      void set_replicated(bool rep) {
+        replicated = rep;
+        layout();
+        if (this->comm.size() > 1) this->comm.barrier();
+      }
+
+      bool is_replicated() const { return replicated; }
+
+      KeyToRank const & get_key_to_rank() const { return key_to_rank; }
+
+      /// the local counts.  indexed from get_offset().
+      local_container_type const & get_local_container() const { return c; }
+      size_t get_offset() const { return offset; }
+
+      const_iterator cbegin() const {
+        return const_iterator(c.data(), lo, hi, offset);
+      }
+      const_iterator cend() const {
+        return const_iterator(c.data(), hi, hi, offset);
+      }
+
+      // ============= data access.  the owned block only, so that each key is reported by 1 rank in either mode.
+
+      virtual void to_vector(::std::vector<::std::pair<Key, T> > & result) const {
+        result.clear();
+        result.reserve(owned_nonzero());
+        for (size_t j = lo; j < hi; ++j)
+          if (c[j - offset] != T(0)) result.emplace_back(key_at(j), c[j - offset]);
+      }
+
+      virtual void keys(::std::vector<Key> & result) const {
+        result.clear();
+        result.reserve(owned_nonzero());
+        for (size_t j = lo; j < hi; ++j)
+          if (c[j - offset] != T(0)) result.emplace_back(key_at(j));
+      }
+
+      using Base::to_vector;
+      using Base::keys;
+
+      /// scans the owned block.
+      virtual bool local_empty() const {
+        return ::std::all_of(c.begin() + (lo - offset), c.begin() + (hi - offset), [](T const & x) { return x == T(0); });
+      }
+      /// number of distinct keys with nonzero count in the owned block.  scans the block.
+      virtual size_t local_size() const {
+        return owned_nonzero();
+      }
+      virtual size_t local_unique_size() const {
+        return owned_nonzero();
+      }
+
+      // ============= modifiers.  collective.
+
+      /**
+       * @brief count the keys.  input is transformed in place.  collective.
+       * @return  number of keys (distributed sparse, or replicated), or of distinct keys (dense) counted on this rank.
+       */
+      template <typename Predicate = ::bliss::filter::TruePredicate>
+      size_t insert(::std::vector<Key>& input, bool sorted_input = false, Predicate const & pred = Predicate()) {
+        BL_BENCH_INIT(insert);
+        BL_COMM_SCOPE(insert);
+
+        if (::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(insert, "direct_count_map:insert", this->comm);
+          return 0;
+        }
+
+        BL_BENCH_START(insert);
+        this->transform_input(input);
+        BL_BENCH_END(insert, "transform_input", input.size());
+
+        BL_BENCH_START(insert);
+        ::std::vector<uint32_t> ids;
+        ids.reserve(input.size());
+        for (auto const & k : input)
+          if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value || pred(k)) ids.emplace_back(index(k));
+        BL_BENCH_END(insert, "index", ids.size());
+
+        BL_BENCH_START(insert);
+        size_t count = this->add(ids);
+        BL_BENCH_END(insert, "add", count);
+
+        BL_BENCH_REPORT_MPI_NAMED(insert, "direct_count_map:insert", this->comm);
+        return count;
+      }
+
+      /// add the given counts.  input is transformed in place.  collective.
+      template <typename Predicate = ::bliss::filter::TruePredicate>
+      size_t insert(::std::vector<::std::pair<Key, T> >& input, bool sorted_input = false, Predicate const & pred = Predicate()) {
+        BL_BENCH_INIT(insert);
+        BL_COMM_SCOPE(insert);
+
+        if (::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(insert, "direct_count_map:insert", this->comm);
+          return 0;
+        }
+
+        BL_BENCH_START(insert);
+        this->transform_input(input);
+        BL_BENCH_END(insert, "transform_input", input.size());
+
+        BL_BENCH_START(insert);
+        ::std::vector<::std::pair<uint32_t, T> > ids;
+        ids.reserve(input.size());
+        for (auto const & x : input)
+          if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value || pred(x)) ids.emplace_back(index(x.first), x.second);
+        BL_BENCH_END(insert, "index", ids.size());
+
+        BL_BENCH_START(insert);
+        size_t count = this->add(ids);
+        BL_BENCH_END(insert, "add", count);
+
+        BL_BENCH_REPORT_MPI_NAMED(insert, "direct_count_map:insert", this->comm);
+        return count;
+      }
+
+      /**
+       * @brief remove the keys.  collective.
+       * @return  number of keys removed on this rank.  in replicated mode, the removed keys in the owned block.
+       */
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      size_t erase(::std::vector<Key>& keys, bool sorted_input = false, Predicate const& pred = Predicate() ) {
+        BL_BENCH_INIT(erase);
+        BL_COMM_SCOPE(erase);
+
+        if (::dsc::empty(keys, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(erase, "direct_count_map:erase", this->comm);
+          return 0;
+        }
+
+        BL_BENCH_START(erase);
+        ::std::vector<uint32_t> ids = this->indices(keys);
+        unique_ids(ids);
+        if (this->comm.size() > 1) {
+          if (replicated) {
+            ids = ::mxx::allgatherv(ids, this->comm);
+            unique_ids(ids);
+          } else {
+            ::std::vector<size_t> recv_counts;
+            ::std::vector<uint32_t> buffer;
+            ::imxx::distribute(ids, key_to_rank, recv_counts, buffer, this->comm);
+            ids.swap(buffer);
+            unique_ids(ids);
+          }
+        }
+        BL_BENCH_END(erase, "distribute", ids.size());
+
+        BL_BENCH_START(erase);
+        size_t count = 0;
+        for (auto const & id : ids) {
+          T & x = c[id - offset];
+          if (x == T(0)) continue;
+          if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value &&
+              !pred(::std::make_pair(key_at(id), x))) continue;
+          x = T(0);
+          if ((id >= lo) && (id < hi)) ++count;
+        }
+        BL_BENCH_END(erase, "local_erase", count);
+
+        BL_BENCH_REPORT_MPI_NAMED(erase, "direct_count_map:erase", this->comm);
+        return count;
+      }
+
+      /**
+       * @brief apply op(count, v) to the count of each key in input with nonzero count.  collective.
+       * @details  op returns the number of entries it changed.  a count set to 0 removes the key.  in replicated mode
+       *           every rank applies all updates.
+       * @return  number of entries updated on this rank.  in replicated mode, those in the owned block.
+       */
+      template <typename V, typename Updater>
+      size_t update(::std::vector<::std::pair<Key, V> >& input, bool sorted_input, Updater const & op) {
+        BL_BENCH_INIT(update);
+        BL_COMM_SCOPE(update);
+
+        if (::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(update, "direct_count_map:update", this->comm);
+          return 0;
+        }
+
+        BL_BENCH_START(update);
+        this->transform_input(input);
+        ::std::vector<::std::pair<uint32_t, V> > ids;
+        ids.reserve(input.size());
+        for (auto const & x : input) ids.emplace_back(index(x.first), x.second);
+        if (this->comm.size() > 1) {
+          if (replicated) {
+            ids = ::mxx::allgatherv(ids, this->comm);
+          } else {
+            ::std::vector<size_t> recv_counts;
+            ::std::vector<::std::pair<uint32_t, V> > buffer;
+            ::imxx::distribute(ids, key_to_rank, recv_counts, buffer, this->comm);
+            ids.swap(buffer);
+          }
+        }
+        BL_BENCH_END(update, "distribute", ids.size());
+
+        BL_BENCH_START(update);
+        size_t count = 0;
+        for (auto const & id : ids) {
+          T & x = c[id.first - offset];
+          if (x == T(0)) continue;
+          size_t changed = op(x, id.second);
+          if ((id.first >= lo) && (id.first < hi)) count += changed;
+        }
+        BL_BENCH_END(update, "local_update", count);
+
+        BL_BENCH_REPORT_MPI_NAMED(update, "direct_count_map:update", this->comm);
+        return count;
+      }
+
+      /// update with values[i] for keys[i].  see update(input, sorted_input, op).  collective.
+      template <typename V, typename Updater>
+      size_t update(::std::vector<Key> const & keys, ::std::vector<V> const & values, Updater const & op) {
+        ::std::vector<::std::pair<Key, V> > input = ::dsc::zip(keys, values);
+        return this->update(input, false, op);
+      }
+
+      // ============= queries.  collective.  keys are transformed as in insert.
+
+      /// counts, with values[i] for keys[i], or missing if keys[i] is not in the map.  keys is not modified.
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<T> find_aligned(::std::vector<Key> const & keys, T const & missing = T(),
+                                    Predicate const& pred = Predicate()) const {
+        ::std::vector<T> results;
+        if (::dsc::empty(keys, this->comm)) return results;
+
+        ::std::vector<uint32_t> ids = this->indices(keys);
+        if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value) {
+          results = this->template query_aligned<T>(ids, [&missing](T const & x) { return (x == T(0)) ? missing : x; });
+        } else {
+          // the predicate needs the key, so answer with the count and filter here.
+          results = this->template query_aligned<T>(ids, [](T const & x) { return x; });
+          for (size_t i = 0; i < results.size(); ++i)
+            if ((results[i] == T(0)) || !pred(::std::make_pair(key_at(ids[i]), results[i]))) results[i] = missing;
+        }
+        return results;
+      }
+
+      /// 1 if keys[i] is in the map, else 0.  keys is not modified.
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<size_type> count_aligned(::std::vector<Key> const & keys, Predicate const& pred = Predicate()) const {
+        ::std::vector<T> found = this->find_aligned(keys, T(0), pred);
+        ::std::vector<size_type> results(found.size());
+        for (size_t i = 0; i < found.size(); ++i) results[i] = (found[i] == T(0)) ? 0 : 1;
+        return results;
+      }
+
+      /**
+       * @brief (key, count) of the keys in the map.  keys are returned transformed, once per query unless
+       *        remove_duplicate.  keys is not modified.
+       */
+      template <bool remove_duplicate = false, class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, T> > find(::std::vector<Key>& keys, bool sorted_input = false,
+                                               Predicate const& pred = Predicate()) const {
+        BL_BENCH_INIT(find);
+        BL_COMM_SCOPE(find);
+        ::std::vector<::std::pair<Key, T> > results;
+
+        if (::dsc::empty(keys, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(find, "direct_count_map:find", this->comm);
+          return results;
+        }
+
+        BL_BENCH_START(find);
+        ::std::vector<uint32_t> ids = this->indices(keys);
+        if (remove_duplicate) unique_ids(ids);
+        BL_BENCH_END(find, "index", ids.size());
+
+        BL_BENCH_START(find);
+        ::std::vector<T> found = this->template query_aligned<T>(ids, [](T const & x) { return x; });
+        BL_BENCH_END(find, "query", found.size());
+
+        BL_BENCH_START(find);
+        for (size_t i = 0; i < found.size(); ++i) {
+          if (found[i] == T(0)) continue;
+          ::std::pair<Key, T> x(key_at(ids[i]), found[i]);
+          if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value || pred(x)) results.emplace_back(x);
+        }
+        BL_BENCH_END(find, "results", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(find, "direct_count_map:find", this->comm);
+        return results;
+      }
+
+      /// (key, 0 or 1) per query.  keys are returned transformed, once per query unless remove_duplicate.
+      template <bool remove_duplicate = false, class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, size_type> > count(::std::vector<Key>& keys, bool sorted_input = false,
+                                                        Predicate const& pred = Predicate() ) const {
+        ::std::vector<::std::pair<Key, size_type> > results;
+        if (::dsc::empty(keys, this->comm)) return results;
+
+        ::std::vector<uint32_t> ids = this->indices(keys);
+        if (remove_duplicate) unique_ids(ids);
+        ::std::vector<T> found = this->template query_aligned<T>(ids, [](T const & x) { return x; });
+
+        results.reserve(found.size());
+        for (size_t i = 0; i < found.size(); ++i) {
+          Key k = key_at(ids[i]);
+          bool in = (found[i] != T(0)) &&
+              (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value || pred(::std::make_pair(k, found[i])));
+          results.emplace_back(k, in ? 1 : 0);
+        }
+        return results;
+      }
+  };
+
+
+} /* namespace dsc */
+
+
+#endif /* SRC_CONTAINERS_DISTRIBUTED_DIRECT_COUNT_MAP_HPP_ */
@@ -0,0 +1,346 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    distributed_key_ids.hpp
+ * @ingroup containers
+ * @author  tpan
+ * @brief   dense global integer ids for the keys of a distributed map.
+ * @details graph edges, read to k-mer matrices and colored de Bruijn graphs are much smaller with k-mers replaced by
+ *          integer ids.  assign_ids(map) numbers each rank's distinct keys 0..n_r-1 in the map's local order (key order
+ *          for sorted maps), and an exclusive prefix scan of the n_r makes the ids global:  the ids of rank r are
+ *          [first_r, first_r + n_r), so an id gives its rank and local slot directly, without communication.
+ *
+ *          key to id lookups go to the key's owner with the map's distribution function, as the map's find does, and
+ *          are answered from a compact open addressing table of slot numbers, 4 bytes per slot at load 0.5 or less.
+ *          the index keeps a copy of the keys, so it can answer id to key queries too, and does not see later changes
+ *          to the map.  construction and the batched queries are collective.
+ */
+#ifndef SRC_CONTAINERS_DISTRIBUTED_KEY_IDS_HPP_
+#define SRC_CONTAINERS_DISTRIBUTED_KEY_IDS_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+#include <mxx/reduction.hpp>
+
+#include "io/incremental_mxx.hpp"
+#include "utils/benchmark_utils.hpp"
+#include "utils/comm_stats.hpp"
+#include "utils/transform_utils.hpp"
+
+namespace dsc
+{
+
+  /**
+   * @brief dense global ids of the keys of a distributed map.  see file comment.
+   * @tparam KeyToRank   distribution function of the map.  key to owner rank.
+   * @tparam InputTransform  applied to query keys, as the map's find does.
+   * @tparam Hash, Equal  hash and equality of the transformed keys.
+   * @tparam ID  id type.  the number of distinct keys has to be less than its largest value, which marks absent keys.
+   */
+  template <typename Key, typename KeyToRank, typename InputTransform, typename Hash, typename Equal, typename ID = uint64_t>
+  class key_id_index {
+      static_assert(::std::is_integral<ID>::value && ::std::is_unsigned<ID>::value, "id type has to be unsigned integral");
+
+    public:
+      using key_type = Key;
+      using id_type = ID;
+
+      /// id of absent keys.
+      static constexpr ID missing = ::std::numeric_limits<ID>::max();
+
+      /// owner rank of an id.
+      struct IdToRank {
+          ::std::vector<ID> const * firsts;
+
+          inline int operator()(ID const & id) const {
+            return static_cast<int>(::std::upper_bound(firsts->begin(), firsts->end(), id) - firsts->begin()) - 1;
+          }
+      };
+
+    protected:
+      KeyToRank key_to_rank;
+      ::mxx::comm comm;
+      Hash hash;
+      Equal equal;
+
+      /// local keys, by slot.
+      ::std::vector<Key> slot_keys;
+      /// open addressing table of slot + 1.  0 is empty.
+      ::std::vector<uint32_t> table;
+      size_t mask;
+      /// first id of each rank, and the total number of ids at the end.
+      ::std::vector<ID> firsts;
+
+      /// 64 bit finalizer of MurmurHash3.  the storage hash may share bits with the distribution hash.
+      static inline uint64_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+      }
+
+      inline size_t home(Key const & k) const {
+        return mix(static_cast<uint64_t>(hash(k))) & mask;
+      }
+
+      static constexpr size_t no_slot = ::std::numeric_limits<size_t>::max();
+
+      /// local slot of the transformed key k, starting the probe at pos.  no_slot if absent.
+      inline size_t probe(Key const & k, size_t pos) const {
+        for (;; pos = (pos + 1) & mask) {
+          uint32_t s = table[pos];
+          if (s == 0) return no_slot;
+          if (equal(slot_keys[s - 1], k)) return s - 1;
+        }
+      }
+
+      /// ids of transformed local keys.  hashes a block first, and prefetches its table entries.
+      void local_ids(Key const * keys, size_t n, ID * out) const {
+        constexpr size_t block = 64;
+        size_t pos[block];
+        ID first = firsts[comm.rank()];
+        for (size_t i = 0; i < n; i += block) {
+          size_t m = ::std::min(block, n - i);
+          for (size_t j = 0; j < m; ++j) {
+            pos[j] = home(keys[i + j]);
+            __builtin_prefetch(table.data() + pos[j]);
+          }
+          for (size_t j = 0; j < m; ++j) {
+            size_t s = probe(keys[i + j], pos[j]);
+            out[i + j] = (s == no_slot) ? missing : static_cast<ID>(first + s);
+          }
+        }
+      }
+
+    public:
+      /**
+       * @brief number this rank's keys, and make the ids global.  collective.
+       * @param keys  this rank's keys, transformed as stored in the map.  duplicates, e.g. of a multimap, get 1 id.
+       */
+      key_id_index(::std::vector<Key> const & keys, KeyToRank const & _key_to_rank, ::mxx::comm const & _comm,
+                   Hash const & _hash = Hash(), Equal const & _equal = Equal()) :
+        key_to_rank(_key_to_rank), comm(_comm.copy()), hash(_hash), equal(_equal), mask(0) {
+        BL_BENCH_INIT(assign_ids);
+
+        BL_BENCH_START(assign_ids);
+        size_t cap = 16;
+        while (cap < 2 * keys.size()) cap <<= 1;
+        table.assign(cap, 0);
+        mask = cap - 1;
+        slot_keys.reserve(keys.size());
+        bool fits = keys.size() < static_cast<size_t>(::std::numeric_limits<uint32_t>::max());
+        for (size_t i = 0; fits && (i < keys.size()); ++i) {
+          size_t pos = home(keys[i]);
+          for (; table[pos] != 0; pos = (pos + 1) & mask) {
+            if (equal(slot_keys[table[pos] - 1], keys[i])) break;
+          }
+          if (table[pos] != 0) continue;
+          slot_keys.emplace_back(keys[i]);
+          table[pos] = static_cast<uint32_t>(slot_keys.size());
+        }
+        BL_BENCH_END(assign_ids, "local", slot_keys.size());
+
+        BL_BENCH_COLLECTIVE_START(assign_ids, "exscan", comm);
+        size_t n = slot_keys.size();
+        size_t first = (comm.size() > 1) ? ::mxx::exscan(n, ::std::plus<size_t>(), comm) : 0;
+        if (comm.rank() == 0) first = 0;
+        ::std::vector<size_t> all = (comm.size() > 1) ? ::mxx::allgather(first, comm) : ::std::vector<size_t>(1, first);
+        size_t total = (comm.size() > 1) ? ::mxx::allreduce(n, comm) : n;
+        fits = (comm.size() > 1) ? ::mxx::all_of(fits, comm) : fits;
+        firsts.assign(all.begin(), all.end());
+        firsts.emplace_back(static_cast<ID>(total));
+        BL_BENCH_END(assign_ids, "exscan", total);
+
+        BL_BENCH_REPORT_MPI_NAMED(assign_ids, "key_id_index:ctor", comm);
+
+        if (!fits) throw ::std::length_error("key_id_index: more than 2^32 - 1 keys on a rank.");
+        if (total >= static_cast<size_t>(missing)) throw ::std::overflow_error("key_id_index: too many keys for the id type.");
+      }
+
+      /// global number of ids.
+      size_t size() const { return static_cast<size_t>(firsts.back()); }
+      /// number of ids on this rank.
+      size_t local_size() const { return slot_keys.size(); }
+      /// first id of rank r.  the ids of r are [first_id(r), first_id(r + 1)).
+      ID first_id(int r) const { return firsts[r]; }
+
+      KeyToRank const & get_key_to_rank() const { return key_to_rank; }
+      IdToRank get_id_to_rank() const { return IdToRank{&firsts}; }
+
+      /// bytes of this rank's keys and table.
+      size_t local_bytes() const {
+        return slot_keys.capacity() * sizeof(Key) + table.capacity() * sizeof(uint32_t) + firsts.capacity() * sizeof(ID);
+      }
+
+      // ============= local, without communication.
+
+      /// owner rank and local slot of an id.
+      ::std::pair<int, size_t> locate(ID const & id) const {
+        int r = IdToRank{&firsts}(id);
+        return ::std::make_pair(r, static_cast<size_t>(id - firsts[r]));
+      }
+
+      /// key of a local slot.
+      Key const & local_key(size_t const & slot) const { return slot_keys[slot]; }
+      /// the local keys, by slot.
+      ::std::vector<Key> const & local_keys() const { return slot_keys; }
+
+      /// id of a key on this rank, transformed as in the map.  missing if absent.
+      ID local_id(Key const & k) const {
+        size_t s = probe(k, home(k));
+        return (s == no_slot) ? missing : static_cast<ID>(firsts[comm.rank()] + s);
+      }
+
+      // ============= batched queries.  collective.
+
+      /**
+       * @brief ids of the keys, ids[i] for keys[i], or missing.  keys are transformed as in the map's find.
+       *        keys is not modified.  collective.
+       */
+      ::std::vector<ID> find_aligned(::std::vector<Key> const & keys) const {
+        BL_BENCH_INIT(find_ids);
+        BL_COMM_SCOPE(find_ids);
+        ::std::vector<ID> results;
+
+        BL_BENCH_START(find_ids);
+        ::std::vector<Key> transformed(keys);
+        ::bliss::transform::transform_in_place<InputTransform>(transformed.data(), transformed.data() + transformed.size());
+        BL_BENCH_END(find_ids, "transform", transformed.size());
+
+        if (comm.size() == 1) {
+          BL_BENCH_START(find_ids);
+          results.resize(transformed.size());
+          local_ids(transformed.data(), transformed.size(), results.data());
+          BL_BENCH_END(find_ids, "local", results.size());
+
+          BL_BENCH_REPORT_MPI_NAMED(find_ids, "key_id_index:find_aligned", comm);
+          return results;
+        }
+
+        BL_BENCH_START(find_ids);
+        ::std::vector<size_t> recv_counts;
+        ::std::vector<size_t> i2o;
+        ::std::vector<Key> buffer;
+        ::imxx::distribute(transformed, key_to_rank, recv_counts, i2o, buffer, comm, true);
+        BL_BENCH_END(find_ids, "distribute", buffer.size());
+
+        BL_BENCH_START(find_ids);
+        ::std::vector<ID> ans(buffer.size());
+        local_ids(buffer.data(), buffer.size(), ans.data());
+        BL_BENCH_END(find_ids, "local", ans.size());
+
+        BL_BENCH_START(find_ids);
+        ::imxx::undistribute(ans, recv_counts, i2o, results, comm, true);
+        BL_BENCH_END(find_ids, "undistribute", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(find_ids, "key_id_index:find_aligned", comm);
+        return results;
+      }
+
+      /**
+       * @brief keys of the ids, keys[i] for ids[i].  ids have to be less than size().  collective.
+       */
+      ::std::vector<Key> keys_aligned(::std::vector<ID> const & ids) const {
+        BL_BENCH_INIT(find_keys);
+        BL_COMM_SCOPE(find_keys);
+        ::std::vector<Key> results;
+
+        if (comm.size() == 1) {
+          results.reserve(ids.size());
+          for (auto const & id : ids) results.emplace_back(slot_keys[id]);
+          return results;
+        }
+
+        BL_BENCH_START(find_keys);
+        ::std::vector<ID> query(ids);
+        ::std::vector<size_t> recv_counts;
+        ::std::vector<size_t> i2o;
+        ::std::vector<ID> buffer;
+        ::imxx::distribute(query, IdToRank{&firsts}, recv_counts, i2o, buffer, comm, true);
+        BL_BENCH_END(find_keys, "distribute", buffer.size());
+
+        BL_BENCH_START(find_keys);
+        ID first = firsts[comm.rank()];
+        ::std::vector<Key> ans;
+        ans.reserve(buffer.size());
+        for (auto const & id : buffer) ans.emplace_back(slot_keys[id - first]);
+        BL_BENCH_END(find_keys, "local", ans.size());
+
+        BL_BENCH_START(find_keys);
+        ::imxx::undistribute(ans, recv_counts, i2o, results, comm, true);
+        BL_BENCH_END(find_keys, "undistribute", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(find_keys, "key_id_index:keys_aligned", comm);
+        return results;
+      }
+  };
+
+  template <typename Key, typename KeyToRank, typename InputTransform, typename Hash, typename Equal, typename ID>
+  constexpr ID key_id_index<Key, KeyToRank, InputTransform, Hash, Equal, ID>::missing;
+
+
+  namespace detail
+  {
+    /// maps that place keys only after a global sort, i.e. sorted maps, have sort_globally().
+    template <typename Map>
+    struct has_sort_globally {
+        template <typename M>
+        static auto test(int) -> decltype(::std::declval<M const &>().sort_globally(), ::std::true_type());
+        template <typename>
+        static ::std::false_type test(...);
+        static constexpr bool value = decltype(test<Map>(0))::value;
+    };
+
+    template <typename Map>
+    void place_keys(Map const & map, ::std::true_type) { map.sort_globally(); }
+    template <typename Map>
+    void place_keys(Map const &, ::std::false_type) {}
+  }
+
+  /// key_id_index type for a distributed map.
+  template <typename Map, typename ID = uint64_t>
+  using key_id_index_type = key_id_index<typename Map::key_type,
+      typename ::std::decay<decltype(::std::declval<Map const &>().get_key_to_rank())>::type,
+      typename Map::input_transform_type, typename Map::key_hash_type, typename Map::key_equal_type, ID>;
+
+  /**
+   * @brief number the distinct keys of a distributed map with dense global ids.  see file comment.  collective.
+   * @details  any dsc map with keys() and get_key_to_rank().  ids follow the map's local order on each rank.
+   *           a sorted map is globally sorted first, as its queries do, so that its splitters place the keys.
+   * @tparam ID  e.g. uint32_t for edge and position payloads, when there are fewer than 2^32 - 1 keys.
+   */
+  template <typename ID = uint64_t, typename Map>
+  key_id_index_type<Map, ID> assign_ids(Map const & map) {
+    detail::place_keys(map, ::std::integral_constant<bool, detail::has_sort_globally<Map>::value>());
+    ::std::vector<typename Map::key_type> keys;
+    map.keys(keys);
+    return key_id_index_type<Map, ID>(keys, map.get_key_to_rank(), map.get_comm());
+  }
+
+} /* namespace dsc */
+
+#endif /* SRC_CONTAINERS_DISTRIBUTED_KEY_IDS_HPP_ */
@@ -30,10 +30,20 @@
 #include <iterator>
 #include <vector>
 #include <unordered_set>
+#include <string>
+#include <typeinfo>
+#include <memory>     // unique_ptr
+#include <numeric>
+#include <stdexcept>
+#include <utility>    // declval
 #include "containers/dsc_container_utils.hpp"
+#include "containers/dsc_map_file.hpp"
+#include "io/incremental_mxx.hpp"
 #include <mxx/collective.hpp>
+#include <mxx/reduction.hpp>
 
 #include "utils/benchmark_utils.hpp"
+#include "utils/comm_stats.hpp"
 
 
 
@@ -192,11 +202,60 @@ namespace dsc
       virtual void local_clear() = 0;
       virtual void local_reserve(size_t n) = 0;
 
+      /// insert pairs from a segment written by this rank into the local container.  they are already on the right rank.
+      virtual void local_load(std::pair<Key, T> const * first, std::pair<Key, T> const * last) = 0;
+
+      /// insert pairs from segments written with a different number of ranks.  collective, redistributes as needed.
+      virtual void load_distribute(std::vector<std::pair<Key, T> > & input) = 0;
+
+      /// batch of local entries, [first, last).
+      using batch_op_type = std::function<void(std::pair<Key, T> const *, std::pair<Key, T> const *)>;
+
+      /// call op on the local entries, in batches of at most batch_size, in container order.  see redistribute.
+      virtual void local_batches(size_t const & batch_size, batch_op_type const & op) const = 0;
+
+      /// collects entries one at a time and calls op on each full batch.  call flush() after the last entry.
+      class batch_buffer {
+          std::vector<std::pair<Key, T> > batch;
+          size_t batch_size;
+          batch_op_type const & op;
+        public:
+          batch_buffer(size_t const & _batch_size, batch_op_type const & _op) : batch_size(_batch_size), op(_op) {
+            batch.reserve(batch_size);
+          }
+          template <typename V>
+          void operator()(V const & x) {
+            batch.emplace_back(x);
+            if (batch.size() == batch_size) flush();
+          }
+          void flush() {
+            if (batch.size() > 0) op(batch.data(), batch.data() + batch.size());
+            batch.clear();
+          }
+      };
+
+      /// local_batches over a range of the local container.
+      template <typename Iter>
+      static void visit_batches(Iter first, Iter last, size_t const & batch_size, batch_op_type const & op) {
+        batch_buffer buffer(batch_size, op);
+        for (; first != last; ++first) buffer(*first);
+        buffer.flush();
+      }
+
       map_base(const mxx::comm& _comm) : comm(_comm) {}
 
     public:
+      /// transform applied to every inserted or queried key before distribution, e.g. canonicalization.
+      using input_transform_type = InputTransform;
+      /// hash and equality of transformed keys, for local tables of a map's keys, e.g. ::dsc::assign_ids.
+      using key_hash_type = StoreTransformedFarmHash;
+      using key_equal_type = StoreTransformedEqual;
+
       virtual ~map_base() {};
 
+      /// the communicator the map is distributed over.
+      const mxx::comm& get_comm() const { return comm; }
+
 
       // ================ data access functions
       virtual void to_vector(std::vector<std::pair<Key, T> > & result) const  = 0;
@@ -283,22 +342,297 @@ namespace dsc
           comm.barrier();
       }
 
+      // ============= persistence
+
+      /// header of this rank's segment file with count entries.  see dsc_map_file.hpp
+      ::dsc::map_segment_header segment_header(size_t const & count) const {
+        return ::dsc::make_map_segment_header<Key, T>(typeid(*this).name(), comm.rank(), comm.size(), count);
+      }
+
+      /**
+       * @brief write the local content of each rank to a segment file, prefix.<rank>.dsc.  collective.
+       * @details see dsc_map_file.hpp for the format.
+       */
+      void save(std::string const & prefix) const {
+        BL_BENCH_INIT(save);
+
+        BL_BENCH_START(save);
+        std::vector<std::pair<Key, T> > local;
+        this->to_vector(local);
+        BL_BENCH_END(save, "to_vector", local.size());
+
+        BL_BENCH_START(save);
+        ::dsc::map_segment_header header = this->segment_header(local.size());
+
+        bool ok = true;
+        std::string msg;
+        try {
+          ::dsc::write_map_segment(::dsc::map_segment_filename(prefix, comm.rank()), header, local.data());
+        } catch (::bliss::io::IOException const & e) {
+          ok = false;
+          msg = e.what();
+        }
+        BL_BENCH_END(save, "write", local.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(save, "map_base:save", comm);
+
+        if (!mxx::all_of(ok, comm)) {
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(ok ? "ERROR: map save failed on another rank." : msg);
+        }
+      }
+
+      /**
+       * @brief load segments written by save() into this map.  collective.
+       * @details if the segments were written by the same number of ranks, each rank maps its own segment
+       *          and inserts it locally without redistribution.  otherwise the segments are divided among the ranks,
+       *          and the entries are redistributed as in insert.
+       *          throws on all ranks if any segment is missing or was written by a different map type.
+       * @return  number of entries read by this rank.
+       */
+      size_t load(std::string const & prefix) {
+        BL_BENCH_INIT(load);
+
+        BL_BENCH_START(load);
+        ::dsc::map_segment_header expected = this->segment_header(0);
+
+        // number of segments, from the first segment.
+        int nsegs = 0;
+        if (comm.rank() == 0) {
+          ::dsc::map_segment_header h;
+          if (::dsc::read_map_segment_header(::dsc::map_segment_filename(prefix, 0), h) && h.compatible(expected))
+            nsegs = h.nranks;
+        }
+        if (comm.size() > 1) nsegs = ::mxx::allreduce(nsegs, comm);  // only rank 0 is nonzero
+        if (nsegs <= 0) {
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>("ERROR: map load: " +
+               ::dsc::map_segment_filename(prefix, 0) + " is missing or was written for a different map type.");
+        }
+        BL_BENCH_END(load, "header", nsegs);
+
+        size_t count = 0;
+        bool ok = true;
+        std::string msg;
+
+        if (nsegs == comm.size()) {
+          BL_BENCH_START(load);
+          std::unique_ptr<::dsc::mapped_map_segment<std::pair<Key, T> > > seg;
+          try {
+            seg.reset(new ::dsc::mapped_map_segment<std::pair<Key, T> >(::dsc::map_segment_filename(prefix, comm.rank()), expected));
+            if (seg->get_header().rank != comm.rank()) throw ::bliss::utils::make_exception<::bliss::io::IOException>(
+                "ERROR: map load: segment rank does not match.");
+          } catch (::bliss::io::IOException const & e) {
+            ok = false;
+            msg = e.what();
+          }
+          BL_BENCH_END(load, "map", (ok ? seg->size() : 0));
+
+          // insert only if all ranks can, so that collectives inside local_load match up.
+          if (mxx::all_of(ok, comm)) {
+            BL_BENCH_START(load);
+            this->local_load(seg->begin(), seg->end());
+            count = seg->size();
+            BL_BENCH_END(load, "local_load", count);
+          }
+
+        } else {
+          // block partition the segments.
+          BL_BENCH_START(load);
+          std::vector<std::pair<Key, T> > input;
+          try {
+            for (int s = (comm.rank() * nsegs) / comm.size(); s < ((comm.rank() + 1) * nsegs) / comm.size(); ++s) {
+              ::dsc::mapped_map_segment<std::pair<Key, T> > seg(::dsc::map_segment_filename(prefix, s), expected);
+              input.insert(input.end(), seg.begin(), seg.end());
+            }
+          } catch (::bliss::io::IOException const & e) {
+            ok = false;
+            msg = e.what();
+          }
+          count = input.size();
+          BL_BENCH_END(load, "read", count);
+
+          if (mxx::all_of(ok, comm)) {
+            BL_BENCH_START(load);
+            this->load_distribute(input);
+            BL_BENCH_END(load, "distribute", this->local_size());
+          }
+        }
+
+        BL_BENCH_REPORT_MPI_NAMED(load, "map_base:load", comm);
+
+        if (!mxx::all_of(ok, comm)) {
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(ok ? "ERROR: map load failed on another rank." : msg);
+        }
+        return count;
+      }
+
+      // ============= redistribution
+
+      /**
+       * @brief move the entries of source, a map over the old communicator, to target, a map of the same type over the
+       *        new communicator, e.g. when shrinking or growing an allocation.  collective over carrier.
+       * @details  the maps keep their communicators, so the new map is a separate object.  each rank streams its local
+       *           entries in rounds of at most batch_size:  every entry goes to its owner under target's KeyToRank, and is
+       *           inserted there locally, as in load.  rounds are synchronized, so a rank sends and receives about
+       *           batch_size entries per round, and no rank holds a copy of its whole local content.  source is cleared
+       *           at the end, so until then a rank in both communicators holds its old and new entries.
+       *
+       *           for hash distributed maps.  sorted maps are distributed by splitters computed from their content,
+       *           so they do not support this.  use save() and load() instead.
+       * @param source   map on the ranks of the old communicator, nullptr on the other ranks of carrier.
+       * @param target   map on the ranks of the new communicator, nullptr on the other ranks of carrier.
+       * @param carrier  communicator containing all ranks of both, e.g. the one both were split from.
+       */
+      template <typename Map>
+      static void redistribute(Map * source, Map * target, const mxx::comm & carrier,
+                               size_t const & batch_size = (1UL << 20)) {
+        BL_BENCH_INIT(redist);
+
+        // carrier rank of each target rank.
+        BL_BENCH_COLLECTIVE_START(redist, "ranks", carrier);
+        int target_rank = (target == nullptr) ? -1 : target->get_comm().rank();
+        std::vector<int> target_ranks = ::mxx::allgather(target_rank, carrier);
+        std::vector<int> to_carrier(carrier.size(), -1);
+        int q = 0;
+        for (int i = 0; i < carrier.size(); ++i) {
+          if (target_ranks[i] < 0) continue;
+          to_carrier[target_ranks[i]] = i;
+          ++q;
+        }
+        if ((q == 0) || ((target != nullptr) && (target->get_comm().size() != q))) {
+          throw std::invalid_argument("redistribute: target must be on all ranks of its communicator, and only those.");
+        }
+        typename std::decay<decltype(std::declval<Map const &>().get_key_to_rank())>::type key_to_rank(q);
+
+        size_t rounds = (source == nullptr) ? 0 : (source->local_size() + batch_size - 1) / batch_size;
+        rounds = ::mxx::allreduce(rounds, ::mxx::max<size_t>(), carrier);
+        BL_BENCH_END(redist, "ranks", rounds);
+
+        BL_BENCH_START(redist);
+        std::vector<size_t> send_counts(carrier.size(), 0);
+        std::vector<size_t> recv_counts(carrier.size(), 0);
+        std::vector<size_t> offsets(carrier.size(), 0);
+        std::vector<int> dest;
+        std::vector<std::pair<Key, T> > sends, received;
+        size_t done = 0;
+        size_t moved = 0;
+
+        // 1 round:  bucket by new owner, exchange, insert locally.
+        auto round = [&](std::pair<Key, T> const * first, std::pair<Key, T> const * last) {
+          size_t n = std::distance(first, last);
+          std::fill(send_counts.begin(), send_counts.end(), 0);
+          dest.resize(n);
+          for (size_t i = 0; i < n; ++i) {
+            dest[i] = to_carrier[key_to_rank(first[i].first)];
+            ++send_counts[dest[i]];
+          }
+          offsets[0] = 0;
+          for (int r = 1; r < carrier.size(); ++r) offsets[r] = offsets[r - 1] + send_counts[r - 1];
+          sends.resize(n);
+          for (size_t i = 0; i < n; ++i) sends[offsets[dest[i]]++] = first[i];
+
+          ::imxx::counts_all2all(send_counts.data(), 1, recv_counts.data(), carrier);
+          received.resize(std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0)));
+          ::imxx::wire_all2allv(sends.data(), send_counts, received.data(), recv_counts, carrier);
+          BL_COMM_RECORD("redistribute", sizeof(std::pair<Key, T>), send_counts, recv_counts);
+
+          if (target != nullptr) static_cast<map_base *>(target)->local_load(received.data(), received.data() + received.size());
+          moved += n;
+          ++done;
+        };
+        if (source != nullptr) static_cast<map_base const *>(source)->local_batches(batch_size, round);
+        for (; done < rounds; ) round(nullptr, nullptr);  // the other ranks still have entries.
+        BL_BENCH_END(redist, "rounds", moved);
+
+        BL_BENCH_START(redist);
+        if (source != nullptr) source->clear();
+        BL_BENCH_END(redist, "clear", rounds);
+
+        BL_BENCH_REPORT_MPI_NAMED(redist, "map_base:redistribute", carrier);
+      }
+
+      /// apply the input transform once per key, before distribution.  batched, e.g. SIMD canonicalization for
+      /// lex_less (see CanonicalHashMapParams), and no pass at all for identity.
       template <typename V>
       void transform_input(std::vector<V> & input) const {
-    	  std::transform(input.begin(), input.end(), input.begin(), InputTransform());
+        ::bliss::transform::transform_in_place<InputTransform>(input.data(), input.data() + input.size());
       }
 
       template <typename V>
       void transform_input(std::vector<V> const & input, std::vector<V> & output) const {
-        output.resize(input.size());
-
-        std::transform(input.begin(), input.end(), output.begin(), InputTransform());
+        output.assign(input.begin(), input.end());
+        this->transform_input(output);
       }
 
       template <typename IT, typename OT>
       void transform_input(IT _begin, IT _end, OT output) const {
         std::transform(_begin, _end, output, InputTransform());
       }
+
+      /// deduplicates queries by transformed key.  see fanout_query.
+      using query_fanout_type = ::fsc::query_fanout<Key, StoreTransformedFarmHash, StoreTransformedEqual>;
+
+      /// deduplicate keys after the input transform, and return the first occurrence of each, untransformed, so that
+      /// the query transforms it once as usual.
+      void fanout_dedup(std::vector<Key> const & keys, query_fanout_type & fan, std::vector<Key> & unique) const {
+        std::vector<Key> transformed;
+        this->transform_input(keys, transformed);
+        fan.dedup(transformed.begin(), transformed.end());
+        fan.select_unique(keys).swap(unique);
+      }
+
+      /**
+       * @brief run query on the unique keys of a batch, and return the answers in query order.  collective.
+       * @details  for batches with many duplicate keys, e.g. read mapping.  each key is sent and answered once, then
+       *           the answers are copied to every query with that key.  answer keys are transformed, as from find.
+       * @param query    find or count on a vector of keys.
+       * @param offsets  answers to keys[i] are [offsets[i], offsets[i+1]) of the output.
+       */
+      template <typename R, typename Query>
+      std::vector<std::pair<Key, R> > fanout_query(std::vector<Key> const & keys, std::vector<size_t> & offsets,
+                                                   Query const & query) const {
+        BL_BENCH_INIT(fanout);
+
+        BL_BENCH_START(fanout);
+        query_fanout_type fan;
+        std::vector<Key> unique;
+        this->fanout_dedup(keys, fan, unique);
+        BL_BENCH_END(fanout, "dedup", unique.size());
+
+        BL_BENCH_START(fanout);
+        std::vector<std::pair<Key, R> > answers = query(unique);
+        BL_BENCH_END(fanout, "query", answers.size());
+
+        BL_BENCH_START(fanout);
+        std::vector<std::pair<Key, R> > results = fan.scatter(answers, offsets);
+        BL_BENCH_END(fanout, "scatter", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(fanout, "map_base:fanout_query", this->comm);
+        return results;
+      }
+
+      /// as above, for queries that answer each key once.  one answer per query, absent if the key got none.
+      template <typename R, typename Query>
+      std::vector<std::pair<Key, R> > fanout_query(std::vector<Key> const & keys, R const & absent,
+                                                   Query const & query) const {
+        BL_BENCH_INIT(fanout);
+
+        BL_BENCH_START(fanout);
+        query_fanout_type fan;
+        std::vector<Key> unique;
+        this->fanout_dedup(keys, fan, unique);
+        BL_BENCH_END(fanout, "dedup", unique.size());
+
+        BL_BENCH_START(fanout);
+        std::vector<std::pair<Key, R> > answers = query(unique);
+        BL_BENCH_END(fanout, "query", answers.size());
+
+        BL_BENCH_START(fanout);
+        std::vector<std::pair<Key, R> > results = fan.scatter(answers, absent);
+        BL_BENCH_END(fanout, "scatter", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(fanout, "map_base:fanout_query", this->comm);
+        return results;
+      }
   };
 
 }
@@ -0,0 +1,170 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    distributed_mphf_index.hpp
+ * @ingroup containers
+ * @author  tpan
+ * @brief   frozen, compact snapshot of a distributed hash map, queried with the map's find and count.
+ * @details each rank converts its local (key, value) pairs into an fsc::mphf_map:  a minimal perfect hash function,
+ *          fingerprints and packed values, with no stored keys.  see mphf_map.hpp.  queries are distributed to the owner
+ *          with the map's distribution function, answered locally, and returned, as in densehash_map_base::find.
+ *
+ *          keys are not stored, so absent keys are reported present with probability 2^-fingerprint_bits, and results
+ *          carry the query key.  the snapshot does not see later changes to the map, which can be cleared once the
+ *          index is built.  construction, find and count are collective.
+ */
+#ifndef SRC_CONTAINERS_DISTRIBUTED_MPHF_INDEX_HPP_
+#define SRC_CONTAINERS_DISTRIBUTED_MPHF_INDEX_HPP_
+
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+#include <mxx/reduction.hpp>
+
+#include "containers/mphf_map.hpp"
+#include "utils/transform_utils.hpp"
+
+namespace dsc
+{
+
+  /**
+   * @brief collective lookup table over the local contents of a distributed map, on a minimal perfect hash.
+   * @tparam KeyToRank   distribution function of the map.  key to owner rank.
+   * @tparam InputTransform  applied to query keys, as the map's find does.
+   * @tparam Hash, Equal  storage hash and equality of the map.
+   */
+  template <typename Key, typename T, typename KeyToRank, typename InputTransform, typename Hash, typename Equal>
+  class mphf_index {
+    public:
+      using local_container_type = ::fsc::mphf_map<Key, T, Hash, Equal>;
+
+    protected:
+      KeyToRank key_to_rank;
+      ::mxx::comm comm;
+      local_container_type c;
+
+      /// transform the keys and group them by owner rank.  returns the count per rank.
+      ::std::vector<size_t> distribute(::std::vector<Key> & keys) const {
+        ::std::vector<size_t> send_counts(comm.size(), 0);
+        ::std::vector<int> owners(keys.size());
+        ::bliss::transform::transform_in_place<InputTransform>(keys.data(), keys.data() + keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+          owners[i] = key_to_rank(keys[i]);
+          ++send_counts[owners[i]];
+        }
+
+        ::std::vector<size_t> offsets(comm.size(), 0);
+        for (int r = 1; r < comm.size(); ++r) offsets[r] = offsets[r - 1] + send_counts[r - 1];
+        ::std::vector<Key> grouped(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) grouped[offsets[owners[i]]++] = keys[i];
+        keys.swap(grouped);
+
+        return send_counts;
+      }
+
+    public:
+      /// build from this rank's local entries.  collective.
+      mphf_index(::std::vector<::std::pair<Key, T> > const & entries, KeyToRank const & _key_to_rank,
+                 ::mxx::comm const & _comm, unsigned int const & fingerprint_bits = 16) :
+        key_to_rank(_key_to_rank), comm(_comm.copy()), c(entries, fingerprint_bits) {}
+
+      /// local number of keys.
+      size_t local_size() const { return c.size(); }
+
+      /// global number of keys.  collective.
+      size_t size() const {
+        return ::mxx::allreduce(c.size(), comm);
+      }
+
+      /// global bytes used.  collective.
+      size_t bytes() const {
+        return ::mxx::allreduce(c.bytes(), comm);
+      }
+
+      local_container_type const & get_local_container() const { return c; }
+
+      /**
+       * @brief find entries for the keys.  collective.
+       * @param keys  transformed and reordered.
+       * @return  (key, value) pairs for the keys found, in no particular order.
+       */
+      ::std::vector<::std::pair<Key, T> > find(::std::vector<Key> & keys) const {
+        ::std::vector<::std::pair<Key, T> > results;
+
+        if (comm.size() == 1) {
+          T v;
+          ::bliss::transform::transform_in_place<InputTransform>(keys.data(), keys.data() + keys.size());
+          for (auto & k : keys) {
+            if (c.find(k, v)) results.emplace_back(k, v);
+          }
+          return results;
+        }
+
+        ::std::vector<size_t> send_counts = distribute(keys);
+        ::std::vector<size_t> recv_counts = ::mxx::all2all(send_counts, comm);
+        ::mxx::all2allv(keys, send_counts, comm).swap(keys);
+
+        T v;
+        auto it = keys.begin();
+        for (int r = 0; r < comm.size(); ++r) {
+          size_t before = results.size();
+          for (size_t i = 0; i < recv_counts[r]; ++i, ++it) {
+            if (c.find(*it, v)) results.emplace_back(*it, v);
+          }
+          send_counts[r] = results.size() - before;
+        }
+
+        ::mxx::all2allv(results, send_counts, comm).swap(results);
+        return results;
+      }
+
+      /**
+       * @brief count the keys, 0 or 1 each.  collective.
+       * @param keys  transformed and reordered.
+       * @return  (key, count) pairs, one for each key.
+       */
+      ::std::vector<::std::pair<Key, size_t> > count(::std::vector<Key> & keys) const {
+        ::std::vector<::std::pair<Key, size_t> > results;
+        results.reserve(keys.size());
+
+        if (comm.size() == 1) {
+          ::bliss::transform::transform_in_place<InputTransform>(keys.data(), keys.data() + keys.size());
+          for (auto & k : keys) {
+            results.emplace_back(k, c.count(k));
+          }
+          return results;
+        }
+
+        ::std::vector<size_t> send_counts = distribute(keys);
+        ::mxx::all2allv(keys, send_counts, comm).swap(keys);
+
+        for (auto const & k : keys) results.emplace_back(k, c.count(k));
+
+        // one answer per query, so the return counts are the query counts reversed.
+        ::std::vector<size_t> recv_counts = ::mxx::all2all(send_counts, comm);
+        ::mxx::all2allv(results, recv_counts, comm).swap(results);
+        return results;
+      }
+  };
+
+} /* namespace dsc */
+
+#endif /* SRC_CONTAINERS_DISTRIBUTED_MPHF_INDEX_HPP_ */
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    distributed_rma_index.hpp
+ * @ingroup containers
+ * @author  tpan
+ * @brief   read-only snapshot of a distributed hash map, for one-sided (MPI RMA) lookups without collectives.
+ * @details each rank copies its local (key, value) pairs into a flat linear probing table of fixed size slots,
+ *          in memory exposed through an MPI window.  a rank looks up a key by computing the owner rank with the
+ *          map's distribution function and the slot with the storage hash, then reads blocks of slots with MPI_Get
+ *          until it finds an empty slot.  all ranks stay in a shared passive target epoch, so lookups from
+ *          different ranks are independent: read-mapping workers need not call find at the same time.
+ *
+ *          the snapshot does not see later changes to the map.  construction and destruction are collective.
+ *          all ranks must run the same binary, as slots are transferred as bytes.
+ */
+#ifndef SRC_CONTAINERS_DISTRIBUTED_RMA_INDEX_HPP_
+#define SRC_CONTAINERS_DISTRIBUTED_RMA_INDEX_HPP_
+
+#include <cstdint>
+#include <cstring>    // memset, memcpy
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+#include <mpi.h>
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+
+#include "utils/sketch_utils.hpp"   // mix64
+
+namespace dsc
+{
+
+  /**
+   * @brief one-sided lookup table over the local contents of a distributed map.
+   * @tparam KeyToRank   distribution function of the map.  key to owner rank.
+   * @tparam InputTransform  applied to query keys, as the map's find does.
+   * @tparam Hash, Equal  storage hash and equality of the map.
+   */
+  template <typename Key, typename T, typename KeyToRank, typename InputTransform, typename Hash, typename Equal>
+  class rma_index {
+    public:
+      struct slot {
+          Key key;
+          T value;
+          uint8_t full;
+      };
+      // Kmer has a user defined assignment, so it is not trivially copyable.  plain data is what matters here.
+      static_assert(::std::is_trivially_destructible<Key>::value && ::std::is_trivially_destructible<T>::value,
+                    "rma_index transfers slots as bytes");
+
+      /// slots read per MPI_Get.  a hit or an empty slot is usually in the first block at load factor 0.5.
+      static constexpr size_t block = 8;
+
+    protected:
+      KeyToRank key_to_rank;
+      InputTransform trans;
+      Hash hash;
+      Equal eq;
+
+      MPI_Comm comm;
+      int rank;
+      MPI_Win win;
+      slot * local;
+      /// power of 2 slot count of each rank's table.
+      ::std::vector<size_t> capacities;
+
+      inline size_t home(Key const & k, size_t cap) const {
+        return ::bliss::utils::sketch::mix64(hash(k)) & (cap - 1);
+      }
+
+    public:
+      /// build from this rank's local entries.  collective.
+      rma_index(::std::vector<::std::pair<Key, T> > const & entries, KeyToRank const & _key_to_rank,
+                ::mxx::comm const & _comm) :
+        key_to_rank(_key_to_rank), comm(_comm), rank(_comm.rank()), win(MPI_WIN_NULL), local(nullptr) {
+        size_t cap = 16;
+        while (cap < 2 * entries.size()) cap <<= 1;
+
+        MPI_Win_allocate(cap * sizeof(slot), sizeof(slot), MPI_INFO_NULL, comm, &local, &win);
+        ::std::memset(static_cast<void*>(local), 0, cap * sizeof(slot));
+        for (auto const & x : entries) {
+          size_t i = home(x.first, cap);
+          while (local[i].full) i = (i + 1) & (cap - 1);
+          local[i].key = x.first;
+          local[i].value = x.second;
+          local[i].full = 1;
+        }
+        capacities = ::mxx::allgather(cap, _comm);
+
+        // shared read-only epoch for the lifetime of the index.  the barrier in allgather above orders the fill.
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+      }
+
+      rma_index(rma_index const &) = delete;
+      rma_index & operator=(rma_index const &) = delete;
+
+      rma_index(rma_index && other) :
+        key_to_rank(other.key_to_rank), trans(other.trans), hash(other.hash), eq(other.eq),
+        comm(other.comm), rank(other.rank), win(other.win), local(other.local),
+        capacities(::std::move(other.capacities)) {
+        other.win = MPI_WIN_NULL;
+        other.local = nullptr;
+      }
+
+      /// collective.
+      ~rma_index() {
+        if (win != MPI_WIN_NULL) {
+          MPI_Win_unlock_all(win);
+          MPI_Win_free(&win);
+        }
+      }
+
+      /// number of slots on a rank.
+      size_t capacity(int r) const { return capacities[r]; }
+
+      /**
+       * @brief find all entries for a batch of keys.  not collective.
+       * @details  the first block of every key is requested before waiting, so remote latencies overlap.
+       *           keys whose block was full and did not match are retried with the next block.
+       * @return  matching (key, value) pairs, in no particular order.  absent keys produce nothing.
+       */
+      ::std::vector<::std::pair<Key, T> > find(::std::vector<Key> const & keys) const {
+        struct probe {
+            Key key;
+            int owner;
+            size_t pos;
+            size_t scanned;
+        };
+
+        ::std::vector<probe> pending;
+        pending.reserve(keys.size());
+        for (auto const & q : keys) {
+          Key k = trans(q);
+          int owner = key_to_rank(k);
+          pending.push_back(probe{k, owner, home(k, capacities[owner]), 0});
+        }
+
+        ::std::vector<::std::pair<Key, T> > results;
+        ::std::vector<slot> buf;
+        ::std::vector<probe> next;
+        while (!pending.empty()) {
+          buf.resize(pending.size() * block);
+
+          bool remote = false;
+          for (size_t j = 0; j < pending.size(); ++j) {
+            probe const & pr = pending[j];
+            size_t n = ::std::min(block, capacities[pr.owner] - pr.pos);
+            if (pr.owner == rank) {
+              ::std::memcpy(static_cast<void*>(&buf[j * block]), local + pr.pos, n * sizeof(slot));
+            } else {
+              MPI_Get(&buf[j * block], n * sizeof(slot), MPI_BYTE, pr.owner, pr.pos, n * sizeof(slot), MPI_BYTE, win);
+              remote = true;
+            }
+          }
+          if (remote) MPI_Win_flush_all(win);
+
+          next.clear();
+          for (size_t j = 0; j < pending.size(); ++j) {
+            probe pr = pending[j];
+            size_t cap = capacities[pr.owner];
+            size_t n = ::std::min(block, cap - pr.pos);
+            bool done = false;
+            for (size_t i = 0; i < n; ++i) {
+              slot const & s = buf[j * block + i];
+              if (!s.full) { done = true; break; }
+              if (eq(s.key, pr.key)) results.emplace_back(s.key, s.value);
+            }
+            pr.scanned += n;
+            if (!done && (pr.scanned < cap)) {
+              pr.pos = (pr.pos + n) & (cap - 1);
+              next.push_back(pr);
+            }
+          }
+          pending.swap(next);
+        }
+        return results;
+      }
+
+      /// find one key.  not collective.
+      bool find(Key const & key, T & value) const {
+        auto r = find(::std::vector<Key>(1, key));
+        if (r.empty()) return false;
+        value = r.front().second;
+        return true;
+      }
+  };
+
+} /* namespace dsc */
+
+#endif /* SRC_CONTAINERS_DISTRIBUTED_RMA_INDEX_HPP_ */
@@ -0,0 +1,181 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    distributed_set_ops.hpp
+ * @ingroup containers
+ * @author  tpan
+ * @brief   intersection, difference and union of 2 distributed hash maps.
+ * @details comparing 2 indices through find pulls all keys of one and queries the other, 2 all2allv round trips.
+ *          when both maps place every key on the same rank (same DistHash and DistTrans params), the set operations
+ *          are local to each rank.  otherwise b's keys or entries are distributed once to a's owners, and the
+ *          operation is again local.  the placement is checked at run time on a sample of b's local keys.
+ *
+ *          the maps must have the same key type and input transform (checked at compile time).  a and b can be
+ *          any dsc densehash or unordered map or multimap, except that merge needs an a with local_merge, i.e.
+ *          densehash_map, unordered_map and their reduction and counting maps.
+ */
+#ifndef SRC_CONTAINERS_DISTRIBUTED_SET_OPS_HPP_
+#define SRC_CONTAINERS_DISTRIBUTED_SET_OPS_HPP_
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <mxx/reduction.hpp>
+
+#include "containers/distributed_colocated_query.hpp"
+#include "containers/dsc_container_utils.hpp"
+#include "io/incremental_mxx.hpp"
+#include "io/scratch_pool.hpp"
+#include "utils/benchmark_utils.hpp"
+#include "utils/comm_stats.hpp"
+
+
+namespace dsc
+{
+
+  namespace detail
+  {
+    /// true if b's local keys (or entries) are all owned by this rank under a's key to rank mapping, on all ranks.
+    /// checked on a sample of each rank's local data.  collective.
+    template <typename MapA, typename T>
+    bool same_owner(MapA const & a, ::std::vector<T> const & local) {
+      auto const & comm = a.get_comm();
+      if (comm.size() == 1) return true;
+
+      auto const & key_to_rank = a.get_key_to_rank();
+      size_t step = ::std::max(static_cast<size_t>(1), local.size() / colocated_check_samples);
+      bool same = true;
+      for (size_t i = 0; same && (i < local.size()); i += step)
+        same = (key_to_rank(local[i]) == comm.rank());
+      return ::mxx::all_of(same, comm);
+    }
+
+    /// send b's local data to their owners under a's key to rank mapping.  collective.
+    template <typename MapA, typename T>
+    void to_owners(MapA const & a, ::std::vector<T> & local) {
+      auto const & comm = a.get_comm();
+      ::std::vector<size_t> recv_counts;
+      ::imxx::scratch::buffer<size_t> i2o(comm);
+      ::imxx::scratch::buffer<T> buffer(comm);
+      i2o.reserve(local.size());
+      buffer.reserve(local.size());
+      ::imxx::distribute(local, a.get_key_to_rank(), recv_counts, *i2o, *buffer, comm);
+      local.swap(*buffer);
+    }
+
+    /// a's local entries whose key is (keep == true) or is not (keep == false) in b.  collective.
+    template <typename MapA, typename MapB>
+    ::std::vector<::std::pair<typename MapA::key_type, typename MapA::mapped_type> >
+    select(MapA const & a, MapB const & b, bool keep) {
+      static_assert(same_query<MapA, MapB>::value, "set operations need the same key type and input transform.");
+      using Key = typename MapA::key_type;
+
+      BL_BENCH_INIT(select);
+      BL_COMM_SCOPE(set_select);
+      auto const & comm = a.get_comm();
+
+      ::std::vector<::std::pair<Key, typename MapA::mapped_type> > results;
+      a.to_vector(results);
+
+      BL_BENCH_START(select);
+      ::std::vector<Key> keys;
+      b.keys(keys);
+      bool local = same_owner(a, keys);
+      BL_BENCH_END(select, "check", keys.size());
+
+      auto last = results.end();
+      BL_BENCH_START(select);
+      if (local) {
+        // colocated:  look up in b's local container directly.
+        auto const & c = b.get_local_container();
+        last = ::std::partition(results.begin(), results.end(), [&c, keep](::std::pair<Key, typename MapA::mapped_type> const & x) {
+          return (c.count(x.first) > 0) == keep;
+        });
+      } else {
+        to_owners(a, keys);
+        ::std::sort(keys.begin(), keys.end());
+        keys.erase(::std::unique(keys.begin(), keys.end()), keys.end());
+        last = ::std::partition(results.begin(), results.end(), [&keys, keep](::std::pair<Key, typename MapA::mapped_type> const & x) {
+          return ::std::binary_search(keys.begin(), keys.end(), x.first) == keep;
+        });
+      }
+      results.erase(last, results.end());
+      BL_BENCH_END(select, "select", results.size());
+
+      BL_BENCH_REPORT_MPI_NAMED(select, "set_ops:select", comm);
+      return results;
+    }
+
+  } // namespace detail
+
+
+  /**
+   * @brief  entries of a whose key is also in b.  collective.
+   * @details  see file description.  the result is distributed, each rank returns entries of its local part of a.
+   */
+  template <typename MapA, typename MapB>
+  ::std::vector<::std::pair<typename MapA::key_type, typename MapA::mapped_type> >
+  intersect(MapA const & a, MapB const & b) {
+    return detail::select(a, b, true);
+  }
+
+  /**
+   * @brief  entries of a whose key is not in b.  collective.
+   * @details  see file description.  the result is distributed, each rank returns entries of its local part of a.
+   */
+  template <typename MapA, typename MapB>
+  ::std::vector<::std::pair<typename MapA::key_type, typename MapA::mapped_type> >
+  subtract(MapA const & a, MapB const & b) {
+    return detail::select(a, b, false);
+  }
+
+  /**
+   * @brief  merge b into a:  op(a value, b value) for keys in both, insert b's entries for keys only in b.  collective.
+   * @details  see file description.  for a multimap b, op is applied once per b entry.
+   * @return  number of keys inserted into a.
+   */
+  template <typename MapA, typename MapB, typename Reducer>
+  size_t merge(MapA & a, MapB const & b, Reducer const & op) {
+    static_assert(detail::same_query<MapA, MapB>::value, "set operations need the same key type and input transform.");
+
+    BL_BENCH_INIT(merge);
+    BL_COMM_SCOPE(set_merge);
+    auto const & comm = a.get_comm();
+
+    BL_BENCH_START(merge);
+    ::std::vector<::std::pair<typename MapB::key_type, typename MapB::mapped_type> > entries;
+    b.to_vector(entries);
+    bool local = detail::same_owner(a, entries);
+    BL_BENCH_END(merge, "check", entries.size());
+
+    BL_BENCH_COLLECTIVE_START(merge, "dist", comm);
+    if (!local) detail::to_owners(a, entries);
+    BL_BENCH_END(merge, "dist", entries.size());
+
+    BL_BENCH_START(merge);
+    size_t count = a.local_merge(entries, op);
+    BL_BENCH_END(merge, "local_merge", count);
+
+    BL_BENCH_REPORT_MPI_NAMED(merge, "set_ops:merge", comm);
+    return count;
+  }
+
+} // namespace dsc
+
+
+#endif /* SRC_CONTAINERS_DISTRIBUTED_SET_OPS_HPP_ */
@@ -0,0 +1,326 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    distributed_shm_index.hpp
+ * @ingroup containers
+ * @author  tpan
+ * @brief   read-only snapshot of a distributed hash map in node shared memory, so lookups within a node are plain loads.
+ * @details each rank copies its local (key, value) pairs into a flat linear probing table of fixed size slots, as in
+ *          rma_index.  the tables are placed in one MPI_Win_allocate_shared segment per node:
+ *
+ *      node    the segment holds the tables of the ranks on the node.  keys owned on the node are probed directly,
+ *              the rest are sent to their owners with all2allv.
+ *      full    the segment holds the tables of all ranks, copied between node leaders with allgatherv.  every lookup
+ *              is a load, and find and count need no communication.  memory per node is the size of the whole map,
+ *              so this is for smaller references.
+ *
+ *          the node layout comes from imxx::hier::get_topology.  the snapshot does not see later changes to the map.
+ *          construction and destruction are collective.  find and count are collective in node mode only.
+ *          all ranks must run the same binary, as slots are transferred as bytes.
+ */
+#ifndef SRC_CONTAINERS_DISTRIBUTED_SHM_INDEX_HPP_
+#define SRC_CONTAINERS_DISTRIBUTED_SHM_INDEX_HPP_
+
+#include <cstdint>
+#include <cstring>    // memset
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+#include <mpi.h>
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+
+#include "io/incremental_mxx.hpp"   // hier::get_topology
+#include "utils/sketch_utils.hpp"   // mix64
+
+namespace dsc
+{
+
+  /**
+   * @brief lookup table over the local contents of a distributed map, shared by the ranks of a node.
+   * @tparam KeyToRank   distribution function of the map.  key to owner rank.
+   * @tparam InputTransform  applied to query keys, as the map's find does.
+   * @tparam Hash, Equal  storage hash and equality of the map.
+   */
+  template <typename Key, typename T, typename KeyToRank, typename InputTransform, typename Hash, typename Equal>
+  class shm_index {
+    public:
+      struct slot {
+          Key key;
+          T value;
+          uint8_t full;
+      };
+      static_assert(::std::is_trivially_destructible<Key>::value && ::std::is_trivially_destructible<T>::value,
+                    "shm_index transfers slots as bytes");
+
+    protected:
+      KeyToRank key_to_rank;
+      InputTransform trans;
+      Hash hash;
+      Equal eq;
+
+      ::mxx::comm comm;
+      bool full;
+      MPI_Win win;
+      /// start of the node segment.
+      slot * base;
+      /// power of 2 slot count of each rank's table.
+      ::std::vector<size_t> capacities;
+      /// slot offset of each rank's table in the node segment.  only meaningful where present is set.
+      ::std::vector<size_t> offsets;
+      /// rank's table is in the node segment.
+      ::std::vector<uint8_t> present;
+
+      inline size_t home(Key const & k, size_t cap) const {
+        return ::bliss::utils::sketch::mix64(hash(k)) & (cap - 1);
+      }
+
+      /// probe the table of owner for k, and call op on each matching slot.
+      template <typename Op>
+      inline void probe(int owner, Key const & k, Op op) const {
+        slot const * table = base + offsets[owner];
+        size_t cap = capacities[owner];
+        size_t i = home(k, cap);
+        for (size_t scanned = 0; (scanned < cap) && table[i].full; ++scanned, i = (i + 1) & (cap - 1)) {
+          if (eq(table[i].key, k)) op(table[i]);
+        }
+      }
+
+      /// write this rank's table into the node segment, then make all tables visible to the node.
+      void fill(::std::vector<::std::pair<Key, T> > const & entries, MPI_Comm node) {
+        slot * table = base + offsets[comm.rank()];
+        size_t cap = capacities[comm.rank()];
+        ::std::memset(static_cast<void*>(table), 0, cap * sizeof(slot));
+        for (auto const & x : entries) {
+          size_t i = home(x.first, cap);
+          while (table[i].full) i = (i + 1) & (cap - 1);
+          table[i].key = x.first;
+          table[i].value = x.second;
+          table[i].full = 1;
+        }
+
+        // separate memory model:  sync, barrier, sync orders the stores of the node before the loads.
+        MPI_Win_sync(win);
+        MPI_Barrier(node);
+        MPI_Win_sync(win);
+      }
+
+      /// transform the keys and split off the ones whose table is not on the node, grouped by owner.
+      ::std::vector<size_t> split_remote(::std::vector<Key> & keys, ::std::vector<Key> & remote) const {
+        ::std::vector<size_t> send_counts(comm.size(), 0);
+        ::std::vector<int> owners;
+        size_t out = 0;
+        for (size_t i = 0; i < keys.size(); ++i) {
+          Key k = trans(keys[i]);
+          int owner = key_to_rank(k);
+          if (present[owner]) {
+            keys[out++] = k;
+          } else {
+            remote.emplace_back(k);
+            owners.emplace_back(owner);
+            ++send_counts[owner];
+          }
+        }
+        keys.erase(keys.begin() + out, keys.end());
+
+        ::std::vector<size_t> pos(comm.size(), 0);
+        for (int r = 1; r < comm.size(); ++r) pos[r] = pos[r - 1] + send_counts[r - 1];
+        ::std::vector<Key> grouped(remote.size());
+        for (size_t i = 0; i < remote.size(); ++i) grouped[pos[owners[i]]++] = remote[i];
+        remote.swap(grouped);
+
+        return send_counts;
+      }
+
+    public:
+      /**
+       * @brief build from this rank's local entries.  collective.
+       * @param _full  replicate all tables on every node, instead of only the node's own.
+       */
+      shm_index(::std::vector<::std::pair<Key, T> > const & entries, KeyToRank const & _key_to_rank,
+                ::mxx::comm const & _comm, bool _full = false) :
+        key_to_rank(_key_to_rank), comm(_comm.copy()), full(_full), win(MPI_WIN_NULL), base(nullptr) {
+        size_t cap = 16;
+        while (cap < 2 * entries.size()) cap <<= 1;
+        capacities = ::mxx::allgather(cap, comm);
+
+        auto const & topo = ::imxx::hier::get_topology(comm);
+        int my_node = topo.node_of[comm.rank()];
+
+        // tables ordered by node then by rank, so each node's tables are contiguous for the leader allgatherv.
+        int p = comm.size();
+        offsets.assign(p, 0);
+        present.assign(p, 0);
+        ::std::vector<size_t> node_slots(topo.num_nodes, 0);
+        size_t total = 0;
+        for (int n = 0; n < topo.num_nodes; ++n) {
+          if (!full && (n != my_node)) continue;
+          for (int r : topo.ranks_of_node[n]) {
+            offsets[r] = total;
+            present[r] = 1;
+            total += capacities[r];
+            node_slots[n] += capacities[r];
+          }
+        }
+
+        // node local rank 0 allocates the segment, the others map it.
+        int local_rank = topo.local_rank_of[comm.rank()];
+        MPI_Aint bytes = (local_rank == 0) ? total * sizeof(slot) : 0;
+        MPI_Win_allocate_shared(bytes, sizeof(slot), MPI_INFO_NULL, topo.node, &base, &win);
+        MPI_Aint seg_size;
+        int disp_unit;
+        MPI_Win_shared_query(win, 0, &seg_size, &disp_unit, &base);
+
+        // shared read-only epoch for the lifetime of the index.
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+        fill(entries, topo.node);
+
+        if (full && (topo.num_nodes > 1)) {
+          if (local_rank == 0) {
+            MPI_Datatype dt;
+            MPI_Type_contiguous(sizeof(slot), MPI_BYTE, &dt);
+            MPI_Type_commit(&dt);
+            ::std::vector<int> counts(topo.num_nodes), displs(topo.num_nodes);
+            size_t d = 0;
+            for (int n = 0; n < topo.num_nodes; ++n) {
+              counts[n] = static_cast<int>(node_slots[n]);
+              displs[n] = static_cast<int>(d);
+              d += node_slots[n];
+            }
+            MPI_Allgatherv(MPI_IN_PLACE, 0, dt, base, counts.data(), displs.data(), dt, topo.leaders);
+            MPI_Type_free(&dt);
+          }
+          MPI_Win_sync(win);
+          MPI_Barrier(topo.node);
+          MPI_Win_sync(win);
+        }
+      }
+
+      shm_index(shm_index const &) = delete;
+      shm_index & operator=(shm_index const &) = delete;
+
+      shm_index(shm_index && other) :
+        key_to_rank(other.key_to_rank), trans(other.trans), hash(other.hash), eq(other.eq),
+        comm(::std::move(other.comm)), full(other.full), win(other.win), base(other.base),
+        capacities(::std::move(other.capacities)), offsets(::std::move(other.offsets)),
+        present(::std::move(other.present)) {
+        other.win = MPI_WIN_NULL;
+        other.base = nullptr;
+      }
+
+      /// collective.
+      ~shm_index() {
+        if (win != MPI_WIN_NULL) {
+          MPI_Win_unlock_all(win);
+          MPI_Win_free(&win);
+        }
+      }
+
+      /// all tables are on every node.
+      bool is_full() const { return full; }
+
+      /// the table owning key (untransformed) is on this node, so the single key find is allowed.
+      bool is_node_local(Key const & key) const {
+        return present[key_to_rank(trans(key))];
+      }
+
+      /**
+       * @brief find all entries for a batch of keys.  collective in node mode.
+       * @param keys  transformed.  keys owned off the node are removed.
+       * @return  matching (key, value) pairs, in no particular order.  absent keys produce nothing.
+       */
+      ::std::vector<::std::pair<Key, T> > find(::std::vector<Key> & keys) const {
+        ::std::vector<::std::pair<Key, T> > results;
+        auto emit = [&results](slot const & s) { results.emplace_back(s.key, s.value); };
+
+        ::std::vector<Key> remote;
+        ::std::vector<size_t> send_counts = split_remote(keys, remote);
+        for (auto const & k : keys) probe(key_to_rank(k), k, emit);
+        if (full || (comm.size() == 1)) return results;
+
+        // off node keys, answered by their owners.
+        ::std::vector<size_t> recv_counts = ::mxx::all2all(send_counts, comm);
+        ::mxx::all2allv(remote, send_counts, comm).swap(remote);
+
+        ::std::vector<::std::pair<Key, T> > answers;
+        auto emit_answer = [&answers](slot const & s) { answers.emplace_back(s.key, s.value); };
+        auto it = remote.begin();
+        for (int r = 0; r < comm.size(); ++r) {
+          size_t before = answers.size();
+          for (size_t i = 0; i < recv_counts[r]; ++i, ++it) probe(comm.rank(), *it, emit_answer);
+          send_counts[r] = answers.size() - before;
+        }
+        ::mxx::all2allv(answers, send_counts, comm).swap(answers);
+
+        results.insert(results.end(), answers.begin(), answers.end());
+        return results;
+      }
+
+      /**
+       * @brief count entries for a batch of keys.  collective in node mode.
+       * @param keys  transformed.  keys owned off the node are removed.
+       * @return  (key, count) pairs, one for each key.
+       */
+      ::std::vector<::std::pair<Key, size_t> > count(::std::vector<Key> & keys) const {
+        ::std::vector<::std::pair<Key, size_t> > results;
+        size_t n = 0;
+        auto tally = [&n](slot const &) { ++n; };
+
+        ::std::vector<Key> remote;
+        ::std::vector<size_t> send_counts = split_remote(keys, remote);
+        results.reserve(keys.size() + remote.size());
+        for (auto const & k : keys) {
+          n = 0;
+          probe(key_to_rank(k), k, tally);
+          results.emplace_back(k, n);
+        }
+        if (full || (comm.size() == 1)) return results;
+
+        ::std::vector<size_t> recv_counts = ::mxx::all2all(send_counts, comm);
+        ::mxx::all2allv(remote, send_counts, comm).swap(remote);
+
+        ::std::vector<::std::pair<Key, size_t> > answers;
+        answers.reserve(remote.size());
+        for (auto const & k : remote) {
+          n = 0;
+          probe(comm.rank(), k, tally);
+          answers.emplace_back(k, n);
+        }
+        // one answer per query, so the return counts are the query counts reversed.
+        ::mxx::all2allv(answers, recv_counts, comm).swap(answers);
+
+        results.insert(results.end(), answers.begin(), answers.end());
+        return results;
+      }
+
+      /// find one key whose table is on the node, see is_node_local.  not collective.
+      bool find(Key const & key, T & value) const {
+        Key k = trans(key);
+        bool found = false;
+        probe(key_to_rank(k), k, [&found, &value](slot const & s) {
+          if (!found) value = s.value;
+          found = true;
+        });
+        return found;
+      }
+  };
+
+} /* namespace dsc */
+
+#endif /* SRC_CONTAINERS_DISTRIBUTED_SHM_INDEX_HPP_ */
@@ -52,6 +52,7 @@
 #include <iterator>  // advance, distance
 #include <random>
 #include <cstdint>  // for uint8, etc.
+#include <numeric>  // accumulate
 
 
 #include <mxx/collective.hpp>
@@ -59,12 +60,15 @@
 #include <mxx/sort.hpp>
 
 #include "utils/benchmark_utils.hpp"  // for timing.
+#include "utils/comm_stats.hpp"     // for communication volume.
 #include "utils/logging.h"
 #include "utils/filter_utils.hpp"
 
 #include "containers/distributed_map_base.hpp"
 #include "common/kmer_transform.hpp"
 #include "containers/dsc_container_utils.hpp"
+#include "containers/fsc_radix_sort.hpp"
+#include "containers/fsc_search_index.hpp"
 #include "io/incremental_mxx.hpp"
 
 
@@ -167,16 +171,31 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
       // uses sorted lookup table to map to target ranks.  assume we store in a vector a pair:  <first kmer on proc, proc id>.  then we can use lower_bound to search.
       // note that this makes in-between values go with the larger proc id.
+      //
+      // after the splitters change, finalize() builds a radix table over the top bits of the transformed keys
+      // (see ::fsc::splitter_table), so a lookup is 1 table load and usually 0 to 2 compares.  without a radix
+      // prefix for Key, or with a comparator other than std::less, the search is a branchless binary search.
       struct KeyToRank {
           ::std::vector<::std::pair<Key, int> > map;  // the splitters need to support [map[i], map[i+1]), so they need to be constructed from the first element of the next range, and map to curr range = next-1.
           int p;
           typename Base::DistTransformedFunc comp;
+          ::fsc::splitter_table<Key> table;
           KeyToRank(int _comm_size) : p(_comm_size) {};
 
+          /// true if the splitter table applies.
+          static constexpr bool use_table = ::fsc::radix_prefix<Key>::value &&
+              ::std::is_same<typename ::std::decay<decltype(::std::declval<typename Base::DistTransformedFunc>().comp)>::type,
+                             ::std::less<Key> >::value;
+
+          /// rebuild the splitter table.  call after map changes.
+          void finalize() {
+            build_table(::std::integral_constant<bool, use_table>());
+          }
+
           /// return id of selected element based on lookup table.  ranges are [map[i], map[i+1])
           inline int operator()(Key const & x) const {
-            auto pos = ::std::upper_bound(map.begin(), map.end(), x, comp);  // if equal, goes to next range.
-            return (pos == map.end()) ? (p-1) : pos->second;
+            size_t pos = upper_bound(x, ::std::integral_constant<bool, use_table>());  // if equal, goes to next range.
+            return (pos == map.size()) ? (p-1) : map[pos].second;
           }
           template<typename V>
           inline int operator()(::std::pair<Key, V> const & x) const {
@@ -186,8 +205,52 @@ using SortedMapParams = ::dsc::DistributedMapParams<
           inline int operator()(::std::pair<const Key, V> const & x) const {
             return this->operator()(x.first);
           }
+
+        protected:
+          void build_table(::std::true_type) {
+            table.build(map.begin(), map.end(), [](::std::pair<Key, int> const & x) -> Key const & { return x.first; }, comp.trans);
+          }
+          void build_table(::std::false_type) {}
+
+          /// upper bound of x in map, among the splitters with x's prefix.
+          inline size_t upper_bound(Key const & x, ::std::true_type) const {
+            if (table.empty()) return upper_bound(x, ::std::false_type());
+            auto r = table.range(comp.trans(x));
+            size_t pos = r.first;
+            if ((r.second - r.first) <= 4) {
+              for (size_t i = r.first; i < r.second; ++i) pos += !comp(x, map[i].first);
+              return pos;
+            }
+            // many splitters share the prefix, e.g. skewed keys.
+            return ::std::upper_bound(map.begin() + r.first, map.begin() + r.second, x, comp) - map.begin();
+          }
+          /// branchless binary search:  the compare selects the next base, so there is no branch to mispredict.
+          inline size_t upper_bound(Key const & x, ::std::false_type) const {
+            size_t n = map.size();
+            if (n == 0) return 0;
+            size_t base = 0;
+            while (n > 1) {
+              size_t half = n >> 1;
+              base = comp(x, map[base + half].first) ? base : base + half;
+              n -= half;
+            }
+            return base + !comp(x, map[base].first);
+          }
       } key_to_rank;
 
+      /// optional search tree over the local container, see set_search_index().
+      using search_index_type = ::fsc::eytzinger_index<Key>;
+      /// optional copy of the keys of the local container, see set_key_column().
+      using key_column_type = ::fsc::key_column<Key>;
+
+      /// the search structures over the local container that the queries use.  null if not enabled.
+      struct local_search {
+          search_index_type const * index;
+          key_column_type const * keys;
+          local_search(search_index_type const * _index = nullptr, key_column_type const * _keys = nullptr) :
+            index(_index), keys(_keys) {}
+      };
+
       /**
        * @brief count elements with the specified keys in the distributed sorted_multimap.
        * @note  input cannot have duplicate elements.
@@ -199,6 +262,21 @@ using SortedMapParams = ::dsc::DistributedMapParams<
       template <bool skip_duplicate_query = false>
       struct QueryProcessor {
 
+          /// merge join when the range has at most this many entries per query, else galloping search.
+          static constexpr size_t merge_join_ratio = 8;
+          /// search index, if given, when the range has more than this many entries per query.  below, galloping
+          /// from the previous match touches fewer lines than a descent from the root.
+          static constexpr size_t search_index_ratio = 512;
+
+          /// move el_end up to the block of the local container that holds the lower bound of v.
+          template <class DBIter, typename Query>
+          static void seek(search_index_type const & index, DBIter & el_end, DBIter const & range_end, Query const & v) {
+            if (el_end == range_end) return;
+            size_t cur = static_cast<::std::pair<Key, T> const *>(&(*el_end)) -
+                static_cast<::std::pair<Key, T> const *>(index.data());
+            size_t b = index.block_begin(v, typename Base::StoreTransformedFunc());
+            if (b > cur) ::std::advance(el_end, ::std::min(b - cur, static_cast<size_t>(::std::distance(el_end, range_end))));
+          }
 
           // get the overlapping range in container.  container must be sorted.
           template<typename QueryIter, typename DBIter>
@@ -224,12 +302,64 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             return ::std::make_pair(range_begin, range_end);
           }
 
+          template <class DBIter, typename Query, class OutputIter, class Operator>
+          static size_t apply(Operator & op, DBIter & range_begin, DBIter & el_end, DBIter const & range_end,
+                              Query const & v, OutputIter & output, ::bliss::filter::TruePredicate const &) {
+            return op.template operator()<true>(range_begin, el_end, range_end, v, output);
+          }
+          template <class DBIter, typename Query, class OutputIter, class Operator, class Predicate>
+          static size_t apply(Operator & op, DBIter & range_begin, DBIter & el_end, DBIter const & range_end,
+                              Query const & v, OutputIter & output, Predicate const & pred) {
+            return op.template operator()<true>(range_begin, el_end, range_end, v, output, pred);
+          }
+
+          /// process with the searches over the key column.  op gets only the entries equal to each query, none for a
+          /// miss, so the entries, and their values, are read for the matches only.
+          template <bool linear, class DBIter, class QueryIter, class OutputIter, class Operator, class Predicate>
+          static size_t process_keys(DBIter range_begin, DBIter range_end,
+                                     QueryIter query_begin, QueryIter query_end,
+                                     OutputIter &output, Operator & op, Predicate const &pred,
+                                     key_column_type const & column, search_index_type const * index) {
+            typename Base::StoreTransformedFunc comp;
+
+            // positions in the local container, which the key column and the index are built over.
+            Key const * keys = column.begin();
+            size_t offset = static_cast<::std::pair<Key, T> const *>(&(*range_begin)) -
+                static_cast<::std::pair<Key, T> const *>(column.data());
+            Key const * k = keys + offset;
+            Key const * kend = k + ::std::distance(range_begin, range_end);
+
+            size_t count = 0;
+            DBIter first, el_end, hit_end;
+            typename ::std::iterator_traits<QueryIter>::value_type v;
+            for (auto it = query_begin; it != query_end;) {
+              v = *it;
+              if (index != nullptr) k = ::std::min(kend, ::std::max(k, keys + index->block_begin(v, comp)));
+
+              Key const * lo = ::fsc::lower_bound<linear>(k, kend, v, comp);
+              k = ::fsc::upper_bound<true>(lo, kend, v, comp);
+
+              first = range_begin;
+              ::std::advance(first, lo - keys - offset);
+              el_end = first;
+              hit_end = first;
+              ::std::advance(hit_end, k - lo);
+              count += apply(op, first, el_end, hit_end, v, output, pred);
+
+              if (skip_duplicate_query) it = ::fsc::upper_bound<true>(it, query_end, v, typename Base::StoreTransformedFunc());
+              else ++it;
+            }
+            return count;
+          }
+
           // assumes that container is sorted. and exact overlap region is provided.  do not filter output here since it's an output iterator.
+          // search structures, if given, must be built over the local container that holds the range, and op must only read.
           template <class DBIter, class QueryIter, class OutputIter, class Operator, class Predicate = ::bliss::filter::TruePredicate>
           static size_t process(DBIter range_begin, DBIter range_end,
                                 QueryIter query_begin, QueryIter query_end,
                                 OutputIter &output, Operator & op,
-                                bool sorted_query = false, Predicate const &pred = Predicate()) {
+                                bool sorted_query = false, Predicate const &pred = Predicate(),
+                                local_search const & search = local_search()) {
 
               // no matches in container.
               if (range_begin == range_end) return 0;
@@ -237,8 +367,6 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
               //auto output_start = output;
 
-//              auto dist_range = ::std::distance(range_begin, range_end);
-//              auto dist_query = ::std::distance(query_begin, query_end);
 
               //if (!sorted_target) Base::sort_ascending(range_begin, range_end);  range_begin and range_end often are const iterators.
               if (!sorted_query)
@@ -246,11 +374,23 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
               auto el_end = range_begin;
               size_t count = 0;
-              // CHECK DISABLED FOR NOW - dist_range for count index may not be big enough, causing linear to be used?
-              bool linear = false; // (static_cast<double>(dist_query) * ::std::log2(dist_range)) > dist_range;
+              // sorted queries walk the range front to back.  when they are dense in it, a merge join (linear scan) is
+              // cheapest.  for sparse queries the search index, if any, gives the block of each query, which is then
+              // scanned.  otherwise each search gallops from the previous match, in O(log gap).
+              size_t dist_range = ::std::distance(range_begin, range_end);
+              size_t dist_query = ::std::distance(query_begin, query_end);
+              bool linear = (dist_range <= merge_join_ratio * dist_query);
+              search_index_type const * index = (dist_range <= search_index_ratio * dist_query) ? nullptr : search.index;
               typename ::std::iterator_traits<QueryIter>::value_type v;
 
-              if (linear) {  // based on number of input and search source, choose a method to search.
+              if (search.keys != nullptr) {
+                // same choices, over the keys only.
+                if (linear) count = process_keys<true>(range_begin, range_end, query_begin, query_end, output, op, pred,
+                                                       *(search.keys), nullptr);
+                else count = process_keys<false>(range_begin, range_end, query_begin, query_end, output, op, pred,
+                                                 *(search.keys), index);
+
+              } else if (linear) {  // based on number of input and search source, choose a method to search.
 
                 // iterate through the input and search in output -
                 if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
@@ -274,6 +414,28 @@ using SortedMapParams = ::dsc::DistributedMapParams<
                   }
 
 
+              } else if (index != nullptr) {
+                // search tree, then scan a block.
+
+                if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+                  for (auto it = query_begin; it != query_end;) {
+                    v = *it;
+                    seek(*index, el_end, range_end, v);
+                    count += op.template operator()<true>(range_begin, el_end, range_end, v, output, pred);
+
+                    if (skip_duplicate_query) it = ::fsc::upper_bound<true>(it, query_end, v, typename Base::StoreTransformedFunc());
+                    else ++it;
+                  }
+                else
+                  for (auto it = query_begin; it != query_end;) {
+                    v = *it;
+                    seek(*index, el_end, range_end, v);
+                    count += op.template operator()<true>(range_begin, el_end, range_end, v, output);
+
+                    if (skip_duplicate_query) it = ::fsc::upper_bound<true>(it, query_end, v, typename Base::StoreTransformedFunc());
+                    else ++it;
+                  }
+
               } else {
                 // use logarithmic search
 
@@ -343,14 +505,49 @@ using SortedMapParams = ::dsc::DistributedMapParams<
        */
       bool sorted;   // this is a local variable.
 
+      /**
+       * @brief  with !sorted, sizes of the consecutive sorted runs that make up c, oldest first.  empty if unknown.
+       * @note   only incremental inserts record runs.  local_sort() merges them instead of sorting.
+       */
+      ::std::vector<size_t> runs;
+
+      /// incremental updates, see set_incremental().  should be set to the same value on all ranks.
+      bool incremental;
+      /// incremental mode rebalances when the largest rank exceeds the average size by this fraction.
+      double max_imbalance;
+
+      /// search tree over c for point queries, see set_search_index().  marked stale whenever c may have changed.
+      bool use_search_index;
+      mutable search_index_type search_index;
+      mutable bool search_index_stale;
+      /// keys of c, see set_key_column().  stale with the search tree.
+      bool use_key_column;
+      mutable key_column_type key_column;
+
 
       // =========== accessors to change the local state of the container
       void set_balanced(bool v) const {
         balanced = v;
+        search_index_stale = true;
       }
       // =========== accessors to change the local state of the container
       void set_globally_sorted(bool v) const {
         globally_sorted = v;
+        search_index_stale = true;
+      }
+
+      /// the search tree and key column over the sorted local container, rebuilt if stale.  null if not enabled.
+      local_search get_search_index() const {
+        if (!use_search_index && !use_key_column) return local_search();
+        if (search_index_stale ||
+            (use_search_index && !search_index.matches(c.data(), c.size())) ||
+            (use_key_column && !key_column.matches(c.data(), c.size()))) {
+          auto get_key = [](::std::pair<Key, T> const & x) { return x.first; };
+          if (use_search_index) search_index.build(c.begin(), c.end(), get_key);
+          if (use_key_column) key_column.build(c.begin(), c.end(), get_key);
+          search_index_stale = false;
+        }
+        return local_search(use_search_index ? &search_index : nullptr, use_key_column ? &key_column : nullptr);
       }
 
       // =========== collective operations to get distribution state of the container
@@ -496,6 +693,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
       ::std::vector<::std::pair<Key, T> > find_overlap(LocalFind & lf, ::std::vector<Key>& keys, bool sorted_input = false,
           Predicate const& pred = Predicate() ) const {
           BL_BENCH_INIT(find);
+          BL_COMM_SCOPE(find_overlap);
           ::std::vector<::std::pair<Key, T> > results;
 
           if (this->empty() || ::dsc::empty(keys, this->comm)) {
@@ -510,7 +708,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
           BL_BENCH_END(find, "begin", keys.size());
 
           BL_BENCH_START(find);
-          ::fsc::sorted_unique(keys, sorted_input,
+          ::fsc::fast_sorted_unique(keys, sorted_input,
         		  typename Base::StoreTransformedFunc(),
 				  typename Base::StoreTransformedEqual());
           BL_BENCH_END(find, "unique", keys.size());
@@ -520,16 +718,20 @@ using SortedMapParams = ::dsc::DistributedMapParams<
               // ensure that the container splitters are setup properly, and load balanced.
               BL_BENCH_COLLECTIVE_START(find, "global_sort", this->comm);
               this->redistribute();
+              auto index = this->get_search_index();  // rebuilt only if the local container changed.
               BL_BENCH_END(find, "global_sort", this->local_size());
 
               BL_BENCH_COLLECTIVE_START(find, "dist_query", this->comm);
             // distribute (communication part)
             std::vector<size_t> recv_counts;
             {
-				std::vector<size_t> i2o;
-				std::vector<Key > buffer;
-				::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-				keys.swap(buffer);
+				// scratch buffers from the communicator's pool, reused across queries.
+				::imxx::scratch::buffer<size_t> i2o(this->comm);
+				::imxx::scratch::buffer<Key> buffer(this->comm);
+				i2o.reserve(keys.size());
+				buffer.reserve(keys.size());
+				::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+				keys.swap(*buffer);
 //      		  ::dsc::distribute_sorted_unique(keys, this->key_to_rank, sorted_input, this->comm,
 //      				  typename Base::StoreTransformedFunc(),
 //      				  typename Base::StoreTransformedEqual()).swap(recv_counts);
@@ -557,7 +759,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
               auto overlap = QueryProcessor<false>::intersect(this->c.begin(), this->c.end(), start, end,
             		  sorted_input);
               QueryProcessor<false>::process(overlap.first, overlap.second, start, end,
-            		  count_emplace_iter, count_element, sorted_input, pred);
+            		  count_emplace_iter, count_element, sorted_input, pred, index);
               send_counts[i] = ::std::accumulate(count_results.begin(), count_results.end(), static_cast<size_t>(0),
                                                  [](size_t v, ::std::pair<Key, size_t> const & x) {
                              return v + x.second;
@@ -625,7 +827,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
               auto overlap = QueryProcessor<false>::intersect(this->c.begin(), this->c.end(),
             		  start, end, sorted_input);
               found = QueryProcessor<false>::process(overlap.first, overlap.second,
-            		  start, end, local_results_iter, lf, sorted_input, pred);
+            		  start, end, local_results_iter, lf, sorted_input, pred, index);
               total += found;
               //== now send the results immediately - minimizing data usage so we need to wait for both send and recv to complete right now.
 
@@ -642,6 +844,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
             // wait for all the receives
             MPI_Waitall(this->comm.size(), &(recv_reqs[0]), MPI_STATUSES_IGNORE);
+            BL_COMM_RECORD("respond", sizeof(results[0]), send_counts, resp_counts);
 
             BL_BENCH_END(find, "find_send", results.size());
 
@@ -649,6 +852,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
               // ensure that the container splitters are setup properly, and load balanced.
               BL_BENCH_COLLECTIVE_START(find, "local_sort", this->comm);
               this->local_sort();  // ensure data is locally sorted
+              auto index = this->get_search_index();  // rebuilt only if the local container changed.
               BL_BENCH_END(find, "local_sort", this->local_size());
 
 //              // keep unique keys
@@ -672,7 +876,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             auto overlap = QueryProcessor<false>::intersect(this->c.begin(), this->c.end(),
             		keys.begin(), keys.end(), sorted_input);
             QueryProcessor<false>::process(overlap.first, overlap.second,
-            		keys.begin(), keys.end(), count_emplace_iter, count_element, sorted_input, pred);
+            		keys.begin(), keys.end(), count_emplace_iter, count_element, sorted_input, pred, index);
             size_t count = ::std::accumulate(count_results.begin(), count_results.end(), static_cast<size_t>(0),
                                           [](size_t v, ::std::pair<Key, size_t> const & x) {
                       return v + x.second;
@@ -687,7 +891,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             BL_BENCH_START(find);
             // within start-end, values are unique, so don't need to set unique to true.
             QueryProcessor<false>::process(overlap.first, overlap.second,
-            		keys.begin(), keys.end(), emplace_iter, lf, sorted_input, pred);
+            		keys.begin(), keys.end(), emplace_iter, lf, sorted_input, pred, index);
             BL_BENCH_END(find, "local_find", results.size());
 
           }
@@ -709,6 +913,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
     		  Predicate const& pred = Predicate() ) const {
 
           BL_BENCH_INIT(find);
+          BL_COMM_SCOPE(find);
           ::std::vector<::std::pair<Key, T> > results;
 
           if (this->empty() || ::dsc::empty(keys, this->comm)) {
@@ -724,7 +929,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
           BL_BENCH_END(find, "begin", keys.size());
 
           BL_BENCH_START(find);
-          ::fsc::sorted_unique(keys, sorted_input,
+          ::fsc::fast_sorted_unique(keys, sorted_input,
         		  typename Base::StoreTransformedFunc(),
 				  typename Base::StoreTransformedEqual());
           BL_BENCH_END(find, "unique", keys.size());
@@ -734,16 +939,20 @@ using SortedMapParams = ::dsc::DistributedMapParams<
               // ensure that the container splitters are setup properly, and load balanced.
               BL_BENCH_COLLECTIVE_START(find, "global_sort", this->comm);
               this->redistribute();
+              auto index = this->get_search_index();  // rebuilt only if the local container changed.
               BL_BENCH_END(find, "global_sort", this->local_size());
 
               BL_BENCH_COLLECTIVE_START(find, "dist_query", this->comm);
             // distribute (communication part)
             std::vector<size_t> recv_counts;
             {
-				std::vector<size_t> i2o;
-				std::vector<Key > buffer;
-				::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-				keys.swap(buffer);
+				// scratch buffers from the communicator's pool, reused across queries.
+				::imxx::scratch::buffer<size_t> i2o(this->comm);
+				::imxx::scratch::buffer<Key> buffer(this->comm);
+				i2o.reserve(keys.size());
+				buffer.reserve(keys.size());
+				::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+				keys.swap(*buffer);
 //      		  ::dsc::distribute_sorted_unique(keys, this->key_to_rank, sorted_input, this->comm,
 //      				  typename Base::StoreTransformedFunc(),
 //      				  typename Base::StoreTransformedEqual()).swap(recv_counts);
@@ -787,7 +996,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
               // within start-end, values are unique, so don't need to set unique to true.
               send_counts[i] = QueryProcessor<false>::process(overlap.first, overlap.second,
-            		  start, end, emplace_iter, lf, sorted_input, pred);
+            		  start, end, emplace_iter, lf, sorted_input, pred, index);
 
               start = end;
             }
@@ -797,6 +1006,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             // send back using the constructed recv count
             BL_BENCH_COLLECTIVE_START(find, "a2a2", this->comm);
             mxx::all2allv(results, send_counts, this->comm).swap(results);
+            BL_COMM_RECORD("respond", sizeof(results[0]), send_counts, results.size());
             BL_BENCH_END(find, "a2a2", results.size());
 
           } else {
@@ -804,6 +1014,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
               // ensure that the container splitters are setup properly, and load balanced.
               BL_BENCH_COLLECTIVE_START(find, "local_sort", this->comm);
               this->local_sort();
+              auto index = this->get_search_index();  // rebuilt only if the local container changed.
               BL_BENCH_END(find, "local_sort", this->local_size());
 
 //
@@ -829,7 +1040,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             		keys.begin(), keys.begin() + estimating, sorted_input);
 
             QueryProcessor<false>::process(overlap.first, overlap.second, keys.begin(), keys.begin() + estimating,
-            		emplace_iter, lf, sorted_input, pred);
+            		emplace_iter, lf, sorted_input, pred, index);
             BL_BENCH_END(find, "local_find_0.1", estimating);
 
             BL_BENCH_START(find);
@@ -842,7 +1053,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             		keys.begin() + estimating, keys.end(), sorted_input);
 
             QueryProcessor<false>::process(overlap.first, overlap.second, keys.begin() + estimating, keys.end(),
-            		emplace_iter, lf, sorted_input, pred);
+            		emplace_iter, lf, sorted_input, pred, index);
             BL_BENCH_END(find, "local_find", results.size());
 
             if (this->comm.rank() == 0) printf("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
@@ -901,7 +1112,9 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
       /// constructor
       sorted_map_base(const mxx::comm& _comm) : Base(_comm),
-          key_to_rank(_comm.size()), balanced(false), globally_sorted(false), sorted(false) {}
+          key_to_rank(_comm.size()), balanced(false), globally_sorted(false), sorted(false),
+          incremental(false), max_imbalance(0.1), use_search_index(false), search_index_stale(true),
+          use_key_column(false) {}
 
       // ===================  sorted map specific virtual functions
       /// ensures container is globally sorted/organized and balanced, and splitters are capatured.  also ensures local sortedness.
@@ -933,12 +1146,111 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         c.reserve(n);
       }
 
+      /**
+       * @brief  append input's entries to c, adopting input's storage when that avoids growing c.  input is left empty.
+       * @details  an empty c swaps input in.  when c would have to grow but input has room for both, c's entries are moved
+       *           in front of input's and input becomes c, so a grown copy of c is never allocated next to input.
+       *           c's entries come first either way, so the runs recorded by incremental inserts stay valid.
+       */
+      void local_append(local_container_type & input) {
+        size_t before = c.size();
+        size_t total = before + input.size();
+        if (before == 0) {   // container is empty, so swap it in.
+          c.swap(input);
+          input.clear();
+        } else if ((c.capacity() < total) && (input.capacity() >= total)) {
+          size_t n = input.size();
+          input.resize(total);
+          ::std::move_backward(input.begin(), input.begin() + n, input.end());
+          ::std::move(c.begin(), c.end(), input.begin());
+          c.swap(input);
+          local_container_type().swap(input);   // release the old storage.
+        } else {   // else move it in.
+          this->local_reserve(total);
+          ::std::move(input.begin(), input.end(), ::fsc::back_emplace_iterator<local_container_type>(c));
+          input.clear();
+        }
+      }
+
+      /// see map_base::local_load.  appended as in insert.  a segment loaded into an empty map keeps its sortedness.
+      virtual void local_load(std::pair<Key, T> const * first, std::pair<Key, T> const * last) {
+        bool was_empty = c.empty();
+        c.insert(c.end(), first, last);
+
+        this->sorted = was_empty && ::std::is_sorted(c.begin(), c.end(), typename Base::StoreTransformedFunc());
+        this->runs.clear();
+        this->set_balanced(false);
+        this->set_globally_sorted(false);
+      }
+
+      /// see map_base::load_distribute.  sorted maps rebalance when queried, so entries just stay where they were read.
+      virtual void load_distribute(std::vector<std::pair<Key, T> > & input) {
+        this->local_load(input.data(), input.data() + input.size());
+      }
+
+      /// see map_base::local_batches
+      virtual void local_batches(size_t const & batch_size, typename Base::batch_op_type const & op) const {
+        Base::visit_batches(c.begin(), c.end(), batch_size, op);
+      }
+
 
       // ==================== sorted vector specific functions.
 
       /// rehash the local container.  n is the local container size.  this allows different processes to individually adjust its own size.
+      /// if incremental inserts left sorted runs, merges them.
       void local_sort() {
-        ::fsc::sort(c, sorted, typename Base::StoreTransformedFunc());
+        if (!sorted) {
+          if ((runs.size() > 1) && (::std::accumulate(runs.begin(), runs.end(), static_cast<size_t>(0)) == c.size())) {
+            local_container_type buffer;
+            ::fsc::multiway_merge(c, runs, typename Base::StoreTransformedFunc(), buffer);
+          } else
+            ::fsc::fast_sort(c, typename Base::StoreTransformedFunc());
+          search_index_stale = true;
+        }
+        sorted = true;
+        runs.clear();
+      }
+
+      /**
+       * @brief  start of an incremental insert.  collective.
+       * @details  sends the batch to the ranks owning its key ranges and sorts it into a run, if the map is in incremental mode
+       *           and globally sorted.  input should already be transformed.
+       * @return  true if the batch was prepared.  false if insert should mark the map unsorted as usual.
+       */
+      bool incremental_prepare(::std::vector<::std::pair<Key, T> > & input) {
+        if (!incremental || !this->is_globally_sorted()) return false;
+
+        if (this->comm.size() > 1) {
+          // the batch is sorted next, so its order does not matter:  exchange in place instead of into a second buffer.
+          std::vector<size_t> recv_counts;
+          ::imxx::distribute_inplace(input, this->key_to_rank, recv_counts, this->comm);
+        }
+        ::fsc::fast_sort(input, typename Base::StoreTransformedFunc());
+        return true;
+      }
+
+      /**
+       * @brief  end of an incremental insert:  records the appended entries [before, c.size()) as a run.  collective.
+       * @details  the map stays globally sorted.  it is marked unbalanced if the largest rank is more than max_imbalance above
+       *           the average, so the next redistribute() moves entries between neighbors without sorting.
+       */
+      void incremental_append(size_t before) {
+        bool known = sorted || !runs.empty();
+        if (sorted) {
+          runs.clear();
+          if (before > 0) runs.emplace_back(before);
+        }
+        if (known && (c.size() > before)) runs.emplace_back(c.size() - before);
+        sorted = known && (runs.size() < 2);
+        if (!known) runs.clear();
+
+        if (this->comm.size() > 1) {
+          size_t local = c.size();
+          size_t most = ::mxx::allreduce(local, ::mxx::max<size_t>(), this->comm);
+          size_t total = ::mxx::allreduce(local, this->comm);
+          if (static_cast<double>(most) > (1.0 + max_imbalance) * static_cast<double>(total) / this->comm.size())
+            this->set_balanced(false);
+        }
       }
 
       /// const version that sorts the local container.
@@ -955,6 +1267,64 @@ using SortedMapParams = ::dsc::DistributedMapParams<
       /// returns the local storage.  please use sparingly.
       local_container_type& get_local_container() { return c; }
 
+      /// returns the key to owner rank mapping, e.g. to bucket keys by destination before insert.
+      KeyToRank const & get_key_to_rank() const { return key_to_rank; }
+
+      /// globally sort, reduce and balance now, as the first query does, so that get_key_to_rank() and keys() agree on
+      /// the owners of the current keys.  e.g. before ::dsc::assign_ids.  collective.
+      void sort_globally() const { this->redistribute(); }
+
+      /// not for sorted maps:  the splitters depend on the content.  see map_base::redistribute.
+      template <typename Map>
+      static void redistribute(Map * source, Map * target, const mxx::comm & carrier, size_t const & batch_size = 0) = delete;
+
+      /**
+       * @brief  incremental updates, e.g. adding a new sequencing run to an existing index.  collective.
+       * @details  once the map is globally sorted, i.e. after its first query or redistribute(), insert sends each batch to
+       *           the ranks owning its key ranges and appends it as a sorted run, instead of leaving the whole map for a
+       *           global sort.  the runs are merged by the next query, in O(n log k) for k runs.  when a rank grows more
+       *           than max_imbalance above the average, the next query rebalances by moving entries, still without sorting.
+       */
+      void set_incremental(bool v, double _max_imbalance = 0.1) {
+        incremental = v;
+        max_imbalance = _max_imbalance;
+      }
+      bool is_incremental() const {
+        return incremental;
+      }
+
+      /**
+       * @brief  random point queries on a large local container.
+       * @details  keeps every 16th key of the local sorted vector in an Eytzinger layout search tree (fsc::eytzinger_index),
+       *           built when the map is next queried after a change.  find and count then locate each query's block with
+       *           a branchless, prefetched descent instead of a binary search, unless the queries are dense enough for a
+       *           merge join.  costs 1/16 of the keys in memory.
+       */
+      void set_search_index(bool v) {
+        use_search_index = v;
+        if (!v) search_index.clear();
+        search_index_stale = true;
+      }
+      bool has_search_index() const {
+        return use_search_index;
+      }
+
+      /**
+       * @brief  searches over the keys only.
+       * @details  keeps the keys of the local sorted vector in a separate array (fsc::key_column), built when the map is
+       *           next queried after a change.  find and count then search that array, merge join or galloping, and read
+       *           the (key, value) entries of the matches only, so the values do not take up the cache lines of the
+       *           searches.  helps most when the values are large, e.g. positions in a multimap.  costs a copy of the keys.
+       */
+      void set_key_column(bool v) {
+        use_key_column = v;
+        if (!v) key_column.clear();
+        search_index_stale = true;
+      }
+      bool has_key_column() const {
+        return use_key_column;
+      }
+
       const_iterator cbegin() const
       {
         return c.cbegin();
@@ -991,12 +1361,168 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
         // and then find unique.
         bool temp = this->sorted;
-        ::fsc::sorted_unique(result, temp,
+        ::fsc::fast_sorted_unique(result, temp,
 				  typename Base::StoreTransformedFunc(),
 				  typename Base::StoreTransformedEqual());
 
       }
 
+      /**
+       * @brief find all entries with keys in the closed intervals [lo, hi].  collective.
+       * @details  each interval is sent only to the ranks whose splitter range overlaps it, i.e. key_to_rank(lo)
+       *           through key_to_rank(hi), and each such rank returns its contiguous run.  bounds are compared in
+       *           stored key order; the input transform is not applied, since it need not preserve order.
+       * @param ranges  intervals to query.  an interval with hi < lo is empty.
+       * @param range_counts  output.  number of results for each interval.
+       * @return  results ordered by interval, and by key within each interval.
+       */
+      ::std::vector<::std::pair<Key, T> > find_range(::std::vector<::std::pair<Key, Key> > const & ranges,
+                                                     ::std::vector<size_t> & range_counts) const {
+        BL_BENCH_INIT(find_range);
+        ::std::vector<::std::pair<Key, T> > results;
+        range_counts.assign(ranges.size(), 0);
+
+        if (this->empty()) {
+          BL_BENCH_REPORT_MPI_NAMED(find_range, "base_sorted_map:find_range", this->comm);
+          return results;
+        }
+
+        typename Base::StoreTransformedFunc store_comp;
+
+        if (this->comm.size() == 1) {
+          BL_BENCH_START(find_range);
+          this->local_sort();
+          BL_BENCH_END(find_range, "local_sort", this->local_size());
+
+          BL_BENCH_START(find_range);
+          for (size_t i = 0; i < ranges.size(); ++i) {
+            if (store_comp(ranges[i].second, ranges[i].first)) continue;
+            auto first = ::std::lower_bound(this->c.begin(), this->c.end(), ranges[i].first, store_comp);
+            auto last = ::std::upper_bound(first, this->c.end(), ranges[i].second, store_comp);
+            results.insert(results.end(), first, last);
+            range_counts[i] = ::std::distance(first, last);
+          }
+          BL_BENCH_END(find_range, "local_find", results.size());
+
+          BL_BENCH_REPORT_MPI_NAMED(find_range, "base_sorted_map:find_range", this->comm);
+          return results;
+        }
+
+        BL_BENCH_COLLECTIVE_START(find_range, "global_sort", this->comm);
+        this->redistribute();
+        BL_BENCH_END(find_range, "global_sort", this->local_size());
+
+        // requests, grouped by target rank.  an interval goes to each rank in [key_to_rank(lo), key_to_rank(hi)].
+        BL_BENCH_START(find_range);
+        int p = this->comm.size();
+        ::std::vector<size_t> send_counts(p, 0);
+        for (auto const & r : ranges) {
+          if (store_comp(r.second, r.first)) continue;
+          for (int j = this->key_to_rank(r.first), e = this->key_to_rank(r.second); j <= e; ++j) ++send_counts[j];
+        }
+        ::std::vector<size_t> offsets(p, 0);
+        for (int j = 1; j < p; ++j) offsets[j] = offsets[j - 1] + send_counts[j - 1];
+        ::std::vector<::std::pair<Key, Key> > requests(offsets[p - 1] + send_counts[p - 1]);
+        for (auto const & r : ranges) {
+          if (store_comp(r.second, r.first)) continue;
+          for (int j = this->key_to_rank(r.first), e = this->key_to_rank(r.second); j <= e; ++j) requests[offsets[j]++] = r;
+        }
+        BL_BENCH_END(find_range, "bucket", requests.size());
+
+        BL_BENCH_COLLECTIVE_START(find_range, "a2a1", this->comm);
+        ::std::vector<size_t> recv_counts = mxx::all2all(send_counts, this->comm);
+        requests = mxx::all2allv(requests, send_counts, recv_counts, this->comm);
+        BL_BENCH_END(find_range, "a2a1", requests.size());
+
+        // local runs, in request order.
+        BL_BENCH_START(find_range);
+        ::std::vector<size_t> counts(requests.size(), 0);
+        ::std::vector<size_t> resp_counts(p, 0);
+        {
+          size_t k = 0;
+          for (int j = 0; j < p; ++j) {
+            for (size_t l = 0; l < recv_counts[j]; ++l, ++k) {
+              auto first = ::std::lower_bound(this->c.begin(), this->c.end(), requests[k].first, store_comp);
+              auto last = ::std::upper_bound(first, this->c.end(), requests[k].second, store_comp);
+              results.insert(results.end(), first, last);
+              counts[k] = ::std::distance(first, last);
+              resp_counts[j] += counts[k];
+            }
+          }
+        }
+        BL_BENCH_END(find_range, "local_find", results.size());
+
+        BL_BENCH_COLLECTIVE_START(find_range, "a2a2", this->comm);
+        counts = mxx::all2allv(counts, recv_counts, send_counts, this->comm);
+        results = mxx::all2allv(results, resp_counts, this->comm);
+        BL_BENCH_END(find_range, "a2a2", results.size());
+
+        // reassemble by interval.  runs from one rank arrive in request order, and ranks are in key order.
+        BL_BENCH_START(find_range);
+        {
+          // request and result offsets of each target rank.
+          ::std::vector<size_t> req_pos(p, 0), res_pos(p, 0);
+          for (int j = 1; j < p; ++j) {
+            req_pos[j] = req_pos[j - 1] + send_counts[j - 1];
+            res_pos[j] = res_pos[j - 1] + ::std::accumulate(counts.begin() + req_pos[j - 1], counts.begin() + req_pos[j],
+                                                            static_cast<size_t>(0));
+          }
+
+          ::std::vector<::std::pair<Key, T> > ordered;
+          ordered.reserve(results.size());
+          for (size_t i = 0; i < ranges.size(); ++i) {
+            if (store_comp(ranges[i].second, ranges[i].first)) continue;
+            for (int j = this->key_to_rank(ranges[i].first), e = this->key_to_rank(ranges[i].second); j <= e; ++j) {
+              size_t n = counts[req_pos[j]++];
+              ordered.insert(ordered.end(), results.begin() + res_pos[j], results.begin() + res_pos[j] + n);
+              res_pos[j] += n;
+              range_counts[i] += n;
+            }
+          }
+          results.swap(ordered);
+        }
+        BL_BENCH_END(find_range, "reorder", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(find_range, "base_sorted_map:find_range", this->comm);
+        return results;
+      }
+
+      /// find all entries with keys in [lo, hi].  collective.
+      ::std::vector<::std::pair<Key, T> > find_range(Key const & lo, Key const & hi) const {
+        ::std::vector<size_t> range_counts;
+        return find_range(::std::vector<::std::pair<Key, Key> >(1, ::std::make_pair(lo, hi)), range_counts);
+      }
+
+      /**
+       * @brief find all entries whose k-mer starts with the first len characters of a prefix k-mer.  collective.
+       * @details  the first character of a k-mer is in the most significant position, so a prefix is the closed
+       *           interval from the prefix with the remaining characters cleared to that with them all set.
+       *           requires Key to be a bliss::common::Kmer, and the stored key order to be the k-mer order.
+       * @param range_counts  output.  number of results for each prefix.
+       */
+      ::std::vector<::std::pair<Key, T> > find_prefix(::std::vector<Key> const & prefixes, unsigned int len,
+                                                      ::std::vector<size_t> & range_counts) const {
+        ::std::vector<::std::pair<Key, Key> > ranges;
+        ranges.reserve(prefixes.size());
+        unsigned int rest = (len < Key::size) ? (Key::size - len) : 0;
+        for (auto const & x : prefixes) {
+          Key lo(x), hi(x);
+          for (unsigned int i = 0; i < rest; ++i) {
+            lo.setCharsAtPos(static_cast<typename Key::KmerWordType>(0), i, 1);
+            hi.setCharsAtPos(~static_cast<typename Key::KmerWordType>(0), i, 1);
+          }
+          ranges.emplace_back(lo, hi);
+        }
+        return find_range(ranges, range_counts);
+      }
+
+      /// find all entries whose k-mer starts with the first len characters of prefix.  collective.
+      ::std::vector<::std::pair<Key, T> > find_prefix(Key const & prefix, unsigned int len) const {
+        ::std::vector<size_t> range_counts;
+        return find_prefix(::std::vector<Key>(1, prefix), len, range_counts);
+      }
+
+
 
 
       /**
@@ -1011,6 +1537,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
 
         BL_BENCH_INIT(count);
+        BL_COMM_SCOPE(count);
 
         // still process - one input, one output
         if (::dsc::empty(keys, this->comm)) {
@@ -1032,7 +1559,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
         if (remove_duplicate) {
 			BL_BENCH_START(count);
-			::fsc::sorted_unique(keys, sorted_input,
+			::fsc::fast_sorted_unique(keys, sorted_input,
 				  typename Base::StoreTransformedFunc(),
 					  typename Base::StoreTransformedEqual());
 			BL_BENCH_END(count, "unique", keys.size());
@@ -1043,16 +1570,20 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             // ensure that the container splitters are setup properly, and load balanced.
             BL_BENCH_COLLECTIVE_START(count, "global_sort", this->comm);
             this->redistribute();
+            auto index = this->get_search_index();  // rebuilt only if the local container changed.
             BL_BENCH_END(count, "global_sort", this->local_size());
 
             BL_BENCH_COLLECTIVE_START(count, "dist_query", this->comm);
           // distribute (communication part)
           std::vector<size_t> recv_counts;
           {
-				std::vector<size_t> i2o;
-				std::vector<Key > buffer;
-				::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-				keys.swap(buffer);
+				// scratch buffers from the communicator's pool, reused across queries.
+				::imxx::scratch::buffer<size_t> i2o(this->comm);
+				::imxx::scratch::buffer<Key> buffer(this->comm);
+				i2o.reserve(keys.size());
+				buffer.reserve(keys.size());
+				::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+				keys.swap(*buffer);
 //      		  ::dsc::distribute_sorted_unique(keys, this->key_to_rank, sorted_input, this->comm,
 //      				  typename Base::StoreTransformedFunc(),
 //      				  typename Base::StoreTransformedEqual()).swap(recv_counts);
@@ -1077,7 +1608,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
             // within start-end, values are unique, so don't need to set unique to true.
             QueryProcessor<false>::process(overlap.first, overlap.second,
-            		start, end, emplace_iter, count_element, sorted_input, pred);
+            		start, end, emplace_iter, count_element, sorted_input, pred, index);
 
             start = end;
           }
@@ -1086,6 +1617,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
           BL_BENCH_COLLECTIVE_START(count, "a2a2", this->comm);
           // send back using the constructed recv count
           mxx::all2allv(results, recv_counts, this->comm).swap(results);
+          BL_COMM_RECORD("respond", sizeof(results[0]), recv_counts, results.size());
           BL_BENCH_END(count, "a2a2", results.size());
 
 
@@ -1093,6 +1625,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             // ensure that the container splitters are setup properly, and load balanced.
             BL_BENCH_COLLECTIVE_START(count, "local_sort", this->comm);
             this->local_sort();
+            auto index = this->get_search_index();  // rebuilt only if the local container changed.
             BL_BENCH_END(count, "local_sort", this->local_size());
 
 //            BL_BENCH_START(count);
@@ -1114,7 +1647,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
           // within key, values may not be unique,
           QueryProcessor<true>::process(overlap.first, overlap.second,
-        		  keys.begin(), keys.end(), emplace_iter, count_element, sorted_input, pred);
+        		  keys.begin(), keys.end(), emplace_iter, count_element, sorted_input, pred, index);
           BL_BENCH_END(count, "local_count", results.size());
 
         }
@@ -1185,34 +1718,35 @@ using SortedMapParams = ::dsc::DistributedMapParams<
       template <class Predicate = ::bliss::filter::TruePredicate>
       size_t insert(::std::vector<::std::pair<Key, T> > &input, bool sorted_input = false, Predicate const &pred = Predicate()) {
           BL_BENCH_INIT(insert);
+          BL_COMM_SCOPE(insert);
 
           if (::dsc::empty(input, this->comm)) {
             BL_BENCH_REPORT_MPI_NAMED(insert, "base_sorted_map:insert", this->comm);
             return 0;
           }
 
-          this->set_balanced(false);
-          this->set_globally_sorted(false);
-
-
           BL_BENCH_START(insert);
           this->transform_input(input);
           BL_BENCH_END(insert, "transform_input", input.size());
 
+          BL_BENCH_START(insert);
+          bool incremental_run = this->incremental_prepare(input);
+          BL_BENCH_END(insert, "incremental", input.size());
+
+          if (!incremental_run) {
+            this->set_balanced(false);
+            this->set_globally_sorted(false);
+          }
+
 
           size_t before = c.size();
           BL_BENCH_START(insert);
 
-          ::fsc::back_emplace_iterator<local_container_type> emplace_iter(c);
           if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value) {
-            if (c.size() == 0)   // container is empty, so swap it in.
-              c.swap(input);
-            else {
-              this->local_reserve(before + input.size());
-                ::std::move(input.begin(), input.end(), emplace_iter);    // else move it in.
-            }
+            this->local_append(input);
           }
           else {
+            ::fsc::back_emplace_iterator<local_container_type> emplace_iter(c);
             this->local_reserve(before + input.size());
             ::std::copy_if(::std::make_move_iterator(input.begin()),
                       ::std::make_move_iterator(input.end()), emplace_iter, pred);  // predicate needed.  move it though.
@@ -1221,11 +1755,15 @@ using SortedMapParams = ::dsc::DistributedMapParams<
           size_t count = c.size() - before;
           BL_BENCH_END(insert, "insert", count);
 
+          if (incremental_run) {
+            this->incremental_append(before);
+          } else {
+            this->sorted = false;
+            this->runs.clear();
+          }
 
           BL_BENCH_REPORT_MPI_NAMED(insert, "base_sorted_map:insert", this->comm);
 
-          this->sorted = false;
-
           return count;
       }
 
@@ -1242,6 +1780,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
       size_t erase(::std::vector<Key>& keys, bool sorted_input = false, Predicate const & pred = Predicate() ) {
         // even if count is 0, still need to participate in mpi calls.  if (keys.size() == 0) return;
           BL_BENCH_INIT(erase);
+          BL_COMM_SCOPE(erase);
 
           if (this->empty() || ::dsc::empty(keys, this->comm)) {
             BL_BENCH_REPORT_MPI_NAMED(erase, "base_sorted_map:erase", this->comm);
@@ -1290,7 +1829,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
         BL_BENCH_START(erase);
         // keep unique keys
-        ::fsc::sorted_unique(keys, sorted_input,
+        ::fsc::fast_sorted_unique(keys, sorted_input,
 				  typename Base::StoreTransformedFunc(),
 				  typename Base::StoreTransformedEqual());
         BL_BENCH_END(erase, "unique_keys", keys.size());
@@ -1349,6 +1888,67 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         return before - c.size();
       }
 
+      /**
+       * @brief apply op(value, v) to every existing entry with key k, for each (k, v) in input, at the owner.  collective.
+       * @details  absent keys are skipped, and nothing is returned.  op returns the number of entries it changed.
+       *           only values change, so the container stays sorted and balanced.
+       * @param input  transformed and redistributed in place.
+       * @return  number of entries updated on this rank.
+       */
+      template <typename V, typename Updater>
+      size_t update(std::vector<::std::pair<Key, V> >& input, bool sorted_input, Updater const & op ) {
+        BL_BENCH_INIT(update);
+        BL_COMM_SCOPE(update);
+
+        if (this->empty() || ::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(update, "base_sorted_map:update", this->comm);
+          return 0;
+        }
+
+        BL_BENCH_START(update);
+        this->transform_input(input);
+        BL_BENCH_END(update, "transform_input", input.size());
+
+        if (this->comm.size() > 1) {
+          // ensure that the container splitters are setup properly, and load balanced.
+          BL_BENCH_COLLECTIVE_START(update, "global_sort", this->comm);
+          this->redistribute();
+          BL_BENCH_END(update, "global_sort", this->local_size());
+
+          BL_BENCH_COLLECTIVE_START(update, "distribute", this->comm);
+          std::vector<size_t> recv_counts;
+          std::vector<size_t> i2o;
+          std::vector<::std::pair<Key, V> > buffer;
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          input.swap(buffer);
+          BL_BENCH_END(update, "distribute", input.size());
+        } else {
+          BL_BENCH_START(update);
+          this->local_sort();
+          BL_BENCH_END(update, "local_sort", this->local_size());
+        }
+
+        BL_BENCH_START(update);
+        typename Base::StoreTransformedFunc store_comp;
+        size_t count = 0;
+        for (auto const & x : input) {
+          auto first = ::std::lower_bound(this->c.begin(), this->c.end(), x.first, store_comp);
+          auto last = ::std::upper_bound(first, this->c.end(), x.first, store_comp);
+          for (auto it = first; it != last; ++it) count += op((*it).second, x.second);
+        }
+        BL_BENCH_END(update, "update", count);
+
+        BL_BENCH_REPORT_MPI_NAMED(update, "base_sorted_map:update", this->comm);
+        return count;
+      }
+
+      /// update with values[i] for keys[i].  see update(input, sorted_input, op).  collective.
+      template <typename V, typename Updater>
+      size_t update(std::vector<Key> const & keys, std::vector<V> const & values, Updater const & op ) {
+        std::vector<::std::pair<Key, V> > input = ::dsc::zip(keys, values);
+        return this->update(input, false, op);
+      }
+
 
       // =============================  overrides.
 
@@ -1520,6 +2120,8 @@ using SortedMapParams = ::dsc::DistributedMapParams<
       // ============= local reduction override.
       virtual void local_reduction(::std::vector<::std::pair<Key, T> > &input, bool sorted_input = false) {
 
+        if (!sorted_input) ::fsc::fast_sort(input, typename Base::StoreTransformedFunc());
+        sorted_input = true;
         ::fsc::sorted_unique(input, sorted_input,
 				  typename Base::StoreTransformedFunc(),
 				  typename Base::StoreTransformedEqual());
@@ -1530,7 +2132,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
     		  bool sorted_input = false) {
 
 		if (first == last) return output;
-		if (!sorted_input) ::std::sort(first, last, typename Base::StoreTransformedFunc());
+		if (!sorted_input) ::fsc::fast_sort(first, last, typename Base::StoreTransformedFunc());
 		// then just get the unique stuff and remove rest.
 		if (first == output)
 			return ::std::unique(first, last, typename Base::StoreTransformedEqual());
@@ -1540,6 +2142,13 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
       using Base::redistribute;
 
+      /**
+       * @brief  whether redistribute() should sort and reduce locally before the global sort.
+       * @details only safe when the reduction is associative and commutative, as it changes the order in which values
+       *          are combined.  the boundary reduction after the global sort merges the at most p entries per key.
+       */
+      virtual bool reduce_before_sort() const { return false; }
+
       /**
        * @brief  redistribute data in sorted order, and keep track of splitters.
        * @details:  local reduce before a2a.
@@ -1628,6 +2237,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         // stop if there are no data to rehash on any of the nodes.
         if (this->empty()) {
           this->key_to_rank.map.clear();
+          this->key_to_rank.finalize();
           BL_BENCH_REPORT_MPI_NAMED(rehash, "sorted_map:rehash", this->comm);
 
           this->sorted = true;
@@ -1781,6 +2391,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 						std::move(splitters[i].first), i);
 			}
 
+			this->key_to_rank.finalize();
 			BL_BENCH_END(rehash, "splitters1", this->key_to_rank.map.size());
 
 			if (this->comm.rank() == 0) printf("split1\n");  fflush(stdout);
@@ -1827,6 +2438,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
               this->key_to_rank.map.emplace_back(this->c.front().first, this->comm.rank() - 1);
             }
             ::mxx::allgatherv(this->key_to_rank.map, this->comm).swap(this->key_to_rank.map);
+            this->key_to_rank.finalize();
             BL_BENCH_END(rehash, "final_splitter", this->key_to_rank.map.size());
 
         	if (this->comm.rank() == 0) printf("splitters\n"); fflush(stdout);
@@ -1880,6 +2492,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         // stop if there are no data to rehash on any of the nodes.
         if (this->empty()) {
           this->key_to_rank.map.clear();
+          this->key_to_rank.finalize();
           BL_BENCH_REPORT_MPI_NAMED(rehash, "sorted_map:rehash", this->comm);
 
           this->sorted = true;
@@ -1956,13 +2569,16 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 				  mxx::all2allv(&(this->c[0]), send_counts, &(recv_elements[0]), recv_counts, this->comm);
 				  this->c.swap(recv_elements);
 	              BL_BENCH_END(rehash, "a2a", recv_elements.size());
-              }
 
+	              // 9. local reordering - the received blocks are sorted, so merge instead of sorting again.
+	              BL_BENCH_START(rehash);
+	              ::fsc::multiway_merge(this->c, recv_counts, store_comp, recv_elements);
+	              BL_BENCH_END(rehash, "merge", this->c.size());
+              }
 
-              // 9. local reordering - merge and reduce
               BL_BENCH_START(rehash);
               // local unique
-              this->local_reduction(this->c, false);
+              this->local_reduction(this->c, true);
               BL_BENCH_END(rehash, "reduc2", this->c.size());
 
               // A. rebalance.
@@ -1983,6 +2599,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
           // note that key_to_rank.map needs to be unique.
           auto map_end = std::unique(this->key_to_rank.map.begin(), this->key_to_rank.map.end(), typename Base::Base::StoreTransformedEqual());
           this->key_to_rank.map.erase(map_end, this->key_to_rank.map.end());
+          this->key_to_rank.finalize();
 
 
           BL_BENCH_END(rehash, "splitter2", this->c.size());
@@ -2019,9 +2636,10 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         {
           // so the splitters are correct as well.
 
-          // ensure locally sorted.
+          // ensure locally sorted.  merges runs left by incremental inserts.
           BL_BENCH_START(rehash);
-          this->local_reduction(this->c, this->sorted);
+          this->local_sort();
+          this->local_reduction(this->c, true);
           BL_BENCH_END(rehash, "local_sort", this->c.size());
 
           // then return.
@@ -2036,6 +2654,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         // stop if there are no data to rehash on any of the nodes.
         if (this->empty()) {
           this->key_to_rank.map.clear();
+          this->key_to_rank.finalize();
           BL_BENCH_REPORT_MPI_NAMED(rehash, "sorted_map:rehash", this->comm);
 
           this->sorted = true;
@@ -2047,8 +2666,24 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
 
         if (this->comm.size() > 1) {
+          // collapse local duplicates first, so only unique entries enter the global sort.  rebalances after.
+          if (!gsorted && this->reduce_before_sort()) {
+            BL_BENCH_START(rehash);
+            this->local_sort();
+            this->local_reduction(this->c, true);
+            balanced = false;
+            BL_BENCH_END(rehash, "reduc0", this->c.size());
+          }
+
           // first balance
 
+          // globally sorted but unbalanced after incremental inserts:  merge the runs so the block shift keeps the order.
+          if (gsorted) {
+            BL_BENCH_START(rehash);
+            this->local_sort();
+            BL_BENCH_END(rehash, "local_sort", this->c.size());
+          }
+
           if (!balanced) {
             BL_BENCH_START(rehash);
             ::mxx::stable_distribute(this->c, this->comm).swap(this->c);
@@ -2112,7 +2747,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
               if (dist > 1) {  // if > 1, the value crossed boundary and we have extra entries to remove.
 
                 size_t offset = ::std::distance(boundary_values.begin(), range.second);
-                if (boundary_ids[offset - 1] < this->comm.rank()) {  // not an owner, so need to remove this element
+                if (boundary_ids[offset - 1] != this->comm.rank()) {  // not an owner, so need to remove this element
                   // now remove this element.  there is only 1, since it's unique.  also c is at least 1 in size before.
                   this->c.pop_back();
 
@@ -2141,6 +2776,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
           // note that key_to_rank.map needs to be unique.
           auto map_end = std::unique(this->key_to_rank.map.begin(), this->key_to_rank.map.end(), typename Base::Base::StoreTransformedEqual());
           this->key_to_rank.map.erase(map_end, this->key_to_rank.map.end());
+          this->key_to_rank.finalize();
 
 
           BL_BENCH_END(rehash, "splitter2", this->c.size());
@@ -2149,7 +2785,8 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         } else {
           BL_BENCH_START(rehash);
           // local reduction
-          this->local_reduction(this->c, this->sorted);
+          this->local_sort();
+          this->local_reduction(this->c, true);
           BL_BENCH_END(rehash, "reduc", this->c.size());
         }
 
@@ -2170,12 +2807,13 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
       virtual ~sorted_map() {};
 
-//      // specialized here so that the local_find functor can be used.
-//      template <class Predicate = ::bliss::filter::TruePredicate>
-//      ::std::vector<::std::pair<Key, T> > find_overlap(::std::vector<Key>& keys, bool sorted_input = false,
-//    		  Predicate const& pred = Predicate()) const {
-//          return Base::find_overlap(find_element, keys, sorted_input, pred);
-//      }
+      // specialized here so that the local_find functor can be used.
+      /// find with point to point exchange, overlapping the local finds with the communication.  collective.
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, T> > find_overlap(::std::vector<Key>& keys, bool sorted_input = false,
+    		  Predicate const& pred = Predicate()) const {
+          return Base::find_overlap(find_element, keys, sorted_input, pred);
+      }
       template <class Predicate = ::bliss::filter::TruePredicate>
       ::std::vector<::std::pair<Key, T> > find(::std::vector<Key>& keys, bool sorted_input = false,
                                                           Predicate const& pred = Predicate()) const {
@@ -2201,6 +2839,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
       using Base::insert;
       using Base::erase;
       using Base::count;
+      using Base::update;
 
       /// update the multiplicity.  only multimap needs to do this.
       virtual float get_multiplicity() const {
@@ -2216,64 +2855,6 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         return Base::unique_size();
       }
 
-
-      /**
-       * @brief insert new elements in the distributed densehash_multimap.
-       * @param first
-       * @param last
-       */
-      template <typename V, typename Updater>
-      size_t update(std::vector<::std::pair<Key, V> >& input, bool sorted_input, Updater const & op ) {
-        // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
-        BL_BENCH_INIT(update);
-
-        if (this->empty() || ::dsc::empty(input, this->comm)) {
-          BL_BENCH_REPORT_MPI_NAMED(update, "sortedmap:update", this->comm);
-          return 0;
-        }
-
-        BL_BENCH_START(update);
-        this->transform_input(input);
-        BL_BENCH_END(update, "transform_intput", input.size());
-
-        // communication part
-
-        if (this->comm.size() > 1) {
-//          // TODO: keep unique only is not needed - overhead is high.
-
-          // and distribute the data.
-          BL_BENCH_START(update);
-    //      ::dsc::distribute_bucketed(input, recv_counts, this->comm).swap(input);
-            std::vector<size_t> recv_counts;
-            std::vector<size_t> i2o;
-            std::vector<::std::pair<Key, V> > buffer;
-            ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-            input.swap(buffer);
-
-          BL_BENCH_END(update, "distribute", input.size());
-
-        }
-
-
-        BL_BENCH_START(update);
-        size_t count = 0;
-
-        for (auto iit = input.begin(); iit != input.end(); ++iit) {
-          auto k = iit->first;
-          auto iter = ::fsc::lower_bound<false>(this->c.begin(), this->c.end(), k, this->store_comp);
-          if (iter == this->c.end()) continue;
-
-          // update the entry
-          count += op((*iter).second, iit->second );
-        }
-
-        BL_BENCH_END(update, "update", count);
-
-        BL_BENCH_REPORT_MPI_NAMED(update, "sortedmap:update", this->comm);
-
-        return count;
-      }
-
       template <typename Filter, typename Updater>
       size_t update(Filter const & fop, Updater const & op ) {
         BL_BENCH_INIT(update);
@@ -2434,6 +3015,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         // stop if there are no data to rehash on any of the nodes.
         if (this->empty()) {
           this->key_to_rank.map.clear();
+          this->key_to_rank.finalize();
           BL_BENCH_REPORT_MPI_NAMED(rehash, "sorted_multimap:rehash", this->comm);
 
           this->sorted = true;
@@ -2447,6 +3029,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         // stop if there are no data to rehash on any of the nodes.
         if (this->empty()) {
           this->key_to_rank.map.clear();
+          this->key_to_rank.finalize();
           BL_BENCH_REPORT_MPI_NAMED(rehash, "sorted_multimap:rehash", this->comm);
           return;
         }
@@ -2454,6 +3037,13 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         if (this->comm.size() > 1) {
           // first balance
 
+          // globally sorted but unbalanced after incremental inserts:  merge the runs so the block shift keeps the order.
+          if (gsorted) {
+            BL_BENCH_START(rehash);
+            this->local_sort();
+            BL_BENCH_END(rehash, "local_sort", this->c.size());
+          }
+
           // TODO: stable_block_decompose uses all2all internally.  is it better to move the deltas ourselves?
           if (!balanced) {
             BL_BENCH_START(rehash);
@@ -2482,6 +3072,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
           auto map_end = std::unique(this->key_to_rank.map.begin(), this->key_to_rank.map.end(),
         		  typename Base::Base::StoreTransformedEqual());
           this->key_to_rank.map.erase(map_end, this->key_to_rank.map.end());
+          this->key_to_rank.finalize();
           assert(this->key_to_rank.map.size() > 0);
 
           BL_BENCH_END(rehash, "splitter1", this->key_to_rank.map.size());
@@ -2724,7 +3315,8 @@ using SortedMapParams = ::dsc::DistributedMapParams<
       virtual void local_reduction(::std::vector<::std::pair<Key, T> >& input, bool sorted_input = false) {
         if (input.size() == 0) return;
 
-        ::fsc::sort(input, sorted_input, typename Base::Base::Base::StoreTransformedFunc());
+        if (!sorted_input) ::fsc::fast_sort(input, typename Base::Base::Base::StoreTransformedFunc());
+        sorted_input = true;
 
         typename Base::Base::Base::StoreTransformedEqual store_equal;
 
@@ -2752,7 +3344,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
     		  bool sorted_input = false) {
 
 		if (first == last) return output;
-		if (!sorted_input) ::std::sort(first, last, typename Base::StoreTransformedFunc());
+		if (!sorted_input) ::fsc::fast_sort(first, last, typename Base::StoreTransformedFunc());
 
         typename Base::Base::Base::StoreTransformedEqual store_equal;
 
@@ -2772,7 +3364,9 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         }
         ++reduc_target;
 
-        return reduc_target;
+        // bucket_reduce compacts the buckets to the front:  the reduced entries go to output, as in sorted_map.
+        if (first == output) return reduc_target;
+        return ::std::move(first, reduc_target, output);
       }
 
 
@@ -2840,10 +3434,59 @@ using SortedMapParams = ::dsc::DistributedMapParams<
       using difference_type       = typename local_container_type::difference_type;
 
 
+    protected:
+      /// counts add up in any order, and at high coverage each rank sees most k-mers many times.
+      virtual bool reduce_before_sort() const { return true; }
+
+    public:
       counting_sorted_map(const mxx::comm& _comm) : Base(_comm) {}
 
       virtual ~counting_sorted_map() {};
 
+      /**
+       * @brief  k-mer count spectrum, e.g. for genome size estimation.  collective.
+       * @details  hist[i] is the number of distinct keys with count i for i < max_count, and hist[max_count] the number
+       *           with count at least max_count.  redistributes first so each key has one entry, then scans the local
+       *           vector in parallel chunks when OpenMP is enabled.  see dsc::count_histogram.
+       * @return  the histogram on root, empty on the other ranks.
+       */
+      ::std::vector<size_t> histogram(size_t max_count, int root = 0) const {
+        BL_BENCH_INIT(histogram);
+
+        BL_BENCH_COLLECTIVE_START(histogram, "redistribute", this->comm);
+        this->redistribute();
+        BL_BENCH_END(histogram, "redistribute", this->c.size());
+
+        BL_BENCH_START(histogram);
+        ::std::vector<size_t> hist = ::dsc::count_histogram(this->c, max_count, root, this->comm);
+        BL_BENCH_END(histogram, "histogram", hist.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(histogram, "count_sorted_map:histogram", this->comm);
+        return hist;
+      }
+
+      /**
+       * @brief  the k most abundant keys, e.g. adapters and contaminants.  collective.
+       * @details  redistributes first so each key has one entry, then selects the local top k, and uses
+       *           O(log max count) scalar allreduces to find the k-th count, and only the k winners are gathered.
+       *           of keys tied at the k-th count, those on lower ranks are kept.  see dsc::count_top_k.
+       * @return  on root, min(k, size()) (key, count) pairs by descending count.  empty on the other ranks.
+       */
+      ::std::vector<::std::pair<Key, T> > top_k(size_t k, int root = 0) const {
+        BL_BENCH_INIT(top_k);
+
+        BL_BENCH_COLLECTIVE_START(top_k, "redistribute", this->comm);
+        this->redistribute();
+        BL_BENCH_END(top_k, "redistribute", this->c.size());
+
+        BL_BENCH_START(top_k);
+        ::std::vector<::std::pair<Key, T> > result = ::dsc::count_top_k(this->c, k, root, this->comm);
+        BL_BENCH_END(top_k, "top_k", result.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(top_k, "count_sorted_map:top_k", this->comm);
+        return result;
+      }
+
       // explicitly get the base class version of insert.
       using Base::insert;
       using Base::erase;
@@ -2858,38 +3501,44 @@ using SortedMapParams = ::dsc::DistributedMapParams<
       template <class Predicate = ::bliss::filter::TruePredicate>
       size_t insert(::std::vector<Key> &input, bool sorted_input = false, Predicate const &pred = Predicate()) {
 
-          if (input.size() == 0) return 0;  // OKAY HERE ONLY BECAUSE NO COMMUNICATION IS HERE.
-
-          this->set_balanced(false);
-          this->set_globally_sorted(false);
+          // OKAY HERE ONLY BECAUSE NO COMMUNICATION IS HERE.  incremental inserts communicate, so every rank continues.
+          if ((input.size() == 0) && !this->is_incremental()) return 0;
 
           typename Base::Base::Base::Base::InputTransform trans;
 
         // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
         BL_BENCH_INIT(insert);
+        BL_COMM_SCOPE(insert);
 
         BL_BENCH_START(insert);
         ::std::vector<::std::pair<Key, T> > temp;
-        temp.reserve(input.size());
+        // room for the local entries too, so local_append can adopt temp instead of growing c.  incremental inserts replace temp.
+        bool adopt = !this->is_incremental() && ::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value &&
+            (this->c.capacity() < this->c.size() + input.size());
+        temp.reserve(input.size() + (adopt ? this->c.size() : 0));
         ::fsc::back_emplace_iterator<::std::vector<::std::pair<Key, T> > > temp_emplacer(temp);
         ::std::transform(input.begin(), input.end(), temp_emplacer, [&trans](Key const & x) {
         	return ::std::make_pair(trans(x), T(1));
         });
         BL_BENCH_END(insert, "convert", input.size());
 
+        BL_BENCH_START(insert);
+        bool incremental_run = this->incremental_prepare(temp);
+        BL_BENCH_END(insert, "incremental", temp.size());
+
+        if (!incremental_run) {
+          this->set_balanced(false);
+          this->set_globally_sorted(false);
+        }
+
         size_t before = this->c.size();
         BL_BENCH_START(insert);
 
-        ::fsc::back_emplace_iterator<local_container_type> emplace_iter(this->c);
         if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value) {
-          if (this->c.size() == 0)   // container is empty, so swap it in.
-            this->c.swap(temp);
-          else {
-            this->local_reserve(before + temp.size());
-              ::std::move(temp.begin(), temp.end(), emplace_iter);    // else move it in.
-          }
+          this->local_append(temp);
         }
         else {
+          ::fsc::back_emplace_iterator<local_container_type> emplace_iter(this->c);
           this->local_reserve(before + temp.size());
           ::std::copy_if(::std::make_move_iterator(temp.begin()),
                     ::std::make_move_iterator(temp.end()), emplace_iter, pred);  // predicate needed.  move it though.
@@ -2899,7 +3548,12 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         BL_BENCH_END(insert, "insert", count);
 
         ::std::vector<::std::pair<Key, T> >().swap(temp);  // clear the temp.
-        this->sorted = false;
+        if (incremental_run) {
+          this->incremental_append(before);
+        } else {
+          this->sorted = false;
+          this->runs.clear();
+        }
 
         // distribute
         BL_BENCH_REPORT_MPI_NAMED(insert, "count_sorted_map:insert", this->comm);
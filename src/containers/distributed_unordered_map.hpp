@@ -62,6 +62,7 @@
 #include "containers/distributed_map_base.hpp"
 
 #include "utils/benchmark_utils.hpp"  // for timing.
+#include "utils/comm_stats.hpp"     // for communication volume.
 #include "utils/logging.h"
 #include "utils/filter_utils.hpp"
 
@@ -80,6 +81,13 @@ namespace dsc  // distributed std container
 	// =================
 
 
+  /// true for std::unordered_multimap, whose distinct key count differs from its size.
+  template <typename C>
+  struct is_unordered_multimap : public ::std::false_type {};
+  template <typename K, typename V, typename H, typename E, typename A>
+  struct is_unordered_multimap<::std::unordered_multimap<K, V, H, E, A> > : public ::std::true_type {};
+
+
   /**
    * @brief  distributed unordered map following std unordered map's interface.
    * @details   This class is modeled after the std::unordered_map.
@@ -167,6 +175,28 @@ namespace dsc  // distributed std container
           inline int operator()(::std::pair<const Key, V> const & x) const {
             return this->operator()(x.first);
           }
+
+          /// batch version, out[i] = operator()(in[i]).  hashes a block at a time with the batch hash.
+          template <typename ID>
+          inline void ranks(Key const * in, size_t n, ID * out) const {
+            uint64_t h[256];
+            size_t m;
+            for (size_t i = 0; i < n; i += m) {
+              m = ::std::min(static_cast<size_t>(256), n - i);
+              proc_trans_hash.hash(in + i, m, h);
+              for (size_t j = 0; j < m; ++j) out[i + j] = h[j] % p;
+            }
+          }
+
+          /// rank from a precomputed hash, e.g. from RollingHashKmerSlidingWindow, without hashing the key again.
+          /// same as operator() when the hash is DistHash of the DistTrans transformed key, e.g. a canonical nthash with lex_less.
+          inline int rank_of_hash(uint64_t const & h) const {
+            return h % p;
+          }
+          template <typename ID>
+          inline void ranks_from_hashes(uint64_t const * h, size_t n, ID * out) const {
+            for (size_t i = 0; i < n; ++i) out[i] = h[i] % p;
+          }
       } key_to_rank;
 
 
@@ -226,7 +256,57 @@ namespace dsc  // distributed std container
     protected:
       local_container_type c;
 
+      /// true if local_unique_count is stale and needs a full pass over c.
       mutable bool local_changed;
+      /// number of distinct keys in c.  kept up to date by local_insert for multimaps, until an erase.
+      mutable size_t local_unique_count;
+
+      /// multimap containers track their distinct key count during insert.
+      static constexpr bool track_unique = is_unordered_multimap<local_container_type>::value;
+
+      /// answer the keys this rank owns locally, outside the query exchange.  see set_split_self_query.
+      bool split_self;
+
+      /**
+       * @brief  query with the keys this rank owns kept out of the exchange.  see imxx::distribute_split_self.  collective.
+       * @details  own keys are answered from c, straight into results, while the other keys are exchanged.  results hold
+       *           this rank's own answers first, then the remote answers by owner rank.
+       * @param one_per_key  element gives exactly 1 result per key, as for count, so no result counts are exchanged.
+       */
+      template <typename R, typename Element, typename Predicate>
+      void query_split_self(::std::vector<Key> & keys, ::std::vector<R> & results, Element & element, bool one_per_key,
+                            bool sorted_input, Predicate const & pred) const {
+        ::std::vector<size_t> send_counts, recv_counts;
+        ::fsc::back_emplace_iterator<::std::vector<R> > emplace_iter(results);
+        auto own = [&](typename ::std::vector<Key>::iterator first, typename ::std::vector<Key>::iterator last) {
+          size_t sent = ::std::accumulate(send_counts.begin(), send_counts.end(), static_cast<size_t>(0));
+          results.reserve(::std::distance(first, last) + (one_per_key ? sent : 0));
+          QueryProcessor::process(c, first, last, emplace_iter, element, sorted_input, pred);
+        };
+        ::imxx::scratch::buffer<Key> received(this->comm);
+        ::imxx::distribute_split_self(keys, this->key_to_rank, send_counts, recv_counts, *received, own, this->comm);
+
+        // answer the received keys, grouped by source rank.
+        ::std::vector<R> answers;
+        answers.reserve(received->size());
+        ::fsc::back_emplace_iterator<::std::vector<R> > answer_iter(answers);
+        ::std::vector<size_t> answer_counts(this->comm.size(), 0);
+        auto start = received->begin();
+        auto end = start;
+        for (int i = 0; i < this->comm.size(); ++i) {
+          ::std::advance(end, recv_counts[i]);
+          answer_counts[i] = QueryProcessor::process(c, start, end, answer_iter, element, sorted_input, pred);
+          start = end;
+        }
+
+        // return the answers.  with 1 per key, each rank gets back as many as it sent.
+        ::std::vector<size_t> result_counts(send_counts);
+        if (!one_per_key) ::imxx::counts_all2all(answer_counts.data(), 1, result_counts.data(), this->comm);
+        size_t own_size = results.size();
+        results.resize(own_size + ::std::accumulate(result_counts.begin(), result_counts.end(), static_cast<size_t>(0)));
+        ::imxx::wire_all2allv(answers.data(), answer_counts, results.data() + own_size, result_counts, this->comm);
+        BL_COMM_RECORD("respond", sizeof(R), answer_counts, results.size() - own_size);
+      }
 
       struct LocalCount {
           // unfiltered.
@@ -310,13 +390,20 @@ namespace dsc  // distributed std container
           size_t before = c.size();
 
           BL_BENCH_START(local_insert);
-          for (auto it = first; it != last; ++it) {
-            c.emplace(*it);
+          if (track_unique && !local_changed) {
+            // count new distinct keys on the way in, so that local_unique_size does not need a full pass.
+            for (auto it = first; it != last; ++it) {
+              if (c.find((*it).first) == c.end()) ++local_unique_count;
+              c.emplace(*it);
+            }
+          } else {
+            for (auto it = first; it != last; ++it) {
+              c.emplace(*it);
+            }
+            if (c.size() != before) local_changed = true;
           }
           BL_BENCH_END(local_insert, "emplace", this->c.size());
 
-          if (c.size() != before) local_changed = true;
-
 
           BL_BENCH_REPORT_MPI_NAMED(local_insert, "base_hashmap:local_insert", this->comm);
 
@@ -346,8 +433,6 @@ namespace dsc  // distributed std container
 //            if (pred(*it)) c.emplace(*it);
 //          }
 //
-          if (c.size() != before) local_changed = true;
-
           return c.size() - before;
       }
 
@@ -365,6 +450,7 @@ namespace dsc  // distributed std container
       template <class LocalFind, typename Predicate = ::bliss::filter::TruePredicate>
       ::std::vector<::std::pair<Key, T> > find_overlap(LocalFind & find_element, ::std::vector<Key>& keys, bool sorted_input = false, Predicate const& pred = Predicate()) const {
           BL_BENCH_INIT(find);
+          BL_COMM_SCOPE(find_overlap);
 
           ::std::vector<::std::pair<Key, T> > results;
 
@@ -386,16 +472,25 @@ namespace dsc  // distributed std container
   						typename Base::StoreTransformedEqual());
   		BL_BENCH_END(find, "unique", keys.size());
 
-            if (this->comm.size() > 1) {
+            if ((this->comm.size() > 1) && this->split_self) {
+
+              BL_BENCH_COLLECTIVE_START(find, "split_self", this->comm);
+              this->query_split_self(keys, results, find_element, false, sorted_input, pred);
+              BL_BENCH_END(find, "split_self", results.size());
+
+            } else if (this->comm.size() > 1) {
 
               BL_BENCH_COLLECTIVE_START(find, "dist_query", this->comm);
               // distribute (communication part)
               std::vector<size_t> recv_counts;
               {
-  				std::vector<size_t> i2o;
-  				std::vector<Key > buffer;
-  				::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-  				keys.swap(buffer);
+  				// scratch buffers from the communicator's pool, reused across queries.
+  				::imxx::scratch::buffer<size_t> i2o(this->comm);
+  				::imxx::scratch::buffer<Key> buffer(this->comm);
+  				i2o.reserve(keys.size());
+  				buffer.reserve(keys.size());
+  				::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+  				keys.swap(*buffer);
   	//            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
   	//            				typename Base::StoreTransformedFunc(),
   	//            				typename Base::StoreTransformedEqual()).swap(recv_counts);
@@ -507,6 +602,7 @@ namespace dsc  // distributed std container
 
             // wait for all the receives
             MPI_Waitall(this->comm.size(), &(recv_reqs[0]), MPI_STATUSES_IGNORE);
+            BL_COMM_RECORD("respond", sizeof(results[0]), send_counts, resp_counts);
 
 
             //printf("Rank %d total find %lu\n", this->comm.rank(), total);
@@ -564,6 +660,7 @@ namespace dsc  // distributed std container
       template <class LocalFind, typename Predicate = ::bliss::filter::TruePredicate>
       ::std::vector<::std::pair<Key, T> > find(LocalFind & find_element, ::std::vector<Key>& keys, bool sorted_input = false, Predicate const& pred = Predicate()) const {
           BL_BENCH_INIT(find);
+          BL_COMM_SCOPE(find);
 
           ::std::vector<::std::pair<Key, T> > results;
 
@@ -584,16 +681,25 @@ namespace dsc  // distributed std container
     						typename Base::StoreTransformedEqual());
     		BL_BENCH_END(find, "unique", keys.size());
 
-              if (this->comm.size() > 1) {
+              if ((this->comm.size() > 1) && this->split_self) {
+
+                BL_BENCH_COLLECTIVE_START(find, "split_self", this->comm);
+                this->query_split_self(keys, results, find_element, false, sorted_input, pred);
+                BL_BENCH_END(find, "split_self", results.size());
+
+              } else if (this->comm.size() > 1) {
 
                 BL_BENCH_COLLECTIVE_START(find, "dist_query", this->comm);
                 // distribute (communication part)
                 std::vector<size_t> recv_counts;
                 {
-  				  std::vector<size_t> i2o;
-  				  std::vector<Key > buffer;
-  				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-  				  keys.swap(buffer);
+  				  // scratch buffers from the communicator's pool, reused across queries.
+  				  ::imxx::scratch::buffer<size_t> i2o(this->comm);
+  				  ::imxx::scratch::buffer<Key> buffer(this->comm);
+  				  i2o.reserve(keys.size());
+  				  buffer.reserve(keys.size());
+  				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+  				  keys.swap(*buffer);
   	  //            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
   	  //            				typename Base::StoreTransformedFunc(),
   	  //            				typename Base::StoreTransformedEqual()).swap(recv_counts);
@@ -645,6 +751,7 @@ namespace dsc  // distributed std container
             BL_BENCH_COLLECTIVE_START(find, "a2a2", this->comm);
             // send back using the constructed recv count
             mxx::all2allv(results, send_counts, this->comm).swap(results);
+            BL_COMM_RECORD("respond", sizeof(results[0]), send_counts, results.size());
             BL_BENCH_END(find, "a2a2", results.size());
 
           } else {
@@ -721,6 +828,7 @@ namespace dsc  // distributed std container
           // even if count is 0, still need to participate in mpi calls.  if (keys.size() == 0) return;
           size_t before = this->c.size();
           BL_BENCH_INIT(erase);
+          BL_COMM_SCOPE(erase);
 
           if (this->empty() || ::dsc::empty(keys, this->comm)) {
             BL_BENCH_REPORT_MPI_NAMED(erase, "base_unordered_map:erase", this->comm);
@@ -805,7 +913,7 @@ namespace dsc  // distributed std container
       }
 
       unordered_map_base(const mxx::comm& _comm) : Base(_comm),
-          key_to_rank(_comm.size()), local_changed(false) {}
+          key_to_rank(_comm.size()), local_changed(false), local_unique_count(0), split_self(true) {}
 
 
       // ================ local overrides
@@ -813,10 +921,14 @@ namespace dsc  // distributed std container
       /// clears the unordered_map
       virtual void local_reset() noexcept {
         decltype(c) tmp; tmp.swap(c);
+        local_changed = false;
+        local_unique_count = 0;
       }
 
       virtual void local_clear() noexcept {
         c.clear();
+        local_changed = false;
+        local_unique_count = 0;
       }
 
       /// reserve space.  n is the local container size.  this allows different processes to individually adjust its own size.
@@ -826,6 +938,27 @@ namespace dsc  // distributed std container
         if (this->c.bucket_count() < buckets) this->c.rehash(buckets);
       }
 
+      /// see map_base::local_load
+      virtual void local_load(std::pair<Key, T> const * first, std::pair<Key, T> const * last) {
+        this->local_insert(first, last);
+      }
+
+      /// see map_base::load_distribute
+      virtual void load_distribute(std::vector<std::pair<Key, T> > & input) {
+        if (this->comm.size() > 1) {
+          std::vector<size_t> recv_counts;
+          std::vector<size_t> i2o;
+          std::vector<::std::pair<Key, T> > buffer;
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          input.swap(buffer);
+        }
+        this->local_load(input.data(), input.data() + input.size());
+      }
+
+      /// see map_base::local_batches
+      virtual void local_batches(size_t const & batch_size, typename Base::batch_op_type const & op) const {
+        Base::visit_batches(c.begin(), c.end(), batch_size, op);
+      }
 
 
     public:
@@ -834,6 +967,22 @@ namespace dsc  // distributed std container
 
       /// returns the local storage.  please use sparingly.
       local_container_type& get_local_container() { return c; }
+      local_container_type const & get_local_container() const { return c; }
+
+      /// returns the key to owner rank mapping, e.g. to bucket keys by destination before insert.
+      KeyToRank const & get_key_to_rank() const { return key_to_rank; }
+
+      /**
+       * @brief  answer the query keys this rank owns from the local container while the other keys are exchanged.
+       * @details  the own keys then skip the send and receive buffers of both exchanges of count and find.  the answers
+       *           to the own keys come first in the results.  on by default.
+       */
+      void set_split_self_query(bool v) {
+        split_self = v;
+      }
+      bool is_split_self_query() const {
+        return split_self;
+      }
 
       const_iterator cbegin() const
       {
@@ -881,6 +1030,7 @@ namespace dsc  // distributed std container
       ::std::vector<::std::pair<Key, size_type> > count(::std::vector<Key>& keys, bool sorted_input = false,
                                                         Predicate const& pred = Predicate() ) const {
           BL_BENCH_INIT(count);
+          BL_COMM_SCOPE(count);
           ::std::vector<::std::pair<Key, size_type> > results;
 
           if (::dsc::empty(keys, this->comm)) {
@@ -910,17 +1060,26 @@ namespace dsc  // distributed std container
       		BL_BENCH_END(count, "unique", keys.size());
           }
 
-          if (this->comm.size() > 1) {
+          if ((this->comm.size() > 1) && this->split_self) {
+
+            BL_BENCH_COLLECTIVE_START(count, "split_self", this->comm);
+            this->query_split_self(keys, results, count_element, true, sorted_input, pred);
+            BL_BENCH_END(count, "split_self", results.size());
+
+          } else if (this->comm.size() > 1) {
 
 
               BL_BENCH_COLLECTIVE_START(count, "dist_query", this->comm);
               // distribute (communication part)
               std::vector<size_t> recv_counts;
               {
-				  std::vector<size_t> i2o;
-				  std::vector<Key > buffer;
-				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
-				  keys.swap(buffer);
+				  // scratch buffers from the communicator's pool, reused across queries.
+				  ::imxx::scratch::buffer<size_t> i2o(this->comm);
+				  ::imxx::scratch::buffer<Key> buffer(this->comm);
+				  i2o.reserve(keys.size());
+				  buffer.reserve(keys.size());
+				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, *i2o, *buffer, this->comm);
+				  keys.swap(*buffer);
 	  //            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
 	  //            				typename Base::StoreTransformedFunc(),
 	  //            				typename Base::StoreTransformedEqual()).swap(recv_counts);
@@ -953,6 +1112,7 @@ namespace dsc  // distributed std container
             // send back using the constructed recv count
             BL_BENCH_COLLECTIVE_START(count, "a2a2", this->comm);
             mxx::all2allv(results, recv_counts, this->comm).swap(results);
+            BL_COMM_RECORD("respond", sizeof(results[0]), recv_counts, results.size());
             BL_BENCH_END(count, "a2a2", results.size());
           } else {
 
@@ -1017,6 +1177,55 @@ namespace dsc  // distributed std container
         return this->erase(erase_element, pred);
       }
 
+      /**
+       * @brief apply op(value, v) to every existing entry with key k, for each (k, v) in input, at the owner.  collective.
+       * @details  absent keys are skipped, and nothing is returned.  op returns the number of entries it changed.
+       * @param input  transformed and redistributed in place.
+       * @return  number of entries updated on this rank.
+       */
+      template <typename V, typename Updater>
+      size_t update(std::vector<::std::pair<Key, V> >& input, bool sorted_input, Updater const & op ) {
+        BL_BENCH_INIT(update);
+        BL_COMM_SCOPE(update);
+
+        if (this->empty() || ::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(update, "base_unordered_map:update", this->comm);
+          return 0;
+        }
+
+        BL_BENCH_START(update);
+        this->transform_input(input);
+        BL_BENCH_END(update, "transform_input", input.size());
+
+        if (this->comm.size() > 1) {
+          BL_BENCH_COLLECTIVE_START(update, "distribute", this->comm);
+          std::vector<size_t> recv_counts;
+          std::vector<size_t> i2o;
+          std::vector<::std::pair<Key, V> > buffer;
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          input.swap(buffer);
+          BL_BENCH_END(update, "distribute", input.size());
+        }
+
+        BL_BENCH_START(update);
+        size_t count = 0;
+        for (auto const & x : input) {
+          auto range = this->c.equal_range(x.first);
+          for (auto it = range.first; it != range.second; ++it) count += op((*it).second, x.second);
+        }
+        BL_BENCH_END(update, "update", count);
+
+        BL_BENCH_REPORT_MPI_NAMED(update, "base_unordered_map:update", this->comm);
+        return count;
+      }
+
+      /// update with values[i] for keys[i].  see update(input, sorted_input, op).  collective.
+      template <typename V, typename Updater>
+      size_t update(std::vector<Key> const & keys, std::vector<V> const & values, Updater const & op ) {
+        std::vector<::std::pair<Key, V> > input = ::dsc::zip(keys, values);
+        return this->update(input, false, op);
+      }
+
       // ================  overrides
 
       // note that for each method, there is a local version of the operartion.
@@ -1149,11 +1358,12 @@ namespace dsc  // distributed std container
       using Base::unique_size;
 
 
-//      template <class Predicate = ::bliss::filter::TruePredicate>
-//      ::std::vector<::std::pair<Key, T> > find_overlap(::std::vector<Key>& keys, bool sorted_input = false,
-//                                               Predicate const& pred = Predicate()) const {
-//          return Base::find_overlap(find_element, keys, sorted_input, pred);
-//      }
+      /// find with point to point exchange, overlapping the local finds with the communication.  collective.
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, T> > find_overlap(::std::vector<Key>& keys, bool sorted_input = false,
+                                               Predicate const& pred = Predicate()) const {
+          return Base::find_overlap(find_element, keys, sorted_input, pred);
+      }
 
 //      template <class Predicate = ::bliss::filter::TruePredicate>
 //      ::std::vector<::std::pair<Key, T> > find_collective(::std::vector<Key>& keys, bool sorted_input = false,
@@ -1186,6 +1396,7 @@ namespace dsc  // distributed std container
       size_t insert(std::vector<::std::pair<Key, T> >& input, bool sorted_input = false, Predicate const & pred = Predicate()) {
         // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
         BL_BENCH_INIT(insert);
+        BL_COMM_SCOPE(insert);
 
         if (::dsc::empty(input, this->comm)) {
           BL_BENCH_REPORT_MPI_NAMED(insert, "hashmap:insert", this->comm);
@@ -1226,6 +1437,22 @@ namespace dsc  // distributed std container
         return count;
       }
 
+      /**
+       * @brief  merge entries that are already on their owner rank, e.g. from a colocated map.  local.
+       * @details  op(stored, x) for keys present, insert for keys absent.  input keys should be transformed.
+       * @return  number of keys inserted.
+       */
+      template <typename V, typename Reducer>
+      size_t local_merge(::std::vector<::std::pair<Key, V> > const & input, Reducer const & op) {
+        size_t before = this->c.size();
+        for (auto const & x : input) {
+          auto it = this->c.find(x.first);
+          if (it == this->c.end()) this->c.emplace(x.first, static_cast<T>(x.second));
+          else op(it->second, x.second);
+        }
+        if (this->c.size() != before) this->local_changed = true;
+        return this->c.size() - before;
+      }
 
   };
 
@@ -1327,12 +1554,10 @@ namespace dsc  // distributed std container
         // no filter by range AND elemenet for now.
       } find_element;
 
-      mutable size_t local_unique_count;
-
     public:
 
 
-      unordered_multimap(const mxx::comm& _comm) : Base(_comm), local_unique_count(0) {}
+      unordered_multimap(const mxx::comm& _comm) : Base(_comm) {}
 
       virtual ~unordered_multimap() {}
 
@@ -1467,6 +1692,7 @@ namespace dsc  // distributed std container
       size_t insert(std::vector<::std::pair<Key, T> >& input, bool sorted_input = false, Predicate const & pred = Predicate()) {
         // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
         BL_BENCH_INIT(insert);
+        BL_COMM_SCOPE(insert);
 
         if (::dsc::empty(input, this->comm)) {
           BL_BENCH_REPORT_MPI_NAMED(insert, "hash_multimap:insert", this->comm);
@@ -1515,7 +1741,8 @@ namespace dsc  // distributed std container
       }
 
 
-      /// get the size of unique keys in the current local container.
+      /// get the size of unique keys in the current local container.  counted during insert; a full pass is only
+      /// needed after an erase.
       virtual size_t local_unique_size() const {
         if (this->local_changed) {
 
@@ -1524,11 +1751,11 @@ namespace dsc  // distributed std container
           for (auto it = this->c.begin(); it != max; ++it) {
             unique_set.emplace((*it).first);
           }
-          local_unique_count = unique_set.size();
+          this->local_unique_count = unique_set.size();
 
           this->local_changed = false;
         }
-        return local_unique_count;
+        return this->local_unique_count;
       }
   };
 
@@ -1595,6 +1822,12 @@ namespace dsc  // distributed std container
     protected:
       Reduc r;
 
+      /// combine duplicate keys locally before distributing.  see local_combine.
+      bool combine_local;
+      /// cumulative local element counts before and after local combine.
+      size_t combine_in;
+      size_t combine_out;
+
       /**
        * @brief insert new elements in the distributed unordered_multimap.
        * @param first
@@ -1642,6 +1875,11 @@ namespace dsc  // distributed std container
 
       }
 
+      /// see map_base::local_load.  reduces with existing entries.
+      virtual void local_load(std::pair<Key, T> const * first, std::pair<Key, T> const * last) {
+        this->local_insert(first, last);
+      }
+
       /// local reduction via a copy of local container type (i.e. unordered_map).
       /// this takes quite a bit of memory due to use of unordered_map, but is significantly faster than sorting.
       virtual void local_reduction(::std::vector<::std::pair<Key, T> >& input, bool & sorted_input) {
@@ -1676,14 +1914,60 @@ namespace dsc  // distributed std container
         BL_BENCH_REPORT_MPI_NAMED(reduce_tuple, "reduction_hashmap:local_reduce", this->comm);
       }
 
+      /**
+       * @brief combine duplicate keys locally with the reduction operator, so that only unique (key, value) pairs are distributed.
+       * @details  each input key is treated as (key, T(1)).  pred is applied to that tuple before combining.
+       *           output is overwritten.  input is left unchanged.
+       */
+      template <typename Predicate = ::bliss::filter::TruePredicate>
+      void local_combine(::std::vector<Key> const & input, ::std::vector<::std::pair<Key, T> > & output,
+                         Predicate const & pred = Predicate()) {
+        output.clear();
+        if (input.size() == 0) return;
+
+        // not reserving to input size: with high coverage data, the unique keys are a small fraction of the input.
+        local_container_type temp;
+
+        bool filter = !::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value;
+        ::std::pair<Key, T> v;
+        v.second = T(1);
+        auto max = input.end();
+        for (auto it = input.begin(); it != max; ++it) {
+          v.first = *it;
+          if (filter && !pred(v)) continue;
+
+          auto result = temp.emplace(v);
+          if (!(result.second)) {
+            // failed insertion - means an entry is already there, so reduce
+            result.first->second = r(result.first->second, v.second);
+          }
+        }
+        output.assign(temp.begin(), temp.end());
+
+        this->combine_in += input.size();
+        this->combine_out += output.size();
+      }
+
 
     public:
 
 
-      reduction_unordered_map(const mxx::comm& _comm) : Base(_comm) {}
+      reduction_unordered_map(const mxx::comm& _comm) : Base(_comm), combine_local(false), combine_in(0), combine_out(0) {}
 
       virtual ~reduction_unordered_map() {};
 
+      /// enable or disable local combining of duplicate keys before distribution, for key-only inserts.
+      void set_local_combine(bool v) {
+        combine_local = v;
+      }
+      bool is_local_combine() const {
+        return combine_local;
+      }
+      /// ratio of local element counts before vs after local combine, cumulative over all inserts.  0 if nothing was combined.
+      double get_combine_ratio() const {
+        return (combine_out == 0) ? 0.0 : static_cast<double>(combine_in) / static_cast<double>(combine_out);
+      }
+
       using Base::count;
       using Base::find;
       using Base::erase;
@@ -1698,6 +1982,7 @@ namespace dsc  // distributed std container
       size_t insert(std::vector<::std::pair<Key, T> >& input, bool sorted_input = false, Predicate const & pred = Predicate()) {
         // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
         BL_BENCH_INIT(insert);
+        BL_COMM_SCOPE(insert);
 
         if (::dsc::empty(input, this->comm)) {
           BL_BENCH_REPORT_MPI_NAMED(insert, "reduction_hashmap:insert", this->comm);
@@ -1812,6 +2097,42 @@ namespace dsc  // distributed std container
 
       virtual ~counting_unordered_map() {};
 
+      /**
+       * @brief  k-mer count spectrum, e.g. for genome size estimation.  collective.
+       * @details  hist[i] is the number of distinct keys with count i for i < max_count, and hist[max_count] the number
+       *           with count at least max_count.  one scan of the local table, split among OpenMP threads when enabled,
+       *           then a reduction.  see dsc::count_histogram.
+       * @return  the histogram on root, empty on the other ranks.
+       */
+      ::std::vector<size_t> histogram(size_t max_count, int root = 0) const {
+        BL_BENCH_INIT(histogram);
+
+        BL_BENCH_START(histogram);
+        ::std::vector<size_t> hist = ::dsc::count_histogram(this->c, max_count, root, this->comm);
+        BL_BENCH_END(histogram, "histogram", hist.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(histogram, "count_hashmap:histogram", this->comm);
+        return hist;
+      }
+
+      /**
+       * @brief  the k most abundant keys, e.g. adapters and contaminants.  collective.
+       * @details  one scan of the local table, split among OpenMP threads when enabled,
+       *           then O(log max count) scalar allreduces to find the k-th count, and only the k winners are gathered.
+       *           of keys tied at the k-th count, those on lower ranks are kept.  see dsc::count_top_k.
+       * @return  on root, min(k, size()) (key, count) pairs by descending count.  empty on the other ranks.
+       */
+      ::std::vector<::std::pair<Key, T> > top_k(size_t k, int root = 0) const {
+        BL_BENCH_INIT(top_k);
+
+        BL_BENCH_START(top_k);
+        ::std::vector<::std::pair<Key, T> > result = ::dsc::count_top_k(this->c, k, root, this->comm);
+        BL_BENCH_END(top_k, "top_k", result.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(top_k, "count_hashmap:top_k", this->comm);
+        return result;
+      }
+
       using Base::insert;
       using Base::count;
       using Base::find;
@@ -1827,6 +2148,7 @@ namespace dsc  // distributed std container
       size_t insert(std::vector< Key >& input, bool sorted_input = false, Predicate const &pred = Predicate()) {
         // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
         BL_BENCH_INIT(insert);
+        BL_COMM_SCOPE(insert);
 
         if (::dsc::empty(input, this->comm)) {
           BL_BENCH_REPORT_MPI_NAMED(insert, "count_hashmap:insert", this->comm);
@@ -1839,6 +2161,34 @@ namespace dsc  // distributed std container
         this->transform_input(input);
         BL_BENCH_END(insert, "transform_input", input.size());
 
+        if (this->combine_local) {
+          // pre-aggregate locally, then only send the unique (key, count) pairs.
+          ::std::vector<::std::pair<Key, T> > combined;
+          BL_BENCH_START(insert);
+          this->Base::local_combine(input, combined, pred);
+          ::std::vector<Key>().swap(input);  // raw keys no longer needed.
+          BL_BENCH_END(insert, "local_combine", combined.size());
+
+          if (this->comm.size() > 1) {
+            BL_BENCH_START(insert);
+            std::vector<size_t> recv_counts;
+            std::vector<size_t> i2o;
+            std::vector<::std::pair<Key, T> > buffer;
+            ::imxx::distribute(combined, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+            combined.swap(buffer);
+            BL_BENCH_END(insert, "dist_data", combined.size());
+          }
+
+          // predicate was already applied during combine.
+          BL_BENCH_START(insert);
+          size_t count = this->Base::local_insert(combined.begin(), combined.end());
+          BL_BENCH_END(insert, "local_insert", this->local_size());
+
+          BL_BENCH_REPORT_MPI_NAMED(insert, "count_hashmap:insert_key", this->comm);
+
+          return count;
+        }
+
         // then send the raw k-mers.
         // communication part
         if (this->comm.size() > 1) {
@@ -29,6 +29,12 @@
 #include <unordered_set>
 #include <algorithm>  // upper bound, unique, sort, etc.
 #include <random>
+#include <functional>  // plus
+#include <limits>
+#include <type_traits>
+#include <cassert>
+#include <utility>
+#include <vector>
 
 #include "containers/fsc_container_utils.hpp"
 
@@ -36,6 +42,7 @@
 
 #include <mxx/distribution.hpp>
 #include <mxx/samplesort.hpp>
+#include <mxx/reduction.hpp>
 
 namespace dsc {
 
@@ -52,6 +59,16 @@ namespace dsc {
 	  }
 	}
 
+  /// (keys[i], values[i]) pairs, e.g. for the batched update(keys, values, op) of the maps.  sizes must match.
+  template <typename Key, typename V>
+  std::vector<std::pair<Key, V> > zip(std::vector<Key> const & keys, std::vector<V> const & values) {
+    assert(keys.size() == values.size());
+    std::vector<std::pair<Key, V> > out;
+    out.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) out.emplace_back(keys[i], values[i]);
+    return out;
+  }
+
 
   // =============== convenience functions for distribution of vector via all to all and a rank mapping function
 	// TODO: make this cleaner...
@@ -792,6 +809,82 @@ namespace dsc {
 
     }
 
+
+  /**
+   * @brief  global count spectrum of a distributed (key, count) table.  collective.
+   * @details  hist[i] is the number of keys with count i for i < max_count, and hist[max_count] the number with count at
+   *           least max_count.  each rank scans its local table once, see fsc::count_histogram, and the per-rank
+   *           histograms are summed on root.  keys are assumed unique across ranks, as in the counting maps.
+   * @return  the histogram on root, empty on the other ranks.
+   */
+  template <typename Container>
+  std::vector<size_t> count_histogram(Container const & c, size_t max_count, int root, mxx::comm const & comm) {
+    std::vector<size_t> hist(max_count + 1, 0);
+    ::fsc::count_histogram(c, hist);
+
+    if (comm.size() > 1) {
+      hist = ::mxx::reduce(hist, root, std::plus<size_t>(), comm);
+      if (comm.rank() != root) hist.clear();
+    }
+    return hist;
+  }
+
+  /**
+   * @brief  the k keys with the highest counts in a distributed (key, count) table, highest first.  collective.
+   * @details  each rank selects its local top k (see fsc::count_top_k), which contain the global top k.  the k-th
+   *           highest count t is then found by bisection over the count range:  each step is 1 allreduce of the
+   *           number of local candidates with count at least the midpoint.  the ranks keep their candidates above t,
+   *           and as many at t as are needed to make k, taken in rank order, and only those are gathered on root.
+   *           so O(log max count) scalar allreduces and k entries move, instead of the tables or a guessed
+   *           find(pred).  keys are assumed unique across ranks, as in the counting maps.
+   * @return  on root, min(k, number of keys) (key, count) pairs in descending count order.  empty on the other ranks.
+   */
+  template <typename Container>
+  std::vector<std::pair<typename std::remove_const<typename Container::value_type::first_type>::type,
+                        typename Container::value_type::second_type> >
+  count_top_k(Container const & c, size_t k, int root, mxx::comm const & comm) {
+    using Key = typename std::remove_const<typename Container::value_type::first_type>::type;
+    using T = typename Container::value_type::second_type;
+
+    std::vector<std::pair<Key, T> > local;
+    ::fsc::count_top_k(c, k, local);
+    if (comm.size() == 1) return local;
+
+    size_t total = ::mxx::allreduce(local.size(), comm);
+    if (total > k) {
+      // number of local candidates with count >= x.  local is in descending count order.
+      auto at_least = [&local](uint64_t x) {
+        return static_cast<size_t>(std::partition_point(local.begin(), local.end(),
+            [&x](std::pair<Key, T> const & e) { return static_cast<uint64_t>(e.second) >= x; }) - local.begin());
+      };
+
+      // at_least(lo) >= k and at_least(hi) < k globally.
+      uint64_t lo = ::mxx::allreduce(local.empty() ? std::numeric_limits<uint64_t>::max() : static_cast<uint64_t>(local.back().second),
+                                     ::mxx::min<uint64_t>(), comm);
+      uint64_t hi = ::mxx::allreduce(local.empty() ? static_cast<uint64_t>(0) : static_cast<uint64_t>(local.front().second),
+                                     ::mxx::max<uint64_t>(), comm) + 1;
+      while ((hi - lo) > 1) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (::mxx::allreduce(at_least(mid), comm) >= k) lo = mid;
+        else hi = mid;
+      }
+
+      // all above lo, and the ties at lo in rank order up to k.
+      size_t above = at_least(lo + 1);
+      size_t ties = at_least(lo) - above;
+      size_t need = k - ::mxx::allreduce(above, comm);
+      size_t before = ::mxx::exscan(ties, comm);
+      if (comm.rank() == 0) before = 0;
+      size_t take = (need > before) ? std::min(ties, need - before) : 0;
+      local.resize(above + take);
+    }
+
+    std::vector<std::pair<Key, T> > result = ::mxx::gatherv(local, root, comm);
+    if (comm.rank() == root) std::stable_sort(result.begin(), result.end(), ::fsc::detail::count_greater());
+    else result.clear();
+    return result;
+  }
+
 }  // namespace dsc
 
 
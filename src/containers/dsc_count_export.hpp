@@ -0,0 +1,223 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    dsc_count_export.hpp
+ * @ingroup containers
+ * @author  tpan
+ * @brief   export the content of a distributed count map to 1 file, with collective MPI-IO writes.
+ * @details each rank serializes its local (key, count) pairs, an exclusive prefix sum of the byte counts gives each
+ *          rank's file offset, and all ranks write with MPI_File_write_at_all, with the MPI-IO hints of mpiio_file.
+ *          with sorted, the entries are first sorted by key across the ranks with mxx::sort, so the file is in key order.
+ *
+ *          formats:
+ *            binary          a map segment (see dsc_map_file.hpp) of the whole map:  page sized header with rank 0 and
+ *                            1 rank, then the (key, count) pairs.  it can be memory mapped with mapped_map_segment, or
+ *                            loaded with map_base::load if named prefix.0.dsc.
+ *            jellyfish_text  "ACGT... count" lines, as jellyfish dump -c.
+ *            kmc_text        "ACGT...<tab>count" lines, as kmc_dump / kmc_tools transform dump.
+ *          the text formats need k-mer keys and integral counts.  k-mers are written as stored, e.g. canonical for a
+ *          canonical map.
+ */
+#ifndef SRC_CONTAINERS_DSC_COUNT_EXPORT_HPP_
+#define SRC_CONTAINERS_DSC_COUNT_EXPORT_HPP_
+
+#include <mpi.h>
+
+#include <cstdint>
+#include <cstring>      // memcpy
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
+#include <mxx/sort.hpp>
+
+#include "common/kmer.hpp"
+#include "containers/dsc_map_file.hpp"
+#include "io/file.hpp"   // mpiio_hints
+#include "io/io_exception.hpp"
+#include "utils/exception_handling.hpp"
+#include "utils/benchmark_utils.hpp"
+
+namespace dsc
+{
+
+  enum class count_format { binary, jellyfish_text, kmc_text };
+
+  namespace detail {
+
+    /// append k characters of a k-mer, first character first.
+    template <typename Kmer>
+    void append_kmer_chars(Kmer const & kmer, ::std::vector<char> & out) {
+      size_t pos = out.size();
+      out.resize(pos + Kmer::size);
+
+      Kmer cpy(kmer);
+      typename Kmer::KmerWordType mask = (static_cast<typename Kmer::KmerWordType>(1) << Kmer::bitsPerChar) - 1;
+      for (size_t i = Kmer::size; i > 0; --i) {
+        out[pos + i - 1] = Kmer::KmerAlphabet::TO_ASCII[cpy.getData()[0] & mask];
+        cpy.template right_shift_bits<Kmer::bitsPerChar>();
+      }
+    }
+
+    /// "kmer<sep>count\n" lines.
+    template <typename Key, typename T>
+    void serialize_text(::std::vector<::std::pair<Key, T> > const & entries, char const sep, ::std::vector<char> & out) {
+      static_assert(::bliss::common::is_kmer<Key>::value, "text count export needs k-mer keys");
+      static_assert(::std::is_integral<T>::value, "text count export needs integral counts");
+
+      out.reserve(entries.size() * (Key::size + 12));
+      char digits[24];
+      for (auto const & e : entries) {
+        append_kmer_chars(e.first, out);
+        out.push_back(sep);
+
+        // count, in decimal.
+        unsigned long long v = static_cast<unsigned long long>(e.second);
+        int n = 0;
+        do {
+          digits[n++] = '0' + (v % 10);
+          v /= 10;
+        } while (v > 0);
+        while (n > 0) out.push_back(digits[--n]);
+        out.push_back('\n');
+      }
+    }
+
+    template <typename Key, typename T>
+    void serialize_entries(::std::vector<::std::pair<Key, T> > const & entries, count_format const & fmt,
+                           ::std::vector<char> & out, ::std::true_type) {
+      serialize_text(entries, (fmt == count_format::kmc_text) ? '\t' : ' ', out);
+    }
+    template <typename Key, typename T>
+    void serialize_entries(::std::vector<::std::pair<Key, T> > const &, count_format const &,
+                           ::std::vector<char> &, ::std::false_type) {
+      throw ::bliss::utils::make_exception<::std::invalid_argument>("ERROR: count export: text formats need k-mer keys and integral counts.");
+    }
+
+    /// write count bytes at offset, in steps of 2^30 bytes as count is int.  collective.
+    inline int write_all(MPI_File fh, size_t const & offset, char const * data, size_t const & count, ::mxx::comm const & comm) {
+      size_t step_size = 1UL << 30;
+      size_t steps = ::mxx::allreduce((count + step_size - 1) / step_size, [](size_t const & x, size_t const & y){
+        return ::std::max(x, y);
+      }, comm);
+
+      int res = MPI_SUCCESS;
+      MPI_Status stat;
+      for (size_t s = 0; s < steps; ++s) {
+        size_t start = ::std::min(count, s * step_size);
+        size_t n = ::std::min(count - start, step_size);
+        int r = MPI_File_write_at_all(fh, offset + start, const_cast<char *>(data + start), n, MPI_BYTE, &stat);
+        if (r != MPI_SUCCESS) res = r;
+      }
+      return res;
+    }
+  }
+
+  /**
+   * @brief  write the content of map to filename, overwriting it.  collective.
+   * @param sorted   sort the entries by key across the ranks first.
+   * @param hints    MPI-IO hints.  with autodetect, derived from the directory of filename.
+   * @return  number of entries in the file.
+   */
+  template <typename Map>
+  size_t export_counts(Map const & map, ::std::string const & filename, count_format const & fmt = count_format::binary,
+                       bool const & sorted = false,
+                       ::bliss::io::parallel::mpiio_hints hints = ::bliss::io::parallel::mpiio_hints()) {
+    using Key = typename Map::key_type;
+    using T = typename Map::mapped_type;
+    ::mxx::comm const & comm = map.get_comm();
+
+    BL_BENCH_INIT(count_export);
+
+    BL_BENCH_START(count_export);
+    ::std::vector<::std::pair<Key, T> > local;
+    map.to_vector(local);
+    BL_BENCH_END(count_export, "to_vector", local.size());
+
+    if (sorted) {
+      BL_BENCH_COLLECTIVE_START(count_export, "sort", comm);
+      ::mxx::sort(local.begin(), local.end(), [](::std::pair<Key, T> const & x, ::std::pair<Key, T> const & y){
+        return x.first < y.first;
+      }, comm);
+      BL_BENCH_END(count_export, "sort", local.size());
+    }
+
+    BL_BENCH_START(count_export);
+    size_t total = ::mxx::allreduce(local.size(), comm);
+    ::std::vector<char> buffer;
+    if (fmt == count_format::binary) {
+      static_assert(detail::is_flat<::std::pair<Key, T> >::value, "map segment entries need to be plain data");
+
+      // header page on rank 0.
+      if (comm.rank() == 0) {
+        ::dsc::map_segment_header header = map.segment_header(total);
+        header.rank = 0;
+        header.nranks = 1;
+        buffer.resize(map_segment_header::data_offset, 0);
+        memcpy(buffer.data(), &header, sizeof(map_segment_header));
+      }
+      size_t bytes = local.size() * sizeof(::std::pair<Key, T>);
+      buffer.resize(buffer.size() + bytes);
+      memcpy(buffer.data() + buffer.size() - bytes, local.data(), bytes);
+    } else {
+      detail::serialize_entries(local, fmt, buffer, ::std::integral_constant<bool,
+                                ::bliss::common::is_kmer<Key>::value && ::std::is_integral<T>::value>());
+    }
+    ::std::vector<::std::pair<Key, T> >().swap(local);
+
+    size_t offset = ::mxx::exscan(buffer.size(), comm);
+    if (comm.rank() == 0) offset = 0;
+    BL_BENCH_END(count_export, "serialize", buffer.size());
+
+    BL_BENCH_COLLECTIVE_START(count_export, "write", comm);
+    if (hints.autodetect) {
+      size_t slash = filename.find_last_of('/');
+      hints.detect((slash == ::std::string::npos) ? ::std::string(".") : filename.substr(0, slash + 1), comm);
+    }
+    MPI_Info info = hints.to_info();
+    MPI_File fh;
+    int res = MPI_File_open(comm, const_cast<char *>(filename.c_str()), MPI_MODE_WRONLY | MPI_MODE_CREATE, info, &fh);
+    if (info != MPI_INFO_NULL) MPI_Info_free(&info);
+    if (res == MPI_SUCCESS) {
+      res = MPI_File_set_size(fh, 0);
+      int r = detail::write_all(fh, offset, buffer.data(), buffer.size(), comm);
+      if (res == MPI_SUCCESS) res = r;
+      r = MPI_File_close(&fh);
+      if (res == MPI_SUCCESS) res = r;
+    }
+    BL_BENCH_END(count_export, "write", buffer.size());
+
+    BL_BENCH_REPORT_MPI_NAMED(count_export, "map_base:export_counts", comm);
+
+    if (!::mxx::all_of(res == MPI_SUCCESS, comm)) {
+      char error_string[MPI_MAX_ERROR_STRING];
+      int len = 0;
+      if (res != MPI_SUCCESS) MPI_Error_string(res, error_string, &len);
+      throw ::bliss::utils::make_exception<::bliss::io::IOException>((res == MPI_SUCCESS) ?
+          ::std::string("ERROR: count export failed on another rank.") :
+          ("ERROR: count export to " + filename + ": " + ::std::string(error_string, len)));
+    }
+
+    return total;
+  }
+
+} // namespace dsc
+
+#endif // SRC_CONTAINERS_DSC_COUNT_EXPORT_HPP_
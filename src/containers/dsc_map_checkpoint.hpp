@@ -0,0 +1,278 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    dsc_map_checkpoint.hpp
+ * @ingroup containers
+ * @author  tpan
+ * @brief   checkpoint and restart of a distributed map that is being built from a file.
+ * @details a checkpoint is the map segment of each rank (see dsc_map_file.hpp) plus a small progress record per rank:
+ *          the epoch, the input file it was built from, and the file offset up to which the input has been consumed.
+ *          on restart with the same input and number of ranks, the map is loaded from the newest checkpoint that all
+ *          ranks completed, and parsing resumes at the saved offset of each rank.
+ *
+ *          the local content is copied, then written on a std::async thread while the build continues, so a
+ *          checkpoint costs 1 copy of the local map in memory until it is written.  2 slots are used in turn, and a slot
+ *          is only overwritten after all ranks completed the other one, so there is always 1 complete checkpoint.
+ *          the segment is renamed into place and the progress record written last, both synced, so a progress record
+ *          means its segment is complete.
+ *
+ *          files are prefix.ckpt<slot>.<rank>.dsc and prefix.ckpt<slot>.<rank>.progress.  node-local SSD works for
+ *          restarting in the same allocation.  to survive the loss of a node, use a shared burst buffer or file system.
+ */
+#ifndef SRC_CONTAINERS_DSC_MAP_CHECKPOINT_HPP_
+#define SRC_CONTAINERS_DSC_MAP_CHECKPOINT_HPP_
+
+#include <cstdint>
+#include <cerrno>
+#include <cstdio>       // rename, remove
+#include <cstring>      // memcpy, strerror
+#include <future>       // async
+#include <string>
+#include <sstream>
+#include <utility>
+#include <vector>
+#include <unistd.h>     // write, close, fsync
+#include <fcntl.h>      // open64
+#include <sys/stat.h>   // stat64
+
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
+
+#include "containers/dsc_map_file.hpp"
+#include "io/io_exception.hpp"
+#include "utils/exception_handling.hpp"
+
+namespace dsc
+{
+
+  /// progress record of 1 rank's checkpoint.
+  struct checkpoint_progress {
+      char magic[8];
+      /// checkpoint number, from 1.
+      uint64_t epoch;
+      int32_t rank;
+      int32_t nranks;
+      /// input file name hash and size, to detect a different input.
+      uint64_t input_hash;
+      uint64_t input_size;
+      /// input consumed by this rank:  resume at the first record at or after this file offset.
+      uint64_t offset;
+      /// number of entries in the segment.
+      uint64_t count;
+
+      static constexpr char const * magic_string() { return "BLDSCCK1"; }
+  };
+
+  /**
+   * @brief  checkpoints of a map built from 1 input file.  see file description.
+   * @tparam Map  distributed map type, derived from ::dsc::map_base.
+   */
+  template <typename Map>
+  class map_checkpoint {
+    public:
+      using value_type = ::std::pair<typename Map::key_type, typename Map::mapped_type>;
+
+    protected:
+      ::std::string prefix;
+      const mxx::comm& comm;
+
+      uint64_t input_hash;
+      uint64_t input_size;
+
+      /// last epoch started.
+      uint64_t epoch;
+
+      /// copy of the local content, owned by the pending write.
+      ::std::vector<value_type> snapshot;
+      ::std::future<void> pending;
+
+      ::std::string slot_prefix(uint64_t e) const {
+        ::std::stringstream ss;
+        ss << prefix << ".ckpt" << (e & 1);
+        return ss.str();
+      }
+      ::std::string progress_filename(uint64_t e) const {
+        ::std::stringstream ss;
+        ss << slot_prefix(e) << "." << comm.rank() << ".progress";
+        return ss.str();
+      }
+
+      static void throw_io(::std::string const & what, ::std::string const & filename, int err) {
+        ::std::stringstream ss;
+        ss << "ERROR: map checkpoint: " << what << " " << filename << ": " << strerror(err);
+        throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+      }
+
+      static void sync_file(::std::string const & filename) {
+        int fd = open64(filename.c_str(), O_RDONLY);
+        if (fd == -1) throw_io("unable to open", filename, errno);
+        int ret = fsync(fd);
+        int err = errno;
+        close(fd);
+        if (ret != 0) throw_io("unable to sync", filename, err);
+      }
+
+      static void write_progress(::std::string const & filename, checkpoint_progress const & prog) {
+        int fd = open64(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1) throw_io("unable to open", filename, errno);
+        bool ok = (::write(fd, &prog, sizeof(checkpoint_progress)) == static_cast<ssize_t>(sizeof(checkpoint_progress))) &&
+            (fsync(fd) == 0);
+        int err = errno;
+        close(fd);
+        if (!ok) throw_io("unable to write", filename, err);
+      }
+
+      /// true if the progress record of slot e of this rank is for this input and number of ranks, and its segment is complete.
+      bool read_progress(uint64_t e, checkpoint_progress & prog) const {
+        int fd = open64(progress_filename(e).c_str(), O_RDONLY);
+        if (fd == -1) return false;
+        bool ok = (pread(fd, &prog, sizeof(checkpoint_progress), 0) == static_cast<ssize_t>(sizeof(checkpoint_progress)));
+        close(fd);
+        if (!ok || (memcmp(prog.magic, checkpoint_progress::magic_string(), 8) != 0) ||
+            (prog.rank != comm.rank()) || (prog.nranks != comm.size()) ||
+            (prog.input_hash != input_hash) || (prog.input_size != input_size) || ((prog.epoch & 1) != (e & 1)))
+          return false;
+
+        ::dsc::map_segment_header h;
+        return ::dsc::read_map_segment_header(::dsc::map_segment_filename(slot_prefix(e), comm.rank()), h) &&
+            (h.count == prog.count);
+      }
+
+      /// the write done on the async thread:  invalidate the slot, write the segment, then the progress record.
+      void write(uint64_t e, ::dsc::map_segment_header const & header, checkpoint_progress const & prog) const {
+        ::std::string pname = progress_filename(e);
+        ::std::remove(pname.c_str());
+
+        ::std::string seg = ::dsc::map_segment_filename(slot_prefix(e), comm.rank());
+        ::std::string tmp = seg + ".tmp";
+        ::dsc::write_map_segment(tmp, header, snapshot.data());
+        sync_file(tmp);
+        if (::std::rename(tmp.c_str(), seg.c_str()) != 0) throw_io("unable to rename", tmp, errno);
+
+        ::std::string ptmp = pname + ".tmp";
+        write_progress(ptmp, prog);
+        if (::std::rename(ptmp.c_str(), pname.c_str()) != 0) throw_io("unable to rename", ptmp, errno);
+      }
+
+    public:
+      /**
+       * @param _prefix      path prefix of the checkpoint files.
+       * @param input_name   input file that the map is built from.  its name and size identify the input.
+       */
+      map_checkpoint(::std::string const & _prefix, ::std::string const & input_name, const mxx::comm& _comm) :
+        prefix(_prefix), comm(_comm),
+        input_hash(::dsc::map_segment_header::hash_name(input_name.c_str())), input_size(0), epoch(0) {
+        struct stat64 st;
+        if (stat64(input_name.c_str(), &st) == 0) input_size = static_cast<uint64_t>(st.st_size);
+      }
+
+      ~map_checkpoint() {
+        // errors were reported by wait(), if it was called.
+        try {
+          if (pending.valid()) pending.get();
+        } catch (...) {}
+      }
+
+      map_checkpoint(map_checkpoint const & other) = delete;
+      map_checkpoint & operator=(map_checkpoint const & other) = delete;
+
+      /// last epoch started, 0 if none.
+      uint64_t get_epoch() const { return epoch; }
+
+      /**
+       * @brief  load the newest checkpoint that all ranks completed into map.  collective.
+       * @return  this rank's offset to resume parsing from, or 0 if there is no usable checkpoint (map is unchanged).
+       */
+      size_t restore(Map & map) {
+        checkpoint_progress prog[2];
+        bool valid[2] = {read_progress(0, prog[0]), read_progress(1, prog[1])};
+
+        // newest complete epoch on every rank.  a rank is at most 1 epoch ahead, and keeps the one before.
+        uint64_t newest = 0;
+        for (int s = 0; s < 2; ++s)
+          if (valid[s] && (prog[s].epoch > newest)) newest = prog[s].epoch;
+        uint64_t e = ::mxx::allreduce(newest, ::mxx::min<uint64_t>(), comm);
+
+        int slot = -1;
+        for (int s = 0; s < 2; ++s)
+          if (valid[s] && (prog[s].epoch == e)) slot = s;
+        if ((e == 0) || !::mxx::all_of(slot >= 0, comm)) return 0;
+
+        map.load(slot_prefix(e));
+        epoch = e;
+        return prog[slot].offset;
+      }
+
+      /**
+       * @brief  start a checkpoint of the map's local content and of the input consumed so far.  collective.
+       * @details  waits for the previous checkpoint on all ranks first.  the write itself is asynchronous.
+       * @param offset  file offset up to which this rank's input is in the map.
+       */
+      void save(Map const & map, size_t const & offset) {
+        this->wait();
+
+        ++epoch;
+        map.to_vector(snapshot);
+
+        checkpoint_progress prog;
+        memset(&prog, 0, sizeof(checkpoint_progress));
+        memcpy(prog.magic, checkpoint_progress::magic_string(), 8);
+        prog.epoch = epoch;
+        prog.rank = comm.rank();
+        prog.nranks = comm.size();
+        prog.input_hash = input_hash;
+        prog.input_size = input_size;
+        prog.offset = offset;
+        prog.count = snapshot.size();
+
+        ::dsc::map_segment_header header = map.segment_header(snapshot.size());
+        uint64_t e = epoch;
+        pending = ::std::async(::std::launch::async, [this, e, header, prog](){
+          this->write(e, header, prog);
+        });
+      }
+
+      /// wait for the pending checkpoint.  collective.  throws on all ranks if it failed on any.
+      void wait() {
+        bool ok = true;
+        ::std::string msg;
+        try {
+          if (pending.valid()) pending.get();  // rethrows exceptions from the write thread.
+        } catch (::bliss::io::IOException const & e) {
+          ok = false;
+          msg = e.what();
+        }
+        ::std::vector<value_type>().swap(snapshot);
+
+        if (!::mxx::all_of(ok, comm)) {
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(ok ? "ERROR: map checkpoint failed on another rank." : msg);
+        }
+      }
+
+      /// wait for the pending checkpoint, then remove this rank's checkpoint files, e.g. after the build completed.  collective.
+      void remove() {
+        this->wait();
+        for (uint64_t s = 0; s < 2; ++s) {
+          ::std::remove(progress_filename(s).c_str());
+          ::std::remove(::dsc::map_segment_filename(slot_prefix(s), comm.rank()).c_str());
+        }
+      }
+  };
+
+} // namespace dsc
+
+#endif // SRC_CONTAINERS_DSC_MAP_CHECKPOINT_HPP_
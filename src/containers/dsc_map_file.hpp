@@ -0,0 +1,367 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    dsc_map_file.hpp
+ * @ingroup containers
+ * @author  tpan
+ * @brief   on-disk segment format for the local content of a distributed map.
+ * @details each rank writes its local (key, value) pairs as one flat array, preceded by a page sized header.
+ *          the array is page aligned so the segment can be memory mapped and used in place.
+ *
+ *          the header records the map type (via a hash of the type name, which covers the container,
+ *          key, value, distribution and storage hash/transform types), k and bits per character for k-mer keys,
+ *          the entry size, and the rank and number of ranks that wrote it.
+ *          the type hash is compiler specific: segments should be read by a binary built with the same compiler.
+ */
+#ifndef SRC_CONTAINERS_DSC_MAP_FILE_HPP_
+#define SRC_CONTAINERS_DSC_MAP_FILE_HPP_
+
+#include <cstdint>
+#include <cerrno>
+#include <cstring>      // memcpy, strerror
+#include <string>
+#include <sstream>
+#include <utility>
+#include <type_traits>
+#include <vector>
+#include <unistd.h>     // write, close
+#include <fcntl.h>      // open64
+#include <sys/mman.h>   // mmap
+#include <sys/stat.h>   // fstat
+
+#include "common/kmer.hpp"
+#include "io/io_exception.hpp"
+#include "utils/exception_handling.hpp"
+
+namespace dsc
+{
+
+  /// header of a map segment file.  padded to map_segment_header::data_offset bytes on disk.
+  struct map_segment_header {
+      /// offset of the data in the file.  page size, so that the mapped data is aligned.
+      static constexpr size_t data_offset = 4096;
+
+      char magic[8];
+      /// hash of the type name of the map.
+      uint64_t type_hash;
+      /// k and bits per character if the key is a k-mer.  0 otherwise
+      uint32_t k;
+      uint32_t bits_per_char;
+      uint32_t key_bytes;
+      uint32_t value_bytes;
+      uint32_t entry_bytes;
+      /// rank that wrote this segment, and the number of ranks (i.e. segments).
+      int32_t rank;
+      int32_t nranks;
+      uint32_t reserved;
+      /// number of entries
+      uint64_t count;
+
+      static constexpr char const * magic_string() { return "BLDSCMP1"; }
+
+      /// 64 bit FNV-1a of a type name.
+      static uint64_t hash_name(char const * name) {
+        uint64_t h = 14695981039346656037ULL;
+        for (; *name != 0; ++name) {
+          h ^= static_cast<unsigned char>(*name);
+          h *= 1099511628211ULL;
+        }
+        return h;
+      }
+
+      /// true if the layout and type of the segment match.  rank and count are not compared.
+      bool compatible(map_segment_header const & other) const {
+        return (memcmp(magic, other.magic, 8) == 0) &&
+            (type_hash == other.type_hash) &&
+            (k == other.k) && (bits_per_char == other.bits_per_char) &&
+            (key_bytes == other.key_bytes) && (value_bytes == other.value_bytes) &&
+            (entry_bytes == other.entry_bytes);
+      }
+  };
+
+  namespace detail {
+    /// entries are written as raw bytes, so they cannot own memory.  Kmer and std::pair define copy operations,
+    /// so trivial destructibility is used as the check.
+    template <typename V>
+    struct is_flat : public ::std::integral_constant<bool, ::std::is_trivially_destructible<V>::value> {};
+    template <typename A, typename B>
+    struct is_flat<::std::pair<A, B> > : public ::std::integral_constant<bool,
+      is_flat<A>::value && is_flat<B>::value> {};
+
+    template <typename Key, bool = ::bliss::common::is_kmer<Key>::value>
+    struct segment_key_traits {
+        static constexpr uint32_t k = 0;
+        static constexpr uint32_t bits_per_char = 0;
+    };
+    template <typename Key>
+    struct segment_key_traits<Key, true> {
+        static constexpr uint32_t k = Key::size;
+        static constexpr uint32_t bits_per_char = Key::bitsPerChar;
+    };
+  }
+
+  /// create the header for a segment of type_name map, with entries of type std::pair<Key, T>.
+  template <typename Key, typename T>
+  map_segment_header make_map_segment_header(char const * type_name, int rank, int nranks, size_t count) {
+    map_segment_header h;
+    memset(&h, 0, sizeof(map_segment_header));
+    memcpy(h.magic, map_segment_header::magic_string(), 8);
+    h.type_hash = map_segment_header::hash_name(type_name);
+    h.k = detail::segment_key_traits<Key>::k;
+    h.bits_per_char = detail::segment_key_traits<Key>::bits_per_char;
+    h.key_bytes = sizeof(Key);
+    h.value_bytes = sizeof(T);
+    h.entry_bytes = sizeof(::std::pair<Key, T>);
+    h.rank = rank;
+    h.nranks = nranks;
+    h.count = count;
+    return h;
+  }
+
+  /// segment file name for a rank
+  inline ::std::string map_segment_filename(::std::string const & prefix, int rank) {
+    ::std::stringstream ss;
+    ss << prefix << "." << rank << ".dsc";
+    return ss.str();
+  }
+
+  /**
+   * @brief write header and count entries to filename.  overwrites existing file.
+   */
+  template <typename V>
+  void write_map_segment(::std::string const & filename, map_segment_header const & header, V const * data) {
+    static_assert(detail::is_flat<V>::value, "map segment entries need to be plain data");
+
+    int fd = open64(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+      ::std::stringstream ss;
+      ss << "ERROR: map segment: unable to open " << filename << " for write: " << strerror(errno);
+      throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+    }
+
+    char page[map_segment_header::data_offset];
+    memset(page, 0, map_segment_header::data_offset);
+    memcpy(page, &header, sizeof(map_segment_header));
+
+    // write header page then data, continuing on partial writes.
+    char const * parts[2] = {page, reinterpret_cast<char const *>(data)};
+    size_t lens[2] = {map_segment_header::data_offset, header.count * sizeof(V)};
+    for (int i = 0; i < 2; ++i) {
+      char const * ptr = parts[i];
+      size_t rem = lens[i];
+      while (rem > 0) {
+        ssize_t n = write(fd, ptr, rem);
+        if (n <= 0) {
+          int err = errno;
+          close(fd);
+          ::std::stringstream ss;
+          ss << "ERROR: map segment: write to " << filename << " failed: " << strerror(err);
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+        }
+        ptr += n;
+        rem -= n;
+      }
+    }
+    close(fd);
+  }
+
+  /**
+   * @brief  write a segment whose entries arrive in pieces, e.g. merged from several sorted sources.
+   * @details  the count is fixed up front, as it is in the header.  close throws if a different number was appended.
+   *           entries are buffered and written in large blocks.
+   */
+  template <typename V>
+  class map_segment_writer {
+    protected:
+      static constexpr size_t buffer_entries = (1UL << 20) / sizeof(V) + 1;
+
+      ::std::string filename;
+      int fd;
+      map_segment_header header;
+      ::std::vector<V> buffer;
+      size_t written;
+
+      void write_bytes(char const * ptr, size_t rem) {
+        while (rem > 0) {
+          ssize_t n = write(fd, ptr, rem);
+          if (n <= 0) {
+            int err = errno;
+            ::close(fd);
+            fd = -1;
+            ::std::stringstream ss;
+            ss << "ERROR: map segment: write to " << filename << " failed: " << strerror(err);
+            throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+          }
+          ptr += n;
+          rem -= n;
+        }
+      }
+
+      void flush() {
+        write_bytes(reinterpret_cast<char const *>(buffer.data()), buffer.size() * sizeof(V));
+        written += buffer.size();
+        buffer.clear();
+      }
+
+    public:
+      /// open filename and write the header.  overwrites existing file.
+      map_segment_writer(::std::string const & _filename, map_segment_header const & _header) :
+        filename(_filename), fd(-1), header(_header), written(0) {
+        static_assert(detail::is_flat<V>::value, "map segment entries need to be plain data");
+
+        fd = open64(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1) {
+          ::std::stringstream ss;
+          ss << "ERROR: map segment: unable to open " << filename << " for write: " << strerror(errno);
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+        }
+        char page[map_segment_header::data_offset];
+        memset(page, 0, map_segment_header::data_offset);
+        memcpy(page, &header, sizeof(map_segment_header));
+        write_bytes(page, map_segment_header::data_offset);
+        buffer.reserve(buffer_entries);
+      }
+
+      ~map_segment_writer() {
+        if (fd != -1) ::close(fd);
+      }
+
+      map_segment_writer(map_segment_writer const & other) = delete;
+      map_segment_writer & operator=(map_segment_writer const & other) = delete;
+
+      template <typename It>
+      void append(It first, It last) {
+        for (; first != last; ++first) {
+          buffer.emplace_back(*first);
+          if (buffer.size() == buffer_entries) flush();
+        }
+      }
+
+      /// entries appended so far.
+      size_t size() const {
+        return written + buffer.size();
+      }
+
+      /// write the remaining entries and close the file.
+      void close() {
+        if (fd == -1) return;
+        flush();
+        ::close(fd);
+        fd = -1;
+        if (written != header.count) {
+          ::std::stringstream ss;
+          ss << "ERROR: map segment: " << filename << " has " << written << " entries, header says " << header.count;
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+        }
+      }
+  };
+
+  /// read only header of a segment file.  returns false if file does not exist or is too short.
+  inline bool read_map_segment_header(::std::string const & filename, map_segment_header & header) {
+    int fd = open64(filename.c_str(), O_RDONLY);
+    if (fd == -1) return false;
+    bool ok = (pread(fd, &header, sizeof(map_segment_header), 0) == static_cast<ssize_t>(sizeof(map_segment_header)));
+    close(fd);
+    return ok && (memcmp(header.magic, map_segment_header::magic_string(), 8) == 0);
+  }
+
+  /**
+   * @brief  read only memory mapped segment.  entries are used in place.
+   * @tparam V  entry type, i.e. std::pair<Key, T>
+   */
+  template <typename V>
+  class mapped_map_segment {
+    protected:
+      int fd;
+      void * addr;
+      size_t bytes;
+      map_segment_header header;
+
+    public:
+      /// map the segment.  throws if the file cannot be mapped or its layout does not match expected.
+      mapped_map_segment(::std::string const & filename, map_segment_header const & expected) :
+        fd(-1), addr(MAP_FAILED), bytes(0) {
+        static_assert(detail::is_flat<V>::value, "map segment entries need to be plain data");
+
+        ::std::stringstream ss;
+        fd = open64(filename.c_str(), O_RDONLY);
+        if (fd == -1) {
+          ss << "ERROR: map segment: unable to open " << filename << ": " << strerror(errno);
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+        }
+
+        struct stat64 st;
+        if ((fstat64(fd, &st) != 0) || (static_cast<size_t>(st.st_size) < map_segment_header::data_offset) ||
+            (pread(fd, &header, sizeof(map_segment_header), 0) != static_cast<ssize_t>(sizeof(map_segment_header)))) {
+          close(fd);
+          ss << "ERROR: map segment: " << filename << " is truncated.";
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+        }
+        if (!header.compatible(expected) || (header.entry_bytes != sizeof(V))) {
+          close(fd);
+          ss << "ERROR: map segment: " << filename << " was written for a different map type (k=" << header.k <<
+              ", bits=" << header.bits_per_char << ", entry bytes=" << header.entry_bytes << ")";
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+        }
+        bytes = map_segment_header::data_offset + header.count * sizeof(V);
+        if (static_cast<size_t>(st.st_size) < bytes) {
+          close(fd);
+          ss << "ERROR: map segment: " << filename << " is truncated.";
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+        }
+
+        if (header.count > 0) {
+          addr = mmap64(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+          if (addr == MAP_FAILED) {
+            int err = errno;
+            close(fd);
+            ss << "ERROR: map segment: unable to map " << filename << ": " << strerror(err);
+            throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+          }
+          madvise(addr, bytes, MADV_SEQUENTIAL | MADV_WILLNEED);
+        }
+      }
+
+      ~mapped_map_segment() {
+        if (addr != MAP_FAILED) munmap(addr, bytes);
+        if (fd != -1) close(fd);
+      }
+
+      mapped_map_segment(mapped_map_segment const & other) = delete;
+      mapped_map_segment & operator=(mapped_map_segment const & other) = delete;
+
+      map_segment_header const & get_header() const { return header; }
+
+      /// replace the default access advice, e.g. MADV_RANDOM for point lookups.
+      void advise(int advice) const {
+        if (addr != MAP_FAILED) madvise(addr, bytes, advice);
+      }
+
+      size_t size() const { return header.count; }
+
+      V const * begin() const {
+        return (addr == MAP_FAILED) ? nullptr :
+            reinterpret_cast<V const *>(reinterpret_cast<char const *>(addr) + map_segment_header::data_offset);
+      }
+      V const * end() const {
+        return (addr == MAP_FAILED) ? nullptr : begin() + header.count;
+      }
+  };
+
+} // namespace dsc
+
+#endif // SRC_CONTAINERS_DSC_MAP_FILE_HPP_
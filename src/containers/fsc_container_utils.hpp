@@ -27,10 +27,22 @@
 
 #include <iterator>  // iterator_traits
 #include <unordered_set>
+#include <unordered_map>
 #include <algorithm>  // upper bound, unique, sort, etc.
+#include <cmath>      // log
+#include <numeric>    // accumulate
+#include <type_traits>
+#include <utility>    // declval
+#include <vector>
+
+#if defined(USE_OPENMP)
+#include <omp.h>
+#endif
 
 #include "utils/benchmark_utils.hpp"
 #include "utils/filter_utils.hpp"
+#include "utils/transform_utils.hpp"
+#include "utils/worker_pool.hpp"
 
 namespace fsc {
 
@@ -63,17 +75,309 @@ namespace fsc {
 
 
 
+  namespace detail {
+    /// true if H has a batch hash(Key const *, size_t, uint64_t *) member, as the k-mer hashes do.
+    template <typename H, typename Key>
+    struct has_batch_hash {
+        template <typename U>
+        static auto test(int) -> decltype(::std::declval<U const &>().hash(::std::declval<Key const *>(), size_t(0), ::std::declval<uint64_t *>()), ::std::true_type());
+        template <typename U>
+        static ::std::false_type test(...);
+
+        static constexpr bool value = decltype(test<H>(0))::value;
+    };
+
+    /// true if container C has a prefetch(Key const &) member, as the densehash maps do.
+    template <typename C, typename Key>
+    struct has_prefetch {
+        template <typename U>
+        static auto test(int) -> decltype(::std::declval<U const &>().prefetch(::std::declval<Key const &>()), ::std::true_type());
+        template <typename U>
+        static ::std::false_type test(...);
+
+        static constexpr bool value = decltype(test<C>(0))::value;
+    };
+
+    /// true if container C can reorder a batch of entries or keys for its insert, locality_order(first, last), as the densehash maps do.
+    template <typename C, typename Iter>
+    struct has_locality_order {
+        template <typename U>
+        static auto test(int) -> decltype(::std::declval<U const &>().locality_order(::std::declval<Iter>(), ::std::declval<Iter>()), ::std::true_type());
+        template <typename U>
+        static ::std::false_type test(...);
+
+        static constexpr bool value = decltype(test<C>(0))::value;
+    };
+
+    /// true if container C can drop erased-entry tombstones, with deleted_ratio() and compact(), as the densehash maps do.
+    template <typename C>
+    struct has_compact {
+        template <typename U>
+        static auto test(int) -> decltype(::std::declval<U const &>().deleted_ratio(), ::std::declval<U &>().compact(), ::std::true_type());
+        template <typename U>
+        static ::std::false_type test(...);
+
+        static constexpr bool value = decltype(test<C>(0))::value;
+    };
+
+    /// true if container C has equal_range_span(Key const &), i.e. stores the entries of a key contiguously, as the multimaps do.
+    template <typename C, typename Key>
+    struct has_equal_range_span {
+        template <typename U>
+        static auto test(int) -> decltype(::std::declval<U const &>().equal_range_span(::std::declval<Key const &>()), ::std::true_type());
+        template <typename U>
+        static ::std::false_type test(...);
+
+        static constexpr bool value = decltype(test<C>(0))::value;
+    };
+
+    /// true if container C has a bucket interface, bucket_count() and begin(n)/end(n), as std::unordered_map and densehash_map do.
+    template <typename C>
+    struct has_buckets {
+        template <typename U>
+        static auto test(int) -> decltype(::std::declval<U const &>().begin(::std::declval<U const &>().bucket_count()), ::std::true_type());
+        template <typename U>
+        static ::std::false_type test(...);
+
+        static constexpr bool value = decltype(test<C>(0))::value;
+    };
+
+    /// number of threads to scan n elements with:  the current worker pool's, or OpenMP's.
+    inline int scan_threads(size_t n) {
+      // small inputs are not worth the fork.
+      return (n < (1UL << 16)) ? 1 : ::bliss::concurrent::region_threads();
+    }
+
+    /// split [0, n) into nthreads parts and call f(first, last, tid) on each, in parallel.  see ::bliss::concurrent::parallel_region.
+    template <typename Func>
+    void for_each_part(size_t n, int nthreads, Func const & f) {
+      ::bliss::concurrent::parallel_region(nthreads, [n, nthreads, &f](int tid) {
+        f(n * tid / nthreads, n * (tid + 1) / nthreads, tid);
+      });
+    }
+
+    /// how a container is split among threads:  2 by bucket ranges, 1 by index ranges, 0 not at all.
+    template <typename Container>
+    struct scan_kind : public ::std::integral_constant<int,
+        has_buckets<Container>::value ? 2 :
+        (::std::is_same<typename ::std::iterator_traits<typename Container::const_iterator>::iterator_category,
+                        ::std::random_access_iterator_tag>::value ? 1 : 0)> {};
+
+    template <typename Container, typename Func>
+    void for_each_range(Container const & c, int nthreads, Func const & f, ::std::integral_constant<int, 2>) {
+      for_each_part(c.bucket_count(), nthreads, [&c, &f](size_t first, size_t last, int tid) {
+        for (size_t b = first; b < last; ++b) f(c.begin(b), c.end(b), tid);
+      });
+    }
+    template <typename Container, typename Func>
+    void for_each_range(Container const & c, int nthreads, Func const & f, ::std::integral_constant<int, 1>) {
+      for_each_part(c.size(), nthreads, [&c, &f](size_t first, size_t last, int tid) {
+        f(c.begin() + first, c.begin() + last, tid);
+      });
+    }
+    template <typename Container, typename Func>
+    void for_each_range(Container const & c, int nthreads, Func const & f, ::std::integral_constant<int, 0>) {
+      (void)nthreads;  // always 1, see range_threads
+      f(c.begin(), c.end(), 0);
+    }
+
+    /// number of threads for_each_range uses for c.
+    template <typename Container>
+    int range_threads(Container const & c) {
+      return (scan_kind<Container>::value == 0) ? 1 : scan_threads(c.size());
+    }
+
+    // range functors for for_each_range.  templated on the iterator, since bucket ranges use local iterators.
+
+    /// calls f on each entry.
+    template <typename Func>
+    struct apply_each {
+        Func const & f;
+        template <typename Iter>
+        void operator()(Iter first, Iter last, int) const {
+          for (; first != last; ++first) f(*first);
+        }
+    };
+
+    /// folds transformed entries into the thread's partial.
+    template <typename V, typename Transform, typename Reduce>
+    struct fold_each {
+        V * partials;
+        Transform const & transform;
+        Reduce const & reduce;
+        template <typename Iter>
+        void operator()(Iter first, Iter last, int tid) const {
+          V & part = partials[tid];
+          for (; first != last; ++first) part = reduce(part, transform(*first));
+        }
+    };
+
+    /// adds counts to the thread's bins.  counts at or above the last bin go into it.
+    struct histogram_each {
+        size_t * parts;
+        size_t nbins;
+        template <typename Iter>
+        void operator()(Iter first, Iter last, int tid) const {
+          size_t * bins = parts + tid * nbins;
+          for (; first != last; ++first) {
+            ++bins[::std::min(static_cast<size_t>(first->second), nbins - 1)];
+          }
+        }
+    };
+
+    /// orders (key, count) entries by count, highest first.  as heap order, the lowest count is on top.
+    struct count_greater {
+        template <typename E>
+        bool operator()(E const & x, E const & y) const {
+          return x.second > y.second;
+        }
+    };
+
+    /// keeps the k highest count entries seen by the thread in its heap.
+    template <typename E>
+    struct top_k_each {
+        ::std::vector<E> * heaps;
+        size_t k;
+        template <typename Iter>
+        void operator()(Iter first, Iter last, int tid) const {
+          ::std::vector<E> & h = heaps[tid];
+          for (; first != last; ++first) {
+            if (h.size() < k) {
+              h.emplace_back(first->first, first->second);
+              ::std::push_heap(h.begin(), h.end(), count_greater());
+            } else if (first->second > h.front().second) {
+              ::std::pop_heap(h.begin(), h.end(), count_greater());
+              h.back() = E(first->first, first->second);
+              ::std::push_heap(h.begin(), h.end(), count_greater());
+            }
+          }
+        }
+    };
+  } // namespace detail
+
+
+  /**
+   * @brief  call f(first, last, tid) on consecutive ranges of a local container, from several threads.
+   * @details  with USE_OPENMP, containers with a bucket interface (std::unordered_map, densehash_map) are split into
+   *           bucket ranges, f receiving one bucket's entries at a time, and random access containers into one index
+   *           range per thread.  tid is the thread's index, in [0, number of threads), for thread-private state.
+   *           other containers, and all containers without USE_OPENMP, are passed whole to thread 0.
+   *           f is called with the container's const_iterator or its bucket iterator, so it should be a functor with a
+   *           templated operator().  the container must not be modified meanwhile.
+   */
+  template <typename Container, typename Func>
+  void parallel_for_each_range(Container const & c, Func const & f) {
+    if (c.empty()) return;
+    detail::for_each_range(c, detail::range_threads(c), f, detail::scan_kind<Container>());
+  }
+
+  /**
+   * @brief  call f(entry) on every entry of a local container, from several threads.  see parallel_for_each_range.
+   * @note   f runs concurrently, so it must not write shared state without synchronization.  use transform_reduce for sums.
+   */
+  template <typename Container, typename Func>
+  void parallel_for_each(Container const & c, Func const & f) {
+    parallel_for_each_range(c, detail::apply_each<Func>{f});
+  }
+
+  /**
+   * @brief  reduce(identity, transform(e_1), transform(e_2), ...) over the entries of a local container, in parallel.
+   * @details  each thread folds its ranges into a private partial that starts at identity, then the partials are folded
+   *           in thread order.  reduce should be associative, and identity its identity element.
+   */
+  template <typename Container, typename V, typename Transform, typename Reduce>
+  V transform_reduce(Container const & c, V const & identity, Transform const & transform, Reduce const & reduce) {
+    if (c.empty()) return identity;
+    int n = detail::range_threads(c);
+    ::std::vector<V> partials(n, identity);
+    detail::for_each_range(c, n, detail::fold_each<V, Transform, Reduce>{partials.data(), transform, reduce},
+                           detail::scan_kind<Container>());
+
+    V result = identity;
+    for (auto const & part : partials) result = reduce(result, part);
+    return result;
+  }
+
+  /**
+   * @brief  add the count spectrum of a local (key, count) table to hist:  hist[i] is the number of entries with count i,
+   *         and the last bin takes all counts at or above it.
+   * @details  one pass over the table, split among threads by parallel_for_each_range, each filling a private histogram.
+   * @param hist  bins, at least 1.  not cleared.
+   */
+  template <typename Container>
+  void count_histogram(Container const & c, ::std::vector<size_t> & hist) {
+    if (hist.empty() || c.empty()) return;
+    size_t nbins = hist.size();
+    int n = detail::range_threads(c);
+    ::std::vector<size_t> parts(n * nbins, 0);
+    detail::for_each_range(c, n, detail::histogram_each{parts.data(), nbins}, detail::scan_kind<Container>());
+
+    for (int t = 0; t < n; ++t)
+      for (size_t i = 0; i < nbins; ++i) hist[i] += parts[t * nbins + i];
+  }
+
+  /**
+   * @brief  the k entries of a local (key, count) table with the highest counts, highest first.
+   * @details  one pass over the table, split among threads by parallel_for_each_range, each keeping a min-heap of its
+   *           k best, then a partial sort of the at most k per thread.  O(n log k).  of entries with equal counts at
+   *           the k-th place, an arbitrary subset is kept.
+   * @param result  replaced.  all entries if the table has fewer than k.
+   */
+  template <typename Container, typename Key, typename T>
+  void count_top_k(Container const & c, size_t k, ::std::vector<::std::pair<Key, T> > & result) {
+    result.clear();
+    if ((k == 0) || c.empty()) return;
+    int n = detail::range_threads(c);
+    ::std::vector<::std::vector<::std::pair<Key, T> > > heaps(n);
+    detail::for_each_range(c, n, detail::top_k_each<::std::pair<Key, T> >{heaps.data(), k}, detail::scan_kind<Container>());
+
+    result.swap(heaps[0]);
+    for (int t = 1; t < n; ++t) result.insert(result.end(), heaps[t].begin(), heaps[t].end());
+    size_t m = ::std::min(k, result.size());
+    ::std::partial_sort(result.begin(), result.begin() + m, result.end(), detail::count_greater());
+    result.resize(m);
+  }
+
+
   template <typename Key, template <typename> class Hash, template <typename> class Transform>
   struct TransformedHash {
       Hash<Key> h;
       Transform<Key> trans;
 
+    protected:
+      static constexpr size_t batch_block = 64;
+
+      inline void hash_impl(Key const * in, size_t n, uint64_t * out, ::std::false_type) const {
+        for (size_t i = 0; i < n; ++i) out[i] = h(trans(in[i]));
+      }
+      inline void hash_impl(Key const * in, size_t n, uint64_t * out, ::std::true_type) const {
+        if (::std::is_same<Transform<Key>, ::bliss::transform::identity<Key> >::value) {
+          h.hash(in, n, out);
+          return;
+        }
+        // transform a block at a time into a small buffer, then batch hash.
+        Key buf[batch_block];
+        size_t m;
+        for (size_t i = 0; i < n; i += m) {
+          m = ::std::min(batch_block, n - i);
+          ::std::copy(in + i, in + i + m, buf);
+          ::bliss::transform::transform_in_place<Transform<Key> >(buf, buf + m);
+          h.hash(buf, m, out + i);
+        }
+      }
+
+    public:
+
       TransformedHash(Hash<Key> const & _hash = Hash<Key>(),
     		  Transform<Key> const &_trans = Transform<Key>()) : h(_hash), trans(_trans) {};
 
       inline uint64_t operator()(Key const& k) const {
         return h(trans(k));
       }
+      /// batch hash, out[i] = operator()(in[i]).  uses the batch hash of Hash if it has one.
+      inline void hash(Key const * in, size_t n, uint64_t * out) const {
+        hash_impl(in, n, out, ::std::integral_constant<bool, detail::has_batch_hash<Hash<Key>, Key>::value>());
+      }
       template<typename V>
       inline uint64_t operator()(::std::pair<Key, V> const& x) const {
         return this->operator()(x.first);
@@ -83,6 +387,8 @@ namespace fsc {
         return this->operator()(x.first);
       }
   };
+  template <typename Key, template <typename> class Hash, template <typename> class Transform>
+  constexpr size_t TransformedHash<Key, Hash, Transform>::batch_block;
 
 
   template <typename Key, template <typename> class Predicate, template <typename> class Transform>
@@ -146,6 +452,42 @@ namespace fsc {
 
 
 
+  /**
+   * @brief  read-only view of a contiguous run of elements, e.g. the entries of 1 key in a multimap.  does not own them.
+   * @details  valid until the container is modified.  callers that only scan the entries of a key read them in place
+   *           instead of through a concatenating iterator or a copy.
+   */
+  template <typename V>
+  class span {
+    protected:
+      V const * first;
+      size_t n;
+
+    public:
+      using value_type = V;
+      using size_type = size_t;
+      using iterator = V const *;
+      using const_iterator = V const *;
+
+      span() : first(nullptr), n(0) {}
+      span(V const * _first, size_t _n) : first(_first), n(_n) {}
+
+      iterator begin() const { return first; }
+      iterator end() const { return first + n; }
+      V const * data() const { return first; }
+      size_type size() const { return n; }
+      bool empty() const { return n == 0; }
+      V const & operator[](size_t i) const { return first[i]; }
+  };
+
+  /// span of the vector elements [first, last).
+  template <typename Iter>
+  inline span<typename ::std::iterator_traits<Iter>::value_type> make_span(Iter first, Iter last) {
+    return span<typename ::std::iterator_traits<Iter>::value_type>((first == last) ? nullptr : &(*first),
+                                                                    ::std::distance(first, last));
+  }
+
+
   /// append to container via emplace.
   /// modified based on http://stackoverflow.com/questions/18724999/why-no-emplacement-iterators-in-c11-or-c14
   template<class Container>
@@ -170,28 +512,170 @@ namespace fsc {
       back_emplace_iterator& operator*() { return *this; }
       back_emplace_iterator& operator++() { return *this; }
       back_emplace_iterator& operator++(int) { return *this; }
+
+      /// append [first, last) with 1 range insert, e.g. a span of a multimap's entries into a send buffer.
+      template <typename Iter>
+      void append(Iter first, Iter last) {
+        container->insert(container->end(), first, last);
+      }
   };
 
+  /// write [first, last) to output and advance it.  bulk insert for back_emplace_iterator, element-wise otherwise.
+  template <typename Iter, typename OutputIter>
+  inline void append_range(Iter first, Iter last, OutputIter & output) {
+    for (; first != last; ++first, ++output) *output = *first;
+  }
+  template <typename Iter, typename Container>
+  inline void append_range(Iter first, Iter last, back_emplace_iterator<Container> & output) {
+    output.append(first, last);
+  }
+
+
+  /**
+   * @brief  read-only handle on a finalized local container, for lookups from many threads at once.
+   * @details  exposes only the const lookups and const iterators of the container, so code holding a frozen handle
+   *           cannot modify it.  the lookups of the densehash maps, std::unordered_map and sorted vectors write no
+   *           internal state, so concurrent calls on a frozen handle need no locks, as long as nothing modifies the
+   *           container through another handle meanwhile.  find, equal_range_span and prefetch are available if the
+   *           container has them.
+   */
+  template <typename Container>
+  class frozen {
+    protected:
+      Container const * c;
+
+    public:
+      using container_type = Container;
+      using key_type = typename Container::key_type;
+      using mapped_type = typename Container::mapped_type;
+      using value_type = typename Container::value_type;
+      using size_type = typename Container::size_type;
+      using const_iterator = typename Container::const_iterator;
+
+      explicit frozen(Container const & _c) : c(&_c) {}
+
+      size_type size() const { return c->size(); }
+      bool empty() const { return c->empty(); }
+
+      const_iterator begin() const { return c->cbegin(); }
+      const_iterator end() const { return c->cend(); }
+      const_iterator cbegin() const { return c->cbegin(); }
+      const_iterator cend() const { return c->cend(); }
+
+      size_type count(key_type const & key) const { return c->count(key); }
+
+      template <typename K, typename C = Container>
+      auto equal_range(K const & key) const -> decltype(::std::declval<C const &>().equal_range(key)) {
+        return c->equal_range(key);
+      }
+      template <typename K, typename C = Container>
+      auto find(K const & key) const -> decltype(::std::declval<C const &>().find(key)) {
+        return c->find(key);
+      }
+      template <typename K, typename C = Container>
+      auto equal_range_span(K const & key) const -> decltype(::std::declval<C const &>().equal_range_span(key)) {
+        return c->equal_range_span(key);
+      }
+      template <typename K, typename C = Container>
+      auto prefetch(K const & key) const -> decltype(::std::declval<C const &>().prefetch(key)) {
+        c->prefetch(key);
+      }
+
+      Container const & get() const { return *c; }
+  };
+
+  /// frozen handle on c.  c must not be modified while the handle is used for concurrent lookups.
+  template <typename Container>
+  inline frozen<Container> freeze(Container const & c) {
+    return frozen<Container>(c);
+  }
+
+
+  /**
+   * @brief  look up the queries in [first, last) from several threads, appending the results to results in query order.
+   * @details  with USE_OPENMP and a large query range, the queries are split into one contiguous part per thread, and
+   *           each thread calls lookup(db, part_first, part_last, out) with an output iterator to its own buffer.  the
+   *           buffers are then appended in thread order, so results are the same as from a single call.  lookup returns
+   *           its number of results.  db is shared by the threads, so it should be a frozen handle.
+   * @return  total number of results.
+   */
+  template <typename DB, typename QueryIter, typename Result, typename Lookup>
+  size_t parallel_lookup(DB const & db, QueryIter first, QueryIter last, ::std::vector<Result> & results,
+                         Lookup const & lookup) {
+    size_t n = ::std::distance(first, last);
+    int nthreads = detail::scan_threads(n);
+    if (nthreads == 1) {
+      back_emplace_iterator<::std::vector<Result> > out(results);
+      return lookup(db, first, last, out);
+    }
+
+    ::std::vector<::std::vector<Result> > parts(nthreads);
+    ::std::vector<size_t> counts(nthreads, 0);
+    detail::for_each_part(n, nthreads, [&](size_t b, size_t e, int tid) {
+      parts[tid].reserve(e - b);
+      back_emplace_iterator<::std::vector<Result> > out(parts[tid]);
+      counts[tid] = lookup(db, first + b, first + e, out);
+    });
+
+    size_t total = 0;
+    for (auto const & part : parts) total += part.size();
+    results.reserve(results.size() + total);
+    for (auto & part : parts) {
+      results.insert(results.end(), ::std::make_move_iterator(part.begin()), ::std::make_move_iterator(part.end()));
+    }
+    return ::std::accumulate(counts.begin(), counts.end(), static_cast<size_t>(0));
+  }
+
 
-  /// linear or logarithmic search for lowerbound.  assumes input is sorted.
+  /**
+   * @brief galloping (exponential) search for the first element of sorted [b, e) for which before(element) is false.
+   * @details probes b, b+1, b+3, b+7, ... then binary searches the last step.  O(log d) for an answer d past b, so a
+   *          stream of sorted queries, each starting from the previous answer, touches the array mostly front to back.
+   */
+  template <class Iterator, class Before>
+  inline Iterator gallop(Iterator b, Iterator e, Before before) {
+      typename ::std::iterator_traits<Iterator>::difference_type step = 1, n = ::std::distance(b, e);
+      while ((step <= n) && before(*(b + (step - 1)))) {
+        b += step;
+        n -= step;
+        step <<= 1;
+      }
+      // answer is in [b, b + min(step - 1, n)).
+      if (step - 1 < n) n = step - 1;
+      return ::std::partition_point(b, b + n, before);
+  }
+
+  /// galloping search for lowerbound from b.  same result as std::lower_bound.
+  template <class Iterator, class Less, class V>
+  inline Iterator gallop_lower_bound(Iterator b, Iterator e, V const & v, Less lt) {
+      return gallop(b, e, [&lt, &v](typename ::std::iterator_traits<Iterator>::reference x) { return lt(x, v); });
+  }
+
+  /// galloping search for upperbound from b.  same result as std::upper_bound.
+  template <class Iterator, class Less, class V>
+  inline Iterator gallop_upper_bound(Iterator b, Iterator e, V const & v, Less lt) {
+      return gallop(b, e, [&lt, &v](typename ::std::iterator_traits<Iterator>::reference x) { return !lt(v, x); });
+  }
+
+  /// linear or galloping search for lowerbound.  assumes input is sorted.
   template <bool linear, class Iterator,
     class Less = ::std::less<typename ::std::iterator_traits<Iterator>::value_type>,
     class V = typename ::std::iterator_traits<Iterator>::value_type>
   inline Iterator lower_bound(Iterator b, Iterator e, V& v, Less lt = Less()) {
       // compiler choose one.
       if (linear) while ((b != e) && lt(*b, v)) ++b;
-      else b = ::std::lower_bound(b, e, v, lt);
+      else b = ::fsc::gallop_lower_bound(b, e, v, lt);
       return b;
   }
 
-  /// linear or logarithmic search for upperbound.  assumes input is sorted.
+  /// linear or galloping search for upperbound.  assumes input is sorted.
   template <bool linear, class Iterator,
     class Less = ::std::less<typename ::std::iterator_traits<Iterator>::value_type>,
     class V = typename ::std::iterator_traits<Iterator>::value_type>
   inline Iterator upper_bound(Iterator b, Iterator e,  V& v, Less lt = Less()) {
       // compiler choose one.
       if (linear) while ((b != e) && !lt(v, *b)) ++b;
-      else b = ::std::upper_bound(b, e, v, lt);
+      else b = ::fsc::gallop_upper_bound(b, e, v, lt);
       return b;
   }
 
@@ -347,6 +831,139 @@ namespace fsc {
     sorted_input = true;
   }
 
+  /**
+   * @brief  deduplicate a query batch, and fan the answers for the unique keys back out to every query.
+   * @details  dedup hashes the keys once, keeping the first occurrence of each in input order, and records for each
+   *           query the index of its unique key.  answers come back keyed and in any order, e.g. after an all2allv,
+   *           and are matched to the unique keys through the same table.  so Hash and Eq see the keys in the form the
+   *           answers carry them, i.e. after any input transform.
+   *           read mapping batches have 30-50% duplicate k-mers, which are then sent and answered once.
+   */
+  template <typename Key, typename Hash, typename Eq>
+  class query_fanout {
+    protected:
+      /// unique key to its index in unique_keys
+      ::std::unordered_map<Key, size_t, Hash, Eq> table;
+      /// unique keys, in first occurrence order
+      ::std::vector<Key> unique_keys;
+      /// position of the first occurrence of each unique key in the batch
+      ::std::vector<size_t> firsts;
+      /// index of the unique key of each query
+      ::std::vector<size_t> slots;
+
+      /// index of the unique key equal to k.  size() if there is none.
+      size_t find_slot(Key const & k) const {
+        auto it = table.find(k);
+        return (it == table.end()) ? unique_keys.size() : it->second;
+      }
+
+    public:
+      query_fanout(Hash const & hash = Hash(), Eq const & equal = Eq()) : table(0, hash, equal) {}
+
+      /// build the table for the batch [begin, end).  returns the number of unique keys.
+      template <typename IT>
+      size_t dedup(IT begin, IT end) {
+        size_t n = ::std::distance(begin, end);
+        table.clear();
+        table.reserve(n);
+        unique_keys.clear();
+        firsts.clear();
+        slots.clear();
+        slots.reserve(n);
+
+        for (size_t i = 0; begin != end; ++begin, ++i) {
+          auto ins = table.emplace(*begin, unique_keys.size());
+          if (ins.second) {
+            unique_keys.emplace_back(*begin);
+            firsts.emplace_back(i);
+          }
+          slots.emplace_back(ins.first->second);
+        }
+        return unique_keys.size();
+      }
+
+      /// number of unique keys
+      size_t size() const { return unique_keys.size(); }
+      /// number of queries
+      size_t queries() const { return slots.size(); }
+
+      ::std::vector<Key> const & get_unique() const { return unique_keys; }
+
+      /// the first occurrence of each unique key from a batch parallel to the deduplicated one, e.g. the keys before
+      /// the input transform.
+      template <typename V>
+      ::std::vector<V> select_unique(::std::vector<V> const & batch) const {
+        ::std::vector<V> out;
+        out.reserve(firsts.size());
+        for (auto const & i : firsts) out.emplace_back(batch[i]);
+        return out;
+      }
+
+      /// one value per query, in query order, from values parallel to get_unique(), e.g. from an aligned query.
+      template <typename T>
+      ::std::vector<T> scatter_aligned(::std::vector<T> const & values) const {
+        ::std::vector<T> out;
+        out.reserve(slots.size());
+        for (auto const & j : slots) out.emplace_back(values[j]);
+        return out;
+      }
+
+      /**
+       * @brief  one answer per query, in query order.  for count-like queries that answer each key once.
+       * @param absent  value for queries whose key got no answer.
+       */
+      template <typename T>
+      ::std::vector<::std::pair<Key, T> > scatter(::std::vector<::std::pair<Key, T> > const & answers, T const & absent) const {
+        ::std::vector<T> values(unique_keys.size(), absent);
+        for (auto const & a : answers) {
+          size_t j = find_slot(a.first);
+          if (j < values.size()) values[j] = a.second;
+        }
+
+        ::std::vector<::std::pair<Key, T> > out;
+        out.reserve(slots.size());
+        for (auto const & j : slots) out.emplace_back(unique_keys[j], values[j]);
+        return out;
+      }
+
+      /**
+       * @brief  all answers of each query, in query order.  for find-like queries with 0 or more answers per key.
+       * @param offsets  answers to query i are [offsets[i], offsets[i+1]) of the output.  queries() + 1 entries.
+       */
+      template <typename T>
+      ::std::vector<::std::pair<Key, T> > scatter(::std::vector<::std::pair<Key, T> > const & answers,
+                                                  ::std::vector<size_t> & offsets) const {
+        // group the answers by unique key, keeping their order within a key.
+        ::std::vector<size_t> which(answers.size());
+        ::std::vector<size_t> starts(unique_keys.size() + 1, 0);
+        for (size_t a = 0; a < answers.size(); ++a) {
+          which[a] = find_slot(answers[a].first);
+          if (which[a] < unique_keys.size()) ++starts[which[a] + 1];
+        }
+        for (size_t j = 0; j < unique_keys.size(); ++j) starts[j + 1] += starts[j];
+
+        ::std::vector<size_t> order(starts.back());
+        {
+          ::std::vector<size_t> pos(starts.begin(), starts.end() - 1);
+          for (size_t a = 0; a < answers.size(); ++a) {
+            if (which[a] < unique_keys.size()) order[pos[which[a]]++] = a;
+          }
+        }
+
+        offsets.resize(slots.size() + 1);
+        offsets[0] = 0;
+        for (size_t i = 0; i < slots.size(); ++i) offsets[i + 1] = offsets[i] + starts[slots[i] + 1] - starts[slots[i]];
+
+        ::std::vector<::std::pair<Key, T> > out;
+        out.reserve(offsets.back());
+        for (auto const & j : slots) {
+          for (size_t o = starts[j]; o < starts[j + 1]; ++o) out.emplace_back(answers[order[o]]);
+        }
+        return out;
+      }
+  };
+
+
   /// keep the unique entries within each bucket.  complexity is b * O(N/b), where b is the bucket size, and O(N/b) is complexity of inserting into and copying from set.
   /// when used within bucket, scales with O(N/b), not with b.  this is as good as it gets wrt complexity.
   /// sortedness is MAINTAINED within buckets
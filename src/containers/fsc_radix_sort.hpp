@@ -0,0 +1,519 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    fsc_radix_sort.hpp
+ * @ingroup containers
+ * @author  tpan
+ * @brief   local sorting for sorted containers: LSD radix sort on k-mer words, and multiway merge of sorted runs.
+ * @details  a Kmer compares as one little endian integer over its words (see bit_ops::bit_less), so when the
+ *           storage comparator is plain std::less on untransformed k-mers, the order is that of a byte-wise LSD
+ *           radix sort.  bytes that are the same for all elements, such as the unused high bits, are skipped.
+ *
+ *           fsc::fast_sort chooses radix sort when radix_key<Less, V> allows it, and std::sort otherwise.
+ *           fsc::multiway_merge merges sorted runs, e.g. the per-rank blocks received after a samplesort all2allv.
+ *           both use OpenMP threads when compiled with OpenMP, and need a buffer as large as the input.
+ *
+ *           runs of at most small_sort_max elements with keys of up to 8 bytes (single word k-mers) are sorted with
+ *           a bitonic sorting network on 64 bit lanes instead (AVX-512F or AVX2, runtime dispatched as in
+ *           cpu_features.hpp), carrying the positions along and permuting the elements once at the end.  radix
+ *           sort's 256 bucket passes and std::sort's mispredicted branches both dominate at these sizes.  the
+ *           network is not stable, so the positions of equal keys are put back in order afterwards;  the result is
+ *           the same as a stable sort on every path.
+ */
+#ifndef SRC_CONTAINERS_FSC_RADIX_SORT_HPP_
+#define SRC_CONTAINERS_FSC_RADIX_SORT_HPP_
+
+#include <cstdint>
+#include <vector>
+#include <utility>      // pair
+#include <algorithm>    // sort, lower_bound
+#include <functional>   // less
+#include <type_traits>
+
+#include <cstring>      // memcpy
+#include <iterator>     // distance, make_move_iterator
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "common/kmer.hpp"
+#include "utils/transform_utils.hpp"
+#include "utils/cpu_features.hpp"
+#include "containers/fsc_container_utils.hpp"
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX512F__) || defined(BLISS_SIMD_DISPATCH_X86)
+#define BLISS_SMALL_SORT_AVX512
+#endif
+#if defined(__AVX2__) || defined(BLISS_SIMD_DISPATCH_X86)
+#define BLISS_SMALL_SORT_AVX2
+#endif
+
+namespace fsc {
+
+  namespace detail {
+
+    template <typename V, typename Key>
+    struct is_key_or_keyed_pair : public ::std::is_same<V, Key> {};
+    template <typename T, typename Key>
+    struct is_key_or_keyed_pair<::std::pair<Key, T>, Key> : public ::std::true_type {};
+
+    inline int sort_threads(size_t n) {
+#ifdef _OPENMP
+      // small inputs are not worth the fork.
+      return (n < (1UL << 16)) ? 1 : omp_get_max_threads();
+#else
+      (void)n;
+      return 1;
+#endif
+    }
+
+  } // namespace detail
+
+
+  /**
+   * @brief  maps a comparator and value type to the key bytes that order them, least significant first.
+   * @details  base template: not radix sortable.
+   */
+  template <typename Less, typename V>
+  struct radix_key {
+      static constexpr bool value = false;
+  };
+
+  /// k-mers (or k-mer keyed pairs) compared with std::less on the untransformed k-mer.
+  template <unsigned int K, typename Alphabet, typename WT, typename V>
+  struct radix_key<::fsc::TransformedComparator<::bliss::common::Kmer<K, Alphabet, WT>, ::std::less, ::bliss::transform::identity>, V> {
+      using Key = ::bliss::common::Kmer<K, Alphabet, WT>;
+
+      static constexpr bool value = (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) &&
+          detail::is_key_or_keyed_pair<V, Key>::value;
+      static constexpr size_t bytes = Key::nWords * sizeof(WT);
+
+      static inline uint8_t const * get(Key const & x) {
+        return reinterpret_cast<uint8_t const *>(x.getData());
+      }
+      template <typename T>
+      static inline uint8_t const * get(::std::pair<Key, T> const & x) {
+        return get(x.first);
+      }
+  };
+
+
+
+  /**
+   * @brief  stable LSD radix sort, 8 bits per pass.
+   * @param input   data, sorted on return.
+   * @param buffer  scratch space, resized to input size.
+   * @param get     returns pointer to the key bytes of an element, least significant first.
+   * @param nbytes  number of key bytes.
+   */
+  template <typename V, typename GetBytes>
+  void radix_sort(::std::vector<V> & input, ::std::vector<V> & buffer, GetBytes const & get, size_t nbytes) {
+    size_t n = input.size();
+    if (n < 2) return;
+    buffer.resize(n);
+
+    int nthreads = detail::sort_threads(n);
+    // hist[t * 256 + b]: count of byte value b in block t, later the scatter position.
+    ::std::vector<size_t> hist(nthreads * 256);
+
+    for (size_t byte = 0; byte < nbytes; ++byte) {
+      ::std::fill(hist.begin(), hist.end(), 0);
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+      {
+#ifdef _OPENMP
+        int tid = omp_get_thread_num();
+#else
+        int tid = 0;
+#endif
+        size_t first = n * tid / nthreads, last = n * (tid + 1) / nthreads;
+        size_t * h = hist.data() + tid * 256;
+        for (size_t i = first; i < last; ++i) ++h[get(input[i])[byte]];
+      }
+
+      // all elements have the same byte:  skip the pass.
+      uint8_t b0 = get(input[0])[byte];
+      size_t same = 0;
+      for (int t = 0; t < nthreads; ++t) same += hist[t * 256 + b0];
+      if (same == n) continue;
+
+      // exclusive prefix sum in (bucket, thread) order keeps the sort stable.
+      size_t offset = 0;
+      for (size_t b = 0; b < 256; ++b) {
+        for (int t = 0; t < nthreads; ++t) {
+          size_t c = hist[t * 256 + b];
+          hist[t * 256 + b] = offset;
+          offset += c;
+        }
+      }
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+      {
+#ifdef _OPENMP
+        int tid = omp_get_thread_num();
+#else
+        int tid = 0;
+#endif
+        size_t first = n * tid / nthreads, last = n * (tid + 1) / nthreads;
+        size_t * h = hist.data() + tid * 256;
+        for (size_t i = first; i < last; ++i) buffer[h[get(input[i])[byte]]++] = input[i];
+      }
+      input.swap(buffer);
+    }
+  }
+
+
+  /**
+   * @brief  stable merge of consecutive sorted runs.
+   * @details  the output is cut into one part per thread by splitters sampled from the runs.  each run is split at
+   *           lower_bound of the splitters, so equal elements stay in one part, and each part is merged with a heap
+   *           that breaks ties by run order.
+   * @param input  concatenated runs.  sorted on return.
+   * @param run_sizes  sizes of the runs, in order.
+   * @param buffer  scratch space, resized to input size.
+   */
+  template <typename V, typename Less>
+  void multiway_merge(::std::vector<V> & input, ::std::vector<size_t> const & run_sizes, Less const & comp,
+                      ::std::vector<V> & buffer) {
+    size_t n = input.size();
+    size_t k = run_sizes.size();
+    if ((n < 2) || (k < 2)) return;
+
+    ::std::vector<size_t> run_offsets(k + 1, 0);
+    for (size_t r = 0; r < k; ++r) run_offsets[r + 1] = run_offsets[r] + run_sizes[r];
+
+    if (k == 2) {
+      ::std::inplace_merge(input.begin(), input.begin() + run_offsets[1], input.end(), comp);
+      return;
+    }
+    buffer.resize(n);
+
+    int nparts = detail::sort_threads(n);
+
+    // splitters from regularly spaced samples of each run.
+    ::std::vector<V> samples;
+    if (nparts > 1) {
+      size_t per_run = 4 * nparts;
+      for (size_t r = 0; r < k; ++r) {
+        if (run_sizes[r] == 0) continue;
+        for (size_t s = 0; s < per_run; ++s)
+          samples.push_back(input[run_offsets[r] + run_sizes[r] * s / per_run]);
+      }
+      ::std::sort(samples.begin(), samples.end(), comp);
+    }
+
+    // bounds[p * k + r]:  start of part p in run r.
+    ::std::vector<size_t> bounds((nparts + 1) * k);
+    for (size_t r = 0; r < k; ++r) {
+      bounds[r] = run_offsets[r];
+      bounds[nparts * k + r] = run_offsets[r + 1];
+      for (int p = 1; p < nparts; ++p) {
+        V const & split = samples[samples.size() * p / nparts];
+        bounds[p * k + r] = ::std::lower_bound(input.begin() + bounds[(p - 1) * k + r], input.begin() + run_offsets[r + 1],
+                                               split, comp) - input.begin();
+      }
+    }
+    ::std::vector<size_t> out_offsets(nparts + 1, 0);
+    for (int p = 0; p < nparts; ++p) {
+      out_offsets[p + 1] = out_offsets[p];
+      for (size_t r = 0; r < k; ++r) out_offsets[p + 1] += bounds[(p + 1) * k + r] - bounds[p * k + r];
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nparts) schedule(static, 1)
+#endif
+    for (int p = 0; p < nparts; ++p) {
+      // min heap of (position, run).  later runs lose ties.
+      ::std::vector<::std::pair<size_t, size_t> > heap;
+      ::std::vector<size_t> ends(k);
+      for (size_t r = 0; r < k; ++r) {
+        ends[r] = bounds[(p + 1) * k + r];
+        if (bounds[p * k + r] < ends[r]) heap.emplace_back(bounds[p * k + r], r);
+      }
+      auto greater = [&input, &comp](::std::pair<size_t, size_t> const & x, ::std::pair<size_t, size_t> const & y) {
+        return comp(input[y.first], input[x.first]) ||
+            (!comp(input[x.first], input[y.first]) && (x.second > y.second));
+      };
+      ::std::make_heap(heap.begin(), heap.end(), greater);
+
+      size_t out = out_offsets[p];
+      while (!heap.empty()) {
+        ::std::pop_heap(heap.begin(), heap.end(), greater);
+        auto & top = heap.back();
+        buffer[out++] = input[top.first];
+        if (++top.first < ends[top.second]) ::std::push_heap(heap.begin(), heap.end(), greater);
+        else heap.pop_back();
+      }
+    }
+    input.swap(buffer);
+  }
+
+
+  /// longest run sorted with the sorting network.  a power of 2.
+  constexpr size_t small_sort_max = 256;
+
+  /// radix sortable with at most 8 key bytes, so that the key fits a 64 bit lane of the sorting network.
+  template <typename Less, typename V, bool = radix_key<Less, V>::value>
+  struct network_key : public ::std::false_type {};
+  template <typename Less, typename V>
+  struct network_key<Less, V, true> : public ::std::integral_constant<bool, (radix_key<Less, V>::bytes <= 8)> {};
+
+
+  namespace detail {
+
+    /// lanes of a vector of w lanes at position base that take the min of their compare-exchange pair in stage (k, j).
+    inline unsigned int bitonic_min_lanes(size_t base, size_t k, size_t j, size_t w) {
+      unsigned int bits = 0;
+      for (size_t l = 0; l < w; ++l) {
+        bool ascending = (((base + l) & k) == 0);
+        bool lower = ((l & j) == 0);
+        if (ascending == lower) bits |= (1U << l);
+      }
+      return bits;
+    }
+
+#if defined(BLISS_SMALL_SORT_AVX512)
+    /// bitonic sort of keys, with vals moved along.  n is a power of 2 and at least 8.
+    BLISS_TARGET("avx512f")
+    inline void bitonic_sort_avx512(uint64_t * keys, uint64_t * vals, size_t n) {
+      __m512i partners[3] = { _mm512_set_epi64(6, 7, 4, 5, 2, 3, 0, 1),
+                              _mm512_set_epi64(5, 4, 7, 6, 1, 0, 3, 2),
+                              _mm512_set_epi64(3, 2, 1, 0, 7, 6, 5, 4) };
+      for (size_t k = 2; k <= n; k <<= 1) {
+        for (size_t j = k >> 1; j > 0; j >>= 1) {
+          if (j >= 8) {
+            // pairs are in 2 vectors, all lanes in the same direction.
+            for (size_t i = 0; i < n; i += 8) {
+              if ((i & j) != 0) continue;
+              __m512i lo = _mm512_loadu_si512(keys + i), hi = _mm512_loadu_si512(keys + i + j);
+              __m512i lov = _mm512_loadu_si512(vals + i), hiv = _mm512_loadu_si512(vals + i + j);
+              __mmask8 swap = ((i & k) == 0) ? _mm512_cmpgt_epu64_mask(lo, hi) : _mm512_cmpgt_epu64_mask(hi, lo);
+              _mm512_storeu_si512(keys + i, _mm512_mask_blend_epi64(swap, lo, hi));
+              _mm512_storeu_si512(keys + i + j, _mm512_mask_blend_epi64(swap, hi, lo));
+              _mm512_storeu_si512(vals + i, _mm512_mask_blend_epi64(swap, lov, hiv));
+              _mm512_storeu_si512(vals + i + j, _mm512_mask_blend_epi64(swap, hiv, lov));
+            }
+          } else {
+            // pairs are within a vector.
+            __m512i idx = partners[(j == 1) ? 0 : ((j == 2) ? 1 : 2)];
+            __mmask8 up = static_cast<__mmask8>(bitonic_min_lanes(0, k, j, 8));
+            __mmask8 down = static_cast<__mmask8>(bitonic_min_lanes(k, k, j, 8));
+            for (size_t i = 0; i < n; i += 8) {
+              __mmask8 take_min = ((i & k) == 0) ? up : down;
+              __m512i v = _mm512_loadu_si512(keys + i), vv = _mm512_loadu_si512(vals + i);
+              __m512i p = _mm512_permutexvar_epi64(idx, v), pv = _mm512_permutexvar_epi64(idx, vv);
+              // both lanes of a pair make the same decision:  swap only if strictly out of order.
+              __mmask8 swap = _mm512_mask_cmpgt_epu64_mask(take_min, v, p) |
+                  _mm512_mask_cmpgt_epu64_mask(static_cast<__mmask8>(~take_min), p, v);
+              _mm512_storeu_si512(keys + i, _mm512_mask_blend_epi64(swap, v, p));
+              _mm512_storeu_si512(vals + i, _mm512_mask_blend_epi64(swap, vv, pv));
+            }
+          }
+        }
+      }
+    }
+#endif
+
+#if defined(BLISS_SMALL_SORT_AVX2)
+    /// lanes of bits as an AVX2 mask.
+    BLISS_TARGET("avx2")
+    inline __m256i lane_mask_avx2(unsigned int bits) {
+      return _mm256_set_epi64x(-static_cast<long long>((bits >> 3) & 1), -static_cast<long long>((bits >> 2) & 1),
+                               -static_cast<long long>((bits >> 1) & 1), -static_cast<long long>(bits & 1));
+    }
+
+    /**
+     * @brief  bitonic sort of keys, with vals moved along.  n is a power of 2 and at least 4.
+     * @details AVX2 has only a signed 64 bit compare, so the keys are compared with the sign bit flipped.
+     */
+    BLISS_TARGET("avx2")
+    inline void bitonic_sort_avx2(uint64_t * keys, uint64_t * vals, size_t n) {
+      const __m256i sign = _mm256_set1_epi64x(static_cast<long long>(0x8000000000000000ULL));
+      for (size_t i = 0; i < n; i += 4) {
+        __m256i * p = reinterpret_cast<__m256i *>(keys + i);
+        _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), sign));
+      }
+
+      for (size_t k = 2; k <= n; k <<= 1) {
+        for (size_t j = k >> 1; j > 0; j >>= 1) {
+          if (j >= 4) {
+            for (size_t i = 0; i < n; i += 4) {
+              if ((i & j) != 0) continue;
+              __m256i * kl = reinterpret_cast<__m256i *>(keys + i), * kh = reinterpret_cast<__m256i *>(keys + i + j);
+              __m256i * vl = reinterpret_cast<__m256i *>(vals + i), * vh = reinterpret_cast<__m256i *>(vals + i + j);
+              __m256i lo = _mm256_loadu_si256(kl), hi = _mm256_loadu_si256(kh);
+              __m256i lov = _mm256_loadu_si256(vl), hiv = _mm256_loadu_si256(vh);
+              __m256i swap = ((i & k) == 0) ? _mm256_cmpgt_epi64(lo, hi) : _mm256_cmpgt_epi64(hi, lo);
+              _mm256_storeu_si256(kl, _mm256_blendv_epi8(lo, hi, swap));
+              _mm256_storeu_si256(kh, _mm256_blendv_epi8(hi, lo, swap));
+              _mm256_storeu_si256(vl, _mm256_blendv_epi8(lov, hiv, swap));
+              _mm256_storeu_si256(vh, _mm256_blendv_epi8(hiv, lov, swap));
+            }
+          } else {
+            __m256i up = lane_mask_avx2(bitonic_min_lanes(0, k, j, 4));
+            __m256i down = lane_mask_avx2(bitonic_min_lanes(k, k, j, 4));
+            for (size_t i = 0; i < n; i += 4) {
+              __m256i take_min = ((i & k) == 0) ? up : down;
+              __m256i * kp = reinterpret_cast<__m256i *>(keys + i), * vp = reinterpret_cast<__m256i *>(vals + i);
+              __m256i v = _mm256_loadu_si256(kp), vv = _mm256_loadu_si256(vp);
+              __m256i p, pv;
+              if (j == 1) {
+                p = _mm256_permute4x64_epi64(v, 0xB1);
+                pv = _mm256_permute4x64_epi64(vv, 0xB1);
+              } else {
+                p = _mm256_permute4x64_epi64(v, 0x4E);
+                pv = _mm256_permute4x64_epi64(vv, 0x4E);
+              }
+              // both lanes of a pair make the same decision:  swap only if strictly out of order.
+              __m256i swap = _mm256_or_si256(_mm256_and_si256(take_min, _mm256_cmpgt_epi64(v, p)),
+                                             _mm256_andnot_si256(take_min, _mm256_cmpgt_epi64(p, v)));
+              _mm256_storeu_si256(kp, _mm256_blendv_epi8(v, p, swap));
+              _mm256_storeu_si256(vp, _mm256_blendv_epi8(vv, pv, swap));
+            }
+          }
+        }
+      }
+
+      for (size_t i = 0; i < n; i += 4) {
+        __m256i * p = reinterpret_cast<__m256i *>(keys + i);
+        _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), sign));
+      }
+    }
+#endif
+
+    /**
+     * @brief  sort keys and vals by keys with the widest network the CPU supports.  n is a power of 2, at most
+     *         small_sort_max.
+     * @return false if there is no SIMD kernel for the CPU, with keys and vals unchanged.
+     */
+    inline bool bitonic_sort(uint64_t * keys, uint64_t * vals, size_t n) {
+#if defined(BLISS_SMALL_SORT_AVX512)
+      if ((n >= 8) && ::bliss::utils::cpu::has_avx512f()) {
+        bitonic_sort_avx512(keys, vals, n);
+        return true;
+      }
+#endif
+#if defined(BLISS_SMALL_SORT_AVX2)
+      if ((n >= 4) && ::bliss::utils::cpu::has_avx2()) {
+        bitonic_sort_avx2(keys, vals, n);
+        return true;
+      }
+#endif
+      (void)keys; (void)vals; (void)n;
+      return false;
+    }
+
+    /**
+     * @brief  stable sort of a run of at most small_sort_max elements with the sorting network.
+     * @return false, with the run unchanged, if the keys do not fit the network or there is no kernel for the CPU.
+     */
+    template <typename Iter, typename Less>
+    typename ::std::enable_if<network_key<Less, typename ::std::iterator_traits<Iter>::value_type>::value, bool>::type
+    network_sort(Iter first, Iter last, Less const & comp) {
+      (void)comp;
+      using V = typename ::std::iterator_traits<Iter>::value_type;
+      using RK = radix_key<Less, V>;
+
+      size_t n = ::std::distance(first, last);
+      if (n > small_sort_max) return false;
+      if (n < 2) return true;
+
+      // pad to a power of 2 with the largest key.  the pads have the largest positions, so they stay last.
+      size_t m = 8;
+      while (m < n) m <<= 1;
+      alignas(64) uint64_t keys[small_sort_max];
+      alignas(64) uint64_t pos[small_sort_max];
+      Iter it = first;
+      for (size_t i = 0; i < n; ++i, ++it) {
+        keys[i] = 0;
+        memcpy(keys + i, RK::get(*it), RK::bytes);
+        pos[i] = i;
+      }
+      for (size_t i = n; i < m; ++i) {
+        keys[i] = ~(0ULL);
+        pos[i] = i;
+      }
+
+      if (!bitonic_sort(keys, pos, m)) return false;
+
+      // equal keys back in input order.
+      for (size_t i = 0; i < m; ) {
+        size_t e = i + 1;
+        while ((e < m) && (keys[e] == keys[i])) ++e;
+        if ((e - i) > 1) ::std::sort(pos + i, pos + e);
+        i = e;
+      }
+
+      ::std::vector<V> tmp(::std::make_move_iterator(first), ::std::make_move_iterator(last));
+      it = first;
+      for (size_t i = 0; i < n; ++i, ++it) *it = ::std::move(tmp[pos[i]]);
+      return true;
+    }
+    template <typename Iter, typename Less>
+    typename ::std::enable_if<!network_key<Less, typename ::std::iterator_traits<Iter>::value_type>::value, bool>::type
+    network_sort(Iter first, Iter last, Less const & comp) {
+      (void)first; (void)last; (void)comp;
+      return false;
+    }
+
+  } // namespace detail
+
+
+  /// sort with radix sort when the comparator allows it, else std::sort.  not stable in the latter case.
+  /// short runs of single word keys use the sorting network.
+  template <typename V, typename Less>
+  typename ::std::enable_if<radix_key<Less, V>::value>::type
+  fast_sort(::std::vector<V> & input, Less const & comp) {
+    if ((input.size() <= small_sort_max) && detail::network_sort(input.begin(), input.end(), comp)) return;
+    ::std::vector<V> buffer;
+    radix_sort(input, buffer, [](V const & x) { return radix_key<Less, V>::get(x); }, radix_key<Less, V>::bytes);
+  }
+  template <typename V, typename Less>
+  typename ::std::enable_if<!radix_key<Less, V>::value>::type
+  fast_sort(::std::vector<V> & input, Less const & comp) {
+    ::std::sort(input.begin(), input.end(), comp);
+  }
+
+  /// sort a range:  the sorting network for short runs of single word keys, else std::sort (not stable).
+  template <typename Iter, typename Less>
+  void fast_sort(Iter first, Iter last, Less const & comp) {
+    if ((static_cast<size_t>(::std::distance(first, last)) <= small_sort_max) &&
+        detail::network_sort(first, last, comp)) return;
+    ::std::sort(first, last, comp);
+  }
+
+  /// fsc::sorted_unique, sorting with fast_sort.
+  template <typename V, typename Less, typename Eq>
+  void fast_sorted_unique(::std::vector<V> & input, bool & sorted_input,
+                          const Less & less = Less(), const Eq & equal = Eq()) {
+    if (!sorted_input) fast_sort(input, less);
+    sorted_input = true;
+    ::fsc::sorted_unique(input, sorted_input, less, equal);
+  }
+
+} // namespace fsc
+
+#endif /* SRC_CONTAINERS_FSC_RADIX_SORT_HPP_ */
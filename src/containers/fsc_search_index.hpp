@@ -0,0 +1,275 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    fsc_search_index.hpp
+ * @ingroup containers
+ * @author  tpan
+ * @brief   auxiliary search tree over a large sorted array, for random point queries.
+ * @details binary search over a sorted array of n entries takes about log2(n) cache misses, as every probe lands on
+ *          a different line until the last few.  eytzinger_index keeps every B-th key of the array in Eytzinger (BFS)
+ *          order:  the children of node k are 2k and 2k+1, so the first levels share a few cache lines and the
+ *          descent is a branchless loop that can prefetch the grandchildren 4 levels ahead.  the search returns the
+ *          block of B entries that holds the lower bound, which the caller scans.
+ *
+ *          the index keeps a copy of n/B keys and their positions, and must be rebuilt when the array changes.
+ *          matches() checks the array's address and size only.
+ *
+ *          key_column keeps a copy of all the keys, so that searches over them do not load the values.
+ *
+ *          splitter_table maps the top bits of a key to the few splitters it can fall between, for key to rank lookups.
+ */
+#ifndef SRC_CONTAINERS_FSC_SEARCH_INDEX_HPP_
+#define SRC_CONTAINERS_FSC_SEARCH_INDEX_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <iterator>   // distance
+
+namespace fsc {
+
+  /**
+   * @brief  every B-th key of a sorted array, in Eytzinger order.
+   * @tparam Key  key type of the array entries, compared with the array's comparator.
+   * @tparam B    entries per block.  the caller scans at most B + 1 entries after a search.
+   */
+  template <typename Key, size_t B = 16>
+  class eytzinger_index {
+      static_assert(B > 0, "block size must be positive");
+
+    protected:
+      /// sampled keys, 1-based.  tree[0] is unused.
+      ::std::vector<Key> tree;
+      /// block number of each tree node.
+      ::std::vector<size_t> block;
+
+      void const * base;
+      size_t n;
+
+      /// fill the tree in order from the sorted samples.  returns the next sample.
+      template <typename Iter, typename GetKey>
+      size_t fill(Iter begin, GetKey const & get_key, size_t k, size_t j) {
+        if (k < tree.size()) {
+          j = fill(begin, get_key, 2 * k, j);
+          tree[k] = get_key(*(begin + j * B));
+          block[k] = j;
+          ++j;
+          j = fill(begin, get_key, 2 * k + 1, j);
+        }
+        return j;
+      }
+
+    public:
+      eytzinger_index() : base(nullptr), n(0) {}
+
+      /**
+       * @brief  build from sorted [begin, end) of a contiguous array.
+       * @param get_key  entry to key, e.g. pair.first.
+       */
+      template <typename Iter, typename GetKey>
+      void build(Iter begin, Iter end, GetKey const & get_key) {
+        n = ::std::distance(begin, end);
+        base = (n == 0) ? nullptr : static_cast<void const *>(&(*begin));
+
+        size_t m = (n + B - 1) / B;
+        tree.resize(m + 1);
+        block.resize(m + 1);
+        fill(begin, get_key, 1, 0);
+      }
+
+      void clear() {
+        ::std::vector<Key>().swap(tree);
+        ::std::vector<size_t>().swap(block);
+        base = nullptr;
+        n = 0;
+      }
+
+      /// true if built for the array at data with size entries.
+      bool matches(void const * data, size_t size) const {
+        return (size == n) && ((n == 0) || (data == base));
+      }
+
+      /// the array the index was built for.
+      void const * data() const { return base; }
+
+      /// number of sampled keys.
+      size_t size() const { return tree.empty() ? 0 : tree.size() - 1; }
+
+      /**
+       * @brief  position in the array from which the lower bound of v is at most B entries away.
+       * @details with J the first sample not less than v, the lower bound is in ((J-1) B, J B].
+       */
+      template <typename V, typename Less>
+      size_t block_begin(V const & v, Less const & lt) const {
+        size_t m = size();
+        if (m == 0) return 0;
+
+        Key const * t = tree.data();
+        size_t k = 1;
+        while (k <= m) {
+          // the 16 descendants 4 levels down are contiguous.
+          __builtin_prefetch(t + ((16 * k) < (m + 1) ? 16 * k : 0));
+          k = 2 * k + static_cast<size_t>(lt(t[k], v));
+        }
+        // undo the right turns after the last left turn.  k is then the first sample not less than v, or 0 for none.
+        k >>= __builtin_ffsll(static_cast<long long>(~k));
+
+        size_t j = (k == 0) ? m : block[k];
+        return (j == 0) ? 0 : (j - 1) * B;
+      }
+  };
+
+
+  /**
+   * @brief  the keys of a sorted array of (key, value) entries, as a separate array.
+   * @details a search over the entries loads whole entries, so the values share the cache lines that the search
+   *          touches.  over the key column each line holds only keys, and the caller reads the entries of the matches
+   *          only.  like eytzinger_index, this is a copy that must be rebuilt when the array changes.
+   */
+  template <typename Key>
+  class key_column {
+    protected:
+      ::std::vector<Key> keys;
+      void const * base;
+
+    public:
+      key_column() : base(nullptr) {}
+
+      /**
+       * @brief  copy the keys of [begin, end) of a contiguous array.
+       * @param get_key  entry to key, e.g. pair.first.
+       */
+      template <typename Iter, typename GetKey>
+      void build(Iter begin, Iter end, GetKey const & get_key) {
+        size_t n = ::std::distance(begin, end);
+        base = (n == 0) ? nullptr : static_cast<void const *>(&(*begin));
+
+        keys.resize(n);
+        Key * k = keys.data();
+        for (; begin != end; ++begin, ++k) *k = get_key(*begin);
+      }
+
+      void clear() {
+        ::std::vector<Key>().swap(keys);
+        base = nullptr;
+      }
+
+      /// true if built for the array at data with size entries.
+      bool matches(void const * data, size_t size) const {
+        return (size == keys.size()) && ((size == 0) || (data == base));
+      }
+
+      /// the array the column was built for.
+      void const * data() const { return base; }
+
+      size_t size() const { return keys.size(); }
+
+      /// key of entry i of the array at position i.
+      Key const * begin() const { return keys.data(); }
+      Key const * end() const { return keys.data() + keys.size(); }
+  };
+
+
+  /// top bits of a key, in the order of operator<.  value is false for key types without such a prefix.
+  template <typename Key, typename Enable = void>
+  struct radix_prefix : public ::std::false_type {
+      static constexpr unsigned int bits = 0;
+      static uint64_t get(Key const &, unsigned int) { return 0; }
+  };
+  /// unsigned integers.
+  template <typename Key>
+  struct radix_prefix<Key, typename ::std::enable_if<::std::is_integral<Key>::value && ::std::is_unsigned<Key>::value>::type> :
+    public ::std::true_type {
+      static constexpr unsigned int bits = sizeof(Key) * 8;
+      /// top b bits, 0 < b <= min(bits, 64).
+      static uint64_t get(Key const & x, unsigned int b) { return static_cast<uint64_t>(x >> (bits - b)); }
+  };
+  /// k-mers, whose order is that of their bits with the first character highest.
+  template <typename Key>
+  struct radix_prefix<Key, typename ::std::enable_if<(Key::nBits > 0) &&
+    ::std::is_same<decltype(::std::declval<Key const &>().getPrefix(1U)), uint64_t>::value>::type> :
+    public ::std::true_type {
+      static constexpr unsigned int bits = Key::nBits;
+      static uint64_t get(Key const & x, unsigned int b) { return x.getPrefix(b); }
+  };
+
+
+  /**
+   * @brief  direct indexed table over the top bits of a small sorted array of splitters.
+   * @details upper_bound over p splitters takes log2(p) dependent, unpredictable compares.  for each value h of the
+   *          top bits, first[h] is the number of splitters whose prefix is below h, so the splitters that compare with
+   *          a key of prefix h are in [first[h], first[h + 1]), usually 0 to 2 of them.  with 2^bits about 64 x p
+   *          cells, the table takes 4 x 64 x p bytes, capped at 2^20 cells.
+   *
+   *          prefixes are taken after trans, the transform of the splitters' comparator, so the comparator must order
+   *          the transformed keys as operator<.
+   */
+  template <typename Key>
+  class splitter_table {
+    protected:
+      ::std::vector<uint32_t> first;
+      unsigned int bits;
+
+    public:
+      static constexpr unsigned int min_bits = 8;
+      static constexpr unsigned int max_bits = 20;
+
+      splitter_table() : bits(0) {}
+
+      /// build from sorted [begin, end).  get_key:  entry to key, e.g. pair.first.
+      template <typename Iter, typename GetKey, typename Trans>
+      void build(Iter begin, Iter end, GetKey const & get_key, Trans const & trans) {
+        static_assert(radix_prefix<Key>::value, "splitter table needs a key type with a radix prefix");
+        size_t n = ::std::distance(begin, end);
+
+        bits = min_bits;
+        while ((bits < max_bits) && ((static_cast<size_t>(1) << bits) < 64 * n)) ++bits;
+        unsigned int const key_bits = radix_prefix<Key>::bits;
+        bits = ::std::min(bits, ::std::min(key_bits, 64U));
+
+        size_t cells = static_cast<size_t>(1) << bits;
+        first.assign(cells + 1, static_cast<uint32_t>(n));
+        size_t h = 0;
+        uint32_t i = 0;
+        for (Iter it = begin; it != end; ++it, ++i) {
+          size_t ph = radix_prefix<Key>::get(trans(get_key(*it)), bits);
+          for (; h <= ph; ++h) first[h] = i;
+        }
+      }
+
+      void clear() {
+        ::std::vector<uint32_t>().swap(first);
+        bits = 0;
+      }
+
+      bool empty() const { return first.empty(); }
+
+      unsigned int get_bits() const { return bits; }
+
+      /// [lo, hi) of the splitters with the same prefix as the transformed key tx.  upper_bound of tx is in [lo, hi].
+      inline ::std::pair<uint32_t, uint32_t> range(Key const & tx) const {
+        size_t h = radix_prefix<Key>::get(tx, bits);
+        return ::std::make_pair(first[h], first[h + 1]);
+      }
+  };
+
+} // namespace fsc
+
+#endif // SRC_CONTAINERS_FSC_SEARCH_INDEX_HPP_
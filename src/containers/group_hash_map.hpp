@@ -0,0 +1,691 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    group_hash_map.hpp
+ * @ingroup containers
+ * @author  tpan
+ * @brief   open addressing hash map with a control byte per slot, probed a group of slots at a time.
+ * @details layout follows the SwissTable design:  a control byte array is kept alongside the slot array.
+ *          a control byte is either empty, deleted, or the low 7 bits of the hash (h2) of the key in the slot.
+ *          the table is probed in groups of group::width slots.  all control bytes of a group are compared against h2
+ *          at once (AVX2 32 slot groups, SSE2 16 slot groups, or a scalar fallback), and only matching slots
+ *          have their keys compared.  probing stops at the first group with an empty slot.
+ *
+ *          since empty and deleted states live in the control bytes, no key values are reserved.  for k-mers that span
+ *          the entire key space this avoids the lower/upper split tables of densehash_map.
+ *
+ *          the template parameters are the same as densehash_map, so it can be used as the local container of
+ *          dsc::densehash_map_base.  SpecialKeys and split are accepted but not needed; SpecialKeys is only used to
+ *          construct Equal when Equal requires the special keys (e.g. ::fsc::sparsehash::compare).
+ */
+#ifndef SRC_CONTAINERS_GROUP_HASH_MAP_HPP_
+#define SRC_CONTAINERS_GROUP_HASH_MAP_HPP_
+
+#include <vector>
+#include <functional>  // hash, equal_to, etc
+#include <utility>     // pair
+#include <memory>      // allocator
+#include <iterator>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+#include <limits>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <x86intrin.h>
+#endif
+
+#include "containers/fsc_container_utils.hpp"
+#include "utils/transform_utils.hpp"
+
+namespace fsc {  // fast standard container
+
+  namespace group_hash {
+
+    /// control byte for an empty slot.  full slots have the high bit clear.
+    constexpr int8_t ctrl_empty = -128;   // 0x80
+    /// control byte for a deleted slot.
+    constexpr int8_t ctrl_deleted = -2;   // 0xFE
+
+    /// compare the control bytes of a group.  bit i of the returned mask corresponds to slot i.
+    struct group {
+#if defined(__AVX2__)
+        static constexpr size_t width = 32;
+
+        static inline uint32_t match(int8_t const * ctrl, int8_t h2) {
+          __m256i c = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(ctrl));
+          return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(h2))));
+        }
+        /// empty or deleted, i.e. high bit set.
+        static inline uint32_t match_free(int8_t const * ctrl) {
+          return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(ctrl))));
+        }
+#elif defined(__SSE2__)
+        static constexpr size_t width = 16;
+
+        static inline uint32_t match(int8_t const * ctrl, int8_t h2) {
+          __m128i c = _mm_loadu_si128(reinterpret_cast<__m128i const *>(ctrl));
+          return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8(h2))));
+        }
+        static inline uint32_t match_free(int8_t const * ctrl) {
+          return static_cast<uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(ctrl))));
+        }
+#else
+        static constexpr size_t width = 16;
+
+        static inline uint32_t match(int8_t const * ctrl, int8_t h2) {
+          uint32_t m = 0;
+          for (size_t i = 0; i < width; ++i) m |= static_cast<uint32_t>(ctrl[i] == h2) << i;
+          return m;
+        }
+        static inline uint32_t match_free(int8_t const * ctrl) {
+          uint32_t m = 0;
+          for (size_t i = 0; i < width; ++i) m |= static_cast<uint32_t>(ctrl[i] < 0) << i;
+          return m;
+        }
+#endif
+        static inline uint32_t match_empty(int8_t const * ctrl) {
+          return match(ctrl, ctrl_empty);
+        }
+    };
+
+    /// index of lowest set bit.  m is not 0.
+    inline size_t lowest(uint32_t m) {
+      return __builtin_ctz(m);
+    }
+
+  } // namespace group_hash
+
+
+/**
+ * @brief  open addressing hash map with SIMD probed control bytes.  interface follows ::fsc::densehash_map.
+ * @details  maximum load factor is 7/8, counting deleted slots.  the table grows by doubling, or is rehashed in place
+ *           when mostly deleted.  iterators are invalidated by insertion that triggers rehash, but not by erase.
+ */
+template <typename Key,
+typename T,
+typename SpecialKeys = void,   // not needed.  see file description.
+template<typename> class Transform = ::bliss::transform::identity,
+typename Hash =  ::fsc::TransformedHash<Key, ::std::hash, Transform>,
+typename Equal = ::fsc::TransformedComparator<Key, ::std::equal_to, Transform>,
+typename Allocator = ::std::allocator<::std::pair<const Key, T> >,
+bool split = false >
+class group_hash_map {
+
+  public:
+    using key_type              = Key;
+    using mapped_type           = T;
+    using value_type            = ::std::pair<const Key, T>;
+    using hasher                = Hash;
+    using key_equal             = Equal;
+    using allocator_type        = Allocator;
+    using reference             = value_type&;
+    using const_reference       = const value_type&;
+    using pointer               = typename std::allocator_traits<Allocator>::pointer;
+    using const_pointer         = typename std::allocator_traits<Allocator>::const_pointer;
+    using size_type             = size_t;
+    using difference_type       = ptrdiff_t;
+
+  protected:
+    using group = ::fsc::group_hash::group;
+    using slot_allocator = typename ::std::allocator_traits<Allocator>::template rebind_alloc<value_type>;
+    using slot_alloc_traits = ::std::allocator_traits<slot_allocator>;
+
+    static constexpr size_t npos = ::std::numeric_limits<size_t>::max();
+
+    /// iterator over full slots.
+    template <typename V>
+    class iter_base : public ::std::iterator<::std::forward_iterator_tag, V> {
+        friend class group_hash_map;
+        template <typename> friend class iter_base;
+
+        int8_t const * c;
+        int8_t const * c_end;
+        V * s;
+
+        void skip() {
+          while ((c != c_end) && (*c < 0)) { ++c; ++s; }
+        }
+
+        iter_base(int8_t const * _c, int8_t const * _c_end, V * _s, bool to_full = true) : c(_c), c_end(_c_end), s(_s) {
+          if (to_full) skip();
+        }
+
+      public:
+        iter_base() : c(nullptr), c_end(nullptr), s(nullptr) {}
+
+        /// convert iterator to const_iterator
+        template <typename V2, typename = typename ::std::enable_if<::std::is_convertible<V2 *, V *>::value>::type>
+        iter_base(iter_base<V2> const & other) : c(other.c), c_end(other.c_end), s(other.s) {}
+
+        V & operator*() const { return *s; }
+        V * operator->() const { return s; }
+
+        iter_base & operator++() {
+          ++c; ++s;
+          skip();
+          return *this;
+        }
+        iter_base operator++(int) {
+          iter_base out(*this);
+          ++(*this);
+          return out;
+        }
+
+        template <typename V2>
+        bool operator==(iter_base<V2> const & other) const { return c == other.c; }
+        template <typename V2>
+        bool operator!=(iter_base<V2> const & other) const { return c != other.c; }
+    };
+
+  public:
+    using iterator              = iter_base<value_type>;
+    using const_iterator        = iter_base<value_type const>;
+
+  protected:
+    /// control bytes, one per slot
+    ::std::vector<int8_t> ctrl;
+    /// slots.  only slots with full control bytes are constructed.
+    value_type * slots;
+    /// number of slots.  power of 2, and multiple of group::width
+    size_t capacity;
+    /// number of entries
+    size_t entries;
+    /// number of empty slots that can be filled before rehash.
+    size_t growth_left;
+
+    Hash hash;
+    Equal eq;
+    slot_allocator alloc;
+
+    // ======== construction of Equal, with the special keys if it needs them.
+    template <typename S, typename E>
+    static typename ::std::enable_if<!::std::is_void<S>::value && ::std::is_constructible<E, Key const &, Key const &>::value, E>::type
+    make_equal() {
+      S specials;
+      return E(specials.generate(0), specials.generate(1));
+    }
+    template <typename S, typename E>
+    static typename ::std::enable_if<::std::is_void<S>::value || !::std::is_constructible<E, Key const &, Key const &>::value, E>::type
+    make_equal() {
+      return E();
+    }
+
+    /// number of slots for n entries
+    static size_t capacity_for(size_t const n) {
+      size_t needed = n + n / 7 + 1;   // n <= 7/8 capacity
+      size_t cap = group::width;
+      while (cap < needed) cap <<= 1;
+      return cap;
+    }
+
+    static size_t max_fill(size_t const cap) {
+      return cap - cap / 8;
+    }
+
+    inline size_t group_mask() const {
+      return (capacity / group::width) - 1;
+    }
+
+    static inline int8_t h2(size_t const h) {
+      return static_cast<int8_t>(h & 0x7F);
+    }
+
+    /// position of key, or npos
+    size_t find_pos(Key const & key) const {
+      size_t h = hash(key);
+      int8_t tag = h2(h);
+      size_t mask = group_mask();
+      size_t g = (h >> 7) & mask;
+
+      for (size_t i = 1; ; ++i) {
+        int8_t const * gc = ctrl.data() + g * group::width;
+        for (uint32_t m = group::match(gc, tag); m != 0; m &= (m - 1)) {
+          size_t pos = g * group::width + ::fsc::group_hash::lowest(m);
+          if (eq(slots[pos].first, key)) return pos;
+        }
+        if (group::match_empty(gc) != 0) return npos;
+        g = (g + i) & mask;   // triangular probing over groups.  visits all groups since group count is power of 2.
+      }
+      return npos;
+    }
+
+    /// first free slot for hash value h.
+    size_t find_free(size_t const h) const {
+      size_t mask = group_mask();
+      size_t g = (h >> 7) & mask;
+
+      for (size_t i = 1; ; ++i) {
+        uint32_t m = group::match_free(ctrl.data() + g * group::width);
+        if (m != 0) return g * group::width + ::fsc::group_hash::lowest(m);
+        g = (g + i) & mask;
+      }
+      return npos;
+    }
+
+    /// allocate an empty table of cap slots.
+    void allocate(size_t const cap) {
+      capacity = cap;
+      ctrl.assign(cap, ::fsc::group_hash::ctrl_empty);
+      slots = slot_alloc_traits::allocate(alloc, cap);
+      entries = 0;
+      growth_left = max_fill(cap);
+    }
+
+    void destroy_all() {
+      if (!::std::is_trivially_destructible<value_type>::value) {
+        for (size_t i = 0; i < capacity; ++i) {
+          if (ctrl[i] >= 0) slot_alloc_traits::destroy(alloc, slots + i);
+        }
+      }
+    }
+
+    void deallocate() {
+      if (slots != nullptr) {
+        destroy_all();
+        slot_alloc_traits::deallocate(alloc, slots, capacity);
+        slots = nullptr;
+      }
+    }
+
+    /// move all entries to a new table of new_cap slots.
+    void rehash_to(size_t const new_cap) {
+      ::std::vector<int8_t> old_ctrl;
+      old_ctrl.swap(ctrl);
+      value_type * old_slots = slots;
+      size_t old_cap = capacity;
+      size_t old_count = entries;
+
+      allocate(new_cap);
+
+      for (size_t i = 0; i < old_cap; ++i) {
+        if (old_ctrl[i] < 0) continue;
+
+        size_t h = hash(old_slots[i].first);
+        size_t pos = find_free(h);
+        ctrl[pos] = h2(h);
+        slot_alloc_traits::construct(alloc, slots + pos, ::std::move(old_slots[i]));
+        slot_alloc_traits::destroy(alloc, old_slots + i);
+      }
+      entries = old_count;
+      growth_left = max_fill(new_cap) - entries;
+
+      slot_alloc_traits::deallocate(alloc, old_slots, old_cap);
+    }
+
+    /// make room for one more entry: grow, or clean up deleted slots if they make up much of the table.
+    void rehash_for_insert() {
+      if (entries * 2 < max_fill(capacity)) rehash_to(capacity);
+      else rehash_to(capacity * 2);
+    }
+
+    /// find key, or the slot to insert it into (second is true).  may rehash.
+    ::std::pair<size_t, bool> find_or_prepare_insert(Key const & key) {
+      size_t h = hash(key);
+      int8_t tag = h2(h);
+      size_t mask = group_mask();
+      size_t g = (h >> 7) & mask;
+      size_t target = npos;
+
+      for (size_t i = 1; ; ++i) {
+        int8_t const * gc = ctrl.data() + g * group::width;
+        for (uint32_t m = group::match(gc, tag); m != 0; m &= (m - 1)) {
+          size_t pos = g * group::width + ::fsc::group_hash::lowest(m);
+          if (eq(slots[pos].first, key)) return ::std::make_pair(pos, false);
+        }
+        if (target == npos) {
+          uint32_t m = group::match_free(gc);
+          if (m != 0) target = g * group::width + ::fsc::group_hash::lowest(m);
+        }
+        if (group::match_empty(gc) != 0) break;
+        g = (g + i) & mask;
+      }
+
+      // reusing a deleted slot does not use up growth.
+      if ((ctrl[target] == ::fsc::group_hash::ctrl_empty) && (growth_left == 0)) {
+        rehash_for_insert();
+        target = find_free(h);
+      }
+      if (ctrl[target] == ::fsc::group_hash::ctrl_empty) --growth_left;
+      ctrl[target] = tag;
+      return ::std::make_pair(target, true);
+    }
+
+    template <typename V>
+    ::std::pair<iterator, bool> insert_impl(V const & x) {
+      ::std::pair<size_t, bool> pos = find_or_prepare_insert(x.first);
+      if (pos.second) {
+        slot_alloc_traits::construct(alloc, slots + pos.first, x);
+        ++entries;
+      }
+      return ::std::make_pair(make_iter(pos.first), pos.second);
+    }
+
+    void erase_pos(size_t const pos) {
+      slot_alloc_traits::destroy(alloc, slots + pos);
+      --entries;
+
+      // if the group has an empty slot, probes already stop at this group, so the slot can be marked empty.
+      if (group::match_empty(ctrl.data() + (pos & ~(group::width - 1))) != 0) {
+        ctrl[pos] = ::fsc::group_hash::ctrl_empty;
+        ++growth_left;
+      } else {
+        ctrl[pos] = ::fsc::group_hash::ctrl_deleted;
+      }
+    }
+
+    inline iterator make_iter(size_t const pos) {
+      return iterator(ctrl.data() + pos, ctrl.data() + capacity, slots + pos, false);
+    }
+    inline const_iterator make_iter(size_t const pos) const {
+      return const_iterator(ctrl.data() + pos, ctrl.data() + capacity, slots + pos, false);
+    }
+    inline size_t pos_of(const_iterator const & it) const {
+      return it.c - ctrl.data();
+    }
+
+  public:
+
+    group_hash_map(size_type bucket_count = 128) :
+      slots(nullptr), capacity(0), entries(0), growth_left(0),
+      hash(), eq(make_equal<SpecialKeys, Equal>()), alloc() {
+      allocate(capacity_for(bucket_count));
+    };
+
+    template<class InputIt>
+    group_hash_map(InputIt first, InputIt last) :
+      group_hash_map(std::distance(first, last)) {
+      this->insert(first, last);
+    };
+
+    group_hash_map(group_hash_map const & other) :
+      slots(nullptr), capacity(0), entries(0), growth_left(0),
+      hash(other.hash), eq(other.eq), alloc(other.alloc) {
+      allocate(other.capacity);
+      for (size_t i = 0; i < capacity; ++i) {
+        if (other.ctrl[i] < 0) continue;
+        slot_alloc_traits::construct(alloc, slots + i, other.slots[i]);
+      }
+      ctrl = other.ctrl;
+      entries = other.entries;
+      growth_left = other.growth_left;
+    }
+
+    group_hash_map(group_hash_map && other) :
+      ctrl(::std::move(other.ctrl)), slots(other.slots), capacity(other.capacity), entries(other.entries),
+      growth_left(other.growth_left), hash(other.hash), eq(other.eq), alloc(other.alloc) {
+      other.slots = nullptr;
+      other.allocate(group::width);
+    }
+
+    group_hash_map & operator=(group_hash_map other) {
+      this->swap(other);
+      return *this;
+    }
+
+    void swap(group_hash_map & other) {
+      ctrl.swap(other.ctrl);
+      ::std::swap(slots, other.slots);
+      ::std::swap(capacity, other.capacity);
+      ::std::swap(entries, other.entries);
+      ::std::swap(growth_left, other.growth_left);
+      ::std::swap(hash, other.hash);
+      ::std::swap(eq, other.eq);
+      ::std::swap(alloc, other.alloc);
+    }
+
+    virtual ~group_hash_map() {
+      deallocate();
+    };
+
+    float get_max_load_factor() const {
+      return 0.875f;
+    }
+
+    iterator begin() {
+      return iterator(ctrl.data(), ctrl.data() + capacity, slots);
+    }
+    const_iterator begin() const {
+      return cbegin();
+    }
+    const_iterator cbegin() const {
+      return const_iterator(ctrl.data(), ctrl.data() + capacity, slots);
+    }
+
+    iterator end() {
+      return make_iter(capacity);
+    }
+    const_iterator end() const {
+      return cend();
+    }
+    const_iterator cend() const {
+      return make_iter(capacity);
+    }
+
+
+    std::vector<Key> keys() const {
+      std::vector<Key> ks;
+      keys(ks);
+      return ks;
+    }
+    void keys(std::vector<Key> & ks) const {
+      ks.clear();
+      ks.reserve(size());
+
+      for (auto it = cbegin(); it != cend(); ++it) {
+        ks.emplace_back(it->first);
+      }
+    }
+
+    std::vector<std::pair<Key, T> > to_vector() const {
+      std::vector<std::pair<Key, T> > vs;
+      to_vector(vs);
+      return vs;
+    }
+    void to_vector(  std::vector<std::pair<Key, T> > & vs) const {
+      vs.clear();
+      vs.reserve(size());
+
+      for (auto it = cbegin(); it != cend(); ++it) {
+        vs.emplace_back(*it);
+      }
+    }
+
+
+    bool empty() const {
+      return entries == 0;
+    }
+
+    size_type size() const {
+      return entries;
+    }
+    size_type unique_size() const {
+      return entries;
+    }
+
+    /// clear and release memory.
+    void reset() {
+      deallocate();
+      allocate(capacity_for(128));
+    }
+
+    /// clear without changing capacity.
+    void clear() {
+      destroy_all();
+      ::std::fill(ctrl.begin(), ctrl.end(), ::fsc::group_hash::ctrl_empty);
+      entries = 0;
+      growth_left = max_fill(capacity);
+    }
+
+    /// reserve space for n entries.  shrinks if n and current size fit in a smaller table.
+    void resize(size_t const n) {
+      size_t cap = capacity_for(::std::max(n, entries));
+      if (cap != capacity) rehash_to(cap);
+    }
+
+    /// rehash for new count number of BUCKETS.  iterators are invalidated.
+    void rehash(size_type n) {
+      this->resize(n);
+    }
+
+    /// bucket count, i.e. slots
+    size_type bucket_count() const {
+      return capacity;
+    }
+
+    float load_factor() const {
+      return static_cast<float>(entries) / static_cast<float>(capacity);
+    }
+
+
+    template <class InputIt>
+    void insert(InputIt first, InputIt last) {
+      for (; first != last; ++first) {
+        insert_impl(*first);
+      }
+    }
+
+    void insert(::std::vector<::std::pair<Key, T> > & input) {
+      insert(input.begin(), input.end());
+    }
+
+    void insert(::std::vector<value_type > & input) {
+      insert(input.begin(), input.end());
+    }
+
+    template <typename K = Key, typename = typename std::enable_if<!std::is_const<Key>::value> >
+    std::pair<iterator, bool> insert(::std::pair<Key, T> const & x) {
+      return insert_impl(x);
+    }
+
+    std::pair<iterator, bool> insert(::std::pair<const Key, T> const & x) {
+      return insert_impl(x);
+    }
+
+    template <typename V, typename Updater>
+    size_t update(::std::vector<::std::pair<Key, V> > & input, Updater const & op) {
+      size_t cnt = 0;
+      for (auto vv : input) {
+        size_t pos = find_pos(vv.first);
+        if (pos == npos) continue;
+
+        cnt += op(slots[pos].second, vv.second);
+      }
+      return cnt;
+    }
+
+    template <typename Filter, typename Updater>
+    size_t update(Filter const & fop, Updater const & op) {
+      size_t cnt = 0;
+      for (auto iter = begin(); iter != end(); ++iter) {
+        if (fop(*iter)) {
+          cnt += op((*iter).second);
+        }
+      }
+      return cnt;
+    }
+
+
+    template <typename InputIt, typename Pred>
+    size_t erase(InputIt first, InputIt last, Pred const & pred) {
+      static_assert(::std::is_convertible<Key, typename ::std::iterator_traits<InputIt>::value_type>::value,
+                    "InputIt value type for erase cannot be converted to key type");
+
+      size_t before = entries;
+      for (; first != last; ++first) {
+        size_t pos = find_pos(*first);
+        if ((pos != npos) && pred(slots[pos])) erase_pos(pos);
+      }
+      return before - entries;
+    }
+
+    template <typename InputIt>
+    size_t erase(InputIt first, InputIt last) {
+      static_assert(::std::is_convertible<Key, typename ::std::iterator_traits<InputIt>::value_type>::value,
+                    "InputIt value type for erase cannot be converted to key type");
+
+      size_t before = entries;
+      for (; first != last; ++first) {
+        size_t pos = find_pos(*first);
+        if (pos != npos) erase_pos(pos);
+      }
+      return before - entries;
+    }
+
+    template <typename Pred>
+    size_t erase(Pred const & pred) {
+      size_t before = entries;
+      for (size_t i = 0; i < capacity; ++i) {
+        if ((ctrl[i] >= 0) && pred(slots[i])) erase_pos(i);
+      }
+      return before - entries;
+    }
+
+    /// erase the entry at iterator.
+    void erase(const_iterator const & it) {
+      erase_pos(pos_of(it));
+    }
+
+    size_type count(Key const & key) const {
+      return (find_pos(key) == npos) ? 0 : 1;
+    }
+
+
+    ::std::pair<iterator, iterator> equal_range(Key const & key) {
+      size_t pos = find_pos(key);
+      if (pos == npos) return ::std::make_pair(end(), end());
+      iterator it = make_iter(pos);
+      iterator next = it;
+      ++next;
+      return ::std::make_pair(it, next);
+    }
+    ::std::pair<const_iterator, const_iterator> equal_range(Key const & key) const {
+      size_t pos = find_pos(key);
+      if (pos == npos) return ::std::make_pair(cend(), cend());
+      const_iterator it = make_iter(pos);
+      const_iterator next = it;
+      ++next;
+      return ::std::make_pair(it, next);
+    }
+
+    iterator find(Key const &key) {
+      size_t pos = find_pos(key);
+      return (pos == npos) ? end() : make_iter(pos);
+    }
+
+    const_iterator find(Key const &key) const {
+      size_t pos = find_pos(key);
+      return (pos == npos) ? cend() : make_iter(pos);
+    }
+
+    inline bool exists(Key const & key) const {
+      return find_pos(key) != npos;
+    }
+
+    /// prefetch the control bytes and the first slot of the home group of key, for batched lookups and inserts.
+    inline void prefetch(Key const & key) const {
+      if (slots == nullptr) return;
+      size_t g = (hash(key) >> 7) & group_mask();
+      __builtin_prefetch(ctrl.data() + g * group::width, 0, 1);
+      __builtin_prefetch(slots + g * group::width, 0, 1);
+    }
+
+};
+
+} // namespace fsc
+
+#endif // SRC_CONTAINERS_GROUP_HASH_MAP_HPP_
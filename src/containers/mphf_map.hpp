@@ -0,0 +1,331 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mphf_map.hpp
+ * @ingroup fsc::containers
+ * @author  tpan
+ * @brief   read-only map from a minimal perfect hash function, without stored keys.
+ * @details a densehash_map keeps every key, and at its load factor has at least as many empty slots as full ones.
+ *          for a finished index that is never inserted into again, mphf_map keeps instead:
+ *
+ *      a minimal perfect hash function (BBHash).  level l is a bit array of about gamma * (keys left) bits.  each key
+ *          left sets the bit at hash_l(key).  keys whose bit no other key set are placed, and the rest go to level l + 1.
+ *          the index of a key is the rank of its bit among all levels.  with gamma 1, about 3 bits per key, plus 1/8
+ *          for the rank samples.  the few keys left after the last level are kept with their keys in a sorted fallback.
+ *      a fingerprint of fingerprint_bits per key, from hash bits the function does not use.  a key that was not in the
+ *          map is reported found with probability 2^-fingerprint_bits.  with 0 bits, absent keys are not detected.
+ *      values, bit packed to the width of the largest value if T is an unsigned integer, e.g. counts.  plain otherwise.
+ *
+ *          the map is built once from all (key, value) pairs and cannot be changed.  keys must be distinct.
+ */
+#ifndef SRC_CONTAINERS_MPHF_MAP_HPP_
+#define SRC_CONTAINERS_MPHF_MAP_HPP_
+
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>   // equal_to
+#include <type_traits>
+
+#include "utils/sketch_utils.hpp"   // mix64
+
+namespace fsc {  // fast standard container
+
+  /// fixed width unsigned integers packed in 64 bit words, with random access.
+  class packed_vector {
+    protected:
+      ::std::vector<uint64_t> words;
+      size_t n;
+      unsigned int width;
+      uint64_t mask;
+
+    public:
+      packed_vector(size_t const & _n = 0, unsigned int const & _width = 0) :
+        words((_n * _width + 63) / 64 + 1, 0), n(_n), width(_width),
+        mask((_width >= 64) ? ~(0ULL) : ((1ULL << _width) - 1)) {}
+
+      /// bits needed to store v.
+      static unsigned int bits_for(uint64_t const & v) {
+        return (v == 0) ? 0 : (64 - __builtin_clzll(v));
+      }
+
+      size_t size() const { return n; }
+      unsigned int bits() const { return width; }
+      size_t bytes() const { return words.size() * sizeof(uint64_t); }
+
+      /// set element i, which is 0 so far.
+      inline void set(size_t const & i, uint64_t const & v) {
+        if (width == 0) return;
+        size_t pos = i * width;
+        size_t w = pos >> 6;
+        unsigned int o = pos & 63;
+        words[w] |= (v & mask) << o;
+        if ((o + width) > 64) words[w + 1] |= (v & mask) >> (64 - o);
+      }
+
+      inline uint64_t get(size_t const & i) const {
+        if (width == 0) return 0;
+        size_t pos = i * width;
+        size_t w = pos >> 6;
+        unsigned int o = pos & 63;
+        uint64_t x = words[w] >> o;
+        if ((o + width) > 64) x |= words[w + 1] << (64 - o);
+        return x & mask;
+      }
+  };
+
+  /// bit vector with a rank sample every 512 bits.
+  class rank_bitvector {
+    protected:
+      ::std::vector<uint64_t> words;
+      /// ones before each 8 word block.
+      ::std::vector<uint64_t> samples;
+
+    public:
+      /// append nbits bits, a multiple of 64.
+      void append(::std::vector<uint64_t> const & bits) {
+        words.insert(words.end(), bits.begin(), bits.end());
+      }
+
+      /// call after the last append.
+      void build_rank() {
+        samples.assign((words.size() + 7) / 8 + 1, 0);
+        uint64_t ones = 0;
+        for (size_t i = 0; i < words.size(); ++i) {
+          if ((i & 7) == 0) samples[i >> 3] = ones;
+          ones += __builtin_popcountll(words[i]);
+        }
+        samples.back() = ones;
+      }
+
+      size_t size() const { return words.size() * 64; }
+      size_t bytes() const { return (words.size() + samples.size()) * sizeof(uint64_t); }
+
+      inline bool test(size_t const & i) const {
+        return (words[i >> 6] >> (i & 63)) & 1;
+      }
+
+      /// number of ones before bit i.
+      inline size_t rank(size_t const & i) const {
+        size_t w = i >> 6;
+        size_t r = samples[w >> 3];
+        for (size_t j = w & ~(static_cast<size_t>(7)); j < w; ++j) r += __builtin_popcountll(words[j]);
+        uint64_t below = (i & 63) ? (words[w] << (64 - (i & 63))) : 0;
+        return r + __builtin_popcountll(below);
+      }
+  };
+
+
+  namespace detail {
+
+    /// values bit packed to the width of the largest one.
+    template <typename T, bool packable = ::std::is_integral<T>::value && ::std::is_unsigned<T>::value>
+    class mphf_values {
+        packed_vector v;
+      public:
+        void init(::std::vector<T> const & max_of, size_t const & n) {
+          T mx = max_of.empty() ? 0 : *(::std::max_element(max_of.begin(), max_of.end()));
+          v = packed_vector(n, packed_vector::bits_for(static_cast<uint64_t>(mx)));
+        }
+        inline void set(size_t const & i, T const & x) { v.set(i, static_cast<uint64_t>(x)); }
+        inline T get(size_t const & i) const { return static_cast<T>(v.get(i)); }
+        size_t bytes() const { return v.bytes(); }
+    };
+
+    /// values stored as is.
+    template <typename T>
+    class mphf_values<T, false> {
+        ::std::vector<T> v;
+      public:
+        void init(::std::vector<T> const &, size_t const & n) { v.assign(n, T()); }
+        inline void set(size_t const & i, T const & x) { v[i] = x; }
+        inline T get(size_t const & i) const { return v[i]; }
+        size_t bytes() const { return v.size() * sizeof(T); }
+    };
+
+  } // namespace detail
+
+
+  /**
+   * @brief read-only map on a minimal perfect hash function.  see file comment.
+   * @tparam Hash   64 bit hash of Key, e.g. the storage hash of the map this is built from.
+   * @tparam Equal  used only for the fallback keys.
+   */
+  template <typename Key, typename T, typename Hash, typename Equal = ::std::equal_to<Key> >
+  class mphf_map {
+    public:
+      using key_type = Key;
+      using mapped_type = T;
+      using value_type = ::std::pair<Key, T>;
+
+      /// levels before the remaining keys go to the fallback.
+      static constexpr unsigned int max_levels = 32;
+
+    protected:
+      Hash hasher;
+      Equal eq;
+
+      size_t n;
+      /// first bit of each level in bits, and the end.
+      ::std::vector<size_t> level_starts;
+      rank_bitvector bits;
+
+      unsigned int fp_bits;
+      packed_vector fps;
+      detail::mphf_values<T> values;
+
+      /// keys not placed in any level, sorted by hash.
+      ::std::vector<::std::pair<uint64_t, value_type> > fallback;
+
+      inline uint64_t key_hash(Key const & k) const {
+        return ::bliss::utils::sketch::mix64(static_cast<uint64_t>(hasher(k)));
+      }
+      static inline uint64_t level_hash(uint64_t const & h, unsigned int const & l) {
+        return ::bliss::utils::sketch::mix64(h ^ ((l + 1) * 0x9E3779B97F4A7C15ULL));
+      }
+      inline uint64_t fingerprint(uint64_t const & h) const {
+        return (fp_bits == 0) ? 0 : (::bliss::utils::sketch::mix64(h + 0x632BE59BD9B4E019ULL) >> (64 - fp_bits));
+      }
+
+      /// slot of key hash h in the function, or n if it is not placed in a level.
+      inline size_t lookup(uint64_t const & h) const {
+        for (size_t l = 0; (l + 1) < level_starts.size(); ++l) {
+          size_t m = level_starts[l + 1] - level_starts[l];
+          size_t p = level_starts[l] + level_hash(h, l) % m;
+          if (bits.test(p)) return bits.rank(p);
+        }
+        return n;
+      }
+
+    public:
+      /**
+       * @brief build from distinct (key, value) pairs.
+       * @param gamma  bits per key in each level.  larger is faster to build and query, at gamma * e bits per key.
+       */
+      mphf_map(::std::vector<value_type> const & entries, unsigned int const & fingerprint_bits = 16,
+               double const & gamma = 1.0, Hash const & _hasher = Hash(), Equal const & _eq = Equal()) :
+        hasher(_hasher), eq(_eq), n(0), fp_bits(::std::min(fingerprint_bits, 64U)) {
+
+        ::std::vector<uint64_t> hashes(entries.size());
+        for (size_t i = 0; i < entries.size(); ++i) hashes[i] = key_hash(entries[i].first);
+
+        // (entry, bit) of the placed keys.
+        ::std::vector<::std::pair<size_t, size_t> > placed;
+        placed.reserve(entries.size());
+
+        ::std::vector<size_t> left(entries.size());
+        for (size_t i = 0; i < left.size(); ++i) left[i] = i;
+        ::std::vector<size_t> next;
+        ::std::vector<uint64_t> hit, collide;
+
+        level_starts.emplace_back(0);
+        for (unsigned int l = 0; (l < max_levels) && !left.empty(); ++l) {
+          size_t m = ::std::max(static_cast<size_t>(64), static_cast<size_t>(gamma * left.size()));
+          m = (m + 63) & ~(static_cast<size_t>(63));
+          hit.assign(m / 64, 0);
+          collide.assign(m / 64, 0);
+
+          for (size_t i : left) {
+            size_t p = level_hash(hashes[i], l) % m;
+            uint64_t b = 1ULL << (p & 63);
+            if (hit[p >> 6] & b) collide[p >> 6] |= b;
+            else hit[p >> 6] |= b;
+          }
+          for (size_t w = 0; w < hit.size(); ++w) hit[w] &= ~collide[w];
+
+          next.clear();
+          for (size_t i : left) {
+            size_t p = level_hash(hashes[i], l) % m;
+            if ((hit[p >> 6] >> (p & 63)) & 1) placed.emplace_back(i, level_starts.back() + p);
+            else next.emplace_back(i);
+          }
+          left.swap(next);
+
+          bits.append(hit);
+          level_starts.emplace_back(level_starts.back() + m);
+        }
+        bits.build_rank();
+
+        n = placed.size();
+        fps = packed_vector(n, fp_bits);
+        ::std::vector<T> vals;
+        vals.reserve(entries.size());
+        for (auto const & x : entries) vals.emplace_back(x.second);
+        values.init(vals, n);
+
+        for (auto const & x : placed) {
+          size_t idx = bits.rank(x.second);
+          fps.set(idx, fingerprint(hashes[x.first]));
+          values.set(idx, entries[x.first].second);
+        }
+
+        for (size_t i : left) fallback.emplace_back(hashes[i], entries[i]);
+        ::std::sort(fallback.begin(), fallback.end(),
+                    [](::std::pair<uint64_t, value_type> const & a, ::std::pair<uint64_t, value_type> const & b) {
+          return a.first < b.first;
+        });
+      }
+
+      /// number of keys.
+      size_t size() const {
+        return n + fallback.size();
+      }
+
+      /// value of key.  false if absent, or with probability 2^-fingerprint_bits, true for an absent key.
+      bool find(Key const & k, T & value) const {
+        uint64_t h = key_hash(k);
+        size_t idx = lookup(h);
+        if (idx < n) {
+          if (fps.get(idx) != fingerprint(h)) return false;
+          value = values.get(idx);
+          return true;
+        }
+
+        auto it = ::std::lower_bound(fallback.begin(), fallback.end(), h,
+                                     [](::std::pair<uint64_t, value_type> const & a, uint64_t const & b) {
+          return a.first < b;
+        });
+        for (; (it != fallback.end()) && (it->first == h); ++it) {
+          if (eq(it->second.first, k)) {
+            value = it->second.second;
+            return true;
+          }
+        }
+        return false;
+      }
+
+      size_t count(Key const & k) const {
+        T v;
+        return find(k, v) ? 1 : 0;
+      }
+
+      /// bits per key of the hash function, including rank samples.
+      double hash_bits_per_key() const {
+        return (size() == 0) ? 0.0 : (static_cast<double>(bits.bytes()) * 8.0 / static_cast<double>(size()));
+      }
+
+      /// total memory, excluding the object itself.
+      size_t bytes() const {
+        return bits.bytes() + fps.bytes() + values.bytes() +
+            level_starts.size() * sizeof(size_t) + fallback.size() * sizeof(::std::pair<uint64_t, value_type>);
+      }
+  };
+
+} // namespace fsc
+
+#endif /* SRC_CONTAINERS_MPHF_MAP_HPP_ */
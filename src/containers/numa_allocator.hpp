@@ -0,0 +1,196 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    numa_allocator.hpp
+ * @ingroup fsc::data_structures
+ * @author  tpan
+ * @brief   allocator that places large allocations across NUMA nodes before they are first touched.
+ * @details a local table (e.g. the bucket array of densehash_map) is filled with the empty key on one thread when it is
+ *          allocated or resized.  with default first touch placement the whole table then lands on that thread's node,
+ *          and threads on the other socket pay remote latency on every probe.  numa_allocator fixes the placement
+ *          at allocation time, before the container's own fill:
+ *
+ *      INTERLEAVE      mbind MPOL_INTERLEAVE over the nodes this process may use.  pages alternate between nodes.
+ *      PARALLEL_TOUCH  the pages are touched by all OpenMP threads, each a contiguous block of pages, so each block is on
+ *                      the node of its thread.  without USE_OPENMP this is the same as LOCAL.
+ *      LOCAL           default placement, same as Base.
+ *      LOCAL_NODE      mbind MPOL_PREFERRED to the node of the allocating thread, so later touches from other nodes do not
+ *                      move it.  for a rank's local map when the rank is pinned to one node (see utils/topology.hpp).
+ *
+ *          only allocations of at least NUMA_THRESHOLD bytes are placed.  placement is a hint:  mbind failures (no
+ *          NUMA, ENOSYS, EPERM) are ignored, and memory that the Base allocator recycles is already faulted and
+ *          stays where it is.
+ *
+ *          use as the Alloc parameter of the dsc maps or of densehash_map, e.g.
+ *          numa_allocator<::std::pair<const Key, T>, numa::INTERLEAVE>.
+ */
+#ifndef SRC_CONTAINERS_NUMA_ALLOCATOR_HPP_
+#define SRC_CONTAINERS_NUMA_ALLOCATOR_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <unistd.h>           // sysconf
+#include <sys/syscall.h>      // __NR_mbind, __NR_get_mempolicy
+#include <linux/mempolicy.h>  // MPOL_INTERLEAVE
+
+#if defined(USE_OPENMP)
+#include <omp.h>
+#endif
+
+namespace fsc {  // fast standard container
+
+  namespace numa {
+
+    enum placement { LOCAL = 0, INTERLEAVE = 1, PARALLEL_TOUCH = 2, LOCAL_NODE = 3 };
+
+    /// allocations smaller than this are not placed.
+    static constexpr size_t NUMA_THRESHOLD = 4UL << 20;
+
+    /// page aligned interior of [p, p + bytes).  empty if first >= last.
+    inline void page_range(void const * p, size_t const & bytes, size_t & first, size_t & last) {
+      size_t page_size = sysconf(_SC_PAGE_SIZE);
+      first = (reinterpret_cast<size_t>(p) + page_size - 1) & ~(page_size - 1);
+      last = (reinterpret_cast<size_t>(p) + bytes) & ~(page_size - 1);
+    }
+
+    /// interleave the pages of [p, p + bytes) over the nodes the process may allocate from.  returns true on success.
+    inline bool interleave(void const * p, size_t const & bytes) {
+#if defined(__NR_mbind) && defined(__NR_get_mempolicy)
+      size_t first, last;
+      page_range(p, bytes, first, last);
+      if (first >= last) return false;
+
+      static constexpr unsigned long MAX_NODES = 1024;
+      unsigned long mask[MAX_NODES / (sizeof(unsigned long) * 8)] = {0};
+      int mode = 0;
+      if (syscall(__NR_get_mempolicy, &mode, mask, MAX_NODES, nullptr, MPOL_F_MEMS_ALLOWED) != 0) return false;
+
+      // a single node:  nothing to interleave.
+      int nodes = 0;
+      for (auto m : mask) nodes += __builtin_popcountl(m);
+      if (nodes < 2) return false;
+
+      return syscall(__NR_mbind, reinterpret_cast<void*>(first), last - first, MPOL_INTERLEAVE,
+                     mask, MAX_NODES, 0) == 0;
+#else
+      return false;
+#endif
+    }
+
+    /// prefer the calling thread's node for the pages of [p, p + bytes).  returns true on success.
+    inline bool prefer_local(void const * p, size_t const & bytes) {
+#if defined(__NR_mbind) && defined(__NR_getcpu)
+      size_t first, last;
+      page_range(p, bytes, first, last);
+      if (first >= last) return false;
+
+      unsigned int cpu = 0, node = 0;
+      if (syscall(__NR_getcpu, &cpu, &node, nullptr) != 0) return false;
+
+      static constexpr unsigned long MAX_NODES = 1024;
+      static constexpr unsigned long BITS = sizeof(unsigned long) * 8;
+      if (node >= MAX_NODES) return false;
+      unsigned long mask[MAX_NODES / BITS] = {0};
+      mask[node / BITS] = 1UL << (node % BITS);
+
+      return syscall(__NR_mbind, reinterpret_cast<void*>(first), last - first, MPOL_PREFERRED,
+                     mask, MAX_NODES, 0) == 0;
+#else
+      return false;
+#endif
+    }
+
+    /// first touch the pages of [p, p + bytes), each thread a contiguous block.  returns number of threads used.
+    inline int parallel_touch(void * p, size_t const & bytes) {
+      size_t first, last;
+      page_range(p, bytes, first, last);
+      if (first >= last) return 0;
+
+#if defined(USE_OPENMP)
+      int nthreads = omp_get_max_threads();
+      if (nthreads < 2) return 1;
+
+      size_t page_size = sysconf(_SC_PAGE_SIZE);
+      int64_t npages = (last - first) / page_size;
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+      for (int64_t i = 0; i < npages; ++i) {
+        *(reinterpret_cast<volatile char *>(first + i * page_size)) = 0;
+      }
+      return nthreads;
+#else
+      return 1;
+#endif
+    }
+
+  }  // namespace numa
+
+
+  /**
+   * @brief allocator adapter that applies a NUMA placement to large allocations of Base.
+   * @tparam Placement  one of numa::placement.
+   */
+  template <typename T, int Placement = numa::INTERLEAVE, typename Base = ::std::allocator<T> >
+  class numa_allocator : public Base {
+    public:
+      using value_type = T;
+      using pointer = T*;
+      using const_pointer = T const *;
+      using reference = T&;
+      using const_reference = T const &;
+      using size_type = size_t;
+      using difference_type = ::std::ptrdiff_t;
+
+      template <typename U>
+      struct rebind {
+          using other = numa_allocator<U, Placement, typename ::std::allocator_traits<Base>::template rebind_alloc<U> >;
+      };
+
+      numa_allocator() noexcept : Base() {}
+      numa_allocator(Base const & b) noexcept : Base(b) {}
+      template <typename U, typename B2>
+      numa_allocator(numa_allocator<U, Placement, B2> const & other) noexcept : Base(static_cast<B2 const &>(other)) {}
+
+      T * allocate(size_t n) {
+        T * p = ::std::allocator_traits<Base>::allocate(*this, n);
+        size_t bytes = n * sizeof(T);
+        if (bytes >= numa::NUMA_THRESHOLD) {
+          if (Placement == numa::INTERLEAVE) numa::interleave(p, bytes);
+          else if (Placement == numa::PARALLEL_TOUCH) numa::parallel_touch(p, bytes);
+          else if (Placement == numa::LOCAL_NODE) numa::prefer_local(p, bytes);
+        }
+        return p;
+      }
+
+      void deallocate(T * p, size_t n) {
+        ::std::allocator_traits<Base>::deallocate(*this, p, n);
+      }
+  };
+
+  template <typename T, typename U, int P, typename B1, typename B2>
+  bool operator==(numa_allocator<T, P, B1> const & x, numa_allocator<U, P, B2> const & y) {
+    return static_cast<B1 const &>(x) == static_cast<B2 const &>(y);
+  }
+  template <typename T, typename U, int P, typename B1, typename B2>
+  bool operator!=(numa_allocator<T, P, B1> const & x, numa_allocator<U, P, B2> const & y) {
+    return !(x == y);
+  }
+
+}  // namespace fsc
+
+#endif /* SRC_CONTAINERS_NUMA_ALLOCATOR_HPP_ */
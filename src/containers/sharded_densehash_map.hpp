@@ -0,0 +1,559 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    sharded_densehash_map.hpp
+ * @ingroup fsc::containers
+ * @author  tpan
+ * @brief   densehash_map partitioned into independent sub-tables so that a batch insert can run on multiple threads.
+ * @details each element goes to shard (mixed hash >> (64 - shard_bits)), i.e. the high bits of the hash.  the
+ *          shards' own bucket index uses the low bits, so the two do not collide.
+ *
+ *          batch insert/update of a vector computes the shard ids in parallel, then each OpenMP thread owns
+ *          a subset of the shards and inserts only the elements that map to them.  no locks are needed since
+ *          no two threads touch the same shard.  without USE_OPENMP, or with 1 shard, this is the same as densehash_map.
+ *
+ *          intended use is hybrid MPI+OpenMP:  fewer ranks per node (smaller all2all) while keeping local insert parallel.
+ */
+#ifndef SHARDED_DENSEHASH_MAP_HPP_
+#define SHARDED_DENSEHASH_MAP_HPP_
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+
+#if defined(USE_OPENMP)
+#include <omp.h>
+#endif
+
+#include "containers/densehash_map.hpp"
+#include "containers/fsc_container_utils.hpp"
+#include "iterators/concatenating_iterator.hpp"
+
+namespace fsc {  // fast standard container
+
+/**
+ * @brief densehash_map split into power-of-2 number of shards by high hash bits.
+ * @details  template parameters are the same as densehash_map's, so this can be used as the Container of
+ *           dsc::densehash_map_base.   the number of shards defaults to omp_get_max_threads(), rounded up to power of 2.
+ *
+ *           begin() and find() use ConcatenatingIterator over the shards.  equal_range returns the shard's range.
+ */
+template <typename Key,
+typename T,
+typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
+template<typename> class Transform = ::bliss::transform::identity,
+typename Hash =  ::fsc::TransformedHash<Key, ::std::hash, Transform>,
+typename Equal = ::fsc::sparsehash::compare<Key, ::std::equal_to, Transform>,
+typename Allocator = ::std::allocator<::std::pair<const Key, T> >,
+bool split = SpecialKeys::need_to_split >
+class sharded_densehash_map {
+
+  protected:
+    using shard_type = ::fsc::densehash_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, split>;
+
+    using shard_iterator = typename shard_type::iterator;
+    using shard_const_iterator = typename shard_type::const_iterator;
+
+    ::std::vector<shard_type> shards;
+
+    Hash hash;
+
+    /// log2 of number of shards.
+    uint8_t shard_bits;
+
+    /// number of threads for batch operations.
+    int nthreads;
+
+    /// fibonacci hashing on top of Hash, so that hashes with weak or zero high bits (e.g. identity) still spread across shards.
+    inline size_t shard_of(Key const & k) const {
+      return (shard_bits == 0) ? 0 :
+          static_cast<size_t>((static_cast<uint64_t>(hash(k)) * 0x9E3779B97F4A7C15ULL) >> (64 - shard_bits));
+    }
+
+    /// compute shard id for each input element, in parallel.
+    template <typename V>
+    void assign_shards(::std::vector<V> const & input, ::std::vector<uint16_t> & ids) const {
+      ids.resize(input.size());
+      int64_t n = input.size();
+
+#if defined(USE_OPENMP)
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+#endif
+      for (int64_t i = 0; i < n; ++i) {
+        ids[i] = shard_of(input[i].first);
+      }
+    }
+
+  public:
+    using key_type              = Key;
+    using mapped_type           = T;
+    using value_type            = ::std::pair<const Key, T>;
+    using hasher                = Hash;
+    using key_equal             = Equal;
+    using allocator_type        = Allocator;
+    using reference             = value_type&;
+    using const_reference       = const value_type&;
+    using pointer               = typename std::allocator_traits<Allocator>::pointer;
+    using const_pointer         = typename std::allocator_traits<Allocator>::const_pointer;
+    using iterator              = ::bliss::iterator::ConcatenatingIterator<shard_iterator >;
+    using const_iterator        = ::bliss::iterator::ConcatenatingIterator<shard_const_iterator >;
+    using size_type             = size_t;
+    using difference_type       = ptrdiff_t;
+
+    /**
+     * @param bucket_count   total number of buckets, divided across the shards.
+     * @param num_shards     number of shards.  rounded up to power of 2, max 2^16.  0 means number of OpenMP threads.
+     */
+    sharded_densehash_map(size_type bucket_count = 128, int num_shards = 0) : hash(), shard_bits(0), nthreads(1) {
+#if defined(USE_OPENMP)
+      nthreads = omp_get_max_threads();
+#endif
+      if (num_shards <= 0) num_shards = nthreads;
+      num_shards = ::std::min(num_shards, 1 << 16);
+      while ((1 << shard_bits) < num_shards) ++shard_bits;
+
+      size_t nshards = 1ULL << shard_bits;
+      shards.reserve(nshards);
+      for (size_t i = 0; i < nshards; ++i) {
+        shards.emplace_back();
+      }
+      // size the bucket arrays in parallel.
+      if (bucket_count > 128 * nshards) this->resize(bucket_count);
+    };
+
+    template<class InputIt, typename = typename ::std::enable_if<!::std::is_integral<InputIt>::value>::type>
+    sharded_densehash_map(InputIt first, InputIt last) :
+      sharded_densehash_map(std::distance(first, last)) {
+      this->insert(first, last);
+    };
+
+    virtual ~sharded_densehash_map() {};
+
+    /// number of shards.
+    size_t get_num_shards() const {
+      return shards.size();
+    }
+
+    /// number of threads used for batch insert, update, and erase.
+    int get_num_threads() const {
+      return nthreads;
+    }
+    void set_num_threads(int n) {
+      nthreads = (n < 1) ? 1 : n;
+    }
+
+    /// access a shard, e.g. for per-thread traversal.
+    shard_type & get_shard(size_t i) {
+      return shards[i];
+    }
+    shard_type const & get_shard(size_t i) const {
+      return shards[i];
+    }
+
+    float get_max_load_factor() const {
+      return shards[0].get_max_load_factor();
+    }
+
+    iterator begin() {
+      if (empty()) return end();
+
+      ::std::vector<::std::pair<shard_iterator, shard_iterator> > ranges;
+      for (size_t i = 0; i < shards.size(); ++i) {
+        ranges.emplace_back(shards[i].begin(), shards[i].end());
+      }
+      return iterator(::std::move(ranges));
+    }
+    const_iterator begin() const {
+      return cbegin();
+    }
+    const_iterator cbegin() const {
+      if (empty()) return cend();
+
+      ::std::vector<::std::pair<shard_const_iterator, shard_const_iterator> > ranges;
+      for (size_t i = 0; i < shards.size(); ++i) {
+        ranges.emplace_back(shards[i].cbegin(), shards[i].cend());
+      }
+      return const_iterator(::std::move(ranges));
+    }
+
+    iterator end() {
+      return iterator(shards.back().end());
+    }
+    const_iterator end() const {
+      return cend();
+    }
+    const_iterator cend() const {
+      return const_iterator(shards.back().cend());
+    }
+
+
+    std::vector<Key> keys() const {
+      std::vector<Key> ks;
+
+      keys(ks);
+
+      return ks;
+    }
+    void keys(std::vector<Key> & ks) const {
+      ks.clear();
+      ks.reserve(size());
+
+      for (size_t i = 0; i < shards.size(); ++i) {
+        for (auto it = shards[i].cbegin(); it != shards[i].cend(); ++it) {
+          ks.emplace_back((*it).first);
+        }
+      }
+    }
+
+    std::vector<std::pair<Key, T> > to_vector() const {
+      std::vector<std::pair<Key, T> > vs;
+
+      to_vector(vs);
+
+      return vs;
+    }
+    void to_vector(std::vector<std::pair<Key, T> > & vs) const {
+      vs.clear();
+      vs.reserve(size());
+
+      for (size_t i = 0; i < shards.size(); ++i) {
+        for (auto it = shards[i].cbegin(); it != shards[i].cend(); ++it) {
+          vs.emplace_back(*it);
+        }
+      }
+    }
+
+
+    bool empty() const {
+      for (size_t i = 0; i < shards.size(); ++i) {
+        if (!shards[i].empty()) return false;
+      }
+      return true;
+    }
+
+    size_type size() const {
+      size_type s = 0;
+      for (size_t i = 0; i < shards.size(); ++i) {
+        s += shards[i].size();
+      }
+      return s;
+    }
+    size_type unique_size() const {
+      return size();
+    }
+
+    void reset() {
+      for (size_t i = 0; i < shards.size(); ++i) {
+        shards[i].reset();
+      }
+    }
+
+    void clear() {
+      for (size_t i = 0; i < shards.size(); ++i) {
+        shards[i].clear();
+      }
+    }
+
+    /// resize all shards.  shards are resized in parallel, so their bucket arrays are first touched by different
+    /// threads and spread over the NUMA nodes instead of all landing on the calling thread's node.
+    void resize(size_t const n) {
+      size_t per_shard = (n + shards.size() - 1) / shards.size();
+      int64_t nshards = shards.size();
+#if defined(USE_OPENMP)
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+#endif
+      for (int64_t i = 0; i < nshards; ++i) {
+        shards[i].resize(per_shard);
+      }
+    }
+
+    /// rehash for new count number of BUCKETS.  iterators are invalidated.
+    void rehash(size_type count) {
+      this->resize(count);
+    }
+
+    /// bucket count.  sum of shards' buckets
+    size_type bucket_count() {
+      size_type s = 0;
+      for (size_t i = 0; i < shards.size(); ++i) {
+        s += shards[i].bucket_count();
+      }
+      return s;
+    }
+
+    float load_factor() {
+      return static_cast<float>(size()) / static_cast<float>(bucket_count());
+    }
+
+
+    /// sequential insert.
+    template <class InputIt>
+    void insert(InputIt first, InputIt last) {
+      for (auto it = first; it != last; ++it) {
+        static_cast<void>(this->insert(*it));
+      }
+    }
+
+    /// batch insert.  shards are filled in parallel, each by one thread.
+    template <typename K>
+    void insert(::std::vector<::std::pair<K, T> > & input) {
+      if (input.size() == 0) return;
+
+      if (shards.size() == 1) {
+        shards[0].insert(input.begin(), input.end());
+        return;
+      }
+
+      ::std::vector<uint16_t> ids;
+      assign_shards(input, ids);
+
+      int64_t nshards = shards.size();
+      size_t n = input.size();
+
+#if defined(USE_OPENMP)
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1)
+#endif
+      for (int64_t s = 0; s < nshards; ++s) {
+        shard_type & shard = shards[s];
+        for (size_t i = 0; i < n; ++i) {
+          if (ids[i] == s) static_cast<void>(shard.insert(input[i]));
+        }
+      }
+    }
+
+    /**
+     * @brief batch insert, reducing values of duplicate keys with r:  existing = r(existing, new).
+     * @details for reduction and counting maps.  shards are filled in parallel, each by one thread.
+     * @return number of new entries.
+     */
+    template <typename K, typename Reduc>
+    size_t insert_reduce(::std::vector<::std::pair<K, T> > & input, Reduc const & r) {
+      if (input.size() == 0) return 0;
+
+      size_t before = size();
+
+      ::std::vector<uint16_t> ids;
+      if (shards.size() > 1) assign_shards(input, ids);
+      else ids.assign(input.size(), 0);
+
+      int64_t nshards = shards.size();
+      size_t n = input.size();
+
+#if defined(USE_OPENMP)
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1)
+#endif
+      for (int64_t s = 0; s < nshards; ++s) {
+        shard_type & shard = shards[s];
+        for (size_t i = 0; i < n; ++i) {
+          if (ids[i] != s) continue;
+
+          auto result = shard.insert(input[i]);
+          if (!(result.second)) {
+            // already there, so reduce
+            result.first->second = r(result.first->second, input[i].second);
+          }
+        }
+      }
+
+      return size() - before;
+    }
+
+    template <typename K = Key, typename = typename std::enable_if<!std::is_const<Key>::value> >
+    auto insert(::std::pair<Key, T> const & x) -> decltype(::std::declval<shard_type &>().insert(x)) {
+      return shards[shard_of(x.first)].insert(x);
+    }
+
+    auto insert(::std::pair<const Key, T> const & x) -> decltype(::std::declval<shard_type &>().insert(x)) {
+      return shards[shard_of(x.first)].insert(x);
+    }
+
+    /// batch update.  shards are updated in parallel, each by one thread.
+    template <typename V, typename Updater>
+    size_t update(::std::vector<::std::pair<Key, V> > & input, Updater const & op) {
+      if (input.size() == 0) return 0;
+
+      if (shards.size() == 1) return shards[0].update(input, op);
+
+      ::std::vector<uint16_t> ids;
+      assign_shards(input, ids);
+
+      int64_t nshards = shards.size();
+      size_t n = input.size();
+      size_t count = 0;
+
+#if defined(USE_OPENMP)
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1) reduction(+:count)
+#endif
+      for (int64_t s = 0; s < nshards; ++s) {
+        shard_type & shard = shards[s];
+        for (size_t i = 0; i < n; ++i) {
+          if (ids[i] != s) continue;
+
+          auto range = shard.equal_range(input[i].first);
+          if (range.first == range.second) continue;
+
+          // update the entry
+          count += op((*(range.first)).second, input[i].second);
+        }
+      }
+
+      return count;
+    }
+
+    // non distributed version
+    template <typename Filter, typename Updater>
+    size_t update(Filter const & fop, Updater const & op) {
+      size_t count = 0;
+      for (size_t i = 0; i < shards.size(); ++i) {
+        count += shards[i].update(fop, op);
+      }
+      return count;
+    }
+
+
+    template <typename InputIt, typename Pred>
+    size_t erase(InputIt first, InputIt last, Pred const & pred) {
+      static_assert(::std::is_convertible<Key, typename ::std::iterator_traits<InputIt>::value_type>::value,
+                    "InputIt value type for erase cannot be converted to key type");
+
+      size_t count = 0;
+      for (; first != last; ++first) {
+        Key k = *first;
+        count += shards[shard_of(k)].erase(&k, &k + 1, pred);
+      }
+      return count;
+    }
+
+    template <typename InputIt>
+    size_t erase(InputIt first, InputIt last) {
+      static_assert(::std::is_convertible<Key, typename ::std::iterator_traits<InputIt>::value_type>::value,
+                    "InputIt value type for erase cannot be converted to key type");
+
+      size_t count = 0;
+      for (; first != last; ++first) {
+        Key k = *first;
+        count += shards[shard_of(k)].erase(&k, &k + 1);
+      }
+      return count;
+    }
+
+    template <typename Pred>
+    size_t erase(Pred const & pred) {
+      int64_t nshards = shards.size();
+      size_t count = 0;
+
+#if defined(USE_OPENMP)
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1) reduction(+:count)
+#endif
+      for (int64_t s = 0; s < nshards; ++s) {
+        count += shards[s].erase(pred);
+      }
+      return count;
+    }
+
+    /// largest fraction of deleted-key tombstones among the shards.
+    double deleted_ratio() const {
+      double r = 0.0;
+      for (size_t i = 0; i < shards.size(); ++i) {
+        r = ::std::max(r, shards[i].deleted_ratio());
+      }
+      return r;
+    }
+
+    /// rebuild the shards without tombstones, in parallel.  iterators are invalidated.
+    void compact() {
+      int64_t nshards = shards.size();
+#if defined(USE_OPENMP)
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1)
+#endif
+      for (int64_t s = 0; s < nshards; ++s) {
+        shards[s].compact();
+      }
+    }
+
+    /// keep only the entries for which pred is true.  shards are rebuilt in parallel.  returns number removed.
+    template <typename Pred>
+    size_t retain_if(Pred const & pred) {
+      int64_t nshards = shards.size();
+      size_t count = 0;
+
+#if defined(USE_OPENMP)
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1) reduction(+:count)
+#endif
+      for (int64_t s = 0; s < nshards; ++s) {
+        count += shards[s].retain_if(pred);
+      }
+      return count;
+    }
+
+    size_type count(Key const & key) const {
+      return shards[shard_of(key)].count(key);
+    }
+
+    auto equal_range(Key const & key) -> decltype(::std::declval<shard_type &>().equal_range(key)) {
+      return shards[shard_of(key)].equal_range(key);
+    }
+    auto equal_range(Key const & key) const -> decltype(::std::declval<shard_type const &>().equal_range(key)) {
+      return shards[shard_of(key)].equal_range(key);
+    }
+    // NO bucket interfaces
+
+    /**
+     * @brief returns iterator that continues through the remaining shards, or end() if not found.
+     * @note  only for non-split shards:  a split densehash_map cannot produce an iterator into its middle.
+     *        for split shards use equal_range, count, or exists.
+     */
+    template <bool S = split>
+    typename ::std::enable_if<!S, iterator>::type find(Key const & key) {
+      size_t s = shard_of(key);
+      auto it = shards[s].find(key);
+      if (it == shards[s].end()) return end();
+
+      ::std::vector<::std::pair<shard_iterator, shard_iterator> > ranges;
+      ranges.emplace_back(it, shards[s].end());
+      for (size_t i = s + 1; i < shards.size(); ++i) {
+        ranges.emplace_back(shards[i].begin(), shards[i].end());
+      }
+      return iterator(::std::move(ranges));
+    }
+
+    template <bool S = split>
+    typename ::std::enable_if<!S, const_iterator>::type find(Key const & key) const {
+      size_t s = shard_of(key);
+      auto it = shards[s].find(key);
+      if (it == shards[s].cend()) return cend();
+
+      ::std::vector<::std::pair<shard_const_iterator, shard_const_iterator> > ranges;
+      ranges.emplace_back(it, shards[s].cend());
+      for (size_t i = s + 1; i < shards.size(); ++i) {
+        ranges.emplace_back(shards[i].cbegin(), shards[i].cend());
+      }
+      return const_iterator(::std::move(ranges));
+    }
+
+    inline bool exists(Key const & key) const {
+      return shards[shard_of(key)].count(key) > 0;
+    }
+
+};
+
+
+}  // namespace fsc
+
+#endif /* SHARDED_DENSEHASH_MAP_HPP_ */
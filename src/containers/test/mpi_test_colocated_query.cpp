@@ -0,0 +1,154 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_colocated_query.cpp
+ *   Test that querying a count map and a position map together gives the same results as querying each separately.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "index/kmer_index.hpp"
+#include "containers/distributed_colocated_query.hpp"
+
+
+class ColocatedQueryTest : public ::testing::Test
+{
+  protected:
+    using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+    template <typename K>
+    using Params = bliss::index::kmer::CanonicalHashMapParams<K>;
+    using CountMap = ::dsc::counting_densehash_map<KmerType, uint32_t, Params,
+        ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> >;
+    using PosMap = ::dsc::densehash_multimap<KmerType, uint32_t, Params,
+        ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> >;
+
+    ::mxx::comm comm;
+    CountMap counts;
+    PosMap positions;
+    std::vector<KmerType> kmers;
+
+    ColocatedQueryTest() : counts(comm), positions(comm) {}
+
+    /// random k-mer from a small pool, so that there are repeats.
+    KmerType make_kmer(std::mt19937 & gen, std::uniform_int_distribution<uint32_t> & dist) {
+      KmerType k;
+      std::mt19937 kgen(dist(gen));
+      for (unsigned int i = 0; i < KmerType::size; ++i) k.nextFromChar(kgen() & 0x3);
+      return k;
+    }
+
+    virtual void SetUp() {
+      std::mt19937 gen(comm.rank() + 7);
+      std::uniform_int_distribution<uint32_t> dist(0, 999);
+
+      for (size_t i = 0; i < 2000; ++i) kmers.emplace_back(make_kmer(gen, dist));
+
+      std::vector<KmerType> input(kmers);
+      counts.insert(input);
+      std::vector<std::pair<KmerType, uint32_t> > pos;
+      for (size_t i = 0; i < kmers.size(); ++i) pos.emplace_back(kmers[i], comm.rank() * kmers.size() + i);
+      positions.insert(pos);
+    }
+
+    /// queries:  half present, half from a pool not inserted.
+    std::vector<KmerType> queries() {
+      std::mt19937 gen(comm.rank() + 101);
+      std::uniform_int_distribution<uint32_t> dist(500, 1499);
+      std::vector<KmerType> out;
+      for (size_t i = 0; i < 300; ++i) out.emplace_back(make_kmer(gen, dist));
+      std::sort(out.begin(), out.end());
+      out.erase(std::unique(out.begin(), out.end()), out.end());
+      return out;
+    }
+};
+
+
+TEST_F(ColocatedQueryTest, count)
+{
+  std::vector<KmerType> q = queries();
+  std::vector<KmerType> q1(q), q2(q);
+
+  auto gold1 = counts.count(q1);
+  auto gold2 = positions.count(q2);
+  auto res = ::dsc::colocated_count(q, counts, positions);
+
+  ASSERT_EQ(gold1.size(), res.size());
+  ASSERT_EQ(gold2.size(), res.size());
+  std::sort(gold1.begin(), gold1.end());
+  std::sort(gold2.begin(), gold2.end());
+  std::sort(res.begin(), res.end());
+
+  bool same = true;
+  for (size_t i = 0; i < res.size(); ++i) {
+    same &= (res[i].first == gold1[i].first) && (res[i].second[0] == gold1[i].second);
+    same &= (res[i].first == gold2[i].first) && (res[i].second[1] == gold2[i].second);
+  }
+  EXPECT_TRUE(::mxx::all_of(same, comm));
+}
+
+TEST_F(ColocatedQueryTest, find)
+{
+  std::vector<KmerType> q = queries();
+  std::vector<KmerType> q1(q), q2(q);
+
+  auto gold1 = counts.find(q1);
+  auto gold2 = positions.find(q2);
+  auto res = ::dsc::colocated_find(q, counts, positions);
+
+  auto & res1 = std::get<0>(res);
+  auto & res2 = std::get<1>(res);
+  std::sort(gold1.begin(), gold1.end());
+  std::sort(gold2.begin(), gold2.end());
+  std::sort(res1.begin(), res1.end());
+  std::sort(res2.begin(), res2.end());
+
+  EXPECT_GT(::mxx::allreduce(res2.size(), comm), 0UL);
+  EXPECT_TRUE(::mxx::all_of(gold1 == res1, comm));
+  EXPECT_TRUE(::mxx::all_of(gold2 == res2, comm));
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_count_export.cpp
+ *   Test that export_counts writes the whole content of a count map to 1 file, as a mappable binary segment and as
+ *   jellyfish and kmc text dumps, and that the sorted export is in key order.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "index/kmer_index.hpp"
+#include "containers/dsc_count_export.hpp"
+
+
+class CountExportTest : public ::testing::Test
+{
+  protected:
+    using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+    template <typename K>
+    using Params = bliss::index::kmer::CanonicalHashMapParams<K>;
+    using MapType = ::dsc::counting_densehash_map<KmerType, uint32_t, Params,
+        ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> >;
+    using PairType = std::pair<KmerType, uint32_t>;
+
+    ::mxx::comm comm;
+    MapType map;
+    std::string filename;
+
+    CountExportTest() : map(comm) {}
+
+    virtual void SetUp() {
+      // k-mers from a small pool of seeds, so that ranks share k-mers.
+      std::vector<KmerType> input;
+      std::mt19937 gen(comm.rank() + 17);
+      std::uniform_int_distribution<uint32_t> dist(0, 999);
+      for (size_t i = 0; i < 2000; ++i) {
+        KmerType k;
+        std::mt19937 kgen(dist(gen));
+        for (unsigned int j = 0; j < KmerType::size; ++j) k.nextFromChar(kgen() & 0x3);
+        input.emplace_back(k);
+      }
+      map.insert(input);
+
+      int pid = getpid();
+      ::mxx::bcast(pid, 0, comm);
+      std::stringstream ss;
+      ss << "/tmp/bliss_count_export_test." << pid;
+      filename = ss.str();
+    }
+
+    virtual void TearDown() {
+      comm.barrier();
+      if (comm.rank() == 0) unlink(filename.c_str());
+      comm.barrier();
+    }
+
+    /// content of the whole map, sorted.
+    std::vector<PairType> gold() {
+      std::vector<PairType> local;
+      map.to_vector(local);
+      std::vector<PairType> all = ::mxx::allgatherv(local, comm);
+      std::sort(all.begin(), all.end());
+      return all;
+    }
+
+    /// parse a text dump with separator sep.
+    bool parse_text(char const & sep, std::vector<PairType> & out) {
+      std::ifstream ifs(filename);
+      std::string line;
+      while (std::getline(ifs, line)) {
+        size_t pos = line.find(sep);
+        if (pos != KmerType::size) return false;
+        KmerType k;
+        for (size_t i = 0; i < pos; ++i) k.nextFromChar(bliss::common::DNA::FROM_ASCII[static_cast<unsigned char>(line[i])]);
+        out.emplace_back(k, static_cast<uint32_t>(std::stoul(line.substr(pos + 1))));
+      }
+      return true;
+    }
+};
+
+
+TEST_F(CountExportTest, binary)
+{
+  auto g = gold();
+  size_t n = ::dsc::export_counts(map, filename);
+  EXPECT_EQ(g.size(), n);
+
+  // every rank maps the file.
+  ::dsc::mapped_map_segment<PairType> seg(filename, map.segment_header(0));
+  std::vector<PairType> res(seg.begin(), seg.end());
+  EXPECT_EQ(0, seg.get_header().rank);
+  EXPECT_EQ(1, seg.get_header().nranks);
+  std::sort(res.begin(), res.end());
+  EXPECT_TRUE(::mxx::all_of(g == res, comm));
+}
+
+TEST_F(CountExportTest, sorted)
+{
+  auto g = gold();
+  ::dsc::export_counts(map, filename, ::dsc::count_format::binary, true);
+
+  ::dsc::mapped_map_segment<PairType> seg(filename, map.segment_header(0));
+  std::vector<PairType> res(seg.begin(), seg.end());
+  EXPECT_TRUE(::mxx::all_of(g == res, comm));
+}
+
+TEST_F(CountExportTest, jellyfish_text)
+{
+  auto g = gold();
+  size_t n = ::dsc::export_counts(map, filename, ::dsc::count_format::jellyfish_text, true);
+  EXPECT_EQ(g.size(), n);
+
+  std::vector<PairType> res;
+  bool ok = parse_text(' ', res);
+  EXPECT_TRUE(::mxx::all_of(ok && (g == res), comm));
+}
+
+TEST_F(CountExportTest, kmc_text)
+{
+  auto g = gold();
+  ::dsc::export_counts(map, filename, ::dsc::count_format::kmc_text);
+
+  std::vector<PairType> res;
+  bool ok = parse_text('\t', res);
+  std::sort(res.begin(), res.end());
+  EXPECT_TRUE(::mxx::all_of(ok && (g == res), comm));
+}
+
+TEST_F(CountExportTest, overwrite)
+{
+  // a shorter export replaces a longer file.
+  ::dsc::export_counts(map, filename, ::dsc::count_format::kmc_text);
+  map.clear();
+  size_t n = ::dsc::export_counts(map, filename, ::dsc::count_format::kmc_text);
+  EXPECT_EQ(0UL, n);
+
+  std::vector<PairType> res;
+  bool ok = parse_text('\t', res);
+  EXPECT_TRUE(::mxx::all_of(ok && res.empty(), comm));
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_count_top_k.cpp
+ *   Test that top_k on the counting maps returns k keys with the highest counts, with ties at the k-th count.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "index/kmer_index.hpp"
+
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+template <typename K>
+using HashParams = bliss::index::kmer::CanonicalHashMapParams<K>;
+template <typename K>
+using SortedParams = bliss::index::kmer::CanonicalSortedMapParams<K>;
+
+template <typename MapType>
+class CountTopKTest : public ::testing::Test
+{
+  protected:
+    using PairType = std::pair<KmerType, uint32_t>;
+
+    ::mxx::comm comm;
+    MapType map;
+    /// whole map content, on every rank.
+    std::map<KmerType, uint32_t> gold;
+
+    CountTopKTest() : map(comm) {}
+
+    static KmerType make_kmer(uint32_t seed) {
+      KmerType k;
+      std::mt19937 gen(seed);
+      for (unsigned int j = 0; j < KmerType::size; ++j) k.nextFromChar(gen() & 0x3);
+      return k;
+    }
+
+    virtual void SetUp() {
+      // few distinct counts, so many ties, and a skewed key split across ranks.
+      std::vector<KmerType> input;
+      for (uint32_t i = 0; i < 2000; ++i) {
+        uint32_t c = (i * 7) % 13 + ((i % 500 == 0) ? 200 : 0);
+        for (uint32_t j = 0; j < c; ++j) {
+          if ((i + j) % comm.size() == comm.rank()) input.emplace_back(make_kmer(i));
+        }
+      }
+      map.insert(input);
+
+      std::vector<PairType> local;
+      map.to_vector(local);
+      std::vector<PairType> all = ::mxx::allgatherv(local, comm);
+      for (auto const & e : all) gold[e.first] += e.second;
+    }
+
+    void check(size_t k) {
+      int root = comm.size() - 1;
+      std::vector<PairType> res = map.top_k(k, root);
+      if (comm.rank() != root) {
+        EXPECT_TRUE(res.empty());
+        return;
+      }
+
+      std::vector<uint32_t> counts;
+      for (auto const & e : gold) counts.push_back(e.second);
+      std::sort(counts.begin(), counts.end(), std::greater<uint32_t>());
+      counts.resize(std::min(k, counts.size()));
+
+      ASSERT_EQ(counts.size(), res.size());
+      std::map<KmerType, uint32_t> seen;
+      for (size_t i = 0; i < res.size(); ++i) {
+        EXPECT_EQ(counts[i], res[i].second) << "k " << k << " i " << i;
+        EXPECT_EQ(gold[res[i].first], res[i].second);
+        seen[res[i].first] = res[i].second;
+      }
+      EXPECT_EQ(res.size(), seen.size());
+    }
+};
+
+typedef ::testing::Types<
+    ::dsc::counting_densehash_map<KmerType, uint32_t, HashParams, ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> >,
+    ::dsc::counting_unordered_map<KmerType, uint32_t, HashParams>,
+    ::dsc::counting_sorted_map<KmerType, uint32_t, SortedParams>
+> MapTypes;
+
+TYPED_TEST_CASE(CountTopKTest, MapTypes);
+
+
+TYPED_TEST(CountTopKTest, top_k)
+{
+  // the heavy keys only, then into the ties, then more than all keys.
+  this->check(4);
+  this->check(1);
+  this->check(10);
+  this->check(157);
+  this->check(1000);
+  this->check(5000);
+  this->check(0);
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
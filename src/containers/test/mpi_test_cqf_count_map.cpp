@@ -0,0 +1,234 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_cqf_count_map.cpp
+ *   Test that the counting quotient filter count map gives counts at least the brute force counts, and rarely more,
+ *   that absent keys are rarely counted, and that keys are placed as in the hash maps.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/kmer_transform.hpp"
+#include "index/kmer_hash.hpp"
+#include "containers/distributed_cqf_count_map.hpp"
+
+
+template <typename K>
+using DistHash = ::bliss::kmer::hash::murmur<K, true>;
+template <typename K>
+using StoreHash = ::bliss::kmer::hash::murmur<K, false>;
+
+template <typename K>
+using SingleStrandParams = ::dsc::HashMapParams<K, ::bliss::transform::identity, ::bliss::transform::identity,
+    DistHash, ::std::equal_to, ::bliss::transform::identity, StoreHash, ::std::equal_to>;
+template <typename K>
+using CanonicalParams = ::dsc::HashMapParams<K, ::bliss::kmer::transform::lex_less, ::bliss::transform::identity,
+    DistHash, ::std::equal_to, ::bliss::transform::identity, StoreHash, ::std::equal_to>;
+
+template <template <typename> class P>
+struct CQFMapParams {
+    template <typename K>
+    using type = P<K>;
+};
+
+
+template <typename MapParams>
+class CQFCountMapTest : public ::testing::Test
+{
+  protected:
+    using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+    template <typename K>
+    using Params = typename MapParams::template type<K>;
+    using MapType = ::dsc::cqf_count_map<KmerType, uint32_t, Params>;
+
+    static KmerType random_kmer(std::mt19937_64 & gen) {
+      KmerType k;
+      k.getDataRef()[0] = gen() & ((1ULL << (2 * 21)) - 1);
+      return k;
+    }
+
+    /// n distinct random k-mers on this rank, each repeated 1 to 5 times.
+    std::vector<KmerType> generate(size_t n) {
+      ::mxx::comm comm;
+      std::mt19937_64 gen(comm.rank() + 11);
+      std::vector<KmerType> out;
+      for (size_t i = 0; i < n; ++i) {
+        KmerType k = random_kmer(gen);
+        for (size_t j = 0; j <= i % 5; ++j) out.emplace_back(k);
+      }
+      std::shuffle(out.begin(), out.end(), gen);
+      return out;
+    }
+
+    /// brute force global counts of the transformed k-mers.
+    std::map<KmerType, uint32_t> gold_counts(std::vector<KmerType> const & input) {
+      ::mxx::comm comm;
+      typename MapType::input_transform_type trans;
+      std::vector<std::pair<KmerType, uint32_t> > all;
+      for (auto const & k : input) all.emplace_back(trans(k), 1);
+      if (comm.size() > 1) all = ::mxx::allgatherv(all, comm);
+      std::map<KmerType, uint32_t> g;
+      for (auto const & x : all) g[x.first] += x.second;
+      return g;
+    }
+
+    void check(MapType const & map, std::map<KmerType, uint32_t> const & g) {
+      ::mxx::comm comm;
+
+      // at most the distinct keys, and rarely fewer.
+      EXPECT_LE(map.size(), g.size());
+      EXPECT_GE(map.size(), g.size() - g.size() / 100);
+
+      // aligned queries for all keys, split over the ranks.
+      std::vector<KmerType> q;
+      std::vector<uint32_t> expected;
+      size_t i = 0;
+      for (auto const & x : g) {
+        if ((i++ % comm.size()) != static_cast<size_t>(comm.rank())) continue;
+        q.emplace_back(x.first);
+        expected.emplace_back(x.second);
+      }
+      std::vector<uint32_t> found = map.find_aligned(q, 0);
+      ASSERT_EQ(q.size(), found.size());
+      bool same = true;
+      size_t more = 0;
+      for (size_t j = 0; j < q.size(); ++j) {
+        same &= (found[j] >= expected[j]);
+        more += (found[j] > expected[j]) ? 1 : 0;
+      }
+      same = ::mxx::all_of(same, comm);
+      EXPECT_TRUE(same);
+      more = ::mxx::allreduce(more, comm);
+      EXPECT_LT(more, g.size() / 100);
+
+      // find returns only counted keys, once per query.
+      std::vector<std::pair<KmerType, uint32_t> > f = map.find(q);
+      EXPECT_EQ(q.size(), f.size());
+
+      // absent keys.
+      std::mt19937_64 gen(comm.rank() + 1000);
+      std::vector<KmerType> absent;
+      for (size_t j = 0; j < 20000; ++j) {
+        KmerType k = random_kmer(gen);
+        typename MapType::input_transform_type trans;
+        if (g.count(trans(k)) == 0) absent.emplace_back(k);
+      }
+      std::vector<size_t> c = map.count_aligned(absent);
+      size_t fp = std::count(c.begin(), c.end(), 1);
+      fp = ::mxx::allreduce(fp, comm);
+      size_t total = ::mxx::allreduce(absent.size(), comm);
+      EXPECT_LE(static_cast<double>(fp) / total, 2.0 / 256);
+    }
+
+    void run(size_t n) {
+      ::mxx::comm comm;
+      std::vector<KmerType> input = generate(n);
+      std::map<KmerType, uint32_t> g = gold_counts(input);
+
+      MapType map(comm, 1.0 / 256, 8);
+      map.reserve(2 * g.size() / comm.size() + 1000);
+
+      // 2 inserts, so counts accumulate.
+      std::vector<KmerType> first(input.begin(), input.begin() + input.size() / 2);
+      std::vector<KmerType> second(input.begin() + input.size() / 2, input.end());
+      map.insert(first);
+      map.insert(second);
+      check(map, g);
+
+      // fingerprints are exact, so (key, count) pairs give the same counts.
+      MapType pairs(comm, 1.0 / 256, 8);
+      pairs.reserve(2 * g.size() / comm.size() + 1000);
+      std::vector<std::pair<KmerType, uint32_t> > local;
+      size_t i = 0;
+      for (auto const & x : g) {
+        if ((i++ % comm.size()) == static_cast<size_t>(comm.rank())) local.emplace_back(x);
+      }
+      pairs.insert(local);
+      check(pairs, g);
+
+      // keys are placed as in the hash maps.
+      std::vector<KmerType> mine;
+      typename MapType::input_transform_type trans;
+      for (auto const & k : input) {
+        if (map.get_key_to_rank()(trans(k)) == comm.rank()) mine.emplace_back(trans(k));
+      }
+      std::sort(mine.begin(), mine.end());
+      mine.erase(std::unique(mine.begin(), mine.end()), mine.end());
+      size_t here = 0;
+      for (auto const & k : mine) here += (map.get_local_container().count(k) > 0) ? 1 : 0;
+      EXPECT_EQ(mine.size(), here);
+
+      EXPECT_THROW(map.to_vector(), std::logic_error);
+
+      map.clear();
+      EXPECT_TRUE(map.empty());
+    }
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(CQFCountMapTest);
+
+TYPED_TEST_P(CQFCountMapTest, insert)
+{
+  this->run(20000);
+}
+
+// now register the test cases
+REGISTER_TYPED_TEST_CASE_P(CQFCountMapTest, insert);
+
+typedef ::testing::Types<
+    CQFMapParams<SingleStrandParams>,
+    CQFMapParams<CanonicalParams>
+> CQFCountMapTestTypes;
+
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, CQFCountMapTest, CQFCountMapTestTypes);
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
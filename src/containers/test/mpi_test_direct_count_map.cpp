@@ -0,0 +1,212 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_direct_count_map.cpp
+ *   Test that the direct indexed count map gives the same counts as a brute force count, in the sparse, dense,
+ *   and replicated insert paths.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "common/kmer_transform.hpp"
+#include "index/kmer_hash.hpp"
+#include "containers/distributed_direct_count_map.hpp"
+
+
+// the hash functions are not used by the direct count map.
+template <typename K>
+using HashIdentity = ::bliss::kmer::hash::identity<K, false>;
+
+template <typename K>
+using SingleStrandParams = ::dsc::HashMapParams<K, ::bliss::transform::identity, ::bliss::transform::identity,
+    HashIdentity, ::std::equal_to, ::bliss::transform::identity, HashIdentity, ::std::equal_to>;
+template <typename K>
+using CanonicalParams = ::dsc::HashMapParams<K, ::bliss::kmer::transform::lex_less, ::bliss::transform::identity,
+    HashIdentity, ::std::equal_to, ::bliss::transform::identity, HashIdentity, ::std::equal_to>;
+
+template <bool CANONICAL, template <typename> class P>
+struct DirectMapParams {
+    static constexpr bool canonical = CANONICAL;
+    template <typename K>
+    using type = P<K>;
+};
+
+
+template <typename MapParams>
+class DirectCountMapTest : public ::testing::Test
+{
+  protected:
+    using KmerType = bliss::common::Kmer<7, bliss::common::DNA, uint16_t>;
+    template <typename K>
+    using Params = typename MapParams::template type<K>;
+    using MapType = ::dsc::direct_count_map<KmerType, uint32_t, Params>;
+
+    /// n random k-mers on this rank.
+    std::vector<KmerType> generate(size_t n) {
+      ::mxx::comm comm;
+      std::mt19937 gen(comm.rank() + 11);
+      std::uniform_int_distribution<uint32_t> dist(0, MapType::table_size - 1);
+      std::vector<KmerType> out;
+      for (size_t i = 0; i < n; ++i) out.emplace_back(MapType::key_at(dist(gen)));
+      // some heavy repeats.
+      for (size_t i = 0; i < n / 4; ++i) out.emplace_back(MapType::key_at(42));
+      return out;
+    }
+
+    /// brute force global counts, by index of the transformed k-mer.
+    std::vector<uint32_t> gold_counts(std::vector<KmerType> const & input) {
+      ::mxx::comm comm;
+      typename MapType::input_transform_type trans;
+      std::vector<uint32_t> g(MapType::table_size, 0);
+      for (auto const & k : input) ++g[MapType::index(trans(k))];
+      if (comm.size() > 1) g = ::mxx::allreduce(g, std::plus<uint32_t>(), comm);
+      return g;
+    }
+
+    void check(MapType const & map, std::vector<uint32_t> const & g) {
+      ::mxx::comm comm;
+
+      size_t distinct = std::count_if(g.begin(), g.end(), [](uint32_t x) { return x > 0; });
+      EXPECT_EQ(distinct, map.size());
+
+      // each key is reported once, by its owner.
+      std::vector<std::pair<KmerType, uint32_t> > local = map.to_vector();
+      bool same = true;
+      for (auto const & x : local) same &= (g[MapType::index(x.first)] == x.second);
+      same &= (static_cast<size_t>(std::distance(map.cbegin(), map.cend())) == local.size());
+      same = ::mxx::all_of(same, comm);
+      EXPECT_TRUE(same);
+
+      // aligned queries for all keys, split over the ranks.
+      std::vector<KmerType> q;
+      for (size_t i = comm.rank(); i < MapType::table_size; i += comm.size()) q.emplace_back(MapType::key_at(i));
+      std::vector<uint32_t> found = map.find_aligned(q, 0);
+      ASSERT_EQ(q.size(), found.size());
+      typename MapType::input_transform_type trans;
+      same = true;
+      for (size_t i = 0; i < q.size(); ++i) same &= (g[MapType::index(trans(q[i]))] == found[i]);
+      same = ::mxx::all_of(same, comm);
+      EXPECT_TRUE(same);
+    }
+
+    void run(size_t n, bool replicated) {
+      ::mxx::comm comm;
+      std::vector<KmerType> input = generate(n);
+      std::vector<uint32_t> g = gold_counts(input);
+
+      MapType map(comm);
+      map.set_replicated(replicated);
+      // 2 inserts, so counts accumulate.
+      std::vector<KmerType> first(input.begin(), input.begin() + input.size() / 2);
+      std::vector<KmerType> second(input.begin() + input.size() / 2, input.end());
+      map.insert(first);
+      map.insert(second);
+      check(map, g);
+
+      // erase the heavy key and check that it is gone everywhere.
+      std::vector<KmerType> e;
+      if (comm.rank() == 0) e.emplace_back(MapType::key_at(42));
+      map.erase(e);
+      typename MapType::input_transform_type trans;
+      g[MapType::index(trans(MapType::key_at(42)))] = 0;
+      check(map, g);
+
+      std::vector<KmerType> q(1, MapType::key_at(42));
+      std::vector<std::pair<KmerType, uint32_t> > f = map.find(q);
+      EXPECT_TRUE(f.empty());
+      std::vector<std::pair<KmerType, size_t> > c = map.count(q);
+      ASSERT_EQ(1UL, c.size());
+      EXPECT_EQ(0UL, c[0].second);
+
+      // every rank adds 1 to the first 100 keys.  absent keys, including the erased one, stay absent.
+      std::vector<KmerType> u;
+      for (uint32_t i = 0; i < 100; ++i) u.emplace_back(MapType::key_at(i));
+      u.emplace_back(MapType::key_at(42));
+      std::vector<uint32_t> ones(u.size(), 1);
+      map.update(u, ones, [](uint32_t & x, uint32_t const & v) { x += v; return 1; });
+      std::vector<uint32_t> before(g);
+      for (auto const & k : u) {
+        size_t id = MapType::index(trans(k));
+        if (before[id] > 0) g[id] += comm.size();
+      }
+      check(map, g);
+    }
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(DirectCountMapTest);
+
+TYPED_TEST_P(DirectCountMapTest, sparse)
+{
+  // few k-mers relative to the 4^7 table, so the indices are sent to their owners.
+  this->run(1000, false);
+}
+
+TYPED_TEST_P(DirectCountMapTest, dense)
+{
+  // more k-mers than the table, so the histograms are reduce-scattered.
+  this->run(200000, false);
+}
+
+TYPED_TEST_P(DirectCountMapTest, replicated)
+{
+  this->run(5000, true);
+}
+
+// now register the test cases
+REGISTER_TYPED_TEST_CASE_P(DirectCountMapTest, sparse, dense, replicated);
+
+typedef ::testing::Types<
+    DirectMapParams<false, SingleStrandParams>,
+    DirectMapParams<true, CanonicalParams>
+> DirectCountMapTestTypes;
+
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, DirectCountMapTest, DirectCountMapTestTypes);
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_key_ids.cpp
+ *   Test that assign_ids numbers the distinct keys of a map 0..n-1, that ids are on the keys' owners, and that key to
+ *   id and id to key lookups agree.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "index/kmer_index.hpp"
+#include "containers/distributed_key_ids.hpp"
+
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+template <typename K>
+using HashParams = bliss::index::kmer::CanonicalHashMapParams<K>;
+template <typename K>
+using SortedParams = bliss::index::kmer::CanonicalSortedMapParams<K>;
+
+template <typename MapType>
+class KeyIdsTest : public ::testing::Test
+{
+  protected:
+    ::mxx::comm comm;
+    MapType map;
+    /// the distinct transformed keys, on every rank.
+    std::vector<KmerType> gold;
+
+    KeyIdsTest() : map(comm) {}
+
+    static KmerType make_kmer(uint32_t seed) {
+      KmerType k;
+      std::mt19937 gen(seed);
+      for (unsigned int j = 0; j < KmerType::size; ++j) k.nextFromChar(gen() & 0x3);
+      return k;
+    }
+
+    virtual void SetUp() {
+      // repeated keys, spread over the ranks.
+      std::vector<KmerType> input;
+      for (uint32_t i = 0; i < 3000; ++i) {
+        for (uint32_t j = 0; j < (i % 3) + 1; ++j) {
+          if ((i + j) % comm.size() == comm.rank()) input.emplace_back(make_kmer(i));
+        }
+      }
+      typename MapType::input_transform_type trans;
+      for (uint32_t i = 0; i < 3000; ++i) gold.emplace_back(trans(make_kmer(i)));
+      std::sort(gold.begin(), gold.end());
+      gold.erase(std::unique(gold.begin(), gold.end()), gold.end());
+
+      map.insert(input);
+    }
+
+    template <typename ID>
+    void check() {
+      auto ids = ::dsc::assign_ids<ID>(map);
+      using IndexType = decltype(ids);
+
+      ASSERT_EQ(gold.size(), ids.size());
+      EXPECT_EQ(ids.size(), ::mxx::allreduce(ids.local_size(), comm));
+      EXPECT_EQ(0UL, static_cast<size_t>(ids.first_id(0)));
+
+      // local slots:  the ids of this rank's keys, in order, on this rank.
+      bool same = true;
+      ID first = ids.first_id(comm.rank());
+      for (size_t s = 0; s < ids.local_size(); ++s) {
+        same &= (ids.local_id(ids.local_key(s)) == static_cast<ID>(first + s));
+        same &= (ids.get_key_to_rank()(ids.local_key(s)) == comm.rank());
+        std::pair<int, size_t> loc = ids.locate(static_cast<ID>(first + s));
+        same &= (loc.first == comm.rank()) && (loc.second == s);
+      }
+      EXPECT_TRUE(::mxx::all_of(same, comm));
+
+      // all keys, queried from every rank, untransformed on odd ranks.
+      std::vector<KmerType> q(gold);
+      if (comm.rank() % 2 == 1) {
+        for (auto & k : q) k = k.reverse_complement();
+      }
+      std::vector<ID> found = ids.find_aligned(q);
+      ASSERT_EQ(q.size(), found.size());
+
+      // dense, and each id on its key's owner.
+      std::vector<ID> sorted(found);
+      std::sort(sorted.begin(), sorted.end());
+      for (size_t i = 0; i < sorted.size(); ++i) ASSERT_EQ(static_cast<ID>(i), sorted[i]);
+      for (size_t i = 0; i < q.size(); ++i) {
+        ASSERT_EQ(ids.get_key_to_rank()(gold[i]), ids.locate(found[i]).first);
+      }
+
+      // the same ids on every rank.
+      std::vector<ID> all = ::mxx::allgatherv(found, comm);
+      for (int r = 0; r < comm.size(); ++r) {
+        EXPECT_TRUE(std::equal(found.begin(), found.end(), all.begin() + r * found.size()));
+      }
+
+      // and back to the keys.
+      std::vector<KmerType> back = ids.keys_aligned(found);
+      EXPECT_EQ(gold, back);
+
+      // absent keys.
+      std::vector<KmerType> absent;
+      for (uint32_t i = 5000; i < 5100; ++i) absent.emplace_back(make_kmer(i));
+      std::vector<ID> none = ids.find_aligned(absent);
+      ASSERT_EQ(absent.size(), none.size());
+      for (auto const & x : none) EXPECT_EQ(IndexType::missing, x);
+    }
+};
+
+typedef ::testing::Types<
+    ::dsc::counting_densehash_map<KmerType, uint32_t, HashParams, ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> >,
+    ::dsc::counting_unordered_map<KmerType, uint32_t, HashParams>,
+    ::dsc::counting_sorted_map<KmerType, uint32_t, SortedParams>
+> MapTypes;
+
+TYPED_TEST_CASE(KeyIdsTest, MapTypes);
+
+
+TYPED_TEST(KeyIdsTest, assign_ids)
+{
+  this->template check<uint64_t>();
+  this->template check<uint32_t>();
+}
+
+TEST(KeyIds, multimap_and_order)
+{
+  ::mxx::comm comm;
+
+  // a multimap has 1 id per distinct key.
+  ::dsc::unordered_multimap<KmerType, uint32_t, HashParams> mm(comm);
+  std::vector<std::pair<KmerType, uint32_t> > input;
+  std::mt19937 gen(comm.rank());
+  for (uint32_t i = 0; i < 1000; ++i) {
+    KmerType k;
+    for (unsigned int j = 0; j < KmerType::size; ++j) k.nextFromChar((i * 7 + j) & 0x3 ? gen() & 0x3 : 0);
+    input.emplace_back(k, i);
+    input.emplace_back(k, i + 1);
+  }
+  mm.insert(input);
+  auto ids = ::dsc::assign_ids(mm);
+  EXPECT_EQ(mm.unique_size(), ids.size());
+
+  // a sorted map numbers its keys in key order on each rank.
+  ::dsc::counting_sorted_map<KmerType, uint32_t, SortedParams> sm(comm);
+  std::vector<KmerType> keys;
+  for (auto const & x : input) keys.emplace_back(x.first);
+  sm.insert(keys);
+  auto sids = ::dsc::assign_ids<uint32_t>(sm);
+  bool sorted = std::is_sorted(sids.local_keys().begin(), sids.local_keys().end());
+  EXPECT_TRUE(::mxx::all_of(sorted, comm));
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_map_redistribute.cpp
+ *   Test that moving a map to a smaller or larger communicator keeps its content, and puts every entry on its owner.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "index/kmer_index.hpp"
+#include "containers/distributed_unordered_map.hpp"
+
+
+template <typename M>
+class MapRedistributeTest : public ::testing::Test
+{
+  protected:
+    using MapType = M;
+    using KmerType = typename MapType::key_type;
+    using Entries = std::vector<std::pair<KmerType, typename MapType::mapped_type> >;
+
+    /// random k-mers, with repeats.
+    std::vector<KmerType> make_kmers(int rank) {
+      std::mt19937 gen(rank + 13);
+      std::uniform_int_distribution<uint32_t> dist(0, 2999);
+      std::vector<KmerType> out;
+      for (size_t i = 0; i < 5000; ++i) {
+        KmerType k;
+        std::mt19937 kgen(dist(gen));
+        for (unsigned int j = 0; j < KmerType::size; ++j) k.nextFromChar(kgen() & 0x3);
+        out.emplace_back(k);
+      }
+      return out;
+    }
+
+    /// counting maps take k-mers.
+    template <typename Map>
+    auto fill(Map & map, std::vector<KmerType> & kmers, int) -> decltype(map.insert(kmers), void()) {
+      map.insert(kmers);
+    }
+    /// multimaps take (k-mer, value) pairs.
+    template <typename Map>
+    void fill(Map & map, std::vector<KmerType> & kmers, long) {
+      Entries entries;
+      for (size_t i = 0; i < kmers.size(); ++i) entries.emplace_back(kmers[i], i);
+      map.insert(entries);
+    }
+
+    /// all entries of a map, sorted, on every rank of carrier.  empty contribution from ranks without a map.
+    Entries gather(MapType const * map, ::mxx::comm const & carrier) {
+      Entries local;
+      if (map != nullptr) map->to_vector(local);
+      Entries all = ::mxx::allgatherv(local, carrier);
+      std::sort(all.begin(), all.end());
+      return all;
+    }
+
+    /// true if all local entries are owned by this rank.
+    bool owned(MapType const & map) {
+      Entries local;
+      map.to_vector(local);
+      bool ok = true;
+      for (auto const & x : local) ok &= (map.get_key_to_rank()(x.first) == map.get_comm().rank());
+      return ok;
+    }
+
+    /// move from a map on the ranks in_old to a map on the ranks in_new.
+    void run(bool in_old, bool in_new, size_t batch_size) {
+      ::mxx::comm comm;
+      ::mxx::comm old_comm = comm.split(in_old);
+      ::mxx::comm new_comm = comm.split(in_new);
+
+      std::unique_ptr<MapType> source(in_old ? new MapType(old_comm) : nullptr);
+      if (in_old) {
+        std::vector<KmerType> kmers = make_kmers(comm.rank());
+        fill(*source, kmers, 0);
+      }
+      Entries before = gather(source.get(), comm);
+      ASSERT_GT(before.size(), 0UL);
+
+      std::unique_ptr<MapType> target(in_new ? new MapType(new_comm) : nullptr);
+      MapType::redistribute(source.get(), target.get(), comm, batch_size);
+
+      Entries after = gather(target.get(), comm);
+      EXPECT_TRUE(before == after);
+      EXPECT_TRUE(::mxx::all_of((target == nullptr) || owned(*target), comm));
+      EXPECT_TRUE(::mxx::all_of((source == nullptr) || (source->local_size() == 0), comm));
+    }
+};
+
+template <typename K>
+using Params = bliss::index::kmer::CanonicalHashMapParams<K>;
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+typedef ::testing::Types<
+    ::dsc::counting_densehash_map<KmerType, uint32_t, Params, ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> >,
+    ::dsc::densehash_multimap<KmerType, uint32_t, Params, ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> >,
+    ::dsc::counting_unordered_map<KmerType, uint32_t, Params>
+> MapTypes;
+
+TYPED_TEST_CASE(MapRedistributeTest, MapTypes);
+
+
+TYPED_TEST(MapRedistributeTest, shrink)
+{
+  ::mxx::comm comm;
+  // keep the first half of the ranks, at least 1.
+  this->run(true, comm.rank() <= (comm.size() - 1) / 2, 1000);
+}
+
+TYPED_TEST(MapRedistributeTest, grow)
+{
+  ::mxx::comm comm;
+  this->run(comm.rank() <= (comm.size() - 1) / 2, true, 1000);
+}
+
+TYPED_TEST(MapRedistributeTest, same_ranks)
+{
+  // 1 round.
+  this->run(true, true, 1UL << 20);
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,283 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_prepared_query.cpp
+ *   Test that count, find and update with a prepared query give the same results as with the key vector, over
+ *   repeated calls, and that update by keys and values matches update by a prepared query.  Also test that the
+ *   projection queries (count_values, exists_bitmap, find_values) match count and find in the order of the keys.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "index/kmer_index.hpp"
+
+
+class PreparedQueryTest : public ::testing::Test
+{
+  protected:
+    using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+    template <typename K>
+    using Params = bliss::index::kmer::CanonicalHashMapParams<K>;
+    using MapType = ::dsc::densehash_map<KmerType, uint32_t, Params,
+        ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> >;
+
+    ::mxx::comm comm;
+    MapType map;
+
+    PreparedQueryTest() : map(comm) {}
+
+    /// k-mer from a small pool of seeds, so that ranks share k-mers.
+    static KmerType make_kmer(uint32_t seed) {
+      KmerType k;
+      std::mt19937 kgen(seed);
+      for (unsigned int i = 0; i < KmerType::size; ++i) k.nextFromChar(kgen() & 0x3);
+      return k;
+    }
+
+    virtual void SetUp() {
+      std::vector<std::pair<KmerType, uint32_t> > input;
+      for (uint32_t i = 0; i < 1000; ++i) input.emplace_back(make_kmer(i), i);
+      map.insert(input);
+    }
+
+    /// unique queries, about half present.
+    std::vector<KmerType> queries() {
+      std::mt19937 gen(comm.rank() + 101);
+      std::uniform_int_distribution<uint32_t> dist(500, 1499);
+      std::vector<KmerType> out;
+      for (size_t i = 0; i < 300; ++i) out.emplace_back(make_kmer(dist(gen)));
+      std::sort(out.begin(), out.end());
+      out.erase(std::unique(out.begin(), out.end()), out.end());
+      return out;
+    }
+};
+
+
+TEST_F(PreparedQueryTest, count)
+{
+  std::vector<KmerType> q = queries();
+  auto prepared = map.prepare_query(q);
+
+  for (int iter = 0; iter < 2; ++iter) {
+    auto res = map.count(prepared);
+
+    // in the input order, with transformed keys.
+    std::vector<KmerType> q1(q);
+    map.transform_input(q1);
+    ASSERT_EQ(q1.size(), res.size());
+    bool same = true;
+    for (size_t i = 0; i < q1.size(); ++i) same &= (res[i].first == q1[i]);
+
+    auto gold = map.count(q1);
+    std::sort(gold.begin(), gold.end());
+    std::sort(res.begin(), res.end());
+    same &= (gold == res);
+    EXPECT_TRUE(::mxx::all_of(same, comm));
+  }
+}
+
+TEST_F(PreparedQueryTest, find)
+{
+  std::vector<KmerType> q = queries();
+  auto prepared = map.prepare_query(q);
+
+  for (int iter = 0; iter < 2; ++iter) {
+    std::vector<KmerType> q1(q);
+    auto gold = map.find(q1);
+    auto res = map.find(prepared);
+    std::sort(gold.begin(), gold.end());
+    std::sort(res.begin(), res.end());
+
+    EXPECT_GT(::mxx::allreduce(res.size(), comm), 0UL);
+    EXPECT_TRUE(::mxx::all_of(gold == res, comm));
+  }
+}
+
+TEST_F(PreparedQueryTest, update)
+{
+  std::vector<KmerType> q = queries();
+  auto prepared = map.prepare_query(q);
+
+  std::vector<KmerType> q1(q);
+  auto before = map.find(q1);
+
+  // each rank adds 1 to each of its present keys, twice.
+  std::vector<uint32_t> ones(q.size(), 1);
+  auto add = [](uint32_t & v, uint32_t const & x) { v += x; return 1; };
+  map.update(prepared, ones, add);
+  map.update(prepared, ones, add);
+
+  std::vector<KmerType> q2(q);
+  auto after = map.find(q2);
+  std::sort(before.begin(), before.end());
+  std::sort(after.begin(), after.end());
+
+  // keys queried by r ranks increase by 2r.
+  std::vector<KmerType> all = ::mxx::allgatherv(q, comm);
+  bool same = (before.size() == after.size());
+  for (size_t i = 0; same && (i < after.size()); ++i) {
+    KmerType k = after[i].first;
+    size_t r = 0;
+    for (auto const & x : all) r += (x == k) || (x.reverse_complement() == k);
+    same &= (after[i].first == before[i].first) && (after[i].second == before[i].second + 2 * r);
+  }
+  EXPECT_TRUE(::mxx::all_of(same, comm));
+}
+
+TEST_F(PreparedQueryTest, keyed_update)
+{
+  // update by (keys, values) matches update by the prepared query.
+  std::vector<KmerType> q = queries();
+  auto prepared = map.prepare_query(q);
+
+  MapType other(comm);
+  std::vector<std::pair<KmerType, uint32_t> > input;
+  for (uint32_t i = 0; i < 1000; ++i) input.emplace_back(make_kmer(i), i);
+  other.insert(input);
+
+  std::vector<uint32_t> values(q.size());
+  for (size_t i = 0; i < q.size(); ++i) values[i] = i + 1;
+  auto add = [](uint32_t & v, uint32_t const & x) { v += x; return 1; };
+  size_t n = map.update(prepared, values, add);
+  size_t m = other.update(q, values, add);
+  EXPECT_EQ(::mxx::allreduce(n, comm), ::mxx::allreduce(m, comm));
+
+  std::vector<KmerType> q1(q), q2(q);
+  auto gold = map.find(q1);
+  auto res = other.find(q2);
+  std::sort(gold.begin(), gold.end());
+  std::sort(res.begin(), res.end());
+  EXPECT_TRUE(::mxx::all_of(gold == res, comm));
+}
+
+TEST_F(PreparedQueryTest, projections)
+{
+  // duplicates, and keys not on this rank's list, in no particular order.
+  std::vector<KmerType> q = queries();
+  q.insert(q.end(), q.begin(), q.begin() + q.size() / 3);
+  std::shuffle(q.begin(), q.end(), std::mt19937(comm.rank()));
+
+  auto counts = map.count_aligned(q);
+  auto found = map.find_aligned(q, 0);
+
+  auto cv = map.count_values(q);
+  auto ex = map.exists_bitmap(q);
+  std::vector<size_t> offsets;
+  auto fv = map.find_values(q, offsets);
+
+  ASSERT_EQ(q.size(), cv.size());
+  ASSERT_EQ(q.size(), ex.size());
+  ASSERT_EQ(q.size() + 1, offsets.size());
+  bool same = (offsets.back() == fv.size());
+  size_t present = 0;
+  for (size_t i = 0; i < q.size(); ++i) {
+    same &= (cv[i] == counts[i]) && (ex[i] == (counts[i] > 0));
+    same &= (offsets[i + 1] - offsets[i] == counts[i]);
+    if (counts[i] > 0) same &= (fv[offsets[i]] == found[i]);
+    present += (counts[i] > 0);
+  }
+  EXPECT_GT(::mxx::allreduce(present, comm), 0UL);
+  EXPECT_TRUE(::mxx::all_of(same, comm));
+
+  // with a prepared query, repeatedly.
+  auto prepared = map.prepare_query(q);
+  for (int iter = 0; iter < 2; ++iter) {
+    EXPECT_TRUE(::mxx::all_of(map.count_values(prepared) == cv, comm));
+    EXPECT_TRUE(::mxx::all_of(map.exists_bitmap(prepared) == ex, comm));
+  }
+}
+
+TEST_F(PreparedQueryTest, multimap_values)
+{
+  using MultimapType = ::dsc::densehash_multimap<KmerType, uint32_t, Params,
+      ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> >;
+  MultimapType mm(comm);
+  std::vector<std::pair<KmerType, uint32_t> > input;
+  for (uint32_t i = 0; i < 1000; ++i)
+    for (uint32_t j = 0; j < (i % 5); ++j) input.emplace_back(make_kmer(i), i * 10 + j);
+  size_t inserted = input.size();
+  mm.insert(input);
+
+  std::vector<KmerType> q = queries();
+  std::shuffle(q.begin(), q.end(), std::mt19937(comm.rank()));
+  std::vector<size_t> offsets;
+  auto fv = mm.find_values(q, offsets);
+
+  // values for q[i] are those of the (key, value) pairs from find with key q[i].
+  std::vector<KmerType> q1(q);
+  auto gold = mm.find(q1);
+  std::sort(gold.begin(), gold.end());
+  std::vector<KmerType> tq(q);
+  mm.transform_input(tq);
+
+  ASSERT_EQ(q.size() + 1, offsets.size());
+  bool same = (offsets.back() == fv.size());
+  size_t total = 0;
+  for (size_t i = 0; i < q.size(); ++i) {
+    std::vector<uint32_t> g;
+    for (auto const & x : gold) if (x.first == tq[i]) g.emplace_back(x.second);
+    std::vector<uint32_t> r(fv.begin() + offsets[i], fv.begin() + offsets[i + 1]);
+    std::sort(r.begin(), r.end());
+    same &= (g == r);
+    total += r.size();
+  }
+  EXPECT_GT(::mxx::allreduce(total, comm), 0UL);
+  EXPECT_TRUE(::mxx::all_of(same, comm));
+
+  // the entries of the keys this rank owns, in place.
+  bool local = true;
+  size_t local_total = 0;
+  for (uint32_t i = 0; i < 1000; ++i) {
+    auto span = mm.local_equal_range(make_kmer(i));
+    local_total += span.size();
+    for (auto const & x : span) local &= (x.second / 10 == i);
+  }
+  EXPECT_TRUE(::mxx::all_of(local, comm));
+  EXPECT_EQ(inserted * comm.size(), ::mxx::allreduce(local_total, comm));
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_query_each.cpp
+ *   Test that find_each and count_each pass the same results to the visitor as find and count return, in chunks of
+ *   about the requested size, for a map and for a multimap with many values per key.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "index/kmer_index.hpp"
+
+
+class QueryEachTest : public ::testing::Test
+{
+  protected:
+    using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+    template <typename K>
+    using Params = bliss::index::kmer::CanonicalHashMapParams<K>;
+    using MapType = ::dsc::densehash_map<KmerType, uint32_t, Params,
+        ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> >;
+    using MultimapType = ::dsc::densehash_multimap<KmerType, uint32_t, Params,
+        ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> >;
+
+    ::mxx::comm comm;
+
+    /// k-mer from a small pool of seeds, so that ranks share k-mers.
+    static KmerType make_kmer(uint32_t seed) {
+      KmerType k;
+      std::mt19937 kgen(seed);
+      for (unsigned int i = 0; i < KmerType::size; ++i) k.nextFromChar(kgen() & 0x3);
+      return k;
+    }
+
+    /// unique queries, about half present.
+    std::vector<KmerType> queries() {
+      std::mt19937 gen(comm.rank() + 101);
+      std::uniform_int_distribution<uint32_t> dist(100, 299);
+      std::vector<KmerType> out;
+      for (size_t i = 0; i < 100; ++i) out.emplace_back(make_kmer(dist(gen)));
+      std::sort(out.begin(), out.end());
+      out.erase(std::unique(out.begin(), out.end()), out.end());
+      return out;
+    }
+
+    /// results from the visitor, and the largest chunk.
+    template <typename M, typename R>
+    void check(M const & map, size_t const chunk, size_t const max_per_key) {
+      std::vector<KmerType> q = queries();
+      std::vector<KmerType> q1(q), q2(q);
+
+      std::vector<R> res;
+      size_t max_chunk = 0;
+      size_t calls = 0;
+      size_t n = map.find_each(q1, [&](R const * first, R const * last) {
+        res.insert(res.end(), first, last);
+        max_chunk = std::max(max_chunk, static_cast<size_t>(last - first));
+        ++calls;
+      }, chunk);
+      auto gold = map.find(q2);
+
+      EXPECT_EQ(res.size(), n);
+      std::sort(gold.begin(), gold.end());
+      std::sort(res.begin(), res.end());
+      EXPECT_GT(::mxx::allreduce(res.size(), comm), 0UL);
+      EXPECT_TRUE(::mxx::all_of(gold == res, comm));
+      // a chunk ends within a block of keys after reaching chunk.
+      EXPECT_LE(max_chunk, chunk + 16 * max_per_key);
+      if (res.size() > 2 * (chunk + 16 * max_per_key)) EXPECT_GT(calls, 1UL);
+    }
+};
+
+
+TEST_F(QueryEachTest, map_find)
+{
+  MapType map(comm);
+  std::vector<std::pair<KmerType, uint32_t> > input;
+  for (uint32_t i = 0; i < 200; ++i) input.emplace_back(make_kmer(i), i);
+  map.insert(input);
+
+  this->check<MapType, std::pair<KmerType, uint32_t> >(map, 4, 1);
+  this->check<MapType, std::pair<KmerType, uint32_t> >(map, 1UL << 16, 1);
+}
+
+TEST_F(QueryEachTest, multimap_find)
+{
+  // many values per key, so the results are much larger than the queries.
+  MultimapType map(comm);
+  std::vector<std::pair<KmerType, uint32_t> > input;
+  for (uint32_t i = 0; i < 200; ++i)
+    for (uint32_t j = 0; j < 50; ++j) input.emplace_back(make_kmer(i), i * 100 + j);
+  map.insert(input);
+
+  size_t per_key = 50 * comm.size();
+  this->check<MultimapType, std::pair<KmerType, uint32_t> >(map, 100, per_key);
+  this->check<MultimapType, std::pair<KmerType, uint32_t> >(map, 1, per_key);
+}
+
+TEST_F(QueryEachTest, count)
+{
+  MapType map(comm);
+  std::vector<std::pair<KmerType, uint32_t> > input;
+  for (uint32_t i = 0; i < 200; ++i) input.emplace_back(make_kmer(i), i);
+  map.insert(input);
+
+  using R = std::pair<KmerType, typename MapType::size_type>;
+  std::vector<KmerType> q = queries();
+  std::vector<KmerType> q1(q), q2(q);
+  std::vector<R> res;
+  size_t n = map.count_each(q1, [&res](R const * first, R const * last) { res.insert(res.end(), first, last); }, 8);
+  auto gold = map.count(q2);
+
+  // 1 per key, including absent keys.
+  EXPECT_EQ(q.size(), n);
+  std::sort(gold.begin(), gold.end());
+  std::sort(res.begin(), res.end());
+  EXPECT_TRUE(::mxx::all_of(gold == res, comm));
+}
+
+TEST_F(QueryEachTest, empty)
+{
+  // empty query on some ranks, empty map.
+  MapType map(comm);
+  std::vector<KmerType> q;
+  if (comm.rank() == 0) q = queries();
+  size_t calls = 0;
+  size_t n = map.find_each(q, [&calls](std::pair<KmerType, uint32_t> const *, std::pair<KmerType, uint32_t> const *) { ++calls; });
+  EXPECT_EQ(0UL, n);
+  EXPECT_EQ(0UL, calls);
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_set_ops.cpp
+ *   Test intersect, subtract and merge of 2 count maps against the same operations on the gathered entries.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "index/kmer_index.hpp"
+#include "containers/distributed_unordered_map.hpp"
+#include "containers/distributed_set_ops.hpp"
+
+
+class SetOpsTest : public ::testing::Test
+{
+  protected:
+    using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+    template <typename K>
+    using Params = bliss::index::kmer::CanonicalHashMapParams<K>;
+    using CountMap = ::dsc::counting_densehash_map<KmerType, uint32_t, Params,
+        ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> >;
+    using OtherMap = ::dsc::counting_unordered_map<KmerType, uint32_t, Params>;
+    using Entries = std::vector<std::pair<KmerType, uint32_t> >;
+
+    ::mxx::comm comm;
+    CountMap a;
+    OtherMap b;
+
+    SetOpsTest() : a(comm), b(comm) {}
+
+    /// k-mers from overlapping pools:  a from [0, 1000), b from [500, 1500).
+    std::vector<KmerType> make_kmers(uint32_t lo, uint32_t seed) {
+      std::mt19937 gen(comm.rank() + seed);
+      std::uniform_int_distribution<uint32_t> dist(lo, lo + 999);
+      std::vector<KmerType> out;
+      for (size_t i = 0; i < 2000; ++i) {
+        KmerType k;
+        std::mt19937 kgen(dist(gen));
+        for (unsigned int j = 0; j < KmerType::size; ++j) k.nextFromChar(kgen() & 0x3);
+        out.emplace_back(k);
+      }
+      return out;
+    }
+
+    virtual void SetUp() {
+      std::vector<KmerType> ka = make_kmers(0, 7);
+      std::vector<KmerType> kb = make_kmers(500, 11);
+      a.insert(ka);
+      b.insert(kb);
+    }
+
+    /// all entries of a map, on every rank, in a std::map.
+    template <typename Map>
+    std::map<KmerType, uint32_t> gather(Map const & m) {
+      Entries local;
+      m.to_vector(local);
+      Entries all = ::mxx::allgatherv(local, comm);
+      return std::map<KmerType, uint32_t>(all.begin(), all.end());
+    }
+
+    std::map<KmerType, uint32_t> gather(Entries const & local) {
+      Entries all = ::mxx::allgatherv(local, comm);
+      return std::map<KmerType, uint32_t>(all.begin(), all.end());
+    }
+};
+
+
+TEST_F(SetOpsTest, intersect_subtract)
+{
+  auto ga = gather(a);
+  auto gb = gather(b);
+
+  auto both = gather(::dsc::intersect(a, b));
+  auto only = gather(::dsc::subtract(a, b));
+
+  std::map<KmerType, uint32_t> gold_both, gold_only;
+  for (auto const & x : ga) {
+    if (gb.count(x.first) > 0) gold_both.insert(x);
+    else gold_only.insert(x);
+  }
+  EXPECT_GT(gold_both.size(), 0UL);
+  EXPECT_GT(gold_only.size(), 0UL);
+  EXPECT_TRUE(gold_both == both);
+  EXPECT_TRUE(gold_only == only);
+}
+
+TEST_F(SetOpsTest, merge)
+{
+  auto ga = gather(a);
+  auto gb = gather(b);
+
+  size_t n = ::dsc::merge(a, b, [](uint32_t & x, uint32_t const & y) { x += y; });
+
+  std::map<KmerType, uint32_t> gold(ga);
+  size_t inserted = 0;
+  for (auto const & x : gb) {
+    if (gold.count(x.first) == 0) ++inserted;
+    gold[x.first] += x.second;
+  }
+  EXPECT_EQ(inserted, ::mxx::allreduce(n, comm));
+  EXPECT_TRUE(gold == gather(a));
+
+  // merged counts are visible to queries.
+  std::vector<KmerType> q = make_kmers(500, 11);
+  std::sort(q.begin(), q.end());
+  q.erase(std::unique(q.begin(), q.end()), q.end());
+  auto res = a.find(q);
+  EXPECT_GT(::mxx::allreduce(res.size(), comm), 0UL);
+  bool same = true;
+  for (auto const & x : res) same &= (x.second == gold[x.first]);
+  EXPECT_TRUE(::mxx::all_of(same, comm));
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_sorted_key_column.cpp
+ *   Test that find and count of the sorted maps give the same results with the key column, alone and with the search
+ *   tree, as without, for sparse and dense queries, and after the map changes.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "index/kmer_index.hpp"
+
+
+class SortedKeyColumnTest : public ::testing::Test
+{
+  protected:
+    using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+    template <typename K>
+    using Params = bliss::index::kmer::CanonicalSortedMapParams<K>;
+
+    ::mxx::comm comm;
+
+    /// k-mer from a pool of seeds, so that ranks share k-mers.
+    static KmerType make_kmer(uint32_t seed) {
+      KmerType k;
+      std::mt19937 kgen(seed);
+      for (unsigned int i = 0; i < KmerType::size; ++i) k.nextFromChar(kgen() & 0x3);
+      return k;
+    }
+
+    /// n queries from seeds [0, 2 * pool), so about half are present.
+    std::vector<KmerType> queries(size_t n, uint32_t pool) {
+      std::mt19937 gen(comm.rank() + 101);
+      std::uniform_int_distribution<uint32_t> dist(0, 2 * pool - 1);
+      std::vector<KmerType> out;
+      for (size_t i = 0; i < n; ++i) out.emplace_back(make_kmer(dist(gen)));
+      return out;
+    }
+
+    /// find and count of map with the search structures set as given, sorted.
+    template <typename Map>
+    void query(Map & map, bool key_column, bool search_index, std::vector<KmerType> const & q,
+               std::vector<std::pair<KmerType, typename Map::mapped_type> > & found,
+               std::vector<std::pair<KmerType, size_t> > & counts) {
+      map.set_key_column(key_column);
+      map.set_search_index(search_index);
+      std::vector<KmerType> q1(q), q2(q);
+      found = map.find(q1);
+      counts = map.count(q2);
+      std::sort(found.begin(), found.end());
+      std::sort(counts.begin(), counts.end());
+    }
+
+    template <typename Map>
+    void check(Map & map, uint32_t pool) {
+      // sparse queries use galloping or the search tree, dense ones the merge join.
+      for (size_t n : {10UL, 100000UL}) {
+        std::vector<KmerType> q = queries(n, pool);
+
+        std::vector<std::pair<KmerType, typename Map::mapped_type> > gold_found, found;
+        std::vector<std::pair<KmerType, size_t> > gold_counts, counts;
+        query(map, false, false, q, gold_found, gold_counts);
+
+        size_t present = 0;
+        for (auto const & x : gold_counts) present += (x.second > 0);
+        EXPECT_GT(::mxx::allreduce(present, comm), 0UL);
+
+        query(map, true, false, q, found, counts);
+        EXPECT_TRUE(::mxx::all_of((gold_found == found) && (gold_counts == counts), comm));
+
+        query(map, true, true, q, found, counts);
+        EXPECT_TRUE(::mxx::all_of((gold_found == found) && (gold_counts == counts), comm));
+      }
+    }
+};
+
+
+TEST_F(SortedKeyColumnTest, map)
+{
+  ::dsc::sorted_map<KmerType, uint32_t, Params> map(comm);
+  std::vector<std::pair<KmerType, uint32_t> > input;
+  for (uint32_t i = 0; i < 20000; ++i) input.emplace_back(make_kmer(i), i);
+  map.insert(input);
+
+  check(map, 20000);
+
+  // rebuilt after the map changes.
+  map.set_key_column(true);
+  input.clear();
+  for (uint32_t i = 20000; i < 30000; ++i) input.emplace_back(make_kmer(i), i);
+  map.insert(input);
+  check(map, 30000);
+}
+
+TEST_F(SortedKeyColumnTest, multimap)
+{
+  // larger values, as positions in an index.
+  using ValueType = std::pair<uint64_t, uint64_t>;
+  ::dsc::sorted_multimap<KmerType, ValueType, Params> map(comm);
+  std::vector<std::pair<KmerType, ValueType> > input;
+  for (uint32_t i = 0; i < 10000; ++i)
+    for (uint32_t j = 0; j < (i % 4); ++j) input.emplace_back(make_kmer(i), ValueType(i, comm.rank() * 10 + j));
+  map.insert(input);
+
+  check(map, 10000);
+}
+
+TEST_F(SortedKeyColumnTest, counting_map)
+{
+  ::dsc::counting_sorted_map<KmerType, uint32_t, Params> map(comm);
+  std::vector<KmerType> input;
+  std::mt19937 gen(comm.rank());
+  std::uniform_int_distribution<uint32_t> dist(0, 9999);
+  for (size_t i = 0; i < 30000; ++i) input.emplace_back(make_kmer(dist(gen)));
+  map.insert(input);
+
+  check(map, 10000);
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
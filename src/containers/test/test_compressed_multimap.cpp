@@ -0,0 +1,141 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/compressed_multimap.hpp"
+
+#include <map>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include <utility>  // pair
+#include <vector>
+#include <iterator>
+
+namespace {
+
+  /// stand-in for ShortSequenceKmerId:  ordered by a packed id field.
+  struct packed_id {
+      size_t id;
+      bool operator==(packed_id const & other) const { return id == other.id; }
+  };
+
+  template <typename T>
+  uint64_t as_int(T const & v) { return static_cast<uint64_t>(v); }
+  uint64_t as_int(packed_id const & v) { return v.id; }
+
+  template <typename T>
+  T from_int(uint64_t const & v) { return static_cast<T>(v); }
+  template <>
+  packed_id from_int<packed_id>(uint64_t const & v) { return packed_id{v}; }
+
+}
+
+template <typename T>
+class CompressedMultimapTest : public ::testing::Test
+{
+  protected:
+    std::vector<std::pair<uint32_t, T> > entries;
+    std::map<uint32_t, std::vector<uint64_t> > gold;
+
+    virtual void SetUp()
+    {
+      std::default_random_engine gen(17);
+      std::uniform_int_distribution<uint64_t> pos(0, (1ULL << 40) - 1);
+
+      // multiplicity 1 to 1000 for 300 keys, one key with 100000, and duplicated values.
+      for (uint32_t k = 0; k < 301; ++k) {
+        size_t n = (k == 300) ? 100000 : ((k * k * 11) % 1000 + 1);
+        for (size_t i = 0; i < n; ++i) {
+          uint64_t v = (i % 97 == 5) ? gold[k].back() : pos(gen);
+          entries.emplace_back(k, from_int<T>(v));
+          gold[k].emplace_back(v);
+        }
+      }
+      for (auto & x : gold) std::sort(x.second.begin(), x.second.end());
+      std::shuffle(entries.begin(), entries.end(), gen);
+    }
+
+    void check(::fsc::compressed_multimap<uint32_t, T> const & test) {
+      EXPECT_EQ(entries.size(), test.size());
+      EXPECT_EQ(gold.size(), test.unique_size());
+
+      for (auto const & x : gold) {
+        ASSERT_EQ(x.second.size(), test.count(x.first));
+
+        std::vector<std::pair<uint32_t, T> > found;
+        test.find(x.first, std::back_inserter(found));
+        ASSERT_EQ(x.second.size(), found.size());
+
+        std::vector<uint64_t> vals;
+        for (auto const & f : found) {
+          EXPECT_EQ(x.first, f.first);
+          vals.emplace_back(as_int(f.second));
+        }
+        std::sort(vals.begin(), vals.end());
+        EXPECT_EQ(x.second, vals) << "key " << x.first;
+      }
+
+      EXPECT_EQ(0UL, test.count(12345));
+      std::vector<std::pair<uint32_t, T> > none;
+      test.find(12345, std::back_inserter(none));
+      EXPECT_EQ(0UL, none.size());
+    }
+};
+
+typedef ::testing::Types<uint64_t, packed_id> CompressedMultimapTestTypes;
+TYPED_TEST_CASE(CompressedMultimapTest, CompressedMultimapTestTypes);
+
+
+TYPED_TEST(CompressedMultimapTest, find)
+{
+  ::fsc::compressed_multimap<uint32_t, TypeParam> test(this->entries.begin(), this->entries.end());
+  this->check(test);
+
+  // the frequent keys take about 2 + log2(2^40 / n) bits per value instead of a pair each.
+  size_t listed = 0;
+  for (auto const & x : this->gold) if (x.second.size() >= 8) listed += x.second.size();
+  EXPECT_LT(test.list_bytes() * 2, listed * sizeof(std::pair<uint32_t, TypeParam>));
+}
+
+TYPED_TEST(CompressedMultimapTest, insert_rebuild)
+{
+  // insert in 2 batches:  the second rebuild merges with the existing lists.
+  size_t half = this->entries.size() / 2;
+  ::fsc::compressed_multimap<uint32_t, TypeParam> test(this->entries.begin(), this->entries.begin() + half);
+  test.build();
+  test.insert(this->entries.begin() + half, this->entries.end());
+  this->check(test);
+
+  std::vector<std::pair<uint32_t, TypeParam> > all;
+  test.to_vector(all);
+  EXPECT_EQ(this->entries.size(), all.size());
+}
+
+TEST(CompressedMultimap, dense)
+{
+  // consecutive values:  no low bits, 2 bits per value.
+  std::vector<std::pair<uint32_t, uint64_t> > entries;
+  for (uint64_t i = 0; i < 64000; ++i) entries.emplace_back(7, 1000000 + i);
+
+  ::fsc::compressed_multimap<uint32_t, uint64_t> test(entries.begin(), entries.end());
+  std::vector<std::pair<uint32_t, uint64_t> > found;
+  test.find(7, std::back_inserter(found));
+  EXPECT_TRUE(entries == found);
+  EXPECT_LT(test.list_bytes(), 64000UL * 2 / 8 + 64);
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * test_concurrent_count_table.cpp
+ *   Test that concurrent increments from several threads give the same counts as a serial count, that a full table
+ *   refuses new keys only, and that parallel_count matches a serial count with and without its fallback.  Also check
+ *   the slot size.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/concurrent_count_table.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <utility>  // pair
+#include <vector>
+
+
+struct MixHash {
+    inline uint64_t operator()(uint64_t x) const {
+      x ^= x >> 33;
+      x *= 0xff51afd7ed558ccdULL;
+      x ^= x >> 33;
+      return x;
+    }
+};
+
+using TableType = ::fsc::concurrent_count_table<uint64_t, uint32_t, MixHash, ::std::equal_to<uint64_t> >;
+
+class ConcurrentCountTableTest : public ::testing::Test
+{
+  protected:
+    ::std::vector<uint64_t> input;
+    ::std::unordered_map<uint64_t, uint32_t> gold;
+
+    virtual void SetUp()
+    {
+      // skewed, so that threads collide on the frequent keys.
+      std::default_random_engine gen(11);
+      std::geometric_distribution<uint64_t> dist(0.001);
+      for (size_t i = 0; i < 200000; ++i) {
+        input.emplace_back(dist(gen) * 7919);
+        ++gold[input.back()];
+      }
+    }
+
+    static ::std::unordered_map<uint64_t, uint32_t> as_map(::std::vector<::std::pair<uint64_t, uint32_t> > const & v) {
+      ::std::unordered_map<uint64_t, uint32_t> out;
+      for (auto const & x : v) out[x.first] += x.second;
+      return out;
+    }
+};
+
+
+TEST_F(ConcurrentCountTableTest, threads)
+{
+  TableType table(gold.size());
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 4; ++t) {
+    threads.emplace_back([this, &table, t]() {
+      for (size_t i = t; i < input.size(); i += 4) table.add(input[i], 1);
+    });
+  }
+  for (auto & t : threads) t.join();
+
+  std::vector<std::pair<uint64_t, uint32_t> > result;
+  table.to_vector(result);
+  EXPECT_EQ(gold.size(), table.size());
+  EXPECT_EQ(gold.size(), result.size());   // each key in 1 slot.
+  EXPECT_TRUE(gold == as_map(result));
+}
+
+TEST_F(ConcurrentCountTableTest, slot_size)
+{
+  // the state byte goes in the padding after a 32 bit count.
+  EXPECT_EQ(16UL, TableType::slot_bytes());
+}
+
+TEST_F(ConcurrentCountTableTest, full)
+{
+  TableType table(10);
+  size_t limit = table.capacity() / 2;
+
+  std::vector<uint64_t> added;
+  for (auto const & g : gold) {
+    if (table.add(g.first, 1)) added.emplace_back(g.first);
+    else break;
+  }
+  EXPECT_EQ(limit, added.size());
+  EXPECT_EQ(limit, table.size());
+
+  // existing keys are still counted, new ones are refused.
+  EXPECT_TRUE(table.add(added.front(), 5));
+  EXPECT_FALSE(table.add(1, 1));
+
+  std::vector<std::pair<uint64_t, uint32_t> > result;
+  table.to_vector(result);
+  EXPECT_EQ(6U, as_map(result)[added.front()]);
+}
+
+TEST_F(ConcurrentCountTableTest, parallel_count)
+{
+  auto pred = [](std::pair<uint64_t, uint32_t> const & x) { return (x.first % 3) != 0; };
+  std::unordered_map<uint64_t, uint32_t> filtered;
+  for (auto const & g : gold) if (pred(g)) filtered.emplace(g);
+
+  std::vector<std::pair<uint64_t, uint32_t> > result;
+  std::unordered_map<uint64_t, uint32_t> fallback_map;
+  struct Fallback {
+      std::unordered_map<uint64_t, uint32_t> & m;
+      std::pair<std::unordered_map<uint64_t, uint32_t>::iterator, bool> insert(std::pair<uint64_t, uint32_t> const & x) {
+        return m.insert(x);
+      }
+      void to_vector(std::vector<std::pair<uint64_t, uint32_t> > & out) const {
+        out.assign(m.begin(), m.end());
+      }
+  } fallback{fallback_map};
+
+  bool done = ::fsc::parallel_count<MixHash, ::std::equal_to<uint64_t> >(input, pred, result, fallback);
+#if defined(USE_OPENMP)
+  if (omp_get_max_threads() > 1) {
+    ASSERT_TRUE(done);
+    EXPECT_EQ(filtered.size(), result.size());
+    EXPECT_TRUE(filtered == as_map(result));
+  }
+#else
+  EXPECT_FALSE(done);
+#endif
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/counting_quotient_filter.hpp"
+
+#include <map>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include <utility>  // pair
+#include <vector>
+
+using FilterType = ::fsc::counting_quotient_filter<uint64_t, uint32_t>;
+
+// fingerprints are stored exactly, so the filter is a map of fingerprints.
+void check_fingerprints(FilterType const & test, std::map<uint64_t, uint64_t> const & gold) {
+  EXPECT_EQ(gold.size(), test.size());
+  for (auto const & x : gold) {
+    ASSERT_EQ(x.second, test.count_fingerprint(x.first)) << "fingerprint " << x.first;
+  }
+
+  std::map<uint64_t, uint64_t> all;
+  test.for_each([&all](uint64_t fp, uint64_t c) { all[fp] += c; });
+  EXPECT_EQ(gold, all);
+}
+
+TEST(CountingQuotientFilter, fingerprints)
+{
+  // few quotient bits and clustered fingerprints, so runs are long, shifted, and wrap around the table.
+  for (unsigned int count_bits : {1U, 3U, 8U}) {
+    FilterType test(50, 1.0 / 16, count_bits);
+    ASSERT_EQ(6U, test.quotient_bits());
+    ASSERT_EQ(4U, test.remainder_bits());
+
+    std::default_random_engine gen(count_bits);
+    std::uniform_int_distribution<uint64_t> quot(60, 63);
+    std::uniform_int_distribution<uint64_t> rem(0, 15);
+    std::uniform_int_distribution<uint64_t> cnt(1, 20);
+    std::map<uint64_t, uint64_t> gold;
+    for (int i = 0; i < 300; ++i) {
+      uint64_t fp = (i % 3 == 0) ? ((quot(gen) << 4) | rem(gen)) : (gen() & 1023);
+      uint64_t c = cnt(gen);
+      test.insert_fingerprint(fp, c);
+      gold[fp] += c;
+      if (test.size() == test.capacity()) break;
+    }
+    EXPECT_EQ(6U, test.quotient_bits());
+    check_fingerprints(test, gold);
+
+    // absent fingerprints.
+    for (uint64_t fp = 0; fp < 1024; ++fp) {
+      if (gold.count(fp) == 0) {
+        ASSERT_EQ(0UL, test.count_fingerprint(fp)) << "fingerprint " << fp;
+      }
+    }
+  }
+}
+
+TEST(CountingQuotientFilter, grow)
+{
+  FilterType test(0, 1.0 / 1024, 4);
+  ASSERT_EQ(16U, test.fingerprint_bits());
+
+  std::default_random_engine gen(3);
+  std::map<uint64_t, uint64_t> gold;
+  std::vector<std::pair<uint64_t, uint64_t> > batch;
+  for (int i = 0; i < 5000; ++i) {
+    uint64_t fp = gen() & 0xFFFF;
+    batch.emplace_back(fp, 1);
+    gold[fp] += 1;
+    // a few heavy fingerprints, past the 4 bit counters.
+    if (i % 100 == 0) {
+      batch.emplace_back(i, 1000);
+      gold[i] += 1000;
+    }
+  }
+  test.insert_fingerprints(batch);
+
+  // 2^6 slots to 2^13, at the same fingerprint length.
+  EXPECT_EQ(16U, test.fingerprint_bits());
+  EXPECT_EQ(13U, test.quotient_bits());
+  EXPECT_LE(test.size(), test.capacity());
+  check_fingerprints(test, gold);
+
+  // a filter merged into an empty one.
+  FilterType other(0, 1.0 / 1024, 4);
+  other.merge(test);
+  check_fingerprints(other, gold);
+  other.merge(test);
+  for (auto & x : gold) x.second *= 2;
+  check_fingerprints(other, gold);
+
+  FilterType shorter(0, 1.0 / 16);
+  EXPECT_THROW(shorter.merge(test), std::invalid_argument);
+
+  test.clear();
+  EXPECT_TRUE(test.empty());
+  EXPECT_EQ(0UL, test.count_fingerprint(gold.begin()->first));
+}
+
+TEST(CountingQuotientFilter, keys)
+{
+  std::default_random_engine gen(5);
+  std::vector<uint64_t> keys;
+  std::map<uint64_t, uint32_t> gold;
+  for (int i = 0; i < 100000; ++i) {
+    uint64_t k = gen();
+    size_t n = (i % 10) + 1;
+    for (size_t j = 0; j < n; ++j) keys.emplace_back(k);
+    gold[k] += n;
+  }
+  std::shuffle(keys.begin(), keys.end(), gen);
+
+  double fp_rate = 1.0 / 256;
+  FilterType test(0, fp_rate);
+  test.reserve(gold.size());
+  unsigned int f = test.fingerprint_bits();
+  test.insert(keys);
+  // sized for the keys, so it did not grow.
+  EXPECT_EQ(f, test.fingerprint_bits());
+  EXPECT_LE(test.false_positive_rate(), fp_rate);
+  EXPECT_EQ(keys.size(), test.total_count());
+
+  // never less than the true count, and rarely more.
+  size_t more = 0;
+  for (auto const & x : gold) {
+    uint32_t c = test.count(x.first);
+    ASSERT_GE(c, x.second);
+    if (c > x.second) ++more;
+  }
+  EXPECT_LT(more, gold.size() / 100);
+
+  // absent keys.
+  size_t fp = 0;
+  size_t absent = 100000;
+  for (size_t i = 0; i < absent; ++i) {
+    uint64_t k = gen();
+    if (gold.count(k) == 0) fp += (test.count(k) > 0) ? 1 : 0;
+  }
+  EXPECT_LE(static_cast<double>(fp) / absent, 2 * fp_rate);
+
+  // 4 times smaller than 16 bytes per key.
+  EXPECT_LT(test.memory_bytes(), gold.size() * 4);
+
+  // (key, count) pairs add their counts.
+  FilterType pairs(gold.size(), fp_rate);
+  std::vector<std::pair<uint64_t, uint32_t> > input(gold.begin(), gold.end());
+  pairs.insert(input);
+  for (auto const & x : gold) {
+    ASSERT_EQ(test.count(x.first), pairs.count(x.first));
+  }
+
+  EXPECT_THROW(FilterType(0, 0.0), std::invalid_argument);
+  EXPECT_THROW(FilterType(0, 0.5, 0), std::invalid_argument);
+}
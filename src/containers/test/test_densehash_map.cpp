@@ -27,6 +27,7 @@
 #include <algorithm>  // for transform.
 #include <cstdint>  // uint32_t
 #include <utility>  // pair
+#include <thread>
 #include <vector>
 
 // include files to test
@@ -391,8 +392,88 @@ TYPED_TEST_P(DenseHashMapFullTest, count_full)
 
 
 
+TYPED_TEST_P(DenseHashMapFullTest, insert_stashed)
+{
+  using MAP = ::fsc::stashed_densehash_map<TypeParam, TypeParam, full_special_keys<TypeParam> >;
+
+  // max and max - 1 of the type are the empty and deleted keys of the table.
+  TypeParam mx = ::std::numeric_limits<TypeParam>::max();
+  this->gold.emplace(mx, 3);
+  this->gold.emplace(mx - 1, 4);
+  this->temp.emplace_back(mx, 3);
+  this->temp.emplace_back(mx - 1, 4);
+
+  MAP test(this->temp.begin(), this->temp.end());
+
+  EXPECT_EQ(2UL, test.stash_size());
+  EXPECT_EQ(this->gold.size(), test.size());
+
+  ::std::vector<::std::pair<TypeParam, TypeParam> > test_vals = test.to_vector();
+  ::std::vector<::std::pair<TypeParam, TypeParam> > gold_vals(this->gold.begin(), this->gold.end());
+  ::std::sort(test_vals.begin(), test_vals.end());
+  ::std::sort(gold_vals.begin(), gold_vals.end());
+  EXPECT_TRUE(test_vals == gold_vals);
+
+  size_t n = 0;
+  for (auto it = test.begin(); it != test.end(); ++it) ++n;
+  EXPECT_EQ(this->gold.size(), n);
+
+  // bucket scans see the stash too.
+  n = 0;
+  for (size_t b = 0; b < test.bucket_count(); ++b) n += ::std::distance(test.begin(b), test.end(b));
+  EXPECT_EQ(this->gold.size(), n);
+
+  for (auto const & g : this->gold) {
+    EXPECT_EQ(1UL, test.count(g.first));
+    EXPECT_TRUE(test.exists(g.first));
+    auto it = test.find(g.first);
+    ASSERT_TRUE(it != test.end());
+    EXPECT_EQ(g.second, (*it).second);
+  }
+}
+
+TYPED_TEST_P(DenseHashMapFullTest, erase_stashed)
+{
+  using MAP = ::fsc::stashed_densehash_map<TypeParam, TypeParam, full_special_keys<TypeParam> >;
+
+  // max and max - 1 of the type are the empty and deleted keys of the table.
+  TypeParam mx = ::std::numeric_limits<TypeParam>::max();
+  this->gold.emplace(mx, 3);
+  this->gold.emplace(mx - 1, 4);
+  this->temp.emplace_back(mx, 3);
+  this->temp.emplace_back(mx - 1, 4);
+
+  MAP test(this->temp.begin(), this->temp.end());
+
+  // erase the odd keys, including max, but not max - 1.
+  ::std::vector<TypeParam> odd;
+  for (auto const & g : this->gold) if (g.first & 1) odd.emplace_back(g.first);
+  EXPECT_EQ(odd.size(), test.erase(odd.begin(), odd.end()));
+  EXPECT_EQ(1UL, test.stash_size());
+  EXPECT_EQ(this->gold.size() - odd.size(), test.size());
+
+  for (auto const & g : this->gold) {
+    EXPECT_EQ((g.first & 1) ? 0UL : 1UL, test.count(g.first));
+    EXPECT_EQ((g.first & 1) == 0, test.find(g.first) != test.end());
+  }
+
+  // reinsert max, then keep the large keys only.
+  test.insert(::std::make_pair(mx, TypeParam(1)));
+  EXPECT_EQ(2UL, test.stash_size());
+
+  TypeParam half = mx / 2;
+  test.retain_if([&half](::std::pair<const TypeParam, TypeParam> const & x) { return x.first > half; });
+  test.compact();
+  EXPECT_EQ(2UL, test.stash_size());
+  for (auto const & g : this->gold) {
+    bool kept = (g.first > half) && (((g.first & 1) == 0) || (g.first >= mx - 1));
+    EXPECT_EQ(kept, test.exists(g.first));
+  }
+}
+
+
 // now register the test cases
-REGISTER_TYPED_TEST_CASE_P(DenseHashMapFullTest, insert_full, equal_range_full, count_full);
+REGISTER_TYPED_TEST_CASE_P(DenseHashMapFullTest, insert_full, equal_range_full, count_full, insert_stashed, erase_stashed);
 
 
 //////////////////// RUN the tests with different types.
@@ -546,6 +627,31 @@ TYPED_TEST_P(DenseHashMultimapPartialTest, equal_range_partial)
 }
 
 
+TYPED_TEST_P(DenseHashMultimapPartialTest, equal_range_span_partial)
+{
+  using MAP = ::fsc::densehash_multimap<TypeParam, TypeParam>;
+
+  MAP test(this->temp.begin(), this->temp.end());
+
+  for (auto const & x : this->temp) {
+    auto span = test.equal_range_span(x.first);
+    auto range = test.equal_range(x.first);
+    ASSERT_EQ(static_cast<size_t>(::std::distance(range.first, range.second)), span.size());
+    EXPECT_EQ(&(*range.first), span.data());
+
+    ::std::vector<TypeParam> test_vals;
+    for (auto const & y : span) test_vals.push_back(y.second);
+    ::std::vector<TypeParam> gold_vals;
+    auto gold_range = this->gold.equal_range(x.first);
+    for (auto it = gold_range.first; it != gold_range.second; ++it) gold_vals.push_back(it->second);
+
+    ::std::sort(test_vals.begin(), test_vals.end());
+    ::std::sort(gold_vals.begin(), gold_vals.end());
+    EXPECT_EQ(gold_vals, test_vals);
+  }
+}
+
+
 TYPED_TEST_P(DenseHashMultimapPartialTest, count_partial)
 {
 	  using MAP = ::fsc::densehash_multimap<TypeParam, TypeParam>;
@@ -572,7 +678,7 @@ TYPED_TEST_P(DenseHashMultimapPartialTest, count_partial)
 
 
 // now register the test cases
-REGISTER_TYPED_TEST_CASE_P(DenseHashMultimapPartialTest, insert_partial, equal_range_partial, count_partial);
+REGISTER_TYPED_TEST_CASE_P(DenseHashMultimapPartialTest, insert_partial, equal_range_partial, equal_range_span_partial, count_partial);
 
 
 //////////////////// RUN the tests with different types.
@@ -1520,3 +1626,132 @@ INSTANTIATE_TYPED_TEST_CASE_P(Bliss, DenseHashKmerMultimapTest, DenseHashKmerMul
 
 
 
+
+
+
+// concurrent lookups through a frozen handle, on split maps so the splitter is exercised too.
+TEST(DenseHashFrozenTest, concurrent_lookup)
+{
+  using MAP = ::fsc::densehash_map<uint32_t, uint32_t, full_special_keys<uint32_t> >;
+  using MULTIMAP = ::fsc::densehash_multimap<uint32_t, uint32_t, full_special_keys<uint32_t> >;
+
+  std::default_random_engine generator(17);
+  std::uniform_int_distribution<uint32_t> distribution(0, ::std::numeric_limits<uint32_t>::max() - 2);
+  ::std::vector<::std::pair<uint32_t, uint32_t> > temp;
+  ::std::unordered_map<uint32_t, size_t> gold;
+  for (size_t i = 0; i < 100000; ++i) {
+    uint32_t key = distribution(generator) % 50000 * 85899;  // spans the lower and upper tables, with repeats.
+    temp.emplace_back(key, i);
+    ++gold[key];
+  }
+
+  MAP map(temp.begin(), temp.end());
+  MULTIMAP multimap;
+  multimap.insert(temp);
+  auto fmap = ::fsc::freeze(map);
+  auto fmultimap = ::fsc::freeze(multimap);
+
+  ::std::vector<uint32_t> queries;
+  for (auto const & g : gold) {
+    queries.emplace_back(g.first);
+    queries.emplace_back(g.first + 1);  // mostly absent.
+  }
+
+  ::std::vector<int> ok(4, 0);
+  ::std::vector<::std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t]() {
+      bool good = true;
+      for (size_t i = t; i < queries.size(); i += 2) {
+        auto it = gold.find(queries[i]);
+        size_t expected = (it == gold.end()) ? 0 : it->second;
+        good &= (fmap.count(queries[i]) == ((expected > 0) ? 1UL : 0UL));
+        good &= (map.exists(queries[i]) == (expected > 0));
+        good &= (fmultimap.count(queries[i]) == expected);
+        auto range = fmultimap.equal_range(queries[i]);
+        good &= (static_cast<size_t>(::std::distance(range.first, range.second)) == expected);
+      }
+      ok[t] = good;
+    });
+  }
+  for (auto & t : threads) t.join();
+  EXPECT_EQ(::std::vector<int>(4, 1), ok);
+
+  // split into parts, the results come back in query order.
+  auto lookup = [](decltype(fmultimap) const & db, ::std::vector<uint32_t>::const_iterator first,
+                   ::std::vector<uint32_t>::const_iterator last,
+                   ::fsc::back_emplace_iterator<::std::vector<::std::pair<uint32_t, size_t> > > & out) {
+    size_t n = ::std::distance(first, last);
+    for (; first != last; ++first) {
+      *out = ::std::make_pair(*first, db.count(*first));
+      ++out;
+    }
+    return n;
+  };
+  ::std::vector<::std::pair<uint32_t, size_t> > results;
+  ::fsc::parallel_lookup(fmultimap, queries.cbegin(), queries.cend(), results, lookup);
+  ASSERT_EQ(queries.size(), results.size());
+  bool same = true;
+  for (size_t i = 0; i < queries.size(); ++i) {
+    same &= (results[i].first == queries[i]) && (results[i].second == multimap.count(queries[i]));
+  }
+  EXPECT_TRUE(same);
+}
+
+
+template <typename MAP>
+void check_locality_order(size_t reserve) {
+  std::default_random_engine generator(23);
+  std::uniform_int_distribution<uint32_t> distribution(0, ::std::numeric_limits<uint32_t>::max() - 2);
+  ::std::vector<::std::pair<uint32_t, uint32_t> > temp;
+  for (uint32_t i = 0; i < 200000; ++i) {
+    temp.emplace_back(distribution(generator) % 80000 * 53687, i);   // lower and upper tables, with repeats.
+  }
+
+  MAP map;
+  map.resize(reserve);
+  // values of each key in input order.
+  auto by_key = [](::std::vector<::std::pair<uint32_t, uint32_t> > const & v) {
+    ::std::unordered_map<uint32_t, ::std::vector<uint32_t> > m;
+    for (auto const & x : v) m[x.first].emplace_back(x.second);
+    return m;
+  };
+
+  auto ordered = temp;
+  map.locality_order(ordered.begin(), ordered.end());
+  EXPECT_EQ(reserve > 0, ordered != temp);
+  EXPECT_TRUE(by_key(temp) == by_key(ordered));
+
+  ::std::vector<uint32_t> keys, ordered_keys;
+  for (auto const & x : temp) keys.emplace_back(x.first);
+  ordered_keys = keys;
+  map.locality_order(ordered_keys.begin(), ordered_keys.end());
+  EXPECT_EQ(reserve > 0, ordered_keys != keys);
+  for (size_t i = 0; i < ordered.size(); ++i) {
+    ASSERT_EQ(ordered[i].first, ordered_keys[i]);
+  }
+
+  // the first of duplicate keys is still the one kept.
+  auto input = temp;
+  size_t buckets = map.bucket_count();
+  map.insert(input);
+  if (reserve > 0) EXPECT_EQ(buckets, map.bucket_count());
+  auto gold = by_key(temp);
+  EXPECT_EQ(gold.size(), map.size());
+  bool same = true;
+  for (auto it = map.cbegin(); it != map.cend(); ++it) {
+    auto g = gold.find(it->first);
+    same &= (g != gold.end()) && (it->second == g->second.front());
+  }
+  EXPECT_TRUE(same);
+}
+
+TEST(DenseHashLocalityTest, locality_order)
+{
+  // 8 byte buckets:  2^20 buckets are 8MB, in 1MB regions.  an empty table is not reordered.
+  check_locality_order<::fsc::densehash_map<uint32_t, uint32_t, full_special_keys<uint32_t> > >(1UL << 20);
+  check_locality_order<::fsc::densehash_map<uint32_t, uint32_t, full_special_keys<uint32_t> > >(0);
+  check_locality_order<::fsc::densehash_map<uint32_t, uint32_t> >(1UL << 20);
+  check_locality_order<::fsc::stashed_densehash_map<uint32_t, uint32_t, full_special_keys<uint32_t> > >(1UL << 20);
+  check_locality_order<::fsc::stashed_densehash_map<uint32_t, uint32_t, full_special_keys<uint32_t> > >(0);
+}
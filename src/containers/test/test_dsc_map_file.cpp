@@ -0,0 +1,120 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/dsc_map_file.hpp"
+
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdio>   // remove
+#include <cstdlib>  // mkstemp
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+
+
+class MapSegmentFileTest : public ::testing::Test
+{
+  protected:
+    using KmerType = ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>;
+    using EntryType = ::std::pair<KmerType, uint32_t>;
+
+    std::string prefix;
+    std::vector<EntryType> entries;
+
+    virtual void SetUp()
+    {
+      char name[] = "/tmp/bliss_test_segXXXXXX";
+      int fd = mkstemp(name);
+      ASSERT_TRUE(fd >= 0);
+      close(fd);
+      remove(name);
+      prefix = name;
+
+      std::default_random_engine generator;
+      std::uniform_int_distribution<uint64_t> distribution;
+      for (size_t i = 0; i < 10000; ++i) {
+        KmerType km;
+        km.getDataRef()[0] = distribution(generator) & 0x3FFFFFFFFFFFFFFFULL;
+        entries.emplace_back(km, static_cast<uint32_t>(i));
+      }
+    }
+
+    virtual void TearDown() {
+      for (int i = 0; i < 3; ++i) remove(::dsc::map_segment_filename(prefix, i).c_str());
+    }
+
+    ::dsc::map_segment_header header(char const * type_name, int rank, size_t count) const {
+      return ::dsc::make_map_segment_header<KmerType, uint32_t>(type_name, rank, 3, count);
+    }
+};
+
+
+TEST_F(MapSegmentFileTest, roundtrip)
+{
+  std::string fn = ::dsc::map_segment_filename(prefix, 1);
+  ::dsc::write_map_segment(fn, header("map", 1, entries.size()), entries.data());
+
+  ::dsc::map_segment_header h;
+  ASSERT_TRUE(::dsc::read_map_segment_header(fn, h));
+  EXPECT_EQ(31U, h.k);
+  EXPECT_EQ(2U, h.bits_per_char);
+  EXPECT_EQ(1, h.rank);
+  EXPECT_EQ(3, h.nranks);
+  EXPECT_EQ(entries.size(), h.count);
+
+  ::dsc::mapped_map_segment<EntryType> seg(fn, header("map", 0, 0));
+  ASSERT_EQ(entries.size(), seg.size());
+  EXPECT_EQ(0UL, reinterpret_cast<uintptr_t>(seg.begin()) % ::dsc::map_segment_header::data_offset);
+  EXPECT_TRUE(std::equal(entries.begin(), entries.end(), seg.begin()));
+}
+
+TEST_F(MapSegmentFileTest, empty)
+{
+  std::string fn = ::dsc::map_segment_filename(prefix, 0);
+  ::dsc::write_map_segment(fn, header("map", 0, 0), entries.data());
+
+  ::dsc::mapped_map_segment<EntryType> seg(fn, header("map", 0, 0));
+  EXPECT_EQ(0UL, seg.size());
+  EXPECT_EQ(seg.begin(), seg.end());
+}
+
+TEST_F(MapSegmentFileTest, mismatch)
+{
+  std::string fn = ::dsc::map_segment_filename(prefix, 2);
+  ::dsc::write_map_segment(fn, header("map", 2, entries.size()), entries.data());
+
+  // different map type
+  EXPECT_THROW(::dsc::mapped_map_segment<EntryType> seg(fn, header("other_map", 0, 0)), ::bliss::io::IOException);
+
+  // different kmer
+  using Kmer2 = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+  EXPECT_THROW((::dsc::mapped_map_segment<::std::pair<Kmer2, uint32_t> >(fn,
+      ::dsc::make_map_segment_header<Kmer2, uint32_t>("map", 0, 3, 0))), ::bliss::io::IOException);
+
+  // missing
+  EXPECT_THROW(::dsc::mapped_map_segment<EntryType> seg(::dsc::map_segment_filename(prefix, 0), header("map", 0, 0)),
+               ::bliss::io::IOException);
+  ::dsc::map_segment_header h;
+  EXPECT_FALSE(::dsc::read_map_segment_header(::dsc::map_segment_filename(prefix, 0), h));
+
+  // truncated
+  ASSERT_EQ(0, truncate(fn.c_str(), ::dsc::map_segment_header::data_offset + 100));
+  EXPECT_THROW(::dsc::mapped_map_segment<EntryType> seg(fn, header("map", 0, 0)), ::bliss::io::IOException);
+}
@@ -0,0 +1,231 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/fsc_container_utils.hpp"
+
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>  // shuffle
+#include <random>
+#include <cstdint>
+#include <utility>  // pair
+#include <vector>
+
+
+class CountHistogramTest : public ::testing::Test
+{
+  protected:
+    std::vector<std::pair<uint64_t, uint32_t> > entries;
+    std::vector<size_t> gold;
+
+    static constexpr size_t max_count = 50;
+
+    virtual void SetUp()
+    {
+      std::default_random_engine gen(23);
+      std::geometric_distribution<uint32_t> count(0.05);
+
+      // enough entries for the parallel scan.
+      gold.assign(max_count + 1, 0);
+      for (uint64_t k = 0; k < 200000; ++k) {
+        uint32_t c = count(gen) + 1;
+        entries.emplace_back(k * 7919, c);
+        ++gold[std::min(static_cast<size_t>(c), max_count)];
+      }
+    }
+};
+constexpr size_t CountHistogramTest::max_count;
+
+
+TEST_F(CountHistogramTest, vector)
+{
+  std::vector<size_t> hist(max_count + 1, 0);
+  ::fsc::count_histogram(this->entries, hist);
+  EXPECT_EQ(this->gold, hist);
+}
+
+TEST_F(CountHistogramTest, buckets)
+{
+  std::unordered_map<uint64_t, uint32_t> table(this->entries.begin(), this->entries.end());
+  std::vector<size_t> hist(max_count + 1, 0);
+  ::fsc::count_histogram(table, hist);
+  EXPECT_EQ(this->gold, hist);
+}
+
+TEST_F(CountHistogramTest, serial)
+{
+  std::map<uint64_t, uint32_t> table(this->entries.begin(), this->entries.end());
+  std::vector<size_t> hist(max_count + 1, 0);
+  ::fsc::count_histogram(table, hist);
+  EXPECT_EQ(this->gold, hist);
+
+  // accumulates.
+  ::fsc::count_histogram(table, hist);
+  for (size_t i = 0; i <= max_count; ++i) EXPECT_EQ(2 * this->gold[i], hist[i]);
+}
+
+TEST(CountHistogram, single_bin)
+{
+  std::vector<std::pair<int, int> > table = { {1, 3}, {2, 1}, {3, 100} };
+  std::vector<size_t> hist(1, 0);
+  ::fsc::count_histogram(table, hist);
+  EXPECT_EQ(3UL, hist[0]);
+}
+
+
+namespace {
+  /// sums counts of even keys, through parallel_for_each.
+  struct even_sum {
+      std::vector<size_t> & per_key;
+      void operator()(std::pair<const uint64_t, uint32_t> const & x) const {
+        // distinct keys:  no two threads write the same slot.
+        if ((x.first % 2) == 0) per_key[x.first / 7919] = x.second;
+      }
+      void operator()(std::pair<uint64_t, uint32_t> const & x) const {
+        if ((x.first % 2) == 0) per_key[x.first / 7919] = x.second;
+      }
+  };
+}
+
+TEST_F(CountHistogramTest, for_each_and_reduce)
+{
+  size_t gold_sum = 0;
+  std::vector<size_t> gold_even(this->entries.size(), 0);
+  for (auto const & x : this->entries) {
+    gold_sum += x.second;
+    if ((x.first % 2) == 0) gold_even[x.first / 7919] = x.second;
+  }
+
+  auto count = [](std::pair<const uint64_t, uint32_t> const & x) { return static_cast<size_t>(x.second); };
+  std::unordered_map<uint64_t, uint32_t> table(this->entries.begin(), this->entries.end());
+  EXPECT_EQ(gold_sum, ::fsc::transform_reduce(table, static_cast<size_t>(0), count, std::plus<size_t>()));
+
+  std::vector<size_t> even(this->entries.size(), 0);
+  ::fsc::parallel_for_each(table, even_sum{even});
+  EXPECT_EQ(gold_even, even);
+
+  std::fill(even.begin(), even.end(), 0);
+  ::fsc::parallel_for_each(this->entries, even_sum{even});
+  EXPECT_EQ(gold_even, even);
+
+  auto maxval = [](std::pair<uint64_t, uint32_t> const & x) { return x.second; };
+  auto larger = [](uint32_t x, uint32_t y) { return std::max(x, y); };
+  uint32_t gold_max = 0;
+  for (auto const & x : this->entries) gold_max = std::max(gold_max, x.second);
+  EXPECT_EQ(gold_max, ::fsc::transform_reduce(this->entries, 0U, maxval, larger));
+
+  std::map<uint64_t, uint32_t> ordered(this->entries.begin(), this->entries.end());
+  EXPECT_EQ(gold_sum, ::fsc::transform_reduce(ordered, static_cast<size_t>(0), count, std::plus<size_t>()));
+}
+
+
+TEST(QueryFanout, count)
+{
+  std::default_random_engine gen(31);
+  std::uniform_int_distribution<uint64_t> key(0, 999);
+
+  // about 40% duplicates.
+  std::vector<uint64_t> queries;
+  for (size_t i = 0; i < 1600; ++i) queries.push_back(key(gen));
+
+  ::fsc::query_fanout<uint64_t, std::hash<uint64_t>, std::equal_to<uint64_t> > fan;
+  size_t n = fan.dedup(queries.begin(), queries.end());
+  std::unordered_set<uint64_t> gold_unique(queries.begin(), queries.end());
+  EXPECT_EQ(gold_unique.size(), n);
+  EXPECT_EQ(queries.size(), fan.queries());
+  EXPECT_EQ(fan.get_unique(), fan.select_unique(queries));
+  EXPECT_EQ(queries[0], fan.get_unique()[0]);
+
+  // answer the unique keys out of order, and skip the multiples of 5.
+  std::vector<std::pair<uint64_t, uint32_t> > answers;
+  for (auto const & k : fan.get_unique()) {
+    if ((k % 5) != 0) answers.emplace_back(k, static_cast<uint32_t>(k * 3));
+  }
+  std::shuffle(answers.begin(), answers.end(), gen);
+
+  auto results = fan.scatter(answers, 7U);
+  ASSERT_EQ(queries.size(), results.size());
+  for (size_t i = 0; i < queries.size(); ++i) {
+    EXPECT_EQ(queries[i], results[i].first);
+    EXPECT_EQ(((queries[i] % 5) == 0) ? 7U : queries[i] * 3, results[i].second);
+  }
+}
+
+TEST(QueryFanout, find)
+{
+  std::default_random_engine gen(37);
+  std::uniform_int_distribution<uint64_t> key(0, 299);
+
+  std::vector<uint64_t> queries;
+  for (size_t i = 0; i < 800; ++i) queries.push_back(key(gen));
+
+  // keys compared modulo 100, e.g. as canonical k-mers.
+  struct mod_hash { size_t operator()(uint64_t const & x) const { return x % 100; } };
+  struct mod_equal { bool operator()(uint64_t const & x, uint64_t const & y) const { return (x % 100) == (y % 100); } };
+  ::fsc::query_fanout<uint64_t, mod_hash, mod_equal> fan;
+  EXPECT_EQ(100UL, fan.dedup(queries.begin(), queries.end()));
+
+  // k % 3 answers per key, with the values in order.
+  std::vector<std::pair<uint64_t, uint32_t> > answers;
+  for (auto const & k : fan.get_unique()) {
+    for (uint32_t v = 0; v < (k % 100) % 3; ++v) answers.emplace_back(k % 100 + 100 * v, v);
+  }
+  std::stable_sort(answers.begin(), answers.end(),
+                   [](std::pair<uint64_t, uint32_t> const & x, std::pair<uint64_t, uint32_t> const & y) {
+    return x.second < y.second;
+  });
+
+  std::vector<size_t> offsets;
+  auto results = fan.scatter(answers, offsets);
+  ASSERT_EQ(queries.size() + 1, offsets.size());
+  EXPECT_EQ(results.size(), offsets.back());
+  for (size_t i = 0; i < queries.size(); ++i) {
+    ASSERT_EQ((queries[i] % 100) % 3, offsets[i + 1] - offsets[i]);
+    for (size_t o = offsets[i]; o < offsets[i + 1]; ++o) {
+      EXPECT_EQ(queries[i] % 100, results[o].first % 100);
+      EXPECT_EQ(o - offsets[i], results[o].second);
+    }
+  }
+}
+
+TEST(Gallop, bounds)
+{
+  std::default_random_engine gen(41);
+  std::uniform_int_distribution<int> val(0, 999);
+
+  for (size_t n : {0, 1, 2, 7, 64, 1000, 5000}) {
+    std::vector<int> data;
+    for (size_t i = 0; i < n; ++i) data.push_back(val(gen));
+    std::sort(data.begin(), data.end());
+
+    // from the start, and from an earlier answer as the sorted query processing does.
+    auto prev = data.begin();
+    for (int v = -1; v <= 1001; ++v) {
+      auto lb = std::lower_bound(data.begin(), data.end(), v);
+      auto ub = std::upper_bound(data.begin(), data.end(), v);
+      EXPECT_EQ(lb, ::fsc::gallop_lower_bound(data.begin(), data.end(), v, std::less<int>()));
+      EXPECT_EQ(ub, ::fsc::gallop_upper_bound(data.begin(), data.end(), v, std::less<int>()));
+      EXPECT_EQ(lb, ::fsc::lower_bound<false>(prev, data.end(), v, std::less<int>()));
+      EXPECT_EQ(lb, ::fsc::lower_bound<true>(prev, data.end(), v, std::less<int>()));
+      EXPECT_EQ(ub, ::fsc::upper_bound<false>(lb, data.end(), v, std::less<int>()));
+      prev = lb;
+    }
+  }
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/fsc_radix_sort.hpp"
+
+#include "common/alphabets.hpp"
+
+#include <random>
+#include <algorithm>  // for sort.
+#include <cstdint>  // uint32_t
+#include <utility>  // pair
+#include <vector>
+
+
+/*
+ * test class holding some information.  Also, needed for the typed tests
+ */
+template<typename Kmer>
+class RadixSortTest : public ::testing::Test
+{
+  protected:
+    using valType = ::std::pair<Kmer, uint32_t>;
+    using Less = ::fsc::TransformedComparator<Kmer, ::std::less, ::bliss::transform::identity>;
+
+    ::std::vector<valType> input;
+
+    size_t iters = 100000;
+
+    virtual void SetUp()
+    { // generate some inputs.  few distinct characters, so there are duplicate keys.
+
+      std::default_random_engine generator;
+      std::uniform_int_distribution<int> distribution(0, 3);
+
+      Kmer km;
+      for (size_t i=0; i< iters; ++i) {
+        km.nextFromChar(distribution(generator));
+        input.emplace_back(km, i);
+        if ((i % 7) == 0) input.emplace_back(km, i);
+      }
+    }
+
+    static bool less(valType const &x, valType const &y) {
+      return x.first < y.first;
+    }
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(RadixSortTest);
+
+TYPED_TEST_P(RadixSortTest, radix_sort)
+{
+  using Less = typename TestFixture::Less;
+  static_assert(::fsc::radix_key<Less, typename TestFixture::valType>::value, "k-mer pairs should be radix sortable");
+
+  auto gold = this->input;
+  ::std::stable_sort(gold.begin(), gold.end(), TestFixture::less);
+
+  // radix sort is stable.
+  auto test = this->input;
+  ::fsc::fast_sort(test, Less());
+  EXPECT_TRUE(::std::equal(gold.begin(), gold.end(), test.begin()));
+
+  ::std::vector<TypeParam> keys, gold_keys;
+  for (auto x : this->input) keys.push_back(x.first);
+  for (auto x : gold) gold_keys.push_back(x.first);
+  ::fsc::fast_sort(keys, Less());
+  EXPECT_TRUE(::std::equal(gold_keys.begin(), gold_keys.end(), keys.begin()));
+}
+
+TYPED_TEST_P(RadixSortTest, small_sort)
+{
+  using Less = typename TestFixture::Less;
+  using valType = typename TestFixture::valType;
+
+  // short runs, around the power of 2 and small_sort_max boundaries.  the result is that of a stable sort whether
+  // the network or the fallback sorted it.
+  for (size_t n : {0UL, 1UL, 2UL, 3UL, 5UL, 8UL, 9UL, 31UL, 64UL, 100UL, 255UL, 256UL, 257UL}) {
+    for (size_t start = 0; start + n <= this->input.size(); start += 15013) {
+      ::std::vector<valType> gold(this->input.begin() + start, this->input.begin() + start + n);
+      ::std::vector<valType> test = gold;
+      ::std::vector<valType> range = gold;
+      ::std::stable_sort(gold.begin(), gold.end(), TestFixture::less);
+
+      ::fsc::fast_sort(test, Less());
+      EXPECT_TRUE(::std::equal(gold.begin(), gold.end(), test.begin())) << "n=" << n << " start=" << start;
+      ::fsc::fast_sort(range.begin(), range.end(), Less());
+      for (size_t i = 0; i < n; ++i) EXPECT_TRUE(gold[i].first == range[i].first) << "n=" << n << " i=" << i;
+
+      ::std::vector<TypeParam> keys, gold_keys;
+      for (auto x : test) gold_keys.push_back(x.first);
+      for (size_t i = 0; i < n; ++i) keys.push_back(this->input[start + (i * 7) % n].first);
+      ::std::sort(gold_keys.begin(), gold_keys.end());
+      ::fsc::fast_sort(keys, Less());
+      EXPECT_TRUE(::std::equal(gold_keys.begin(), gold_keys.end(), keys.begin())) << "n=" << n;
+    }
+  }
+
+  // the largest key, as the padding is.
+  TypeParam ones;
+  for (unsigned int i = 0; i < TypeParam::size; ++i) ones.nextFromChar(3);
+  ::std::vector<valType> test;
+  for (uint32_t i = 0; i < 13; ++i) test.emplace_back((i % 3 == 0) ? ones : this->input[i].first, i);
+  ::std::vector<valType> gold = test;
+  ::std::stable_sort(gold.begin(), gold.end(), TestFixture::less);
+  ::fsc::fast_sort(test, Less());
+  EXPECT_TRUE(::std::equal(gold.begin(), gold.end(), test.begin()));
+}
+
+TYPED_TEST_P(RadixSortTest, multiway_merge)
+{
+  using Less = typename TestFixture::Less;
+
+  auto gold = this->input;
+  ::std::stable_sort(gold.begin(), gold.end(), TestFixture::less);
+
+  for (size_t k : {1UL, 2UL, 5UL, 64UL}) {
+    // runs of different sizes, including empty ones.
+    auto test = this->input;
+    ::std::vector<size_t> run_sizes;
+    size_t start = 0;
+    for (size_t r = 0; r < k; ++r) {
+      size_t end = (r == k - 1) ? test.size() : (start + (test.size() - start) / ((r % 3) + 2));
+      if ((r == 1) && (r < k - 1)) end = start;
+      ::std::stable_sort(test.begin() + start, test.begin() + end, TestFixture::less);
+      run_sizes.push_back(end - start);
+      start = end;
+    }
+
+    ::std::vector<typename TestFixture::valType> buffer;
+    ::fsc::multiway_merge(test, run_sizes, Less(), buffer);
+
+    // stable across runs: equal keys keep their input order, as in stable_sort.
+    ASSERT_EQ(gold.size(), test.size());
+    EXPECT_TRUE(::std::equal(gold.begin(), gold.end(), test.begin())) << "k=" << k;
+  }
+}
+
+
+// now register the test cases
+REGISTER_TYPED_TEST_CASE_P(RadixSortTest, radix_sort, small_sort, multiway_merge);
+
+
+//////////////////// RUN the tests with different types.
+
+typedef ::testing::Types<
+    ::bliss::common::Kmer<  5, bliss::common::DNA, uint8_t>,
+    ::bliss::common::Kmer< 21, bliss::common::DNA, uint16_t>,
+    ::bliss::common::Kmer< 31, bliss::common::DNA, uint64_t>,
+    ::bliss::common::Kmer< 63, bliss::common::DNA5, uint64_t>,
+    ::bliss::common::Kmer< 96, bliss::common::DNA, uint32_t>
+> RadixSortTestTypes;
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, RadixSortTest, RadixSortTestTypes);
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/fsc_search_index.hpp"
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+
+#include <random>
+#include <algorithm>  // for sort, lower_bound
+#include <functional> // less
+#include <cstdint>    // uint64_t
+#include <utility>    // pair
+#include <vector>
+
+
+struct PairKeyLess {
+    bool operator()(uint64_t const & x, uint64_t const & y) const { return x < y; }
+    bool operator()(std::pair<uint64_t, int> const & x, uint64_t const & y) const { return x.first < y; }
+};
+
+
+TEST(EytzingerIndex, block_holds_lower_bound)
+{
+  std::default_random_engine gen(43);
+
+  for (size_t n : {0, 1, 15, 16, 17, 100, 1023, 1024, 5000, 70001}) {
+    // few distinct keys for the small sizes, so runs of equal keys span blocks.
+    std::uniform_int_distribution<uint64_t> key(0, (n < 2000) ? 50 : 1000000);
+    std::vector<std::pair<uint64_t, int> > data;
+    for (size_t i = 0; i < n; ++i) data.emplace_back(key(gen), static_cast<int>(i));
+    std::sort(data.begin(), data.end());
+
+    ::fsc::eytzinger_index<uint64_t, 16> index;
+    index.build(data.begin(), data.end(), [](std::pair<uint64_t, int> const & x) { return x.first; });
+    EXPECT_EQ((n + 15) / 16, index.size());
+    EXPECT_TRUE(index.matches(data.data(), data.size()));
+    EXPECT_FALSE(index.matches(data.data(), data.size() + 1));
+
+    std::vector<uint64_t> queries;
+    for (size_t i = 0; i < 2000; ++i) queries.push_back(key(gen));
+    if (n > 0) {
+      queries.push_back(data.front().first);
+      queries.push_back(data.back().first);
+      queries.push_back(data.back().first + 1);
+    }
+
+    for (auto q : queries) {
+      size_t lb = std::lower_bound(data.begin(), data.end(), q, PairKeyLess()) - data.begin();
+      size_t b = index.block_begin(q, PairKeyLess());
+      EXPECT_LE(b, lb) << " n " << n << " q " << q;
+      EXPECT_LE(lb, b + 16) << " n " << n << " q " << q;
+    }
+  }
+}
+
+TEST(EytzingerIndex, clear)
+{
+  std::vector<std::pair<uint64_t, int> > data(100, std::make_pair(7UL, 0));
+  ::fsc::eytzinger_index<uint64_t, 8> index;
+  index.build(data.begin(), data.end(), [](std::pair<uint64_t, int> const & x) { return x.first; });
+  EXPECT_EQ(13UL, index.size());
+  EXPECT_EQ(0UL, index.block_begin(7UL, PairKeyLess()));
+  EXPECT_EQ(96UL, index.block_begin(8UL, PairKeyLess()));
+
+  index.clear();
+  EXPECT_EQ(0UL, index.size());
+  EXPECT_EQ(0UL, index.block_begin(8UL, PairKeyLess()));
+}
+
+template <typename Key>
+void check_splitter_table(std::vector<Key> const & splitters, std::vector<Key> const & queries) {
+  ::fsc::splitter_table<Key> table;
+  table.build(splitters.begin(), splitters.end(), [](Key const & x) { return x; }, [](Key const & x) { return x; });
+  EXPECT_FALSE(table.empty());
+  EXPECT_LE(table.get_bits(), static_cast<unsigned int>(::fsc::radix_prefix<Key>::bits));
+
+  for (auto q : queries) {
+    size_t ub = std::upper_bound(splitters.begin(), splitters.end(), q) - splitters.begin();
+    auto r = table.range(q);
+    EXPECT_LE(r.first, ub) << " q " << static_cast<uint64_t>(q);
+    EXPECT_LE(ub, r.second) << " q " << static_cast<uint64_t>(q);
+    // splitters in the range share the prefix.
+    for (size_t i = r.first; i < r.second; ++i)
+      EXPECT_EQ(::fsc::radix_prefix<Key>::get(q, table.get_bits()),
+                ::fsc::radix_prefix<Key>::get(splitters[i], table.get_bits()));
+  }
+}
+
+TEST(SplitterTable, range_holds_upper_bound)
+{
+  std::default_random_engine gen(47);
+
+  for (size_t p : {1, 2, 15, 1000}) {
+    std::uniform_int_distribution<uint64_t> key;
+    std::vector<uint64_t> splitters, queries;
+    for (size_t i = 0; i < p; ++i) splitters.push_back(key(gen));
+    std::sort(splitters.begin(), splitters.end());
+    for (size_t i = 0; i < 5000; ++i) queries.push_back(key(gen));
+    queries.insert(queries.end(), splitters.begin(), splitters.end());
+    queries.push_back(0);
+    queries.push_back(~0UL);
+    check_splitter_table(splitters, queries);
+  }
+
+  // skewed:  the splitters share the top bits.
+  {
+    std::uniform_int_distribution<uint64_t> key(0, 1000);
+    std::vector<uint64_t> splitters, queries;
+    for (size_t i = 0; i < 64; ++i) splitters.push_back(key(gen));
+    std::sort(splitters.begin(), splitters.end());
+    for (size_t i = 0; i < 2000; ++i) queries.push_back(key(gen));
+    check_splitter_table(splitters, queries);
+  }
+
+  // fewer key bits than the table would use.
+  {
+    std::vector<uint8_t> splitters, queries;
+    for (int i = 0; i < 256; i += 3) splitters.push_back(i);
+    for (int i = 0; i < 256; ++i) queries.push_back(i);
+    check_splitter_table(splitters, queries);
+  }
+}
+
+TEST(SplitterTable, kmer_prefix_order)
+{
+  // the prefix does not decrease with the k-mer order, for one and for multiple words.
+  using KmerType = bliss::common::Kmer<31, bliss::common::DNA, uint64_t>;
+  using Kmer2Type = bliss::common::Kmer<40, bliss::common::DNA, uint32_t>;
+  ASSERT_TRUE(::fsc::radix_prefix<KmerType>::value);
+  ASSERT_TRUE(::fsc::radix_prefix<Kmer2Type>::value);
+
+  std::default_random_engine gen(11);
+  for (size_t t = 0; t < 10000; ++t) {
+    KmerType a, b;
+    Kmer2Type c, d;
+    for (unsigned int i = 0; i < Kmer2Type::size; ++i) {
+      if (i < KmerType::size) {
+        a.nextFromChar(gen() & 0x3);
+        b.nextFromChar(gen() & 0x3);
+      }
+      c.nextFromChar(gen() & 0x3);
+      d.nextFromChar(gen() & 0x3);
+    }
+    if (b < a) std::swap(a, b);
+    if (d < c) std::swap(c, d);
+    EXPECT_LE(::fsc::radix_prefix<KmerType>::get(a, 12), ::fsc::radix_prefix<KmerType>::get(b, 12));
+    EXPECT_LE(::fsc::radix_prefix<Kmer2Type>::get(c, 17), ::fsc::radix_prefix<Kmer2Type>::get(d, 17));
+  }
+}
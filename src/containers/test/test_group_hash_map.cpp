@@ -0,0 +1,279 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/group_hash_map.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <random>
+#include <algorithm>  // for sort.
+#include <cstdint>  // uint32_t
+#include <utility>  // pair
+#include <vector>
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "index/kmer_hash.hpp"
+#include "containers/densehash_map.hpp"
+
+
+/*
+ * test class holding some information.  Also, needed for the typed tests
+ */
+template<typename T>
+class GroupHashMapTest : public ::testing::Test
+{
+    static_assert(std::is_integral<T>::value, "only supporting integral types in tests right now.");
+  protected:
+
+    ::std::unordered_map<T, T> gold;
+    ::std::vector<std::pair<T, T>> temp;
+
+    size_t iters = 100000;
+
+    virtual void SetUp()
+    { // generate some inputs.  full range: no reserved keys.
+      std::default_random_engine generator;
+      std::uniform_int_distribution<T> distribution(::std::numeric_limits<T>::min(), ::std::numeric_limits<T>::max());
+
+      for (size_t i=0; i< iters; ++i) {
+        T key = distribution(generator);
+        T val = distribution(generator);
+        gold.emplace(key, val);
+        temp.emplace_back(::std::move(key), ::std::move(val));
+      }
+      // the values densehash_map would reserve
+      temp.emplace_back(::std::numeric_limits<T>::max(), 1);
+      gold.emplace(::std::numeric_limits<T>::max(), 1);
+      temp.emplace_back(::std::numeric_limits<T>::max() - 1, 2);
+      gold.emplace(::std::numeric_limits<T>::max() - 1, 2);
+      temp.emplace_back(0, 3);
+      gold.emplace(0, 3);
+    }
+
+    template <typename MAP>
+    void check_same(MAP const & test) {
+      ASSERT_EQ(gold.size(), test.size());
+
+      std::vector<std::pair<T, T> > test_vals = test.to_vector();
+      std::vector<std::pair<T, T> > gold_vals(gold.begin(), gold.end());
+      std::sort(test_vals.begin(), test_vals.end());
+      std::sort(gold_vals.begin(), gold_vals.end());
+      EXPECT_TRUE(std::equal(test_vals.begin(), test_vals.end(), gold_vals.begin()));
+    }
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(GroupHashMapTest);
+
+
+TYPED_TEST_P(GroupHashMapTest, insert)
+{
+  using MAP = ::fsc::group_hash_map<TypeParam, TypeParam>;
+
+  // small initial size, so there are multiple rehashes.
+  MAP test(16);
+  for (auto x : this->temp) test.insert(x);
+
+  this->check_same(test);
+  EXPECT_LE(test.load_factor(), test.get_max_load_factor());
+
+  // duplicate insertion keeps the first value.
+  auto res = test.insert(this->temp[0]);
+  EXPECT_FALSE(res.second);
+  EXPECT_EQ(this->gold[this->temp[0].first], res.first->second);
+
+  MAP test2(this->temp.begin(), this->temp.end());
+  this->check_same(test2);
+
+  MAP test3(test2);
+  this->check_same(test3);
+
+  MAP test4(::std::move(test3));
+  this->check_same(test4);
+  EXPECT_EQ(0UL, test3.size());
+}
+
+TYPED_TEST_P(GroupHashMapTest, find)
+{
+  using MAP = ::fsc::group_hash_map<TypeParam, TypeParam>;
+
+  MAP test(this->temp.begin(), this->temp.end());
+
+  for (auto x : this->gold) {
+    auto it = test.find(x.first);
+    ASSERT_TRUE(it != test.end());
+    EXPECT_EQ(x.second, it->second);
+    EXPECT_EQ(1UL, test.count(x.first));
+
+    auto range = test.equal_range(x.first);
+    EXPECT_EQ(1, std::distance(range.first, range.second));
+  }
+
+  // absent keys
+  std::default_random_engine generator(17);
+  std::uniform_int_distribution<TypeParam> distribution;
+  for (size_t i = 0; i < 1000; ++i) {
+    TypeParam k = distribution(generator);
+    EXPECT_EQ(this->gold.count(k), test.count(k));
+    EXPECT_EQ(this->gold.count(k) > 0, test.find(k) != test.end());
+  }
+}
+
+TYPED_TEST_P(GroupHashMapTest, erase)
+{
+  using MAP = ::fsc::group_hash_map<TypeParam, TypeParam>;
+
+  MAP test(this->temp.begin(), this->temp.end());
+  size_t buckets = test.bucket_count();
+
+  // erase every other key
+  std::vector<TypeParam> to_erase;
+  bool odd = false;
+  for (auto x : this->gold) {
+    if (odd) to_erase.push_back(x.first);
+    odd = !odd;
+  }
+  EXPECT_EQ(to_erase.size(), test.erase(to_erase.begin(), to_erase.end()));
+  for (auto k : to_erase) this->gold.erase(k);
+  this->check_same(test);
+
+  // erasing again removes nothing
+  EXPECT_EQ(0UL, test.erase(to_erase.begin(), to_erase.end()));
+
+  // reinsert, reusing deleted slots.  table should not grow.
+  for (auto k : to_erase) {
+    test.insert(std::make_pair(k, k));
+    this->gold.emplace(k, k);
+  }
+  this->check_same(test);
+  EXPECT_EQ(buckets, test.bucket_count());
+
+  // repeated erase and insert cycles do not accumulate deleted slots.
+  for (int r = 0; r < 4; ++r) {
+    test.erase(to_erase.begin(), to_erase.end());
+    for (auto k : to_erase) test.insert(std::make_pair(k, k));
+  }
+  this->check_same(test);
+  EXPECT_EQ(buckets, test.bucket_count());
+
+  // erase by predicate
+  size_t n = test.erase([](std::pair<const TypeParam, TypeParam> const & x){ return (x.second & 1) == 0; });
+  size_t gold_n = 0;
+  for (auto it = this->gold.begin(); it != this->gold.end(); ) {
+    if ((it->second & 1) == 0) { it = this->gold.erase(it); ++gold_n; }
+    else ++it;
+  }
+  EXPECT_EQ(gold_n, n);
+  this->check_same(test);
+}
+
+TYPED_TEST_P(GroupHashMapTest, clear)
+{
+  using MAP = ::fsc::group_hash_map<TypeParam, TypeParam>;
+
+  MAP test(this->temp.begin(), this->temp.end());
+  size_t buckets = test.bucket_count();
+
+  test.clear();
+  EXPECT_TRUE(test.empty());
+  EXPECT_EQ(buckets, test.bucket_count());
+  EXPECT_TRUE(test.begin() == test.end());
+
+  test.insert(this->temp);
+  this->check_same(test);
+
+  test.reset();
+  EXPECT_TRUE(test.empty());
+  EXPECT_GT(buckets, test.bucket_count());
+
+  test.resize(this->gold.size());
+  buckets = test.bucket_count();
+  test.insert(this->temp);
+  this->check_same(test);
+  EXPECT_EQ(buckets, test.bucket_count());
+}
+
+
+REGISTER_TYPED_TEST_CASE_P(GroupHashMapTest, insert, find, erase, clear);
+
+//////////////////// RUN the tests with different types.
+
+typedef ::testing::Types<uint8_t, uint16_t, uint32_t, uint64_t> GroupHashMapTestTypes;
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, GroupHashMapTest, GroupHashMapTestTypes);
+
+
+
+TEST(GroupHashMapKmerTest, full_kmer)
+{
+  using KmerType = ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>;
+  using Hash = ::bliss::kmer::hash::farm<KmerType, false>;
+  using MAP = ::fsc::group_hash_map<KmerType, uint32_t, void, ::bliss::transform::identity, Hash, ::std::equal_to<KmerType> >;
+
+  std::unordered_map<uint64_t, uint32_t> gold;
+  std::vector<std::pair<KmerType, uint32_t> > input;
+
+  std::default_random_engine generator;
+  std::uniform_int_distribution<uint64_t> distribution;
+  KmerType km;
+  for (size_t i = 0; i < 50000; ++i) {
+    // include all-A and all-T k-mers, which densehash_map would need to split out.
+    uint64_t v = (i < 2) ? ((i == 0) ? 0ULL : 0x3FFFFFFFFFFFFFFFULL) : (distribution(generator) & 0x3FFFFFFFFFFFFFFFULL);
+    km.getDataRef()[0] = v;
+    input.emplace_back(km, static_cast<uint32_t>(i));
+    gold.emplace(v, static_cast<uint32_t>(i));
+  }
+
+  MAP test(input.begin(), input.end());
+  ASSERT_EQ(gold.size(), test.size());
+
+  for (auto it = test.cbegin(); it != test.cend(); ++it) {
+    auto g = gold.find(it->first.getData()[0]);
+    ASSERT_TRUE(g != gold.end());
+    EXPECT_EQ(g->second, it->second);
+  }
+  for (auto x : input) {
+    EXPECT_TRUE(test.exists(x.first));
+  }
+}
+
+TEST(GroupHashMapKmerTest, special_keys_equal)
+{
+  // Equal constructed from SpecialKeys, as for densehash_map's local store.
+  using KmerType = ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>;
+  using Hash = ::bliss::kmer::hash::farm<KmerType, false>;
+  using Specials = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false>;
+  using Equal = ::fsc::sparsehash::compare<KmerType, ::std::equal_to, ::bliss::transform::identity>;
+  using MAP = ::fsc::group_hash_map<KmerType, uint32_t, Specials, ::bliss::transform::identity, Hash, Equal>;
+
+  MAP test;
+  Specials s;
+  KmerType a = s.generate(0);
+  KmerType b = s.generate(1);
+  KmerType c;
+  c.getDataRef()[0] = 12345;
+
+  test.insert(std::make_pair(a, 1U));
+  test.insert(std::make_pair(b, 2U));
+  test.insert(std::make_pair(c, 3U));
+  EXPECT_EQ(3UL, test.size());
+  EXPECT_EQ(1U, test.find(a)->second);
+  EXPECT_EQ(2U, test.find(b)->second);
+  EXPECT_EQ(3U, test.find(c)->second);
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/mphf_map.hpp"
+
+#include <unordered_map>
+#include <random>
+#include <cstdint>  // uint32_t
+#include <utility>  // pair
+#include <vector>
+#include <functional>  // hash
+
+
+TEST(MphfMapTest, packed_vector)
+{
+  for (unsigned int width : {0U, 1U, 7U, 13U, 64U}) {
+    std::default_random_engine gen(width);
+    std::uniform_int_distribution<uint64_t> dist;
+    uint64_t mask = (width >= 64) ? ~(0ULL) : ((1ULL << width) - 1);
+
+    std::vector<uint64_t> gold(1000);
+    fsc::packed_vector v(gold.size(), width);
+    for (size_t i = 0; i < gold.size(); ++i) {
+      gold[i] = dist(gen) & mask;
+      v.set(i, gold[i]);
+    }
+    for (size_t i = 0; i < gold.size(); ++i) {
+      ASSERT_EQ(gold[i], v.get(i)) << "width " << width << " i " << i;
+    }
+  }
+}
+
+TEST(MphfMapTest, find)
+{
+  std::default_random_engine gen(11);
+  std::uniform_int_distribution<uint64_t> dist;
+  std::uniform_int_distribution<uint32_t> count(1, 1000);
+
+  std::unordered_map<uint64_t, uint32_t> gold;
+  while (gold.size() < 200000) gold[dist(gen)] = count(gen);
+  std::vector<std::pair<uint64_t, uint32_t> > entries(gold.begin(), gold.end());
+
+  fsc::mphf_map<uint64_t, uint32_t, std::hash<uint64_t> > map(entries, 16);
+  ASSERT_EQ(gold.size(), map.size());
+
+  for (auto const & x : gold) {
+    uint32_t v = 0;
+    ASSERT_TRUE(map.find(x.first, v)) << "key " << x.first;
+    ASSERT_EQ(x.second, v) << "key " << x.first;
+  }
+
+  // about 3 bits per key for the levels, 3.5 with the rank samples.
+  EXPECT_LT(map.hash_bits_per_key(), 4.0);
+  // hash, 16 bit fingerprint and 10 bit counts
+  EXPECT_LT(map.bytes() * 8, gold.size() * 30);
+
+  // absent keys:  about 2^-16 false positives.
+  size_t false_pos = 0;
+  size_t absent = 0;
+  for (size_t i = 0; i < 1000000; ++i) {
+    uint64_t k = dist(gen);
+    if (gold.count(k) > 0) continue;
+    ++absent;
+    false_pos += map.count(k);
+  }
+  EXPECT_LT(false_pos, 1 + (absent >> 14));
+}
+
+TEST(MphfMapTest, fallback)
+{
+  // gamma < 1 leaves keys for the fallback.
+  std::vector<std::pair<uint32_t, uint64_t> > entries;
+  for (uint32_t i = 0; i < 5000; ++i) entries.emplace_back(i * 7, i);
+
+  fsc::mphf_map<uint32_t, uint64_t, std::hash<uint32_t> > map(entries, 8, 0.05);
+  ASSERT_EQ(entries.size(), map.size());
+  for (auto const & x : entries) {
+    uint64_t v = 0;
+    ASSERT_TRUE(map.find(x.first, v));
+    ASSERT_EQ(x.second, v);
+  }
+
+  fsc::mphf_map<uint32_t, uint64_t, std::hash<uint32_t> > empty(std::vector<std::pair<uint32_t, uint64_t> >(), 8);
+  EXPECT_EQ(0UL, empty.size());
+  EXPECT_EQ(0UL, empty.count(5));
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/numa_allocator.hpp"
+
+#include <unordered_map>
+#include <cstdint>  // uint64_t
+#include <utility>  // pair
+#include <vector>
+
+
+template <int P>
+void check_placement() {
+  // large enough to be placed.
+  size_t n = 2 * ::fsc::numa::NUMA_THRESHOLD / sizeof(uint64_t);
+  ::std::vector<uint64_t, ::fsc::numa_allocator<uint64_t, P> > v(n);
+  for (size_t i = 0; i < n; ++i) v[i] = i;
+  for (size_t i = 0; i < n; i += 4099) EXPECT_EQ(i, v[i]);
+
+  // node based container through rebind.
+  ::std::unordered_map<uint64_t, uint64_t, ::std::hash<uint64_t>, ::std::equal_to<uint64_t>,
+    ::fsc::numa_allocator<::std::pair<const uint64_t, uint64_t>, P> > m;
+  for (uint64_t i = 0; i < 1000; ++i) m[i] = 2 * i;
+  EXPECT_EQ(1000UL, m.size());
+  EXPECT_EQ(20UL, m.at(10));
+}
+
+TEST(NumaAllocator, local)
+{
+  check_placement<::fsc::numa::LOCAL>();
+}
+
+TEST(NumaAllocator, interleave)
+{
+  check_placement<::fsc::numa::INTERLEAVE>();
+}
+
+TEST(NumaAllocator, parallel_touch)
+{
+  check_placement<::fsc::numa::PARALLEL_TOUCH>();
+
+  // too small a range has no whole page to touch.
+  char buf[16];
+  EXPECT_EQ(0, ::fsc::numa::parallel_touch(buf, 0));
+}
+
+TEST(NumaAllocator, local_node)
+{
+  check_placement<::fsc::numa::LOCAL_NODE>();
+
+  char buf[16];
+  EXPECT_FALSE(::fsc::numa::prefer_local(buf, 0));
+}
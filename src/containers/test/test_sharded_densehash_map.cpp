@@ -0,0 +1,176 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/sharded_densehash_map.hpp"
+
+#include <unordered_map>
+#include <random>
+#include <algorithm>  // for sort.
+#include <cstdint>  // uint32_t
+#include <utility>  // pair
+#include <vector>
+#include <limits>
+
+
+  template <typename Key>
+  struct sharded_full_special_keys {
+	static_assert(::std::is_integral<Key>::value && !::std::is_signed<Key>::value, "example imple only supports unsigned int");
+
+	inline Key generate(uint8_t id = 0) {
+		return ::std::numeric_limits<Key>::max() - id;
+	}
+
+	inline Key invert(Key const &x) {
+		return static_cast<Key>(~x);
+	}
+
+	inline Key get_splitter() {
+		return static_cast<Key>(~(::std::numeric_limits<Key>::max() >> 2));
+	}
+
+	static constexpr bool need_to_split = true;
+  };
+
+
+/*
+ * test class holding some information.  Also, needed for the typed tests
+ */
+template<typename T>
+class ShardedDenseHashMapTest : public ::testing::Test
+{
+    static_assert(std::is_integral<T>::value, "only supporting integral types in tests right now.");
+  protected:
+
+    ::std::unordered_map<T, T> gold;
+    ::std::unordered_map<T, T> gold_sum;
+    ::std::vector<std::pair<T, T>> temp;
+
+    size_t iters = 100000;
+
+    virtual void SetUp()
+    { // generate some inputs, with duplicates.
+
+      std::default_random_engine generator;
+      std::uniform_int_distribution<T> distribution(2, ::std::min(static_cast<T>(iters / 4), static_cast<T>(::std::numeric_limits<T>::max() - 2)));
+
+      for (size_t i=0; i< iters; ++i) {
+        T key = distribution(generator);
+        T val = distribution(generator);
+        gold.emplace(key, val);
+        gold_sum[key] += val;
+        temp.emplace_back(::std::move(key), ::std::move(val));
+      }
+    }
+
+    template <typename MAP>
+    void check(MAP const & test, ::std::unordered_map<T, T> const & g) {
+      ::std::vector<::std::pair<T, T> > test_vals = test.to_vector();
+      ::std::vector<::std::pair<T, T> > gold_vals(g.begin(), g.end());
+
+      ASSERT_EQ(gold_vals.size(), test_vals.size());
+      ASSERT_EQ(gold_vals.size(), test.size());
+
+      ::std::sort(test_vals.begin(), test_vals.end());
+      ::std::sort(gold_vals.begin(), gold_vals.end());
+      EXPECT_TRUE(::std::equal(test_vals.begin(), test_vals.end(), gold_vals.begin()));
+
+      for (auto const & x : g) {
+        EXPECT_EQ(1UL, test.count(x.first));
+      }
+      EXPECT_EQ(0UL, test.count(0));
+    }
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(ShardedDenseHashMapTest);
+
+TYPED_TEST_P(ShardedDenseHashMapTest, insert)
+{
+  using MAP = ::fsc::sharded_densehash_map<TypeParam, TypeParam>;
+
+  for (int shards : {1, 3, 8}) {
+    MAP test(128, shards);
+    EXPECT_LE(static_cast<size_t>(shards), test.get_num_shards());
+
+    test.insert(this->temp);
+    this->check(test, this->gold);
+
+    // iterate through all shards
+    size_t count = 0;
+    for (auto it = test.begin(); it != test.end(); ++it) ++count;
+    EXPECT_EQ(this->gold.size(), count);
+
+    auto it = test.find(this->temp[0].first);
+    ASSERT_TRUE(it != test.end());
+    EXPECT_EQ(this->temp[0].first, (*it).first);
+    EXPECT_TRUE(test.find(0) == test.end());
+  }
+}
+
+TYPED_TEST_P(ShardedDenseHashMapTest, insert_reduce)
+{
+  using MAP = ::fsc::sharded_densehash_map<TypeParam, TypeParam>;
+
+  for (int shards : {1, 4}) {
+    MAP test(128, shards);
+
+    size_t added = test.insert_reduce(this->temp, ::std::plus<TypeParam>());
+    EXPECT_EQ(this->gold_sum.size(), added);
+    this->check(test, this->gold_sum);
+  }
+}
+
+TYPED_TEST_P(ShardedDenseHashMapTest, insert_full)
+{
+  using MAP = ::fsc::sharded_densehash_map<TypeParam, TypeParam, sharded_full_special_keys<TypeParam> >;
+
+  MAP test(128, 4);
+  test.insert(this->temp);
+  this->check(test, this->gold);
+
+  size_t count = 0;
+  for (auto it = test.begin(); it != test.end(); ++it) ++count;
+  EXPECT_EQ(this->gold.size(), count);
+}
+
+TYPED_TEST_P(ShardedDenseHashMapTest, erase)
+{
+  using MAP = ::fsc::sharded_densehash_map<TypeParam, TypeParam>;
+
+  MAP test(128, 4);
+  test.insert(this->temp);
+
+  ::std::vector<TypeParam> keys;
+  for (size_t i = 0; i < this->temp.size(); i += 2) {
+    keys.emplace_back(this->temp[i].first);
+    this->gold.erase(this->temp[i].first);
+  }
+  test.erase(keys.begin(), keys.end());
+
+  this->check(test, this->gold);
+}
+
+// now register the test cases
+REGISTER_TYPED_TEST_CASE_P(ShardedDenseHashMapTest, insert, insert_reduce, insert_full, erase);
+
+
+//////////////////// RUN the tests with different types.
+
+typedef ::testing::Types<uint16_t, uint32_t, uint64_t> ShardedDenseHashMapTestTypes;
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, ShardedDenseHashMapTest, ShardedDenseHashMapTestTypes);
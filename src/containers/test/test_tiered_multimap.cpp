@@ -0,0 +1,205 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/tiered_multimap.hpp"
+
+#include <map>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include <utility>  // pair
+#include <vector>
+#include <iterator>
+#include <unistd.h>  // access
+
+class TieredMultimapTest : public ::testing::Test
+{
+  protected:
+    using MapType = ::fsc::tiered_multimap<uint64_t, uint32_t>;
+
+    std::vector<std::pair<uint64_t, uint32_t> > entries;
+    std::map<uint64_t, std::vector<uint32_t> > gold;
+    std::string file;
+
+    virtual void SetUp()
+    {
+      file = "tiered_multimap_test." + std::to_string(getpid()) + ".dsc";
+
+      std::default_random_engine gen(17);
+      std::uniform_int_distribution<uint64_t> key(0, 1ULL << 40);
+
+      // 2000 keys of multiplicity 1 to 50, and 1 key with 3000.
+      for (uint32_t k = 0; k < 2001; ++k) {
+        uint64_t kk = key(gen);
+        size_t n = (k == 2000) ? 3000 : ((k * 7) % 50 + 1);
+        for (size_t i = 0; i < n; ++i) entries.emplace_back(kk, static_cast<uint32_t>(gen()));
+      }
+      std::shuffle(entries.begin(), entries.end(), gen);
+      for (auto const & e : entries) gold[e.first].emplace_back(e.second);
+    }
+
+    void check(MapType const & test, std::map<uint64_t, std::vector<uint32_t> > const & expected) {
+      size_t total = 0;
+      for (auto const & x : expected) total += x.second.size();
+      EXPECT_EQ(total, test.size());
+      EXPECT_EQ(total, test.hot_size() + test.cold_size());
+      EXPECT_EQ(expected.size(), test.unique_size());
+
+      for (auto const & x : expected) {
+        ASSERT_EQ(x.second.size(), test.count(x.first)) << "key " << x.first;
+
+        // in insertion order.
+        std::vector<uint32_t> vals;
+        for (auto const & e : test.equal_range_span(x.first)) {
+          EXPECT_EQ(x.first, e.first);
+          vals.emplace_back(e.second);
+        }
+        EXPECT_EQ(x.second, vals) << "key " << x.first;
+
+        std::vector<std::pair<uint64_t, uint32_t> > found;
+        test.find(x.first, std::back_inserter(found));
+        EXPECT_EQ(x.second.size(), found.size());
+      }
+      // absent, below, between and above all keys.
+      for (uint64_t k : {0ULL, 1ULL << 39, (1ULL << 41)}) {
+        if (expected.count(k) > 0) continue;
+        EXPECT_EQ(0UL, test.count(k));
+        EXPECT_TRUE(test.equal_range_span(k).empty());
+      }
+
+      std::vector<std::pair<uint64_t, uint32_t> > all;
+      test.to_vector(all);
+      EXPECT_EQ(total, all.size());
+    }
+};
+
+TEST_F(TieredMultimapTest, all_hot)
+{
+  MapType test("", 10);
+  test.insert(entries.begin(), entries.end());
+  check(test, gold);
+  EXPECT_EQ(0UL, test.cold_size());
+}
+
+TEST_F(TieredMultimapTest, split)
+{
+  {
+    MapType test(file, 5000);
+    test.insert(entries.begin(), entries.end());
+    test.build();
+    EXPECT_EQ(0, access(file.c_str(), F_OK));
+
+    // by multiplicity:  the 3000 key and the 40 keys of 50 fill the hot tier exactly.
+    EXPECT_EQ(5000UL, test.hot_size());
+    for (auto const & x : gold) {
+      if (x.second.size() == 3000) {
+        EXPECT_TRUE(test.is_hot(x.first));
+      }
+      if (x.second.size() < 40) {
+        EXPECT_FALSE(test.is_hot(x.first));
+      }
+    }
+    check(test, gold);
+
+    // fences of 1 entry, and of more entries than a key has.
+    for (size_t stride : {1UL, 7UL, 1000UL}) {
+      MapType small(file + "." + std::to_string(stride), 0, stride);
+      small.insert(entries.begin(), entries.end());
+      check(small, gold);
+      EXPECT_EQ(0UL, small.hot_size());
+    }
+  }
+  // removed with the map.
+  EXPECT_NE(0, access(file.c_str(), F_OK));
+}
+
+TEST_F(TieredMultimapTest, incremental)
+{
+  MapType test(file, 2000, 16);
+  std::map<uint64_t, std::vector<uint32_t> > expected;
+  // 3 batches, each merged with both tiers.  later batches add values to keys that are already hot or cold.
+  size_t step = entries.size() / 3 + 1;
+  for (size_t i = 0; i < entries.size(); i += step) {
+    size_t end = std::min(entries.size(), i + step);
+    test.insert(entries.begin() + i, entries.begin() + end);
+    for (size_t j = i; j < end; ++j) expected[entries[j].first].emplace_back(entries[j].second);
+    check(test, expected);
+  }
+  EXPECT_GT(test.cold_size(), 0UL);
+
+  test.clear();
+  EXPECT_TRUE(test.empty());
+  EXPECT_EQ(0UL, test.count(entries[0].first));
+  EXPECT_NE(0, access(file.c_str(), F_OK));
+}
+
+TEST_F(TieredMultimapTest, retier)
+{
+  MapType test(file, 500, 16);
+  test.insert(entries.begin(), entries.end());
+  test.build();
+
+  // queries hit a few keys of multiplicity 10, which do not fit at first.
+  std::vector<uint64_t> hot_keys;
+  for (auto const & x : gold) {
+    if ((x.second.size() == 10) && (hot_keys.size() < 20)) hot_keys.emplace_back(x.first);
+  }
+  ASSERT_EQ(20UL, hot_keys.size());
+  for (auto const & k : hot_keys) EXPECT_FALSE(test.is_hot(k));
+
+  test.track_access(1024);
+  size_t before = test.memory_bytes();
+  for (int r = 0; r < 100; ++r) {
+    for (auto const & k : hot_keys) EXPECT_EQ(10UL, test.count(k));
+  }
+  // a few other keys, once.
+  for (auto it = gold.begin(); it != gold.end(); std::advance(it, 100)) {
+    test.count(it->first);
+    if (std::distance(it, gold.end()) <= 100) break;
+  }
+
+  test.retier();
+  for (auto const & k : hot_keys) EXPECT_TRUE(test.is_hot(k));
+  EXPECT_LE(test.hot_size(), 500UL);
+  check(test, gold);
+  EXPECT_LE(test.memory_bytes(), before + 500 * sizeof(std::pair<uint64_t, uint32_t>));
+
+  // counts start over:  an untracked retier goes back to multiplicity.
+  test.untrack_access();
+  test.retier();
+  for (auto const & k : hot_keys) EXPECT_FALSE(test.is_hot(k));
+  check(test, gold);
+}
+
+TEST_F(TieredMultimapTest, mismatched_file)
+{
+  // a cold file of another map type is not mapped.
+  std::vector<std::pair<uint64_t, uint64_t> > other(10);
+  ::dsc::write_map_segment(file, ::dsc::make_map_segment_header<uint64_t, uint64_t>("other", 0, 1, other.size()), other.data());
+  ::dsc::map_segment_header expected = ::dsc::make_map_segment_header<uint64_t, uint32_t>("tiered", 0, 1, 10);
+  EXPECT_THROW((::dsc::mapped_map_segment<std::pair<uint64_t, uint32_t> >(file, expected)), ::bliss::io::IOException);
+
+  // a writer with fewer entries than its header.
+  ::dsc::map_segment_writer<std::pair<uint64_t, uint64_t> > writer(file,
+      ::dsc::make_map_segment_header<uint64_t, uint64_t>("other", 0, 1, 11));
+  writer.append(other.begin(), other.end());
+  EXPECT_EQ(10UL, writer.size());
+  EXPECT_THROW(writer.close(), ::bliss::io::IOException);
+  std::remove(file.c_str());
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/unordered_grouped_multimap.hpp"
+
+#include <unordered_map>
+#include <random>
+#include <algorithm>  // for sort.
+#include <cstdint>  // uint32_t
+#include <utility>  // pair
+#include <vector>
+
+
+/*
+ * test class holding some information.  Also, needed for the typed tests
+ */
+template<typename T>
+class UnorderedGroupedMultimapTest : public ::testing::Test
+{
+  protected:
+    using valType = ::std::pair<T, T>;
+
+    ::std::unordered_multimap<T, T> gold;
+    ::fsc::unordered_grouped_multimap<T, T> test;
+    ::std::vector<valType> input;
+
+    size_t iters = 100000;
+
+    virtual void SetUp()
+    { // generate some inputs
+
+      std::default_random_engine generator;
+      std::uniform_int_distribution<T> distribution(0,99);
+
+      for (size_t i=0; i< iters; ++i) {
+        T key = distribution(generator);
+        T val = distribution(generator);
+        input.emplace_back(key, val);
+        gold.emplace(key, val);
+      }
+      // insert in 2 batches, so the second build merges into existing runs.
+      test.insert(input.begin(), input.begin() + iters / 2);
+      test.build();
+      test.insert(input.begin() + iters / 2, input.end());
+    }
+
+    static bool less(valType const &x, valType const &y) {
+      return (x.first == y.first) ? (x.second < y.second) : (x.first < y.first);
+    }
+
+    void check_same() {
+      ::std::vector<valType> test_vals(test.begin(), test.end());
+      ::std::vector<valType> gold_vals(gold.begin(), gold.end());
+      ASSERT_EQ(gold_vals.size(), test_vals.size());
+      EXPECT_EQ(gold.size(), test.size());
+
+      ::std::sort(test_vals.begin(), test_vals.end(), less);
+      ::std::sort(gold_vals.begin(), gold_vals.end(), less);
+      EXPECT_TRUE(::std::equal(test_vals.begin(), test_vals.end(), gold_vals.begin()));
+    }
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(UnorderedGroupedMultimapTest);
+
+TYPED_TEST_P(UnorderedGroupedMultimapTest, insert)
+{
+  this->check_same();
+
+  ::fsc::unordered_grouped_multimap<TypeParam, TypeParam> test2(this->gold.begin(), this->gold.end());
+  EXPECT_EQ(this->gold.size(), test2.size());
+
+  size_t u = 0;
+  for (auto it = this->gold.begin(); it != this->gold.end(); it = this->gold.equal_range(it->first).second) ++u;
+  EXPECT_EQ(u, test2.unique_size());
+
+  // entries are grouped by key
+  ::std::vector<TypeParam> seen;
+  auto it = this->test.begin();
+  while (it != this->test.end()) {
+    EXPECT_TRUE(::std::find(seen.begin(), seen.end(), it->first) == seen.end());
+    seen.push_back(it->first);
+    auto key = it->first;
+    while ((it != this->test.end()) && (it->first == key)) ++it;
+  }
+}
+
+
+TYPED_TEST_P(UnorderedGroupedMultimapTest, equal_range)
+{
+  for (int i = 0; i < 101; ++i) {
+    auto test_range = this->test.equal_range(i);
+    auto gold_range = this->gold.equal_range(i);
+
+    ::std::vector<TypeParam> test_vals;
+    ::std::vector<TypeParam> gold_vals;
+
+    for (auto it = test_range.first; it != test_range.second; ++it) {
+      EXPECT_EQ(i, it->first);
+      test_vals.push_back(it->second);
+    }
+    for (auto it = gold_range.first; it != gold_range.second; ++it) {
+      gold_vals.push_back(it->second);
+    }
+
+    ASSERT_EQ(gold_vals.size(), test_vals.size());
+
+    // insertion order within key is kept.
+    ::std::vector<TypeParam> input_vals;
+    for (auto x : this->input) {
+      if (x.first == i) input_vals.push_back(x.second);
+    }
+    EXPECT_TRUE(::std::equal(test_vals.begin(), test_vals.end(), input_vals.begin()));
+  }
+}
+
+
+TYPED_TEST_P(UnorderedGroupedMultimapTest, count)
+{
+  for (int i = 0; i < 101; ++i) {
+    EXPECT_EQ(this->gold.count(i), this->test.count(i));
+  }
+}
+
+TYPED_TEST_P(UnorderedGroupedMultimapTest, erase)
+{
+  // erase whole keys
+  for (int i = 0; i < 100; i += 3) {
+    EXPECT_EQ(this->gold.count(i), this->test.erase(i));
+    this->gold.erase(i);
+  }
+  EXPECT_EQ(0UL, this->test.erase(0));
+
+  // erase by predicate
+  for (int i = 1; i < 100; i += 3) {
+    auto pred = [](::std::pair<TypeParam, TypeParam> const & x) { return (x.second & 1) == 0; };
+    size_t gold_n = 0;
+    auto range = this->gold.equal_range(i);
+    for (auto it = range.first; it != range.second; ) {
+      if (pred(*it)) { it = this->gold.erase(it); ++gold_n; }
+      else ++it;
+    }
+    EXPECT_EQ(gold_n, this->test.erase(i, pred));
+  }
+
+  for (int i = 0; i < 101; ++i) {
+    EXPECT_EQ(this->gold.count(i), this->test.count(i));
+  }
+
+  // reinsert after erase, then compare all.
+  this->test.insert(this->input.begin(), this->input.begin() + 1000);
+  this->gold.insert(this->input.begin(), this->input.begin() + 1000);
+  this->check_same();
+
+  this->test.rehash(100000);
+  EXPECT_LE(static_cast<size_t>(100000), this->test.bucket_count());
+  this->check_same();
+
+  this->test.clear();
+  EXPECT_TRUE(this->test.empty());
+  EXPECT_EQ(0UL, this->test.count(5));
+  EXPECT_TRUE(this->test.begin() == this->test.end());
+}
+
+
+// now register the test cases
+REGISTER_TYPED_TEST_CASE_P(UnorderedGroupedMultimapTest, insert, equal_range, count, erase);
+
+
+//////////////////// RUN the tests with different types.
+
+typedef ::testing::Types<int8_t, int16_t, int32_t,
+    int64_t, uint64_t> UnorderedGroupedMultimapTestTypes;
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, UnorderedGroupedMultimapTest, UnorderedGroupedMultimapTestTypes);
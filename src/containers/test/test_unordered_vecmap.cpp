@@ -91,6 +91,25 @@ TYPED_TEST_P(UnorderedCompactVecMapTest, insert)
 }
 
 
+TYPED_TEST_P(UnorderedCompactVecMapTest, insert_sorted)
+{
+  ::std::vector<::std::pair<TypeParam, TypeParam> > gold_vals(this->gold.begin(), this->gold.end());
+
+  // insert_sorted consumes its buffer, like a received all2allv buffer.  insert into a non-empty map too.
+  ::std::vector<::std::pair<TypeParam, TypeParam> > buffer(gold_vals.begin(), gold_vals.begin() + gold_vals.size() / 2);
+  ::fsc::unordered_compact_vecmap<TypeParam, TypeParam> test2;
+  test2.insert_sorted(buffer.begin(), buffer.end());
+  buffer.assign(gold_vals.begin() + gold_vals.size() / 2, gold_vals.end());
+  test2.insert_sorted(buffer.begin(), buffer.end());
+
+  EXPECT_EQ(this->iters, test2.size());
+
+  ::std::vector<::std::pair<TypeParam, TypeParam> > test_vals(test2.begin(), test2.end());
+  ::std::sort(test_vals.begin(), test_vals.end());
+  ::std::sort(gold_vals.begin(), gold_vals.end());
+  EXPECT_TRUE(::std::equal(test_vals.begin(), test_vals.end(), gold_vals.begin()));
+}
+
 
 TYPED_TEST_P(UnorderedCompactVecMapTest, equal_range_value_only)
 {
@@ -130,6 +149,25 @@ TYPED_TEST_P(UnorderedCompactVecMapTest, equal_range_value_only)
     }
 }
 
+TYPED_TEST_P(UnorderedCompactVecMapTest, equal_range_span)
+{
+    for (int i = 0; i < 101; ++i) {
+      auto span = this->test.equal_range_span(i);
+      auto gold_range = this->gold.equal_range(i);
+
+      ::std::vector<TypeParam> test_vals(span.begin(), span.end());
+      ::std::vector<TypeParam> gold_vals;
+      for (auto it = gold_range.first; it != gold_range.second; ++it) {
+        gold_vals.push_back(it->second);
+      }
+      EXPECT_EQ(this->test.count(i), span.size());
+
+      ::std::sort(test_vals.begin(), test_vals.end());
+      ::std::sort(gold_vals.begin(), gold_vals.end());
+      EXPECT_EQ(gold_vals, test_vals);
+    }
+}
+
 TYPED_TEST_P(UnorderedCompactVecMapTest, equal_range)
 {
   bool same = false;
@@ -308,7 +346,7 @@ TYPED_TEST_P(UnorderedCompactVecMapTest, copy)
 
 
 // now register the test cases
-REGISTER_TYPED_TEST_CASE_P(UnorderedCompactVecMapTest, insert, equal_range_value_only, equal_range, count, iterator, rand_iterator, copy);
+REGISTER_TYPED_TEST_CASE_P(UnorderedCompactVecMapTest, insert, insert_sorted, equal_range_value_only, equal_range_span, equal_range, count, iterator, rand_iterator, copy);
 
 
 //////////////////// RUN the tests with different types.
@@ -427,6 +465,29 @@ TYPED_TEST_P(UnorderedVecMapTest, equal_range)
 }
 
 
+TYPED_TEST_P(UnorderedVecMapTest, equal_range_span)
+{
+    for (int i = 0; i < 101; ++i) {
+      auto span = this->test.equal_range_span(i);
+      auto gold_range = this->gold.equal_range(i);
+
+      ::std::vector<TypeParam> test_vals;
+      ::std::vector<TypeParam> gold_vals;
+      for (auto const & x : span) {
+        EXPECT_EQ(static_cast<TypeParam>(i), x.first);
+        test_vals.push_back(x.second);
+      }
+      for (auto it = gold_range.first; it != gold_range.second; ++it) {
+        gold_vals.push_back(it->second);
+      }
+      EXPECT_EQ(this->test.count(i), span.size());
+
+      ::std::sort(test_vals.begin(), test_vals.end());
+      ::std::sort(gold_vals.begin(), gold_vals.end());
+      EXPECT_EQ(gold_vals, test_vals);
+    }
+}
+
 TYPED_TEST_P(UnorderedVecMapTest, count)
 {
     for (int i = 0; i < 99; ++i) {
@@ -563,7 +624,7 @@ TYPED_TEST_P(UnorderedVecMapTest, copy)
 
 
 // now register the test cases
-REGISTER_TYPED_TEST_CASE_P(UnorderedVecMapTest, insert, equal_range, count, iterator, rand_iterator, copy);
+REGISTER_TYPED_TEST_CASE_P(UnorderedVecMapTest, insert, equal_range, equal_range_span, count, iterator, rand_iterator, copy);
 
 
 //////////////////// RUN the tests with different types.
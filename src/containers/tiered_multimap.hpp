@@ -0,0 +1,431 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    tiered_multimap.hpp
+ * @ingroup containers
+ * @author  tpan
+ * @brief   build-once multimap with a hot tier in memory and a cold tier in a memory mapped file, e.g. on an SSD.
+ * @details position multimaps of large references can exceed the memory of a node, while queries mostly hit a small
+ *          set of keys.  here, at most hot_capacity entries are kept in an unordered_grouped_multimap.  the rest are
+ *          sorted by key and written to a map segment file (see dsc_map_file.hpp), which is mapped read only.  a cold
+ *          lookup binary searches a fence index, the first key of every fence_stride entries (1 page for 16 byte
+ *          entries), and then reads 1 or 2 pages of the file.
+ *
+ *          hot keys are the ones with the most recorded accesses, then the most values.  before any access is
+ *          recorded, i.e. on the first build, that is multiplicity alone.  track_access starts counting the keys of
+ *          count, find and equal_range_span in a small count-min sketch, which is safe for concurrent queries.
+ *          retier rebuilds with those counts, so keys that became hot move into memory.
+ *
+ *          inserted entries are staged, and the map is rebuilt on the next query, as in compressed_multimap.  a
+ *          rebuild merges the staged entries, the hot tier, and the cold file in key order, and writes a new cold file,
+ *          so the cold entries are never all in memory.  the entries of a key keep their insertion order.
+ *
+ *          the cold file belongs to the map:  it is replaced on rebuild and removed on destruction.
+ */
+#ifndef SRC_CONTAINERS_TIERED_MULTIMAP_HPP_
+#define SRC_CONTAINERS_TIERED_MULTIMAP_HPP_
+
+#include <vector>
+#include <functional>  // hash, equal_to, less
+#include <utility>     // pair
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstdio>      // rename, remove
+#include <cstdint>
+#include <typeinfo>
+
+#include "containers/unordered_grouped_multimap.hpp"
+#include "containers/dsc_map_file.hpp"
+#include "containers/fsc_container_utils.hpp"
+#include "utils/logging.h"
+
+namespace fsc {  // fast standard container
+
+  /**
+   * @brief  multimap with a memory resident hot tier and a memory mapped cold tier.  see file comment.
+   * @details  interface follows compressed_multimap.  find appends (key, value) pairs to an output iterator, and
+   *           equal_range_span returns the entries of a key in place, in either tier.
+   * @tparam Less  orders keys in the cold file.
+   */
+  template <typename Key,
+  typename T,
+  typename Hash = ::std::hash<Key>,
+  typename Less = ::std::less<Key>,
+  typename Equal = ::std::equal_to<Key>
+  >
+  class tiered_multimap {
+
+    protected:
+      using entry_type = ::std::pair<Key, T>;
+      using hot_type = ::fsc::unordered_grouped_multimap<Key, T, Hash, Equal>;
+      using segment_type = ::dsc::mapped_map_segment<entry_type>;
+
+      /// rows of the access sketch.
+      static constexpr size_t sketch_rows = 4;
+
+      ::std::string cold_file;
+      size_t hot_capacity;
+      size_t fence_stride;
+
+      mutable hot_type hot;
+      mutable ::std::unique_ptr<segment_type> cold;
+      /// first key of every fence_stride cold entries.
+      mutable ::std::vector<Key> fences;
+      mutable ::std::vector<entry_type> staged;
+
+      /// count-min sketch of accesses, sketch_rows rows of sketch_mask + 1 counters.  empty if not tracking.
+      mutable ::std::unique_ptr<::std::atomic<uint32_t>[]> sketch;
+      size_t sketch_mask;
+
+      Hash hasher;
+      Less lt;
+      Equal eq;
+
+      entry_type const * cold_begin() const {
+        return cold ? cold->begin() : nullptr;
+      }
+      entry_type const * cold_end() const {
+        return cold ? cold->end() : nullptr;
+      }
+      size_t cold_count() const {
+        return cold ? cold->size() : 0;
+      }
+
+      /// counters of key, 1 per row.
+      template <typename F>
+      inline void for_each_counter(Key const & key, F const & f) const {
+        uint64_t h = static_cast<uint64_t>(hasher(key));
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        uint64_t step = (h >> 32) | 1;
+        for (size_t r = 0; r < sketch_rows; ++r) {
+          f(sketch[r * (sketch_mask + 1) + ((h + r * step) & sketch_mask)]);
+        }
+      }
+
+      inline void record(Key const & key) const {
+        if (!sketch) return;
+        for_each_counter(key, [](::std::atomic<uint32_t> & c) {
+          if (c.load(::std::memory_order_relaxed) < 0xFFFFFFFFU) c.fetch_add(1, ::std::memory_order_relaxed);
+        });
+      }
+
+      /// recorded accesses of key, an upper bound.
+      inline uint32_t accesses(Key const & key) const {
+        if (!sketch) return 0;
+        uint32_t m = 0xFFFFFFFFU;
+        for_each_counter(key, [&m](::std::atomic<uint32_t> & c) {
+          m = ::std::min(m, c.load(::std::memory_order_relaxed));
+        });
+        return m;
+      }
+
+      /// f(key, mem_first, mem_last, cold_first, cold_last) for each key of the key-sorted mem and cold entries, in order.
+      template <typename F>
+      void for_each_group(::std::vector<entry_type> const & mem, F const & f) const {
+        auto m = mem.begin();
+        entry_type const * c = cold_begin();
+        entry_type const * ce = cold_end();
+        while ((m != mem.end()) || (c != ce)) {
+          Key const & key = (c == ce) ? m->first :
+              (((m == mem.end()) || lt(c->first, m->first)) ? c->first : m->first);
+          auto me = m;
+          while ((me != mem.end()) && eq(me->first, key)) ++me;
+          entry_type const * cn = c;
+          while ((cn != ce) && eq(cn->first, key)) ++cn;
+          f(key, m, me, c, cn);
+          m = me;
+          c = cn;
+        }
+      }
+
+      /// merge staged entries with both tiers and split them again.
+      void rebuild() const {
+        // in memory:  staged and the hot tier, key sorted.  cold entries were inserted earlier, so they go first.
+        ::std::vector<entry_type> mem;
+        mem.reserve(hot.size() + staged.size());
+        mem.insert(mem.end(), hot.cbegin(), hot.cend());
+        mem.insert(mem.end(), staged.begin(), staged.end());
+        hot.clear();
+        ::std::vector<entry_type>().swap(staged);
+        ::std::stable_sort(mem.begin(), mem.end(), [this](entry_type const & x, entry_type const & y) {
+          return lt(x.first, y.first);
+        });
+
+        // pass 1:  score the keys, and take the best that fit into the hot tier.
+        ::std::vector<uint32_t> hits;
+        ::std::vector<size_t> counts;
+        for_each_group(mem, [this, &hits, &counts](Key const & key,
+            typename ::std::vector<entry_type>::const_iterator mf, typename ::std::vector<entry_type>::const_iterator ml,
+            entry_type const * cf, entry_type const * cl) {
+          hits.emplace_back(accesses(key));
+          counts.emplace_back(::std::distance(mf, ml) + ::std::distance(cf, cl));
+        });
+        ::std::vector<size_t> order(counts.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        ::std::sort(order.begin(), order.end(), [&hits, &counts](size_t const & x, size_t const & y) {
+          return (hits[x] > hits[y]) || ((hits[x] == hits[y]) && (counts[x] > counts[y]));
+        });
+        ::std::vector<bool> hot_key(counts.size(), cold_file.empty());
+        size_t n_hot = 0;
+        size_t total = 0;
+        for (auto const & c : counts) total += c;
+        if (!cold_file.empty()) {
+          for (auto const & i : order) {
+            if ((n_hot + counts[i]) > hot_capacity) continue;
+            hot_key[i] = true;
+            n_hot += counts[i];
+          }
+        } else {
+          n_hot = total;
+        }
+        ::std::vector<uint32_t>().swap(hits);
+
+        // pass 2:  hot keys into memory, the rest into a new cold file.
+        ::std::vector<entry_type> hot_entries;
+        hot_entries.reserve(n_hot);
+        ::std::vector<Key> new_fences;
+        ::std::string tmp = cold_file + ".tmp";
+        ::std::unique_ptr<::dsc::map_segment_writer<entry_type> > writer;
+        if (total > n_hot) writer.reset(new ::dsc::map_segment_writer<entry_type>(tmp, segment_header(total - n_hot)));
+
+        size_t g = 0;
+        for_each_group(mem, [this, &g, &hot_key, &hot_entries, &writer, &new_fences](Key const &,
+            typename ::std::vector<entry_type>::const_iterator mf, typename ::std::vector<entry_type>::const_iterator ml,
+            entry_type const * cf, entry_type const * cl) {
+          if (hot_key[g++]) {
+            hot_entries.insert(hot_entries.end(), cf, cl);
+            hot_entries.insert(hot_entries.end(), mf, ml);
+            return;
+          }
+          size_t pos = writer->size();
+          size_t n = ::std::distance(cf, cl) + ::std::distance(mf, ml);
+          // fences at multiples of fence_stride in [pos, pos + n) all have this key.
+          for (size_t f = (pos + fence_stride - 1) / fence_stride * fence_stride; f < pos + n; f += fence_stride) {
+            new_fences.emplace_back((cf != cl) ? cf->first : mf->first);
+          }
+          writer->append(cf, cl);
+          writer->append(mf, ml);
+        });
+        if (writer) writer->close();
+        ::std::vector<entry_type>().swap(mem);
+
+        // replace the cold file.  the old mapping stays valid until it is reset.
+        cold.reset();
+        fences.swap(new_fences);
+        if (writer) {
+          if (::std::rename(tmp.c_str(), cold_file.c_str()) != 0) {
+            throw ::bliss::utils::make_exception<::bliss::io::IOException>(
+                "ERROR: tiered multimap: unable to replace cold file " + cold_file);
+          }
+          cold.reset(new segment_type(cold_file, segment_header(total - n_hot)));
+          cold->advise(MADV_RANDOM);
+        } else if (!cold_file.empty()) {
+          ::std::remove(cold_file.c_str());
+        }
+
+        hot.insert(hot_entries.begin(), hot_entries.end());
+        hot.build();
+      }
+
+      ::dsc::map_segment_header segment_header(size_t count) const {
+        return ::dsc::make_map_segment_header<Key, T>(typeid(tiered_multimap).name(), 0, 1, count);
+      }
+
+      inline void ensure_built() const {
+        if (!staged.empty()) rebuild();
+      }
+
+      /// cold entries of key.  empty range if key is hot or absent.
+      ::std::pair<entry_type const *, entry_type const *> cold_range(Key const & key) const {
+        if (!cold || fences.empty()) return ::std::make_pair(cold_end(), cold_end());
+
+        // the first fence not less than key.  the key's entries start after the previous fence, and at the latest here.
+        size_t j = ::std::distance(fences.begin(), ::std::lower_bound(fences.begin(), fences.end(), key, lt));
+        entry_type const * first = cold_begin() + ((j == 0) ? 0 : (j - 1) * fence_stride);
+        entry_type const * last = cold_begin() + ::std::min(j * fence_stride + 1, cold_count());
+
+        first = ::std::lower_bound(first, last, key, [this](entry_type const & e, Key const & k) {
+          return lt(e.first, k);
+        });
+        last = first;
+        while ((last != cold_end()) && eq(last->first, key)) ++last;
+        return ::std::make_pair(first, last);
+      }
+
+    public:
+      using key_type              = Key;
+      using mapped_type           = T;
+      using value_type            = entry_type;
+      using size_type             = size_t;
+
+      /**
+       * @param _cold_file      file for the cold tier, e.g. on a local SSD.  empty to keep all entries in memory.
+       * @param _hot_capacity   number of entries kept in memory.
+       * @param _fence_stride   cold entries per fence key.
+       */
+      tiered_multimap(::std::string const & _cold_file, size_t const & _hot_capacity,
+                      size_t const & _fence_stride = 4096 / sizeof(entry_type) + 1) :
+        cold_file(_cold_file), hot_capacity(_hot_capacity), fence_stride(::std::max(_fence_stride, static_cast<size_t>(1))),
+        sketch_mask(0) {}
+
+      ~tiered_multimap() {
+        cold.reset();
+        if (!cold_file.empty()) ::std::remove(cold_file.c_str());
+      }
+
+      tiered_multimap(tiered_multimap const & other) = delete;
+      tiered_multimap & operator=(tiered_multimap const & other) = delete;
+
+      /// build now.  otherwise the map is built on the first query after insertion.
+      void build() const {
+        ensure_built();
+      }
+
+      template <class InputIt>
+      void insert(InputIt first, InputIt last) {
+        staged.insert(staged.end(), first, last);
+      }
+
+      void insert(entry_type const & value) {
+        staged.emplace_back(value);
+      }
+
+      /// count the keys of count, find and equal_range_span from now on, in a sketch of about width counters per row.
+      void track_access(size_t const & width = (1UL << 16)) {
+        size_t w = 1;
+        while (w < width) w <<= 1;
+        sketch_mask = w - 1;
+        sketch.reset(new ::std::atomic<uint32_t>[sketch_rows * w]);
+        for (size_t i = 0; i < sketch_rows * w; ++i) sketch[i].store(0, ::std::memory_order_relaxed);
+      }
+
+      /// stop counting accesses, and forget them.
+      void untrack_access() {
+        sketch.reset();
+        sketch_mask = 0;
+      }
+
+      /// rebuild with the accesses recorded so far, then count from 0.  not concurrent with queries.
+      void retier() {
+        ensure_built();
+        if (hot.size() + cold_count() > 0) rebuild();
+        if (sketch) track_access(sketch_mask + 1);
+      }
+
+      /// change the number of entries kept in memory.  takes effect on the next build or retier.
+      void set_hot_capacity(size_t const & _hot_capacity) {
+        hot_capacity = _hot_capacity;
+      }
+
+      bool empty() const {
+        return size() == 0;
+      }
+
+      size_type size() const {
+        return hot.size() + cold_count() + staged.size();
+      }
+
+      size_type unique_size() const {
+        ensure_built();
+        size_t n = hot.unique_size();
+        for (entry_type const * it = cold_begin(); it != cold_end(); ++it) {
+          if ((it == cold_begin()) || !eq((it - 1)->first, it->first)) ++n;
+        }
+        return n;
+      }
+
+      /// entries in memory and in the cold file.
+      size_type hot_size() const {
+        ensure_built();
+        return hot.size();
+      }
+      size_type cold_size() const {
+        ensure_built();
+        return cold_count();
+      }
+
+      /// true if key's entries are in memory.
+      bool is_hot(Key const & key) const {
+        ensure_built();
+        return hot.count(key) > 0;
+      }
+
+      void clear() {
+        hot.clear();
+        cold.reset();
+        fences.clear();
+        staged.clear();
+        if (!cold_file.empty()) ::std::remove(cold_file.c_str());
+      }
+
+      size_type count(Key const & key) const {
+        ensure_built();
+        record(key);
+        size_t n = hot.count(key);
+        if (n > 0) return n;
+        auto range = cold_range(key);
+        return ::std::distance(range.first, range.second);
+      }
+
+      /// the entries of key, in place in either tier.  valid until the next build.
+      ::fsc::span<entry_type> equal_range_span(Key const & key) const {
+        ensure_built();
+        record(key);
+        auto h = hot.equal_range(key);
+        if (h.first != h.second) return ::fsc::make_span(h.first, h.second);
+        auto range = cold_range(key);
+        return ::fsc::span<entry_type>(range.first, ::std::distance(range.first, range.second));
+      }
+
+      /// append the (key, value) entries of key to out, in insertion order.
+      template <typename OutputIt>
+      OutputIt find(Key const & key, OutputIt out) const {
+        auto s = equal_range_span(key);
+        return ::std::copy(s.begin(), s.end(), out);
+      }
+
+      /// all entries, keys grouped.
+      void to_vector(::std::vector<entry_type> & result) const {
+        ensure_built();
+        result.clear();
+        result.reserve(size());
+        result.insert(result.end(), hot.cbegin(), hot.cend());
+        result.insert(result.end(), cold_begin(), cold_end());
+      }
+
+      /// bytes in memory:  hot entries, fences, and the access sketch.  excludes staged entries and the hot key index.
+      size_t memory_bytes() const {
+        ensure_built();
+        return hot.size() * sizeof(entry_type) + fences.size() * sizeof(Key) +
+            (sketch ? sketch_rows * (sketch_mask + 1) * sizeof(uint32_t) : 0);
+      }
+
+      void report() const {
+        ensure_built();
+        BL_INFOF("tiered multimap: %lu hot entries, %lu cold entries in %s, %lu fences\n", hot.size(), cold_count(),
+                 cold_file.c_str(), fences.size());
+        hot.report();
+      }
+  };
+
+} // end namespace fsc.
+
+#endif /* SRC_CONTAINERS_TIERED_MULTIMAP_HPP_ */
@@ -0,0 +1,519 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    unordered_grouped_multimap.hpp
+ * @ingroup containers
+ * @author  tpan
+ * @brief   multimap with all entries in one array, grouped by key, indexed by a Robin Hood hash table.
+ * @details alternative to unordered_vecmap for build-once, query-many uses such as position indices.
+ *
+ *          inserted entries are appended to a staging buffer.  the index is built on first query after insertion, in 2 passes:
+ *            1. count:  find or insert each key in a Robin Hood table of unique keys, and count entries per key.
+ *            2. scatter:  prefix sum of counts gives each key's run in the entry array.  entries are moved into their runs.
+ *          entries of the same key keep their insertion order.
+ *
+ *          each table slot holds the offset of the key's run, the run length, the probe distance, and a 16 bit hash tag.
+ *          keys are not duplicated in the table: the key is read from the first entry of its run, only when the tag matches.
+ *
+ *      memory usage:
+ *          entries are stored once as std::pair<K, T>, so 16 or 24 bytes.  N elements
+ *          each slot is 16 bytes, at most 0.8 load.  U unique elements
+ *
+ *          total: (16N or 24N) + 20U, compared to (16N or 24N) + 24U + 16HU for unordered_vecmap, and
+ *          no per-key allocations.  building temporarily needs another 8N + 24U.
+ *
+ *          find returns a contiguous range of entries.
+ *
+ *          erasure leaves holes in the entry array, which are compacted on the next iteration or build.
+ *          interleaving insert and query rebuilds the index each time, so batch inserts.
+ */
+#ifndef SRC_CONTAINERS_UNORDERED_GROUPED_MULTIMAP_HPP_
+#define SRC_CONTAINERS_UNORDERED_GROUPED_MULTIMAP_HPP_
+
+#include <vector>
+#include <functional>  // hash, equal_to, etc
+#include <utility>     // pair
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <type_traits>
+
+#include "utils/logging.h"
+
+namespace fsc {  // fast standard container
+
+  /**
+   * @brief  multimap storing entries contiguously, grouped by key, with a Robin Hood index over the unique keys.
+   * @details  interface follows unordered_vecmap where the semantic allows.  insert does not return an iterator,
+   *           since the entry is staged until the next build.
+   */
+  template <typename Key,
+  typename T,
+  typename Hash = ::std::hash<Key>,
+  typename Equal = ::std::equal_to<Key>,
+  typename Allocator = ::std::allocator<::std::pair<Key, T> >
+  >
+  class unordered_grouped_multimap {
+
+    protected:
+      using entry_type = ::std::pair<Key, T>;
+      using container_type = ::std::vector<entry_type, Allocator>;
+
+      /// index slot.  dist is probe distance + 1, 0 means empty.
+      struct slot {
+          size_t offset;   // start of run in entries.  during build, id of the key.
+          uint32_t count;
+          uint16_t dist;
+          uint16_t tag;
+      };
+
+      static constexpr size_t min_capacity = 16;
+
+      /// entries, grouped by key.
+      mutable container_type entries;
+      /// inserted but not yet indexed entries
+      mutable container_type staged;
+      mutable ::std::vector<slot> slots;
+      /// number of unique keys in the index
+      mutable size_t n_keys;
+      /// number of erased entries still in the entries array.
+      mutable size_t holes;
+      /// number of valid entries, including staged.
+      size_t s;
+
+      Hash hasher_;
+      Equal eq;
+
+      static inline uint16_t get_tag(size_t const h) {
+        return static_cast<uint16_t>(h >> (sizeof(size_t) * 8 - 16));
+      }
+
+      static size_t capacity_for(size_t const n) {
+        size_t needed = n + n / 4 + 1;   // n <= 0.8 capacity
+        size_t cap = min_capacity;
+        while (cap < needed) cap <<= 1;
+        return cap;
+      }
+
+      /// find slot index of key, or slots.size().  key_of maps slot offset to key.
+      template <typename KeyOf>
+      size_t find_slot(Key const & key, size_t const h, KeyOf const & key_of) const {
+        size_t mask = slots.size() - 1;
+        size_t i = h & mask;
+        uint16_t tag = get_tag(h);
+        for (uint16_t d = 1; ; ++d, i = (i + 1) & mask) {
+          slot const & sl = slots[i];
+          // robin hood invariant:  if the resident is closer to its home than we would be, key is absent.
+          if (sl.dist < d) return slots.size();
+          if ((sl.tag == tag) && eq(key_of(sl.offset), key)) return i;
+        }
+        return slots.size();
+      }
+
+      /// insert a slot known to be absent, robin hood style.
+      void place_slot(slot sl, size_t const h) const {
+        size_t mask = slots.size() - 1;
+        size_t i = h & mask;
+        sl.dist = 1;
+        for (; ; i = (i + 1) & mask, ++sl.dist) {
+          if (slots[i].dist == 0) {
+            slots[i] = sl;
+            return;
+          }
+          if (slots[i].dist < sl.dist) ::std::swap(slots[i], sl);
+        }
+      }
+
+      /// remove slot i, shifting following displaced slots back.
+      void remove_slot(size_t i) const {
+        size_t mask = slots.size() - 1;
+        size_t j = (i + 1) & mask;
+        while (slots[j].dist > 1) {
+          slots[i] = slots[j];
+          --slots[i].dist;
+          i = j;
+          j = (j + 1) & mask;
+        }
+        slots[i].dist = 0;
+        --n_keys;
+      }
+
+      /// copy live runs to a new array, in slot order.
+      void compact() const {
+        if (holes == 0) return;
+
+        container_type tmp;
+        tmp.reserve(entries.size() - holes);
+        for (auto & sl : slots) {
+          if (sl.dist == 0) continue;
+          size_t off = tmp.size();
+          tmp.insert(tmp.end(), ::std::make_move_iterator(entries.begin() + sl.offset),
+                     ::std::make_move_iterator(entries.begin() + sl.offset + sl.count));
+          sl.offset = off;
+        }
+        entries.swap(tmp);
+        holes = 0;
+      }
+
+      /// rebuild the index from existing entries and staged entries.  entries of a key keep their order.
+      void build_index() const {
+        compact();
+        if (entries.empty()) entries.swap(staged);
+        else {
+          entries.insert(entries.end(), ::std::make_move_iterator(staged.begin()), ::std::make_move_iterator(staged.end()));
+          container_type tmp;
+          tmp.swap(staged);
+        }
+
+        size_t const n = entries.size();
+
+        // ========= pass 1:  count.  slot offset is the key id during this pass.
+        ::std::vector<size_t> rep;        // first entry for each key id
+        ::std::vector<size_t> key_hash;   // hash of each key id
+        ::std::vector<size_t> cnt;        // count, then start, for each key id
+        ::std::vector<size_t> ids(n);     // key id of each entry
+        if (slots.size() < capacity_for(n_keys)) slots.resize(capacity_for(n_keys));
+        for (auto & sl : slots) sl.dist = 0;
+        rep.reserve(n_keys);
+        key_hash.reserve(n_keys);
+        cnt.reserve(n_keys);
+
+        auto key_of_id = [this, &rep](size_t const id) -> Key const & { return entries[rep[id]].first; };
+
+        for (size_t i = 0; i < n; ++i) {
+          size_t h = hasher_(entries[i].first);
+          size_t pos = find_slot(entries[i].first, h, key_of_id);
+          if (pos < slots.size()) {
+            ids[i] = slots[pos].offset;
+            ++cnt[ids[i]];
+            continue;
+          }
+
+          size_t id = rep.size();
+          if ((id + 1) > (slots.size() - slots.size() / 5)) {
+            // grow, and reinsert all keys seen so far.
+            slots.assign(slots.size() * 2, slot());
+            for (auto & sl : slots) sl.dist = 0;
+            for (size_t j = 0; j < id; ++j) {
+              slot sl{j, 0, 0, get_tag(key_hash[j])};
+              place_slot(sl, key_hash[j]);
+            }
+          }
+          rep.push_back(i);
+          key_hash.push_back(h);
+          cnt.push_back(1);
+          ids[i] = id;
+          slot sl{id, 0, 0, get_tag(h)};
+          place_slot(sl, h);
+        }
+        n_keys = rep.size();
+
+        // ========= prefix sum.  cnt becomes the start of each run.
+        size_t off = 0;
+        for (auto & sl : slots) {
+          if (sl.dist == 0) continue;
+          size_t id = sl.offset;
+          sl.count = static_cast<uint32_t>(cnt[id]);
+          sl.offset = off;
+          cnt[id] = off;
+          off += sl.count;
+        }
+
+        // ========= pass 2:  scatter.
+        container_type tmp;
+        tmp.reserve(n);
+        tmp.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+          tmp[cnt[ids[i]]++] = ::std::move(entries[i]);
+        }
+        entries.swap(tmp);
+      }
+
+      inline void ensure_built() const {
+        if (!staged.empty()) build_index();
+      }
+
+      /// slot of key, or nullptr.
+      slot const * find_key(Key const & key) const {
+        ensure_built();
+        if (n_keys == 0) return nullptr;
+        size_t pos = find_slot(key, hasher_(key), [this](size_t const off) -> Key const & { return entries[off].first; });
+        return (pos < slots.size()) ? &(slots[pos]) : nullptr;
+      }
+
+    public:
+      using key_type              = Key;
+      using mapped_type           = T;
+      using value_type            = ::std::pair<const Key, T>;
+      using hasher                = Hash;
+      using key_equal             = Equal;
+      using allocator_type        = Allocator;
+      using reference             = entry_type&;
+      using const_reference       = const entry_type&;
+      // entries are stored as pair<Key, T> so they can be moved during build.  do not modify keys via iterator.
+      using iterator              = typename container_type::iterator;
+      using const_iterator        = typename container_type::const_iterator;
+      using size_type             = typename container_type::size_type;
+      using difference_type       = typename container_type::difference_type;
+
+      /// load_factor is the expected multiplicity.  bucket_count is the expected number of unique keys.
+      unordered_grouped_multimap(size_type load_factor = 1,
+                   size_type bucket_count = 128,
+                         const Hash& hash = Hash(),
+                         const Equal& equal = Equal(),
+                         const Allocator& alloc = Allocator()) :
+                           entries(alloc), staged(alloc), slots(capacity_for(bucket_count)),
+                           n_keys(0), holes(0), s(0UL), hasher_(hash), eq(equal) {
+        for (auto & sl : slots) sl.dist = 0;
+        staged.reserve(bucket_count * load_factor);
+      };
+
+      template<class InputIt, typename = typename ::std::enable_if<!::std::is_integral<InputIt>::value>::type>
+      unordered_grouped_multimap(InputIt first, InputIt last,
+                         size_type load_factor = 1,
+                         size_type bucket_count = 128,
+                         const Hash& hash = Hash(),
+                         const Equal& equal = Equal(),
+                         const Allocator& alloc = Allocator()) :
+                         unordered_grouped_multimap(load_factor, bucket_count, hash, equal, alloc) {
+          this->insert(first, last);
+      };
+
+      virtual ~unordered_grouped_multimap() {};
+
+      /// build the index now.  otherwise it is built on the first query after insertion.
+      void build() const {
+        ensure_built();
+        compact();
+      }
+
+      iterator begin() {
+        build();
+        return entries.begin();
+      }
+      const_iterator begin() const {
+        return cbegin();
+      }
+      const_iterator cbegin() const {
+        build();
+        return entries.cbegin();
+      }
+
+      iterator end() {
+        build();
+        return entries.end();
+      }
+      const_iterator end() const {
+        return cend();
+      }
+      const_iterator cend() const {
+        build();
+        return entries.cend();
+      }
+
+
+      bool empty() const {
+        return s == 0;
+      }
+
+      size_type size() const {
+        return s;
+      }
+
+      void reset() {
+        s = 0; n_keys = 0; holes = 0;
+        container_type().swap(entries);
+        container_type().swap(staged);
+        ::std::vector<slot>(min_capacity).swap(slots);
+        for (auto & sl : slots) sl.dist = 0;
+      }
+
+      void clear() {
+        s = 0; n_keys = 0; holes = 0;
+        entries.clear();
+        staged.clear();
+        for (auto & sl : slots) sl.dist = 0;
+      }
+
+      /// rehash for count unique keys.  only grows.
+      void rehash(size_type count) {
+        if (capacity_for(count) > slots.size()) {
+          build();
+          slots.resize(capacity_for(count));
+          // rebuild from the grouped entries.  order within keys is kept.
+          staged.swap(entries);
+          build_index();
+        }
+      }
+
+      /// bucket count, i.e. slots of the index
+      size_type bucket_count() const { return slots.size(); }
+
+      /// max load factor, in elements per slot.
+      float max_load_factor() const {
+        return (n_keys == 0) ? 0.8f : 0.8f * (static_cast<float>(s) / static_cast<float>(n_keys));
+      }
+
+      /// reserve for new count of elements.
+      void reserve(size_type count) {
+        staged.reserve(count);
+      }
+
+      void insert(const entry_type & value) {
+        staged.emplace_back(value);
+        ++s;
+      }
+      void insert(entry_type && value) {
+        staged.emplace_back(::std::move(value));
+        ++s;
+      }
+      void insert(value_type const & value) {
+        staged.emplace_back(value.first, value.second);
+        ++s;
+      }
+      void emplace(Key&& key, T&& value) {
+        staged.emplace_back(::std::forward<Key>(key), ::std::forward<T>(value));
+        ++s;
+      }
+
+      template <class InputIt>
+      void insert(InputIt first, InputIt last) {
+        size_t n = ::std::distance(first, last);
+        staged.reserve(staged.size() + n);
+        for (; first != last; ++first) {
+          auto const & x = *first;
+          staged.emplace_back(x.first, x.second);
+        }
+        s += n;
+      }
+
+      /// same as insert.  input does not need to be sorted, grouping is done by the build.
+      template <class InputIt>
+      void insert_sorted(InputIt first, InputIt last) {
+        insert(first, last);
+      }
+
+
+      template <typename Pred>
+      size_t erase(const key_type& key, Pred const & pred) {
+        slot const * sl = find_key(key);
+        if (sl == nullptr) return 0;
+
+        slot & sll = const_cast<slot &>(*sl);
+        auto first = entries.begin() + sll.offset;
+        auto last = first + sll.count;
+        auto new_end = ::std::stable_partition(first, last, [&pred](entry_type const & x) { return !pred(x); });
+        size_t removed = ::std::distance(new_end, last);
+
+        sll.count -= removed;
+        holes += removed;
+        s -= removed;
+        if (sll.count == 0) remove_slot(sl - slots.data());
+
+        return removed;
+      }
+
+      size_t erase(const key_type& key) {
+        slot const * sl = find_key(key);
+        if (sl == nullptr) return 0;
+
+        size_t c = sl->count;
+        holes += c;
+        s -= c;
+        remove_slot(sl - slots.data());
+
+        return c;
+      }
+
+      size_type count(Key const & key) const {
+        slot const * sl = find_key(key);
+        return (sl == nullptr) ? 0 : sl->count;
+      }
+
+      void shrink_to_fit() {
+        build();
+        entries.shrink_to_fit();
+        container_type().swap(staged);
+      }
+
+
+      void report() const {
+          ensure_built();
+          BL_INFOF("grouped multimap bucket count: %lu\n", slots.size());
+          BL_INFOF("grouped multimap load factor: %f\n", static_cast<float>(n_keys) / static_cast<float>(slots.size()));
+          BL_INFOF("grouped multimap unique entries: %lu\n", n_keys);
+          BL_INFOF("grouped multimap total size: %lu\n", s);
+      }
+
+
+      size_type unique_size() const {
+        ensure_built();
+        return n_keys;
+      }
+
+
+      size_type get_max_multiplicity() const {
+        ensure_built();
+        size_type max_multiplicity = 0;
+        for (auto const & sl : slots) {
+          if (sl.dist > 0) max_multiplicity = ::std::max(max_multiplicity, static_cast<size_type>(sl.count));
+        }
+        return max_multiplicity;
+      }
+
+      size_type get_min_multiplicity() const {
+        ensure_built();
+        size_type min_multiplicity = ::std::numeric_limits<size_type>::max();
+        for (auto const & sl : slots) {
+          if (sl.dist > 0) min_multiplicity = ::std::min(min_multiplicity, static_cast<size_type>(sl.count));
+        }
+        return min_multiplicity;
+      }
+
+      double get_mean_multiplicity() const {
+        return static_cast<double>(s) / double(unique_size());
+      }
+      double get_stdev_multiplicity() const {
+        ensure_built();
+        double stdev_multiplicity = 0;
+        for (auto const & sl : slots) {
+          if (sl.dist > 0) stdev_multiplicity += (static_cast<double>(sl.count) * static_cast<double>(sl.count));
+        }
+        return stdev_multiplicity / double(n_keys) - get_mean_multiplicity();
+      }
+
+
+      /// entries with key.  contiguous.
+      ::std::pair<iterator, iterator> equal_range(Key const & key) {
+        slot const * sl = find_key(key);
+        if (sl == nullptr) return ::std::make_pair(entries.end(), entries.end());
+
+        return ::std::make_pair(entries.begin() + sl->offset, entries.begin() + sl->offset + sl->count);
+      }
+      ::std::pair<const_iterator, const_iterator> equal_range(Key const & key) const {
+        slot const * sl = find_key(key);
+        if (sl == nullptr) return ::std::make_pair(entries.cend(), entries.cend());
+
+        return ::std::make_pair(entries.cbegin() + sl->offset, entries.cbegin() + sl->offset + sl->count);
+      }
+      // NO bucket interfaces
+
+  };
+
+} // end namespace fsc.
+
+#endif /* SRC_CONTAINERS_UNORDERED_GROUPED_MULTIMAP_HPP_ */
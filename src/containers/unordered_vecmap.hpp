@@ -34,6 +34,7 @@
 #include <cmath>   // ceil
 //#include "ext/pool_allocator.h"
 
+#include "containers/fsc_container_utils.hpp"
 #include "utils/logging.h"
 
 namespace fsc {  // fast standard container
@@ -86,6 +87,8 @@ using allocator = std::allocator<T>;
    *          total: (16N or 24N) + 24U + 16 HU.  assume good hash function, HU = U.
    *
    *          bottomline - large amount of memory is needed.
+   *          see unordered_grouped_multimap.hpp for a build-once version that stores all entries in one array.
+   *          see compressed_multimap.hpp for a build-once version that stores frequent keys once, with compressed values.
    *
    */
   template <typename Key,
@@ -613,6 +616,7 @@ using allocator = std::allocator<T>;
       }
 
 
+      /// insert a range after sorting it by key.  the range is a consumed buffer:  entries are moved out, not copied.
       template <class InputIt>
       void insert_sorted(InputIt first, InputIt last) {
           size_t ss = std::distance(first, last);
@@ -643,8 +647,8 @@ using allocator = std::allocator<T>;
             ss = std::distance(start, it);
             map[key].reserve(map[key].size() + ss);
             std::transform(start, it, std::back_inserter(map[key]),
-                 [](InputValueType const & x){
-                    return x.second;
+                 [](InputValueType & x){
+                    return ::std::move(x.second);
                     });
 
             s += ss;
@@ -816,6 +820,12 @@ using allocator = std::allocator<T>;
         return ::std::make_pair(iter->second.cbegin(), iter->second.cend());
 
       }
+      /// the values of key, in place, without the concat_iter and without copying.  valid until the map is modified.
+      ::fsc::span<T> equal_range_span(Key const & key) const {
+        auto iter = map.find(key);
+        if (iter == map.end()) return ::fsc::span<T>();
+        return ::fsc::make_span(iter->second.cbegin(), iter->second.cend());
+      }
 
 
       ::std::pair<iterator, iterator> equal_range(Key const & key) {
@@ -1361,6 +1371,7 @@ using allocator = std::allocator<T>;
           //s += count;
       }
 
+      /// insert a range after sorting it by key.  the range is a consumed buffer:  entries are moved out, not copied.
       template <class InputIt>
       void insert_sorted(InputIt first, InputIt last) {
           size_t ss = std::distance(first, last);
@@ -1388,7 +1399,7 @@ using allocator = std::allocator<T>;
 
             ss = std::distance(start, it);
             map[key].reserve(map[key].size() + ss);
-            std::copy(start, it, std::back_inserter(map[key]));
+            std::move(start, it, std::back_inserter(map[key]));
 
             s += ss;
           }
@@ -1505,6 +1516,12 @@ using allocator = std::allocator<T>;
         return ::std::make_pair(iter->second.cbegin(), iter->second.cend());
 
       }
+      /// the entries of key, in place, without the concat_iter and without copying.  valid until the map is modified.
+      ::fsc::span<::std::pair<Key, T> > equal_range_span(Key const & key) const {
+        auto iter = map.find(key);
+        if (iter == map.end()) return ::fsc::span<::std::pair<Key, T> >();
+        return ::fsc::make_span(iter->second.cbegin(), iter->second.cend());
+      }
 
 
       ::std::pair<iterator, iterator> equal_range(Key const & key) {
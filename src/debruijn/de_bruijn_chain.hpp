@@ -0,0 +1,268 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    de_bruijn_chain.hpp
+ * @ingroup debruijn
+ * @author  tpan
+ * @brief   per node state for compacting linear chains of a de bruijn graph into unitigs.
+ * @details a node is stored once, in one orientation (the stored key), with in and out edges relative to that
+ *          orientation.  each node has 2 sides, IN and OUT.  side s of node u is linked to node v if u has exactly
+ *          1 edge on s, and v has exactly 1 edge on the side that the edge enters v through.  a linked edge may
+ *          flip orientation: the stored key of v may be the reverse complement of the k-mer generated from u.
+ *
+ *          a unitig is a maximal chain of linked nodes.  it is found by list ranking with pointer jumping:
+ *          each side of a node keeps the node that is dist steps away along the chain (target), and the side of
+ *          target to continue through.  each round replaces target with target's own entry for that side, so
+ *          dist doubles until target is the end of the chain.  this header has the node local part, i.e. the
+ *          link test, the jump, and the final unitig assignment.  de_bruijn_compaction.hpp does the distributed
+ *          lookups.
+ *
+ *          linear unitigs are named by the smaller of the 2 end nodes.  circular unitigs have no end and are named
+ *          by their smallest node, which is tracked during the jumps.
+ */
+#ifndef DE_BRUIJN_CHAIN_HPP_
+#define DE_BRUIJN_CHAIN_HPP_
+
+#include <cstdint>
+#include <utility>      // pair
+
+namespace bliss
+{
+  namespace de_bruijn
+  {
+    namespace chain
+    {
+      /// side of a node with the in edges, counts[4..7] of the node trait.
+      static constexpr uint8_t IN = 0;
+      /// side of a node with the out edges, counts[0..3] of the node trait.
+      static constexpr uint8_t OUT = 1;
+
+      /**
+       * @brief walk state for 1 side of a node.
+       * @details  span is the nodes after this node up to and including target.
+       */
+      template <typename Kmer>
+      struct chain_end {
+          /// node reached after dist steps.  stored key.
+          Kmer target;
+          /// smallest node key in the span.
+          Kmer min_key;
+          /// number of steps to target.  0 if the side is not linked.
+          uint64_t dist;
+          /// number of steps to min_key.
+          uint64_t min_dist;
+          /// side of target to continue the walk through.
+          uint8_t side;
+          /// side of min_key that the walk continues through.
+          uint8_t min_side;
+          /// 1 if target is the end of the chain.
+          uint8_t done;
+      };
+
+      /// chain state of a node, indexed by IN and OUT.
+      template <typename Kmer>
+      struct chain_node {
+          chain_end<Kmer> ends[2];
+      };
+
+      /// unitig membership of a node.
+      template <typename Kmer>
+      struct unitig_info {
+          /// stored key of the first node of the unitig.
+          Kmer id;
+          /// number of steps from the first node.
+          uint64_t rank;
+          /// number of nodes in the unitig.
+          uint64_t length;
+          /// 1 if the stored key is the reverse complement of the node in the unitig's direction.
+          uint8_t flip;
+          /// 1 if the unitig is a cycle.
+          uint8_t circular;
+      };
+
+
+      /**
+       * @brief walk operations on the chain state.
+       * @tparam Kmer      k-mer type, in stored orientation.
+       */
+      template <typename Kmer>
+      class chain_ops {
+        public:
+
+          /// initial state of an unlinked side:  the node is the end of the chain.
+          static chain_end<Kmer> terminal(Kmer const & kmer, uint8_t side) {
+            chain_end<Kmer> e;
+            e.target = kmer;
+            e.min_key = kmer;
+            e.dist = 0;
+            e.min_dist = 0;
+            e.side = side;
+            e.min_side = side;
+            e.done = 1;
+            return e;
+          }
+
+          /// true if the side still needs to jump.  cycles stop once the span covers all n nodes.
+          static bool active(chain_end<Kmer> const & e, uint64_t n) {
+            return (e.done == 0) && (e.dist < n);
+          }
+
+          /**
+           * @brief one pointer jumping step.
+           * @param next  the state of e.target for side e.side, from before this round.
+           */
+          static void jump(chain_end<Kmer> & e, chain_end<Kmer> const & next) {
+            if (next.dist == 0) {
+              // target is the end of the chain.
+              e.done = 1;
+              return;
+            }
+            if (next.min_key < e.min_key) {
+              e.min_key = next.min_key;
+              e.min_dist = e.dist + next.min_dist;
+              e.min_side = next.min_side;
+            }
+            e.target = next.target;
+            e.side = next.side;
+            e.dist += next.dist;
+            e.done = next.done;
+          }
+
+          /**
+           * @brief unitig membership once no side is active.
+           * @details  a linear unitig starts at the smaller of its 2 end nodes.  the node is flipped if the first node
+           *          is reached through its OUT side.
+           *          a circular unitig starts at its smallest node, in the orientation of that node's stored key.
+           *          both walks from the node have covered the cycle and reached the smallest node; the walk that
+           *          arrives there continuing through IN is the reverse of the unitig's direction, and gives the rank.
+           */
+          static unitig_info<Kmer> assign(Kmer const & kmer, chain_node<Kmer> const & node) {
+            chain_end<Kmer> const & in = node.ends[IN];
+            chain_end<Kmer> const & out = node.ends[OUT];
+
+            unitig_info<Kmer> u;
+            if (in.done && out.done) {
+              u.circular = 0;
+              u.length = in.dist + out.dist + 1;
+              if (out.target < in.target) {
+                u.id = out.target;
+                u.rank = out.dist;
+                u.flip = 1;
+              } else {
+                u.id = in.target;
+                u.rank = in.dist;
+                u.flip = 0;
+              }
+              return u;
+            }
+
+            u.circular = 1;
+            if (!(in.min_key < kmer)) {
+              // this node is the smallest.  the walk returns to it after a full cycle.
+              u.id = kmer;
+              u.rank = 0;
+              u.length = in.min_dist;
+              u.flip = 0;
+            } else {
+              u.id = in.min_key;
+              u.length = in.min_dist + out.min_dist;
+              if (in.min_side == IN) {
+                u.rank = in.min_dist;
+                u.flip = 0;
+              } else {
+                u.rank = out.min_dist;
+                u.flip = 1;
+              }
+            }
+            return u;
+          }
+      };
+
+
+      /**
+       * @brief link test for a node trait type.
+       * @tparam Kmer      k-mer type, in stored orientation.
+       * @tparam EdgeType  node trait type, e.g. edge_counts or edge_exists.
+       */
+      template <typename Kmer, typename EdgeType>
+      class chain_utils : public chain_ops<Kmer> {
+        public:
+          using chain_ops<Kmer>::terminal;
+
+          /// number of edges on a side.
+          static unsigned int degree(EdgeType const & edge, uint8_t side) {
+            unsigned int offset = (side == OUT) ? 0 : 4;
+            unsigned int d = 0;
+            for (unsigned int i = 0; i < 4; ++i) {
+              d += (edge.get_edge_frequency(offset + i) > 0) ? 1 : 0;
+            }
+            return d;
+          }
+
+          /**
+           * @brief the neighbor on a side, as the k-mer generated from kmer (i.e. not necessarily stored orientation).
+           * @return false if the side does not have exactly 1 edge.
+           */
+          static bool neighbor(Kmer const & kmer, EdgeType const & edge, uint8_t side, Kmer & next) {
+            unsigned int offset = (side == OUT) ? 0 : 4;
+            int c = -1;
+            for (int i = 0; i < 4; ++i) {
+              if (edge.get_edge_frequency(offset + i) > 0) {
+                if (c >= 0) return false;
+                c = i;
+              }
+            }
+            if (c < 0) return false;
+
+            next = kmer;
+            if (side == OUT) next.nextFromChar(c);
+            else next.nextReverseFromChar(c);
+            return true;
+          }
+
+          /**
+           * @brief initial state of a side, given the neighbor's stored key and edges.
+           * @param next         neighbor k-mer as generated by neighbor()
+           * @param next_stored  stored key of the neighbor, next or its reverse complement.
+           * @return  terminal state if the neighbor does not link back, or if it is the node itself (self loop or hairpin).
+           */
+          static chain_end<Kmer> link(Kmer const & kmer, uint8_t side, Kmer const & next,
+                                      Kmer const & next_stored, EdgeType const & next_edge) {
+            if (next_stored == kmer) return terminal(kmer, side);
+
+            uint8_t flip = (next_stored == next) ? 0 : 1;
+            // the edge enters next through the opposite side, and the opposite again if flipped.
+            uint8_t back = (1 - side) ^ flip;
+            if (degree(next_edge, back) != 1) return terminal(kmer, side);
+
+            chain_end<Kmer> e;
+            e.target = next_stored;
+            e.min_key = next_stored;
+            e.dist = 1;
+            e.min_dist = 1;
+            e.side = side ^ flip;
+            e.min_side = e.side;
+            e.done = 0;
+            return e;
+          }
+      };
+
+    } /* namespace chain */
+  } /* namespace de_bruijn */
+} /* namespace bliss */
+
+#endif /* DE_BRUIJN_CHAIN_HPP_ */
@@ -0,0 +1,430 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    de_bruijn_cleaning.hpp
+ * @ingroup debruijn
+ * @author  tpan
+ * @brief   distributed tip clipping and bubble popping of a de bruijn graph, driven by a shrinking active set.
+ * @details each rank keeps a frontier of local nodes to (re)examine.  the first iteration has all nodes.
+ *          an iteration:
+ *
+ *          1. start walks from the frontier nodes:  a tip walk from a node with no edge on 1 side and 1 on the other,
+ *             and a bubble walk along each edge of a side with 2 or more edges, except the best edge of the side
+ *             (highest count, then lowest index).  the walks live on the frontier node's rank.
+ *          2. walk rounds.  each round advances all walks by 1 node with 1 batched find on the node map.  a walk
+ *             continues through nodes with 1 edge on each side, and ends at a node where other paths join
+ *             (2 or more edges on the side it enters through), or when it is too long.  if the walk enters the
+ *             junction through an edge that is not the best of its side, its path is removed:  for a tip, the nodes
+ *             from the dead end; for a bubble, the nodes between the 2 branch nodes.  this pops simple bubbles, and
+ *             the weak paths of overlapping ones, 1 path at a time.  the best edge of a side is never removed, so
+ *             cleaning does not disconnect the nodes it keeps.
+ *          3. 1 distribute of edge removals to the owners of the junctions, which clear the edges to removed paths,
+ *             then 1 erase of the removed nodes.
+ *
+ *          the next frontier is the nodes that lost an edge, plus the start of any walk that stopped at one of them
+ *          because it branched there (the branch may have been removed).  such walks register with the branch node's
+ *          owner along with the edge removals.  the work of an iteration is proportional to the changes of the
+ *          previous one rather than to the graph size.
+ *
+ *          a bubble path is found from both ends.  the test at each end is the same, so both remove it.
+ *
+ *          keys are stored keys.  as with unitig_compaction, neighbors are looked up in the orientation generated,
+ *          so the node map has to find a node in either orientation (e.g. BimoleculeHashMapParams).
+ */
+#ifndef DE_BRUIJN_CLEANING_HPP_
+#define DE_BRUIJN_CLEANING_HPP_
+
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mpi.h"
+#endif
+
+#include <vector>
+#include <map>
+#include <limits>       // numeric_limits
+#include <utility>      // pair
+#include <algorithm>    // sort, lower_bound, unique
+
+#include "debruijn/de_bruijn_chain.hpp"
+#include "debruijn/debruijn_mxx_support.hpp"
+#include "containers/dsc_container_utils.hpp"
+
+#include "utils/benchmark_utils.hpp"  // for timing.
+#include "utils/logging.h"
+
+
+namespace bliss
+{
+  namespace de_bruijn
+  {
+
+    /**
+     * @brief  removes tips and bubbles from a distributed de bruijn graph, iterating over the changed nodes only.
+     * @tparam NodeMapType  a de_bruijn_nodes_distributed.  nodes are modified in place.
+     */
+    template <typename NodeMapType>
+    class graph_cleaning {
+
+      public:
+        using Key = typename NodeMapType::key_type;
+        using EdgeType = typename NodeMapType::mapped_type;
+
+        /// work and results of clean().  local unless noted.
+        struct stats {
+            /// iterations until the frontier was empty.  global.
+            size_t iterations = 0;
+            /// walk rounds over all iterations.  global.
+            size_t rounds = 0;
+            /// tips clipped by walks from this rank.
+            size_t tips = 0;
+            /// bubble paths removed by walks from this rank, counted from 1 end.
+            size_t bubbles = 0;
+            /// nodes erased on this rank.
+            size_t removed = 0;
+            /// frontier size on this rank, per iteration.
+            ::std::vector<size_t> frontier;
+        };
+
+      protected:
+        using Utils = ::bliss::de_bruijn::chain::chain_utils<Key, EdgeType>;
+
+        static constexpr uint8_t TIP = 0;
+        static constexpr uint8_t BUBBLE = 1;
+        /// update record for a walk waiting on a branch node.  0 to 7 are edge removals.
+        static constexpr uint8_t WAIT = 8;
+
+        /// 1 walk.
+        struct walk {
+            /// stored key of the node the walk started from.
+            Key origin;
+            /// stored key of the last node reached.
+            Key last;
+            /// next k-mer, generated from last.
+            Key next;
+            /// tip:  the nodes from the dead end.  bubble:  the nodes between origin and the end.
+            ::std::vector<Key> path;
+            /// side of last that the walk leaves through.
+            uint8_t side;
+            /// side of origin that the walk leaves through.
+            uint8_t origin_side;
+            /// edge index at origin.
+            uint8_t first;
+            /// TIP or BUBBLE.
+            uint8_t kind;
+            /// junction at the end of the walk:  stored key, side entered through, and edge index to last.
+            Key end;
+            uint8_t end_side;
+            uint8_t end_edge;
+        };
+
+        /// the node map.
+        NodeMapType & nodes;
+
+        /// communicator, same as the node map.
+        mxx::comm const & comm;
+
+        /// longest tip removed, in nodes.
+        size_t max_tip;
+        /// longest bubble path removed, in nodes between the 2 ends.
+        size_t max_bubble;
+
+        /// walks waiting on a local branch node:  branch -> walk origin.
+        ::std::multimap<Key, Key> waiting;
+
+        /// compare the keys of find results.
+        struct KeyLess {
+            template <typename V>
+            bool operator()(V const & x, V const & y) const {
+              return x.first < y.first;
+            }
+            template <typename V>
+            bool operator()(V const & x, Key const & y) const {
+              return x.first < y;
+            }
+        };
+
+        /// look up an exact key in sorted find results.  returns end if not there.
+        template <typename V>
+        static typename ::std::vector<V>::const_iterator lookup(::std::vector<V> const & results, Key const & key) {
+          auto it = ::std::lower_bound(results.begin(), results.end(), key, KeyLess());
+          if ((it != results.end()) && (it->first == key)) return it;
+          return results.end();
+        }
+
+        /// the k-mer along edge idx of kmer.
+        static Key follow(Key const & kmer, uint8_t idx) {
+          Key next = kmer;
+          if (idx < 4) next.nextFromChar(idx);
+          else next.nextReverseFromChar(idx - 4);
+          return next;
+        }
+
+        /// index of the edge on side of kmer that leads to target (stored key).  8 if none.
+        static uint8_t edge_to(Key const & kmer, EdgeType const & edge, uint8_t side, Key const & target) {
+          uint8_t offset = (side == ::bliss::de_bruijn::chain::OUT) ? 0 : 4;
+          for (uint8_t i = offset; i < offset + 4; ++i) {
+            if (edge.get_edge_frequency(i) == 0) continue;
+            Key next = follow(kmer, i);
+            if ((next == target) || (next.reverse_complement() == target)) return i;
+          }
+          return 8;
+        }
+
+        /// true if another edge on the same side as idx has a higher count, or the same count and a lower index.
+        static bool has_better(EdgeType const & edge, uint8_t idx) {
+          uint8_t offset = (idx < 4) ? 0 : 4;
+          size_t count = edge.get_edge_frequency(idx);
+          for (uint8_t i = offset; i < offset + 4; ++i) {
+            if (i == idx) continue;
+            size_t c = edge.get_edge_frequency(i);
+            if ((c > count) || ((c == count) && (c > 0) && (i < idx))) return true;
+          }
+          return false;
+        }
+
+        /// start the walks from a local node.
+        void start(Key const & kmer, EdgeType const & edge, ::std::vector<walk> & walks) {
+          unsigned int deg[2] = { Utils::degree(edge, ::bliss::de_bruijn::chain::IN), Utils::degree(edge, ::bliss::de_bruijn::chain::OUT) };
+
+          walk w;
+          w.origin = kmer;
+          w.last = kmer;
+          w.first = 8;
+
+          for (uint8_t s = 0; s < 2; ++s) {
+            if ((deg[s] == 1) && (deg[1 - s] == 0)) {
+              // dead end on the other side.
+              w.kind = TIP;
+              w.side = s;
+              w.origin_side = s;
+              Utils::neighbor(kmer, edge, s, w.next);
+              w.path.assign(1, kmer);
+              walks.emplace_back(w);
+            } else if (deg[s] > 1) {
+              w.kind = BUBBLE;
+              w.side = s;
+              w.origin_side = s;
+              w.path.clear();
+              // the best edge of the side stays.
+              uint8_t offset = (s == ::bliss::de_bruijn::chain::OUT) ? 0 : 4;
+              for (uint8_t i = offset; i < offset + 4; ++i) {
+                if ((edge.get_edge_frequency(i) == 0) || !has_better(edge, i)) continue;
+                w.first = i;
+                w.next = follow(kmer, i);
+                walks.emplace_back(w);
+              }
+            }
+          }
+        }
+
+        /**
+         * @brief advance a walk to the next node, given its stored key and edges.
+         * @return  true if the walk continues.  otherwise w.end_edge is 8 if the walk is dropped, and w.end_side is 2 if
+         *          the walk waits on w.end.
+         */
+        bool step(walk & w, Key const & stored, EdgeType const & edge) const {
+          w.end_edge = 8;
+          w.end_side = 0;
+          if ((stored == w.origin) ||
+              (::std::find(w.path.begin(), w.path.end(), stored) != w.path.end())) return false;  // cycle.
+
+          // the edge enters through the opposite side, and the opposite again if flipped.
+          uint8_t flip = (stored == w.next) ? 0 : 1;
+          uint8_t back = (1 - w.side) ^ flip;
+          uint8_t ahead = 1 - back;
+          unsigned int in = Utils::degree(edge, back);
+          unsigned int out = Utils::degree(edge, ahead);
+
+          if (in > 1) {
+            // other paths join here.  the walk is removed only if 1 of them is better.
+            uint8_t e = edge_to(stored, edge, back, w.last);
+            if ((e == 8) || !has_better(edge, e)) return false;
+            w.end = stored;
+            w.end_side = back;
+            w.end_edge = e;
+            return false;
+          }
+          if ((out == 1) && (w.path.size() < ((w.kind == TIP) ? max_tip : max_bubble))) {
+            w.path.emplace_back(stored);
+            w.last = stored;
+            w.side = ahead;
+            Utils::neighbor(stored, edge, ahead, w.next);
+            return true;
+          }
+          if (out > 1) {
+            // branches here.  retry once the branch changes.
+            w.end = stored;
+            w.end_side = 2;
+          }
+          return false;
+        }
+
+        /**
+         * @brief send edge removals and waiting walks to the owners of the nodes, and apply them.  collective.
+         * @return  the next frontier:  nodes that lost an edge, and the starts of the walks waiting on them.
+         */
+        ::std::vector<Key> apply(::std::vector<::std::pair<Key, ::std::pair<Key, uint8_t> > > & updates) {
+          if (comm.size() > 1) {
+            bool sorted = false;
+            ::dsc::distribute(updates, nodes.get_key_to_rank(), sorted, comm);
+          }
+
+          for (auto const & u : updates) {
+            if (u.second.second == WAIT) waiting.emplace(u.first, u.second.first);
+          }
+
+          ::std::vector<Key> changed, released;
+          for (auto const & u : updates) {
+            if ((u.second.second < WAIT) && nodes.local_remove_edge(u.first, u.second.second)) changed.emplace_back(u.first);
+          }
+          ::std::sort(changed.begin(), changed.end());
+          changed.erase(::std::unique(changed.begin(), changed.end()), changed.end());
+
+          for (auto const & k : changed) {
+            auto range = waiting.equal_range(k);
+            for (auto it = range.first; it != range.second; ++it) released.emplace_back(it->second);
+            waiting.erase(range.first, range.second);
+          }
+
+          // the walk starts go back to their owners.
+          if (comm.size() > 1) {
+            bool sorted = false;
+            ::dsc::distribute(released, nodes.get_key_to_rank(), sorted, comm);
+          }
+
+          changed.insert(changed.end(), released.begin(), released.end());
+          ::std::sort(changed.begin(), changed.end());
+          changed.erase(::std::unique(changed.begin(), changed.end()), changed.end());
+          return changed;
+        }
+
+      public:
+        /**
+         * @param _nodes        the graph.
+         * @param _max_tip      longest tip to clip, in nodes.  0 for 2k.
+         * @param _max_bubble   longest bubble path to remove, in nodes between the 2 ends.  0 for 2k.
+         */
+        graph_cleaning(NodeMapType & _nodes, size_t _max_tip = 0, size_t _max_bubble = 0) :
+          nodes(_nodes), comm(_nodes.get_comm()),
+          max_tip(_max_tip == 0 ? 2 * Key::size : _max_tip),
+          max_bubble(_max_bubble == 0 ? 2 * Key::size : _max_bubble) {}
+
+        virtual ~graph_cleaning() {}
+
+        /**
+         * @brief clip tips and pop bubbles until nothing changes, or for at most max_iterations.  collective.
+         * @return  work and results.
+         */
+        stats clean(size_t max_iterations = ::std::numeric_limits<size_t>::max()) {
+          BL_BENCH_INIT(clean);
+
+          stats st;
+          waiting.clear();
+          auto & local = nodes.get_local_container();
+
+          // first frontier:  all nodes.
+          BL_BENCH_START(clean);
+          ::std::vector<Key> frontier;
+          frontier.reserve(local.size());
+          for (auto it = local.begin(); it != local.end(); ++it) frontier.emplace_back(it->first);
+          BL_BENCH_END(clean, "frontier", frontier.size());
+
+          ::std::vector<walk> walks, done;
+          ::std::vector<Key> queries, erase;
+          ::std::vector<::std::pair<Key, ::std::pair<Key, uint8_t> > > updates;
+
+          while ((st.iterations < max_iterations) && !::mxx::all_of(frontier.empty(), comm)) {
+            ++st.iterations;
+            st.frontier.emplace_back(frontier.size());
+
+            BL_BENCH_START(clean);
+            walks.clear();
+            done.clear();
+            for (auto const & k : frontier) {
+              auto it = local.find(k);
+              if (it != local.end()) start(it->first, it->second, walks);
+            }
+            BL_BENCH_END(clean, "start", walks.size());
+
+            // walk rounds.  1 batched find each.
+            BL_BENCH_COLLECTIVE_START(clean, "walk", comm);
+            while (!::mxx::all_of(walks.empty(), comm)) {
+              ++st.rounds;
+              queries.clear();
+              for (auto const & w : walks) queries.emplace_back(w.next);
+
+              auto found = nodes.find(queries);
+              ::std::sort(found.begin(), found.end(), KeyLess());
+
+              size_t j = 0;
+              for (size_t i = 0; i < walks.size(); ++i) {
+                walk & w = walks[i];
+                auto f = lookup(found, w.next);
+                if (f == found.end()) f = lookup(found, w.next.reverse_complement());
+                if (f == found.end()) continue;
+
+                if (step(w, f->first, f->second)) {
+                  if (j != i) walks[j] = ::std::move(w);
+                  ++j;
+                } else if ((w.end_edge < 8) || (w.end_side == 2)) {
+                  done.emplace_back(::std::move(w));
+                }
+              }
+              walks.resize(j);
+            }
+            BL_BENCH_END(clean, "walk", done.size());
+
+            // remove the paths, and the edges from the junctions to them.
+            BL_BENCH_START(clean);
+            updates.clear();
+            erase.clear();
+            for (auto const & w : done) {
+              if (w.end_side == 2) {
+                updates.emplace_back(w.end, ::std::make_pair(w.origin, static_cast<uint8_t>(WAIT)));
+                continue;
+              }
+              erase.insert(erase.end(), w.path.begin(), w.path.end());
+              updates.emplace_back(w.end, ::std::make_pair(w.end, w.end_edge));
+              if (w.kind == TIP) {
+                ++st.tips;
+              } else {
+                updates.emplace_back(w.origin, ::std::make_pair(w.origin, w.first));
+                // found from both ends.  count once.
+                if (w.origin < w.end) ++st.bubbles;
+              }
+            }
+            BL_BENCH_END(clean, "decide", erase.size());
+
+            BL_BENCH_COLLECTIVE_START(clean, "update", comm);
+            frontier = apply(updates);
+            BL_BENCH_END(clean, "update", frontier.size());
+
+            BL_BENCH_COLLECTIVE_START(clean, "erase", comm);
+            st.removed += nodes.erase(erase);
+            BL_BENCH_END(clean, "erase", st.removed);
+          }
+
+          BL_BENCH_REPORT_MPI_NAMED(clean, "graph_cleaning:clean", comm);
+          return st;
+        }
+    };
+
+  } /* namespace de_bruijn */
+} /* namespace bliss */
+
+#endif /* DE_BRUIJN_CLEANING_HPP_ */
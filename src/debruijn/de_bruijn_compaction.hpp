@@ -0,0 +1,264 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    de_bruijn_compaction.hpp
+ * @ingroup debruijn
+ * @author  tpan
+ * @brief   distributed compaction of a de bruijn graph into unitigs.
+ * @details the chain state (de_bruijn_chain.hpp) of each node is kept in a distributed map with the same MapParams
+ *          as the node map, so it lives on the same rank as the node.  there are 2 phases:
+ *
+ *          1. link:  each rank generates the unique neighbor of each side of its nodes, and looks all of them up
+ *             with 1 batched find on the node map, to check that the neighbor links back.
+ *          2. rank:  pointer jumping.  each round, every side that has not reached the end of its chain queries
+ *             its target's chain state with 1 batched find on the chain map, then jumps.  a chain of length L
+ *             takes about log2(L) rounds.  cycles are stopped once the jump distance reaches the number of nodes.
+ *
+ *          the result assigns each local node a unitig id, its rank within the unitig, and its orientation.
+ *          the unitig sequences can then be assembled by sorting nodes by (id, rank).
+ */
+#ifndef DE_BRUIJN_COMPACTION_HPP_
+#define DE_BRUIJN_COMPACTION_HPP_
+
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mpi.h"
+#endif
+
+#include <vector>
+#include <utility>      // pair
+#include <algorithm>    // sort, lower_bound
+
+#include "debruijn/de_bruijn_chain.hpp"
+#include "debruijn/debruijn_mxx_support.hpp"
+#include "containers/distributed_unordered_map.hpp"
+
+#include "utils/benchmark_utils.hpp"  // for timing.
+#include "utils/logging.h"
+
+
+namespace bliss
+{
+  namespace de_bruijn
+  {
+
+    /**
+     * @brief  computes the unitigs of a distributed de bruijn graph.
+     * @tparam Key        k-mer type
+     * @tparam MapParams  map parameters of the node map.  the chain map uses the same to colocate with the nodes.
+     */
+    template <typename Key, template <typename> class MapParams>
+    class unitig_compaction {
+
+      public:
+        using chain_node_type = ::bliss::de_bruijn::chain::chain_node<Key>;
+        using unitig_info_type = ::bliss::de_bruijn::chain::unitig_info<Key>;
+        using chain_map_type = ::dsc::unordered_map<Key, chain_node_type, MapParams>;
+
+      protected:
+        /// chain state per node.
+        chain_map_type chains;
+
+        /// communicator, same as the node map.
+        mxx::comm const & comm;
+
+        /// pointer jumping rounds in the last call to rank().
+        size_t rounds;
+
+        /// compare the keys of find results.
+        struct KeyLess {
+            template <typename V>
+            bool operator()(V const & x, V const & y) const {
+              return x.first < y.first;
+            }
+            template <typename V>
+            bool operator()(V const & x, Key const & y) const {
+              return x.first < y;
+            }
+        };
+
+        /// look up an exact key in sorted find results.  returns end if not there.
+        template <typename V>
+        static typename ::std::vector<V>::const_iterator lookup(::std::vector<V> const & results, Key const & key) {
+          auto it = ::std::lower_bound(results.begin(), results.end(), key, KeyLess());
+          if ((it != results.end()) && (it->first == key)) return it;
+          return results.end();
+        }
+
+      public:
+        unitig_compaction(const mxx::comm & _comm) : chains(_comm), comm(_comm), rounds(0) {}
+
+        virtual ~unitig_compaction() {}
+
+        /// the chain map, e.g. to inspect the link state.
+        chain_map_type & get_chain_map() {
+          return chains;
+        }
+
+        /// number of pointer jumping rounds taken by rank().
+        size_t get_rounds() const {
+          return rounds;
+        }
+
+        /**
+         * @brief phase 1: find the linked sides of each node.  collective.
+         * @param nodes   a de_bruijn_nodes_distributed.  keys are in stored orientation.
+         */
+        template <typename NodeMapType>
+        void link(NodeMapType & nodes) {
+          using EdgeType = typename NodeMapType::mapped_type;
+          using Utils = ::bliss::de_bruijn::chain::chain_utils<Key, EdgeType>;
+
+          BL_BENCH_INIT(link);
+
+          auto & local = nodes.get_local_container();
+
+          // generate the unique neighbor of every side with 1 edge.
+          BL_BENCH_START(link);
+          ::std::vector<Key> queries;
+          ::std::vector<::std::pair<Key, chain_node_type> > states;
+          queries.reserve(local.size() * 2);
+          states.reserve(local.size());
+
+          Key next;
+          for (auto it = local.begin(); it != local.end(); ++it) {
+            chain_node_type n;
+            for (uint8_t s = 0; s < 2; ++s) {
+              n.ends[s] = Utils::terminal(it->first, s);
+              if (Utils::neighbor(it->first, it->second, s, next)) {
+                queries.emplace_back(next);
+              }
+            }
+            states.emplace_back(it->first, n);
+          }
+          BL_BENCH_END(link, "neighbors", queries.size());
+
+          // 1 batched lookup.  results are stored keys.
+          BL_BENCH_COLLECTIVE_START(link, "find", comm);
+          auto found = nodes.find(queries);
+          ::std::sort(found.begin(), found.end(), KeyLess());
+          BL_BENCH_END(link, "find", found.size());
+
+          BL_BENCH_START(link);
+          auto s_it = states.begin();
+          for (auto it = local.begin(); it != local.end(); ++it, ++s_it) {
+            for (uint8_t s = 0; s < 2; ++s) {
+              if (! Utils::neighbor(it->first, it->second, s, next)) continue;
+
+              // the neighbor is stored in either orientation.
+              auto f = lookup(found, next);
+              if (f == found.end()) f = lookup(found, next.reverse_complement());
+              if (f == found.end()) continue;
+
+              s_it->second.ends[s] = Utils::link(it->first, s, next, f->first, f->second);
+            }
+          }
+          BL_BENCH_END(link, "link", states.size());
+
+          BL_BENCH_COLLECTIVE_START(link, "insert", comm);
+          chains.insert(states);
+          BL_BENCH_END(link, "insert", chains.local_size());
+
+          BL_BENCH_REPORT_MPI_NAMED(link, "unitig_compaction:link", comm);
+        }
+
+        /**
+         * @brief phase 2: pointer jumping until every side has reached the end of its chain.  collective.
+         * @return  number of rounds.
+         */
+        size_t rank() {
+          using Utils = ::bliss::de_bruijn::chain::chain_ops<Key>;
+
+          BL_BENCH_INIT(rank);
+
+          auto & local = chains.get_local_container();
+          uint64_t n = chains.size();
+
+          rounds = 0;
+          ::std::vector<Key> queries;
+          queries.reserve(local.size() * 2);
+
+          while (true) {
+            BL_BENCH_START(rank);
+            queries.clear();
+            for (auto it = local.begin(); it != local.end(); ++it) {
+              for (uint8_t s = 0; s < 2; ++s) {
+                if (Utils::active(it->second.ends[s], n)) queries.emplace_back(it->second.ends[s].target);
+              }
+            }
+            BL_BENCH_END(rank, "targets", queries.size());
+
+            if (::mxx::all_of(queries.empty(), comm)) break;
+
+            // state of all targets from before this round.
+            BL_BENCH_COLLECTIVE_START(rank, "find", comm);
+            auto found = chains.find(queries);
+            ::std::sort(found.begin(), found.end(), KeyLess());
+            BL_BENCH_END(rank, "find", found.size());
+
+            BL_BENCH_START(rank);
+            for (auto it = local.begin(); it != local.end(); ++it) {
+              for (uint8_t s = 0; s < 2; ++s) {
+                auto & e = it->second.ends[s];
+                if (! Utils::active(e, n)) continue;
+
+                auto f = lookup(found, e.target);
+                if (f == found.end()) e.done = 1;  // target is not in the graph.
+                else Utils::jump(e, f->second.ends[e.side]);
+              }
+            }
+            BL_BENCH_END(rank, "jump", local.size());
+
+            ++rounds;
+          }
+
+          BL_BENCH_REPORT_MPI_NAMED(rank, "unitig_compaction:rank", comm);
+
+          return rounds;
+        }
+
+        /// unitig membership of the local nodes.  local, call after rank().
+        ::std::vector<::std::pair<Key, unitig_info_type> > assign() {
+          using Utils = ::bliss::de_bruijn::chain::chain_ops<Key>;
+
+          auto & local = chains.get_local_container();
+
+          ::std::vector<::std::pair<Key, unitig_info_type> > results;
+          results.reserve(local.size());
+          for (auto it = local.begin(); it != local.end(); ++it) {
+            results.emplace_back(it->first, Utils::assign(it->first, it->second));
+          }
+          return results;
+        }
+
+        /**
+         * @brief link, rank and assign.  collective.
+         * @return  unitig membership of the local nodes.
+         */
+        template <typename NodeMapType>
+        ::std::vector<::std::pair<Key, unitig_info_type> > compact(NodeMapType & nodes) {
+          link(nodes);
+          rank();
+          return assign();
+        }
+    };
+
+  } /* namespace de_bruijn */
+} /* namespace bliss */
+
+#endif /* DE_BRUIJN_COMPACTION_HPP_ */
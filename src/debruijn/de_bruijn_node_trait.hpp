@@ -40,6 +40,10 @@
 #include <tuple>        // tuple and utility functions
 #include <utility>      // pair and utility functions.
 #include <type_traits>
+#include <array>
+#include <vector>
+#include <limits>       // numeric_limits
+#include <ostream>
 
 #include "utils/logging.h"
 #include "common/alphabets.hpp"
@@ -111,6 +115,38 @@ namespace bliss
             }
           }
 
+          /// write the out then in neighbors with non-zero edge count to output.  for batching the neighbors of many nodes.
+          template <typename OutputIterator>
+          static OutputIterator get_neighbors(Kmer const & kmer, EdgeType const & edge, OutputIterator output) {
+            Kmer next;
+            for (int i = 0; i < 4; ++i) {
+              if (edge.get_edge_frequency(i) > 0) {
+                next = kmer;
+                next.nextFromChar(i);
+                *output = next;
+                ++output;
+              }
+            }
+            for (int i = 0; i < 4; ++i) {
+              if (edge.get_edge_frequency(i + 4) > 0) {
+                next = kmer;
+                next.nextReverseFromChar(i);
+                *output = next;
+                ++output;
+              }
+            }
+            return output;
+          }
+
+          /// number of edges with non-zero count, in and out.
+          static size_t get_degree(EdgeType const & edge) {
+            size_t d = 0;
+            for (int i = 0; i < 8; ++i) {
+              d += (edge.get_edge_frequency(i) > 0) ? 1 : 0;
+            }
+            return d;
+          }
+
 
       };
 
@@ -262,6 +298,11 @@ namespace bliss
 				  return counts[idx];
 				}
 
+				/// clear edge idx (0 to 7, as in get_edge_frequency), e.g. when the neighbor is removed from the graph.
+				void remove_edge(uint8_t idx) {
+				  if (idx < 8) counts[idx] = 0;
+				}
+
 			};
 
 
@@ -332,6 +373,138 @@ namespace bliss
           return (counts >> idx) & 0x1;
         }
 
+        /// clear edge idx (0 to 7).
+        void remove_edge(uint8_t idx) {
+          if (idx < 8) counts &= ~(1 << idx);
+        }
+
+
+      };
+
+
+      /**
+       * @brief kmer metadata with edge counts as small saturating counters, packed into 64 bit words.
+       * @details same layout and update semantics as edge_counts:  counters 0-3 are out edges, 4-7 in edges, 8 the kmer count,
+       *          relative to the kmer's orientation.  with BITS = 4 the 9 counters fit in 1 word (8 bytes, vs 36 for edge_counts<A, uint32_t>),
+       *          with BITS = 8 in 2 words.  counters stop at max_count.  update() reports the increments lost to saturation so
+       *          the container can keep the excess in a side table (see de_bruijn_nodes_distributed).
+       */
+      template<typename ALPHA, unsigned int BITS = 4>
+      class packed_edge_counts {
+          static_assert(BITS == 4 || BITS == 8, "packed_edge_counts supports 4 or 8 bit counters");
+
+        public:
+
+          using Alphabet = ALPHA;
+          using CountType = uint8_t;
+
+          /// number of counters per word.  BITS divides 64, so a counter does not span 2 words.
+          static constexpr unsigned int per_word = 64 / BITS;
+          static constexpr unsigned int nWords = (9 + per_word - 1) / per_word;
+          /// saturation value.
+          static constexpr CountType max_count = (1U << BITS) - 1;
+
+          friend std::ostream& operator<<(std::ostream& ost, const packed_edge_counts<ALPHA, BITS> & node)
+          {
+            // friend keyword signals that this overrides an externally declared function
+            ost << " dBGr node: counts self = " << static_cast<uint32_t>(node.get(8)) << " in = [";
+            for (int i = 4; i < 8; ++i) ost << static_cast<uint32_t>(node.get(i)) << ",";
+            ost << "], out = [";
+            for (int i = 0; i < 4; ++i) ost << static_cast<uint32_t>(node.get(i)) << ",";
+            ost << "]";
+            return ost;
+          }
+
+
+          /// packed counters.  counter i is at bits [(i % per_word) * BITS, + BITS) of word i / per_word.
+          std::array<uint64_t, nWords> counts;
+
+        protected:
+          /// increment counter idx.  returns 1 if the counter is saturated and the increment is lost.
+          uint16_t inc(uint8_t idx) {
+            if (get(idx) == max_count) return 1;
+            counts[idx / per_word] += static_cast<uint64_t>(1) << ((idx % per_word) * BITS);
+            return 0;
+          }
+
+        public:
+        /*constructor*/
+        packed_edge_counts() { counts.fill(0); };
+
+        /*destructor.  not virtual, so that we don't have virtual lookup table pointer in the structure as well.*/
+        ~packed_edge_counts() {}
+
+        /// value of counter idx, 0 to 8.
+        CountType get(uint8_t idx) const {
+          return (counts[idx / per_word] >> ((idx % per_word) * BITS)) & max_count;
+        }
+
+        /**
+         * @brief update the current count from the input left and right chars (encoded in exts).  same input as edge_counts.
+         * @param exts            2 4bits in 1 uchar.  ordered as [out, in], lower bits being out.
+         * @return  bit mask of the counters that were saturated and did not count this update.  bit 8 is the kmer count.
+         */
+        uint16_t update(uint8_t exts)
+        {
+          uint16_t lost = inc(8) << 8;   // increment self count.
+
+          if (std::is_same<ALPHA, bliss::common::DNA>::value ||
+              std::is_same<ALPHA, bliss::common::DNA5>::value ||
+              std::is_same<ALPHA, bliss::common::RNA>::value ||
+              std::is_same<ALPHA, bliss::common::RNA5>::value) {
+            // value encodes only 1 possible character.  assume values are 0 1 2 3 for ACGT
+
+            if (std::is_same<ALPHA, bliss::common::DNA5>::value || std::is_same<ALPHA, bliss::common::RNA5>::value) {
+              if ((exts & 0x0C) == 0) lost |= inc(exts & 0x3) << (exts & 0x3);  // right edge (out).  increment if it's not marked as unknown.
+              if ((exts & 0xC0) == 0) lost |= inc(((exts >> 4) & 0x3) + 4) << (((exts >> 4) & 0x3) + 4);  // left edge (in).
+            } else {
+              lost |= inc(exts & 0x3) << (exts & 0x3);  // right edge (out)
+              lost |= inc(((exts >> 4) & 0x3) + 4) << (((exts >> 4) & 0x3) + 4);  // left edge (in)
+            }
+
+          } else {
+            // value encodes 0 or more possible characters.  bit position are ACGT from low to high
+
+            // if not DNA 16, convert to DNA16
+            if (!std::is_same<ALPHA, bliss::common::DNA16>::value) {
+              exts = (bliss::common::DNA16::FROM_ASCII[ALPHA::TO_ASCII[exts >> 4]] << 4) | bliss::common::DNA16::FROM_ASCII[ALPHA::TO_ASCII[exts & 0xF]];
+            }
+
+            for (int i = 0; i < 8; ++i) {
+              if ((exts >> i) & 1) lost |= inc(i) << i;
+            }
+          }
+          return lost;
+        }
+
+        /**
+         * @brief update the current count from the input left and right chars (not encoded in exts).
+         * @param exts              2 byte chars, in [out, in] lower byte being out.
+         * @return  bit mask of the counters that were saturated and did not count this update.
+         */
+        uint16_t update(uint16_t exts)
+        {
+          uint16_t lost = inc(8) << 8;   // increment self count.
+
+          uint8_t temp = (bliss::common::DNA16::FROM_ASCII[exts >> 8] << 4) | bliss::common::DNA16::FROM_ASCII[exts & 0xFF];
+
+          for (int i = 0; i < 8; ++i) {
+            if ((temp >> i) & 1) lost |= inc(i) << i;
+          }
+          return lost;
+        }
+
+        /// saturated count.  the exact count adds the container's overflow.
+        CountType get_edge_frequency(uint8_t idx) const {
+          if (idx >= 8) return 0;
+
+          return get(idx);
+        }
+
+        /// clear edge idx (0 to 7).  the container's overflow for the edge has to be cleared as well.
+        void remove_edge(uint8_t idx) {
+          if (idx < 8) counts[idx / per_word] &= ~(static_cast<uint64_t>(max_count) << ((idx % per_word) * BITS));
+        }
 
       };
 
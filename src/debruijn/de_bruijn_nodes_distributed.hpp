@@ -36,6 +36,7 @@
 #include <iterator>  // advance, distance
 
 #include <cstdint>  // for uint8, etc.
+#include <array>
 
 #include <type_traits>
 #include "debruijn/de_bruijn_node_trait.hpp"	//node trait data structure storing the linkage information to the node
@@ -82,6 +83,39 @@ namespace bliss{
 
 			protected:
 
+			  /// counts lost to saturation by node traits with small counters (e.g. packed_edge_counts), per stored key.  index as in get_edge_frequency, 8 is the kmer count.
+			  ::std::unordered_map<Key, ::std::array<size_t, 9>, hasher, key_equal> overflow;
+
+			  /// update a node trait that does not saturate.
+			  template <typename NodeIter, typename InputEdgeType>
+			  auto update_node(NodeIter node, InputEdgeType const & exts)
+			    -> typename ::std::enable_if<::std::is_void<decltype(node->second.update(exts))>::value>::type {
+			    node->second.update(exts);
+			  }
+
+			  /// update a node trait that reports saturated counters, and keep the lost increments in overflow.
+			  template <typename NodeIter, typename InputEdgeType>
+			  auto update_node(NodeIter node, InputEdgeType const & exts)
+			    -> typename ::std::enable_if<!::std::is_void<decltype(node->second.update(exts))>::value>::type {
+			    auto lost = node->second.update(exts);
+			    if (lost == 0) return;
+
+			    auto & extra = overflow[node->first];  // value initialized to 0 on first use.
+			    for (int i = 0; i < 9; ++i) {
+			      extra[i] += (lost >> i) & 1;
+			    }
+			  }
+
+			  virtual void local_reset() noexcept {
+			    Base::local_reset();
+			    decltype(overflow) tmp; tmp.swap(overflow);
+			  }
+
+			  virtual void local_clear() noexcept {
+			    Base::local_clear();
+			    overflow.clear();
+			  }
+
 
 			  /**
 			   * @brief insert new elements in the distributed unordered_multimap.
@@ -148,10 +182,10 @@ namespace bliss{
 
 					  // if different, swap and reverse complement the edges.  else, use as is.
 					  if (relative_strand == bliss::de_bruijn::node::ANTI_SENSE) {
-              node->second.update(bliss::de_bruijn::node::input_edge_utils::reverse_complement_edges<Alphabet>(it->second));
+              this->update_node(node, bliss::de_bruijn::node::input_edge_utils::reverse_complement_edges<Alphabet>(it->second));
 
 					  } else {
-              node->second.update(it->second);
+              this->update_node(node, it->second);
 					  }
 
 				  }
@@ -202,10 +236,10 @@ namespace bliss{
 
             // if different, swap and reverse complement the edges.  else, use as is.
             if (relative_strand == bliss::de_bruijn::node::ANTI_SENSE) {
-              node->second.update(bliss::de_bruijn::node::input_edge_utils::reverse_complement_edges<Alphabet>(it->second));
+              this->update_node(node, bliss::de_bruijn::node::input_edge_utils::reverse_complement_edges<Alphabet>(it->second));
 
             } else {
-              node->second.update(it->second);
+              this->update_node(node, it->second);
             }
 
 
@@ -220,6 +254,39 @@ namespace bliss{
 
 			  virtual ~de_bruijn_nodes_distributed() {/*do nothing*/};
 
+			  /// counts lost to saturation for local nodes, by stored key.  empty unless the node trait saturates.
+			  decltype(overflow) const & get_overflow() const {
+			    return overflow;
+			  }
+
+			  /**
+			   * @brief exact edge count of a local node:  the node trait's count plus any overflow.  idx as in get_edge_frequency.
+			   * @param node  a local entry, or a find result from this rank.
+			   */
+			  template <typename NodeType>
+			  size_t local_edge_frequency(NodeType const & node, uint8_t idx) const {
+			    size_t count = node.second.get_edge_frequency(idx);
+			    if (overflow.empty() || (idx >= 8)) return count;
+
+			    auto it = overflow.find(node.first);
+			    return (it == overflow.end()) ? count : count + it->second[idx];
+			  }
+
+			  /**
+			   * @brief clear edge idx of a local node, and its overflow.  local.
+			   * @param key  stored key.
+			   * @return  true if the node is on this rank and the edge was there.
+			   */
+			  bool local_remove_edge(Key const & key, uint8_t idx) {
+			    auto node = this->c.find(key);
+			    if ((node == this->c.end()) || (node->second.get_edge_frequency(idx) == 0)) return false;
+			    node->second.remove_edge(idx);
+
+			    auto it = overflow.find(node->first);
+			    if (it != overflow.end()) it->second[idx] = 0;
+			    return true;
+			  }
+
 			  /*transform function*/
 
 			  /**
@@ -262,6 +329,75 @@ namespace bliss{
 
 				 return count;
 			   }
+
+			   /**
+			    * @brief find the neighbors of a traversal frontier.  collective.
+			    * @details  the neighbors along the non-zero edges of all frontier nodes are generated into 1 vector, then find
+			    *           removes duplicates (either orientation), routes them with 1 distribute, and returns the ones in the graph.
+			    *           1 level of a breadth first traversal is then 1 call:  next = find_neighbors(find(...)).
+			    * @param frontier  nodes with stored keys and edges, e.g. the result of find or of a previous find_neighbors.
+			    * @return  the neighbors in the graph, with stored keys and edges.
+			    */
+			   ::std::vector<::std::pair<Key, T> > find_neighbors(::std::vector<::std::pair<Key, T> > const & frontier) const {
+				 BL_BENCH_INIT(neighbors);
+
+				 using Utils = ::bliss::de_bruijn::node::node_utils<Key, T>;
+
+				 BL_BENCH_START(neighbors);
+				 size_t count = 0;
+				 for (auto it = frontier.begin(); it != frontier.end(); ++it) {
+				   count += Utils::get_degree(it->second);
+				 }
+				 ::std::vector<Key> keys(count);
+				 auto out = keys.begin();
+				 for (auto it = frontier.begin(); it != frontier.end(); ++it) {
+				   out = Utils::get_neighbors(it->first, it->second, out);
+				 }
+				 BL_BENCH_END(neighbors, "generate", keys.size());
+
+				 BL_BENCH_COLLECTIVE_START(neighbors, "find", this->comm);
+				 auto results = this->find(keys);
+				 BL_BENCH_END(neighbors, "find", results.size());
+
+				 BL_BENCH_REPORT_MPI_NAMED(neighbors, "de_bruijn_nodes:find_neighbors", this->comm);
+
+				 return results;
+			   }
+
+			   /**
+			    * @brief find the neighbors of a traversal frontier given by k-mers only.  collective.
+			    * @details  without the edges, all 8 possible neighbors of each k-mer are candidates.  they are generated in place
+			    *           in frontier, and find keeps the ones in the graph.  prefer the overload with edges when they are at hand.
+			    * @param frontier  k-mers in any orientation.  overwritten with the candidate neighbors.
+			    * @return  the neighbors in the graph, with stored keys and edges.
+			    */
+			   ::std::vector<::std::pair<Key, T> > find_neighbors(::std::vector<Key> & frontier) const {
+				 BL_BENCH_INIT(neighbors);
+
+				 BL_BENCH_START(neighbors);
+				 size_t n = frontier.size();
+				 frontier.resize(n * 8);
+				 // back to front, so that k-mer i is read before its slot is overwritten by the neighbors of k-mers before it.
+				 for (size_t i = n; i > 0; --i) {
+				   Key kmer = frontier[i - 1];
+				   Key * out = frontier.data() + (i - 1) * 8;
+				   for (unsigned char c = 0; c < 4; ++c) {
+				     out[c] = kmer;
+				     out[c].nextFromChar(c);
+				     out[c + 4] = kmer;
+				     out[c + 4].nextReverseFromChar(c);
+				   }
+				 }
+				 BL_BENCH_END(neighbors, "generate", frontier.size());
+
+				 BL_BENCH_COLLECTIVE_START(neighbors, "find", this->comm);
+				 auto results = this->find(frontier);
+				 BL_BENCH_END(neighbors, "find", results.size());
+
+				 BL_BENCH_REPORT_MPI_NAMED(neighbors, "de_bruijn_nodes:find_neighbors", this->comm);
+
+				 return results;
+			   }
 		};
 	}/*de_bruijn*/
 }/*bliss*/
@@ -30,6 +30,7 @@
 //#include "utils/system_utils.hpp"
 
 #include "debruijn/de_bruijn_node_trait.hpp"
+#include "debruijn/de_bruijn_chain.hpp"
 
 namespace mxx {
 
@@ -91,6 +92,71 @@ namespace mxx {
         return baseType::get_type(); 
       }
 
+      static size_t num_basic_elements() {
+        return baseType::num_basic_elements();
+      }
+    };
+
+  template<typename A, unsigned int BITS>
+    struct datatype_builder<bliss::de_bruijn::node::packed_edge_counts<A, BITS> > :
+    public datatype_builder<decltype(bliss::de_bruijn::node::packed_edge_counts<A, BITS>::counts) > {
+
+      typedef datatype_builder<decltype(bliss::de_bruijn::node::packed_edge_counts<A, BITS>::counts) > baseType;
+
+      static MPI_Datatype get_type(){
+        return baseType::get_type();
+      }
+
+      static size_t num_basic_elements() {
+        return baseType::num_basic_elements();
+      }
+    };
+
+
+  template<typename A, unsigned int BITS>
+    struct datatype_builder<const bliss::de_bruijn::node::packed_edge_counts<A, BITS> > :
+    public datatype_builder<decltype(bliss::de_bruijn::node::packed_edge_counts<A, BITS>::counts) > {
+
+      typedef datatype_builder<decltype(bliss::de_bruijn::node::packed_edge_counts<A, BITS>::counts) > baseType;
+
+      static MPI_Datatype get_type(){
+        return baseType::get_type();
+      }
+
+      static size_t num_basic_elements() {
+        return baseType::num_basic_elements();
+      }
+    };
+
+
+
+  // chain state mixes k-mer words with counters and flags.  sent as bytes.
+  template<typename K>
+    struct datatype_builder<bliss::de_bruijn::chain::chain_node<K> > :
+    public datatype_contiguous<uint8_t, sizeof(bliss::de_bruijn::chain::chain_node<K>)> {
+
+      typedef datatype_contiguous<uint8_t, sizeof(bliss::de_bruijn::chain::chain_node<K>)> baseType;
+
+      static MPI_Datatype get_type(){
+        return baseType::get_type();
+      }
+
+      static size_t num_basic_elements() {
+        return baseType::num_basic_elements();
+      }
+    };
+
+
+  template<typename K>
+    struct datatype_builder<const bliss::de_bruijn::chain::chain_node<K> > :
+    public datatype_contiguous<uint8_t, sizeof(bliss::de_bruijn::chain::chain_node<K>)> {
+
+      typedef datatype_contiguous<uint8_t, sizeof(bliss::de_bruijn::chain::chain_node<K>)> baseType;
+
+      static MPI_Datatype get_type(){
+        return baseType::get_type();
+      }
+
       static size_t num_basic_elements() {
         return baseType::num_basic_elements();
       }
@@ -0,0 +1,238 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_de_bruijn_cleaning.cpp
+ *   Test that graph_cleaning removes a planted tip and bubble exactly, and the error k-mers of simulated reads
+ *   without removing genome k-mers, with later iterations examining only a small part of the graph.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "index/kmer_hash.hpp"
+#include "index/kmer_index.hpp"
+#include "debruijn/de_bruijn_node_trait.hpp"
+#include "debruijn/de_bruijn_nodes_distributed.hpp"
+#include "debruijn/de_bruijn_cleaning.hpp"
+
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+using EdgeType = bliss::de_bruijn::node::edge_counts<bliss::common::DNA16, uint32_t>;
+template <typename K>
+using MapParams = bliss::index::kmer::BimoleculeHashMapParams<K>;
+using NodeMapType = bliss::de_bruijn::de_bruijn_nodes_distributed<KmerType, EdgeType, MapParams>;
+using Cleaning = bliss::de_bruijn::graph_cleaning<NodeMapType>;
+
+class DeBruijnCleaningTest : public ::testing::Test
+{
+  protected:
+    ::mxx::comm comm;
+    NodeMapType nodes;
+    /// k-mers of the genome, smaller orientation.
+    std::set<KmerType> genome_kmers;
+
+    DeBruijnCleaningTest() : nodes(comm) {}
+
+    static std::string random_seq(size_t len, unsigned int seed) {
+      std::mt19937 gen(seed);
+      std::string s;
+      for (size_t i = 0; i < len; ++i) s.push_back("ACGT"[gen() & 3]);
+      return s;
+    }
+
+    static std::string revcomp(std::string const & s) {
+      std::string r(s.rbegin(), s.rend());
+      for (auto & c : r) c = (c == 'A') ? 'T' : (c == 'C') ? 'G' : (c == 'G') ? 'C' : 'A';
+      return r;
+    }
+
+    static KmerType canonical(KmerType const & km) {
+      KmerType rc = km.reverse_complement();
+      return (rc < km) ? rc : km;
+    }
+
+    /// k-mers of a read with their edges, stored as the smaller orientation.
+    static void add_read(std::string const & read, std::vector<std::pair<KmerType, uint8_t> > & input) {
+      for (size_t i = 0; i + KmerType::size <= read.size(); ++i) {
+        KmerType km(read.substr(i, KmerType::size));
+        int in = (i > 0) ? bliss::common::DNA::FROM_ASCII[read[i - 1]] : -1;
+        int out = (i + KmerType::size < read.size()) ? bliss::common::DNA::FROM_ASCII[read[i + KmerType::size]] : -1;
+
+        KmerType rc = km.reverse_complement();
+        if (rc < km) {
+          // stored as reverse complement:  edges swap sides and complement.
+          int t = in;
+          in = (out < 0) ? -1 : 3 - out;
+          out = (t < 0) ? -1 : 3 - t;
+          km = rc;
+        }
+        // DNA16 encoding is 1 bit per base.
+        uint8_t exts = ((in < 0) ? 0 : (1 << in)) << 4 | ((out < 0) ? 0 : (1 << out));
+        input.emplace_back(km, exts);
+      }
+    }
+
+    void set_genome(std::string const & g) {
+      for (size_t i = 0; i + KmerType::size <= g.size(); ++i) genome_kmers.insert(canonical(KmerType(g.substr(i, KmerType::size))));
+    }
+
+    /// global counts of the genome and other k-mers in the graph.
+    std::pair<size_t, size_t> census() {
+      auto & local = nodes.get_local_container();
+      size_t in_genome = 0, other = 0;
+      for (auto it = local.begin(); it != local.end(); ++it) {
+        if (genome_kmers.count(it->first) > 0) ++in_genome;
+        else ++other;
+      }
+      return std::make_pair(::mxx::allreduce(in_genome, comm), ::mxx::allreduce(other, comm));
+    }
+
+    /// global number of edges that lead to a node not in the graph.
+    size_t dangling() {
+      auto & local = nodes.get_local_container();
+      std::vector<KmerType> queries;
+      for (auto it = local.begin(); it != local.end(); ++it) {
+        for (uint8_t i = 0; i < 8; ++i) {
+          if (it->second.get_edge_frequency(i) == 0) continue;
+          KmerType n = it->first;
+          if (i < 4) n.nextFromChar(i);
+          else n.nextReverseFromChar(i - 4);
+          queries.emplace_back(n);
+        }
+      }
+      auto found = nodes.find(queries);
+      std::set<KmerType> present;
+      for (auto const & f : found) present.insert(f.first);
+      size_t missing = 0;
+      for (auto const & q : queries) missing += (present.count(canonical(q)) == 0);
+      return ::mxx::allreduce(missing, comm);
+    }
+};
+
+TEST_F(DeBruijnCleaningTest, planted)
+{
+  std::string g = random_seq(300, 3);
+  set_genome(g);
+
+  std::vector<std::pair<KmerType, uint8_t> > input;
+  for (int i = 0; i < 10; ++i) {
+    if (i % comm.size() == comm.rank()) add_read((i % 2) ? revcomp(g) : g, input);
+  }
+  if (comm.rank() == comm.size() - 1) {
+    // error at offset 95 of a 100 base read:  a tip of 5 nodes.
+    std::string tip = g.substr(50, 100);
+    tip[95] = (tip[95] == 'A') ? 'C' : 'A';
+    add_read(revcomp(tip), input);
+    // error in the middle:  a bubble of 21 nodes.
+    std::string bubble = g.substr(150, 100);
+    bubble[50] = (bubble[50] == 'G') ? 'T' : 'G';
+    add_read(bubble, input);
+  }
+  nodes.insert(input);
+
+  auto before = census();
+  EXPECT_EQ(g.size() - KmerType::size + 1, before.first);
+  EXPECT_EQ(26UL, before.second);
+
+  Cleaning cleaning(nodes);
+  auto st = cleaning.clean();
+
+  auto after = census();
+  EXPECT_EQ(before.first, after.first);
+  EXPECT_EQ(0UL, after.second);
+  EXPECT_EQ(26UL, ::mxx::allreduce(st.removed, comm));
+  EXPECT_EQ(1UL, ::mxx::allreduce(st.tips, comm));
+  EXPECT_EQ(1UL, ::mxx::allreduce(st.bubbles, comm));
+  EXPECT_EQ(0UL, dangling());
+
+  // a clean graph only takes the first pass over all nodes.
+  auto again = cleaning.clean();
+  EXPECT_EQ(1UL, again.iterations);
+  EXPECT_EQ(0UL, ::mxx::allreduce(again.removed, comm));
+}
+
+TEST_F(DeBruijnCleaningTest, reads)
+{
+  std::string g = random_seq(10000, 5);
+  set_genome(g);
+
+  // ~30x coverage in total, reads from both strands, ~0.3% substitutions.
+  std::vector<std::pair<KmerType, uint8_t> > input;
+  std::mt19937 gen(comm.rank() + 7);
+  std::uniform_int_distribution<size_t> start(0, g.size() - 100);
+  std::uniform_real_distribution<double> err(0.0, 1.0);
+  for (size_t r = 0; r < 3000 / comm.size(); ++r) {
+    std::string s = g.substr(start(gen), 100);
+    for (auto & c : s) {
+      if (err(gen) < 0.003) c = "ACGT"[(bliss::common::DNA::FROM_ASCII[c] + 1 + (gen() % 3)) % 4];
+    }
+    add_read((r % 2) ? revcomp(s) : s, input);
+  }
+  nodes.insert(input);
+
+  auto before = census();
+  ASSERT_GT(before.second, 1000UL);
+
+  Cleaning cleaning(nodes);
+  auto st = cleaning.clean();
+
+  auto after = census();
+  EXPECT_EQ(before.first, after.first) << "genome k-mers removed";
+  EXPECT_LT(after.second * 100, before.second) << "before " << before.second << " after " << after.second;
+  EXPECT_EQ(0UL, dangling());
+  EXPECT_GT(st.iterations, 1UL);
+
+  // later iterations only look at the neighborhood of the changes.
+  size_t first = ::mxx::allreduce(st.frontier[0], comm);
+  size_t rest = 0;
+  for (size_t i = 1; i < st.frontier.size(); ++i) rest += st.frontier[i];
+  rest = ::mxx::allreduce(rest, comm);
+  EXPECT_LT(rest * 10, first) << "first " << first << " rest " << rest;
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_de_bruijn_chain.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test unitig compaction of a de bruijn graph, with the distributed lookups replaced by a local map.
+ * @details
+ */
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "debruijn/de_bruijn_node_trait.hpp"
+
+// include files to test
+#include "debruijn/de_bruijn_chain.hpp"
+
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+using EdgeType = bliss::de_bruijn::node::edge_exists<bliss::common::DNA16>;
+using Utils = bliss::de_bruijn::chain::chain_utils<KmerType, EdgeType>;
+using ChainNode = bliss::de_bruijn::chain::chain_node<KmerType>;
+using Unitig = bliss::de_bruijn::chain::unitig_info<KmerType>;
+
+class DeBruijnChainTest : public ::testing::Test {
+  protected:
+    /// graph, keyed by the smaller of the k-mer and its reverse complement.
+    std::map<KmerType, EdgeType> graph;
+    std::map<KmerType, ChainNode> chains;
+    std::map<KmerType, Unitig> unitigs;
+    size_t rounds;
+
+    static std::string random_seq(size_t len, unsigned int seed) {
+      std::default_random_engine gen(seed);
+      std::uniform_int_distribution<int> dist(0, 3);
+      std::string s;
+      for (size_t i = 0; i < len; ++i) s.push_back("ACGT"[dist(gen)]);
+      return s;
+    }
+
+    static std::string revcomp(std::string const & s) {
+      std::string r(s.rbegin(), s.rend());
+      for (auto & c : r) c = (c == 'A') ? 'T' : (c == 'C') ? 'G' : (c == 'G') ? 'C' : 'A';
+      return r;
+    }
+
+    /// insert the k-mers of a read with their edges, the way de_bruijn_nodes_distributed::local_insert does.
+    void add_read(std::string const & read) {
+      for (size_t i = 0; i + KmerType::size <= read.size(); ++i) {
+        KmerType km(read.substr(i, KmerType::size));
+        int in = (i > 0) ? bliss::common::DNA::FROM_ASCII[read[i - 1]] : -1;
+        int out = (i + KmerType::size < read.size()) ? bliss::common::DNA::FROM_ASCII[read[i + KmerType::size]] : -1;
+
+        KmerType rc = km.reverse_complement();
+        if (rc < km) {
+          // stored as reverse complement:  edges swap sides and complement.
+          int t = in;
+          in = (out < 0) ? -1 : 3 - out;
+          out = (t < 0) ? -1 : 3 - t;
+          km = rc;
+        }
+        // DNA16 encoding is 1 bit per base.
+        uint8_t exts = ((in < 0) ? 0 : (1 << in)) << 4 | ((out < 0) ? 0 : (1 << out));
+        graph[km].update(exts);
+      }
+    }
+
+    /// link, jump and assign, with a synchronous copy of the chain state per round in place of the batched find.
+    void compact() {
+      KmerType next;
+      for (auto const & n : graph) {
+        ChainNode c;
+        for (uint8_t s = 0; s < 2; ++s) {
+          c.ends[s] = Utils::terminal(n.first, s);
+          if (! Utils::neighbor(n.first, n.second, s, next)) continue;
+
+          auto f = graph.find(next);
+          if (f == graph.end()) f = graph.find(next.reverse_complement());
+          if (f == graph.end()) continue;
+          c.ends[s] = Utils::link(n.first, s, next, f->first, f->second);
+        }
+        chains[n.first] = c;
+      }
+
+      rounds = 0;
+      uint64_t n = chains.size();
+      while (true) {
+        bool active = false;
+        std::map<KmerType, ChainNode> prev(chains);
+        for (auto & c : chains) {
+          for (uint8_t s = 0; s < 2; ++s) {
+            auto & e = c.second.ends[s];
+            if (! Utils::active(e, n)) continue;
+            active = true;
+            Utils::jump(e, prev.at(e.target).ends[e.side]);
+          }
+        }
+        if (!active) break;
+        ++rounds;
+      }
+
+      for (auto const & c : chains) {
+        unitigs[c.first] = Utils::assign(c.first, c.second);
+      }
+    }
+
+    /// check each unitig has ranks 0 .. length - 1, and consecutive oriented k-mers overlap by k - 1.  returns number of unitigs.
+    size_t check_unitigs() {
+      std::map<KmerType, std::map<uint64_t, KmerType> > groups;
+      for (auto const & u : unitigs) {
+        KmerType oriented = u.second.flip ? u.first.reverse_complement() : u.first;
+        EXPECT_TRUE(groups[u.second.id].emplace(u.second.rank, oriented).second);
+      }
+
+      for (auto const & g : groups) {
+        auto const & first = unitigs.at(g.first);
+        EXPECT_EQ(0UL, first.rank);
+        EXPECT_EQ(first.length, g.second.size());
+
+        uint64_t expected = 0;
+        KmerType prev;
+        for (auto const & r : g.second) {
+          EXPECT_EQ(expected, r.first);
+          EXPECT_EQ(first.length, unitigs.at(std::min(r.second, r.second.reverse_complement())).length);
+          if (expected > 0) {
+            KmerType shifted = prev;
+            shifted.nextFromChar(r.second.getCharsAtPos(0, 1));
+            EXPECT_EQ(shifted, r.second);
+          }
+          prev = r.second;
+          ++expected;
+        }
+      }
+      return groups.size();
+    }
+};
+
+
+TEST_F(DeBruijnChainTest, linear)
+{
+  std::string read = random_seq(60, 1);
+  add_read(read);
+  compact();
+
+  ASSERT_EQ(40UL, unitigs.size());
+  EXPECT_EQ(1UL, check_unitigs());
+  EXPECT_EQ(0, unitigs.begin()->second.circular);
+  EXPECT_EQ(40UL, unitigs.begin()->second.length);
+  EXPECT_LE(rounds, 7UL);
+}
+
+TEST_F(DeBruijnChainTest, branch)
+{
+  // 2 reads sharing a suffix, 1 on the reverse strand:  a Y with 3 unitigs.
+  std::string shared = random_seq(40, 2);
+  add_read(random_seq(30, 3) + shared);
+  add_read(revcomp(random_seq(30, 4) + shared));
+  compact();
+
+  EXPECT_EQ(3UL, check_unitigs());
+  for (auto const & u : unitigs) {
+    EXPECT_EQ(0, u.second.circular);
+  }
+}
+
+TEST_F(DeBruijnChainTest, cycle)
+{
+  // the k-mers of a circular sequence of length 50.
+  std::string circ = random_seq(50, 5);
+  add_read(circ + circ.substr(0, KmerType::size));
+  compact();
+
+  ASSERT_EQ(50UL, unitigs.size());
+  EXPECT_EQ(1UL, check_unitigs());
+
+  KmerType smallest = unitigs.begin()->first;
+  for (auto const & u : unitigs) {
+    EXPECT_EQ(1, u.second.circular);
+    EXPECT_EQ(50UL, u.second.length);
+    EXPECT_EQ(smallest, u.second.id);
+  }
+}
+
+TEST_F(DeBruijnChainTest, singletons)
+{
+  // a repeated k-mer with 2 different extensions on each side breaks every link.
+  std::string core = random_seq(21, 6);
+  add_read("A" + core + "C");
+  add_read("G" + core + "T");
+  compact();
+
+  EXPECT_EQ(5UL, check_unitigs());
+  for (auto const & u : unitigs) {
+    EXPECT_EQ(1UL, u.second.length);
+    EXPECT_EQ(0UL, u.second.rank);
+  }
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_de_bruijn_node_trait.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test neighbor generation from de bruijn node edges.
+ * @details
+ */
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+
+// include files to test
+#include "debruijn/de_bruijn_node_trait.hpp"
+
+
+using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+template <typename EdgeType>
+void check_neighbors(EdgeType const & edge, size_t degree) {
+  using Utils = bliss::de_bruijn::node::node_utils<KmerType, EdgeType>;
+
+  KmerType kmer(std::string("ACGTTGCAACGTTTGACCAGT"));
+
+  std::vector<KmerType> out, in;
+  Utils::get_out_neighbors(kmer, edge, out);
+  Utils::get_in_neighbors(kmer, edge, in);
+
+  EXPECT_EQ(degree, Utils::get_degree(edge));
+  EXPECT_EQ(degree, out.size() + in.size());
+
+  // batched version writes out then in, appending to the output.
+  std::vector<KmerType> all(1, kmer);
+  Utils::get_neighbors(kmer, edge, std::back_inserter(all));
+  ASSERT_EQ(degree + 1, all.size());
+  EXPECT_EQ(kmer, all[0]);
+  for (size_t i = 0; i < out.size(); ++i) EXPECT_EQ(out[i], all[i + 1]);
+  for (size_t i = 0; i < in.size(); ++i) EXPECT_EQ(in[i], all[i + 1 + out.size()]);
+}
+
+TEST(DeBruijnNodeTrait, neighbors_exists)
+{
+  bliss::de_bruijn::node::edge_exists<bliss::common::DNA16> edge;
+  check_neighbors(edge, 0);
+
+  // DNA16:  in = C|T, out = A|G|T
+  edge.update(static_cast<uint8_t>(0xA0 | 0x0D));
+  check_neighbors(edge, 5);
+}
+
+TEST(DeBruijnNodeTrait, neighbors_counts)
+{
+  bliss::de_bruijn::node::edge_counts<bliss::common::DNA16, int32_t> edge;
+  check_neighbors(edge, 0);
+
+  // DNA16:  in = G, out = C.  counted twice.
+  edge.update(static_cast<uint8_t>(0x42));
+  edge.update(static_cast<uint8_t>(0x42));
+  check_neighbors(edge, 2);
+
+  edge.update(static_cast<uint8_t>(0x18));
+  check_neighbors(edge, 4);
+}
+
+TEST(DeBruijnNodeTrait, neighbors_packed)
+{
+  bliss::de_bruijn::node::packed_edge_counts<bliss::common::DNA16, 4> edge;
+  check_neighbors(edge, 0);
+
+  edge.update(static_cast<uint8_t>(0xA0 | 0x0D));
+  check_neighbors(edge, 5);
+}
+
+
+/// packed counters match edge_counts until saturation, and report exactly the increments they lose.
+template <typename ALPHA, unsigned int BITS>
+void check_packed(unsigned int seed) {
+  using Packed = bliss::de_bruijn::node::packed_edge_counts<ALPHA, BITS>;
+  bliss::de_bruijn::node::edge_counts<ALPHA, uint32_t> full;
+  Packed packed;
+  std::vector<size_t> lost(9, 0);
+
+  srand(seed);
+  for (int i = 0; i < 300; ++i) {
+    // skew towards a few edges so that they saturate.
+    uint8_t exts = (rand() % 3 == 0) ? static_cast<uint8_t>(rand() & 0xFF) : static_cast<uint8_t>(0x21);
+    full.update(exts);
+    uint16_t mask = packed.update(exts);
+    for (int j = 0; j < 9; ++j) lost[j] += (mask >> j) & 1;
+  }
+
+  for (uint8_t j = 0; j < 8; ++j) {
+    uint32_t expected = std::min<uint32_t>(full.get_edge_frequency(j), Packed::max_count);
+    EXPECT_EQ(expected, packed.get_edge_frequency(j));
+    EXPECT_EQ(full.get_edge_frequency(j), packed.get_edge_frequency(j) + lost[j]);
+  }
+  EXPECT_EQ(full.counts[8], packed.get(8) + lost[8]);
+  EXPECT_EQ(0, packed.get_edge_frequency(8));
+}
+
+TEST(DeBruijnNodeTrait, packed_counts)
+{
+  EXPECT_EQ(8UL, sizeof(bliss::de_bruijn::node::packed_edge_counts<bliss::common::DNA16, 4>));
+  EXPECT_EQ(16UL, sizeof(bliss::de_bruijn::node::packed_edge_counts<bliss::common::DNA16, 8>));
+
+  for (unsigned int seed = 1; seed < 5; ++seed) {
+    check_packed<bliss::common::DNA16, 4>(seed);
+    check_packed<bliss::common::DNA16, 8>(seed);
+    check_packed<bliss::common::DNA, 4>(seed);
+    check_packed<bliss::common::DNA5, 8>(seed);
+  }
+}
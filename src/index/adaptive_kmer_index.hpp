@@ -0,0 +1,278 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    adaptive_kmer_index.hpp
+ * @ingroup bliss::index
+ * @author  tpan
+ * @brief   k-mer index front end that picks a sorted or a densehash backend at runtime.
+ * @details AdaptiveIndex is given the parsed tuples and the number of query keys the caller plans to issue.  it sketches
+ *          the number of distinct keys with HyperLogLog (merged across ranks), asks index_policy for the cheaper backend,
+ *          logs the decision on rank 0, then builds only that index.  queries go through kmer_index_query, which hides
+ *          the backend type.
+ *
+ *          both backends are compiled in.  they have to be the same kind of index (count or position), since that
+ *          decides whether one entry per key (map) or one per tuple (multimap) is stored.
+ */
+#ifndef ADAPTIVE_KMER_INDEX_HPP_
+#define ADAPTIVE_KMER_INDEX_HPP_
+
+#include <memory>       // unique_ptr
+#include <vector>
+#include <utility>      // pair
+#include <algorithm>    // max
+#include <type_traits>
+#include <stdexcept>
+
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
+
+#include "utils/logging.h"
+#include "utils/sketch_utils.hpp"
+#include "utils/transform_utils.hpp"
+#include "index/kmer_index.hpp"
+#include "index/index_policy.hpp"
+
+namespace bliss
+{
+namespace index
+{
+namespace kmer
+{
+
+  /// backend independent queries on a k-mer index.
+  template <typename Key, typename T>
+  class kmer_index_query {
+    public:
+      virtual ~kmer_index_query() {};
+
+      /// matching (key, value) entries.  query may be transformed and reordered.  collective.
+      virtual std::vector<std::pair<Key, T> > find(std::vector<Key> & query) const = 0;
+      /// number of entries for each query key.  collective.
+      virtual std::vector<std::pair<Key, size_t> > count(std::vector<Key> & query) const = 0;
+      /// global number of entries.  collective.
+      virtual size_t size() const = 0;
+      virtual size_t local_size() const = 0;
+      virtual index_plan::backend_type backend() const = 0;
+  };
+
+  /// kmer_index_query over an Index.
+  template <typename IndexType, index_plan::backend_type BACKEND>
+  class kmer_index_query_adapter : public kmer_index_query<typename IndexType::KmerType, typename IndexType::ValueType> {
+    protected:
+      using Key = typename IndexType::KmerType;
+      using T = typename IndexType::ValueType;
+
+      IndexType idx;
+
+    public:
+      kmer_index_query_adapter(mxx::comm const & comm) : idx(comm) {}
+      virtual ~kmer_index_query_adapter() {};
+
+      IndexType & get_index() { return idx; }
+      IndexType const & get_index() const { return idx; }
+
+      virtual std::vector<std::pair<Key, T> > find(std::vector<Key> & query) const {
+        auto found = idx.find(query);
+        return std::vector<std::pair<Key, T> >(found.begin(), found.end());
+      }
+      virtual std::vector<std::pair<Key, size_t> > count(std::vector<Key> & query) const {
+        auto counts = idx.count(query);
+        return std::vector<std::pair<Key, size_t> >(counts.begin(), counts.end());
+      }
+      virtual size_t size() const { return idx.size(); }
+      virtual size_t local_size() const { return idx.local_size(); }
+      virtual index_plan::backend_type backend() const { return BACKEND; }
+  };
+
+
+  namespace detail {
+    /// parsers whose tuples are all kept (multimap), rather than reduced to one entry per key.
+    template <typename Parser>
+    struct stores_all_tuples : public ::std::true_type {};
+    template <typename KmerType>
+    struct stores_all_tuples<KmerParser<KmerType> > : public ::std::false_type {};
+    template <typename TupleType>
+    struct stores_all_tuples<KmerCountTupleParser<TupleType> > : public ::std::false_type {};
+  }
+
+
+  /**
+   * @brief   k-mer index that chooses its backend when it is built.
+   * @tparam SortedIndex    Index on a sorted map, e.g. CountIndex<counting_sorted_map<...> >
+   * @tparam HashIndex      Index on a densehash map, with the same k-mer, value and parser types.
+   * @tparam KeyTransform   applied to keys before sketching, to match the maps' input transform.  lex_less for canonical.
+   */
+  template <typename SortedIndex, typename HashIndex,
+            template <typename> class KeyTransform = ::bliss::transform::identity>
+  class AdaptiveIndex {
+    public:
+      using KmerType = typename SortedIndex::KmerType;
+      using ValueType = typename SortedIndex::ValueType;
+      using KmerParserType = typename SortedIndex::KmerParserType;
+      using TupleType = typename KmerParserType::value_type;
+      using query_type = kmer_index_query<KmerType, ValueType>;
+
+      static_assert(::std::is_same<KmerType, typename HashIndex::KmerType>::value &&
+                    ::std::is_same<ValueType, typename HashIndex::ValueType>::value &&
+                    ::std::is_same<KmerParserType, typename HashIndex::KmerParserType>::value,
+                    "sorted and hash backends have to be the same kind of index");
+
+    protected:
+      mxx::comm const & comm;
+      index_policy policy;
+      index_plan plan;
+
+      /// query keys this rank plans to issue.
+      size_t planned_queries;
+
+      std::unique_ptr<query_type> index;
+
+      static KmerType const & key_of(KmerType const & x) { return x; }
+      template <typename V>
+      static KmerType const & key_of(std::pair<KmerType, V> const & x) { return x.first; }
+
+      /// global tuple count and distinct key estimate.  collective.
+      void measure(std::vector<TupleType> const & tuples, size_t & global_tuples, double & distinct) const {
+        ::bliss::utils::sketch::hyperloglog<> hll;
+        KeyTransform<KmerType> trans;
+        StoreHashFarm<KmerType> hash;
+        for (auto const & t : tuples) hll.update(hash(trans(key_of(t))));
+
+        global_tuples = tuples.size();
+        if (comm.size() > 1) {
+          hll.registers() = ::mxx::allreduce(hll.registers(), [](uint8_t const & x, uint8_t const & y) {
+            return ::std::max(x, y);
+          }, comm);
+          global_tuples = ::mxx::allreduce(global_tuples, comm);
+        }
+        distinct = hll.estimate();
+      }
+
+      template <typename IndexType, index_plan::backend_type BACKEND>
+      void build_backend(std::vector<TupleType> & tuples) {
+        auto adapter = new kmer_index_query_adapter<IndexType, BACKEND>(comm);
+        index.reset(adapter);
+        adapter->get_index().insert(tuples);
+      }
+
+    public:
+      AdaptiveIndex(mxx::comm const & _comm, index_policy const & _policy = index_policy()) :
+        comm(_comm), policy(_policy), planned_queries(0) {}
+
+      virtual ~AdaptiveIndex() {};
+
+      /// number of query keys this rank expects to issue.  set before build.
+      void plan_queries(size_t const & local_queries) {
+        planned_queries = local_queries;
+      }
+
+      /**
+       * @brief  measure the tuples, choose the backend, and insert the tuples into it.  collective.
+       * @details a second build replaces the index.
+       */
+      void build(std::vector<TupleType> & tuples) {
+        BL_BENCH_INIT(build);
+
+        BL_BENCH_START(build);
+        size_t global_tuples;
+        double distinct;
+        measure(tuples, global_tuples, distinct);
+        size_t queries = (comm.size() > 1) ? ::mxx::allreduce(planned_queries, comm) : planned_queries;
+
+        plan = policy.choose(global_tuples, distinct, queries, comm.size(),
+                             detail::stores_all_tuples<KmerParserType>::value, sizeof(::std::pair<KmerType, ValueType>));
+        if (comm.rank() == 0) {
+          BL_INFOF("AdaptiveIndex chose %s", plan.to_string().c_str());
+        }
+        BL_BENCH_END(build, "plan", global_tuples);
+
+        BL_BENCH_START(build);
+        if (plan.backend == index_plan::SORTED) {
+          build_backend<SortedIndex, index_plan::SORTED>(tuples);
+        } else {
+          build_backend<HashIndex, index_plan::DENSEHASH>(tuples);
+        }
+        BL_BENCH_END(build, index_plan::backend_name(plan.backend), index->local_size());
+
+        BL_BENCH_REPORT_MPI_NAMED(build, "index:adaptive_build", comm);
+      }
+
+      /// build from reads packed by KmerFileHelper::read_file_to_store.  collective.
+      void build(::bliss::io::PackedReadStore<typename KmerType::KmerAlphabet> const & store) {
+        std::vector<TupleType> tuples;
+        store.template generate<KmerParserType>(tuples);
+        this->build(tuples);
+      }
+
+      /// the decision, with the measurements it was based on.
+      index_plan const & get_plan() const {
+        return plan;
+      }
+
+      /// the built index.  throws if build has not been called.
+      query_type const & get_index() const {
+        if (!index) throw ::std::logic_error("AdaptiveIndex: build has to be called before queries.");
+        return *index;
+      }
+
+      std::vector<std::pair<KmerType, ValueType> > find(std::vector<KmerType> & query) const {
+        return get_index().find(query);
+      }
+
+      std::vector<std::pair<KmerType, size_t> > count(std::vector<KmerType> & query) const {
+        return get_index().count(query);
+      }
+
+      size_t size() const {
+        return index ? index->size() : 0;
+      }
+
+      size_t local_size() const {
+        return index ? index->local_size() : 0;
+      }
+  };
+
+
+  namespace detail {
+    template <typename Key>
+    using CanonicalSortedParams = CanonicalSortedMapParams<Key>;
+    template <typename Key>
+    using CanonicalHashParams = CanonicalHashMapParams<Key>;
+  }
+
+  /// canonical k-mer counts, on counting_sorted_map or counting_densehash_map.
+  template <typename KmerType, typename CountType = uint32_t>
+  using AdaptiveCanonicalCountIndex = AdaptiveIndex<
+      CountIndex< ::dsc::counting_sorted_map<KmerType, CountType, detail::CanonicalSortedParams> >,
+      CountIndex< ::dsc::counting_densehash_map<KmerType, CountType, detail::CanonicalHashParams,
+                                                ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> > >,
+      ::bliss::kmer::transform::lex_less>;
+
+  /// canonical k-mer positions, on sorted_multimap or densehash_multimap.
+  template <typename KmerType, typename IdType = ::bliss::common::ShortSequenceKmerId>
+  using AdaptiveCanonicalPositionIndex = AdaptiveIndex<
+      PositionIndex< ::dsc::sorted_multimap<KmerType, IdType, detail::CanonicalSortedParams> >,
+      PositionIndex< ::dsc::densehash_multimap<KmerType, IdType, detail::CanonicalHashParams,
+                                               ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> > >,
+      ::bliss::kmer::transform::lex_less>;
+
+
+} // namespace kmer
+} // namespace index
+} // namespace bliss
+
+#endif /* ADAPTIVE_KMER_INDEX_HPP_ */
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    index_policy.hpp
+ * @ingroup bliss::index
+ * @author  tpan
+ * @brief   choose between a sorted and a hashed k-mer index from the input multiplicity and the planned queries.
+ * @details test/benchmark/hash_vs_sort.cpp and the SORTED vs DENSEHASH testKmerIndex targets show sort winning for small
+ *          per rank sizes and few queries, and hashing winning when the log(N) search dominates:  std::sort of uint64_t
+ *          breaks even with hashing at just under 8M entries, i.e. a hash insert or probe costs about log2(8M) = 23
+ *          comparisons.  index_policy models the per rank work of each backend in comparisons,
+ *
+ *            sorted:  n log2(n) to sort the tuples, plus q log2(d) to binary search the queries
+ *            hashed:  (n + q) * hash_cost
+ *
+ *          with n tuples, d distinct keys and q query keys per rank, and picks the cheaper one.  a memory budget, if
+ *          given, overrides the model when only the sorted layout fits.  the densehash tables are sized for
+ *          max_load_factor, and store one entry per distinct key for a map, one per tuple for a multimap.
+ *
+ *          index_plan records the measurements and the reason, for the log.
+ */
+#ifndef INDEX_POLICY_HPP_
+#define INDEX_POLICY_HPP_
+
+#include <cmath>      // log2
+#include <algorithm>  // max
+#include <string>
+#include <sstream>
+
+namespace bliss
+{
+namespace index
+{
+namespace kmer
+{
+
+  /// the measurements behind an index backend choice, and the choice.
+  struct index_plan {
+      enum backend_type { SORTED = 0, DENSEHASH = 1 };
+
+      backend_type backend;
+      /// global number of tuples to insert
+      size_t tuples;
+      /// estimated global number of distinct keys
+      double distinct;
+      /// planned global number of query keys
+      size_t queries;
+      int ranks;
+      bool multimap;
+
+      /// modeled per rank work, in comparisons.
+      double sorted_cost;
+      double hashed_cost;
+      /// modeled per rank bytes.
+      double sorted_bytes;
+      double hashed_bytes;
+
+      std::string reason;
+
+      index_plan() : backend(SORTED), tuples(0), distinct(0.0), queries(0), ranks(1), multimap(false),
+          sorted_cost(0.0), hashed_cost(0.0), sorted_bytes(0.0), hashed_bytes(0.0) {}
+
+      /// average number of tuples per distinct key.
+      double multiplicity() const {
+        return (distinct > 0.0) ? static_cast<double>(tuples) / distinct : 0.0;
+      }
+
+      static char const * backend_name(backend_type const & b) {
+        return (b == SORTED) ? "sorted" : "densehash";
+      }
+
+      std::string to_string() const {
+        std::stringstream ss;
+        ss << backend_name(backend) << (multimap ? " multimap" : " map") << ": " << reason
+           << ". tuples " << tuples << " distinct ~" << static_cast<size_t>(distinct)
+           << " multiplicity " << multiplicity() << " queries " << queries << " ranks " << ranks
+           << " cost sorted " << sorted_cost << " hashed " << hashed_cost
+           << " bytes sorted " << static_cast<size_t>(sorted_bytes) << " hashed " << static_cast<size_t>(hashed_bytes);
+        return ss.str();
+      }
+  };
+
+
+  /// cost model for the sorted vs hashed backend choice.  see file description.
+  struct index_policy {
+      /// cost of a hash insert or probe, in comparisons.  log2 of the sort/hash break even size.
+      double hash_cost;
+      /// max load factor of the hash tables.
+      double max_load_factor;
+      /// bytes available per rank for the index.  0 for no limit.
+      size_t memory_budget;
+
+      index_policy(double const & _hash_cost = 23.0, double const & _max_load = 0.5, size_t const & _budget = 0) :
+        hash_cost(_hash_cost), max_load_factor(_max_load), memory_budget(_budget) {}
+
+      /**
+       * @brief  choose a backend.
+       * @param tuples       global number of tuples to insert.
+       * @param distinct     estimated global number of distinct keys.
+       * @param queries      planned global number of query keys.
+       * @param ranks        number of ranks.
+       * @param multimap     if all tuples are stored (e.g. positions), rather than one entry per key.
+       * @param entry_bytes  bytes of a (key, value) entry.
+       */
+      index_plan choose(size_t const & tuples, double const & distinct, size_t const & queries, int const & ranks,
+                        bool const & multimap, size_t const & entry_bytes) const {
+        index_plan plan;
+        plan.tuples = tuples;
+        plan.distinct = ::std::min(::std::max(distinct, 0.0), static_cast<double>(tuples));
+        plan.queries = queries;
+        plan.ranks = ::std::max(ranks, 1);
+        plan.multimap = multimap;
+
+        double p = static_cast<double>(plan.ranks);
+        double n = static_cast<double>(tuples) / p;
+        double d = plan.distinct / p;
+        double q = static_cast<double>(queries) / p;
+
+        plan.sorted_cost = n * ::std::log2(::std::max(n, 2.0)) + q * ::std::log2(::std::max(d, 2.0));
+        plan.hashed_cost = (n + q) * hash_cost;
+
+        // sorting needs all tuples at once.  a sorted map is reduced to the distinct keys afterwards.
+        plan.sorted_bytes = n * static_cast<double>(entry_bytes);
+        plan.hashed_bytes = (multimap ? n : d) * static_cast<double>(entry_bytes) / max_load_factor;
+
+        std::stringstream reason;
+        if ((memory_budget > 0) && (plan.hashed_bytes > static_cast<double>(memory_budget)) &&
+            (plan.sorted_bytes <= static_cast<double>(memory_budget))) {
+          plan.backend = index_plan::SORTED;
+          reason << "only the sorted layout fits in the memory budget of " << memory_budget << " bytes";
+        } else if (plan.hashed_cost < plan.sorted_cost) {
+          plan.backend = index_plan::DENSEHASH;
+          reason << ((q * ::std::log2(::std::max(d, 2.0)) > n * ::std::log2(::std::max(n, 2.0))) ?
+              "query heavy, hash probes are cheaper than binary search" : "large per rank input, hashing is cheaper than sorting");
+        } else {
+          plan.backend = index_plan::SORTED;
+          reason << "small per rank input or few queries, sorting is cheaper than hashing";
+        }
+        plan.reason = reason.str();
+
+        return plan;
+      }
+  };
+
+
+} // namespace kmer
+} // namespace index
+} // namespace bliss
+
+#endif /* INDEX_POLICY_HPP_ */
@@ -0,0 +1,446 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    index_server.hpp
+ * @ingroup index
+ * @author  tpan
+ * @brief   resident k-mer index that answers find and count requests from local client processes.
+ * @details the MPI job builds or loads the index once, then each rank serves the clients on its node through a unix
+ *          domain stream socket named <name>.<rank> in the abstract namespace (see io/unix_domain_socket.h).
+ *          a request is a small header on the socket plus the keys in a memfd, passed with send_fd.  the answers
+ *          come back the same way, so only the headers are copied through the socket.
+ *
+ *          the server runs in rounds:  each rank collects the requests that arrived, then all ranks make 1 collective
+ *          find and 1 collective count for the union of their clients' keys, and each rank splits the answers back to
+ *          its clients.  concurrent small requests thus become a few large collective calls.  a rank with no request
+ *          still takes part in each round, so the round time bounds the latency.
+ *
+ *          response memory layout:  uint64_t counts[n], the number of answers for each query key in query order,
+ *          then the answers, grouped by query key.  answer keys are transformed as from Index::find, e.g. canonical.
+ */
+#ifndef SRC_INDEX_INDEX_SERVER_HPP_
+#define SRC_INDEX_INDEX_SERVER_HPP_
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <sys/mman.h>   // memfd_create, mmap
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
+
+#include "index/query_coalescer.hpp"
+#include "io/io_exception.hpp"
+#include "io/unix_domain_socket.h"
+#include "utils/benchmark_utils.hpp"
+#include "utils/exception_handling.hpp"
+
+namespace bliss
+{
+  namespace index
+  {
+
+    namespace server
+    {
+      static constexpr uint32_t request_magic = 0x424c5351;   // BLSQ
+      static constexpr uint32_t response_magic = 0x424c5341;  // BLSA
+
+      enum operation : uint32_t { FIND = 0, COUNT = 1, STOP = 2 };
+
+      /// followed by the keys' memfd if count > 0.
+      struct request_header {
+          uint32_t magic;
+          uint32_t op;
+          uint64_t count;
+      };
+
+      /// followed by the answers' memfd if status == 0 and bytes > 0.
+      struct response_header {
+          uint32_t magic;
+          int32_t status;
+          uint64_t bytes;
+      };
+
+      /// abstract socket name of a rank's server.  the first char is replaced by make_address.
+      inline ::std::string socket_name(::std::string const & name, int rank) {
+        ::std::stringstream ss;
+        ss << "#" << name << "." << rank;
+        return ss.str();
+      }
+
+      inline void throw_io(::std::string const & what) {
+        ::std::stringstream ss;
+        ss << "ERROR: index server: " << what << ": " << strerror(errno);
+        throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+      }
+
+      /// exactly len bytes.  false on error or closed socket.
+      inline bool send_all(int fd, void const * data, size_t len) {
+        char const * p = reinterpret_cast<char const *>(data);
+        while (len > 0) {
+          ssize_t n = ::send(fd, p, len, MSG_NOSIGNAL);
+          if (n < 0 && errno == EINTR) continue;
+          if (n <= 0) return false;
+          p += n;
+          len -= n;
+        }
+        return true;
+      }
+      inline bool recv_all(int fd, void * data, size_t len) {
+        char * p = reinterpret_cast<char *>(data);
+        while (len > 0) {
+          ssize_t n = ::recv(fd, p, len, 0);
+          if (n < 0 && errno == EINTR) continue;
+          if (n <= 0) return false;
+          p += n;
+          len -= n;
+        }
+        return true;
+      }
+
+      /// memfd holding a copy of [data, data + bytes).  -1 on error.
+      inline int make_memfd(char const * name, void const * data, size_t bytes) {
+        int fd = memfd_create(name, MFD_CLOEXEC);
+        if (fd < 0) return -1;
+        if ((ftruncate(fd, bytes) != 0) ||
+            ((bytes > 0) && (::pwrite(fd, data, bytes, 0) != static_cast<ssize_t>(bytes)))) {
+          close(fd);
+          return -1;
+        }
+        return fd;
+      }
+
+      /// map bytes of a received memfd read only.  nullptr on error, or if the memfd is shorter.  the fd is closed.
+      inline void const * map_memfd(int fd, size_t bytes) {
+        struct stat st;
+        void * p = ((fstat(fd, &st) == 0) && (static_cast<size_t>(st.st_size) >= bytes)) ?
+            mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        close(fd);
+        return (p == MAP_FAILED) ? nullptr : p;
+      }
+
+    } // namespace server
+
+
+    /**
+     * @brief  serves find and count requests on an Index, e.g. CountIndex or PositionIndex.  see file description.
+     */
+    template <typename Index>
+    class index_server {
+      public:
+        using KmerType = typename Index::KmerType;
+        using find_result_type = typename ::std::decay<decltype(::std::declval<Index const &>().find(
+            ::std::declval<::std::vector<KmerType> &>()))>::type::value_type;
+        using count_result_type = typename ::std::decay<decltype(::std::declval<Index const &>().count(
+            ::std::declval<::std::vector<KmerType> &>()))>::type::value_type;
+
+      protected:
+        Index const & index;
+        const mxx::comm& comm;
+
+        struct sockaddr_un address;
+        int listen_fd;
+        ::std::vector<int> clients;
+
+        /// requests of 1 round.
+        struct request {
+            int client;
+            uint32_t op;
+            ::std::vector<KmerType> keys;
+        };
+
+        void close_client(size_t i) {
+          close(clients[i]);
+          clients.erase(clients.begin() + i);
+        }
+
+        /// read 1 request from client i.  false if the client is gone or sent an invalid request, then it is closed.
+        bool read_request(size_t i, request & req) {
+          ::bliss::index::server::request_header h;
+          bool ok = ::bliss::index::server::recv_all(clients[i], &h, sizeof(h)) &&
+              (h.magic == ::bliss::index::server::request_magic) && (h.op <= ::bliss::index::server::STOP);
+          if (ok && (h.count > 0)) {
+            int fd = ::bliss::io::util::recv_fd(clients[i]);
+            void const * p = (fd < 0) ? nullptr : ::bliss::index::server::map_memfd(fd, h.count * sizeof(KmerType));
+            if (p == nullptr) {
+              ok = false;
+            } else {
+              KmerType const * keys = reinterpret_cast<KmerType const *>(p);
+              req.keys.assign(keys, keys + h.count);
+              munmap(const_cast<void *>(p), h.count * sizeof(KmerType));
+            }
+          }
+          if (!ok) {
+            close_client(i);
+            return false;
+          }
+          req.client = clients[i];
+          req.op = h.op;
+          return true;
+        }
+
+        /// requests from all clients with data.  waits up to wait_ms for the first.
+        void collect(int wait_ms, ::std::vector<request> & reqs) {
+          ::std::vector<struct pollfd> fds(clients.size() + 1);
+          fds[0].fd = listen_fd;
+          fds[0].events = POLLIN;
+          for (size_t i = 0; i < clients.size(); ++i) {
+            fds[i + 1].fd = clients[i];
+            fds[i + 1].events = POLLIN;
+          }
+          if (poll(fds.data(), fds.size(), wait_ms) <= 0) return;
+
+          // existing clients first:  accepting changes the client list.  backwards, as read_request may remove.
+          for (size_t i = fds.size() - 1; i > 0; --i) {
+            if ((fds[i].revents & (POLLIN | POLLHUP | POLLERR)) == 0) continue;
+            request req;
+            if (read_request(i - 1, req)) reqs.emplace_back(::std::move(req));
+          }
+          if (fds[0].revents & POLLIN) {
+            int fd = accept(listen_fd, nullptr, nullptr);
+            if (fd >= 0) clients.emplace_back(fd);
+          }
+        }
+
+        /// answer each request of 1 op from 1 collective query on the union of their transformed keys.
+        template <typename Result, typename Query>
+        void answer(::std::vector<request> const & reqs, uint32_t op, Query const & query) {
+          ::std::vector<::std::vector<KmerType> const *> batches;
+          ::std::vector<int> targets;
+          for (auto const & req : reqs) {
+            if (req.op != op) continue;
+            batches.emplace_back(&(req.keys));
+            targets.emplace_back(req.client);
+          }
+          ::std::vector<::std::vector<size_t> > counts;
+          ::std::vector<::std::vector<Result> > answers;
+          ::bliss::index::coalesced_query<Result>(index.get_map(), batches, query, counts, answers);  // COLLECTIVE CALL...
+
+          ::std::vector<char> response;
+          for (size_t b = 0; b < batches.size(); ++b) {
+            size_t n = counts[b].size();
+            response.resize(n * sizeof(uint64_t) + answers[b].size() * sizeof(Result));
+            for (size_t i = 0; i < n; ++i) {
+              uint64_t c = counts[b][i];
+              memcpy(response.data() + i * sizeof(uint64_t), &c, sizeof(uint64_t));
+            }
+            if (answers[b].size() > 0)
+              memcpy(response.data() + n * sizeof(uint64_t), answers[b].data(), answers[b].size() * sizeof(Result));
+            this->respond(targets[b], response);
+          }
+        }
+
+        /// send a response.  a client that is gone is dropped at its next poll.
+        void respond(int client, ::std::vector<char> const & response) {
+          ::bliss::index::server::response_header h;
+          h.magic = ::bliss::index::server::response_magic;
+          h.bytes = response.size();
+          int fd = -1;
+          if (h.bytes > 0) fd = ::bliss::index::server::make_memfd("bliss_index_response", response.data(), response.size());
+          h.status = ((h.bytes > 0) && (fd < 0)) ? -1 : 0;
+          if (h.status != 0) h.bytes = 0;
+          if (::bliss::index::server::send_all(client, &h, sizeof(h)) && (fd >= 0))
+            ::bliss::io::util::send_fd(client, fd);
+          if (fd >= 0) close(fd);
+        }
+
+      public:
+        /**
+         * @brief  start listening on <name>.<rank>.  collective.  throws on all ranks if any cannot listen.
+         */
+        index_server(Index const & _index, ::std::string const & name, const mxx::comm& _comm) :
+          index(_index), comm(_comm), listen_fd(-1) {
+          socklen_t len;
+          address = ::bliss::io::util::make_address(::bliss::index::server::socket_name(name, comm.rank()), len);
+          listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+          bool ok = (listen_fd >= 0) &&
+              (bind(listen_fd, reinterpret_cast<struct sockaddr const *>(&address), len) == 0) &&
+              (listen(listen_fd, 64) == 0);
+          if (!ok && (listen_fd >= 0)) {
+            close(listen_fd);
+            listen_fd = -1;
+          }
+          if (!::mxx::all_of(ok, comm)) {
+            if (listen_fd >= 0) close(listen_fd);
+            throw ::bliss::utils::make_exception<::bliss::io::IOException>(
+                ok ? "ERROR: index server: unable to listen on another rank." : "ERROR: index server: unable to listen on " + name);
+          }
+        }
+
+        virtual ~index_server() {
+          for (int c : clients) close(c);
+          if (listen_fd >= 0) close(listen_fd);
+        }
+
+        index_server(index_server const & other) = delete;
+        index_server & operator=(index_server const & other) = delete;
+
+        /// number of connected clients on this rank.
+        size_t local_clients() const { return clients.size(); }
+
+        /**
+         * @brief  1 round:  collect requests for up to wait_ms, then answer them.  collective.
+         * @return  true if any rank received a stop request.
+         */
+        bool serve_once(int wait_ms) {
+          BL_BENCH_INIT(serve);
+
+          BL_BENCH_START(serve);
+          ::std::vector<request> reqs;
+          this->collect(wait_ms, reqs);
+          bool has_find = false, has_count = false, stop = false;
+          for (auto const & r : reqs) {
+            has_find |= (r.op == ::bliss::index::server::FIND);
+            has_count |= (r.op == ::bliss::index::server::COUNT);
+            stop |= (r.op == ::bliss::index::server::STOP);
+          }
+          BL_BENCH_END(serve, "collect", reqs.size());
+
+          BL_BENCH_COLLECTIVE_START(serve, "find", comm);
+          if (::mxx::any_of(has_find, comm))
+            this->template answer<find_result_type>(reqs, ::bliss::index::server::FIND, [this](::std::vector<KmerType> & q) {
+              return index.find(q);
+            });
+          BL_BENCH_END(serve, "find", reqs.size());
+
+          BL_BENCH_COLLECTIVE_START(serve, "count", comm);
+          if (::mxx::any_of(has_count, comm))
+            this->template answer<count_result_type>(reqs, ::bliss::index::server::COUNT, [this](::std::vector<KmerType> & q) {
+              return index.count(q);
+            });
+          BL_BENCH_END(serve, "count", reqs.size());
+
+          // acknowledge stops last.
+          for (auto const & r : reqs)
+            if (r.op == ::bliss::index::server::STOP) this->respond(r.client, ::std::vector<char>());
+
+          BL_BENCH_REPORT_MPI_NAMED(serve, "index_server:round", comm);
+          return ::mxx::any_of(stop, comm);
+        }
+
+        /// serve rounds of up to wait_ms until a client on any rank sends stop.  collective.
+        void serve(int wait_ms = 10) {
+          while (!this->serve_once(wait_ms)) {}
+        }
+    };
+
+
+    /**
+     * @brief  connection of a local process to 1 rank of an index_server.  no MPI.
+     * @details  requests are synchronous.  answers are as from Index::find and Index::count:  counts[i] answers
+     *           for keys[i], concatenated in answers.
+     */
+    template <typename Index>
+    class index_client {
+      public:
+        using KmerType = typename Index::KmerType;
+        using find_result_type = typename index_server<Index>::find_result_type;
+        using count_result_type = typename index_server<Index>::count_result_type;
+
+      protected:
+        int fd;
+
+        void send_request(uint32_t op, ::std::vector<KmerType> const & keys) {
+          ::bliss::index::server::request_header h;
+          h.magic = ::bliss::index::server::request_magic;
+          h.op = op;
+          h.count = keys.size();
+          if (!::bliss::index::server::send_all(fd, &h, sizeof(h))) ::bliss::index::server::throw_io("unable to send request");
+          if (h.count == 0) return;
+
+          int kfd = ::bliss::index::server::make_memfd("bliss_index_request", keys.data(), keys.size() * sizeof(KmerType));
+          if (kfd < 0) ::bliss::index::server::throw_io("unable to create request memory");
+          int ret = ::bliss::io::util::send_fd(fd, kfd);
+          close(kfd);
+          if (ret < 0) ::bliss::index::server::throw_io("unable to send request memory");
+        }
+
+        template <typename Result>
+        void receive(size_t n, ::std::vector<size_t> & counts, ::std::vector<Result> & answers) {
+          ::bliss::index::server::response_header h;
+          if (!::bliss::index::server::recv_all(fd, &h, sizeof(h)) || (h.magic != ::bliss::index::server::response_magic) ||
+              (h.status != 0))
+            ::bliss::index::server::throw_io("invalid response");
+
+          counts.assign(n, 0);
+          answers.clear();
+          if (h.bytes == 0) return;
+
+          int rfd = ::bliss::io::util::recv_fd(fd);
+          void const * p = (rfd < 0) ? nullptr : ::bliss::index::server::map_memfd(rfd, h.bytes);
+          if (p == nullptr) ::bliss::index::server::throw_io("unable to map response");
+          char const * b = reinterpret_cast<char const *>(p);
+          memcpy(counts.data(), b, n * sizeof(uint64_t));  // size_t is uint64_t on supported platforms
+          Result const * first = reinterpret_cast<Result const *>(b + n * sizeof(uint64_t));
+          answers.assign(first, first + (h.bytes - n * sizeof(uint64_t)) / sizeof(Result));
+          munmap(const_cast<void *>(p), h.bytes);
+        }
+
+      public:
+        /// connect to the server of rank on this node, started with the same name.
+        index_client(::std::string const & name, int rank = 0) {
+          socklen_t len;
+          struct sockaddr_un address = ::bliss::io::util::make_address(::bliss::index::server::socket_name(name, rank), len);
+          fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+          if (fd < 0) ::bliss::index::server::throw_io("unable to create socket");
+          if (connect(fd, reinterpret_cast<struct sockaddr const *>(&address), len) != 0) {
+            close(fd);
+            ::bliss::index::server::throw_io("unable to connect to " + name);
+          }
+        }
+
+        ~index_client() {
+          close(fd);
+        }
+
+        index_client(index_client const & other) = delete;
+        index_client & operator=(index_client const & other) = delete;
+
+        void find(::std::vector<KmerType> const & keys, ::std::vector<size_t> & counts, ::std::vector<find_result_type> & answers) {
+          this->send_request(::bliss::index::server::FIND, keys);
+          this->receive(keys.size(), counts, answers);
+        }
+
+        void count(::std::vector<KmerType> const & keys, ::std::vector<size_t> & counts, ::std::vector<count_result_type> & answers) {
+          this->send_request(::bliss::index::server::COUNT, keys);
+          this->receive(keys.size(), counts, answers);
+        }
+
+        /// stop the server after its current round.  returns when acknowledged.
+        void stop() {
+          this->send_request(::bliss::index::server::STOP, ::std::vector<KmerType>());
+          ::std::vector<size_t> counts;
+          ::std::vector<find_result_type> answers;
+          this->receive(0, counts, answers);
+        }
+    };
+
+  } // namespace index
+} // namespace bliss
+
+#endif // SRC_INDEX_INDEX_SERVER_HPP_
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    kmer_dispatch.hpp
+ * @ingroup bliss::index
+ * @author  tpan
+ * @brief   select k at runtime from a list of precompiled k-mer sizes.
+ * @details Kmer<K, ...> fixes K, and with it the storage word count, at compile time, so that the
+ *          shift, compare and hash loops run on a fixed number of words.  an index is therefore
+ *          a different type for each k.  to sweep k without a rebuild, a program instantiates
+ *          its index code for a list of k values (KmerSizes<...>), and dispatch_k maps the runtime
+ *          k to the matching instantiation:
+ *
+ *            template <typename KmerType>
+ *            struct BuildIndex {
+ *              static int run(std::string const & file, mxx::comm const & comm) { ... }
+ *            };
+ *
+ *            dispatch_k<BuildIndex, DNA, WordType>(k, KmerSizes<15, 21, 31, 63>(), file, comm);
+ *
+ *          each k in the list costs one instantiation of the job, so the list should hold the k values
+ *          actually swept.  kmer_storage_bits reports the storage width (64, 128, 192, 256 ... bits)
+ *          that a given k runs on.
+ */
+#ifndef KMER_DISPATCH_HPP_
+#define KMER_DISPATCH_HPP_
+
+#include <stdexcept>    // invalid_argument
+#include <string>
+#include <vector>
+#include <utility>      // forward
+#include <type_traits>
+
+#include "common/kmer.hpp"
+
+namespace bliss
+{
+namespace index
+{
+namespace kmer
+{
+
+  /// compile time list of k values to instantiate for runtime selection of k.
+  template <unsigned int... Ks>
+  struct KmerSizes {
+      /// the k values in the list, for reporting.
+      static ::std::vector<unsigned int> values() {
+        return ::std::vector<unsigned int>{Ks...};
+      }
+
+      /// check if a runtime k has been instantiated.
+      static bool contains(unsigned int k) {
+        for (unsigned int x : values()) {
+          if (x == k) return true;
+        }
+        return false;
+      }
+  };
+
+  /// k values covered by the k-mer index benchmarks:  15, 21, 31 fit in 64 bits, 63 in 128 bits, and 95 in 192 bits for DNA.
+  using DefaultKmerSizes = KmerSizes<15, 21, 31, 63, 95>;
+
+  /// number of storage bits for a k-mer of size K.  the inner loops run on this fixed width.
+  template <unsigned int K, typename Alphabet, typename WordType>
+  struct kmer_storage_bits : public ::std::integral_constant<unsigned int,
+    ::bliss::common::Kmer<K, Alphabet, WordType>::nWords * sizeof(WordType) * 8> {};
+
+
+  namespace detail {
+
+    /// end of the list: k was not instantiated.
+    template <template <typename> class Job, typename Alphabet, typename WordType, typename R, typename... Args>
+    R dispatch_k(unsigned int k, KmerSizes<> const &, ::std::string const & supported, Args&&...) {
+      throw ::std::invalid_argument("k=" + ::std::to_string(k) + " was not compiled in.  supported k: " + supported);
+    }
+
+    template <template <typename> class Job, typename Alphabet, typename WordType, typename R,
+      unsigned int K, unsigned int... Ks, typename... Args>
+    R dispatch_k(unsigned int k, KmerSizes<K, Ks...> const &, ::std::string const & supported, Args&&... args) {
+      if (k == K) return Job< ::bliss::common::Kmer<K, Alphabet, WordType> >::run(::std::forward<Args>(args)...);
+      return dispatch_k<Job, Alphabet, WordType, R>(k, KmerSizes<Ks...>(), supported, ::std::forward<Args>(args)...);
+    }
+
+  }  // namespace detail
+
+
+  /**
+   * @brief   call Job<Kmer<k, Alphabet, WordType> >::run(args...) for a runtime k.
+   * @details k is matched against the precompiled sizes in KmerSizes.  all Job instantiations
+   *          must return the same type.
+   * @throw   std::invalid_argument if k is not in the list.
+   */
+  template <template <typename> class Job, typename Alphabet, typename WordType,
+    unsigned int K, unsigned int... Ks, typename... Args>
+  auto dispatch_k(unsigned int k, KmerSizes<K, Ks...> const & sizes, Args&&... args)
+    -> decltype(Job< ::bliss::common::Kmer<K, Alphabet, WordType> >::run(::std::forward<Args>(args)...)) {
+    using R = decltype(Job< ::bliss::common::Kmer<K, Alphabet, WordType> >::run(::std::forward<Args>(args)...));
+
+    ::std::string supported;
+    if (! KmerSizes<K, Ks...>::contains(k)) {
+      for (unsigned int x : KmerSizes<K, Ks...>::values()) {
+        supported.append(::std::to_string(x)).append(" ");
+      }
+    }
+    return detail::dispatch_k<Job, Alphabet, WordType, R>(k, sizes, supported, ::std::forward<Args>(args)...);
+  }
+
+
+} // namespace kmer
+} // namespace index
+} // namespace bliss
+
+
+
+#endif /* KMER_DISPATCH_HPP_ */
@@ -65,6 +65,13 @@
 #include "common/kmer.hpp"
 
 #include "utils/transform_utils.hpp"
+#include "utils/cpu_features.hpp"
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#elif defined(__SSE4_2__)
+#include <nmmintrin.h>  // _mm_crc32_u64
+#endif
 
 // includ the murmurhash code.
 #ifndef _MURMURHASH3_H_
@@ -148,6 +155,59 @@ namespace bliss {
     namespace hash
     {
 
+      namespace detail {
+
+        /// 64 bit finalizer from MurmurHash3.  a bijection with full avalanche.
+        inline uint64_t fmix64(uint64_t k) {
+          k ^= k >> 33;
+          k *= 0xff51afd7ed558ccdULL;
+          k ^= k >> 33;
+          k *= 0xc4ceb9fe1a85ec53ULL;
+          k ^= k >> 33;
+          return k;
+        }
+
+#if (defined(__AVX512F__) && defined(__AVX512DQ__)) || defined(BLISS_SIMD_DISPATCH_X86)
+#define BLISS_MIX_HASH_AVX512
+#endif
+#if defined(__AVX2__) || defined(BLISS_SIMD_DISPATCH_X86)
+#define BLISS_MIX_HASH_AVX2
+#endif
+
+#if defined(BLISS_MIX_HASH_AVX512)
+        /// fmix64 on each 64 bit lane.
+        BLISS_TARGET("avx512f,avx512dq")
+        inline __m512i fmix64(__m512i k) {
+          k = _mm512_xor_si512(k, _mm512_srli_epi64(k, 33));
+          k = _mm512_mullo_epi64(k, _mm512_set1_epi64(static_cast<long long>(0xff51afd7ed558ccdULL)));
+          k = _mm512_xor_si512(k, _mm512_srli_epi64(k, 33));
+          k = _mm512_mullo_epi64(k, _mm512_set1_epi64(static_cast<long long>(0xc4ceb9fe1a85ec53ULL)));
+          return _mm512_xor_si512(k, _mm512_srli_epi64(k, 33));
+        }
+#endif
+
+#if defined(BLISS_MIX_HASH_AVX2)
+        /// per lane 64 bit multiply, low half.  AVX2 only has 32x32->64 (mul_epu32), so combine 3 partial products.
+        BLISS_TARGET("avx2")
+        inline __m256i mullo_epi64(__m256i const & a, __m256i const & b) {
+          __m256i lo = _mm256_mul_epu32(a, b);
+          __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+                                           _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+          return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+        }
+
+        /// fmix64 on each 64 bit lane.
+        BLISS_TARGET("avx2")
+        inline __m256i fmix64(__m256i k) {
+          k = _mm256_xor_si256(k, _mm256_srli_epi64(k, 33));
+          k = mullo_epi64(k, _mm256_set1_epi64x(static_cast<long long>(0xff51afd7ed558ccdULL)));
+          k = _mm256_xor_si256(k, _mm256_srli_epi64(k, 33));
+          k = mullo_epi64(k, _mm256_set1_epi64x(static_cast<long long>(0xc4ceb9fe1a85ec53ULL)));
+          return _mm256_xor_si256(k, _mm256_srli_epi64(k, 33));
+        }
+#endif
+
+      } // namespace detail
 
       /**
        * @brief  Kmer hash, returns the least significant NumBits directly as identity hash.
@@ -198,6 +258,12 @@ namespace bliss {
               return h;  // suffix.  just return the whole thing.
           }
 
+
+          /// batch hash.  out[i] = operator()(in[i]).
+          inline void hash(KMER const * in, size_t n, uint64_t * out) const {
+            for (size_t i = 0; i < n; ++i) out[i] = this->operator()(in[i]);
+          }
+
       };
       template<typename KMER, bool Prefix>
       constexpr uint8_t cpp_std<KMER, Prefix>::batch_size;
@@ -229,6 +295,12 @@ namespace bliss {
               // get the whole thing
               return kmer.getSuffix(suffix_bits);
           }
+
+          /// batch hash.  out[i] = operator()(in[i]).
+          inline void hash(KMER const * in, size_t n, uint64_t * out) const {
+            for (size_t i = 0; i < n; ++i) out[i] = this->operator()(in[i]);
+          }
+
       };
       template<typename KMER, bool Prefix>
       constexpr uint8_t identity<KMER, Prefix>::batch_size;
@@ -273,6 +345,12 @@ namespace bliss {
               return h[0];
           }
 
+
+          /// batch hash.  out[i] = operator()(in[i]).
+          inline void hash(KMER const * in, size_t n, uint64_t * out) const {
+            for (size_t i = 0; i < n; ++i) out[i] = this->operator()(in[i]);
+          }
+
       };
       template<typename KMER, bool Prefix>
       constexpr uint8_t murmur<KMER, Prefix>::batch_size;
@@ -308,10 +386,466 @@ namespace bliss {
               return ::util::Hash64WithSeed(reinterpret_cast<const char*>(kmer.getData()), nBytes, seed);
           }
 
+
+          /// batch hash.  out[i] = operator()(in[i]).
+          inline void hash(KMER const * in, size_t n, uint64_t * out) const {
+            for (size_t i = 0; i < n; ++i) out[i] = this->operator()(in[i]);
+          }
+
       };
       template<typename KMER, bool Prefix>
       constexpr uint8_t farm<KMER, Prefix>::batch_size;
 
+      /**
+       * @brief  Kmer hash for fixed width keys.  chains the murmur3 64 bit finalizer over the 64 bit words of the k-mer.
+       * @details  h = seed;  h = fmix64(h ^ word) for each word.  for a single word k-mer this is a bijection of the k-mer,
+       *           so distinct k-mers never collide in 64 bits.  much cheaper than running the general byte hashes
+       *           (murmur, farm) on 8 or 16 byte keys, and it vectorizes:  the batch hash() processes 4 (AVX2) or 8 (AVX-512)
+       *           k-mers per iteration when the k-mers are 1 or 2 unpadded 64 bit words.  results are the same as operator().
+       *           as with farm, the prefix version uses a different seed so that distribution and storage hashes differ.
+       */
+      template <typename KMER, bool Prefix = false>
+      class mix {
+
+        protected:
+          static constexpr size_t bytes = KMER::nWords * sizeof(typename KMER::KmerWordType);
+          static constexpr size_t words = bytes / sizeof(uint64_t);
+          static constexpr size_t leftover = bytes % sizeof(uint64_t);
+
+          /// an array of these k-mers is an array of 1 or 2 uint64_t per k-mer, so lanes can be loaded directly.
+          static constexpr bool lanes_ok = (sizeof(KMER) == bytes) && (leftover == 0) && ((words == 1) || (words == 2));
+
+          uint64_t seed;
+
+          inline void hash_lanes(KMER const * in, size_t n, uint64_t * out, ::std::false_type) const {
+            for (size_t i = 0; i < n; ++i) out[i] = this->operator()(in[i]);
+          }
+
+#if defined(BLISS_MIX_HASH_AVX512)
+          /// AVX-512 part of the batch hash.  returns the number of k-mers done, a multiple of 8.
+          BLISS_TARGET("avx512f,avx512dq")
+          inline size_t hash_lanes_avx512(KMER const * in, size_t n, uint64_t * out) const {
+            size_t i = 0;
+            long long const * data = reinterpret_cast<long long const *>(in);
+            __m512i s = _mm512_set1_epi64(static_cast<long long>(seed));
+            if (words == 1) {
+              for (; (i + 8) <= n; i += 8) {
+                __m512i v = _mm512_loadu_si512(reinterpret_cast<void const *>(data + i));
+                _mm512_storeu_si512(reinterpret_cast<void *>(out + i), detail::fmix64(_mm512_xor_si512(v, s)));
+              }
+            } else {
+              // 2 words per k-mer.  gather the first and second words of 8 k-mers from 2 registers.
+              __m512i even = _mm512_setr_epi64(0, 2, 4, 6, 8, 10, 12, 14);
+              __m512i odd = _mm512_setr_epi64(1, 3, 5, 7, 9, 11, 13, 15);
+              for (; (i + 8) <= n; i += 8) {
+                __m512i a = _mm512_loadu_si512(reinterpret_cast<void const *>(data + 2 * i));
+                __m512i b = _mm512_loadu_si512(reinterpret_cast<void const *>(data + 2 * i + 8));
+                __m512i h = detail::fmix64(_mm512_xor_si512(_mm512_permutex2var_epi64(a, even, b), s));
+                h = detail::fmix64(_mm512_xor_si512(h, _mm512_permutex2var_epi64(a, odd, b)));
+                _mm512_storeu_si512(reinterpret_cast<void *>(out + i), h);
+              }
+            }
+            return i;
+          }
+#endif
+
+#if defined(BLISS_MIX_HASH_AVX2)
+          /// AVX2 part of the batch hash.  returns the number of k-mers done, a multiple of 4.
+          BLISS_TARGET("avx2")
+          inline size_t hash_lanes_avx2(KMER const * in, size_t n, uint64_t * out) const {
+            size_t i = 0;
+            long long const * data = reinterpret_cast<long long const *>(in);
+            __m256i s = _mm256_set1_epi64x(static_cast<long long>(seed));
+            if (words == 1) {
+              for (; (i + 4) <= n; i += 4) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(data + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), detail::fmix64(_mm256_xor_si256(v, s)));
+              }
+            } else {
+              // 2 words per k-mer.  unpack gives lanes in k-mer order 0, 2, 1, 3 so permute back.
+              for (; (i + 4) <= n; i += 4) {
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(data + 2 * i));
+                __m256i b = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(data + 2 * i + 4));
+                __m256i w0 = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xD8);
+                __m256i w1 = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b), 0xD8);
+                __m256i h = detail::fmix64(_mm256_xor_si256(w0, s));
+                h = detail::fmix64(_mm256_xor_si256(h, w1));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), h);
+              }
+            }
+            return i;
+          }
+#endif
+
+          /// widest available path first (checked at runtime with BLISS_SIMD_DISPATCH), then the scalar remainder.
+          inline void hash_lanes(KMER const * in, size_t n, uint64_t * out, ::std::true_type) const {
+            size_t i = 0;
+#if defined(BLISS_MIX_HASH_AVX512)
+            if (::bliss::utils::cpu::has_avx512dq()) i = hash_lanes_avx512(in, n, out);
+            else
+#endif
+#if defined(BLISS_MIX_HASH_AVX2)
+            if (::bliss::utils::cpu::has_avx2()) i = hash_lanes_avx2(in, n, out);
+#endif
+            for (; i < n; ++i) out[i] = this->operator()(in[i]);
+          }
+
+        public:
+          /// preferred batch size.  with runtime dispatch, the widest the binary supports.
+#if defined(BLISS_MIX_HASH_AVX512)
+          static constexpr uint8_t batch_size = lanes_ok ? 8 : 1;
+#elif defined(BLISS_MIX_HASH_AVX2)
+          static constexpr uint8_t batch_size = lanes_ok ? 4 : 1;
+#else
+          static constexpr uint8_t batch_size = 1;
+#endif
+
+          static const unsigned int default_init_value = 24U;  // ignored, hash is 64 bit.
+
+          mix(const unsigned int prefix_bits = default_init_value, uint32_t const & _seed = 42 ) :
+            seed(Prefix ? detail::fmix64((static_cast<uint64_t>(_seed) << 1) - 1) : detail::fmix64(_seed)) {};
+
+          /// operator to compute hash.  64 bit.
+          inline uint64_t operator()(const KMER & kmer) const {
+            uint64_t h = seed;
+            uint64_t w;
+            unsigned char const * data = reinterpret_cast<unsigned char const *>(kmer.getData());
+            for (size_t i = 0; i < words; ++i) {
+              memcpy(&w, data + i * sizeof(uint64_t), sizeof(uint64_t));
+              h = detail::fmix64(h ^ w);
+            }
+            if (leftover > 0) {
+              w = 0;
+              memcpy(&w, data + words * sizeof(uint64_t), leftover);
+              h = detail::fmix64(h ^ w);
+            }
+            return h;
+          }
+
+          /// batch hash.  out[i] = operator()(in[i]), vectorized where possible.
+          inline void hash(KMER const * in, size_t n, uint64_t * out) const {
+            hash_lanes(in, n, out, ::std::integral_constant<bool, lanes_ok>());
+          }
+
+      };
+      template<typename KMER, bool Prefix>
+      constexpr uint8_t mix<KMER, Prefix>::batch_size;
+
+      /**
+       * @brief  Kmer hash for distribution, multiply-shift.  only a good bucket spread, not full avalanche.
+       * @details  h = seed;  h = fold((h ^ word) * C) for each 64 bit word of the k-mer, with C odd and a 128 bit product.
+       *           the high 64 bits are the multiply-shift hash and depend on every input bit, but the caller takes
+       *           hash % p, which for power of 2 p only sees the low bits.  the low bits of a product depend only on the
+       *           low bits of the input, so fold xors the two halves.  one multiply per word.
+       */
+      template <typename KMER, bool Prefix = false>
+      class multiply_shift {
+
+        protected:
+          static constexpr size_t bytes = KMER::nWords * sizeof(typename KMER::KmerWordType);
+          static constexpr size_t words = bytes / sizeof(uint64_t);
+          static constexpr size_t leftover = bytes % sizeof(uint64_t);
+
+          static constexpr uint64_t multiplier = 0x9E3779B97F4A7C15ULL;   // 2^64 / golden ratio, odd.
+
+          uint64_t seed;
+
+          /// low half xor high half of x * multiplier.
+          static inline uint64_t fold(uint64_t x) {
+#if defined(__SIZEOF_INT128__)
+            unsigned __int128 r = static_cast<unsigned __int128>(x) * multiplier;
+            return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+#else
+            // no 128 bit product.  the top byte of the 64 bit product depends on all input bits, so xor it into the bottom.
+            x *= multiplier;
+            return x ^ (x >> 32) ^ (x >> 56);
+#endif
+          }
+
+        public:
+          static constexpr uint8_t batch_size = 1;
+
+          static const unsigned int default_init_value = 24U;  // ignored, hash is 64 bit.
+
+          multiply_shift(const unsigned int prefix_bits = default_init_value, uint32_t const & _seed = 42 ) :
+            seed(Prefix ? detail::fmix64((static_cast<uint64_t>(_seed) << 1) - 1) : detail::fmix64(_seed)) {};
+
+          /// operator to compute hash.  64 bit.
+          inline uint64_t operator()(const KMER & kmer) const {
+            uint64_t h = seed;
+            uint64_t w;
+            unsigned char const * data = reinterpret_cast<unsigned char const *>(kmer.getData());
+            for (size_t i = 0; i < words; ++i) {
+              memcpy(&w, data + i * sizeof(uint64_t), sizeof(uint64_t));
+              h = fold(h ^ w);
+            }
+            if (leftover > 0) {
+              w = 0;
+              memcpy(&w, data + words * sizeof(uint64_t), leftover);
+              h = fold(h ^ w);
+            }
+            return h;
+          }
+
+          /// batch hash.  out[i] = operator()(in[i]).  the multiplies of consecutive k-mers are independent and pipeline.
+          inline void hash(KMER const * in, size_t n, uint64_t * out) const {
+            for (size_t i = 0; i < n; ++i) out[i] = this->operator()(in[i]);
+          }
+
+      };
+      template<typename KMER, bool Prefix>
+      constexpr uint8_t multiply_shift<KMER, Prefix>::batch_size;
+      template<typename KMER, bool Prefix>
+      constexpr uint64_t multiply_shift<KMER, Prefix>::multiplier;
+
+#if defined(__SSE4_2__)
+      /**
+       * @brief  Kmer hash for distribution, hardware CRC32C (SSE4.2).  only a good bucket spread, not full avalanche.
+       * @details  crc = _mm_crc32_u64(crc, word) for each 64 bit word of the k-mer, starting from the seed.  1 instruction
+       *           per word.  the 32 bit crc is spread to 64 bits by multiplying with an odd constant, a bijection, so
+       *           distinct crcs stay distinct.  CRC is linear, so this is not suitable as a storage hash.
+       *           only available when compiled with SSE4.2, e.g. -march=native on x86.  see DistHashHW in kmer_index.hpp
+       *           for the build time choice between this and multiply_shift.
+       */
+      template <typename KMER, bool Prefix = false>
+      class crc32c {
+
+        protected:
+          static constexpr size_t bytes = KMER::nWords * sizeof(typename KMER::KmerWordType);
+          static constexpr size_t words = bytes / sizeof(uint64_t);
+          static constexpr size_t leftover = bytes % sizeof(uint64_t);
+
+          static constexpr uint64_t multiplier = 0x9E3779B97F4A7C15ULL;
+
+          uint32_t seed;
+
+        public:
+          static constexpr uint8_t batch_size = 1;
+
+          static const unsigned int default_init_value = 24U;  // ignored.
+
+          crc32c(const unsigned int prefix_bits = default_init_value, uint32_t const & _seed = 42 ) :
+            seed(static_cast<uint32_t>(Prefix ? detail::fmix64((static_cast<uint64_t>(_seed) << 1) - 1) : detail::fmix64(_seed))) {};
+
+          /// operator to compute hash.  64 bit.
+          inline uint64_t operator()(const KMER & kmer) const {
+            uint64_t crc = seed;
+            uint64_t w;
+            unsigned char const * data = reinterpret_cast<unsigned char const *>(kmer.getData());
+            for (size_t i = 0; i < words; ++i) {
+              memcpy(&w, data + i * sizeof(uint64_t), sizeof(uint64_t));
+              crc = _mm_crc32_u64(crc, w);
+            }
+            if (leftover > 0) {
+              w = 0;
+              memcpy(&w, data + words * sizeof(uint64_t), leftover);
+              crc = _mm_crc32_u64(crc, w);
+            }
+            return crc * multiplier;
+          }
+
+          /// batch hash.  out[i] = operator()(in[i]).  crc32 has 3 cycle latency but 1 cycle throughput, so consecutive k-mers overlap.
+          inline void hash(KMER const * in, size_t n, uint64_t * out) const {
+            for (size_t i = 0; i < n; ++i) out[i] = this->operator()(in[i]);
+          }
+
+      };
+      template<typename KMER, bool Prefix>
+      constexpr uint8_t crc32c<KMER, Prefix>::batch_size;
+      template<typename KMER, bool Prefix>
+      constexpr uint64_t crc32c<KMER, Prefix>::multiplier;
+#endif
+
+      /**
+       * @brief  minimizer based Kmer hash, for distribution.  hash of the canonical minimizer of the k-mer.
+       * @details  the minimizer is the canonical m-mer (min of m-mer and its reverse complement) with the smallest
+       *           (seeded 64 bit mix) hash among the k-m+1 m-mers in the k-mer.  ordering by hash instead of
+       *           lexicographically avoids pile up on low complexity m-mers such as poly-A.
+       *
+       *           consecutive k-mers of a read mostly share their minimizer (a super-k-mer), so using this as
+       *           the distribution hash sends them to the same rank.  since m-mers are canonical, a k-mer and its
+       *           reverse complement have the same minimizer, so this is usable with lex_less or xor DistTrans as well.
+       *
+       *           NOT for storage hash - many distinct k-mers share a value.
+       * @tparam M  minimizer length in characters.  M * bitsPerChar must fit in 64 bits, and M <= k.
+       */
+      template <typename KMER, bool Prefix = false,
+    		  unsigned int M = ((KMER::size < 15) ? KMER::size : 15)>
+      class minimizer {
+
+        protected:
+          static_assert(M > 0, "ERROR: minimizer length must be positive");
+          static_assert(M <= KMER::size, "ERROR: minimizer length must not exceed k");
+          static_assert((M * KMER::bitsPerChar) <= 64, "ERROR: minimizer must fit in 64 bits");
+
+          static constexpr unsigned int bitsPerChar = KMER::bitsPerChar;
+          static constexpr uint64_t char_mask = ~(~(0x0ULL) << bitsPerChar);
+          static constexpr uint64_t mmer_mask = ((M * bitsPerChar) == 64) ? ~(0x0ULL) : ~(~(0x0ULL) << (M * bitsPerChar));
+          static constexpr unsigned int rc_shift = (M - 1) * bitsPerChar;
+
+          uint64_t order_seed;
+          uint64_t hash_seed;
+
+          /// 64 bit finalizer from MurmurHash3
+          static inline uint64_t fmix64(uint64_t k) {
+            k ^= k >> 33;
+            k *= 0xff51afd7ed558ccdULL;
+            k ^= k >> 33;
+            k *= 0xc4ceb9fe1a85ec53ULL;
+            k ^= k >> 33;
+            return k;
+          }
+
+          /// get character at position pos.  pos 0 is LSB (most recently added)
+          template <typename KM = KMER,
+        		  typename ::std::enable_if<(KM::nWords * sizeof(typename KM::KmerWordType) <= sizeof(uint64_t)), int>::type = 0>
+          static inline uint64_t get_char(KM const & kmer, unsigned int pos) {
+            uint64_t v = 0;
+            memcpy(&v, kmer.getData(), KM::nWords * sizeof(typename KM::KmerWordType));
+            return (v >> (pos * bitsPerChar)) & char_mask;
+          }
+          template <typename KM = KMER,
+        		  typename ::std::enable_if<(KM::nWords * sizeof(typename KM::KmerWordType) > sizeof(uint64_t)), int>::type = 0>
+          static inline uint64_t get_char(KM const & kmer, unsigned int pos) {
+            return static_cast<uint64_t>(kmer.getCharsAtPos(pos, 1)) & char_mask;
+          }
+
+        public:
+          static constexpr uint8_t batch_size = 1;
+
+          static const unsigned int default_init_value = 24U;  // ignored, hash is 64 bit.
+
+          minimizer(const unsigned int prefix_bits = default_init_value, uint32_t const & _seed = 42 ) :
+        	  order_seed(fmix64(_seed)), hash_seed(Prefix ? fmix64((static_cast<uint64_t>(_seed) << 1) - 1) : fmix64(_seed + 1)) {};
+
+          /// compute the canonical minimizer of the k-mer.  returned as packed m-mer, first char at MSB.
+          inline uint64_t get_minimizer(const KMER & kmer) const {
+            uint64_t fwd = 0, rc = 0, c;
+            uint64_t canon, h;
+            uint64_t min_h = ~(0x0ULL);
+            uint64_t min_mmer = 0;
+
+            // walk from the first character (MSB) to the last, rolling both strands of the m-mer.
+            for (int pos = KMER::size - 1; pos >= 0; --pos) {
+              c = get_char(kmer, pos);
+              fwd = ((fwd << bitsPerChar) | c) & mmer_mask;
+              rc = (rc >> bitsPerChar) | (static_cast<uint64_t>(KMER::KmerAlphabet::to_complement(c)) << rc_shift);
+
+              if (pos > static_cast<int>(KMER::size - M)) continue;   // not a full m-mer yet.
+
+              canon = (fwd < rc) ? fwd : rc;
+              h = fmix64(canon ^ order_seed);
+              if (h < min_h) {
+                min_h = h;
+                min_mmer = canon;
+              }
+            }
+            return min_mmer;
+          }
+
+          /// operator to compute hash.  64 bit.
+          inline uint64_t operator()(const KMER & kmer) const {
+            return fmix64(get_minimizer(kmer) ^ hash_seed);
+          }
+
+      };
+      template<typename KMER, bool Prefix, unsigned int M>
+      constexpr uint8_t minimizer<KMER, Prefix, M>::batch_size;
+
+      /**
+       * @brief  ntHash style rolling hash.  O(1) per character when rolled along a read by RollingHashKmerSlidingWindow.
+       * @details  each character code c has a random 64 bit seed T[c].  the forward hash of a k-mer is the xor of T[c]
+       *           rotated left by the character's distance from the last (least significant) character, so sliding
+       *           by 1 character is  fwd' = rol(fwd, 1) ^ rol(T[out], k) ^ T[in].  the reverse hash is the same over
+       *           the reverse complement and rolls the other way.  the canonical value uses fwd + rev, which is the same
+       *           for a k-mer and its reverse complement, so it agrees with a lex_less DistTrans or StoreTrans.
+       *
+       *           the value is fmix64 of the raw hash, so the low bits used for hash % p are well mixed.  operator()
+       *           computes the same value from scratch in O(k), so this is also a normal DistHash/StoreHash, and a
+       *           precomputed rolling value can stand in for hashing the k-mer.  as with farm, Prefix uses a different seed.
+       * @tparam Canonical  combine both strands.  otherwise the forward strand only.
+       */
+      template <typename KMER, bool Prefix = false, bool Canonical = true>
+      class nthash {
+
+        protected:
+          static constexpr unsigned int bitsPerChar = KMER::bitsPerChar;
+          static constexpr unsigned int table_size = 1U << bitsPerChar;
+          static constexpr unsigned int k_rot = KMER::size % 64;
+          static constexpr unsigned int k1_rot = (KMER::size - 1) % 64;
+
+          /// seed per character, and per complemented character for the reverse strand.
+          uint64_t fwd_table[table_size];
+          uint64_t rev_table[table_size];
+
+          static inline uint64_t rol(uint64_t x, unsigned int r) {
+            return (r == 0) ? x : ((x << r) | (x >> (64 - r)));
+          }
+          static inline uint64_t ror(uint64_t x, unsigned int r) {
+            return (r == 0) ? x : ((x >> r) | (x << (64 - r)));
+          }
+
+        public:
+          static constexpr uint8_t batch_size = 1;
+
+          static const unsigned int default_init_value = 24U;  // ignored, hash is 64 bit.
+
+          /// rolling state:  forward and reverse strand hashes.
+          struct state {
+              uint64_t fwd;
+              uint64_t rev;
+          };
+
+          nthash(const unsigned int prefix_bits = default_init_value, uint32_t const & _seed = 42 ) {
+            uint64_t s = Prefix ? detail::fmix64((static_cast<uint64_t>(_seed) << 1) - 1) : detail::fmix64(_seed);
+            for (unsigned int c = 0; c < table_size; ++c) {
+              fwd_table[c] = detail::fmix64(s + c);
+            }
+            for (unsigned int c = 0; c < table_size; ++c) {
+              rev_table[c] = fwd_table[KMER::KmerAlphabet::to_complement(c) & (table_size - 1)];
+            }
+          };
+
+          /// state of a whole k-mer, from the first (most significant) character.  O(k).
+          inline state init(const KMER & kmer) const {
+            state st{0, 0};
+            uint64_t c;
+            for (int pos = KMER::size - 1; pos >= 0; --pos) {
+              c = static_cast<uint64_t>(kmer.getCharsAtPos(pos, 1)) & (table_size - 1);
+              st.fwd = rol(st.fwd, 1) ^ fwd_table[c];
+              st.rev ^= rol(rev_table[c], (KMER::size - 1 - pos) % 64);
+            }
+            return st;
+          }
+
+          /// slide by 1 character:  out is the first character of the old k-mer, in the last of the new one.  O(1).
+          inline void roll(state & st, uint64_t out, uint64_t in) const {
+            out &= (table_size - 1);
+            in &= (table_size - 1);
+            st.fwd = rol(st.fwd, 1) ^ rol(fwd_table[out], k_rot) ^ fwd_table[in];
+            st.rev = ror(st.rev ^ rev_table[out], 1) ^ rol(rev_table[in], k1_rot);
+          }
+
+          /// hash value of a state.
+          inline uint64_t value(state const & st) const {
+            return detail::fmix64(Canonical ? (st.fwd + st.rev) : st.fwd);
+          }
+
+          /// operator to compute hash.  64 bit.  same as value() of the rolled state.
+          inline uint64_t operator()(const KMER & kmer) const {
+            return value(init(kmer));
+          }
+
+          /// batch hash.  out[i] = operator()(in[i]).
+          inline void hash(KMER const * in, size_t n, uint64_t * out) const {
+            for (size_t i = 0; i < n; ++i) out[i] = this->operator()(in[i]);
+          }
+
+      };
+      template<typename KMER, bool Prefix, bool Canonical>
+      constexpr uint8_t nthash<KMER, Prefix, Canonical>::batch_size;
+
+
 
       namespace sparsehash {
       	  //  ===============
@@ -45,14 +45,16 @@
 #include "mpi.h"
 #endif
 
-//#if defined(USE_OPENMP)
-//#include "omp.h"
-//#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include <tuple>        // tuple and utility functions
 #include <utility>      // pair and utility functions.
 #include <type_traits>
 #include <cctype>       // tolower.
+#include <atomic>
+#include <memory>       // shared_ptr
 
 #include "io/file.hpp"
 #include "io/fastq_loader.hpp"
@@ -64,20 +66,28 @@
 #include "common/sequence.hpp"
 #include "utils/kmer_utils.hpp"
 #include "index/kmer_hash.hpp"
+#include "index/kmer_dispatch.hpp"
 #include "common/kmer_transform.hpp"
 
 #include "io/kmer_file_helper.hpp"
 #include "io/kmer_parser.hpp"
+#include "io/packed_read_store.hpp"
+#include "index/read_dedup.hpp"
+#include "io/bucket_spill.hpp"
+#include "io/file_manifest.hpp"
 #include "io/mxx_support.hpp"
 #include "containers/distributed_unordered_map.hpp"
 #include "containers/distributed_sorted_map.hpp"
 //#include "containers/distributed_hashed_vec.hpp"
 //#include "containers/distributed_map.hpp"
 #include "containers/distributed_densehash_map.hpp"
+#include "containers/distributed_direct_count_map.hpp"
+#include "containers/dsc_map_checkpoint.hpp"
 
 #include "utils/benchmark_utils.hpp"
 #include "utils/file_utils.hpp"
 #include "utils/transform_utils.hpp"
+#include "utils/worker_pool.hpp"
 
 
 #include <fstream> // debug only
@@ -103,6 +113,17 @@ protected:
 
 	const mxx::comm& comm;
 
+	/// per stage counters of the last build_pipelined.
+	std::vector<::bliss::concurrent::stage_stats> pipeline_stats;
+
+	/// threads for the loops within this rank, shared by builds and queries.  nullptr for OpenMP teams.
+	std::shared_ptr<::bliss::concurrent::worker_pool> pool;
+
+	/// makes pool current on the calling thread for the duration of a build or query.  see worker_pool::scope.
+	::bliss::concurrent::worker_pool::scope pool_scope() const {
+		return ::bliss::concurrent::worker_pool::scope(pool.get());
+	}
+
 public:
 	using KmerType = typename MapType::key_type;
 	// TODO: make this consistent with map data type conventions?
@@ -124,13 +145,30 @@ public:
 		return map;
 	}
 
+	/// start nthreads pinned workers (0 for omp_get_max_threads()) for this index's builds and queries.
+	void use_worker_pool(int nthreads = 0) {
+		pool = std::make_shared<::bliss::concurrent::worker_pool>(nthreads);
+	}
+	/// share 1 pool among indices, e.g. count and position indices of the same reads.  nullptr for OpenMP teams.
+	void set_worker_pool(std::shared_ptr<::bliss::concurrent::worker_pool> const & p) {
+		pool = p;
+	}
+	std::shared_ptr<::bliss::concurrent::worker_pool> const & get_worker_pool() const {
+		return pool;
+	}
 
 
-//	std::vector<TupleType> find_overlap(std::vector<KmerType> &query) const {
-//		return map.find_overlap(query);
-//	}
+
+	/// find with overlapped point to point exchange, for maps that have it.  collective.
+	template <typename M = MapType>
+	auto find_overlap(std::vector<KmerType> &query) const
+	-> decltype(::std::declval<M const &>().find_overlap(::std::declval<std::vector<KmerType> &>())) {
+		auto scope = this->pool_scope();
+		return map.find_overlap(query);
+	}
 	auto find(std::vector<KmerType> &query) const
 		-> decltype(::std::declval<MapType>().find(::std::declval<std::vector<KmerType> &>())) {
+		auto scope = this->pool_scope();
 		return map.find(query);
 	}
 //	std::vector<TupleType> find_collective(std::vector<KmerType> &query) const {
@@ -141,10 +179,148 @@ public:
 //  }
 	auto count(std::vector<KmerType> &query) const
 	-> decltype(::std::declval<MapType>().count(::std::declval<std::vector<KmerType> &>())){
+		auto scope = this->pool_scope();
 		return map.count(query);
 	}
 
+	/// non-blocking find and count, for maps that have them.  see densehash_map_base::count_async.  collective.
+	template <typename M = MapType>
+	auto find_async(std::vector<KmerType> query) const
+	-> decltype(::std::declval<M const &>().find_async(::std::declval<std::vector<KmerType> >())) {
+		return map.find_async(::std::move(query));
+	}
+	template <typename M = MapType>
+	auto count_async(std::vector<KmerType> query) const
+	-> decltype(::std::declval<M const &>().count_async(::std::declval<std::vector<KmerType> >())) {
+		return map.count_async(::std::move(query));
+	}
+
+	/// find and count with duplicate query k-mers sent once, results in query order, for maps that have them.
+	/// see map_base::fanout_query.  collective.
+	template <typename M = MapType>
+	auto find_fanout(std::vector<KmerType> const & query, std::vector<size_t> & offsets) const
+	-> decltype(::std::declval<M const &>().find_fanout(::std::declval<std::vector<KmerType> const &>(), offsets)) {
+		auto scope = this->pool_scope();
+		return map.find_fanout(query, offsets);
+	}
+	template <typename M = MapType>
+	auto count_fanout(std::vector<KmerType> const & query) const
+	-> decltype(::std::declval<M const &>().count_fanout(::std::declval<std::vector<KmerType> const &>())) {
+		auto scope = this->pool_scope();
+		return map.count_fanout(query);
+	}
+
+	/// find and count with one answer per query k-mer, in query order, for maps that have them.
+	/// see densehash_map_base::query_aligned.  collective.
+	template <typename M = MapType>
+	auto find_aligned(std::vector<KmerType> const & query, ValueType const & missing = ValueType()) const
+	-> decltype(::std::declval<M const &>().find_aligned(::std::declval<std::vector<KmerType> const &>(), missing)) {
+		auto scope = this->pool_scope();
+		return map.find_aligned(query, missing);
+	}
+	template <typename M = MapType>
+	auto count_aligned(std::vector<KmerType> const & query) const
+	-> decltype(::std::declval<M const &>().count_aligned(::std::declval<std::vector<KmerType> const &>())) {
+		auto scope = this->pool_scope();
+		return map.count_aligned(query);
+	}
+
+	/**
+	 * @brief  streaming count query of a FASTQ file, for maps that have count_async.  collective.
+	 * @details  the file is read in blocks of block_size bytes per process (see KmerFileHelper::parse_reads_prefetched),
+	 *         and each block's k-mers are counted with count_async while the next block is read and parsed, so
+	 *         at most 2 blocks of k-mers are in memory and 2 queries outstanding, regardless of the file size.
+	 *         the unordered counts are joined back to the k-mers by key.  set_async_progress_thread on the map lets the
+	 *         exchanges also proceed during parsing.
+	 * @tparam FileReader  posix_file or mpiio_file.
+	 * @tparam ReadOp  functor with signature void(size_t const & read_id, size_t const * first, size_t const * last).
+	 *         called once per read, with the counts of the read's k-mers, in file order within this process's partition.
+	 *         the read id is the file offset of the record.
+	 * @return  number of reads and number of k-mers queried by this process.
+	 */
+	template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType,
+		typename FileReader, typename ReadOp, typename M = MapType>
+	auto count_reads_prefetched(FileReader & reader, size_t const & block_size, ReadOp & read_op) const
+	-> decltype(::std::declval<M const &>().count_async(::std::declval<std::vector<KmerType> >()), ::std::pair<size_t, size_t>()) {
+		using BatchType = ::bliss::io::KmerFileHelper::read_batch<KmerType>;
+		using ResultType = ::std::pair<KmerType, typename M::size_type>;
+
+		struct pending {
+			BatchType batch;
+			::dsc::query_handle<KmerType, ResultType> handle;
+		};
+
+		BL_BENCH_INIT(query);
+		auto scope = this->pool_scope();
+
+		// slots[curr] is free, slots[curr ^ 1] has the outstanding query of the previous block, if any.
+		pending slots[2];
+		int curr = 0;
+		std::vector<size_t> counts;
+		typename M::input_transform_type trans;
+
+		auto finish = [&read_op, &counts, &trans](pending & p) {
+			if (!p.handle.valid()) return;
+
+			std::vector<ResultType> & results = p.handle.get();
+			std::sort(results.begin(), results.end(), [](ResultType const & x, ResultType const & y) {
+				return x.first < y.first;
+			});
+
+			counts.resize(p.batch.kmers.size());
+			for (size_t i = 0; i < p.batch.kmers.size(); ++i) {
+				ResultType k(trans(p.batch.kmers[i]), 0);
+				auto it = std::lower_bound(results.begin(), results.end(), k, [](ResultType const & x, ResultType const & y) {
+					return x.first < y.first;
+				});
+				counts[i] = ((it != results.end()) && (it->first == k.first)) ? it->second : 0;
+			}
+			for (size_t r = 0; r < p.batch.size(); ++r) {
+				read_op(p.batch.ids[r], counts.data() + p.batch.offsets[r], counts.data() + p.batch.offsets[r + 1]);
+			}
+
+			p.handle = ::dsc::query_handle<KmerType, ResultType>();
+			p.batch.clear();
+		};
+
+		BL_BENCH_START(query);
+		auto query_op = [this, &slots, &curr, &finish](BatchType & batch) {
+			pending & p = slots[curr];
+			std::swap(p.batch, batch);
+			p.handle = this->map.template count_async<true>(p.batch.kmers);   // COLLECTIVE CALL.  copies the k-mers for the join.
+
+			curr ^= 1;
+			finish(slots[curr]);
+		};
+		auto read = ::bliss::io::KmerFileHelper::template parse_reads_prefetched<::bliss::index::kmer::KmerParser<KmerType>,
+			SeqParser, SeqIterType>(reader, block_size, query_op, this->comm);
+		finish(slots[curr ^ 1]);
+		BL_BENCH_END(query, "read_count", read.second);
+
+		BL_BENCH_REPORT_MPI_NAMED(query, "index:count_reads_prefetched", this->comm);
+		return read;
+	}
+
+	/// streaming count query via posix pread.  see count_reads_prefetched.
+	template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType,
+		typename ReadOp, typename M = MapType>
+	auto count_reads_posix(const std::string & filename, size_t const & block_size, ReadOp & read_op) const
+	-> decltype(::std::declval<M const &>().count_async(::std::declval<std::vector<KmerType> >()), ::std::pair<size_t, size_t>()) {
+		::bliss::io::posix_file reader(filename);
+		return this->template count_reads_prefetched<SeqParser, SeqIterType>(reader, block_size, read_op);
+	}
+
+	/// streaming count query via nonblocking mpiio.  see count_reads_prefetched.
+	template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType,
+		typename ReadOp, typename M = MapType>
+	auto count_reads_mpiio(const std::string & filename, size_t const & block_size, ReadOp & read_op) const
+	-> decltype(::std::declval<M const &>().count_async(::std::declval<std::vector<KmerType> >()), ::std::pair<size_t, size_t>()) {
+		::bliss::io::parallel::mpiio_file<SeqParser> reader(filename, 0UL, this->comm);   // collective open
+		return this->template count_reads_prefetched<SeqParser, SeqIterType>(reader, block_size, read_op);
+	}
+
 	void erase(std::vector<KmerType> &query) {
+		auto scope = this->pool_scope();
 		map.erase(query);
 	}
 
@@ -156,6 +332,7 @@ public:
 	template <typename Predicate>
 	auto find_if(std::vector<KmerType> &query, Predicate const &pred) const
 	-> decltype(::std::declval<MapType>().find(::std::declval<std::vector<KmerType> &>())) {
+		auto scope = this->pool_scope();
 		return map.find(query, false, pred);
 	}
 //	template <typename Predicate>
@@ -168,28 +345,33 @@ public:
 //  }
 	template <typename Predicate>
 	std::vector<TupleType> find_if(Predicate const &pred) const {
+		auto scope = this->pool_scope();
 		return map.find(pred);
 	}
 
 	template <typename Predicate>
 	auto count_if(std::vector<KmerType> &query, Predicate const &pred) const
 	-> decltype(::std::declval<MapType>().find(::std::declval<std::vector<KmerType> &>())) {
+		auto scope = this->pool_scope();
 		return map.count(query, false, pred);
 	}
 
 	template <typename Predicate>
 	std::vector<std::pair<KmerType, size_t> > count_if(Predicate const &pred) const {
+		auto scope = this->pool_scope();
 		return map.count(pred);
 	}
 
 
 	template <typename Predicate>
 	void erase_if(std::vector<KmerType> &query, Predicate const &pred) {
+		auto scope = this->pool_scope();
 		map.erase(query, false, pred);
 	}
 
 	template <typename Predicate>
 	void erase_if(Predicate const &pred) {
+		auto scope = this->pool_scope();
 		map.erase(pred);
 	}
 
@@ -208,18 +390,10 @@ public:
 
 		// distribute
 		BL_BENCH_START(insert);
+		auto scope = this->pool_scope();
 		this->map.insert(temp);  // COLLECTIVE CALL...
 		BL_BENCH_END(insert, "map_insert", this->map.local_size());
 
-#if (BL_BENCHMARK == 1)
-		BL_BENCH_START(insert);
-		size_t m = 0;  // here because sortmap needs it.
-		m = this->map.get_multiplicity();
-		BL_BENCH_END(insert, "multiplicity", m);
-#else
-		auto result = this->map.get_multiplicity();
-		BLISS_UNUSED(result);
-#endif
 		BL_BENCH_REPORT_MPI_NAMED(insert, "index:insert", this->comm);
 
 	 }
@@ -374,6 +548,428 @@ public:
 
 
 
+	 /**
+	  * @brief  streaming build.  file is read, then parsed and inserted in chunks of approximately chunk_size kmers,
+	  *         so the full set of kmers is never materialized and peak memory follows the map size instead.
+	  * @tparam FileType	file reader type, e.g. mpiio_file or partitioned_file
+	  */
+	 template <typename FileType, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+	 void build_chunked(const std::string & filename, MPI_Comm comm, size_t const & chunk_size) {
+
+		 // file extension determines SeqParserType
+		 std::string extension = ::bliss::utils::file::get_file_extension(filename);
+		 std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		 if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0) && (extension.compare("fa") != 0)) {
+			 throw std::invalid_argument("input filename extension is not supported.");
+		 }
+
+		 // check to make sure that the file parser will work
+		 if ((extension.compare("fastq") == 0) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTQParser<char*> >::value)) {
+			 throw std::invalid_argument("Specified File Parser template parameter does not support files with fastq extension.");
+		 } else if (((extension.compare("fasta") == 0) || (extension.compare("fa") == 0)) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTAParser<char*> >::value)) {
+			 throw std::invalid_argument("Specified File Parser template parameter does not support files with fasta extension.");
+		 }
+		 BL_BENCH_INIT(build);
+
+		 BL_BENCH_START(build);
+		 auto insert_op = [this](::std::vector<typename KmerParser::value_type> & chunk) {
+			 this->map.insert(chunk);  // COLLECTIVE CALL...
+		 };
+		 auto read = bliss::io::KmerFileHelper::template read_file_chunked<FileType, KmerParser, SeqParser, SeqIterType>(filename, chunk_size, insert_op, comm);
+		 BL_BENCH_END(build, "read_insert", read.second);
+		 BLISS_UNUSED(read);
+
+
+		 BL_BENCH_REPORT_MPI_NAMED(build, "index:build_chunked", this->comm);
+	 }
+
+	 /// streaming build via mpiio.  see build_chunked
+	 template <template <typename> class SeqParser, template <typename, template <typename> class> class SeqIterType>
+	 void build_mpiio(const std::string & filename, MPI_Comm comm, size_t const & chunk_size) {
+		 this->template build_chunked<::bliss::io::parallel::mpiio_file<SeqParser>, SeqParser, SeqIterType>(filename, comm, chunk_size);
+	 }
+
+	 /// streaming build via mmap.  see build_chunked
+	 template <template <typename> class SeqParser, template <typename, template <typename> class> class SeqIterType>
+	 void build_mmap(const std::string & filename, MPI_Comm comm, size_t const & chunk_size) {
+		 this->template build_chunked<::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file, SeqParser>, SeqParser, SeqIterType>(filename, comm, chunk_size);
+	 }
+
+	 /// streaming build via posix.  see build_chunked
+	 template <template <typename> class SeqParser, template <typename, template <typename> class> class SeqIterType>
+	 void build_posix(const std::string & filename, MPI_Comm comm, size_t const & chunk_size) {
+		 this->template build_chunked<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, SeqParser>, SeqParser, SeqIterType>(filename, comm, chunk_size);
+	 }
+
+	 /**
+	  * @brief  streaming build as build_chunked, with reading, parsing, and insert overlapped in a stage pipeline.
+	  * @details  1 thread walks the sequences, parse_threads threads parse them into chunks of about chunk_size kmers,
+	  *         and the calling thread inserts each chunk into the map (bucket, exchange, and local insert), while the
+	  *         next chunks are parsed.  at most depth chunks wait between stages.  per stage counters of the last build
+	  *         are in get_pipeline_stats().  see KmerFileHelper::read_file_pipelined.
+	  * @tparam FileType	file reader type, e.g. mpiio_file or partitioned_file
+	  */
+	 template <typename FileType, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+	 void build_pipelined(const std::string & filename, MPI_Comm comm, size_t const & chunk_size,
+			 int const & parse_threads = 2, size_t const & depth = 4) {
+
+		 std::string extension = ::bliss::utils::file::get_file_extension(filename);
+		 std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		 if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0) && (extension.compare("fa") != 0)) {
+			 throw std::invalid_argument("input filename extension is not supported.");
+		 }
+		 if ((extension.compare("fastq") == 0) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTQParser<char*> >::value)) {
+			 throw std::invalid_argument("Specified File Parser template parameter does not support files with fastq extension.");
+		 } else if (((extension.compare("fasta") == 0) || (extension.compare("fa") == 0)) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTAParser<char*> >::value)) {
+			 throw std::invalid_argument("Specified File Parser template parameter does not support files with fasta extension.");
+		 }
+		 BL_BENCH_INIT(build);
+
+		 BL_BENCH_START(build);
+		 auto insert_op = [this](::std::vector<typename KmerParser::value_type> & chunk) {
+			 this->map.insert(chunk);  // COLLECTIVE CALL...
+		 };
+		 auto read = bliss::io::KmerFileHelper::template read_file_pipelined<FileType, KmerParser, SeqParser, SeqIterType>(
+				 filename, chunk_size, insert_op, comm, parse_threads, depth, pipeline_stats);
+		 BL_BENCH_END(build, "read_insert", read.second);
+		 BLISS_UNUSED(read);
+
+		 BL_BENCH_REPORT_MPI_NAMED(build, "index:build_pipelined", this->comm);
+	 }
+
+	 /// per stage counters of the last build_pipelined on this process.
+	 std::vector<::bliss::concurrent::stage_stats> const & get_pipeline_stats() const {
+		 return pipeline_stats;
+	 }
+
+	 /**
+	  * @brief  streaming build as build_chunked, with a checkpoint of the map and the input consumed every interval chunks.
+	  * @details  if checkpoint_prefix has a checkpoint of a build of the same file with the same number of processes,
+	  *         the map is loaded from it and parsing resumes where that build stopped.  checkpoints are written
+	  *         asynchronously, and removed when the build completes.  see ::dsc::map_checkpoint.
+	  * @param checkpoint_prefix  path prefix for the checkpoint files, e.g. on node-local SSD or a burst buffer.
+	  * @param interval  number of chunks between checkpoints.
+	  */
+	 template <typename FileType, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+	 void build_checkpointed(const std::string & filename, MPI_Comm comm, size_t const & chunk_size,
+			 std::string const & checkpoint_prefix, size_t const & interval) {
+
+		 // file extension determines SeqParserType
+		 std::string extension = ::bliss::utils::file::get_file_extension(filename);
+		 std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		 if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0) && (extension.compare("fa") != 0)) {
+			 throw std::invalid_argument("input filename extension is not supported.");
+		 }
+
+		 // check to make sure that the file parser will work
+		 if ((extension.compare("fastq") == 0) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTQParser<char*> >::value)) {
+			 throw std::invalid_argument("Specified File Parser template parameter does not support files with fastq extension.");
+		 } else if (((extension.compare("fasta") == 0) || (extension.compare("fa") == 0)) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTAParser<char*> >::value)) {
+			 throw std::invalid_argument("Specified File Parser template parameter does not support files with fasta extension.");
+		 }
+		 if (interval == 0) {
+			 throw std::invalid_argument("checkpoint interval must be greater than 0.");
+		 }
+		 BL_BENCH_INIT(build);
+
+		 BL_BENCH_COLLECTIVE_START(build, "restore", this->comm);
+		 ::dsc::map_checkpoint<MapType> checkpoint(checkpoint_prefix, filename, this->comm);
+		 size_t resume_from = checkpoint.restore(this->map);
+		 BL_BENCH_END(build, "restore", this->map.local_size());
+
+		 BL_BENCH_START(build);
+		 auto insert_op = [this](::std::vector<typename KmerParser::value_type> & chunk) {
+			 this->map.insert(chunk);  // COLLECTIVE CALL...
+		 };
+		 size_t nchunks = 0;
+		 auto progress_op = [this, &checkpoint, &nchunks, &interval](size_t const & consumed) {
+			 if ((++nchunks % interval) == 0) checkpoint.save(this->map, consumed);  // COLLECTIVE CALL...
+		 };
+		 auto read = bliss::io::KmerFileHelper::template read_file_chunked<FileType, KmerParser, SeqParser, SeqIterType>(
+				 filename, chunk_size, insert_op, comm, resume_from, progress_op);
+		 BL_BENCH_END(build, "read_insert", read.second);
+
+		 BL_BENCH_START(build);
+		 checkpoint.remove();
+		 BL_BENCH_END(build, "remove_checkpoint", checkpoint.get_epoch());
+
+
+		 BL_BENCH_REPORT_MPI_NAMED(build, "index:build_checkpointed", this->comm);
+	 }
+
+	 /**
+	  * @brief  out-of-core build.  kmers are parsed in chunks and appended to per-destination spill files in spill_dir,
+	  *         then inserted in rounds that take at most the same number of kmers from every destination file.
+	  * @details  a round sends at most mem_budget / 4 bytes of kmers and receives at most as much, so the transient
+	  *         memory of the build stays within mem_budget regardless of input size and skew.  the map itself is not
+	  *         bounded:  for counting, it holds the distinct kmers only.
+	  * @param mem_budget  bytes per process for parse chunks, spill write buffers, and exchange.
+	  * @param spill_dir   directory for temporary files, e.g. node-local SSD.  files are removed on return.
+	  */
+	 template <typename FileType, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+	 void build_spilled(const std::string & filename, MPI_Comm comm, size_t const & mem_budget, std::string const & spill_dir) {
+
+		 // file extension determines SeqParserType
+		 std::string extension = ::bliss::utils::file::get_file_extension(filename);
+		 std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		 if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0) && (extension.compare("fa") != 0)) {
+			 throw std::invalid_argument("input filename extension is not supported.");
+		 }
+
+		 // check to make sure that the file parser will work
+		 if ((extension.compare("fastq") == 0) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTQParser<char*> >::value)) {
+			 throw std::invalid_argument("Specified File Parser template parameter does not support files with fastq extension.");
+		 } else if (((extension.compare("fasta") == 0) || (extension.compare("fa") == 0)) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTAParser<char*> >::value)) {
+			 throw std::invalid_argument("Specified File Parser template parameter does not support files with fasta extension.");
+		 }
+
+		 using V = typename KmerParser::value_type;
+		 size_t p = this->comm.size();
+		 // a quarter each for the parse chunk, the write buffers, the round's send, and its receive.
+		 size_t quarter = ::std::max(static_cast<size_t>(1), mem_budget / (4 * sizeof(V)));
+		 size_t per_dest = ::std::max(static_cast<size_t>(1), quarter / p);
+
+		 BL_BENCH_INIT(build);
+
+		 BL_BENCH_START(build);
+		 ::bliss::io::bucket_spill<V> spill(spill_dir, p, quarter * sizeof(V));
+		 auto const & key_to_rank = this->map.get_key_to_rank();
+		 auto spill_op = [&spill, &key_to_rank](::std::vector<V> & chunk) {
+			 spill.append(chunk, key_to_rank);
+		 };
+		 auto read = bliss::io::KmerFileHelper::template read_file_chunked<FileType, KmerParser, SeqParser, SeqIterType>(filename, quarter, spill_op, comm);
+		 spill.flush();
+		 BL_BENCH_END(build, "read_spill", read.second);
+
+		 BL_BENCH_COLLECTIVE_START(build, "rounds", this->comm);
+		 size_t rounds = 0;
+		 for (size_t r = 0; r < p; ++r) rounds = ::std::max(rounds, (spill.remaining(r) + per_dest - 1) / per_dest);
+		 rounds = ::mxx::allreduce(rounds, ::mxx::max<size_t>(), this->comm);
+		 BL_BENCH_END(build, "rounds", rounds);
+
+		 BL_BENCH_START(build);
+		 ::std::vector<V> chunk;
+		 chunk.reserve(per_dest * p);
+		 for (size_t i = 0; i < rounds; ++i) {
+			 chunk.clear();
+			 for (size_t r = 0; r < p; ++r) spill.read(r, per_dest, chunk);
+			 this->map.insert(chunk);  // COLLECTIVE CALL...
+		 }
+		 BL_BENCH_END(build, "insert", this->map.local_size());
+
+
+		 BL_BENCH_REPORT_MPI_NAMED(build, "index:build_spilled", this->comm);
+	 }
+
+	 /// out-of-core build via posix.  see build_spilled
+	 template <template <typename> class SeqParser, template <typename, template <typename> class> class SeqIterType>
+	 void build_posix(const std::string & filename, MPI_Comm comm, size_t const & mem_budget, std::string const & spill_dir) {
+		 this->template build_spilled<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, SeqParser>, SeqParser, SeqIterType>(filename, comm, mem_budget, spill_dir);
+	 }
+
+	 /// out-of-core build via mpiio.  see build_spilled
+	 template <template <typename> class SeqParser, template <typename, template <typename> class> class SeqIterType>
+	 void build_mpiio(const std::string & filename, MPI_Comm comm, size_t const & mem_budget, std::string const & spill_dir) {
+		 this->template build_spilled<::bliss::io::parallel::mpiio_file<SeqParser>, SeqParser, SeqIterType>(filename, comm, mem_budget, spill_dir);
+	 }
+
+	 /**
+	  * @brief  build from many files, balanced by bytes over all processes.  see file_manifest.hpp
+	  * @details  the files are parsed with the streaming parsers, which produce k-mers only, so this is for indices
+	  *         whose KmerParser produces k-mers, e.g. the count index.
+	  * @tparam StreamParser  StreamingFASTQKmerParser or StreamingFASTAKmerParser.  all files have to be of its format.
+	  */
+	 template <template <typename> class StreamParser>
+	 void build_files(::bliss::io::file_manifest const & manifest, MPI_Comm comm, size_t const & block_size) {
+		 static_assert(std::is_same<typename KmerParser::value_type, KmerType>::value,
+				 "build_files supports only indices whose KmerParser produces k-mers.");
+
+		 bool fastq = std::is_same<StreamParser<KmerType>, ::bliss::io::StreamingFASTQKmerParser<KmerType> >::value;
+		 for (size_t i = 0; i < manifest.size(); ++i) {
+			 std::string extension = ::bliss::utils::file::get_file_extension(manifest.file(i));
+			 std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+			 if (fastq ? (extension.compare("fastq") != 0) :
+					 ((extension.compare("fasta") != 0) && (extension.compare("fa") != 0))) {
+				 throw std::invalid_argument("Specified stream parser does not support the extension of " + manifest.file(i));
+			 }
+		 }
+		 BL_BENCH_INIT(build);
+
+		 BL_BENCH_START(build);
+		 ::std::vector<KmerType> temp;
+		 bliss::io::KmerFileHelper::template read_files_streaming<StreamParser, KmerType>(manifest, block_size, temp, comm);
+		 BL_BENCH_END(build, "read", temp.size());
+
+		 BL_BENCH_START(build);
+		 this->insert(temp);
+		 BL_BENCH_END(build, "insert", temp.size());
+
+
+		 BL_BENCH_REPORT_MPI_NAMED(build, "index:build_files", this->comm);
+	 }
+
+	 /**
+	  * @brief  build from reads already packed by KmerFileHelper::read_file_to_store.  collective.
+	  * @details  the same store can build several indices (e.g. count and position) from one parse, and the file data
+	  *           does not need to be kept.  KmerParser has to be KmerParser, KmerCountTupleParser or KmerPositionTupleParser.
+	  */
+	 void build(::bliss::io::PackedReadStore<typename KmerType::KmerAlphabet> const & store) {
+		 BL_BENCH_INIT(build);
+		 auto scope = this->pool_scope();
+
+		 BL_BENCH_START(build);
+		 ::std::vector<typename KmerParser::value_type> temp;
+		 store.template generate<KmerParser>(temp);
+		 BL_BENCH_END(build, "generate", temp.size());
+
+		 BL_BENCH_START(build);
+		 this->insert(temp);
+		 BL_BENCH_END(build, "insert", temp.size());
+
+		 BL_BENCH_REPORT_MPI_NAMED(build, "index:build_store", this->comm);
+	 }
+
+	 /**
+	  * @brief  count index build from a store, counting each block of reads on this rank before it is distributed.  collective.
+	  * @details  reads are taken in blocks of about block_kmers k-mers.  each thread counts its share of a block's reads in
+	  *           its own table of the map's local container type, and only the block's (k-mer, count) pairs go to
+	  *           map.insert, which reduces them with those from the other threads and ranks.  the k-mers of the whole
+	  *           store are never materialized, and with high coverage much less is sent.  KmerParser has to be
+	  *           KmerCountTupleParser.  the counting map's solid and heavy modes apply to k-mer inserts, not to these
+	  *           pair inserts.
+	  */
+	 void build_counted(::bliss::io::PackedReadStore<typename KmerType::KmerAlphabet> const & store, size_t const & block_kmers) {
+		 this->build_counted(store, block_kmers, ::std::vector<size_t>());
+	 }
+
+	 /**
+	  * @brief  count index build from a store as build_counted, with a weight per read.  collective.
+	  * @details  the k-mers of read i are counted weights[i] times, and reads with weight 0 are skipped.  empty weights
+	  *           count every read once.  see build_deduped.
+	  */
+	 void build_counted(::bliss::io::PackedReadStore<typename KmerType::KmerAlphabet> const & store, size_t const & block_kmers,
+			 ::std::vector<size_t> const & weights) {
+		 using TupleType = typename KmerParser::value_type;
+		 using CountType = typename ::std::tuple_element<1, TupleType>::type;
+		 static_assert(::std::is_same<KmerParser, ::bliss::index::kmer::KmerCountTupleParser<TupleType> >::value,
+				 "build_counted needs KmerCountTupleParser");
+
+		 BL_BENCH_INIT(build);
+
+		 BL_BENCH_START(build);
+		 auto const & arena = store.get_arena();
+		 size_t k = KmerType::size;
+		 // reads [bounds[b], bounds[b+1]) form block b.
+		 ::std::vector<size_t> bounds(1, 0);
+		 size_t kmers = 0;
+		 bool weighted = !(weights.empty());
+		 for (size_t i = 0; i < arena.size(); ++i) {
+			 if ((arena[i].length >= k) && (!weighted || (weights[i] > 0))) kmers += arena[i].length - k + 1;
+			 if (kmers >= ::std::max(block_kmers, static_cast<size_t>(1))) {
+				 bounds.push_back(i + 1);
+				 kmers = 0;
+			 }
+		 }
+		 if (bounds.back() != arena.size()) bounds.push_back(arena.size());
+		 size_t blocks = bounds.size() - 1;
+		 size_t rounds = ::mxx::allreduce(blocks, ::mxx::max<size_t>(), this->comm);
+		 BL_BENCH_END(build, "blocks", rounds);
+
+		 auto scope = this->pool_scope();
+		 int nthreads = ::bliss::concurrent::region_threads();
+		 // each thread's part stays with the thread across blocks.
+		 ::bliss::concurrent::worker_local<::std::vector<TupleType> > parts(nthreads);
+		 ::std::vector<TupleType> temp;
+		 size_t counted = 0;
+
+		 BL_BENCH_START(build);
+		 for (size_t b = 0; b < rounds; ++b) {
+			 int64_t first = (b < blocks) ? bounds[b] : 0;
+			 int64_t last = (b < blocks) ? bounds[b + 1] : 0;
+
+			 // dynamic schedule:  threads take 64 reads at a time.
+			 ::std::atomic<int64_t> next(first);
+			 ::bliss::concurrent::parallel_region(nthreads, [&](int tid) {
+				 // keys are transformed (e.g. canonicalized) first, as in map.insert, so they are valid local container keys.
+				 typename MapType::input_transform_type trans;
+				 typename MapType::local_container_type counts;
+				 for (int64_t chunk = next.fetch_add(64); chunk < last; chunk = next.fetch_add(64)) {
+					 for (int64_t i = chunk; i < ::std::min(chunk + 64, last); ++i) {
+						 if (arena[i].length < k) continue;
+						 CountType w = weighted ? static_cast<CountType>(weights[i]) : CountType(1);
+						 if (w == 0) continue;
+						 auto end = arena.template kmer_end<KmerType>(i);
+						 for (auto it = arena.template kmer_begin<KmerType>(i); it != end; ++it) {
+							 auto result = counts.insert(TupleType(trans(*it), w));
+							 if (!(result.second)) result.first->second += w;
+						 }
+					 }
+				 }
+				 counts.to_vector(parts[tid]);
+			 });
+
+			 temp.clear();
+			 for (int t = 0; t < nthreads; ++t) {
+				 temp.insert(temp.end(), parts[t].begin(), parts[t].end());
+			 }
+			 counted += temp.size();
+			 this->map.insert(temp);  // COLLECTIVE CALL...
+		 }
+		 BL_BENCH_END(build, "count_insert", counted);
+
+		 BL_BENCH_REPORT_MPI_NAMED(build, "index:build_counted", this->comm);
+	 }
+
+	 /**
+	  * @brief  count index build from a store, with exact duplicate reads removed first.  collective.
+	  * @details  the reads are deduplicated over all ranks by a 128 bit hash of their packed sequence (see
+	  *           ::bliss::index::dedup_reads), and build_counted counts the k-mers of 1 copy of each, weighted by the
+	  *           number of copies, so the counts are the same as without.  pays off for PCR heavy libraries, where
+	  *           20-40% of the reads are duplicates.  KmerParser has to be KmerCountTupleParser.
+	  * @return  number of reads with weight > 0 on this rank.
+	  */
+	 size_t build_deduped(::bliss::io::PackedReadStore<typename KmerType::KmerAlphabet> const & store, size_t const & block_kmers) {
+		 BL_BENCH_INIT(build);
+
+		 BL_BENCH_COLLECTIVE_START(build, "dedup", this->comm);
+		 size_t distinct = 0;
+		 ::std::vector<size_t> weights = ::bliss::index::dedup_reads(store, this->comm, distinct);
+		 BL_BENCH_END(build, "dedup", distinct);
+
+		 BL_BENCH_START(build);
+		 this->build_counted(store, block_kmers, weights);
+		 BL_BENCH_END(build, "count", this->map.local_size());
+
+		 BL_BENCH_REPORT_MPI_NAMED(build, "index:build_deduped", this->comm);
+		 return distinct;
+	 }
+
+
+	 /**
+	  * @brief  write the index, one segment per rank (prefix.<rank>.dsc).  collective.  see ::dsc::map_base::save
+	  */
+	 void save(const std::string & prefix) const {
+		 this->map.save(prefix);
+	 }
+
+	 /**
+	  * @brief  load an index written by save, in place of build_*.  collective.
+	  * @details with the same number of ranks, each rank maps its own segment and no k-mers are exchanged.
+	  *          otherwise the segments are read in parallel and redistributed.  see ::dsc::map_base::load
+	  */
+	 void load(const std::string & prefix) {
+		 BL_BENCH_INIT(load);
+
+		 BL_BENCH_START(load);
+		 size_t count = this->map.load(prefix);
+		 BL_BENCH_END(load, "load", count);
+		 BLISS_UNUSED(count);
+
+
+		 BL_BENCH_REPORT_MPI_NAMED(load, "index:load", this->comm);
+	 }
+
+
    typename MapType::const_iterator cbegin() const
    {
      return map.cbegin();
@@ -402,8 +998,17 @@ using KmerIndex = Index<MapType, KmerParser<typename MapType::key_type> >;
 template <typename MapType>
 using PositionIndex = Index<MapType, KmerPositionTupleParser<std::pair<typename MapType::key_type, typename MapType::mapped_type> > >;
 
-template <typename MapType>
-using PositionQualityIndex = Index<MapType, KmerPositionQualityTupleParser<std::pair<typename MapType::key_type, typename MapType::mapped_type> > >;
+/// sampled PositionIndex with only the (W, k)-minimizers, about 2 / (W + 1) of the k-mers.  query with MinimizerKmerParser.
+template <typename MapType, unsigned int W>
+using MinimizerPositionIndex = Index<MapType, MinimizerPositionTupleParser<std::pair<typename MapType::key_type, typename MapType::mapped_type>, W > >;
+
+/// QualityEncoder can be a QuantizedQualityScoreCodec alias to store 8 or 16 bit k-mer quality scores.
+template <typename MapType, template<typename> class QualityEncoder = bliss::index::Illumina18QualityScoreCodec>
+using PositionQualityIndex = Index<MapType, KmerPositionQualityTupleParser<std::pair<typename MapType::key_type, typename MapType::mapped_type>, QualityEncoder > >;
+
+/// same as PositionQualityIndex, with the single pass FusedKmerPositionQualityTupleParser.
+template <typename MapType, template<typename> class QualityEncoder = bliss::index::Illumina18QualityScoreCodec>
+using FusedPositionQualityIndex = Index<MapType, FusedKmerPositionQualityTupleParser<std::pair<typename MapType::key_type, typename MapType::mapped_type>, QualityEncoder > >;
 
 template <typename MapType>
 using CountIndex = Index<MapType, KmerCountTupleParser<std::pair<typename MapType::key_type, typename MapType::mapped_type> > >;
@@ -419,6 +1024,27 @@ template <typename Key>
 using DistHashStd = ::bliss::kmer::hash::cpp_std<Key, true>;
 template <typename Key>
 using DistHashIdentity = ::bliss::kmer::hash::identity<Key, true>;
+/// minimizer based distribution: consecutive k-mers of a read sharing a minimizer go to the same rank.
+template <typename Key>
+using DistHashMinimizer = ::bliss::kmer::hash::minimizer<Key, true>;
+/// fixed width mixer, with a vectorized batch hash for bucketing.
+template <typename Key>
+using DistHashMix = ::bliss::kmer::hash::mix<Key, true>;
+/// cheap distribution hash, bucket spread only.  hardware CRC32C when built with SSE4.2, else multiply-shift.
+template <typename Key>
+using DistHashMulShift = ::bliss::kmer::hash::multiply_shift<Key, true>;
+/// ntHash style canonical rolling hash.  RollingHashKmerSlidingWindow computes it in O(1) per character.
+template <typename Key>
+using DistHashNt = ::bliss::kmer::hash::nthash<Key, true>;
+#if defined(__SSE4_2__)
+template <typename Key>
+using DistHashCRC32C = ::bliss::kmer::hash::crc32c<Key, true>;
+template <typename Key>
+using DistHashHW = DistHashCRC32C<Key>;
+#else
+template <typename Key>
+using DistHashHW = DistHashMulShift<Key>;
+#endif
 
 
 template <typename Key>
@@ -429,6 +1055,10 @@ template <typename Key>
 using StoreHashStd = ::bliss::kmer::hash::cpp_std<Key, false>;
 template <typename Key>
 using StoreHashIdentity = ::bliss::kmer::hash::identity<Key, false>;
+template <typename Key>
+using StoreHashMix = ::bliss::kmer::hash::mix<Key, false>;
+template <typename Key>
+using StoreHashNt = ::bliss::kmer::hash::nthash<Key, false>;
 
 // =================  Partially defined aliases for MapParams, for distributed_xxx_maps.
 // NOTE: when using this, need to further alias so that only Key param remains.
@@ -450,6 +1080,9 @@ using SingleStrandHashMapParams = ::dsc::HashMapParams<
 		  >;
 
 
+/// canonical k-mers.  each inserted or queried key is canonicalized once, in batch, before distribution (see
+/// ::dsc::map_base::transform_input), and the map stores canonical keys, so hashing and probing do no transforms.
+/// Bimolecule params instead recompute the reverse complement in every hash and comparison.
 template <typename Key,
 	template <typename> class DistHash  = DistHashMurmur,
 	template <typename> class StoreHash = StoreHashMurmur
@@ -0,0 +1,240 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    multi_index_build.hpp
+ * @ingroup index
+ * @author  tpan
+ * @brief   build several k-mer indices from 1 read and parse of a file.
+ * @details each Index::build_* reads and parses the file with its own KmerParser.  to build e.g. a count index and a
+ *          position index from the same FASTQ, build_multi parses once with the widest tuple parser (e.g.
+ *          KmerPositionTupleParser), and each index gets a projection of every chunk of tuples (e.g. (k-mer, 1) for
+ *          counts, or the tuple itself for positions).
+ *
+ *          if all indices have the same k-mer type and input transform, and their maps send every k-mer to the same
+ *          rank, each chunk is transformed and distributed once for all of them.  the maps' own inserts then find
+ *          every entry already on its owner, so their exchanges carry no remote data.  otherwise each index
+ *          distributes its own projection, and only the I/O and parsing are shared.
+ */
+#ifndef SRC_INDEX_MULTI_INDEX_BUILD_HPP_
+#define SRC_INDEX_MULTI_INDEX_BUILD_HPP_
+
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <mxx/comm.hpp>
+
+#include "index/kmer_index.hpp"
+#include "io/incremental_mxx.hpp"
+#include "io/kmer_file_helper.hpp"
+#include "utils/benchmark_utils.hpp"
+#include "utils/sketch_utils.hpp"
+
+
+namespace bliss
+{
+  namespace index
+  {
+    namespace kmer
+    {
+
+      // ============= projections from a parsed tuple to the input of an index.
+
+      /// the tuple itself, e.g. position tuples into a position index.
+      struct project_identity {
+          template <typename V>
+          inline V const & operator()(V const & x) const { return x; }
+      };
+
+      /// the k-mer, for a KmerIndex or a CountIndex2.
+      struct project_kmer {
+          template <typename K, typename V>
+          inline K const & operator()(::std::pair<K, V> const & x) const { return x.first; }
+      };
+
+      /// (k-mer, 1), for a CountIndex.
+      template <typename Count>
+      struct project_count {
+          template <typename K, typename V>
+          inline ::std::pair<K, Count> operator()(::std::pair<K, V> const & x) const { return ::std::pair<K, Count>(x.first, Count(1)); }
+      };
+
+      /// an index to build, and the projection of the parsed tuples to its input.  see make_sink.
+      template <typename IndexType, typename Projection>
+      struct index_sink {
+          IndexType & index;
+          Projection project;
+      };
+
+      template <typename Projection, typename IndexType>
+      index_sink<IndexType, Projection> make_sink(IndexType & index, Projection const & project = Projection()) {
+        return index_sink<IndexType, Projection>{index, project};
+      }
+
+      namespace detail
+      {
+        template <typename V>
+        inline V const & tuple_key(V const & x) { return x; }
+        template <typename K, typename V>
+        inline K const & tuple_key(::std::pair<K, V> const & x) { return x.first; }
+        template <typename V>
+        inline V & tuple_key_ref(V & x) { return x; }
+        template <typename K, typename V>
+        inline K & tuple_key_ref(::std::pair<K, V> & x) { return x.first; }
+
+        template <typename Sink>
+        using sink_map_type = typename ::std::decay<decltype(::std::declval<Sink const &>().index.get_map())>::type;
+
+        /// true if the sinks' maps have the same key type and input transform.
+        template <typename... Sinks>
+        struct same_input;
+        template <typename S>
+        struct same_input<S> : ::std::true_type {};
+        template <typename S1, typename S2, typename... Sinks>
+        struct same_input<S1, S2, Sinks...> : ::std::integral_constant<bool,
+          ::std::is_same<typename sink_map_type<S1>::key_type, typename sink_map_type<S2>::key_type>::value &&
+          ::std::is_same<typename sink_map_type<S1>::input_transform_type, typename sink_map_type<S2>::input_transform_type>::value &&
+          same_input<S2, Sinks...>::value> {};
+
+        /// deterministic sample of k-mers, the same on all ranks.
+        template <typename KmerType>
+        ::std::vector<KmerType> sample_kmers(size_t n) {
+          ::std::vector<KmerType> out(n);
+          uint64_t h = 0;
+          for (size_t i = 0; i < n; ++i) {
+            for (unsigned int j = 0; j < KmerType::size; ++j) {
+              h = ::bliss::utils::sketch::mix64(h + i * KmerType::size + j + 1);
+              out[i].nextFromChar(h & ((1ULL << KmerType::bitsPerChar) - 1));
+            }
+          }
+          return out;
+        }
+
+        /// true if every sink's map sends each sample k-mer to the same rank as the first sink's map.
+        template <typename KmerType, typename Sink>
+        bool same_ranks(::std::vector<KmerType> const & sample, ::std::vector<int> & ranks, Sink const & sink) {
+          auto const & key_to_rank = sink.index.get_map().get_key_to_rank();
+          if (ranks.empty()) {
+            for (auto const & k : sample) ranks.emplace_back(key_to_rank(k));
+            return true;
+          }
+          for (size_t i = 0; i < sample.size(); ++i)
+            if (key_to_rank(sample[i]) != ranks[i]) return false;
+          return true;
+        }
+        template <typename KmerType, typename Sink, typename... Sinks>
+        bool same_ranks(::std::vector<KmerType> const & sample, ::std::vector<int> & ranks, Sink const & sink, Sinks const &... sinks) {
+          return same_ranks(sample, ranks, sink) && same_ranks(sample, ranks, sinks...);
+        }
+
+        /// project chunk for each sink and insert.  collective.
+        template <typename V>
+        void insert_all(::std::vector<V> const &) {}
+        template <typename V, typename Sink, typename... Sinks>
+        void insert_all(::std::vector<V> const & chunk, Sink & sink, Sinks &... sinks) {
+          using P = typename ::std::decay<decltype(sink.project(::std::declval<V const &>()))>::type;
+          ::std::vector<P> projected;
+          projected.reserve(chunk.size());
+          for (auto const & x : chunk) projected.emplace_back(sink.project(x));
+          sink.index.insert(projected);  // COLLECTIVE CALL...
+          insert_all(chunk, sinks...);
+        }
+      } // namespace detail
+
+
+      /**
+       * @brief  build several indices from 1 chunked read of filename.  collective.
+       * @details  see file description.  chunks are parsed by KmerParser, whose value_type each sink's projection
+       *           accepts, and inserted into every sink in argument order.  each sink gets the same chunks, so each
+       *           index ends up as if built with build_chunked and its own parser.
+       * @tparam FileType    file reader type, e.g. mpiio_file or partitioned_file.
+       * @tparam KmerParser  the widest tuple parser needed by the sinks, e.g. KmerPositionTupleParser.
+       * @param sinks  from make_sink(index, projection).
+       * @return  number of sequences and number of tuples parsed.
+       */
+      template <typename FileType, typename KmerParser, template <typename> class SeqParser,
+                template <typename, template <typename> class> class SeqIterType, typename... Sinks>
+      ::std::pair<size_t, size_t> build_multi(const std::string & filename, ::mxx::comm const & comm,
+                                              size_t const & chunk_size, Sinks... sinks) {
+        static_assert(sizeof...(Sinks) > 0, "build_multi needs at least 1 index");
+        using V = typename KmerParser::value_type;
+        using FirstMap = detail::sink_map_type<typename ::std::tuple_element<0, ::std::tuple<Sinks...> >::type>;
+        using KmerType = typename FirstMap::key_type;
+
+        BL_BENCH_INIT(build);
+
+        // 1 distribution for all, if the maps agree on where every k-mer goes.
+        BL_BENCH_START(build);
+        bool shared = false;
+        if (detail::same_input<Sinks...>::value && (comm.size() > 1)) {
+          ::std::vector<KmerType> sample = detail::sample_kmers<KmerType>(1024);
+          ::std::vector<int> ranks;
+          shared = detail::same_ranks(sample, ranks, sinks...);
+        }
+        BL_BENCH_END(build, "check_dist", shared);
+
+        auto const & first = ::std::get<0>(::std::tie(sinks...)).index.get_map();
+        auto const & key_to_rank = first.get_key_to_rank();
+        typename FirstMap::input_transform_type trans;
+
+        auto insert_op = [&](::std::vector<V> & chunk) {
+          if (shared) {
+            for (auto & x : chunk) detail::tuple_key_ref(x) = trans(detail::tuple_key(x));
+            ::std::vector<size_t> recv_counts;
+            ::std::vector<V> buffer;
+            ::imxx::distribute(chunk, [&key_to_rank](V const & x) { return key_to_rank(detail::tuple_key(x)); },
+                               recv_counts, buffer, comm);
+            chunk.swap(buffer);
+          }
+          detail::insert_all(chunk, sinks...);
+        };
+
+        BL_BENCH_START(build);
+        auto read = ::bliss::io::KmerFileHelper::template read_file_chunked<FileType, KmerParser, SeqParser, SeqIterType>(
+            filename, chunk_size, insert_op, comm);
+        BL_BENCH_END(build, "read_insert", read.second);
+
+        BL_BENCH_REPORT_MPI_NAMED(build, "index:build_multi", comm);
+        return read;
+      }
+
+      /// build_multi via mmap.
+      template <typename KmerParser, template <typename> class SeqParser,
+                template <typename, template <typename> class> class SeqIterType, typename... Sinks>
+      ::std::pair<size_t, size_t> build_multi_mmap(const std::string & filename, ::mxx::comm const & comm,
+                                                   size_t const & chunk_size, Sinks... sinks) {
+        return build_multi<::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file, SeqParser>, KmerParser,
+            SeqParser, SeqIterType>(filename, comm, chunk_size, sinks...);
+      }
+
+      /// build_multi via mpiio.
+      template <typename KmerParser, template <typename> class SeqParser,
+                template <typename, template <typename> class> class SeqIterType, typename... Sinks>
+      ::std::pair<size_t, size_t> build_multi_mpiio(const std::string & filename, ::mxx::comm const & comm,
+                                                    size_t const & chunk_size, Sinks... sinks) {
+        return build_multi<::bliss::io::parallel::mpiio_file<SeqParser>, KmerParser,
+            SeqParser, SeqIterType>(filename, comm, chunk_size, sinks...);
+      }
+
+    } // namespace kmer
+  } // namespace index
+} // namespace bliss
+
+
+#endif /* SRC_INDEX_MULTI_INDEX_BUILD_HPP_ */
@@ -0,0 +1,269 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    partitioned_position_index.hpp
+ * @ingroup bliss::index
+ * @author  tpan
+ * @brief   k-mer position index that keeps each rank's file partition, with a minimizer to rank directory.
+ * @details a PositionIndex hashes every k-mer to a rank, so consecutive k-mers of a chromosome, which are usually
+ *          queried together, end up on all ranks, and building it shuffles every (k-mer, position) pair.
+ *          PartitionedPositionIndex keeps the (k-mer, position) pairs on the rank whose partitioned_file block they
+ *          were parsed from.  a distributed directory maps each canonical minimizer (see bliss::kmer::hash::minimizer)
+ *          to the ranks holding k-mers with that minimizer.  consecutive k-mers mostly share a minimizer, so the
+ *          directory has about 2 / (k - m + 2) entries per k-mer, and build only shuffles those.
+ *
+ *          find asks the directory for the ranks of each key's minimizer, sends the key to only those ranks, and
+ *          returns their matches:  queries over a nearby region go to the few ranks holding that region.  keys are
+ *          canonical, as with CanonicalHashMapParams.  a rank holding the minimizer but not the k-mer answers nothing.
+ * @tparam M  minimizer length, as in bliss::kmer::hash::minimizer.
+ */
+#ifndef PARTITIONED_POSITION_INDEX_HPP_
+#define PARTITIONED_POSITION_INDEX_HPP_
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+#include <mxx/reduction.hpp>
+
+#include "common/kmer.hpp"
+#include "common/kmer_transform.hpp"
+#include "index/kmer_hash.hpp"
+#include "index/kmer_index.hpp"
+#include "io/incremental_mxx.hpp"
+#include "io/kmer_file_helper.hpp"
+#include "io/kmer_parser.hpp"
+#include "utils/benchmark_utils.hpp"
+#include "utils/comm_stats.hpp"
+
+namespace bliss
+{
+namespace index
+{
+namespace kmer
+{
+
+  template <typename Kmer, typename Id = ::bliss::common::ShortSequenceKmerId,
+            unsigned int M = ((Kmer::size < 15) ? Kmer::size : 15)>
+  class PartitionedPositionIndex {
+    public:
+      using KmerType = Kmer;
+      using ValueType = Id;
+      using TupleType = ::std::pair<KmerType, ValueType>;
+      using KmerParserType = KmerPositionTupleParser<TupleType>;
+
+      /// canonical minimizer, as an m-mer.
+      using MinimizerType = ::bliss::common::Kmer<M, typename KmerType::KmerAlphabet, uint64_t>;
+
+      template <typename K>
+      using DirectoryParams = SingleStrandHashMapParams<K>;
+      /// minimizer to rank.  1 entry per (minimizer, rank) pair.
+      using DirectoryType = ::dsc::unordered_multimap<MinimizerType, int, DirectoryParams>;
+
+    protected:
+      const mxx::comm& comm;
+
+      /// local (canonical k-mer, position) pairs, sorted by k-mer.
+      ::std::vector<TupleType> entries;
+
+      DirectoryType directory;
+
+      ::bliss::kmer::hash::minimizer<KmerType, true, M> min_hash;
+      ::bliss::kmer::transform::lex_less<KmerType> canonical;
+
+      MinimizerType get_minimizer(KmerType const & k) const {
+        MinimizerType m;
+        m.getDataRef()[0] = min_hash.get_minimizer(k);
+        return m;
+      }
+
+      static bool less_key(TupleType const & x, TupleType const & y) {
+        return x.first < y.first;
+      }
+
+    public:
+      PartitionedPositionIndex(const mxx::comm& _comm) : comm(_comm), directory(_comm) {}
+
+      virtual ~PartitionedPositionIndex() {}
+
+      /**
+       * @brief  index the local (k-mer, position) pairs where they are, and add their minimizers to the directory.  collective.
+       * @param input  content is canonicalized and sorted.
+       */
+      void build(::std::vector<TupleType> & input) {
+        BL_BENCH_INIT(build);
+
+        BL_BENCH_START(build);
+        for (auto & x : input) x.first = canonical(x.first);
+        ::std::sort(input.begin(), input.end(), less_key);
+        entries.insert(entries.end(), input.begin(), input.end());
+        if (entries.size() > input.size())
+          ::std::inplace_merge(entries.begin(), entries.end() - input.size(), entries.end(), less_key);
+        BL_BENCH_END(build, "local_sort", entries.size());
+
+        BL_BENCH_START(build);
+        ::std::vector<MinimizerType> mins;
+        mins.reserve(input.size() / 4);
+        for (auto const & x : input) {
+          MinimizerType m = get_minimizer(x.first);
+          if (mins.empty() || !(mins.back() == m)) mins.emplace_back(m);  // runs of shared minimizers.
+        }
+        ::std::sort(mins.begin(), mins.end());
+        mins.erase(::std::unique(mins.begin(), mins.end()), mins.end());
+
+        ::std::vector<::std::pair<MinimizerType, int> > dir;
+        dir.reserve(mins.size());
+        for (auto const & m : mins) dir.emplace_back(m, comm.rank());
+        BL_BENCH_END(build, "minimizers", dir.size());
+
+        BL_BENCH_COLLECTIVE_START(build, "directory", comm);
+        directory.insert(dir);
+        BL_BENCH_END(build, "directory", directory.local_size());
+
+        BL_BENCH_REPORT_MPI_NAMED(build, "partitioned_index:build", comm);
+      }
+
+      /// parse this rank's block of the file and build.  no (k-mer, position) shuffle.  collective.
+      template <template <typename> class SeqParser, template <typename, template <typename> class> class SeqIterType>
+      void build_mmap(const std::string & filename, MPI_Comm comm) {
+        BL_BENCH_INIT(build);
+
+        BL_BENCH_START(build);
+        ::std::vector<TupleType> temp;
+        ::bliss::io::KmerFileHelper::template read_file_mmap<KmerParserType, SeqParser, SeqIterType>(filename, temp, comm);
+        BL_BENCH_END(build, "read", temp.size());
+
+        BL_BENCH_START(build);
+        this->build(temp);
+        BL_BENCH_END(build, "build", entries.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(build, "partitioned_index:build_mmap", this->comm);
+      }
+
+      /**
+       * @brief  (k-mer, position) pairs for the keys.  collective.
+       * @details  1 directory find, then each key goes only to the ranks holding its minimizer.
+       * @param keys  content is canonicalized, sorted and made unique.
+       */
+      ::std::vector<TupleType> find(::std::vector<KmerType> & keys) const {
+        BL_BENCH_INIT(find);
+        BL_COMM_SCOPE(partitioned_find);
+        ::std::vector<TupleType> results;
+
+        BL_BENCH_START(find);
+        for (auto & k : keys) k = canonical(k);
+        ::std::sort(keys.begin(), keys.end());
+        keys.erase(::std::unique(keys.begin(), keys.end()), keys.end());
+
+        ::std::vector<MinimizerType> mins;
+        mins.reserve(keys.size());
+        for (auto const & k : keys) mins.emplace_back(get_minimizer(k));
+        ::std::vector<MinimizerType> query(mins);
+        ::std::sort(query.begin(), query.end());
+        query.erase(::std::unique(query.begin(), query.end()), query.end());
+        BL_BENCH_END(find, "minimizers", query.size());
+
+        // ranks of each minimizer, sorted by minimizer.
+        BL_BENCH_COLLECTIVE_START(find, "directory", comm);
+        ::std::vector<::std::pair<MinimizerType, int> > holders = directory.find(query);
+        ::std::sort(holders.begin(), holders.end());
+        BL_BENCH_END(find, "directory", holders.size());
+
+        // group key copies by holder rank.
+        BL_BENCH_START(find);
+        ::std::vector<size_t> send_counts(comm.size(), 0);
+        auto first_holder = [&holders](MinimizerType const & m) {
+          return ::std::lower_bound(holders.begin(), holders.end(), ::std::make_pair(m, 0),
+                                    [](::std::pair<MinimizerType, int> const & x, ::std::pair<MinimizerType, int> const & y) {
+            return x.first < y.first;
+          });
+        };
+        for (size_t i = 0; i < keys.size(); ++i) {
+          for (auto it = first_holder(mins[i]); (it != holders.end()) && (it->first == mins[i]); ++it)
+            ++send_counts[it->second];
+        }
+        ::std::vector<size_t> offsets(comm.size(), 0);
+        for (int r = 1; r < comm.size(); ++r) offsets[r] = offsets[r - 1] + send_counts[r - 1];
+        ::std::vector<KmerType> sends(offsets.back() + send_counts.back());
+        for (size_t i = 0; i < keys.size(); ++i) {
+          for (auto it = first_holder(mins[i]); (it != holders.end()) && (it->first == mins[i]); ++it)
+            sends[offsets[it->second]++] = keys[i];
+        }
+        BL_BENCH_END(find, "group", sends.size());
+
+        BL_BENCH_COLLECTIVE_START(find, "a2a", comm);
+        ::std::vector<size_t> recv_counts(comm.size(), 0);
+        ::imxx::counts_all2all(send_counts.data(), 1, recv_counts.data(), comm);
+        ::std::vector<KmerType> received(::std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0)));
+        ::imxx::wire_all2allv(sends.data(), send_counts, received.data(), recv_counts, comm);
+        BL_COMM_RECORD("distribute", sizeof(KmerType), send_counts, recv_counts);
+        BL_BENCH_END(find, "a2a", received.size());
+
+        // local lookup, per source rank.
+        BL_BENCH_START(find);
+        ::std::vector<TupleType> answers;
+        ::std::vector<size_t> answer_counts(comm.size(), 0);
+        auto it = received.begin();
+        for (int r = 0; r < comm.size(); ++r) {
+          size_t before = answers.size();
+          for (size_t j = 0; j < recv_counts[r]; ++j, ++it) {
+            auto range = ::std::equal_range(entries.begin(), entries.end(), TupleType(*it, ValueType()), less_key);
+            answers.insert(answers.end(), range.first, range.second);
+          }
+          answer_counts[r] = answers.size() - before;
+        }
+        BL_BENCH_END(find, "local_find", answers.size());
+
+        BL_BENCH_COLLECTIVE_START(find, "a2a2", comm);
+        ::std::vector<size_t> result_counts(comm.size(), 0);
+        ::imxx::counts_all2all(answer_counts.data(), 1, result_counts.data(), comm);
+        results.resize(::std::accumulate(result_counts.begin(), result_counts.end(), static_cast<size_t>(0)));
+        ::imxx::wire_all2allv(answers.data(), answer_counts, results.data(), result_counts, comm);
+        BL_COMM_RECORD("respond", sizeof(TupleType), answer_counts, result_counts);
+        BL_BENCH_END(find, "a2a2", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(find, "partitioned_index:find", comm);
+        return results;
+      }
+
+      /// global number of (k-mer, position) pairs.  collective.
+      size_t size() const {
+        return ::mxx::allreduce(entries.size(), comm);
+      }
+      size_t local_size() const {
+        return entries.size();
+      }
+
+      /// local (canonical k-mer, position) pairs, sorted by k-mer.
+      ::std::vector<TupleType> const & get_local_entries() const {
+        return entries;
+      }
+
+      DirectoryType const & get_directory() const {
+        return directory;
+      }
+  };
+
+} /* namespace kmer */
+} /* namespace index */
+} /* namespace bliss */
+
+#endif /* PARTITIONED_POSITION_INDEX_HPP_ */
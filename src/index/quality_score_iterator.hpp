@@ -66,11 +66,16 @@ template <typename BaseIterator, unsigned int KMER_SIZE,
           typename Encoder = bliss::index::Illumina18QualityScoreCodec<double> >
 class QualityScoreSlidingWindow
 {
+  protected:
+    /// how the k-mer score is stored.  a quantized Encoder decodes characters with its floating point codec.
+    typedef quality_score_storage<Encoder> Storage;
+    typedef typename Storage::codec_type Codec;
+
   public:
 
     /// Type of the internal sum is equal to the floating point type
     /// returned by the encoding
-    typedef typename Encoder::value_type QualityType;
+    typedef typename Codec::value_type QualityType;
 
   private:
 
@@ -102,10 +107,10 @@ public:
     {
       // fill the window_values and count the number of bases with
       // zero probability (-inf log-prob of) of begin correct
-      QualityType newval = Encoder::decode(*it);
+      QualityType newval = Codec::decode(*it);
       window_values[i] = newval;
 
-      if ((newval > Encoder::DecodeLUT[0]) && (newval < Encoder::DecodeLUT[95])) {
+      if ((newval > Codec::DecodeLUT[0]) && (newval < Codec::DecodeLUT[95])) {
         current_sum += newval;
       } else {
         ++n_incorrect_bases;
@@ -129,13 +134,13 @@ public:
     // slide the window by one, throwing out the last value and adding in
     // the new one in a circular buffer fashion
     QualityType oldval = window_values[window_pos];
-    QualityType newval = Encoder::decode(*it);
+    QualityType newval = Codec::decode(*it);
 
     window_values[window_pos] = newval;
     window_pos = (window_pos+1) % KMER_SIZE;
 
     // remove old value from either the sum or the incorrect count
-    if ((oldval > Encoder::DecodeLUT[0]) && (oldval < Encoder::DecodeLUT[95]))
+    if ((oldval > Codec::DecodeLUT[0]) && (oldval < Codec::DecodeLUT[95]))
     {
       current_sum -= oldval;
     }
@@ -145,7 +150,7 @@ public:
     }
 
     // add the new value to either the sum or the incorrect count
-    if ((newval > Encoder::DecodeLUT[0]) && (newval < Encoder::DecodeLUT[95]))
+    if ((newval > Codec::DecodeLUT[0]) && (newval < Codec::DecodeLUT[95]))
     {
       current_sum += newval;
     }
@@ -161,15 +166,15 @@ public:
    *        bases. This is equal to the multiplication of all base probabilities
    *        of being correct.
    *
-   * @return The probability that all bases in the sliding window are correct.
+   * @return The probability that all bases in the sliding window are correct, as Storage::value_type.
    */
-  inline QualityType getValue()
+  inline typename Storage::value_type getValue()
   {
 
       if (n_incorrect_bases > 0)
-        return 0.0;
+        return Storage::store(0.0);
       else
-        return std::exp2(current_sum);
+        return Storage::store(std::exp2(current_sum));
   }
 };
 
@@ -252,7 +257,7 @@ protected:
   typedef QualityScoreSlidingWindow<BaseIterator, KMER_SIZE, Encoder > functor_t;
 
 public:
-  typedef typename Encoder::value_type QualityType;
+  typedef typename quality_score_storage<Encoder>::value_type QualityType;
 
   /// Default constructor.
   QualityScoreGenerationIterator() : base_class_t() {}
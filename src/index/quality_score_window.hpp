@@ -0,0 +1,254 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    quality_score_window.hpp
+ * @ingroup index
+ * @author  tpan
+ * @brief   bulk computation of k-mer quality scores for a whole read.
+ * @details QualityScoreSlidingWindow decodes 1 quality character per step through the LUT and updates the window sum
+ *          with a subtract and an add, behind the sliding window and zip iterators.  here the quality characters of a
+ *          read are decoded in bulk into a prefix sum of log2(p_correct), and the score of the k-mer starting at i is
+ *          exp2(psum[i + k] - psum[i]).
+ *
+ *          the prefix sum is in double regardless of the codec's type, so the difference stays precise for long reads.
+ *          with AVX2, 32 characters are range checked at a time, and decoding and the prefix sum use gathers and
+ *          in-register scans on 8 characters at a time.
+ *
+ *          result is the same as QualityScoreSlidingWindow:  a k-mer that contains a base that the window counts
+ *          as incorrect (LUT value not strictly between DecodeLUT[0] and DecodeLUT[95]) has score 0.
+ *          characters outside of the codec's range are also incorrect.  EOL characters are not removed here.
+ */
+#ifndef BLISS_INDEX_QUALITY_SCORE_WINDOW_HPP
+#define BLISS_INDEX_QUALITY_SCORE_WINDOW_HPP
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "index/quality_scores.hpp"
+
+namespace bliss
+{
+namespace index
+{
+
+  /**
+   * @brief  per character tables for the window computation, built from Encoder::DecodeLUT.
+   * @details  log_prob is 0 for characters counted as incorrect, so that they do not disturb the prefix sum.
+   *           the correct characters form the contiguous range [lo, hi].
+   */
+  template <typename Encoder>
+  struct QualityWindowLUT {
+      /// log2(p_correct) for each character, 0 if the base is counted as incorrect.
+      ::std::array<double, 256> log_prob;
+      /// 1 if the character is counted as a correct base.
+      ::std::array<uint8_t, 256> valid;
+      /// first and last correct characters.
+      unsigned char lo, hi;
+
+      QualityWindowLUT() : lo(255), hi(0) {
+        log_prob.fill(0.0);
+        valid.fill(0);
+
+        for (size_t i = 0; (i < Encoder::size) && (i < 96); ++i) {
+          size_t c = Encoder::min_input + i;
+          auto v = Encoder::DecodeLUT[i];
+          if ((v > Encoder::DecodeLUT[0]) && (v < Encoder::DecodeLUT[95])) {
+            log_prob[c] = static_cast<double>(v);
+            valid[c] = 1;
+            if (c < lo) lo = c;
+            if (c > hi) hi = c;
+          }
+        }
+      }
+
+      /// the shared table for the Encoder.
+      static QualityWindowLUT const & get() {
+        static const QualityWindowLUT lut;
+        return lut;
+      }
+  };
+
+
+  /**
+   * @brief  decode quality characters into the prefix sum of log2(p_correct).  scalar version.
+   * @tparam AVX2  use the AVX2 specialization.  only valid if compiled with AVX2 support.
+   */
+  template <typename Encoder, bool AVX2 = false>
+  struct quality_prefix_sum {
+
+      /**
+       * @brief  psum[0] = 0, psum[i + 1] = psum[i] + log2(p_correct(in[i])).
+       * @param psum   needs n + 1 entries.
+       * @return true if there are characters that are counted as incorrect.
+       */
+      inline bool operator()(unsigned char const * in, size_t const & n, double * psum) const {
+        QualityWindowLUT<Encoder> const & lut = QualityWindowLUT<Encoder>::get();
+
+        double s = 0.0;
+        uint8_t valid = 1;
+        psum[0] = s;
+        for (size_t i = 0; i < n; ++i) {
+          s += lut.log_prob[in[i]];
+          psum[i + 1] = s;
+          valid &= lut.valid[in[i]];
+        }
+        return valid == 0;
+      }
+  };
+
+#if defined(__AVX2__)
+  /**
+   * @brief  AVX2 version.  a block of 32 characters is range checked with byte compares, then decoded 8 at a time
+   *         with 2 gathers of 4 doubles, each scanned in register and offset by the running sum.
+   */
+  template <typename Encoder>
+  struct quality_prefix_sum<Encoder, true> {
+
+      /// inclusive prefix sum of 4 doubles.
+      static inline __m256d scan(__m256d v) {
+        // [a, a+b, b+c, c+d]
+        v = _mm256_add_pd(v, _mm256_blend_pd(_mm256_permute4x64_pd(v, 0x90), _mm256_setzero_pd(), 0x1));
+        // [a, a+b, a+b+c, a+b+c+d]
+        return _mm256_add_pd(v, _mm256_permute2f128_pd(v, v, 0x08));
+      }
+
+      inline bool operator()(unsigned char const * in, size_t const & n, double * psum) const {
+        QualityWindowLUT<Encoder> const & lut = QualityWindowLUT<Encoder>::get();
+
+        const __m256i lo = _mm256_set1_epi8(static_cast<char>(lut.lo));
+        const __m256i hi = _mm256_set1_epi8(static_cast<char>(lut.hi));
+        double const * table = lut.log_prob.data();
+
+        __m256d carry = _mm256_setzero_pd();
+        bool invalid = false;
+        psum[0] = 0.0;
+
+        size_t i = 0;
+        for (; (i + 32) <= n; i += 32) {
+          __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(in + i));
+          // lo <= v <= hi, unsigned.
+          __m256i ok = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(v, lo), v),
+                                        _mm256_cmpeq_epi8(_mm256_min_epu8(v, hi), v));
+          invalid |= (_mm256_movemask_epi8(ok) != -1);
+
+          for (size_t j = 0; j < 32; j += 8) {
+            __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const *>(in + i + j)));
+
+            __m256d s = _mm256_add_pd(scan(_mm256_i32gather_pd(table, _mm256_castsi256_si128(idx), 8)), carry);
+            _mm256_storeu_pd(psum + i + j + 1, s);
+            carry = _mm256_permute4x64_pd(s, 0xFF);
+
+            s = _mm256_add_pd(scan(_mm256_i32gather_pd(table, _mm256_extracti128_si256(idx, 1), 8)), carry);
+            _mm256_storeu_pd(psum + i + j + 5, s);
+            carry = _mm256_permute4x64_pd(s, 0xFF);
+          }
+        }
+
+        // remainder
+        double s = psum[i];
+        uint8_t valid = 1;
+        for (; i < n; ++i) {
+          s += lut.log_prob[in[i]];
+          psum[i + 1] = s;
+          valid &= lut.valid[in[i]];
+        }
+        return invalid || (valid == 0);
+      }
+  };
+#endif
+
+  /// best available quality decoder for the compiler flags.
+  template <typename Encoder>
+#if defined(__AVX2__)
+  using QualityPrefixSum = quality_prefix_sum<Encoder, true>;
+#else
+  using QualityPrefixSum = quality_prefix_sum<Encoder, false>;
+#endif
+
+
+  /**
+   * @brief  computes the quality score of every k-mer in a read, same values as QualityScoreGenerationIterator.
+   * @details  buffers are kept between calls, so use 1 instance per thread.
+   * @tparam KMER_SIZE  window size
+   * @tparam Encoder    quality score codec, or a QuantizedQualityScoreCodec.  output is quality_score_storage<Encoder>::value_type
+   * @tparam Decoder    quality_prefix_sum variant.  default to best available.
+   */
+  template <unsigned int KMER_SIZE, typename Encoder = ::bliss::index::Illumina18QualityScoreCodec<double>,
+            typename Decoder = QualityPrefixSum<typename quality_score_storage<Encoder>::codec_type> >
+  class KmerQualityScorer {
+    protected:
+      using Storage = quality_score_storage<Encoder>;
+      using Codec = typename Storage::codec_type;
+
+    public:
+      using QualityType = typename Storage::value_type;
+
+    protected:
+      /// prefix sum of log2(p_correct)
+      ::std::vector<double> psum;
+      /// prefix count of incorrect bases, only computed if there are any.
+      ::std::vector<uint32_t> pbad;
+
+    public:
+      /**
+       * @brief  compute the scores of the n - KMER_SIZE + 1 k-mers in the quality characters [in, in + n).
+       * @param out   resized to the number of k-mers.
+       * @return number of k-mers.
+       */
+      size_t operator()(unsigned char const * in, size_t const & n, ::std::vector<QualityType> & out) {
+        if (n < KMER_SIZE) {
+          out.clear();
+          return 0;
+        }
+        size_t m = n - KMER_SIZE + 1;
+        out.resize(m);
+        psum.resize(n + 1);
+
+        bool has_invalid = Decoder()(in, n, psum.data());
+
+        double const * lead = psum.data() + KMER_SIZE;
+        double const * tail = psum.data();
+        if (!has_invalid) {
+          for (size_t i = 0; i < m; ++i) {
+            out[i] = Storage::store(::std::exp2(lead[i] - tail[i]));
+          }
+        } else {
+          QualityWindowLUT<Codec> const & lut = QualityWindowLUT<Codec>::get();
+          pbad.resize(n + 1);
+          pbad[0] = 0;
+          for (size_t i = 0; i < n; ++i) {
+            pbad[i + 1] = pbad[i] + (1 - lut.valid[in[i]]);
+          }
+          for (size_t i = 0; i < m; ++i) {
+            out[i] = Storage::store((pbad[i + KMER_SIZE] == pbad[i]) ? ::std::exp2(lead[i] - tail[i]) : 0.0);
+          }
+        }
+        return m;
+      }
+  };
+
+} // namespace index
+} // namespace bliss
+
+#endif // BLISS_INDEX_QUALITY_SCORE_WINDOW_HPP
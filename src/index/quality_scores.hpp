@@ -33,6 +33,8 @@
 #include <array>
 #include <limits>
 #include <algorithm>
+#include <cstdint>
+#include <type_traits>
 
 #include "utils/constexpr_array.hpp"
 
@@ -96,6 +98,10 @@ private:
 public:
     /// number of possible quality-score character values
     static constexpr unsigned char size = MaxInput - MinInput + 1;
+    /// the first quality-score character, i.e. DecodeLUT[0]
+    static constexpr unsigned char min_input = MinInput;
+    /// the last quality-score character
+    static constexpr unsigned char max_input = MaxInput;
 
 protected:
     /// Type of the lookup-table
@@ -514,6 +520,11 @@ public:
 
 
 
+template<typename OutT, unsigned char MinInput, unsigned char MaxInput, char MinScore>
+constexpr unsigned char QualityScoreCodec<OutT, MinInput, MaxInput, MinScore>::min_input;
+template<typename OutT, unsigned char MinInput, unsigned char MaxInput, char MinScore>
+constexpr unsigned char QualityScoreCodec<OutT, MinInput, MaxInput, MinScore>::max_input;
+
 // NOTE:  Define quality score lookup table here.  DO NOT define in separate cpp file or where it mightbe used.
 /// define (not declare or initialize) the quality score lookup table.
 template<typename OutT, unsigned char MinInput, unsigned char MaxInput, char MinScore>
@@ -547,6 +558,126 @@ using Illumina15QualityScoreCodec = QualityScoreCodec<OutT, 64, 126, 3>;  // spe
 
 
 
+/**
+ * @class QuantizedQualityScoreCodec
+ * @brief  stores a k-mer quality score, i.e. probability that all bases are correct, as a phred score in 8 or 16 bits
+ *         instead of a float or double probability.
+ * @details  k-mer quality scores are stored per k-mer occurrence, so the storage type sets the size of a
+ *           position + quality index entry.
+ *
+ *   uint8_t:  the value is the Codec's LUT index, i.e. Codec::encode(log2(p)) - MinInput, so encoding uses
+ *             the Codec's rounding and decoding is a lookup in Codec::DecodeLUT.  resolution is 1 phred unit.
+ *   uint16_t: fixed point phred score with 8 fractional bits, range [0, 256).
+ *
+ *   0 corresponds to p = 0, e.g. a k-mer with an incorrect base.  the maximum value decodes to p = 1 or nearly so.
+ *
+ * @tparam StoreT  uint8_t or uint16_t
+ * @tparam Codec   QualityScoreCodec used to decode the quality characters.
+ */
+template <typename StoreT, typename Codec>
+struct QuantizedQualityScoreCodec
+{
+    static_assert(std::is_same<StoreT, uint8_t>::value || std::is_same<StoreT, uint16_t>::value,
+                  "Quantized Quality Score storage needs to be uint8_t or uint16_t");
+
+    /// type of the stored k-mer quality score
+    typedef StoreT value_type;
+    /// codec for the quality characters
+    typedef Codec codec_type;
+    /// floating point type of the codec
+    typedef typename Codec::value_type prob_type;
+
+    /// number of fractional bits in the stored phred score.
+    static constexpr unsigned int fraction_bits = (sizeof(StoreT) == 1) ? 0 : 8;
+
+    /// convert probability that the k-mer is correct to the stored value.
+    inline static value_type encode_prob(const double p)
+    {
+      return encode_prob(p, std::integral_constant<bool, (fraction_bits == 0)>());
+    }
+
+    /// convert stored value back to the probability that the k-mer is correct.
+    inline static prob_type decode_prob(const value_type v)
+    {
+      return decode_prob(v, std::integral_constant<bool, (fraction_bits == 0)>());
+    }
+
+protected:
+    /// codec LUT index
+    inline static value_type encode_prob(const double p, std::true_type const &)
+    {
+      if (!(p > 0.0)) return Codec::encode(std::numeric_limits<prob_type>::lowest()) - Codec::min_input;
+      return Codec::encode(static_cast<prob_type>(std::log2(p))) - Codec::min_input;
+    }
+    inline static prob_type decode_prob(const value_type v, std::true_type const &)
+    {
+      return std::exp2(Codec::DecodeLUT[std::min<size_t>(v, Codec::DecodeLUT.size() - 1)]);
+    }
+
+    /// fixed point phred score:  q = -10 log10(1 - p)
+    inline static value_type encode_prob(const double p, std::false_type const &)
+    {
+      if (!(p > 0.0)) return 0;
+      if (p >= 1.0) return std::numeric_limits<value_type>::max();
+
+      double q = std::round(-10.0 * std::log10(1.0 - p) * static_cast<double>(1U << fraction_bits));
+      return (q >= static_cast<double>(std::numeric_limits<value_type>::max())) ?
+          std::numeric_limits<value_type>::max() : static_cast<value_type>(q);
+    }
+    inline static prob_type decode_prob(const value_type v, std::false_type const &)
+    {
+      return 1.0 - std::pow(10.0, static_cast<double>(v) / (-10.0 * static_cast<double>(1U << fraction_bits)));
+    }
+};
+
+template <typename StoreT, typename Codec>
+constexpr unsigned int QuantizedQualityScoreCodec<StoreT, Codec>::fraction_bits;
+
+/// quantized Illumina 1.8 k-mer quality storage.  convenience typedef.
+template<typename StoreT>
+using QuantizedIllumina18QualityScoreCodec = QuantizedQualityScoreCodec<StoreT, Illumina18QualityScoreCodec<double> >;
+
+/// quantized Sanger k-mer quality storage.  convenience typedef.
+template<typename StoreT>
+using QuantizedSangerQualityScoreCodec = QuantizedQualityScoreCodec<StoreT, SangerQualityScoreCodec<double> >;
+
+/// quantized Illumina 1.3 k-mer quality storage.  convenience typedef.
+template<typename StoreT>
+using QuantizedIllumina13QualityScoreCodec = QuantizedQualityScoreCodec<StoreT, Illumina13QualityScoreCodec<double> >;
+
+/// quantized Illumina 1.5 k-mer quality storage.  convenience typedef.
+template<typename StoreT>
+using QuantizedIllumina15QualityScoreCodec = QuantizedQualityScoreCodec<StoreT, Illumina15QualityScoreCodec<double> >;
+
+
+/**
+ * @brief  how a k-mer quality score is stored for an Encoder.  a QualityScoreCodec stores the probability directly.
+ * @details  codec_type decodes the quality characters, and store() converts the k-mer's probability of being correct
+ *           to value_type.
+ */
+template <typename Encoder>
+struct quality_score_storage
+{
+    typedef Encoder codec_type;
+    typedef typename Encoder::value_type value_type;
+
+    inline static value_type store(const double p) { return static_cast<value_type>(p); }
+    inline static double load(const value_type v) { return v; }
+};
+
+/// quantized storage.
+template <typename StoreT, typename Codec>
+struct quality_score_storage<QuantizedQualityScoreCodec<StoreT, Codec> >
+{
+    typedef Codec codec_type;
+    typedef StoreT value_type;
+
+    inline static value_type store(const double p) { return QuantizedQualityScoreCodec<StoreT, Codec>::encode_prob(p); }
+    inline static double load(const value_type v) { return QuantizedQualityScoreCodec<StoreT, Codec>::decode_prob(v); }
+};
+
+
+
 } // namespace index
 } // namespace bliss
 
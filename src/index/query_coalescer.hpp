@@ -0,0 +1,251 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    query_coalescer.hpp
+ * @ingroup index
+ * @author  tpan
+ * @brief   combine small find and count batches from several threads into 1 collective query per round.
+ * @details each collective find has a fixed latency from its exchanges, so many small batches, e.g. 1 per read from
+ *          the threads of a mapper, spend most of their time in latency.  the threads submit batches to a
+ *          query_coalescer and get futures.  the thread that makes MPI calls runs dispatch rounds:  a round waits until
+ *          max_keys keys are queued or the oldest batch has waited max_delay, then answers all queued batches with
+ *          1 collective find and 1 collective count on the union of their keys (see coalesced_query), and fulfills the
+ *          futures.
+ *
+ *          all ranks take part in every round, so a batch waits at most about max_delay locally, plus the time for the
+ *          slowest rank to reach the round, plus the query itself.  set max_delay from the latency target, and
+ *          max_keys from the batch size at which throughput stops improving.
+ */
+#ifndef SRC_INDEX_QUERY_COALESCER_HPP_
+#define SRC_INDEX_QUERY_COALESCER_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
+
+#include "utils/benchmark_utils.hpp"
+
+namespace bliss
+{
+  namespace index
+  {
+
+    /**
+     * @brief  answer several batches of keys with 1 collective query on the union of their transformed keys.  collective.
+     * @details  keys are transformed with the map's input transform and deduplicated, so each distinct key is sent once.
+     *           the answers are then split back:  counts[b][i] answers for batches[b][i], concatenated in answers[b] in
+     *           the order of the batch.  answer keys are transformed, as from find.
+     * @param query  find or count on a vector of keys, e.g. a lambda calling Index::find.
+     */
+    template <typename Result, typename Map, typename Key, typename Query>
+    void coalesced_query(Map const & map, ::std::vector<::std::vector<Key> const *> const & batches, Query const & query,
+                         ::std::vector<::std::vector<size_t> > & counts, ::std::vector<::std::vector<Result> > & answers) {
+      ::std::vector<::std::vector<Key> > keys(batches.size());
+      ::std::vector<Key> all;
+      for (size_t b = 0; b < batches.size(); ++b) {
+        map.transform_input(*(batches[b]), keys[b]);
+        all.insert(all.end(), keys[b].begin(), keys[b].end());
+      }
+      ::std::sort(all.begin(), all.end());
+      all.erase(::std::unique(all.begin(), all.end()), all.end());
+
+      ::std::vector<Result> results = query(all);  // COLLECTIVE CALL...
+      auto less_key = [](Result const & x, Result const & y) { return x.first < y.first; };
+      ::std::stable_sort(results.begin(), results.end(), less_key);
+
+      counts.resize(batches.size());
+      answers.resize(batches.size());
+      for (size_t b = 0; b < batches.size(); ++b) {
+        counts[b].assign(keys[b].size(), 0);
+        answers[b].clear();
+        for (size_t i = 0; i < keys[b].size(); ++i) {
+          Result probe;
+          probe.first = keys[b][i];
+          auto range = ::std::equal_range(results.begin(), results.end(), probe, less_key);
+          counts[b][i] = ::std::distance(range.first, range.second);
+          answers[b].insert(answers[b].end(), range.first, range.second);
+        }
+      }
+    }
+
+
+    /**
+     * @brief  queue of find and count batches from any thread, answered in collective rounds.  see file description.
+     * @tparam Index  e.g. CountIndex or PositionIndex.
+     */
+    template <typename Index>
+    class query_coalescer {
+      public:
+        using KmerType = typename Index::KmerType;
+        using find_result_type = typename ::std::decay<decltype(::std::declval<Index const &>().find(
+            ::std::declval<::std::vector<KmerType> &>()))>::type::value_type;
+        using count_result_type = typename ::std::decay<decltype(::std::declval<Index const &>().count(
+            ::std::declval<::std::vector<KmerType> &>()))>::type::value_type;
+
+        /// answers to 1 batch:  counts[i] answers for keys[i], concatenated in answers.
+        template <typename Result>
+        struct result {
+            ::std::vector<size_t> counts;
+            ::std::vector<Result> answers;
+        };
+        using find_result = result<find_result_type>;
+        using count_result = result<count_result_type>;
+
+      protected:
+        using clock = ::std::chrono::steady_clock;
+
+        template <typename Result>
+        struct pending {
+            ::std::vector<KmerType> keys;
+            ::std::promise<result<Result> > promise;
+            clock::time_point arrival;
+        };
+
+        Index const & index;
+        const mxx::comm& comm;
+
+        size_t max_keys;
+        clock::duration max_delay;
+
+        ::std::mutex mutex;
+        ::std::condition_variable ready;
+        ::std::deque<pending<find_result_type> > finds;
+        ::std::deque<pending<count_result_type> > counts;
+        size_t queued_keys;
+        bool closed;
+
+        template <typename Result>
+        ::std::future<result<Result> > submit(::std::deque<pending<Result> > & queue, ::std::vector<KmerType> && keys) {
+          pending<Result> p;
+          p.keys = ::std::move(keys);
+          p.arrival = clock::now();
+          ::std::future<result<Result> > out = p.promise.get_future();
+          {
+            ::std::lock_guard<::std::mutex> lock(mutex);
+            queued_keys += p.keys.size();
+            queue.emplace_back(::std::move(p));
+          }
+          ready.notify_one();
+          return out;
+        }
+
+        /// answer the taken batches of 1 kind, if any rank has some.  collective.
+        template <typename Result, typename Query>
+        void answer(::std::deque<pending<Result> > & taken, Query const & query) {
+          if (!::mxx::any_of(!taken.empty(), comm)) return;
+
+          ::std::vector<::std::vector<KmerType> const *> batches;
+          for (auto const & p : taken) batches.emplace_back(&(p.keys));
+          ::std::vector<::std::vector<size_t> > c;
+          ::std::vector<::std::vector<Result> > a;
+          coalesced_query<Result>(index.get_map(), batches, query, c, a);
+
+          for (size_t b = 0; b < taken.size(); ++b) {
+            result<Result> r;
+            r.counts.swap(c[b]);
+            r.answers.swap(a[b]);
+            taken[b].promise.set_value(::std::move(r));
+          }
+        }
+
+      public:
+        /**
+         * @param _max_keys   start a round once this many keys are queued.
+         * @param _max_delay  or once the oldest batch has waited this long.
+         */
+        query_coalescer(Index const & _index, const mxx::comm& _comm, size_t const & _max_keys = (1UL << 20),
+                        ::std::chrono::microseconds const & _max_delay = ::std::chrono::microseconds(2000)) :
+          index(_index), comm(_comm), max_keys(_max_keys), max_delay(_max_delay), queued_keys(0), closed(false) {}
+
+        query_coalescer(query_coalescer const & other) = delete;
+        query_coalescer & operator=(query_coalescer const & other) = delete;
+
+        /// queue a find.  thread safe, no MPI calls.
+        ::std::future<find_result> find(::std::vector<KmerType> keys) {
+          return this->submit(finds, ::std::move(keys));
+        }
+        /// queue a count.  thread safe, no MPI calls.
+        ::std::future<count_result> count(::std::vector<KmerType> keys) {
+          return this->submit(counts, ::std::move(keys));
+        }
+
+        /// no more batches from this rank after the queued ones.  thread safe.
+        void close() {
+          {
+            ::std::lock_guard<::std::mutex> lock(mutex);
+            closed = true;
+          }
+          ready.notify_one();
+        }
+
+        /**
+         * @brief  1 round:  wait for max_keys queued keys or max_delay, then answer all queued batches.  collective.
+         * @return  true if all ranks are closed and had nothing left to answer.
+         */
+        bool dispatch_once() {
+          BL_BENCH_INIT(coalesce);
+
+          BL_BENCH_START(coalesce);
+          ::std::deque<pending<find_result_type> > taken_finds;
+          ::std::deque<pending<count_result_type> > taken_counts;
+          bool done;
+          {
+            ::std::unique_lock<::std::mutex> lock(mutex);
+            clock::time_point oldest = clock::now();
+            if (!finds.empty()) oldest = ::std::min(oldest, finds.front().arrival);
+            if (!counts.empty()) oldest = ::std::min(oldest, counts.front().arrival);
+            ready.wait_until(lock, oldest + max_delay, [this]() { return closed || (queued_keys >= max_keys); });
+
+            taken_finds.swap(finds);
+            taken_counts.swap(counts);
+            queued_keys = 0;
+            done = closed && taken_finds.empty() && taken_counts.empty();
+          }
+          BL_BENCH_END(coalesce, "wait", taken_finds.size() + taken_counts.size());
+
+          BL_BENCH_COLLECTIVE_START(coalesce, "find", comm);
+          this->answer(taken_finds, [this](::std::vector<KmerType> & q) { return index.find(q); });
+          BL_BENCH_END(coalesce, "find", taken_finds.size());
+
+          BL_BENCH_COLLECTIVE_START(coalesce, "count", comm);
+          this->answer(taken_counts, [this](::std::vector<KmerType> & q) { return index.count(q); });
+          BL_BENCH_END(coalesce, "count", taken_counts.size());
+
+          BL_BENCH_REPORT_MPI_NAMED(coalesce, "coalescer:round", comm);
+
+          return ::mxx::all_of(done, comm);
+        }
+
+        /// dispatch rounds until all ranks are closed and answered.  collective, on the thread that makes MPI calls.
+        void run() {
+          while (!this->dispatch_once()) {}
+        }
+    };
+
+  } // namespace index
+} // namespace bliss
+
+#endif // SRC_INDEX_QUERY_COALESCER_HPP_
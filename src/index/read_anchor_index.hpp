@@ -0,0 +1,271 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    read_anchor_index.hpp
+ * @ingroup bliss::index
+ * @author  tpan
+ * @brief   k-mer position index that stores (read number, offset in read) per occurrence, with file positions on demand.
+ * @details a PositionIndex stores the file position of every k-mer occurrence.  most read level queries only ask which
+ *          reads contain a k-mer, so ReadAnchorIndex stores a ReadKmerId instead:  the global number of the read and
+ *          the k-mer's offset from the read's record start, which can be packed into 32 bits for short reads.  the read
+ *          number to file position map is kept once per read, in a ReadOffsetTable on the rank that packed the read,
+ *          and is only consulted by resolve.
+ *
+ *          read numbers are assigned in rank order over the PackedReadStore the index is built from.
+ */
+#ifndef READ_ANCHOR_INDEX_HPP_
+#define READ_ANCHOR_INDEX_HPP_
+
+#include <vector>
+#include <utility>      // pair
+#include <algorithm>    // upper_bound
+#include <stdexcept>
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+
+#include "utils/benchmark_utils.hpp"
+#include "common/sequence.hpp"
+#include "io/mxx_support.hpp"
+#include "io/incremental_mxx.hpp"
+#include "io/packed_read_store.hpp"
+
+namespace bliss
+{
+namespace index
+{
+namespace kmer
+{
+
+  /**
+   * @brief   distributed map from global read number to the start of the read's record in its file.
+   * @details rank r holds reads [firsts[r], firsts[r+1]), in the order of its PackedReadStore.
+   */
+  class ReadOffsetTable {
+    protected:
+      ::mxx::comm const & comm;
+
+      /// record start and file of each local read.
+      std::vector<::bliss::common::ShortSequenceKmerId> starts;
+
+      /// first read number of each rank, then the total.
+      std::vector<size_t> firsts;
+
+      size_t owner(size_t const & read) const {
+        return (::std::upper_bound(firsts.begin(), firsts.end(), read) - firsts.begin()) - 1;
+      }
+
+    public:
+      ReadOffsetTable(::mxx::comm const & _comm) : comm(_comm), firsts(_comm.size() + 1, 0) {}
+
+      /**
+       * @brief  take the local reads of the store, numbered after those of the lower ranks.  collective.
+       * @return the number of the first local read.
+       */
+      template <typename Alphabet>
+      size_t build(::bliss::io::PackedReadStore<Alphabet> const & store) {
+        starts.clear();
+        starts.reserve(store.size());
+        for (size_t i = 0; i < store.size(); ++i) {
+          starts.emplace_back(store.get_id(i));
+        }
+
+        std::vector<size_t> counts = ::mxx::allgather(starts.size(), comm);
+        firsts[0] = 0;
+        for (size_t r = 0; r < counts.size(); ++r) {
+          firsts[r + 1] = firsts[r] + counts[r];
+        }
+        return first();
+      }
+
+      /// global number of reads.
+      size_t size() const { return firsts.back(); }
+      size_t local_size() const { return starts.size(); }
+      /// number of the first local read.
+      size_t first() const { return firsts[comm.rank()]; }
+
+      /**
+       * @brief  record start and file of each read, in query order.  collective.
+       * @details the reads are sent to their owners with imxx::distribute, and the answers come back in query order
+       *          through the i2o permutation.  see densehash_map_base::query_aligned.
+       */
+      std::vector<::bliss::common::ShortSequenceKmerId> lookup(std::vector<size_t> const & reads) const {
+        BL_BENCH_INIT(lookup);
+        std::vector<::bliss::common::ShortSequenceKmerId> results;
+
+        for (auto const & r : reads) {
+          if (r >= size()) throw std::out_of_range("ReadOffsetTable: read number out of range.");
+        }
+
+        BL_BENCH_START(lookup);
+        std::vector<size_t> query(reads);
+        std::vector<size_t> i2o;
+        std::vector<size_t> recv_counts;
+        if (comm.size() > 1) {
+          std::vector<size_t> buffer;
+          ::imxx::distribute(query, [this](size_t const & r) { return this->owner(r); },
+                             recv_counts, i2o, buffer, comm);
+          query.swap(buffer);
+        }
+        BL_BENCH_END(lookup, "dist_query", query.size());
+
+        BL_BENCH_START(lookup);
+        size_t f = first();
+        results.reserve(query.size());
+        for (auto const & r : query) {
+          results.emplace_back(starts[r - f]);
+        }
+        BL_BENCH_END(lookup, "local_lookup", results.size());
+
+        if (comm.size() > 1) {
+          BL_BENCH_START(lookup);
+          auto bucketed = ::mxx::all2allv(results, recv_counts, comm);
+          results.resize(bucketed.size());
+          if (bucketed.size() > 0)
+            ::imxx::local::unpermute(bucketed.begin(), bucketed.end(), i2o.begin(), results.begin(), 0);
+          BL_BENCH_END(lookup, "a2a2", results.size());
+        }
+
+        BL_BENCH_REPORT_MPI_NAMED(lookup, "read_table:lookup", comm);
+
+        return results;
+      }
+
+      /**
+       * @brief  file position of each k-mer occurrence, in query order, as the PositionIndex id.  collective.
+       */
+      template <typename W, unsigned int B>
+      std::vector<::bliss::common::ShortSequenceKmerId>
+      resolve(std::vector<::bliss::common::ReadKmerId<W, B> > const & occurrences) const {
+        std::vector<size_t> reads;
+        reads.reserve(occurrences.size());
+        for (auto const & o : occurrences) {
+          reads.emplace_back(o.get_read());
+        }
+
+        std::vector<::bliss::common::ShortSequenceKmerId> results = lookup(reads);
+        for (size_t i = 0; i < results.size(); ++i) {
+          results[i] += occurrences[i].get_offset();
+        }
+        return results;
+      }
+  };
+
+
+  /**
+   * @brief   k-mer index of (k-mer, ReadKmerId) occurrences, with a ReadOffsetTable for file positions.
+   * @tparam MapType   multimap from k-mer to a ::bliss::common::ReadKmerId, e.g. densehash_multimap.
+   */
+  template <typename MapType>
+  class ReadAnchorIndex {
+    public:
+      using KmerType = typename MapType::key_type;
+      using ValueType = typename MapType::mapped_type;
+      using TupleType = std::pair<KmerType, ValueType>;
+      using Alphabet = typename KmerType::KmerAlphabet;
+
+    protected:
+      MapType map;
+
+      ReadOffsetTable table;
+
+      const mxx::comm& comm;
+
+    public:
+      ReadAnchorIndex(const mxx::comm& _comm) : map(_comm), table(_comm), comm(_comm) {}
+
+      virtual ~ReadAnchorIndex() {};
+
+      MapType & get_map() { return map; }
+      MapType const & get_map() const { return map; }
+      ReadOffsetTable const & get_table() const { return table; }
+
+      /**
+       * @brief  number the reads of the store, then insert one (k-mer, read, offset) tuple per k-mer.  collective.
+       * @details throws if there are more reads, or longer records, than ValueType can hold.
+       */
+      void build(::bliss::io::PackedReadStore<Alphabet> const & store) {
+        BL_BENCH_INIT(build);
+
+        BL_BENCH_START(build);
+        size_t first = table.build(store);
+        if ((table.size() > 0) && ((table.size() - 1) > ValueType::max_read))
+          throw std::invalid_argument("ReadAnchorIndex: more reads than the read id type can hold.");
+        BL_BENCH_END(build, "read_table", table.local_size());
+
+        BL_BENCH_START(build);
+        auto const & arena = store.get_arena();
+        std::vector<TupleType> temp;
+        temp.reserve(arena.template num_kmers<KmerType>());
+        for (size_t i = 0; i < arena.size(); ++i) {
+          if (arena[i].length < KmerType::size) continue;
+          size_t start = store.get_id(i).get_pos();
+          auto end = arena.template kmer_end<KmerType>(i);
+          size_t j = 0;
+          for (auto it = arena.template kmer_begin<KmerType>(i); it != end; ++it, ++j) {
+            // offset from the record start, as in KmerPositionTupleParser.
+            size_t offset = arena.source_offset(i, j) - start;
+            if (offset > static_cast<size_t>(ValueType::offset_mask))
+              throw std::invalid_argument("ReadAnchorIndex: record longer than the read id offset can hold.");
+            temp.emplace_back(*it, ValueType(first + i, offset));
+          }
+        }
+        BL_BENCH_END(build, "generate", temp.size());
+
+        BL_BENCH_START(build);
+        map.insert(temp);
+        BL_BENCH_END(build, "insert", temp.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(build, "read_anchor_index:build", comm);
+      }
+
+      /// (k-mer, read id) occurrences of the query k-mers.  get_read() gives the reads that contain them.  collective.
+      auto find(std::vector<KmerType> &query) const
+        -> decltype(::std::declval<MapType>().find(::std::declval<std::vector<KmerType> &>())) {
+        return map.find(query);
+      }
+
+      auto count(std::vector<KmerType> &query) const
+        -> decltype(::std::declval<MapType>().count(::std::declval<std::vector<KmerType> &>())) {
+        return map.count(query);
+      }
+
+      /// file positions of found occurrences, in order.  see ReadOffsetTable::resolve.  collective.
+      std::vector<::bliss::common::ShortSequenceKmerId> resolve(std::vector<TupleType> const & found) const {
+        std::vector<ValueType> occurrences;
+        occurrences.reserve(found.size());
+        for (auto const & x : found) {
+          occurrences.emplace_back(x.second);
+        }
+        return table.resolve(occurrences);
+      }
+
+      size_t size() const {
+        return map.size();
+      }
+
+      size_t local_size() const {
+        return map.local_size();
+      }
+  };
+
+
+} // namespace kmer
+} // namespace index
+} // namespace bliss
+
+#endif /* READ_ANCHOR_INDEX_HPP_ */
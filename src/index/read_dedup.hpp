@@ -0,0 +1,156 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    read_dedup.hpp
+ * @ingroup bliss::index
+ * @author  tpan
+ * @brief   exact duplicate read detection over the ranks, for weighted k-mer counting.
+ * @details PCR duplicates generate the same k-mers again, which are parsed, exchanged and inserted for nothing when
+ *          only the counts are needed.  dedup_reads hashes each read of a PackedReadStore (its packed words, 128 bit
+ *          MurmurHash3), sends each distinct hash with its local multiplicity to the rank that owns it, and gets back
+ *          a weight per read:  the total multiplicity of its sequence for 1 copy over all ranks, 0 for the others.
+ *          Index::build_deduped counts the k-mers of the copies with weight > 0, each with the weight as count.
+ *
+ *          the store holds the reads as trimmed to the rank's valid range, so a read split by a partition boundary
+ *          is 2 sequences, which match only the same pieces of other reads.  the counts are exact either way, since
+ *          identical sequences generate identical k-mers.  a 128 bit hash collision would merge 2 different
+ *          sequences;  at 2^-64 per pair for 10^9 reads, that is not guarded against.
+ */
+#ifndef READ_DEDUP_HPP_
+#define READ_DEDUP_HPP_
+
+#include <vector>
+#include <utility>      // pair
+#include <algorithm>    // sort
+#include <numeric>      // iota
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+
+#include "io/packed_read_store.hpp"
+#include "index/kmer_hash.hpp"   // MurmurHash3
+
+namespace bliss
+{
+  namespace index
+  {
+
+    /// 128 bit hash of a read, as (h[0], h[1]).
+    typedef ::std::pair<uint64_t, uint64_t> read_hash_type;
+
+    /**
+     * @brief  128 bit hash of the packed sequence i of the arena.
+     * @details the tail of the last word is 0, so the words and the length determine the sequence.
+     */
+    template <typename Arena>
+    read_hash_type hash_read(Arena const & arena, size_t const & i) {
+      size_t nbytes = ((arena[i].length + Arena::padtraits::chars_per_word - 1) / Arena::padtraits::chars_per_word) *
+          sizeof(typename Arena::const_iterator::value_type);
+      uint64_t h[2] = {0, 0};
+      // length as seed, so that sequences of 0 characters at the tail differ.
+      MurmurHash3_x64_128(nbytes == 0 ? nullptr : &(*(arena.begin(i))), static_cast<int>(nbytes),
+                          static_cast<uint32_t>(arena[i].length * 0x9E3779B1UL), h);
+      return read_hash_type(h[0], h[1]);
+    }
+
+    /**
+     * @brief  weight of each read of the store after removing exact duplicates over all ranks.  collective.
+     * @details of each set of identical reads, the one on the lowest rank (and first on that rank) gets the number of
+     *          reads in the set, the others 0.  the weights sum to store.size() over all ranks.
+     * @param distinct  output, number of reads with weight > 0 on this rank.
+     */
+    template <typename ALPHABET>
+    ::std::vector<size_t> dedup_reads(::bliss::io::PackedReadStore<ALPHABET> const & store,
+                                      ::mxx::comm const & comm, size_t & distinct) {
+      auto const & arena = store.get_arena();
+      size_t n = store.size();
+      int p = comm.size();
+
+      // local duplicates first:  the reads in hash order, then one entry per distinct hash.
+      ::std::vector<read_hash_type> hashes(n);
+      for (size_t i = 0; i < n; ++i) hashes[i] = hash_read(arena, i);
+      ::std::vector<size_t> order(n);
+      ::std::iota(order.begin(), order.end(), 0);
+      ::std::sort(order.begin(), order.end(), [&hashes](size_t const & x, size_t const & y) {
+        return (hashes[x] < hashes[y]) || ((hashes[x] == hashes[y]) && (x < y));
+      });
+
+      // representative (first read) and multiplicity of each distinct local hash, bucketed by owner rank.
+      ::std::vector<size_t> reps;
+      ::std::vector<size_t> mults;
+      for (size_t j = 0; j < n; ++j) {
+        if ((j == 0) || (hashes[order[j]] != hashes[order[j - 1]])) {
+          reps.emplace_back(order[j]);
+          mults.emplace_back(1);
+        } else {
+          ++(mults.back());
+        }
+      }
+      size_t m = reps.size();
+      ::std::vector<size_t> send_counts(p, 0);
+      for (size_t j = 0; j < m; ++j) ++send_counts[hashes[reps[j]].second % p];
+      ::std::vector<size_t> offsets(p, 0);
+      for (int r = 1; r < p; ++r) offsets[r] = offsets[r - 1] + send_counts[r - 1];
+      ::std::vector<read_hash_type> send_hashes(m);
+      ::std::vector<size_t> send_mults(m);
+      ::std::vector<size_t> send_reps(m);   // local read of each sent entry, for the replies.
+      for (size_t j = 0; j < m; ++j) {
+        size_t pos = offsets[hashes[reps[j]].second % p]++;
+        send_hashes[pos] = hashes[reps[j]];
+        send_mults[pos] = mults[j];
+        send_reps[pos] = reps[j];
+      }
+      ::std::vector<read_hash_type>().swap(hashes);
+
+      // owners total the multiplicities.  received entries are in source rank order.
+      ::std::vector<size_t> recv_counts = ::mxx::all2all(send_counts, comm);
+      ::std::vector<read_hash_type> recv_hashes = ::mxx::all2allv(send_hashes, send_counts, comm);
+      ::std::vector<size_t> recv_mults = ::mxx::all2allv(send_mults, send_counts, comm);
+
+      size_t nr = recv_hashes.size();
+      ::std::vector<size_t> rorder(nr);
+      ::std::iota(rorder.begin(), rorder.end(), 0);
+      // stable, so the first of a hash is from the lowest rank.
+      ::std::stable_sort(rorder.begin(), rorder.end(), [&recv_hashes](size_t const & x, size_t const & y) {
+        return recv_hashes[x] < recv_hashes[y];
+      });
+      ::std::vector<size_t> replies(nr, 0);
+      for (size_t j = 0; j < nr; ) {
+        size_t e = j + 1;
+        size_t total = recv_mults[rorder[j]];
+        while ((e < nr) && (recv_hashes[rorder[e]] == recv_hashes[rorder[j]])) total += recv_mults[rorder[e++]];
+        replies[rorder[j]] = total;
+        j = e;
+      }
+      ::std::vector<read_hash_type>().swap(recv_hashes);
+
+      // one reply per entry, so the return counts are the receive counts.
+      replies = ::mxx::all2allv(replies, recv_counts, comm);
+
+      ::std::vector<size_t> weights(n, 0);
+      distinct = 0;
+      for (size_t j = 0; j < m; ++j) {
+        weights[send_reps[j]] = replies[j];
+        if (replies[j] > 0) ++distinct;
+      }
+      return weights;
+    }
+
+  } // namespace index
+} // namespace bliss
+
+#endif /* READ_DEDUP_HPP_ */
@@ -0,0 +1,371 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    spectrum_corrector.hpp
+ * @ingroup bliss::index
+ * @author  tpan
+ * @brief   k-mer spectrum read error correction against a distributed count index, in place in a PackedReadStore.
+ * @details a k-mer is solid if its count is at least a threshold, else weak.  a substitution error at read position e
+ *          makes the k-mers covering e weak, so the first weak k-mer after a solid one has the error at its last base,
+ *          and the last weak k-mer of a weak prefix has it at its first base.  SpectrumCorrector::correct, in rounds:
+ *            1. counts the k-mers of the active reads.
+ *            2. picks one weak k-mer per read as above, and generates its Hamming distance 1 neighbours at the error
+ *               position (3), or at every position (3k) if the read has no solid k-mer.
+ *            3. counts the neighbours, and applies the substitution of the only solid neighbour.
+ *          reads with a correction stay active for the next round, which checks the correction and the next weak
+ *          region.  the others are done.
+ *
+ *          all reads of a rank are processed together, in batches of at most batch_kmers k-mers, so each batch is 2
+ *          collective queries.  the queries are deduplicated locally (see map_base::fanout_dedup) and answered with
+ *          find_aligned, i.e. one routed all2allv each way.  the ranks agree on the number of batches per round.
+ *
+ *          the index has to have a find_aligned, e.g. a CountIndex over counting_densehash_map, and DNA k-mers:  the
+ *          neighbours are generated by XOR with 1, 2 and 3, which gives the other 3 bases of a 2 bit code.
+ *          a read with 2 errors within k bases is usually left uncorrected, as no single substitution makes the pivot
+ *          solid.
+ */
+#ifndef SPECTRUM_CORRECTOR_HPP_
+#define SPECTRUM_CORRECTOR_HPP_
+
+#include <vector>
+#include <algorithm>    // max
+#include <type_traits>
+#include <utility>      // declval
+
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
+
+#include "common/alphabets.hpp"
+#include "utils/cpu_features.hpp"
+#include "utils/benchmark_utils.hpp"
+#include "io/packed_read_store.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX2__) || defined(BLISS_SIMD_DISPATCH_X86)
+#define BLISS_HAMMING_AVX2
+#endif
+
+namespace bliss
+{
+namespace index
+{
+namespace kmer
+{
+
+  namespace detail {
+
+#if defined(BLISS_HAMMING_AVX2)
+    /// out[i] = x ^ masks[i], 4 words at a time.  returns the number of words done.
+    BLISS_TARGET("avx2")
+    inline size_t xor_broadcast_avx2(uint64_t const & x, void const * masks, void * out, size_t const & n) {
+      __m256i v = _mm256_set1_epi64x(static_cast<long long>(x));
+      __m256i const * m = reinterpret_cast<__m256i const *>(masks);
+      __m256i * o = reinterpret_cast<__m256i *>(out);
+      size_t i = 0;
+      for (; (i + 4) <= n; i += 4, ++m, ++o) {
+        _mm256_storeu_si256(o, _mm256_xor_si256(v, _mm256_loadu_si256(m)));
+      }
+      return i;
+    }
+#endif
+
+  } // namespace detail
+
+
+  /**
+   * @brief  Hamming distance 1 neighbours of DNA k-mers, as XOR with precomputed masks.
+   * @details  single 64 bit word k-mers are generated 4 at a time with AVX2 (runtime dispatched as in cpu_features.hpp).
+   */
+  template <typename KmerType>
+  class HammingNeighbors {
+      static_assert(::std::is_same<typename KmerType::KmerAlphabet, ::bliss::common::DNA>::value,
+                    "HammingNeighbors requires DNA k-mers");
+
+    protected:
+      using WordType = typename KmerType::KmerWordType;
+
+      /// masks[3 * p + d - 1]:  value d at window position p, 0 elsewhere.
+      ::std::vector<KmerType> masks;
+
+    public:
+      HammingNeighbors() : masks(3 * KmerType::size) {
+        for (unsigned int p = 0; p < KmerType::size; ++p) {
+          for (unsigned char d = 1; d < 4; ++d) {
+            KmerType m;
+            // the first character shifted in ends up at window position 0.
+            for (unsigned int q = 0; q < KmerType::size; ++q) m.nextFromChar((q == p) ? d : 0);
+            masks[3 * p + d - 1] = m;
+          }
+        }
+      }
+
+      /**
+       * @brief  append the 3 substitutions at each window position in [first, last) of km to out.
+       * @details  neighbour 3 * (p - first) + d - 1 has base c ^ d at position p, where c is the base of km.
+       */
+      void generate(KmerType const & km, size_t const & first, size_t const & last, ::std::vector<KmerType> & out) const {
+        size_t n = 3 * (last - first);
+        size_t start = out.size();
+        out.resize(start + n);
+        KmerType const * m = masks.data() + 3 * first;
+        KmerType * o = out.data() + start;
+
+        size_t i = 0;
+#if defined(BLISS_HAMMING_AVX2)
+        if ((KmerType::nWords == 1) && (sizeof(WordType) == sizeof(uint64_t)) && (sizeof(KmerType) == sizeof(uint64_t)) &&
+            ::bliss::utils::cpu::has_avx2()) {
+          i = detail::xor_broadcast_avx2(static_cast<uint64_t>(km.getData()[0]), m, o, n);
+        }
+#endif
+        for (; i < n; ++i) {
+          for (unsigned int w = 0; w < KmerType::nWords; ++w) {
+            o[i].getDataRef()[w] = km.getData()[w] ^ m[i].getData()[w];
+          }
+        }
+      }
+  };
+
+
+  /**
+   * @brief  corrects substitution errors in reads against the k-mer counts of an index.  see file description.
+   * @tparam Index  index with find_aligned, e.g. CountIndex<counting_densehash_map<...> >.
+   */
+  template <typename Index>
+  class SpectrumCorrector {
+    public:
+      using KmerType = typename Index::KmerType;
+      using CountType = typename Index::ValueType;
+      using MapType = typename ::std::decay<decltype(::std::declval<Index const &>().get_map())>::type;
+
+      /// local counters of a correct call.
+      struct stats {
+          /// reads with at least 1 k-mer
+          size_t reads = 0;
+          /// reads with only solid k-mers at the start
+          size_t solid = 0;
+          /// reads with at least 1 correction
+          size_t corrected = 0;
+          /// substitutions applied
+          size_t corrections = 0;
+          /// reads left with weak k-mers:  no single solid neighbour, or the per read limit reached.
+          size_t unresolved = 0;
+          /// rounds run, same on all ranks
+          size_t rounds = 0;
+      };
+
+    protected:
+      Index const & index;
+
+      /// smallest count of a solid k-mer
+      CountType solid_count;
+
+      size_t max_rounds;
+
+      /// most substitutions per read, over all rounds.
+      size_t max_per_read;
+
+      /// most k-mers per batch of reads, and so per query.
+      size_t batch_kmers;
+
+      HammingNeighbors<KmerType> neighbors;
+
+      /// count of each k-mer, in order.  duplicates are sent once.  collective.
+      ::std::vector<CountType> counts_of(::std::vector<KmerType> const & kmers) const {
+        typename MapType::query_fanout_type fan;
+        ::std::vector<KmerType> unique;
+        index.get_map().fanout_dedup(kmers, fan, unique);
+        return fan.scatter_aligned(index.get_map().find_aligned(unique, CountType(0)));
+      }
+
+      /// the reads [first, last) of reads:  check, and correct 1 error each where possible.  collective.
+      template <typename Alphabet>
+      void correct_batch(::bliss::io::PackedReadStore<Alphabet> & store, ::std::vector<size_t> const & reads,
+                         size_t const & first, size_t const & last, bool const & initial,
+                         ::std::vector<size_t> & fixes, ::std::vector<size_t> & next, stats & st) const {
+        auto const & arena = store.get_arena();
+        BL_BENCH_INIT(correct);
+
+        // 1. k-mers of the reads, and their counts.
+        BL_BENCH_START(correct);
+        ::std::vector<size_t> offsets(1, 0);
+        ::std::vector<KmerType> kmers;
+        for (size_t r = first; r < last; ++r) {
+          auto end = arena.template kmer_end<KmerType>(reads[r]);
+          for (auto it = arena.template kmer_begin<KmerType>(reads[r]); it != end; ++it) kmers.emplace_back(*it);
+          offsets.emplace_back(kmers.size());
+        }
+        BL_BENCH_END(correct, "kmers", kmers.size());
+
+        BL_BENCH_COLLECTIVE_START(correct, "count_kmers", index.get_map().get_comm());
+        ::std::vector<CountType> counts = counts_of(kmers);
+        BL_BENCH_END(correct, "count_kmers", counts.size());
+
+        // 2. one pivot k-mer per read with weak k-mers, and its neighbours at the likely error positions.
+        BL_BENCH_START(correct);
+        ::std::vector<KmerType> cands;
+        // per read in the batch:  first neighbour, read position of the pivot's window start, first window position.
+        ::std::vector<size_t> cand_offsets(1, 0);
+        ::std::vector<size_t> pivots(last - first, 0);
+        ::std::vector<size_t> windows(last - first, 0);
+        for (size_t r = first; r < last; ++r) {
+          size_t b = offsets[r - first], e = offsets[r - first + 1];
+          size_t weak = b;
+          while ((weak < e) && (counts[weak] >= solid_count)) ++weak;
+
+          if (weak == e) {
+            if (initial) ++st.solid;
+          } else if (fixes[reads[r]] >= max_per_read) {
+            ++st.unresolved;
+          } else if (weak > b) {
+            // error at the last base of the first weak k-mer after a solid one.
+            pivots[r - first] = weak - b;
+            windows[r - first] = KmerType::size - 1;
+            neighbors.generate(kmers[weak], KmerType::size - 1, KmerType::size, cands);
+          } else {
+            size_t s = weak;
+            while ((s < e) && (counts[s] < solid_count)) ++s;
+            if (s < e) {
+              // weak prefix:  error at the first base of the last weak k-mer.
+              pivots[r - first] = s - 1 - b;
+              windows[r - first] = 0;
+              neighbors.generate(kmers[s - 1], 0, 1, cands);
+            } else {
+              // no solid k-mer:  all neighbours of the first k-mer.
+              pivots[r - first] = 0;
+              windows[r - first] = 0;
+              neighbors.generate(kmers[b], 0, KmerType::size, cands);
+            }
+          }
+          cand_offsets.emplace_back(cands.size());
+        }
+        ::std::vector<KmerType>().swap(kmers);
+        BL_BENCH_END(correct, "neighbors", cands.size());
+
+        // 3. counts of the neighbours.
+        BL_BENCH_COLLECTIVE_START(correct, "count_neighbors", index.get_map().get_comm());
+        ::std::vector<CountType> cand_counts = counts_of(cands);
+        BL_BENCH_END(correct, "count_neighbors", cand_counts.size());
+
+        // 4. apply the substitution of the only solid neighbour.
+        BL_BENCH_START(correct);
+        size_t applied = 0;
+        for (size_t r = first; r < last; ++r) {
+          size_t b = cand_offsets[r - first], e = cand_offsets[r - first + 1];
+          if (b == e) continue;
+
+          size_t best = e;
+          size_t nsolid = 0;
+          for (size_t c = b; c < e; ++c) {
+            if (cand_counts[c] < solid_count) continue;
+            ++nsolid;
+            best = c;
+          }
+          if (nsolid != 1) {
+            ++st.unresolved;
+            continue;
+          }
+
+          size_t pos = pivots[r - first] + windows[r - first] + (best - b) / 3;
+          uint8_t d = static_cast<uint8_t>((best - b) % 3 + 1);
+          store.set_base(reads[r], pos, arena.get(reads[r], pos) ^ d);
+          ++fixes[reads[r]];
+          ++applied;
+          next.emplace_back(reads[r]);
+        }
+        st.corrections += applied;
+        BL_BENCH_END(correct, "apply", applied);
+
+        BL_BENCH_REPORT_MPI_NAMED(correct, "spectrum_corrector:batch", index.get_map().get_comm());
+      }
+
+    public:
+      /**
+       * @param _index        k-mer counts, e.g. of the reads to correct.
+       * @param _solid_count  smallest count of a solid k-mer.
+       * @param _max_rounds   most rounds, i.e. most substitutions in a read's worst weak region chain.
+       * @param _max_per_read most substitutions per read.
+       * @param _batch_kmers  most k-mers per query batch.
+       */
+      SpectrumCorrector(Index const & _index, CountType const & _solid_count, size_t const & _max_rounds = 8,
+                        size_t const & _max_per_read = 4, size_t const & _batch_kmers = (1UL << 22)) :
+        index(_index), solid_count(_solid_count), max_rounds(_max_rounds), max_per_read(_max_per_read),
+        batch_kmers(::std::max(_batch_kmers, 1UL)) {}
+
+      /**
+       * @brief  correct the reads of store in place.  collective.
+       * @details  reads shorter than k are skipped.  the index is not updated, so the counts stay those of the
+       *           uncorrected reads.
+       */
+      template <typename Alphabet>
+      stats correct(::bliss::io::PackedReadStore<Alphabet> & store) const {
+        static_assert(::std::is_same<Alphabet, typename KmerType::KmerAlphabet>::value,
+                      "store alphabet has to match the k-mer alphabet");
+        ::mxx::comm const & comm = index.get_map().get_comm();
+        auto const & arena = store.get_arena();
+
+        stats st;
+        ::std::vector<size_t> active;
+        for (size_t i = 0; i < store.size(); ++i) {
+          if (arena[i].length >= KmerType::size) active.emplace_back(i);
+        }
+        st.reads = active.size();
+        ::std::vector<size_t> fixes(store.size(), 0);
+
+        for (size_t round = 0; round < max_rounds; ++round) {
+          // batches of consecutive active reads.  a read longer than batch_kmers is a batch by itself.
+          ::std::vector<size_t> bounds(1, 0);
+          size_t nk = 0;
+          for (size_t r = 0; r < active.size(); ++r) {
+            size_t rk = arena[active[r]].length - KmerType::size + 1;
+            if ((nk > 0) && (nk + rk > batch_kmers)) {
+              bounds.emplace_back(r);
+              nk = 0;
+            }
+            nk += rk;
+          }
+          if (!active.empty()) bounds.emplace_back(active.size());
+
+          size_t nb = ::mxx::allreduce(bounds.size() - 1, ::mxx::max<size_t>(), comm);
+          if (nb == 0) break;
+          ++st.rounds;
+
+          ::std::vector<size_t> next;
+          for (size_t b = 0; b < nb; ++b) {
+            size_t first = (b + 1 < bounds.size()) ? bounds[b] : active.size();
+            size_t last = (b + 1 < bounds.size()) ? bounds[b + 1] : active.size();
+            correct_batch(store, active, first, last, (round == 0), fixes, next, st);
+          }
+          active.swap(next);
+        }
+        // corrected in the last round, but not checked again.
+        st.unresolved += active.size();
+
+        for (auto const & f : fixes) {
+          if (f > 0) ++st.corrected;
+        }
+        return st;
+      }
+  };
+
+} // namespace kmer
+} // namespace index
+} // namespace bliss
+
+#endif /* SPECTRUM_CORRECTOR_HPP_ */
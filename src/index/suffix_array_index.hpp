@@ -0,0 +1,388 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    suffix_array_index.hpp
+ * @ingroup bliss::index
+ * @author  tpan
+ * @brief   distributed suffix array of bounded length suffixes, for longest match queries of variable length.
+ * @details every position of the packed reads contributes its suffix, truncated to L = KmerType::size characters.
+ *          a suffix is stored as a k-mer, left aligned (first character in the most significant bits) and zero
+ *          padded, with its length.  comparing (k-mer, length) is then the lexicographic order of the strings, so
+ *          the k-mer windows of a read and the shorter suffixes at its end sort together.
+ *
+ *          the suffixes are sorted with imxx::samplesort, not rebalanced.  each rank keeps its sorted block and the
+ *          first suffix of every rank, which routes queries.  find_longest_match takes two all2allv rounds:
+ *
+ *            1. the rank holding a query's insertion point returns the longest common prefix with its two neighbours,
+ *               which is the longest match anywhere in the array.
+ *            2. the ranks whose blocks may hold suffixes starting with that prefix count them.
+ *
+ *          a query longer than L is matched on its first L characters.  for the matching statistics of a read, issue
+ *          one query per read position.
+ */
+#ifndef SUFFIX_ARRAY_INDEX_HPP_
+#define SUFFIX_ARRAY_INDEX_HPP_
+
+#include <cstdint>
+#include <vector>
+#include <utility>      // pair
+#include <algorithm>    // lower_bound, max
+#include <stdexcept>
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+#include <mxx/reduction.hpp>
+
+#include "utils/benchmark_utils.hpp"
+#include "io/mxx_support.hpp"
+#include "io/incremental_mxx.hpp"
+#include "io/packed_read_store.hpp"
+
+namespace bliss
+{
+namespace index
+{
+namespace kmer
+{
+
+  /**
+   * @brief   suffix array of the suffixes of the reads, truncated to KmerType::size characters.
+   * @tparam KmerType   holds a suffix.  its size is the longest match reported.
+   */
+  template <typename KmerType>
+  class SuffixArrayIndex {
+    public:
+      using Alphabet = typename KmerType::KmerAlphabet;
+
+      /// a string of up to L characters:  left aligned and zero padded in the k-mer, and its length.
+      using query_type = ::std::pair<KmerType, uint32_t>;
+      /// a suffix, and the source position of its first character.
+      using suffix_type = ::std::pair<query_type, uint64_t>;
+
+      static constexpr uint32_t L = KmerType::size;
+
+      struct longest_match {
+          /// number of leading query characters that occur in the reads.  0 if not even the first one does.
+          uint32_t length;
+          /// number of suffixes starting with them.  0 if length is 0.
+          uint64_t count;
+          /// source position of the first of those suffixes in sorted order.
+          uint64_t pos;
+      };
+
+      /// (k-mer, length) order, i.e. lexicographic.
+      struct query_less {
+          bool operator()(query_type const & x, query_type const & y) const {
+            return (x.first < y.first) || ((x.first == y.first) && (x.second < y.second));
+          }
+          bool operator()(suffix_type const & x, query_type const & y) const {
+            return (*this)(x.first, y);
+          }
+      };
+
+      /// lexicographic, then by position.
+      struct suffix_less {
+          bool operator()(suffix_type const & x, suffix_type const & y) const {
+            query_less ql;
+            return ql(x.first, y.first) || (!ql(y.first, x.first) && (x.second < y.second));
+          }
+      };
+
+    protected:
+      mxx::comm const & comm;
+
+      /// sorted suffixes of this rank
+      ::std::vector<suffix_type> suffixes;
+
+      /// first suffix of each rank that has any, and that rank.
+      ::std::vector<query_type> firsts;
+      ::std::vector<int> first_ranks;
+
+      /// index in firsts of the next rank with suffixes.  firsts.size() if there is none.
+      size_t next_first;
+
+      size_t global_size;
+
+      /// character i (0 is the first) of a left aligned string.
+      static uint8_t char_at(KmerType const & k, uint32_t const & i) {
+        return static_cast<uint8_t>(k.getCharsAtPos(L - 1 - i, 1));
+      }
+
+      static uint32_t lcp(query_type const & x, query_type const & y) {
+        uint32_t n = ::std::min(x.second, y.second);
+        uint32_t i = 0;
+        while ((i < n) && (char_at(x.first, i) == char_at(y.first, i))) ++i;
+        return i;
+      }
+
+      /// first m characters, right aligned.  compares as the m character prefixes.
+      static KmerType prefix(KmerType const & k, uint32_t const & m) {
+        return (m == 0) ? KmerType() : (k >> (L - m));
+      }
+
+      /// rank holding the insertion point of q, i.e. the last rank whose first suffix is less than q.
+      size_t route(query_type const & q) const {
+        size_t i = ::std::lower_bound(firsts.begin(), firsts.end(), q, query_less()) - firsts.begin();
+        return (i > 0) ? i - 1 : 0;
+      }
+
+      /// longest common prefix of q with the local suffixes next to its insertion point.
+      uint32_t local_lcp(query_type const & q) const {
+        auto it = ::std::lower_bound(suffixes.begin(), suffixes.end(), q, query_less());
+        uint32_t m = 0;
+        if (it != suffixes.begin()) m = lcp(q, (it - 1)->first);
+        if (it != suffixes.end()) m = ::std::max(m, lcp(q, it->first));
+        else if (next_first < firsts.size()) m = ::std::max(m, lcp(q, firsts[next_first]));
+        return m;
+      }
+
+      /// (number, first position) of the local suffixes that start with the q.second characters of q.
+      ::std::pair<uint64_t, uint64_t> local_count(query_type const & q) const {
+        // padded suffixes shorter than q sort first among those with the same padded prefix.
+        auto lo = ::std::lower_bound(suffixes.begin(), suffixes.end(), q, query_less());
+        KmerType p = prefix(q.first, q.second);
+        auto hi = ::std::upper_bound(lo, suffixes.end(), p, [&q](KmerType const & x, suffix_type const & y) {
+          return x < prefix(y.first.first, q.second);
+        });
+        return ::std::pair<uint64_t, uint64_t>(hi - lo, (hi == lo) ? 0 : lo->second);
+      }
+
+      /**
+       * @brief send each request to its destination rank, and return the answers in request order.  collective.
+       * @param answer   computes the reply to a request on the destination rank.
+       */
+      template <typename Reply, typename Request, typename Answer>
+      ::std::vector<Reply> request(::std::vector<Request> const & reqs, ::std::vector<int> const & dest,
+                                   Answer const & answer) const {
+        ::std::vector<Reply> replies(reqs.size());
+        if (comm.size() == 1) {
+          for (size_t i = 0; i < reqs.size(); ++i) replies[i] = answer(reqs[i]);
+          return replies;
+        }
+
+        // group by destination.
+        ::std::vector<size_t> send_counts(comm.size(), 0);
+        for (auto const & d : dest) ++send_counts[d];
+        ::std::vector<size_t> offsets(comm.size(), 0);
+        for (int r = 1; r < comm.size(); ++r) offsets[r] = offsets[r - 1] + send_counts[r - 1];
+
+        ::std::vector<size_t> perm(reqs.size());
+        ::std::vector<Request> remote(reqs.size());
+        for (size_t i = 0; i < reqs.size(); ++i) {
+          perm[i] = offsets[dest[i]]++;
+          remote[perm[i]] = reqs[i];
+        }
+
+        ::std::vector<size_t> recv_counts = ::mxx::all2all(send_counts, comm);
+        ::mxx::all2allv(remote, send_counts, comm).swap(remote);
+
+        ::std::vector<Reply> answers;
+        answers.reserve(remote.size());
+        for (auto const & x : remote) answers.emplace_back(answer(x));
+        // one reply per request, so the return counts are the request counts reversed.
+        ::mxx::all2allv(answers, recv_counts, comm).swap(answers);
+
+        for (size_t i = 0; i < reqs.size(); ++i) replies[i] = answers[perm[i]];
+        return replies;
+      }
+
+    public:
+      SuffixArrayIndex(mxx::comm const & _comm) : comm(_comm), next_first(0), global_size(0) {}
+
+      virtual ~SuffixArrayIndex() {};
+
+      /// query from the ASCII string [begin, end).  only the first L characters are used.
+      template <typename Iter>
+      static query_type make_query(Iter begin, Iter end) {
+        KmerType k;
+        uint32_t n = 0;
+        for (; (begin != end) && (n < L); ++begin, ++n) {
+          k.nextFromChar(Alphabet::FROM_ASCII[static_cast<unsigned char>(*begin)]);
+        }
+        if ((n > 0) && (n < L)) k <<= (L - n);
+        return query_type(k, n);
+      }
+
+      /**
+       * @brief  sort the given suffixes into the index.  collective.
+       * @details a second build replaces the index.
+       */
+      void build(::std::vector<suffix_type> & input) {
+        BL_BENCH_INIT(build);
+
+        BL_BENCH_START(build);
+        suffixes.clear();
+        ::imxx::samplesort<false>(input, suffixes, suffix_less(), comm);
+        BL_BENCH_END(build, "sort", suffixes.size());
+
+        BL_BENCH_START(build);
+        // length 0 marks a rank without suffixes.
+        query_type first = suffixes.empty() ? query_type(KmerType(), 0) : suffixes.front().first;
+        ::std::vector<query_type> all_firsts(1, first);
+        global_size = suffixes.size();
+        if (comm.size() > 1) {
+          all_firsts = ::mxx::allgather(first, comm);
+          global_size = ::mxx::allreduce(global_size, comm);
+        }
+
+        firsts.clear();
+        first_ranks.clear();
+        next_first = 0;
+        for (int r = 0; r < static_cast<int>(all_firsts.size()); ++r) {
+          if (all_firsts[r].second == 0) continue;
+          if (r <= comm.rank()) next_first = firsts.size() + 1;
+          firsts.emplace_back(all_firsts[r]);
+          first_ranks.emplace_back(r);
+        }
+        BL_BENCH_END(build, "firsts", firsts.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(build, "index:suffix_array_build", comm);
+      }
+
+      /**
+       * @brief  index the suffixes of the reads in store, e.g. from KmerFileHelper::read_file_to_store.  collective.
+       * @details reads shorter than L have been dropped by the readers.
+       * @param last_read_cut  the last read of the store may continue on the next rank, as when a FASTA or .2bit
+       *                       partition ends in the middle of a sequence.  its suffixes shorter than L are left out,
+       *                       as they may not end at the end of the sequence.
+       */
+      void build(::bliss::io::PackedReadStore<Alphabet> const & store, bool const & last_read_cut) {
+        if ((store.size() > 0) && (store.kmer_size() != L))
+          throw ::std::invalid_argument("SuffixArrayIndex: reads were trimmed for a different k-mer size.");
+
+        auto const & arena = store.get_arena();
+        ::std::vector<suffix_type> input;
+        input.reserve(arena.chars());
+
+        for (size_t i = 0; i < arena.size(); ++i) {
+          size_t len = arena[i].length;
+          if (len == 0) continue;
+
+          // longest suffix at the end of the read, at position b.
+          uint32_t w = (len < L) ? len : L;
+          size_t b = len - w;
+          KmerType t;
+          if (len < L) {
+            for (size_t j = 0; j < len; ++j) t.nextFromChar(arena.get(i, j));
+            t <<= (L - w);
+            input.emplace_back(query_type(t, w), arena.source_offset(i, b));
+          } else {
+            auto end = arena.template kmer_end<KmerType>(i);
+            size_t j = 0;
+            for (auto it = arena.template kmer_begin<KmerType>(i); it != end; ++it, ++j) {
+              t = *it;
+              input.emplace_back(query_type(t, L), arena.source_offset(i, j));
+            }
+          }
+
+          if (last_read_cut && (i + 1 == arena.size())) continue;
+          for (uint32_t s = 1; s < w; ++s) {
+            t <<= 1;
+            input.emplace_back(query_type(t, w - s), arena.source_offset(i, b + s));
+          }
+        }
+
+        this->build(input);
+      }
+
+      /// index the reads in store.  the last read of every rank but the last may be cut.  collective.
+      void build(::bliss::io::PackedReadStore<Alphabet> const & store) {
+        this->build(store, comm.rank() + 1 < comm.size());
+      }
+
+      /**
+       * @brief  longest prefix of each query that occurs in the reads, and where.  collective.
+       * @return one longest_match per query, in query order.
+       */
+      ::std::vector<longest_match> find_longest_match(::std::vector<query_type> const & queries) const {
+        longest_match none = {0, 0, 0};
+        ::std::vector<longest_match> results(queries.size(), none);
+        if (firsts.empty()) return results;
+
+        BL_BENCH_INIT(find);
+
+        // 1. longest match length, from the rank of the insertion point.
+        BL_BENCH_START(find);
+        ::std::vector<int> dest(queries.size());
+        for (size_t i = 0; i < queries.size(); ++i) dest[i] = first_ranks[route(queries[i])];
+        ::std::vector<uint32_t> lengths = request<uint32_t>(queries, dest, [this](query_type const & q) {
+          return local_lcp(q);
+        });
+        BL_BENCH_END(find, "length", queries.size());
+
+        // 2. count the matched prefix on every rank whose block may hold it.
+        BL_BENCH_START(find);
+        ::std::vector<query_type> prefixes;
+        ::std::vector<size_t> owner;
+        dest.clear();
+        for (size_t i = 0; i < queries.size(); ++i) {
+          uint32_t m = lengths[i];
+          if (m == 0) continue;
+          query_type p(prefix(queries[i].first, m) << (L - m), m);
+          KmerType pk = prefix(p.first, m);
+          size_t lo = route(p);
+          size_t hi = ::std::upper_bound(firsts.begin(), firsts.end(), pk, [m](KmerType const & x, query_type const & y) {
+            return x < prefix(y.first, m);
+          }) - firsts.begin();
+          for (size_t r = lo; r < ::std::max(hi, lo + 1); ++r) {
+            prefixes.emplace_back(p);
+            owner.emplace_back(i);
+            dest.emplace_back(first_ranks[r]);
+          }
+        }
+        ::std::vector<::std::pair<uint64_t, uint64_t> > counts =
+            request<::std::pair<uint64_t, uint64_t> >(prefixes, dest, [this](query_type const & q) {
+          return local_count(q);
+        });
+
+        // requests of a query are in rank order, so the first nonzero count has the first position.
+        for (size_t j = 0; j < counts.size(); ++j) {
+          longest_match & res = results[owner[j]];
+          res.length = lengths[owner[j]];
+          if ((res.count == 0) && (counts[j].first > 0)) res.pos = counts[j].second;
+          res.count += counts[j].first;
+        }
+        BL_BENCH_END(find, "count", prefixes.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(find, "index:suffix_array_find", comm);
+
+        return results;
+      }
+
+      /// global number of suffixes.
+      size_t size() const {
+        return global_size;
+      }
+
+      size_t local_size() const {
+        return suffixes.size();
+      }
+
+      /// the sorted suffixes of this rank.
+      ::std::vector<suffix_type> const & get_local() const {
+        return suffixes;
+      }
+  };
+
+  template <typename KmerType>
+  constexpr uint32_t SuffixArrayIndex<KmerType>::L;
+
+} // namespace kmer
+} // namespace index
+} // namespace bliss
+
+#endif /* SUFFIX_ARRAY_INDEX_HPP_ */
@@ -0,0 +1,510 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    taxonomy_index.hpp
+ * @ingroup bliss::index
+ * @author  tpan
+ * @brief   taxonomic classification of reads by the lowest common ancestors (LCA) of reference k-mers, as in Kraken.
+ * @details Taxonomy is a compact copy of the taxonomy tree, replicated on every rank.  nodes are renumbered 1..n in
+ *          preorder, so the subtree of v is the id range [v, last(v)], and an ancestor test is 2 comparisons.  id 0 is
+ *          "no taxon".
+ *
+ *          TaxonomyIndex stores 1 taxon per reference k-mer in a reduction_densehash_map whose reduction is TaxonLCA:
+ *          a k-mer inserted with different taxa, from any references on any ranks, keeps their LCA.
+ *
+ *          classify queries the k-mers of a block of reads with 1 deduplicated find_aligned, so the answers come back
+ *          in read order, and then scores each read locally as Kraken does:  the score of a hit taxon is the number of
+ *          hits on its root-to-leaf (RTL) path, the read gets the taxon with the highest score (the LCA of ties), and
+ *          with a confidence c > 0 the call moves up the tree until at least c of the read's k-mers hit its clade, as
+ *          in Kraken 2.  a read's distinct hit taxa are kept as flat arrays, and the RTL and clade sums are branchless
+ *          loops over them that the compiler vectorizes.
+ */
+#ifndef TAXONOMY_INDEX_HPP_
+#define TAXONOMY_INDEX_HPP_
+
+#include <cstdint>
+#include <cmath>        // ceil
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+#include <type_traits>
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+#include <mxx/reduction.hpp>
+
+#include "utils/benchmark_utils.hpp"
+#include "io/packed_read_store.hpp"
+
+namespace bliss
+{
+namespace index
+{
+namespace kmer
+{
+
+  /**
+   * @brief  taxonomy tree with preorder compact ids, for LCA and ancestor queries.
+   * @details  taxa are given by their external ids, e.g. NCBI taxids, and mapped to compact ids 1..n.
+   */
+  class Taxonomy {
+    public:
+      using taxon_type = uint32_t;
+
+    protected:
+      /// by compact id.  entry 0 is "no taxon".  the root's parent is 0.
+      ::std::vector<taxon_type> parent;
+      /// last compact id in the subtree.
+      ::std::vector<taxon_type> last;
+      ::std::vector<uint32_t> depth;
+      ::std::vector<taxon_type> external;
+
+      /// (external id, compact id), sorted by external id.
+      ::std::vector<::std::pair<taxon_type, taxon_type> > lookup;
+
+    public:
+      Taxonomy() : parent(1, 0), last(1, 0), depth(1, 0), external(1, 0) {}
+
+      /**
+       * @brief  build from (taxon, parent) pairs of external ids.
+       * @details  the root is its own parent, or has parent 0, and there has to be exactly 1.  every parent has to
+       *           be listed as a taxon as well.  duplicate pairs are allowed.
+       */
+      explicit Taxonomy(::std::vector<::std::pair<taxon_type, taxon_type> > const & nodes) {
+        ::std::vector<::std::pair<taxon_type, taxon_type> > edges(nodes);
+        ::std::sort(edges.begin(), edges.end());
+        edges.erase(::std::unique(edges.begin(), edges.end()), edges.end());
+        for (size_t i = 1; i < edges.size(); ++i) {
+          if (edges[i].first == edges[i - 1].first)
+            throw ::std::invalid_argument("Taxonomy: taxon " + ::std::to_string(edges[i].first) + " has 2 parents.");
+        }
+        if (edges.empty()) throw ::std::invalid_argument("Taxonomy: no taxa.");
+        size_t n = edges.size();
+
+        // position in edges of an external id.
+        auto position = [&edges](taxon_type const & t) -> size_t {
+          auto it = ::std::lower_bound(edges.begin(), edges.end(), ::std::make_pair(t, static_cast<taxon_type>(0)));
+          return ((it == edges.end()) || (it->first != t)) ? edges.size() : ::std::distance(edges.begin(), it);
+        };
+
+        // children, CSR.
+        size_t root = n;
+        ::std::vector<size_t> up(n);
+        ::std::vector<size_t> offsets(n + 1, 0);
+        for (size_t i = 0; i < n; ++i) {
+          if ((edges[i].second == edges[i].first) || (edges[i].second == 0)) {
+            if (root < n) throw ::std::invalid_argument("Taxonomy: more than 1 root.");
+            root = i;
+            up[i] = n;
+            continue;
+          }
+          up[i] = position(edges[i].second);
+          if (up[i] == n)
+            throw ::std::invalid_argument("Taxonomy: parent " + ::std::to_string(edges[i].second) + " is not a taxon.");
+          ++offsets[up[i] + 1];
+        }
+        if (root == n) throw ::std::invalid_argument("Taxonomy: no root.");
+        for (size_t i = 0; i < n; ++i) offsets[i + 1] += offsets[i];
+        ::std::vector<size_t> children(n);
+        ::std::vector<size_t> pos(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < n; ++i) {
+          if (i != root) children[pos[up[i]]++] = i;
+        }
+
+        // preorder.  a node's whole subtree is popped before anything below it on the stack.
+        parent.assign(n + 1, 0);
+        depth.assign(n + 1, 0);
+        external.assign(n + 1, 0);
+        ::std::vector<taxon_type> id(n, 0);
+        ::std::vector<size_t> stack(1, root);
+        taxon_type next = 1;
+        while (!stack.empty()) {
+          size_t i = stack.back();
+          stack.pop_back();
+          id[i] = next++;
+          external[id[i]] = edges[i].first;
+          if (i != root) {
+            parent[id[i]] = id[up[i]];
+            depth[id[i]] = depth[parent[id[i]]] + 1;
+          }
+          for (size_t c = offsets[i + 1]; c > offsets[i]; --c) stack.emplace_back(children[c - 1]);
+        }
+        if (next != n + 1) throw ::std::invalid_argument("Taxonomy: taxa not connected to the root, i.e. a cycle.");
+
+        // subtree sizes, children before parents.
+        ::std::vector<taxon_type> sizes(n + 1, 1);
+        for (taxon_type v = n; v > 1; --v) sizes[parent[v]] += sizes[v];
+        last.assign(n + 1, 0);
+        for (taxon_type v = 1; v <= n; ++v) last[v] = v + sizes[v] - 1;
+
+        lookup.reserve(n);
+        for (size_t i = 0; i < n; ++i) lookup.emplace_back(edges[i].first, id[i]);
+      }
+
+      /// build from the (taxon, parent) pairs given on all ranks.  collective.
+      static Taxonomy build(::std::vector<::std::pair<taxon_type, taxon_type> > const & nodes, ::mxx::comm const & comm) {
+        return Taxonomy(::mxx::allgatherv(nodes, comm));
+      }
+
+      /// (taxon, parent) pairs of an NCBI taxonomy nodes.dmp file:  "taxid\t|\tparent\t|\t...".
+      static ::std::vector<::std::pair<taxon_type, taxon_type> > read_ncbi_nodes(::std::string const & filename) {
+        ::std::ifstream ifs(filename);
+        if (!ifs.is_open()) throw ::std::invalid_argument("Taxonomy: cannot open " + filename);
+
+        ::std::vector<::std::pair<taxon_type, taxon_type> > nodes;
+        ::std::string line;
+        while (::std::getline(ifs, line)) {
+          if (line.empty()) continue;
+          ::std::istringstream ss(line);
+          taxon_type t, p;
+          char bar;
+          if (!(ss >> t >> bar >> p) || (bar != '|'))
+            throw ::std::invalid_argument("Taxonomy: malformed line in " + filename + ": " + line);
+          nodes.emplace_back(t, p);
+        }
+        return nodes;
+      }
+
+      /// number of taxa
+      size_t size() const {
+        return parent.size() - 1;
+      }
+
+      /// compact id of an external id.  0 if not a taxon.
+      taxon_type compact(taxon_type const & ext) const {
+        auto it = ::std::lower_bound(lookup.begin(), lookup.end(), ::std::make_pair(ext, static_cast<taxon_type>(0)));
+        return ((it == lookup.end()) || (it->first != ext)) ? 0 : it->second;
+      }
+
+      /// external id of a compact id.  0 for 0.
+      taxon_type external_id(taxon_type const & v) const {
+        return external[v];
+      }
+
+      taxon_type get_parent(taxon_type const & v) const {
+        return parent[v];
+      }
+
+      uint32_t get_depth(taxon_type const & v) const {
+        return depth[v];
+      }
+
+      /// the subtree of v is [v, subtree_last(v)].
+      taxon_type subtree_last(taxon_type const & v) const {
+        return last[v];
+      }
+
+      /// true if u is v or an ancestor of v.  u and v are compact ids, not 0.
+      bool is_ancestor(taxon_type const & u, taxon_type const & v) const {
+        return (u <= v) && (v <= last[u]);
+      }
+
+      /// lowest common ancestor of compact ids.  0 is "no taxon", so lca(0, b) == b.
+      taxon_type lca(taxon_type a, taxon_type b) const {
+        if (a == 0) return b;
+        if (b == 0) return a;
+        while (depth[a] > depth[b]) a = parent[a];
+        while (depth[b] > depth[a]) b = parent[b];
+        while (a != b) {
+          a = parent[a];
+          b = parent[b];
+        }
+        return a;
+      }
+  };
+
+
+  /// reduction for reduction_densehash_map:  the LCA of 2 compact taxa.  set taxonomy before inserting.
+  struct TaxonLCA {
+      Taxonomy const * taxonomy = nullptr;
+
+      Taxonomy::taxon_type operator()(Taxonomy::taxon_type const & a, Taxonomy::taxon_type const & b) const {
+        return taxonomy->lca(a, b);
+      }
+  };
+
+
+  /**
+   * @brief  k-mer to taxon index and Kraken style read classification.  see the file comment.
+   * @tparam MapType  reduction_densehash_map with Taxonomy::taxon_type values and TaxonLCA reduction, and DNA k-mers,
+   *                  e.g. with CanonicalHashMapParams so that reads from either strand hit.
+   */
+  template <typename MapType>
+  class TaxonomyIndex {
+    public:
+      using KmerType = typename MapType::key_type;
+      using taxon_type = Taxonomy::taxon_type;
+
+      static_assert(::std::is_same<typename MapType::mapped_type, taxon_type>::value,
+                    "TaxonomyIndex map values have to be Taxonomy::taxon_type");
+
+      /// result for 1 read.
+      struct classification {
+          /// external id of the taxon.  0 if unclassified.
+          taxon_type taxon = 0;
+          /// k-mers of the read that hit the taxon's clade.
+          uint32_t hits = 0;
+          /// k-mers of the read.
+          uint32_t kmers = 0;
+      };
+
+    protected:
+      Taxonomy taxonomy;
+
+      MapType map;
+
+      /// most k-mers per insert or query batch.
+      size_t batch_kmers;
+
+      /// per read scratch:  distinct hit taxa, sorted, their hit counts and subtree ends.
+      struct scratch {
+          ::std::vector<taxon_type> hits;
+          ::std::vector<taxon_type> taxa;
+          ::std::vector<uint32_t> counts;
+          ::std::vector<taxon_type> lasts;
+      };
+
+      /// batches of consecutive reads with at least 1 k-mer, of about batch_kmers k-mers.  bounds into reads.
+      template <typename Alphabet>
+      void make_batches(::bliss::io::PackedReadStore<Alphabet> const & store, ::std::vector<size_t> & reads,
+                        ::std::vector<size_t> & bounds) const {
+        auto const & arena = store.get_arena();
+        reads.clear();
+        for (size_t i = 0; i < store.size(); ++i) {
+          if (arena[i].length >= KmerType::size) reads.emplace_back(i);
+        }
+        bounds.assign(1, 0);
+        size_t nk = 0;
+        for (size_t r = 0; r < reads.size(); ++r) {
+          size_t rk = arena[reads[r]].length - KmerType::size + 1;
+          if ((nk > 0) && (nk + rk > batch_kmers)) {
+            bounds.emplace_back(r);
+            nk = 0;
+          }
+          nk += rk;
+        }
+        if (!reads.empty()) bounds.emplace_back(reads.size());
+      }
+
+      /// number of hits in [first, last] of the sorted distinct taxa.  branchless.
+      static uint32_t range_hits(scratch const & s, taxon_type const & first, taxon_type const & last) {
+        size_t m = s.taxa.size();
+        taxon_type const * t = s.taxa.data();
+        uint32_t const * c = s.counts.data();
+        uint32_t sum = 0;
+        for (size_t j = 0; j < m; ++j) sum += c[j] & (0U - static_cast<uint32_t>((first <= t[j]) & (t[j] <= last)));
+        return sum;
+      }
+
+    public:
+      /**
+       * @param _taxonomy     taxonomy, the same on all ranks.  copied.
+       * @param _comm         communicator of the map.
+       * @param _batch_kmers  most k-mers per insert or query batch.
+       */
+      TaxonomyIndex(Taxonomy const & _taxonomy, ::mxx::comm const & _comm, size_t const & _batch_kmers = (1UL << 22)) :
+        taxonomy(_taxonomy), map(_comm), batch_kmers(::std::max(_batch_kmers, 1UL)) {
+        map.get_reducer().taxonomy = &taxonomy;
+      }
+
+      /// the map's reducer points to taxonomy.
+      TaxonomyIndex(TaxonomyIndex const &) = delete;
+      TaxonomyIndex & operator=(TaxonomyIndex const &) = delete;
+
+      Taxonomy const & get_taxonomy() const {
+        return taxonomy;
+      }
+
+      MapType & get_map() {
+        return map;
+      }
+      MapType const & get_map() const {
+        return map;
+      }
+
+      /**
+       * @brief  add the k-mers of reference sequences.  collective.
+       * @param refs   reference sequences of this rank.
+       * @param taxa   external taxon id of each sequence in refs.  sequences with unknown taxa are skipped.
+       * @return  number of k-mers sent from this rank.
+       */
+      template <typename Alphabet>
+      size_t insert(::bliss::io::PackedReadStore<Alphabet> const & refs, ::std::vector<taxon_type> const & taxa) {
+        static_assert(::std::is_same<Alphabet, typename KmerType::KmerAlphabet>::value,
+                      "store alphabet has to match the k-mer alphabet");
+        if (taxa.size() != refs.size()) throw ::std::invalid_argument("TaxonomyIndex::insert: 1 taxon per sequence required.");
+
+        ::mxx::comm const & comm = map.get_comm();
+        auto const & arena = refs.get_arena();
+
+        ::std::vector<size_t> seqs;
+        ::std::vector<size_t> bounds;
+        make_batches(refs, seqs, bounds);
+        size_t nb = ::mxx::allreduce(bounds.size() - 1, ::mxx::max<size_t>(), comm);
+
+        size_t sent = 0;
+        ::std::vector<::std::pair<KmerType, taxon_type> > input;
+        for (size_t b = 0; b < nb; ++b) {
+          input.clear();
+          size_t first = (b + 1 < bounds.size()) ? bounds[b] : seqs.size();
+          size_t last = (b + 1 < bounds.size()) ? bounds[b + 1] : seqs.size();
+          for (size_t r = first; r < last; ++r) {
+            taxon_type t = taxonomy.compact(taxa[seqs[r]]);
+            if (t == 0) continue;
+            auto end = arena.template kmer_end<KmerType>(seqs[r]);
+            for (auto it = arena.template kmer_begin<KmerType>(seqs[r]); it != end; ++it) input.emplace_back(*it, t);
+          }
+          sent += input.size();
+          map.insert(input);
+        }
+        return sent;
+      }
+
+      /**
+       * @brief  classify the k-mer hits of 1 read.
+       * @param first, last  compact taxon of each k-mer of the read, 0 for no hit.
+       * @param confidence   smallest fraction of the read's k-mers in the clade of the call.  0 for none.
+       */
+      template <typename Iter>
+      classification score(Iter first, Iter last, double const & confidence, scratch & s) const {
+        classification res;
+        res.kmers = static_cast<uint32_t>(::std::distance(first, last));
+
+        s.hits.clear();
+        for (; first != last; ++first) {
+          if (*first != 0) s.hits.emplace_back(*first);
+        }
+        if (s.hits.empty()) return res;
+
+        ::std::sort(s.hits.begin(), s.hits.end());
+        s.taxa.clear();
+        s.counts.clear();
+        s.lasts.clear();
+        for (size_t i = 0; i < s.hits.size(); ++i) {
+          if ((i == 0) || (s.hits[i] != s.hits[i - 1])) {
+            s.taxa.emplace_back(s.hits[i]);
+            s.counts.emplace_back(0);
+            s.lasts.emplace_back(taxonomy.subtree_last(s.hits[i]));
+          }
+          ++s.counts.back();
+        }
+
+        // RTL score of each hit taxon v:  hits of the u with u <= v <= last(u).  ties go to the LCA.
+        size_t m = s.taxa.size();
+        taxon_type call = s.taxa[0];
+        uint32_t best = s.counts[0];
+        if (m > 1) {
+          taxon_type const * t = s.taxa.data();
+          taxon_type const * l = s.lasts.data();
+          uint32_t const * c = s.counts.data();
+          best = 0;
+          for (size_t i = 0; i < m; ++i) {
+            taxon_type v = t[i];
+            uint32_t sc = 0;
+            for (size_t j = 0; j < m; ++j) sc += c[j] & (0U - static_cast<uint32_t>((t[j] <= v) & (v <= l[j])));
+
+            if (sc > best) {
+              best = sc;
+              call = v;
+            } else if (sc == best) {
+              call = taxonomy.lca(call, v);
+            }
+          }
+        }
+
+        uint32_t clade = range_hits(s, call, taxonomy.subtree_last(call));
+        if (confidence > 0.0) {
+          uint32_t need = static_cast<uint32_t>(::std::ceil(confidence * static_cast<double>(res.kmers)));
+          while ((call != 0) && (clade < need)) {
+            call = taxonomy.get_parent(call);
+            if (call != 0) clade = range_hits(s, call, taxonomy.subtree_last(call));
+          }
+          if (call == 0) return res;
+        }
+
+        res.taxon = taxonomy.external_id(call);
+        res.hits = clade;
+        return res;
+      }
+
+      /**
+       * @brief  classify the reads of this rank.  collective.
+       * @param confidence  smallest fraction of a read's k-mers in the clade of its call.  0 for plain Kraken 1 RTL.
+       * @return  1 per read of reads, in order.  reads shorter than k are unclassified with 0 k-mers.
+       */
+      template <typename Alphabet>
+      ::std::vector<classification> classify(::bliss::io::PackedReadStore<Alphabet> const & reads,
+                                             double const & confidence = 0.0) const {
+        static_assert(::std::is_same<Alphabet, typename KmerType::KmerAlphabet>::value,
+                      "store alphabet has to match the k-mer alphabet");
+        ::mxx::comm const & comm = map.get_comm();
+        auto const & arena = reads.get_arena();
+        BL_BENCH_INIT(classify);
+
+        ::std::vector<classification> results(reads.size());
+
+        ::std::vector<size_t> active;
+        ::std::vector<size_t> bounds;
+        make_batches(reads, active, bounds);
+        size_t nb = ::mxx::allreduce(bounds.size() - 1, ::mxx::max<size_t>(), comm);
+
+        scratch s;
+        ::std::vector<KmerType> kmers;
+        ::std::vector<size_t> offsets;
+        for (size_t b = 0; b < nb; ++b) {
+          size_t first = (b + 1 < bounds.size()) ? bounds[b] : active.size();
+          size_t last = (b + 1 < bounds.size()) ? bounds[b + 1] : active.size();
+
+          BL_BENCH_START(classify);
+          kmers.clear();
+          offsets.assign(1, 0);
+          for (size_t r = first; r < last; ++r) {
+            auto end = arena.template kmer_end<KmerType>(active[r]);
+            for (auto it = arena.template kmer_begin<KmerType>(active[r]); it != end; ++it) kmers.emplace_back(*it);
+            offsets.emplace_back(kmers.size());
+          }
+          BL_BENCH_END(classify, "kmers", kmers.size());
+
+          // duplicates, e.g. from overlapping reads, are sent once.  answers in the order of kmers.
+          BL_BENCH_COLLECTIVE_START(classify, "find", comm);
+          typename MapType::query_fanout_type fan;
+          ::std::vector<KmerType> unique;
+          map.fanout_dedup(kmers, fan, unique);
+          ::std::vector<taxon_type> found = fan.scatter_aligned(map.find_aligned(unique, taxon_type(0)));
+          BL_BENCH_END(classify, "find", found.size());
+
+          BL_BENCH_START(classify);
+          for (size_t r = first; r < last; ++r) {
+            results[active[r]] = score(found.begin() + offsets[r - first], found.begin() + offsets[r - first + 1], confidence, s);
+          }
+          BL_BENCH_END(classify, "score", last - first);
+        }
+
+        BL_BENCH_REPORT_MPI_NAMED(classify, "taxonomy_index:classify", comm);
+        return results;
+      }
+  };
+
+} // namespace kmer
+} // namespace index
+} // namespace bliss
+
+#endif /* TAXONOMY_INDEX_HPP_ */
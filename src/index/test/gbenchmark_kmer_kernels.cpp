@@ -0,0 +1,271 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * gbenchmark_kmer_kernels.cpp
+ *   google benchmark microbenchmarks for the local k-mer kernels:  generation, reverse complement, hashing,
+ *   bucketing, and local hash table insert and find, across K, alphabet and word type.
+ *
+ *   every benchmark reports items/s (k-mers) and bytes/s (input bytes of the kernel).  for json output,
+ *     gbenchmark-bliss-index-kmer_kernels --benchmark_out=kernels.json --benchmark_out_format=json
+ *   or build the gbenchmark-json target.  --benchmark_filter=<regex> selects kernels, e.g. "hash.*DNA5".
+ *   BLISS_BENCH_CPU and BLISS_BENCH_FLUSH pin the process and flush the caches before each run (utils/bench_env.hpp).
+ */
+
+#include <benchmark/benchmark.h>
+#include "bliss-config.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/alphabets.hpp"
+#include "common/alphabet_traits.hpp"
+#include "common/kmer.hpp"
+#include "common/kmer_iterators.hpp"
+#include "common/dna_encoder.hpp"
+#include "iterators/transform_iterator.hpp"
+#include "index/kmer_hash.hpp"
+#include "utils/generator.hpp"
+#include "utils/bench_env.hpp"
+
+#if defined(USE_MPI)
+#include "io/incremental_mxx.hpp"
+#endif
+
+
+/// characters of input per benchmark iteration.  about 1MB, so generation and hashing stream from L2/L3.
+static constexpr size_t kernel_chars = 1 << 20;
+
+/// random DNA characters, and the k-mers generated from them, shared by all benchmarks of a k-mer type.
+template <typename Kmer>
+struct KernelData {
+    std::vector<unsigned char> chars;
+    std::vector<Kmer> kmers;
+
+    static KernelData const & get() {
+      static KernelData d;
+      return d;
+    }
+
+  protected:
+    KernelData() : chars(bliss::utils::random_dna(kernel_chars)) {
+      using Decoder = bliss::common::ASCII2<typename Kmer::KmerAlphabet, unsigned char>;
+      using CharIter = bliss::iterator::transform_iterator<std::vector<unsigned char>::const_iterator, Decoder>;
+      using KmerIter = bliss::common::KmerGenerationIterator<CharIter, Kmer>;
+
+      kmers.reserve(chars.size() - Kmer::size + 1);
+      KmerIter it(CharIter(chars.cbegin(), Decoder()), true);
+      KmerIter end(CharIter(chars.cend(), Decoder()), false);
+      for (; it != end; ++it) kmers.emplace_back(*it);
+    }
+};
+
+
+/// k-mer generation from ASCII, via the character iterator (any alphabet).
+template <typename Kmer>
+static void bm_kmergen_iterator(benchmark::State & state) {
+  auto const & d = KernelData<Kmer>::get();
+
+  using Decoder = bliss::common::ASCII2<typename Kmer::KmerAlphabet, unsigned char>;
+  using CharIter = bliss::iterator::transform_iterator<std::vector<unsigned char>::const_iterator, Decoder>;
+  using KmerIter = bliss::common::KmerGenerationIterator<CharIter, Kmer>;
+
+  std::vector<Kmer> out(d.kmers.size());
+  for (auto _ : state) {
+    KmerIter it(CharIter(d.chars.cbegin(), Decoder()), true);
+    KmerIter end(CharIter(d.chars.cend(), Decoder()), false);
+    std::copy(it, end, out.begin());
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * out.size());
+  state.SetBytesProcessed(state.iterations() * d.chars.size());
+}
+
+/// k-mer generation from ASCII, via the bulk DNA encoder (DNA only).
+template <typename Kmer>
+static void bm_kmergen_encoder(benchmark::State & state) {
+  auto const & d = KernelData<Kmer>::get();
+
+  bliss::common::DNAKmerGenerator<Kmer> gen;
+  std::vector<Kmer> out(d.kmers.size());
+  for (auto _ : state) {
+    gen(d.chars.data(), d.chars.data() + d.chars.size(), out.begin());
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * out.size());
+  state.SetBytesProcessed(state.iterations() * d.chars.size());
+}
+
+template <typename Kmer>
+static void bm_revcomp(benchmark::State & state) {
+  auto const & d = KernelData<Kmer>::get();
+
+  std::vector<Kmer> out(d.kmers.size());
+  for (auto _ : state) {
+    for (size_t i = 0; i < d.kmers.size(); ++i) d.kmers[i].reverse_complement(out[i]);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * d.kmers.size());
+  state.SetBytesProcessed(state.iterations() * d.kmers.size() * sizeof(Kmer));
+}
+
+/// batch hash of all k-mers.
+template <typename Kmer, template <typename, bool> class Hash>
+static void bm_hash(benchmark::State & state) {
+  auto const & d = KernelData<Kmer>::get();
+
+  Hash<Kmer, false> h;
+  std::vector<uint64_t> out(d.kmers.size());
+  for (auto _ : state) {
+    h.hash(d.kmers.data(), d.kmers.size(), out.data());
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * d.kmers.size());
+  state.SetBytesProcessed(state.iterations() * d.kmers.size() * sizeof(Kmer));
+}
+
+#if defined(USE_MPI)
+/// bucketing by the prefix farm hash into range(0) buckets, as before an all2allv.
+template <typename Kmer>
+static void bm_bucket(benchmark::State & state) {
+  auto const & d = KernelData<Kmer>::get();
+  size_t const buckets = state.range(0);
+
+  bliss::kmer::hash::farm<Kmer, true> h;
+  auto to_bucket = [&h, buckets](Kmer const & x) { return h(x) % buckets; };
+
+  std::vector<size_t> counts;
+  std::vector<size_t> i2o;
+  for (auto _ : state) {
+    imxx::local::assign_to_buckets(d.kmers, to_bucket, buckets, counts, i2o, 0, d.kmers.size());
+    benchmark::DoNotOptimize(i2o.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * d.kmers.size());
+  state.SetBytesProcessed(state.iterations() * d.kmers.size() * sizeof(Kmer));
+}
+#endif
+
+/// local hash table, as used by the unordered map backend for the k-mer count index.
+template <typename Kmer>
+using LocalTable = std::unordered_map<Kmer, uint32_t, bliss::kmer::hash::farm<Kmer, false> >;
+
+template <typename Kmer>
+static void bm_insert(benchmark::State & state) {
+  auto const & d = KernelData<Kmer>::get();
+
+  for (auto _ : state) {
+    LocalTable<Kmer> table;
+    table.reserve(d.kmers.size());
+    for (auto const & x : d.kmers) ++table[x];
+    benchmark::DoNotOptimize(table.size());
+  }
+  state.SetItemsProcessed(state.iterations() * d.kmers.size());
+  state.SetBytesProcessed(state.iterations() * d.kmers.size() * sizeof(Kmer));
+}
+
+/// find every k-mer once.  all hits.
+template <typename Kmer>
+static void bm_find(benchmark::State & state) {
+  auto const & d = KernelData<Kmer>::get();
+
+  LocalTable<Kmer> table;
+  table.reserve(d.kmers.size());
+  for (auto const & x : d.kmers) ++table[x];
+
+  for (auto _ : state) {
+    size_t found = 0;
+    for (auto const & x : d.kmers) found += (table.find(x) != table.end());
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetItemsProcessed(state.iterations() * d.kmers.size());
+  state.SetBytesProcessed(state.iterations() * d.kmers.size() * sizeof(Kmer));
+}
+
+
+//////////////////// register the kernels for the different types.
+
+/// before each run (and repetition):  evict the previous run's data if BLISS_BENCH_FLUSH=1.
+static void flush_setup(benchmark::State const &) {
+  ::bliss::utils::bench::flush_if_enabled();
+}
+
+/// RegisterBenchmark with the flush setup.
+template <typename Fn>
+static benchmark::internal::Benchmark * register_kernel(char const * name, Fn fn) {
+  return benchmark::RegisterBenchmark(name, fn)->Setup(flush_setup);
+}
+
+// benchmark names:  kernel<K, alphabet, word type>.
+#define BLISS_KMER_NAME(K, ALPHA, WORD) "<" #K ", " #ALPHA ", " #WORD ">"
+
+#if defined(USE_MPI)
+#define BLISS_REGISTER_BUCKET(K, ALPHA, WORD) \
+  register_kernel("bucket" BLISS_KMER_NAME(K, ALPHA, WORD), \
+                  bm_bucket<bliss::common::Kmer<K, bliss::common::ALPHA, WORD> >)->Arg(64)->Arg(1024)
+#else
+#define BLISS_REGISTER_BUCKET(K, ALPHA, WORD)
+#endif
+
+#define BLISS_REGISTER_KERNELS(K, ALPHA, WORD) do { \
+  using KM = bliss::common::Kmer<K, bliss::common::ALPHA, WORD>; \
+  register_kernel("kmergen_iterator" BLISS_KMER_NAME(K, ALPHA, WORD), bm_kmergen_iterator<KM>); \
+  register_kernel("revcomp" BLISS_KMER_NAME(K, ALPHA, WORD), bm_revcomp<KM>); \
+  register_kernel("hash_std" BLISS_KMER_NAME(K, ALPHA, WORD), bm_hash<KM, bliss::kmer::hash::cpp_std>); \
+  register_kernel("hash_murmur" BLISS_KMER_NAME(K, ALPHA, WORD), bm_hash<KM, bliss::kmer::hash::murmur>); \
+  register_kernel("hash_farm" BLISS_KMER_NAME(K, ALPHA, WORD), bm_hash<KM, bliss::kmer::hash::farm>); \
+  register_kernel("hash_mix" BLISS_KMER_NAME(K, ALPHA, WORD), bm_hash<KM, bliss::kmer::hash::mix>); \
+  register_kernel("hash_multiply_shift" BLISS_KMER_NAME(K, ALPHA, WORD), bm_hash<KM, bliss::kmer::hash::multiply_shift>); \
+  register_kernel("hash_crc32c" BLISS_KMER_NAME(K, ALPHA, WORD), bm_hash<KM, bliss::kmer::hash::crc32c>); \
+  BLISS_REGISTER_BUCKET(K, ALPHA, WORD); \
+  register_kernel("insert" BLISS_KMER_NAME(K, ALPHA, WORD), bm_insert<KM>); \
+  register_kernel("find" BLISS_KMER_NAME(K, ALPHA, WORD), bm_find<KM>); \
+} while (0)
+
+#define BLISS_REGISTER_DNA_KERNELS(K, WORD) do { \
+  register_kernel("kmergen_encoder" BLISS_KMER_NAME(K, DNA, WORD), \
+                  bm_kmergen_encoder<bliss::common::Kmer<K, bliss::common::DNA, WORD> >); \
+} while (0)
+
+
+/// registered at static initialization, before main runs.
+static bool registered = []() {
+  // K, for 1, 2 and 3 words
+  BLISS_REGISTER_KERNELS(21, DNA, uint64_t);
+  BLISS_REGISTER_KERNELS(31, DNA, uint64_t);
+  BLISS_REGISTER_KERNELS(63, DNA, uint64_t);
+  BLISS_REGISTER_KERNELS(95, DNA, uint64_t);
+  // word type
+  BLISS_REGISTER_KERNELS(31, DNA, uint32_t);
+  BLISS_REGISTER_KERNELS(31, DNA, uint16_t);
+  // alphabet
+  BLISS_REGISTER_KERNELS(21, DNA5, uint64_t);
+  BLISS_REGISTER_KERNELS(31, DNA5, uint64_t);
+  BLISS_REGISTER_KERNELS(21, DNA16, uint64_t);
+  BLISS_REGISTER_KERNELS(31, DNA16, uint64_t);
+
+  BLISS_REGISTER_DNA_KERNELS(21, uint64_t);
+  BLISS_REGISTER_DNA_KERNELS(31, uint64_t);
+  BLISS_REGISTER_DNA_KERNELS(63, uint64_t);
+  BLISS_REGISTER_DNA_KERNELS(31, uint32_t);
+  return true;
+}();
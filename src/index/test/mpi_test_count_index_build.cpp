@@ -0,0 +1,211 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_count_index_build.cpp
+ *   Test that counting blocks of a read store before distribution gives the same counts as inserting every k-mer,
+ *   also with duplicate reads removed first.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "index/kmer_index.hpp"
+
+
+template <typename MapParams>
+class CountIndexBuildTest : public ::testing::Test
+{
+  protected:
+    using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+    template <typename K>
+    using Params = typename MapParams::template type<K>;
+    using MapType = ::dsc::counting_densehash_map<KmerType, uint32_t,
+        Params,
+        ::bliss::kmer::hash::sparsehash::special_keys<KmerType, MapParams::canonical> >;
+    using Index = bliss::index::kmer::CountIndex<MapType>;
+    using Store = bliss::io::PackedReadStore<bliss::common::DNA>;
+
+    Store store;
+
+    virtual void SetUp()
+    {
+      ::mxx::comm comm;
+      std::mt19937 gen(comm.rank() + 3);
+      std::uniform_int_distribution<int> len_dist(5, 300);
+      std::uniform_int_distribution<int> char_dist(0, 3);
+
+      // repeats within and across reads, and some reads too short for a k-mer.
+      size_t offset = 0;
+      for (int i = 0; i < 200; ++i) {
+        std::string s;
+        int len = len_dist(gen);
+        for (int j = 0; j < len; ++j) s.push_back((i % 3 == 0) ? "ACGTTGCA"[j % 8] : "ACGT"[char_dist(gen)]);
+        store.append(s.begin(), s.end(), offset, bliss::common::SequenceId(offset), KmerType::size);
+        offset += s.size() + 1;
+      }
+
+      // duplicates on every rank, from the same seed, and some again on this rank.
+      std::mt19937 shared(17);
+      for (int i = 0; i < 50; ++i) {
+        std::string s;
+        int len = len_dist(shared);
+        for (int j = 0; j < len; ++j) s.push_back("ACGT"[char_dist(shared)]);
+        for (int c = 0; c <= (i + comm.rank()) % 3; ++c) {
+          store.append(s.begin(), s.end(), offset, bliss::common::SequenceId(offset), KmerType::size);
+          offset += s.size() + 1;
+        }
+      }
+    }
+
+    void check(size_t block_kmers, int pool_threads = -1) {
+      ::mxx::comm comm;
+
+      Index gold(comm);
+      gold.build(store);
+
+      Index idx(comm);
+      if (pool_threads >= 0) idx.use_worker_pool(pool_threads);
+      idx.build_counted(store, block_kmers);
+
+      EXPECT_EQ(gold.size(), idx.size());
+
+      std::vector<std::pair<KmerType, uint32_t> > g, r;
+      gold.get_map().to_vector(g);
+      idx.get_map().to_vector(r);
+      std::sort(g.begin(), g.end());
+      std::sort(r.begin(), r.end());
+      bool same = (g == r);
+      same = ::mxx::all_of(same, comm);
+      EXPECT_TRUE(same);
+    }
+
+    void check_deduped(size_t block_kmers) {
+      ::mxx::comm comm;
+
+      Index gold(comm);
+      gold.build(store);
+
+      // weights add up to the number of reads, and each shared read is kept once over all ranks.
+      size_t distinct = 0;
+      std::vector<size_t> weights = bliss::index::dedup_reads(store, comm, distinct);
+      ASSERT_EQ(store.size(), weights.size());
+      size_t total = 0, kept = 0;
+      for (auto w : weights) {
+        total += w;
+        if (w > 0) ++kept;
+      }
+      EXPECT_EQ(kept, distinct);
+      EXPECT_EQ(::mxx::allreduce(store.size(), comm), ::mxx::allreduce(total, comm));
+      EXPECT_LE(::mxx::allreduce(distinct, comm) + 50 * (comm.size() - 1) + 40, ::mxx::allreduce(store.size(), comm));
+
+      Index idx(comm);
+      EXPECT_EQ(distinct, idx.build_deduped(store, block_kmers));
+
+      EXPECT_EQ(gold.size(), idx.size());
+
+      std::vector<std::pair<KmerType, uint32_t> > g, r;
+      gold.get_map().to_vector(g);
+      idx.get_map().to_vector(r);
+      std::sort(g.begin(), g.end());
+      std::sort(r.begin(), r.end());
+      bool same = (g == r);
+      same = ::mxx::all_of(same, comm);
+      EXPECT_TRUE(same);
+    }
+};
+
+template <typename K>
+using SingleStrandParams = bliss::index::kmer::SingleStrandHashMapParams<K>;
+template <typename K>
+using CanonicalParams = bliss::index::kmer::CanonicalHashMapParams<K>;
+
+template <bool CANONICAL, template <typename> class P>
+struct CountMapParams {
+    static constexpr bool canonical = CANONICAL;
+    template <typename K>
+    using type = P<K>;
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(CountIndexBuildTest);
+
+TYPED_TEST_P(CountIndexBuildTest, one_block)
+{
+  this->check(1UL << 30);
+}
+
+TYPED_TEST_P(CountIndexBuildTest, small_blocks)
+{
+  // blocks of a few reads, and block counts that differ across ranks.
+  this->check(500);
+  this->check(1);
+}
+
+TYPED_TEST_P(CountIndexBuildTest, worker_pool)
+{
+  // the read loop on a persistent pool, with more threads than cores, and with the caller alone.
+  this->check(1UL << 30, 3);
+  this->check(500, 3);
+  this->check(500, 1);
+}
+
+TYPED_TEST_P(CountIndexBuildTest, deduped)
+{
+  this->check_deduped(1UL << 30);
+  this->check_deduped(500);
+}
+
+// now register the test cases
+REGISTER_TYPED_TEST_CASE_P(CountIndexBuildTest, one_block, small_blocks, worker_pool, deduped);
+
+typedef ::testing::Types<
+    CountMapParams<false, SingleStrandParams>,
+    CountMapParams<true, CanonicalParams>
+> CountIndexBuildTestTypes;
+
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, CountIndexBuildTest, CountIndexBuildTestTypes);
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_count_reads.cpp
+ *   Test that the streaming count query count_reads_prefetched gives each read of a FASTQ file once, in file order,
+ *   with the same k-mer counts as count_aligned on the whole file's k-mers.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "index/kmer_index.hpp"
+
+
+class CountReadsTest : public ::testing::Test
+{
+  protected:
+    using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+    template <typename K>
+    using Params = bliss::index::kmer::CanonicalHashMapParams<K>;
+    using CountMapType = ::dsc::counting_densehash_map<KmerType, uint32_t, Params,
+        ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> >;
+    using IndexType = bliss::index::kmer::CountIndex<CountMapType>;
+
+    /// streamed reads, in the order read_op got them.
+    std::vector<size_t> ids;
+    std::vector<size_t> offsets;
+    std::vector<size_t> counts;
+
+    void check(IndexType const & idx, std::string const & filename, size_t block_size, bool mpiio) {
+      ::mxx::comm comm;
+
+      ids.clear();
+      offsets.assign(1, 0);
+      counts.clear();
+      auto read_op = [this](size_t const & id, size_t const * first, size_t const * last) {
+        ids.emplace_back(id);
+        counts.insert(counts.end(), first, last);
+        offsets.emplace_back(counts.size());
+      };
+      std::pair<size_t, size_t> read;
+      if (mpiio) read = idx.template count_reads_mpiio<bliss::io::FASTQParser, bliss::io::SequencesIterator>(filename, block_size, read_op);
+      else read = idx.template count_reads_posix<bliss::io::FASTQParser, bliss::io::SequencesIterator>(filename, block_size, read_op);
+
+      // gold:  the same partition's k-mers, read at once.
+      std::vector<KmerType> query;
+      ::bliss::io::posix_file reader(filename);
+      auto gold_read = ::bliss::io::KmerFileHelper::template parse_file_prefetched<::bliss::index::kmer::KmerParser<KmerType>,
+          bliss::io::FASTQParser, bliss::io::SequencesIterator>(reader, 1UL << 20, query, comm);
+      std::vector<size_t> gold = idx.count_aligned(query);
+
+      EXPECT_EQ(gold_read, read);
+      EXPECT_EQ(read.first, ids.size());
+      EXPECT_EQ(read.second, counts.size());
+      EXPECT_TRUE(gold == counts);
+
+      // every k-mer is in the index, and reads are in file order and on 1 process each.
+      EXPECT_EQ(counts.end(), std::find(counts.begin(), counts.end(), 0UL));
+      EXPECT_TRUE(std::is_sorted(ids.begin(), ids.end()));
+      std::vector<size_t> all = ::mxx::allgatherv(ids, comm);
+      EXPECT_TRUE(std::is_sorted(all.begin(), all.end()));
+      EXPECT_EQ(all.end(), std::adjacent_find(all.begin(), all.end()));
+      EXPECT_GT(all.size(), 0UL);
+    }
+};
+
+
+TEST_F(CountReadsTest, fastq)
+{
+  ::mxx::comm comm;
+  std::string filename = std::string(PROJ_SRC_DIR) + "/test/data/natural.fastq";
+
+  IndexType idx(comm);
+  idx.template build_posix<bliss::io::FASTQParser, bliss::io::SequencesIterator>(filename, comm, 100000);
+
+  // many blocks, and 1 block.
+  check(idx, filename, 3000, false);
+  check(idx, filename, 3000, true);
+  check(idx, filename, 1UL << 24, false);
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,195 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_index_checkpoint.cpp
+ *   Test that a checkpointed build gives the same index as a build without checkpoints, that a checkpoint restores
+ *   the saved map and offset, and that a build interrupted after a checkpoint resumes to the same index.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+#include "mxx/collective.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>   // access
+
+#include "index/kmer_index.hpp"
+#include "containers/dsc_map_checkpoint.hpp"
+
+
+class IndexCheckpointTest : public ::testing::Test
+{
+  protected:
+    using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+    template <typename K>
+    using Params = bliss::index::kmer::CanonicalHashMapParams<K>;
+    using MapType = ::dsc::counting_densehash_map<KmerType, uint32_t, Params,
+        ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> >;
+    using IndexType = bliss::index::kmer::CountIndex<MapType>;
+    using FileType = bliss::io::parallel::partitioned_file<bliss::io::mmap_file, bliss::io::FASTQParser>;
+
+    std::string filename = std::string(PROJ_SRC_DIR) + "/test/data/natural.fastq";
+    size_t chunk_size = 2000;
+    std::string prefix;
+
+    virtual void SetUp() {
+      ::mxx::comm comm;
+      int pid = getpid();
+      ::mxx::bcast(pid, 0, comm);
+      std::stringstream ss;
+      ss << "/tmp/bliss_ckpt_test." << pid;
+      prefix = ss.str();
+    }
+
+    /// true if any of this rank's checkpoint files exist.
+    bool has_files() {
+      ::mxx::comm comm;
+      bool found = false;
+      for (int s = 0; s < 2; ++s) {
+        std::stringstream ss;
+        ss << prefix << ".ckpt" << s << "." << comm.rank();
+        found |= (access((ss.str() + ".dsc").c_str(), F_OK) == 0);
+        found |= (access((ss.str() + ".progress").c_str(), F_OK) == 0);
+      }
+      return found;
+    }
+
+    /// same content on all ranks together.
+    void compare(MapType const & gold, MapType const & map) {
+      ::mxx::comm comm;
+      std::vector<std::pair<KmerType, uint32_t> > gl, rl;
+      gold.to_vector(gl);
+      map.to_vector(rl);
+      auto g = ::mxx::allgatherv(gl, comm);
+      auto r = ::mxx::allgatherv(rl, comm);
+      std::sort(g.begin(), g.end());
+      std::sort(r.begin(), r.end());
+      EXPECT_GT(g.size(), 0UL);
+      EXPECT_TRUE(g == r);
+    }
+};
+
+
+TEST_F(IndexCheckpointTest, build)
+{
+  ::mxx::comm comm;
+
+  IndexType gold(comm);
+  gold.template build_mmap<bliss::io::FASTQParser, bliss::io::SequencesIterator>(filename, comm, chunk_size);
+
+  IndexType idx(comm);
+  idx.template build_checkpointed<FileType, bliss::io::FASTQParser, bliss::io::SequencesIterator>(
+      filename, comm, chunk_size, prefix, 1);
+
+  compare(gold.get_map(), idx.get_map());
+  EXPECT_FALSE(has_files());
+}
+
+TEST_F(IndexCheckpointTest, save_restore)
+{
+  ::mxx::comm comm;
+
+  IndexType gold(comm);
+  gold.template build_mmap<bliss::io::FASTQParser, bliss::io::SequencesIterator>(filename, comm, chunk_size);
+
+  {
+    ::dsc::map_checkpoint<MapType> checkpoint(prefix, filename, comm);
+    checkpoint.save(gold.get_map(), 1000 + comm.rank());
+    checkpoint.save(gold.get_map(), 2000 + comm.rank());
+    checkpoint.wait();
+    EXPECT_EQ(2UL, checkpoint.get_epoch());
+  }
+
+  ::dsc::map_checkpoint<MapType> checkpoint(prefix, filename, comm);
+  IndexType idx(comm);
+  EXPECT_EQ(2000UL + comm.rank(), checkpoint.restore(idx.get_map()));
+  EXPECT_EQ(2UL, checkpoint.get_epoch());
+  compare(gold.get_map(), idx.get_map());
+
+  // a different input does not match.
+  ::dsc::map_checkpoint<MapType> other(prefix, filename + ".other", comm);
+  IndexType empty(comm);
+  EXPECT_EQ(0UL, other.restore(empty.get_map()));
+  EXPECT_EQ(0UL, empty.get_map().size());
+
+  checkpoint.remove();
+  EXPECT_FALSE(has_files());
+}
+
+TEST_F(IndexCheckpointTest, resume)
+{
+  ::mxx::comm comm;
+
+  IndexType gold(comm);
+  gold.template build_mmap<bliss::io::FASTQParser, bliss::io::SequencesIterator>(filename, comm, chunk_size);
+
+  // interrupted build:  checkpoint after the first chunk, then fail.
+  {
+    IndexType partial(comm);
+    ::dsc::map_checkpoint<MapType> checkpoint(prefix, filename, comm);
+    auto insert_op = [&partial](std::vector<typename IndexType::KmerParserType::value_type> & chunk) {
+      partial.get_map().insert(chunk);
+    };
+    auto progress_op = [&partial, &checkpoint](size_t const & consumed) {
+      checkpoint.save(partial.get_map(), consumed);
+      checkpoint.wait();
+      throw std::runtime_error("interrupted");
+    };
+    EXPECT_THROW((bliss::io::KmerFileHelper::template read_file_chunked<FileType, typename IndexType::KmerParserType,
+        bliss::io::FASTQParser, bliss::io::SequencesIterator>(filename, chunk_size, insert_op, comm, 0, progress_op)),
+        std::runtime_error);
+    EXPECT_LT(partial.get_map().size(), gold.get_map().size());
+  }
+  EXPECT_TRUE(::mxx::any_of(has_files(), comm));
+
+  IndexType idx(comm);
+  idx.template build_checkpointed<FileType, bliss::io::FASTQParser, bliss::io::SequencesIterator>(
+      filename, comm, chunk_size, prefix, 2);
+
+  compare(gold.get_map(), idx.get_map());
+  EXPECT_FALSE(has_files());
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
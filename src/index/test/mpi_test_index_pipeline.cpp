@@ -0,0 +1,125 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_index_pipeline.cpp
+ *   Test that build_pipelined gives the same index as build_chunked, for FASTQ and FASTA, counts and positions,
+ *   and that the stage counters add up.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "index/kmer_index.hpp"
+
+
+class IndexPipelineTest : public ::testing::Test
+{
+  protected:
+    using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+    template <typename K>
+    using Params = bliss::index::kmer::CanonicalHashMapParams<K>;
+    using CountMapType = ::dsc::counting_densehash_map<KmerType, uint32_t, Params,
+        ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> >;
+    using PosMapType = ::dsc::densehash_multimap<KmerType, bliss::common::ShortSequenceKmerId, Params,
+        ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> >;
+
+    template <typename FileType, template <typename> class SeqParser, typename IndexType>
+    void check(std::string const & filename, size_t chunk_size, int parse_threads) {
+      ::mxx::comm comm;
+
+      IndexType gold(comm);
+      gold.template build_chunked<FileType, SeqParser, bliss::io::SequencesIterator>(filename, comm, chunk_size);
+
+      IndexType idx(comm);
+      idx.template build_pipelined<FileType, SeqParser, bliss::io::SequencesIterator>(filename, comm, chunk_size,
+                                                                                        parse_threads, 2);
+
+      using TupleType = typename IndexType::TupleType;
+      std::vector<TupleType> gl, rl;
+      gold.get_map().to_vector(gl);
+      idx.get_map().to_vector(rl);
+      auto g = ::mxx::allgatherv(gl, comm);
+      auto r = ::mxx::allgatherv(rl, comm);
+      std::sort(g.begin(), g.end());
+      std::sort(r.begin(), r.end());
+      EXPECT_GT(g.size(), 0UL);
+      EXPECT_TRUE(g == r);
+
+      // every batch is parsed, and every chunk reaches the insert.
+      auto stats = idx.get_pipeline_stats();
+      ASSERT_EQ(3UL, stats.size());
+      EXPECT_EQ(stats[0].items, stats[1].items);
+      EXPECT_GE(stats[2].items, stats[1].items);
+      EXPECT_EQ(parse_threads, stats[1].threads);
+      EXPECT_EQ(::mxx::allreduce(stats[2].items, [](size_t x, size_t y){ return std::max(x, y); }, comm),
+                stats[2].items);
+    }
+};
+
+
+TEST_F(IndexPipelineTest, count_fastq)
+{
+  using FileType = bliss::io::parallel::partitioned_file<bliss::io::mmap_file, bliss::io::FASTQParser>;
+  std::string filename = std::string(PROJ_SRC_DIR) + "/test/data/natural.fastq";
+  check<FileType, bliss::io::FASTQParser, bliss::index::kmer::CountIndex<CountMapType> >(filename, 2000, 1);
+  check<FileType, bliss::io::FASTQParser, bliss::index::kmer::CountIndex<CountMapType> >(filename, 2000, 3);
+}
+
+TEST_F(IndexPipelineTest, count_fasta)
+{
+  using FileType = bliss::io::parallel::partitioned_file<bliss::io::mmap_file, bliss::io::FASTAParser>;
+  std::string filename = std::string(PROJ_SRC_DIR) + "/test/data/natural.fasta";
+  check<FileType, bliss::io::FASTAParser, bliss::index::kmer::CountIndex<CountMapType> >(filename, 5000, 2);
+}
+
+TEST_F(IndexPipelineTest, position_fastq)
+{
+  using FileType = bliss::io::parallel::mpiio_file<bliss::io::FASTQParser>;
+  std::string filename = std::string(PROJ_SRC_DIR) + "/test/data/natural.fastq";
+  check<FileType, bliss::io::FASTQParser, bliss::index::kmer::PositionIndex<PosMapType> >(filename, 3000, 2);
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
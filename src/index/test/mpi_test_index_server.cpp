@@ -0,0 +1,194 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_index_server.cpp
+ *   Test that clients of a resident index server get the same answers as direct find and count calls.
+ *   each rank runs its clients on threads, which stand in for local client processes.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>   // getpid
+
+#include "index/kmer_index.hpp"
+#include "index/index_server.hpp"
+
+
+class IndexServerTest : public ::testing::Test
+{
+  protected:
+    using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+    template <typename K>
+    using Params = bliss::index::kmer::CanonicalHashMapParams<K>;
+    using IndexType = bliss::index::kmer::CountIndex<::dsc::counting_densehash_map<KmerType, uint32_t, Params,
+        ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> > >;
+    using ClientType = bliss::index::index_client<IndexType>;
+    using FindResult = typename ClientType::find_result_type;
+    using CountResult = typename ClientType::count_result_type;
+
+    std::string filename = std::string(PROJ_SRC_DIR) + "/test/data/natural.fastq";
+    ::mxx::comm comm;
+    IndexType idx;
+    std::string name;
+
+    IndexServerTest() : idx(comm) {}
+
+    virtual void SetUp() {
+      idx.template build_mmap<bliss::io::FASTQParser, bliss::io::SequencesIterator>(filename, comm, 2000);
+
+      int pid = getpid();
+      ::mxx::bcast(pid, 0, comm);
+      std::stringstream ss;
+      ss << "bliss_index_server_test." << pid;
+      name = ss.str();
+    }
+
+    /// some indexed k-mers, their reverse complements, absent k-mers, and repeats.
+    std::vector<KmerType> make_query(int seed) {
+      std::vector<std::pair<KmerType, uint32_t> > local;
+      idx.get_map().to_vector(local);
+      std::vector<KmerType> out;
+      for (size_t i = seed; i < local.size(); i += 7) {
+        out.emplace_back(local[i].first);
+        if (i % 3 == 0) out.emplace_back(local[i].first.reverse_complement());
+      }
+      KmerType k;
+      for (unsigned int j = 0; j < KmerType::size; ++j) k.nextFromChar(j & 0x3);
+      out.emplace_back(k);
+      if (out.size() > 1) out.emplace_back(out.front());
+      return out;
+    }
+
+    /// gold answers for each query key, from the answers of a direct query.
+    template <typename Result>
+    std::vector<std::vector<Result> > gold(std::vector<KmerType> const & query, std::vector<Result> all) {
+      std::sort(all.begin(), all.end());
+      all.erase(std::unique(all.begin(), all.end()), all.end());
+      std::vector<std::vector<Result> > out(query.size());
+      typename std::decay<decltype(idx.get_map())>::type::input_transform_type trans;
+      for (size_t i = 0; i < query.size(); ++i)
+        for (auto const & r : all) if (r.first == trans(query[i])) out[i].emplace_back(r);
+      return out;
+    }
+
+    template <typename Result>
+    static bool same(std::vector<std::vector<Result> > const & gold, std::vector<size_t> const & counts,
+                     std::vector<Result> const & answers) {
+      if (gold.size() != counts.size()) return false;
+      size_t j = 0;
+      for (size_t i = 0; i < gold.size(); ++i) {
+        if (gold[i].size() != counts[i]) return false;
+        for (auto const & g : gold[i]) if ((j >= answers.size()) || !(answers[j++] == g)) return false;
+      }
+      return j == answers.size();
+    }
+};
+
+
+TEST_F(IndexServerTest, find_count)
+{
+  bliss::index::index_server<IndexType> server(idx, name, comm);
+
+  // 2 clients per rank, each with its own query.
+  std::vector<std::vector<KmerType> > queries = {make_query(comm.rank()), make_query(comm.rank() + 3)};
+  std::vector<std::vector<std::vector<FindResult> > > gold_finds;
+  std::vector<std::vector<std::vector<CountResult> > > gold_counts;
+  for (auto const & q : queries) {
+    std::vector<KmerType> tmp(q);
+    gold_finds.emplace_back(gold(q, idx.find(tmp)));
+    tmp = q;
+    gold_counts.emplace_back(gold(q, idx.count(tmp)));
+  }
+
+  std::atomic<int> done(0);
+  std::atomic<int> ok(0);
+  std::vector<std::thread> clients;
+  for (size_t c = 0; c < queries.size(); ++c) {
+    clients.emplace_back([&, c]() {
+      ClientType client(name, comm.rank());
+      std::vector<size_t> counts;
+      std::vector<FindResult> answers;
+      client.find(queries[c], counts, answers);
+      bool good = same(gold_finds[c], counts, answers);
+
+      std::vector<CountResult> count_answers;
+      client.count(queries[c], counts, count_answers);
+      good &= same(gold_counts[c], counts, count_answers);
+
+      ok += good;
+      ++done;
+    });
+  }
+
+  // serve until all clients on all ranks are done.
+  while (!::mxx::all_of(done == static_cast<int>(queries.size()), comm)) server.serve_once(5);
+  for (auto & t : clients) t.join();
+
+  EXPECT_EQ(static_cast<int>(queries.size()), ok.load());
+}
+
+TEST_F(IndexServerTest, stop)
+{
+  bliss::index::index_server<IndexType> server(idx, name, comm);
+
+  std::thread stopper;
+  if (comm.rank() == comm.size() - 1) {
+    stopper = std::thread([&]() {
+      ClientType client(name, comm.rank());
+      client.stop();
+    });
+  }
+  server.serve(5);  // returns on all ranks.
+  if (stopper.joinable()) stopper.join();
+
+  // a different name does not connect.
+  EXPECT_THROW(ClientType(name + ".none", comm.rank()), ::bliss::io::IOException);
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_multi_index_build.cpp
+ *   Test that building a count and a position index from 1 parse pass gives the same indices as building each
+ *   from the file with its own parser.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "index/multi_index_build.hpp"
+
+
+class MultiIndexBuildTest : public ::testing::Test
+{
+  protected:
+    using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+    using IdType = bliss::common::ShortSequenceKmerId;
+    template <typename K>
+    using SingleParams = bliss::index::kmer::SingleStrandHashMapParams<K>;
+    template <typename K>
+    using CanonicalParams = bliss::index::kmer::CanonicalHashMapParams<K>;
+
+    template <template <typename> class Params, bool canonical>
+    using CountIndex = bliss::index::kmer::CountIndex<::dsc::counting_densehash_map<KmerType, uint32_t, Params,
+        ::bliss::kmer::hash::sparsehash::special_keys<KmerType, canonical> > >;
+    template <template <typename> class Params, bool canonical>
+    using PosIndex = bliss::index::kmer::PositionIndex<::dsc::densehash_multimap<KmerType, IdType, Params,
+        ::bliss::kmer::hash::sparsehash::special_keys<KmerType, canonical> > >;
+
+    using PosParser = bliss::index::kmer::KmerPositionTupleParser<std::pair<KmerType, IdType> >;
+
+    std::string filename = std::string(PROJ_SRC_DIR) + "/test/data/natural.fastq";
+    size_t chunk_size = 2000;
+
+    /// same content on all ranks together.
+    template <typename Index>
+    void compare(Index & gold, Index & idx) {
+      ::mxx::comm comm;
+      EXPECT_EQ(gold.size(), idx.size());
+
+      using V = typename ::std::decay<decltype(gold.get_map())>::type::value_type;
+      ::std::vector<::std::pair<typename ::std::remove_const<typename V::first_type>::type, typename V::second_type> > gl, rl;
+      gold.get_map().to_vector(gl);
+      idx.get_map().to_vector(rl);
+      auto g = ::mxx::allgatherv(gl, comm);
+      auto r = ::mxx::allgatherv(rl, comm);
+      std::sort(g.begin(), g.end());
+      std::sort(r.begin(), r.end());
+      EXPECT_TRUE(g == r);
+    }
+
+    template <typename Count, typename Pos>
+    void check() {
+      ::mxx::comm comm;
+
+      Count count_gold(comm);
+      count_gold.template build_mmap<bliss::io::FASTQParser, bliss::io::SequencesIterator>(filename, comm, chunk_size);
+      Pos pos_gold(comm);
+      pos_gold.template build_mmap<bliss::io::FASTQParser, bliss::io::SequencesIterator>(filename, comm, chunk_size);
+
+      Count count_idx(comm);
+      Pos pos_idx(comm);
+      auto read = bliss::index::kmer::build_multi_mmap<PosParser, bliss::io::FASTQParser, bliss::io::SequencesIterator>(
+          filename, comm, chunk_size,
+          bliss::index::kmer::make_sink<bliss::index::kmer::project_count<uint32_t> >(count_idx),
+          bliss::index::kmer::make_sink<bliss::index::kmer::project_identity>(pos_idx));
+      EXPECT_GT(pos_gold.size(), 0UL);
+      EXPECT_EQ(pos_gold.size(), ::mxx::allreduce(read.second, comm));
+
+      compare(count_gold, count_idx);
+      compare(pos_gold, pos_idx);
+    }
+};
+
+
+TEST_F(MultiIndexBuildTest, shared_distribution)
+{
+  // both canonical, with the same distribution hash:  1 exchange per chunk.
+  this->check<CountIndex<CanonicalParams, true>, PosIndex<CanonicalParams, true> >();
+}
+
+TEST_F(MultiIndexBuildTest, separate_distribution)
+{
+  // different input transforms:  each index distributes its own projection.
+  this->check<CountIndex<CanonicalParams, true>, PosIndex<SingleParams, false> >();
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
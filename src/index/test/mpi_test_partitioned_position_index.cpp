@@ -0,0 +1,106 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_partitioned_position_index.cpp
+ *   Test that a partitioned position index finds the same (k-mer, position) pairs as a hashed position index.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "index/kmer_index.hpp"
+#include "index/partitioned_position_index.hpp"
+
+
+class PartitionedPositionIndexTest : public ::testing::Test
+{
+  protected:
+    using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+    using IdType = bliss::common::ShortSequenceKmerId;
+    template <typename K>
+    using Params = bliss::index::kmer::CanonicalHashMapParams<K>;
+    using GoldIndex = bliss::index::kmer::PositionIndex<::dsc::densehash_multimap<KmerType, IdType, Params,
+        ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> > >;
+    using IndexType = bliss::index::kmer::PartitionedPositionIndex<KmerType, IdType>;
+
+    std::string filename = std::string(PROJ_SRC_DIR) + "/test/data/natural.fastq";
+};
+
+
+TEST_F(PartitionedPositionIndexTest, find)
+{
+  ::mxx::comm comm;
+
+  GoldIndex gold(comm);
+  gold.build_mmap<bliss::io::FASTQParser, bliss::io::SequencesIterator>(filename, comm);
+  IndexType idx(comm);
+  idx.build_mmap<bliss::io::FASTQParser, bliss::io::SequencesIterator>(filename, comm);
+
+  EXPECT_GT(idx.size(), 0UL);
+  EXPECT_EQ(gold.size(), idx.size());
+  // fewer directory entries than k-mers.
+  EXPECT_LT(idx.get_directory().size(), idx.size() / 2);
+
+  // every 5th distinct local k-mer, some as reverse complements.  unique, as find with duplicates repeats results.
+  std::vector<KmerType> q;
+  auto const & local = idx.get_local_entries();
+  for (size_t i = 0, n = 0; i < local.size(); ++i) {
+    if ((i > 0) && (local[i].first == local[i - 1].first)) continue;
+    if (n % 5 == 0) q.emplace_back((n % 10 == 0) ? local[i].first.reverse_complement() : local[i].first);
+    ++n;
+  }
+  std::vector<KmerType> q1(q), q2(q);
+
+  auto g = gold.find(q1);
+  auto r = idx.find(q2);
+  std::sort(g.begin(), g.end());
+  std::sort(r.begin(), r.end());
+
+  EXPECT_GT(::mxx::allreduce(r.size(), comm), 0UL);
+  EXPECT_TRUE(::mxx::all_of(g == r, comm));
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
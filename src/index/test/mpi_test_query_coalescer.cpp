@@ -0,0 +1,185 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_query_coalescer.cpp
+ *   Test that small find and count batches from several threads, coalesced into collective rounds, get the same
+ *   answers as direct find and count calls.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "index/kmer_index.hpp"
+#include "index/query_coalescer.hpp"
+
+
+class QueryCoalescerTest : public ::testing::Test
+{
+  protected:
+    using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+    template <typename K>
+    using Params = bliss::index::kmer::CanonicalHashMapParams<K>;
+    using IndexType = bliss::index::kmer::CountIndex<::dsc::counting_densehash_map<KmerType, uint32_t, Params,
+        ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> > >;
+    using CoalescerType = bliss::index::query_coalescer<IndexType>;
+    using FindResult = typename CoalescerType::find_result_type;
+    using CountResult = typename CoalescerType::count_result_type;
+
+    std::string filename = std::string(PROJ_SRC_DIR) + "/test/data/natural.fastq";
+    ::mxx::comm comm;
+    IndexType idx;
+
+    QueryCoalescerTest() : idx(comm) {}
+
+    virtual void SetUp() {
+      idx.template build_mmap<bliss::io::FASTQParser, bliss::io::SequencesIterator>(filename, comm, 2000);
+    }
+
+    /// small batches of indexed k-mers, their reverse complements, and repeats, different for each thread.
+    std::vector<std::vector<KmerType> > make_batches(int seed, size_t batch_size) {
+      std::vector<std::pair<KmerType, uint32_t> > local;
+      idx.get_map().to_vector(local);
+      std::vector<std::vector<KmerType> > out(1);
+      for (size_t i = seed; i < local.size(); i += 5) {
+        if (out.back().size() >= batch_size) out.emplace_back();
+        out.back().emplace_back(local[i].first);
+        if (i % 3 == 0) out.back().emplace_back(local[i].first.reverse_complement());
+        if (i % 4 == 0) out.back().emplace_back(local[i].first);
+      }
+      KmerType k;
+      for (unsigned int j = 0; j < KmerType::size; ++j) k.nextFromChar(j & 0x3);
+      out.back().emplace_back(k);
+      return out;
+    }
+
+    /// gold answers for each query key, from the answers of a direct query.
+    template <typename Result>
+    std::vector<std::vector<Result> > gold(std::vector<KmerType> const & query, std::vector<Result> all) {
+      std::sort(all.begin(), all.end());
+      all.erase(std::unique(all.begin(), all.end()), all.end());
+      std::vector<std::vector<Result> > out(query.size());
+      typename std::decay<decltype(idx.get_map())>::type::input_transform_type trans;
+      for (size_t i = 0; i < query.size(); ++i)
+        for (auto const & r : all) if (r.first == trans(query[i])) out[i].emplace_back(r);
+      return out;
+    }
+
+    template <typename Result>
+    static bool same(std::vector<std::vector<Result> > const & gold,
+                     typename CoalescerType::template result<Result> const & r) {
+      if (gold.size() != r.counts.size()) return false;
+      size_t j = 0;
+      for (size_t i = 0; i < gold.size(); ++i) {
+        if (gold[i].size() != r.counts[i]) return false;
+        for (auto const & g : gold[i]) if ((j >= r.answers.size()) || !(r.answers[j++] == g)) return false;
+      }
+      return j == r.answers.size();
+    }
+
+    /// threads submit their batches and check the answers.  the main thread dispatches rounds.
+    void run(size_t nthreads, size_t batch_size, size_t max_keys, std::chrono::microseconds const & max_delay) {
+      std::vector<std::vector<std::vector<KmerType> > > batches;
+      std::vector<std::vector<std::vector<std::vector<FindResult> > > > gold_finds(nthreads);
+      std::vector<std::vector<std::vector<std::vector<CountResult> > > > gold_counts(nthreads);
+      for (size_t t = 0; t < nthreads; ++t) {
+        batches.emplace_back(make_batches(comm.rank() * nthreads + t, batch_size));
+        for (auto const & b : batches[t]) {
+          std::vector<KmerType> tmp(b);
+          gold_finds[t].emplace_back(gold(b, idx.find(tmp)));
+          tmp = b;
+          gold_counts[t].emplace_back(gold(b, idx.count(tmp)));
+        }
+      }
+      // ranks may have different numbers of batches.
+      size_t total = 0;
+      for (auto const & b : batches) total += b.size();
+      ASSERT_GT(::mxx::allreduce(total, comm), 0UL);
+
+      CoalescerType coalescer(idx, comm, max_keys, max_delay);
+      std::atomic<size_t> ok(0);
+      std::atomic<size_t> done(0);
+      std::vector<std::thread> threads;
+      for (size_t t = 0; t < nthreads; ++t) {
+        threads.emplace_back([&, t]() {
+          for (size_t b = 0; b < batches[t].size(); ++b) {
+            auto f = coalescer.find(batches[t][b]);
+            auto c = coalescer.count(batches[t][b]);
+            ok += same(gold_finds[t][b], f.get());
+            ok += same(gold_counts[t][b], c.get());
+          }
+          if (++done == nthreads) coalescer.close();
+        });
+      }
+      coalescer.run();
+      for (auto & t : threads) t.join();
+
+      EXPECT_EQ(2 * total, ok.load());
+    }
+};
+
+
+TEST_F(QueryCoalescerTest, delay)
+{
+  // rounds end on the deadline.
+  this->run(4, 20, 1UL << 20, std::chrono::microseconds(1000));
+}
+
+TEST_F(QueryCoalescerTest, size)
+{
+  // rounds end on the key count.
+  this->run(4, 20, 50, std::chrono::microseconds(1000000));
+}
+
+TEST_F(QueryCoalescerTest, empty)
+{
+  CoalescerType coalescer(idx, comm);
+  coalescer.close();
+  coalescer.run();  // returns on all ranks.
+  SUCCEED();
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,195 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_read_anchor_index.cpp
+ *   Test that the read anchored index finds the same occurrences as the position tuples of the same reads.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "index/kmer_index.hpp"
+#include "index/read_anchor_index.hpp"
+
+
+template <typename Key>
+using ReadAnchorMapParams = bliss::index::kmer::SingleStrandHashMapParams<Key>;
+
+class ReadAnchorIndexTest : public ::testing::Test
+{
+  protected:
+    using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+    using IdType = bliss::common::ReadKmerId<uint32_t, 12>;
+    using MapType = ::dsc::densehash_multimap<KmerType, IdType,
+        ReadAnchorMapParams,
+        ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false> >;
+    using Index = bliss::index::kmer::ReadAnchorIndex<MapType>;
+    using Store = bliss::io::PackedReadStore<bliss::common::DNA>;
+
+    /// the reads, same on all ranks, and the file offsets of their records.
+    std::vector<std::string> seqs;
+    std::vector<size_t> offsets;
+
+    virtual void SetUp()
+    {
+      std::mt19937 gen(11);
+      std::uniform_int_distribution<int> len_dist(10, 150);
+      // few distinct characters in places, so that k-mers repeat across reads.
+      std::uniform_int_distribution<int> char_dist(0, 3);
+
+      size_t offset = 0;
+      for (int i = 0; i < 80; ++i) {
+        std::string s;
+        int len = len_dist(gen);
+        for (int j = 0; j < len; ++j) s.push_back((i % 4 == 0) ? "ACGT"[j % 4] : "ACGT"[char_dist(gen)]);
+        seqs.push_back(s);
+        offsets.push_back(offset);
+        offset += s.size() + 20;
+      }
+    }
+
+    /// reads i % step == rank, with a 7 character header before the sequence.
+    void fill(Store & store, int rank, int step) {
+      for (size_t i = rank; i < seqs.size(); i += step) {
+        store.append(seqs[i].begin(), seqs[i].end(), offsets[i] + 7,
+                     bliss::common::SequenceId(offsets[i], i, 0), KmerType::size);
+      }
+    }
+};
+
+
+TEST_F(ReadAnchorIndexTest, find_and_resolve)
+{
+  ::mxx::comm comm;
+
+  Store store;
+  fill(store, comm.rank(), comm.size());
+  Index idx(comm);
+  idx.build(store);
+
+  EXPECT_EQ(seqs.size(), idx.get_table().size());
+
+  // gold:  all position tuples, on every rank.
+  Store all;
+  fill(all, 0, 1);
+  using PosParser = bliss::index::kmer::KmerPositionTupleParser<std::pair<KmerType, bliss::common::ShortSequenceKmerId> >;
+  std::vector<std::pair<KmerType, bliss::common::ShortSequenceKmerId> > gold;
+  all.template generate<PosParser>(gold);
+  EXPECT_EQ(gold.size(), idx.size());
+
+  // query a rank dependent subset of the k-mers, with repeats.
+  std::vector<KmerType> query;
+  for (size_t i = comm.rank(); i < gold.size(); i += 3) query.emplace_back(gold[i].first);
+  std::vector<KmerType> q(query);
+
+  auto found = idx.find(q);
+  auto positions = idx.resolve(found);
+  ASSERT_EQ(found.size(), positions.size());
+
+  bool same = true;
+  for (size_t i = 0; i < found.size(); ++i) {
+    // the read with that record start holds the k-mer at the resolved position.
+    size_t read = found[i].second.get_read();
+    same &= (positions[i].get_id() == offsets[read]);
+    same &= (positions[i].get_pos() == offsets[read] + found[i].second.get_offset());
+  }
+  EXPECT_TRUE(same);
+
+  // the same occurrences as the position tuples.
+  std::sort(query.begin(), query.end());
+  query.erase(std::unique(query.begin(), query.end()), query.end());
+  std::vector<std::pair<KmerType, size_t> > expected, actual;
+  for (auto const & g : gold) {
+    if (std::binary_search(query.begin(), query.end(), g.first)) expected.emplace_back(g.first, g.second.get_pos());
+  }
+  for (size_t i = 0; i < found.size(); ++i) actual.emplace_back(found[i].first, positions[i].get_pos());
+  std::sort(expected.begin(), expected.end());
+  std::sort(actual.begin(), actual.end());
+  actual.erase(std::unique(actual.begin(), actual.end()), actual.end());
+  EXPECT_EQ(expected.size(), actual.size());
+  same = (expected == actual);
+  same = ::mxx::all_of(same, comm);
+  EXPECT_TRUE(same);
+}
+
+TEST_F(ReadAnchorIndexTest, lookup)
+{
+  ::mxx::comm comm;
+
+  Store store;
+  fill(store, comm.rank(), comm.size());
+  bliss::index::kmer::ReadOffsetTable table(comm);
+  size_t first = table.build(store);
+  EXPECT_EQ(seqs.size(), table.size());
+
+  // read numbers follow rank order, so the local reads are consecutive from first.
+  std::vector<size_t> reads;
+  for (size_t r = table.size(); r > 0; --r) reads.push_back(r - 1);
+  auto starts = table.lookup(reads);
+  ASSERT_EQ(reads.size(), starts.size());
+
+  // the starts of the local reads are in the store.
+  for (size_t i = 0; i < store.size(); ++i) {
+    EXPECT_EQ(store.get_id(i).get_pos(), starts[reads.size() - 1 - (first + i)].get_id());
+  }
+
+  reads.push_back(table.size());
+  EXPECT_THROW(table.lookup(reads), std::out_of_range);
+}
+
+TEST_F(ReadAnchorIndexTest, read_id)
+{
+  IdType id(1000, 7);
+  EXPECT_EQ(1000UL, id.get_read());
+  EXPECT_EQ(7UL, id.get_offset());
+  id += 4;
+  EXPECT_EQ(11UL, id.get_offset());
+  EXPECT_TRUE(IdType(999, 4000) < id);
+  EXPECT_THROW(id += 4095, std::invalid_argument);
+  EXPECT_EQ(4UL, sizeof(IdType));
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_spectrum_corrector.cpp
+ *   Test the Hamming neighbour generator against k-mers of edited strings, and that SpectrumCorrector fixes most
+ *   substitution errors of simulated reads against their own k-mer counts without introducing new ones.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "index/kmer_index.hpp"
+#include "index/spectrum_corrector.hpp"
+
+
+template <typename KmerType>
+class HammingNeighborsTest : public ::testing::Test {};
+
+typedef ::testing::Types<
+    bliss::common::Kmer<21, bliss::common::DNA, uint64_t>,
+    bliss::common::Kmer<31, bliss::common::DNA, uint32_t>,
+    bliss::common::Kmer<45, bliss::common::DNA, uint64_t>
+> NeighborTypes;
+TYPED_TEST_CASE(HammingNeighborsTest, NeighborTypes);
+
+TYPED_TEST(HammingNeighborsTest, generate)
+{
+  std::mt19937 gen(5);
+  std::string s;
+  for (unsigned int i = 0; i < TypeParam::size; ++i) s.push_back("ACGT"[gen() & 3]);
+  auto encode = [](std::string const & x) {
+    TypeParam km;
+    for (char c : x) km.nextFromChar(bliss::common::DNA::FROM_ASCII[static_cast<unsigned char>(c)]);
+    return km;
+  };
+
+  bliss::index::kmer::HammingNeighbors<TypeParam> nb;
+  std::vector<TypeParam> out(1);   // appended after existing entries.
+  nb.generate(encode(s), 0, TypeParam::size, out);
+  ASSERT_EQ(1 + 3 * TypeParam::size, out.size());
+
+  for (unsigned int p = 0; p < TypeParam::size; ++p) {
+    uint8_t c = bliss::common::DNA::FROM_ASCII[static_cast<unsigned char>(s[p])];
+    for (uint8_t d = 1; d < 4; ++d) {
+      std::string t = s;
+      t[p] = "ACGT"[c ^ d];
+      EXPECT_EQ(encode(t), out[1 + 3 * p + d - 1]) << "p " << p << " d " << static_cast<int>(d);
+    }
+  }
+
+  std::vector<TypeParam> last;
+  nb.generate(encode(s), TypeParam::size - 1, TypeParam::size, last);
+  ASSERT_EQ(3UL, last.size());
+  EXPECT_TRUE(std::equal(last.begin(), last.end(), out.end() - 3));
+}
+
+
+template <typename K>
+using CanonicalParams = bliss::index::kmer::CanonicalHashMapParams<K>;
+
+class SpectrumCorrectorTest : public ::testing::Test
+{
+  protected:
+    using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+    using MapType = ::dsc::counting_densehash_map<KmerType, uint32_t,
+        CanonicalParams,
+        ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> >;
+    using Index = bliss::index::kmer::CountIndex<MapType>;
+    using Store = bliss::io::PackedReadStore<bliss::common::DNA>;
+
+    ::mxx::comm comm;
+    Store store;
+    /// error free read, as alphabet values.
+    std::vector<std::vector<uint8_t> > truth;
+
+    /// positions that differ from the truth, over the local reads.
+    size_t errors() const {
+      size_t n = 0;
+      for (size_t i = 0; i < store.size(); ++i) {
+        for (size_t j = 0; j < truth[i].size(); ++j) n += (store.get_arena().get(i, j) != truth[i][j]);
+      }
+      return n;
+    }
+
+    virtual void SetUp() {
+      // one genome on all ranks, ~20x coverage in total, reads from both strands.
+      std::mt19937 shared(11);
+      std::string genome;
+      for (int i = 0; i < 20000; ++i) genome.push_back("ACGT"[shared() & 3]);
+
+      size_t nreads = 4000 / comm.size();
+      std::mt19937 gen(comm.rank() + 23);
+      std::uniform_int_distribution<size_t> start(0, genome.size() - 100);
+      std::uniform_real_distribution<double> err(0.0, 1.0);
+      size_t offset = 0;
+      for (size_t r = 0; r < nreads; ++r) {
+        std::string s = genome.substr(start(gen), 100);
+        if (r % 2) {
+          std::string rc(s.rbegin(), s.rend());
+          for (auto & c : rc) c = (c == 'A') ? 'T' : ((c == 'C') ? 'G' : ((c == 'G') ? 'C' : 'A'));
+          s.swap(rc);
+        }
+        std::vector<uint8_t> t;
+        for (char c : s) t.push_back(bliss::common::DNA::FROM_ASCII[static_cast<unsigned char>(c)]);
+        truth.emplace_back(t);
+        // ~0.5% substitutions.
+        for (auto & c : s) {
+          if (err(gen) < 0.005) c = "ACGT"[(bliss::common::DNA::FROM_ASCII[static_cast<unsigned char>(c)] + 1 + (gen() % 3)) % 4];
+        }
+        store.append(s.begin(), s.end(), offset, bliss::common::SequenceId(offset), KmerType::size);
+        offset += s.size() + 1;
+      }
+    }
+};
+
+TEST_F(SpectrumCorrectorTest, correct)
+{
+  Index idx(comm);
+  idx.build(store);
+
+  size_t before = ::mxx::allreduce(errors(), comm);
+  ASSERT_GT(before, 500UL);
+
+  // small batches, so the ranks run different numbers of local batches.
+  bliss::index::kmer::SpectrumCorrector<Index> corrector(idx, 3, 8, 4, 5000 + 1000 * comm.rank());
+  auto st = corrector.correct(store);
+
+  size_t after = ::mxx::allreduce(errors(), comm);
+  size_t corrections = ::mxx::allreduce(st.corrections, comm);
+  EXPECT_LT(after * 10, before) << "before " << before << " after " << after;
+  // nearly all substitutions restore the true base.
+  EXPECT_LE(corrections, (before - after) + before / 50);
+  EXPECT_EQ(store.size(), st.reads);
+  EXPECT_LE(st.corrected, st.reads - st.solid);
+  EXPECT_GT(st.rounds, 1UL);
+
+  // again:  nothing left that can be fixed, apart from the unresolved reads.
+  auto again = corrector.correct(store);
+  EXPECT_LE(::mxx::allreduce(again.corrections, comm), ::mxx::allreduce(st.unresolved, comm));
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,230 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_suffix_array_index.cpp
+ *   Test the distributed bounded length suffix array against a brute force longest match over the same reads.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "index/suffix_array_index.hpp"
+
+
+template <typename Kmer>
+class SuffixArrayIndexTest : public ::testing::Test
+{
+  protected:
+    using Index = bliss::index::kmer::SuffixArrayIndex<Kmer>;
+    using query_type = typename Index::query_type;
+    using longest_match = typename Index::longest_match;
+
+    /// the reads, same on all ranks, and their source offsets.
+    std::vector<std::string> seqs;
+    std::vector<size_t> offsets;
+
+    std::vector<std::string> queries;
+
+    virtual void SetUp()
+    {
+      std::mt19937 gen(17);
+      // short alphabet runs, so that there are repeats at all lengths.
+      std::uniform_int_distribution<int> len_dist(1, 200);
+      std::uniform_int_distribution<int> char_dist(0, 3);
+
+      size_t offset = 0;
+      for (int i = 0; i < 60; ++i) {
+        std::string s;
+        int len = len_dist(gen);
+        for (int j = 0; j < len; ++j) s.push_back("ACGT"[char_dist(gen)]);
+        seqs.push_back(s);
+        offsets.push_back(offset);
+        offset += s.size() + 1;
+      }
+    }
+
+    void make_queries(int rank) {
+      std::mt19937 gen(rank + 5);
+      std::uniform_int_distribution<int> len_dist(1, Kmer::size + 3);
+      std::uniform_int_distribution<int> char_dist(0, 3);
+      std::uniform_int_distribution<size_t> seq_dist(0, seqs.size() - 1);
+
+      for (int i = 0; i < 500; ++i) {
+        size_t len = len_dist(gen);
+        std::string q;
+        if (i % 2 == 0) {
+          // from a read, with a substitution.
+          std::string const & s = seqs[seq_dist(gen)];
+          size_t start = std::uniform_int_distribution<size_t>(0, s.size() - 1)(gen);
+          q = s.substr(start, len);
+          size_t mut = std::uniform_int_distribution<size_t>(0, q.size() + 5)(gen);
+          if (mut < q.size()) q[mut] = "ACGT"[(char_dist(gen) + 1 + q[mut]) % 4];
+        } else {
+          for (size_t j = 0; j < len; ++j) q.push_back("ACGT"[char_dist(gen)]);
+        }
+        queries.push_back(q);
+      }
+    }
+
+    /// longest match of q by brute force.
+    longest_match gold(std::string q) const {
+      if (q.size() > Kmer::size) q.resize(Kmer::size);
+
+      longest_match res = {0, 0, 0};
+      std::string best;
+      for (size_t i = 0; i < seqs.size(); ++i) {
+        for (size_t j = 0; j < seqs[i].size(); ++j) {
+          std::string s = seqs[i].substr(j, Kmer::size);
+          uint32_t m = 0;
+          while ((m < q.size()) && (m < s.size()) && (q[m] == s[m])) ++m;
+          if (m == 0) continue;
+
+          uint64_t pos = offsets[i] + j;
+          if (m > res.length) {
+            res.length = m;
+            res.count = 0;
+          }
+          if (m < res.length) continue;
+          // the first in (suffix, position) order.
+          if ((res.count == 0) || (s < best) || ((s == best) && (pos < res.pos))) {
+            best = s;
+            res.pos = pos;
+          }
+          ++res.count;
+        }
+      }
+      return res;
+    }
+
+    void check(bool with_reads) {
+      ::mxx::comm comm;
+
+      bliss::io::PackedReadStore<typename Kmer::KmerAlphabet> store;
+      if (with_reads) {
+        for (size_t i = comm.rank(); i < seqs.size(); i += comm.size()) {
+          store.append(seqs[i].begin(), seqs[i].end(), offsets[i], bliss::common::SequenceId(offsets[i]), Kmer::size);
+        }
+      }
+
+      Index idx(comm);
+      // whole reads on every rank.
+      idx.build(store, false);
+
+      size_t total = 0;
+      if (with_reads) for (auto const & s : seqs) total += s.size();
+      EXPECT_EQ(total, idx.size());
+
+      make_queries(comm.rank());
+      std::vector<query_type> qs;
+      for (auto const & q : queries) qs.emplace_back(Index::make_query(q.begin(), q.end()));
+
+      std::vector<longest_match> results = idx.find_longest_match(qs);
+      ASSERT_EQ(queries.size(), results.size());
+
+      bool same = true;
+      for (size_t i = 0; i < queries.size(); ++i) {
+        longest_match g = with_reads ? gold(queries[i]) : longest_match{0, 0, 0};
+        same &= (g.length == results[i].length) && (g.count == results[i].count) && (g.pos == results[i].pos);
+        EXPECT_EQ(g.length, results[i].length) << "query " << queries[i];
+        EXPECT_EQ(g.count, results[i].count) << "query " << queries[i];
+        EXPECT_EQ(g.pos, results[i].pos) << "query " << queries[i];
+      }
+      same = ::mxx::all_of(same, comm);
+      EXPECT_TRUE(same);
+    }
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(SuffixArrayIndexTest);
+
+TYPED_TEST_P(SuffixArrayIndexTest, longest_match)
+{
+  this->check(true);
+}
+
+TYPED_TEST_P(SuffixArrayIndexTest, empty)
+{
+  this->check(false);
+}
+
+TYPED_TEST_P(SuffixArrayIndexTest, make_query)
+{
+  using Index = typename TestFixture::Index;
+  using Alphabet = typename TypeParam::KmerAlphabet;
+  size_t k = TypeParam::size;
+
+  // left aligned, zero padded.
+  std::string s("ACGTTG");
+  TypeParam gold;
+  for (auto c : s) gold.nextFromChar(Alphabet::FROM_ASCII[static_cast<unsigned char>(c)]);
+  gold <<= (k - s.size());
+
+  auto q = Index::make_query(s.begin(), s.end());
+  EXPECT_EQ(static_cast<uint32_t>(s.size()), q.second);
+  EXPECT_EQ(gold, q.first);
+
+  // only the first L characters.
+  std::string l = s + std::string(k, 'C');
+  for (size_t i = s.size(); i < k; ++i) gold.setCharsAtPos(Alphabet::FROM_ASCII[static_cast<unsigned char>('C')], k - 1 - i, 1);
+
+  q = Index::make_query(l.begin(), l.end());
+  EXPECT_EQ(static_cast<uint32_t>(k), q.second);
+  EXPECT_EQ(gold, q.first);
+}
+
+
+// now register the test cases
+REGISTER_TYPED_TEST_CASE_P(SuffixArrayIndexTest, longest_match, empty, make_query);
+
+
+typedef ::testing::Types<
+    ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>,
+    ::bliss::common::Kmer<31, ::bliss::common::DNA, uint16_t>,
+    ::bliss::common::Kmer< 7, ::bliss::common::DNA, uint64_t>
+> SuffixArrayIndexTestTypes;
+
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, SuffixArrayIndexTest, SuffixArrayIndexTestTypes);
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,297 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_taxonomy_index.cpp
+ *   Test the compact Taxonomy (LCA, ancestors, invalid trees, NCBI nodes.dmp), and that TaxonomyIndex keeps the LCA of
+ *   k-mers shared by references inserted on different ranks and classifies reads, ties and low confidence calls the
+ *   way Kraken does.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "index/kmer_index.hpp"
+#include "index/taxonomy_index.hpp"
+
+using Taxonomy = bliss::index::kmer::Taxonomy;
+
+//       1
+//     /   \
+//    10    3
+//   /  \    \
+// 100  101   30
+static std::vector<std::pair<uint32_t, uint32_t> > tree_nodes() {
+  return { {30, 3}, {100, 10}, {1, 1}, {101, 10}, {10, 1}, {3, 1} };
+}
+
+TEST(TaxonomyTest, lca)
+{
+  Taxonomy tax(tree_nodes());
+  ASSERT_EQ(6UL, tax.size());
+  EXPECT_EQ(0U, tax.compact(7));
+
+  auto c = [&tax](uint32_t t) { return tax.compact(t); };
+  auto e = [&tax](uint32_t v) { return tax.external_id(v); };
+  EXPECT_EQ(1U, c(1));   // preorder:  the root first.
+  EXPECT_EQ(0U, tax.get_parent(c(1)));
+  EXPECT_EQ(c(10), tax.get_parent(c(101)));
+  EXPECT_EQ(2U, tax.get_depth(c(30)));
+
+  EXPECT_EQ(10U, e(tax.lca(c(100), c(101))));
+  EXPECT_EQ(1U, e(tax.lca(c(100), c(30))));
+  EXPECT_EQ(10U, e(tax.lca(c(10), c(101))));
+  EXPECT_EQ(30U, e(tax.lca(c(30), c(30))));
+  EXPECT_EQ(c(100), tax.lca(0, c(100)));
+  EXPECT_EQ(c(100), tax.lca(c(100), 0));
+
+  EXPECT_TRUE(tax.is_ancestor(c(10), c(100)));
+  EXPECT_TRUE(tax.is_ancestor(c(1), c(30)));
+  EXPECT_TRUE(tax.is_ancestor(c(101), c(101)));
+  EXPECT_FALSE(tax.is_ancestor(c(100), c(10)));
+  EXPECT_FALSE(tax.is_ancestor(c(3), c(101)));
+  EXPECT_FALSE(tax.is_ancestor(c(100), c(101)));
+}
+
+TEST(TaxonomyTest, invalid)
+{
+  // 2 roots
+  EXPECT_THROW(Taxonomy({ {1, 1}, {2, 0}, {3, 1} }), std::invalid_argument);
+  // no root, a cycle
+  EXPECT_THROW(Taxonomy({ {1, 2}, {2, 1} }), std::invalid_argument);
+  // a cycle apart from the root
+  EXPECT_THROW(Taxonomy({ {1, 1}, {2, 3}, {3, 2} }), std::invalid_argument);
+  // unknown parent
+  EXPECT_THROW(Taxonomy({ {1, 1}, {2, 5} }), std::invalid_argument);
+  // 2 parents
+  EXPECT_THROW(Taxonomy({ {1, 1}, {2, 1}, {3, 1}, {3, 2} }), std::invalid_argument);
+  // duplicates are fine
+  EXPECT_EQ(2UL, Taxonomy({ {1, 1}, {2, 1}, {2, 1} }).size());
+}
+
+TEST(TaxonomyTest, build)
+{
+  ::mxx::comm comm;
+  auto nodes = tree_nodes();
+  std::vector<std::pair<uint32_t, uint32_t> > mine;
+  for (size_t i = comm.rank(); i < nodes.size(); i += comm.size()) mine.emplace_back(nodes[i]);
+
+  Taxonomy tax = Taxonomy::build(mine, comm);
+  ASSERT_EQ(6UL, tax.size());
+  EXPECT_EQ(10U, tax.external_id(tax.lca(tax.compact(100), tax.compact(101))));
+}
+
+TEST(TaxonomyTest, read_ncbi_nodes)
+{
+  ::mxx::comm comm;
+  std::string name = "taxonomy_nodes_" + std::to_string(comm.rank()) + ".dmp";
+  {
+    std::ofstream ofs(name);
+    for (auto const & n : tree_nodes()) ofs << n.first << "\t|\t" << n.second << "\t|\tspecies\t|\t\t|\n";
+  }
+  auto nodes = Taxonomy::read_ncbi_nodes(name);
+  std::remove(name.c_str());
+
+  EXPECT_EQ(tree_nodes(), nodes);
+  EXPECT_THROW(Taxonomy::read_ncbi_nodes(name), std::invalid_argument);
+}
+
+
+template <typename K>
+using CanonicalParams = bliss::index::kmer::CanonicalHashMapParams<K>;
+
+class TaxonomyIndexTest : public ::testing::Test
+{
+  protected:
+    using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+    using MapType = ::dsc::reduction_densehash_map<KmerType, uint32_t,
+        CanonicalParams,
+        ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true>,
+        bliss::index::kmer::TaxonLCA>;
+    using Index = bliss::index::kmer::TaxonomyIndex<MapType>;
+    using Store = bliss::io::PackedReadStore<bliss::common::DNA>;
+
+    ::mxx::comm comm;
+    std::mt19937 gen;
+
+    /// 100 and 101 share the last 2000 bases.  30 is unrelated.
+    std::string shared, g100, g101, g30;
+
+    std::string random(size_t n) {
+      std::string s;
+      for (size_t i = 0; i < n; ++i) s.push_back("ACGT"[gen() & 3]);
+      return s;
+    }
+
+    static std::string revcomp(std::string const & s) {
+      std::string rc(s.rbegin(), s.rend());
+      for (auto & c : rc) c = (c == 'A') ? 'T' : ((c == 'C') ? 'G' : ((c == 'G') ? 'C' : 'A'));
+      return rc;
+    }
+
+    static void append(Store & store, std::string const & s, size_t & offset) {
+      store.append(s.begin(), s.end(), offset, bliss::common::SequenceId(offset), KmerType::size);
+      offset += s.size() + 1;
+    }
+
+    virtual void SetUp() {
+      gen.seed(17);   // same genomes on all ranks.
+      shared = random(2000);
+      g100 = random(3000) + shared;
+      g101 = random(3000) + shared;
+      g30 = random(5000);
+      gen.seed(101 + comm.rank());
+    }
+
+    /// the references in overlapping fragments, round robin over the ranks, so shared k-mers meet in the reduction.
+    void build(Index & idx) {
+      Store refs;
+      std::vector<uint32_t> taxa;
+      size_t offset = 0, f = 0;
+      std::vector<std::pair<std::string const *, uint32_t> > genomes = { {&g100, 100}, {&g101, 101}, {&g30, 30} };
+      for (auto const & g : genomes) {
+        for (size_t s = 0; s < g.first->size(); s += 700, ++f) {
+          if (static_cast<int>(f % comm.size()) != comm.rank()) continue;
+          append(refs, g.first->substr(s, 700 + KmerType::size - 1), offset);
+          taxa.emplace_back(g.second);
+        }
+      }
+      // a sequence with an unknown taxon is skipped.
+      append(refs, random(200), offset);
+      taxa.emplace_back(12345);
+
+      idx.insert(refs, taxa);
+    }
+};
+
+TEST_F(TaxonomyIndexTest, lca_of_shared_kmers)
+{
+  Taxonomy tax(tree_nodes());
+  // tiny batches, so the ranks run different numbers of local batches.
+  Index idx(tax, comm, 500 + 300 * comm.rank());
+  build(idx);
+
+  // all k-mers of the 3 genomes:  (5000 - 20) + (5000 - 20 - (2000 - 20)) + (5000 - 20).
+  EXPECT_EQ(12960UL, idx.get_map().size());
+
+  std::vector<KmerType> q;
+  std::string probe = g100.substr(3000 + 100 * comm.rank(), 50);
+  KmerType km;
+  for (size_t i = 0; i < probe.size(); ++i) {
+    km.nextFromChar(bliss::common::DNA::FROM_ASCII[static_cast<unsigned char>(probe[i])]);
+    if (i + 1 >= KmerType::size) q.emplace_back(km);
+  }
+  auto found = idx.get_map().find_aligned(q, 0U);
+  ASSERT_EQ(q.size(), found.size());
+  for (auto const & t : found) EXPECT_EQ(tax.compact(10), t);
+}
+
+TEST_F(TaxonomyIndexTest, classify)
+{
+  Taxonomy tax(tree_nodes());
+  Index idx(tax, comm, 1000);
+  build(idx);
+
+  std::uniform_int_distribution<size_t> own(0, 3000 - 100);
+  std::uniform_int_distribution<size_t> any(0, 5000 - 100);
+  Store reads;
+  std::vector<uint32_t> expected;
+  size_t offset = 0;
+  for (int r = 0; r < 40; ++r) {
+    append(reads, g100.substr(own(gen), 100), offset);
+    expected.emplace_back(100);
+    append(reads, revcomp(g101.substr(own(gen), 100)), offset);
+    expected.emplace_back(101);
+    append(reads, g30.substr(any(gen), 100), offset);
+    expected.emplace_back(30);
+    append(reads, shared.substr(own(gen) % (2000 - 100), 100), offset);
+    expected.emplace_back(10);
+    append(reads, random(100), offset);
+    expected.emplace_back(0);
+  }
+  // even halves of 100 and 101:  a tie goes to the LCA.
+  append(reads, g100.substr(500, 40) + g101.substr(500, 40), offset);
+  expected.emplace_back(10);
+  // shorter than k.
+  append(reads, g100.substr(0, 15), offset);
+  expected.emplace_back(0);
+
+  auto res = idx.classify(reads);
+  ASSERT_EQ(expected.size(), res.size());
+  for (size_t i = 0; i < res.size(); ++i) {
+    EXPECT_EQ(expected[i], res[i].taxon) << "read " << i;
+  }
+  EXPECT_EQ(80U, res[0].kmers);
+  EXPECT_EQ(80U, res[0].hits);
+  EXPECT_EQ(0U, res[4].hits);
+  EXPECT_EQ(60U, res[res.size() - 2].kmers);
+  EXPECT_EQ(40U, res[res.size() - 2].hits);
+  EXPECT_EQ(0U, res.back().kmers);
+}
+
+TEST_F(TaxonomyIndexTest, confidence)
+{
+  Taxonomy tax(tree_nodes());
+  Index idx(tax, comm);
+  build(idx);
+
+  // 30 of 80 k-mers hit 100, a few more if the random half happens to continue the genome.
+  Store reads;
+  size_t offset = 0;
+  append(reads, g100.substr(1000, 50) + random(50), offset);
+
+  auto low = idx.classify(reads, 0.3);
+  ASSERT_EQ(1UL, low.size());
+  EXPECT_EQ(100U, low[0].taxon);
+  EXPECT_GE(low[0].hits, 30U);
+  EXPECT_LT(low[0].hits, 36U);
+
+  auto high = idx.classify(reads, 0.9);
+  EXPECT_EQ(0U, high[0].taxon);
+  EXPECT_EQ(80U, high[0].kmers);
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_index_policy.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test the sorted vs hashed index backend choice.
+ * @details
+ */
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <string>
+
+// include files to test
+#include "index/index_policy.hpp"
+
+using bliss::index::kmer::index_plan;
+using bliss::index::kmer::index_policy;
+
+TEST(IndexPolicy, input_size)
+{
+  index_policy policy;
+
+  // below the sort/hash break even of about 8M per rank.
+  EXPECT_EQ(index_plan::SORTED, policy.choose(1000000UL, 1000000.0, 0, 1, false, 16).backend);
+  EXPECT_EQ(index_plan::DENSEHASH, policy.choose(1000000000UL, 1000000000.0, 0, 1, false, 16).backend);
+
+  // the same input spread over enough ranks sorts.
+  EXPECT_EQ(index_plan::SORTED, policy.choose(1000000000UL, 1000000000.0, 0, 1024, false, 16).backend);
+}
+
+TEST(IndexPolicy, query_mix)
+{
+  index_policy policy;
+
+  // many duplicates:  hashing the tuples is cheaper than sorting them,
+  EXPECT_EQ(index_plan::DENSEHASH, policy.choose(16UL << 20, 1 << 20, 0, 1, false, 16).backend);
+  // but searching the few distinct keys is cheaper than hash probes when queries dominate.
+  index_plan plan = policy.choose(16UL << 20, 1 << 20, 100000000UL, 1, false, 16);
+  EXPECT_EQ(index_plan::SORTED, plan.backend);
+  EXPECT_DOUBLE_EQ(16.0, plan.multiplicity());
+  EXPECT_LT(plan.sorted_cost, plan.hashed_cost);
+}
+
+TEST(IndexPolicy, memory_budget)
+{
+  size_t n = 1000000000UL;
+
+  index_plan plan = index_policy().choose(n, n, 0, 1, true, 16);
+  EXPECT_EQ(index_plan::DENSEHASH, plan.backend);
+  EXPECT_DOUBLE_EQ(2.0 * plan.sorted_bytes, plan.hashed_bytes);
+
+  // the hash tables do not fit, the sorted array does.
+  plan = index_policy(23.0, 0.5, 24 * n).choose(n, n, 0, 1, true, 16);
+  EXPECT_EQ(index_plan::SORTED, plan.backend);
+  EXPECT_NE(std::string::npos, plan.reason.find("memory"));
+
+  // neither fits:  the cost model decides.
+  plan = index_policy(23.0, 0.5, n).choose(n, n, 0, 1, true, 16);
+  EXPECT_EQ(index_plan::DENSEHASH, plan.backend);
+
+  // a map stores one entry per distinct key.
+  plan = index_policy().choose(n, n / 4, 0, 1, false, 16);
+  EXPECT_DOUBLE_EQ(0.5 * plan.sorted_bytes, plan.hashed_bytes);
+}
+
+TEST(IndexPolicy, plan)
+{
+  index_plan plan = index_policy().choose(100, 400.0, 10, 4, true, 16);
+  // distinct estimate is capped by the number of tuples.
+  EXPECT_DOUBLE_EQ(100.0, plan.distinct);
+  EXPECT_DOUBLE_EQ(1.0, plan.multiplicity());
+  EXPECT_EQ(4, plan.ranks);
+
+  std::string s = plan.to_string();
+  EXPECT_NE(std::string::npos, s.find("sorted multimap"));
+  EXPECT_NE(std::string::npos, s.find(plan.reason));
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_kmer_dispatch.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test selection of precompiled k-mer sizes from a runtime k.
+ * @details
+ */
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <string>
+#include <stdexcept>
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "utils/kmer_utils.hpp"
+
+// include files to test
+#include "index/kmer_dispatch.hpp"
+
+
+/// reports the k and storage of the instantiation it runs in, and builds a k-mer from the given sequence.
+template <typename KmerType>
+struct KmerInfo {
+    static std::string run(std::string const & seq, unsigned int & k, unsigned int & words) {
+      k = KmerType::size;
+      words = KmerType::nWords;
+
+      KmerType km(seq);
+      return bliss::utils::KmerUtils::toASCIIString(km);
+    }
+};
+
+
+TEST(KmerDispatch, select)
+{
+  using Sizes = bliss::index::kmer::KmerSizes<15, 21, 31, 33, 63, 95>;
+  std::string seq("ACGTACGTTGCAACGTTTGACCAGTACGATCGACTGATCAGCTAGCTAGGACTGACTGACTACGACTAGCATCGACTTTACGCATGAGGACTACTA");
+
+  for (unsigned int k : Sizes::values()) {
+    unsigned int kk = 0, words = 0;
+    std::string s = bliss::index::kmer::dispatch_k<KmerInfo, bliss::common::DNA, uint64_t>(k, Sizes(), seq, kk, words);
+
+    EXPECT_EQ(k, kk);
+    EXPECT_EQ((2 * k + 63) / 64, words);
+    EXPECT_EQ(seq.substr(0, k), s);
+  }
+}
+
+TEST(KmerDispatch, unsupported)
+{
+  using Sizes = bliss::index::kmer::KmerSizes<21, 31>;
+  unsigned int kk = 0, words = 0;
+  std::string seq("ACGTACGTTGCAACGTTTGACCAGTACGATCGACTGATC");
+
+  EXPECT_FALSE(Sizes::contains(25));
+  EXPECT_THROW((bliss::index::kmer::dispatch_k<KmerInfo, bliss::common::DNA, uint64_t>(25, Sizes(), seq, kk, words)), std::invalid_argument);
+  EXPECT_EQ(0U, kk);
+}
+
+TEST(KmerDispatch, storage_bits)
+{
+  EXPECT_EQ(64U,  (bliss::index::kmer::kmer_storage_bits<31, bliss::common::DNA, uint64_t>::value));
+  EXPECT_EQ(64U,  (bliss::index::kmer::kmer_storage_bits<32, bliss::common::DNA, uint64_t>::value));
+  EXPECT_EQ(128U, (bliss::index::kmer::kmer_storage_bits<33, bliss::common::DNA, uint64_t>::value));
+  EXPECT_EQ(128U, (bliss::index::kmer::kmer_storage_bits<31, bliss::common::DNA16, uint64_t>::value));
+  EXPECT_EQ(192U, (bliss::index::kmer::kmer_storage_bits<95, bliss::common::DNA, uint64_t>::value));
+  EXPECT_EQ(256U, (bliss::index::kmer::kmer_storage_bits<127, bliss::common::DNA, uint64_t>::value));
+}
@@ -41,6 +41,7 @@
 #include "common/kmer.hpp"
 #include "common/alphabets.hpp"
 #include "common/alphabet_traits.hpp"
+#include "common/kmer_iterators.hpp"
 
 
 
@@ -107,6 +108,55 @@ class KmerHashTest : public ::testing::Test {
       EXPECT_TRUE(same);
 
     }
+
+    template <template <typename, bool> class H>
+    void batch_vector(std::string name) {
+      H<T, false> op;
+      H<T, true> pop;
+      size_t n = this->iterations - 5;   // not a multiple of the vector width
+      std::vector<uint64_t> out(n), pout(n);
+      op.hash(this->kmers.data() + 1, n, out.data());
+      pop.hash(this->kmers.data() + 1, n, pout.data());
+
+      for (size_t i = 0; i < n; ++i) {
+        ASSERT_EQ(op(this->kmers[i + 1]), out[i]) << name << " at " << i;
+        ASSERT_EQ(pop(this->kmers[i + 1]), pout[i]) << name << " prefix at " << i;
+      }
+    }
+
+    template <template <typename, bool> class H>
+    void spread_vector(std::string name) {
+      // AT rich background, every 4th block replaced by a copy of a motif with 5% mutations.
+      std::default_random_engine gen(11);
+      std::discrete_distribution<int> skewed{40, 10, 10, 40};
+      std::uniform_int_distribution<int> uni(0, 3);
+      std::uniform_int_distribution<int> pct(0, 99);
+      std::vector<int> motif(97);
+      for (auto & c : motif) c = skewed(gen);
+
+      // small k have few distinct k-mers.  stop when the set stops growing.
+      std::set<T> uniq;
+      T kmer;
+      for (size_t i = 0; (uniq.size() < this->iterations) && (i < 4 * this->iterations); ++i) {
+        int c = ((i / motif.size()) % 4 == 0) ? ((pct(gen) < 5) ? uni(gen) : motif[i % motif.size()]) : skewed(gen);
+        kmer.nextFromChar(c % T::KmerAlphabet::SIZE);
+        if (i >= T::size) uniq.emplace(kmer);
+      }
+
+      H<T, true> op;
+      for (size_t p : {7, 64, 1000, 4099}) {
+        if (uniq.size() < 5 * p) continue;  // chi-squared needs at least 5 per bucket.
+
+        std::vector<size_t> counts(p, 0);
+        for (auto const & km : uniq) ++counts[op(km) % p];
+
+        double mean = static_cast<double>(uniq.size()) / static_cast<double>(p);
+        double chi2 = 0;
+        for (auto c : counts) chi2 += (c - mean) * (c - mean) / mean;
+        double df = static_cast<double>(p - 1);
+        EXPECT_LT(chi2, df + 6.0 * std::sqrt(2.0 * df)) << name << " with " << p << " buckets";
+      }
+    }
 };
 
 template <typename T>
@@ -118,6 +168,10 @@ template <typename T>
 std::set<T> KmerHashTest<T>::unique_kmers;
 
 
+/// forward strand ntHash, with the 2 parameter signature of the other hashes.
+template <typename KMER, bool Prefix>
+using nthash_forward = bliss::kmer::hash::nthash<KMER, Prefix, false>;
+
 // indicate this is a typed test
 TYPED_TEST_CASE_P(KmerHashTest);
 
@@ -127,14 +181,121 @@ TYPED_TEST_P(KmerHashTest, hash)
 	this->template hash_vector<bliss::kmer::hash::identity>(std::string("identity"));
 	this->template hash_vector<bliss::kmer::hash::murmur  >(std::string("murmur"));
 	this->template hash_vector<bliss::kmer::hash::farm    >(std::string("farm"));
+	this->template hash_vector<bliss::kmer::hash::mix     >(std::string("mix"));
+	this->template hash_vector<bliss::kmer::hash::multiply_shift>(std::string("multiply_shift"));
+}
+
+/// batch hash should give the same values as per k-mer hashing, including the scalar tail.
+TYPED_TEST_P(KmerHashTest, batch)
+{
+  this->template batch_vector<bliss::kmer::hash::cpp_std >(std::string("cpp_std"));
+  this->template batch_vector<bliss::kmer::hash::identity>(std::string("identity"));
+  this->template batch_vector<bliss::kmer::hash::murmur  >(std::string("murmur"));
+  this->template batch_vector<bliss::kmer::hash::farm    >(std::string("farm"));
+  this->template batch_vector<bliss::kmer::hash::mix     >(std::string("mix"));
+  this->template batch_vector<bliss::kmer::hash::multiply_shift>(std::string("multiply_shift"));
+  this->template batch_vector<nthash_forward>(std::string("nthash"));
+#if defined(__SSE4_2__)
+  this->template batch_vector<bliss::kmer::hash::crc32c  >(std::string("crc32c"));
+#endif
+}
+
+/// distribution hashes only need a good bucket spread.  check hash % p on unique k-mers from skewed, genome like
+/// sequence:  AT rich, with a mutated tandem repeat.  chi-squared should be within 6 standard deviations of p - 1.
+TYPED_TEST_P(KmerHashTest, spread)
+{
+  this->template spread_vector<bliss::kmer::hash::murmur  >(std::string("murmur"));
+  this->template spread_vector<bliss::kmer::hash::farm    >(std::string("farm"));
+  this->template spread_vector<bliss::kmer::hash::mix     >(std::string("mix"));
+  this->template spread_vector<bliss::kmer::hash::multiply_shift>(std::string("multiply_shift"));
+  this->template spread_vector<nthash_forward>(std::string("nthash"));
+#if defined(__SSE4_2__)
+  this->template spread_vector<bliss::kmer::hash::crc32c  >(std::string("crc32c"));
+#endif
+}
+
+/// minimizer hash is not unique per k-mer.  check strand invariance, that the minimizer occurs in the k-mer,
+/// and that consecutive k-mers mostly share the minimizer.
+TYPED_TEST_P(KmerHashTest, minimizer)
+{
+  using MinHash = bliss::kmer::hash::minimizer<TypeParam, true>;
+  MinHash op;
+  constexpr unsigned int m = (TypeParam::size < 15) ? TypeParam::size : 15;
+
+  size_t changes = 0;
+  uint64_t last = 0;
+  for (size_t i = 0; i < this->iterations; ++i) {
+    TypeParam const & km = this->kmers[i];
+    uint64_t mm = op.get_minimizer(km);
+
+    ASSERT_EQ(op(km), op(km.reverse_complement())) << " at " << i;
+    ASSERT_EQ(mm, op.get_minimizer(km.reverse_complement())) << " at " << i;
+
+    // the minimizer is one of the canonical m-mers
+    bool found = false;
+    for (unsigned int s = 0; (s + m) <= TypeParam::size && !found; ++s) {
+      uint64_t f = 0, r = 0, c;
+      for (unsigned int j = 0; j < m; ++j) {
+        c = km.getCharsAtPos(TypeParam::size - 1 - s - j, 1);
+        f = (f << TypeParam::bitsPerChar) | c;
+        r |= static_cast<uint64_t>(TypeParam::KmerAlphabet::to_complement(c)) << (j * TypeParam::bitsPerChar);
+      }
+      found = (mm == ((f < r) ? f : r));
+    }
+    ASSERT_TRUE(found) << " at " << i;
+
+    if ((i > 0) && (mm != last)) ++changes;
+    last = mm;
+  }
+
+  // with window of k-m+1 m-mers, the minimizer changes about 2/(k-m+2) of the time.  check there is locality.
+  if ((TypeParam::size - m) >= 8) {
+    EXPECT_LT(changes, this->iterations / 2);
+  }
 }
 
 
 
 
+/// rolling ntHash should match hashing each k-mer from scratch, both by roll() and in the generation iterator,
+/// and the canonical variant should be the same on both strands.
+TYPED_TEST_P(KmerHashTest, nthash)
+{
+  bliss::kmer::hash::nthash<TypeParam, true, true> canon;
+  nthash_forward<TypeParam, true> fwd;
+
+  auto cst = canon.init(this->kmers[0]);
+  auto fst = fwd.init(this->kmers[0]);
+  for (size_t i = 1; i < this->iterations; ++i) {
+    TypeParam const & km = this->kmers[i];
+    uint64_t out = this->kmers[i - 1].getCharsAtPos(TypeParam::size - 1, 1);
+    uint64_t in = km.getCharsAtPos(0, 1);
+    canon.roll(cst, out, in);
+    fwd.roll(fst, out, in);
+
+    ASSERT_EQ(canon(km), canon.value(cst)) << " at " << i;
+    ASSERT_EQ(fwd(km), fwd.value(fst)) << " at " << i;
+    ASSERT_EQ(canon(km), canon(km.reverse_complement())) << " at " << i;
+  }
+
+  // same from the generation iterator, over the characters of a read.
+  std::vector<uint8_t> read(TypeParam::size + 999);
+  srand(23);
+  for (auto & c : read) c = rand() % TypeParam::KmerAlphabet::SIZE;
+
+  using KmerIter = bliss::common::KmerGenerationIterator<std::vector<uint8_t>::iterator, TypeParam>;
+  using HashIter = bliss::common::RollingHashKmerGenerationIterator<std::vector<uint8_t>::iterator, TypeParam,
+      bliss::kmer::hash::nthash<TypeParam, true, true> >;
+  KmerIter kit(read.begin(), true);
+  HashIter hit(read.begin(), true);
+  for (size_t i = 0; i < 1000; ++i, ++kit, ++hit) {
+    ASSERT_EQ(*kit, (*hit).first) << " at " << i;
+    ASSERT_EQ(canon(*kit), (*hit).second) << " at " << i;
+  }
+}
 
 
-REGISTER_TYPED_TEST_CASE_P(KmerHashTest, hash);
+REGISTER_TYPED_TEST_CASE_P(KmerHashTest, hash, batch, spread, minimizer, nthash);
 
 //////////////////// RUN the tests with different types.
 
@@ -435,3 +435,52 @@ TEST(QualityScoreGeneration, TestIllunima15QualityScoreFloat)
 
 }
 
+
+
+template <typename StoreT, typename Codec>
+void testQuantizedCodec() {
+  using QCodec = bliss::index::QuantizedQualityScoreCodec<StoreT, Codec>;
+
+  // p = 0 (incorrect base) and p = 1 are at the ends of the range.
+  EXPECT_EQ(0, QCodec::encode_prob(0.0));
+  EXPECT_EQ(0.0, QCodec::decode_prob(0));
+  EXPECT_LT(1.0 - 1e-9, QCodec::decode_prob(QCodec::encode_prob(1.0)));
+
+  // monotonic in p, and decode/encode round trips.
+  StoreT prev = 0;
+  for (double phred = 0.25; phred < 90.0; phred += 0.5) {
+    double p = 1.0 - std::pow(10.0, phred / -10.0);
+    StoreT v = QCodec::encode_prob(p);
+
+    EXPECT_LE(prev, v);
+    EXPECT_EQ(v, QCodec::encode_prob(QCodec::decode_prob(v)));
+
+    // error in phred score is at most half of a quantization step.
+    double dphred = -10.0 * std::log10(1.0 - QCodec::decode_prob(v));
+    EXPECT_NEAR(phred, dphred, 0.5 / static_cast<double>(1U << QCodec::fraction_bits) + 1e-6);
+
+    prev = v;
+  }
+  EXPECT_LE(prev, QCodec::encode_prob(1.0));
+}
+
+/**
+ * quantized k-mer quality storage
+ */
+TEST(QualityScoreGeneration, TestQuantizedQualityScore8)
+{
+  testQuantizedCodec<uint8_t, bliss::index::Illumina18QualityScoreCodec<double> >();
+
+  // 8 bit storage is the codec's LUT index, so integer phred scores map to the quality characters.
+  using QCodec = bliss::index::QuantizedIllumina18QualityScoreCodec<uint8_t>;
+  for (unsigned char c = 34; c < 127; ++c) {
+    double p = std::exp2(QCodec::codec_type::decode(c));
+    EXPECT_EQ(c - 33, QCodec::encode_prob(p));
+    EXPECT_NEAR(p, QCodec::decode_prob(c - 33), 1e-15);
+  }
+}
+
+TEST(QualityScoreGeneration, TestQuantizedQualityScore16)
+{
+  testQuantizedCodec<uint16_t, bliss::index::Illumina18QualityScoreCodec<double> >();
+}
@@ -30,7 +30,9 @@
 
 // include classes to test
 #include "index/quality_score_iterator.hpp"
+#include "index/quality_score_window.hpp"
 #include <vector>
+#include <random>
 #include <algorithm>
 #include <cassert>
 #include "utils/logging.h"
@@ -337,6 +339,20 @@ void testQualityIterator(const std::string & strdata) {
   EXPECT_TRUE(same);
 
 
+  // test bulk scoring, with the best available and the scalar decoder.
+  std::vector<OT> windowDecoded;
+  bliss::index::KmerQualityScorer<K, Encoder> scorer;
+  scorer(gold.data(), gold.size(), windowDecoded);
+  same = compare_vectors<OT>(windowDecoded, goldDecoded);
+  if (!same) BL_ERROR( "window decode: result not same" );
+  EXPECT_TRUE(same);
+
+  bliss::index::KmerQualityScorer<K, Encoder, bliss::index::quality_prefix_sum<Encoder> > seq_scorer;
+  seq_scorer(gold.data(), gold.size(), windowDecoded);
+  same = compare_vectors<OT>(windowDecoded, goldDecoded);
+  if (!same) BL_ERROR( "scalar window decode: result not same" );
+  EXPECT_TRUE(same);
+
 }
 
 
@@ -439,3 +455,94 @@ TEST(QualityScoreGenerationIteratorTest, TestIllunima18QualityScoreFloat)
 //
 //}
 //
+
+
+/**
+ * bulk scoring of long reads, against scores computed directly in long double.  includes incorrect bases ('!')
+ * and remainders of the SIMD blocks.  the iterator's running sum drifts over long reads, so it is not the reference here.
+ */
+template <typename OT, unsigned int K>
+void testQualityWindowLong() {
+  using Encoder = bliss::index::Illumina18QualityScoreCodec<OT>;
+
+  std::default_random_engine gen(K);
+  std::uniform_int_distribution<int> qdist('"', 'J');
+  std::uniform_int_distribution<int> bad(0, 199);
+
+  bliss::index::KmerQualityScorer<K, Encoder> scorer;
+  std::vector<OT> windowDecoded;
+
+  // relative error bound
+  const long double eps = std::is_same<OT, float>::value ? 1.0e-6L : 1.0e-12L;
+
+  for (size_t len : {K, K + 1, 33U + K, 100U, 151U, 1000U}) {
+    std::vector<unsigned char> data(len);
+    for (size_t i = 0; i < len; ++i) {
+      data[i] = (bad(gen) == 0) ? '!' : qdist(gen);
+    }
+
+    scorer(data.data(), data.size(), windowDecoded);
+    ASSERT_EQ(len - K + 1, windowDecoded.size());
+
+    for (size_t i = 0; i < windowDecoded.size(); ++i) {
+      long double sum = 0;
+      bool valid = true;
+      for (size_t j = i; j < i + K; ++j) {
+        if (data[j] == '!') valid = false;
+        else sum += static_cast<long double>(Encoder::decode(data[j]));
+      }
+      long double expected = valid ? std::exp2(sum) : 0.0L;
+
+      EXPECT_LE(std::fabs(expected - windowDecoded[i]), eps * expected) << "length " << len << " pos " << i;
+    }
+  }
+}
+
+TEST(QualityScoreGenerationIteratorTest, TestQualityWindowLong)
+{
+  testQualityWindowLong<double, 21>();
+  testQualityWindowLong<double, 31>();
+  testQualityWindowLong<float, 31>();
+  testQualityWindowLong<double, 63>();
+}
+
+
+/**
+ * bulk scoring into quantized storage is the quantized double score.
+ */
+template <typename StoreT, unsigned int K>
+void testQualityWindowQuantized() {
+  using Encoder = bliss::index::Illumina18QualityScoreCodec<double>;
+  using QEncoder = bliss::index::QuantizedIllumina18QualityScoreCodec<StoreT>;
+
+  std::default_random_engine gen(K);
+  std::uniform_int_distribution<int> qdist('"', 'J');
+  std::uniform_int_distribution<int> bad(0, 199);
+
+  bliss::index::KmerQualityScorer<K, Encoder> scorer;
+  bliss::index::KmerQualityScorer<K, QEncoder> qscorer;
+  std::vector<double> decoded;
+  std::vector<StoreT> quantized;
+
+  for (size_t len : {K, 100U, 151U}) {
+    std::vector<unsigned char> data(len);
+    for (size_t i = 0; i < len; ++i) {
+      data[i] = (bad(gen) == 0) ? '!' : qdist(gen);
+    }
+
+    scorer(data.data(), data.size(), decoded);
+    qscorer(data.data(), data.size(), quantized);
+    ASSERT_EQ(decoded.size(), quantized.size());
+
+    for (size_t i = 0; i < decoded.size(); ++i) {
+      EXPECT_EQ(QEncoder::encode_prob(decoded[i]), quantized[i]) << "length " << len << " pos " << i;
+    }
+  }
+}
+
+TEST(QualityScoreGenerationIteratorTest, TestQualityWindowQuantized)
+{
+  testQualityWindowQuantized<uint8_t, 21>();
+  testQualityWindowQuantized<uint16_t, 21>();
+  testQualityWindowQuantized<uint16_t, 31>();
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    bucket_spill.hpp
+ * @ingroup io
+ * @author  tpan
+ * @brief   per-bucket temporary files, for building distributed maps from more k-mers than fit in memory.
+ * @details elements are appended to one file per bucket (typically per destination rank) through small write buffers,
+ *          then read back in bounded slices.  a round that takes at most m elements from every bucket sends at most
+ *          m to each rank and so receives at most m * p, which gives the exchange a hard memory bound independent of
+ *          how skewed the input partitions are.
+ *
+ *          files are created with mkstemp in the spill directory (e.g. node-local SSD) and unlinked right away,
+ *          so they disappear when the object is destroyed or the process exits.  elements are stored as raw bytes.
+ */
+#ifndef SRC_IO_BUCKET_SPILL_HPP_
+#define SRC_IO_BUCKET_SPILL_HPP_
+
+#include <cstdlib>      // mkstemp
+#include <cassert>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>      // strerror
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <utility>      // pair
+#include <unistd.h>     // pread, pwrite, unlink, close
+
+#include "io/io_exception.hpp"
+#include "utils/exception_handling.hpp"
+
+namespace bliss
+{
+  namespace io
+  {
+
+    namespace detail {
+      /// plain data that can be stored as bytes.  Kmer and std::pair have user defined assignment, so
+      /// trivial destructibility is used as the check, as for map segment files.
+      template <typename V>
+      struct is_spillable : public ::std::integral_constant<bool, ::std::is_trivially_destructible<V>::value> {};
+      template <typename A, typename B>
+      struct is_spillable<::std::pair<A, B> > : public ::std::integral_constant<bool,
+        is_spillable<A>::value && is_spillable<B>::value> {};
+    } // namespace detail
+
+    /**
+     * @brief  append-then-read temporary storage, one file per bucket.
+     * @tparam V  element type.  plain data, e.g. k-mers or pairs of k-mers and counts.
+     */
+    template <typename V>
+    class bucket_spill {
+        static_assert(detail::is_spillable<V>::value, "bucket_spill stores elements as bytes");
+
+      protected:
+        ::std::vector<int> fds;
+        /// elements per write buffer.
+        size_t buffer_elems;
+        ::std::vector<::std::vector<V> > buffers;
+        /// elements written to each file, and elements read back from each.
+        ::std::vector<size_t> written;
+        ::std::vector<size_t> consumed;
+
+        static void fail(char const * what, int err) {
+          ::std::stringstream ss;
+          ss << "ERROR: bucket_spill: " << what << ": " << strerror(err);
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+        }
+
+        void write_buffer(size_t b) {
+          ::std::vector<V> & buf = buffers[b];
+          char const * ptr = reinterpret_cast<char const *>(buf.data());
+          size_t rem = buf.size() * sizeof(V);
+          off_t off = written[b] * sizeof(V);
+          while (rem > 0) {
+            ssize_t n = pwrite(fds[b], ptr, rem, off);
+            if (n <= 0) fail("write failed", errno);
+            ptr += n;
+            off += n;
+            rem -= n;
+          }
+          written[b] += buf.size();
+          buf.clear();
+        }
+
+        void close_all() {
+          for (int fd : fds) if (fd != -1) close(fd);
+          fds.clear();
+        }
+
+      public:
+        /**
+         * @param dir            directory for the temporary files.
+         * @param nbuckets       number of buckets.
+         * @param buffer_bytes   memory for write buffers, shared by all buckets.  at least 1 element per bucket.
+         */
+        bucket_spill(::std::string const & dir, size_t const nbuckets, size_t const buffer_bytes = (1UL << 24)) :
+          fds(nbuckets, -1),
+          buffer_elems(::std::max(static_cast<size_t>(1), buffer_bytes / (::std::max(nbuckets, static_cast<size_t>(1)) * sizeof(V)))),
+          buffers(nbuckets), written(nbuckets, 0), consumed(nbuckets, 0) {
+          if (nbuckets == 0) throw ::std::invalid_argument("ERROR: bucket_spill: number of buckets is 0");
+
+          ::std::string templ = (dir.empty() ? ::std::string(".") : dir) + "/bliss_spill_XXXXXX";
+          ::std::vector<char> name(templ.size() + 1);
+          for (size_t b = 0; b < nbuckets; ++b) {
+            ::std::copy(templ.begin(), templ.end(), name.begin());
+            name[templ.size()] = 0;
+            int fd = mkstemp(name.data());
+            if (fd == -1) {
+              int err = errno;
+              close_all();
+              fail(("unable to create temporary file in " + dir).c_str(), err);
+            }
+            unlink(name.data());  // storage is released on close.
+            fds[b] = fd;
+            buffers[b].reserve(buffer_elems);
+          }
+        }
+
+        bucket_spill(bucket_spill const &) = delete;
+        bucket_spill & operator=(bucket_spill const &) = delete;
+
+        ~bucket_spill() { close_all(); }
+
+        size_t num_buckets() const { return buffers.size(); }
+
+        /// append elements to their buckets.  to_bucket returns a bucket id in [0, num_buckets).
+        template <typename ToBucket>
+        void append(::std::vector<V> const & input, ToBucket const & to_bucket) {
+          for (auto const & x : input) {
+            size_t b = to_bucket(x);
+            assert((b < buffers.size()) && "bucket id is not valid");
+            buffers[b].emplace_back(x);
+            if (buffers[b].size() == buffer_elems) write_buffer(b);
+          }
+        }
+
+        /// write out all buffered elements.  call before reading.
+        void flush() {
+          for (size_t b = 0; b < buffers.size(); ++b) {
+            if (!buffers[b].empty()) write_buffer(b);
+          }
+        }
+
+        /// elements in bucket b, written or buffered.
+        size_t size(size_t b) const { return written[b] + buffers[b].size(); }
+
+        /// flushed elements in bucket b that have not been read.
+        size_t remaining(size_t b) const { return written[b] - consumed[b]; }
+
+        /**
+         * @brief  read the next elements of bucket b, appending to output.
+         * @return number of elements read, at most max_elems.
+         */
+        size_t read(size_t b, size_t const max_elems, ::std::vector<V> & output) {
+          size_t count = ::std::min(max_elems, remaining(b));
+          if (count == 0) return 0;
+
+          size_t start = output.size();
+          output.resize(start + count);
+          char * ptr = reinterpret_cast<char *>(output.data() + start);
+          size_t rem = count * sizeof(V);
+          off_t off = consumed[b] * sizeof(V);
+          while (rem > 0) {
+            ssize_t n = pread(fds[b], ptr, rem, off);
+            if (n <= 0) fail("read failed", (n == 0) ? EIO : errno);
+            ptr += n;
+            off += n;
+            rem -= n;
+          }
+          consumed[b] += count;
+          return count;
+        }
+
+        /// start reading all buckets from the beginning again.
+        void rewind() {
+          ::std::fill(consumed.begin(), consumed.end(), 0);
+        }
+    };
+
+  } // namespace io
+} // namespace bliss
+
+#endif /* SRC_IO_BUCKET_SPILL_HPP_ */
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    byte_wire.hpp
+ * @ingroup io
+ * @author  tpan
+ * @brief   send trivially copyable tuples as blocks of sizeof(T) bytes instead of as mxx struct datatypes.
+ * @details mxx builds std::pair<Kmer, T> and nested tuples as struct datatypes that describe each member and the
+ *          padding between them.  MPI implementations pack such types member by member, which is much slower than
+ *          copying the bytes.  a type for which as_bytes<T> is true is instead sent as a contiguous MPI type of
+ *          sizeof(T) MPI_BYTEs, padding included.  sender and receiver must have the same layout of T, which holds for
+ *          ranks of the same build on the same architecture.
+ *
+ *          opt-in:  specialize as_bytes<T> to ::std::true_type, or build with USE_BYTE_WIRE to turn it on for every
+ *          trivially copyable type.  the MPI types are created once per T and freed at MPI_Finalize.
+ *
+ *          used by imxx::wire_all2allv, and so by imxx::distribute and imxx::undistribute.
+ *
+ *          packs_smaller<V> marks the std::pairs that have padding, e.g. std::pair<Kmer<31, DNA, uint64_t>, uint32_t>
+ *          of 16 bytes with 4 of padding.  with USE_PACKED_ENTRIES, imxx::packed_entry_all2allv sends them as
+ *          ::bliss::common::packed_pair instead, without the padding.
+ */
+#ifndef SRC_IO_BYTE_WIRE_HPP_
+#define SRC_IO_BYTE_WIRE_HPP_
+
+#include <mpi.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>    // pair
+#include <vector>
+
+namespace bliss {
+  namespace io {
+    namespace wire {
+
+      /// true:  T is sent as sizeof(T) bytes.  see file description.
+      template <typename T, typename Enable = void>
+      struct as_bytes : public ::std::integral_constant<bool,
+#if defined(USE_BYTE_WIRE)
+        ::std::is_trivially_copyable<T>::value
+#else
+        false
+#endif
+      > {};
+
+      /// true:  V is a std::pair of flat types with padding, and is smaller as a packed_pair.
+      template <typename V>
+      struct packs_smaller : public ::std::false_type {};
+      template <typename A, typename B>
+      struct packs_smaller<::std::pair<A, B> > : public ::std::integral_constant<bool,
+        (sizeof(::std::pair<A, B>) > (sizeof(A) + sizeof(B))) &&
+        ::std::is_trivially_destructible<A>::value && ::std::is_trivially_destructible<B>::value> {};
+
+      namespace detail {
+
+        /// N bytes, trivially copyable.  a view of flat entries, e.g. k-mer tuples, for byte_all2allv.
+        template <size_t N>
+        struct byte_block {
+            uint8_t bytes[N];
+        };
+
+        inline int free_byte_types(MPI_Comm, int, void * attr, void *) {
+          ::std::vector<MPI_Datatype> * types = static_cast<::std::vector<MPI_Datatype> *>(attr);
+          for (auto & t : *types) MPI_Type_free(&t);
+          delete types;
+          return MPI_SUCCESS;
+        }
+
+        /// committed contiguous type of bytes MPI_BYTEs.  freed with the attributes of MPI_COMM_SELF in MPI_Finalize.
+        inline MPI_Datatype make_byte_type(size_t const & bytes) {
+          static int keyval = MPI_KEYVAL_INVALID;
+          if (keyval == MPI_KEYVAL_INVALID) MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, free_byte_types, &keyval, nullptr);
+
+          void * attr = nullptr;
+          int found = 0;
+          MPI_Comm_get_attr(MPI_COMM_SELF, keyval, &attr, &found);
+          if (!found) {
+            attr = new ::std::vector<MPI_Datatype>();
+            MPI_Comm_set_attr(MPI_COMM_SELF, keyval, attr);
+          }
+
+          MPI_Datatype dt;
+          MPI_Type_contiguous(static_cast<int>(bytes), MPI_BYTE, &dt);
+          MPI_Type_commit(&dt);
+          static_cast<::std::vector<MPI_Datatype> *>(attr)->emplace_back(dt);
+          return dt;
+        }
+
+      }  // namespace detail
+
+      /// cached MPI type of sizeof(T) bytes.  the first call for each T creates it, on the thread that makes MPI calls.
+      template <typename T>
+      MPI_Datatype byte_datatype() {
+        static MPI_Datatype dt = detail::make_byte_type(sizeof(T));
+        return dt;
+      }
+
+    }  // namespace wire
+  }  // namespace io
+}  // namespace bliss
+
+#endif  // SRC_IO_BYTE_WIRE_HPP_
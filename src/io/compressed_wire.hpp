@@ -0,0 +1,154 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    compressed_wire.hpp
+ * @ingroup io
+ * @author  tpan
+ * @brief   optional deflate compression of all2all buckets, for bandwidth bound exchanges.
+ * @details after bucketing (and sorting within a bucket), large buckets of k-mer tuples compress well.  each bucket is
+ *          encoded as a 1 byte tag followed by either the raw bytes or a zlib deflate stream at a fast level.  buckets
+ *          smaller than the threshold, or that do not shrink, are sent raw, so the cost for small exchanges is 1 byte.
+ *
+ *          runtime settings, so the same binary can be benchmarked with and without:
+ *            BLISS_A2A_COMPRESS=1          enable.  off by default.
+ *            BLISS_A2A_COMPRESS_MIN=bytes  smallest bucket to compress.  default 64KB.
+ *            BLISS_A2A_COMPRESS_LEVEL=n    zlib level, 1 (fastest) to 9.  default 1.
+ *          or set bliss::io::compress::settings() directly.  the setting must be the same on all ranks of a communicator.
+ *
+ *          used by imxx::compressed_all2allv.  needs zlib.  compression is only available when built with USE_ZLIB;
+ *          otherwise settings().enabled is ignored.
+ */
+#ifndef SRC_IO_COMPRESSED_WIRE_HPP_
+#define SRC_IO_COMPRESSED_WIRE_HPP_
+
+#include <cstdint>
+#include <cstdlib>    // getenv, strtoul
+#include <cstring>    // memcpy
+#include <stdexcept>
+#include <algorithm>  // max
+
+#if defined(USE_ZLIB)
+#include <zlib.h>
+#endif
+
+namespace bliss {
+  namespace io {
+    namespace compress {
+
+      /// runtime settings for compressed all2allv.
+      struct options {
+          bool enabled;
+          /// buckets with fewer bytes are sent raw.
+          size_t min_bytes;
+          int level;
+      };
+
+      namespace detail {
+
+        inline options from_env() {
+          options o;
+          o.enabled = false;
+          o.min_bytes = 64 * 1024;
+          o.level = 1;
+
+          char const * e = getenv("BLISS_A2A_COMPRESS");
+          if (e != nullptr) o.enabled = (strtoul(e, nullptr, 10) != 0);
+          e = getenv("BLISS_A2A_COMPRESS_MIN");
+          if (e != nullptr) o.min_bytes = strtoul(e, nullptr, 10);
+          e = getenv("BLISS_A2A_COMPRESS_LEVEL");
+          if (e != nullptr) o.level = static_cast<int>(strtoul(e, nullptr, 10));
+          if (o.level < 1) o.level = 1;
+          if (o.level > 9) o.level = 9;
+          return o;
+        }
+
+      } // namespace detail
+
+      /// process wide settings, read from the environment on first use.
+      inline options & settings() {
+        static options o = detail::from_env();
+        return o;
+      }
+
+      /// true if all2allv should compress.  false when built without zlib.
+      inline bool active() {
+#if defined(USE_ZLIB)
+        return settings().enabled;
+#else
+        return false;
+#endif
+      }
+
+      /// tags for the first byte of an encoded bucket.
+      enum : uint8_t { RAW = 0, DEFLATE = 1 };
+
+      /// most bytes an encoded bucket of n bytes can take.
+      inline size_t max_bytes(size_t const & n) {
+#if defined(USE_ZLIB)
+        return 1 + ::std::max(n, static_cast<size_t>(compressBound(n)));
+#else
+        return 1 + n;
+#endif
+      }
+
+      /**
+       * @brief  encode n bytes of src into out, which has room for max_bytes(n).
+       * @return number of bytes written.
+       */
+      inline size_t encode(uint8_t const * src, size_t const & n, uint8_t * out, options const & o = settings()) {
+#if defined(USE_ZLIB)
+        if (n >= o.min_bytes) {
+          uLongf len = compressBound(n);
+          if ((compress2(out + 1, &len, src, n, o.level) == Z_OK) && (len < n)) {
+            out[0] = DEFLATE;
+            return 1 + len;
+          }
+        }
+#endif
+        out[0] = RAW;
+        if (n > 0) memcpy(out + 1, src, n);
+        return 1 + n;
+      }
+
+      /**
+       * @brief  decode a bucket of bytes bytes from in into out, which expects exactly n bytes.
+       * @details throws if the bucket is corrupt or does not hold n bytes.
+       */
+      inline void decode(uint8_t const * in, size_t const & bytes, uint8_t * out, size_t const & n) {
+        if (bytes == 0) throw ::std::invalid_argument("compress::decode: empty bucket");
+
+        if (in[0] == RAW) {
+          if ((bytes - 1) != n) throw ::std::invalid_argument("compress::decode: raw bucket size mismatch");
+          if (n > 0) memcpy(out, in + 1, n);
+          return;
+        }
+#if defined(USE_ZLIB)
+        if (in[0] == DEFLATE) {
+          uLongf len = n;
+          if ((uncompress(out, &len, in + 1, bytes - 1) != Z_OK) || (len != n))
+            throw ::std::invalid_argument("compress::decode: corrupt deflate bucket");
+          return;
+        }
+#endif
+        throw ::std::invalid_argument("compress::decode: unknown bucket tag");
+      }
+
+    } // namespace compress
+  } // namespace io
+} // namespace bliss
+
+#endif // SRC_IO_COMPRESSED_WIRE_HPP_
@@ -0,0 +1,333 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    dust_filter.hpp
+ * @ingroup io
+ * @author  tpan
+ * @brief   low complexity (DUST) masking of sequences, as a split predicate and a sequence predicate.
+ * @details microsatellites and homopolymers produce many copies of a few k-mers, which load the ranks that own them
+ *          and bloat the position multimaps.  dust_masker marks the characters of a sequence that lie in a window
+ *          of window bases whose DUST score is above threshold, as dustmasker does:  with c_t the count of triplet t
+ *          in the window and l the number of triplets, the score is sum_t c_t (c_t - 1) / 2 / (l - 1).  a homopolymer
+ *          window of 64 scores 31, a random one about 0.5.  the default threshold 2.0 is dustmasker's level 20.
+ *
+ *          the characters are classified 16 (SSE2) or 32 (AVX2) at a time into 2 bit codes, EOL and others;  the
+ *          window score is then updated in O(1) per base.  non-ACGT characters are masked and end a scoring segment;
+ *          EOL characters are skipped, and take the mask of the character before.
+ *
+ *          DustSplitSequencesIterator splits the reads at the masked characters, as NSplitSequencesIterator splits
+ *          at N, so the k-mers that overlap a low complexity region are never generated, exchanged or stored.  it can
+ *          be given to the KmerFileHelper readers and Index::build_* in place of NSplitSequencesIterator.
+ *          DustFilterSequencesIterator instead drops the reads with more than half of the bases masked.
+ */
+#ifndef SRC_IO_DUST_FILTER_HPP_
+#define SRC_IO_DUST_FILTER_HPP_
+
+#include "io/filtered_sequence_iterator.hpp"
+#include "common/dna_encoder.hpp"  // is_contiguous_char_iterator
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace bliss
+{
+
+  namespace io
+  {
+
+    /**
+     * @brief  classify characters for dust_masker:  0-3 for A, C, T, G (either case), 4 for EOL, 5 for the others.
+     * @details  the base codes are (c >> 1) & 3, which differ for the 4 bases.  scalar version.
+     */
+    template <bool SIMD = false>
+    struct dust_encode {
+        static constexpr uint8_t eol = 4;
+        static constexpr uint8_t other = 5;
+
+        static uint8_t code(unsigned char const & c) {
+          unsigned char l = c | 0x20;
+          if ((l == 'a') || (l == 'c') || (l == 'g') || (l == 't')) return (c >> 1) & 0x3;
+          return ((c == '\n') || (c == '\r')) ? eol : other;
+        }
+
+        static void encode(unsigned char const * b, unsigned char const * e, uint8_t * out) {
+          for (; b < e; ++b, ++out) *out = code(*b);
+        }
+    };
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    /// SIMD version.  classifies 32 (AVX2) or 16 (SSE2) characters per iteration with compares and masks.
+    template <>
+    struct dust_encode<true> {
+        static constexpr uint8_t eol = 4;
+        static constexpr uint8_t other = 5;
+
+        static void encode(unsigned char const * b, unsigned char const * e, uint8_t * out) {
+#if defined(__AVX2__)
+          const __m256i lower = _mm256_set1_epi8(0x20);
+          const __m256i three = _mm256_set1_epi8(0x3);
+          const __m256i a = _mm256_set1_epi8('a'), c = _mm256_set1_epi8('c'), g = _mm256_set1_epi8('g'), t = _mm256_set1_epi8('t');
+          const __m256i lf = _mm256_set1_epi8('\n'), cr = _mm256_set1_epi8('\r');
+          const __m256i eols = _mm256_set1_epi8(eol), others = _mm256_set1_epi8(other);
+          for (; (b + 32) <= e; b += 32, out += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(b));
+            __m256i l = _mm256_or_si256(v, lower);
+            __m256i base = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(l, a), _mm256_cmpeq_epi8(l, c)),
+                                           _mm256_or_si256(_mm256_cmpeq_epi8(l, g), _mm256_cmpeq_epi8(l, t)));
+            __m256i is_eol = _mm256_or_si256(_mm256_cmpeq_epi8(v, lf), _mm256_cmpeq_epi8(v, cr));
+            // 16 bit shift:  the bit shifted in from the next byte is masked off.
+            __m256i code = _mm256_and_si256(_mm256_srli_epi16(v, 1), three);
+            __m256i rest = _mm256_blendv_epi8(others, eols, is_eol);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), _mm256_blendv_epi8(rest, code, base));
+          }
+#endif
+          const __m128i lower16 = _mm_set1_epi8(0x20);
+          const __m128i three16 = _mm_set1_epi8(0x3);
+          const __m128i a16 = _mm_set1_epi8('a'), c16 = _mm_set1_epi8('c'), g16 = _mm_set1_epi8('g'), t16 = _mm_set1_epi8('t');
+          const __m128i lf16 = _mm_set1_epi8('\n'), cr16 = _mm_set1_epi8('\r');
+          const __m128i eols16 = _mm_set1_epi8(eol), others16 = _mm_set1_epi8(other);
+          for (; (b + 16) <= e; b += 16, out += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(b));
+            __m128i l = _mm_or_si128(v, lower16);
+            __m128i base = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(l, a16), _mm_cmpeq_epi8(l, c16)),
+                                        _mm_or_si128(_mm_cmpeq_epi8(l, g16), _mm_cmpeq_epi8(l, t16)));
+            __m128i is_eol = _mm_or_si128(_mm_cmpeq_epi8(v, lf16), _mm_cmpeq_epi8(v, cr16));
+            __m128i code = _mm_and_si128(_mm_srli_epi16(v, 1), three16);
+            // SSE2 has no blendv:  select with and / andnot.
+            __m128i rest = _mm_or_si128(_mm_and_si128(is_eol, eols16), _mm_andnot_si128(is_eol, others16));
+            __m128i res = _mm_or_si128(_mm_and_si128(base, code), _mm_andnot_si128(base, rest));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out), res);
+          }
+          dust_encode<false>::encode(b, e, out);
+        }
+    };
+
+    /// best available classifier for the compiler flags.
+    using DustEncode = dust_encode<true>;
+#else
+    using DustEncode = dust_encode<false>;
+#endif
+
+
+    /**
+     * @brief  marks the low complexity characters of a sequence.  see file documentation for the score.
+     * @details  sequences (or segments between non-ACGT characters) shorter than window are scored as 1 window.
+     *           holds scratch buffers, so 1 instance per thread.
+     */
+    class dust_masker {
+      public:
+        static constexpr size_t default_window = 64;
+        static constexpr double default_threshold = 2.0;
+
+      protected:
+        size_t window;
+        double threshold;
+
+        /// character classes
+        std::vector<uint8_t> codes;
+        /// positions of the bases of the current segment
+        std::vector<size_t> bases;
+        /// triplets of the current segment
+        std::vector<uint8_t> triplets;
+
+        /// mark the low complexity windows of the segment in bases.
+        void mask_segment(std::vector<uint8_t> & mask) {
+          size_t n = bases.size();
+          if (n < 4) return;   // fewer than 2 triplets.
+          size_t w = ::std::min(window, n);
+          size_t l = w - 2;
+
+          triplets.resize(n - 2);
+          for (size_t j = 0; j < n - 2; ++j)
+            triplets[j] = static_cast<uint8_t>((codes[bases[j]] << 4) | (codes[bases[j + 1]] << 2) | codes[bases[j + 2]]);
+
+          // s = sum_t c_t (c_t - 1) / 2, updated as triplets enter and leave the window.
+          uint32_t counts[64] = {0};
+          size_t s = 0;
+          for (size_t j = 0; j < l; ++j) s += counts[triplets[j]]++;
+          double limit = threshold * static_cast<double>(l - 1);
+
+          size_t covered = 0;  // bases before this are already marked.
+          for (size_t start = 0; ; ++start) {
+            if (static_cast<double>(s) > limit) {
+              for (size_t j = ::std::max(start, covered); j < start + w; ++j) mask[bases[j]] = 1;
+              covered = start + w;
+            }
+            if (start + w >= n) break;
+            s -= --counts[triplets[start]];
+            s += counts[triplets[start + l]]++;
+          }
+        }
+
+      public:
+        dust_masker(size_t _window = default_window, double _threshold = default_threshold) :
+          window(::std::max(_window, static_cast<size_t>(4))), threshold(_threshold) {}
+
+        size_t get_window() const { return window; }
+        double get_threshold() const { return threshold; }
+
+        /**
+         * @brief  mask[i] is 1 if character i of [b, e) is masked, 0 otherwise.
+         * @return number of masked characters.
+         */
+        template <typename Iter>
+        size_t mask(Iter b, Iter e, std::vector<uint8_t> & mask) {
+          size_t n = ::std::distance(b, e);
+          codes.resize(n);
+          encode(b, e, ::bliss::common::is_contiguous_char_iterator<Iter>());
+          mask.assign(n, 0);
+
+          size_t i = 0;
+          while (i < n) {
+            bases.clear();
+            for (; (i < n) && (codes[i] != DustEncode::other); ++i) {
+              if (codes[i] != DustEncode::eol) bases.emplace_back(i);
+            }
+            mask_segment(mask);
+            if (i < n) mask[i++] = 1;
+          }
+
+          size_t masked = 0;
+          for (i = 0; i < n; ++i) {
+            if ((codes[i] == DustEncode::eol) && (i > 0)) mask[i] = mask[i - 1];
+            masked += mask[i];
+          }
+          return masked;
+        }
+
+        /// the DUST score of the bases in [b, e), as 1 window.  EOL skipped, other characters not allowed.  for testing.
+        template <typename Iter>
+        static double score(Iter b, Iter e) {
+          std::vector<uint8_t> c;
+          for (; b != e; ++b) {
+            uint8_t x = dust_encode<false>::code(*b);
+            if (x < DustEncode::eol) c.emplace_back(x);
+          }
+          if (c.size() < 4) return 0.0;
+          uint32_t counts[64] = {0};
+          size_t s = 0;
+          for (size_t j = 0; j + 2 < c.size(); ++j) s += counts[(c[j] << 4) | (c[j + 1] << 2) | c[j + 2]]++;
+          return static_cast<double>(s) / static_cast<double>(c.size() - 3);
+        }
+
+      protected:
+        template <typename Iter>
+        void encode(Iter b, Iter e, ::std::false_type const &) {
+          for (size_t i = 0; b != e; ++b, ++i) codes[i] = dust_encode<false>::code(*b);
+        }
+        template <typename Iter>
+        void encode(Iter b, Iter e, ::std::true_type const &) {
+          if (b == e) return;
+          unsigned char const * p = reinterpret_cast<unsigned char const *>(&(*b));
+          DustEncode::encode(p, p + ::std::distance(b, e), codes.data());
+        }
+    };
+
+
+    /**
+     * @class bliss::io::DustCharFilter
+     * @brief  split predicate for SplitSequencesIterator:  a character passes if it is not masked by dust_masker.
+     * @details  whether a character is masked depends on its neighbors, so the mask of a sequence is computed when the
+     *           first run is requested, from the sequence start, and kept for the later runs of the same sequence.
+     *           for contiguous character data only.
+     */
+    struct DustCharFilter {
+        dust_masker masker;
+
+        /// the cached mask is for the sequence that ends at end.
+        unsigned char const * end;
+        std::vector<uint8_t> mask;
+
+        DustCharFilter(size_t window = dust_masker::default_window,
+                       double threshold = dust_masker::default_threshold) :
+          masker(window, threshold), end(nullptr) {}
+
+        /// mask of the characters from b to the end of the sequence ending at e, starting at the returned pointer.
+        uint8_t const * get_mask(unsigned char const * b, unsigned char const * e) {
+          if (e != end) {
+            masker.mask(b, e, mask);
+            end = e;
+          }
+          return mask.data() + mask.size() - (e - b);
+        }
+    };
+
+    /// DustCharFilter:  uses the cached mask of the sequence.
+    template <>
+    struct split_scanner<DustCharFilter> {
+        template <typename Iter>
+        static Iter find_valid(Iter b, Iter e, DustCharFilter & pred) {
+          return find<0>(b, e, pred);
+        }
+        template <typename Iter>
+        static Iter find_invalid(Iter b, Iter e, DustCharFilter & pred) {
+          return find<1>(b, e, pred);
+        }
+
+      protected:
+        template <uint8_t MASKED, typename Iter>
+        static Iter find(Iter b, Iter e, DustCharFilter & pred) {
+          static_assert(::bliss::common::is_contiguous_char_iterator<Iter>::value,
+                        "DustCharFilter requires contiguous character data.");
+          if (b == e) return e;
+          unsigned char const * p = reinterpret_cast<unsigned char const *>(&(*b));
+          size_t n = ::std::distance(b, e);
+          uint8_t const * m = pred.get_mask(p, p + n);
+          return b + (::std::find(m, m + n, MASKED) - m);
+        }
+    };
+
+    template <typename Iterator, template <typename> class SeqParser>
+    using DustSplitSequencesIterator = bliss::io::SplitSequencesIterator<Iterator, SeqParser, bliss::io::DustCharFilter>;
+
+
+    /**
+     * @class bliss::io::DustSequenceFilter
+     * @brief  predicate for FilteredSequencesIterator:  a sequence passes if at most max_fraction of it is masked.
+     */
+    struct DustSequenceFilter {
+        dust_masker masker;
+        double max_fraction;
+        std::vector<uint8_t> mask;
+
+        DustSequenceFilter(double _max_fraction = 0.5,
+                           size_t window = dust_masker::default_window,
+                           double threshold = dust_masker::default_threshold) :
+          masker(window, threshold), max_fraction(_max_fraction) {}
+
+        template <typename SEQ>
+        bool operator()(SEQ const & x) {
+          size_t masked = masker.mask(x.seq_begin, x.seq_end, mask);
+          return static_cast<double>(masked) <= max_fraction * static_cast<double>(mask.size());
+        }
+    };
+
+    template <typename Iterator, template <typename> class SeqParser>
+    using DustFilterSequencesIterator = bliss::io::FilteredSequencesIterator<Iterator, SeqParser, bliss::io::DustSequenceFilter>;
+
+  } // namespace io
+} // namespace bliss
+
+#endif /* SRC_IO_DUST_FILTER_HPP_ */
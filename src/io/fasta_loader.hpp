@@ -34,6 +34,7 @@
 #include "common/sequence.hpp"
 #include "common/base_types.hpp"
 #include "io/file_loader.hpp"
+#include "io/record_index.hpp"
 
 #include "io/mxx_support.hpp"
 #include <mxx/datatypes.hpp>
@@ -114,6 +115,9 @@ namespace bliss
         SequenceVecType sequences;
         size_t seq_offset;
 
+        /// optional .fai index.  if loaded, init_parser takes the record positions from it instead of scanning.
+        ::bliss::io::fai_index fai;
+
       public:
 
         /// default constructor.
@@ -126,15 +130,25 @@ namespace bliss
 
         /// converting constructor.
         template <typename Iterator2>
-        FASTAParser(FASTAParser<Iterator2> const & other) : sequences(other.sequences), seq_offset(other.seq_offset) { }
+        FASTAParser(FASTAParser<Iterator2> const & other) : sequences(other.sequences), seq_offset(other.seq_offset), fai(other.fai) { }
         /// converting assignment operator that can transform the base iterator type.
         template <typename Iterator2>
         FASTAParser<Iterator>& operator=(FASTAParser<Iterator2> const & other) {
           sequences.assign(other.sequences.begin(), other.sequences.end());
           seq_offset = other.seq_offset;
+          fai = other.fai;
           return *this;
         }
 
+        /**
+         * @brief load the samtools .fai index of filename, if there is one.  init_parser then computes the records from it.
+         * @note  for init_parser with a communicator, the index is used only if all ranks loaded it.
+         * @return true if the index was loaded.
+         */
+        bool load_index(std::string const & filename) {
+          return fai.open(filename);
+        }
+
         using bliss::io::BaseFileParser<Iterator>::find_overlap_end;
         using bliss::io::BaseFileParser<Iterator>::reset;
         using bliss::io::BaseFileParser<Iterator>::init_parser;
@@ -182,9 +196,76 @@ namespace bliss
           sequences.clear();
         }
 
+      protected:
+        /**
+         * @brief populate sequences from the .fai index, keeping the records whose sequence part overlaps r.
+         * @details same entries as the scanning init_parser produces, without reading the data.
+         */
+        void init_from_index(const RangeType &parentRange, const RangeType &r) {
+          if (r.size() == 0) return;
+
+          auto records = fai.records(parentRange.end);
+
+          // first record whose sequence part ends after r.start
+          auto it = ::std::upper_bound(records.begin(), records.end(), r.start,
+              [](size_t const & pos, typename ::bliss::io::fai_index::offsets_type const & rec){
+                return pos < ::std::get<2>(rec);
+              });
+          for (; (it != records.end()) && (::std::get<1>(*it) < r.end); ++it) {
+            sequences.emplace_back(::std::get<0>(*it), ::std::get<1>(*it), ::std::get<2>(*it),
+                                   ::std::distance(records.begin(), it));
+          }
+        }
+
+      public:
+
 
 #ifdef USE_MPI
 
+      protected:
+        /**
+         * @brief   fast path of init_parser for a file that holds a single record, e.g. one chromosome.
+         * @details the layout is a '>' header line at the start of the file and no other line starting with '>' or ';'.
+         *          the record is then [parent start, first eol + 1, parent end), so every rank can compute it from the
+         *          position of the first eol alone, and the line start vectors, unique, shifts and scans of the general
+         *          path are skipped.  each rank scans its own range once, and the layout is agreed on with 2 allreduces.
+         *          line width does not matter since all positions are file offsets.
+         *          a header char at the start of a non-first rank's range disqualifies the layout, since the previous
+         *          char is not known locally.  the general path handles those files.
+         * @param[in]   r       this rank's range, not overlapping with other ranks.
+         * @return  true if the file has the single record layout, and sequences has been populated.
+         */
+        bool init_single_record(const Iterator &_data, const RangeType &parentRange, const RangeType &r, const mxx::comm& comm) {
+          using TT = typename std::iterator_traits<Iterator>::value_type;
+
+          bool single = true;
+          size_t first_eol = ::std::numeric_limits<size_t>::max();
+
+          Iterator it = _data;
+          TT prev = 0;
+          for (auto i = r.start; single && (i < r.end); ++i, ++it) {
+            TT c = *it;
+            if (i == parentRange.start) single = (c == '>');
+            else if (((i == r.start) || (prev == '\n')) && ((c == '>') || (c == ';'))) single = false;
+
+            if ((c == '\n') && (first_eol == ::std::numeric_limits<size_t>::max())) first_eol = i;
+            prev = c;
+          }
+
+          if (!mxx::all_of(single, comm)) return false;
+
+          first_eol = mxx::allreduce(first_eol, mxx::min<size_t>(), comm);
+          // header only.  let the general path report it.
+          if ((first_eol == ::std::numeric_limits<size_t>::max()) || ((first_eol + 1) >= parentRange.end)) return false;
+
+          // same as the general path:  empty ranges have no entries, and the sequence part has to overlap the range.
+          if ((r.size() > 0) && ((first_eol + 1) < r.end) && (parentRange.end > r.start))
+            sequences.emplace_back(parentRange.start, first_eol + 1, parentRange.end, 0);
+
+          return true;
+        }
+
+      public:
         /**
          * @brief   Keep track of all '>' and the following EOL character to save the positions of the fasta record headers for each fasta record in the local block
          * @attention   This function should be called by all the MPI ranks in MPI communicator
@@ -233,6 +314,17 @@ namespace bliss
           else
             r.end = mxx::left_shift(r.start, comm);
 
+          // with a .fai index, no scan and no exchange.
+          if (mxx::all_of(fai.size() > 0, comm)) {
+            init_from_index(parentRange, r);
+            if (mxx::allreduce(sequences.size(), comm) == 0) throw std::logic_error("ERROR: no sequences found from .fai index.  wrong index?");
+            return RangeType::intersect(searchRange, inMemRange).start;
+          }
+
+          // a single record file, e.g. one chromosome, needs no line start exchange.
+          if (init_single_record(_data, parentRange, r, comm))
+            return RangeType::intersect(searchRange, inMemRange).start;
+
           // clear the starting position storage.
 
           TT prev_char = '\n';  // default to EOL char.
@@ -506,6 +598,14 @@ namespace bliss
 
           if (r.size() == 0) return searchRange.start;
 
+          if (fai.size() > 0) {
+            init_from_index(parentRange, r);
+            if (sequences.size() == 0) {
+              BL_WARNING("WARNING: no sequences found from .fai index.  wrong index, or a part of file that does not contain sequence start was read.");
+            }
+            return RangeType::intersect(searchRange, inMemRange).start;
+          }
+
           TT prev_char = '\n';  // default to EOL char.
 
           //============== OUTLINE
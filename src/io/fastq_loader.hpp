@@ -26,10 +26,18 @@
 #define FASTQ_PARTITIONER_HPP_
 
 #include <cmath>
+#include <cstdint>
 
 #include <sstream>
 #include <iterator>  // for ostream_iterator
 #include <algorithm> // for copy.
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include <mxx/comm.hpp>
 #include <mxx/shift.hpp>
@@ -51,6 +59,108 @@ namespace bliss
     };
 
 
+    /**
+     * @brief  find EOL ('\n' or '\r') characters in a contiguous character range.  scalar version.
+     * @details  find locates the end of 1 line.  index records the offsets of all EOL characters in a block,
+     *      so the lines of a whole block are known after a single pass over it.
+     */
+    template <bool SIMD = false>
+    struct eol_scan {
+        static bool is_eol(unsigned char const & c) {
+          return (c == '\n') || (c == '\r');
+        }
+
+        /// first EOL character in [b, e), or e.
+        static unsigned char const * find(unsigned char const * b, unsigned char const * e) {
+          for (; b < e; ++b) {
+            if (is_eol(*b)) return b;
+          }
+          return e;
+        }
+
+        /// first non-EOL character in [b, e), or e.  runs of EOL are short, so always scalar.
+        static unsigned char const * skip(unsigned char const * b, unsigned char const * e) {
+          while ((b < e) && is_eol(*b)) ++b;
+          return b;
+        }
+
+        /// append the offsets, relative to b, of the EOL characters in [b, e) to eols.
+        static void index(unsigned char const * b, unsigned char const * e, ::std::vector<size_t> & eols) {
+          index_from(b, b, e, eols);
+        }
+
+      protected:
+        template <bool> friend struct eol_scan;
+
+        static void index_from(unsigned char const * base, unsigned char const * b, unsigned char const * e,
+                               ::std::vector<size_t> & eols) {
+          for (; b < e; ++b) {
+            if (is_eol(*b)) eols.emplace_back(b - base);
+          }
+        }
+    };
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    /**
+     * @brief  SIMD version.  compares 32 (AVX2) or 16 (SSE2) characters against '\n' and '\r' at a time.
+     * @details  find returns at the first set bit of the movemask.  index walks the set bits of each movemask with
+     *      count trailing zeros, so the cost is per register plus per line, independent of the line lengths.
+     */
+    template <>
+    struct eol_scan<true> : public eol_scan<false> {
+        static unsigned char const * find(unsigned char const * b, unsigned char const * e) {
+#if defined(__AVX2__)
+          const __m256i lf = _mm256_set1_epi8('\n');
+          const __m256i cr = _mm256_set1_epi8('\r');
+          for (; (b + 32) <= e; b += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(b));
+            uint32_t m = static_cast<uint32_t>(_mm256_movemask_epi8(
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, lf), _mm256_cmpeq_epi8(v, cr))));
+            if (m != 0) return b + __builtin_ctz(m);
+          }
+#endif
+          const __m128i lf16 = _mm_set1_epi8('\n');
+          const __m128i cr16 = _mm_set1_epi8('\r');
+          for (; (b + 16) <= e; b += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(b));
+            uint32_t m = static_cast<uint32_t>(_mm_movemask_epi8(
+                _mm_or_si128(_mm_cmpeq_epi8(v, lf16), _mm_cmpeq_epi8(v, cr16))));
+            if (m != 0) return b + __builtin_ctz(m);
+          }
+          return eol_scan<false>::find(b, e);
+        }
+
+        static void index(unsigned char const * b, unsigned char const * e, ::std::vector<size_t> & eols) {
+          unsigned char const * base = b;
+#if defined(__AVX2__)
+          const __m256i lf = _mm256_set1_epi8('\n');
+          const __m256i cr = _mm256_set1_epi8('\r');
+          for (; (b + 32) <= e; b += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(b));
+            uint32_t m = static_cast<uint32_t>(_mm256_movemask_epi8(
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, lf), _mm256_cmpeq_epi8(v, cr))));
+            for (size_t i = b - base; m != 0; m &= (m - 1)) eols.emplace_back(i + __builtin_ctz(m));
+          }
+#endif
+          const __m128i lf16 = _mm_set1_epi8('\n');
+          const __m128i cr16 = _mm_set1_epi8('\r');
+          for (; (b + 16) <= e; b += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(b));
+            uint32_t m = static_cast<uint32_t>(_mm_movemask_epi8(
+                _mm_or_si128(_mm_cmpeq_epi8(v, lf16), _mm_cmpeq_epi8(v, cr16))));
+            for (size_t i = b - base; m != 0; m &= (m - 1)) eols.emplace_back(i + __builtin_ctz(m));
+          }
+          eol_scan<false>::index_from(base, b, e, eols);
+        }
+    };
+
+    /// best available EOL scanner for the compiler flags.
+    using EOLScan = eol_scan<true>;
+#else
+    using EOLScan = eol_scan<false>;
+#endif
+
+
     template <typename Iterator, bool HasQuality = true>
     class FASTQSequence : public ::bliss::common::Sequence<Iterator> {
         // NOTE: uses the default SequenceId type instead of ShortSequenceKmerType, because we are dealing with file coordinate right now and not Kmer's position
@@ -467,6 +577,148 @@ namespace bliss
         }
 
 
+        /// sequence type produced by index_records.  without quality, qual_begin == qual_end == seq_end.
+        template <bool WithQuality>
+        using IndexedSequenceType = bliss::io::FASTQSequence<Iterator, WithQuality>;
+
+        /**
+         * @brief parse all records in [begin, end) in 1 call, locating the lines with EOLScan instead of char by char.
+         * @details   begin has to be at the start of a record, as for get_next_record, and the records are the same as
+         *            successive get_next_record calls would produce, with the same checks.
+         *
+         *            WithQuality:  the offsets of all EOL characters in the block are collected in a single SIMD pass,
+         *                and each record is read off the next 4 non-empty lines.
+         *            Without:  the header, sequence, and '+' lines are each found with a SIMD search, and the quality line
+         *                is stepped over by the sequence length, so its characters are never read.  only the character
+         *                after it is checked to be EOL (else the line is searched, and a length mismatch is an error).
+         *                quality score parsers do not accept the resulting sequence type.
+         *
+         * @note      Iterator has to be contiguous (pointer, or vector or string iterator).
+         * @param begin     start of the records
+         * @param end       end of the data
+         * @param offset    position of begin in the file.
+         * @param records   output.  records are appended.
+         * @return          number of records appended.
+         */
+        template <bool WithQuality>
+        size_t index_records(Iterator const & begin, Iterator const & end, size_t const & offset,
+                             ::std::vector<IndexedSequenceType<WithQuality> > & records) {
+          static_assert(::std::is_same<typename ::std::iterator_traits<Iterator>::iterator_category,
+                                       ::std::random_access_iterator_tag>::value &&
+                        (sizeof(typename ::std::iterator_traits<Iterator>::value_type) == 1),
+                        "index_records requires a contiguous char iterator");
+
+          if (begin == end) return 0;
+
+          size_t before = records.size();
+          index_records_impl(begin, end, offset, records, ::std::integral_constant<bool, WithQuality>());
+          return records.size() - before;
+        }
+
+      protected:
+
+        /// check and append 1 record.  lines are [lb, le) offsets from begin.  absent lines are at end.
+        template <typename SeqType>
+        void add_indexed_record(Iterator const & begin, Iterator const & end, size_t const & offset,
+                                size_t const (&lb)[4], size_t const (&le)[4], size_t const & record_end,
+                                Iterator const & qb, Iterator const & qe, ::std::vector<SeqType> & records) {
+          size_t n = ::std::distance(begin, end);
+
+          if (*(begin + lb[0]) != '@')
+            this->handleError("missing @ on first line. ", begin + lb[0], end, offset + lb[0], offset + n);
+          if ((lb[2] < n) && (*(begin + lb[2]) != '+'))
+            this->handleError("missing + on third line. ", begin + lb[0], end, offset + lb[0], offset + n);
+
+          if ((lb[1] == le[1]) || (lb[3] == le[3])) {
+            this->handleWarning("truncated record? missing seq or quality", begin + lb[0], begin + le[3], offset + lb[0], offset + record_end);
+          } else if ((le[1] - lb[1]) != (le[3] - lb[3])) {
+            this->handleError("truncated record? seq and qual differ in length", begin + lb[0], begin + le[3], offset + lb[0], offset + record_end);
+          }
+
+          records.emplace_back(SequenceIdType(offset + lb[0]), record_end - lb[0], lb[1] - lb[0],
+                               begin + lb[1], begin + le[1], qb, qe);
+        }
+
+        /// all 4 lines from a single pass index of the EOL characters.
+        template <typename SeqType>
+        void index_records_impl(Iterator const & begin, Iterator const & end, size_t const & offset,
+                                ::std::vector<SeqType> & records, ::std::true_type) {
+          size_t n = ::std::distance(begin, end);
+          unsigned char const * data = reinterpret_cast<unsigned char const *>(&(*begin));
+
+          ::std::vector<size_t> eols;
+          eols.reserve(n / 32 + 1);  // about 4 lines in a 150 character record.
+          ::bliss::io::EOLScan::index(data, data + n, eols);
+          eols.emplace_back(n);      // end acts as the last EOL.
+
+          // lines are the non-empty gaps between successive EOLs.  line_start is just after the last EOL used.
+          size_t e = 0;
+          size_t line_start = 0;
+          auto skip_empty = [&eols, &e, &line_start]() {
+            while ((e < eols.size()) && (eols[e] == line_start)) line_start = eols[e++] + 1;
+          };
+
+          size_t lb[4], le[4];
+          while (true) {
+            skip_empty();
+            if (e == eols.size()) break;
+
+            for (int j = 0; j < 4; ++j) {
+              skip_empty();
+              if (e < eols.size()) {
+                lb[j] = line_start;
+                le[j] = eols[e];
+                line_start = eols[e++] + 1;
+              } else {
+                lb[j] = le[j] = n;
+              }
+            }
+            skip_empty();
+
+            add_indexed_record(begin, end, offset, lb, le, ::std::min(line_start, n),
+                               begin + lb[3], begin + le[3], records);
+          }
+        }
+
+        /// header, sequence, and '+' lines by SIMD search, and the quality line stepped over.
+        template <typename SeqType>
+        void index_records_impl(Iterator const & begin, Iterator const & end, size_t const & offset,
+                                ::std::vector<SeqType> & records, ::std::false_type) {
+          size_t n = ::std::distance(begin, end);
+          unsigned char const * data = reinterpret_cast<unsigned char const *>(&(*begin));
+          unsigned char const * data_end = data + n;
+
+          unsigned char const * p = ::bliss::io::EOLScan::skip(data, data_end);
+          size_t lb[4], le[4];
+          while (p != data_end) {
+            for (int j = 0; j < 3; ++j) {
+              p = ::bliss::io::EOLScan::skip(p, data_end);
+              lb[j] = p - data;
+              p = ::bliss::io::EOLScan::find(p, data_end);
+              le[j] = p - data;
+            }
+
+            p = ::bliss::io::EOLScan::skip(p, data_end);
+            lb[3] = p - data;
+            size_t len = le[1] - lb[1];
+            if ((len > 0) && (len <= static_cast<size_t>(data_end - p)) &&
+                (((p + len) == data_end) || ::bliss::io::EOLScan::is_eol(p[len]))) {
+              p += len;
+            } else {
+              p = ::bliss::io::EOLScan::find(p, data_end);
+            }
+            le[3] = p - data;
+
+            p = ::bliss::io::EOLScan::skip(p, data_end);
+
+            add_indexed_record(begin, end, offset, lb, le, p - data,
+                               begin + le[1], begin + le[1], records);
+          }
+        }
+
+      public:
+
+
 
         /**
          * @brief   get the average record size in the supplied range
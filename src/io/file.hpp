@@ -39,15 +39,30 @@
 #include "bliss-config.hpp"
 
 #include <string>
+#include <vector>
+#include <functional>   // std::plus
+#include <numeric>      // std::accumulate
+#include <limits>
+#include <algorithm>
 #include <cstring>      // memcpy, strerror
 
 #include <ios>          // ios_base::failure
 #include <iostream>     // ios_base::failure
 #include <unistd.h>     // sysconf, usleep, lseek,
 #include <sys/mman.h>   // mmap
+#include <sys/vfs.h>    // statfs
+#include <sys/xattr.h>  // getxattr
 #include <fcntl.h>      // for open64 and close
 #include <sstream>      // stringstream
 #include <exception>    // std exception
+#include <memory>       // unique_ptr
+#include <cstdlib>      // posix_memalign
+#include <sys/syscall.h>      // SYS_getcpu, __NR_mbind
+#include <linux/mempolicy.h>  // MPOL_PREFERRED
+
+#if defined(USE_OPENMP)
+#include <omp.h>
+#endif
 
 #if defined(USE_MPI)
 #include <mpi.h>
@@ -58,10 +73,14 @@
 #include <mxx/shift.hpp>
 
 #include <io/io_exception.hpp>
+#if defined(USE_IO_URING)
+#include <io/io_uring_queue.hpp>
+#endif
 
 #include <io/file_loader.hpp>
 #include <io/fastq_loader.hpp>
 #include <io/fasta_loader.hpp>
+#include <io/record_index.hpp>
 #include <io/unix_domain_socket.h>
 #include <partition/range.hpp>
 
@@ -222,6 +241,32 @@ struct file_data {
 
 
 
+/**
+ * @brief  how a file region is mapped, and how the buffer it is copied into is placed in memory.
+ * @details  the default is the historical behavior:  MADV_SEQUENTIAL | MADV_WILLNEED on the mapping, no prefaulting.
+ *      hugepage    MADV_HUGEPAGE on the mapping and on the output buffer.  transparent huge pages only;
+ *                  MAP_HUGETLB does not work with file mappings.  page cache THP depends on filesystem and kernel support,
+ *                  so for the mapping this is a hint, and errors are ignored.
+ *      populate    MAP_POPULATE.  prefault the whole mapping instead of relying on read ahead.
+ *      numa_threads  if > 0, the output buffer is split into numa_threads equal sub-ranges (same split as the initial
+ *                  chunk blocks in KmerFileHelper::read_block_omp), and each is bound to the node of the omp thread that parses it,
+ *                  then first touched under that policy.  mbind has no effect on page cache pages of a
+ *                  regular file, so placement applies to the copy.  without USE_OPENMP this is ignored.
+ */
+struct mmap_policy {
+    /// madvise advice for the mapping.
+    int advice;
+    /// prefault the mapping with MAP_POPULATE
+    bool populate;
+    /// request transparent huge pages
+    bool hugepage;
+    /// number of threads whose sub-ranges are bound to their NUMA node.  0 to disable.
+    int numa_threads;
+
+    mmap_policy() : advice(MADV_SEQUENTIAL | MADV_WILLNEED), populate(false), hugepage(false), numa_threads(0) {}
+};
+
+
 /**
  * mmapped data.  wrapper for moving it around.
  */
@@ -245,8 +290,9 @@ class mapped_data {
      * @brief   map the specified portion of the file to memory.
      * @note    AGNOSTIC of overlaps
      * @param range_bytes    range specifying the portion of the file to map.
+     * @param policy         mapping flags and advice.  default is MADV_SEQUENTIAL | MADV_WILLNEED, no populate.
      */
-    mapped_data(int const & _fd, range_type const & target) :
+    mapped_data(int const & _fd, range_type const & target, mmap_policy const & policy = mmap_policy()) :
       data(nullptr), range_bytes(0, 0),
       page_size(sysconf(_SC_PAGE_SIZE))
     {
@@ -267,13 +313,13 @@ class mapped_data {
       range_bytes.start = range_type::align_to_page(target, page_size);
       range_bytes.end = target.end;  // okay for end not to align - made 0.
 
-      // NOT using MAP_POPULATE. (SLOW)  no need to prefault the entire range - use read ahead from madvice.
+      // MAP_POPULATE only if requested. (SLOW)  default is no prefaulting of the entire range - use read ahead from madvice.
       // NOTE HUGETLB not supported for file mapping, only anonymous.  also, kernel has to enable it and system has to have it reserved,
       // MAP_SHARED so that we don't have CoW (no private instance) (potential sharing between processes?)  slightly slower by 1%?
       // MAP_NORESERVE so that swap is not allocated.
       data = (unsigned char*)mmap64(nullptr, range_bytes.size(),
                                    PROT_READ,
-                                   MAP_SHARED | MAP_NORESERVE, _fd,
+                                   MAP_SHARED | MAP_NORESERVE | (policy.populate ? MAP_POPULATE : 0), _fd,
                                    range_bytes.start);
 
       // if mmap failed,
@@ -287,8 +333,7 @@ class mapped_data {
       }
 
       // set the madvice info.  SEQUENTIAL vs RANDOM does not appear to make a difference in running time.
-      int madv_result = madvise(data, range_bytes.size(),
-          MADV_SEQUENTIAL | MADV_WILLNEED);
+      int madv_result = madvise(data, range_bytes.size(), policy.advice);
       if ( madv_result == -1 ) {
         std::stringstream ss;
         int myerr = errno;
@@ -296,6 +341,10 @@ class mapped_data {
 
         throw ::bliss::utils::make_exception<bliss::io::IOException>(ss.str());
       }
+#if defined(MADV_HUGEPAGE)
+      // hint only.  EINVAL if THP is not configured.
+      if (policy.hugepage) madvise(data, range_bytes.size(), MADV_HUGEPAGE);
+#endif
       // for testing
       //std::cout << "serial fd=" << _fd << " mapped region = " << range_bytes << " pointer is " << (const void*)data << ::std::endl;
     }
@@ -466,6 +515,12 @@ protected:
   base_file(int const & _fd, size_t const & _file_size) :
     filename(::std::string()), fd(dup(_fd)), file_range_bytes(0, _file_size) {};
 
+  /// what partitioned_file passes to its FileReader's constructor, along with the size:  the open file descriptor.
+  /// parallel::object_base_file, which has no local file, hides this with the object's location.
+  int const & reader_source() const {
+    return fd;
+  }
+
 public:
 
 	/**
@@ -556,11 +611,66 @@ protected:
 	/// BASE type
 	using BASE = ::bliss::io::base_file;
 
+	/// mapping and placement policy
+	mmap_policy policy;
+
+	/**
+	 * @brief  size output to bytes in a fresh allocation, applying the huge page and NUMA parts of the policy before first touch.
+	 * @details  the allocation is reserved but not touched, advised and bound, then the resize zero fill faults the pages in.
+	 *      a reused buffer would already be faulted, so the old one is released.
+	 */
+	void place_output(typename ::bliss::io::file_data::container & output, size_t const & bytes) {
+	  typename ::bliss::io::file_data::container().swap(output);
+	  output.reserve(bytes);
+
+	  size_t page_size = sysconf(_SC_PAGE_SIZE);
+	  size_t first = (reinterpret_cast<size_t>(output.data()) + page_size - 1) & ~(page_size - 1);
+	  size_t last = (reinterpret_cast<size_t>(output.data()) + bytes) & ~(page_size - 1);
+
+#if defined(MADV_HUGEPAGE)
+	  if (policy.hugepage && (first < last)) madvise(reinterpret_cast<void*>(first), last - first, MADV_HUGEPAGE);
+#endif
+
+#if defined(USE_OPENMP) && defined(__NR_mbind)
+	  if (policy.numa_threads > 0) {
+	    int nthreads = policy.numa_threads;
+	    size_t base = reinterpret_cast<size_t>(output.data());
+#pragma omp parallel num_threads(nthreads)
+	    {
+	      int t = omp_get_thread_num();
+	      unsigned cpu = 0, node = 0;
+	      // page aligned sub-range of this thread.  boundary pages go to the higher thread.
+	      size_t s = (base + (bytes * t) / nthreads + page_size - 1) & ~(page_size - 1);
+	      size_t e = (t == nthreads - 1) ? last : ((base + (bytes * (t + 1)) / nthreads + page_size - 1) & ~(page_size - 1));
+	      s = ::std::max(s, first);
+	      e = ::std::min(e, last);
+	      if ((s < e) && (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) && (node < sizeof(unsigned long) * 8)) {
+	        unsigned long mask = 1UL << node;
+	        // hint only.  fails with ENOSYS/EPERM in restricted environments, then default (local) placement is used.
+	        syscall(__NR_mbind, reinterpret_cast<void*>(s), e - s, MPOL_PREFERRED, &mask, sizeof(unsigned long) * 8, 0);
+	      }
+	    }
+	  }
+#endif
+
+	  output.resize(bytes);
+	}
+
 public:
 
 	// this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
 	using BASE::read_range;
 
+	/// set the mapping policy for subsequent map and read calls.
+	void set_policy(mmap_policy const & _policy) {
+	  policy = _policy;
+	}
+
+	/// get the mapping policy.
+	mmap_policy const & get_policy() const {
+	  return policy;
+	}
+
 	/**
 	 *  bulk load all the data and return it in pre-allocated vector
 	 *  @param output   vector where the results are to be stored.
@@ -577,7 +687,7 @@ public:
 	  }
 
 		// map
-		mapped_data md(this->fd, file_range);
+		mapped_data md(this->fd, file_range, policy);
 
 		//
 		unsigned char * md_data = md.get_data();
@@ -601,11 +711,33 @@ public:
 			return target;
 		}
 
-		// resize output's capacity
-		if (output.capacity() < target.size()) output.resize(target.size());
+		unsigned char const * src = md_data + (target.start - mapped_range.start);
+
+		if (policy.hugepage || (policy.numa_threads > 0)) {
+		  place_output(output, target.size());
+		} else {
+		  // resize output to the read size.  capacity alone is not enough when output is reused.
+		  output.resize(target.size());
+		}
+
+#if defined(USE_OPENMP)
+		if (policy.numa_threads > 1) {
+		  // copy by the same threads, so the page cache reads happen in parallel as well.
+		  int nthreads = policy.numa_threads;
+		  size_t bytes = target.size();
+#pragma omp parallel num_threads(nthreads)
+		  {
+		    int t = omp_get_thread_num();
+		    size_t s = (bytes * t) / nthreads;
+		    size_t e = (bytes * (t + 1)) / nthreads;
+		    memcpy(output.data() + s, src + s, e - s);
+		  }
+		  return target;
+		}
+#endif
 
 		// copy the data into memory.  vector is contiguous, so this is okay.
-		memmove(output.data(), md_data + (target.start - mapped_range.start), target.size());
+		memmove(output.data(), src, target.size());
 
 		return target;
 
@@ -613,7 +745,7 @@ public:
 	}
 
 	inline mapped_data map(typename BASE::range_type const & range_bytes) {
-	  return mapped_data(this->fd, BASE::range_type::intersect(range_bytes, this->file_range_bytes));
+	  return mapped_data(this->fd, BASE::range_type::intersect(range_bytes, this->file_range_bytes), policy);
 	}
 
 	/**
@@ -738,8 +870,8 @@ public:
 
 //		std::cout << "curr pos in fd is " << ftell(this->fp) << std::endl;
 
-		// resize output's capacity
-		if (output.capacity() < target.size()) output.resize(target.size());
+		// resize output to the read size.  capacity alone is not enough when output is reused.
+		output.resize(target.size());
 
 		size_t read = fread_unlocked(output.data(), 1, target.size(), fp);
 
@@ -846,8 +978,8 @@ public:
 
     //std::cout << "curr pos in fd is " << lseek64(this->fd, 0, SEEK_CUR) << ::std::endl;
 
-    // resize output's capacity
-    if (output.capacity() < target.size()) output.resize(target.size());
+    // resize output to the read size.  capacity alone is not enough when output is reused.
+    output.resize(target.size());
 
     size_t s = 0;
     long count;
@@ -910,6 +1042,260 @@ public:
 
 
 
+};
+
+/**
+ * @brief    file wrapper that reads with deep queues of O_DIRECT reads through io_uring.
+ * @details  the range is read in aligned chunks of chunk_bytes, with up to queue_depth chunks in flight, into page aligned
+ *           staging buffers that are then copied to the output.  staging buffers may be registered with the kernel (READ_FIXED)
+ *           to avoid per read page pinning.
+ *
+ *           a separate file description is opened with O_DIRECT.  if the file system does not support O_DIRECT (e.g. tmpfs),
+ *           reads are buffered.  if not compiled with USE_IO_URING, or io_uring is not available at runtime (old kernel, seccomp),
+ *           the same chunks are read with pread.  read_range sets up its own ring, so concurrent calls are safe.
+ *
+ *           same constructors as posix_file, so it can be used as the FileReader of partitioned_file.
+ */
+class uring_file : public ::bliss::io::base_file {
+
+protected:
+
+  using BASE = ::bliss::io::base_file;
+
+  /// O_DIRECT alignment for offsets, lengths, and buffers.  covers 512 and 4096 byte logical blocks.
+  static constexpr size_t alignment = 4096UL;
+
+  /// file descriptor opened with O_DIRECT.  -1 if O_DIRECT is not supported.
+  int direct_fd;
+
+  /// bytes per read.  multiple of alignment
+  size_t chunk_bytes;
+
+  /// max number of reads in flight
+  unsigned queue_depth;
+
+  /// use registered buffers
+  bool registered_buffers;
+
+  /// open a new file description with O_DIRECT.  via /proc/self/fd, since the fd may have been passed in (and dup shares the status flags).
+  void open_direct() {
+    if (this->fd < 0) return;
+
+    ::std::stringstream ss;
+    ss << "/proc/self/fd/" << this->fd;
+    direct_fd = open64(ss.str().c_str(), O_RDONLY | O_DIRECT);
+    // else not supported.  use buffered fd.
+  }
+
+  /// copy the part of the chunk [chunk_start, chunk_start + bytes) that falls in target into output.
+  static void copy_chunk(unsigned char const * buf, size_t const & chunk_start, size_t const & bytes,
+                         range_type const & target, unsigned char * output) {
+    size_t s = ::std::max(chunk_start, target.start);
+    size_t e = ::std::min(chunk_start + bytes, target.end);
+    if (s < e) memcpy(output + (s - target.start), buf + (s - chunk_start), e - s);
+  }
+
+  void throw_short_read(size_t const & offset, long const & res) {
+    std::stringstream ss;
+    if (res < 0) {
+      ss << "ERROR: uring_file read: file " << this->filename << " offset " << offset << " error " << -res << ": " << strerror(-res);
+    } else {
+      ss << "ERROR: uring_file read: file " << this->filename << " offset " << offset << " unexpected end of file";
+    }
+    throw ::bliss::utils::make_exception<bliss::io::IOException>(ss.str());
+  }
+
+  /// fallback: read the chunks one at a time with pread.
+  void pread_chunks(int const & rfd, unsigned char * buf, range_type const & aligned,
+                    range_type const & target, unsigned char * output) {
+    for (size_t c = aligned.start; c < aligned.end; c += chunk_bytes) {
+      size_t len = ::std::min(chunk_bytes, aligned.end - c);
+      size_t need = ::std::min(c + len, target.end) - c;   // bytes that must be read.  rest is alignment padding past eof.
+      size_t got = 0;
+      while (got < need) {
+        long count = pread64(rfd, buf + got, len - got, static_cast<__off64_t>(c + got));
+        if (count <= 0) throw_short_read(c + got, (count < 0) ? -errno : 0);
+        got += count;
+      }
+      copy_chunk(buf, c, got, target, output);
+    }
+  }
+
+#if defined(USE_IO_URING)
+  /// read the chunks through io_uring, queue_depth deep.  returns false if io_uring is not available.
+  bool uring_chunks(int const & rfd, unsigned char * bufs, unsigned const & nbufs, range_type const & aligned,
+                    range_type const & target, unsigned char * output) {
+    ::std::unique_ptr<::bliss::io::io_uring_queue> ring;
+    try {
+      ring.reset(new ::bliss::io::io_uring_queue(nbufs));
+    } catch (::bliss::io::IOException const &) {
+      return false;
+    }
+
+    bool fixed = false;
+    if (registered_buffers) {
+      ::std::vector<struct iovec> iovs(nbufs);
+      for (unsigned i = 0; i < nbufs; ++i) {
+        iovs[i].iov_base = bufs + i * chunk_bytes;
+        iovs[i].iov_len = chunk_bytes;
+      }
+      fixed = (ring->register_buffers(iovs.data(), nbufs) == 0);  // else e.g. over RLIMIT_MEMLOCK.  use plain reads.
+    }
+
+    // per buffer: chunk start offset and bytes read so far.
+    ::std::vector<size_t> chunk_start(nbufs, 0);
+    ::std::vector<size_t> chunk_got(nbufs, 0);
+    ::std::vector<unsigned> free_bufs;
+    free_bufs.reserve(nbufs);
+    for (unsigned i = nbufs; i > 0; --i) free_bufs.push_back(i - 1);
+
+    size_t next = aligned.start;
+    unsigned inflight = 0;
+    uint64_t id;
+    int res;
+
+    while ((next < aligned.end) || (inflight > 0)) {
+      // fill the queue
+      while ((next < aligned.end) && !free_bufs.empty()) {
+        unsigned b = free_bufs.back();
+        size_t len = ::std::min(chunk_bytes, aligned.end - next);
+        if (!ring->push_read(rfd, bufs + b * chunk_bytes, len, next, b, fixed ? static_cast<int>(b) : -1)) break;
+        free_bufs.pop_back();
+        chunk_start[b] = next;
+        chunk_got[b] = 0;
+        next += len;
+        ++inflight;
+      }
+
+      ring->submit(1);
+
+      while (ring->pop(id, res)) {
+        --inflight;
+        unsigned b = static_cast<unsigned>(id);
+        size_t c = chunk_start[b];
+        size_t len = ::std::min(chunk_bytes, aligned.end - c);
+        size_t need = ::std::min(c + len, target.end) - c;
+
+        if (res < 0 || ((res == 0) && (chunk_got[b] < need))) throw_short_read(c + chunk_got[b], res);
+        chunk_got[b] += res;
+
+        if (chunk_got[b] < need) {
+          // short read.  resubmit the rest.  O_DIRECT short reads are block multiples, so stays aligned.
+          ring->push_read(rfd, bufs + b * chunk_bytes + chunk_got[b], len - chunk_got[b], c + chunk_got[b],
+                          b, fixed ? static_cast<int>(b) : -1);
+          ++inflight;
+        } else {
+          copy_chunk(bufs + b * chunk_bytes, c, chunk_got[b], target, output);
+          free_bufs.push_back(b);
+        }
+      }
+    }
+    return true;
+  }
+#endif
+
+public:
+
+  // this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
+  using BASE::read_range;
+
+  /**
+   * @brief  bulk load all the data and return it in a newly constructed vector.  reuse vector
+   * @param range_bytes range to read, in bytes
+   * @param output    vector containing data as bytes.
+   * @return  the range for the read data.
+   */
+  virtual range_type read_range(typename ::bliss::io::file_data::container & output, range_type const & range_bytes) {
+    if (this->fd == -1) {
+      throw ::bliss::utils::make_exception<std::logic_error>("ERROR: read_range: file pointer is null");
+    }
+
+    typename BASE::range_type target =
+        BASE::range_type::intersect(this->file_range_bytes, range_bytes);
+
+    if (target.size() == 0) {
+      std::cout << "WARNING: read_range: requested " << range_bytes << " not in file " << this->file_range_bytes << std::endl;
+      output.clear();
+      return target;
+    }
+
+    output.resize(target.size());
+
+    // aligned range to read.  end may be past end of file, which gives a short final read.
+    range_type aligned(target.start & ~(alignment - 1), (target.end + alignment - 1) & ~(alignment - 1));
+
+    unsigned nbufs = static_cast<unsigned>(::std::min(static_cast<size_t>(queue_depth), (aligned.size() + chunk_bytes - 1) / chunk_bytes));
+    void * mem = nullptr;
+    if (posix_memalign(&mem, alignment, nbufs * chunk_bytes) != 0) {
+      throw ::std::bad_alloc();
+    }
+    ::std::unique_ptr<unsigned char, decltype(&free)> bufs(reinterpret_cast<unsigned char *>(mem), &free);
+
+    int rfd = (direct_fd >= 0) ? direct_fd : this->fd;
+
+    bool done = false;
+#if defined(USE_IO_URING)
+    done = uring_chunks(rfd, bufs.get(), nbufs, aligned, target, output.data());
+#endif
+    if (!done) pread_chunks(rfd, bufs.get(), aligned, target, output.data());
+
+    return target;
+  }
+
+  /// set the number of bytes per read.  rounded up to a multiple of 4096.
+  void set_chunk_size(size_t const & bytes) {
+    chunk_bytes = ::std::max(static_cast<size_t>(alignment), (bytes + alignment - 1) & ~(alignment - 1));
+  }
+  /// set the maximum number of reads in flight.
+  void set_queue_depth(unsigned const & depth) {
+    queue_depth = ::std::max(1U, depth);
+  }
+  /// use registered (fixed) buffers.  falls back to plain reads if registration fails.
+  void set_registered_buffers(bool const & use) {
+    registered_buffers = use;
+  }
+  /// whether reads use O_DIRECT.
+  bool is_direct() const { return direct_fd >= 0; }
+
+  /**
+   * initializes a file for reading
+   * @param _filename   name of file to open
+   */
+  uring_file(std::string const & _filename) : ::bliss::io::base_file(_filename),
+    direct_fd(-1), chunk_bytes(1UL << 20), queue_depth(16), registered_buffers(false) {
+    this->open_direct();
+  };
+
+  /**
+   * initializes a file for reading.  for use by a parallel file (composition pattern)
+   * @param _filename   name of file to open
+   * @param _file_size  previously computed file size.
+   */
+  uring_file(std::string const & _filename, size_t const & _file_size, size_t const & delay_ms) :
+    ::bliss::io::base_file(_filename, _file_size, delay_ms),
+    direct_fd(-1), chunk_bytes(1UL << 20), queue_depth(16), registered_buffers(false) {
+    this->open_direct();
+  };
+
+  /**
+   * initializes a file for reading.  for use by a parallel file (composition pattern)
+   * @param _fd   previously opened file descriptor
+   * @param _file_size  previously computed file size.
+   */
+  uring_file(int const & _fd, size_t const & _file_size) :
+    ::bliss::io::base_file(_fd, _file_size),
+    direct_fd(-1), chunk_bytes(1UL << 20), queue_depth(16), registered_buffers(false) {
+    this->open_direct();
+  };
+
+  /// destructor
+  virtual ~uring_file() {
+    if (direct_fd >= 0) close(direct_fd);
+  };
+
+  // this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
+  using BASE::read_file;
+
 };
 
 #ifdef USE_MPI
@@ -1149,6 +1535,11 @@ public:
 	// this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
 	using BASE::read_range;
 
+	/// access the underlying reader, e.g. to set the mmap_file mapping policy before reading.
+	FileReader & get_reader() {
+	  return reader;
+	}
+
 	/**
 	 * @brief  bulk load the data and return it in a newly constructed vector.  block decomposes the range.  reuse vector.  no overlap
 	 * @note   virtual so other overloads of this function can also block decompose the range.
@@ -1173,7 +1564,10 @@ public:
 	 */
 	partitioned_file(std::string const & _filename, size_t const & _overlap = 0UL, ::mxx::comm const & _comm = ::mxx::comm()) :
 		BaseType(_filename, _comm),
-		 reader(this->fd, this->file_range_bytes.end), overlap(_overlap) {};
+		 reader(this->reader_source(), this->file_range_bytes.end), overlap(_overlap) {
+	  // readers of compressed files (gzip_file) report the uncompressed size.  partition in that space.
+	  this->file_range_bytes.end = reader.size();
+	};
 
 	/// destructor
 	virtual ~partitioned_file() {};  // will call super's unmap.
@@ -1230,6 +1624,154 @@ protected:
 	/// partitioner to use.
 	::bliss::partition::BlockPartitioner<typename BASE::range_type> partitioner;
 
+	/// use the record_index sidecar:  partition by it if present, write it after boundary discovery if not.
+	bool use_index;
+
+	/**
+	 * @brief  partition on record boundaries using the sidecar record index.  no overlap reads and no exchange.
+	 * @details records are block partitioned by count, so each rank looks up 2 offsets.
+	 * @return false on all ranks if any rank could not open a valid index.
+	 */
+	bool read_file_indexed(::bliss::io::file_data & output) {
+		::bliss::io::record_index idx;
+		bool ok = idx.open(this->filename, this->file_range_bytes.end);
+		if (!::mxx::all_of(ok, this->comm)) return false;
+
+		size_t n = idx.size();
+		size_t p = this->comm.size();
+		size_t r = this->comm.rank();
+		size_t first = (n / p) * r + ::std::min(r, n % p);
+		size_t last = first + (n / p) + ((r < (n % p)) ? 1 : 0);
+
+		range_type target(idx.offset(first), idx.offset(last));
+		// the first rank also owns anything before the first record.
+		if (r == 0) target.start = this->file_range_bytes.start;
+
+		output.in_mem_range_bytes = reader.read_range(output.data, target);
+		output.valid_range_bytes = output.in_mem_range_bytes;
+		output.parent_range_bytes = this->file_range_bytes;
+
+		return true;
+	}
+
+	/// also move whole records between ranks after boundary discovery so that each rank has about the same number of bases.
+	bool balance_bases;
+
+	/**
+	 * @brief  start offset and base count of each record in the valid range, which begins at a record.
+	 * @details a record is 4 lines, and its bases are the 2nd line, excluding a '\r'.
+	 */
+	void scan_records(::bliss::io::file_data const & output, ::std::vector<size_t> & starts, ::std::vector<size_t> & bases) {
+		starts.clear();
+		bases.clear();
+		if (output.valid_range_bytes.size() == 0) return;
+
+		size_t pos = output.valid_range_bytes.start;
+		size_t line_start = pos;
+		size_t line = 0;
+		starts.emplace_back(pos);
+		bases.emplace_back(0);
+		for (auto it = output.cbegin(); it != output.cend(); ++it, ++pos) {
+			if (*it != '\n') continue;
+
+			if ((line & 0x3) == 1)
+				bases.back() = pos - line_start - (((pos > line_start) && (*(it - 1) == '\r')) ? 1 : 0);
+			line_start = pos + 1;
+
+			// a trailing empty line is not a record.
+			if (((++line & 0x3) == 0) && ((pos + 1) < output.valid_range_bytes.end) && (*(it + 1) == '@')) {
+				starts.emplace_back(pos + 1);
+				bases.emplace_back(0);
+			}
+		}
+	}
+
+	/**
+	 * @brief  move whole records to the ranks in dests.  dests[i] is the destination of the record starting at starts[i],
+	 * 			and is non-decreasing over all ranks, so records keep file order.
+	 * @details the transfer is an all2allv as in the boundary shift of read_file, with only the neighbor counts
+	 * 			non-zero in practice.  afterwards in mem and valid ranges are the same, and cover exactly the
+	 * 			received records.
+	 */
+	void move_records(::bliss::io::file_data & output, ::std::vector<size_t> const & starts, ::std::vector<size_t> const & dests) {
+		size_t p = this->comm.size();
+		::std::vector<size_t> send_counts(p, 0);
+		// file offset of the first record sent to each rank.
+		::std::vector<size_t> send_starts(p, ::std::numeric_limits<size_t>::max());
+		for (size_t i = 0; i < starts.size(); ++i) {
+			size_t end = ((i + 1) < starts.size()) ? starts[i + 1] : output.valid_range_bytes.end;
+			send_counts[dests[i]] += end - starts[i];
+			send_starts[dests[i]] = ::std::min(send_starts[dests[i]], starts[i]);
+		}
+
+		::std::vector<size_t> recv_starts = ::mxx::all2all(send_starts, this->comm);
+		size_t new_start = *(::std::min_element(recv_starts.begin(), recv_starts.end()));
+
+		typename ::bliss::io::file_data::container valid(output.cbegin(), output.cend());
+		::mxx::all2allv(valid, send_counts, this->comm).swap(output.data);
+
+		// a rank that receives nothing gets an empty range at the end of the previous one.
+		size_t new_end = (output.data.size() == 0) ? 0 : new_start + output.data.size();
+		size_t prev_end = ::mxx::exscan(new_end, [](size_t const & x, size_t const & y){
+			return (x < y) ? y : x;
+		}, this->comm);
+		if (this->comm.rank() == 0) prev_end = output.valid_range_bytes.start;
+		if (output.data.size() == 0) new_start = prev_end;
+
+		output.in_mem_range_bytes = range_type(new_start, new_start + output.data.size());
+		output.valid_range_bytes = output.in_mem_range_bytes;
+	}
+
+	/**
+	 * @brief  move whole records between ranks so that each has about total bases / p.
+	 * @details a record goes to rank (bases before it * p / total), so records mostly move to a neighbor.
+	 */
+	void rebalance_by_bases(::bliss::io::file_data & output) {
+		::std::vector<size_t> starts;
+		::std::vector<size_t> bases;
+		scan_records(output, starts, bases);
+
+		size_t local = ::std::accumulate(bases.begin(), bases.end(), static_cast<size_t>(0));
+		size_t prefix = ::mxx::exscan(local, ::std::plus<size_t>(), this->comm);
+		if (this->comm.rank() == 0) prefix = 0;
+		size_t total = ::mxx::allreduce(local, this->comm);
+
+		size_t p = this->comm.size();
+		::std::vector<size_t> dests(starts.size(), this->comm.rank());
+		for (size_t i = 0; i < starts.size(); ++i) {
+			if (total > 0) dests[i] = ::std::min(p - 1, (prefix * p) / total);
+			prefix += bases[i];
+		}
+
+		move_records(output, starts, dests);
+	}
+
+	/**
+	 * @brief  write the sidecar record index from the partitions found by boundary discovery.
+	 * @details each rank lists the record starts in its valid range, which begins at a record:  every 4th line start.
+	 * 			rank 0 creates the sidecar, all ranks write their entries at their exscan position, and rank 0
+	 * 			renames it into place.  failure, e.g. a read only directory, just leaves no index.
+	 */
+	void write_record_index(::bliss::io::file_data const & output) {
+		::std::vector<size_t> starts;
+		::std::vector<size_t> bases;
+		scan_records(output, starts, bases);
+
+		size_t first = ::mxx::exscan(starts.size(), ::std::plus<size_t>(), this->comm);
+		if (this->comm.rank() == 0) first = 0;
+		size_t total = ::mxx::allreduce(starts.size(), this->comm);
+
+		bool ok = (this->comm.rank() == 0) ?
+				::bliss::io::record_index::create(this->filename, this->file_range_bytes.end, total) : true;
+		ok = ::mxx::all_of(ok, this->comm);
+		if (!ok) return;
+
+		ok = ::bliss::io::record_index::write_entries(this->filename, first, starts);
+		ok = ::mxx::all_of(ok, this->comm);
+		if (this->comm.rank() == 0) ::bliss::io::record_index::publish(this->filename, ok);
+		this->comm.barrier();
+	}
+
 	/**
 	 * @brief partitions the specified range by the number of processes in communicator
 	 * @note  does not add overlap.  this is strictly for block partitioning a range.
@@ -1298,6 +1840,73 @@ public:
 	// this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
 	using BASE::read_range;
 
+	/// access the underlying reader, e.g. to set the mmap_file mapping policy before reading.
+	FileReader & get_reader() {
+	  return reader;
+	}
+
+	/// partition with the record_index sidecar (<file>.bri), writing it on the first read if it does not exist.
+	void set_record_index(bool const & use) {
+	  use_index = use;
+	}
+
+	/// after boundary discovery, move whole records between ranks so that each has about the same number of bases.
+	void set_balance_bases(bool const & balance) {
+	  balance_bases = balance;
+	}
+
+	/// number of records in the valid range of output, as read by read_file or read_records.
+	size_t count_records(::bliss::io::file_data const & output) {
+		::std::vector<size_t> starts;
+		::std::vector<size_t> bases;
+		scan_records(output, starts, bases);
+		return starts.size();
+	}
+
+	/**
+	 * @brief  read records [first, last) of the file, by global record index.  collective.  ranges may differ per rank,
+	 * 			but have to be non-overlapping and in rank order, e.g. from the record partition of another file.
+	 * @details with the record_index sidecar, the 2 offsets are looked up and the range is read directly.  otherwise
+	 * 			the file is read and its boundaries found as in read_file, the record counts are prefix scanned to get
+	 * 			global record indices, and each record is moved to the rank whose [first, last) contains it.
+	 * 			records past the last rank's last stay with the last rank.
+	 */
+	void read_records(::bliss::io::file_data & output, size_t const & first, size_t const & last) {
+		::bliss::io::record_index idx;
+		bool ok = use_index && idx.open(this->filename, this->file_range_bytes.end);
+		if (::mxx::all_of(ok, this->comm)) {
+			range_type target(idx.offset(first), idx.offset(last));
+			if (this->comm.rank() == 0) target.start = this->file_range_bytes.start;
+			if (this->comm.rank() == (this->comm.size() - 1)) target.end = this->file_range_bytes.end;
+
+			output.in_mem_range_bytes = reader.read_range(output.data, target);
+			output.valid_range_bytes = output.in_mem_range_bytes;
+			output.parent_range_bytes = this->file_range_bytes;
+			return;
+		}
+
+		bool balance = balance_bases;
+		balance_bases = false;
+		this->read_file(output);
+		balance_bases = balance;
+		if (this->comm.size() == 1) return;
+
+		::std::vector<size_t> starts;
+		::std::vector<size_t> bases;
+		scan_records(output, starts, bases);
+		size_t record = ::mxx::exscan(starts.size(), ::std::plus<size_t>(), this->comm);
+		if (this->comm.rank() == 0) record = 0;
+
+		// record i goes to the last rank whose first is at or before i.
+		::std::vector<size_t> firsts = ::mxx::allgather(first, this->comm);
+		::std::vector<size_t> dests(starts.size(), 0);
+		for (size_t i = 0; i < starts.size(); ++i, ++record) {
+			dests[i] = ::std::upper_bound(firsts.begin() + 1, firsts.end(), record) - (firsts.begin() + 1);
+		}
+
+		move_records(output, starts, dests);
+	}
+
 	/**
 	 * @brief  bulk load the data and return it in a newly constructed vector.  block decomposes the range.  reuse vector.  no overlap
 	 * @note   virtual so other overloads of this function can also block decompose the range.
@@ -1324,7 +1933,10 @@ public:
 	 */
 	partitioned_file(std::string const & _filename, size_t const & _overlap = 0UL, ::mxx::comm const & _comm = ::mxx::comm()) :
 		BaseType(_filename, _comm),
-		 reader(this->fd, this->file_range_bytes.end), overlap(0UL) {};
+		 reader(this->reader_source(), this->file_range_bytes.end), overlap(0UL), use_index(false), balance_bases(false) {
+	  // readers of compressed files (gzip_file) report the uncompressed size.  partition in that space.
+	  this->file_range_bytes.end = reader.size();
+	};
 
 	/// destructor
 	virtual ~partitioned_file() {};  // will call super's unmap.
@@ -1341,6 +1953,11 @@ public:
 	 */
 	virtual void read_file(::bliss::io::file_data & output) {
 
+		if (use_index && read_file_indexed(output)) {
+			if (balance_bases && (this->comm.size() > 1)) rebalance_by_bases(output);
+			return;
+		}
+
 //		std::cout << " rank " << this->comm.rank() << " FASTQ: in mem " << output.in_mem_range_bytes << " valid " << output.valid_range_bytes << std::endl;
 
 		// overlap is set to page size, so output will have sufficient space.
@@ -1423,6 +2040,8 @@ public:
 
 //		std::cout << "rank " << this->comm.rank() << " file  " << output.parent_range_bytes << std::endl;
 
+		if (use_index) write_record_index(output);
+		if (balance_bases && (this->comm.size() > 1)) rebalance_by_bases(output);
 	}
 
 
@@ -1520,6 +2139,11 @@ public:
 	// this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
 	using BASE::read_range;
 
+	/// access the underlying reader, e.g. to set the mmap_file mapping policy before reading.
+	FileReader & get_reader() {
+	  return reader;
+	}
+
 	/**
 	 * @brief  bulk load the data and return it in a newly constructed vector.  block decomposes the range.  reuse vector.  no overlap
 	 * @note   virtual so other overloads of this function can also block decompose the range.
@@ -1546,7 +2170,10 @@ public:
 	 */
 	partitioned_file(std::string const & _filename, size_t const & _overlap = 0UL, ::mxx::comm const & _comm = ::mxx::comm()) :
 		BaseType(_filename, _comm),
-		 reader(this->fd, this->file_range_bytes.end), overlap(_overlap) {};
+		 reader(this->reader_source(), this->file_range_bytes.end), overlap(_overlap) {
+	  // readers of compressed files (gzip_file) report the uncompressed size.  partition in that space.
+	  this->file_range_bytes.end = reader.size();
+	};
 
 	/// destructor
 	virtual ~partitioned_file() {};  // will call super's unmap.
@@ -1629,6 +2256,408 @@ class partitioned_file<::bliss::io::stdio_file, FileParser, ::bliss::io::paralle
 
 
 
+/**
+ * @brief  file data in a node shared memory window.  same ranges as file_data, but the bytes belong to the window.
+ * @details valid until the next read_shared call on, or the destruction of, the node_aggregated_file that produced it.
+ *          the iterators are pointers, so parse with e.g. FASTQParser<unsigned char const *>.
+ */
+struct shared_file_data {
+  using const_iterator = unsigned char const *;
+  using range_type = ::bliss::partition::range<size_t>;
+
+  // range from which the data came
+  range_type parent_range_bytes;
+
+  // range loaded in memory.  INCLUDES OVERLAP
+  range_type in_mem_range_bytes;
+
+  // valid range for this.  EXCLUDES OVERLAP
+  range_type valid_range_bytes;
+
+  /// first byte of the in mem range, in the window.
+  const_iterator data;
+
+  shared_file_data() : data(nullptr) {}
+
+  /// beginning of the valid range
+  const_iterator cbegin() const {
+    return data + valid_range_bytes.start - in_mem_range_bytes.start;
+  }
+  /// end of valid range
+  const_iterator cend() const {
+    return data + valid_range_bytes.end - in_mem_range_bytes.start;
+  }
+
+  /// start of inmem range
+  const_iterator in_mem_cbegin() const {
+    return data;
+  }
+  /// end of in mem range
+  const_iterator in_mem_cend() const {
+    return data + in_mem_range_bytes.size();
+  }
+
+  range_type getRange() const {
+    return valid_range_bytes;
+  }
+};
+
+/**
+ * @brief  how node_aggregated_file reads a node's part of the file.
+ *      aggregators   ranks per node that read.  clipped to the number of ranks on the node.
+ *      stripe_bytes  reads end on multiples of this file offset, e.g. the lustre stripe size.  the chunks are dealt
+ *                    round robin to the aggregators.
+ *      tail_bytes    read past the node's last block, so that the last rank's records and overlap are in the window.
+ *                    doubled and reread if not enough.
+ */
+struct aggregation_policy {
+    int aggregators;
+    size_t stripe_bytes;
+    size_t tail_bytes;
+
+    aggregation_policy() : aggregators(1), stripe_bytes(32UL << 20), tail_bytes(1UL << 20) {}
+};
+
+/**
+ * @brief  parallel file where a few aggregator ranks per node read for all ranks on the node.
+ * @details  base_shared_fd_file shares 1 descriptor per node, but each rank still reads its own range, so a node with
+ *           many ranks has as many concurrent readers.  here the ranks of a node allocate 1 MPI shared memory window
+ *           covering all their block partitions, the aggregators fill it with large stripe aligned preads, and
+ *           read_shared returns each rank's partition as pointers into the window, without a per rank copy.
+ *
+ *           partitions are the same as partitioned_file's:  block partition, record starts from FileParser::init_parser,
+ *           and overlap from find_overlap_end.  a rank whose block has no record start gets an empty range, and the
+ *           previous rank's records extend over its block.  the in mem range starts at the valid range, not at the
+ *           block start as in partitioned_file<FASTQ>.  read_file copies the partition out of the window,
+ *           so this can also stand in for a partitioned_file.
+ *
+ *           read_shared, read_file and the destructor are collective.  the window is freed at the next read_shared.
+ */
+template <template <typename> class FileParser = ::bliss::io::BaseFileParser >
+class node_aggregated_file : public ::bliss::io::parallel::base_shared_fd_file {
+protected:
+  using BASE = ::bliss::io::parallel::base_shared_fd_file;
+  using range_type = typename BASE::range_type;
+  using FileParserType = FileParser<unsigned char const *>;
+
+  /// reader for read_range, on the shared descriptor.
+  ::bliss::io::posix_file reader;
+
+  /// overlap amount
+  const size_t overlap;
+
+  /// aggregator count and read sizes.
+  aggregation_policy policy;
+
+  /// ranks on this node.
+  ::mxx::comm node;
+
+  /// node shared window, and the file range it holds.
+  MPI_Win win;
+  unsigned char * window;
+  range_type window_range;
+
+  /// partitioner to use.
+  ::bliss::partition::BlockPartitioner<range_type> partitioner;
+
+  /// block partition of the file, as partitioned_file.
+  range_type partition(range_type const & range_bytes) {
+    range_type target = range_type::intersect(range_bytes, this->file_range_bytes);
+    if (this->comm.size() == 1) return target;
+
+    partitioner.configure(target, this->comm.size());
+    return partitioner.getNext(this->comm.rank());
+  }
+
+  /// free the window.  collective on node.
+  void free_window() {
+    if (win == MPI_WIN_NULL) return;
+
+    MPI_Win_unlock_all(win);
+    MPI_Win_free(&win);
+    window = nullptr;
+    window_range = range_type(0, 0);
+  }
+
+  /// pread the range into out.
+  void read_chunk(unsigned char * out, range_type const & target) {
+    size_t s = 0;
+    long count;
+
+    //pread64 can only read 2GB at a time
+    for (; s < target.size(); s += count) {
+      count = pread64(this->fd, out + s, std::min(1UL << 30, target.size() - s),
+                      static_cast<__off64_t>(target.start + s));
+
+      if (count <= 0) {
+        std::stringstream ss;
+        int myerr = errno;
+        ss << "ERROR: pread64: file " << this->filename << " error " << myerr << ": " << strerror(myerr);
+        throw ::bliss::utils::make_exception<bliss::io::IOException>(ss.str());
+      }
+    }
+  }
+
+  /// allocate the window for r on the node, and read r into it on the aggregators.  collective on node.
+  void fill_window(range_type const & r) {
+    this->free_window();
+
+    // all of it on the first rank, so the window is contiguous.
+    MPI_Aint bytes = (node.rank() == 0) ? r.size() : 0;
+    MPI_Win_allocate_shared(bytes, 1, MPI_INFO_NULL, node, &window, &win);
+    MPI_Aint size;
+    int disp;
+    MPI_Win_shared_query(win, 0, &size, &disp, &window);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+    window_range = r;
+
+    int aggregators = ::std::max(1, ::std::min(policy.aggregators, node.size()));
+    if (node.rank() < aggregators) {
+      size_t stripe = ::std::max(policy.stripe_bytes, 1UL);
+      size_t i = 0;
+      for (size_t s = r.start, e; s < r.end; s = e, ++i) {
+        e = ::std::min(r.end, (s / stripe + 1) * stripe);
+        if (static_cast<int>(i % aggregators) == node.rank())
+          read_chunk(window + (s - r.start), range_type(s, e));
+      }
+    }
+
+    // make the aggregators' writes visible to the node.
+    MPI_Win_sync(win);
+    node.barrier();
+    MPI_Win_sync(win);
+  }
+
+public:
+  // this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
+  using BASE::read_range;
+
+  /// access the aggregation policy, e.g. to set the aggregator count before reading.
+  aggregation_policy & get_policy() {
+    return policy;
+  }
+
+  /**
+   * @brief  bulk load the data and return it in a newly constructed vector.  block decomposes the range.  reuse vector.  no overlap
+   * @note   reads on each rank, as partitioned_file.  read_shared is the aggregated read.
+   * @param range_bytes range to read, in bytes
+   * @param output    vector containing data as bytes.
+   */
+  virtual range_type read_range(typename ::bliss::io::file_data::container & output,
+                                range_type const & range_bytes) {
+    range_type target = partition(range_bytes);
+    reader.read_range(output, target);
+    return target;
+  }
+
+  /**
+   * @brief  read the node's partitions into the shared window, and return this rank's partition in it.
+   * @note   collective.  invalidates the result of the previous call.
+   */
+  shared_file_data read_shared() {
+    range_type file = this->file_range_bytes;
+    range_type block = partition(file);
+
+    // the node's blocks, which need not be consecutive, and a tail.
+    size_t lo = ::mxx::allreduce(block.start, [](size_t const & x, size_t const & y){ return ::std::min(x, y); }, node);
+    size_t hi = ::mxx::allreduce(block.end, [](size_t const & x, size_t const & y){ return ::std::max(x, y); }, node);
+    size_t tail = policy.tail_bytes;
+    this->fill_window(range_type::intersect(range_type(lo, hi + tail), file));
+
+    // record start in the block.
+    FileParserType parser;
+    size_t start = parser.init_parser(window, file, window_range, block, this->comm);
+    bool found = (start < block.end);
+    start = ::std::min(start, block.end);
+
+    // the valid range ends at the next record start on a later rank.
+    size_t next = ::mxx::exscan(found ? start : file.end, [](size_t const & x, size_t const & y){
+      return ::std::min(x, y);
+    }, this->comm.reverse());
+    if (this->comm.rank() == (this->comm.size() - 1)) next = file.end;
+
+    shared_file_data output;
+    output.parent_range_bytes = file;
+    output.valid_range_bytes = found ? range_type(start, next) : range_type(next, next);
+    range_type & valid = output.valid_range_bytes;
+
+    // add the overlap.  grow the window until it holds every rank's.
+    size_t end = valid.end;
+    while (true) {
+      bool fits = (valid.size() == 0) || (overlap == 0 && window_range.contains(valid));
+      if (!fits && window_range.contains(valid)) {
+        end = parser.find_overlap_end(window, file, window_range, valid.end, overlap);
+        fits = (end < window_range.end) || (window_range.end == file.end);
+      }
+      if (::mxx::all_of(fits, node)) break;
+
+      tail <<= 1;
+      hi = ::mxx::allreduce(::std::max(hi, valid.end), [](size_t const & x, size_t const & y){ return ::std::max(x, y); }, node);
+      this->fill_window(range_type::intersect(range_type(lo, hi + tail), file));
+    }
+
+    output.in_mem_range_bytes = range_type(valid.start, end);
+    output.data = (output.in_mem_range_bytes.size() == 0) ? window :
+        window + (output.in_mem_range_bytes.start - window_range.start);
+
+    return output;
+  }
+
+  /**
+   * @brief constructor
+   * @param _filename     name of file to open
+   * @param _overlap      overlap after each partition
+   * @param _comm       MPI communicator to use.
+   * @param _policy       aggregator count and read sizes.
+   */
+  node_aggregated_file(std::string const & _filename, size_t const & _overlap = 0UL, ::mxx::comm const & _comm = ::mxx::comm(),
+                       aggregation_policy const & _policy = aggregation_policy()) :
+    BASE(_filename, _comm),
+    reader(this->fd, this->file_range_bytes.end), overlap(_overlap), policy(_policy),
+    node(this->comm.split_shared()), win(MPI_WIN_NULL), window(nullptr), window_range(0, 0) {};
+
+  /// destructor.  collective on the node.
+  virtual ~node_aggregated_file() {
+    this->free_window();
+  };
+
+  // this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
+  using BASE::read_file;
+
+  /**
+   * @brief  read this rank's partition, and copy it out of the window.
+   * @param output    file_data object containing data and various ranges.
+   */
+  virtual void read_file(::bliss::io::file_data & output) {
+    shared_file_data s = this->read_shared();
+
+    output.data.assign(s.in_mem_cbegin(), s.in_mem_cend());
+    output.parent_range_bytes = s.parent_range_bytes;
+    output.in_mem_range_bytes = s.in_mem_range_bytes;
+    output.valid_range_bytes = s.valid_range_bytes;
+  }
+};
+
+
+/**
+ * @brief  MPI-IO hints for mpiio_file.
+ * @details  on lustre and gpfs, collective buffering with aggregators and buffers sized to the stripes makes a large
+ *           difference for MPI_File_read_at_all.  fields that are 0 or empty are not passed.  with autodetect,
+ *           mpiio_base_file fills the unset fields from the file's stripe layout at open:
+ *             lustre:  stripe size and count from the lustre.lov xattr (what llapi_file_get_stripe reads), or st_blksize.
+ *             gpfs:    file system block size.
+ *           then cb_nodes is the stripe count (or the node count) capped at the node count, cb_buffer_size is 16MB
+ *           rounded up to a stripe, and romio_cb_read and romio_cb_write are "enable".  nothing is derived on other
+ *           file systems.
+ *
+ *           align:  move the partition boundaries between ranks to the nearest multiple of striping_unit, so each rank's
+ *           collective read starts on a stripe.  the overlap is still read after each partition.
+ */
+struct mpiio_hints {
+    bool autodetect;
+    bool align;
+
+    int cb_nodes;
+    size_t cb_buffer_size;
+    size_t striping_unit;
+    int striping_factor;
+    ::std::string romio_cb_read;
+    ::std::string romio_cb_write;
+
+    /// other hints, passed as is.
+    ::std::vector<::std::pair<::std::string, ::std::string> > extra;
+
+    mpiio_hints() : autodetect(true), align(false), cb_nodes(0), cb_buffer_size(0), striping_unit(0), striping_factor(0) {}
+
+    /**
+     * @brief  stripe size and count of a file on lustre or gpfs.
+     * @return false on other file systems.  count is 0 if unknown.
+     */
+    static bool stripe_layout(::std::string const & filename, size_t & unit, int & count) {
+      unit = 0;
+      count = 0;
+
+      struct statfs fs;
+      if (statfs(filename.c_str(), &fs) != 0) return false;
+
+      if (static_cast<unsigned long>(fs.f_type) == 0x0BD00BD0UL) {  // LUSTRE_SUPER_MAGIC
+        // lov_user_md v1 or v3:  magic, pattern, 16 byte object id, then 4 byte stripe size and 2 byte stripe count.
+        ssize_t len = getxattr(filename.c_str(), "lustre.lov", nullptr, 0);
+        if (len >= 32) {
+          ::std::vector<unsigned char> lov(len);
+          len = getxattr(filename.c_str(), "lustre.lov", lov.data(), lov.size());
+          uint32_t magic = 0;
+          if (len >= 32) memcpy(&magic, lov.data(), sizeof(uint32_t));
+          if ((magic == 0x0BD10BD0U) || (magic == 0x0BD30BD0U)) {  // LOV_USER_MAGIC_V1, _V3.  composite layouts are not parsed.
+            uint32_t su;
+            uint16_t sc;
+            memcpy(&su, lov.data() + 24, sizeof(uint32_t));
+            memcpy(&sc, lov.data() + 28, sizeof(uint16_t));
+            unit = su;
+            count = sc;
+          }
+        }
+        if (unit == 0) {
+          struct stat64 st;
+          if (stat64(filename.c_str(), &st) == 0) unit = st.st_blksize;
+        }
+        return true;
+      }
+      if (static_cast<unsigned long>(fs.f_type) == 0x47504653UL) {  // GPFS_SUPER_MAGIC
+        unit = fs.f_bsize;
+        return true;
+      }
+      return false;
+    }
+
+    /// fill the unset fields from a stripe layout and the number of nodes.
+    void derive(size_t const & unit, int const & count, int const & nodes) {
+      if (striping_unit == 0) striping_unit = unit;
+      if (striping_factor == 0) striping_factor = count;
+      if (cb_nodes == 0) cb_nodes = ::std::min((count > 0) ? count : nodes, nodes);
+      if ((cb_buffer_size == 0) && (unit > 0)) cb_buffer_size = ((16UL << 20) + unit - 1) / unit * unit;
+      if (romio_cb_read.empty()) romio_cb_read = "enable";
+      if (romio_cb_write.empty()) romio_cb_write = "enable";
+    }
+
+    /**
+     * @brief  derive the unset fields from the stripe layout of path, a file or, for a new file, its directory.
+     * @note   collective.  only rank 0 looks at the file system.
+     */
+    void detect(::std::string const & path, ::mxx::comm const & comm) {
+      size_t layout[3] = {0, 0, 0};
+      if (comm.rank() == 0) {
+        int count = 0;
+        layout[0] = stripe_layout(path, layout[1], count) ? 1 : 0;
+        layout[2] = count;
+      }
+      MPI_Bcast(layout, 3, MPI_UNSIGNED_LONG, 0, comm);
+
+      int nodes = (comm.split_shared().rank() == 0) ? 1 : 0;
+      nodes = ::mxx::allreduce(nodes, comm);
+      if (layout[0] == 1) derive(layout[1], static_cast<int>(layout[2]), nodes);
+    }
+
+    /// MPI_Info with the set hints.  the caller frees it.  MPI_INFO_NULL if there are none.
+    MPI_Info to_info() const {
+      ::std::vector<::std::pair<::std::string, ::std::string> > kv;
+      if (cb_nodes > 0) kv.emplace_back("cb_nodes", ::std::to_string(cb_nodes));
+      if (cb_buffer_size > 0) kv.emplace_back("cb_buffer_size", ::std::to_string(cb_buffer_size));
+      if (striping_unit > 0) kv.emplace_back("striping_unit", ::std::to_string(striping_unit));
+      if (striping_factor > 0) kv.emplace_back("striping_factor", ::std::to_string(striping_factor));
+      if (!romio_cb_read.empty()) kv.emplace_back("romio_cb_read", romio_cb_read);
+      if (!romio_cb_write.empty()) kv.emplace_back("romio_cb_write", romio_cb_write);
+      kv.insert(kv.end(), extra.begin(), extra.end());
+      if (kv.empty()) return MPI_INFO_NULL;
+
+      MPI_Info info;
+      MPI_Info_create(&info);
+      for (auto const & x : kv) MPI_Info_set(info, const_cast<char *>(x.first.c_str()), const_cast<char *>(x.second.c_str()));
+      return info;
+    }
+};
+
+
 // multilevel parallel file io relies on MPIIO.
 template <template <typename> class FileParser = ::bliss::io::BaseFileParser >
 class mpiio_base_file : public ::bliss::io::base_file {
@@ -1647,6 +2676,9 @@ protected:
 	/// MPI file handle
 	MPI_File fh;
 
+	/// MPI-IO hints.  with autodetect, the derived fields are filled in at open.
+	mpiio_hints hints;
+
 	/// partitioner to use.
 	::bliss::partition::BlockPartitioner<range_type> partitioner;
 
@@ -1712,8 +2744,12 @@ protected:
 	// first clear previously open file
 		close_file();
 
+		if (hints.autodetect) hints.detect(this->filename, this->comm);
+
 		// open the file
-		int res = MPI_File_open(this->comm, const_cast<char *>(this->filename.c_str()), MPI_MODE_RDONLY, MPI_INFO_NULL, &fh);
+		MPI_Info info = hints.to_info();
+		int res = MPI_File_open(this->comm, const_cast<char *>(this->filename.c_str()), MPI_MODE_RDONLY, info, &fh);
+		if (info != MPI_INFO_NULL) MPI_Info_free(&info);
 
 		if (res != MPI_SUCCESS) {
 			throw ::bliss::utils::make_exception<::bliss::io::IOException>(get_error_string("open", res));
@@ -1763,8 +2799,20 @@ public:
 
 		// do equal partition
 		if (comm.size() > 1) {
+			range_type whole = target;
 			partitioner.configure(target, comm.size());
 			target = partitioner.getNext(comm.rank());
+
+			// move the boundaries between ranks to the nearest stripe.  same function of the same boundary on both sides.
+			if (hints.align && (hints.striping_unit > 0)) {
+				size_t unit = hints.striping_unit;
+				auto align = [&whole, &unit](size_t const & x) {
+					return ::std::max(whole.start, ::std::min(whole.end, (x + unit / 2) / unit * unit));
+				};
+				if (target.start != whole.start) target.start = align(target.start);
+				if (target.end != whole.end) target.end = align(target.end);
+				target.end = ::std::max(target.start, target.end);
+			}
 		}
 
 		// compute the size to read.
@@ -1908,11 +2956,63 @@ public:
 		return target;
 	}
 
+	/**
+	 * @brief  start an independent, nonblocking read of range_bytes into output.  NOT collective, and no partitioning or overlap.
+	 * @details  used by prefetching_reader to overlap reading the next block with parsing the current one.
+	 *      issues MPI_File_iread_at in steps of 2^30 bytes, since element count is int.
+	 *      complete with wait_range.  output must not be resized before completion.
+	 * @return  requests to wait on.
+	 */
+	::std::vector<MPI_Request> iread_range(typename ::bliss::io::file_data::container & output,
+	                                       range_type const & range_bytes) {
+		if (fh == MPI_FILE_NULL) {
+			std::stringstream ss;
+			ss << "ERROR in mpiio: rank " << comm.rank() << " file " << this->filename << " not yet open " << std::endl;
+
+			throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+		}
+
+		range_type target = BASE::range_type::intersect(range_bytes, this->file_range_bytes);
+		output.resize(target.size());
+
+		size_t step_size = 1UL << 30;
+		::std::vector<MPI_Request> reqs;
+		reqs.reserve((target.size() + step_size - 1) / step_size);
 
-	mpiio_base_file(::std::string const & _filename, size_t const _overlap = 0UL,  ::mxx::comm const & _comm = ::mxx::comm()) :
+		int res = MPI_SUCCESS;
+		for (size_t offset = 0; offset < target.size(); offset += step_size) {
+			reqs.emplace_back(MPI_REQUEST_NULL);
+			res = MPI_File_iread_at(fh, target.start + offset, output.data() + offset,
+			                        ::std::min(step_size, target.size() - offset), MPI_BYTE, &(reqs.back()));
+			if (res != MPI_SUCCESS)
+			  throw ::bliss::utils::make_exception<::bliss::io::IOException>(get_error_string("iread", res));
+		}
+
+		return reqs;
+	}
+
+	/// complete the reads started by iread_range.
+	void wait_range(::std::vector<MPI_Request> & reqs) {
+		if (reqs.size() == 0) return;
+
+		::std::vector<MPI_Status> stats(reqs.size());
+		int res = MPI_Waitall(reqs.size(), reqs.data(), stats.data());
+		if (res != MPI_SUCCESS) {
+			for (size_t i = 0; i < stats.size(); ++i) {
+				if (stats[i].MPI_ERROR != MPI_SUCCESS)
+				  throw ::bliss::utils::make_exception<::bliss::io::IOException>(get_error_string("iread wait", res, stats[i]));
+			}
+			throw ::bliss::utils::make_exception<::bliss::io::IOException>(get_error_string("iread wait", res));
+		}
+		reqs.clear();
+	}
+
+
+	mpiio_base_file(::std::string const & _filename, size_t const _overlap = 0UL,  ::mxx::comm const & _comm = ::mxx::comm(),
+	                mpiio_hints const & _hints = mpiio_hints()) :
 	  BASE(static_cast<int>(-1), static_cast<size_t>(0)),
 	 	 overlap(_overlap),
-				  comm(_comm.copy()), fh(MPI_FILE_NULL) {
+				  comm(_comm.copy()), fh(MPI_FILE_NULL), hints(_hints) {
 		this->filename = _filename;
 	  this->open_file();
 		this->file_range_bytes.end = this->get_file_size();  // call after opening file
@@ -1920,6 +3020,11 @@ public:
 
 	~mpiio_base_file() { this->close_file(); };
 
+	/// the hints the file was opened with, including the derived ones.
+	mpiio_hints const & get_hints() const {
+		return hints;
+	}
+
 	// this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
 	using BASE::read_file;
 
@@ -1943,8 +3048,9 @@ public:
 		using FileParserType = typename BASE::FileParserType;
 
 
-		mpiio_file(::std::string const & _filename, size_t const & _overlap = 0UL, ::mxx::comm const & _comm = ::mxx::comm()) :
-			BASE(_filename, _overlap, _comm) {};
+		mpiio_file(::std::string const & _filename, size_t const & _overlap = 0UL, ::mxx::comm const & _comm = ::mxx::comm(),
+		           mpiio_hints const & _hints = mpiio_hints()) :
+			BASE(_filename, _overlap, _comm, _hints) {};
 
 		~mpiio_file() {};
 
@@ -1998,8 +3104,9 @@ public:
 		using FileParserType = typename BASE::FileParserType;
 
 
-		mpiio_file(::std::string const & _filename, size_t const & _overlap = 0UL, ::mxx::comm const & _comm = ::mxx::comm()) :
-			BASE(_filename, 0UL, _comm) {};      // specify 1 page worth as overlap
+		mpiio_file(::std::string const & _filename, size_t const & _overlap = 0UL, ::mxx::comm const & _comm = ::mxx::comm(),
+		           mpiio_hints const & _hints = mpiio_hints()) :
+			BASE(_filename, 0UL, _comm, _hints) {};      // specify 1 page worth as overlap
 
 		~mpiio_file() { };
 
@@ -2121,8 +3228,9 @@ public:
 		using FileParserType = typename BASE::FileParserType;
 
 
-		mpiio_file(::std::string const & _filename, size_t const & _overlap = 0UL, ::mxx::comm const & _comm = ::mxx::comm()) :
-			BASE(_filename, _overlap, _comm) {};      // specify 1 page worth as overlap
+		mpiio_file(::std::string const & _filename, size_t const & _overlap = 0UL, ::mxx::comm const & _comm = ::mxx::comm(),
+		           mpiio_hints const & _hints = mpiio_hints()) :
+			BASE(_filename, _overlap, _comm, _hints) {};      // specify 1 page worth as overlap
 
 		~mpiio_file() { };
 
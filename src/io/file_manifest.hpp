@@ -0,0 +1,181 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    file_manifest.hpp
+ * @ingroup io
+ * @author  tpan
+ * @brief   a list of input files, block partitioned as one concatenated byte range.
+ * @details runs over thousands of lane files used to open and partition each file in turn over all processes.  every
+ *          open is collective, and a small file leaves most processes with nothing to do.
+ *
+ *          file_manifest takes a list of files, or a glob pattern, or a file with one name per line.  rank 0 gets the
+ *          sizes and broadcasts them, and the files are treated as one range in list order.  slices(rank, p) block
+ *          partitions that range and maps the rank's block back to (file, byte range) pieces.  a rank's block is
+ *          contiguous, so each file appears at most once in its slices, and a process opens each of its files once.
+ *
+ *          a slice is a byte range like a partition of a single file:  the records that start in it belong to it.
+ *          see KmerFileHelper::read_files_streaming.
+ */
+#ifndef SRC_IO_FILE_MANIFEST_HPP_
+#define SRC_IO_FILE_MANIFEST_HPP_
+
+#include <glob.h>       // glob
+#include <sys/stat.h>   // stat64
+#include <cerrno>
+#include <cstring>      // strerror
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(USE_MPI)
+#include <mpi.h>
+#endif
+
+#include <mxx/comm.hpp>
+
+#include "io/io_exception.hpp"
+#include "partition/range.hpp"
+#include "utils/exception_handling.hpp"
+
+namespace bliss
+{
+  namespace io
+  {
+
+    class file_manifest {
+      public:
+        using range_type = ::bliss::partition::range<size_t>;
+
+        /// part of one file assigned to a rank.
+        struct slice {
+            size_t file;
+            range_type range;
+        };
+
+        /// files matching a glob pattern, sorted.
+        static std::vector<std::string> expand(std::string const & pattern) {
+          std::vector<std::string> files;
+          glob_t g;
+          if (::glob(pattern.c_str(), 0, nullptr, &g) == 0) {
+            files.assign(g.gl_pathv, g.gl_pathv + g.gl_pathc);
+          }
+          globfree(&g);
+          return files;
+        }
+
+        /// file names from a list file, one per line.  empty lines and lines starting with '#' are skipped.
+        static std::vector<std::string> read_list(std::string const & list_file) {
+          std::vector<std::string> files;
+          std::ifstream in(list_file);
+          if (!in.good()) {
+            ::std::stringstream ss;
+            ss << "ERROR : bliss::io::file_manifest::read_list: cannot open [" << list_file << "]";
+            throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+          }
+          std::string line;
+          while (std::getline(in, line)) {
+            if (!line.empty() && (line.back() == '\r')) line.pop_back();
+            if (line.empty() || (line[0] == '#')) continue;
+            files.emplace_back(line);
+          }
+          return files;
+        }
+
+      protected:
+        std::vector<std::string> files;
+        /// prefix sum of file sizes.  offsets[i] is the start of file i in the concatenated range.  size is files.size() + 1.
+        std::vector<size_t> offsets;
+
+        static size_t get_file_size(std::string const & filename) {
+          struct stat64 filestat;
+          int ret = stat64(filename.c_str(), &filestat);
+          if (ret < 0) {
+            ::std::stringstream ss;
+            int myerr = errno;
+            ss << "ERROR : bliss::io::file_manifest::get_file_size: ["  << filename << "] " << myerr << ": " << strerror(myerr);
+            throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+          }
+          return static_cast<size_t>(filestat.st_size);
+        }
+
+      public:
+        /**
+         * @brief constructor.  collective:  rank 0 gets the file sizes and broadcasts them.
+         * @param _files  file names.  all processes have to pass the same list.
+         */
+        file_manifest(std::vector<std::string> const & _files, ::mxx::comm const & comm = ::mxx::comm()) :
+          files(_files), offsets(_files.size() + 1, 0) {
+
+          std::vector<size_t> sizes(files.size(), 0);
+          if (comm.rank() == 0) {
+            for (size_t i = 0; i < files.size(); ++i) sizes[i] = get_file_size(files[i]);
+          }
+#if defined(USE_MPI)
+          if ((comm.size() > 1) && (sizes.size() > 0))
+            MPI_Bcast(sizes.data(), sizes.size(), MPI_UNSIGNED_LONG, 0, comm);
+#endif
+          for (size_t i = 0; i < sizes.size(); ++i) offsets[i + 1] = offsets[i] + sizes[i];
+        }
+
+        /// number of files
+        size_t size() const {
+          return files.size();
+        }
+
+        std::string const & file(size_t const & i) const {
+          return files[i];
+        }
+
+        size_t file_size(size_t const & i) const {
+          return offsets[i + 1] - offsets[i];
+        }
+
+        /// total bytes in all files.
+        size_t total_size() const {
+          return offsets.back();
+        }
+
+        /**
+         * @brief pieces of the files that make up block rank of p of the concatenated range.  empty pieces are omitted.
+         * @return slices in list order, with ranges in each file's own byte offsets.
+         */
+        std::vector<slice> slices(size_t const & rank, size_t const & p) const {
+          std::vector<slice> result;
+          if (files.size() == 0) return result;
+
+          size_t total = total_size();
+          size_t start = (total / p) * rank + ::std::min(rank, total % p);
+          size_t end = start + (total / p) + ((rank < (total % p)) ? 1 : 0);
+
+          // first file whose end is after start.
+          size_t f = ::std::upper_bound(offsets.begin() + 1, offsets.end(), start) - (offsets.begin() + 1);
+          for (; (f < files.size()) && (offsets[f] < end); ++f) {
+            size_t s = ::std::max(start, offsets[f]);
+            size_t e = ::std::min(end, offsets[f + 1]);
+            if (s < e) result.emplace_back(slice{f, range_type(s - offsets[f], e - offsets[f])});
+          }
+          return result;
+        }
+    };
+
+  } /* namespace io */
+} /* namespace bliss */
+
+#endif /* SRC_IO_FILE_MANIFEST_HPP_ */
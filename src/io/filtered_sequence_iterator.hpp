@@ -34,8 +34,16 @@
 #include "iterators/filter_iterator.hpp"
 #include "io/fastq_loader.hpp"
 #include "io/file_loader.hpp"
+#include "common/dna_encoder.hpp"  // is_contiguous_char_iterator
 
 #include <algorithm>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace bliss
 {
@@ -164,6 +172,116 @@ namespace bliss
     template <typename Iterator, template <typename> class SeqParser>
     using NFilterSequencesIterator = bliss::io::FilteredSequencesIterator<Iterator, SeqParser, bliss::io::NSequenceFilter>;
 
+    /**
+     * @class bliss::io::NCharFilter
+     * @brief   given a character, return true if it's NOT N.
+     */
+    struct NCharFilter {
+
+        template <typename T>
+        bool operator()(T const & x) {
+          // scan through x to look for NOT N
+          return (x != 'N') && (x != 'n');
+        }
+    };
+
+
+    /**
+     * @brief  find the first character in [b, e) that is (IS_N = true) or is not (IS_N = false) 'N' or 'n'.  scalar version.
+     * @details  (c | 0x20) == 'n' only for 'N' and 'n', so 1 compare covers both cases.
+     */
+    template <bool SIMD = false>
+    struct n_scan {
+        template <bool IS_N>
+        static unsigned char const * find(unsigned char const * b, unsigned char const * e) {
+          for (; b < e; ++b) {
+            if (((*b | 0x20) == 'n') == IS_N) return b;
+          }
+          return e;
+        }
+    };
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    /**
+     * @brief  SIMD version.  compares 32 (AVX2) or 16 (SSE2) characters at a time, and finds the first match
+     *         in the movemask with a count trailing zeros.  long runs of bases or of N are skipped a register at a time.
+     */
+    template <>
+    struct n_scan<true> {
+        template <bool IS_N>
+        static unsigned char const * find(unsigned char const * b, unsigned char const * e) {
+#if defined(__AVX2__)
+          const __m256i lower = _mm256_set1_epi8(0x20);
+          const __m256i n = _mm256_set1_epi8('n');
+          for (; (b + 32) <= e; b += 32) {
+            __m256i v = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(b)), lower);
+            uint32_t m = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, n)));
+            if (!IS_N) m = ~m;
+            if (m != 0) return b + __builtin_ctz(m);
+          }
+#endif
+          const __m128i lower16 = _mm_set1_epi8(0x20);
+          const __m128i n16 = _mm_set1_epi8('n');
+          for (; (b + 16) <= e; b += 16) {
+            __m128i v = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<__m128i const *>(b)), lower16);
+            uint32_t m = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, n16)));
+            if (!IS_N) m = ~m & 0xFFFF;
+            if (m != 0) return b + __builtin_ctz(m);
+          }
+          return n_scan<false>::template find<IS_N>(b, e);
+        }
+    };
+
+    /// best available N scanner for the compiler flags.
+    using NScan = n_scan<true>;
+#else
+    using NScan = n_scan<false>;
+#endif
+
+    /**
+     * @brief  finds the ends of the valid runs of a sequence for SplitSequencesIterator.
+     * @details  generic version tests each character with the predicate.
+     */
+    template <typename Predicate>
+    struct split_scanner {
+        /// first character that passes
+        template <typename Iter>
+        static Iter find_valid(Iter b, Iter e, Predicate & pred) {
+          return ::std::find_if(b, e, pred);
+        }
+        /// first character that fails
+        template <typename Iter>
+        static Iter find_invalid(Iter b, Iter e, Predicate & pred) {
+          return ::std::find_if_not(b, e, pred);
+        }
+    };
+
+    /// NCharFilter:  contiguous char data is scanned with NScan, others with the predicate.
+    template <>
+    struct split_scanner<NCharFilter> {
+        template <typename Iter>
+        static Iter find_valid(Iter b, Iter e, NCharFilter & pred) {
+          return find<false>(b, e, pred, ::bliss::common::is_contiguous_char_iterator<Iter>());
+        }
+        template <typename Iter>
+        static Iter find_invalid(Iter b, Iter e, NCharFilter & pred) {
+          return find<true>(b, e, pred, ::bliss::common::is_contiguous_char_iterator<Iter>());
+        }
+
+      protected:
+        template <bool IS_N, typename Iter>
+        static Iter find(Iter b, Iter e, NCharFilter & pred, ::std::false_type const &) {
+          return IS_N ? ::std::find_if_not(b, e, pred) : ::std::find_if(b, e, pred);
+        }
+        template <bool IS_N, typename Iter>
+        static Iter find(Iter b, Iter e, NCharFilter &, ::std::true_type const &) {
+          if (b == e) return e;
+          unsigned char const * p = reinterpret_cast<unsigned char const *>(&(*b));
+          return b + (NScan::template find<IS_N>(p, p + ::std::distance(b, e)) - p);
+        }
+    };
+
+
     /**
      * @class bliss::io::SplitSequencesIterator
      * @brief Iterator for parsing and traversing a block of data to access individual sequence records (of some file format), split when predicate fails.
@@ -230,11 +348,11 @@ namespace bliss
 //          std::cout << "RAW NEXT " << next << " len " << std::distance(next.seq_begin, next.seq_end) << std::endl;
 
           // find the beginning of valid.
-          seq.seq_begin = std::find_if(next.seq_begin, next.seq_end, pred);
+          seq.seq_begin = split_scanner<Predicate>::find_valid(next.seq_begin, next.seq_end, pred);
 //          std::cout << "first SEQ " << seq << " len " << std::distance(seq.seq_begin, seq.seq_end) << std::endl;
 
           // find the end of the valid range
-          seq.seq_end = std::find_if_not(seq.seq_begin, next.seq_end, pred);
+          seq.seq_end = split_scanner<Predicate>::find_invalid(seq.seq_begin, next.seq_end, pred);
 //          std::cout << "second SEQ " << seq << " len " << std::distance(seq.seq_begin, seq.seq_end) << std::endl;
 
           // now update the next seq object.
@@ -422,20 +540,6 @@ namespace bliss
 
     };
 
-    /**
-     * @class bliss::io::NCharFilter
-     * @brief   given a character, return true if it's NOT N.
-     */
-    struct NCharFilter {
-
-        template <typename T>
-        bool operator()(T const & x) {
-          // scan through x to look for NOT N
-          return (x != 'N') && (x != 'n');
-        }
-    };
-
-
     template <typename Iterator, template <typename> class SeqParser>
     using NSplitSequencesIterator = bliss::io::SplitSequencesIterator<Iterator, SeqParser, bliss::io::NCharFilter>;
 
@@ -0,0 +1,530 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    gzip_file.hpp
+ * @ingroup io
+ * @author  tpan
+ * @brief   reader for BGZF and gzip compressed files, presenting the uncompressed bytes.
+ * @details ranges passed to read_range and returned by size() are in UNCOMPRESSED bytes, so gzip_file can stand in for
+ *          mmap_file/posix_file as the FileReader of partitioned_file, and FASTQParser/FASTAParser see plain file_data.
+ *
+ *          random access uses a list of access points, i.e. positions where inflate can restart.
+ *          BGZF (bgzip, samtools): every block is a complete gzip member, so block starts are access points.
+ *            the index is built by walking the block headers, without inflating.
+ *          plain gzip: access points are deflate block boundaries, recorded with the preceding 32KB window as in zlib's zran.c.
+ *            building this requires inflating the whole file once, so build it once with write_index().  it is loaded
+ *            automatically from <file>.bidx when present and when it matches the compressed file size.
+ *
+ *          access points are kept about "span" uncompressed bytes apart.  segments between consecutive points are inflated
+ *          independently, by multiple OpenMP threads if set_threads() > 1.
+ *
+ *          needs zlib.  built only with USE_ZLIB.
+ */
+#ifndef SRC_IO_GZIP_FILE_HPP_
+#define SRC_IO_GZIP_FILE_HPP_
+
+#include <zlib.h>
+#include <unistd.h>     // pread64, readlink
+#include <climits>      // UINT_MAX
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "io/file.hpp"
+#include "io/io_exception.hpp"
+#include "utils/exception_handling.hpp"
+
+#if defined(USE_OPENMP)
+#include <omp.h>
+#endif
+
+namespace bliss {
+  namespace io {
+
+    /**
+     * @brief  read only file class for BGZF or gzip compressed files.  ranges are in uncompressed bytes.
+     * @note   file_range_bytes (and size()) is the uncompressed size.  the compressed size is compressed_size().
+     */
+    class gzip_file : public ::bliss::io::base_file {
+
+      protected:
+        /// BASE type
+        using BASE = ::bliss::io::base_file;
+
+      public:
+        /// a position where inflate can restart.
+        struct access_point {
+          /// compressed offset of the first full byte.
+          size_t in;
+          /// uncompressed offset
+          size_t out;
+          /// number of bits in byte (in - 1) that belong to this point.  0 to 7.
+          int bits;
+          /// true if a gzip member header starts at in.  window is not needed then.
+          bool member;
+          /// up to 32KB of uncompressed data preceding out.  empty for member points.
+          std::vector<unsigned char> window;
+
+          access_point() : in(0), out(0), bits(0), member(true) {}
+          access_point(size_t const & _in, size_t const & _out) : in(_in), out(_out), bits(0), member(true) {}
+        };
+
+        /// deflate window size
+        static constexpr size_t window_size = 32768;
+
+        /// default uncompressed distance between access points.  also the unit of parallel decompression.
+        static constexpr size_t default_span = 1UL << 20;
+
+        /// suffix of index file loaded during construction
+        static std::string index_suffix() { return ".bidx"; }
+
+      protected:
+        /// compressed size of the file
+        size_t compressed_bytes;
+
+        /// BGZF or plain gzip
+        bool bgzf;
+
+        /// access points, sorted by out.
+        std::vector<access_point> points;
+
+        /// number of threads for read_range
+        int nthreads;
+
+        /// compressed bytes read per pread
+        static constexpr size_t chunk_bytes = 1UL << 18;
+
+        void throw_error(std::string const & msg) const {
+          std::stringstream ss;
+          ss << "ERROR: gzip_file [" << this->filename << "] " << msg;
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+        }
+
+        /// pread until count bytes or end of file.  returns bytes read.
+        size_t pread_full(unsigned char * buf, size_t const & count, size_t const & offset) const {
+          size_t total = 0;
+          while (total < count) {
+            ssize_t n = pread64(this->fd, buf + total, count - total, offset + total);
+            if (n < 0) {
+              if (errno == EINTR) continue;
+              int myerr = errno;
+              std::stringstream ss;
+              ss << "pread error at " << (offset + total) << ": " << myerr << ": " << strerror(myerr);
+              throw_error(ss.str());
+            }
+            if (n == 0) break;
+            total += n;
+          }
+          return total;
+        }
+
+        /// check for the BGZF extra field, 'BC', in a gzip header.  return the total block size, or 0 if not BGZF.
+        static size_t bgzf_block_size(unsigned char const * hdr, size_t const & len) {
+          if (len < 18) return 0;
+          if ((hdr[0] != 0x1f) || (hdr[1] != 0x8b) || (hdr[2] != 8) || ((hdr[3] & 4) == 0)) return 0;
+          if ((hdr[10] | (hdr[11] << 8)) != 6) return 0;
+          if ((hdr[12] != 'B') || (hdr[13] != 'C') || ((hdr[14] | (hdr[15] << 8)) != 2)) return 0;
+          return (hdr[16] | (hdr[17] << 8)) + 1;
+        }
+
+        /// path of the open file.  via /proc/self/fd if constructed from an fd.
+        std::string get_path() const {
+          if (this->filename.length() > 0) return this->filename;
+          if (this->fd < 0) return std::string();
+
+          std::stringstream ss;
+          ss << "/proc/self/fd/" << this->fd;
+          char buf[4096];
+          ssize_t n = readlink(ss.str().c_str(), buf, sizeof(buf) - 1);
+          if (n <= 0) return std::string();
+          return std::string(buf, n);
+        }
+
+        /// walk BGZF block headers.  no inflating.
+        void build_bgzf_index(size_t const & span) {
+          points.clear();
+
+          unsigned char hdr[18];
+          unsigned char isize[4];
+          size_t pos = 0, out = 0;
+          while (pos < compressed_bytes) {
+            size_t bsize = bgzf_block_size(hdr, pread_full(hdr, 18, pos));
+            if ((bsize < 26) || (pos + bsize > compressed_bytes)) {
+              std::stringstream ss;
+              ss << "invalid BGZF block at " << pos;
+              throw_error(ss.str());
+            }
+            if (pread_full(isize, 4, pos + bsize - 4) < 4) throw_error("truncated BGZF block");
+
+            if (points.empty() || (out - points.back().out) >= span) points.emplace_back(pos, out);
+
+            out += static_cast<size_t>(isize[0]) | (static_cast<size_t>(isize[1]) << 8) |
+                (static_cast<size_t>(isize[2]) << 16) | (static_cast<size_t>(isize[3]) << 24);
+            pos += bsize;
+          }
+
+          this->file_range_bytes.end = out;
+        }
+
+        /// inflate the whole file, recording deflate block boundaries as access points (zlib zran.c).  handles multiple members.
+        void build_gzip_index(size_t const & span) {
+          points.clear();
+
+          z_stream strm;
+          memset(&strm, 0, sizeof(z_stream));
+          if (inflateInit2(&strm, 31) != Z_OK) throw_error("inflateInit2 failed");
+
+          std::vector<unsigned char> input(chunk_bytes);
+          std::vector<unsigned char> window(window_size);
+          bool wrapped = false;
+
+          size_t totin = 0, totout = 0, in_pos = 0;
+          points.emplace_back(0, 0);
+
+          int ret = Z_OK;
+          strm.avail_out = 0;
+          while (true) {
+            if (strm.avail_in == 0) {
+              size_t n = pread_full(input.data(), input.size(), in_pos);
+              if (n == 0) break;
+              in_pos += n;
+              strm.next_in = input.data();
+              strm.avail_in = n;
+            }
+            if (strm.avail_out == 0) {
+              if (strm.next_out != nullptr) wrapped = true;
+              strm.next_out = window.data();
+              strm.avail_out = window_size;
+            }
+
+            totin += strm.avail_in;
+            totout += strm.avail_out;
+            ret = inflate(&strm, Z_BLOCK);
+            totin -= strm.avail_in;
+            totout -= strm.avail_out;
+
+            if ((ret == Z_NEED_DICT) || (ret == Z_DATA_ERROR) || (ret == Z_MEM_ERROR)) {
+              inflateEnd(&strm);
+              throw_error(std::string("inflate error: ") + (strm.msg ? strm.msg : "data error"));
+            }
+
+            if (ret == Z_STREAM_END) {
+              // end of a member.  if more follows, it starts with a gzip header.
+              if ((strm.avail_in == 0) && (in_pos >= compressed_bytes)) break;
+              inflateReset(&strm);
+              if ((totout - points.back().out) >= span) points.emplace_back(totin, totout);
+              continue;
+            }
+
+            // at a deflate block boundary, not after the last block.
+            if (((strm.data_type & 128) != 0) && ((strm.data_type & 64) == 0) &&
+                (totout > 0) && ((totout - points.back().out) >= span)) {
+              access_point p(totin, totout);
+              p.bits = strm.data_type & 7;
+              p.member = false;
+
+              size_t pos = window_size - strm.avail_out;
+              if (wrapped) {
+                p.window.assign(window.begin() + pos, window.end());
+                p.window.insert(p.window.end(), window.begin(), window.begin() + pos);
+              } else {
+                p.window.assign(window.begin(), window.begin() + pos);
+              }
+              points.emplace_back(std::move(p));
+            }
+          }
+          inflateEnd(&strm);
+
+          if (ret != Z_STREAM_END) throw_error("truncated gzip file");
+
+          this->file_range_bytes.end = totout;
+        }
+
+        /// load index.  false if missing or not for this file.
+        bool load_index(std::string const & path) {
+          std::ifstream ifs(path, std::ios::in | std::ios::binary);
+          if (!ifs.good()) return false;
+
+          char magic[8];
+          uint64_t header[4];   // compressed size, uncompressed size, bgzf, count
+          ifs.read(magic, 8);
+          ifs.read(reinterpret_cast<char*>(header), sizeof(header));
+          if (!ifs.good() || (memcmp(magic, "BLGZIDX1", 8) != 0) || (header[0] != compressed_bytes)) return false;
+
+          std::vector<access_point> pts(header[3]);
+          for (size_t i = 0; i < pts.size(); ++i) {
+            uint64_t v[2];
+            uint32_t u[3];   // bits, member, window length
+            ifs.read(reinterpret_cast<char*>(v), sizeof(v));
+            ifs.read(reinterpret_cast<char*>(u), sizeof(u));
+            if (!ifs.good() || (u[2] > window_size)) return false;
+            pts[i].in = v[0];
+            pts[i].out = v[1];
+            pts[i].bits = u[0];
+            pts[i].member = (u[1] != 0);
+            pts[i].window.resize(u[2]);
+            ifs.read(reinterpret_cast<char*>(pts[i].window.data()), u[2]);
+          }
+          if (!ifs.good() || pts.empty()) return false;
+
+          points.swap(pts);
+          bgzf = (header[2] != 0);
+          this->file_range_bytes.end = header[1];
+          return true;
+        }
+
+        /// open the file's index, or build it.
+        void init_index() {
+          compressed_bytes = this->file_range_bytes.end;
+          this->file_range_bytes.end = 0;
+          if ((this->fd < 0) || (compressed_bytes == 0)) return;
+
+          std::string path = get_path();
+          if ((path.length() > 0) && load_index(path + index_suffix())) return;
+
+          build_index(static_cast<size_t>(default_span));
+        }
+
+        /**
+         * @brief  inflate from access point i, discard skip bytes, then write count bytes to dest.
+         * @note   thread safe: only uses pread on the shared fd.
+         */
+        void inflate_segment(size_t const & i, unsigned char * dest, size_t skip, size_t const & count) const {
+          access_point const & p = points[i];
+
+          z_stream strm;
+          memset(&strm, 0, sizeof(z_stream));
+          bool raw = !p.member;
+          if (inflateInit2(&strm, raw ? -15 : 31) != Z_OK) throw_error("inflateInit2 failed");
+
+          std::vector<unsigned char> input(chunk_bytes);
+          std::vector<unsigned char> scratch;
+          size_t in_pos = p.in;
+
+          int ret = Z_OK;
+          if (raw) {
+            if (p.bits > 0) {
+              unsigned char c;
+              if (pread_full(&c, 1, p.in - 1) < 1) ret = Z_DATA_ERROR;
+              else ret = inflatePrime(&strm, p.bits, c >> (8 - p.bits));
+            }
+            if (ret == Z_OK) ret = inflateSetDictionary(&strm, p.window.data(), p.window.size());
+          }
+
+          size_t done = 0;
+          while ((ret == Z_OK) && (done < count)) {
+            if (strm.avail_in == 0) {
+              size_t n = pread_full(input.data(), input.size(), in_pos);
+              if (n == 0) { ret = Z_BUF_ERROR; break; }
+              in_pos += n;
+              strm.next_in = input.data();
+              strm.avail_in = n;
+            }
+
+            if (skip > 0) {
+              scratch.resize(std::min(skip, static_cast<size_t>(chunk_bytes)));
+              strm.next_out = scratch.data();
+              strm.avail_out = scratch.size();
+            } else {
+              strm.next_out = dest + done;
+              strm.avail_out = std::min(count - done, static_cast<size_t>(UINT_MAX));
+            }
+
+            size_t avail = strm.avail_out;
+            ret = inflate(&strm, Z_NO_FLUSH);
+            size_t produced = avail - strm.avail_out;
+            if (skip > 0) skip -= produced;
+            else done += produced;
+
+            if (ret == Z_BUF_ERROR) ret = Z_OK;   // needs more input.
+            else if (ret == Z_STREAM_END) {
+              // member done.  gzip mode consumed the trailer.  raw mode still has the 8 byte crc and size.
+              if (raw) {
+                size_t trailer = 8;
+                while (trailer > 0) {
+                  if (strm.avail_in == 0) {
+                    size_t n = pread_full(input.data(), input.size(), in_pos);
+                    if (n == 0) break;
+                    in_pos += n;
+                    strm.next_in = input.data();
+                    strm.avail_in = n;
+                  }
+                  size_t t = std::min(trailer, static_cast<size_t>(strm.avail_in));
+                  strm.next_in += t;
+                  strm.avail_in -= t;
+                  trailer -= t;
+                }
+                raw = false;
+              }
+              ret = inflateReset2(&strm, 31);
+            }
+          }
+          inflateEnd(&strm);
+
+          if (done < count) {
+            std::stringstream ss;
+            ss << "inflate error at access point " << i << " (compressed offset " << p.in << "): " << ret;
+            throw_error(ss.str());
+          }
+        }
+
+      public:
+
+        // this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
+        using BASE::read_range;
+
+        /**
+         * @brief  inflate the uncompressed range_bytes into output.
+         * @param range_bytes   uncompressed range to read.
+         * @return              uncompressed range read.
+         */
+        virtual typename BASE::range_type read_range(typename ::bliss::io::file_data::container & output,
+                                                     typename BASE::range_type const & range_bytes) {
+          typename BASE::range_type target = BASE::range_type::intersect(range_bytes, this->file_range_bytes);
+
+          output.clear();
+          if (target.size() == 0) return target;
+
+          output.resize(target.size());
+
+          // segments [points[i].out, points[i+1].out) that intersect target.
+          auto by_out = [](size_t const & x, access_point const & p) { return x < p.out; };
+          size_t first = std::upper_bound(points.begin(), points.end(), target.start, by_out) - points.begin() - 1;
+          size_t last = std::upper_bound(points.begin(), points.end(), target.end - 1, by_out) - points.begin();
+
+          std::string error;
+          long nsegs = last - first;
+#if defined(USE_OPENMP)
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic)
+#endif
+          for (long j = 0; j < nsegs; ++j) {
+            size_t i = first + j;
+            size_t seg_start = points[i].out;
+            size_t seg_end = ((i + 1) < points.size()) ? points[i + 1].out : this->file_range_bytes.end;
+            size_t s = std::max(seg_start, target.start);
+            size_t e = std::min(seg_end, target.end);
+            if (s >= e) continue;
+
+            // no exceptions out of the parallel region.
+            try {
+              inflate_segment(i, output.data() + (s - target.start), s - seg_start, e - s);
+            } catch (std::exception const & ex) {
+#if defined(USE_OPENMP)
+#pragma omp critical
+#endif
+              error = ex.what();
+            }
+          }
+          if (error.length() > 0) throw ::bliss::utils::make_exception<::bliss::io::IOException>(error);
+
+          return target;
+        }
+
+        /**
+         * @brief  rebuild the access points, spaced about span uncompressed bytes apart.
+         * @note   for plain gzip this inflates the whole file.
+         */
+        void build_index(size_t const & span) {
+          unsigned char hdr[18];
+          size_t n = pread_full(hdr, 18, 0);
+          if ((n < 2) || (hdr[0] != 0x1f) || (hdr[1] != 0x8b)) throw_error("not a gzip file");
+
+          bgzf = (bgzf_block_size(hdr, n) > 0);
+          if (bgzf) build_bgzf_index(std::max(span, 1UL));
+          else build_gzip_index(std::max(span, static_cast<size_t>(window_size)));
+        }
+
+        /// write the access points to a file, e.g. get_filename() + index_suffix().
+        void write_index(std::string const & path) const {
+          std::ofstream ofs(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+          uint64_t header[4] = { compressed_bytes, this->file_range_bytes.end, bgzf ? 1UL : 0UL, points.size() };
+          ofs.write("BLGZIDX1", 8);
+          ofs.write(reinterpret_cast<char const *>(header), sizeof(header));
+          for (auto const & p : points) {
+            uint64_t v[2] = { p.in, p.out };
+            uint32_t u[3] = { static_cast<uint32_t>(p.bits), p.member ? 1U : 0U, static_cast<uint32_t>(p.window.size()) };
+            ofs.write(reinterpret_cast<char const *>(v), sizeof(v));
+            ofs.write(reinterpret_cast<char const *>(u), sizeof(u));
+            ofs.write(reinterpret_cast<char const *>(p.window.data()), p.window.size());
+          }
+          if (!ofs.good()) throw_error(std::string("cannot write index ") + path);
+        }
+
+        /// set the number of threads used by read_range.  no effect without USE_OPENMP
+        void set_threads(int const & _nthreads) {
+          nthreads = std::max(1, _nthreads);
+        }
+
+        /// compressed size of file in bytes
+        size_t compressed_size() const {
+          return compressed_bytes;
+        }
+
+        /// true if the file is BGZF
+        bool is_bgzf() const {
+          return bgzf;
+        }
+
+        /// access points
+        std::vector<access_point> const & get_access_points() const {
+          return points;
+        }
+
+        /**
+         * initializes a gzip file for reading.  loads or builds the index.
+         * @param _filename   name of file to open
+         */
+        gzip_file(std::string const & _filename) :
+          ::bliss::io::base_file(_filename), compressed_bytes(0), bgzf(false), nthreads(1) {
+          init_index();
+        }
+
+        /**
+         * initializes a gzip file for reading.  for use by a parallel file (composition pattern)
+         * @param _filename   name of file to open
+         * @param _file_size  previously computed COMPRESSED file size.
+         */
+        gzip_file(std::string const & _filename, size_t const & _file_size, size_t const & delay_ms = 0) :
+          ::bliss::io::base_file(_filename, _file_size, delay_ms), compressed_bytes(0), bgzf(false), nthreads(1) {
+          init_index();
+        }
+
+        /**
+         * initializes a gzip file for reading.  for use by a parallel file (composition pattern)
+         * @param _fd         open file descriptor
+         * @param _file_size  previously computed COMPRESSED file size.
+         */
+        gzip_file(int const & _fd, size_t const & _file_size) :
+          ::bliss::io::base_file(_fd, _file_size), compressed_bytes(0), bgzf(false), nthreads(1) {
+          init_index();
+        }
+
+        /// default destructor
+        virtual ~gzip_file() {};
+
+        // this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
+        using BASE::read_file;
+    };
+
+  } // namespace io
+} // namespace bliss
+
+#endif /* SRC_IO_GZIP_FILE_HPP_ */
@@ -28,15 +28,31 @@
 
 
 #include <algorithm>
+#include <chrono>
+#include <limits>
+#include <ostream>
 #include <mxx/datatypes.hpp>
 #include <mxx/comm.hpp>
 #include <mxx/collective.hpp>
 #include <mxx/samplesort.hpp>
 
 #include "utils/benchmark_utils.hpp"
+#include "utils/comm_stats.hpp"
+#include "utils/event_trace.hpp"
 #include "utils/function_traits.hpp"
+#include "utils/sketch_utils.hpp"
 
+#include "common/packed_pair.hpp"
 #include "containers/fsc_container_utils.hpp"
+#include "containers/fsc_radix_sort.hpp"
+#include "io/packed_wire.hpp"
+#include "io/byte_wire.hpp"
+#include "io/compressed_wire.hpp"
+#include "io/scratch_pool.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace imxx
 {
@@ -44,6 +60,52 @@ namespace imxx
   // local version of MPI
   namespace local {
 
+    /// threads for the bucketing and permute loops below.  same cutoff as the local sorts:  small ranges stay sequential.
+    inline int bucketing_threads(size_t n) {
+      return ::fsc::detail::sort_threads(n);
+    }
+
+    /**
+     * @brief  per-thread bucket counts of bucket ids in [first, last), turned into per-thread scatter positions.
+     * @details  thread t handles the t-th equal share of the range.  positions are the exclusive prefix sum in
+     *           (bucket, thread) order starting at offset, so a scatter by thread share is stable.
+     * @param ids   bucket id for each position, indexed from first.
+     * @param hist[out]  hist[t * num_buckets + b] is where thread t writes its next element of bucket b.
+     * @param bucket_sizes[out]  total count per bucket.
+     */
+    template <typename IDS, typename SIZE>
+    void bucket_offsets(IDS const & ids, size_t const first, size_t const last, size_t const num_buckets,
+                        size_t const offset, int const nthreads,
+                        std::vector<size_t> & hist, std::vector<SIZE> & bucket_sizes) {
+      size_t const len = last - first;
+      hist.assign(nthreads * num_buckets, 0);
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+      {
+#ifdef _OPENMP
+        int tid = omp_get_thread_num();
+#else
+        int tid = 0;
+#endif
+        size_t * h = hist.data() + tid * num_buckets;
+        size_t e = first + len * (tid + 1) / nthreads;
+        for (size_t i = first + len * tid / nthreads; i < e; ++i) ++h[ids[i - first]];
+      }
+
+      bucket_sizes.assign(num_buckets, 0);
+      size_t pos = offset;
+      for (size_t b = 0; b < num_buckets; ++b) {
+        for (int t = 0; t < nthreads; ++t) {
+          size_t c = hist[t * num_buckets + b];
+          hist[t * num_buckets + b] = pos;
+          pos += c;
+          bucket_sizes[b] += c;
+        }
+      }
+    }
+
 
 
     /* ====
@@ -114,45 +176,45 @@ namespace imxx
       }
 
       // output to input mapping
-      std::vector<ASSIGN_TYPE> i2o;
-      i2o.reserve(len);
+      std::vector<ASSIGN_TYPE> i2o(len);
+      int nthreads = bucketing_threads(len);
 
-      // [1st pass]: compute bucket counts and input to bucket assignment.
-      ASSIGN_TYPE p;
+      // [1st pass]: compute input to bucket assignment.
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+#endif
       for (size_t i = f; i < l; ++i) {
-          p = key_func(input[i]);
+          ASSIGN_TYPE p = key_func(input[i]);
 
           assert(((0 <= p) && ((size_t)p < num_buckets)) && "assigned bucket id is not valid");
 
-          i2o.emplace_back(p);
-          ++bucket_sizes[p];
+          i2o[i - f] = p;
       }
 
-      // get offsets of where buckets start (= exclusive prefix sum)
-      // use bucket_sizes temporarily.
-      bucket_sizes.back() = len - bucket_sizes.back();
-      // checking for >= 0 with unsigned and decrement is a bad idea.  need to check for > 0
-      for (size_t i = num_buckets - 1; i > 0; --i) {
-        bucket_sizes[i-1] = bucket_sizes[i] - bucket_sizes[i-1];
-      }
-      assert(bucket_sizes.front() == 0);  // first one should be 0 at this point.
+      // per-thread bucket counts, then offsets of where buckets start (exclusive prefix sum).
+      std::vector<size_t> offsets;
+      bucket_offsets(i2o, f, l, num_buckets, 0, nthreads, offsets, bucket_sizes);
 
-      // [2nd pass]: saving elements into correct position, and save the final position.
+      // [2nd pass]: saving elements into correct position.  each thread scatters its share of the range.
       std::vector<T> tmp_result(len);
-      for (size_t i = f; i < l; ++i) {
-          tmp_result[bucket_sizes[i2o[i-f]]++] = input[i];
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+      {
+#ifdef _OPENMP
+        int tid = omp_get_thread_num();
+#else
+        int tid = 0;
+#endif
+        size_t * o = offsets.data() + tid * num_buckets;
+        size_t e = f + len * (tid + 1) / nthreads;
+        for (size_t i = f + len * tid / nthreads; i < e; ++i) {
+            tmp_result[o[i2o[i-f]]++] = input[i];
+        }
       }
       //std::cout << "bucket64 SIZES i2o " << sizeof(i2o) << " tmp results " << sizeof(tmp_result) << std::endl;
       if (len == input.size()) input.swap(tmp_result);   // if can swap, swap
       else memcpy(input.data() + f, tmp_result.data(), len * sizeof(T));   // else memcpy.
-
-      // this process should have turned bucket_sizes to an inclusive prefix sum
-      assert(bucket_sizes.back() == len);
-      // convert inclusive prefix sum back to counts.
-      // hopefully this is a fast process when compared to allocating memory.
-      for (size_t i = num_buckets - 1; i > 0; --i) {
-        bucket_sizes[i] -= bucket_sizes[i-1];
-      }
     }
 
     template <typename T, typename Func, typename ASSIGN_TYPE, typename SIZE>
@@ -192,53 +254,313 @@ namespace imxx
         bucket_sizes[0] = len;
 
         // set output values
+        results.resize(input.size());
         memcpy(results.data() + f, input.data() + f, len * sizeof(T));
 
         return;
       }
 
       // output to input mapping
-      std::vector<ASSIGN_TYPE> i2o;
-      i2o.reserve(len);
+      std::vector<ASSIGN_TYPE> i2o(len);
+      int nthreads = bucketing_threads(len);
 
-      // [1st pass]: compute bucket counts and input to bucket assignment.
-      ASSIGN_TYPE p;
+      // [1st pass]: compute input to bucket assignment.
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+#endif
       for (size_t i = f; i < l; ++i) {
-          p = key_func(input[i]);
+          ASSIGN_TYPE p = key_func(input[i]);
 
           assert(((0 <= p) && ((size_t)p < num_buckets)) && "assigned bucket id is not valid");
 
-          i2o.emplace_back(p);
-          ++bucket_sizes[p];
+          i2o[i - f] = p;
       }
 
-      // get offsets of where buckets start (= exclusive prefix sum)
-      // use bucket_sizes temporarily.
-      bucket_sizes.back() = l - bucket_sizes.back();
-      // checking for >= 0 with unsigned and decrement is a bad idea.  need to check for > 0
-      for (size_t i = num_buckets - 1; i > 0; --i) {
-        bucket_sizes[i-1] = bucket_sizes[i] - bucket_sizes[i-1];
-      }
-      assert(bucket_sizes.front() == f);  // first one should be 0 at this point.
+      // per-thread bucket counts, then offsets of where buckets start (exclusive prefix sum), offset by the range.
+      std::vector<size_t> offsets;
+      bucket_offsets(i2o, f, l, num_buckets, f, nthreads, offsets, bucket_sizes);
 
-      // [2nd pass]: saving elements into correct position, and save the final position.
+      // [2nd pass]: saving elements into correct position.  each thread scatters its share of the range.
       results.resize(input.size());
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+      {
+#ifdef _OPENMP
+        int tid = omp_get_thread_num();
+#else
+        int tid = 0;
+#endif
+        size_t * o = offsets.data() + tid * num_buckets;
+        size_t e = f + len * (tid + 1) / nthreads;
+        for (size_t i = f + len * tid / nthreads; i < e; ++i) {
+            results[o[i2o[i-f]]++] = input[i];
+        }
+      }
+
+    }
+
+
+
+    /**
+     * @brief  count the elements of each bucket in [first, last).  first pass of partition_inplace.
+     */
+    template <typename T, typename Func, typename SIZE>
+    void
+    count_buckets(std::vector<T> const & input,
+                  Func const & key_func,
+                  size_t const & num_buckets,
+                  std::vector<SIZE> & bucket_sizes,
+                  size_t first = 0,
+                  size_t last = std::numeric_limits<size_t>::max()) {
+      if (num_buckets == 0) throw std::invalid_argument("ERROR: number of buckets is 0");
+      bucket_sizes.assign(num_buckets, 0);
+
+      size_t f = std::min(first, input.size());
+      size_t l = std::min(last, input.size());
+      assert((f <= l) && "first should not exceed last" );
+
+      if (num_buckets == 1) {
+        bucket_sizes[0] = l - f;
+        return;
+      }
       for (size_t i = f; i < l; ++i) {
-          results[bucket_sizes[i2o[i-f]]++] = input[i];
+        size_t p = key_func(input[i]);
+        assert((p < num_buckets) && "assigned bucket id is not valid");
+        ++bucket_sizes[p];
       }
+    }
 
-      // this process should have turned bucket_sizes to an inclusive prefix sum
-      assert(bucket_sizes.back() == l);
-      // convert inclusive prefix sum back to counts.
-      // hopefully this is a fast process when compared to allocating memory.
-      for (size_t i = num_buckets - 1; i > 0; --i) {
-        bucket_sizes[i] -= bucket_sizes[i-1];
+    /**
+     * @brief  in-place, unstable partition of [first, last) by bucket, American flag style.
+     * @details  every bucket gets a head and an end position.  visiting the positions in order, an element that is not
+     *           in its bucket is swapped to the head of its bucket, and the displaced element is placed the same way,
+     *           until one belonging at the current position comes back.  each element is moved once, and extra memory
+     *           is O(num_buckets), instead of the 8 bytes per element of the i2o mapping in assign_to_buckets/permute.
+     *           key_func is called about twice per element, so it should be cheap, e.g. a hash to rank.
+     *
+     *           with block > 0, the range is instead laid out for block_all2all plus all2allv, as in
+     *           bucket_to_block_permutation:  first block elements of each bucket in bucket order, then the remaining
+     *           elements grouped by bucket.  block should not exceed the smallest bucket.
+     *
+     * @param bucket_sizes[in/out]  bucket sizes from count_buckets.  with block > 0, reduced by block on return.
+     */
+    template <typename T, typename Func, typename SIZE>
+    void
+    partition_inplace(std::vector<T> & input,
+                      Func const & key_func,
+                      std::vector<SIZE> & bucket_sizes,
+                      SIZE const block = 0,
+                      size_t first = 0,
+                      size_t last = std::numeric_limits<size_t>::max()) {
+      size_t nb = bucket_sizes.size();
+      size_t f = std::min(first, input.size());
+      size_t l = std::min(last, input.size());
+      assert((f <= l) && "first should not exceed last" );
+      assert((std::accumulate(bucket_sizes.begin(), bucket_sizes.end(), static_cast<size_t>(0)) == (l - f)) &&
+             "bucket sizes do not match the range");
+      if ((nb < 2) && (block == 0)) return;
+
+      // regions in position order.  without block: one per bucket.  with block: nb block regions, then nb remainders.
+      size_t nr = (block > 0) ? 2 * nb : nb;
+      std::vector<size_t> head(nr), end(nr);
+      size_t pos = f;
+      if (block > 0) {
+        for (size_t b = 0; b < nb; ++b, pos += block) {
+          assert((bucket_sizes[b] >= block) && "block is larger than a bucket");
+          head[b] = pos;
+          end[b] = pos + block;
+        }
+      }
+      for (size_t b = 0; b < nb; ++b) {
+        size_t r = nr - nb + b;
+        head[r] = pos;
+        pos += bucket_sizes[b] - block;
+        end[r] = pos;
+      }
+
+      // region that the next element of bucket b goes to.
+      auto target = [&head, &end, nb, block](size_t b) {
+        return ((block > 0) && (head[b] < end[b])) ? b : (b + ((block > 0) ? nb : 0));
+      };
+
+      for (size_t r = 0; r < nr; ++r) {
+        size_t owner = (r < nb) ? r : (r - nb);
+        while (head[r] < end[r]) {
+          T x = std::move(input[head[r]]);
+          size_t d = key_func(x);
+          while (d != owner) {
+            std::swap(x, input[head[target(d)]++]);
+            d = key_func(x);
+          }
+          input[head[r]++] = std::move(x);
+        }
+      }
+
+      if (block > 0) {
+        for (size_t b = 0; b < nb; ++b) bucket_sizes[b] -= block;
+      }
+    }
+
+
+    /// true if key_func has a batch ranks(T const *, size_t, ID *) member, e.g. the KeyToRank of the hash maps.
+    template <typename Func, typename T, typename ID>
+    struct has_batch_ranks {
+        template <typename U>
+        static auto test(int) -> decltype(::std::declval<U const &>().ranks(::std::declval<T const *>(), size_t(0), ::std::declval<ID *>()), ::std::true_type());
+        template <typename U>
+        static ::std::false_type test(...);
+
+        static constexpr bool value = decltype(test<Func>(0))::value;
+    };
+
+    template <typename T, typename Func, typename ID>
+    inline void assign_ids_impl(T const * input, Func const & key_func, ID * ids, size_t f, size_t l, int nthreads, ::std::false_type) {
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+#endif
+      for (size_t i = f; i < l; ++i) {
+        ids[i - f] = key_func(input[i]);
+      }
+    }
+    /// batch version, so the hash can process several keys per call (SIMD).  blocks are split among threads.
+    template <typename T, typename Func, typename ID>
+    inline void assign_ids_impl(T const * input, Func const & key_func, ID * ids, size_t f, size_t l, int nthreads, ::std::true_type) {
+      constexpr size_t block = 1024;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+#endif
+      for (size_t i = f; i < l; i += block) {
+        key_func.ranks(input + i, ::std::min(block, l - i), ids + (i - f));
+      }
+    }
+
+    /**
+     * @brief  compute the bucket id of each element of [first, last) once, and count the buckets.
+     * @param ids[out]  ids[i - first] is the bucket of input[i].  ID should be the smallest type that holds num_buckets - 1.
+     */
+    template <typename T, typename Func, typename ID, typename SIZE>
+    void
+    assign_bucket_ids(std::vector<T> const & input,
+                      Func const & key_func,
+                      size_t const & num_buckets,
+                      std::vector<ID> & ids,
+                      std::vector<SIZE> & bucket_sizes,
+                      size_t first = 0,
+                      size_t last = std::numeric_limits<size_t>::max()) {
+      static_assert(::std::is_integral<ID>::value, "ID should be integral, preferably unsigned");
+      if (num_buckets == 0) throw std::invalid_argument("ERROR: number of buckets is 0");
+      assert(((num_buckets - 1) <= static_cast<size_t>(::std::numeric_limits<ID>::max())) && "ID type too small");
+
+      size_t f = std::min(first, input.size());
+      size_t l = std::min(last, input.size());
+      assert((f <= l) && "first should not exceed last" );
+
+      ids.resize(l - f);
+      int nthreads = bucketing_threads(l - f);
+      assign_ids_impl(input.data(), key_func, ids.data(), f, l, nthreads,
+                      ::std::integral_constant<bool, has_batch_ranks<Func, T, ID>::value>());
+#ifndef NDEBUG
+      for (size_t i = 0; i < ids.size(); ++i) {
+        assert((static_cast<size_t>(ids[i]) < num_buckets) && "assigned bucket id is not valid");
       }
-      bucket_sizes[0] -= f;
+#endif
 
+      std::vector<size_t> offsets;
+      bucket_offsets(ids, f, l, num_buckets, 0, nthreads, offsets, bucket_sizes);
     }
 
+    /**
+     * @brief  partition_inplace with bucket ids from assign_bucket_ids instead of a key function.
+     * @details  same layout as partition_inplace.  ids are moved along with the elements, so no element is hashed twice.
+     */
+    template <typename T, typename ID, typename SIZE>
+    void
+    partition_inplace_by_id(std::vector<T> & input,
+                            std::vector<ID> & ids,
+                            std::vector<SIZE> & bucket_sizes,
+                            SIZE const block = 0,
+                            size_t first = 0,
+                            size_t last = std::numeric_limits<size_t>::max()) {
+      size_t nb = bucket_sizes.size();
+      size_t f = std::min(first, input.size());
+      size_t l = std::min(last, input.size());
+      assert((f <= l) && "first should not exceed last" );
+      assert((ids.size() == (l - f)) && "ids do not match the range");
+      assert((std::accumulate(bucket_sizes.begin(), bucket_sizes.end(), static_cast<size_t>(0)) == (l - f)) &&
+             "bucket sizes do not match the range");
+      if ((nb < 2) && (block == 0)) return;
+
+      // regions in position order, relative to f.  see partition_inplace.
+      size_t nr = (block > 0) ? 2 * nb : nb;
+      std::vector<size_t> head(nr), end(nr);
+      size_t pos = 0;
+      if (block > 0) {
+        for (size_t b = 0; b < nb; ++b, pos += block) {
+          assert((bucket_sizes[b] >= block) && "block is larger than a bucket");
+          head[b] = pos;
+          end[b] = pos + block;
+        }
+      }
+      for (size_t b = 0; b < nb; ++b) {
+        size_t r = nr - nb + b;
+        head[r] = pos;
+        pos += bucket_sizes[b] - block;
+        end[r] = pos;
+      }
+
+      auto target = [&head, &end, nb, block](size_t b) {
+        return ((block > 0) && (head[b] < end[b])) ? b : (b + ((block > 0) ? nb : 0));
+      };
+
+      T * data = input.data() + f;
+      for (size_t r = 0; r < nr; ++r) {
+        size_t owner = (r < nb) ? r : (r - nb);
+        while (head[r] < end[r]) {
+          T x = std::move(data[head[r]]);
+          ID d = ids[head[r]];
+          while (static_cast<size_t>(d) != owner) {
+            size_t t = head[target(d)]++;
+            std::swap(x, data[t]);
+            std::swap(d, ids[t]);
+          }
+          data[head[r]] = std::move(x);
+          ids[head[r]++] = d;
+        }
+      }
 
+      if (block > 0) {
+        for (size_t b = 0; b < nb; ++b) bucket_sizes[b] -= block;
+      }
+    }
+
+    /**
+     * @brief  bucket [first, last) in place, calling key_func once per element.
+     * @details  uses 1, 2, or 4 bytes per element for the bucket ids, depending on num_buckets.
+     */
+    template <typename T, typename Func, typename SIZE>
+    void
+    bucket_inplace(std::vector<T> & input,
+                   Func const & key_func,
+                   size_t const & num_buckets,
+                   std::vector<SIZE> & bucket_sizes,
+                   SIZE const block = 0,
+                   size_t first = 0,
+                   size_t last = std::numeric_limits<size_t>::max()) {
+      if (num_buckets <= (1UL << 8)) {
+        std::vector<uint8_t> ids;
+        assign_bucket_ids(input, key_func, num_buckets, ids, bucket_sizes, first, last);
+        partition_inplace_by_id(input, ids, bucket_sizes, block, first, last);
+      } else if (num_buckets <= (1UL << 16)) {
+        std::vector<uint16_t> ids;
+        assign_bucket_ids(input, key_func, num_buckets, ids, bucket_sizes, first, last);
+        partition_inplace_by_id(input, ids, bucket_sizes, block, first, last);
+      } else {
+        std::vector<uint32_t> ids;
+        assign_bucket_ids(input, key_func, num_buckets, ids, bucket_sizes, first, last);
+        partition_inplace_by_id(input, ids, bucket_sizes, block, first, last);
+      }
+    }
 
     /**
      * @brief   compute the element index mapping between input and bucketed output.
@@ -307,15 +629,31 @@ namespace imxx
 
 
         // [1st pass]: compute bucket counts and input2bucket assignment.
-        // store input2bucket assignment in i2o temporarily.
-        size_t p;
-        for (size_t i = f; i < l; ++i) {
-            p = key_func(input[i]);
+        // store input2bucket assignment in i2o temporarily.  per-thread counts are summed at the end.
+        int nthreads = bucketing_threads(l - f);
+        std::vector<size_t> hist(nthreads * num_buckets, 0);
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+        {
+#ifdef _OPENMP
+          int tid = omp_get_thread_num();
+#else
+          int tid = 0;
+#endif
+          size_t * h = hist.data() + tid * num_buckets;
+          size_t e = f + (l - f) * (tid + 1) / nthreads;
+          for (size_t i = f + (l - f) * tid / nthreads; i < e; ++i) {
+            size_t p = key_func(input[i]);
 
             assert(((0 <= p) && ((size_t)p < num_buckets)) && "assigned bucket id is not valid");
 
             i2o[i] = p;
-            ++bucket_sizes[p];
+            ++h[p];
+          }
+        }
+        for (int t = 0; t < nthreads; ++t) {
+          for (size_t b = 0; b < num_buckets; ++b) bucket_sizes[b] += hist[t * num_buckets + b];
         }
 
     }
@@ -339,28 +677,31 @@ namespace imxx
       if (f == l) return;  // no data in question.
 
 
-      // get offsets of where buckets start (= exclusive prefix sum), offset by the range.
-      // use bucket_sizes temporarily.
-      bucket_sizes.back() = l - bucket_sizes.back();  // offset from f, or alternatively, l.
-      // checking for >= 0 with unsigned and decrement is a bad idea.  need to check for > 0
-      for (size_t i = bucket_sizes.size() - 1; i > 0; --i) {
-        bucket_sizes[i-1] = bucket_sizes[i] - bucket_sizes[i-1];
-      }
-      assert((bucket_sizes.front() == f) && "prefix sum resulted in incorrect starting position");  // first one should be 0 at this point.
+      // get per-thread offsets of where buckets start (= exclusive prefix sum), offset by the range.
+      // recounted from the bucket ids, so each thread can scatter its share of the range.
+      size_t nb = bucket_sizes.size();
+      int nthreads = bucketing_threads(l - f);
+      std::vector<size_t> offsets;
+      std::vector<SIZE> counts;
+      bucket_offsets(i2o.data() + f, f, l, nb, f, nthreads, offsets, counts);
+      assert(std::equal(counts.begin(), counts.end(), bucket_sizes.begin()) && "bucket sizes do not match the assignment");
 
       // [2nd pass]: saving elements into correct position, and save the final position.
-      for (size_t i = f; i < l; ++i) {
-        i2o[i] = bucket_sizes[i2o[i]]++;  // output position from bucket id (i2o[i]).  post increment.  already offset by f.
-      }
-
-      // this process should have turned bucket_sizes to an inclusive prefix sum
-      assert((bucket_sizes.back() == l) && "mapping assignment resulted in incorrect ending position");
-      // convert inclusive prefix sum back to counts.
-      // hopefully this is a fast process when compared to allocating memory.
-      for (size_t i = bucket_sizes.size() - 1; i > 0; --i) {
-        bucket_sizes[i] -= bucket_sizes[i-1];
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+      {
+#ifdef _OPENMP
+        int tid = omp_get_thread_num();
+#else
+        int tid = 0;
+#endif
+        size_t * o = offsets.data() + tid * nb;
+        size_t e = f + (l - f) * (tid + 1) / nthreads;
+        for (size_t i = f + (l - f) * tid / nthreads; i < e; ++i) {
+          i2o[i] = o[i2o[i]]++;  // output position from bucket id (i2o[i]).  post increment.  already offset by f.
+        }
       }
-      bucket_sizes[0] -= f;
     }
 
 //    template <typename SIZE = size_t>
@@ -525,9 +866,13 @@ namespace imxx
         		(*(std::max_element(i2o, i2o + in_len)) <= (bucketed_pos_offset + out_len - 1)) &&
 				"ERROR, i2o [0, len) does not map to itself");
 
-        // saving elements into correct position
-        for (; unbucketed != unbucketed_end; ++i2o, ++unbucketed) {
-            *(bucketed + (*i2o - bucketed_pos_offset)) = *unbucketed;
+        // saving elements into correct position.  i2o is one-to-one, so threads write disjoint positions.
+        int nthreads = bucketing_threads(in_len);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+#endif
+        for (size_t i = 0; i < in_len; ++i) {
+            *(bucketed + (*(i2o + i) - bucketed_pos_offset)) = *(unbucketed + i);
         }
     }
 
@@ -611,9 +956,13 @@ namespace imxx
         		(*(std::max_element(i2o, i2o + len)) == ( bucketed_pos_offset + len - 1)) &&
 				"ERROR, i2o [first, last) does not map to itself");
 
-        // saving elements into correct position
-        for (; unbucketed != unbucketed_end; ++unbucketed, ++i2o) {
-            *(bucketed + (*i2o - bucketed_pos_offset)) = *unbucketed;
+        // saving elements into correct position.  i2o is one-to-one, so threads write disjoint positions.
+        int nthreads = bucketing_threads(len);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+#endif
+        for (size_t i = 0; i < len; ++i) {
+            *(bucketed + (*(i2o + i) - bucketed_pos_offset)) = *(unbucketed + i);
         }
 
     }
@@ -780,8 +1129,12 @@ namespace imxx
 				"ERROR, i2o [0, len) does not map to itself");
 
         // saving elements into correct position
-        for (; unbucketed < unbucketed_end; ++i2o, ++unbucketed) {
-            *unbucketed = *(bucketed + (*i2o - bucketed_pos_offset));
+        int nthreads = bucketing_threads(out_len);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+#endif
+        for (size_t i = 0; i < out_len; ++i) {
+            *(unbucketed + i) = *(bucketed + (*(i2o + i) - bucketed_pos_offset));
         }
     }
 
@@ -812,9 +1165,12 @@ namespace imxx
 				"ERROR, i2o [first, last) does not map to itself");
 
         // saving elements into correct position
-        OT unbucketed_end = unbucketed + len;
-        for (; unbucketed != unbucketed_end; ++unbucketed, ++i2o) {
-            *unbucketed = *(bucketed + (*i2o - bucketed_pos_offset));
+        int nthreads = bucketing_threads(len);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+#endif
+        for (size_t i = 0; i < len; ++i) {
+            *(unbucketed + i) = *(bucketed + (*(i2o + i) - bucketed_pos_offset));
         }
     }
 
@@ -986,6 +1342,12 @@ namespace imxx
     assert((input.size() >= (send_offset + send_count * comm.size())) && "input for block_all2all not big enough");
     assert((output.size() >= (recv_offset + send_count * comm.size())) && "output for block_all2all not big enough");
 
+    if (::bliss::io::compress::active()) {
+      ::std::vector<size_t> counts(comm.size(), send_count);
+      compressed_all2allv(&(input[send_offset]), counts, &(output[recv_offset]), counts, comm);
+      return;
+    }
+
     // send via mxx all2all - leverage any large message support from mxx.  (which uses datatype.contiguous() to increase element size and reduce element count to 1)
     ::mxx::all2all(&(input[send_offset]), send_count, &(output[recv_offset]), comm);
   }
@@ -1032,16 +1394,770 @@ namespace imxx
 
 
   /**
-   * @brief distribute function.  input is transformed, but remains the original input with original order.  buffer is used for output.
-   * @details
-   * @tparam SIZE     type for the i2o mapping and recv counts.  should be large enough to represent max of input.size() and output.size()
+   * @brief all2allv using the compact wire format in io/packed_wire.hpp.
+   * @details  each bucket of input is bit-packed/varint encoded into a byte buffer, the byte counts are exchanged,
+   *           the bytes are sent with all2allv, and each received bucket is decoded into output.
+   *           send_counts and recv_counts are ELEMENT counts, as for mxx::all2allv.  output must have room for all received elements.
+   *
+   * @param input   bucketed input, send_counts[i] elements for rank i, in rank order.
+   * @param output  received elements, recv_counts[i] elements from rank i, in rank order.
    */
-  template <typename V, typename ToRank, typename SIZE>
+  template <typename V, typename SIZE>
+  void packed_all2allv(V const * input, ::std::vector<SIZE> const & send_counts,
+                       V * output, ::std::vector<SIZE> const & recv_counts,
+                       ::mxx::comm const & comm) {
+    size_t p = comm.size();
+
+    // encode.  each bucket is rounded up to a byte, hence the extra p bytes.
+    size_t total = ::std::accumulate(send_counts.begin(), send_counts.end(), static_cast<size_t>(0));
+    // wire buffers are reused across calls on this communicator.
+    ::imxx::scratch::buffer<uint8_t> send_buf(comm);
+    send_buf.reserve(::bliss::io::wire::max_bytes<V>(total) + p);
+    send_buf->resize(::bliss::io::wire::max_bytes<V>(total) + p);
+    ::std::vector<size_t> send_bytes(p, 0);
+
+    V const * it = input;
+    uint8_t * out = send_buf->data();
+    for (size_t i = 0; i < p; ++i) {
+      send_bytes[i] = ::bliss::io::wire::encode(it, it + send_counts[i], out);
+      it += send_counts[i];
+      out += send_bytes[i];
+    }
+
+    // exchange byte counts, then the bytes.
+    ::std::vector<size_t> recv_bytes(p, 0);
+    ::mxx::all2all(send_bytes.data(), 1, recv_bytes.data(), comm);
+    size_t recv_total = ::std::accumulate(recv_bytes.begin(), recv_bytes.end(), static_cast<size_t>(0));
+
+    ::imxx::scratch::buffer<uint8_t> recv_buf(comm);
+    recv_buf.reserve(recv_total);
+    recv_buf->resize(recv_total);
+    ::mxx::all2allv(send_buf->data(), send_bytes, recv_buf->data(), recv_bytes, comm);
+    BL_COMM_RECORD("packed_wire", 1, send_bytes, recv_bytes);
+
+    // decode
+    uint8_t const * in = recv_buf->data();
+    V * oit = output;
+    for (size_t i = 0; i < p; ++i) {
+      ::bliss::io::wire::decode(in, in + recv_bytes[i], recv_counts[i], oit);
+      in += recv_bytes[i];
+      oit += recv_counts[i];
+    }
+  }
+
+  /**
+   * @brief all2allv with each bucket deflate compressed, see io/compressed_wire.hpp.
+   * @details  buckets are compressed in parallel into fixed size slots, packed, and their byte counts exchanged; the
+   *           bytes are sent with all2allv, and each received bucket is decompressed into output, also in parallel.
+   *           send_counts and recv_counts are ELEMENT counts, as for mxx::all2allv.  V is sent as its bytes,
+   *           so it must be plain data (k-mers, integers, and pairs of these), as for the mxx datatypes.
+   *
+   * @param input   bucketed input, send_counts[i] elements for rank i, in rank order.
+   * @param output  received elements, recv_counts[i] elements from rank i, in rank order.
+   */
+  template <typename V, typename SIZE>
+  void compressed_all2allv(V const * input, ::std::vector<SIZE> const & send_counts,
+                           V * output, ::std::vector<SIZE> const & recv_counts,
+                           ::mxx::comm const & comm) {
+    size_t p = comm.size();
+    ::bliss::io::compress::options const & opts = ::bliss::io::compress::settings();
+
+    // slot per destination, large enough for its worst case.
+    ::std::vector<size_t> send_offsets(p + 1, 0), slots(p + 1, 0);
+    for (size_t i = 0; i < p; ++i) {
+      send_offsets[i + 1] = send_offsets[i] + send_counts[i];
+      slots[i + 1] = slots[i] + ::bliss::io::compress::max_bytes(send_counts[i] * sizeof(V));
+    }
+
+    ::imxx::scratch::buffer<uint8_t> send_buf(comm);
+    send_buf.reserve(slots[p]);
+    send_buf->resize(slots[p]);
+    ::std::vector<size_t> send_bytes(p, 0);
+
+    uint8_t const * src = reinterpret_cast<uint8_t const *>(input);
+    int nthreads = local::bucketing_threads(send_offsets[p]);
+#pragma omp parallel for schedule(dynamic) num_threads(nthreads) if (nthreads > 1)
+    for (int64_t i = 0; i < static_cast<int64_t>(p); ++i) {
+      send_bytes[i] = ::bliss::io::compress::encode(src + send_offsets[i] * sizeof(V), send_counts[i] * sizeof(V),
+                                                    send_buf->data() + slots[i], opts);
+    }
+
+    // pack the slots, front to back.  slots only move down.
+    uint8_t * out = send_buf->data();
+    for (size_t i = 0; i < p; ++i) {
+      if (out != send_buf->data() + slots[i]) memmove(out, send_buf->data() + slots[i], send_bytes[i]);
+      out += send_bytes[i];
+    }
+
+    // exchange byte counts, then the bytes.
+    ::std::vector<size_t> recv_bytes(p, 0);
+    ::mxx::all2all(send_bytes.data(), 1, recv_bytes.data(), comm);
+    ::std::vector<size_t> recv_offsets(p + 1, 0), out_offsets(p + 1, 0);
+    for (size_t i = 0; i < p; ++i) {
+      recv_offsets[i + 1] = recv_offsets[i] + recv_bytes[i];
+      out_offsets[i + 1] = out_offsets[i] + recv_counts[i];
+    }
+
+    ::imxx::scratch::buffer<uint8_t> recv_buf(comm);
+    recv_buf.reserve(recv_offsets[p]);
+    recv_buf->resize(recv_offsets[p]);
+    ::mxx::all2allv(send_buf->data(), send_bytes, recv_buf->data(), recv_bytes, comm);
+    BL_COMM_RECORD("compressed_wire", 1, send_bytes, recv_bytes);
+
+    // decompress.  exceptions cannot leave the parallel region, so note the failure and throw after.
+    uint8_t * dest = reinterpret_cast<uint8_t *>(output);
+    bool corrupt = false;
+    nthreads = local::bucketing_threads(out_offsets[p]);
+#pragma omp parallel for schedule(dynamic) num_threads(nthreads) if (nthreads > 1) reduction(|| : corrupt)
+    for (int64_t i = 0; i < static_cast<int64_t>(p); ++i) {
+      try {
+        ::bliss::io::compress::decode(recv_buf->data() + recv_offsets[i], recv_bytes[i],
+                                      dest + out_offsets[i] * sizeof(V), recv_counts[i] * sizeof(V));
+      } catch (::std::invalid_argument const &) {
+        corrupt = true;
+      }
+    }
+    if (corrupt) throw ::std::invalid_argument("compressed_all2allv: corrupt bucket received");
+  }
+
+  namespace hier {
+
+    /**
+     * @brief node layout of a communicator, for the two-level all2allv.
+     * @details  node holds the ranks sharing memory, ordered by rank in the parent communicator.  leaders holds local
+     *           rank 0 of every node; other ranks hold an unused communicator of non-leaders.  cached on the parent
+     *           communicator as an MPI attribute, so it is built once and freed with the communicator.
+     */
+    struct node_topology {
+        MPI_Comm node;
+        MPI_Comm leaders;
+        int num_nodes;
+        ::std::vector<int> node_of;         // parent rank -> node
+        ::std::vector<int> local_rank_of;   // parent rank -> rank within node
+        ::std::vector<::std::vector<int> > ranks_of_node;
+        bool useful;                        // more than 1 node, and some node with more than 1 rank.
+
+        explicit node_topology(::mxx::comm const & comm) {
+          MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, comm.rank(), MPI_INFO_NULL, &node);
+          int l;
+          MPI_Comm_rank(node, &l);
+          MPI_Comm_split(comm, (l == 0) ? 0 : 1, comm.rank(), &leaders);
+
+          int node_id = 0;
+          MPI_Comm_rank(leaders, &node_id);
+          MPI_Comm_size(leaders, &num_nodes);
+          int ids[2] = {node_id, num_nodes};
+          MPI_Bcast(ids, 2, MPI_INT, 0, node);
+          num_nodes = ids[1];
+
+          node_of = ::mxx::allgather(ids[0], comm);
+          ranks_of_node.resize(num_nodes);
+          local_rank_of.resize(comm.size());
+          for (int r = 0; r < comm.size(); ++r) {
+            local_rank_of[r] = ranks_of_node[node_of[r]].size();
+            ranks_of_node[node_of[r]].push_back(r);
+          }
+
+          useful = (num_nodes > 1) && (num_nodes < comm.size());
+        }
+
+        ~node_topology() {
+          MPI_Comm_free(&leaders);
+          MPI_Comm_free(&node);
+        }
+    };
+
+    inline int delete_topology(MPI_Comm, int, void * attr, void *) {
+      delete static_cast<node_topology *>(attr);
+      return MPI_SUCCESS;
+    }
+
+    /// get the cached node layout of comm, building it on first use.  collective on first use.
+    inline node_topology const & get_topology(::mxx::comm const & comm) {
+      static int keyval = MPI_KEYVAL_INVALID;
+      if (keyval == MPI_KEYVAL_INVALID) MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, delete_topology, &keyval, nullptr);
+
+      void * attr = nullptr;
+      int found = 0;
+      MPI_Comm_get_attr(comm, keyval, &attr, &found);
+      if (!found) {
+        attr = new node_topology(comm);
+        MPI_Comm_set_attr(comm, keyval, attr);
+      }
+      return *static_cast<node_topology *>(attr);
+    }
+
+  }  // namespace hier
+
+  /**
+   * @brief node-aware two-level all2allv.  same arguments and result as mxx::all2allv.
+   * @details  ranks send everything to their node leader over shared memory, leaders exchange per node pair, and each
+   *           leader scatters to the ranks in its node, ordered by source rank.  with N nodes, this uses about
+   *           N^2 + 2P messages instead of P^2, at the cost of moving the node's data through the leader.  for latency
+   *           bound exchanges at large P, i.e. many small buckets.
+   */
+  template <typename V, typename SIZE>
+  void hierarchical_all2allv(V const * input, ::std::vector<SIZE> const & send_counts,
+                             V * output, ::std::vector<SIZE> const & recv_counts,
+                             ::mxx::comm const & comm) {
+    hier::node_topology const & topo = hier::get_topology(comm);
+    ::mxx::comm node(topo.node);
+    size_t p = comm.size();
+    size_t L = node.size();
+    bool leader = (node.rank() == 0);
+
+    // 1. gather all send counts and data in the node.  C is L x p, by local source.
+    ::std::vector<size_t> counts(send_counts.begin(), send_counts.end());
+    size_t send_total = ::std::accumulate(counts.begin(), counts.end(), static_cast<size_t>(0));
+    ::std::vector<size_t> C = ::mxx::gather(counts.data(), p, 0, node);
+    ::std::vector<size_t> gather_sizes;
+    if (leader) {
+      gather_sizes.assign(L, 0);
+      for (size_t s = 0; s < L; ++s)
+        gather_sizes[s] = ::std::accumulate(C.begin() + s * p, C.begin() + (s + 1) * p, static_cast<size_t>(0));
+    }
+    ::std::vector<V> G(leader ? ::std::accumulate(gather_sizes.begin(), gather_sizes.end(), static_cast<size_t>(0)) : 0);
+    ::mxx::gatherv(input, send_total, G.data(), gather_sizes, 0, node);
+
+    ::std::vector<V> S;
+    ::std::vector<size_t> scatter_sizes;
+    if (leader) {
+      ::mxx::comm leaders(topo.leaders);
+      size_t N = topo.num_nodes;
+
+      // offset of block (s -> d) in G.
+      ::std::vector<size_t> goff(L * p);
+      size_t o = 0;
+      for (size_t s = 0; s < L; ++s) {
+        for (size_t d = 0; d < p; ++d) {
+          goff[s * p + d] = o;
+          o += C[s * p + d];
+        }
+      }
+
+      // 2. per destination node m: header of counts, ordered by destination then local source, and the data.
+      ::std::vector<size_t> hdr_send_sizes(N), hdr_recv_sizes(N), data_send_sizes(N, 0);
+      ::std::vector<size_t> hdr;
+      hdr.reserve(L * p);
+      ::std::vector<V> out;
+      out.reserve(G.size());
+      for (size_t m = 0; m < N; ++m) {
+        hdr_send_sizes[m] = L * topo.ranks_of_node[m].size();
+        hdr_recv_sizes[m] = topo.ranks_of_node[m].size() * L;
+        for (int d : topo.ranks_of_node[m]) {
+          for (size_t s = 0; s < L; ++s) {
+            size_t c = C[s * p + d];
+            hdr.push_back(c);
+            out.insert(out.end(), G.begin() + goff[s * p + d], G.begin() + goff[s * p + d] + c);
+            data_send_sizes[m] += c;
+          }
+        }
+      }
+      ::std::vector<V>().swap(G);
+
+      // 3. exchange among leaders.
+      ::std::vector<size_t> rhdr(p * L);
+      ::mxx::all2allv(hdr.data(), hdr_send_sizes, rhdr.data(), hdr_recv_sizes, leaders);
+
+      // from node k: local destination d major, k's local source s minor.
+      ::std::vector<size_t> hoff(N + 1, 0), data_recv_sizes(N, 0);
+      for (size_t k = 0; k < N; ++k) {
+        hoff[k + 1] = hoff[k] + topo.ranks_of_node[k].size() * L;
+        data_recv_sizes[k] = ::std::accumulate(rhdr.begin() + hoff[k], rhdr.begin() + hoff[k + 1], static_cast<size_t>(0));
+      }
+      ::std::vector<V> R(::std::accumulate(data_recv_sizes.begin(), data_recv_sizes.end(), static_cast<size_t>(0)));
+      ::mxx::all2allv(out.data(), data_send_sizes, R.data(), data_recv_sizes, leaders);
+      ::std::vector<V>().swap(out);
+
+      // offset of each received block, in header order.
+      ::std::vector<size_t> roff(rhdr.size());
+      o = 0;
+      for (size_t i = 0; i < rhdr.size(); ++i) {
+        roff[i] = o;
+        o += rhdr[i];
+      }
+
+      // 4. reorder by local destination, then by source rank, as all2allv would deliver.
+      S.reserve(R.size());
+      scatter_sizes.assign(L, 0);
+      for (size_t d = 0; d < L; ++d) {
+        for (size_t g = 0; g < p; ++g) {
+          int k = topo.node_of[g];
+          size_t i = hoff[k] + d * topo.ranks_of_node[k].size() + topo.local_rank_of[g];
+          S.insert(S.end(), R.begin() + roff[i], R.begin() + roff[i] + rhdr[i]);
+          scatter_sizes[d] += rhdr[i];
+        }
+      }
+    }
+
+    size_t recv_total = ::std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0));
+    ::mxx::scatterv(S.data(), scatter_sizes, output, recv_total, 0, node);
+  }
+
+  /**
+   * @brief all2all of count arrays, n entries per rank.  two-level when compiled with USE_HIERARCHICAL_A2A.
+   */
+  template <typename SIZE>
+  inline void counts_all2all(SIZE const * input, size_t n, SIZE * output, ::mxx::comm const & comm) {
+#if defined(USE_HIERARCHICAL_A2A)
+    if (hier::get_topology(comm).useful) {
+      ::std::vector<size_t> sizes(comm.size(), n);
+      hierarchical_all2allv(input, sizes, output, sizes, comm);
+      return;
+    }
+#endif
+    ::mxx::all2all(input, n, output, comm);
+  }
+
+  namespace rma {
+
+    /**
+     * @brief receive window for rma_all2allv.
+     * @details  allocated with MPI_Win_allocate, so the MPI library can register it with the network once, and cached
+     *           on the communicator as an MPI attribute, like hier::node_topology.  grows, never shrinks.
+     */
+    struct recv_window {
+        MPI_Win win;
+        uint8_t * base;
+        size_t bytes;
+
+        recv_window() : win(MPI_WIN_NULL), base(nullptr), bytes(0) {}
+
+        ~recv_window() {
+          if (win != MPI_WIN_NULL) MPI_Win_free(&win);
+        }
+
+        /// room for n bytes on this rank.  collective:  all ranks reallocate if any rank needs to.
+        void reserve(size_t const & n, ::mxx::comm const & comm) {
+          if (::mxx::all_of(n <= bytes, comm)) return;
+
+          if (win != MPI_WIN_NULL) MPI_Win_free(&win);
+          // headroom, so that slowly growing exchanges do not reallocate every time.
+          bytes = ::std::max(n, bytes + (bytes >> 1));
+          MPI_Win_allocate(bytes, 1, MPI_INFO_NULL, comm, &base, &win);
+        }
+    };
+
+    inline int delete_window(MPI_Comm, int, void * attr, void *) {
+      delete static_cast<recv_window *>(attr);
+      return MPI_SUCCESS;
+    }
+
+    /// get the cached receive window of comm, creating an empty one on first use.
+    inline recv_window & get_window(::mxx::comm const & comm) {
+      static int keyval = MPI_KEYVAL_INVALID;
+      if (keyval == MPI_KEYVAL_INVALID) MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, delete_window, &keyval, nullptr);
+
+      void * attr = nullptr;
+      int found = 0;
+      MPI_Comm_get_attr(comm, keyval, &attr, &found);
+      if (!found) {
+        attr = new recv_window();
+        MPI_Comm_set_attr(comm, keyval, attr);
+      }
+      return *static_cast<recv_window *>(attr);
+    }
+
+  }  // namespace rma
+
+  /**
+   * @brief all2allv with one-sided puts into a registered receive window.  same arguments and result as mxx::all2allv.
+   * @details  each rank learns where its bucket starts in every destination's window (1 extra count all2all), then puts
+   *           the buckets directly, in a single fence epoch, and copies its window to output.  this avoids the
+   *           rendezvous handshake per message of a large two-sided all2allv, and the window memory is registered once
+   *           per communicator.  for bandwidth bound exchanges of large buckets.
+   */
+  template <typename V, typename SIZE>
+  void rma_all2allv(V const * input, ::std::vector<SIZE> const & send_counts,
+                    V * output, ::std::vector<SIZE> const & recv_counts,
+                    ::mxx::comm const & comm) {
+    size_t p = comm.size();
+
+    // byte offset of each source in this rank's window, then of this rank's bucket in each destination's window.
+    ::std::vector<size_t> recv_displs(p, 0), remote_displs(p, 0);
+    size_t recv_total = 0;
+    for (size_t i = 0; i < p; ++i) {
+      recv_displs[i] = recv_total;
+      recv_total += recv_counts[i] * sizeof(V);
+    }
+    counts_all2all(recv_displs.data(), 1, remote_displs.data(), comm);
+
+    rma::recv_window & w = rma::get_window(comm);
+    w.reserve(recv_total, comm);
+
+    ::std::vector<size_t> send_displs(p, 0);
+    for (size_t i = 1; i < p; ++i) {
+      send_displs[i] = send_displs[i - 1] + send_counts[i - 1] * sizeof(V);
+    }
+
+    uint8_t const * src = reinterpret_cast<uint8_t const *>(input);
+    MPI_Win_fence(MPI_MODE_NOPRECEDE, w.win);
+    // start with the next rank, so that not all ranks put to rank 0 first.
+    for (size_t j = 1; j <= p; ++j) {
+      size_t d = (comm.rank() + j) % p;
+      size_t n = send_counts[d] * sizeof(V);
+      size_t off = 0;
+      while (off < n) {
+        int c = static_cast<int>(::std::min(n - off, static_cast<size_t>(::mxx::max_int)));
+        MPI_Put(const_cast<uint8_t *>(src + send_displs[d] + off), c, MPI_BYTE, d,
+                static_cast<MPI_Aint>(remote_displs[d] + off), c, MPI_BYTE, w.win);
+        off += c;
+      }
+    }
+    MPI_Win_fence(MPI_MODE_NOSUCCEED, w.win);
+    BL_COMM_RECORD("rma", sizeof(V), send_counts, recv_counts);
+
+    if (recv_total > 0) memcpy(static_cast<void *>(output), w.base, recv_total);
+  }
+
+  /**
+   * @brief all2allv of V as blocks of sizeof(V) bytes.  same arguments and result as mxx::all2allv.
+   * @details  1 MPI_Alltoallv with the cached type from ::bliss::io::wire::byte_datatype, so MPI copies bytes instead
+   *           of packing a struct type member by member.  if any rank's counts or displacements do not fit in int, all
+   *           ranks send MPI_BYTEs with mxx::all2allv instead.  V needs no mxx datatype.  see io/byte_wire.hpp.
+   */
+  template <typename V, typename SIZE>
+  void byte_all2allv(V const * input, ::std::vector<SIZE> const & send_counts,
+                     V * output, ::std::vector<SIZE> const & recv_counts,
+                     ::mxx::comm const & comm) {
+    static_assert(::std::is_trivially_copyable<V>::value, "byte_all2allv requires a trivially copyable type");
+    size_t p = comm.size();
+
+    ::std::vector<int> scounts(p), sdispls(p), rcounts(p), rdispls(p);
+    size_t stotal = 0, rtotal = 0;
+    for (size_t i = 0; i < p; ++i) {
+      scounts[i] = static_cast<int>(send_counts[i]);
+      rcounts[i] = static_cast<int>(recv_counts[i]);
+      sdispls[i] = static_cast<int>(stotal);
+      rdispls[i] = static_cast<int>(rtotal);
+      stotal += send_counts[i];
+      rtotal += recv_counts[i];
+    }
+    bool fits = (stotal <= static_cast<size_t>(::mxx::max_int)) && (rtotal <= static_cast<size_t>(::mxx::max_int));
+    if (!::mxx::all_of(fits, comm)) {
+      // as MPI_BYTEs, through mxx's large count support.  V needs no mxx datatype.
+      ::std::vector<size_t> send_bytes(p), recv_bytes(p);
+      for (size_t i = 0; i < p; ++i) {
+        send_bytes[i] = send_counts[i] * sizeof(V);
+        recv_bytes[i] = recv_counts[i] * sizeof(V);
+      }
+      ::mxx::all2allv(reinterpret_cast<uint8_t const *>(input), send_bytes, reinterpret_cast<uint8_t *>(output), recv_bytes, comm);
+      return;
+    }
+
+    MPI_Datatype dt = ::bliss::io::wire::byte_datatype<V>();
+    MPI_Alltoallv(const_cast<V *>(input), scounts.data(), sdispls.data(), dt,
+                  output, rcounts.data(), rdispls.data(), dt, comm);
+  }
+
+  /**
+   * @brief all2allv of std::pairs as packed_pairs, without the padding of std::pair.  same arguments and result as mxx::all2allv.
+   * @details  std::pair<Kmer<31, DNA, uint64_t>, uint32_t> is 16 bytes, 4 of them padding.  the entries are copied to
+   *           packed_pairs of 12 bytes, sent as byte blocks with byte_all2allv, and copied back to std::pairs.  the packed
+   *           send and receive buffers are 3/4 the size of the input and output.  see io/byte_wire.hpp.
+   */
+  template <typename A, typename B, typename SIZE>
+  void packed_entry_all2allv(::std::pair<A, B> const * input, ::std::vector<SIZE> const & send_counts,
+                             ::std::pair<A, B> * output, ::std::vector<SIZE> const & recv_counts,
+                             ::mxx::comm const & comm) {
+    using P = ::bliss::common::packed_pair<A, B>;
+    using W = ::bliss::io::wire::detail::byte_block<sizeof(P)>;
+    static_assert(sizeof(W) == sizeof(P), "packed entry and its byte block differ in size");
+
+    size_t stotal = ::std::accumulate(send_counts.begin(), send_counts.end(), static_cast<size_t>(0));
+    size_t rtotal = ::std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0));
+
+    ::std::vector<P> sends(input, input + stotal);
+    ::std::vector<P> recvs(rtotal);
+    byte_all2allv(reinterpret_cast<W const *>(sends.data()), send_counts,
+                  reinterpret_cast<W *>(recvs.data()), recv_counts, comm);
+    ::std::vector<P>().swap(sends);
+
+    for (size_t i = 0; i < rtotal; ++i) output[i] = recvs[i];
+  }
+
+  namespace detail {
+    /// packs_smaller types go through packed_entry_all2allv.  returns false for the others.
+    template <typename V, typename SIZE>
+    inline bool packed_entry_all2allv(V const *, ::std::vector<SIZE> const &, V *, ::std::vector<SIZE> const &,
+                                      ::mxx::comm const &, ::std::false_type) {
+      return false;
+    }
+    template <typename V, typename SIZE>
+    inline bool packed_entry_all2allv(V const * input, ::std::vector<SIZE> const & send_counts,
+                                      V * output, ::std::vector<SIZE> const & recv_counts,
+                                      ::mxx::comm const & comm, ::std::true_type) {
+      ::imxx::packed_entry_all2allv(input, send_counts, output, recv_counts, comm);
+      return true;
+    }
+
+    /// as_bytes types go through byte_all2allv, without instantiating mxx::all2allv for V.
+    template <typename V, typename SIZE>
+    inline void default_all2allv(V const * input, ::std::vector<SIZE> const & send_counts,
+                                 V * output, ::std::vector<SIZE> const & recv_counts,
+                                 ::mxx::comm const & comm, ::std::true_type) {
+      byte_all2allv(input, send_counts, output, recv_counts, comm);
+    }
+    template <typename V, typename SIZE>
+    inline void default_all2allv(V const * input, ::std::vector<SIZE> const & send_counts,
+                                 V * output, ::std::vector<SIZE> const & recv_counts,
+                                 ::mxx::comm const & comm, ::std::false_type) {
+      ::mxx::all2allv(input, send_counts, output, recv_counts, comm);
+    }
+  }  // namespace detail
+
+  /**
+   * @brief all2allv for distribute/undistribute.
+   * @details  when compiled with USE_PACKED_WIRE, element types that get smaller on the wire (k-mers with padding,
+   *           multi-byte integers, and pairs of these) go through packed_all2allv.  otherwise, when compiled with
+   *           USE_PACKED_ENTRIES, std::pairs with padding go through packed_entry_all2allv.  when compiled with USE_HIERARCHICAL_A2A,
+   *           communicators spanning several multi-rank nodes use hierarchical_all2allv.  when compiled with USE_RMA_A2A,
+   *           rma_all2allv is used instead of both of these.  when compression is enabled at
+   *           runtime (io/compressed_wire.hpp), compressed_all2allv takes precedence over both.  of the rest, types with
+   *           ::bliss::io::wire::as_bytes (io/byte_wire.hpp) use byte_all2allv.  everything else, and the default build,
+   *           uses mxx::all2allv directly.
+   */
+  template <typename V, typename SIZE>
+  inline void wire_all2allv(V const * input, ::std::vector<SIZE> const & send_counts,
+                            V * output, ::std::vector<SIZE> const & recv_counts,
+                            ::mxx::comm const & comm) {
+    BL_TRACE_SCOPE(wire_all2allv);
+    if (::bliss::io::compress::active()) {
+      compressed_all2allv(input, send_counts, output, recv_counts, comm);
+      return;
+    }
+#if defined(USE_PACKED_WIRE)
+    if (::bliss::io::wire::codec<V>::packed) {
+      packed_all2allv(input, send_counts, output, recv_counts, comm);
+      return;
+    }
+#endif
+#if defined(USE_PACKED_ENTRIES)
+    if (detail::packed_entry_all2allv(input, send_counts, output, recv_counts, comm,
+                                      ::std::integral_constant<bool, ::bliss::io::wire::packs_smaller<V>::value>()))
+      return;
+#endif
+#if defined(USE_RMA_A2A)
+    rma_all2allv(input, send_counts, output, recv_counts, comm);
+    return;
+#endif
+#if defined(USE_HIERARCHICAL_A2A)
+    if (hier::get_topology(comm).useful) {
+      hierarchical_all2allv(input, send_counts, output, recv_counts, comm);
+      return;
+    }
+#endif
+    detail::default_all2allv(input, send_counts, output, recv_counts, comm,
+                             ::std::integral_constant<bool, ::bliss::io::wire::as_bytes<V>::value>());
+  }
+
+
+  /**
+   * @brief fixed size exchange of 1 count per rank, for repeated distribute calls.
+   * @details  the count buffers are bound to a persistent MPI_Alltoall_init request when MPI 4 is available, so each
+   *           exchange is only MPI_Start and MPI_Wait.  otherwise falls back to counts_all2all on the same buffers.
+   *           fill send_counts(), call exchange(), read recv_counts().  construction is collective.
+   *           the buffers must not be resized.
+   */
+  template <typename SIZE = size_t>
+  class persistent_counts {
+    protected:
+      MPI_Comm comm;
+      ::std::vector<SIZE> sends;
+      ::std::vector<SIZE> recvs;
+#if MPI_VERSION >= 4
+      MPI_Request req;
+#endif
+
+    public:
+      explicit persistent_counts(::mxx::comm const & _comm) :
+        comm(_comm), sends(_comm.size(), 0), recvs(_comm.size(), 0) {
+#if MPI_VERSION >= 4
+        ::mxx::datatype dt = ::mxx::get_datatype<SIZE>();
+        MPI_Alltoall_init(sends.data(), 1, dt.type(), recvs.data(), 1, dt.type(), comm, MPI_INFO_NULL, &req);
+#endif
+      }
+
+      persistent_counts(persistent_counts const &) = delete;
+      persistent_counts & operator=(persistent_counts const &) = delete;
+
+      ~persistent_counts() {
+#if MPI_VERSION >= 4
+        MPI_Request_free(&req);
+#endif
+      }
+
+      ::std::vector<SIZE> & send_counts() { return sends; }
+      ::std::vector<SIZE> & recv_counts() { return recvs; }
+      ::std::vector<SIZE> const & recv_counts() const { return recvs; }
+
+      /// all2all of send_counts into recv_counts.  collective.
+      void exchange() {
+#if MPI_VERSION >= 4
+        MPI_Start(&req);
+        MPI_Wait(&req, MPI_STATUS_IGNORE);
+#else
+        counts_all2all(sends.data(), 1, recvs.data(), ::mxx::comm(comm));
+#endif
+      }
+  };
+
+
+  /**
+   * @brief the routing of 1 input vector to its owner ranks, kept for repeated exchanges of data aligned with it.
+   * @details  construction buckets the input with to_rank and exchanges the counts, as distribute does.  route() then
+   *           sends any vector aligned with the input (the same keys, or values for them) with the kept permutation and
+   *           counts, and respond() returns 1 entry per routed element to its source, in the source's original order.
+   *           neither buckets nor exchanges counts.  construction, route and respond are collective.
+   */
+  template <typename SIZE = size_t>
+  class routing_plan {
+    protected:
+      ::mxx::comm const & comm;
+      ::std::vector<SIZE> i2o;
+      ::std::vector<SIZE> sends;
+      ::std::vector<SIZE> recvs;
+      size_t received;
+
+    public:
+      template <typename V, typename ToRank>
+      routing_plan(::std::vector<V> const & input, ToRank const & to_rank, ::mxx::comm const & _comm) :
+        comm(_comm), i2o(input.size()), sends(_comm.size(), 0), recvs(_comm.size(), 0), received(0) {
+        imxx::local::assign_to_buckets(input, to_rank, comm.size(), sends, i2o, 0, input.size());
+        imxx::local::bucket_to_permutation(sends, i2o, 0, input.size());
+        counts_all2all(sends.data(), 1, recvs.data(), comm);
+        received = ::std::accumulate(recvs.begin(), recvs.end(), static_cast<size_t>(0));
+      }
+
+      /// number of input elements on this rank.
+      size_t size() const { return i2o.size(); }
+      /// number of elements routed to this rank.
+      size_t recv_size() const { return received; }
+      ::std::vector<SIZE> const & send_counts() const { return sends; }
+      ::std::vector<SIZE> const & recv_counts() const { return recvs; }
+
+      /// send input, aligned with the planned input, to the owners.  output is grouped by source rank.  collective.
+      template <typename V>
+      void route(::std::vector<V> const & input, ::std::vector<V> & output) const {
+        assert(input.size() == i2o.size());
+        ::std::vector<V> bucketed(input.size());
+        imxx::local::permute(input.begin(), input.end(), i2o.begin(), bucketed.begin(), 0);
+        if (output.capacity() < received) output.clear();
+        output.resize(received);
+        wire_all2allv(bucketed.data(), sends, output.data(), recvs, comm);
+        BL_COMM_RECORD("route", sizeof(V), sends, recvs);
+      }
+
+      /// return 1 entry per routed element to its source.  output is in the planned input's order.  collective.
+      template <typename V>
+      void respond(::std::vector<V> const & input, ::std::vector<V> & output) const {
+        assert(input.size() == received);
+        ::std::vector<V> bucketed(i2o.size());
+        wire_all2allv(input.data(), recvs, bucketed.data(), sends, comm);
+        BL_COMM_RECORD("respond", sizeof(V), recvs, sends);
+        if (output.capacity() < i2o.size()) output.clear();
+        output.resize(i2o.size());
+        imxx::local::unpermute(bucketed.begin(), bucketed.end(), i2o.begin(), output.begin(), 0);
+      }
+
+      /**
+       * @brief  respond with 1 bit per routed element, sent packed 64 to a word.  output is in the planned input's order.  collective.
+       * @details  each rank's bits start a new word, so at most 1 word per rank is padding.
+       */
+      void respond_bits(::std::vector<bool> const & input, ::std::vector<bool> & output) const {
+        assert(input.size() == received);
+        int p = comm.size();
+        ::std::vector<SIZE> word_sends(p), word_recvs(p);
+        for (int r = 0; r < p; ++r) {
+          word_sends[r] = (recvs[r] + 63) / 64;
+          word_recvs[r] = (sends[r] + 63) / 64;
+        }
+
+        ::std::vector<uint64_t> words(::std::accumulate(word_sends.begin(), word_sends.end(), static_cast<size_t>(0)), 0);
+        size_t j = 0, w = 0;
+        for (int r = 0; r < p; ++r) {
+          for (size_t b = 0; b < recvs[r]; ++b, ++j) {
+            if (input[j]) words[w + (b >> 6)] |= (1ULL << (b & 63));
+          }
+          w += word_sends[r];
+        }
+
+        ::std::vector<uint64_t> bucketed(::std::accumulate(word_recvs.begin(), word_recvs.end(), static_cast<size_t>(0)));
+        wire_all2allv(words.data(), word_sends, bucketed.data(), word_recvs, comm);
+        BL_COMM_RECORD("respond", sizeof(uint64_t), word_sends, word_recvs);
+
+        // padded bit position of each bucketed element, then back to the input's order.
+        ::std::vector<size_t> bits(i2o.size());
+        size_t k = 0;
+        w = 0;
+        for (int r = 0; r < p; ++r) {
+          for (size_t b = 0; b < sends[r]; ++b, ++k) bits[k] = (w << 6) + b;
+          w += word_recvs[r];
+        }
+        output.assign(i2o.size(), false);
+        for (size_t i = 0; i < i2o.size(); ++i) {
+          output[i] = (bucketed[bits[i2o[i]] >> 6] >> (bits[i2o[i]] & 63)) & 1;
+        }
+      }
+
+      /**
+       * @brief  respond with counts[j] entries for routed element j, concatenated in input.  collective.
+       * @details  the counts are returned as by respond, then the entries, with per-rank totals from the counts, so no
+       *           other count exchange is needed.
+       * @param output   entries for planned input element i are [offsets[i], offsets[i + 1]).
+       * @param offsets  size of the planned input + 1.
+       */
+      template <typename V, typename C>
+      void respond_variable(::std::vector<V> const & input, ::std::vector<C> const & counts,
+                            ::std::vector<V> & output, ::std::vector<size_t> & offsets) const {
+        assert(counts.size() == received);
+        int p = comm.size();
+
+        // the counts, in bucketed order.
+        ::std::vector<C> bucketed_counts(i2o.size());
+        wire_all2allv(counts.data(), recvs, bucketed_counts.data(), sends, comm);
+        BL_COMM_RECORD("respond", sizeof(C), recvs, sends);
+
+        ::std::vector<SIZE> entry_sends(p, 0), entry_recvs(p, 0);
+        size_t j = 0;
+        for (int r = 0; r < p; ++r) {
+          for (size_t b = 0; b < recvs[r]; ++b, ++j) entry_sends[r] += counts[j];
+        }
+        j = 0;
+        for (int r = 0; r < p; ++r) {
+          for (size_t b = 0; b < sends[r]; ++b, ++j) entry_recvs[r] += bucketed_counts[j];
+        }
+        assert(input.size() == ::std::accumulate(entry_sends.begin(), entry_sends.end(), static_cast<size_t>(0)));
+
+        ::std::vector<V> bucketed(::std::accumulate(entry_recvs.begin(), entry_recvs.end(), static_cast<size_t>(0)));
+        wire_all2allv(input.data(), entry_sends, bucketed.data(), entry_recvs, comm);
+        BL_COMM_RECORD("respond", sizeof(V), entry_sends, entry_recvs);
+
+        // bucketed offsets, then copy into the input's order.
+        ::std::vector<size_t> bucketed_offsets(i2o.size() + 1, 0);
+        for (size_t b = 0; b < i2o.size(); ++b) bucketed_offsets[b + 1] = bucketed_offsets[b] + bucketed_counts[b];
+        offsets.assign(i2o.size() + 1, 0);
+        for (size_t i = 0; i < i2o.size(); ++i) offsets[i + 1] = offsets[i] + bucketed_counts[i2o[i]];
+        if (output.capacity() < bucketed.size()) output.clear();
+        output.resize(bucketed.size());
+        for (size_t i = 0; i < i2o.size(); ++i) {
+          ::std::copy(bucketed.begin() + bucketed_offsets[i2o[i]], bucketed.begin() + bucketed_offsets[i2o[i] + 1],
+                      output.begin() + offsets[i]);
+        }
+      }
+  };
+
+
+  namespace detail {
+
+  /// distribute implementation.  send_counts and recv_counts are sized to comm size, and the counts are exchanged by x().
+  template <typename V, typename ToRank, typename SIZE, typename CountsExchange>
   void distribute(::std::vector<V>& input, ToRank const & to_rank,
+                  ::std::vector<SIZE> & send_counts,
                   ::std::vector<SIZE> & recv_counts,
                   ::std::vector<SIZE> & i2o,
                   ::std::vector<V>& output,
-                  ::mxx::comm const &_comm, bool const & preserve_input = false) {
+                  ::mxx::comm const &_comm, bool const & preserve_input, CountsExchange const & x) {
     BL_BENCH_INIT(distribute);
 
     BL_BENCH_COLLECTIVE_START(distribute, "empty", _comm);
@@ -1050,13 +2166,15 @@ namespace imxx
     BL_BENCH_END(distribute, "empty", input.size());
 
     if (empty) {
+      send_counts.assign(_comm.size(), 0);
+      ::std::fill(recv_counts.begin(), recv_counts.end(), 0);
       BL_BENCH_REPORT_MPI_NAMED(distribute, "imxx:distribute", _comm);
       return;
     }
     // speed over mem use.  mxx all2allv already has to double memory usage. same as stable distribute.
 
     BL_BENCH_START(distribute);
-    std::vector<SIZE> send_counts(_comm.size(), 0);
+    send_counts.assign(_comm.size(), 0);
     i2o.resize(input.size());
     BL_BENCH_COLLECTIVE_END(distribute, "alloc_map", input.size(), _comm);
 
@@ -1083,8 +2201,7 @@ namespace imxx
 
     // distribute (communication part)
     BL_BENCH_START(distribute);
-    recv_counts.resize(_comm.size());
-    mxx::all2all(send_counts.data(), 1, recv_counts.data(), _comm);
+    x();
     size_t total = std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0));
     BL_BENCH_COLLECTIVE_END(distribute, "a2a_count", recv_counts.size(), _comm);
 
@@ -1095,7 +2212,8 @@ namespace imxx
     BL_BENCH_COLLECTIVE_END(distribute, "realloc_out", output.size(), _comm);
 
     BL_BENCH_START(distribute);
-    mxx::all2allv(input.data(), send_counts, output.data(), recv_counts, _comm);
+    wire_all2allv(input.data(), send_counts, output.data(), recv_counts, _comm);
+    BL_COMM_RECORD("distribute", sizeof(V), send_counts, recv_counts);
     BL_BENCH_END(distribute, "a2a", output.size());
 
     if (preserve_input) {
@@ -1104,8 +2222,211 @@ namespace imxx
       imxx::local::unpermute_inplace(input, i2o, 0, input.size());
       BL_BENCH_END(distribute, "unpermute_inplace", input.size());
     }
-    BL_BENCH_REPORT_MPI_NAMED(distribute, "imxx:distribute", _comm);
+    BL_BENCH_REPORT_MPI_NAMED(distribute, "imxx:distribute", _comm);
+
+  }
+
+  }  // namespace detail
+
+  /**
+   * @brief distribute function.  input is transformed, but remains the original input with original order.  buffer is used for output.
+   * @details
+   * @tparam SIZE     type for the i2o mapping and recv counts.  should be large enough to represent max of input.size() and output.size()
+   */
+  template <typename V, typename ToRank, typename SIZE>
+  void distribute(::std::vector<V>& input, ToRank const & to_rank,
+                  ::std::vector<SIZE> & recv_counts,
+                  ::std::vector<SIZE> & i2o,
+                  ::std::vector<V>& output,
+                  ::mxx::comm const &_comm, bool const & preserve_input = false) {
+    std::vector<SIZE> send_counts;
+    recv_counts.resize(_comm.size());
+    detail::distribute(input, to_rank, send_counts, recv_counts, i2o, output, _comm, preserve_input,
+                       [&send_counts, &recv_counts, &_comm]() {
+      counts_all2all(send_counts.data(), 1, recv_counts.data(), _comm);
+    });
+  }
+
+  /**
+   * @brief distribute with the count buffers and count exchange of a persistent_counts object, for repeated calls.
+   * @details  on return, counts.send_counts() and counts.recv_counts() hold the bucket sizes sent and received.
+   *           i2o and output keep their capacity between calls.
+   */
+  template <typename V, typename ToRank, typename SIZE>
+  void distribute(::std::vector<V>& input, ToRank const & to_rank,
+                  persistent_counts<SIZE> & counts,
+                  ::std::vector<SIZE> & i2o,
+                  ::std::vector<V>& output,
+                  ::mxx::comm const &_comm, bool const & preserve_input = false) {
+    detail::distribute(input, to_rank, counts.send_counts(), counts.recv_counts(), i2o, output, _comm, preserve_input,
+                       [&counts]() {
+      counts.exchange();
+    });
+  }
+
+  /// HyperLogLog precision of the per destination sketches in distinct_all2all.  1KB per destination, about 3% error.
+  constexpr unsigned int distinct_sketch_precision = 10;
+
+  /**
+   * @brief  estimated number of distinct elements each rank receives, from sketches of what it is sent.  collective.
+   * @details  the element counts of a distribute say nothing about duplicates, so a receiving hash table cannot be
+   *           sized from them.  each rank sketches each of its send buckets with a small HyperLogLog, the sketches
+   *           are exchanged with 1 all2all of p * 1KB per rank, and each rank merges the sketches it gets.  the merge
+   *           is a union, so a key sent by several ranks is counted once.
+   * @param input  elements grouped by destination, send_counts[i] for rank i, in rank order.
+   * @param hash   64 bit hash of an element.  remixed by the sketch, so a map's storage hash can be used.
+   * @return  distinct estimate of the elements this rank receives.
+   */
+  template <typename V, typename SIZE, typename Hash>
+  double distinct_all2all(V const * input, ::std::vector<SIZE> const & send_counts, Hash const & hash,
+                          ::mxx::comm const & comm) {
+    using sketch_type = ::bliss::utils::sketch::hyperloglog<distinct_sketch_precision>;
+    constexpr size_t m = sketch_type::num_registers;
+    int p = comm.size();
+
+    ::std::vector<uint8_t> regs(m * p);
+    size_t offset = 0;
+    sketch_type hll;
+    for (int i = 0; i < p; ++i) {
+      hll.clear();
+      for (size_t j = offset; j < offset + send_counts[i]; ++j) hll.update(hash(input[j]));
+      offset += send_counts[i];
+      ::std::copy(hll.registers().begin(), hll.registers().end(), regs.begin() + i * m);
+    }
+
+    if (p > 1) regs = ::mxx::all2all(regs, comm);
+
+    ::std::vector<uint8_t> & merged = hll.registers();
+    ::std::copy(regs.begin(), regs.begin() + m, merged.begin());
+    for (int i = 1; i < p; ++i) {
+      uint8_t const * r = regs.data() + i * m;
+      for (size_t j = 0; j < m; ++j) merged[j] = ::std::max(merged[j], r[j]);
+    }
+    return hll.estimate();
+  }
+
+  /**
+   * @brief distribute, and estimate the distinct elements this rank receives.  see distinct_all2all.
+   * @details  the sketches are built from the permuted input and exchanged along with the counts, before the data,
+   *           so a receiver can size its table once instead of growing it by rehashing.
+   * @param hash      64 bit hash of an element.
+   * @param distinct  [out] distinct estimate for the received elements.  0 if no rank has input.
+   */
+  template <typename V, typename ToRank, typename SIZE, typename Hash>
+  void distribute(::std::vector<V>& input, ToRank const & to_rank,
+                  ::std::vector<SIZE> & recv_counts,
+                  ::std::vector<SIZE> & i2o,
+                  ::std::vector<V>& output,
+                  ::mxx::comm const &_comm, Hash const & hash, double & distinct,
+                  bool const & preserve_input = false) {
+    std::vector<SIZE> send_counts;
+    recv_counts.resize(_comm.size());
+    distinct = 0;
+    // input holds the permuted elements when the exchange runs.
+    detail::distribute(input, to_rank, send_counts, recv_counts, i2o, output, _comm, preserve_input,
+                       [&input, &send_counts, &recv_counts, &_comm, &hash, &distinct]() {
+      counts_all2all(send_counts.data(), 1, recv_counts.data(), _comm);
+      distinct = distinct_all2all(input.data(), send_counts, hash, _comm);
+    });
+  }
+
+  /**
+   * @brief sparse all2allv with the NBX algorithm (Hoefler et al., 2010), for exchanges where most counts are 0.
+   * @details  each rank synchronously sends only to ranks with non-zero counts, and receives by probing until a
+   *           non-blocking barrier, entered once all of its own sends are matched, completes.  nothing of size p is
+   *           exchanged, so latency follows the number of actual destinations plus a log p barrier.
+   *           a rank can run at most one exchange ahead of another, so back to back calls should alternate between
+   *           2 tags.  each message must fit in an int count.
+   *
+   * @param input   bucketed input, send_counts[i] elements for rank i, in rank order.
+   * @param output  received elements, in source rank order.
+   * @param recv_counts [out] elements received from each rank.
+   */
+  template <typename V, typename SIZE>
+  void sparse_all2allv(V const * input, ::std::vector<SIZE> const & send_counts,
+                       ::std::vector<V> & output, ::std::vector<SIZE> & recv_counts,
+                       ::mxx::comm const & comm, int const tag = 0) {
+    int p = comm.size();
+    ::mxx::datatype dt = ::mxx::get_datatype<V>();
+
+    ::std::vector<MPI_Request> sends;
+    size_t offset = 0;
+    for (int i = 0; i < p; ++i) {
+      if (send_counts[i] == 0) continue;
+      assert((send_counts[i] < static_cast<size_t>(::mxx::max_int)) && "sparse_all2allv message too large");
+      sends.emplace_back();
+      MPI_Issend(const_cast<V*>(input + offset), send_counts[i], dt.type(), i, tag, comm, &(sends.back()));
+      offset += send_counts[i];
+    }
+
+    // receive into per source buffers until everyone's sends are matched.
+    ::std::vector<::std::vector<V> > received(p);
+    recv_counts.assign(p, 0);
+    MPI_Request barrier;
+    bool barrier_active = false;
+    while (true) {
+      int flag = 0;
+      MPI_Status status;
+      MPI_Iprobe(MPI_ANY_SOURCE, tag, comm, &flag, &status);
+      if (flag) {
+        int count = 0;
+        MPI_Get_count(&status, dt.type(), &count);
+        received[status.MPI_SOURCE].resize(count);
+        MPI_Recv(received[status.MPI_SOURCE].data(), count, dt.type(), status.MPI_SOURCE, tag, comm, MPI_STATUS_IGNORE);
+        recv_counts[status.MPI_SOURCE] = count;
+      }
+
+      if (barrier_active) {
+        int done = 0;
+        MPI_Test(&barrier, &done, MPI_STATUS_IGNORE);
+        if (done) break;
+      } else {
+        int done = 0;
+        MPI_Testall(sends.size(), sends.data(), &done, MPI_STATUSES_IGNORE);
+        if (done) {
+          MPI_Ibarrier(comm, &barrier);
+          barrier_active = true;
+        }
+      }
+    }
+
+    output.clear();
+    output.reserve(::std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0)));
+    for (int i = 0; i < p; ++i) {
+      output.insert(output.end(), received[i].begin(), received[i].end());
+    }
+  }
+
+  /**
+   * @brief distribute with sparse_all2allv, for small inputs that go to few ranks.  input is bucketed in place.
+   * @param send_counts [out] elements sent to each rank.
+   * @param recv_counts [out] elements received from each rank.
+   */
+  template <typename V, typename ToRank, typename SIZE>
+  void sparse_distribute(::std::vector<V>& input, ToRank const & to_rank,
+                         ::std::vector<SIZE> & send_counts,
+                         ::std::vector<SIZE> & recv_counts,
+                         ::std::vector<V>& output,
+                         ::mxx::comm const &_comm, int const tag = 0) {
+    BL_BENCH_INIT(sparse_distribute);
+
+    BL_BENCH_START(sparse_distribute);
+    std::vector<SIZE> i2o(input.size());
+    send_counts.assign(_comm.size(), 0);
+    imxx::local::assign_to_buckets(input, to_rank, _comm.size(), send_counts, i2o, 0, input.size());
+    imxx::local::bucket_to_permutation(send_counts, i2o, 0, input.size());
+    if (output.capacity() < input.size()) output.clear();
+    output.resize(input.size());
+    imxx::local::permute(input.begin(), input.end(), i2o.begin(), output.begin(), 0);
+    output.swap(input);  // input now holds bucketed entries.
+    BL_BENCH_END(sparse_distribute, "bucket", input.size());
+
+    BL_BENCH_START(sparse_distribute);
+    sparse_all2allv(input.data(), send_counts, output, recv_counts, _comm, tag);
+    BL_COMM_RECORD("sparse_distribute", sizeof(V), send_counts, recv_counts);
+    BL_BENCH_END(sparse_distribute, "nbx", output.size());
 
+    BL_BENCH_REPORT_MPI_NAMED(sparse_distribute, "imxx:sparse_distribute", _comm);
   }
 
   template <typename V, typename ToRank, typename SIZE>
@@ -1126,35 +2447,17 @@ namespace imxx
     }
     // speed over mem use.  mxx all2allv already has to double memory usage. same as stable distribute.
 
+    // bucketing, in place.  no i2o, so the input order is not preserved.  to_rank is called once per element.
     BL_BENCH_START(distribute);
     std::vector<SIZE> send_counts(_comm.size(), 0);
-    BL_BENCH_END(distribute, "alloc_map", input.size());
-
-    BL_BENCH_START(distribute);
-    if (output.capacity() < input.size()) output.clear();
-    output.resize(input.size());
-    output.swap(input);  // swap the 2.
-    BL_BENCH_COLLECTIVE_END(distribute, "alloc_permute", output.size(), _comm);
-
-    // bucketing
-    BL_BENCH_START(distribute);
-    size_t comm_size = _comm.size();
-    if (comm_size <= std::numeric_limits<uint8_t>::max()) {
-      imxx::local::bucketing_impl(output, to_rank, static_cast< uint8_t>(comm_size), send_counts, input, 0, output.size());
-    } else if (comm_size <= std::numeric_limits<uint16_t>::max()) {
-      imxx::local::bucketing_impl(output, to_rank, static_cast<uint16_t>(comm_size), send_counts, input, 0, output.size());
-    } else if (comm_size <= std::numeric_limits<uint32_t>::max()) {
-      imxx::local::bucketing_impl(output, to_rank, static_cast<uint32_t>(comm_size), send_counts, input, 0, output.size());
-    } else {
-      imxx::local::bucketing_impl(output, to_rank, static_cast<uint64_t>(comm_size), send_counts, input, 0, output.size());
-    }
+    imxx::local::bucket_inplace(input, to_rank, _comm.size(), send_counts, static_cast<SIZE>(0), 0, input.size());
     BL_BENCH_COLLECTIVE_END(distribute, "bucket", input.size(), _comm);
 
 
     // distribute (communication part)
     BL_BENCH_START(distribute);
     recv_counts.resize(_comm.size());
-    mxx::all2all(send_counts.data(), 1, recv_counts.data(), _comm);
+    counts_all2all(send_counts.data(), 1, recv_counts.data(), _comm);
     size_t total = std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0));
     BL_BENCH_COLLECTIVE_END(distribute, "a2a_count", recv_counts.size(), _comm);
 
@@ -1165,13 +2468,125 @@ namespace imxx
     BL_BENCH_COLLECTIVE_END(distribute, "realloc_out", output.size(), _comm);
 
     BL_BENCH_START(distribute);
-    mxx::all2allv(input.data(), send_counts, output.data(), recv_counts, _comm);
+    wire_all2allv(input.data(), send_counts, output.data(), recv_counts, _comm);
+    BL_COMM_RECORD("distribute", sizeof(V), send_counts, recv_counts);
     BL_BENCH_END(distribute, "a2a", output.size());
 
     BL_BENCH_REPORT_MPI_NAMED(distribute, "imxx:distribute_bucket", _comm);
 
   }
 
+  /**
+   * @brief distribute in place:  input becomes the received elements, grouped by source process.
+   * @details  distribute keeps input alive next to an output of the received size, so its peak is sent + received.
+   *           here input is bucketed in place with the own bucket first, then the buckets for rank-1, rank-2, ..., so the
+   *           bucket for rank+1 is last.  in round k = 1 .. p-1 each process sends its last bucket to rank+k and receives
+   *           from rank-k, in pieces of at most slack x the average per process element count, via MPI_Isend/MPI_Irecv.
+   *           sent pieces come off the end of the unsent part, and received pieces are written from the end of the array
+   *           toward the front, so each piece only needs room once the pieces before it were sent.  the array is sized
+   *           once to the largest unsent + received footprint of this schedule, computed locally from the counts.  at the
+   *           end the received blocks are moved behind the own bucket and rotated into source order.
+   *
+   *           with balanced buckets the peak is about (1 + slack) x max(sent, received).  if input's capacity is below
+   *           that it is grown once, before the exchange.  the order within a bucket is not preserved, and the wire codecs
+   *           of wire_all2allv are not used.
+   *
+   * @param input[in|out]     data to distribute.  received elements, grouped by source process, on return.
+   * @param recv_counts[out]  number of elements received from each process.
+   * @param slack             piece size, as a fraction of the average per process element count.
+   */
+  template <typename V, typename ToRank, typename SIZE>
+  void distribute_inplace(::std::vector<V>& input, ToRank const & to_rank,
+                          ::std::vector<SIZE> & recv_counts,
+                          ::mxx::comm const &_comm, double slack = 0.1) {
+    BL_BENCH_INIT(distribute);
+    BL_COMM_SCOPE(distribute_inplace);
+    size_t p = _comm.size();
+    size_t rank = _comm.rank();
+
+    BL_BENCH_COLLECTIVE_START(distribute, "empty", _comm);
+    size_t global = ::mxx::allreduce(input.size(), _comm);
+    BL_BENCH_END(distribute, "empty", input.size());
+
+    if (global == 0) {
+      recv_counts.assign(p, 0);
+      BL_BENCH_REPORT_MPI_NAMED(distribute, "imxx:distribute_inplace", _comm);
+      return;
+    }
+
+    // bucketing, in place, in the order rank, rank-1, ..., rank+1.
+    BL_BENCH_START(distribute);
+    std::vector<SIZE> bucket_counts(p, 0);
+    imxx::local::bucket_inplace(input, [&to_rank, p, rank](V const & x) {
+      return (rank + p - static_cast<size_t>(to_rank(x))) % p;
+    }, p, bucket_counts, static_cast<SIZE>(0), 0, input.size());
+    std::vector<SIZE> send_counts(p, 0);
+    for (size_t i = 0; i < p; ++i) send_counts[(rank + p - i) % p] = bucket_counts[i];
+    BL_BENCH_COLLECTIVE_END(distribute, "bucket", input.size(), _comm);
+
+    BL_BENCH_START(distribute);
+    recv_counts.resize(p);
+    counts_all2all(send_counts.data(), 1, recv_counts.data(), _comm);
+    size_t total = std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0));
+    BL_BENCH_COLLECTIVE_END(distribute, "a2a_count", recv_counts.size(), _comm);
+
+    // plan:  the largest unsent + received footprint over all pieces.
+    BL_BENCH_START(distribute);
+    size_t piece = ::std::max(static_cast<size_t>(1), static_cast<size_t>(slack * static_cast<double>(global) / p));
+    piece = ::std::min(piece, static_cast<size_t>(mxx::max_int));
+    size_t self = send_counts[rank];
+    size_t planned = input.size();
+    {
+      size_t unsent = input.size(), received = 0;
+      for (size_t k = 1; k < p; ++k) {
+        size_t out = send_counts[(rank + k) % p], in = recv_counts[(rank + p - k) % p];
+        while ((out > 0) || (in > 0)) {
+          size_t o = ::std::min(piece, out), i = ::std::min(piece, in);
+          planned = ::std::max(planned, unsent + received + i);
+          unsent -= o;  out -= o;
+          received += i;  in -= i;
+        }
+      }
+      planned = ::std::max(planned, self + received);
+    }
+    input.resize(planned);
+    BL_BENCH_COLLECTIVE_END(distribute, "plan", planned, _comm);
+
+    // pairwise exchange.  the j-th piece from a source matches its j-th send, as MPI does not reorder messages.
+    BL_BENCH_START(distribute);
+    const int tag = 1537;
+    mxx::datatype dt = mxx::get_datatype<V>();
+    V * data = input.data();
+    size_t unsent = std::accumulate(send_counts.begin(), send_counts.end(), static_cast<size_t>(0));
+    size_t recv_begin = planned;
+    for (size_t k = 1; k < p; ++k) {
+      int dst = (rank + k) % p, src = (rank + p - k) % p;
+      size_t out = send_counts[dst], in = recv_counts[src];
+      while ((out > 0) || (in > 0)) {
+        size_t o = ::std::min(piece, out), i = ::std::min(piece, in);
+        MPI_Request reqs[2];
+        int nreqs = 0;
+        if (i > 0) MPI_Irecv(data + recv_begin - i, static_cast<int>(i), dt.type(), src, tag, _comm, &(reqs[nreqs++]));
+        if (o > 0) MPI_Isend(data + unsent - o, static_cast<int>(o), dt.type(), dst, tag, _comm, &(reqs[nreqs++]));
+        MPI_Waitall(nreqs, reqs, MPI_STATUSES_IGNORE);
+        unsent -= o;  out -= o;
+        recv_begin -= i;  in -= i;
+      }
+    }
+    BL_COMM_RECORD("distribute", sizeof(V), send_counts, recv_counts);
+    BL_BENCH_END(distribute, "a2a", total);
+
+    // own bucket is [0, self), the received blocks [recv_begin, planned) are from rank+1, ..., rank-1.
+    BL_BENCH_START(distribute);
+    if (recv_begin > self) ::std::move(input.begin() + recv_begin, input.end(), input.begin() + self);
+    input.resize(total);
+    size_t head = std::accumulate(recv_counts.begin() + rank, recv_counts.end(), static_cast<size_t>(0));
+    ::std::rotate(input.begin(), input.begin() + head, input.end());
+    BL_BENCH_END(distribute, "rotate", input.size());
+
+    BL_BENCH_REPORT_MPI_NAMED(distribute, "imxx:distribute_inplace", _comm);
+  }
+
   template <typename V, typename SIZE>
   void undistribute(::std::vector<V> const & input,
                   ::std::vector<SIZE> const & recv_counts,
@@ -1192,8 +2607,8 @@ namespace imxx
 
 
     BL_BENCH_START(undistribute);
-    std::vector<size_t> send_counts(recv_counts.size());
-    mxx::all2all(recv_counts.data(), 1, send_counts.data(), _comm);
+    std::vector<SIZE> send_counts(recv_counts.size());
+    counts_all2all(recv_counts.data(), 1, send_counts.data(), _comm);
     size_t total = std::accumulate(send_counts.begin(), send_counts.end(), static_cast<size_t>(0));
     BL_BENCH_END(undistribute, "recv_counts", input.size());
 
@@ -1203,7 +2618,8 @@ namespace imxx
     BL_BENCH_COLLECTIVE_END(undistribute, "realloc_out", output.size(), _comm);
 
     BL_BENCH_START(undistribute);
-    mxx::all2allv(input.data(), recv_counts, output.data(), send_counts, _comm);
+    wire_all2allv(input.data(), recv_counts, output.data(), send_counts, _comm);
+    BL_COMM_RECORD("undistribute", sizeof(V), recv_counts, send_counts);
     BL_BENCH_END(undistribute, "a2av", input.size());
 
     if (restore_order) {
@@ -1289,12 +2705,15 @@ namespace imxx
 
       BL_BENCH_START(distribute);
       block_all2all(input, min_bucket_size, output, 0, 0, _comm);
+      BL_COMM_RECORD("distribute_2part_block", sizeof(V), ::std::vector<SIZE>(_comm.size(), min_bucket_size),
+                     ::std::vector<SIZE>(_comm.size(), min_bucket_size));
       BL_BENCH_COLLECTIVE_END(distribute, "a2a", first_part, _comm);
 
 
       BL_BENCH_START(distribute);
       mxx::all2allv(input.data() + first_part, send_counts,
                     output.data() + first_part, recv_counts, _comm);
+      BL_COMM_RECORD("distribute_2part", sizeof(V), send_counts, recv_counts);
       BL_BENCH_END(distribute, "a2av", total - first_part);
 
       // permute
@@ -1308,6 +2727,73 @@ namespace imxx
   }
 
 
+  /**
+   * @brief distribute_2part without the i2o mapping.  buckets in place, so input is left in bucketed order.
+   * @param recv_counts  counts for each bucket that is NOT PART OF FIRST BLOCK.
+   */
+  template <typename V, typename ToRank, typename SIZE>
+  void distribute_2part(::std::vector<V>& input, ToRank const & to_rank,
+                        ::std::vector<SIZE> & recv_counts,
+                        ::std::vector<V>& output,
+                        ::mxx::comm const &_comm) {
+    BL_BENCH_INIT(distribute);
+
+    BL_BENCH_COLLECTIVE_START(distribute, "empty", _comm);
+    bool empty = input.size() == 0;
+    empty = mxx::all_of(empty);
+    BL_BENCH_END(distribute, "empty", input.size());
+
+    if (empty) {
+      BL_BENCH_REPORT_MPI_NAMED(distribute, "imxx:distribute_2_bucket", _comm);
+      return;
+    }
+
+      BL_BENCH_START(distribute);
+      std::vector<SIZE> send_counts(_comm.size(), 0);
+      imxx::local::count_buckets(input, to_rank, _comm.size(), send_counts, 0, input.size());
+      BL_BENCH_COLLECTIVE_END(distribute, "count", input.size(), _comm);
+
+      // compute minimum block size.
+      BL_BENCH_START(distribute);
+      SIZE min_bucket_size = *(::std::min_element(send_counts.begin(), send_counts.end()));
+      min_bucket_size = ::mxx::allreduce(min_bucket_size, mxx::min<SIZE>(), _comm);
+      BL_BENCH_END(distribute, "min_bucket_size", min_bucket_size);
+
+      // blocks then remainders, in place.  send_counts modified to the remainders.
+      BL_BENCH_START(distribute);
+      imxx::local::partition_inplace(input, to_rank, send_counts, min_bucket_size, 0, input.size());
+      SIZE first_part = _comm.size() * min_bucket_size;
+      BL_BENCH_COLLECTIVE_END(distribute, "bucket", input.size(), _comm);
+
+      // compute receive counts and total
+      BL_BENCH_START(distribute);
+      recv_counts.resize(_comm.size());
+      mxx::all2all(send_counts.data(), 1, recv_counts.data(), _comm);
+      SIZE total = std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0));
+      total += first_part;
+      BL_BENCH_COLLECTIVE_END(distribute, "a2av_count", total, _comm);
+
+      BL_BENCH_START(distribute);
+      if (output.capacity() < total) output.clear();
+      output.resize(total);
+      BL_BENCH_COLLECTIVE_END(distribute, "alloc_out", output.size(), _comm);
+
+      BL_BENCH_START(distribute);
+      block_all2all(input, min_bucket_size, output, 0, 0, _comm);
+      BL_COMM_RECORD("distribute_2part_block", sizeof(V), ::std::vector<SIZE>(_comm.size(), min_bucket_size),
+                     ::std::vector<SIZE>(_comm.size(), min_bucket_size));
+      BL_BENCH_COLLECTIVE_END(distribute, "a2a", first_part, _comm);
+
+      BL_BENCH_START(distribute);
+      mxx::all2allv(input.data() + first_part, send_counts,
+                    output.data() + first_part, recv_counts, _comm);
+      BL_COMM_RECORD("distribute_2part", sizeof(V), send_counts, recv_counts);
+      BL_BENCH_END(distribute, "a2av", total - first_part);
+
+      BL_BENCH_REPORT_MPI_NAMED(distribute, "imxx:distribute_2_bucket", _comm);
+  }
+
+
   /**
    * @param recv_counts  counts for each bucket that is NOT PART OF FIRST BLOCK.
    */
@@ -1347,10 +2833,13 @@ namespace imxx
 
     BL_BENCH_START(undistribute);
     mxx::all2all(input.data(), first_part / _comm.size(), output.data(), _comm);
+    BL_COMM_RECORD("undistribute_2part_block", sizeof(V), ::std::vector<size_t>(_comm.size(), first_part / _comm.size()),
+                   ::std::vector<size_t>(_comm.size(), first_part / _comm.size()));
     BL_BENCH_END(undistribute, "a2a", first_part);
 
     BL_BENCH_START(undistribute);
     mxx::all2allv(input.data() + first_part, recv_counts, output.data() + first_part, send_counts, _comm);
+    BL_COMM_RECORD("undistribute_2part", sizeof(V), recv_counts, send_counts);
     BL_BENCH_END(undistribute, "a2av", second_part);
 
     if (restore_order) {
@@ -1381,6 +2870,7 @@ namespace imxx
                               ::mxx::comm const &_comm,
                               bool const & preserve_input = false) {
       BL_BENCH_INIT(scat_comp_gath);
+      BL_COMM_SCOPE(scatter_compute_gather);
 
       // speed over mem use.  mxx all2allv already has to double memory usage. same as stable distribute.
       BL_BENCH_COLLECTIVE_START(scat_comp_gath, "empty", _comm);
@@ -1456,6 +2946,7 @@ namespace imxx
                               ::mxx::comm const &_comm,
                               bool const & preserve_input = false) {
       BL_BENCH_INIT(scat_comp_gath_2);
+      BL_COMM_SCOPE(scatter_compute_gather_2part);
 
       // speed over mem use.  mxx all2allv already has to double memory usage. same as stable scat_comp_gath_2.
       BL_BENCH_COLLECTIVE_START(scat_comp_gath_2, "empty", _comm);
@@ -1522,6 +3013,8 @@ namespace imxx
       //== process first part.  communicate in place
       BL_BENCH_START(scat_comp_gath_2);
       block_all2all(input, min_bucket_size, in_buffer, 0, 0, _comm);
+      BL_COMM_RECORD("scatter_block", sizeof(V), ::std::vector<SIZE>(_comm.size(), min_bucket_size),
+                     ::std::vector<SIZE>(_comm.size(), min_bucket_size));
       BL_BENCH_END(scat_comp_gath_2, "a2a_inplace", first_part);
 
       // process
@@ -1533,6 +3026,8 @@ namespace imxx
       // undo a2a, so that result data matches.
       BL_BENCH_START(scat_comp_gath_2);
       block_all2all_inplace(output, min_bucket_size, 0, _comm);
+      BL_COMM_RECORD("gather_block", sizeof(T), ::std::vector<SIZE>(_comm.size(), min_bucket_size),
+                     ::std::vector<SIZE>(_comm.size(), min_bucket_size));
       BL_BENCH_END(scat_comp_gath_2, "inverse_a2a_inplace", first_part);
 
       //======= process the second part
@@ -1547,6 +3042,7 @@ namespace imxx
       BL_BENCH_START(scat_comp_gath_2);
 	  mxx::all2allv(input.data() + first_part, send_counts,
                     in_buffer.data(), recv_counts, _comm);
+      BL_COMM_RECORD("scatter", sizeof(V), send_counts, recv_counts);
       BL_BENCH_END(scat_comp_gath_2, "a2av", in_buffer.size());
 
       // process the second part.
@@ -1558,6 +3054,7 @@ namespace imxx
       BL_BENCH_START(scat_comp_gath_2);
 	  mxx::all2allv(out_buffer.data(), recv_counts,
                     output.data() + first_part, send_counts, _comm);
+      BL_COMM_RECORD("gather", sizeof(T), recv_counts, send_counts);
       BL_BENCH_END(scat_comp_gath_2, "inverse_a2av", output.size());
 
 
@@ -1654,6 +3151,7 @@ namespace imxx
                               ::mxx::comm const &_comm,
                               bool const & preserve_input = false) {
       BL_BENCH_INIT(scat_comp_gath_lm);
+      BL_COMM_SCOPE(scatter_compute_gather_lowmem);
 
       BL_BENCH_COLLECTIVE_START(scat_comp_gath_lm, "empty", _comm);
       bool empty = input.size() == 0;
@@ -1735,6 +3233,8 @@ namespace imxx
 
 		  BL_BENCH_START(scat_comp_gath_lm);
 		  block_all2all_inplace(in_buffer, block_bucket_size, 0, _comm);
+		  BL_COMM_RECORD("scatter_block", sizeof(V), ::std::vector<SIZE>(_comm.size(), block_bucket_size),
+		                 ::std::vector<SIZE>(_comm.size(), block_bucket_size));
 		  BL_BENCH_END(scat_comp_gath_lm, "a2a_inplace", block_size);
 
 		  // process
@@ -1746,6 +3246,8 @@ namespace imxx
 		  // undo a2a, so that result data matches.
 		  BL_BENCH_START(scat_comp_gath_lm);
 		  block_all2all_inplace(output, block_bucket_size, i * block_size, _comm);
+		  BL_COMM_RECORD("gather_block", sizeof(T), ::std::vector<SIZE>(_comm.size(), block_bucket_size),
+		                 ::std::vector<SIZE>(_comm.size(), block_bucket_size));
 		  BL_BENCH_END(scat_comp_gath_lm, "inverse_a2a_inplace", block_size);
 
       }
@@ -1768,6 +3270,7 @@ namespace imxx
       ::mxx::all2all(send_counts.data(), 1, recv_counts.data(), _comm);
 	  mxx::all2allv(in_buffer.data(), send_counts,
                     in_buffer.data() + second_part_local, recv_counts, _comm);
+      BL_COMM_RECORD("scatter", sizeof(V), send_counts, recv_counts);
       BL_BENCH_END(scat_comp_gath_lm, "a2av", second_part_local);
 
       // process the second part.
@@ -1779,6 +3282,7 @@ namespace imxx
       BL_BENCH_START(scat_comp_gath_lm);
 	  mxx::all2allv(out_buffer.data(), recv_counts,
                     output.data() + first_part, send_counts, _comm);
+      BL_COMM_RECORD("gather", sizeof(T), recv_counts, send_counts);
       BL_BENCH_END(scat_comp_gath_lm, "inverse_a2av", second_part_remote);
 
       // permute
@@ -1793,6 +3297,169 @@ namespace imxx
       BL_BENCH_REPORT_MPI_NAMED(scat_comp_gath_lm, "imxx:scat_comp_gath_lm", _comm);
   }
 
+  /**
+   * @brief round size controller for scatter_compute_gather_adaptive.
+   * @details  the round size is the number of input elements each rank sends per round.  the time of each full round
+   *           (max over ranks of the distribute + undistribute and compute times) gives its throughput.  the controller
+   *           doubles the round size while throughput improves by more than 5%, then settles on the best size seen.
+   *           if a settled round falls below 3/4 of the best throughput (the input or the machine changed), it probes
+   *           again from half the best size.  round sizes are capped so that one round's buffers fit under mem_limit
+   *           bytes per rank, using the largest receive imbalance seen so far.
+   *
+   *           keep one controller per call site, so later calls start from the learned size.  all ranks update their
+   *           controllers with the same global values, so they agree on the round size without extra communication.
+   */
+  class batch_controller {
+    public:
+      struct round_info {
+          size_t size;          // elements per rank this round.  the last round may be smaller than the chosen size.
+          double comm_time;     // seconds, max over ranks.
+          double compute_time;  // seconds, max over ranks.
+      };
+
+    protected:
+      size_t mem_limit;
+      size_t min_size;
+      size_t current;
+      size_t best;
+      double best_rate;
+      bool settled;
+      /// largest received / sent elements of a rank in a round.
+      double recv_ratio;
+      ::std::vector<round_info> rounds;
+
+    public:
+      /**
+       * @param mem_limit_bytes   per rank ceiling for the buffers of one round.
+       * @param initial           first round size, in elements per rank.
+       * @param min_round         smallest round size the controller will choose.
+       */
+      explicit batch_controller(size_t const & mem_limit_bytes, size_t const & initial = (1UL << 16),
+                                size_t const & min_round = 1024) :
+        mem_limit(mem_limit_bytes), min_size(::std::max(min_round, static_cast<size_t>(1))),
+        current(::std::max(initial, min_size)), best(0), best_rate(0.0), settled(false), recv_ratio(1.0) {}
+
+      /// round size for elements that need bytes_per_elem of buffer per element sent or received.  at least 1.
+      size_t next(size_t const & bytes_per_elem) const {
+        size_t cap = static_cast<size_t>(static_cast<double>(mem_limit) / (static_cast<double>(bytes_per_elem) * recv_ratio));
+        return ::std::max(::std::min(current, cap), static_cast<size_t>(1));
+      }
+
+      /// record a round.  full is false when no rank had n elements left, which is reported but does not steer.
+      void record(size_t const & n, double const & comm_time, double const & compute_time, double const & ratio, bool const & full) {
+        rounds.push_back(round_info{n, comm_time, compute_time});
+        recv_ratio = ::std::max(recv_ratio, ratio);
+        if (!full) return;
+
+        double t = comm_time + compute_time;
+        double rate = (t > 0.0) ? static_cast<double>(n) / t : ::std::numeric_limits<double>::max();
+
+        if (!settled) {
+          if (rate > 1.05 * best_rate) {
+            best = n;
+            best_rate = rate;
+            current = 2 * n;
+          } else {
+            current = best;
+            settled = true;
+          }
+        } else if (rate < 0.75 * best_rate) {
+          best = ::std::max(min_size, n / 2);
+          best_rate = 0.0;
+          current = best;
+          settled = false;
+        }
+      }
+
+      size_t get_round_size() const { return current; }
+      bool is_settled() const { return settled; }
+      ::std::vector<round_info> const & schedule() const { return rounds; }
+
+      /// the rounds so far, one per line:  size, comm time, compute time, throughput.
+      void print(::std::ostream & os) const {
+        os << "batch_controller: round size " << current << (settled ? " (settled)" : " (probing)")
+           << ", " << rounds.size() << " rounds" << ::std::endl;
+        for (size_t i = 0; i < rounds.size(); ++i) {
+          double t = rounds[i].comm_time + rounds[i].compute_time;
+          os << "  " << i << "\tn=" << rounds[i].size << "\tcomm=" << rounds[i].comm_time
+             << "s\tcompute=" << rounds[i].compute_time << "s\trate=" << ((t > 0.0) ? rounds[i].size / t : 0.0)
+             << "/s" << ::std::endl;
+        }
+      }
+  };
+
+
+  /**
+   * @brief distribute, compute, send back, in rounds sized by a batch_controller.  result matching input in order.
+   * @details  each round takes the next ctl.next() input elements of every rank, distributes them, computes, and sends
+   *           the results back to their place in output.  rounds continue until every rank is done, so ranks with less
+   *           input join with empty slices.  input is not modified, so preserve_input is implied.  i2o, in_buffer and
+   *           out_buffer are per round scratch.  use ctl.print() or ctl.schedule() to see the chosen rounds.
+   */
+  template <typename V, typename ToRank, typename Operation, typename SIZE = size_t,
+      typename T = typename bliss::functional::function_traits<Operation, V>::return_type>
+  void scatter_compute_gather_adaptive(::std::vector<V> const & input, ToRank const & to_rank,
+                              Operation const & op,
+                              ::std::vector<SIZE> & i2o,
+                              ::std::vector<T>& output,
+                              ::std::vector<V>& in_buffer, std::vector<T>& out_buffer,
+                              batch_controller & ctl,
+                              ::mxx::comm const &_comm) {
+      BL_BENCH_INIT(scat_comp_gath_ad);
+      BL_COMM_SCOPE(scatter_compute_gather_adaptive);
+
+      using clock = ::std::chrono::steady_clock;
+
+      if (output.capacity() < input.size()) output.clear();
+      output.resize(input.size());
+
+      // slice and its results, per element sent.  received elements need the same again, scaled by the imbalance.
+      size_t bytes_per_elem = sizeof(V) + sizeof(T) + sizeof(SIZE);
+
+      ::std::vector<V> slice;
+      ::std::vector<T> results;
+      ::std::vector<SIZE> recv_counts;
+      size_t done = 0;
+      while (!::mxx::all_of(done >= input.size(), _comm)) {
+        size_t n = ctl.next(bytes_per_elem);
+        size_t m = ::std::min(n, input.size() - done);
+        slice.assign(input.begin() + done, input.begin() + done + m);
+
+        BL_BENCH_START(scat_comp_gath_ad);
+        auto t0 = clock::now();
+        distribute(slice, to_rank, recv_counts, i2o, in_buffer, _comm, false);
+        auto t1 = clock::now();
+        BL_BENCH_END(scat_comp_gath_ad, "distribute", in_buffer.size());
+
+        BL_BENCH_START(scat_comp_gath_ad);
+        if (out_buffer.capacity() < in_buffer.size()) out_buffer.clear();
+        out_buffer.resize(in_buffer.size());
+        op(in_buffer.begin(), in_buffer.end(), out_buffer.begin());
+        auto t2 = clock::now();
+        BL_BENCH_END(scat_comp_gath_ad, "compute", out_buffer.size());
+
+        BL_BENCH_START(scat_comp_gath_ad);
+        undistribute(out_buffer, recv_counts, i2o, results, _comm, true);
+        auto t3 = clock::now();
+        if (m > 0) ::std::copy(results.begin(), results.begin() + m, output.begin() + done);
+        BL_BENCH_END(scat_comp_gath_ad, "undistribute", m);
+
+        // global values, so all controllers stay in step.
+        double comm_time = ::std::chrono::duration<double>((t1 - t0) + (t3 - t2)).count();
+        double compute_time = ::std::chrono::duration<double>(t2 - t1).count();
+        comm_time = ::mxx::allreduce(comm_time, ::mxx::max<double>(), _comm);
+        compute_time = ::mxx::allreduce(compute_time, ::mxx::max<double>(), _comm);
+        double ratio = ::mxx::allreduce(static_cast<double>(in_buffer.size()) / static_cast<double>(n),
+                                        ::mxx::max<double>(), _comm);
+        bool full = ::mxx::any_of(m == n, _comm);
+        ctl.record(n, comm_time, compute_time, ratio, full);
+
+        done += m;
+      }
+
+      BL_BENCH_REPORT_MPI_NAMED(scat_comp_gath_ad, "imxx:scat_comp_gath_adaptive", _comm);
+  }
+
   // TODO: non-one-to-one version.
 
   /**
@@ -1811,6 +3478,7 @@ namespace imxx
                               ::mxx::comm const &_comm,
                               bool const & preserve_input = false) {
       BL_BENCH_INIT(scat_comp_gath_v);
+      BL_COMM_SCOPE(scatter_compute_gather_v);
 
       // speed over mem use.  mxx all2allv already has to double memory usage. same as stable distribute.
       BL_BENCH_COLLECTIVE_START(scat_comp_gath_v, "empty", _comm);
@@ -1880,6 +3548,200 @@ namespace imxx
       BL_BENCH_REPORT_MPI_NAMED(scat_comp_gath_v, "imxx:scat_comp_gath_v", _comm);
   }
 
+  /**
+   * @brief distribute and compute in rounds, overlapping the communication of round i+1 with the computation on round i.
+   * @details  the input is processed in contiguous batches of at most batch_size elements.  each batch is bucketed
+   *           in place, then sent with a non-blocking all2allv.  while a batch is in flight, op is called on the
+   *           elements received for the previous batch.  results are not sent back, so this is for insert-like operations.
+   *
+   *           all processes iterate the same number of rounds (the max over comm), so batch_size can differ between processes.
+   *           memory overhead is 2 receive buffers, each about p * batch_size in the worst case.
+   *
+   *           op is called as op(begin, end), with iterators into the receive buffer.  op may reorder the range.
+   *
+   * @param input[in|out]   data to distribute.  each batch is permuted in place.
+   * @param batch_size      max number of elements per process per round.
+   * @return  total number of elements received by this process.
+   */
+  template <typename V, typename ToRank, typename Operation, typename SIZE = size_t>
+  size_t distribute_compute_overlap(::std::vector<V>& input, ToRank const & to_rank,
+                              Operation & op, size_t const & batch_size,
+                              ::mxx::comm const &_comm) {
+      BL_BENCH_INIT(dist_comp_overlap);
+      BL_COMM_SCOPE(distribute_compute_overlap);
+
+      BL_BENCH_COLLECTIVE_START(dist_comp_overlap, "empty", _comm);
+      bool empty = input.size() == 0;
+      empty = mxx::all_of(empty);
+      BL_BENCH_END(dist_comp_overlap, "empty", input.size());
+
+      if (empty) {
+        BL_BENCH_REPORT_MPI_NAMED(dist_comp_overlap, "imxx:dist_comp_overlap", _comm);
+        return 0;
+      }
+
+      // same number of rounds for everyone.
+      BL_BENCH_START(dist_comp_overlap);
+      size_t batch = (batch_size == 0) ? input.size() : batch_size;
+      size_t nrounds = (input.size() + batch - 1) / batch;
+      nrounds = ::mxx::allreduce(nrounds, mxx::max<size_t>(), _comm);
+      BL_BENCH_END(dist_comp_overlap, "nrounds", nrounds);
+
+      BL_BENCH_START(dist_comp_overlap);
+      size_t comm_size = _comm.size();
+      std::vector<SIZE> send_counts(comm_size, 0);
+      std::vector<SIZE> recv_counts(comm_size, 0);
+      std::vector<int> send_cnts(comm_size, 0);
+      std::vector<int> send_displs(comm_size, 0);
+      std::vector<int> recv_cnts[2] = { std::vector<int>(comm_size, 0), std::vector<int>(comm_size, 0) };
+      std::vector<int> recv_displs[2] = { std::vector<int>(comm_size, 0), std::vector<int>(comm_size, 0) };
+      std::vector<V> recv_buffer[2];
+      MPI_Request reqs[2];
+      mxx::datatype dt = mxx::get_datatype<V>();
+      BL_BENCH_END(dist_comp_overlap, "alloc", comm_size);
+
+      BL_BENCH_LOOP_START(dist_comp_overlap, 0);
+      BL_BENCH_LOOP_START(dist_comp_overlap, 1);
+      BL_BENCH_LOOP_START(dist_comp_overlap, 2);
+      BL_BENCH_LOOP_START(dist_comp_overlap, 3);
+      size_t sent = 0;
+      size_t received = 0;
+      size_t computed = 0;
+      size_t f, l, total;
+      int curr, prev;
+
+      for (size_t r = 0; r <= nrounds; ++r) {
+        curr = r & 1;
+        prev = 1 - curr;
+
+        // post communication for round r.  send buffer is the bucketed batch in input.
+        if (r < nrounds) {
+          BL_BENCH_LOOP_RESUME(dist_comp_overlap, 0);
+          f = std::min(r * batch, input.size());
+          l = std::min(f + batch, input.size());
+          if (comm_size <= std::numeric_limits<uint8_t>::max()) {
+            imxx::local::bucketing_impl(input, to_rank, static_cast< uint8_t>(comm_size), send_counts, f, l);
+          } else if (comm_size <= std::numeric_limits<uint16_t>::max()) {
+            imxx::local::bucketing_impl(input, to_rank, static_cast<uint16_t>(comm_size), send_counts, f, l);
+          } else {
+            imxx::local::bucketing_impl(input, to_rank, static_cast<uint32_t>(comm_size), send_counts, f, l);
+          }
+          BL_BENCH_LOOP_PAUSE(dist_comp_overlap, 0);
+          sent += l - f;
+
+          BL_BENCH_LOOP_RESUME(dist_comp_overlap, 1);
+          mxx::all2all(send_counts.data(), 1, recv_counts.data(), _comm);
+          total = std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0));
+          assert((std::max(total, l - f) < static_cast<size_t>(mxx::max_int)) && "batch too large for MPI_Ialltoallv");
+
+          for (size_t i = 0; i < comm_size; ++i) {
+            send_cnts[i] = send_counts[i];
+            recv_cnts[curr][i] = recv_counts[i];
+          }
+          send_displs[0] = 0;
+          recv_displs[curr][0] = 0;
+          for (size_t i = 1; i < comm_size; ++i) {
+            send_displs[i] = send_displs[i-1] + send_cnts[i-1];
+            recv_displs[curr][i] = recv_displs[curr][i-1] + recv_cnts[curr][i-1];
+          }
+
+          if (recv_buffer[curr].capacity() < total) recv_buffer[curr].clear();
+          recv_buffer[curr].resize(total);
+
+          MPI_Ialltoallv(const_cast<V*>(input.data() + f), send_cnts.data(), send_displs.data(), dt.type(),
+                         recv_buffer[curr].data(), recv_cnts[curr].data(), recv_displs[curr].data(), dt.type(),
+                         _comm, &reqs[curr]);
+          BL_COMM_RECORD("distribute", sizeof(V), send_counts, recv_counts);
+          BL_BENCH_LOOP_PAUSE(dist_comp_overlap, 1);
+        }
+
+        // compute on round r-1 while round r is in flight.
+        if (r > 0) {
+          BL_BENCH_LOOP_RESUME(dist_comp_overlap, 2);
+          MPI_Wait(&reqs[prev], MPI_STATUS_IGNORE);
+          BL_BENCH_LOOP_PAUSE(dist_comp_overlap, 2);
+          received += recv_buffer[prev].size();
+
+          BL_BENCH_LOOP_RESUME(dist_comp_overlap, 3);
+          op(recv_buffer[prev].begin(), recv_buffer[prev].end());
+          BL_BENCH_LOOP_PAUSE(dist_comp_overlap, 3);
+          computed += recv_buffer[prev].size();
+        }
+      }
+      BL_BENCH_LOOP_END(dist_comp_overlap, 0, "bucket", sent);
+      BL_BENCH_LOOP_END(dist_comp_overlap, 1, "a2av_post", nrounds);
+      BL_BENCH_LOOP_END(dist_comp_overlap, 2, "a2av_wait", received);
+      BL_BENCH_LOOP_END(dist_comp_overlap, 3, "compute", computed);
+
+      BL_BENCH_REPORT_MPI_NAMED(dist_comp_overlap, "imxx:dist_comp_overlap", _comm);
+
+      return received;
+  }
+
+  /**
+   * @brief distribute, keeping the elements this process owns out of the exchange.
+   * @details  input is bucketed in place.  the other processes' buckets go out with MPI_Ialltoallv, and local(begin, end)
+   *           is called on this process's own bucket, in place in input, while the exchange is in flight.  the own bucket
+   *           never goes through the send or receive buffers, so send_counts[rank] and recv_counts[rank] are 0.
+   *
+   *           the wire codecs of wire_all2allv are not used, as with distribute_compute_overlap.
+   *
+   * @param input[in|out]     data to distribute.  bucketed on return.
+   * @param send_counts[out]  number of elements sent to each process.
+   * @param recv_counts[out]  number of elements received from each process.
+   * @param output[out]       received elements, grouped by source process.
+   * @return  number of elements in this process's own bucket.
+   */
+  template <typename V, typename ToRank, typename LocalOp, typename SIZE = size_t>
+  size_t distribute_split_self(::std::vector<V>& input, ToRank const & to_rank,
+                               ::std::vector<SIZE> & send_counts, ::std::vector<SIZE> & recv_counts,
+                               ::std::vector<V> & output, LocalOp & local, ::mxx::comm const & comm) {
+    BL_COMM_SCOPE(distribute_split_self);
+    size_t comm_size = comm.size();
+    int rank = comm.rank();
+
+    if (comm_size <= std::numeric_limits<uint8_t>::max()) {
+      imxx::local::bucketing_impl(input, to_rank, static_cast< uint8_t>(comm_size), send_counts);
+    } else if (comm_size <= std::numeric_limits<uint16_t>::max()) {
+      imxx::local::bucketing_impl(input, to_rank, static_cast<uint16_t>(comm_size), send_counts);
+    } else {
+      imxx::local::bucketing_impl(input, to_rank, static_cast<uint32_t>(comm_size), send_counts);
+    }
+
+    // offsets are of the full bucketed input.  then drop the own bucket from the exchange.
+    std::vector<int> send_cnts(comm_size, 0), send_displs(comm_size, 0);
+    for (size_t i = 0; i < comm_size; ++i) send_cnts[i] = send_counts[i];
+    for (size_t i = 1; i < comm_size; ++i) send_displs[i] = send_displs[i-1] + send_cnts[i-1];
+    size_t self_begin = send_displs[rank];
+    size_t self_size = send_counts[rank];
+    send_counts[rank] = 0;
+    send_cnts[rank] = 0;
+
+    recv_counts.resize(comm_size);
+    counts_all2all(send_counts.data(), 1, recv_counts.data(), comm);
+    size_t total = std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0));
+    assert((std::max(total, input.size()) < static_cast<size_t>(mxx::max_int)) && "too large for MPI_Ialltoallv");
+
+    std::vector<int> recv_cnts(comm_size, 0), recv_displs(comm_size, 0);
+    for (size_t i = 0; i < comm_size; ++i) recv_cnts[i] = recv_counts[i];
+    for (size_t i = 1; i < comm_size; ++i) recv_displs[i] = recv_displs[i-1] + recv_cnts[i-1];
+
+    output.clear();
+    output.resize(total);
+
+    MPI_Request req;
+    mxx::datatype dt = mxx::get_datatype<V>();
+    MPI_Ialltoallv(const_cast<V*>(input.data()), send_cnts.data(), send_displs.data(), dt.type(),
+                   output.data(), recv_cnts.data(), recv_displs.data(), dt.type(), comm, &req);
+    BL_COMM_RECORD("distribute", sizeof(V), send_counts, recv_counts);
+
+    local(input.begin() + self_begin, input.begin() + self_begin + self_size);
+
+    MPI_Wait(&req, MPI_STATUS_IGNORE);
+
+    return self_size;
+  }
+
   //TODO:
 //
 //  /**
@@ -2153,12 +4015,147 @@ namespace imxx
   }
 
 
+  namespace detail {
+
+    /// number of local elements (sorted, on this rank) before the element at index idx of rank r, in (key, rank, index) order.
+    template <typename V, typename _Compare>
+    size_t count_before(::std::vector<V> const & input, _Compare comp, V const & key, int r, size_t idx, int rank) {
+      if (rank == r) return idx;
+      if (rank < r) return ::std::distance(input.begin(), ::std::upper_bound(input.begin(), input.end(), key, comp));
+      return ::std::distance(input.begin(), ::std::lower_bound(input.begin(), input.end(), key, comp));
+    }
+
+  } // namespace detail
+
+
+  /**
+   * @brief  split the locally sorted input into p parts of near equal global size, even with heavily repeated keys.  collective.
+   * @details stable_split needs distinct splitters, so it throws when one key has more than N/p copies.  here the
+   *          elements are ordered by (key, rank, local index), a total order that is the stable global order when the
+   *          local sort is stable.  a splitter is an element instead of a key, so a run of equal keys can span ranks.
+   *
+   *          the splitters are refined with global histograms, as in HykSort and AMS-sort.  target i is global position
+   *          (i+1) * N / p, bracketed by the closest known elements before and after it.  each round, every rank proposes
+   *          the element at the interpolated position of its part of each bracket, the global position of all proposals
+   *          comes from one allreduce of local counts, and the brackets shrink to the closest proposals.  the first round
+   *          is regular sampling.  stops when every target is within tolerance, so each rank receives N/p +- 2 tolerance.
+   *
+   * @param splitters   out: the key of the first element after each split.  empty if p == 1.
+   * @param tolerance   allowed distance of a split from its target.  0 for N / (100 p), i.e. 1% of the average.
+   * @param max_rounds  refinement rounds before settling for the closest split found.
+   * @return send counts.
+   */
+  template <typename V, typename _Compare>
+  std::vector<size_t> balanced_split(::std::vector<V> const & input, _Compare comp,
+                                     ::std::vector<V> & splitters, const mxx::comm& comm,
+                                     size_t tolerance = 0, int max_rounds = 16) {
+    int p = comm.size();
+    int rank = comm.rank();
+    size_t n = input.size();
+    size_t k = p - 1;
+    size_t const none = ::std::numeric_limits<size_t>::max();
+
+    size_t N = ::mxx::allreduce(n, comm);
+    if (tolerance == 0) tolerance = ::std::max(static_cast<size_t>(1), N / (100 * static_cast<size_t>(p)));
+
+    // bracket of each target: global position, local position, and key, of the closest elements before and after.
+    // an element's position is the number of elements before it.  the initial brackets are the ends, which have no key.
+    std::vector<size_t> target(k), lo_g(k, 0), hi_g(k, N), lo_l(k, 0), hi_l(k, n);
+    std::vector<V> lo_key(k), hi_key(k);
+    for (size_t i = 0; i < k; ++i) {
+      target[i] = (i + 1) * N / p;
+    }
+
+    auto done = [&](size_t i) {
+      return ((target[i] - lo_g[i]) <= tolerance) || ((hi_g[i] - target[i]) <= tolerance);
+    };
+
+    std::vector<V> keys(k);
+    std::vector<size_t> idx(k);
+    std::vector<size_t> counts(p * k);
+    for (int round = 0; round < max_rounds; ++round) {
+      bool converged = true;
+      for (size_t i = 0; i < k; ++i) converged &= done(i);
+      if (converged) break;   // same on all ranks, as the brackets are global.
+
+      // propose, for each open target, the local element at the interpolated position within the bracket.
+      for (size_t i = 0; i < k; ++i) {
+        idx[i] = none;
+        if (done(i) || (hi_l[i] <= lo_l[i])) continue;
+        idx[i] = lo_l[i] + static_cast<size_t>(static_cast<double>(hi_l[i] - lo_l[i]) *
+            static_cast<double>(target[i] - lo_g[i]) / static_cast<double>(hi_g[i] - lo_g[i]));
+        idx[i] = ::std::min(idx[i], hi_l[i] - 1);
+        keys[i] = input[idx[i]];
+      }
+      std::vector<V> all_keys = ::mxx::allgather(keys, comm);
+      std::vector<size_t> all_idx = ::mxx::allgather(idx, comm);
+
+      // global position of every proposal.
+      for (int r = 0; r < p; ++r) {
+        for (size_t i = 0; i < k; ++i) {
+          size_t j = r * k + i;
+          counts[j] = (all_idx[j] == none) ? 0 :
+              ::imxx::detail::count_before(input, comp, all_keys[j], r, all_idx[j], rank);
+        }
+      }
+      std::vector<size_t> pos = ::mxx::allreduce(counts, comm);
+
+      // shrink the brackets.
+      for (int r = 0; r < p; ++r) {
+        for (size_t i = 0; i < k; ++i) {
+          size_t j = r * k + i;
+          if (all_idx[j] == none) continue;
+          if ((pos[j] <= target[i]) && (pos[j] > lo_g[i])) {
+            lo_g[i] = pos[j];  lo_l[i] = counts[j];  lo_key[i] = all_keys[j];
+          }
+          if ((pos[j] >= target[i]) && (pos[j] < hi_g[i])) {
+            hi_g[i] = pos[j];  hi_l[i] = counts[j];  hi_key[i] = all_keys[j];
+          }
+        }
+      }
+
+      // a proposal for one target may bound its neighbours better.
+      for (size_t i = 1; i < k; ++i) {
+        if (lo_g[i - 1] > lo_g[i]) {
+          lo_g[i] = lo_g[i - 1];  lo_l[i] = lo_l[i - 1];  lo_key[i] = lo_key[i - 1];
+        }
+      }
+      for (size_t i = k - 1; i > 0; --i) {
+        if (hi_g[i] < hi_g[i - 1]) {
+          hi_g[i - 1] = hi_g[i];  hi_l[i - 1] = hi_l[i];  hi_key[i - 1] = hi_key[i];
+        }
+      }
+    }
+
+    // take the closer end of each bracket, keeping the splits in order.
+    std::vector<size_t> send_counts(p, 0);
+    splitters.resize(k);
+    size_t prev_g = 0, prev_l = 0;
+    for (size_t i = 0; i < k; ++i) {
+      size_t g = lo_g[i], l = lo_l[i];
+      splitters[i] = lo_key[i];
+      if ((hi_g[i] - target[i]) < (target[i] - lo_g[i])) {
+        g = hi_g[i];  l = hi_l[i];  splitters[i] = hi_key[i];
+      }
+      if (g < prev_g) {
+        g = prev_g;  l = prev_l;  splitters[i] = splitters[i - 1];   // i > 0, as prev_g starts at 0.
+      }
+      send_counts[i] = l - prev_l;
+      prev_g = g;
+      prev_l = l;
+    }
+    send_counts[p - 1] = n - prev_l;
+
+    MXX_ASSERT(std::accumulate(send_counts.begin(), send_counts.end(), static_cast<size_t>(0)) == input.size());
+    return send_counts;
+  }
+
+
   /**
    * @brief modified version of mxx::samplesort with some optimizations
    * @details  This version does not attempt to rebalance after parallel sort.
-   *    NOTE: if we want load balance, balance BEFORE calling this routine.
-   *    ASSUMPTION: data is close to uniformly distributed
-   *    ASSUMPTION: where data is not uniformly distributed, sampling results in good enough splits
+   *    the splits come from balanced_split, so each rank receives N/p elements to within about 2%, even when a key
+   *    repeats more than N/p times.  equal keys may then span ranks.
    *
    *    return local splitters
    */
@@ -2185,11 +4182,11 @@ namespace imxx
 
       BL_BENCH_COLLECTIVE_START(imxx_samplesort, "init", comm);
 
-      // perform local (stable) sorting
-      if (_Stable)
+      // perform local (stable) sorting.  radix sort, when the comparator allows it, is stable.
+      if (_Stable && !::fsc::radix_key<_Compare, V>::value)
           std::stable_sort(input.begin(), input.end(), comp);
       else
-          std::sort(input.begin(), input.end(), comp);
+          ::fsc::fast_sort(input, comp);
 
       BL_BENCH_COLLECTIVE_END(imxx_samplesort, "local sort", input.size(), comm);
 
@@ -2215,12 +4212,10 @@ namespace imxx
 
       // sample sort
       // 1. local sort
-      // 2. pick `s` samples regularly spaced on each processor
-      // 3. bitonic sort samples
-      // 4. allgather the last sample of each process -> splitters
-      // 5. locally find splitter positions in data
-      //    //NO (if an identical splitter appears twice, then split evenly)
-      //    => send_counts
+      // 2. propose one element per splitter on each processor, regularly spaced at first
+      // 3. allgather the proposals, allreduce their local counts -> global positions
+      // 4. narrow each splitter to the closest proposals, repeat 2-4 until within tolerance
+      // 5. the local positions of the splitters => send_counts
       // 6. distribute send_counts with all2all to get recv_counts
       // 7. allocate enough space (may be more than previously allocated) for receiving
       // 8. all2allv
@@ -2228,26 +4223,10 @@ namespace imxx
       // A. equalizing distribution into original size (e.g.,block decomposition)
       //    by sending elements to neighbors
 
-      // get splitters, using the method depending on whether the input consists
-      // of arbitrary decompositions or not
+      // 2-5. in (key, rank, index) order, so runs of equal keys can be split across ranks.
       std::vector<V> local_splitters;
-      // number of samples
-      size_t s = p-1;
-      if(_AssumeBlockDecomp)
-          local_splitters = ::mxx::impl::sample_block_decomp(input.cbegin(), input.cend(), comp, s, comm);
-      else
-          local_splitters = ::mxx::impl::sample_arbit_decomp(input.cbegin(), input.cend(), comp, s, comm);
-
-      BL_BENCH_END(imxx_samplesort, "get_splitters", s);
-
-      BL_BENCH_START(imxx_samplesort);
-
-
-      // 5. locally find splitter positions in data
-      //    (if an identical splitter appears at least three times (or more),
-      //    then split the intermediary buckets evenly) => send_counts
-      std::vector<size_t> send_counts = imxx::stable_split(input, comp, local_splitters, comm);  // always do stable split
-      BL_BENCH_END(imxx_samplesort, "send_counts", send_counts.size());
+      std::vector<size_t> send_counts = imxx::balanced_split(input, comp, local_splitters, comm);
+      BL_BENCH_END(imxx_samplesort, "balanced_split", send_counts.size());
 
       BL_BENCH_START(imxx_samplesort);
 
@@ -2266,6 +4245,7 @@ namespace imxx
 
       // TODO: use collective with iterators [begin,end) instead of pointers!
       ::mxx::all2allv(input.data(), send_counts, output.data(), recv_counts, comm);
+      BL_COMM_RECORD("samplesort", sizeof(V), send_counts, recv_counts);
       BL_BENCH_END(imxx_samplesort, "all2all", local_size);
 
       BL_BENCH_START(imxx_samplesort);
@@ -2390,11 +4370,9 @@ namespace imxx
 
       } else
   #endif
-      { // sorting based.
-          if (_Stable)
-              std::stable_sort(output.begin(), output.end(), comp);
-          else
-              std::sort(output.begin(), output.end(), comp);
+      { // merge the sorted runs from each rank.  stable.
+          std::vector<V> merge_buf;
+          ::fsc::multiway_merge(output, recv_counts, comp, merge_buf);
       }
       } // p > 2
 
@@ -2421,9 +4399,8 @@ namespace imxx
   /**
    * @brief modified version of mxx::samplesort with some optimizations
    * @details  This version does not attempt to rebalance after parallel sort.
-   *    NOTE: if we want load balance, balance BEFORE calling this routine.
-   *    ASSUMPTION: data is close to uniformly distributed
-   *    ASSUMPTION: where data is not uniformly distributed, sampling results in good enough splits
+   *    the splits come from balanced_split, so each rank receives N/p elements to within about 2%, even when a key
+   *    repeats more than N/p times.  equal keys may then span ranks.
    *
    *    return local splitters
    */
@@ -2477,12 +4454,10 @@ namespace imxx
 
       // sample sort
       // 1. local sort
-      // 2. pick `s` samples regularly spaced on each processor
-      // 3. bitonic sort samples
-      // 4. allgather the last sample of each process -> splitters
-      // 5. locally find splitter positions in data
-      //    //NO (if an identical splitter appears twice, then split evenly)
-      //    => send_counts
+      // 2. propose one element per splitter on each processor, regularly spaced at first
+      // 3. allgather the proposals, allreduce their local counts -> global positions
+      // 4. narrow each splitter to the closest proposals, repeat 2-4 until within tolerance
+      // 5. the local positions of the splitters => send_counts
       // 6. distribute send_counts with all2all to get recv_counts
       // 7. allocate enough space (may be more than previously allocated) for receiving
       // 8. all2allv
@@ -2490,26 +4465,10 @@ namespace imxx
       // A. equalizing distribution into original size (e.g.,block decomposition)
       //    by sending elements to neighbors
 
-      // get splitters, using the method depending on whether the input consists
-      // of arbitrary decompositions or not
+      // 2-5. in (key, rank, index) order, so runs of equal keys can be split across ranks.
       std::vector<V> local_splitters;
-      // number of samples
-      size_t s = p-1;
-      if(_AssumeBlockDecomp)
-          local_splitters = ::mxx::impl::sample_block_decomp(input.cbegin(), input.cend(), comp, s, comm);
-      else
-          local_splitters = ::mxx::impl::sample_arbit_decomp(input.cbegin(), input.cend(), comp, s, comm);
-
-      BL_BENCH_END(imxx_samplesort, "get_splitters", s);
-
-      BL_BENCH_START(imxx_samplesort);
-
-
-      // 5. locally find splitter positions in data
-      //    (if an identical splitter appears at least three times (or more),
-      //    then split the intermediary buckets evenly) => send_counts
-      std::vector<size_t> send_counts = imxx::stable_split(input, comp, local_splitters, comm);  // always do stable split
-      BL_BENCH_END(imxx_samplesort, "send_counts", send_counts.size());
+      std::vector<size_t> send_counts = imxx::balanced_split(input, comp, local_splitters, comm);
+      BL_BENCH_END(imxx_samplesort, "balanced_split", send_counts.size());
 
       BL_BENCH_START(imxx_samplesort);
 
@@ -2577,6 +4536,7 @@ namespace imxx
         ::mxx::all2allv(input.data(), send_counts, output.data(), recv_counts, comm);
       else
         ::mxx::all2allv(input.data(), send_counts, buf, recv_counts, comm);
+      BL_COMM_RECORD("samplesort", sizeof(V), send_counts, recv_counts);
 
       BL_BENCH_END(imxx_samplesort, "all2all", local_size);
 
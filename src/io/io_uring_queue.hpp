@@ -0,0 +1,202 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    io_uring_queue.hpp
+ * @ingroup io
+ * @author  tpan
+ * @brief   minimal io_uring submission/completion queue for reads, using the raw syscalls.
+ * @details only what uring_file needs: READ and READ_FIXED submissions, buffer registration, and completion reaping.
+ *          talks to the kernel directly through linux/io_uring.h so there is no liburing dependency.
+ *          not thread safe.  use one queue per thread.
+ */
+#ifndef SRC_IO_IO_URING_QUEUE_HPP_
+#define SRC_IO_IO_URING_QUEUE_HPP_
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>  // __NR_io_uring_*
+#include <sys/mman.h>     // mmap
+#include <sys/uio.h>      // iovec
+#include <unistd.h>       // syscall, close
+#include <cerrno>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>        // memset, strerror
+#include <sstream>
+
+#include "io/io_exception.hpp"
+#include "utils/exception_handling.hpp"
+
+namespace bliss {
+  namespace io {
+
+    /// io_uring with a single submission and completion queue.
+    class io_uring_queue {
+      protected:
+        int ring_fd;
+
+        // mapped regions
+        void * sq_ptr;
+        size_t sq_len;
+        void * cq_ptr;
+        size_t cq_len;
+        struct io_uring_sqe * sqes;
+        size_t sqes_len;
+
+        // submission queue ring
+        unsigned * sq_head;
+        unsigned * sq_tail;
+        unsigned * sq_mask;
+        unsigned * sq_array;
+        unsigned sq_entries;
+
+        // completion queue ring
+        unsigned * cq_head;
+        unsigned * cq_tail;
+        unsigned * cq_mask;
+        struct io_uring_cqe * cqes;
+
+        /// number of sqes filled but not yet submitted
+        unsigned to_submit;
+
+        void throw_error(char const * op, int err) {
+          ::std::stringstream ss;
+          ss << "ERROR: io_uring " << op << " error " << err << ": " << strerror(err);
+          throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+        }
+
+        void release() {
+          if (sqes != nullptr) munmap(sqes, sqes_len);
+          if (cq_ptr != nullptr) munmap(cq_ptr, cq_len);
+          if (sq_ptr != nullptr) munmap(sq_ptr, sq_len);
+          if (ring_fd >= 0) close(ring_fd);
+          sqes = nullptr; cq_ptr = nullptr; sq_ptr = nullptr; ring_fd = -1;
+        }
+
+      public:
+        /**
+         * @brief  set up a ring.
+         * @throws IOException if the kernel does not support io_uring or the call is not permitted.
+         */
+        explicit io_uring_queue(unsigned const & entries) :
+          ring_fd(-1), sq_ptr(nullptr), sq_len(0), cq_ptr(nullptr), cq_len(0), sqes(nullptr), sqes_len(0),
+          sq_head(nullptr), sq_tail(nullptr), sq_mask(nullptr), sq_array(nullptr), sq_entries(0),
+          cq_head(nullptr), cq_tail(nullptr), cq_mask(nullptr), cqes(nullptr), to_submit(0) {
+
+          struct io_uring_params p;
+          memset(&p, 0, sizeof(p));
+
+          ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+          if (ring_fd < 0) throw_error("setup", errno);
+
+          sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+          cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+          sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+
+          sq_ptr = mmap(nullptr, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+          if (sq_ptr == MAP_FAILED) { sq_ptr = nullptr; int err = errno; release(); throw_error("mmap sq", err); }
+          cq_ptr = mmap(nullptr, cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+          if (cq_ptr == MAP_FAILED) { cq_ptr = nullptr; int err = errno; release(); throw_error("mmap cq", err); }
+          void * s = mmap(nullptr, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+          if (s == MAP_FAILED) { int err = errno; release(); throw_error("mmap sqes", err); }
+          sqes = reinterpret_cast<struct io_uring_sqe *>(s);
+
+          unsigned char * sq = reinterpret_cast<unsigned char *>(sq_ptr);
+          sq_head  = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+          sq_tail  = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+          sq_mask  = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+          sq_array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+          sq_entries = p.sq_entries;
+
+          unsigned char * cq = reinterpret_cast<unsigned char *>(cq_ptr);
+          cq_head = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+          cq_tail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+          cq_mask = reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+          cqes    = reinterpret_cast<struct io_uring_cqe *>(cq + p.cq_off.cqes);
+        }
+
+        ~io_uring_queue() { release(); }
+
+        io_uring_queue(io_uring_queue const &) = delete;
+        io_uring_queue & operator=(io_uring_queue const &) = delete;
+
+        /// number of submission entries.
+        unsigned size() const { return sq_entries; }
+
+        /// register buffers for READ_FIXED.  returns 0 or -errno (e.g. -ENOMEM if over RLIMIT_MEMLOCK).
+        int register_buffers(struct iovec const * iovs, unsigned const & n) {
+          int res = static_cast<int>(syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_BUFFERS, iovs, n));
+          return (res < 0) ? -errno : res;
+        }
+
+        /**
+         * @brief  queue a read.  call submit to hand to kernel.
+         * @param buf_index   registered buffer index for READ_FIXED, or -1 for plain READ.
+         * @return false if the submission queue is full.
+         */
+        bool push_read(int const & fd, void * buf, unsigned const & len, size_t const & offset,
+                       uint64_t const & user_data, int const & buf_index = -1) {
+          unsigned tail = *sq_tail;
+          unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+          if ((tail - head) >= sq_entries) return false;
+
+          unsigned idx = tail & *sq_mask;
+          struct io_uring_sqe * sqe = &(sqes[idx]);
+          memset(sqe, 0, sizeof(struct io_uring_sqe));
+          sqe->opcode = (buf_index < 0) ? IORING_OP_READ : IORING_OP_READ_FIXED;
+          sqe->fd = fd;
+          sqe->off = offset;
+          sqe->addr = reinterpret_cast<uint64_t>(buf);
+          sqe->len = len;
+          sqe->buf_index = (buf_index < 0) ? 0 : buf_index;
+          sqe->user_data = user_data;
+
+          sq_array[idx] = idx;
+          __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+          ++to_submit;
+          return true;
+        }
+
+        /// submit queued sqes and wait for at least min_complete completions.
+        void submit(unsigned const & min_complete = 0) {
+          unsigned flags = (min_complete > 0) ? IORING_ENTER_GETEVENTS : 0;
+          while (true) {
+            int res = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+            if (res >= 0) {
+              to_submit -= ::std::min(to_submit, static_cast<unsigned>(res));
+              return;
+            }
+            if (errno != EINTR) throw_error("enter", errno);
+          }
+        }
+
+        /// get a completion if available.  returns false if the completion queue is empty.
+        bool pop(uint64_t & user_data, int & res) {
+          unsigned head = *cq_head;
+          if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) return false;
+
+          struct io_uring_cqe const & cqe = cqes[head & *cq_mask];
+          user_data = cqe.user_data;
+          res = cqe.res;
+          __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+          return true;
+        }
+    };
+
+  } // namespace io
+} // namespace bliss
+
+#endif /* SRC_IO_IO_URING_QUEUE_HPP_ */
@@ -42,23 +42,36 @@
 #include "mpi.h"
 #endif
 
-//#if defined(USE_OPENMP)
-//#include "omp.h"
-//#endif
+#if defined(USE_OPENMP)
+#include "omp.h"
+#endif
 
 #include <unistd.h>     // sysconf
 #include <sys/stat.h>   // block size.
 #include <tuple>        // tuple and utility functions
 #include <utility>      // pair and utility functions.
+#include <atomic>
+#include <algorithm>    // count_if
 #include <type_traits>
 #include <cctype>       // tolower.
 
 #include "io/file.hpp"
 #include "io/fastq_loader.hpp"
 #include "io/fasta_loader.hpp"
+#include "io/prefetch_reader.hpp"
+#include "io/streaming_kmer_parser.hpp"
+#include "io/file_manifest.hpp"
+#include "common/packed_sequence_arena.hpp"
+#include "io/packed_read_store.hpp"
+#include "io/twobit_file.hpp"
+#include "io/object_file.hpp"
+#if defined(USE_ZLIB)
+#include "io/gzip_file.hpp"
+#endif
 //#include "io/fasta_iterator.hpp"
 
 #include "iterators/container_concatenating_iterator.hpp"
+#include "partition/partitioner.hpp"
 
 #include "utils/logging.h"
 #include "utils/file_utils.hpp"
@@ -77,6 +90,7 @@
 
 #include "utils/benchmark_utils.hpp"
 #include "utils/file_utils.hpp"
+#include "utils/stage_pipeline.hpp"
 
 #include <fstream> // debug only
 #include <iostream>  // debug only
@@ -97,6 +111,106 @@ namespace io
 struct KmerFileHelper {
 
 
+  /**
+   * @brief  generate kmers or kmer tuples for 1 sequence of a block, trimming FASTA sequences that extend into the overlap region.
+   * @return true if the sequence should be counted as belonging to this block.
+   */
+  template <typename SeqParserType, typename BlockType, typename SeqType, typename KmerParserType, typename OutputIter>
+  static bool parse_sequence(BlockType const & partition, SeqType & seq,
+                             KmerParserType & kmer_parser, OutputIter & emplace_iter) {
+    if (seq.seq_size() == 0) return false;
+
+    size_t start_offset = seq.seq_global_offset();
+
+    // if seq data starts outside of valid, then skip
+    if (start_offset >= partition.valid_range_bytes.end) return false;
+
+    // check if last.  if yes, and seqParser is a FASTAParser, then inspect and change if needed
+    if (::std::is_same<SeqParserType, ::bliss::io::FASTAParser<typename BlockType::const_iterator> >::value) {
+      // if seq data ends in overlap region, then go at most k-1 characters from end of valid range.
+      if ((start_offset + seq.seq_size()) >= partition.valid_range_bytes.end) {
+        ::bliss::utils::file::NotEOL not_eol;
+
+        // scan for k-1 characters, from the valid range end.
+        auto endd = seq.seq_begin + (partition.valid_range_bytes.end - start_offset);
+        size_t steps = KmerParserType::window_size - 1;
+        size_t count = 0;
+
+        // iterate and find the windows size - 1 chars in overlap, starting from valid end.  should be less than current seq end.
+        while ((endd != seq.seq_end) && (count < steps)) {
+          if (not_eol(*endd)) {
+            ++count;
+          }
+
+          ++endd;
+        }
+
+        seq.seq_end = endd;
+      }
+    }
+
+    emplace_iter = kmer_parser(seq, emplace_iter);
+
+    return ((seq.seq_offset == seq.seq_begin_offset) ||
+        (start_offset >= partition.valid_range_bytes.start));
+  }
+
+  /**
+   * @brief  stands in for a KmerParser in parse_sequence, and counts the k-mers that KmerParser would generate.
+   * @details  a read with n non-EOL characters in its valid range gives n - k + 1 k-mers, or none if n < k.
+   *      for a parser with a window other than k, or more than 1 k-mer per window position, see kmer_counter.
+   */
+  template <typename KmerType, size_t Window = KmerType::size, size_t PerWindow = 1>
+  struct KmerCounter {
+      static constexpr size_t window_size = Window;
+
+      ::bliss::partition::range<size_t> valid_range;
+
+      KmerCounter(::bliss::partition::range<size_t> const & _valid_range) : valid_range(_valid_range) {}
+
+      /// returns count plus the number of k-mers in read.
+      template <typename SeqType>
+      size_t operator()(SeqType const & read, size_t const & count) const {
+        typename SeqType::IteratorType seq_begin;
+        typename SeqType::IteratorType seq_end;
+        bool has_window = false;
+
+        ::std::tie(seq_begin, seq_end, has_window) =
+            ::bliss::index::kmer::KmerParser<KmerType>::get_valid_iterator_range(read, valid_range, window_size);
+        if (!has_window) return count;
+
+        size_t n = ::std::count_if(seq_begin, seq_end, ::bliss::utils::file::NotEOL());
+        return count + (n - window_size + 1) * PerWindow;
+      }
+  };
+
+  /// KmerCounter for a KmerParser type.
+  template <typename KmerParser>
+  struct kmer_counter {
+      using type = KmerCounter<typename KmerParser::kmer_type>;
+  };
+  template <typename KmerType>
+  struct kmer_counter<::bliss::index::kmer::TranslatedKmerParser<KmerType> > {
+      using Parser = ::bliss::index::kmer::TranslatedKmerParser<KmerType>;
+      using type = KmerCounter<KmerType, Parser::window_size, Parser::kmers_per_window>;
+  };
+
+  /**
+   * @brief  exact number of k-mers that parse_sequence generates from the reads in [seqs_start, seqs_end).
+   * @details  walks the records once without generating, so the output can be reserved to its final size and
+   *      does not reallocate (and copy) while it is filled.
+   */
+  template <typename KmerParser, typename SeqParserType, typename BlockType, typename SeqIter>
+  static size_t count_kmers(BlockType const & partition, SeqIter seqs_start, SeqIter const & seqs_end) {
+    typename kmer_counter<KmerParser>::type counter(partition.valid_range_bytes);
+    size_t count = 0;
+    for (; seqs_start != seqs_end; ++seqs_start) {
+      auto seq = *seqs_start;
+      parse_sequence<SeqParserType>(partition, seq, counter, count);
+    }
+    return count;
+  }
+
   /**
    * @brief  generate kmers or kmer tuples for 1 block of raw data.
    * @note   requires that SeqParser be passed in and operates on the Block's Iterators.
@@ -119,7 +233,6 @@ struct KmerFileHelper {
 
     //== sequence parser type
     KmerParser kmer_parser(partition.valid_range_bytes);
-    ::bliss::utils::file::NotEOL not_eol;
 
     //== process the chunk of data
 
@@ -127,6 +240,9 @@ struct KmerFileHelper {
     SeqIterType<CharIterType, SeqParser> seqs_start(seq_parser, partition.cbegin(), partition.in_mem_cend(), partition.getRange().start);
     SeqIterType<CharIterType, SeqParser> seqs_end(partition.in_mem_cend());
 
+    //== size the output exactly.
+    result.reserve(result.size() + count_kmers<KmerParser, SeqParser<CharIterType> >(partition, seqs_start, seqs_end));
+
     ::fsc::back_emplace_iterator<std::vector<typename KmerParser::value_type> > emplace_iter(result);
 
     size_t before = result.size();
@@ -136,51 +252,115 @@ struct KmerFileHelper {
     for (; seqs_start != seqs_end; ++seqs_start)
     {
       auto seq = *seqs_start;
-      if (seq.seq_size() == 0) continue;
-      //      std::cout << "** seq: " << (*seqs_start).id.id << ", ";
-      //      ostream_iterator<typename std::iterator_traits<typename SeqType::IteratorType>::value_type> osi(std::cout);
-      //      std::copy((*seqs_start).seq_begin, (*seqs_start).seq_end, osi);
-      //      std::cout << std::endl;
+      if (parse_sequence<SeqParser<CharIterType> >(partition, seq, kmer_parser, emplace_iter)) ++seqs;
+    }
 
-      size_t start_offset = seq.seq_global_offset();
+    //std::cout << "number of sequences " << seqs << " number of total entries " << result.size() << " before insertion " << before << std::endl;
 
-      // if seq data starts outside of valid, then skip
-      if (start_offset >= partition.valid_range_bytes.end) {
-        continue;
-      }
+    return std::make_pair(seqs, result.size() - before);
+  }
 
-      // check if last.  if yes, and seqParser is a FASTAParser, then inspect and change if needed
-      if (::std::is_same<SeqParser<CharIterType>, ::bliss::io::FASTAParser<CharIterType> >::value) {
-        // if seq data ends in overlap region, then go at most k-1 characters from end of valid range.
-        if ((start_offset + seq.seq_size()) >= partition.valid_range_bytes.end) {
-          // scan for k-1 characters, from the valid range end.
-          auto endd = seq.seq_begin + (partition.valid_range_bytes.end - start_offset);
-          size_t steps = KmerParser::window_size - 1;
-          size_t count = 0;
-
-          // iterate and find the windows size - 1 chars in overlap, starting from valid end.  should be less than current seq end.
-          while ((endd != seq.seq_end) && (count < steps)) {
-            if (not_eol(*endd)) {
-              ++count;
-            }
 
-            ++endd;
-          }
+  /**
+   * @brief  stands in for a KmerParser in parse_sequence, so that the same trimming and counting applies.
+   *      packs the part of each read that KmerParser would generate k-mers from into a PackedSequenceArena,
+   *      or a PackedReadStore, which also keeps the read ids.
+   */
+  template <typename KmerType, typename Arena>
+  struct SequencePacker {
+      static constexpr size_t window_size = KmerType::size;
 
+      Arena & arena;
+      ::bliss::partition::range<size_t> valid_range;
 
-          seq.seq_end = endd;
-        }
+      SequencePacker(Arena & _arena, ::bliss::partition::range<size_t> const & _valid_range) :
+        arena(_arena), valid_range(_valid_range) {}
+
+      /// pack 1 read.  returns count + 1 if the read was long enough to be packed.
+      template <typename SeqType>
+      size_t operator()(SeqType const & read, size_t const & count) {
+        typename SeqType::IteratorType seq_begin;
+        typename SeqType::IteratorType seq_end;
+        bool has_window = false;
+
+        ::std::tie(seq_begin, seq_end, has_window) =
+            ::bliss::index::kmer::KmerParser<KmerType>::get_valid_iterator_range(read, valid_range, window_size);
+        if (!has_window) return count;
+
+        append(arena, read, seq_begin, seq_end, read.seq_global_offset() + ::std::distance(read.seq_begin, seq_begin));
+        return count + 1;
+      }
+
+    protected:
+      template <typename A, typename SeqType, typename Iter>
+      static void append(A & a, SeqType const & read, Iter begin, Iter end, size_t const & offset) {
+        a.append(begin, end, offset);
+      }
+      template <typename ALPHABET, typename SeqType, typename Iter>
+      static void append(::bliss::io::PackedReadStore<ALPHABET> & a, SeqType const & read, Iter begin, Iter end, size_t const & offset) {
+        a.append(begin, end, offset, read.id, window_size);
       }
+  };
+
+  /**
+   * @brief  pack the reads of 1 block of raw data into arena, trimmed as KmerParser<KmerType> would.
+   * @tparam Arena       PackedSequenceArena or PackedReadStore of the k-mer's alphabet.
+   * @return number of reads in the block.
+   */
+  template <typename KmerType, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType,
+            typename BlockType, typename Arena>
+  static size_t pack_block(BlockType const & partition,
+      SeqParser<typename BlockType::iterator> const &seq_parser,
+      Arena & arena) {
+
+    // from FileLoader type, get the block iter type and range type
+    using CharIterType = typename BlockType::const_iterator;
 
-      emplace_iter = kmer_parser(seq, emplace_iter);
-      if ((seq.seq_offset == seq.seq_begin_offset) ||
-          (start_offset >= partition.valid_range_bytes.start)) ++seqs;
+    SequencePacker<KmerType, Arena> packer(arena, partition.valid_range_bytes);
+
+    //==  and wrap the chunk inside an iterator that emits Reads.
+    SeqIterType<CharIterType, SeqParser> seqs_start(seq_parser, partition.cbegin(), partition.in_mem_cend(), partition.getRange().start);
+    SeqIterType<CharIterType, SeqParser> seqs_end(partition.in_mem_cend());
 
-      //      std::cout << "Last: pos - kmer " << result.back() << std::endl;
+    size_t packed = 0;
+    size_t seqs = 0;
 
+    //== loop over the reads and pack
+    for (; seqs_start != seqs_end; ++seqs_start)
+    {
+      auto seq = *seqs_start;
+      if (parse_sequence<SeqParser<CharIterType> >(partition, seq, packer, packed)) ++seqs;
     }
+    return seqs;
+  }
 
-    //std::cout << "number of sequences " << seqs << " number of total entries " << result.size() << " before insertion " << before << std::endl;
+  /**
+   * @brief  generate kmers for 1 block of raw data by first packing the reads into arena, then generating from the packed reads.
+   * @details  each read's bases are written to arena as the records are found, and k-mers are generated by
+   *      PackedKmerGenerationIterator, so the ASCII is scanned once.  arena is appended to and is kept for the caller,
+   *      e.g. to build other indices from the same reads without reparsing.  the k-mers produced are the same as read_block_old.
+   * @tparam KmerParser  has to be KmerParser<KmerType>, i.e. k-mers only.
+   * @tparam Arena       PackedSequenceArena of the k-mer's alphabet.
+   */
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType,
+            typename BlockType, typename Arena>
+  static std::pair<size_t, size_t> read_block_packed(BlockType const & partition,
+      SeqParser<typename BlockType::iterator> const &seq_parser,
+      Arena & arena,
+      std::vector<typename KmerParser::value_type>& result) {
+
+    using KmerType = typename KmerParser::kmer_type;
+    static_assert(::std::is_same<KmerParser, ::bliss::index::kmer::KmerParser<KmerType> >::value,
+                  "packed parsing only generates k-mers.");
+
+    size_t first = arena.size();
+    size_t seqs = pack_block<KmerType, SeqParser, SeqIterType>(partition, seq_parser, arena);
+
+    //== then generate from the packed reads, into exactly sized output.
+    result.reserve(result.size() + arena.template num_kmers<KmerType>(first));
+    ::fsc::back_emplace_iterator<std::vector<typename KmerParser::value_type> > emplace_iter(result);
+    size_t before = result.size();
+    arena.template generate<KmerType>(emplace_iter, first);
 
     return std::make_pair(seqs, result.size() - before);
   }
@@ -205,15 +385,18 @@ struct KmerFileHelper {
     SeqIterType<CharIterType, SeqParser> seqs_start(seq_parser, partition.cbegin(), partition.in_mem_cend(), partition.getRange().start);
     SeqIterType<CharIterType, SeqParser> seqs_end(partition.in_mem_cend());
 
-    ::fsc::back_emplace_iterator<std::vector<typename KmerParser::value_type> > emplace_iter(result);
-
     size_t before = result.size();
     size_t seqs = 0;
 
+    // the concatenating iterator does not trim FASTA sequences, so count each read as is.
+    typename kmer_counter<KmerParser>::type counter(partition.valid_range_bytes);
+    size_t nkmers = 0;
+
     //== loop over the reads and count the good ones.  TODO: DO WE REALLY NEED TO DO THIS? WHERE IS IT USED?
     for (auto it = seqs_start; it != seqs_end; ++it)
     {
         auto seq = *it;
+        nkmers = counter(seq, nkmers);
 
         // if a sequence is chopped up, count only the starting ones, or the ones that starts after the partition's valid ranges
 //        if ((seq.seq_offset == seq.seq_begin_offset) ||
@@ -235,12 +418,127 @@ struct KmerFileHelper {
 	Iter concat_start(kmer_parser, seqs_start, seqs_end);
 	Iter concat_end(kmer_parser, seqs_end);
 
+    //== size the output exactly.
+    result.reserve(before + nkmers);
+    ::fsc::back_emplace_iterator<std::vector<typename KmerParser::value_type> > emplace_iter(result);
+
 	std::copy(concat_start, concat_end, emplace_iter);
 
     return std::make_pair(seqs, result.size() - before);
   }
 
 
+  /**
+   * @brief  generate kmers or kmer tuples for 1 block of raw data using multiple OpenMP threads.
+   * @details  the block's valid range is cut into up to chunks_per_thread * nthreads byte ranges of at least 4KB,
+   *      each moved forward to the next record start using the parser's record boundary search (find_first_record).
+   *      chunks are handed to threads by a WorkStealingPartitioner:  each thread starts on its own contiguous block of
+   *      chunks (the same block split as mmap_policy::numa_threads placement), and takes chunks from the nearest other
+   *      threads once its own are done, so threads stay busy when records differ a lot in length.
+   *      each chunk is walked with its own SequencesIterator and a per thread KmerParser into a per chunk buffer.
+   *      the buffers are appended to result in parallel, in chunk order, so the output order is the same as read_block_old.
+   *
+   *      only FASTQ is split, since FASTQ records can be found without context.  FASTA (which needs the sequence headers
+   *      found by the collective init_parser), nthreads <= 1, or builds without USE_OPENMP use read_block_old.
+   * @note   seq_parser must have been initialized via init_parser.
+   */
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename BlockType>
+  static std::pair<size_t, size_t> read_block_omp(BlockType const & partition,
+      SeqParser<typename BlockType::iterator> const &seq_parser,
+      std::vector<typename KmerParser::value_type>& result, int nthreads) {
+
+    using CharIterType = typename BlockType::const_iterator;
+    using RangeType = typename BlockType::range_type;
+
+#if defined(USE_OPENMP)
+    if ((nthreads > 1) && ::std::is_same<SeqParser<CharIterType>, ::bliss::io::FASTQParser<CharIterType> >::value &&
+        (partition.getRange().size() > static_cast<size_t>(nthreads) * 4096)) {
+
+      RangeType valid = partition.getRange();
+
+      // enough chunks for load balancing, but at least a few pages each.
+      constexpr size_t chunks_per_thread = 16;
+      size_t nchunks = ::std::min(static_cast<size_t>(nthreads) * chunks_per_thread, valid.size() / 4096);
+
+      //== find record aligned starting points.  serial, since find_first_record may throw.
+      ::std::vector<size_t> starts(nchunks + 1, valid.end);
+      starts[0] = valid.start;
+      {
+        SeqParser<CharIterType> boundary_parser(seq_parser);
+        for (size_t c = 1; c < nchunks; ++c) {
+          size_t cut = valid.start + (valid.size() * c) / nchunks;
+          try {
+            starts[c] = boundary_parser.find_first_record(partition.in_mem_cbegin(), partition.parent_range_bytes,
+                                                          partition.in_mem_range_bytes, RangeType(cut, partition.in_mem_range_bytes.end));
+          } catch (::std::logic_error const &) {
+            // cut is inside the last record.  remaining chunks get nothing.
+            starts[c] = valid.end;
+          }
+          starts[c] = ::std::min(::std::max(starts[c], starts[c - 1]), valid.end);
+        }
+      }
+
+      ::std::vector<::std::vector<typename KmerParser::value_type> > buffers(nchunks);
+      ::std::vector<size_t> seqs(nchunks, 0);
+
+      ::bliss::partition::WorkStealingPartitioner<::bliss::partition::range<size_t> > scheduler;
+      scheduler.configure(::bliss::partition::range<size_t>(0, nchunks), nthreads, 1);
+
+#pragma omp parallel num_threads(nthreads)
+      {
+        int t = omp_get_thread_num();
+
+        KmerParser kmer_parser(partition.valid_range_bytes);
+        SeqParser<CharIterType> parser(seq_parser);
+
+        for (::bliss::partition::range<size_t> r = scheduler.getNext(t); r.size() > 0; r = scheduler.getNext(t)) {
+          size_t c = r.start;
+
+          // last chunk goes to end of in memory data, as read_block_old does, to include the overlap.
+          CharIterType b = partition.cbegin() + (starts[c] - valid.start);
+          CharIterType e = (c == (nchunks - 1)) ? partition.in_mem_cend() : partition.cbegin() + (starts[c + 1] - valid.start);
+
+          if ((starts[c] < starts[c + 1]) || (c == (nchunks - 1))) {
+            SeqIterType<CharIterType, SeqParser> seqs_start(parser, b, e, starts[c]);
+            SeqIterType<CharIterType, SeqParser> seqs_end(e);
+
+            ::std::vector<typename KmerParser::value_type> & buffer = buffers[c];
+            buffer.reserve(count_kmers<KmerParser, SeqParser<CharIterType> >(partition, seqs_start, seqs_end));
+            ::fsc::back_emplace_iterator<std::vector<typename KmerParser::value_type> > emplace_iter(buffer);
+
+            for (; seqs_start != seqs_end; ++seqs_start) {
+              auto seq = *seqs_start;
+              if (parse_sequence<SeqParser<CharIterType> >(partition, seq, kmer_parser, emplace_iter)) ++seqs[c];
+            }
+          }
+        }
+      }
+
+      //== append to result in chunk order.
+      size_t before = result.size();
+      ::std::vector<size_t> offsets(nchunks + 1, before);
+      for (size_t c = 0; c < nchunks; ++c) {
+        offsets[c + 1] = offsets[c] + buffers[c].size();
+      }
+      result.resize(offsets[nchunks]);
+
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1)
+      for (size_t c = 0; c < nchunks; ++c) {
+        ::std::move(buffers[c].begin(), buffers[c].end(), result.begin() + offsets[c]);
+        ::std::vector<typename KmerParser::value_type>().swap(buffers[c]);
+      }
+
+      size_t nseqs = 0;
+      for (size_t c = 0; c < nchunks; ++c) nseqs += seqs[c];
+
+      return std::make_pair(nseqs, result.size() - before);
+    }
+#endif
+
+    return read_block_old<KmerParser, SeqParser, SeqIterType>(partition, seq_parser, result);
+  }
+
+
   /**
    * @brief initialize the sequence parser, estimate capacity and reserver, and then call read_block to parse the actual data.
    */
@@ -249,8 +547,6 @@ struct KmerFileHelper {
                          std::vector<typename KmerParser::value_type>& result) {
       std::pair<size_t, size_t> read = {0, 0};
 
-     constexpr int kmer_size = KmerParser::window_size;
-
       BL_BENCH_INIT(file);
       {
         // not reusing the SeqParser in loader.  instead, reinitializing one.
@@ -259,19 +555,7 @@ struct KmerFileHelper {
         seq_parser.init_parser(partition.in_mem_cbegin(), partition.parent_range_bytes, partition.in_mem_range_bytes, partition.getRange());
         BL_BENCH_END(file, "mark_seqs", partition.getRange().size());
 
-        //== reserve
-        BL_BENCH_START(file);
-        // modifying the local index directly here causes a thread safety issue, since callback thread is already running.
-        // index reserve internally sends a message to itself.
-
-        // call after getting first L1Block to ensure that file is loaded.  (rank 0 reads and broadcast)
-        size_t record_size = 0;
-        size_t seq_len = 0;
-        std::tie(record_size, seq_len) = seq_parser.get_record_size(partition.cbegin(), partition.parent_range_bytes, partition.getRange(), partition.getRange(), 10);
-        size_t est_size = (record_size == 0) ? 0 : (partition.getRange().size() + record_size - 1) / record_size;  // number of records
-        est_size *= (seq_len < kmer_size) ? 0 : (seq_len - kmer_size + 1) ;  // number of kmers in a record
-        result.reserve(result.size() + est_size + (est_size >> 4));
-        BL_BENCH_END(file, "reserve", est_size + (est_size >> 4));
+        // read_block* reserves the exact output size, so no estimate here.
 
         BL_BENCH_START(file);
         //=== copy into array
@@ -294,8 +578,6 @@ struct KmerFileHelper {
                          std::vector<typename KmerParser::value_type>& result) {
       std::pair<size_t, size_t> read = {0, 0};
 
-     constexpr int kmer_size = KmerParser::window_size;
-
       BL_BENCH_INIT(file);
       {
         // not reusing the SeqParser in loader.  instead, reinitializing one.
@@ -304,19 +586,7 @@ struct KmerFileHelper {
         seq_parser.init_parser(partition.in_mem_cbegin(), partition.parent_range_bytes, partition.in_mem_range_bytes, partition.getRange());
         BL_BENCH_END(file, "mark_seqs", partition.getRange().size());
 
-        //== reserve
-        BL_BENCH_START(file);
-        // modifying the local index directly here causes a thread safety issue, since callback thread is already running.
-        // index reserve internally sends a message to itself.
-
-        // call after getting first L1Block to ensure that file is loaded.  (rank 0 reads and broadcast)
-        size_t record_size = 0;
-        size_t seq_len = 0;
-        std::tie(record_size, seq_len) = seq_parser.get_record_size(partition.cbegin(), partition.parent_range_bytes, partition.getRange(), partition.getRange(), 10);
-        size_t est_size = (record_size == 0) ? 0 : (partition.getRange().size() + record_size - 1) / record_size;  // number of records
-        est_size *= (seq_len < kmer_size) ? 0 : (seq_len - kmer_size + 1) ;  // number of kmers in a record
-        result.reserve(result.size() + est_size  + (est_size >> 4) );
-        BL_BENCH_END(file, "reserve", est_size + (est_size >> 4));
+        // read_block* reserves the exact output size, so no estimate here.
 
         BL_BENCH_START(file);
         //=== copy into array
@@ -440,11 +710,10 @@ struct KmerFileHelper {
    */
   template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename BlockType>
   static  ::std::pair<size_t, size_t> parse_file_data_old(const BlockType & partition,
-                         std::vector<typename KmerParser::value_type>& result, const mxx::comm & _comm) {
+                         std::vector<typename KmerParser::value_type>& result, const mxx::comm & _comm,
+                         int nthreads = 1) {
       ::std::pair<size_t, size_t> read = {0,0};
 
-     constexpr int kmer_size = KmerParser::window_size;
-
       BL_BENCH_INIT(file);
       {
         // not reusing the SeqParser in loader.  instead, reinitializing one.
@@ -453,24 +722,12 @@ struct KmerFileHelper {
         seq_parser.init_parser(partition.in_mem_cbegin(), partition.parent_range_bytes, partition.in_mem_range_bytes, partition.getRange(), _comm);
         BL_BENCH_END(file, "mark_seqs", partition.getRange().size());
 
-        //== reserve
-        BL_BENCH_START(file);
-        // modifying the local index directly here causes a thread safety issue, since callback thread is already running.
-        // index reserve internally sends a message to itself.
-
-        // call after getting first L1Block to ensure that file is loaded.  (rank 0 reads and broadcast)
-        size_t record_size = 0;
-        size_t seq_len = 0;
-        std::tie(record_size, seq_len) = seq_parser.get_record_size(partition.cbegin(), partition.parent_range_bytes, partition.getRange(), partition.getRange(), _comm, 10);
-        size_t est_size = (record_size == 0) ? 0 : (partition.getRange().size() + record_size - 1) / record_size;  // number of records
-        est_size *= (seq_len < kmer_size) ? 0 : (seq_len - kmer_size + 1) ;  // number of kmers in a record
-        result.reserve(result.size() + est_size / 2);
-        BL_BENCH_END(file, "reserve", est_size);
+        // read_block* reserves the exact output size, so no estimate here.
 
         BL_BENCH_START(file);
         //=== copy into array
         if (partition.getRange().size() > 0) {
-          read = read_block_old<KmerParser, SeqParser, SeqIterType>(partition, seq_parser, result);
+          read = read_block_omp<KmerParser, SeqParser, SeqIterType>(partition, seq_parser, result, nthreads);
         }
         BL_BENCH_END(file, "read_seqs", read.first);
         // std::cout << "Last: pos - kmer " << result.back() << std::endl;
@@ -489,8 +746,6 @@ struct KmerFileHelper {
                          std::vector<typename KmerParser::value_type>& result, const mxx::comm & _comm) {
       ::std::pair<size_t, size_t> read = {0,0};
 
-     constexpr int kmer_size = KmerParser::window_size;
-
       BL_BENCH_INIT(file);
       {
         // not reusing the SeqParser in loader.  instead, reinitializing one.
@@ -499,19 +754,7 @@ struct KmerFileHelper {
         seq_parser.init_parser(partition.in_mem_cbegin(), partition.parent_range_bytes, partition.in_mem_range_bytes, partition.getRange(), _comm);
         BL_BENCH_END(file, "mark_seqs", partition.getRange().size());
 
-        //== reserve
-        BL_BENCH_START(file);
-        // modifying the local index directly here causes a thread safety issue, since callback thread is already running.
-        // index reserve internally sends a message to itself.
-
-        // call after getting first L1Block to ensure that file is loaded.  (rank 0 reads and broadcast)
-        size_t record_size = 0;
-        size_t seq_len = 0;
-        std::tie(record_size, seq_len) = seq_parser.get_record_size(partition.cbegin(), partition.parent_range_bytes, partition.getRange(), partition.getRange(), _comm, 10);
-        size_t est_size = (record_size == 0) ? 0 : (partition.getRange().size() + record_size - 1) / record_size;  // number of records
-        est_size *= (seq_len < kmer_size) ? 0 : (seq_len - kmer_size + 1) ;  // number of kmers in a record
-        result.reserve(result.size() + est_size / 2);
-        BL_BENCH_END(file, "reserve", est_size);
+        // read_block* reserves the exact output size, so no estimate here.
 
         BL_BENCH_START(file);
         //=== copy into array
@@ -550,7 +793,7 @@ struct KmerFileHelper {
   template <typename FileType, typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
   static  ::std::pair<size_t, size_t> read_file(const std::string & filename,
                          std::vector<typename KmerParser::value_type>& result,
-                         const mxx::comm & _comm) {
+                         const mxx::comm & _comm, int nthreads = 1) {
 
       ::std::pair<size_t, size_t> read = {0, 0};
 
@@ -568,7 +811,7 @@ struct KmerFileHelper {
 
         // not reusing the SeqParser in loader.  instead, reinitializing one.
         BL_BENCH_START(file);
-        read = parse_file_data_old<KmerParser, SeqParser, SeqIterType>(partition, result, _comm);
+        read = parse_file_data_old<KmerParser, SeqParser, SeqIterType>(partition, result, _comm, nthreads);
         BL_BENCH_END(file, "read_kmers", read.second);
         // std::cout << "Last: pos - kmer " << result.back() << std::endl;
       }
@@ -579,6 +822,136 @@ struct KmerFileHelper {
   }
 
 
+  /**
+   * @brief read a file's content, pack the reads into arena, and generate kmers from the packed reads.  see read_block_packed.
+   * @note  static so can be used without instantiating a internal map.
+   * @tparam FileType     file reader type, e.g. mpiio_file or partitioned_file.
+   * @tparam KmerParser   has to be KmerParser<KmerType>.
+   * @param arena         PackedSequenceArena.  the reads of this rank are appended.
+   */
+  template <typename FileType, typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType,
+            typename Arena>
+  static  ::std::pair<size_t, size_t> read_file_packed(const std::string & filename,
+                         Arena & arena,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm) {
+
+      ::std::pair<size_t, size_t> read = {0, 0};
+
+      constexpr int kmer_size = KmerParser::window_size;
+
+      BL_BENCH_INIT(file);
+      {  // ensure that fileloader is closed at the end.
+
+        BL_BENCH_START(file);
+        ::bliss::io::file_data partition = open_file<FileType>(filename, kmer_size - 1, _comm);
+        BL_BENCH_END(file, "open", partition.getRange().size());
+
+        BL_BENCH_START(file);
+        SeqParser<typename ::bliss::io::file_data::const_iterator> seq_parser;
+        seq_parser.init_parser(partition.in_mem_cbegin(), partition.parent_range_bytes, partition.in_mem_range_bytes, partition.getRange(), _comm);
+        BL_BENCH_END(file, "mark_seqs", partition.getRange().size());
+
+        BL_BENCH_START(file);
+        size_t record_size = 0;
+        size_t seq_len = 0;
+        std::tie(record_size, seq_len) = seq_parser.get_record_size(partition.cbegin(), partition.parent_range_bytes, partition.getRange(), partition.getRange(), _comm, 10);
+        size_t est_seqs = (record_size == 0) ? 0 : (partition.getRange().size() + record_size - 1) / record_size;
+        arena.reserve(est_seqs * seq_len, est_seqs);
+        BL_BENCH_END(file, "reserve", est_seqs);
+
+        BL_BENCH_START(file);
+        if (partition.getRange().size() > 0) {
+          read = read_block_packed<KmerParser, SeqParser, SeqIterType>(partition, seq_parser, arena, result);
+        }
+        BL_BENCH_END(file, "read_kmers", read.second);
+      }
+
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:read_file_packed", _comm);
+      return read;
+  }
+
+
+  /**
+   * @brief read a file's content and pack this rank's reads into a PackedReadStore, without generating k-mers.
+   * @details  the file data is released on return.  the store then builds any number of k-mer, count or position indices
+   *      via Index::build(store), without reparsing and without keeping the ASCII in memory.
+   * @tparam FileType     file reader type, e.g. mpiio_file or partitioned_file.
+   * @tparam KmerType     k-mer type of the indices to build.  reads are trimmed to the rank's k-mers of this size.
+   * @param store         PackedReadStore of the k-mer's alphabet.  the reads of this rank are appended.
+   * @return number of reads packed.
+   */
+  template <typename FileType, typename KmerType, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType,
+            typename Store>
+  static size_t read_file_to_store(const std::string & filename,
+                         Store & store,
+                         const mxx::comm & _comm) {
+
+      size_t seqs = 0;
+
+      BL_BENCH_INIT(file);
+      {  // ensure that fileloader is closed at the end.
+
+        BL_BENCH_START(file);
+        ::bliss::io::file_data partition = open_file<FileType>(filename, KmerType::size - 1, _comm);
+        BL_BENCH_END(file, "open", partition.getRange().size());
+
+        BL_BENCH_START(file);
+        SeqParser<typename ::bliss::io::file_data::const_iterator> seq_parser;
+        seq_parser.init_parser(partition.in_mem_cbegin(), partition.parent_range_bytes, partition.in_mem_range_bytes, partition.getRange(), _comm);
+        BL_BENCH_END(file, "mark_seqs", partition.getRange().size());
+
+        BL_BENCH_START(file);
+        size_t record_size = 0;
+        size_t seq_len = 0;
+        std::tie(record_size, seq_len) = seq_parser.get_record_size(partition.cbegin(), partition.parent_range_bytes, partition.getRange(), partition.getRange(), _comm, 10);
+        size_t est_seqs = (record_size == 0) ? 0 : (partition.getRange().size() + record_size - 1) / record_size;
+        store.reserve(est_seqs * seq_len, est_seqs);
+        BL_BENCH_END(file, "reserve", est_seqs);
+
+        BL_BENCH_START(file);
+        if (partition.getRange().size() > 0) {
+          seqs = pack_block<KmerType, SeqParser, SeqIterType>(partition, seq_parser, store);
+        }
+        BL_BENCH_END(file, "pack", store.bytes());
+      }
+
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:read_file_to_store", _comm);
+      return seqs;
+  }
+
+
+  /**
+   * @brief read this rank's part of a UCSC .2bit file into a PackedReadStore.  see twobit_file.
+   * @details  the concatenated bases are split evenly across the ranks, and each rank reads the bases of the k-mers
+   *      starting in its part, with k-1 overlap.  the bases go into the store without ASCII translation.
+   * @tparam KmerType     k-mer type of the indices to build.
+   * @return number of sequence parts packed.
+   */
+  template <typename KmerType, typename Store>
+  static size_t read_file_2bit(const std::string & filename,
+                         Store & store,
+                         const mxx::comm & _comm) {
+      size_t seqs = 0;
+
+      BL_BENCH_INIT(file);
+
+      BL_BENCH_START(file);
+      ::bliss::io::twobit_file f(filename);
+      size_t start = f.size() * _comm.rank() / _comm.size();
+      size_t end = f.size() * (_comm.rank() + 1) / _comm.size();
+      store.reserve(end - start + KmerType::size - 1, 1);
+      BL_BENCH_END(file, "open", end - start);
+
+      BL_BENCH_START(file);
+      seqs = f.read(::bliss::partition::range<size_t>(start, end), KmerType::size, store);
+      BL_BENCH_END(file, "pack", store.bytes());
+
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:read_file_2bit", _comm);
+      return seqs;
+  }
+
+
   /**
    * @brief read a file's content and generate kmers, place in a vector as return result.
    * @note  static so can be used wihtout instantiating a internal map.
@@ -588,10 +961,10 @@ struct KmerFileHelper {
   template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
   static  ::std::pair<size_t, size_t> read_file_mpiio(const std::string & filename,
                          std::vector<typename KmerParser::value_type>& result,
-                         const mxx::comm & _comm) {
+                         const mxx::comm & _comm, int nthreads = 1) {
 
       return read_file<::bliss::io::parallel::mpiio_file<SeqParser >,
-          KmerParser, SeqParser, SeqIterType>(filename, result, _comm);
+          KmerParser, SeqParser, SeqIterType>(filename, result, _comm, nthreads);
   }
 
 
@@ -604,11 +977,11 @@ struct KmerFileHelper {
   template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
   static  ::std::pair<size_t, size_t> read_file_mmap(const std::string & filename,
                         std::vector<typename KmerParser::value_type>& result,
-                        const mxx::comm & _comm) {
+                        const mxx::comm & _comm, int nthreads = 1) {
 
       // partitioned file with mmap or posix is only slightly faster than mpiio and may result in more jitter when congested.
       return read_file<::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file, SeqParser >,
-          KmerParser, SeqParser, SeqIterType>(filename, result, _comm);
+          KmerParser, SeqParser, SeqIterType>(filename, result, _comm, nthreads);
 
   }
 
@@ -622,14 +995,691 @@ struct KmerFileHelper {
   template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
   static ::std::pair<size_t, size_t> read_file_posix(const std::string & filename,
                          std::vector<typename KmerParser::value_type>& result,
-                         const mxx::comm & _comm) {
+                         const mxx::comm & _comm, int nthreads = 1) {
 
 
 
       // partitioned file with mmap or posix do not seem to be much faster than mpiio and may result in more jitter when congested.
       return read_file<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, SeqParser >,
-          KmerParser, SeqParser, SeqIterType>(filename, result, _comm);
+          KmerParser, SeqParser, SeqIterType>(filename, result, _comm, nthreads);
+
+  }
 
+  /**
+   * @brief read a file's content and generate kmers, place in a vector as return result.  reads with O_DIRECT through io_uring.
+   * @note  static so can be used wihtout instantiating a internal map.
+   * @tparam SeqParser    parser type for extracting sequences.  supports FASTQ and FASTA.   template template parameter, param is iterator
+   * @tparam KmerParser   parser type for generating Kmer.  supports kmer, kmer+pos, kmer+count, kmer+pos/qual.
+   */
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static ::std::pair<size_t, size_t> read_file_uring(const std::string & filename,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm, int nthreads = 1) {
+
+      return read_file<::bliss::io::parallel::partitioned_file<::bliss::io::uring_file, SeqParser >,
+          KmerParser, SeqParser, SeqIterType>(filename, result, _comm, nthreads);
+
+  }
+
+  /**
+   * @brief read an object's content from object storage and generate kmers, place in a vector as return result.
+   * @details  each rank requests its partition with concurrent HTTP range requests, without staging the file.
+   *      filename is an s3://, gs:// or http:// url ending in .fastq or .fasta.  see object_file for the endpoints and settings.
+   * @note  static so can be used wihtout instantiating a internal map.
+   * @tparam SeqParser    parser type for extracting sequences.  supports FASTQ and FASTA.   template template parameter, param is iterator
+   * @tparam KmerParser   parser type for generating Kmer.  supports kmer, kmer+pos, kmer+count, kmer+pos/qual.
+   */
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static ::std::pair<size_t, size_t> read_file_object(const std::string & filename,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm, int nthreads = 1) {
+
+      return read_file<::bliss::io::parallel::object_file<SeqParser >,
+          KmerParser, SeqParser, SeqIterType>(filename, result, _comm, nthreads);
+
+  }
+
+#if defined(USE_ZLIB)
+  /**
+   * @brief read a gzip or BGZF compressed file's content and generate kmers, place in a vector as return result.
+   * @details  ranks partition the uncompressed bytes.  each rank inflates its partition with nthreads threads,
+   *      then parses as read_file does.  filename should be xxx.fastq.gz or xxx.fasta.gz.  see gzip_file for the index.
+   * @note  static so can be used wihtout instantiating a internal map.
+   * @tparam SeqParser    parser type for extracting sequences.  supports FASTQ and FASTA.   template template parameter, param is iterator
+   * @tparam KmerParser   parser type for generating Kmer.  supports kmer, kmer+pos, kmer+count, kmer+pos/qual.
+   */
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static ::std::pair<size_t, size_t> read_file_gzip(const std::string & filename,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm, int nthreads = 1) {
+
+      ::std::pair<size_t, size_t> read = {0, 0};
+
+      constexpr int kmer_size = KmerParser::window_size;
+
+      // file extension before .gz/.bgz determines SeqParserType
+      std::string name = filename;
+      std::string extension = ::bliss::utils::file::get_file_extension(name);
+      std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+      if ((extension.compare("gz") == 0) || (extension.compare("bgz") == 0)) {
+        name = name.substr(0, name.length() - extension.length() - 1);
+        extension = ::bliss::utils::file::get_file_extension(name);
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+      }
+      if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0)) {
+        throw std::invalid_argument("input filename extension is not supported.");
+      }
+
+      BL_BENCH_INIT(file);
+      {  // ensure that fileloader is closed at the end.
+
+        BL_BENCH_START(file);
+        ::bliss::io::file_data partition;
+        {
+          ::bliss::io::parallel::partitioned_file<::bliss::io::gzip_file, SeqParser > fobj(filename, kmer_size - 1, _comm);
+          fobj.get_reader().set_threads(nthreads);
+          partition = fobj.read_file();
+        }
+        BL_BENCH_END(file, "open", partition.getRange().size());
+
+        BL_BENCH_START(file);
+        read = parse_file_data_old<KmerParser, SeqParser, SeqIterType>(partition, result, _comm, nthreads);
+        BL_BENCH_END(file, "read_kmers", read.second);
+      }
+
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:read_file_gzip", _comm);
+      return read;
+  }
+#endif
+
+
+  /**
+   * @brief read a file's content and generate kmers in chunks of approximately chunk_size elements, calling op on each chunk.
+   * @details  only the raw partition bytes are kept in memory.  kmers are parsed one sequence at a time into a
+   *      reusable buffer, which is handed to op once it reaches chunk_size entries (it may exceed by at most 1 sequence's worth).
+   *      op is invoked the same number of times on all processes, with an empty chunk if a process has run out of data,
+   *      so op may be a collective call such as a distributed map insert.
+   *
+   *      for restarting a build, sequences that start before resume_from are skipped, and after each op, progress is
+   *      called with the file offset up to which this process's input has been handed to op.  resume_from is a
+   *      progress value from a run with the same file and number of processes.  see ::dsc::map_checkpoint.
+   * @note  op may modify the chunk (e.g. distribute in place).  the chunk is cleared after each call.
+   * @tparam FileType     file reader type, e.g. mpiio_file or partitioned_file.
+   * @tparam Operation    functor with signature void(std::vector<typename KmerParser::value_type> &).
+   * @tparam Progress     functor with signature void(size_t const &).  may be collective, as op.
+   * @return  number of sequences and number of kmers parsed.
+   */
+  template <typename FileType, typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType,
+            typename Operation, typename Progress>
+  static ::std::pair<size_t, size_t> read_file_chunked(const std::string & filename, size_t const & chunk_size,
+                         Operation & op, const mxx::comm & _comm, size_t const & resume_from, Progress & progress) {
+
+      if (chunk_size == 0) {
+        throw std::invalid_argument("chunk size for chunked file read must be greater than 0.");
+      }
+
+      ::std::pair<size_t, size_t> read = {0, 0};
+
+      constexpr int kmer_size = KmerParser::window_size;
+
+      using CharIterType = typename ::bliss::io::file_data::const_iterator;
+      using SeqIter = SeqIterType<CharIterType, SeqParser>;
+
+      BL_BENCH_INIT(file);
+      {  // ensure that fileloader is closed at the end.
+
+        BL_BENCH_START(file);
+        ::bliss::io::file_data partition = open_file<FileType>(filename, kmer_size - 1, _comm);
+        BL_BENCH_END(file, "open", partition.getRange().size());
+
+        // not reusing the SeqParser in loader.  instead, reinitializing one.  collective.
+        BL_BENCH_START(file);
+        SeqParser<CharIterType> seq_parser;
+        seq_parser.init_parser(partition.in_mem_cbegin(), partition.parent_range_bytes, partition.in_mem_range_bytes, partition.getRange(), _comm);
+        BL_BENCH_END(file, "mark_seqs", partition.getRange().size());
+
+        BL_BENCH_START(file);
+        KmerParser kmer_parser(partition.valid_range_bytes);
+
+        SeqIter seqs_start = (partition.getRange().size() > 0) ?
+            SeqIter(seq_parser, partition.cbegin(), partition.in_mem_cend(), partition.getRange().start) :
+            SeqIter(partition.in_mem_cend());
+        SeqIter seqs_end(partition.in_mem_cend());
+
+        ::std::vector<typename KmerParser::value_type> chunk;
+        chunk.reserve(chunk_size + (chunk_size >> 4));
+        ::fsc::back_emplace_iterator<std::vector<typename KmerParser::value_type> > emplace_iter(chunk);
+        BL_BENCH_END(file, "reserve", chunk.capacity());
+
+        size_t nchunks = 0;
+        size_t consumed = resume_from;
+        bool done = mxx::all_of(seqs_start == seqs_end, _comm);
+
+        BL_BENCH_LOOP_START(file, 0);
+        BL_BENCH_LOOP_START(file, 1);
+        while (!done) {
+
+          BL_BENCH_LOOP_RESUME(file, 0);
+          for (; (seqs_start != seqs_end) && (chunk.size() < chunk_size); ++seqs_start) {
+            auto seq = *seqs_start;
+            if (seq.seq_global_offset() < resume_from) continue;  // in the map from before the restart.
+            if (parse_sequence<SeqParser<CharIterType> >(partition, seq, kmer_parser, emplace_iter)) ++read.first;
+            consumed = seq.seq_global_offset() + 1;
+          }
+          read.second += chunk.size();
+          BL_BENCH_LOOP_PAUSE(file, 0);
+
+          BL_BENCH_LOOP_RESUME(file, 1);
+          op(chunk);   // potentially collective.
+          chunk.clear();
+          progress(consumed);   // potentially collective.
+          BL_BENCH_LOOP_PAUSE(file, 1);
+
+          ++nchunks;
+          done = mxx::all_of(seqs_start == seqs_end, _comm);
+        }
+        BL_BENCH_LOOP_END(file, 0, "parse", read.second);
+        BL_BENCH_LOOP_END(file, 1, "op", nchunks);
+      }
+
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:read_file_chunked", _comm);
+      return read;
+  }
+
+  /// progress functor that does nothing.
+  struct no_progress {
+      inline void operator()(size_t const &) const {}
+  };
+
+  /// chunked read of the whole file, without progress.  see read_file_chunked.
+  template <typename FileType, typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename Operation>
+  static ::std::pair<size_t, size_t> read_file_chunked(const std::string & filename, size_t const & chunk_size,
+                         Operation & op, const mxx::comm & _comm) {
+      no_progress progress;
+      return read_file_chunked<FileType, KmerParser, SeqParser, SeqIterType>(filename, chunk_size, op, _comm, 0, progress);
+  }
+
+  /// chunked read via mpiio.  see read_file_chunked.
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename Operation>
+  static ::std::pair<size_t, size_t> read_file_mpiio_chunked(const std::string & filename, size_t const & chunk_size,
+                         Operation & op, const mxx::comm & _comm) {
+      return read_file_chunked<::bliss::io::parallel::mpiio_file<SeqParser >,
+          KmerParser, SeqParser, SeqIterType>(filename, chunk_size, op, _comm);
+  }
+
+  /// chunked read via mmap.  see read_file_chunked.
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename Operation>
+  static ::std::pair<size_t, size_t> read_file_mmap_chunked(const std::string & filename, size_t const & chunk_size,
+                         Operation & op, const mxx::comm & _comm) {
+      return read_file_chunked<::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file, SeqParser >,
+          KmerParser, SeqParser, SeqIterType>(filename, chunk_size, op, _comm);
+  }
+
+  /// chunked read via posix.  see read_file_chunked.
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename Operation>
+  static ::std::pair<size_t, size_t> read_file_posix_chunked(const std::string & filename, size_t const & chunk_size,
+                         Operation & op, const mxx::comm & _comm) {
+      return read_file_chunked<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, SeqParser >,
+          KmerParser, SeqParser, SeqIterType>(filename, chunk_size, op, _comm);
+  }
+
+
+  /**
+   * @brief  read a file's content as read_file_chunked, with the stages overlapped in a stage_pipeline.
+   * @details  stages:
+   *        read    1 thread.  walks the sequences of the partition and groups them in batches of about chunk_size
+   *                characters.
+   *        parse   parse_threads threads.  parses a batch into kmers.
+   *        op      the calling thread.  op(chunk), e.g. a distributed map insert, which buckets, exchanges, and inserts.
+   *      queues hold at most depth batches and depth chunks, which bounds the memory to about 2 x depth chunks.  op is
+   *      invoked the same number of times on all processes, with an empty chunk if a process has run out of data, so
+   *      op may be collective.  chunks reach op in the order the parse threads finish, not in file order.
+   * @tparam Operation    functor with signature void(std::vector<typename KmerParser::value_type> &).
+   * @param stats   per stage counters of this process.  see ::bliss::concurrent::stage_stats.
+   * @return  number of sequences and number of kmers parsed.
+   */
+  template <typename FileType, typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType,
+            typename Operation>
+  static ::std::pair<size_t, size_t> read_file_pipelined(const std::string & filename, size_t const & chunk_size,
+                         Operation & op, const mxx::comm & _comm, int const & parse_threads, size_t const & depth,
+                         ::std::vector<::bliss::concurrent::stage_stats> & stats) {
+
+      if (chunk_size == 0) {
+        throw std::invalid_argument("chunk size for pipelined file read must be greater than 0.");
+      }
+
+      constexpr int kmer_size = KmerParser::window_size;
+
+      using CharIterType = typename ::bliss::io::file_data::const_iterator;
+      using SeqIter = SeqIterType<CharIterType, SeqParser>;
+      using SeqType = typename ::std::decay<decltype(*(::std::declval<SeqIter>()))>::type;
+      using ChunkType = ::std::vector<typename KmerParser::value_type>;
+
+      ::std::atomic<size_t> nseqs(0);
+      ::std::atomic<size_t> nkmers(0);
+
+      BL_BENCH_INIT(file);
+      {  // ensure that fileloader is closed at the end.
+
+        BL_BENCH_START(file);
+        ::bliss::io::file_data partition = open_file<FileType>(filename, kmer_size - 1, _comm);
+        BL_BENCH_END(file, "open", partition.getRange().size());
+
+        BL_BENCH_START(file);
+        SeqParser<CharIterType> seq_parser;
+        seq_parser.init_parser(partition.in_mem_cbegin(), partition.parent_range_bytes, partition.in_mem_range_bytes, partition.getRange(), _comm);
+        BL_BENCH_END(file, "mark_seqs", partition.getRange().size());
+
+        BL_BENCH_COLLECTIVE_START(file, "pipeline", _comm);
+        SeqIter seqs_start = (partition.getRange().size() > 0) ?
+            SeqIter(seq_parser, partition.cbegin(), partition.in_mem_cend(), partition.getRange().start) :
+            SeqIter(partition.in_mem_cend());
+        SeqIter seqs_end(partition.in_mem_cend());
+
+        ::bliss::concurrent::stage_pipeline pipe;
+        auto batches = pipe.template source<::std::vector<SeqType> >("read", 1, depth,
+            [&seqs_start, &seqs_end, &chunk_size](::std::vector<SeqType> & batch) {
+          batch.clear();
+          size_t chars = 0;
+          for (; (seqs_start != seqs_end) && (chars < chunk_size); ++seqs_start) {
+            batch.emplace_back(*seqs_start);
+            chars += batch.back().seq_size();
+          }
+          return !batch.empty();
+        });
+
+        ::bliss::io::file_data const & part = partition;
+        auto chunks = pipe.template stage<::std::vector<SeqType>, ChunkType>("parse", ::std::max(1, parse_threads), batches, depth,
+            [&part, &nseqs, &nkmers, &chunk_size](::std::vector<SeqType> & batch, ChunkType & chunk) {
+          KmerParser kmer_parser(part.valid_range_bytes);
+          chunk.clear();
+          chunk.reserve(chunk_size + (chunk_size >> 4));
+          ::fsc::back_emplace_iterator<ChunkType> emplace_iter(chunk);
+          size_t n = 0;
+          for (auto & seq : batch) {
+            if (parse_sequence<SeqParser<CharIterType> >(part, seq, kmer_parser, emplace_iter)) ++n;
+          }
+          nseqs += n;
+          nkmers += chunk.size();
+          return true;
+        });
+
+        pipe.template sink<ChunkType>("op", 0, chunks, [&op](ChunkType & chunk) {
+          op(chunk);   // potentially collective.
+          chunk.clear();
+        });
+        pipe.set_agreement([&_comm](bool done) {
+          return mxx::all_of(done, _comm);
+        });
+
+        pipe.run();
+        stats = pipe.get_stats();
+        BL_BENCH_END(file, "pipeline", nkmers.load());
+
+#if (BL_BENCHMARK == 1)
+        if (_comm.rank() == 0) pipe.report(::std::cout, "io:read_file_pipelined R0");
+#endif
+      }
+
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:read_file_pipelined", _comm);
+      return ::std::make_pair(nseqs.load(), nkmers.load());
+  }
+
+
+  /**
+   * @brief  find the first record start at or after pos in a prefetched block, extending the block if the record search runs past the in memory data.
+   * @return record start, or end of file.
+   */
+  template <typename SeqParserType, typename PrefetchReader>
+  static size_t find_record_start(SeqParserType & seq_parser, PrefetchReader & blocks,
+                                  ::bliss::io::file_data & block, size_t const & pos) {
+    using RangeType = typename ::bliss::io::file_data::range_type;
+
+    if (pos >= block.parent_range_bytes.end) return block.parent_range_bytes.end;
+
+    while (true) {
+      size_t start = block.in_mem_range_bytes.end;
+      try {
+        start = seq_parser.find_first_record(block.in_mem_cbegin(), block.parent_range_bytes, block.in_mem_range_bytes,
+                                             RangeType(pos, block.in_mem_range_bytes.end));
+      } catch (::std::logic_error const &) {
+        // no complete record in memory.
+      }
+
+      // find_first_record returns the search end if fewer than 4 lines are in memory, so end of in memory is only valid at end of file.
+      if ((start < block.in_mem_range_bytes.end) || (block.in_mem_range_bytes.end == block.parent_range_bytes.end)) return start;
+
+      blocks.extend(block, ::std::max(block.in_mem_range_bytes.size(), 4096UL));
+    }
+  }
+
+  /**
+   * @brief read a FASTQ file's content block by block and generate kmers.  reading block i+1 is overlapped with parsing block i.
+   * @details  each process takes its block partition of the file and reads it through a prefetching_reader in blocks of block_size bytes.
+   *      blocks are aligned to records with find_first_record, from the partition start and from each block end.  this is the same search
+   *      that partitioned_file and mpiio_file do at partition boundaries, so every record is parsed by exactly one process and block
+   *      without communication.  a record that extends past a block's overlap is handled by extending the block synchronously.
+   * @note  FASTQ only.  FASTA needs the collective sequence header search in init_parser.
+   * @param reader     file reader, posix_file or mpiio_file.  for mpiio, reads are nonblocking MPI_File_iread_at.
+   * @param block_size bytes to read at a time, per process.
+   * @param overlap    bytes read past each block, should cover a few records.
+   * @param ring_size  number of block buffers.  2 for double buffering.
+   */
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename FileReader>
+  static ::std::pair<size_t, size_t> parse_file_prefetched(FileReader & reader, size_t const & block_size,
+                         std::vector<typename KmerParser::value_type>& result, const mxx::comm & _comm,
+                         size_t const & overlap = (1UL << 16), size_t const & ring_size = 2) {
+
+      using CharIterType = typename ::bliss::io::file_data::const_iterator;
+      using SeqIter = SeqIterType<CharIterType, SeqParser>;
+      using RangeType = typename ::bliss::io::file_data::range_type;
+
+      static_assert(::std::is_same<SeqParser<CharIterType>, ::bliss::io::FASTQParser<CharIterType> >::value,
+                    "prefetched file parsing supports only FASTQ files.");
+
+      ::std::pair<size_t, size_t> read = {0, 0};
+
+      BL_BENCH_INIT(file);
+      {
+        BL_BENCH_START(file);
+        RangeType file_range(0, reader.size());
+        ::bliss::partition::BlockPartitioner<RangeType> partitioner;
+        partitioner.configure(file_range, _comm.size());
+        RangeType local = partitioner.getNext(_comm.rank());
+
+        ::bliss::io::prefetching_reader<FileReader> blocks(reader, local, block_size, overlap, ring_size);
+        BL_BENCH_END(file, "open", local.size());
+
+        SeqParser<CharIterType> seq_parser;
+        ::fsc::back_emplace_iterator<std::vector<typename KmerParser::value_type> > emplace_iter(result);
+        size_t before = result.size();
+
+        // start of the next record to parse.
+        size_t start = local.start;
+        size_t end;
+        bool first = true;
+
+        BL_BENCH_LOOP_START(file, 0);
+        BL_BENCH_LOOP_START(file, 1);
+        while (blocks.has_next()) {
+
+          BL_BENCH_LOOP_RESUME(file, 0);
+          ::bliss::io::file_data & block = blocks.next();
+          BL_BENCH_LOOP_PAUSE(file, 0);
+
+          BL_BENCH_LOOP_RESUME(file, 1);
+          if (first) {
+            start = find_record_start(seq_parser, blocks, block, start);
+            first = false;
+          }
+
+          // records that start in [start, end) belong to this block.  start may be at or past the block end if a record
+          // is longer than a block, and the search skips a record that starts exactly at the search position, so search anyway.
+          end = find_record_start(seq_parser, blocks, block, block.valid_range_bytes.end);
+          if (start < end) {
+            block.valid_range_bytes = RangeType(start, end);
+            KmerParser kmer_parser(block.valid_range_bytes);
+
+            SeqIter seqs_start(seq_parser, block.cbegin(), block.cend(), start);
+            SeqIter seqs_end(block.cend());
+
+            for (; seqs_start != seqs_end; ++seqs_start) {
+              auto seq = *seqs_start;
+              if (parse_sequence<SeqParser<CharIterType> >(block, seq, kmer_parser, emplace_iter)) ++read.first;
+            }
+
+            start = end;
+          }
+          BL_BENCH_LOOP_PAUSE(file, 1);
+        }
+        BL_BENCH_LOOP_END(file, 0, "read wait", blocks.size());
+        BL_BENCH_LOOP_END(file, 1, "parse", read.first);
+
+        read.second = result.size() - before;
+      }
+
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:parse_file_prefetched", _comm);
+      return read;
+  }
+
+  /// prefetched read via posix pread on a background thread.  see parse_file_prefetched.
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static ::std::pair<size_t, size_t> read_file_posix_prefetched(const std::string & filename, size_t const & block_size,
+                         std::vector<typename KmerParser::value_type>& result, const mxx::comm & _comm) {
+      ::bliss::io::posix_file reader(filename);
+      return parse_file_prefetched<KmerParser, SeqParser, SeqIterType>(reader, block_size, result, _comm);
+  }
+
+  /// prefetched read via nonblocking mpiio.  see parse_file_prefetched.
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static ::std::pair<size_t, size_t> read_file_mpiio_prefetched(const std::string & filename, size_t const & block_size,
+                         std::vector<typename KmerParser::value_type>& result, const mxx::comm & _comm) {
+      ::bliss::io::parallel::mpiio_file<SeqParser> reader(filename, 0UL, _comm);   // collective open
+      return parse_file_prefetched<KmerParser, SeqParser, SeqIterType>(reader, block_size, result, _comm);
+  }
+
+
+  /// k-mers of the reads of 1 block, grouped by read, in file order.  see parse_reads_prefetched.
+  template <typename T>
+  struct read_batch {
+      /// k-mers of all reads, read after read.
+      std::vector<T> kmers;
+      /// k-mers of read i are [offsets[i], offsets[i+1]).  1 more than the number of reads.
+      std::vector<size_t> offsets;
+      /// file offset of each read's record, which is its global id.
+      std::vector<size_t> ids;
+
+      read_batch() : offsets(1, 0) {}
+
+      size_t size() const { return ids.size(); }
+      void clear() {
+        kmers.clear();
+        offsets.assign(1, 0);
+        ids.clear();
+      }
+  };
+
+  /**
+   * @brief read a FASTQ file block by block as parse_file_prefetched, and hand each block's k-mers to op, grouped by read.
+   * @details  op(batch) is called once per block, with the reads of the block in file order.  a read shorter than k has no
+   *      k-mers but is still in the batch.  op is invoked the same number of times on all processes, with an empty batch
+   *      if a process has run out of blocks, so op may be collective.  memory is ring_size blocks and 1 batch.
+   * @tparam Operation    functor with signature void(read_batch<typename KmerParser::value_type> &).  op may take over the batch content.
+   * @return  number of reads and number of kmers parsed.
+   */
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType,
+      typename FileReader, typename Operation>
+  static ::std::pair<size_t, size_t> parse_reads_prefetched(FileReader & reader, size_t const & block_size,
+                         Operation & op, const mxx::comm & _comm,
+                         size_t const & overlap = (1UL << 16), size_t const & ring_size = 2) {
+
+      using CharIterType = typename ::bliss::io::file_data::const_iterator;
+      using SeqIter = SeqIterType<CharIterType, SeqParser>;
+      using RangeType = typename ::bliss::io::file_data::range_type;
+      using BatchType = read_batch<typename KmerParser::value_type>;
+
+      static_assert(::std::is_same<SeqParser<CharIterType>, ::bliss::io::FASTQParser<CharIterType> >::value,
+                    "prefetched file parsing supports only FASTQ files.");
+
+      ::std::pair<size_t, size_t> read = {0, 0};
+
+      BL_BENCH_INIT(file);
+      {
+        BL_BENCH_START(file);
+        RangeType file_range(0, reader.size());
+        ::bliss::partition::BlockPartitioner<RangeType> partitioner;
+        partitioner.configure(file_range, _comm.size());
+        RangeType local = partitioner.getNext(_comm.rank());
+
+        ::bliss::io::prefetching_reader<FileReader> blocks(reader, local, block_size, overlap, ring_size);
+        BL_BENCH_END(file, "open", local.size());
+
+        SeqParser<CharIterType> seq_parser;
+        BatchType batch;
+        size_t nblocks = 0;
+
+        // start of the next record to parse.
+        size_t start = local.start;
+        size_t end;
+        bool first = true;
+
+        BL_BENCH_LOOP_START(file, 0);
+        BL_BENCH_LOOP_START(file, 1);
+        BL_BENCH_LOOP_START(file, 2);
+        bool more = blocks.has_next();
+        while (::mxx::any_of(more, _comm)) {
+          batch.clear();
+
+          if (more) {
+            BL_BENCH_LOOP_RESUME(file, 0);
+            ::bliss::io::file_data & block = blocks.next();
+            BL_BENCH_LOOP_PAUSE(file, 0);
+
+            BL_BENCH_LOOP_RESUME(file, 1);
+            if (first) {
+              start = find_record_start(seq_parser, blocks, block, start);
+              first = false;
+            }
+
+            // same alignment as parse_file_prefetched.
+            end = find_record_start(seq_parser, blocks, block, block.valid_range_bytes.end);
+            if (start < end) {
+              block.valid_range_bytes = RangeType(start, end);
+              KmerParser kmer_parser(block.valid_range_bytes);
+              ::fsc::back_emplace_iterator<std::vector<typename KmerParser::value_type> > emplace_iter(batch.kmers);
+
+              SeqIter seqs_start(seq_parser, block.cbegin(), block.cend(), start);
+              SeqIter seqs_end(block.cend());
+
+              for (; seqs_start != seqs_end; ++seqs_start) {
+                auto seq = *seqs_start;
+                if (parse_sequence<SeqParser<CharIterType> >(block, seq, kmer_parser, emplace_iter)) {
+                  batch.ids.emplace_back(seq.id.get_pos());
+                  batch.offsets.emplace_back(batch.kmers.size());
+                } else {
+                  batch.kmers.resize(batch.offsets.back());  // not this block's read.
+                }
+              }
+
+              start = end;
+            }
+            ++nblocks;
+            BL_BENCH_LOOP_PAUSE(file, 1);
+          }
+          read.first += batch.size();
+          read.second += batch.kmers.size();
+
+          BL_BENCH_LOOP_RESUME(file, 2);
+          op(batch);   // potentially collective.
+          BL_BENCH_LOOP_PAUSE(file, 2);
+
+          more = blocks.has_next();
+        }
+        BL_BENCH_LOOP_END(file, 0, "read wait", blocks.size());
+        BL_BENCH_LOOP_END(file, 1, "parse", read.first);
+        BL_BENCH_LOOP_END(file, 2, "op", nblocks);
+      }
+
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:parse_reads_prefetched", _comm);
+      return read;
+  }
+
+
+  /**
+   * @brief stream the records (FASTQ) or k-mers (FASTA) of byte range local of a file through StreamParser.
+   * @details  finds the first record or line in local with StreamParser::find_start, and streams blocks of block_size bytes
+   *      through the parser until it reports that the records or k-mers of the range are complete.
+   * @return  number of records started in the range, and number of k-mers.
+   */
+  template <template <typename> class StreamParser, typename KmerType, typename FileReader>
+  static ::std::pair<size_t, size_t> parse_range_streaming(FileReader & reader,
+                         typename ::bliss::io::file_data::range_type const & local, size_t const & block_size,
+                         std::vector<KmerType>& result) {
+      using RangeType = typename ::bliss::io::file_data::range_type;
+
+      size_t file_end = reader.size();
+      size_t start = StreamParser<KmerType>::find_start(reader, local.start, block_size);
+
+      StreamParser<KmerType> parser(start);
+      ::fsc::back_emplace_iterator<std::vector<KmerType> > emplace_iter(result);
+      size_t before = result.size();
+
+      typename ::bliss::io::file_data::container buffer;
+      for (size_t b = start; b < file_end; b += block_size) {
+        RangeType got = reader.read_range(buffer, RangeType(b, ::std::min(b + block_size, file_end)));
+        if (!parser.parse(buffer.data(), got.size(), local.end, emplace_iter)) break;
+      }
+
+      return ::std::make_pair(parser.size(), result.size() - before);
+  }
+
+  /**
+   * @brief read a file of long reads block by block, with records and k-mers spanning blocks.  memory is one block per process.
+   * @details  each process takes its byte block partition and parses it with parse_range_streaming.
+   *      no overlap, no communication, and no record has to fit in memory.  see streaming_kmer_parser.hpp.
+   * @tparam StreamParser  StreamingFASTQKmerParser or StreamingFASTAKmerParser.
+   * @param reader     file reader with size() and read_range, e.g. posix_file.
+   * @return  number of records started in the partition, and number of k-mers.
+   */
+  template <template <typename> class StreamParser, typename KmerType, typename FileReader>
+  static ::std::pair<size_t, size_t> parse_file_streaming(FileReader & reader, size_t const & block_size,
+                         std::vector<KmerType>& result, const mxx::comm & _comm) {
+
+      using RangeType = typename ::bliss::io::file_data::range_type;
+
+      ::std::pair<size_t, size_t> read = {0, 0};
+
+      BL_BENCH_INIT(file);
+      {
+        BL_BENCH_START(file);
+        RangeType file_range(0, reader.size());
+        ::bliss::partition::BlockPartitioner<RangeType> partitioner;
+        partitioner.configure(file_range, _comm.size());
+        RangeType local = partitioner.getNext(_comm.rank());
+
+        read = parse_range_streaming<StreamParser, KmerType>(reader, local, block_size, result);
+        BL_BENCH_END(file, "parse", read.second);
+      }
+
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:parse_file_streaming", _comm);
+      return read;
+  }
+
+  /// streaming long read parsing via posix pread.  see parse_file_streaming.
+  template <template <typename> class StreamParser, typename KmerType>
+  static ::std::pair<size_t, size_t> read_file_posix_streaming(const std::string & filename, size_t const & block_size,
+                         std::vector<KmerType>& result, const mxx::comm & _comm) {
+      ::bliss::io::posix_file reader(filename);
+      return parse_file_streaming<StreamParser, KmerType>(reader, block_size, result, _comm);
+  }
+
+  /**
+   * @brief read all files of a manifest, balanced by bytes over all processes.  see file_manifest.hpp.
+   * @details  each process parses its slices of the concatenated files with parse_range_streaming.  the opens are local,
+   *      not collective, and a process opens only the files its slices are in, each once.
+   * @return  number of records started in the local slices, and number of k-mers.
+   */
+  template <template <typename> class StreamParser, typename KmerType>
+  static ::std::pair<size_t, size_t> read_files_streaming(::bliss::io::file_manifest const & manifest, size_t const & block_size,
+                         std::vector<KmerType>& result, const mxx::comm & _comm) {
+
+      ::std::pair<size_t, size_t> read = {0, 0};
+
+      BL_BENCH_INIT(file);
+      {
+        BL_BENCH_START(file);
+        std::vector<::bliss::io::file_manifest::slice> slices = manifest.slices(_comm.rank(), _comm.size());
+        for (auto const & s : slices) {
+          ::bliss::io::posix_file reader(manifest.file(s.file));
+          ::std::pair<size_t, size_t> r = parse_range_streaming<StreamParser, KmerType>(reader, s.range, block_size, result);
+          read.first += r.first;
+          read.second += r.second;
+        }
+        BL_BENCH_END(file, "parse", read.second);
+      }
+
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:read_files_streaming", _comm);
+      return read;
   }
 #endif
 
@@ -24,6 +24,8 @@
  *      Kmer Count tuple,
  *      Kmer Position tuple, and
  *      Kmer Position + Quality score tuple.
+ *      TranslatedKmerParser generates amino acid Kmers from DNA, in 6 frames.
+ *      MinimizerPositionTupleParser and MinimizerKmerParser keep only the (w, k)-minimizers, for a sampled index.
  *
  *
  */
@@ -44,6 +46,8 @@
 #include <utility>      // pair and utility functions.
 #include <type_traits>
 #include <cctype>       // tolower.
+#include <cstring>      // memchr
+#include <iterator>     // back_inserter
 
 #include "utils/logging.h"
 #include "utils/file_utils.hpp"
@@ -60,11 +64,15 @@
 #include "io/sequence_iterator.hpp"
 #include "io/sequence_id_iterator.hpp"
 #include "iterators/transform_iterator.hpp"
+#include "iterators/block_iterator.hpp"
 #include "common/kmer_iterators.hpp"
+#include "common/dna_encoder.hpp"
+#include "common/protein_encoder.hpp"
 #include "iterators/zip_iterator.hpp"
 #include "iterators/unzip_iterator.hpp"
 #include "iterators/constant_iterator.hpp"
 #include "index/quality_score_iterator.hpp"
+#include "index/quality_score_window.hpp"
 #include "containers/fsc_container_utils.hpp"
 
 namespace bliss
@@ -286,10 +294,67 @@ public:
 ////      else
 ////        return ::std::copy_if(start, end, output_iter, pred);
 //    }
-    iterator_type<SeqType> istart = begin(read, window_size);
-    iterator_type<SeqType> iend = end(read, window_size);
+    // DNA or amino acids from a contiguous char array can use the bulk encoder.
+    using use_encoder = ::std::integral_constant<bool,
+        (::std::is_same<Alphabet, ::bliss::common::DNA>::value ||
+         ::bliss::common::is_amino_acid_alphabet<Alphabet>::value) &&
+        ::bliss::common::is_contiguous_char_iterator<typename SeqType::IteratorType>::value>;
 
-    return std::copy(istart, iend, output_iter);
+    return generate(read, output_iter, use_encoder());
+  }
+
+protected:
+  /// generate kmers by reading the converted characters in blocks and shifting them into the kmer.
+  template <typename SeqType, typename OutputIt>
+  OutputIt generate(SeqType const & read, OutputIt output_iter, ::std::false_type const &) {
+    typename SeqType::IteratorType seq_begin;
+    typename SeqType::IteratorType seq_end;
+    bool has_window = false;
+
+    std::tie(seq_begin, seq_end, has_window) =
+        ::bliss::index::kmer::KmerParser<kmer_type>::get_valid_iterator_range(read, valid_range, window_size);
+
+    if (!has_window) return output_iter;
+
+    bliss::utils::file::NotEOL neol;
+    BaseCharIterator<SeqType> it(CharIter<SeqType>(neol, seq_begin, seq_end), bliss::common::ASCII2<Alphabet>());
+    BaseCharIterator<SeqType> it_end(CharIter<SeqType>(neol, seq_end), bliss::common::ASCII2<Alphabet>());
+
+    // same kmers as KmerGenerationIterator:  the first after kmer_type::size characters, then one per character.
+    typename ::std::iterator_traits<BaseCharIterator<SeqType> >::value_type buf[::bliss::iterator::BLOCK_SIZE];
+    kmer_type km(true);
+    size_t filled = 0;
+    size_t m;
+    while ((m = ::bliss::iterator::read_block(it, it_end, buf, ::bliss::iterator::BLOCK_SIZE)) > 0) {
+      size_t i = 0;
+      for (; (i < m) && (filled < (kmer_type::size - 1)); ++i, ++filled) {
+        km.nextFromChar(buf[i]);
+      }
+      for (; i < m; ++i, ++output_iter) {
+        km.nextFromChar(buf[i]);
+        *output_iter = km;
+      }
+    }
+    return output_iter;
+  }
+
+  /// generate DNA or amino acid kmers by bulk converting the characters then shifting into the kmer.
+  template <typename SeqType, typename OutputIt>
+  OutputIt generate(SeqType const & read, OutputIt output_iter, ::std::true_type const &) {
+    typename SeqType::IteratorType seq_begin;
+    typename SeqType::IteratorType seq_end;
+    bool has_window = false;
+
+    std::tie(seq_begin, seq_end, has_window) =
+        ::bliss::index::kmer::KmerParser<kmer_type>::get_valid_iterator_range(read, valid_range, window_size);
+
+    if (!has_window) return output_iter;
+
+    using Generator = typename ::std::conditional<::std::is_same<Alphabet, ::bliss::common::DNA>::value,
+        ::bliss::common::DNAKmerGenerator<kmer_type>, ::bliss::common::AAKmerGenerator<kmer_type> >::type;
+
+    unsigned char const * b = reinterpret_cast<unsigned char const *>(&(*seq_begin));
+    return Generator()(b, b + ::std::distance(seq_begin, seq_end), output_iter);
   }
 };
 
@@ -297,6 +362,79 @@ template <typename KmerType>
 constexpr size_t KmerParser<KmerType>::window_size;
 
 
+/**
+ * @brief  amino acid k-mers from DNA reads, by six frame translation.  see ::bliss::common::TranslatedKmerGenerator.
+ * @details  a k-mer spans window_size = 3k nucleotides and belongs to the block its first nucleotide is in, the same
+ *      ownership rule as KmerParser.  every nucleotide position gives 2 k-mers, 1 per strand.
+ *      only the operator() path is provided, not begin()/end().
+ * @tparam KmerType       amino acid k-mer type, e.g. Kmer<12, AA, uint64_t>.
+ */
+template <typename KmerType>
+class TranslatedKmerParser {
+
+public:
+  using value_type = KmerType;
+  using kmer_type = KmerType;
+  /// nucleotides spanned by 1 k-mer.
+  static constexpr size_t window_size = 3 * kmer_type::size;
+  /// k-mers per window position.
+  static constexpr size_t kmers_per_window = 2;
+
+protected:
+  ::bliss::partition::range<size_t> valid_range;
+
+  ::bliss::common::TranslatedKmerGenerator<kmer_type> translate;
+
+  /// copy of the characters, for sequences that are not in a contiguous char array.
+  ::std::vector<unsigned char> chars;
+
+public:
+  TranslatedKmerParser(::bliss::partition::range<size_t> const & _valid_range) : valid_range(_valid_range) {};
+
+  /**
+   * @brief generate the translated kmers of 1 sequence.  result inserted into output_iter, which may be preallocated.
+   * @param read          sequence object, which has pointers to the raw byte array.
+   * @param output_iter   output iterator pointing to insertion point for underlying container.
+   * @return new position for output_iter
+   */
+  template <typename SeqType, typename OutputIt, typename Predicate = ::bliss::filter::TruePredicate>
+  OutputIt operator()(SeqType const & read, OutputIt output_iter, Predicate const & pred = Predicate()) {
+    static_assert(std::is_same<KmerType, typename ::std::iterator_traits<OutputIt>::value_type>::value,
+            "output type and output container value type are not the same");
+
+    typename SeqType::IteratorType seq_begin;
+    typename SeqType::IteratorType seq_end;
+    bool has_window = false;
+
+    std::tie(seq_begin, seq_end, has_window) =
+        ::bliss::index::kmer::KmerParser<kmer_type>::get_valid_iterator_range(read, valid_range, window_size);
+
+    if (!has_window) return output_iter;
+
+    return generate(seq_begin, seq_end, output_iter,
+                    ::bliss::common::is_contiguous_char_iterator<typename SeqType::IteratorType>());
+  }
+
+protected:
+  template <typename Iter, typename OutputIt>
+  OutputIt generate(Iter seq_begin, Iter seq_end, OutputIt output_iter, ::std::false_type const &) {
+    chars.assign(seq_begin, seq_end);
+    return translate(chars.data(), chars.data() + chars.size(), output_iter);
+  }
+
+  template <typename Iter, typename OutputIt>
+  OutputIt generate(Iter seq_begin, Iter seq_end, OutputIt output_iter, ::std::true_type const &) {
+    unsigned char const * b = reinterpret_cast<unsigned char const *>(&(*seq_begin));
+    return translate(b, b + ::std::distance(seq_begin, seq_end), output_iter);
+  }
+};
+
+template <typename KmerType>
+constexpr size_t TranslatedKmerParser<KmerType>::window_size;
+template <typename KmerType>
+constexpr size_t TranslatedKmerParser<KmerType>::kmers_per_window;
+
+
 /**
  * @tparam TupleType       output value type of this parser.  not necessarily the same as the map's final storage type.
  */
@@ -571,8 +709,100 @@ public:
 template <typename TupleType>
 constexpr size_t KmerPositionTupleParser<TupleType>::window_size;
 
+
+/**
+ * @brief  (k-mer, position) pairs of the (W, k)-minimizers only, for a sampled position index.  see ::bliss::common::WindowedMinimizer.
+ * @details  about 2 / (W + 1) of the k-mers are kept, and a query sharing W + k - 1 characters with the reference
+ *      shares at least 1 minimizer with it, so long queries stay mappable.  the query k-mers should be sampled the
+ *      same way, with MinimizerKmerParser.  the order is the canonical ntHash, so both strands keep the same k-mers.
+ *
+ *      a minimizer window spans window_size = k + W - 1 characters and belongs to the block its first character is in.
+ *      a minimizer selected by windows from 2 blocks is output by both, so a few duplicate pairs occur at block
+ *      boundaries.  reads shorter than window_size give nothing.  only the operator() path is provided, not begin()/end().
+ * @tparam TupleType  (k-mer, position) pair, as for KmerPositionTupleParser.
+ * @tparam W          minimizer window, in k-mers.
+ */
+template <typename TupleType, unsigned int W>
+class MinimizerPositionTupleParser {
+
+public:
+  using value_type = TupleType;
+  using kmer_type = typename ::std::tuple_element<0, value_type>::type;
+  static constexpr size_t window_size = kmer_type::size + W - 1;
+
+protected:
+  KmerPositionTupleParser<TupleType> kmers;
+
+  ::bliss::common::WindowedMinimizer<kmer_type, W, ::bliss::kmer::hash::nthash<kmer_type, false, true> > select;
+
+  struct get_kmer {
+    inline kmer_type const & operator()(value_type const & x) const { return x.first; }
+  };
+
+public:
+  MinimizerPositionTupleParser(::bliss::partition::range<size_t> const & _valid_range) : kmers(_valid_range) {};
+
+  /**
+   * @brief generate the minimizer-position pairs of 1 sequence.  result inserted into output_iter, which may be preallocated.
+   * @param read          sequence object, which has pointers to the raw byte array.
+   * @param output_iter   output iterator pointing to insertion point for underlying container.
+   * @return new position for output_iter
+   */
+  template <typename SeqType, typename OutputIt, typename Predicate = ::bliss::filter::TruePredicate>
+  OutputIt operator()(SeqType const & read, OutputIt output_iter, Predicate const & pred = Predicate()) {
+    static_assert(std::is_same<TupleType, typename ::std::iterator_traits<OutputIt>::value_type>::value,
+            "output type and output container value type are not the same");
+
+    return select(kmers.begin(read, window_size), kmers.end(read, window_size), output_iter, get_kmer());
+  }
+};
+
+template <typename TupleType, unsigned int W>
+constexpr size_t MinimizerPositionTupleParser<TupleType, W>::window_size;
+
+/**
+ * @brief  the (W, k)-minimizers of the query sequences, for lookup in a MinimizerPositionTupleParser index.
+ * @details  same selection and block ownership as MinimizerPositionTupleParser.  only the operator() path is provided.
+ * @tparam KmerType   k-mer type.
+ * @tparam W          minimizer window, in k-mers.
+ */
+template <typename KmerType, unsigned int W>
+class MinimizerKmerParser {
+
+public:
+  using value_type = KmerType;
+  using kmer_type = KmerType;
+  static constexpr size_t window_size = kmer_type::size + W - 1;
+
+protected:
+  KmerParser<KmerType> kmers;
+
+  ::bliss::common::WindowedMinimizer<kmer_type, W, ::bliss::kmer::hash::nthash<kmer_type, false, true> > select;
+
+public:
+  MinimizerKmerParser(::bliss::partition::range<size_t> const & _valid_range) : kmers(_valid_range) {};
+
+  /**
+   * @brief generate the minimizers of 1 sequence.  result inserted into output_iter, which may be preallocated.
+   * @param read          sequence object, which has pointers to the raw byte array.
+   * @param output_iter   output iterator pointing to insertion point for underlying container.
+   * @return new position for output_iter
+   */
+  template <typename SeqType, typename OutputIt, typename Predicate = ::bliss::filter::TruePredicate>
+  OutputIt operator()(SeqType const & read, OutputIt output_iter, Predicate const & pred = Predicate()) {
+    static_assert(std::is_same<KmerType, typename ::std::iterator_traits<OutputIt>::value_type>::value,
+            "output type and output container value type are not the same");
+
+    return select(kmers.begin(read, window_size), kmers.end(read, window_size), output_iter);
+  }
+};
+
+template <typename KmerType, unsigned int W>
+constexpr size_t MinimizerKmerParser<KmerType, W>::window_size;
+
 /**
  * @tparam TupleType       output value type of this parser.  not necessarily the same as the map's final storage type.
+ *                         std::pair<Kmer, M>, where M is std::pair<Id, Qual> or the flat bliss::common::packed_pair<Id, Qual>.
  */
 template <typename TupleType, template<typename> class QualityEncoder = bliss::index::Illumina18QualityScoreCodec>
 class KmerPositionQualityTupleParser {
@@ -619,6 +849,10 @@ protected:
   using IdIter = bliss::iterator::AdvancingUnzipIterator<CharPosIter<SeqType>, 1>;
 
 
+  // k-mer quality storage:  probability for a QualityScoreCodec, quantized phred score for a QuantizedQualityScoreCodec.
+  static_assert(::std::is_same<typename bliss::index::quality_score_storage<QualityEncoder<QualType> >::value_type, QualType>::value,
+                "QualityEncoder output type should be the same as the index's quality type");
+
   // also remove eol from quality score
   template <typename SeqType>
   using QualIterType =
@@ -631,6 +865,11 @@ protected:
 
   ::bliss::partition::range<size_t> valid_range;
 
+  /// bulk quality scoring for contiguous reads, and its buffers.  reused across reads.
+  ::bliss::index::KmerQualityScorer<kmer_type::size, QualityEncoder<QualType> > scorer;
+  ::std::vector<QualType> quals;
+  ::std::vector<unsigned char> qual_chars;
+
 public:
   template <typename SeqType>
   using iterator_type = bliss::iterator::ZipIterator<KmerIter<SeqType>, KmerInfoIterType<SeqType> >;
@@ -644,11 +883,12 @@ public:
 	    static_assert(::std::tuple_size<value_type>::value == 2, "kmer-pos-qual index data type should be a pair");
 	    static_assert(::std::tuple_size<typename std::tuple_element<1, value_type>::type>::value == 2, "pos-qual index data type should be a pair");
 
-	  static_assert(std::is_same<typename std::iterator_traits<KmerInfoIterType<SeqType> >::value_type,
+	  // a packed_pair mapped_type is converted from the zipped std::pair.
+	  static_assert(std::is_convertible<typename std::iterator_traits<KmerInfoIterType<SeqType> >::value_type,
 	      mapped_type >::value,
 	      "kmer info input iterator and output iterator's value types differ");
 
-      static_assert(std::is_same<typename std::iterator_traits<iterator_type<SeqType> >::value_type,
+      static_assert(std::is_convertible<typename std::iterator_traits<iterator_type<SeqType> >::value_type,
                     value_type>::value,
                     "Generating iterator value type differs from expected");
 
@@ -710,11 +950,12 @@ public:
     static_assert(::std::tuple_size<typename std::tuple_element<1, value_type>::type>::value == 2, "pos-qual index data type should be a pair");
 
 
-	  static_assert(std::is_same<typename std::iterator_traits<KmerInfoIterType<SeqType> >::value_type,
+	  // a packed_pair mapped_type is converted from the zipped std::pair.
+	  static_assert(std::is_convertible<typename std::iterator_traits<KmerInfoIterType<SeqType> >::value_type,
 	      mapped_type >::value,
 	      "kmer info input iterator and output iterator's value types differ");
 
-      static_assert(std::is_same<typename std::iterator_traits<iterator_type<SeqType> >::value_type,
+      static_assert(std::is_convertible<typename std::iterator_traits<iterator_type<SeqType> >::value_type,
                     value_type>::value,
                     "Generating iterator value type differs from expected");
 
@@ -891,11 +1132,68 @@ public:
 //        return ::std::copy(index_start, index_end, output_iter);
 //    }
 
+    // reads in a contiguous char array are scored in 1 pass by KmerQualityScorer.
+    using use_scorer = ::bliss::common::is_contiguous_char_iterator<typename SeqType::IteratorType>;
+
+    return generate(read, output_iter, use_scorer());
+  }
+
+protected:
+  /// generate kmer-position-quality tuples by iterators.
+  template <typename SeqType, typename OutputIt>
+  OutputIt generate(SeqType const & read, OutputIt output_iter, ::std::false_type const &) {
     iterator_type<SeqType> istart = begin(read, window_size);
     iterator_type<SeqType> iend = end(read, window_size);
 
     return std::copy(istart, iend, output_iter);
+  }
 
+  /// generate kmer-position-quality tuples, with the quality scores of the whole read computed up front.
+  template <typename SeqType, typename OutputIt>
+  OutputIt generate(SeqType const & read, OutputIt output_iter, ::std::true_type const &) {
+    typename SeqType::IteratorType seq_begin;
+    typename SeqType::IteratorType seq_end;
+    bool has_window = false;
+
+    std::tie(seq_begin, seq_end, has_window) =
+        ::bliss::index::kmer::KmerParser<kmer_type>::get_valid_iterator_range(read, valid_range, window_size);
+
+    if (!has_window) return output_iter;
+
+    typename SeqType::IteratorType qual_begin = read.qual_begin;
+    std::advance(qual_begin, std::distance(read.seq_begin, seq_begin));
+    size_t nqual = std::distance(seq_begin, seq_end);
+
+    // quality chars, with EOL removed if there are any.
+    unsigned char const * q = reinterpret_cast<unsigned char const *>(&(*qual_begin));
+    if ((::std::memchr(q, '\n', nqual) != nullptr) || (::std::memchr(q, '\r', nqual) != nullptr)) {
+      qual_chars.clear();
+      ::std::copy_if(q, q + nqual, ::std::back_inserter(qual_chars), bliss::utils::file::NotEOL());
+      q = qual_chars.data();
+      nqual = qual_chars.size();
+    }
+    size_t nkmers = scorer(q, nqual, quals);
+
+    //== set up the kmer generating and position iterators, same as begin()
+    bliss::utils::file::NotEOL neol;
+    KmerIter<SeqType> kmer_it(BaseCharIterator<SeqType>(
+        CharIter<SeqType>(neol, seq_begin, seq_end),
+        bliss::common::ASCII2<Alphabet>()), true);
+
+    IdType seq_begin_id(read.id);
+    seq_begin_id += read.seq_begin_offset;  // change id to point to start of sequence (in file coord)
+    seq_begin_id += std::distance(read.seq_begin, seq_begin);
+    IdType seq_end_id(seq_begin_id);
+    seq_end_id += std::distance(seq_begin, seq_end);
+
+    PairedIter<SeqType> pp_begin(seq_begin, IdIterType(seq_begin_id));
+    PairedIter<SeqType> pp_end(seq_end, IdIterType(seq_end_id));
+    IdIter<SeqType> id_it(std::make_shared<CharPosIter<SeqType> >(neol, pp_begin, pp_end));
+
+    for (size_t i = 0; i < nkmers; ++i, ++kmer_it, ++id_it, ++output_iter) {
+      *output_iter = value_type(*kmer_it, mapped_type(*id_it, quals[i]));
+    }
+    return output_iter;
   }
 };
 
@@ -903,6 +1201,128 @@ template <typename TupleType, template<typename> class QualityEncoder>
 constexpr size_t KmerPositionQualityTupleParser<TupleType, QualityEncoder>::window_size;
 
 
+/**
+ * @brief  drop-in replacement for KmerPositionQualityTupleParser that walks each read once.
+ * @details  KmerPositionQualityTupleParser zips a kmer generation iterator, a position iterator and a quality score
+ *           iterator, each filtering EOL from the read on its own.  here a single loop over the sequence and quality
+ *           characters shifts each base into the kmer, records its position, and adds its log2(p_correct) to a
+ *           running sum.  the last window_size positions and partial sums are kept in small rings, so the tuple of
+ *           each kmer is written directly to the output.  same tuples as KmerPositionQualityTupleParser.
+ *           no begin()/end() iterators are provided.
+ * @tparam TupleType       output value type of this parser.  not necessarily the same as the map's final storage type.
+ *                         std::pair<Kmer, M>, where M is std::pair<Id, Qual> or the flat bliss::common::packed_pair<Id, Qual>.
+ */
+template <typename TupleType, template<typename> class QualityEncoder = bliss::index::Illumina18QualityScoreCodec>
+class FusedKmerPositionQualityTupleParser {
+
+public:
+  /// type of element generated by this parser.  since kmer itself is parameterized, this is not hard coded.
+  using value_type = TupleType;
+  using kmer_type = typename ::std::tuple_element<0, value_type>::type;
+  using mapped_type = typename ::std::tuple_element<1, value_type>::type;
+  using IdType = typename std::tuple_element<0, mapped_type >::type;
+  using QualType = typename std::tuple_element<1, mapped_type>::type;
+  static constexpr size_t window_size = kmer_type::size;
+
+protected:
+  using Alphabet = typename kmer_type::KmerAlphabet;
+
+  static_assert(::std::tuple_size<mapped_type>::value == 2, "pos-qual index data type should be a pair");
+
+  using Storage = bliss::index::quality_score_storage<QualityEncoder<QualType> >;
+  static_assert(::std::is_same<typename Storage::value_type, QualType>::value,
+                "QualityEncoder output type should be the same as the index's quality type");
+
+  ::bliss::partition::range<size_t> valid_range;
+
+  /// rings of the last window_size offsets, log2(p_correct) prefix sums and incorrect base counts.
+  size_t offsets[window_size];
+  double psums[window_size];
+  size_t pbads[window_size];
+
+public:
+  FusedKmerPositionQualityTupleParser(::bliss::partition::range<size_t> const & _valid_range) : valid_range(_valid_range) {};
+
+  /**
+   * @brief generate kmer-position-quality pairs from 1 sequence.  result inserted into output_iter, which may be preallocated.
+   * @param read          sequence object, which has pointers to the raw byte array.
+   * @param output_iter   output iterator pointing to insertion point for underlying container.
+   * @return new position for output_iter
+   * @tparam SeqType      type of sequence.  inferred.
+   * @tparam OutputIt     output iterator type, inferred.
+   */
+  template <typename SeqType, typename OutputIt, typename Predicate = ::bliss::filter::TruePredicate>
+  OutputIt operator()(SeqType const & read, OutputIt output_iter, Predicate const & pred = Predicate()) {
+    static_assert(SeqType::has_quality(), "Sequence Parser needs to support quality scores");
+    static_assert(std::is_same<TupleType, typename ::std::iterator_traits<OutputIt>::value_type>::value,
+        "output type and output container value type are not the same");
+
+    assert(::std::distance(read.seq_begin, read.seq_end) <= ::std::distance(read.qual_begin, read.qual_end));
+
+    typename SeqType::IteratorType seq_begin;
+    typename SeqType::IteratorType seq_end;
+    bool has_window = false;
+
+    std::tie(seq_begin, seq_end, has_window) =
+        ::bliss::index::kmer::KmerParser<kmer_type>::get_valid_iterator_range(read, valid_range, window_size);
+
+    if (!has_window) return output_iter;
+
+    typename SeqType::IteratorType qual_it = read.qual_begin;
+    std::advance(qual_it, std::distance(read.seq_begin, seq_begin));
+    typename SeqType::IteratorType qual_end = qual_it;
+    std::advance(qual_end, std::distance(seq_begin, seq_end));
+
+    IdType seq_begin_id(read.id);
+    seq_begin_id += read.seq_begin_offset;  // change id to point to start of sequence (in file coord)
+    seq_begin_id += std::distance(read.seq_begin, seq_begin);
+
+    bliss::utils::file::NotEOL neol;
+    bliss::common::ASCII2<Alphabet> to_val;
+    bliss::index::QualityWindowLUT<typename Storage::codec_type> const & lut =
+        bliss::index::QualityWindowLUT<typename Storage::codec_type>::get();
+
+    kmer_type km(true);
+    double psum = 0.0;
+    size_t pbad = 0;
+    size_t n = 0;    // non EOL characters so far
+    size_t r = 0;    // n % window_size
+    size_t off = 0;  // offset of the current character from seq_begin
+    for (auto it = seq_begin; it != seq_end; ++it, ++off) {
+      if (!neol(*it)) continue;
+
+      // the quality characters are filtered separately, same as the quality iterator.
+      while ((qual_it != qual_end) && !neol(*qual_it)) ++qual_it;
+      if (qual_it == qual_end) break;
+      unsigned char q = static_cast<unsigned char>(*qual_it);
+      ++qual_it;
+
+      km.nextFromChar(to_val(*it));
+      offsets[r] = off;
+      psums[r] = psum;
+      pbads[r] = pbad;
+      psum += lut.log_prob[q];
+      pbad += 1 - lut.valid[q];
+      ++n;
+      r = (r + 1 == window_size) ? 0 : r + 1;
+
+      if (n < window_size) continue;
+
+      // r is now the ring slot of the kmer's first character.
+      IdType id(seq_begin_id);
+      id += offsets[r];
+      *output_iter = value_type(km, mapped_type(id,
+          Storage::store((pbad == pbads[r]) ? ::std::exp2(psum - psums[r]) : 0.0)));
+      ++output_iter;
+    }
+    return output_iter;
+  }
+};
+
+template <typename TupleType, template<typename> class QualityEncoder>
+constexpr size_t FusedKmerPositionQualityTupleParser<TupleType, QualityEncoder>::window_size;
+
+
 /**
  * @tparam TupleType       output value type of this parser.  not necessarily the same as the map's final storage type.
  */
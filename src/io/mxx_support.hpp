@@ -26,17 +26,21 @@
 #define SRC_IO_MXX_SUPPORT_HPP_
 
 #include <mxx/datatypes.hpp>
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
 
 #include "common/kmer.hpp"
 
 //#include "utils/system_utils.hpp"
 
 #include <algorithm>  // for std::min
+#include <vector>
 
 #include <unistd.h>   // for gethostname
 
 #include "partition/range.hpp"
 #include "common/sequence.hpp"
+#include "common/packed_pair.hpp"
 
 namespace mxx {
 
@@ -140,6 +144,101 @@ namespace mxx {
     };
 
 
+  // packed, so no padding to describe.  sent as bytes.
+  template<typename A, typename B>
+    struct datatype_builder<bliss::common::packed_pair<A, B> > :
+    public datatype_contiguous<uint8_t, sizeof(bliss::common::packed_pair<A, B>)> {
+
+      typedef datatype_contiguous<uint8_t, sizeof(bliss::common::packed_pair<A, B>)> baseType;
+
+      static MPI_Datatype get_type(){
+        return baseType::get_type();
+      }
+
+      static size_t num_basic_elements() {
+        return baseType::num_basic_elements();
+      }
+    };
+
+  template<typename A, typename B>
+    struct datatype_builder<const bliss::common::packed_pair<A, B> > :
+    public datatype_contiguous<uint8_t, sizeof(bliss::common::packed_pair<A, B>)> {
+
+      typedef datatype_contiguous<uint8_t, sizeof(bliss::common::packed_pair<A, B>)> baseType;
+
+      static MPI_Datatype get_type(){
+        return baseType::get_type();
+      }
+
+      static size_t num_basic_elements() {
+        return baseType::num_basic_elements();
+      }
+    };
+
+  template<typename W>
+    struct datatype_builder<bliss::common::PackedSequenceKmerId<W> > :
+    public datatype_builder<W> {
+
+      typedef datatype_builder<W> baseType;
+
+      static MPI_Datatype get_type(){
+        return baseType::get_type();
+      }
+
+      static size_t num_basic_elements() {
+        return baseType::num_basic_elements();
+      }
+    };
+
+
+  template<typename W>
+    struct datatype_builder<const bliss::common::PackedSequenceKmerId<W> > :
+    public datatype_builder<W> {
+
+      typedef datatype_builder<W> baseType;
+
+      static MPI_Datatype get_type(){
+        return baseType::get_type();
+      }
+
+      static size_t num_basic_elements() {
+        return baseType::num_basic_elements();
+      }
+    };
+
+
+  template<typename W, unsigned int B>
+    struct datatype_builder<bliss::common::ReadKmerId<W, B> > :
+    public datatype_builder<W> {
+
+      typedef datatype_builder<W> baseType;
+
+      static MPI_Datatype get_type(){
+        return baseType::get_type();
+      }
+
+      static size_t num_basic_elements() {
+        return baseType::num_basic_elements();
+      }
+    };
+
+
+  template<typename W, unsigned int B>
+    struct datatype_builder<const bliss::common::ReadKmerId<W, B> > :
+    public datatype_builder<W> {
+
+      typedef datatype_builder<W> baseType;
+
+      static MPI_Datatype get_type(){
+        return baseType::get_type();
+      }
+
+      static size_t num_basic_elements() {
+        return baseType::num_basic_elements();
+      }
+    };
+
+
   template<typename T>
     struct datatype_builder<bliss::partition::range<T> > : 
     public datatype_contiguous<T , 
@@ -180,6 +279,29 @@ namespace mxx {
 }  // namespace mxx
 
 
+namespace bliss {
+  namespace io {
+
+    /**
+     * @brief  set the PackedSequenceKmerId<W> field widths from the largest local file id, sequence id and position in
+     *         sequence, reduced over comm so that all ranks use the same layout.  collective.
+     */
+    template <typename W>
+    void set_packed_id_layout(size_t const & max_file_id, size_t const & max_seq_id, size_t const & max_pos_in_seq,
+                              ::mxx::comm const & comm) {
+      std::vector<size_t> maxima = {max_file_id, max_seq_id, max_pos_in_seq};
+      if (comm.size() > 1) {
+        maxima = ::mxx::allreduce(maxima, [](size_t const & x, size_t const & y) {
+          return ::std::max(x, y);
+        }, comm);
+      }
+      ::bliss::common::PackedSequenceKmerId<W>::set_layout(maxima[0], maxima[1], maxima[2]);
+    }
+
+  }  // namespace io
+}  // namespace bliss
+
+
 //std::ostream &operator<<(std::ostream &os, uint8_t const &t) {
 //  return os << static_cast<uint32_t>(t);
 //}
@@ -0,0 +1,693 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    object_file.hpp
+ * @ingroup io
+ * @author  tpan
+ * @brief   reader for objects in S3 or GCS compatible object storage, using concurrent HTTP range requests.
+ * @details object_file reads a byte range as chunk_bytes sized "Range: bytes=" GETs, with up to "connections" requests
+ *          in flight on a pool of keep-alive connections.  each chunk is received directly into its place in the output.
+ *          read_range is safe to call concurrently, so prefetching_reader can parse one block while the requests for the
+ *          next blocks are in flight.
+ *
+ *          parallel::object_file<FileParser> is partitioned_file with object_file as the FileReader and
+ *          parallel::object_base_file as the base, which gets the object size on rank 0 and broadcasts it.  each rank then
+ *          requests only its partition plus overlap, and the FASTQParser and FASTAParser specializations of partitioned_file
+ *          find the record boundaries as they do for a local file.  so the input does not need to be staged to a
+ *          shared file system first.
+ *
+ *          urls:
+ *            http://host[:port]/path[?query]   e.g. a presigned url, or a MinIO or Ceph gateway.
+ *            s3://bucket/key                   path style request to BLISS_S3_ENDPOINT, default http://s3.amazonaws.com
+ *            gs://bucket/key                   request to BLISS_GCS_ENDPOINT, default http://storage.googleapis.com
+ *          BLISS_OBJECT_AUTHORIZATION, if set, is sent as the Authorization header, e.g. "Bearer <token>" for GCS.
+ *          BLISS_OBJECT_CONNECTIONS and BLISS_OBJECT_CHUNK_BYTES override the defaults of 8 connections and 8MB chunks.
+ *
+ *          this is HTTP/1.1 over POSIX sockets, without dependencies.  there is no TLS and no request signing, so https urls
+ *          are rejected.  use public or presigned objects through an http endpoint (e.g. a VPC endpoint), or a local TLS proxy.
+ *          connection failures, 429 and 5xx responses are retried with exponential backoff.
+ */
+#ifndef SRC_IO_OBJECT_FILE_HPP_
+#define SRC_IO_OBJECT_FILE_HPP_
+
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include <mpi.h>
+#endif
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>     // timeval
+#include <netdb.h>        // getaddrinfo
+#include <netinet/in.h>
+#include <netinet/tcp.h>  // TCP_NODELAY
+#include <unistd.h>       // close, usleep
+#include <cerrno>
+#include <cstring>        // strerror
+#include <cstdlib>        // getenv, strtoull
+#include <cctype>         // tolower
+#include <cstdio>         // snprintf
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <sstream>
+#include <algorithm>
+#include <limits>
+
+#include "io/file.hpp"
+#include "io/io_exception.hpp"
+#include "utils/exception_handling.hpp"
+
+namespace bliss {
+  namespace io {
+
+    /// where an object is and how to read it.  see the file comment for the url forms and environment variables.
+    struct object_location {
+        /// url as given
+        ::std::string url;
+        ::std::string host;
+        ::std::string port;
+        /// request target:  path and query.
+        ::std::string target;
+        /// value of the Authorization header.  empty for none.
+        ::std::string authorization;
+        /// maximum number of requests in flight per read_range call.
+        size_t connections;
+        /// bytes per range request.
+        size_t chunk_bytes;
+        /// attempts per request after the first.
+        size_t retries;
+
+        object_location() : connections(8), chunk_bytes(8UL << 20), retries(5) {};
+
+        /// true if url has one of the schemes handled here.  includes https, which parse rejects.
+        static bool is_object_url(::std::string const & url) {
+          size_t p = url.find("://");
+          if (p == ::std::string::npos) return false;
+          ::std::string scheme = lower(url.substr(0, p));
+          return (scheme == "http") || (scheme == "https") || (scheme == "s3") || (scheme == "gs");
+        }
+
+        /// resolve url to a host and request target.  throws IOException for unsupported or malformed urls.
+        static object_location parse(::std::string const & url) {
+          object_location loc;
+          loc.url = url;
+
+          size_t p = url.find("://");
+          if (p == ::std::string::npos)
+            throw ::bliss::utils::make_exception<::bliss::io::IOException>("ERROR: object_location: not a url: " + url);
+          ::std::string scheme = lower(url.substr(0, p));
+          ::std::string rest = url.substr(p + 3);
+
+          if (scheme == "http") {
+            split(rest, loc.host, loc.port, loc.target);
+          } else if ((scheme == "s3") || (scheme == "gs")) {
+            size_t slash = rest.find('/');
+            if ((slash == ::std::string::npos) || (slash == 0) || (slash + 1 == rest.size()))
+              throw ::bliss::utils::make_exception<::bliss::io::IOException>("ERROR: object_location: expected " + scheme + "://bucket/key: " + url);
+
+            char const * env = getenv((scheme == "s3") ? "BLISS_S3_ENDPOINT" : "BLISS_GCS_ENDPOINT");
+            ::std::string endpoint = (env != nullptr) ? ::std::string(env) :
+                ((scheme == "s3") ? ::std::string("http://s3.amazonaws.com") : ::std::string("http://storage.googleapis.com"));
+            if (lower(endpoint.substr(0, 7)) != "http://")
+              throw ::bliss::utils::make_exception<::bliss::io::IOException>("ERROR: object_location: endpoint must be an http url: " + endpoint);
+
+            ::std::string prefix;
+            split(endpoint.substr(7), loc.host, loc.port, prefix);
+            while ((prefix.size() > 0) && (prefix.back() == '/')) prefix.pop_back();
+            loc.target = prefix + "/" + rest.substr(0, slash) + "/" + encode(rest.substr(slash + 1));
+          } else if (scheme == "https") {
+            throw ::bliss::utils::make_exception<::bliss::io::IOException>("ERROR: object_location: https is not supported.  "
+                "use an http endpoint or a local TLS proxy: " + url);
+          } else {
+            throw ::bliss::utils::make_exception<::bliss::io::IOException>("ERROR: object_location: unsupported scheme: " + url);
+          }
+
+          if (loc.host.size() == 0)
+            throw ::bliss::utils::make_exception<::bliss::io::IOException>("ERROR: object_location: no host in url: " + url);
+
+          char const * env = getenv("BLISS_OBJECT_AUTHORIZATION");
+          if (env != nullptr) loc.authorization = env;
+          env = getenv("BLISS_OBJECT_CONNECTIONS");
+          if ((env != nullptr) && (strtoull(env, nullptr, 10) > 0)) loc.connections = strtoull(env, nullptr, 10);
+          env = getenv("BLISS_OBJECT_CHUNK_BYTES");
+          if ((env != nullptr) && (strtoull(env, nullptr, 10) > 0)) loc.chunk_bytes = strtoull(env, nullptr, 10);
+
+          return loc;
+        }
+
+      protected:
+        static ::std::string lower(::std::string s) {
+          ::std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c){ return ::tolower(c); });
+          return s;
+        }
+
+        /// split "host[:port][/target]".  port defaults to 80 and target to "/".
+        static void split(::std::string const & s, ::std::string & host, ::std::string & port, ::std::string & target) {
+          size_t slash = s.find_first_of("/?");
+          ::std::string authority = s.substr(0, slash);
+          target = (slash == ::std::string::npos) ? ::std::string("/") : s.substr(slash);
+          if (target[0] == '?') target = "/" + target;
+
+          // [v6 address]:port
+          size_t colon = authority.rfind(':');
+          size_t bracket = authority.rfind(']');
+          if ((colon != ::std::string::npos) && ((bracket == ::std::string::npos) || (colon > bracket))) {
+            host = authority.substr(0, colon);
+            port = authority.substr(colon + 1);
+          } else {
+            host = authority;
+            port = "80";
+          }
+          if ((host.size() > 1) && (host.front() == '[') && (host.back() == ']')) host = host.substr(1, host.size() - 2);
+        }
+
+        /// percent encode an object key, keeping '/'.
+        static ::std::string encode(::std::string const & key) {
+          ::std::string out;
+          char buf[4];
+          for (unsigned char c : key) {
+            if (::isalnum(c) || (c == '-') || (c == '_') || (c == '.') || (c == '~') || (c == '/')) {
+              out.push_back(c);
+            } else {
+              snprintf(buf, 4, "%%%02X", c);
+              out.append(buf);
+            }
+          }
+          return out;
+        }
+    };
+
+
+    namespace http {
+
+      /// a failure that may not recur on a new connection:  network errors, timeouts, 429 and 5xx responses.
+      class transient_error : public ::std::runtime_error {
+        public:
+          explicit transient_error(::std::string const & msg) : ::std::runtime_error(msg) {};
+      };
+
+      /// status and the headers of a response that object_file uses.
+      struct response {
+          int status;
+          /// max size_t if absent, e.g. chunked.
+          size_t content_length;
+          ::std::string content_range;
+          bool keep_alive;
+      };
+
+      /// one HTTP/1.1 client connection.  not thread safe.
+      class connection {
+        protected:
+          int sock;
+
+          /// bytes received past the end of the last response head.
+          ::std::string pending;
+
+          [[noreturn]] static void fail(::std::string const & op) {
+            int myerr = errno;
+            ::std::stringstream ss;
+            ss << "http " << op << " error " << myerr << ": " << strerror(myerr);
+            throw transient_error(ss.str());
+          }
+
+        public:
+          connection() : sock(-1) {};
+
+          ~connection() { this->close(); };
+
+          connection(connection const &) = delete;
+          connection & operator=(connection const &) = delete;
+
+          bool is_open() const { return sock >= 0; }
+
+          /// connect.  sends and receives time out after timeout_s seconds.
+          void open(::std::string const & host, ::std::string const & port, int const & timeout_s = 60) {
+            this->close();
+
+            struct addrinfo hints;
+            memset(&hints, 0, sizeof(hints));
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            struct addrinfo * addrs = nullptr;
+            int res = getaddrinfo(host.c_str(), port.c_str(), &hints, &addrs);
+            if (res != 0) throw transient_error("http resolve " + host + ":" + port + " error: " + gai_strerror(res));
+
+            for (struct addrinfo * a = addrs; (a != nullptr) && (sock < 0); a = a->ai_next) {
+              sock = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+              if (sock < 0) continue;
+              if (::connect(sock, a->ai_addr, a->ai_addrlen) != 0) {
+                ::close(sock);
+                sock = -1;
+              }
+            }
+            freeaddrinfo(addrs);
+            if (sock < 0) fail("connect " + host + ":" + port);
+
+            int one = 1;
+            setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            struct timeval tv;
+            tv.tv_sec = timeout_s;
+            tv.tv_usec = 0;
+            setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+            setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+          }
+
+          void close() {
+            if (sock >= 0) {
+              ::close(sock);
+              sock = -1;
+            }
+            pending.clear();
+          }
+
+          /// send a whole request.  MSG_NOSIGNAL, so a closed peer is an error instead of SIGPIPE.
+          void send_all(::std::string const & request) {
+            size_t s = 0;
+            while (s < request.size()) {
+              ssize_t count = ::send(sock, request.data() + s, request.size() - s, MSG_NOSIGNAL);
+              if (count < 0) {
+                if (errno == EINTR) continue;
+                fail("send");
+              }
+              s += count;
+            }
+          }
+
+          /// receive and parse the status line and headers.
+          response read_head() {
+            size_t end;
+            char buf[4096];
+            while ((end = pending.find("\r\n\r\n")) == ::std::string::npos) {
+              if (pending.size() > (64UL << 10)) throw ::bliss::utils::make_exception<::bliss::io::IOException>("ERROR: http response head too long");
+              ssize_t count = ::recv(sock, buf, sizeof(buf), 0);
+              if (count < 0) {
+                if (errno == EINTR) continue;
+                fail("recv");
+              }
+              if (count == 0) throw transient_error("http connection closed before response");
+              pending.append(buf, count);
+            }
+
+            ::std::string head = pending.substr(0, end + 2);
+            pending.erase(0, end + 4);
+
+            response resp;
+            resp.status = 0;
+            resp.content_length = ::std::numeric_limits<size_t>::max();
+            resp.keep_alive = true;
+
+            // "HTTP/1.1 206 Partial Content"
+            size_t eol = head.find("\r\n");
+            ::std::string line = head.substr(0, eol);
+            if ((line.compare(0, 5, "HTTP/") != 0) || (line.find(' ') == ::std::string::npos))
+              throw transient_error("http malformed status line: " + line);
+            if (line.compare(0, 8, "HTTP/1.0") == 0) resp.keep_alive = false;
+            resp.status = atoi(line.c_str() + line.find(' ') + 1);
+
+            for (size_t start = eol + 2; start < head.size(); start = eol + 2) {
+              eol = head.find("\r\n", start);
+              line = head.substr(start, eol - start);
+              size_t colon = line.find(':');
+              if (colon == ::std::string::npos) continue;
+
+              ::std::string name = line.substr(0, colon);
+              ::std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c){ return ::tolower(c); });
+              size_t vstart = line.find_first_not_of(" \t", colon + 1);
+              ::std::string value = (vstart == ::std::string::npos) ? ::std::string() : line.substr(vstart);
+
+              if (name == "content-length") resp.content_length = strtoull(value.c_str(), nullptr, 10);
+              else if (name == "content-range") resp.content_range = value;
+              else if (name == "connection") {
+                ::std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c){ return ::tolower(c); });
+                if (value.find("close") != ::std::string::npos) resp.keep_alive = false;
+                else if (value.find("keep-alive") != ::std::string::npos) resp.keep_alive = true;
+              }
+              else if (name == "transfer-encoding") resp.content_length = ::std::numeric_limits<size_t>::max();
+            }
+
+            return resp;
+          }
+
+          /// receive n bytes of body into out.  out == nullptr discards them.
+          void read_body(unsigned char * out, size_t const & n) {
+            size_t s = ::std::min(n, pending.size());
+            if (out != nullptr) memcpy(out, pending.data(), s);
+            pending.erase(0, s);
+
+            char buf[4096];
+            while (s < n) {
+              ssize_t count = (out != nullptr) ? ::recv(sock, out + s, n - s, 0) :
+                  ::recv(sock, buf, ::std::min(sizeof(buf), n - s), 0);
+              if (count < 0) {
+                if (errno == EINTR) continue;
+                fail("recv");
+              }
+              if (count == 0) throw transient_error("http connection closed in response body");
+              s += count;
+            }
+          }
+      };
+
+    } // namespace http
+
+
+    /**
+     * @brief  read only file class for an object in object storage.  see the file comment.
+     * @details  same read_range interface as posix_file, and constructible from (object_location, size), so it can
+     *           be the FileReader of partitioned_file with parallel::object_base_file.
+     */
+    class object_file : public ::bliss::io::base_file {
+
+      protected:
+        /// BASE type
+        using BASE = ::bliss::io::base_file;
+
+        object_location location;
+
+        /// idle connections, open or not.
+        ::std::vector<::std::unique_ptr<http::connection> > pool;
+        ::std::mutex pool_mutex;
+
+        ::std::atomic<size_t> n_requests;
+        ::std::atomic<size_t> n_retries;
+
+        ::std::unique_ptr<http::connection> acquire() {
+          ::std::lock_guard<::std::mutex> lock(pool_mutex);
+          if (pool.empty()) return ::std::unique_ptr<http::connection>(new http::connection());
+          ::std::unique_ptr<http::connection> c = ::std::move(pool.back());
+          pool.pop_back();
+          return c;
+        }
+
+        /// return a connection to the pool.  closed ones are dropped.
+        void release(::std::unique_ptr<http::connection> & c) {
+          if (!c->is_open()) return;
+          ::std::lock_guard<::std::mutex> lock(pool_mutex);
+          pool.emplace_back(::std::move(c));
+        }
+
+        ::std::string make_request(range_type const & r) const {
+          ::std::stringstream ss;
+          ss << "GET " << location.target << " HTTP/1.1\r\n"
+             << "Host: " << location.host << ((location.port == "80") ? ::std::string() : ":" + location.port) << "\r\n"
+             << "Range: bytes=" << r.start << "-" << (r.end - 1) << "\r\n";
+          if (location.authorization.size() > 0) ss << "Authorization: " << location.authorization << "\r\n";
+          ss << "Connection: keep-alive\r\n\r\n";
+          return ss.str();
+        }
+
+        /// parse "bytes first-last/total" or "bytes */total".  returns false if malformed.
+        static bool parse_content_range(::std::string const & value, range_type & r, size_t & total) {
+          if (value.compare(0, 6, "bytes ") != 0) return false;
+          size_t slash = value.find('/');
+          if (slash == ::std::string::npos) return false;
+          total = strtoull(value.c_str() + slash + 1, nullptr, 10);
+          if (value[6] == '*') {
+            r = range_type(0, 0);
+            return true;
+          }
+          char * next = nullptr;
+          r.start = strtoull(value.c_str() + 6, &next, 10);
+          if ((next == nullptr) || (*next != '-')) return false;
+          r.end = strtoull(next + 1, nullptr, 10) + 1;
+          return true;
+        }
+
+        /**
+         * @brief  one range request, retried on transient errors.
+         * @param r    range to get.  not empty.
+         * @param out  r.size() bytes.  nullptr to only get the object size, in which case r should be (0, 1).
+         * @return object size from the Content-Range header.
+         */
+        size_t fetch(range_type const & r, unsigned char * out) {
+          size_t attempt = 0;
+          size_t backoff_ms = 100;
+          while (true) {
+            ::std::unique_ptr<http::connection> conn = acquire();
+            bool reused = conn->is_open();
+            bool responded = false;
+            try {
+              if (!reused) conn->open(location.host, location.port);
+              conn->send_all(make_request(r));
+              http::response resp = conn->read_head();
+              responded = true;
+              ++n_requests;
+
+              range_type got;
+              size_t total = 0;
+              if (resp.status == 206) {
+                if (!parse_content_range(resp.content_range, got, total) || (got.start != r.start) || (got.end != r.end) ||
+                    (resp.content_length != r.size())) {
+                  throw ::bliss::utils::make_exception<::bliss::io::IOException>("ERROR: object_file: " + location.url +
+                      " unexpected range in response: " + resp.content_range);
+                }
+                conn->read_body(out, r.size());
+                if (!resp.keep_alive) conn->close();
+                release(conn);
+                return total;
+
+              } else if ((resp.status == 200) && (out == nullptr) && (resp.content_length != ::std::numeric_limits<size_t>::max())) {
+                // no range support.  the size is enough here, and the whole object is not worth receiving.
+                conn->close();
+                return resp.content_length;
+
+              } else if ((resp.status == 416) && (out == nullptr) && parse_content_range(resp.content_range, got, total)) {
+                // an empty object
+                if (resp.content_length == ::std::numeric_limits<size_t>::max()) conn->close();
+                else conn->read_body(nullptr, resp.content_length);
+                if (!resp.keep_alive) conn->close();
+                release(conn);
+                return total;
+
+              } else if ((resp.status == 429) || (resp.status >= 500)) {
+                ::std::stringstream ss;
+                ss << "http status " << resp.status;
+                throw http::transient_error(ss.str());
+              }
+
+              ::std::stringstream ss;
+              ss << "ERROR: object_file: " << location.url << " range " << r << " http status " << resp.status;
+              if (resp.status == 200) ss << ".  the server does not support range requests";
+              throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+
+            } catch (http::transient_error const & e) {
+              conn->close();
+
+              // a pooled connection the server closed while idle.  retry at once on a new one.
+              if (reused && !responded) continue;
+
+              if (attempt >= location.retries) {
+                ::std::stringstream ss;
+                ss << "ERROR: object_file: " << location.url << " range " << r << " failed after " << (attempt + 1) << " attempts: " << e.what();
+                throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+              }
+              ++attempt;
+              ++n_retries;
+              usleep(backoff_ms * 1000UL);
+              backoff_ms = ::std::min(backoff_ms * 2, 10000UL);
+            }
+          }
+        }
+
+      public:
+        // this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
+        using BASE::read_range;
+
+        /**
+         * @brief  read a range as concurrent range requests of chunk_bytes each.  safe to call concurrently.
+         * @param range_bytes range to read, in bytes
+         * @param output    vector containing data as bytes.
+         * @return  the range for the read data.
+         */
+        virtual range_type read_range(typename ::bliss::io::file_data::container & output, range_type const & range_bytes) {
+          range_type target = BASE::range_type::intersect(this->file_range_bytes, range_bytes);
+
+          output.resize(target.size());
+          if (target.size() == 0) return target;
+
+          size_t chunk = location.chunk_bytes;
+          size_t nchunks = (target.size() + chunk - 1) / chunk;
+          size_t nthreads = ::std::min(location.connections, nchunks);
+
+          ::std::atomic<size_t> next(0);
+          ::std::atomic<bool> failed(false);
+          ::std::exception_ptr error;
+          ::std::mutex error_mutex;
+
+          auto work = [&]() {
+            size_t i;
+            while (!failed.load() && ((i = next.fetch_add(1)) < nchunks)) {
+              range_type r(target.start + i * chunk, ::std::min(target.start + (i + 1) * chunk, target.end));
+              try {
+                fetch(r, output.data() + (r.start - target.start));
+              } catch (...) {
+                ::std::lock_guard<::std::mutex> lock(error_mutex);
+                if (!error) error = ::std::current_exception();
+                failed.store(true);
+              }
+            }
+          };
+
+          ::std::vector<::std::thread> threads;
+          for (size_t t = 1; t < nthreads; ++t) threads.emplace_back(work);
+          work();
+          for (auto & t : threads) t.join();
+
+          if (error) ::std::rethrow_exception(error);
+
+          return target;
+        }
+
+        /**
+         * @brief  open an object.  gets its size with a 1 byte range request.
+         * @param _location   object location, e.g. from object_location::parse, with connections and chunk_bytes set.
+         */
+        object_file(object_location const & _location) :
+          BASE(static_cast<int>(-1), static_cast<size_t>(0)), location(_location), n_requests(0), n_retries(0) {
+          this->filename = location.url;
+          this->file_range_bytes.end = this->get_object_size();
+        };
+
+        /**
+         * @brief  open an object.  see object_location for the url forms.
+         * @param _url   object url
+         */
+        object_file(::std::string const & _url) : object_file(object_location::parse(_url)) {};
+
+        /**
+         * @brief  open an object of known size.  for use by a parallel file (composition pattern)
+         * @param _location   object location
+         * @param _file_size  previously obtained object size.
+         */
+        object_file(object_location const & _location, size_t const & _file_size) :
+          BASE(static_cast<int>(-1), _file_size), location(_location), n_requests(0), n_retries(0) {
+          this->filename = location.url;
+        };
+
+        /// destructor
+        virtual ~object_file() {};
+
+        // this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
+        using BASE::read_file;
+
+        /// ask the object store for the object size.
+        size_t get_object_size() {
+          return fetch(range_type(0, 1), nullptr);
+        }
+
+        object_location const & get_location() const {
+          return location;
+        }
+
+        /// number of responses received, including errors.
+        size_t requests() const {
+          return n_requests.load();
+        }
+
+        /// number of requests that were retried after a transient error.
+        size_t retries() const {
+          return n_retries.load();
+        }
+    };
+
+
+#if defined(USE_MPI)
+    namespace parallel {
+
+      /**
+       * @brief  BaseType for partitioned_file that opens an object instead of a local file.
+       * @details rank 0 gets the object size and broadcasts it.  partitioned_file constructs its FileReader, object_file,
+       *          from reader_source(), the object location.
+       */
+      class object_base_file : public ::bliss::io::parallel::base_file {
+        protected:
+          using BASE = ::bliss::io::parallel::base_file;
+
+          object_location location;
+
+          /// get object size on rank 0, then broadcast.  all ranks throw if rank 0 fails.
+          size_t get_file_size() {
+            size_t const failed = ::std::numeric_limits<size_t>::max();
+            size_t file_size = 0;
+            ::std::string error;
+
+            if (this->comm.rank() == 0) {
+              try {
+                file_size = ::bliss::io::object_file(location, 0).get_object_size();
+              } catch (::std::exception const & e) {
+                error = e.what();
+                file_size = failed;
+              }
+            }
+            if (this->comm.size() > 1)
+              MPI_Bcast(&file_size, 1, MPI_UNSIGNED_LONG, 0, this->comm);
+
+            if (file_size == failed) {
+              ::std::stringstream ss;
+              ss << "ERROR: object_base_file: rank " << this->comm.rank() << " could not get size of " << location.url;
+              if (error.size() > 0) ss << ": " << error;
+              throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+            }
+            return file_size;
+          }
+
+        public:
+          // this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
+          using BASE::read_range;
+
+          /// argument for the FileReader's constructor.  hides base_file::reader_source, the file descriptor.
+          object_location const & reader_source() const {
+            return location;
+          }
+
+          /**
+           * @brief constructor
+           * @param _url    object url.  see object_location.
+           * @param _comm   MPI communicator to use.
+           */
+          object_base_file(::std::string const & _url, ::mxx::comm const & _comm = ::mxx::comm()) :
+            BASE(_comm), location(object_location::parse(_url)) {
+            this->filename = _url;
+            this->file_range_bytes.end = this->get_file_size();
+          };
+
+          /// destructor
+          virtual ~object_base_file() {};
+
+          // this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
+          using BASE::read_file;
+      };
+
+      /// parallel reader for an object in object storage:  block partition with overlap, and FASTQ/FASTA record boundaries.
+      template <template <typename> class FileParser = ::bliss::io::BaseFileParser >
+      using object_file = ::bliss::io::parallel::partitioned_file<::bliss::io::object_file, FileParser,
+                                                                  ::bliss::io::parallel::object_base_file>;
+
+    } // namespace parallel
+#endif
+
+  } // namespace io
+} // namespace bliss
+
+#endif /* SRC_IO_OBJECT_FILE_HPP_ */
@@ -0,0 +1,252 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    packed_read_store.hpp
+ * @ingroup io
+ * @author  tpan
+ * @brief   the reads of a rank, packed once at parse time, for building several k-mer indices without the file data.
+ * @details PackedReadStore holds the part of each read that KmerParser would generate k-mers from (i.e. trimmed to the
+ *          rank's valid range with a k-1 overlap), packed in a PackedSequenceArena, plus the sequence id of each read.
+ *          KmerFileHelper::read_file_to_store fills it and releases the file data (read_file_2bit fills it from a UCSC
+ *          .2bit file), and Index::build(store) generates the parser's tuples from it, so a k-mer, count and position
+ *          index can be built from one parse at about a quarter of the ASCII footprint for DNA.
+ *
+ *          the generated tuples are the same as from the file:
+ *            KmerParser                  k-mers
+ *            KmerCountTupleParser        (k-mer, 1)
+ *            KmerPositionTupleParser     (k-mer, id), id from the read id and the source position, EOL accounted for.
+ *          quality scores and the non-ACGT characters are not kept, so the quality and de Bruijn parsers are not supported.
+ *
+ *          the trimming depends on k, so the store can only generate k-mers of the size it was built for.
+ */
+#ifndef SRC_IO_PACKED_READ_STORE_HPP_
+#define SRC_IO_PACKED_READ_STORE_HPP_
+
+#include <vector>
+#include <algorithm>  // max
+#include <tuple>
+#include <stdexcept>
+#include <type_traits>
+
+#include "common/sequence.hpp"
+#include "common/packed_sequence_arena.hpp"
+#include "io/kmer_parser.hpp"
+
+namespace bliss
+{
+  namespace io
+  {
+
+    /**
+     * @brief  packed reads of this rank, with their sequence ids.
+     * @tparam ALPHABET   alphabet of the k-mers to generate.
+     */
+    template <typename ALPHABET>
+    class PackedReadStore {
+      public:
+        using arena_type = ::bliss::common::PackedSequenceArena<ALPHABET>;
+        using id_type = ::bliss::common::SequenceId;
+
+      protected:
+        /// packed reads
+        arena_type arena;
+
+        /// id of the read each packed sequence came from.
+        std::vector<id_type> ids;
+
+        /// k-mer size the reads were trimmed for.  0 if empty.
+        size_t window;
+
+        /// id of a new read, trimmed for k-mers of size k.
+        void add_read(id_type const & id, size_t k) {
+          if ((ids.size() > 0) && (k != window))
+            throw std::invalid_argument("PackedReadStore: reads are already trimmed for a different k-mer size.");
+          window = k;
+          ids.emplace_back(id);
+        }
+
+        /// k-mers of size window only.
+        template <typename KmerType>
+        void check_kmer() const {
+          static_assert(::std::is_same<typename KmerType::KmerAlphabet, ALPHABET>::value, "kmer alphabet has to match store alphabet");
+          if ((ids.size() > 0) && (KmerType::size != window))
+            throw std::invalid_argument("PackedReadStore: reads were trimmed for a different k-mer size.");
+        }
+
+        // generate tuples for each supported parser.
+        template <typename KmerType>
+        void generate(std::vector<KmerType> & result, ::bliss::index::kmer::KmerParser<KmerType> const *) const {
+          check_kmer<KmerType>();
+          result.reserve(result.size() + arena.template num_kmers<KmerType>());
+          arena.template generate<KmerType>(::std::back_inserter(result));
+        }
+
+        template <typename TupleType>
+        void generate(std::vector<TupleType> & result, ::bliss::index::kmer::KmerCountTupleParser<TupleType> const *) const {
+          using KmerType = typename ::std::tuple_element<0, TupleType>::type;
+          using CountType = typename ::std::tuple_element<1, TupleType>::type;
+          check_kmer<KmerType>();
+
+          result.reserve(result.size() + arena.template num_kmers<KmerType>());
+          for (size_t i = 0; i < arena.size(); ++i) {
+            if (arena[i].length < KmerType::size) continue;
+            auto end = arena.template kmer_end<KmerType>(i);
+            for (auto it = arena.template kmer_begin<KmerType>(i); it != end; ++it) {
+              result.emplace_back(*it, CountType(1));
+            }
+          }
+        }
+
+        template <typename TupleType>
+        void generate(std::vector<TupleType> & result, ::bliss::index::kmer::KmerPositionTupleParser<TupleType> const *) const {
+          using KmerType = typename ::std::tuple_element<0, TupleType>::type;
+          using IdType = typename ::std::tuple_element<1, TupleType>::type;
+          check_kmer<KmerType>();
+
+          result.reserve(result.size() + arena.template num_kmers<KmerType>());
+          for (size_t i = 0; i < arena.size(); ++i) {
+            if (arena[i].length < KmerType::size) continue;
+            auto end = arena.template kmer_end<KmerType>(i);
+            size_t j = 0;
+            for (auto it = arena.template kmer_begin<KmerType>(i); it != end; ++it, ++j) {
+              // same as KmerPositionTupleParser:  the read's id, advanced to the k-mer's first character in the file.
+              IdType id(ids[i]);
+              id += arena.source_offset(i, j) - ids[i].get_pos();
+              result.emplace_back(*it, id);
+            }
+          }
+        }
+
+        template <typename TupleType, typename Parser>
+        void generate(std::vector<TupleType> &, Parser const *) const {
+          static_assert(!::std::is_same<Parser, Parser>::value,
+                        "PackedReadStore supports KmerParser, KmerCountTupleParser and KmerPositionTupleParser only.");
+        }
+
+      public:
+        PackedReadStore() : window(0) {}
+
+        /// number of reads
+        size_t size() const {
+          return ids.size();
+        }
+
+        /// k-mer size the reads were trimmed for.
+        size_t kmer_size() const {
+          return window;
+        }
+
+        /// total number of characters
+        size_t chars() const {
+          return arena.chars();
+        }
+
+        /// bytes used by the store
+        size_t bytes() const {
+          return arena.bytes() + arena.line_bytes() + arena.size() * sizeof(typename arena_type::record) +
+              ids.size() * sizeof(id_type);
+        }
+
+        /// packed reads.  e.g. for arena.generate with a different output type.
+        arena_type const & get_arena() const {
+          return arena;
+        }
+
+        /// replace base j of read i with alphabet value v, e.g. a correction.  the id and the trimming are unchanged.
+        void set_base(size_t const & i, size_t const & j, uint8_t const & v) {
+          arena.set(i, j, v);
+        }
+
+        /// id of read i
+        id_type const & get_id(size_t const & i) const {
+          return ids[i];
+        }
+
+        /**
+         * @brief  largest file id, sequence id (file position of a record) and k-mer offset from its record start, over the
+         *         local reads.  the input to ::bliss::io::set_packed_id_layout, for PackedSequenceKmerId positions.
+         */
+        void id_maxima(size_t & max_file_id, size_t & max_seq_id, size_t & max_pos_in_seq) const {
+          max_file_id = 0;
+          max_seq_id = 0;
+          max_pos_in_seq = 0;
+          for (size_t i = 0; i < ids.size(); ++i) {
+            max_file_id = ::std::max(max_file_id, static_cast<size_t>(ids[i].file_id));
+            max_seq_id = ::std::max(max_seq_id, ids[i].get_pos());
+            if (arena[i].length == 0) continue;
+            // the last character bounds the first character of the last k-mer.
+            max_pos_in_seq = ::std::max(max_pos_in_seq, arena.source_offset(i, arena[i].length - 1) - ids[i].get_pos());
+          }
+        }
+
+        /// reserve space for approximately n_chars characters in n_reads reads.
+        void reserve(size_t const & n_chars, size_t const & n_reads) {
+          arena.reserve(n_chars, n_reads);
+          ids.reserve(n_reads);
+        }
+
+        void clear() {
+          arena.clear();
+          ids.clear();
+          window = 0;
+        }
+
+        /**
+         * @brief  append the ASCII read [begin, end), already trimmed for k-mers of size k.
+         * @param offset   source position of begin.
+         * @param id       id of the read, which points to the start of its record.
+         */
+        template <typename Iter>
+        size_t append(Iter begin, Iter end, size_t const & offset, id_type const & id, size_t k) {
+          add_read(id, k);
+          return arena.append(begin, end, offset);
+        }
+
+        /// append a read of alphabet values.  see PackedSequenceArena::append_values
+        template <typename ValIter>
+        size_t append_values(ValIter begin, ValIter end, size_t const & offset, id_type const & id, size_t k) {
+          add_read(id, k);
+          return arena.append_values(begin, end, offset);
+        }
+
+        /// append an already packed read.  see PackedSequenceArena::append_packed
+        size_t append_packed(uint8_t const * src, size_t const & skip, size_t const & n, size_t const & offset,
+                             id_type const & id, size_t k) {
+          add_read(id, k);
+          return arena.append_packed(src, skip, n, offset);
+        }
+
+        /// number of tuples generate<KmerParser> produces.
+        template <typename KmerType>
+        size_t num_kmers() const {
+          return arena.template num_kmers<KmerType>();
+        }
+
+        /**
+         * @brief  append the tuples that KmerParser would generate from the original reads to result.
+         * @tparam KmerParser   KmerParser, KmerCountTupleParser or KmerPositionTupleParser.
+         */
+        template <typename KmerParser>
+        void generate(std::vector<typename KmerParser::value_type> & result) const {
+          this->generate(result, static_cast<KmerParser const *>(nullptr));
+        }
+    };
+
+  } // namespace io
+} // namespace bliss
+
+#endif /* SRC_IO_PACKED_READ_STORE_HPP_ */
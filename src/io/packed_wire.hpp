@@ -0,0 +1,276 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    packed_wire.hpp
+ * @ingroup io
+ * @author  tpan
+ * @brief   compact wire format for sending k-mers and k-mer tuples.
+ * @details mxx datatype for Kmer sends whole machine words, including padding (22 bits per 21-mer in uint64_t),
+ *          and counts/positions are sent at full width.  the codecs here bit-pack k-mers to nBits,
+ *          varint (LEB128) encode unsigned integers (zigzag for signed), and copy everything else verbatim.
+ *
+ *          a bucket of elements is encoded into a byte aligned stream.  the number of elements is NOT
+ *          in the stream - the receiver knows the element counts from the count all2all.
+ *
+ *          used by imxx::packed_all2allv.
+ */
+#ifndef SRC_IO_PACKED_WIRE_HPP_
+#define SRC_IO_PACKED_WIRE_HPP_
+
+#include <cstdint>
+#include <cstring>    // memcpy
+#include <utility>    // pair
+#include <type_traits>
+#include <algorithm>
+
+#include "common/kmer.hpp"
+
+namespace bliss {
+  namespace io {
+    namespace wire {
+
+      /// little endian bit stream writer, 64 bits at a time.  caller guarantees output has room.
+      class bit_writer {
+        protected:
+          uint8_t * out;
+          uint64_t acc;
+          unsigned int nacc;
+
+        public:
+          bit_writer(uint8_t * _out) : out(_out), acc(0), nacc(0) {}
+
+          /// append lowest nbits of v.  nbits <= 64, v has no bits set above nbits.
+          inline void put(uint64_t const & v, unsigned int const & nbits) {
+            if (nbits == 0) return;
+            acc |= (v << nacc);   // nacc < 64 always.
+            if ((nacc + nbits) >= 64) {
+              memcpy(out, &acc, sizeof(uint64_t));
+              out += sizeof(uint64_t);
+              acc = (nacc == 0) ? 0 : (v >> (64 - nacc));
+              nacc = nacc + nbits - 64;
+            } else {
+              nacc += nbits;
+            }
+          }
+
+          /// flush partial bytes.  returns pointer past the last written byte.  the stream is byte aligned afterwards.
+          inline uint8_t * flush() {
+            size_t bytes = (nacc + 7) >> 3;
+            if (bytes > 0) {
+              memcpy(out, &acc, bytes);
+              out += bytes;
+            }
+            acc = 0;
+            nacc = 0;
+            return out;
+          }
+      };
+
+      /// little endian bit stream reader, matching bit_writer.  never reads past end.
+      class bit_reader {
+        protected:
+          uint8_t const * in;
+          uint8_t const * end;
+          uint64_t acc;
+          unsigned int nacc;
+
+        public:
+          bit_reader(uint8_t const * _in, uint8_t const * _end) : in(_in), end(_end), acc(0), nacc(0) {}
+
+          inline uint64_t get(unsigned int const & nbits) {
+            if (nbits == 0) return 0;
+            uint64_t mask = (nbits == 64) ? ~(0x0ULL) : ~(~(0x0ULL) << nbits);
+
+            if (nacc >= nbits) {
+              uint64_t r = acc & mask;
+              acc = (nbits == 64) ? 0 : (acc >> nbits);
+              nacc -= nbits;
+              return r;
+            }
+
+            // refill.  nacc < nbits <= 64
+            uint64_t next = 0;
+            size_t bytes = std::min(sizeof(uint64_t), static_cast<size_t>(end - in));
+            if (bytes > 0) {
+              memcpy(&next, in, bytes);
+              in += bytes;
+            }
+
+            uint64_t r = (acc | (next << nacc)) & mask;
+            unsigned int used = nbits - nacc;
+            acc = (used == 64) ? 0 : (next >> used);
+            nacc = (bytes << 3) - used;
+            return r;
+          }
+      };
+
+
+      /// default codec:  verbatim copy of the bytes.  for trivially copyable types.
+      template <typename T, typename Enable = void>
+      struct codec {
+          static constexpr bool packed = false;
+          static constexpr size_t max_bits = sizeof(T) * 8;
+
+          static inline void encode(bit_writer & w, T const & v) {
+            uint8_t const * p = reinterpret_cast<uint8_t const *>(&v);
+            size_t i = 0;
+            for (; (i + sizeof(uint64_t)) <= sizeof(T); i += sizeof(uint64_t)) {
+              uint64_t x;
+              memcpy(&x, p + i, sizeof(uint64_t));
+              w.put(x, 64);
+            }
+            if (i < sizeof(T)) {
+              uint64_t x = 0;
+              memcpy(&x, p + i, sizeof(T) - i);
+              w.put(x, (sizeof(T) - i) * 8);
+            }
+          }
+          static inline void decode(bit_reader & r, T & v) {
+            uint8_t * p = reinterpret_cast<uint8_t *>(&v);
+            size_t i = 0;
+            for (; (i + sizeof(uint64_t)) <= sizeof(T); i += sizeof(uint64_t)) {
+              uint64_t x = r.get(64);
+              memcpy(p + i, &x, sizeof(uint64_t));
+            }
+            if (i < sizeof(T)) {
+              uint64_t x = r.get((sizeof(T) - i) * 8);
+              memcpy(p + i, &x, sizeof(T) - i);
+            }
+          }
+      };
+
+      /// unsigned integers, LEB128 varint.  single byte types use the default verbatim codec.
+      template <typename T>
+      struct codec<T, typename ::std::enable_if<::std::is_integral<T>::value && ::std::is_unsigned<T>::value && (sizeof(T) > 1)>::type> {
+          static constexpr bool packed = true;
+          static constexpr size_t max_bits = ((sizeof(T) * 8 + 6) / 7) * 8;
+
+          static inline void encode(bit_writer & w, T const & v) {
+            uint64_t x = v;
+            while (x >= 0x80) {
+              w.put((x & 0x7F) | 0x80, 8);
+              x >>= 7;
+            }
+            w.put(x, 8);
+          }
+          static inline void decode(bit_reader & r, T & v) {
+            uint64_t x = 0, b;
+            unsigned int shift = 0;
+            do {
+              b = r.get(8);
+              x |= (b & 0x7F) << shift;
+              shift += 7;
+            } while (b & 0x80);
+            v = static_cast<T>(x);
+          }
+      };
+
+      /// signed integers, zigzag then LEB128 varint.
+      template <typename T>
+      struct codec<T, typename ::std::enable_if<::std::is_integral<T>::value && ::std::is_signed<T>::value && (sizeof(T) > 1)>::type> {
+          using U = typename ::std::make_unsigned<T>::type;
+          static constexpr bool packed = true;
+          static constexpr size_t max_bits = codec<U>::max_bits;
+
+          static inline void encode(bit_writer & w, T const & v) {
+            U z = (static_cast<U>(v) << 1) ^ static_cast<U>(v >> (sizeof(T) * 8 - 1));
+            codec<U>::encode(w, z);
+          }
+          static inline void decode(bit_reader & r, T & v) {
+            U z;
+            codec<U>::decode(r, z);
+            v = static_cast<T>((z >> 1) ^ (~(z & 1) + 1));
+          }
+      };
+
+      /// Kmer, bit packed to nBits.
+      template <unsigned int KMER_SIZE, typename ALPHABET, typename WORD_TYPE>
+      struct codec<::bliss::common::Kmer<KMER_SIZE, ALPHABET, WORD_TYPE>, void> {
+          using KmerType = ::bliss::common::Kmer<KMER_SIZE, ALPHABET, WORD_TYPE>;
+          static constexpr bool packed = (KmerType::nBits < sizeof(KmerType) * 8);
+          static constexpr size_t max_bits = KmerType::nBits;
+
+          static inline void encode(bit_writer & w, KmerType const & v) {
+            uint8_t const * p = reinterpret_cast<uint8_t const *>(v.getData());
+            uint64_t x;
+            for (unsigned int offset = 0; offset < KmerType::nBits; offset += 64) {
+              unsigned int bits = std::min(64U, KmerType::nBits - offset);
+              x = 0;
+              memcpy(&x, p + (offset >> 3), (bits + 7) >> 3);
+              w.put(x, bits);   // k-mer is sanitized, so no bits above nBits.
+            }
+          }
+          static inline void decode(bit_reader & r, KmerType & v) {
+            uint8_t * p = reinterpret_cast<uint8_t *>(v.getDataRef());
+            memset(p, 0, sizeof(WORD_TYPE) * KmerType::nWords);
+            uint64_t x;
+            for (unsigned int offset = 0; offset < KmerType::nBits; offset += 64) {
+              unsigned int bits = std::min(64U, KmerType::nBits - offset);
+              x = r.get(bits);
+              memcpy(p + (offset >> 3), &x, (bits + 7) >> 3);
+            }
+          }
+      };
+
+      /// pairs, e.g. k-mer count and k-mer position tuples.
+      template <typename K, typename V>
+      struct codec<::std::pair<K, V>, void> {
+          using KK = typename ::std::remove_const<K>::type;
+          static constexpr bool packed = codec<KK>::packed || codec<V>::packed;
+          static constexpr size_t max_bits = codec<KK>::max_bits + codec<V>::max_bits;
+
+          static inline void encode(bit_writer & w, ::std::pair<K, V> const & v) {
+            codec<KK>::encode(w, v.first);
+            codec<V>::encode(w, v.second);
+          }
+          static inline void decode(bit_reader & r, ::std::pair<K, V> & v) {
+            codec<KK>::decode(r, const_cast<KK &>(v.first));
+            codec<V>::decode(r, v.second);
+          }
+      };
+
+
+      /// upper bound of bytes needed to encode count elements.
+      template <typename T>
+      inline size_t max_bytes(size_t const & count) {
+        return (count * codec<T>::max_bits + 7) / 8;
+      }
+
+      /// encode [begin, end) into out, which must have max_bytes<T>(end - begin) bytes.  returns number of bytes written.
+      template <typename T>
+      inline size_t encode(T const * begin, T const * end, uint8_t * out) {
+        bit_writer w(out);
+        for (; begin != end; ++begin) {
+          codec<T>::encode(w, *begin);
+        }
+        return w.flush() - out;
+      }
+
+      /// decode count elements from [in, in_end) into out.
+      template <typename T>
+      inline void decode(uint8_t const * in, uint8_t const * in_end, size_t const & count, T * out) {
+        bit_reader r(in, in_end);
+        for (size_t i = 0; i < count; ++i, ++out) {
+          codec<T>::decode(r, *out);
+        }
+      }
+
+    } // namespace wire
+  } // namespace io
+} // namespace bliss
+
+#endif /* SRC_IO_PACKED_WIRE_HPP_ */
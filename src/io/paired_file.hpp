@@ -0,0 +1,133 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    paired_file.hpp
+ * @ingroup io
+ * @author  tpan
+ * @brief   reader for paired end FASTQ files that puts both mates of a pair on the same rank.
+ * @details R1 and R2 partitioned independently split on different records, so pair aware processing needs a shuffle.
+ *          paired_fastq_file partitions R1 on record boundaries as partitioned_file does (with the record index and
+ *          base balancing options of R1 applied), then reads the same global record indices of R2 with read_records.
+ *          with an R2 record_index sidecar that is a direct read.  without, R2's own partition is moved to the R1
+ *          record ranges, which mostly touches only the neighbors.
+ *
+ *          afterwards, the k-th record in the valid range of each file_data is pair first_record() + k.
+ *          set_pair_id gives a sequence the SequenceId of its pair:  seq_id is the pair index, file_id the mate (0 or 1),
+ *          and pos_in_file is unchanged.
+ */
+#ifndef SRC_IO_PAIRED_FILE_HPP_
+#define SRC_IO_PAIRED_FILE_HPP_
+
+#include <functional>
+#include <sstream>
+#include <string>
+
+#include "io/file.hpp"
+#include "io/fastq_loader.hpp"
+#include "io/io_exception.hpp"
+#include "utils/exception_handling.hpp"
+
+#if defined(USE_MPI)
+
+namespace bliss {
+  namespace io {
+    namespace parallel {
+
+      /**
+       * @brief  paired end FASTQ reader.  see file comment.
+       * @tparam FileReader  sequential reader, e.g. mmap_file or posix_file.
+       */
+      template <typename FileReader, typename BaseType = ::bliss::io::parallel::base_file >
+      class paired_fastq_file {
+        public:
+          using file_type = ::bliss::io::parallel::partitioned_file<FileReader, ::bliss::io::FASTQParser, BaseType>;
+
+        protected:
+          ::mxx::comm comm;
+          file_type r1;
+          file_type r2;
+
+          /// global index of the first local pair.
+          size_t first;
+          /// number of local pairs.
+          size_t count;
+
+        public:
+          /**
+           * @brief constructor.  collective.
+           * @param _file1  R1 file name
+           * @param _file2  R2 file name
+           */
+          paired_fastq_file(std::string const & _file1, std::string const & _file2, ::mxx::comm const & _comm = ::mxx::comm()) :
+            comm(_comm.copy()), r1(_file1, 0UL, comm), r2(_file2, 0UL, comm), first(0), count(0) {};
+
+          /// R1 (mate 0) or R2 (mate 1), e.g. to set the record index or base balancing options before reading.
+          file_type & get_file(uint16_t const & mate) {
+            return (mate == 0) ? r1 : r2;
+          }
+
+          /// global index of the first local pair, after read_files.
+          size_t first_record() const {
+            return first;
+          }
+
+          /// number of local pairs, after read_files.
+          size_t size() const {
+            return count;
+          }
+
+          /**
+           * @brief  read both files so that the k-th record in each output is pair first_record() + k.  collective.
+           * @throw  IOException if R1 and R2 do not have the same number of records.
+           */
+          void read_files(::bliss::io::file_data & output1, ::bliss::io::file_data & output2) {
+            r1.read_file(output1);
+            count = r1.count_records(output1);
+            first = ::mxx::exscan(count, ::std::plus<size_t>(), comm);
+            if (comm.rank() == 0) first = 0;
+
+            r2.read_records(output2, first, first + count);
+
+            size_t count2 = r2.count_records(output2);
+            // R2 records past the end of R1 stay on the last rank, so a longer R2 is caught there too.
+            if (!::mxx::all_of(count2 == count, comm)) {
+              ::std::stringstream ss;
+              ss << "ERROR : bliss::io::parallel::paired_fastq_file::read_files: R1 and R2 record counts differ on rank "
+                 << comm.rank() << ": " << count << " vs " << count2;
+              throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+            }
+          }
+
+          /**
+           * @brief  set the id of a sequence to that of its pair.
+           * @param k     position of the sequence among the records of its file_data.
+           * @param mate  0 for R1, 1 for R2.
+           */
+          template <typename SequenceType>
+          void set_pair_id(SequenceType & seq, size_t const & k, uint16_t const & mate) const {
+            seq.id.seq_id = first + k;
+            seq.id.file_id = mate;
+          }
+      };
+
+    } /* namespace parallel */
+  } /* namespace io */
+} /* namespace bliss */
+
+#endif  // USE_MPI
+
+#endif /* SRC_IO_PAIRED_FILE_HPP_ */
@@ -0,0 +1,223 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    prefetch_reader.hpp
+ * @ingroup io
+ * @author  tpan
+ * @brief   block reader that reads the next blocks of a range asynchronously while the current block is processed.
+ * @details the file readers' read_range loads a whole partition synchronously, so reading and parsing do not overlap.
+ *          prefetching_reader cuts a byte range into fixed size blocks and keeps a small ring of reusable file_data buffers.
+ *          when block i is handed out, the reads for blocks i+1 .. i+ring_size-1 are in flight.
+ *
+ *          readers that provide iread_range/wait_range (mpiio_base_file) use nonblocking, independent MPI_File_iread_at.
+ *          all other readers (posix_file, mmap_file) call read_range on a std::async thread, so read_range must be
+ *          safe to call concurrently with itself (true for pread and for per-call mmap).
+ *
+ *          blocks are NOT record aligned.  each block's valid range is the raw block, and the in memory range extends
+ *          by overlap into the next block.  the caller aligns to records, and may call extend() if a record crosses
+ *          past the overlap.
+ */
+#ifndef SRC_IO_PREFETCH_READER_HPP_
+#define SRC_IO_PREFETCH_READER_HPP_
+
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include <mpi.h>
+#endif
+
+#include <vector>
+#include <future>       // async
+#include <utility>      // declval
+#include <type_traits>
+#include <stdexcept>
+#include <algorithm>
+
+#include "io/file.hpp"
+
+namespace bliss {
+  namespace io {
+
+    /**
+     * @brief  asynchronous, double (or more) buffered block reader for a range of a file.
+     * @tparam FileReader   a file reader with read_range(container&, range), e.g. posix_file, or with iread_range/wait_range.
+     *                      reader must outlive the prefetching_reader.
+     */
+    template <typename FileReader>
+    class prefetching_reader {
+      public:
+        using range_type = ::bliss::io::file_data::range_type;
+
+      protected:
+        /// detect nonblocking read support (mpiio).
+        template <typename R>
+        static auto has_iread(int) -> decltype(::std::declval<R &>().iread_range(::std::declval<typename ::bliss::io::file_data::container &>(),
+                                                                                ::std::declval<range_type const &>()), ::std::true_type());
+        template <typename R>
+        static ::std::false_type has_iread(...);
+
+        using iread_tag = decltype(has_iread<FileReader>(0));
+
+        /// one buffer in the ring, with its outstanding read.
+        struct slot {
+            ::bliss::io::file_data block;
+            ::std::future<void> pending;
+#if defined(USE_MPI)
+            ::std::vector<MPI_Request> reqs;
+#endif
+        };
+
+        /// reader.  not owned
+        FileReader & reader;
+
+        /// range of the whole file
+        range_type file_range;
+
+        /// range to read, clipped to file.
+        range_type range;
+
+        /// block size, excluding overlap
+        size_t block_size;
+
+        /// amount to read past the end of each block
+        size_t overlap;
+
+        /// ring of buffers.  block i goes to ring[i % ring.size()]
+        ::std::vector<slot> ring;
+
+        /// number of blocks
+        size_t nblocks;
+
+        /// number of blocks handed out so far.
+        size_t curr;
+
+
+        /// thread read
+        void start_read(slot & s, range_type const & r, ::std::false_type) {
+          s.pending = ::std::async(::std::launch::async, [this, &s, r](){
+            this->reader.read_range(s.block.data, r);
+          });
+        }
+        void finish_read(slot & s, ::std::false_type) {
+          if (s.pending.valid()) s.pending.get();  // rethrows exceptions from the read thread.
+        }
+
+#if defined(USE_MPI)
+        /// nonblocking mpiio read
+        void start_read(slot & s, range_type const & r, ::std::true_type) {
+          s.reqs = reader.iread_range(s.block.data, r);
+        }
+        void finish_read(slot & s, ::std::true_type) {
+          reader.wait_range(s.reqs);
+        }
+#endif
+
+        /// issue the read for block i into its slot.
+        void start(size_t const & i) {
+          if (i >= nblocks) return;
+
+          slot & s = ring[i % ring.size()];
+
+          s.block.parent_range_bytes = file_range;
+          s.block.valid_range_bytes.start = range.start + i * block_size;
+          s.block.valid_range_bytes.end = ::std::min(s.block.valid_range_bytes.start + block_size, range.end);
+          s.block.in_mem_range_bytes = s.block.valid_range_bytes;
+          s.block.in_mem_range_bytes.end = ::std::min(s.block.valid_range_bytes.end + overlap, file_range.end);
+
+          start_read(s, s.block.in_mem_range_bytes, iread_tag());
+        }
+
+      public:
+        /**
+         * @brief constructor.  starts reading the first ring_size - 1 blocks.
+         * @param _reader       file reader
+         * @param _range        range to read, e.g. this rank's partition.  clipped to the file.
+         * @param _block_size   bytes per block, excluding overlap
+         * @param _overlap      bytes past the end of each block to also read.
+         * @param ring_size     number of buffers.  2 for double buffering.  1 reads synchronously in next().
+         */
+        prefetching_reader(FileReader & _reader, range_type const & _range, size_t const & _block_size,
+                           size_t const & _overlap = 0UL, size_t const & ring_size = 2) :
+          reader(_reader), file_range(0, _reader.size()), range(range_type::intersect(_range, file_range)),
+          block_size(_block_size), overlap(_overlap), ring(ring_size), nblocks(0), curr(0) {
+
+          if (block_size == 0) throw ::std::invalid_argument("prefetching_reader: block size must be greater than 0.");
+          if (ring_size == 0) throw ::std::invalid_argument("prefetching_reader: ring size must be greater than 0.");
+
+          nblocks = (range.size() + block_size - 1) / block_size;
+
+          for (size_t i = 0; i + 1 < ring.size(); ++i) {
+            start(i);
+          }
+        }
+
+        /// destructor.  waits for outstanding reads, since they target the ring's buffers.
+        ~prefetching_reader() {
+          for (size_t i = 0; i < ring.size(); ++i) {
+            try {
+              finish_read(ring[i], iread_tag());
+            } catch (...) {
+              // don't throw from destructor.
+            }
+          }
+        }
+
+        /// number of blocks
+        size_t size() const { return nblocks; }
+
+        /// whether there are more blocks.
+        bool has_next() const { return curr < nblocks; }
+
+        /**
+         * @brief  get the next block.  the block returned by the previous call is released and gets reused.
+         * @return the block.  valid range is the raw block, in mem range includes overlap.  caller may change valid range.
+         */
+        ::bliss::io::file_data & next() {
+          if (curr >= nblocks) throw ::std::out_of_range("prefetching_reader: no more blocks.");
+
+          // previous block's slot is free now.  fill with the farthest block.
+          start(curr + ring.size() - 1);
+
+          slot & s = ring[curr % ring.size()];
+          finish_read(s, iread_tag());
+          ++curr;
+
+          return s.block;
+        }
+
+        /**
+         * @brief  synchronously read bytes more past the end of block's in memory range, e.g. if a record crosses past the overlap.
+         * @param block   block returned by the last call to next()
+         * @param bytes   number of bytes to append.  clipped to end of file.
+         */
+        void extend(::bliss::io::file_data & block, size_t const & bytes) {
+          range_type r(block.in_mem_range_bytes.end, ::std::min(block.in_mem_range_bytes.end + bytes, file_range.end));
+          if (r.size() == 0) return;
+
+          slot tmp;
+          start_read(tmp, r, iread_tag());
+          finish_read(tmp, iread_tag());
+
+          block.data.insert(block.data.end(), tmp.block.data.begin(), tmp.block.data.end());
+          block.in_mem_range_bytes.end = r.end;
+        }
+    };
+
+  } // namespace io
+} // namespace bliss
+
+#endif /* SRC_IO_PREFETCH_READER_HPP_ */
@@ -0,0 +1,185 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    read_simulator.hpp
+ * @ingroup io
+ * @author  tpan
+ * @brief   deterministic synthetic reads, generated in memory on each rank, for reproducible scaling benchmarks.
+ * @details the genome is never materialized:  base x is a hash of (seed, x), so any rank can produce any read in
+ *          O(read length), and the genome can be much larger than the memory of a rank (e.g. for weak scaling).
+ *          read i is produced from its own random stream, seeded from (seed, i), so the global set of reads is the same
+ *          for any number of ranks.  rank r of p produces reads [r n / p, (r + 1) n / p).
+ *
+ *          knobs:
+ *            coverage          reads = coverage * genome_length / read_length.
+ *            error_rate        per base substitution probability.
+ *            repeat_fraction   fraction of the genome, in segments of repeat_length, that are copies of one of
+ *                              repeat_units repeat sequences.
+ *            skew              fraction of the reads that start in the first hot_fraction of the genome, so that a few
+ *                              k-mers are much more frequent than the rest (and hash to few ranks).
+ *          half of the reads are reverse complemented.
+ *
+ *          reads have no EOL or non-ACGT characters.  read i's record starts at file position i * (read_length + 1),
+ *          as if the reads were one per line.
+ */
+#ifndef SRC_IO_READ_SIMULATOR_HPP_
+#define SRC_IO_READ_SIMULATOR_HPP_
+
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+#include <algorithm>  // min, max
+
+#include "common/sequence.hpp"
+#include "io/packed_read_store.hpp"
+
+namespace bliss
+{
+  namespace io
+  {
+
+    /**
+     * @brief  synthetic read generator.  stateless apart from its parameters.
+     */
+    class ReadSimulator {
+      public:
+        struct params {
+            uint64_t genome_length;
+            size_t read_length;
+            double coverage;
+            double error_rate;
+            double repeat_fraction;
+            size_t repeat_length;
+            size_t repeat_units;
+            double skew;
+            double hot_fraction;
+            uint64_t seed;
+
+            params() : genome_length(1000000), read_length(100), coverage(10.0), error_rate(0.0),
+                repeat_fraction(0.0), repeat_length(500), repeat_units(16), skew(0.0), hot_fraction(0.01),
+                seed(42) {}
+        };
+
+      protected:
+        params p;
+
+        /// splitmix64 finalizer
+        static inline uint64_t mix(uint64_t x) {
+          x += 0x9E3779B97F4A7C15ULL;
+          x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+          x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+          return x ^ (x >> 31);
+        }
+
+        /// uniform in [0, 1) from the top 53 bits.
+        static inline double unit(uint64_t x) {
+          return static_cast<double>(x >> 11) * (1.0 / 9007199254740992.0);
+        }
+
+        /// random stream of one read.
+        struct stream {
+            uint64_t state;
+            inline uint64_t next() { state += 0x9E3779B97F4A7C15ULL; return mix(state); }
+        };
+
+        /// salts, so that the genome, repeat layout and reads use unrelated streams.
+        static constexpr uint64_t genome_salt = 0x67656E6F6DULL;
+        static constexpr uint64_t repeat_salt = 0x7265706561ULL;
+        static constexpr uint64_t read_salt = 0x7265616473ULL;
+
+      public:
+        ReadSimulator(params const & _p) : p(_p) {
+          if (p.read_length == 0) throw ::std::invalid_argument("ReadSimulator: read_length is 0");
+          if (p.genome_length < p.read_length) throw ::std::invalid_argument("ReadSimulator: genome shorter than a read");
+          if (p.repeat_length == 0) p.repeat_length = 1;
+          if (p.repeat_units == 0) p.repeat_units = 1;
+        }
+
+        params const & get_params() const { return p; }
+
+        /// total number of reads.
+        size_t num_reads() const {
+          return static_cast<size_t>(p.coverage * static_cast<double>(p.genome_length) / static_cast<double>(p.read_length));
+        }
+
+        /// first read of rank r of nprocs.  rank nprocs gives num_reads().
+        size_t first_read(int r, int nprocs) const {
+          size_t n = num_reads();
+          return (n / nprocs) * r + ((n % nprocs) * r) / nprocs;
+        }
+
+        /// file position of read i's record.
+        size_t record_offset(size_t i) const {
+          return i * (p.read_length + 1);
+        }
+
+        /// base (0..3) at genome position x.
+        inline uint8_t base(uint64_t x) const {
+          uint64_t seg = x / p.repeat_length;
+          uint64_t h = mix(p.seed ^ mix(seg ^ repeat_salt));
+          if (unit(h) < p.repeat_fraction) {
+            // copy of a repeat unit, which lives past the end of the genome.
+            x = p.genome_length + (h % p.repeat_units) * p.repeat_length + x % p.repeat_length;
+          }
+          return static_cast<uint8_t>((mix(p.seed ^ mix((x >> 5) ^ genome_salt)) >> ((x & 31) * 2)) & 0x3);
+        }
+
+        /// ASCII read i.
+        void read(size_t i, ::std::string & out) const {
+          stream s;
+          s.state = mix(p.seed ^ mix(i ^ read_salt));
+
+          uint64_t span = p.genome_length - p.read_length + 1;
+          uint64_t hot = ::std::max(static_cast<uint64_t>(1),
+                                    ::std::min(span, static_cast<uint64_t>(p.hot_fraction * static_cast<double>(span))));
+          uint64_t start = (unit(s.next()) < p.skew) ? (s.next() % hot) : (s.next() % span);
+          bool rc = (s.next() & 0x1) != 0;
+
+          out.resize(p.read_length);
+          for (size_t j = 0; j < p.read_length; ++j) {
+            uint8_t b = rc ? (3 - base(start + p.read_length - 1 - j)) : base(start + j);
+            if ((p.error_rate > 0.0) && (unit(s.next()) < p.error_rate)) {
+              b = static_cast<uint8_t>((b + 1 + (s.next() % 3)) & 0x3);
+            }
+            out[j] = "ACGT"[b];
+          }
+        }
+
+        /**
+         * @brief  append the reads of rank r of nprocs to store, for k-mers of size k.
+         * @return number of reads appended.
+         */
+        template <typename ALPHABET>
+        size_t fill(PackedReadStore<ALPHABET> & store, size_t k, int r, int nprocs) const {
+          size_t first = first_read(r, nprocs);
+          size_t last = first_read(r + 1, nprocs);
+
+          store.reserve((last - first) * p.read_length, last - first);
+          ::std::string seq;
+          for (size_t i = first; i < last; ++i) {
+            read(i, seq);
+            store.append(seq.begin(), seq.end(), record_offset(i),
+                         ::bliss::common::SequenceId(record_offset(i), i, 0), k);
+          }
+          return last - first;
+        }
+    };
+
+  } // namespace io
+} // namespace bliss
+
+#endif /* SRC_IO_READ_SIMULATOR_HPP_ */
@@ -0,0 +1,257 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    record_index.hpp
+ * @ingroup io
+ * @author  tpan
+ * @brief   sidecar indices of record positions, so that opening a file does not have to rediscover record boundaries.
+ * @details record_index is the bliss sidecar for record oriented files such as FASTQ, <file>.bri.  it holds the start
+ *          offset of every record, so a partitioned file can split on record boundaries by record count with 2 lookups
+ *          per rank, and with no overlap reads or boundary exchange.  layout, all little endian uint64:
+ *
+ *      magic, file size, record count, offset[0], ..., offset[count - 1]
+ *
+ *          the file size ties the index to the file it was written for.  a stale index is ignored.
+ *
+ *          fai_index reads a samtools faidx index, <file>.fai, and converts it to the
+ *          (record start, sequence start, sequence end) offsets that FASTAParser computes by scanning.
+ */
+#ifndef SRC_IO_RECORD_INDEX_HPP_
+#define SRC_IO_RECORD_INDEX_HPP_
+
+#include <fcntl.h>     // open
+#include <unistd.h>    // pread, pwrite, close
+
+#include <cstdint>
+#include <cstdio>      // rename, remove
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace bliss
+{
+  namespace io
+  {
+
+    /**
+     * @brief sidecar index of record start offsets.  see file comment for layout.
+     * @details opened read only.  entries are read with pread on demand, so a rank touches only the entries it needs.
+     */
+    class record_index {
+      public:
+        /// "BLSSRI01"
+        static constexpr uint64_t MAGIC = 0x3130495253534c42ULL;
+        /// magic, file size, count.
+        static constexpr size_t HEADER_BYTES = 3 * sizeof(uint64_t);
+
+        /// name of the sidecar for a file.
+        static std::string sidecar_name(std::string const & filename) {
+          return filename + ".bri";
+        }
+
+      protected:
+        int fd;
+        size_t file_size;
+        size_t count;
+
+      public:
+        record_index() : fd(-1), file_size(0), count(0) {}
+        ~record_index() { close(); }
+
+        record_index(record_index const & other) = delete;
+        record_index & operator=(record_index const & other) = delete;
+
+        /**
+         * @brief open the sidecar index of filename.
+         * @return false if there is none, or if it was written for a file of a different size.
+         */
+        bool open(std::string const & filename, size_t const & _file_size) {
+          close();
+
+          fd = ::open(sidecar_name(filename).c_str(), O_RDONLY);
+          if (fd < 0) return false;
+
+          uint64_t header[3];
+          if ((pread(fd, header, HEADER_BYTES, 0) != static_cast<ssize_t>(HEADER_BYTES)) ||
+              (header[0] != MAGIC) || (header[1] != _file_size) ||
+              (lseek(fd, 0, SEEK_END) != static_cast<off_t>(HEADER_BYTES + header[2] * sizeof(uint64_t)))) {
+            close();
+            return false;
+          }
+
+          file_size = header[1];
+          count = header[2];
+          return true;
+        }
+
+        void close() {
+          if (fd >= 0) ::close(fd);
+          fd = -1;
+          file_size = 0;
+          count = 0;
+        }
+
+        bool is_open() const {
+          return fd >= 0;
+        }
+
+        /// number of records.
+        size_t size() const {
+          return count;
+        }
+
+        /// start offset of record i.  i == size() gives the file size, i.e. the end of the last record.
+        size_t offset(size_t const & i) const {
+          if (i >= count) return file_size;
+
+          uint64_t off;
+          if (pread(fd, &off, sizeof(uint64_t), HEADER_BYTES + i * sizeof(uint64_t)) != sizeof(uint64_t))
+            return file_size;
+          return off;
+        }
+
+        /**
+         * @brief create the sidecar of filename as a temporary file, sized for count records, with the header written.
+         * @details the entries are written with write_entries, possibly by several processes, then publish renames the
+         *          temporary file, so a reader never sees a partial index.
+         * @return false if the file could not be created.
+         */
+        static bool create(std::string const & filename, size_t const & _file_size, size_t const & _count) {
+          std::string tmp = sidecar_name(filename) + ".tmp";
+          int f = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+          if (f < 0) return false;
+
+          uint64_t header[3] = { MAGIC, _file_size, _count };
+          bool ok = (pwrite(f, header, HEADER_BYTES, 0) == static_cast<ssize_t>(HEADER_BYTES)) &&
+              (ftruncate(f, HEADER_BYTES + _count * sizeof(uint64_t)) == 0);
+          ::close(f);
+
+          if (!ok) remove(tmp.c_str());
+          return ok;
+        }
+
+        /// write offsets as entries [first, first + offsets.size()) of a sidecar made by create.
+        static bool write_entries(std::string const & filename, size_t const & first, std::vector<size_t> const & offsets) {
+          if (offsets.size() == 0) return true;
+
+          int f = ::open((sidecar_name(filename) + ".tmp").c_str(), O_WRONLY);
+          if (f < 0) return false;
+
+          static_assert(sizeof(size_t) == sizeof(uint64_t), "record offsets are written as uint64_t");
+          size_t bytes = offsets.size() * sizeof(uint64_t);
+          size_t pos = HEADER_BYTES + first * sizeof(uint64_t);
+          unsigned char const * data = reinterpret_cast<unsigned char const *>(offsets.data());
+          size_t done = 0;
+          while (done < bytes) {
+            ssize_t w = pwrite(f, data + done, bytes - done, pos + done);
+            if (w <= 0) break;
+            done += w;
+          }
+          ::close(f);
+          return done == bytes;
+        }
+
+        /// make the sidecar written by create and write_entries visible, or discard it if !ok.
+        static bool publish(std::string const & filename, bool const & ok) {
+          std::string tmp = sidecar_name(filename) + ".tmp";
+          if (ok && (rename(tmp.c_str(), sidecar_name(filename).c_str()) == 0)) return true;
+          remove(tmp.c_str());
+          return false;
+        }
+    };
+
+
+    /**
+     * @brief samtools faidx index.  one line per record:  name, length, offset, line bases, line width.
+     */
+    class fai_index {
+      public:
+        /// record start, sequence start, sequence end.  same meaning as in FASTAParser.
+        using offsets_type = ::std::tuple<size_t, size_t, size_t>;
+
+        /// name of the index for a file.
+        static std::string sidecar_name(std::string const & filename) {
+          return filename + ".fai";
+        }
+
+      protected:
+        struct entry {
+            size_t length;
+            size_t offset;
+            size_t line_bases;
+            size_t line_width;
+        };
+        std::vector<entry> entries;
+
+      public:
+
+        /// read the .fai of filename.  returns false if there is none or it is malformed.
+        bool open(std::string const & filename) {
+          entries.clear();
+
+          std::ifstream in(sidecar_name(filename));
+          if (!in.good()) return false;
+
+          std::string line, name;
+          while (std::getline(in, line)) {
+            if (line.empty()) continue;
+            std::istringstream ss(line);
+            entry e;
+            if (!(ss >> name >> e.length >> e.offset >> e.line_bases >> e.line_width) ||
+                (e.line_bases == 0) || (e.line_width < e.line_bases)) {
+              entries.clear();
+              return false;
+            }
+            entries.emplace_back(e);
+          }
+          return entries.size() > 0;
+        }
+
+        size_t size() const {
+          return entries.size();
+        }
+
+        /**
+         * @brief offsets of each record in a file of size file_size.
+         * @details a record's sequence part ends after the eol of its last line, which is where the next record's header
+         *          starts.  the last record ends at the end of the file.
+         */
+        std::vector<offsets_type> records(size_t const & file_size) const {
+          std::vector<offsets_type> result;
+          result.reserve(entries.size());
+
+          size_t record_start = 0;
+          for (size_t i = 0; i < entries.size(); ++i) {
+            entry const & e = entries[i];
+            size_t rem = e.length % e.line_bases;
+            size_t seq_end = e.offset + (e.length / e.line_bases) * e.line_width +
+                ((rem == 0) ? 0 : (rem + e.line_width - e.line_bases));
+            if ((i + 1) == entries.size()) seq_end = file_size;
+
+            result.emplace_back(record_start, e.offset, seq_end);
+            record_start = seq_end;
+          }
+          return result;
+        }
+    };
+
+  } /* namespace io */
+} /* namespace bliss */
+
+#endif /* SRC_IO_RECORD_INDEX_HPP_ */
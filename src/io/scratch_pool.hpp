@@ -0,0 +1,237 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    scratch_pool.hpp
+ * @ingroup io
+ * @author  tpan
+ * @brief   per communicator pool of scratch vectors, reused across distribute and query calls.
+ * @details each distribute, find and count call needs temporary vectors (i2o permutation, bucketed keys, wire buffers)
+ *          that are freed at the end of the call.  in a query loop this repeats the large allocation, the unmapping,
+ *          and the first touch page faults every time.
+ *
+ *          scratch::buffer<T> leases a std::vector<T> from the pool of a communicator.  the vector comes back empty,
+ *          and goes back to the pool with its capacity when the lease ends, so the next call of the same element type
+ *          starts with memory that is already mapped and faulted.  buffer::reserve replaces a buffer that is too small
+ *          with a fresh allocation advised for transparent huge pages before first touch.
+ *
+ *          the pool is cached on the communicator as an MPI attribute and freed with it.  pool::trim releases the
+ *          idle buffers, and pool::set_limit caps the idle bytes kept.
+ */
+#ifndef SRC_IO_SCRATCH_POOL_HPP_
+#define SRC_IO_SCRATCH_POOL_HPP_
+
+#include <mpi.h>
+#include <mxx/comm.hpp>
+
+#include <sys/mman.h>  // madvise
+#include <unistd.h>    // sysconf
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <typeindex>
+#include <vector>
+
+
+namespace imxx
+{
+
+  namespace scratch
+  {
+
+    /// buffers at least this large are advised for transparent huge pages.
+    static constexpr size_t HUGEPAGE_THRESHOLD = 2UL << 20;
+
+    /// advise the page aligned part of [data, data + bytes) for transparent huge pages.  no-op where unsupported.
+    inline void advise_hugepage(void const * data, size_t const & bytes) {
+#if defined(MADV_HUGEPAGE)
+      if (bytes < HUGEPAGE_THRESHOLD) return;
+      size_t page_size = sysconf(_SC_PAGE_SIZE);
+      size_t first = (reinterpret_cast<size_t>(data) + page_size - 1) & ~(page_size - 1);
+      size_t last = (reinterpret_cast<size_t>(data) + bytes) & ~(page_size - 1);
+      if (first < last) madvise(reinterpret_cast<void*>(first), last - first, MADV_HUGEPAGE);
+#endif
+    }
+
+    /**
+     * @brief idle scratch vectors, by element type.  thread safe.
+     */
+    class pool {
+      protected:
+        struct holder_base {
+            virtual ~holder_base() {}
+            virtual size_t bytes() const = 0;
+        };
+        template <typename T>
+        struct holder : public holder_base {
+            ::std::vector<T> v;
+            virtual size_t bytes() const { return v.capacity() * sizeof(T); }
+        };
+
+        struct entry {
+            ::std::type_index type;
+            ::std::unique_ptr<holder_base> h;
+            bool in_use;
+        };
+
+        ::std::vector<entry> entries;
+        size_t limit;
+        mutable ::std::mutex mtx;
+
+        size_t idle_bytes_locked() const {
+          size_t total = 0;
+          for (auto const & e : entries) {
+            if (!e.in_use) total += e.h->bytes();
+          }
+          return total;
+        }
+
+      public:
+        pool() : limit(::std::numeric_limits<size_t>::max()) {}
+
+        pool(pool const & other) = delete;
+        pool & operator=(pool const & other) = delete;
+
+        /// get an empty vector of T, with the largest idle capacity available.
+        template <typename T>
+        ::std::vector<T> * acquire() {
+          ::std::lock_guard<::std::mutex> lock(mtx);
+          ::std::type_index t(typeid(T));
+          entry * best = nullptr;
+          for (auto & e : entries) {
+            if (e.in_use || (e.type != t)) continue;
+            if ((best == nullptr) || (e.h->bytes() > best->h->bytes())) best = &e;
+          }
+          if (best == nullptr) {
+            entries.push_back(entry{t, ::std::unique_ptr<holder_base>(new holder<T>()), false});
+            best = &(entries.back());
+          }
+          best->in_use = true;
+          ::std::vector<T> & v = static_cast<holder<T> *>(best->h.get())->v;
+          v.clear();
+          return &v;
+        }
+
+        /// return a vector from acquire.  its memory is kept unless that exceeds the idle limit.
+        template <typename T>
+        void release(::std::vector<T> * v) {
+          ::std::lock_guard<::std::mutex> lock(mtx);
+          ::std::type_index t(typeid(T));
+          for (auto & e : entries) {
+            if ((e.type != t) || (&(static_cast<holder<T> *>(e.h.get())->v) != v)) continue;
+            v->clear();
+            if ((idle_bytes_locked() + v->capacity() * sizeof(T)) > limit) ::std::vector<T>().swap(*v);
+            e.in_use = false;
+            return;
+          }
+        }
+
+        /// free the memory of all idle buffers.
+        void trim() {
+          ::std::lock_guard<::std::mutex> lock(mtx);
+          size_t j = 0;
+          for (size_t i = 0; i < entries.size(); ++i) {
+            if (entries[i].in_use) {
+              if (i != j) entries[j] = ::std::move(entries[i]);
+              ++j;
+            }
+          }
+          entries.erase(entries.begin() + j, entries.end());
+        }
+
+        /// maximum bytes of idle buffers to keep.  buffers returned beyond that are freed.
+        void set_limit(size_t const & bytes) {
+          { ::std::lock_guard<::std::mutex> lock(mtx);
+            limit = bytes;
+          }
+          if (idle_bytes() > bytes) trim();
+        }
+
+        /// bytes held by idle buffers.
+        size_t idle_bytes() const {
+          ::std::lock_guard<::std::mutex> lock(mtx);
+          return idle_bytes_locked();
+        }
+
+        /// number of buffers, idle or leased.
+        size_t size() const {
+          ::std::lock_guard<::std::mutex> lock(mtx);
+          return entries.size();
+        }
+    };
+
+    inline int delete_pool(MPI_Comm, int, void * attr, void *) {
+      delete static_cast<pool *>(attr);
+      return MPI_SUCCESS;
+    }
+
+    /// get the scratch pool of comm, creating it on first use.  not collective.
+    inline pool & get_pool(::mxx::comm const & comm) {
+      static int keyval = MPI_KEYVAL_INVALID;
+      if (keyval == MPI_KEYVAL_INVALID) MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, delete_pool, &keyval, nullptr);
+
+      void * attr = nullptr;
+      int found = 0;
+      MPI_Comm_get_attr(comm, keyval, &attr, &found);
+      if (!found) {
+        attr = new pool();
+        MPI_Comm_set_attr(comm, keyval, attr);
+      }
+      return *static_cast<pool *>(attr);
+    }
+
+    /**
+     * @brief lease of an empty scratch vector, returned to the pool on destruction.
+     * @details  the vector may be resized and swapped with other vectors freely; whatever storage it holds at the end
+     *           of the lease goes back to the pool.
+     */
+    template <typename T>
+    class buffer {
+      protected:
+        pool & p;
+        ::std::vector<T> * v;
+
+      public:
+        explicit buffer(pool & _p) : p(_p), v(_p.template acquire<T>()) {}
+        explicit buffer(::mxx::comm const & comm) : buffer(get_pool(comm)) {}
+
+        ~buffer() {
+          p.release(v);
+        }
+
+        buffer(buffer const & other) = delete;
+        buffer & operator=(buffer const & other) = delete;
+
+        ::std::vector<T> & operator*() { return *v; }
+        ::std::vector<T> * operator->() { return v; }
+
+        /// make room for n elements without touching them.  a buffer that is too small is replaced, and a large
+        /// replacement is advised for huge pages.  the contents are discarded if the buffer grows.
+        void reserve(size_t const & n) {
+          if (v->capacity() >= n) return;
+          ::std::vector<T>().swap(*v);
+          v->reserve(n);
+          advise_hugepage(v->data(), n * sizeof(T));
+        }
+    };
+
+  } // namespace scratch
+
+} // namespace imxx
+
+#endif /* SRC_IO_SCRATCH_POOL_HPP_ */
@@ -36,8 +36,10 @@
 // C++ STL includes
 #include <iterator>
 #include <algorithm>
+#include <memory>
 #include <sstream>
 #include <type_traits>
+#include <vector>
 
 // own includes
 #include "common/sequence.hpp"
@@ -361,6 +363,145 @@ namespace bliss
 
     };
 
+
+    /**
+     * @class bliss::io::LineIndexedSequencesIterator
+     * @brief Iterator over the sequence records of a block, with all records parsed up front by Parser::index_records.
+     * @details  same traversal as SequencesIterator, but the records are found at construction, using the SIMD
+     *    EOL index of the block rather than by walking the characters of each record in operator++.
+     *    The parsed records are shared between copies of the iterator.
+     *
+     *    With WithQuality == false the quality lines are not read, and value_type has no quality scores.
+     *    Use IndexedSequencesIterator or NoQualityIndexedSequencesIterator where a
+     *    template <typename, template <typename> class> class SeqIterType is expected.
+     *
+     * @note    only FASTQParser provides index_records.  Iterator has to be contiguous.
+     * @tparam Iterator	     Base iterator type to be parsed into sequences
+     * @tparam Parser        Functoid type to parse data pointed by Iterator into sequence objects.
+     * @tparam WithQuality   whether to set the quality score iterators.
+     */
+    template<typename Iterator, template<typename> class Parser, bool WithQuality = true>
+    class LineIndexedSequencesIterator :
+      public ::std::iterator<
+            ::std::forward_iterator_tag,
+            typename Parser<Iterator>::template IndexedSequenceType<WithQuality>,
+            typename std::iterator_traits<Iterator>::difference_type
+          >
+    {
+      public:
+        using SequenceType = typename Parser<Iterator>::template IndexedSequenceType<WithQuality>;
+
+      protected:
+
+        /// type of LineIndexedSequencesIterator class
+        typedef LineIndexedSequencesIterator<Iterator, Parser, WithQuality> type;
+
+        /// all records in the block.  shared by the copies of this iterator.
+        ::std::shared_ptr<const ::std::vector<SequenceType> > records;
+
+        /// index of the current record
+        size_t pos;
+
+        /// start of the current record, or _end.  for comparison between iterators.
+        Iterator _curr;
+
+        /// end of the input data.
+        Iterator _end;
+
+        /// point _curr at the current record.
+        void set_curr() {
+          _curr = (records && (pos < records->size())) ?
+              (*records)[pos].seq_begin - (*records)[pos].seq_begin_offset : _end;
+        }
+
+      public:
+        /**
+         * @brief constructor.  parses all records in [start, end).
+         * @param f       parser functoid for parsing the data.
+         * @param start   beginning of the data to be parsed.  at the start of a record.
+         * @param end     end of the data to be parsed.
+         * @param _offset position of start in the file.
+         */
+        explicit LineIndexedSequencesIterator(const Parser<Iterator> & f, Iterator start,
+                                              Iterator end, const size_t &_offset)
+            : pos(0), _curr(start), _end(end)
+        {
+          ::std::shared_ptr<::std::vector<SequenceType> > recs = ::std::make_shared<::std::vector<SequenceType> >();
+          Parser<Iterator> parser(f);
+          parser.template index_records<WithQuality>(start, end, _offset, *recs);
+          records = recs;
+          set_curr();
+        }
+
+        /**
+         * @brief constructor, initializes with only the end.  this represents the end of the output iterator.
+         * @param end     end of the data to be parsed.
+         */
+        explicit LineIndexedSequencesIterator(Iterator end)
+            : records(), pos(0), _curr(end), _end(end) {}
+
+        LineIndexedSequencesIterator() = default;
+        LineIndexedSequencesIterator(const type& Other) = default;
+        LineIndexedSequencesIterator(type && Other) = default;
+        type& operator=(const type& Other) = default;
+        type& operator=(type && Other) = default;
+
+        /// pre increment.  no-op at end.
+        type &operator++()
+        {
+          if (_curr != _end) {
+            ++pos;
+            set_curr();
+          }
+          return *this;
+        }
+
+        /// post increment
+        type operator++(int)
+        {
+          type output(*this);
+          this->operator++();
+          return output;
+        }
+
+        /// base iterator at the start of the current record.
+        const Iterator& getBaseIterator() const
+        {
+          return _curr;
+        }
+
+        /// compares the underlying base iterator positions.
+        bool operator==(const type& rhs) const
+        {
+          return _curr == rhs._curr;
+        }
+
+        /// compares the underlying base iterator positions.
+        bool operator!=(const type& rhs) const
+        {
+          return _curr != rhs._curr;
+        }
+
+        /// dereference operator.  not valid at end.
+        SequenceType const & operator*() const
+        {
+          return (*records)[pos];
+        }
+
+        /// pointer dereference operator.  not valid at end.
+        const SequenceType *operator->() const {
+          return &((*records)[pos]);
+        }
+    };
+
+    /// line indexed records with quality scores, as SeqIterType template template argument.
+    template<typename Iterator, template<typename> class Parser>
+    using IndexedSequencesIterator = LineIndexedSequencesIterator<Iterator, Parser, true>;
+
+    /// line indexed records that skip the quality lines, for k-mer parsers that do not use quality scores.
+    template<typename Iterator, template<typename> class Parser>
+    using NoQualityIndexedSequencesIterator = LineIndexedSequencesIterator<Iterator, Parser, false>;
+
   } // iterator
 } // bliss
 #endif /* SequencesIterator_HPP_ */
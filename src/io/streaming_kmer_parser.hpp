@@ -0,0 +1,370 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    streaming_kmer_parser.hpp
+ * @ingroup io
+ * @author  tpan
+ * @brief   k-mer generation from a stream of blocks, with records allowed to span blocks.  for long reads.
+ * @details FASTQParser, FASTAParser and SequencesIterator need a whole record in memory, and the record search at
+ *          partition and block boundaries reads ahead until it has seen 4 full lines.  for 1 Mbp reads that means
+ *          megabytes of overlap per boundary, and blocks that have to grow to fit a read.
+ *
+ *          the parsers here are state machines over bytes.  the record state (which line we are in, bases so far) and
+ *          the k-mer being built are members, so a block can end anywhere, and the next block continues from the same
+ *          state.  memory is one block regardless of read length.
+ *
+ *          partitioning is by byte range [start, end).  find_start locates the first record (FASTQ) or line (FASTA)
+ *          at or after start by streaming through line lengths and first characters only.  the parser then runs
+ *          from there until parse() returns false:
+ *
+ *      FASTQ   records starting in [start, end) belong to the partition.  parse stops at the first record start >= end.
+ *              a record is 4 lines, and the quality line has as many scores as the sequence line has bases, so a
+ *              quality line beginning with '@' is never taken as a header.
+ *      FASTA   k-mers whose first base is in [start, end) belong to the partition.  records and sequences may span
+ *              partitions.  after end, the parser continues for at most k - 1 bases to complete those k-mers.
+ *
+ *          find_start for FASTQ checks lines i and i + 2 for '@' and '+', and that lines i + 1 and i + 3 have equal
+ *          length.  a sequence line cannot start with '@', and a quality line starting with '@' is followed by a
+ *          header, not a '+' line, so the match is unambiguous.
+ */
+#ifndef SRC_IO_STREAMING_KMER_PARSER_HPP_
+#define SRC_IO_STREAMING_KMER_PARSER_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>     // memchr
+#include <limits>
+#include <vector>
+
+#include "partition/range.hpp"
+
+namespace bliss
+{
+  namespace io
+  {
+
+    namespace streaming
+    {
+
+      /**
+       * @brief  stream [pos - 1, file end) through reader, and call on_line(start, length, first char) for each complete line
+       *         that starts at or after pos, until it returns true.
+       * @tparam FileReader  has size() and read_range(std::vector<unsigned char> &, range), e.g. posix_file.
+       * @return start of the line on_line accepted, or the file end.
+       */
+      template <typename FileReader, typename OnLine>
+      size_t scan_lines(FileReader & reader, size_t const & pos, size_t const & block_size, OnLine on_line) {
+        size_t file_end = reader.size();
+        if (pos == 0) return 0;
+        if (pos >= file_end) return file_end;
+
+        ::std::vector<unsigned char> buf;
+        size_t line_start = ::std::numeric_limits<size_t>::max();   // none yet:  the first partial line is skipped.
+        unsigned char first = 0;
+        bool need_first = false;
+
+        for (size_t b = pos - 1; b < file_end; b += block_size) {
+          ::bliss::partition::range<size_t> r =
+              reader.read_range(buf, ::bliss::partition::range<size_t>(b, ::std::min(b + block_size, file_end)));
+          unsigned char const * data = buf.data();
+          size_t n = r.size();
+
+          for (size_t i = 0; i < n; ) {
+            if (need_first) {
+              first = data[i];
+              need_first = false;
+            }
+            void const * eol = ::memchr(data + i, '\n', n - i);
+            if (eol == nullptr) break;
+
+            size_t q = r.start + (reinterpret_cast<unsigned char const *>(eol) - data);
+            if ((line_start != ::std::numeric_limits<size_t>::max()) && on_line(line_start, q - line_start, first))
+              return line_start;
+
+            line_start = q + 1;
+            need_first = true;
+            i = q + 1 - r.start;
+          }
+        }
+        // last line without eol.
+        if ((line_start < file_end) && on_line(line_start, file_end - line_start, first)) return line_start;
+
+        return file_end;
+      }
+
+    } /* namespace streaming */
+
+
+    /**
+     * @brief streaming FASTQ k-mer generator.  see file comment.
+     * @tparam KmerType  k-mer type.  bases are converted with its alphabet, as KmerParser does.
+     */
+    template <typename KmerType>
+    class StreamingFASTQKmerParser {
+      public:
+        using value_type = KmerType;
+
+      protected:
+        using Alphabet = typename KmerType::KmerAlphabet;
+
+        enum : uint8_t { HEADER = 0, SEQ = 1, PLUS = 2, QUAL = 3 };
+
+        KmerType km;
+        /// bases of the current read.
+        size_t seq_len;
+        /// quality scores of the current read.
+        size_t qual_len;
+        /// current line of the record.
+        uint8_t line;
+        /// next byte is the first of a line.
+        bool line_start;
+        /// file offset of the next byte.
+        size_t pos;
+        size_t records;
+
+      public:
+        /// start is a record start, e.g. from find_start.
+        explicit StreamingFASTQKmerParser(size_t const & start) :
+          km(true), seq_len(0), qual_len(0), line(HEADER), line_start(true), pos(start), records(0) {}
+
+        /// first record start at or after pos.
+        template <typename FileReader>
+        static size_t find_start(FileReader & reader, size_t const & pos, size_t const & block_size) {
+          // last 4 lines:  start, length, first char.
+          size_t starts[4];
+          size_t lens[4];
+          unsigned char firsts[4];
+          size_t count = 0;
+          size_t found = reader.size();
+          if (pos == 0) return 0;
+
+          ::bliss::io::streaming::scan_lines(reader, pos, block_size,
+              [&](size_t const & s, size_t const & len, unsigned char const & c) {
+                starts[count & 0x3] = s;
+                lens[count & 0x3] = len;
+                firsts[count & 0x3] = c;
+                ++count;
+                if (count < 4) return false;
+
+                size_t i = count & 0x3;  // oldest of the 4
+                if ((firsts[i] != '@') || (firsts[(i + 2) & 0x3] != '+') || (lens[(i + 1) & 0x3] != lens[(i + 3) & 0x3]))
+                  return false;
+                found = starts[i];
+                return true;
+              });
+          return found;
+        }
+
+        /// number of records started so far.
+        size_t size() const {
+          return records;
+        }
+
+        /// file offset of the next byte expected.
+        size_t position() const {
+          return pos;
+        }
+
+        /**
+         * @brief parse the next n bytes, which continue where the previous call ended.
+         * @param end   records starting at or after end belong to the next partition.
+         * @return false once a record starting at or after end is reached.  no more data is needed.
+         */
+        template <typename OutputIt>
+        bool parse(unsigned char const * data, size_t const & n, size_t const & end, OutputIt & out) {
+          size_t i = 0;
+          while (i < n) {
+            switch (line) {
+              case HEADER:
+                if (line_start) {
+                  // skip empty lines between records.
+                  if ((data[i] == '\n') || (data[i] == '\r')) { ++i; ++pos; continue; }
+                  if (pos >= end) return false;
+                  ++records;
+                  line_start = false;
+                }
+                // fall through
+              case PLUS:
+              {
+                // skip to the end of the line.
+                void const * eol = ::memchr(data + i, '\n', n - i);
+                size_t next = (eol == nullptr) ? n : (reinterpret_cast<unsigned char const *>(eol) - data) + 1;
+                pos += next - i;
+                i = next;
+                if (eol != nullptr) {
+                  if (line == HEADER) {
+                    line = SEQ;
+                    seq_len = 0;
+                  } else {
+                    line = QUAL;
+                    qual_len = 0;
+                  }
+                }
+                break;
+              }
+              case SEQ:
+                for (; i < n; ++i, ++pos) {
+                  unsigned char c = data[i];
+                  if (c == '\n') {
+                    line = PLUS;
+                    ++i;
+                    ++pos;
+                    break;
+                  }
+                  if (c == '\r') continue;
+
+                  km.nextFromChar(Alphabet::FROM_ASCII[c]);
+                  if (++seq_len >= KmerType::size) {
+                    *out = km;
+                    ++out;
+                  }
+                }
+                break;
+              case QUAL:
+              {
+                // the scores are skipped in bulk.  the record ends at the first eol after seq_len of them.
+                size_t skip = ::std::min(n - i, seq_len - ::std::min(seq_len, qual_len));
+                qual_len += skip;
+                pos += skip;
+                i += skip;
+                for (; i < n; ++i, ++pos) {
+                  unsigned char c = data[i];
+                  if ((c == '\n') && (qual_len >= seq_len)) {
+                    line = HEADER;
+                    line_start = true;
+                    ++i;
+                    ++pos;
+                    break;
+                  }
+                  if ((c != '\n') && (c != '\r')) ++qual_len;
+                }
+                break;
+              }
+            }
+          }
+          return true;
+        }
+    };
+
+
+    /**
+     * @brief streaming FASTA k-mer generator.  see file comment.
+     * @tparam KmerType  k-mer type.  bases are converted with its alphabet, as KmerParser does.
+     */
+    template <typename KmerType>
+    class StreamingFASTAKmerParser {
+      public:
+        using value_type = KmerType;
+
+      protected:
+        using Alphabet = typename KmerType::KmerAlphabet;
+
+        KmerType km;
+        /// bases of the current sequence seen by this parser.
+        size_t seq_len;
+        /// bases seen since passing end.
+        size_t tail;
+        /// in a header or comment line.
+        bool header;
+        /// next byte is the first of a line.
+        bool line_start;
+        /// file offset of the next byte.
+        size_t pos;
+        size_t records;
+        bool past_end;
+
+      public:
+        /// start is a line start, e.g. from find_start.
+        explicit StreamingFASTAKmerParser(size_t const & start) :
+          km(true), seq_len(0), tail(0), header(false), line_start(true), pos(start), records(0), past_end(false) {}
+
+        /// first line start at or after pos.
+        template <typename FileReader>
+        static size_t find_start(FileReader & reader, size_t const & pos, size_t const & block_size) {
+          return ::bliss::io::streaming::scan_lines(reader, pos, block_size,
+              [](size_t const &, size_t const &, unsigned char const &) { return true; });
+        }
+
+        /// number of records whose header was seen.
+        size_t size() const {
+          return records;
+        }
+
+        /// file offset of the next byte expected.
+        size_t position() const {
+          return pos;
+        }
+
+        /**
+         * @brief parse the next n bytes, which continue where the previous call ended.
+         * @param end   k-mers whose first base is at or after end belong to the next partition.
+         * @return false once the k-mers of this partition are complete.  no more data is needed.
+         */
+        template <typename OutputIt>
+        bool parse(unsigned char const * data, size_t const & n, size_t const & end, OutputIt & out) {
+          size_t i = 0;
+          while (i < n) {
+            if (line_start) {
+              if (pos >= end) past_end = true;
+              header = (data[i] == '>') || (data[i] == ';');
+              if (header) {
+                // a new record:  k-mers of this partition cannot continue past it.
+                if (past_end) return false;
+                ++records;
+                seq_len = 0;
+              }
+              line_start = false;
+            }
+
+            if (header) {
+              void const * eol = ::memchr(data + i, '\n', n - i);
+              size_t next = (eol == nullptr) ? n : (reinterpret_cast<unsigned char const *>(eol) - data) + 1;
+              pos += next - i;
+              i = next;
+              line_start = (eol != nullptr);
+              continue;
+            }
+
+            for (; i < n; ++i, ++pos) {
+              unsigned char c = data[i];
+              if (c == '\n') {
+                line_start = true;
+                ++i;
+                ++pos;
+                break;
+              }
+              if (c == '\r') continue;
+
+              // a k-mer completed by the k - 1 bases after end still starts before end.
+              if (past_end && (++tail >= KmerType::size)) return false;
+
+              km.nextFromChar(Alphabet::FROM_ASCII[c]);
+              if (++seq_len >= KmerType::size) {
+                *out = km;
+                ++out;
+              }
+            }
+          }
+          return true;
+        }
+    };
+
+  } /* namespace io */
+} /* namespace bliss */
+
+#endif /* SRC_IO_STREAMING_KMER_PARSER_HPP_ */
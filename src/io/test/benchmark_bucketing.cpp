@@ -207,6 +207,60 @@ TEST_P(BucketBenchmark, mxx_bucket)
 }
 
 
+TEST_P(BucketBenchmark, partition_inplace)
+{
+  this->unbucketed.clear();
+  this->mapping.clear();
+
+  // allocate.
+  this->bucketed.resize(this->p.input_size);
+
+  // copy
+  std::copy(this->data.begin(), this->data.end(), this->bucketed.begin());
+
+  BucketBenchmarkInfo pp = this->p;
+  auto key = [&pp](std::pair<size_t, size_t> const & x){ return x.first % pp.bucket_count; };
+
+  imxx::local::count_buckets(this->bucketed, key, this->p.bucket_count, this->bcounts, this->p.first, this->p.last);
+  imxx::local::partition_inplace(this->bucketed, key, this->bcounts, 0UL, this->p.first, this->p.last);
+}
+
+TEST_P(BucketBenchmark, bucket_inplace)
+{
+  this->unbucketed.clear();
+  this->mapping.clear();
+
+  // allocate.
+  this->bucketed.resize(this->p.input_size);
+
+  // copy
+  std::copy(this->data.begin(), this->data.end(), this->bucketed.begin());
+
+  BucketBenchmarkInfo pp = this->p;
+  auto key = [&pp](std::pair<size_t, size_t> const & x){ return x.first % pp.bucket_count; };
+
+  imxx::local::bucket_inplace(this->bucketed, key, this->p.bucket_count, this->bcounts, 0UL, this->p.first, this->p.last);
+}
+
+TEST_P(BucketBenchmark, partition_inplace_block)
+{
+  this->unbucketed.clear();
+  this->mapping.clear();
+
+  // allocate.
+  this->bucketed.resize(this->p.input_size);
+
+  // copy
+  std::copy(this->data.begin(), this->data.end(), this->bucketed.begin());
+
+  BucketBenchmarkInfo pp = this->p;
+  auto key = [&pp](std::pair<size_t, size_t> const & x){ return x.first % pp.bucket_count; };
+
+  imxx::local::count_buckets(this->bucketed, key, this->p.bucket_count, this->bcounts, this->p.first, this->p.last);
+  size_t block = *(std::min_element(this->bcounts.begin(), this->bcounts.end()));
+  imxx::local::partition_inplace(this->bucketed, key, this->bcounts, block, this->p.first, this->p.last);
+}
+
 TEST_P(BucketBenchmark, permute)
 {
 	this->unbucketed.clear();
@@ -274,6 +274,16 @@ public:
 };
 
 
+/// same layout as std::pair<size_t, int>, padding included, but sent as sizeof bytes by wire_all2allv.  no mxx datatype.
+struct blob_pair {
+    size_t first;
+    int second;
+};
+namespace bliss { namespace io { namespace wire {
+  template <>
+  struct as_bytes<blob_pair> : public ::std::true_type {};
+} } }
+
 template <typename IIT, typename OIT>
 struct copy {
     void operator()(IIT begin, IIT end, OIT out) const {
@@ -510,6 +520,38 @@ TEST_P(DistributeBenchmark, distribute_rt)
 }
 
 
+/// distribute_rt with the element sent as bytes rather than as an mxx struct datatype.
+TEST_P(DistributeBenchmark, distribute_rt_bytes)
+{
+
+  ::mxx::comm comm;
+
+  this->init(comm);
+
+  std::vector<blob_pair> input(this->data.size()), distributed, roundtripped;
+  for (size_t i = 0; i < this->data.size(); ++i) {
+    input[i].first = this->data[i].first;
+    input[i].second = this->data[i].second;
+  }
+
+  // distribute
+  int p = comm.size();
+  std::vector<size_t> recv_counts;
+  std::vector<size_t> mapping;
+
+  if (this->p.hash_type == 0)
+	  imxx::distribute(input, [&p](blob_pair const & x ){ return x.first % p; },
+					   recv_counts, mapping, distributed, comm, false);
+  else {
+	  murmurhash hs;
+	  imxx::distribute(input, [&p, &hs](blob_pair const & x ){ return hs(x.first) % p; },
+					   recv_counts, mapping, distributed, comm, false);
+  }
+
+  imxx::undistribute(distributed, recv_counts, mapping, roundtripped, comm, false);
+}
+
+
 TEST_P(DistributeBenchmark, dsc_distribute_rt)
 {
 
@@ -276,6 +276,59 @@ TEST_P(A2ADistributeTest, block_roundtrip_inplace)
 }
 
 
+TEST_P(A2ADistributeTest, rma_roundtrip)
+{
+  ::mxx::comm comm;
+
+  this->init(comm);
+
+  // allocate.
+  A2ADistributeTestInfo pp = this->p;
+
+  this->distributed.clear();
+  this->distributed.resize(pp.output_size);
+  this->roundtripped.clear();
+  this->roundtripped.resize(pp.input_size);
+
+  if ((pp.input_size == 0) || (pp.output_size == 0)) return;
+
+  std::vector<size_t> counts(comm.size(), pp.block_size);
+  imxx::rma_all2allv(this->data.data() + pp.input_offset, counts,
+                     this->distributed.data() + pp.output_offset, counts, comm);
+
+  // again, reusing the cached window.
+  imxx::rma_all2allv(this->distributed.data() + pp.output_offset, counts,
+                     this->roundtripped.data() + pp.input_offset, counts, comm);
+}
+
+
+
+TEST_P(A2ADistributeTest, packed_entry_roundtrip)
+{
+  ::mxx::comm comm;
+
+  this->init(comm);
+
+  // std::pair<size_t, int> has 4 bytes of padding.
+  static_assert(::bliss::io::wire::packs_smaller<T>::value, "test type should have padding");
+
+  A2ADistributeTestInfo pp = this->p;
+
+  this->distributed.clear();
+  this->distributed.resize(pp.output_size);
+  this->roundtripped.clear();
+  this->roundtripped.resize(pp.input_size);
+
+  if ((pp.input_size == 0) || (pp.output_size == 0)) return;
+
+  std::vector<size_t> counts(comm.size(), pp.block_size);
+  imxx::packed_entry_all2allv(this->data.data() + pp.input_offset, counts,
+                              this->distributed.data() + pp.output_offset, counts, comm);
+  imxx::packed_entry_all2allv(this->distributed.data() + pp.output_offset, counts,
+                              this->roundtripped.data() + pp.input_offset, counts, comm);
+}
+
+
 
 INSTANTIATE_TEST_CASE_P(Bliss, A2ADistributeTest, ::testing::Values(
     // base cases
@@ -312,6 +365,16 @@ struct copy {
 };
 
 
+/// same layout as std::pair<size_t, int>, padding included, but sent as sizeof bytes by wire_all2allv.  no mxx datatype.
+struct blob_pair {
+    size_t first;
+    int second;
+};
+namespace bliss { namespace io { namespace wire {
+  template <>
+  struct as_bytes<blob_pair> : public ::std::true_type {};
+} } }
+
 struct DistributeTestInfo {
     size_t input_size;
 
@@ -473,6 +536,38 @@ TEST_P(DistributeTest, distribute)
   this->roundtripped.clear();
 }
 
+TEST_P(DistributeTest, distribute_distinct)
+{
+
+  ::mxx::comm comm;
+
+  this->init(comm);
+
+  // few distinct values, repeated across ranks.
+  for (auto & x : this->data) x.first %= 1000;
+  std::vector<T> temp(this->data.begin(), this->data.end());
+  int p = comm.size();
+  std::vector<size_t> send_counts = ::mxx::bucketing(temp, [&p](T const & x ){ return x.first % p; }, p);
+  ::mxx::all2allv(temp, send_counts, comm).swap(this->gold);
+
+  // copy data into roundtripped.
+  this->roundtripped.resize(this->data.size());
+  std::copy(this->data.begin(), this->data.end(), this->roundtripped.begin());
+
+  std::vector<size_t> recv_counts;
+  std::vector<size_t> mapping;
+  double distinct = -1;
+
+  imxx::distribute(this->roundtripped, [&p](T const & x ){ return x.first % p; },
+                   recv_counts, mapping, this->distributed, comm,
+                   [](T const & x) { return static_cast<uint64_t>(x.first); }, distinct, true);
+
+  std::unordered_set<size_t> keys;
+  for (auto const & x : this->gold) keys.insert(x.first);
+  double err = ::bliss::utils::sketch::hyperloglog<imxx::distinct_sketch_precision>::error();
+  EXPECT_NEAR(static_cast<double>(keys.size()), distinct, 4.0 * err * keys.size() + 1.0);
+}
+
 
 
 TEST_P(DistributeTest, distribute_preserve_input_rt)
@@ -522,6 +617,53 @@ TEST_P(DistributeTest, distribute_rt)
   imxx::undistribute(distributed, recv_counts, mapping, this->roundtripped, comm, true);
 }
 
+TEST_P(DistributeTest, routing_plan_rt)
+{
+
+  ::mxx::comm comm;
+
+  this->init(comm);
+
+  int p = comm.size();
+  imxx::routing_plan<size_t> plan(this->data, [&p](T const & x ){ return x.first % p; }, comm);
+  EXPECT_EQ(this->data.size(), plan.size());
+
+  // route twice with the same plan.
+  plan.route(this->data, this->distributed);
+  plan.route(this->data, this->distributed);
+  EXPECT_EQ(this->distributed.size(), plan.recv_size());
+
+  plan.respond(this->distributed, this->roundtripped);
+}
+
+TEST_P(DistributeTest, distribute_rt_bytes)
+{
+
+  ::mxx::comm comm;
+
+  this->init(comm);
+
+  // the same exchange as distribute_rt, with a type sent as bytes.
+  std::vector<blob_pair> input(this->data.size()), distributed, roundtripped;
+  for (size_t i = 0; i < this->data.size(); ++i) {
+    input[i].first = this->data[i].first;
+    input[i].second = this->data[i].second;
+  }
+
+  int p = comm.size();
+  std::vector<size_t> recv_counts;
+  std::vector<size_t> mapping;
+
+  imxx::distribute(input, [&p](blob_pair const & x ){ return x.first % p; },
+                   recv_counts, mapping, distributed, comm, false);
+  imxx::undistribute(distributed, recv_counts, mapping, roundtripped, comm, true);
+
+  // compared in TearDown.
+  for (auto const & x : distributed) this->distributed.emplace_back(x.first, x.second);
+  this->roundtripped.clear();
+  for (auto const & x : roundtripped) this->roundtripped.emplace_back(x.first, x.second);
+}
+
 TEST_P(DistributeTest, scatter_compute_gather)
 {
 
@@ -555,6 +697,117 @@ TEST_P(DistributeTest, scatter_compute_gather)
 
 }
 
+TEST_P(DistributeTest, scatter_compute_gather_adaptive)
+{
+
+  ::mxx::comm comm;
+
+  this->init(comm);
+
+  // distribute
+  int p = comm.size();
+  std::vector<size_t> mapping;
+
+  std::vector<T> inbuf;
+  std::vector<T> outbuf;
+
+  // small rounds, so that there are several.
+  imxx::batch_controller ctl(1UL << 30, 64, 16);
+  imxx::scatter_compute_gather_adaptive(this->data, [&p](T const & x ){ return x.first % p; },
+                               copy<typename std::vector<T>::const_iterator,
+                                    typename std::vector<T>::iterator>(),
+                   mapping, this->roundtripped, inbuf, outbuf, ctl, comm);
+
+  size_t total = 0;
+  for (auto const & r : ctl.schedule()) total += r.size;
+  EXPECT_GE(total, this->data.size());
+}
+
+TEST(BatchControllerTest, probe_and_settle)
+{
+  imxx::batch_controller ctl(1UL << 30, 100, 10);
+
+  // throughput grows up to 800 per round, then drops.
+  auto time_of = [](size_t n) { return (n <= 800) ? 1.0 : 4.0 * n / 800.0; };
+  for (int i = 0; i < 10; ++i) {
+    size_t n = ctl.next(8);
+    ctl.record(n, time_of(n), 0.0, 1.0, true);
+  }
+  EXPECT_TRUE(ctl.is_settled());
+  EXPECT_EQ(800UL, ctl.get_round_size());
+
+  // slower machine:  probes again from half.
+  ctl.record(800, 2.0, 0.0, 1.0, true);
+  EXPECT_FALSE(ctl.is_settled());
+  EXPECT_EQ(400UL, ctl.get_round_size());
+
+  // the memory ceiling caps the round, scaled by the receive imbalance.
+  imxx::batch_controller small(8000, 5000, 10);
+  EXPECT_EQ(1000UL, small.next(8));
+  small.record(1000, 1.0, 0.0, 2.0, false);
+  EXPECT_EQ(500UL, small.next(8));
+}
+
+TEST_P(DistributeTest, distribute_compute_overlap)
+{
+
+  ::mxx::comm comm;
+
+  this->init(comm);
+
+  // copy data into roundtripped.
+  this->roundtripped.resize(this->data.size());
+  std::copy(this->data.begin(), this->data.end(), this->roundtripped.begin());
+
+  // distribute in rounds, collecting what is received.
+  int p = comm.size();
+  auto collect = [this](typename std::vector<T>::iterator first, typename std::vector<T>::iterator last) {
+    this->distributed.insert(this->distributed.end(), first, last);
+  };
+
+  size_t received = imxx::distribute_compute_overlap(this->roundtripped, [&p](T const & x ){ return x.first % p; },
+                   collect, (this->data.size() + 2) / 3, comm);
+  EXPECT_EQ(received, this->distributed.size());
+
+  // batches arrive in a different order than from a single all2allv.
+  std::sort(this->distributed.begin(), this->distributed.end());
+  std::sort(this->gold.begin(), this->gold.end());
+
+  this->roundtripped.clear();
+}
+
+TEST_P(DistributeTest, distribute_inplace)
+{
+
+  ::mxx::comm comm;
+
+  this->init(comm);
+
+  // distribute the copy in place.
+  this->distributed.assign(this->data.begin(), this->data.end());
+
+  int p = comm.size();
+  std::vector<size_t> recv_counts;
+
+  imxx::distribute_inplace(this->distributed, [&p](T const & x ){ return x.first % p; },
+                   recv_counts, comm);
+
+  // grouped by source rank.
+  size_t offset = 0;
+  for (int i = 0; i < p; ++i) {
+    for (size_t j = 0; j < recv_counts[i]; ++j) {
+      EXPECT_EQ(i, this->distributed[offset + j].second);
+    }
+    offset += recv_counts[i];
+  }
+  EXPECT_EQ(offset, this->distributed.size());
+
+  // the order within a bucket is not preserved.
+  std::sort(this->distributed.begin(), this->distributed.end());
+  std::sort(this->gold.begin(), this->gold.end());
+
+  this->roundtripped.clear();
+}
 
 
 
@@ -400,7 +400,8 @@ INSTANTIATE_TEST_CASE_P(Bliss, FASTAParseTest, ::testing::Values(
     TestFileInfo(6,    246,    940, std::string("/test/data/test2.fasta")),
     TestFileInfo(4,    64,     512, std::string("/test/data/test.fasta")),
     TestFileInfo(5000, 335000, 1092580, std::string("/test/data/test.medium.fasta")),
-    TestFileInfo(2,    31155,  31244, std::string("/test/data/test.unitiqs.fasta"))
+    TestFileInfo(2,    31155,  31244, std::string("/test/data/test.unitiqs.fasta")),
+    TestFileInfo(1,    31189,  31753, std::string("/test/data/test.chrom.fasta"))
 ));
 
 //INSTANTIATE_TEST_CASE_P(Bliss, FASTAParseProcedureTest, ::testing::Values(
@@ -766,7 +767,8 @@ INSTANTIATE_TEST_CASE_P(Bliss, NoNFASTAParseTest, ::testing::Values(
     TestFileInfo(6,    246,    940, std::string("/test/data/test2.fasta")),
     TestFileInfo(4,    64,     512, std::string("/test/data/test.fasta")),
     TestFileInfo(4994, 334598, 1092580, std::string("/test/data/test.medium.fasta")),
-    TestFileInfo(2,    31155,  31244, std::string("/test/data/test.unitiqs.fasta"))
+    TestFileInfo(2,    31155,  31244, std::string("/test/data/test.unitiqs.fasta")),
+    TestFileInfo(1,    31189,  31753, std::string("/test/data/test.chrom.fasta"))
 ));
 
 
@@ -1257,7 +1259,8 @@ INSTANTIATE_TEST_CASE_P(Bliss, SplitFASTAParseTest, ::testing::Values(
     TestFileInfo(6,    246,    940, std::string("/test/data/test2.fasta")),
     TestFileInfo(4,    64,     512, std::string("/test/data/test.fasta")),
     TestFileInfo(5000, 334994, 1092580, std::string("/test/data/test.medium.fasta")),
-    TestFileInfo(2,    31155,  31244, std::string("/test/data/test.unitiqs.fasta"))
+    TestFileInfo(2,    31155,  31244, std::string("/test/data/test.unitiqs.fasta")),
+    TestFileInfo(1,    31189,  31753, std::string("/test/data/test.chrom.fasta"))
 ));
 
 
@@ -47,6 +47,7 @@
 
 #include "io/fastq_loader.hpp"
 #include "io/file.hpp"
+#include "io/paired_file.hpp"
 
 #include "utils/benchmark_utils.hpp"
 
@@ -428,6 +429,42 @@ TEST_P(FASTQParseTest, parse_posix_mpi)
   comm.barrier();
 }
 
+TEST_P(FASTQParseTest, parse_posix_mpi_balanced)
+{
+	  ::mxx::comm comm;
+
+  ::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, bliss::io::FASTQParser> fobj(this->fileName, 0UL, comm);
+  fobj.set_balance_bases(true);
+
+  this->parse_mpi(fobj, 0UL, comm);
+
+  comm.barrier();
+}
+
+TEST_P(FASTQParseTest, parse_posix_mpi_paired)
+{
+  ::mxx::comm comm;
+
+  // same file as both mates, so mate records are identical.  R1 is base balanced so its partition differs from R2's own.
+  ::bliss::io::parallel::paired_fastq_file<::bliss::io::posix_file> fobj(this->fileName, this->fileName, comm);
+  fobj.get_file(0).set_balance_bases(true);
+
+  ::bliss::io::file_data d1;
+  ::bliss::io::file_data d2;
+  fobj.read_files(d1, d2);
+
+  EXPECT_EQ(this->GetParam().seqCount, ::mxx::allreduce(fobj.size(), comm));
+  size_t first = ::mxx::exscan(fobj.size(), ::std::plus<size_t>(), comm);
+  if (comm.rank() == 0) first = 0;
+  EXPECT_EQ(first, fobj.first_record());
+
+  EXPECT_EQ(d1.getRange(), d2.getRange());
+  ASSERT_EQ(d1.getRange().size(), d2.getRange().size());
+  EXPECT_TRUE(std::equal(d1.cbegin(), d1.cend(), d2.cbegin()));
+
+  comm.barrier();
+}
+
 TEST_P(FASTQParseTest, parse_mpiio_mpi)
 {
 	  ::mxx::comm comm;
@@ -438,6 +475,167 @@ TEST_P(FASTQParseTest, parse_mpiio_mpi)
 
 	  comm.barrier();
 }
+
+TEST_P(FASTQParseTest, parse_mmap_omp)
+{
+  ::mxx::comm comm;
+
+  using KmerParserType = bliss::index::kmer::KmerParser<KmerType >;
+
+  std::vector<KmerType> gold;
+  auto gold_read = bliss::io::KmerFileHelper::read_file_mmap<KmerParserType, bliss::io::FASTQParser,
+      bliss::io::SequencesIterator>(this->fileName, gold, comm);
+
+  for (int nthreads : {2, 3, 4}) {
+    std::vector<KmerType> result;
+    auto read = bliss::io::KmerFileHelper::read_file_mmap<KmerParserType, bliss::io::FASTQParser,
+        bliss::io::SequencesIterator>(this->fileName, result, comm, nthreads);
+
+    EXPECT_EQ(gold_read.first, read.first);
+    EXPECT_EQ(gold_read.second, read.second);
+    ASSERT_EQ(gold.size(), result.size());
+    EXPECT_TRUE(std::equal(gold.begin(), gold.end(), result.begin()));
+  }
+
+  comm.barrier();
+}
+
+TEST_P(FASTQParseTest, parse_indexed)
+{
+  ::mxx::comm comm;
+
+  using KmerParserType = bliss::index::kmer::KmerParser<KmerType >;
+  using QualParserType = bliss::index::kmer::KmerPositionQualityTupleParser<
+      std::pair<KmerType, std::pair<bliss::common::ShortSequenceKmerId, float> > >;
+
+  std::vector<KmerType> gold;
+  auto gold_read = bliss::io::KmerFileHelper::read_file_mmap<KmerParserType, bliss::io::FASTQParser,
+      bliss::io::SequencesIterator>(this->fileName, gold, comm);
+
+  for (int nthreads : {1, 3}) {
+    std::vector<KmerType> result;
+    auto read = bliss::io::KmerFileHelper::read_file_mmap<KmerParserType, bliss::io::FASTQParser,
+        bliss::io::IndexedSequencesIterator>(this->fileName, result, comm, nthreads);
+
+    EXPECT_EQ(gold_read.first, read.first);
+    EXPECT_EQ(gold_read.second, read.second);
+    ASSERT_EQ(gold.size(), result.size());
+    EXPECT_TRUE(std::equal(gold.begin(), gold.end(), result.begin()));
+
+    result.clear();
+    read = bliss::io::KmerFileHelper::read_file_mmap<KmerParserType, bliss::io::FASTQParser,
+        bliss::io::NoQualityIndexedSequencesIterator>(this->fileName, result, comm, nthreads);
+
+    EXPECT_EQ(gold_read.first, read.first);
+    EXPECT_EQ(gold_read.second, read.second);
+    ASSERT_EQ(gold.size(), result.size());
+    EXPECT_TRUE(std::equal(gold.begin(), gold.end(), result.begin()));
+  }
+
+  // quality scores come from the indexed quality lines.
+  std::vector<typename QualParserType::value_type> gold_qual;
+  bliss::io::KmerFileHelper::read_file_mmap<QualParserType, bliss::io::FASTQParser,
+      bliss::io::SequencesIterator>(this->fileName, gold_qual, comm);
+  std::vector<typename QualParserType::value_type> result_qual;
+  bliss::io::KmerFileHelper::read_file_mmap<QualParserType, bliss::io::FASTQParser,
+      bliss::io::IndexedSequencesIterator>(this->fileName, result_qual, comm);
+  ASSERT_EQ(gold_qual.size(), result_qual.size());
+  EXPECT_TRUE(std::equal(gold_qual.begin(), gold_qual.end(), result_qual.begin()));
+
+  comm.barrier();
+}
+
+TEST_P(FASTQParseTest, parse_prefetched)
+{
+  ::mxx::comm comm;
+
+  using KmerParserType = bliss::index::kmer::KmerParser<KmerType >;
+
+  std::vector<KmerType> gold;
+  auto gold_read = bliss::io::KmerFileHelper::read_file_mmap<KmerParserType, bliss::io::FASTQParser,
+      bliss::io::SequencesIterator>(this->fileName, gold, comm);
+
+  // small blocks so that records cross block boundaries and overlaps.
+  for (size_t block_size : {100UL, 1000UL, 1UL << 20}) {
+    std::vector<KmerType> result;
+    auto read = bliss::io::KmerFileHelper::read_file_posix_prefetched<KmerParserType, bliss::io::FASTQParser,
+        bliss::io::SequencesIterator>(this->fileName, block_size, result, comm);
+
+    EXPECT_EQ(gold_read.first, read.first);
+    EXPECT_EQ(gold_read.second, read.second);
+    ASSERT_EQ(gold.size(), result.size());
+    EXPECT_TRUE(std::equal(gold.begin(), gold.end(), result.begin()));
+
+    result.clear();
+    read = bliss::io::KmerFileHelper::read_file_mpiio_prefetched<KmerParserType, bliss::io::FASTQParser,
+        bliss::io::SequencesIterator>(this->fileName, block_size, result, comm);
+
+    EXPECT_EQ(gold_read.first, read.first);
+    EXPECT_EQ(gold_read.second, read.second);
+    ASSERT_EQ(gold.size(), result.size());
+    EXPECT_TRUE(std::equal(gold.begin(), gold.end(), result.begin()));
+  }
+
+  comm.barrier();
+}
+
+TEST_P(FASTQParseTest, parse_packed)
+{
+  ::mxx::comm comm;
+
+  using KmerParserType = bliss::index::kmer::KmerParser<KmerType >;
+
+  std::vector<KmerType> gold;
+  auto gold_read = bliss::io::KmerFileHelper::read_file_mmap<KmerParserType, bliss::io::FASTQParser,
+      bliss::io::SequencesIterator>(this->fileName, gold, comm);
+
+  ::bliss::common::PackedSequenceArena<typename KmerType::KmerAlphabet> arena;
+  std::vector<KmerType> result;
+  auto read = bliss::io::KmerFileHelper::read_file_packed<
+      ::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file, ::bliss::io::FASTQParser>,
+      KmerParserType, bliss::io::FASTQParser, bliss::io::SequencesIterator>(this->fileName, arena, result, comm);
+
+  EXPECT_EQ(gold_read.first, read.first);
+  EXPECT_EQ(gold_read.second, read.second);
+  ASSERT_EQ(gold.size(), result.size());
+  EXPECT_TRUE(std::equal(gold.begin(), gold.end(), result.begin()));
+  EXPECT_GE(arena.size(), read.first);
+
+  comm.barrier();
+}
+
+TEST_P(FASTQParseTest, parse_store)
+{
+  ::mxx::comm comm;
+
+  using KmerParserType = bliss::index::kmer::KmerParser<KmerType >;
+  using PosParserType = bliss::index::kmer::KmerPositionTupleParser<std::pair<KmerType, bliss::common::ShortSequenceKmerId> >;
+
+  std::vector<KmerType> gold;
+  bliss::io::KmerFileHelper::read_file_mmap<KmerParserType, bliss::io::FASTQParser,
+      bliss::io::SequencesIterator>(this->fileName, gold, comm);
+  std::vector<typename PosParserType::value_type> gold_pos;
+  bliss::io::KmerFileHelper::read_file_mmap<PosParserType, bliss::io::FASTQParser,
+      bliss::io::SequencesIterator>(this->fileName, gold_pos, comm);
+
+  // pack once, generate both.
+  ::bliss::io::PackedReadStore<typename KmerType::KmerAlphabet> store;
+  bliss::io::KmerFileHelper::read_file_to_store<
+      ::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file, ::bliss::io::FASTQParser>,
+      KmerType, bliss::io::FASTQParser, bliss::io::SequencesIterator>(this->fileName, store, comm);
+
+  std::vector<KmerType> result;
+  store.template generate<KmerParserType>(result);
+  ASSERT_EQ(gold.size(), result.size());
+  EXPECT_TRUE(std::equal(gold.begin(), gold.end(), result.begin()));
+
+  std::vector<typename PosParserType::value_type> result_pos;
+  store.template generate<PosParserType>(result_pos);
+  ASSERT_EQ(gold_pos.size(), result_pos.size());
+  EXPECT_TRUE(std::equal(gold_pos.begin(), gold_pos.end(), result_pos.begin()));
+
+  comm.barrier();
+}
 #endif
 
 
@@ -1141,6 +1339,9 @@ protected:
       std::tie(this->seqCount, this->kmerCount) = bliss::io::KmerFileHelper::parse_file_data<bliss::index::kmer::KmerParser<KmerType >,
         bliss::io::FASTQParser, ::bliss::io::NSplitSequencesIterator>(fdata, result);
 
+      // output is reserved to its exact size.
+      ASSERT_EQ(result.size(), result.capacity());
+
   }
 
 
@@ -1216,6 +1417,9 @@ protected:
     std::tie(this->seqCount, this->kmerCount) = bliss::io::KmerFileHelper::parse_file_data<bliss::index::kmer::KmerParser<KmerType >,
       bliss::io::FASTQParser, ::bliss::io::NSplitSequencesIterator>(fdata, result, comm);
 
+    // output is reserved to its exact size.
+    ASSERT_EQ(result.size(), result.capacity());
+
   }
 
 
@@ -138,7 +138,8 @@ REGISTER_TYPED_TEST_CASE_P(FileSequentialLoadTest,
 typedef ::testing::Types<
 		bliss::io::mmap_file,
 		bliss::io::stdio_file,
-		bliss::io::posix_file
+		bliss::io::posix_file,
+		bliss::io::uring_file
 > FileSequentialLoadTestTypes;
 
 //typedef ::testing::Types< FileLoader<unsigned char, 0, bliss::io::BaseFileParser, false, false> > FileSequentialLoadTestTypes;
@@ -245,15 +246,19 @@ typedef ::testing::Types<
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file,  ::bliss::io::BaseFileParser >, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::stdio_file, ::bliss::io::BaseFileParser >, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::BaseFileParser >, std::integral_constant<size_t, 0> >,
+	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::uring_file, ::bliss::io::BaseFileParser >, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file,  ::bliss::io::BaseFileParser , ::bliss::io::parallel::base_shared_fd_file>, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::BaseFileParser , ::bliss::io::parallel::base_shared_fd_file>, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::mpiio_file<::bliss::io::BaseFileParser >, std::integral_constant<size_t, 0> >,
+	std::pair<::bliss::io::parallel::node_aggregated_file<::bliss::io::BaseFileParser >, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file,  ::bliss::io::FASTAParser >, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::stdio_file, ::bliss::io::FASTAParser >, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::FASTAParser >, std::integral_constant<size_t, 0> >,
+	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::uring_file, ::bliss::io::FASTAParser >, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file,  ::bliss::io::FASTAParser , ::bliss::io::parallel::base_shared_fd_file>,  std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::FASTAParser , ::bliss::io::parallel::base_shared_fd_file>,  std::integral_constant<size_t, 0> >,
-	std::pair<::bliss::io::parallel::mpiio_file<::bliss::io::FASTAParser >, std::integral_constant<size_t, 0> >
+	std::pair<::bliss::io::parallel::mpiio_file<::bliss::io::FASTAParser >, std::integral_constant<size_t, 0> >,
+	std::pair<::bliss::io::parallel::node_aggregated_file<::bliss::io::FASTAParser >, std::integral_constant<size_t, 0> >
 > FileMPILoadTestTypes;
 
 INSTANTIATE_TYPED_TEST_CASE_P(Bliss, FileMPILoadTest, FileMPILoadTestTypes);
@@ -347,15 +352,138 @@ typedef ::testing::Types<
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file,  ::bliss::io::FASTQParser >, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::stdio_file, ::bliss::io::FASTQParser >, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::FASTQParser >, std::integral_constant<size_t, 0> >,
+	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::uring_file, ::bliss::io::FASTQParser >, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file,  ::bliss::io::FASTQParser , ::bliss::io::parallel::base_shared_fd_file>, std::integral_constant<size_t, 0> >,
 	std::pair<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, ::bliss::io::FASTQParser , ::bliss::io::parallel::base_shared_fd_file>, std::integral_constant<size_t, 0> >,
-	std::pair<::bliss::io::parallel::mpiio_file<::bliss::io::FASTQParser >, std::integral_constant<size_t, 0> >
+	std::pair<::bliss::io::parallel::mpiio_file<::bliss::io::FASTQParser >, std::integral_constant<size_t, 0> >,
+	std::pair<::bliss::io::parallel::node_aggregated_file<::bliss::io::FASTQParser >, std::integral_constant<size_t, 0> >
 > FASTQMPILoadTestTypes;
 
 INSTANTIATE_TYPED_TEST_CASE_P(Bliss, FASTQMPILoadTest, FASTQMPILoadTestTypes);
 
 
 
+class NodeAggregatedLoadTest : public FileLoaderTest
+{
+protected:
+	~NodeAggregatedLoadTest() {};
+
+	/// read_shared gives the same partitions and bytes as partitioned_file.  small stripes and tail, so that there are
+	/// many chunks per aggregator and the window has to grow.
+	template <template <typename> class Parser>
+	void compare(size_t const & overlap, int const & aggregators, mxx::comm const & comm) {
+		::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, Parser> gold_obj(this->fileName, overlap, comm);
+		::bliss::io::file_data gold = gold_obj.read_file();
+
+		::bliss::io::parallel::aggregation_policy policy;
+		policy.aggregators = aggregators;
+		policy.stripe_bytes = 4096;
+		policy.tail_bytes = 16;
+		::bliss::io::parallel::node_aggregated_file<Parser> fobj(this->fileName, overlap, comm, policy);
+
+		for (int iter = 0; iter < 2; ++iter) {
+			::bliss::io::parallel::shared_file_data fdata = fobj.read_shared();
+
+			// in mem starts at the first record here, and at the block start in partitioned_file<FASTQ>.
+			bool same = fdata.parent_range_bytes.equal(gold.parent_range_bytes) &&
+					fdata.valid_range_bytes.equal(gold.valid_range_bytes) &&
+					(fdata.in_mem_range_bytes.start == fdata.valid_range_bytes.start) &&
+					(fdata.in_mem_range_bytes.end == gold.in_mem_range_bytes.end) &&
+					::std::equal(fdata.cbegin(), fdata.in_mem_cend(), gold.cbegin());
+			ASSERT_TRUE(::mxx::all_of(same, comm));
+		}
+	}
+};
+
+TEST_F(NodeAggregatedLoadTest, fastq)
+{
+	::mxx::comm comm;
+	this->template compare<::bliss::io::FASTQParser>(0, 1, comm);
+	this->template compare<::bliss::io::FASTQParser>(0, 3, comm);
+}
+
+TEST_F(NodeAggregatedLoadTest, overlap)
+{
+	::mxx::comm comm;
+	this->template compare<::bliss::io::BaseFileParser>(100, 2, comm);
+}
+
+
+
+class MPIIOHintsLoadTest : public FileLoaderTest
+{
+protected:
+	~MPIIOHintsLoadTest() {};
+
+	/// user supplied hints, so that the test does not depend on the file system.
+	static ::bliss::io::parallel::mpiio_hints hints() {
+		::bliss::io::parallel::mpiio_hints h;
+		h.autodetect = false;
+		h.align = true;
+		h.striping_unit = 65536;
+		h.cb_nodes = 1;
+		h.cb_buffer_size = 1UL << 20;
+		h.romio_cb_read = "enable";
+		h.extra.emplace_back("romio_ds_read", "disable");
+		return h;
+	}
+};
+
+TEST_F(MPIIOHintsLoadTest, to_info)
+{
+	MPI_Info info = hints().to_info();
+	ASSERT_NE(MPI_INFO_NULL, info);
+
+	char value[64];
+	int flag = 0;
+	MPI_Info_get(info, const_cast<char *>("cb_buffer_size"), 63, value, &flag);
+	EXPECT_TRUE(flag);
+	EXPECT_EQ(std::string("1048576"), std::string(value));
+	MPI_Info_get(info, const_cast<char *>("romio_ds_read"), 63, value, &flag);
+	EXPECT_TRUE(flag);
+	EXPECT_EQ(std::string("disable"), std::string(value));
+	MPI_Info_free(&info);
+
+	::bliss::io::parallel::mpiio_hints none;
+	EXPECT_EQ(MPI_INFO_NULL, none.to_info());
+}
+
+TEST_F(MPIIOHintsLoadTest, aligned)
+{
+	::mxx::comm comm;
+	size_t const overlap = 100;
+	::bliss::io::parallel::mpiio_file<::bliss::io::BaseFileParser> fobj(this->fileName, overlap, comm, hints());
+	::bliss::io::file_data fdata = fobj.read_file();
+
+	// the boundaries between ranks are on stripes, and the partitions cover the file.
+	std::vector<size_t> begins = mxx::allgather(fdata.valid_range_bytes.start, comm);
+	std::vector<size_t> ends = mxx::allgather(fdata.valid_range_bytes.end, comm);
+	EXPECT_EQ(0UL, begins.front());
+	EXPECT_EQ(fobj.size(), ends.back());
+	for (int i = 1; i < comm.size(); ++i) {
+		EXPECT_EQ(ends[i - 1], begins[i]);
+		EXPECT_EQ(0UL, begins[i] % 65536);
+	}
+
+	// overlap is still read, and the bytes are the file's.
+	EXPECT_EQ(::std::min(fdata.valid_range_bytes.end + overlap, fobj.size()), fdata.in_mem_range_bytes.end);
+	if (fdata.in_mem_range_bytes.size() > 0) {
+		ValueType * data = new ValueType[fdata.in_mem_range_bytes.size()];
+		this->readFilePOSIX(this->fileName, fdata.in_mem_range_bytes.start, fdata.in_mem_range_bytes.size(), data);
+		EXPECT_TRUE(equal(data, fdata.in_mem_begin(), fdata.in_mem_range_bytes.size(), true));
+		delete [] data;
+	}
+
+	// FASTQ partitions still start on records.
+	::bliss::io::parallel::mpiio_file<::bliss::io::FASTQParser> qobj(this->fileName, 0UL, comm, hints());
+	::bliss::io::file_data qdata = qobj.read_file();
+	size_t total = ::mxx::allreduce(qdata.valid_range_bytes.size(), comm);
+	EXPECT_EQ(qobj.size(), total);
+	if (qdata.valid_range_bytes.size() > 0) EXPECT_EQ('@', *(qdata.begin()));
+}
+
+
+
 #endif
 
 
@@ -0,0 +1,370 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * mpi_test_object_file.cpp
+ *   Test object_file against a local HTTP server with range requests:  url parsing, chunked concurrent reads, retries
+ *   of failed requests and closed connections, prefetching, and that parallel::object_file partitions FASTQ and FASTA
+ *   exactly as partitioned_file does for the local file.
+ */
+
+#include "bliss-config.hpp"    // for location of data.
+
+// include google test
+#include <gtest/gtest.h>
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cstdlib>    // setenv
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#include "io/file.hpp"
+#include "io/object_file.hpp"
+#include "io/prefetch_reader.hpp"
+
+
+/// HTTP/1.1 server on 127.0.0.1 that serves one object, with range requests and keep-alive.
+/// every fail_every-th request gets a 503, and every close_every-th response closes its connection.
+class range_server {
+  protected:
+    std::string path;
+    std::string content;
+    int lsock;
+    int port;
+    std::atomic<bool> stop;
+    std::thread acceptor;
+    std::mutex clients_mutex;
+    std::vector<int> client_socks;
+    std::vector<std::thread> clients;
+
+    void respond(int fd, std::string const & head, char const * body, size_t len) {
+      std::string msg = head;
+      msg.append(body, len);
+      size_t s = 0;
+      while (s < msg.size()) {
+        ssize_t count = ::send(fd, msg.data() + s, msg.size() - s, MSG_NOSIGNAL);
+        if (count <= 0) return;
+        s += count;
+      }
+    }
+
+    void serve(int fd) {
+      std::string buf;
+      char tmp[4096];
+      while (!stop.load()) {
+        size_t end;
+        while ((end = buf.find("\r\n\r\n")) == std::string::npos) {
+          ssize_t count = ::recv(fd, tmp, sizeof(tmp), 0);
+          if (count <= 0) return;
+          buf.append(tmp, count);
+        }
+        std::string head = buf.substr(0, end);
+        buf.erase(0, end + 4);
+        std::transform(head.begin(), head.end(), head.begin(), [](unsigned char c){ return ::tolower(c); });
+
+        size_t n = ++requests;
+        size_t a = ++active;
+        size_t m = max_active.load();
+        while ((a > m) && !max_active.compare_exchange_weak(m, a)) {}
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        bool close_after = (close_every > 0) && ((n % close_every) == 0);
+        std::string conn = close_after ? "Connection: close\r\n" : "";
+        std::string target = head.substr(4, head.find(' ', 4) - 4);
+        size_t rpos = head.find("range: bytes=");
+
+        std::stringstream ss;
+        if ((fail_every > 0) && ((n % fail_every) == 0)) {
+          ss << "HTTP/1.1 503 Slow Down\r\nContent-Length: 0\r\n" << conn << "\r\n";
+          respond(fd, ss.str(), nullptr, 0);
+        } else if (target != path) {
+          ss << "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n" << conn << "\r\n";
+          respond(fd, ss.str(), nullptr, 0);
+        } else if (rpos != std::string::npos) {
+          size_t first = strtoull(head.c_str() + rpos + 13, nullptr, 10);
+          size_t last = strtoull(head.c_str() + head.find('-', rpos + 13) + 1, nullptr, 10);
+          if (first >= content.size()) {
+            ss << "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */" << content.size() << "\r\nContent-Length: 0\r\n" << conn << "\r\n";
+            respond(fd, ss.str(), nullptr, 0);
+          } else {
+            last = std::min(last, content.size() - 1);
+            ss << "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes " << first << "-" << last << "/" << content.size()
+               << "\r\nContent-Length: " << (last - first + 1) << "\r\n" << conn << "\r\n";
+            respond(fd, ss.str(), content.data() + first, last - first + 1);
+          }
+        } else {
+          ss << "HTTP/1.1 200 OK\r\nContent-Length: " << content.size() << "\r\n" << conn << "\r\n";
+          respond(fd, ss.str(), content.data(), content.size());
+        }
+        --active;
+
+        if (close_after) return;
+      }
+    }
+
+  public:
+    size_t fail_every;
+    size_t close_every;
+    std::atomic<size_t> requests;
+    std::atomic<size_t> active;
+    std::atomic<size_t> max_active;
+
+    range_server(std::string const & _path, std::string const & _content) :
+      path(_path), content(_content), lsock(-1), port(0), stop(false), fail_every(0), close_every(0),
+      requests(0), active(0), max_active(0) {
+      lsock = ::socket(AF_INET, SOCK_STREAM, 0);
+      int one = 1;
+      setsockopt(lsock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+      struct sockaddr_in addr;
+      memset(&addr, 0, sizeof(addr));
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      addr.sin_port = 0;
+      ::bind(lsock, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+      socklen_t len = sizeof(addr);
+      getsockname(lsock, reinterpret_cast<struct sockaddr *>(&addr), &len);
+      port = ntohs(addr.sin_port);
+      ::listen(lsock, 64);
+
+      acceptor = std::thread([this](){
+        while (!stop.load()) {
+          int fd = ::accept(lsock, nullptr, nullptr);
+          if (fd < 0) return;
+          std::lock_guard<std::mutex> lock(clients_mutex);
+          client_socks.emplace_back(fd);
+          clients.emplace_back([this, fd](){ this->serve(fd); ::close(fd); });
+        }
+      });
+    }
+
+    ~range_server() {
+      stop.store(true);
+      ::shutdown(lsock, SHUT_RDWR);
+      ::close(lsock);
+      acceptor.join();
+      std::lock_guard<std::mutex> lock(clients_mutex);
+      for (int fd : client_socks) ::shutdown(fd, SHUT_RDWR);
+      for (auto & t : clients) t.join();
+    }
+
+    std::string url(std::string const & p) const {
+      std::stringstream ss;
+      ss << "http://127.0.0.1:" << port << p;
+      return ss.str();
+    }
+    std::string url() const { return url(path); }
+};
+
+
+class ObjectFileTest : public ::testing::Test
+{
+  protected:
+    ::mxx::comm comm;
+
+    static std::string data_file(std::string const & name) {
+      return std::string(PROJ_SRC_DIR) + "/test/data/" + name;
+    }
+
+    static std::string slurp(std::string const & filename) {
+      std::ifstream ifs(filename, std::ios::binary);
+      return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+
+    /// parallel::object_file gives the same partitions and bytes as partitioned_file<posix_file> on the local file.
+    template <template <typename> class Parser>
+    void compare(std::string const & name, size_t const & overlap) {
+      std::string filename = data_file(name);
+      range_server server("/bucket/" + name, slurp(filename));
+
+      ::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, Parser> gold_obj(filename, overlap, comm);
+      ::bliss::io::file_data gold = gold_obj.read_file();
+
+      ::bliss::io::parallel::object_file<Parser> fobj(server.url(), overlap, comm);
+      ASSERT_EQ(gold_obj.size(), fobj.size());
+      ::bliss::io::file_data fdata = fobj.read_file();
+
+      bool same = fdata.parent_range_bytes.equal(gold.parent_range_bytes) &&
+          fdata.valid_range_bytes.equal(gold.valid_range_bytes) &&
+          fdata.in_mem_range_bytes.equal(gold.in_mem_range_bytes) &&
+          (fdata.data == gold.data);
+      EXPECT_TRUE(::mxx::all_of(same, comm));
+      // small chunks, so that ranks with data issue several requests.
+      if (fdata.in_mem_range_bytes.size() > 8192) EXPECT_GT(server.requests.load(), 2UL);
+    }
+};
+
+TEST_F(ObjectFileTest, location)
+{
+  unsetenv("BLISS_S3_ENDPOINT");
+  ::bliss::io::object_location loc = ::bliss::io::object_location::parse("s3://bucket/dir/my reads+1.fastq");
+  EXPECT_EQ("s3.amazonaws.com", loc.host);
+  EXPECT_EQ("80", loc.port);
+  EXPECT_EQ("/bucket/dir/my%20reads%2B1.fastq", loc.target);
+
+  setenv("BLISS_S3_ENDPOINT", "http://minio.local:9000/", 1);
+  loc = ::bliss::io::object_location::parse("s3://bucket/r.fastq");
+  EXPECT_EQ("minio.local", loc.host);
+  EXPECT_EQ("9000", loc.port);
+  EXPECT_EQ("/bucket/r.fastq", loc.target);
+  unsetenv("BLISS_S3_ENDPOINT");
+
+  loc = ::bliss::io::object_location::parse("gs://b/k.fasta");
+  EXPECT_EQ("storage.googleapis.com", loc.host);
+  EXPECT_EQ("/b/k.fasta", loc.target);
+
+  loc = ::bliss::io::object_location::parse("http://[::1]:8080/x.fastq?X-Amz-Signature=ab%2F");
+  EXPECT_EQ("::1", loc.host);
+  EXPECT_EQ("8080", loc.port);
+  EXPECT_EQ("/x.fastq?X-Amz-Signature=ab%2F", loc.target);
+
+  EXPECT_TRUE(::bliss::io::object_location::is_object_url("S3://b/k"));
+  EXPECT_FALSE(::bliss::io::object_location::is_object_url("/data/k.fastq"));
+  EXPECT_THROW(::bliss::io::object_location::parse("https://host/k"), ::bliss::io::IOException);
+  EXPECT_THROW(::bliss::io::object_location::parse("s3://bucket"), ::bliss::io::IOException);
+  EXPECT_THROW(::bliss::io::object_location::parse("ftp://host/k"), ::bliss::io::IOException);
+}
+
+TEST_F(ObjectFileTest, read_range)
+{
+  std::string content = slurp(data_file("test.medium.fastq"));
+  range_server server("/bucket/test.medium.fastq", content);
+
+  ::bliss::io::object_location loc = ::bliss::io::object_location::parse(server.url());
+  loc.chunk_bytes = 1000;
+  loc.connections = 4;
+  ::bliss::io::object_file fobj(loc);
+  ASSERT_EQ(content.size(), fobj.size());
+
+  ::bliss::io::file_data all = fobj.read_file();
+  EXPECT_TRUE(std::equal(all.data.begin(), all.data.end(), content.begin()));
+  EXPECT_EQ(content.size(), all.data.size());
+  EXPECT_GT(server.max_active.load(), 1UL);
+  EXPECT_EQ(0UL, fobj.retries());
+
+  ::bliss::io::file_data::container out;
+  auto r = fobj.read_range(out, ::bliss::io::file_data::range_type(1234, 9876));
+  EXPECT_EQ(1234UL, r.start);
+  ASSERT_EQ(9876UL - 1234UL, out.size());
+  EXPECT_TRUE(std::equal(out.begin(), out.end(), content.begin() + 1234));
+
+  // clipped to the object.
+  r = fobj.read_range(out, ::bliss::io::file_data::range_type(content.size() - 10, content.size() + 100));
+  ASSERT_EQ(10UL, out.size());
+  EXPECT_TRUE(std::equal(out.begin(), out.end(), content.end() - 10));
+}
+
+TEST_F(ObjectFileTest, retry)
+{
+  std::string content = slurp(data_file("test.medium.fastq"));
+  range_server server("/bucket/test.medium.fastq", content);
+  server.fail_every = 3;
+  server.close_every = 4;
+
+  ::bliss::io::object_location loc = ::bliss::io::object_location::parse(server.url());
+  loc.chunk_bytes = 512;
+  loc.connections = 3;
+  ::bliss::io::object_file fobj(loc);
+  ASSERT_EQ(content.size(), fobj.size());
+
+  ::bliss::io::file_data all = fobj.read_file();
+  EXPECT_EQ(content.size(), all.data.size());
+  EXPECT_TRUE(std::equal(all.data.begin(), all.data.end(), content.begin()));
+  EXPECT_GT(fobj.retries(), 0UL);
+
+  // errors that are not transient are not retried.
+  size_t before = server.requests.load();
+  EXPECT_THROW(::bliss::io::object_file(server.url("/bucket/missing.fastq")), ::bliss::io::IOException);
+  EXPECT_LE(server.requests.load(), before + 2);  // a 503 may come first.
+}
+
+TEST_F(ObjectFileTest, prefetch)
+{
+  std::string content = slurp(data_file("test.medium.fastq"));
+  range_server server("/bucket/test.medium.fastq", content);
+
+  ::bliss::io::object_location loc = ::bliss::io::object_location::parse(server.url());
+  loc.chunk_bytes = 700;
+  ::bliss::io::object_file fobj(loc);
+
+  ::bliss::io::prefetching_reader<::bliss::io::object_file> blocks(fobj, ::bliss::io::file_data::range_type(100, content.size()), 4096, 50, 3);
+  size_t pos = 100;
+  while (blocks.has_next()) {
+    ::bliss::io::file_data & block = blocks.next();
+    ASSERT_EQ(pos, block.valid_range_bytes.start);
+    ASSERT_EQ(block.in_mem_range_bytes.size(), block.data.size());
+    EXPECT_TRUE(std::equal(block.data.begin(), block.data.end(), content.begin() + pos));
+    pos = block.valid_range_bytes.end;
+  }
+  EXPECT_EQ(content.size(), pos);
+}
+
+TEST_F(ObjectFileTest, partitioned)
+{
+  setenv("BLISS_OBJECT_CHUNK_BYTES", "4096", 1);
+  setenv("BLISS_OBJECT_CONNECTIONS", "4", 1);
+
+  this->template compare<::bliss::io::BaseFileParser>("test.medium.fasta", 0);
+  this->template compare<::bliss::io::FASTQParser>("test.medium.fastq", 0);
+  this->template compare<::bliss::io::FASTQParser>("natural.fastq", 0);
+  this->template compare<::bliss::io::FASTAParser>("test.medium.fasta", 30);
+  this->template compare<::bliss::io::FASTAParser>("natural.fasta", 30);
+
+  unsetenv("BLISS_OBJECT_CHUNK_BYTES");
+  unsetenv("BLISS_OBJECT_CONNECTIONS");
+}
+
+TEST_F(ObjectFileTest, missing)
+{
+  std::string content = "@r\nACGT\n+\nIIII\n";
+  range_server server("/bucket/r.fastq", content);
+  // rank 0 fails to get the size, and all ranks throw.
+  EXPECT_THROW(::bliss::io::parallel::object_file<::bliss::io::FASTQParser>(server.url("/bucket/none.fastq"), 0, comm),
+               ::bliss::io::IOException);
+}
+
+#endif
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -276,6 +276,37 @@ TEST_P(SamplesortTest, mxx_samplesort)
 		  ::mxx::impl::samplesort<decltype(this->sorted.begin()), decltype(comp), false>(this->sorted.begin(), this->sorted.end(), comp, comm);
   }
 }
+// one key holds most of the elements, more than fit on a rank.  stable_split used to throw here.
+TEST(SamplesortSkewTest, heavy_duplicates)
+{
+  ::mxx::comm comm;
+  using T = std::pair<size_t, int>;
+  auto comp = [](const T& x, const T& y){ return x.first < y.first; };
+
+  std::mt19937_64 gen(comm.rank() + 3);
+  std::vector<T> data;
+  for (size_t i = 0; i < 1000UL + 500UL * comm.rank(); ++i) {
+    data.emplace_back(((gen() % 10) < 9) ? 42 : gen() % 100, comm.rank());
+  }
+  std::vector<T> gold = mxx::gatherv(data, 0, comm);
+  std::stable_sort(gold.begin(), gold.end(), comp);
+
+  std::vector<T> sorted;
+  imxx::samplesort<true>(data, sorted, comp, comm);
+
+  // balanced to within 2% of the average, plus rounding.
+  size_t total = ::mxx::allreduce(sorted.size(), comm);
+  size_t avg = total / comm.size();
+  size_t dev = (sorted.size() > avg) ? (sorted.size() - avg) : (avg - sorted.size());
+  EXPECT_LE(dev, avg / 50 + 2);
+
+  // same as a sequential stable sort.
+  std::vector<T> temp = mxx::gatherv(sorted, 0, comm);
+  bool same = (comm.rank() != 0) || (temp == gold);
+  same = ::mxx::all_of(same, comm);
+  EXPECT_TRUE(same);
+}
+
 
 
 
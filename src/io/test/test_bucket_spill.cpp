@@ -0,0 +1,104 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint> // for uint64_t, etc.
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <random>
+
+#include "io/bucket_spill.hpp"
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+
+
+class BucketSpillTest : public ::testing::TestWithParam<size_t>
+{
+  protected:
+    using KmerType = ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>;
+    using valType = ::std::pair<KmerType, uint32_t>;
+
+    static constexpr size_t nbuckets = 7;
+    ::std::vector<valType> data;
+
+    virtual void SetUp() {
+      std::default_random_engine generator;
+      std::uniform_int_distribution<int> distribution(0, 3);
+
+      KmerType km;
+      for (size_t i = 0; i < 10007; ++i) {
+        km.nextFromChar(distribution(generator));
+        data.emplace_back(km, i);
+      }
+    }
+
+    static size_t to_bucket(valType const & x) {
+      return x.second % nbuckets;
+    }
+};
+constexpr size_t BucketSpillTest::nbuckets;
+
+
+TEST_P(BucketSpillTest, roundtrip)
+{
+  // write buffer size is the parameter, so some buckets flush many times and some never before flush().
+  ::bliss::io::bucket_spill<valType> spill("/tmp", nbuckets, GetParam());
+
+  // append in a few chunks
+  for (size_t pos = 0; pos < data.size(); pos += 1000) {
+    ::std::vector<valType> chunk(data.begin() + pos, data.begin() + ::std::min(pos + 1000, data.size()));
+    spill.append(chunk, &BucketSpillTest::to_bucket);
+  }
+  spill.flush();
+
+  for (size_t b = 0; b < nbuckets; ++b) {
+    ::std::vector<valType> gold;
+    for (auto const & x : data) if (to_bucket(x) == b) gold.emplace_back(x);
+    ASSERT_EQ(gold.size(), spill.size(b));
+    ASSERT_EQ(gold.size(), spill.remaining(b));
+
+    // read back in slices, appended to output in order.
+    ::std::vector<valType> output;
+    size_t total = 0, n = 0;
+    while ((n = spill.read(b, 333, output)) > 0) {
+      EXPECT_GE(333UL, n);
+      total += n;
+    }
+    EXPECT_EQ(gold.size(), total);
+    EXPECT_EQ(0UL, spill.remaining(b));
+    ASSERT_EQ(gold.size(), output.size());
+    EXPECT_TRUE(::std::equal(gold.begin(), gold.end(), output.begin()));
+  }
+
+  // read again after rewind.
+  spill.rewind();
+  ::std::vector<valType> output;
+  spill.read(3, data.size(), output);
+  EXPECT_EQ(spill.size(3), output.size());
+}
+
+TEST_F(BucketSpillTest, bad_dir)
+{
+  EXPECT_THROW(::bliss::io::bucket_spill<valType>("/nonexistent/bliss", nbuckets), ::bliss::io::IOException);
+  EXPECT_THROW(::bliss::io::bucket_spill<valType>("/tmp", 0), ::std::invalid_argument);
+}
+
+INSTANTIATE_TEST_CASE_P(Bliss, BucketSpillTest, ::testing::Values(
+    1UL, sizeof(std::pair<::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>, uint32_t>) * 7 * 10, 1UL << 20));
@@ -252,6 +252,99 @@ TEST_P(BucketTest, mxx_bucket)
   }
 }
 
+TEST_P(BucketTest, partition_inplace)
+{
+  this->unbucketed.clear();
+  this->mapping.clear();
+
+  // allocate.
+  this->bucketed.resize(this->p.input_size);
+
+  // copy
+  std::copy(this->data.begin(), this->data.end(), this->bucketed.begin());
+
+  BucketTestInfo pp = this->p;
+  auto key = [&pp](std::pair<size_t, size_t> const & x){ return x.first % pp.bucket_count; };
+
+  imxx::local::count_buckets(this->bucketed, key, this->p.bucket_count, this->bcounts, this->p.first, this->p.last);
+  imxx::local::partition_inplace(this->bucketed, key, this->bcounts, 0UL, this->p.first, this->p.last);
+
+  // not stable.  restore input order within each bucket (second is the input position) for the check in TearDown.
+  size_t f = std::min(this->p.first, this->p.input_size);
+  for (size_t i = 0; i < this->p.bucket_count; ++i) {
+    for (size_t j = f; j < f + this->bcounts[i]; ++j) EXPECT_EQ(i, key(this->bucketed[j]));
+    std::sort(this->bucketed.begin() + f, this->bucketed.begin() + f + this->bcounts[i],
+              [](std::pair<size_t, size_t> const & x, std::pair<size_t, size_t> const & y){ return x.second < y.second; });
+    f += this->bcounts[i];
+  }
+}
+
+TEST_P(BucketTest, bucket_inplace)
+{
+  this->unbucketed.clear();
+  this->mapping.clear();
+
+  // allocate.
+  this->bucketed.resize(this->p.input_size);
+
+  // copy
+  std::copy(this->data.begin(), this->data.end(), this->bucketed.begin());
+
+  BucketTestInfo pp = this->p;
+  auto key = [&pp](std::pair<size_t, size_t> const & x){ return x.first % pp.bucket_count; };
+
+  imxx::local::bucket_inplace(this->bucketed, key, this->p.bucket_count, this->bcounts, 0UL, this->p.first, this->p.last);
+
+  // not stable.  restore input order within each bucket for the check in TearDown.
+  size_t f = std::min(this->p.first, this->p.input_size);
+  for (size_t i = 0; i < this->bcounts.size(); ++i) {
+    for (size_t j = f; j < f + this->bcounts[i]; ++j) EXPECT_EQ(i, key(this->bucketed[j]));
+    std::sort(this->bucketed.begin() + f, this->bucketed.begin() + f + this->bcounts[i],
+              [](std::pair<size_t, size_t> const & x, std::pair<size_t, size_t> const & y){ return x.second < y.second; });
+    f += this->bcounts[i];
+  }
+}
+
+TEST_P(BucketTest, partition_inplace_block)
+{
+  this->unbucketed.clear();
+  this->mapping.clear();
+
+  // allocate.
+  this->bucketed.resize(this->p.input_size);
+
+  // copy
+  std::copy(this->data.begin(), this->data.end(), this->bucketed.begin());
+
+  BucketTestInfo pp = this->p;
+  auto key = [&pp](std::pair<size_t, size_t> const & x){ return x.first % pp.bucket_count; };
+
+  imxx::local::count_buckets(this->bucketed, key, this->p.bucket_count, this->bcounts, this->p.first, this->p.last);
+  size_t block = *(std::min_element(this->bcounts.begin(), this->bcounts.end()));
+  imxx::local::partition_inplace(this->bucketed, key, this->bcounts, block, this->p.first, this->p.last);
+
+  // check the block layout, then regroup by bucket and restore input order for the check in TearDown.
+  size_t f = std::min(this->p.first, this->p.input_size);
+  size_t rem = f + block * this->p.bucket_count;
+  std::vector<std::pair<size_t, size_t> > regrouped;
+  for (size_t i = 0; i < this->p.bucket_count; ++i) {
+    size_t start = regrouped.size();
+    for (size_t j = f + i * block; j < f + (i + 1) * block; ++j) {
+      EXPECT_EQ(i, key(this->bucketed[j]));
+      regrouped.emplace_back(this->bucketed[j]);
+    }
+    for (size_t j = rem; j < rem + this->bcounts[i]; ++j) {
+      EXPECT_EQ(i, key(this->bucketed[j]));
+      regrouped.emplace_back(this->bucketed[j]);
+    }
+    rem += this->bcounts[i];
+    std::sort(regrouped.begin() + start, regrouped.end(),
+              [](std::pair<size_t, size_t> const & x, std::pair<size_t, size_t> const & y){ return x.second < y.second; });
+    this->bcounts[i] += block;
+  }
+  std::copy(regrouped.begin(), regrouped.end(), this->bucketed.begin() + f);
+}
+
 TEST_P(BucketTest, permute )
 {
 	this->unbucketed.clear();
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "io/compressed_wire.hpp"
+
+#include <random>
+#include <cstdint>  // uint32_t
+#include <stdexcept>
+#include <vector>
+
+
+class CompressedWireTest : public ::testing::Test {
+  protected:
+    std::vector<uint64_t> sorted;
+    std::vector<uint64_t> noise;
+    ::bliss::io::compress::options opts;
+
+    virtual void SetUp() {
+      std::mt19937_64 gen(29);
+      // sorted keys with small gaps, as in a bucket after sorting.
+      uint64_t v = gen() >> 8;
+      for (size_t i = 0; i < 20000; ++i) {
+        v += gen() % 16;
+        sorted.push_back(v);
+        noise.push_back(gen());
+      }
+
+      opts.enabled = true;
+      opts.min_bytes = 1024;
+      opts.level = 1;
+    }
+
+    /// encode then decode the first count elements of in.  returns the encoded size.
+    size_t roundtrip(std::vector<uint64_t> const & in, size_t count) {
+      size_t n = count * sizeof(uint64_t);
+      std::vector<uint8_t> buffer(::bliss::io::compress::max_bytes(n));
+      size_t bytes = ::bliss::io::compress::encode(reinterpret_cast<uint8_t const *>(in.data()), n, buffer.data(), opts);
+      EXPECT_LE(bytes, buffer.size());
+
+      std::vector<uint64_t> out(count);
+      ::bliss::io::compress::decode(buffer.data(), bytes, reinterpret_cast<uint8_t *>(out.data()), n);
+      for (size_t i = 0; i < count; ++i) {
+        EXPECT_EQ(in[i], out[i]) << " at " << i << " of " << count;
+      }
+      return bytes;
+    }
+};
+
+
+TEST_F(CompressedWireTest, roundtrip)
+{
+  for (size_t count : {0, 1, 127, 128, 129, 5000, 20000}) {
+    roundtrip(sorted, count);
+    roundtrip(noise, count);
+  }
+}
+
+TEST_F(CompressedWireTest, threshold)
+{
+  // below the threshold, raw with a 1 byte tag.
+  EXPECT_EQ(1 + 100 * sizeof(uint64_t), roundtrip(sorted, 100));
+
+  // random bits do not shrink, so they go raw as well.
+  EXPECT_EQ(1 + noise.size() * sizeof(uint64_t), roundtrip(noise, noise.size()));
+
+#if defined(USE_ZLIB)
+  // sorted keys compress.
+  EXPECT_LT(roundtrip(sorted, sorted.size()), sorted.size() * sizeof(uint64_t) / 2);
+#else
+  EXPECT_EQ(1 + sorted.size() * sizeof(uint64_t), roundtrip(sorted, sorted.size()));
+#endif
+}
+
+TEST_F(CompressedWireTest, corrupt)
+{
+  std::vector<uint8_t> buffer(::bliss::io::compress::max_bytes(800));
+  size_t bytes = ::bliss::io::compress::encode(reinterpret_cast<uint8_t const *>(sorted.data()), 800, buffer.data(), opts);
+
+  std::vector<uint8_t> out(800);
+  EXPECT_THROW(::bliss::io::compress::decode(buffer.data(), bytes, out.data(), 799), std::invalid_argument);
+  EXPECT_THROW(::bliss::io::compress::decode(buffer.data(), 0, out.data(), 800), std::invalid_argument);
+  buffer[0] = 7;
+  EXPECT_THROW(::bliss::io::compress::decode(buffer.data(), bytes, out.data(), 800), std::invalid_argument);
+}
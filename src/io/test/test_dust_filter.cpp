@@ -0,0 +1,193 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * test_dust_filter.cpp
+ * Test the DUST masker against a per window reference, the SIMD classifier against the scalar one, and the runs
+ * DustCharFilter splits a sequence into.
+ */
+
+#include "bliss-config.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "io/dust_filter.hpp"
+
+namespace {
+
+  /// random bases with homopolymers, microsatellites, the occasional N and EOL.
+  std::string make_reads(size_t const & len, std::default_random_engine & gen) {
+    std::uniform_int_distribution<int> base(0, 3);
+    std::uniform_int_distribution<int> run(0, 120);
+    std::uniform_int_distribution<int> coin(0, 19);
+    std::string data;
+    while (data.size() < len) {
+      int r = run(gen);
+      for (int i = 0; i < r; ++i) {
+        int x = coin(gen);
+        data.push_back(x == 0 ? '\n' : (x == 1 ? 'N' : "ACGTacgt"[base(gen) + (x < 4 ? 4 : 0)]));
+      }
+      r = run(gen) / 2;
+      switch (coin(gen) % 4) {
+        case 0: data.append(r, "ACGT"[base(gen)]); break;
+        case 1: for (int i = 0; i < r; ++i) data.push_back("CA"[i % 2]); break;
+        case 2: for (int i = 0; i < r; ++i) data.push_back("GAT"[i % 3]); break;
+        default: break;
+      }
+    }
+    data.resize(len);
+    return data;
+  }
+
+  /// reference:  scores every window of the segments between non-ACGT characters with dust_masker::score.
+  std::vector<uint8_t> reference_mask(std::string const & s, size_t window, double threshold) {
+    std::vector<uint8_t> mask(s.size(), 0);
+    auto is_eol = [](char c) { return (c == '\n') || (c == '\r'); };
+    size_t i = 0;
+    while (i < s.size()) {
+      std::vector<size_t> bases;
+      for (; (i < s.size()) && (bliss::io::dust_encode<false>::code(s[i]) != 5); ++i) {
+        if (!is_eol(s[i])) bases.push_back(i);
+      }
+      if (bases.size() >= 4) {
+        size_t w = std::min(window, bases.size());
+        for (size_t start = 0; start + w <= bases.size(); ++start) {
+          std::string win;
+          for (size_t j = start; j < start + w; ++j) win.push_back(s[bases[j]]);
+          if (bliss::io::dust_masker::score(win.begin(), win.end()) > threshold) {
+            for (size_t j = start; j < start + w; ++j) mask[bases[j]] = 1;
+          }
+        }
+      }
+      if (i < s.size()) mask[i++] = 1;
+    }
+    for (i = 1; i < s.size(); ++i) {
+      if (is_eol(s[i])) mask[i] = mask[i - 1];
+    }
+    return mask;
+  }
+
+}
+
+TEST(Dust, score)
+{
+  std::string homo(64, 'A');
+  EXPECT_DOUBLE_EQ(31.0, bliss::io::dust_masker::score(homo.begin(), homo.end()));
+
+  std::string di;
+  for (int i = 0; i < 64; ++i) di.push_back("CA"[i % 2]);
+  EXPECT_GT(bliss::io::dust_masker::score(di.begin(), di.end()), 2.0);
+
+  std::default_random_engine gen(7);
+  std::uniform_int_distribution<int> base(0, 3);
+  std::string rnd;
+  for (int i = 0; i < 64; ++i) rnd.push_back("ACGT"[base(gen)]);
+  EXPECT_LT(bliss::io::dust_masker::score(rnd.begin(), rnd.end()), 2.0);
+}
+
+TEST(Dust, encode)
+{
+  std::string data;
+  for (int c = 0; c < 256; ++c) data.push_back(static_cast<char>(c));
+  std::default_random_engine gen(11);
+  data += make_reads(1000, gen);
+
+  unsigned char const * p = reinterpret_cast<unsigned char const *>(data.data());
+  for (size_t s = 0; s < 40; ++s) {
+    std::vector<uint8_t> gold(data.size() - s), simd(data.size() - s);
+    bliss::io::dust_encode<false>::encode(p + s, p + data.size(), gold.data());
+    bliss::io::DustEncode::encode(p + s, p + data.size(), simd.data());
+    ASSERT_TRUE(gold == simd);
+  }
+  // the 4 bases have distinct codes in either case.
+  EXPECT_EQ(bliss::io::dust_encode<false>::code('A'), bliss::io::dust_encode<false>::code('a'));
+  EXPECT_EQ(bliss::io::dust_encode<false>::code('T'), bliss::io::dust_encode<false>::code('t'));
+  std::vector<uint8_t> codes = {bliss::io::dust_encode<false>::code('A'), bliss::io::dust_encode<false>::code('C'),
+                                bliss::io::dust_encode<false>::code('G'), bliss::io::dust_encode<false>::code('T')};
+  std::sort(codes.begin(), codes.end());
+  EXPECT_TRUE(codes == std::vector<uint8_t>({0, 1, 2, 3}));
+}
+
+TEST(Dust, mask)
+{
+  std::default_random_engine gen(13);
+  std::string data = make_reads(20000, gen);
+
+  for (size_t window : {8UL, 20UL, 64UL}) {
+    bliss::io::dust_masker masker(window, 2.0);
+    for (size_t s = 0; s < data.size(); s += 1999) {
+      std::string read = data.substr(s, 1 + (s % 3000));
+      std::vector<uint8_t> mask;
+      size_t masked = masker.mask(read.begin(), read.end(), mask);
+      std::vector<uint8_t> gold = reference_mask(read, window, 2.0);
+      ASSERT_TRUE(gold == mask) << "window " << window << " start " << s;
+      EXPECT_EQ(static_cast<size_t>(std::count(gold.begin(), gold.end(), 1)), masked);
+    }
+  }
+
+  // a microsatellite in random sequence is masked, and little of the rest.
+  std::uniform_int_distribution<int> base(0, 3);
+  std::string read;
+  for (int i = 0; i < 300; ++i) read.push_back("ACGT"[base(gen)]);
+  for (int i = 0; i < 100; ++i) read.push_back("AC"[i % 2]);
+  for (int i = 0; i < 300; ++i) read.push_back("ACGT"[base(gen)]);
+  bliss::io::dust_masker masker;
+  std::vector<uint8_t> mask;
+  masker.mask(read.begin(), read.end(), mask);
+  EXPECT_TRUE(std::all_of(mask.begin() + 300, mask.begin() + 400, [](uint8_t x) { return x == 1; }));
+  EXPECT_LT(std::count(mask.begin(), mask.end(), 1), 100 + 2 * 64);
+}
+
+TEST(Dust, split)
+{
+  std::default_random_engine gen(17);
+  std::string data = make_reads(10000, gen);
+
+  // walk the runs as SplitSequencesIterator::split_seq does.
+  bliss::io::DustCharFilter pred;
+  std::vector<uint8_t> gold = reference_mask(data, bliss::io::dust_masker::default_window, 2.0);
+  std::vector<uint8_t> seen(data.size(), 1);
+  auto b = data.cbegin();
+  size_t runs = 0;
+  while (b != data.cend()) {
+    auto vb = bliss::io::split_scanner<bliss::io::DustCharFilter>::find_valid(b, data.cend(), pred);
+    auto ve = bliss::io::split_scanner<bliss::io::DustCharFilter>::find_invalid(vb, data.cend(), pred);
+    for (auto it = vb; it != ve; ++it) seen[it - data.cbegin()] = 0;
+    if (vb != ve) ++runs;
+    b = ve;
+  }
+  EXPECT_TRUE(gold == seen);
+  EXPECT_GT(runs, 10UL);
+
+  // whole reads.
+  struct { std::string::const_iterator seq_begin, seq_end; } seq;
+  bliss::io::DustSequenceFilter filter;
+  std::string homo(100, 'G');
+  seq.seq_begin = homo.cbegin();
+  seq.seq_end = homo.cend();
+  EXPECT_FALSE(filter(seq));
+  std::string rnd;
+  std::uniform_int_distribution<int> base(0, 3);
+  for (int i = 0; i < 100; ++i) rnd.push_back("ACGT"[base(gen)]);
+  seq.seq_begin = rnd.cbegin();
+  seq.seq_end = rnd.cend();
+  EXPECT_TRUE(filter(seq));
+}
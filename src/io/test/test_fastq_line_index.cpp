@@ -0,0 +1,157 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * test_fastq_line_index.cpp
+ * Test the SIMD EOL scan, and that the line indexed FASTQ records are the same as the ones from FASTQParser::get_next_record.
+ */
+
+#include "bliss-config.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "io/fastq_loader.hpp"
+#include "io/sequence_iterator.hpp"
+
+namespace {
+
+  /// random FASTQ records.  names and quality lines contain '@' and '+', some files use CR LF, and some have blank lines.
+  std::vector<unsigned char> make_fastq(size_t const & nrecords, bool crlf, bool blanks, std::default_random_engine & gen) {
+    std::uniform_int_distribution<int> base(0, 3);
+    std::uniform_int_distribution<int> len(1, 300);
+    std::uniform_int_distribution<int> score('!', 'J');
+    std::uniform_int_distribution<int> coin(0, 9);
+    std::string eol = crlf ? "\r\n" : "\n";
+
+    std::string s;
+    for (size_t i = 0; i < nrecords; ++i) {
+      int l = len(gen);
+      s += "@read" + std::to_string(i) + ((coin(gen) == 0) ? " x@y+z" : "") + eol;
+      for (int j = 0; j < l; ++j) s.push_back("ACGT"[base(gen)]);
+      s += eol + ((coin(gen) < 5) ? "+" : "+read" + std::to_string(i)) + eol;
+      for (int j = 0; j < l; ++j) s.push_back((j == 0) && (coin(gen) < 2) ? "@+"[coin(gen) & 1] : static_cast<char>(score(gen)));
+      s += eol;
+      if (blanks && (coin(gen) == 0)) s += eol;
+    }
+    return std::vector<unsigned char>(s.begin(), s.end());
+  }
+
+  template <typename Iter, bool WithQuality>
+  void compare(Iter b, Iter e, size_t const & offset) {
+    using SeqIter = bliss::io::SequencesIterator<Iter, bliss::io::FASTQParser>;
+    using IndexedIter = bliss::io::LineIndexedSequencesIterator<Iter, bliss::io::FASTQParser, WithQuality>;
+
+    bliss::io::FASTQParser<Iter> parser;
+
+    SeqIter gold(parser, b, e, offset);
+    SeqIter gold_end(e);
+    IndexedIter it(parser, b, e, offset);
+    IndexedIter it_end(e);
+
+    size_t n = 0;
+    for (; (gold != gold_end) && (it != it_end); ++gold, ++it, ++n) {
+      ASSERT_EQ(gold.getBaseIterator(), it.getBaseIterator());
+      ASSERT_EQ(gold->id.get_pos(), it->id.get_pos());
+      ASSERT_EQ(gold->record_size, it->record_size);
+      ASSERT_EQ(gold->seq_begin_offset, it->seq_begin_offset);
+      ASSERT_EQ(gold->seq_begin, it->seq_begin);
+      ASSERT_EQ(gold->seq_end, it->seq_end);
+      if (WithQuality) {
+        ASSERT_EQ(gold->qual_begin, it->qual_begin);
+        ASSERT_EQ(gold->qual_end, it->qual_end);
+      } else {
+        ASSERT_EQ(it->seq_end, it->qual_begin);
+        ASSERT_EQ(it->seq_end, it->qual_end);
+      }
+    }
+    EXPECT_TRUE(gold == gold_end);
+    EXPECT_TRUE(it == it_end);
+    EXPECT_GT(n, 0UL);
+
+    // copies share the records, and ++ at end does nothing.
+    IndexedIter copy(parser, b, e, offset);
+    IndexedIter copy2 = copy;
+    ++copy2;
+    EXPECT_TRUE(copy != copy2);
+    ++it;
+    EXPECT_TRUE(it == it_end);
+  }
+
+}
+
+TEST(FASTQLineIndex, eol_scan)
+{
+  std::default_random_engine gen(7);
+  std::vector<unsigned char> data = make_fastq(20, true, true, gen);
+
+  // all starting alignments, and all short lengths.
+  unsigned char const * p = data.data();
+  for (size_t s = 0; s < 64; ++s) {
+    for (size_t e = s; e < data.size(); e += ((e - s) < 100) ? 1 : 97) {
+      ASSERT_EQ(bliss::io::eol_scan<false>::find(p + s, p + e), bliss::io::EOLScan::find(p + s, p + e));
+
+      std::vector<size_t> gold, result;
+      bliss::io::eol_scan<false>::index(p + s, p + e, gold);
+      bliss::io::EOLScan::index(p + s, p + e, result);
+      ASSERT_EQ(gold, result);
+    }
+  }
+}
+
+TEST(FASTQLineIndex, records)
+{
+  std::default_random_engine gen(11);
+  for (bool crlf : {false, true}) {
+    for (bool blanks : {false, true}) {
+      std::vector<unsigned char> data = make_fastq(500, crlf, blanks, gen);
+
+      compare<std::vector<unsigned char>::const_iterator, true>(data.cbegin(), data.cend(), 1000);
+      compare<std::vector<unsigned char>::const_iterator, false>(data.cbegin(), data.cend(), 1000);
+      compare<unsigned char const *, true>(data.data(), data.data() + data.size(), 0);
+      compare<unsigned char const *, false>(data.data(), data.data() + data.size(), 0);
+    }
+  }
+}
+
+TEST(FASTQLineIndex, errors)
+{
+  using Iter = std::vector<unsigned char>::const_iterator;
+  bliss::io::FASTQParser<Iter> parser;
+
+  // quality longer, and shorter, than the sequence, and no + line.
+  for (std::string s : {"@a\nACGT\n+\nIIIII\n@b\nACGT\n+\nIIII\n",
+                        "@a\nACGT\n+\nIII\n@b\nACGT\n+\nIIII\n",
+                        "@a\nACGT\nIIII\n@b\nACGT\n+\nIIII\n"}) {
+    std::vector<unsigned char> data(s.begin(), s.end());
+    std::vector<bliss::io::FASTQSequence<Iter, true> > with;
+    std::vector<bliss::io::FASTQSequence<Iter, false> > without;
+    EXPECT_THROW(parser.index_records<true>(data.begin(), data.end(), 0, with), std::logic_error);
+    EXPECT_THROW(parser.index_records<false>(data.begin(), data.end(), 0, without), std::logic_error);
+  }
+
+  // a truncated last record is kept, as get_next_record does.
+  std::string s("@a\nACGT\n+\nIIII\n@b\nAC");
+  std::vector<unsigned char> data(s.begin(), s.end());
+  std::vector<bliss::io::FASTQSequence<Iter, true> > with;
+  EXPECT_EQ(2UL, parser.index_records<true>(data.begin(), data.end(), 0, with));
+  EXPECT_EQ(2, std::distance(with.back().seq_begin, with.back().seq_end));
+  EXPECT_TRUE(with.back().qual_begin == with.back().qual_end);
+}
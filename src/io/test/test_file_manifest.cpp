@@ -0,0 +1,89 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * test_file_manifest.cpp
+ * Test that the manifest slices cover every byte of every file exactly once, with balanced totals per rank.
+ */
+
+#include "bliss-config.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "io/file_manifest.hpp"
+
+namespace {
+
+  std::string temp_name(size_t const & i) {
+    return std::string("/tmp/bliss_test_file_manifest_") + std::to_string(i) + ".fastq";
+  }
+
+}
+
+TEST(FileManifest, slices)
+{
+  // includes an empty file, and files smaller than a rank's share.
+  std::vector<size_t> sizes = {0, 1, 5000, 3, 0, 17, 12000, 2, 700};
+  std::vector<std::string> files;
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    files.emplace_back(temp_name(i));
+    std::ofstream f(files.back());
+    f << std::string(sizes[i], 'A');
+  }
+
+  std::vector<std::string> globbed = bliss::io::file_manifest::expand("/tmp/bliss_test_file_manifest_*.fastq");
+  EXPECT_EQ(files.size(), globbed.size());
+
+  bliss::io::file_manifest manifest(files);
+  ASSERT_EQ(files.size(), manifest.size());
+  size_t total = 0;
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    EXPECT_EQ(sizes[i], manifest.file_size(i));
+    total += sizes[i];
+  }
+  EXPECT_EQ(total, manifest.total_size());
+
+  for (size_t p : {1UL, 2UL, 7UL, 64UL, 20000UL}) {
+    std::vector<size_t> covered(sizes.size(), 0);
+    std::vector<size_t> next(sizes.size(), 0);
+    for (size_t r = 0; r < p; ++r) {
+      size_t local = 0;
+      size_t last_file = sizes.size();
+      for (auto const & s : manifest.slices(r, p)) {
+        ASSERT_LT(s.file, sizes.size());
+        EXPECT_NE(last_file, s.file) << "file opened twice by rank " << r;
+        last_file = s.file;
+        // contiguous, in order.
+        EXPECT_EQ(next[s.file], s.range.start);
+        EXPECT_LT(s.range.start, s.range.end);
+        EXPECT_LE(s.range.end, sizes[s.file]);
+        next[s.file] = s.range.end;
+        covered[s.file] += s.range.size();
+        local += s.range.size();
+      }
+      EXPECT_LE(local, (total + p - 1) / p) << "p " << p << " rank " << r;
+      EXPECT_GE(local, total / p) << "p " << p << " rank " << r;
+    }
+    EXPECT_EQ(sizes, covered) << "p " << p;
+  }
+
+  for (auto const & f : files) std::remove(f.c_str());
+}
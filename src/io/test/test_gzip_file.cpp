@@ -0,0 +1,196 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "bliss-config.hpp"    // for location of data.
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint> // for uint64_t, etc.
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#if defined(USE_ZLIB)
+
+#include <zlib.h>
+#include <cstdio>   // remove
+#include <cstdlib>  // mkstemp
+
+#include "io/file.hpp"
+#include "io/gzip_file.hpp"
+
+
+class GzipFileTest : public ::testing::TestWithParam<bool>
+{
+  protected:
+    std::string fileName;
+    std::vector<unsigned char> gold;
+
+    /// gzip member of src, with a flush every flush_bytes.  alternate flush modes so block boundaries are not all byte aligned.
+    static void deflate_member(unsigned char const * src, size_t len, size_t flush_bytes, std::vector<unsigned char> & out) {
+      z_stream strm;
+      memset(&strm, 0, sizeof(z_stream));
+      ASSERT_EQ(Z_OK, deflateInit2(&strm, 6, Z_DEFLATED, 31, 8, Z_DEFAULT_STRATEGY));
+
+      std::vector<unsigned char> buf(deflateBound(&strm, len) + 1024);
+      strm.next_out = buf.data();
+      strm.avail_out = buf.size();
+
+      size_t pos = 0;
+      int i = 0;
+      while (pos < len) {
+        size_t n = std::min(flush_bytes, len - pos);
+        strm.next_in = const_cast<unsigned char *>(src + pos);
+        strm.avail_in = n;
+        pos += n;
+        int flush = (pos == len) ? Z_FINISH : (((++i) % 2) ? Z_BLOCK : Z_SYNC_FLUSH);
+        int ret = deflate(&strm, flush);
+        ASSERT_TRUE((ret == Z_OK) || (ret == Z_STREAM_END));
+      }
+      out.insert(out.end(), buf.data(), strm.next_out);
+      deflateEnd(&strm);
+    }
+
+    /// BGZF block: gzip member whose header carries the BC field with the block size.
+    static void bgzf_block(unsigned char const * src, size_t len, std::vector<unsigned char> & out) {
+      std::vector<unsigned char> raw(compressBound(len) + 64);
+      z_stream strm;
+      memset(&strm, 0, sizeof(z_stream));
+      ASSERT_EQ(Z_OK, deflateInit2(&strm, 6, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY));
+      strm.next_in = const_cast<unsigned char *>(src);
+      strm.avail_in = len;
+      strm.next_out = raw.data();
+      strm.avail_out = raw.size();
+      ASSERT_EQ(Z_STREAM_END, deflate(&strm, Z_FINISH));
+      size_t clen = strm.total_out;
+      deflateEnd(&strm);
+
+      size_t bsize = 18 + clen + 8;
+      unsigned char hdr[18] = {0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0,
+                               static_cast<unsigned char>((bsize - 1) & 0xff), static_cast<unsigned char>((bsize - 1) >> 8)};
+      out.insert(out.end(), hdr, hdr + 18);
+      out.insert(out.end(), raw.data(), raw.data() + clen);
+
+      uint32_t crc = crc32(0L, src, len);
+      uint32_t tail[2] = {crc, static_cast<uint32_t>(len)};
+      out.insert(out.end(), reinterpret_cast<unsigned char *>(tail), reinterpret_cast<unsigned char *>(tail) + 8);
+    }
+
+    virtual void SetUp()
+    {
+      std::string src(PROJ_SRC_DIR);
+      src.append("/test/data/test.medium.fastq");
+
+      // repeat the file so plain gzip has multiple access points.
+      ::bliss::io::posix_file fobj(src);
+      ::bliss::io::file_data fdata = fobj.read_file();
+      for (int i = 0; i < 8; ++i) gold.insert(gold.end(), fdata.data.begin(), fdata.data.end());
+
+      std::vector<unsigned char> compressed;
+      if (GetParam()) {
+        for (size_t pos = 0; pos < gold.size(); pos += 5000)
+          bgzf_block(gold.data() + pos, std::min(static_cast<size_t>(5000), gold.size() - pos), compressed);
+        bgzf_block(gold.data(), 0, compressed);  // EOF marker
+      } else {
+        // 2 members
+        size_t half = gold.size() / 2 + 13;
+        deflate_member(gold.data(), half, 10000, compressed);
+        deflate_member(gold.data() + half, gold.size() - half, 10000, compressed);
+      }
+
+      char name[] = "/tmp/bliss_test_gzXXXXXX";
+      int fd = mkstemp(name);
+      ASSERT_TRUE(fd >= 0);
+      ASSERT_EQ(static_cast<ssize_t>(compressed.size()), write(fd, compressed.data(), compressed.size()));
+      close(fd);
+      fileName = name;
+    }
+
+    virtual void TearDown() {
+      remove(fileName.c_str());
+      remove((fileName + ::bliss::io::gzip_file::index_suffix()).c_str());
+    }
+
+    void check(::bliss::io::gzip_file & fobj, ::bliss::io::file_data::range_type const & range) {
+      ::bliss::io::file_data::container output;
+      ::bliss::io::file_data::range_type r = fobj.read_range(output, range);
+
+      ASSERT_EQ(range.start, r.start);
+      ASSERT_EQ(std::min(range.end, fobj.size()), r.end);
+      ASSERT_EQ(r.size(), output.size());
+      EXPECT_TRUE(std::equal(output.begin(), output.end(), gold.begin() + r.start));
+    }
+};
+
+
+TEST_P(GzipFileTest, read_file)
+{
+  ::bliss::io::gzip_file fobj(this->fileName);
+  EXPECT_EQ(GetParam(), fobj.is_bgzf());
+  ASSERT_EQ(this->gold.size(), fobj.size());
+
+  ::bliss::io::file_data fdata = fobj.read_file();
+  ASSERT_EQ(this->gold.size(), fdata.data.size());
+  EXPECT_TRUE(std::equal(fdata.data.begin(), fdata.data.end(), this->gold.begin()));
+}
+
+TEST_P(GzipFileTest, read_range)
+{
+  ::bliss::io::gzip_file fobj(this->fileName);
+  size_t s = fobj.size();
+
+  for (size_t span : {1000UL, 40000UL, 1UL << 20}) {
+    fobj.build_index(span);
+    if (span < 50000) {
+      EXPECT_LT(2UL, fobj.get_access_points().size());
+    }
+
+    for (int threads : {1, 3}) {
+      fobj.set_threads(threads);
+
+      this->check(fobj, ::bliss::io::file_data::range_type(0, s));
+      this->check(fobj, ::bliss::io::file_data::range_type(1, s / 2 + 7));
+      this->check(fobj, ::bliss::io::file_data::range_type(s / 3, s + 100));
+      this->check(fobj, ::bliss::io::file_data::range_type(40000, 40001));
+      this->check(fobj, ::bliss::io::file_data::range_type(s - 1, s));
+    }
+  }
+}
+
+TEST_P(GzipFileTest, index_file)
+{
+  size_t npoints;
+  {
+    ::bliss::io::gzip_file fobj(this->fileName);
+    fobj.build_index(40000);
+    npoints = fobj.get_access_points().size();
+    fobj.write_index(this->fileName + ::bliss::io::gzip_file::index_suffix());
+  }
+
+  // composition constructor, as used by partitioned_file.  finds the index via the fd.
+  ::bliss::io::posix_file pfile(this->fileName);
+  ::bliss::io::gzip_file fobj(open64(this->fileName.c_str(), O_RDONLY), pfile.size());
+  EXPECT_EQ(npoints, fobj.get_access_points().size());
+  EXPECT_EQ(pfile.size(), fobj.compressed_size());
+
+  this->check(fobj, ::bliss::io::file_data::range_type(100, fobj.size()));
+}
+
+
+INSTANTIATE_TEST_CASE_P(Bliss, GzipFileTest, ::testing::Values(true, false));
+
+#endif
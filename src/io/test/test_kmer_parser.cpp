@@ -0,0 +1,320 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * test_kmer_parser.cpp
+ * Test FusedKmerPositionQualityTupleParser against KmerPositionQualityTupleParser, packed_pair values against std::pair,
+ * the amino acid and translated k-mer parsers, and the minimizer parsers.
+ */
+
+#include "bliss-config.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/packed_pair.hpp"
+#include "io/fastq_loader.hpp"
+#include "io/kmer_parser.hpp"
+
+namespace {
+
+  using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+  using IdType = bliss::common::ShortSequenceKmerId;
+
+  /// random read with EOL every line_len characters, and a matching quality string.
+  void make_read(size_t const & len, size_t const & line_len, std::default_random_engine & gen,
+                 std::string & seq, std::string & qual) {
+    std::uniform_int_distribution<int> base(0, 3);
+    // mostly good scores, and a few '!' (incorrect) ones.
+    std::uniform_int_distribution<int> score(0, 40);
+    seq.clear();
+    qual.clear();
+    for (size_t i = 0; i < len; ++i) {
+      if ((line_len > 0) && (i > 0) && ((i % line_len) == 0)) {
+        seq.push_back('\n');
+        qual.push_back('\n');
+      }
+      seq.push_back("ACGT"[base(gen)]);
+      qual.push_back(static_cast<char>('!' + score(gen)));
+    }
+  }
+
+  /// per_char:  output capacity per character.  the translated parser makes 2 k-mers per position.
+  template <typename Parser, typename SeqType>
+  std::vector<typename Parser::value_type> parse(SeqType const & read, ::bliss::partition::range<size_t> const & valid,
+                                                 size_t per_char = 1) {
+    Parser parser(valid);
+    std::vector<typename Parser::value_type> out(read.seq_size() * per_char);
+    out.erase(parser(read, out.begin()), out.end());
+    return out;
+  }
+
+  template <typename Iter, template <typename> class QualityEncoder, typename QualType>
+  void compare(Iter seq_b, Iter seq_e, Iter qual_b, Iter qual_e, size_t const & offset,
+               ::bliss::partition::range<size_t> const & valid) {
+    using TupleType = std::pair<KmerType, std::pair<IdType, QualType> >;
+    using SeqType = bliss::io::FASTQSequence<Iter>;
+
+    SeqType read(bliss::common::SequenceId(offset), std::distance(seq_b, qual_e), 0, seq_b, seq_e, qual_b, qual_e);
+
+    auto gold = parse<bliss::index::kmer::KmerPositionQualityTupleParser<TupleType, QualityEncoder> >(read, valid);
+    auto fused = parse<bliss::index::kmer::FusedKmerPositionQualityTupleParser<TupleType, QualityEncoder> >(read, valid);
+
+    ASSERT_EQ(gold.size(), fused.size());
+    for (size_t i = 0; i < gold.size(); ++i) {
+      ASSERT_EQ(gold[i].first, fused[i].first) << "kmer " << i;
+      ASSERT_EQ(gold[i].second.first.get_pos(), fused[i].second.first.get_pos()) << "kmer " << i;
+      // the bulk scorer may sum in a different order.
+      ASSERT_NEAR(static_cast<double>(gold[i].second.second), static_cast<double>(fused[i].second.second),
+                  1e-5 * (1.0 + std::fabs(static_cast<double>(gold[i].second.second)))) << "kmer " << i;
+    }
+  }
+
+  /// same parser with std::pair and packed_pair (position, quality) values:  same tuples.
+  template <template <typename, template <typename> class> class Parser, typename Iter,
+            template <typename> class QualityEncoder, typename QualType>
+  void compare_packed(Iter seq_b, Iter seq_e, Iter qual_b, Iter qual_e, size_t const & offset,
+                      ::bliss::partition::range<size_t> const & valid) {
+    using TupleType = std::pair<KmerType, std::pair<IdType, QualType> >;
+    using PackedType = std::pair<KmerType, bliss::common::packed_pair<IdType, QualType> >;
+    using SeqType = bliss::io::FASTQSequence<Iter>;
+
+    SeqType read(bliss::common::SequenceId(offset), std::distance(seq_b, qual_e), 0, seq_b, seq_e, qual_b, qual_e);
+
+    auto gold = parse<Parser<TupleType, QualityEncoder> >(read, valid);
+    auto packed = parse<Parser<PackedType, QualityEncoder> >(read, valid);
+
+    using Mapped = bliss::common::packed_pair<IdType, QualType>;
+    ASSERT_EQ(gold.size(), packed.size());
+    for (size_t i = 0; i < gold.size(); ++i) {
+      ASSERT_EQ(gold[i].first, packed[i].first) << "kmer " << i;
+      ASSERT_TRUE(Mapped(gold[i].second) == packed[i].second) << "kmer " << i;
+    }
+  }
+
+}
+
+
+TEST(PackedPair, layout)
+{
+  static_assert(std::is_trivially_copyable<IdType>::value, "ShortSequenceKmerId should be trivially copyable");
+  static_assert(std::is_trivially_copyable<bliss::common::packed_pair<IdType, float> >::value, "packed_pair should be trivially copyable");
+  EXPECT_EQ(sizeof(IdType) + sizeof(float), sizeof(bliss::common::packed_pair<IdType, float>));
+  EXPECT_EQ(sizeof(IdType) + sizeof(uint8_t), sizeof(bliss::common::packed_pair<IdType, uint8_t>));
+  EXPECT_EQ(16UL, sizeof(std::pair<IdType, uint8_t>));
+
+  using Mapped = bliss::common::packed_pair<IdType, uint8_t>;
+  Mapped x(IdType(100, 0, 3), 7);
+  std::pair<IdType, uint8_t> y = x;
+  EXPECT_EQ(IdType(x.first).get_pos(), y.first.get_pos());
+  EXPECT_EQ(7, y.second);
+  EXPECT_TRUE(x == Mapped(y));
+}
+
+TEST(PackedPair, parsers)
+{
+  std::default_random_engine gen(5);
+  std::string seq, qual;
+
+  for (size_t len : {21UL, 150UL, 1000UL}) {
+    make_read(len, 60, gen, seq, qual);
+    std::string rec = seq + "\n+\n" + qual;
+    char const * b = rec.data();
+    char const * se = b + seq.size();
+    char const * qb = se + 3;
+    char const * qe = qb + qual.size();
+
+    std::list<char> lrec(rec.begin(), rec.end());
+    auto lb = lrec.cbegin();
+    auto lse = std::next(lb, seq.size());
+    auto lqb = std::next(lse, 3);
+    auto lqe = std::next(lqb, qual.size());
+
+    ::bliss::partition::range<size_t> valid(0, 100000);
+    compare_packed<bliss::index::kmer::KmerPositionQualityTupleParser, char const *,
+                   bliss::index::QuantizedIllumina18QualityScoreCodec, uint8_t>(b, se, qb, qe, 0, valid);
+    compare_packed<bliss::index::kmer::FusedKmerPositionQualityTupleParser, char const *,
+                   bliss::index::Illumina18QualityScoreCodec, float>(b, se, qb, qe, 0, valid);
+    // zip iterator path, converted from std::pair.
+    compare_packed<bliss::index::kmer::KmerPositionQualityTupleParser, std::list<char>::const_iterator,
+                   bliss::index::Illumina18QualityScoreCodec, float>(lb, lse, lqb, lqe, 0, valid);
+  }
+}
+
+TEST(FusedKmerPositionQualityTupleParser, contiguous)
+{
+  std::default_random_engine gen(7);
+  std::string seq, qual;
+
+  for (size_t len : {0UL, 20UL, 21UL, 150UL, 1000UL}) {
+    for (size_t line_len : {0UL, 60UL}) {
+      make_read(len, line_len, gen, seq, qual);
+      std::string rec = seq + "\n+\n" + qual;
+      char const * b = rec.data();
+      char const * se = b + seq.size();
+      char const * qb = se + 3;
+      char const * qe = qb + qual.size();
+
+      for (size_t vs : {0UL, 50UL}) {
+        ::bliss::partition::range<size_t> valid(1000 + vs, 1000 + vs + len / 2 + 30);
+        compare<char const *, bliss::index::Illumina18QualityScoreCodec, float>(b, se, qb, qe, 1000, valid);
+        compare<char const *, bliss::index::QuantizedIllumina18QualityScoreCodec, uint8_t>(b, se, qb, qe, 1000, valid);
+      }
+    }
+  }
+}
+
+TEST(FusedKmerPositionQualityTupleParser, iterator)
+{
+  std::default_random_engine gen(11);
+  std::string seq, qual;
+
+  for (size_t len : {21UL, 150UL, 1000UL}) {
+    make_read(len, 60, gen, seq, qual);
+    std::string s = seq + "\n+\n" + qual;
+    std::list<char> rec(s.begin(), s.end());
+    auto b = rec.cbegin();
+    auto se = std::next(b, seq.size());
+    auto qb = std::next(se, 3);
+    auto qe = std::next(qb, qual.size());
+
+    ::bliss::partition::range<size_t> valid(0, 100000);
+    compare<std::list<char>::const_iterator, bliss::index::Illumina18QualityScoreCodec, float>(b, se, qb, qe, 0, valid);
+  }
+}
+
+TEST(TranslatedKmerParser, partitions)
+{
+  using AAKmerType = bliss::common::Kmer<12, bliss::common::AA, uint64_t>;
+  using Parser = bliss::index::kmer::TranslatedKmerParser<AAKmerType>;
+  using SeqType = bliss::io::FASTQSequence<char const *>;
+
+  std::default_random_engine gen(13);
+  std::string seq, qual;
+
+  for (size_t len : {35UL, 36UL, 150UL, 1000UL}) {
+    make_read(len, 60, gen, seq, qual);
+    std::string rec = seq + "\n+\n" + qual;
+    char const * b = rec.data();
+    char const * se = b + seq.size();
+    char const * qb = se + 3;
+    char const * qe = qb + qual.size();
+    SeqType read(bliss::common::SequenceId(1000), std::distance(b, qe), 0, b, se, qb, qe);
+
+    // whole read, 2 k-mers per position with 36 nucleotides from it.
+    auto whole = parse<Parser>(read, ::bliss::partition::range<size_t>(0, 100000), 2);
+    size_t n = std::count_if(seq.begin(), seq.end(), bliss::utils::file::NotEOL());
+    ASSERT_EQ((n < 36) ? 0 : 2 * (n - 36 + 1), whole.size());
+
+    // split anywhere, the 2 parts give the same k-mers.
+    for (size_t split : {1UL, 37UL, len / 2}) {
+      auto first = parse<Parser>(read, ::bliss::partition::range<size_t>(1000, 1000 + split), 2);
+      auto second = parse<Parser>(read, ::bliss::partition::range<size_t>(1000 + split, 100000), 2);
+      first.insert(first.end(), second.begin(), second.end());
+      std::sort(first.begin(), first.end());
+      std::vector<AAKmerType> gold(whole);
+      std::sort(gold.begin(), gold.end());
+      ASSERT_EQ(gold.size(), first.size()) << "split " << split;
+      EXPECT_TRUE(std::equal(gold.begin(), gold.end(), first.begin())) << "split " << split;
+    }
+  }
+}
+
+TEST(KmerParser, amino_acids)
+{
+  using AAKmerType = bliss::common::Kmer<12, bliss::common::AA, uint64_t>;
+  std::string s = "MKVLAAGIVGLLLAQPAMAADSTGAVQKLFDEVRH\nWQRLMKVLAAGIVGLLLAQPAMAADSTGAVQK*\n+\n";
+  std::list<char> l(s.begin(), s.end());
+  size_t len = s.size() - 3;
+
+  // bulk encoder path and the iterator path give the same k-mers.
+  bliss::io::FASTQSequence<char const *> r1(bliss::common::SequenceId(0), s.size(), 0, s.data(), s.data() + len, s.data() + len, s.data() + len);
+  bliss::io::FASTQSequence<std::list<char>::const_iterator> r2(bliss::common::SequenceId(0), s.size(), 0,
+      l.cbegin(), std::next(l.cbegin(), len), std::next(l.cbegin(), len), std::next(l.cbegin(), len));
+  ::bliss::partition::range<size_t> valid(0, 100000);
+  auto a = parse<bliss::index::kmer::KmerParser<AAKmerType> >(r1, valid);
+  auto b = parse<bliss::index::kmer::KmerParser<AAKmerType> >(r2, valid);
+  ASSERT_EQ(len - 1 - 12 + 1, a.size());
+  ASSERT_EQ(a.size(), b.size());
+  EXPECT_TRUE(std::equal(a.begin(), a.end(), b.begin()));
+  EXPECT_EQ("MKVLAAGIVGLL", bliss::utils::KmerUtils::toASCIIString(a[0]));
+}
+
+TEST(MinimizerPositionTupleParser, sampling)
+{
+  constexpr unsigned int W = 10;
+  using TupleType = std::pair<KmerType, IdType>;
+  using Parser = bliss::index::kmer::MinimizerPositionTupleParser<TupleType, W>;
+  using SeqType = bliss::io::FASTQSequence<char const *>;
+  bliss::kmer::hash::nthash<KmerType, false, true> hash;
+
+  std::default_random_engine gen(17);
+  std::string seq, qual;
+
+  for (size_t len : {25UL, 30UL, 31UL, 150UL, 2000UL}) {
+    make_read(len, 60, gen, seq, qual);
+    std::string rec = seq + "\n+\n" + qual;
+    char const * b = rec.data();
+    char const * se = b + seq.size();
+    char const * qb = se + 3;
+    char const * qe = qb + qual.size();
+    SeqType read(bliss::common::SequenceId(1000), std::distance(b, qe), 0, b, se, qb, qe);
+    ::bliss::partition::range<size_t> all(0, 100000);
+
+    // brute force:  the first smallest hash of each window of W k-mers, each position once.
+    auto kmers = parse<bliss::index::kmer::KmerPositionTupleParser<TupleType> >(read, all);
+    std::vector<TupleType> gold;
+    for (size_t s = 0; (s + W) <= kmers.size(); ++s) {
+      size_t m = s;
+      for (size_t j = s + 1; j < s + W; ++j)
+        if (hash(kmers[j].first) < hash(kmers[m].first)) m = j;
+      if (gold.empty() || !(gold.back().second.get_pos() == kmers[m].second.get_pos())) gold.emplace_back(kmers[m]);
+    }
+
+    auto whole = parse<Parser>(read, all);
+    ASSERT_EQ(gold.size(), whole.size()) << "len " << len;
+    for (size_t i = 0; i < gold.size(); ++i) {
+      ASSERT_EQ(gold[i].first, whole[i].first) << "len " << len << " at " << i;
+      ASSERT_EQ(gold[i].second.get_pos(), whole[i].second.get_pos()) << "len " << len << " at " << i;
+    }
+    if (len >= 2000) EXPECT_LT(whole.size(), kmers.size() / 3);
+
+    // the query side selects the same k-mers.
+    auto query = parse<bliss::index::kmer::MinimizerKmerParser<KmerType, W> >(read, all);
+    ASSERT_EQ(whole.size(), query.size());
+    for (size_t i = 0; i < whole.size(); ++i) ASSERT_EQ(whole[i].first, query[i]);
+
+    // split anywhere, the 2 parts together have every minimizer, and only add duplicates.
+    for (size_t split : {1UL, 37UL, len / 2}) {
+      auto first = parse<Parser>(read, ::bliss::partition::range<size_t>(1000, 1000 + split));
+      auto second = parse<Parser>(read, ::bliss::partition::range<size_t>(1000 + split, 100000));
+      first.insert(first.end(), second.begin(), second.end());
+      std::vector<size_t> pos, gold_pos;
+      for (auto const & x : first) pos.emplace_back(x.second.get_pos());
+      for (auto const & x : whole) gold_pos.emplace_back(x.second.get_pos());
+      std::sort(pos.begin(), pos.end());
+      pos.erase(std::unique(pos.begin(), pos.end()), pos.end());
+      EXPECT_TRUE(pos == gold_pos) << "len " << len << " split " << split;
+    }
+  }
+}
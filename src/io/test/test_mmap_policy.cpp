@@ -0,0 +1,104 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "bliss-config.hpp"    // for location of data.
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint> // for uint64_t, etc.
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "io/file.hpp"
+
+
+class MmapPolicyTest : public ::testing::TestWithParam<std::string>
+{
+  protected:
+    std::string fileName;
+    ::bliss::io::file_data gold;
+
+    virtual void SetUp()
+    {
+      fileName.assign(PROJ_SRC_DIR);
+      fileName.append(GetParam());
+
+      ::bliss::io::posix_file fobj(fileName);
+      gold = fobj.read_file();
+      ASSERT_TRUE(gold.data.size() > 0);
+    }
+
+    void check(::bliss::io::mmap_file & fobj, ::bliss::io::file_data::range_type const & range) {
+      // reused output, to check that the policy path does not depend on a fresh buffer.
+      ::bliss::io::file_data::container output(7, 0);
+      ::bliss::io::file_data::range_type r = fobj.read_range(output, range);
+
+      ASSERT_EQ(range.start, r.start);
+      ASSERT_EQ(std::min(range.end, fobj.size()), r.end);
+      ASSERT_EQ(r.size(), output.size());
+      EXPECT_TRUE(std::equal(output.begin(), output.end(), gold.data.begin() + r.start));
+    }
+};
+
+
+TEST_P(MmapPolicyTest, read_range)
+{
+  ::bliss::io::mmap_file fobj(this->fileName);
+  size_t s = fobj.size();
+
+  for (bool populate : {false, true}) {
+    for (bool hugepage : {false, true}) {
+      for (int numa : {0, 1, 3}) {
+        ::bliss::io::mmap_policy policy;
+        policy.populate = populate;
+        policy.hugepage = hugepage;
+        policy.numa_threads = numa;
+        fobj.set_policy(policy);
+        EXPECT_EQ(numa, fobj.get_policy().numa_threads);
+
+        this->check(fobj, ::bliss::io::file_data::range_type(0, s));
+        this->check(fobj, ::bliss::io::file_data::range_type(1, s / 2 + 7));
+        this->check(fobj, ::bliss::io::file_data::range_type(s / 3, s + 100));
+        this->check(fobj, ::bliss::io::file_data::range_type(s - 1, s));
+      }
+    }
+  }
+}
+
+TEST_P(MmapPolicyTest, map)
+{
+  ::bliss::io::mmap_file fobj(this->fileName);
+
+  ::bliss::io::mmap_policy policy;
+  policy.advice = MADV_RANDOM;
+  policy.populate = true;
+  policy.hugepage = true;
+  fobj.set_policy(policy);
+
+  ::bliss::io::mapped_data md = fobj.map(::bliss::io::file_data::range_type(0, fobj.size()));
+  ASSERT_EQ(fobj.size(), md.size());
+  EXPECT_TRUE(std::equal(md.get_data(), md.get_data() + md.size(), this->gold.data.begin()));
+}
+
+
+INSTANTIATE_TEST_CASE_P(Bliss, MmapPolicyTest, ::testing::Values(
+    std::string("/test/data/test.medium.fastq"),
+    std::string("/test/data/test.debruijn.tiny.fastq"),
+    std::string("/test/data/test.unitiqs.fastq"),
+    std::string("/test/data/test.medium.fasta")
+));
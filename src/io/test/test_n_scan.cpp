@@ -0,0 +1,103 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * test_n_scan.cpp
+ * Test the bulk N scan used by NSplitSequencesIterator against the per character predicate.
+ */
+
+#include "bliss-config.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <list>
+#include <random>
+#include <vector>
+
+#include "io/filtered_sequence_iterator.hpp"
+
+namespace {
+
+  /// bases with runs of N and n of random lengths, and the occasional EOL.
+  std::vector<unsigned char> make_scaffold(size_t const & len, std::default_random_engine & gen) {
+    std::uniform_int_distribution<int> base(0, 3);
+    std::uniform_int_distribution<int> run(0, 80);
+    std::uniform_int_distribution<int> coin(0, 9);
+    std::vector<unsigned char> data;
+    while (data.size() < len) {
+      int r = run(gen);
+      for (int i = 0; i < r; ++i) data.push_back(coin(gen) == 0 ? '\n' : "ACGT"[base(gen)]);
+      r = (coin(gen) < 3) ? run(gen) : 0;
+      for (int i = 0; i < r; ++i) data.push_back(coin(gen) < 5 ? 'N' : 'n');
+    }
+    data.resize(len);
+    return data;
+  }
+
+}
+
+TEST(NScan, find)
+{
+  std::default_random_engine gen(17);
+  std::vector<unsigned char> data = make_scaffold(4000, gen);
+  bliss::io::NCharFilter pred;
+
+  // all starting alignments, and all short lengths.
+  for (size_t s = 0; s < 64; ++s) {
+    for (size_t e = s; e < data.size(); e += ((e - s) < 100) ? 1 : 97) {
+      auto b = data.cbegin() + s;
+      auto end = data.cbegin() + e;
+      ASSERT_EQ(std::find_if(b, end, pred) - data.cbegin(),
+                bliss::io::split_scanner<bliss::io::NCharFilter>::find_valid(b, end, pred) - data.cbegin());
+      ASSERT_EQ(std::find_if_not(b, end, pred) - data.cbegin(),
+                bliss::io::split_scanner<bliss::io::NCharFilter>::find_invalid(b, end, pred) - data.cbegin());
+
+      unsigned char const * p = data.data();
+      ASSERT_EQ(bliss::io::n_scan<false>::find<true>(p + s, p + e), bliss::io::NScan::find<true>(p + s, p + e));
+      ASSERT_EQ(bliss::io::n_scan<false>::find<false>(p + s, p + e), bliss::io::NScan::find<false>(p + s, p + e));
+    }
+  }
+}
+
+TEST(NScan, split)
+{
+  std::default_random_engine gen(23);
+  std::vector<unsigned char> data = make_scaffold(10000, gen);
+  std::list<unsigned char> ldata(data.begin(), data.end());
+  bliss::io::NCharFilter pred;
+
+  // walk the valid runs as split_seq does, on contiguous and on list data.
+  auto b = data.cbegin();
+  auto lb = ldata.cbegin();
+  size_t runs = 0;
+  while (b != data.cend()) {
+    auto vb = bliss::io::split_scanner<bliss::io::NCharFilter>::find_valid(b, data.cend(), pred);
+    auto ve = bliss::io::split_scanner<bliss::io::NCharFilter>::find_invalid(vb, data.cend(), pred);
+
+    auto lvb = bliss::io::split_scanner<bliss::io::NCharFilter>::find_valid(lb, ldata.cend(), pred);
+    auto lve = bliss::io::split_scanner<bliss::io::NCharFilter>::find_invalid(lvb, ldata.cend(), pred);
+
+    ASSERT_EQ(std::distance(data.cbegin(), vb), std::distance(ldata.cbegin(), lvb));
+    ASSERT_EQ(std::distance(data.cbegin(), ve), std::distance(ldata.cbegin(), lve));
+    ASSERT_TRUE(std::none_of(vb, ve, [](unsigned char c) { return (c == 'N') || (c == 'n'); }));
+
+    if (vb != ve) ++runs;
+    b = ve;
+    lb = lve;
+  }
+  EXPECT_GT(runs, 10UL);
+}
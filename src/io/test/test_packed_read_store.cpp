@@ -0,0 +1,185 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * test_packed_read_store.cpp
+ * Test that PackedReadStore generates the same tuples as the kmer parsers on the ASCII reads.
+ */
+
+#include "bliss-config.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "io/kmer_parser.hpp"
+#include "io/packed_read_store.hpp"
+
+namespace {
+
+  using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+  using SeqType = bliss::common::Sequence<char const *>;
+
+  /// record with a 12 char header, sequence with EOL every line_len characters (0 for none).
+  std::string make_record(size_t const & len, size_t const & line_len, std::default_random_engine & gen) {
+    std::uniform_int_distribution<int> base(0, 3);
+    std::string rec(">read header");
+    rec.push_back('\n');
+    for (size_t i = 0; i < len; ++i) {
+      if ((line_len > 0) && (i > 0) && ((i % line_len) == 0)) rec.push_back('\n');
+      rec.push_back("ACGT"[base(gen)]);
+    }
+    rec.push_back('\n');
+    return rec;
+  }
+
+  template <typename Parser>
+  std::vector<typename Parser::value_type> parse(std::vector<SeqType> const & reads, ::bliss::partition::range<size_t> const & valid) {
+    Parser parser(valid);
+    std::vector<typename Parser::value_type> out;
+    for (auto const & read : reads) {
+      std::vector<typename Parser::value_type> o(read.seq_size());
+      o.erase(parser(read, o.begin()), o.end());
+      out.insert(out.end(), o.begin(), o.end());
+    }
+    return out;
+  }
+
+  class PackedReadStoreTest : public ::testing::Test {
+    protected:
+      std::string data;
+      std::vector<SeqType> reads;
+
+      virtual void SetUp() {
+        std::default_random_engine gen(23);
+        std::uniform_int_distribution<size_t> len(10, 400);
+
+        std::vector<size_t> starts;
+        for (size_t i = 0; i < 60; ++i) {
+          starts.push_back(data.size());
+          // single line reads, uniform lines, and lines of 1 character.
+          data.append(make_record(len(gen), (i % 3 == 0) ? 0 : ((i % 3 == 1) ? 60 : 1), gen));
+        }
+        for (size_t i = 0; i < starts.size(); ++i) {
+          size_t end = (i + 1 < starts.size()) ? starts[i + 1] : data.size();
+          char const * b = data.data() + starts[i];
+          reads.emplace_back(bliss::common::SequenceId(starts[i], i), end - starts[i], 13, 13, b + 13, data.data() + end - 1);
+        }
+      }
+
+      /// pack the reads, trimmed the same way as SequencePacker does.
+      void pack(bliss::io::PackedReadStore<bliss::common::DNA> & store, ::bliss::partition::range<size_t> const & valid) {
+        for (auto const & read : reads) {
+          char const * b;
+          char const * e;
+          bool has_window;
+          std::tie(b, e, has_window) =
+              ::bliss::index::kmer::KmerParser<KmerType>::get_valid_iterator_range(read, valid, KmerType::size);
+          if (!has_window) continue;
+          store.append(b, e, read.seq_global_offset() + std::distance(read.seq_begin, b), read.id, KmerType::size);
+        }
+      }
+
+      template <typename Parser>
+      void compare(::bliss::partition::range<size_t> const & valid) {
+        bliss::io::PackedReadStore<bliss::common::DNA> store;
+        pack(store, valid);
+
+        auto gold = parse<Parser>(reads, valid);
+        ASSERT_GT(gold.size(), 0UL);
+        std::vector<typename Parser::value_type> result;
+        store.template generate<Parser>(result);
+
+        ASSERT_EQ(gold.size(), result.size());
+        for (size_t i = 0; i < gold.size(); ++i) {
+          ASSERT_TRUE(gold[i] == result[i]) << "tuple " << i;
+        }
+      }
+  };
+
+  TEST_F(PackedReadStoreTest, kmers) {
+    this->compare<bliss::index::kmer::KmerParser<KmerType> >(::bliss::partition::range<size_t>(0, data.size()));
+    // valid range ending inside a read.
+    this->compare<bliss::index::kmer::KmerParser<KmerType> >(::bliss::partition::range<size_t>(0, data.size() / 2));
+  }
+
+  TEST_F(PackedReadStoreTest, counts) {
+    using Parser = bliss::index::kmer::KmerCountTupleParser<std::pair<KmerType, uint32_t> >;
+    this->compare<Parser>(::bliss::partition::range<size_t>(0, data.size()));
+    this->compare<Parser>(::bliss::partition::range<size_t>(data.size() / 3, data.size() / 2));
+  }
+
+  TEST_F(PackedReadStoreTest, positions) {
+    using ShortParser = bliss::index::kmer::KmerPositionTupleParser<std::pair<KmerType, bliss::common::ShortSequenceKmerId> >;
+    using LongParser = bliss::index::kmer::KmerPositionTupleParser<std::pair<KmerType, bliss::common::LongSequenceKmerId> >;
+    this->compare<ShortParser>(::bliss::partition::range<size_t>(0, data.size()));
+    this->compare<ShortParser>(::bliss::partition::range<size_t>(data.size() / 3, data.size() / 2));
+    this->compare<LongParser>(::bliss::partition::range<size_t>(0, data.size()));
+    this->compare<LongParser>(::bliss::partition::range<size_t>(data.size() / 3, data.size() / 2));
+  }
+
+  TEST_F(PackedReadStoreTest, packed_positions) {
+    using PackedId = bliss::common::PackedSequenceKmerId<uint32_t>;
+    bliss::io::PackedReadStore<bliss::common::DNA> store;
+    pack(store, ::bliss::partition::range<size_t>(0, data.size()));
+
+    size_t max_file, max_seq, max_pos;
+    store.id_maxima(max_file, max_seq, max_pos);
+    EXPECT_EQ(0UL, max_file);
+    EXPECT_LT(max_seq, data.size());
+    EXPECT_LT(max_pos, 2 * 400UL);
+    PackedId::set_layout(max_file, max_seq, max_pos);
+    EXPECT_EQ(0, PackedId::layout().file_bits);
+    EXPECT_LE(PackedId::layout().total(), 32UL);
+
+    using PackedParser = bliss::index::kmer::KmerPositionTupleParser<std::pair<KmerType, PackedId> >;
+    this->compare<PackedParser>(::bliss::partition::range<size_t>(0, data.size()));
+    this->compare<PackedParser>(::bliss::partition::range<size_t>(data.size() / 3, data.size() / 2));
+
+    // same positions as ShortSequenceKmerId, in the same order.
+    using ShortParser = bliss::index::kmer::KmerPositionTupleParser<std::pair<KmerType, bliss::common::ShortSequenceKmerId> >;
+    std::vector<typename PackedParser::value_type> packed;
+    std::vector<typename ShortParser::value_type> gold;
+    store.template generate<PackedParser>(packed);
+    store.template generate<ShortParser>(gold);
+    ASSERT_EQ(gold.size(), packed.size());
+    for (size_t i = 0; i < gold.size(); ++i) {
+      ASSERT_EQ(gold[i].second.get_id(), packed[i].second.get_id()) << "tuple " << i;
+      ASSERT_EQ(gold[i].second.get_pos(), packed[i].second.get_pos()) << "tuple " << i;
+      if (i > 0) ASSERT_EQ(gold[i - 1].second < gold[i].second, packed[i - 1].second < packed[i].second);
+    }
+
+    // too wide for 32 bits.
+    EXPECT_THROW(PackedId::set_layout(255, 1UL << 30, 1000), std::invalid_argument);
+  }
+
+  TEST_F(PackedReadStoreTest, kmer_size) {
+    bliss::io::PackedReadStore<bliss::common::DNA> store;
+    pack(store, ::bliss::partition::range<size_t>(0, data.size()));
+    EXPECT_EQ(static_cast<size_t>(KmerType::size), store.kmer_size());
+    EXPECT_GT(store.size(), 0UL);
+    // packed is about a quarter of the sequence characters.
+    EXPECT_LT(store.get_arena().bytes(), data.size() / 3);
+
+    using OtherKmer = bliss::common::Kmer<31, bliss::common::DNA, uint64_t>;
+    using OtherParser = bliss::index::kmer::KmerParser<OtherKmer>;
+    std::vector<OtherKmer> other;
+    EXPECT_THROW(store.template generate<OtherParser>(other), std::invalid_argument);
+  }
+
+}
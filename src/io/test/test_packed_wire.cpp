@@ -0,0 +1,117 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "io/packed_wire.hpp"
+
+#include <random>
+#include <cstdint>  // uint32_t
+#include <utility>  // pair
+#include <vector>
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+
+
+template <typename T>
+class PackedWireTest : public ::testing::Test {
+  protected:
+    std::vector<T> input;
+
+    template <typename V, typename RNG>
+    static void make_value(V & v, RNG & gen) {
+      v = static_cast<V>(gen() >> (gen() % 64));   // mix of small and large values.
+    }
+    template <unsigned int K, typename A, typename W, typename RNG>
+    static void make_value(::bliss::common::Kmer<K, A, W> & v, RNG & gen) {
+      for (unsigned int i = 0; i < K; ++i) {
+        v.nextFromChar(gen() % A::SIZE);
+      }
+    }
+    template <typename K, typename V, typename RNG>
+    static void make_value(::std::pair<K, V> & v, RNG & gen) {
+      make_value(v.first, gen);
+      make_value(v.second, gen);
+    }
+
+    virtual void SetUp() {
+      std::mt19937_64 gen(23);
+      input.resize(1001);
+      for (size_t i = 0; i < input.size(); ++i) {
+        make_value(input[i], gen);
+      }
+    }
+
+    void check_roundtrip(size_t count) {
+      std::vector<uint8_t> buffer(::bliss::io::wire::max_bytes<T>(count));
+      size_t bytes = ::bliss::io::wire::encode(input.data(), input.data() + count, buffer.data());
+      ASSERT_LE(bytes, buffer.size());
+
+      std::vector<T> output(count);
+      ::bliss::io::wire::decode(buffer.data(), buffer.data() + bytes, count, output.data());
+
+      for (size_t i = 0; i < count; ++i) {
+        ASSERT_EQ(input[i], output[i]) << " at " << i << " of " << count;
+      }
+    }
+};
+
+TYPED_TEST_CASE_P(PackedWireTest);
+
+TYPED_TEST_P(PackedWireTest, roundtrip)
+{
+  for (size_t count : {0, 1, 2, 7, 8, 9, 63, 64, 65, 1001}) {
+    this->check_roundtrip(count);
+  }
+}
+
+REGISTER_TYPED_TEST_CASE_P(PackedWireTest, roundtrip);
+
+typedef ::testing::Types<
+    uint16_t, uint32_t, uint64_t, int32_t, int64_t, uint8_t, double,
+    ::bliss::common::Kmer< 21, bliss::common::DNA,   uint64_t>,   // 1 word, not full
+    ::bliss::common::Kmer< 32, bliss::common::DNA,   uint64_t>,   // 1 word, full
+    ::bliss::common::Kmer< 31, bliss::common::DNA,   uint16_t>,   // 4 words, not full
+    ::bliss::common::Kmer< 80, bliss::common::DNA,   uint64_t>,   // 3 words, not full
+    ::bliss::common::Kmer< 21, bliss::common::DNA5,  uint64_t>,   // 3 bit chars
+    ::std::pair<::bliss::common::Kmer< 21, bliss::common::DNA, uint64_t>, uint32_t>,
+    ::std::pair<::bliss::common::Kmer< 31, bliss::common::DNA16, uint64_t>, uint64_t>,
+    ::std::pair<::bliss::common::Kmer< 63, bliss::common::DNA5, uint64_t>, uint8_t>
+> PackedWireTestTypes;
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, PackedWireTest, PackedWireTestTypes);
+
+
+TEST(PackedWire, Size)
+{
+  using KmerType = ::bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+  using PairType = ::std::pair<KmerType, uint32_t>;
+
+  std::vector<PairType> input(1000);
+  KmerType km;
+  for (size_t i = 0; i < input.size(); ++i) {
+    km.nextFromChar(i % 4);
+    input[i] = PairType(km, i % 100);   // small counts, 1 byte varint.
+  }
+
+  std::vector<uint8_t> buffer(::bliss::io::wire::max_bytes<PairType>(input.size()));
+  size_t bytes = ::bliss::io::wire::encode(input.data(), input.data() + input.size(), buffer.data());
+
+  // 42 bits + 8 bits per element, versus 16 bytes for the padded pair.
+  EXPECT_EQ((input.size() * 50 + 7) / 8, bytes);
+  EXPECT_LT(bytes, input.size() * sizeof(PairType) / 2);
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "bliss-config.hpp"    // for location of data.
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint> // for uint64_t, etc.
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "io/file.hpp"
+#include "io/prefetch_reader.hpp"
+
+
+template <typename file_reader>
+class PrefetchReaderTest : public ::testing::Test
+{
+  protected:
+    std::string fileName;
+    ::bliss::io::file_data gold;
+
+    virtual void SetUp()
+    {
+      fileName.assign(PROJ_SRC_DIR);
+      fileName.append("/test/data/test.medium.fastq");
+
+      file_reader fobj(fileName);
+      gold = fobj.read_file();
+      ASSERT_EQ(18761UL, gold.data.size());
+    }
+
+    /// read range in blocks, check each block's content and their coverage of range.
+    void check(file_reader & fobj, ::bliss::io::file_data::range_type const & _range,
+               size_t block_size, size_t overlap, size_t ring_size) {
+      ::bliss::io::prefetching_reader<file_reader> blocks(fobj, _range, block_size, overlap, ring_size);
+
+      ::bliss::io::file_data::range_type range =
+          ::bliss::io::file_data::range_type::intersect(_range, ::bliss::io::file_data::range_type(0, fobj.size()));
+
+      EXPECT_EQ((range.size() + block_size - 1) / block_size, blocks.size());
+
+      size_t pos = range.start;
+      size_t count = 0;
+      while (blocks.has_next()) {
+        ::bliss::io::file_data & block = blocks.next();
+
+        ASSERT_EQ(pos, block.valid_range_bytes.start);
+        ASSERT_EQ(std::min(pos + block_size, range.end), block.valid_range_bytes.end);
+        ASSERT_EQ(pos, block.in_mem_range_bytes.start);
+        ASSERT_EQ(std::min(block.valid_range_bytes.end + overlap, fobj.size()), block.in_mem_range_bytes.end);
+        ASSERT_EQ(block.in_mem_range_bytes.size(), block.data.size());
+        ASSERT_EQ(fobj.size(), block.parent_range_bytes.end);
+
+        EXPECT_TRUE(std::equal(block.in_mem_cbegin(), block.in_mem_cend(), gold.data.cbegin() + pos));
+
+        pos = block.valid_range_bytes.end;
+        ++count;
+      }
+      if (range.size() > 0) EXPECT_EQ(range.end, pos);
+      EXPECT_EQ(blocks.size(), count);
+    }
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(PrefetchReaderTest);
+
+
+TYPED_TEST_P(PrefetchReaderTest, read)
+{
+  TypeParam fobj(this->fileName);
+  ::bliss::io::file_data::range_type all(0, fobj.size());
+
+  for (size_t ring_size : {1, 2, 3}) {
+    for (size_t block_size : {1000, 4096, 18761, 100000}) {
+      this->check(fobj, all, block_size, 0, ring_size);
+      this->check(fobj, all, block_size, 100, ring_size);
+    }
+  }
+}
+
+TYPED_TEST_P(PrefetchReaderTest, read_subrange)
+{
+  TypeParam fobj(this->fileName);
+
+  this->check(fobj, ::bliss::io::file_data::range_type(5000, 12345), 1000, 200, 2);
+  this->check(fobj, ::bliss::io::file_data::range_type(18000, 30000), 512, 64, 2);   // clipped to file
+  this->check(fobj, ::bliss::io::file_data::range_type(20000, 30000), 512, 64, 2);   // outside of file
+
+  EXPECT_THROW(::bliss::io::prefetching_reader<TypeParam>(fobj, ::bliss::io::file_data::range_type(0, 100), 0), std::invalid_argument);
+}
+
+TYPED_TEST_P(PrefetchReaderTest, extend)
+{
+  TypeParam fobj(this->fileName);
+  ::bliss::io::prefetching_reader<TypeParam> blocks(fobj, ::bliss::io::file_data::range_type(0, fobj.size()), 8000, 10, 2);
+
+  ::bliss::io::file_data & first = blocks.next();
+  blocks.extend(first, 500);
+  EXPECT_EQ(8510UL, first.in_mem_range_bytes.end);
+  ASSERT_EQ(8510UL, first.data.size());
+  EXPECT_TRUE(std::equal(first.in_mem_cbegin(), first.in_mem_cend(), this->gold.data.cbegin()));
+
+  blocks.next();
+  ::bliss::io::file_data & last = blocks.next();
+  EXPECT_FALSE(blocks.has_next());
+  blocks.extend(last, 500);   // at end of file already.
+  EXPECT_EQ(fobj.size(), last.in_mem_range_bytes.end);
+  EXPECT_EQ(fobj.size() - 16000, last.data.size());
+
+  EXPECT_THROW(blocks.next(), std::out_of_range);
+}
+
+
+// now register the test cases
+REGISTER_TYPED_TEST_CASE_P(PrefetchReaderTest, read, read_subrange, extend);
+
+
+typedef ::testing::Types<
+    bliss::io::mmap_file,
+    bliss::io::posix_file
+> PrefetchReaderTestTypes;
+
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, PrefetchReaderTest, PrefetchReaderTestTypes);
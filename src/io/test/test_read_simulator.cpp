@@ -0,0 +1,134 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * test_read_simulator.cpp
+ * Test that the synthetic reads are deterministic, independent of the number of ranks, and follow the knobs.
+ */
+
+#include "bliss-config.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "io/kmer_parser.hpp"
+#include "io/read_simulator.hpp"
+
+namespace {
+
+  using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+  using Simulator = bliss::io::ReadSimulator;
+
+  /// reads in order, from the stores of p ranks.
+  std::vector<KmerType> kmers(Simulator const & sim, int p) {
+    std::vector<KmerType> out;
+    for (int r = 0; r < p; ++r) {
+      bliss::io::PackedReadStore<bliss::common::DNA> store;
+      sim.fill(store, KmerType::size, r, p);
+      store.template generate<bliss::index::kmer::KmerParser<KmerType> >(out);
+    }
+    return out;
+  }
+
+  size_t distinct(std::vector<KmerType> v) {
+    std::sort(v.begin(), v.end());
+    return std::unique(v.begin(), v.end()) - v.begin();
+  }
+
+  Simulator::params small() {
+    Simulator::params p;
+    p.genome_length = 20000;
+    p.read_length = 100;
+    p.coverage = 5.0;
+    return p;
+  }
+
+} // namespace
+
+
+TEST(ReadSimulatorTest, partition)
+{
+  Simulator sim(small());
+  EXPECT_EQ(1000UL, sim.num_reads());
+  EXPECT_EQ(0UL, sim.first_read(0, 7));
+  EXPECT_EQ(sim.num_reads(), sim.first_read(7, 7));
+
+  // same reads for any number of ranks.
+  std::vector<KmerType> gold = kmers(sim, 1);
+  EXPECT_EQ(sim.num_reads() * (100 - KmerType::size + 1), gold.size());
+  EXPECT_TRUE(gold == kmers(sim, 3));
+  EXPECT_TRUE(gold == kmers(sim, 16));
+}
+
+TEST(ReadSimulatorTest, genome)
+{
+  Simulator sim(small());
+
+  // without errors, each read is a substring of the genome or its reverse complement.
+  std::string genome, rc;
+  for (uint64_t x = 0; x < 20000; ++x) genome.push_back("ACGT"[sim.base(x)]);
+  for (auto it = genome.rbegin(); it != genome.rend(); ++it) rc.push_back("TGCA"[std::string("ACGT").find(*it)]);
+
+  std::string read;
+  size_t fwd = 0;
+  for (size_t i = 0; i < 200; ++i) {
+    sim.read(i, read);
+    ASSERT_EQ(100UL, read.size());
+    bool f = genome.find(read) != std::string::npos;
+    EXPECT_TRUE(f || (rc.find(read) != std::string::npos)) << " read " << i;
+    fwd += f;
+  }
+  EXPECT_GT(fwd, 50UL);
+  EXPECT_LT(fwd, 150UL);
+
+  // a different seed gives a different genome.
+  Simulator::params p = small();
+  p.seed = 43;
+  Simulator other(p);
+  size_t same = 0;
+  for (uint64_t x = 0; x < 1000; ++x) same += (sim.base(x) == other.base(x));
+  EXPECT_LT(same, 400UL);
+}
+
+TEST(ReadSimulatorTest, knobs)
+{
+  size_t base = distinct(kmers(Simulator(small()), 1));
+
+  // errors add k-mers.
+  Simulator::params p = small();
+  p.error_rate = 0.01;
+  EXPECT_GT(distinct(kmers(Simulator(p), 1)), base + base / 4);
+
+  // repeats remove them.
+  p = small();
+  p.repeat_fraction = 0.5;
+  p.repeat_length = 200;
+  p.repeat_units = 2;
+  EXPECT_LT(distinct(kmers(Simulator(p), 1)), base * 3 / 4);
+
+  // skew concentrates the reads at the start of the genome.
+  p = small();
+  p.skew = 0.5;
+  p.hot_fraction = 0.05;
+  EXPECT_LT(distinct(kmers(Simulator(p), 1)), base * 3 / 4);
+
+  p = small();
+  p.genome_length = 50;
+  EXPECT_THROW(Simulator s(p), std::invalid_argument);
+}
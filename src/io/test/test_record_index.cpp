@@ -0,0 +1,104 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * test_record_index.cpp
+ * Test the record_index sidecar and the .fai reader.
+ */
+
+#include "bliss-config.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "io/record_index.hpp"
+
+namespace {
+
+  std::string temp_name(std::string const & suffix) {
+    return std::string("/tmp/bliss_test_record_index_") + suffix;
+  }
+
+}
+
+TEST(RecordIndex, write_read)
+{
+  std::string fn = temp_name("fastq");
+  std::remove(bliss::io::record_index::sidecar_name(fn).c_str());
+
+  bliss::io::record_index idx;
+  EXPECT_FALSE(idx.open(fn, 1000));
+
+  std::vector<size_t> offsets;
+  for (size_t i = 0; i < 100; ++i) offsets.push_back(i * 10);
+
+  // written in 2 parts, as by 2 ranks.
+  ASSERT_TRUE(bliss::io::record_index::create(fn, 1000, offsets.size()));
+  ASSERT_TRUE(bliss::io::record_index::write_entries(fn, 0, std::vector<size_t>(offsets.begin(), offsets.begin() + 37)));
+  ASSERT_TRUE(bliss::io::record_index::write_entries(fn, 37, std::vector<size_t>(offsets.begin() + 37, offsets.end())));
+  // not visible until published.
+  EXPECT_FALSE(idx.open(fn, 1000));
+  ASSERT_TRUE(bliss::io::record_index::publish(fn, true));
+
+  ASSERT_TRUE(idx.open(fn, 1000));
+  ASSERT_EQ(offsets.size(), idx.size());
+  for (size_t i = 0; i < offsets.size(); ++i) {
+    EXPECT_EQ(offsets[i], idx.offset(i));
+  }
+  EXPECT_EQ(1000UL, idx.offset(idx.size()));
+
+  // stale:  written for a different file size.
+  EXPECT_FALSE(idx.open(fn, 1001));
+
+  std::remove(bliss::io::record_index::sidecar_name(fn).c_str());
+}
+
+TEST(RecordIndex, fai)
+{
+  std::string fn = temp_name("fasta");
+
+  // 3 records, 4 bases per line.  the second ends on a full line.
+  std::string data(">a\nACGT\nAC\n>b desc\nACGT\nACGT\n>c\nA\n");
+  std::vector<std::tuple<size_t, size_t, size_t> > gold = {
+      std::make_tuple(0UL, 3UL, 11UL),
+      std::make_tuple(11UL, 19UL, 29UL),
+      std::make_tuple(29UL, 32UL, data.size())
+  };
+
+  {
+    std::ofstream fai(bliss::io::fai_index::sidecar_name(fn));
+    fai << "a\t6\t3\t4\t5\n";
+    fai << "b\t8\t19\t4\t5\n";
+    fai << "c\t1\t32\t4\t5\n";
+  }
+
+  bliss::io::fai_index idx;
+  ASSERT_TRUE(idx.open(fn));
+  EXPECT_EQ(gold, idx.records(data.size()));
+
+  {
+    std::ofstream fai(bliss::io::fai_index::sidecar_name(fn));
+    fai << "a\t6\tx\t4\t5\n";
+  }
+  EXPECT_FALSE(idx.open(fn));
+
+  std::remove(bliss::io::fai_index::sidecar_name(fn).c_str());
+}
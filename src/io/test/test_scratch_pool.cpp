@@ -0,0 +1,86 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint> // for uint64_t, etc.
+#include <vector>
+
+#include "io/scratch_pool.hpp"
+
+
+TEST(ScratchPool, reuse)
+{
+  ::imxx::scratch::pool p;
+
+  size_t const * data = nullptr;
+  {
+    ::imxx::scratch::buffer<size_t> i2o(p);
+    EXPECT_TRUE(i2o->empty());
+    i2o.reserve(1000);
+    i2o->resize(1000, 1);
+    data = i2o->data();
+  }
+  EXPECT_EQ(1UL, p.size());
+  EXPECT_EQ(1000UL * sizeof(size_t), p.idle_bytes());
+
+  {
+    // same storage, returned empty.
+    ::imxx::scratch::buffer<size_t> i2o(p);
+    EXPECT_TRUE(i2o->empty());
+    EXPECT_EQ(data, i2o->data());
+    EXPECT_EQ(0UL, p.idle_bytes());
+
+    // a second lease of the same type, and one of another type, get their own vectors.
+    ::imxx::scratch::buffer<size_t> counts(p);
+    ::imxx::scratch::buffer<uint8_t> bytes(p);
+    EXPECT_NE(&(*i2o), &(*counts));
+    EXPECT_EQ(3UL, p.size());
+
+    // swapped storage goes back to the pool.
+    std::vector<size_t> other(10);
+    i2o->swap(other);
+  }
+  EXPECT_EQ(3UL, p.size());
+  EXPECT_EQ(10UL * sizeof(size_t), p.idle_bytes());
+
+  p.trim();
+  EXPECT_EQ(0UL, p.size());
+}
+
+TEST(ScratchPool, limit)
+{
+  ::imxx::scratch::pool p;
+  p.set_limit(4096);
+  {
+    ::imxx::scratch::buffer<uint64_t> small(p);
+    small->resize(100);
+    ::imxx::scratch::buffer<uint64_t> large(p);
+    // large enough for the huge page advice.
+    large.reserve(1 << 20);
+    large->resize(1 << 20);
+  }
+  // the large buffer is freed on return.
+  EXPECT_EQ(2UL, p.size());
+  EXPECT_EQ(100UL * sizeof(uint64_t), p.idle_bytes());
+
+  // grows without keeping the contents.
+  ::imxx::scratch::buffer<uint64_t> b(p);
+  b->push_back(1);
+  b.reserve(1000);
+  EXPECT_TRUE(b->empty());
+  EXPECT_LE(1000UL, b->capacity());
+}
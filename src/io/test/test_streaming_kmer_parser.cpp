@@ -0,0 +1,144 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * test_streaming_kmer_parser.cpp
+ * Test the streaming long read k-mer parsers against k-mers generated from whole sequences,
+ * for different block sizes and partitionings.
+ */
+
+#include "bliss-config.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "io/streaming_kmer_parser.hpp"
+
+namespace {
+
+  using KmerType = bliss::common::Kmer<21, bliss::common::DNA, uint64_t>;
+
+  /// in memory stand-in for posix_file.
+  struct string_reader {
+      std::string const & data;
+      size_t size() const { return data.size(); }
+      bliss::partition::range<size_t> read_range(std::vector<unsigned char> & out, bliss::partition::range<size_t> const & r) {
+        out.assign(data.begin() + r.start, data.begin() + r.end);
+        return r;
+      }
+  };
+
+  std::string random_bases(size_t const & len, std::default_random_engine & gen) {
+    std::uniform_int_distribution<int> base(0, 3);
+    std::string s;
+    for (size_t i = 0; i < len; ++i) s.push_back("ACGT"[base(gen)]);
+    return s;
+  }
+
+  void append_kmers(std::string const & seq, std::vector<KmerType> & out) {
+    KmerType km(true);
+    for (size_t i = 0; i < seq.size(); ++i) {
+      km.nextFromChar(KmerType::KmerAlphabet::FROM_ASCII[static_cast<unsigned char>(seq[i])]);
+      if ((i + 1) >= KmerType::size) out.emplace_back(km);
+    }
+  }
+
+  /// parse data as p partitions with blocks of block_size bytes.
+  template <typename Parser>
+  std::vector<KmerType> parse(std::string const & data, size_t const & p, size_t const & block_size, size_t & records) {
+    string_reader reader{data};
+    std::vector<KmerType> result;
+    std::vector<unsigned char> buf;
+    records = 0;
+
+    for (size_t r = 0; r < p; ++r) {
+      size_t local_start = (data.size() * r) / p;
+      size_t local_end = (data.size() * (r + 1)) / p;
+
+      size_t start = Parser::find_start(reader, local_start, block_size);
+      Parser parser(start);
+      std::back_insert_iterator<std::vector<KmerType> > out(result);
+      for (size_t b = start; b < data.size(); b += block_size) {
+        bliss::partition::range<size_t> got = reader.read_range(buf, bliss::partition::range<size_t>(b, std::min(b + block_size, data.size())));
+        if (!parser.parse(buf.data(), got.size(), local_end, out)) break;
+      }
+      records += parser.size();
+    }
+    return result;
+  }
+
+}
+
+TEST(StreamingKmerParser, fastq)
+{
+  std::default_random_engine gen(5);
+  std::uniform_int_distribution<int> len(0, 3000);
+  std::uniform_int_distribution<int> score(0, 40);
+
+  std::string data;
+  std::vector<KmerType> gold;
+  size_t nrecords = 60;
+  for (size_t i = 0; i < nrecords; ++i) {
+    std::string seq = random_bases((i == 7) ? 40000 : len(gen), gen);
+    // quality lines that start with '@' and '+'.
+    std::string qual;
+    for (size_t j = 0; j < seq.size(); ++j) qual.push_back((j == 0) ? "@+"[i & 1] : static_cast<char>('!' + score(gen)));
+    data += "@read" + std::to_string(i) + "\n" + seq + "\n+\n" + qual + "\n";
+    append_kmers(seq, gold);
+  }
+
+  for (size_t p : {1UL, 3UL, 16UL}) {
+    for (size_t block : {7UL, 256UL, 65536UL}) {
+      size_t records = 0;
+      std::vector<KmerType> result = parse<bliss::io::StreamingFASTQKmerParser<KmerType> >(data, p, block, records);
+      EXPECT_EQ(nrecords, records) << "p " << p << " block " << block;
+      ASSERT_EQ(gold.size(), result.size()) << "p " << p << " block " << block;
+      EXPECT_TRUE(gold == result) << "p " << p << " block " << block;
+    }
+  }
+}
+
+TEST(StreamingKmerParser, fasta)
+{
+  std::default_random_engine gen(9);
+  std::uniform_int_distribution<int> len(0, 5000);
+
+  std::string data;
+  std::vector<KmerType> gold;
+  size_t nrecords = 20;
+  for (size_t i = 0; i < nrecords; ++i) {
+    std::string seq = random_bases((i == 3) ? 50000 : len(gen), gen);
+    data += ">seq" + std::to_string(i) + " description\n";
+    for (size_t j = 0; j < seq.size(); j += 60) data += seq.substr(j, 60) + "\n";
+    append_kmers(seq, gold);
+  }
+
+  for (size_t p : {1UL, 4UL, 32UL}) {
+    for (size_t block : {5UL, 100UL, 65536UL}) {
+      size_t records = 0;
+      std::vector<KmerType> result = parse<bliss::io::StreamingFASTAKmerParser<KmerType> >(data, p, block, records);
+      EXPECT_EQ(nrecords, records) << "p " << p << " block " << block;
+      ASSERT_EQ(gold.size(), result.size()) << "p " << p << " block " << block;
+      EXPECT_TRUE(gold == result) << "p " << p << " block " << block;
+    }
+  }
+}
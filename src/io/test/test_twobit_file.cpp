@@ -0,0 +1,242 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * test_twobit_file.cpp
+ * Test the UCSC .2bit reader against k-mers generated from the same sequences in ASCII.
+ */
+
+#include "bliss-config.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "io/twobit_file.hpp"
+#include "io/kmer_parser.hpp"
+
+namespace {
+
+  std::string temp_name(std::string const & suffix) {
+    return std::string("/tmp/bliss_test_twobit_") + suffix + ".2bit";
+  }
+
+  void put32(std::string & out, uint32_t v, bool swap) {
+    if (swap) v = __builtin_bswap32(v);
+    out.append(reinterpret_cast<char const *>(&v), sizeof(uint32_t));
+  }
+
+  /// runs of characters satisfying pred, as (start, length)
+  template <typename Pred>
+  std::vector<std::pair<uint32_t, uint32_t> > runs(std::string const & s, Pred pred) {
+    std::vector<std::pair<uint32_t, uint32_t> > r;
+    for (size_t i = 0; i < s.size(); ) {
+      if (!pred(s[i])) { ++i; continue; }
+      size_t j = i;
+      while ((j < s.size()) && pred(s[j])) ++j;
+      r.emplace_back(i, j - i);
+      i = j;
+    }
+    return r;
+  }
+
+  /// write seqs as a .2bit file.
+  void write_2bit(std::string const & fn, std::vector<std::string> const & seqs, uint32_t version, bool swap) {
+    std::string header, index, records;
+    put32(header, bliss::io::twobit_file::SIGNATURE, swap);
+    put32(header, version, swap);
+    put32(header, seqs.size(), swap);
+    put32(header, 0, swap);
+
+    size_t index_size = 0;
+    for (size_t i = 0; i < seqs.size(); ++i) index_size += 1 + std::to_string(i).size() + ((version == 0) ? 4 : 8);
+
+    for (size_t i = 0; i < seqs.size(); ++i) {
+      std::string name = std::to_string(i);
+      index.push_back(static_cast<char>(name.size()));
+      index.append(name);
+      uint64_t off = header.size() + index_size + records.size();
+      put32(index, static_cast<uint32_t>(off), swap);
+      if (version == 1) put32(index, static_cast<uint32_t>(off >> 32), swap);   // only correct for the native byte order
+
+      std::string const & s = seqs[i];
+      auto n = runs(s, [](char c) { return (c == 'N') || (c == 'n'); });
+      auto m = runs(s, [](char c) { return islower(c); });
+      put32(records, s.size(), swap);
+      put32(records, n.size(), swap);
+      for (auto const & x : n) put32(records, x.first, swap);
+      for (auto const & x : n) put32(records, x.second, swap);
+      put32(records, m.size(), swap);
+      for (auto const & x : m) put32(records, x.first, swap);
+      for (auto const & x : m) put32(records, x.second, swap);
+      put32(records, 0, swap);
+
+      for (size_t j = 0; j < s.size(); j += 4) {
+        uint8_t b = 0;
+        for (size_t l = 0; l < 4; ++l) {
+          uint8_t code = 0;  // T, also for N and past the end.
+          if (j + l < s.size()) {
+            switch (toupper(s[j + l])) {
+              case 'C': code = 1; break;
+              case 'A': code = 2; break;
+              case 'G': code = 3; break;
+              default: break;
+            }
+          }
+          b |= code << (6 - 2 * l);
+        }
+        records.push_back(static_cast<char>(b));
+      }
+    }
+
+    std::ofstream ofs(fn, std::ios::binary);
+    ofs << header << index << records;
+  }
+
+}
+
+template <typename Kmer>
+class TwoBitFileTest : public ::testing::Test
+{
+  protected:
+    using Alphabet = typename Kmer::KmerAlphabet;
+
+    std::vector<std::string> seqs;
+
+    virtual void SetUp()
+    {
+      std::mt19937 gen(29);
+      std::uniform_int_distribution<int> len_dist(0, 600);
+      std::uniform_int_distribution<int> char_dist(0, 99);
+
+      for (int i = 0; i < 20; ++i) {
+        std::string s;
+        int len = (i < 3) ? (i * 7) : len_dist(gen);
+        bool lower = false;
+        for (int j = 0; j < len; ++j) {
+          int c = char_dist(gen);
+          if (c < 2) lower = !lower;
+          if (c < 4) {
+            // N runs
+            for (int l = 0; l < c * 13 + 1; ++l) s.push_back(lower ? 'n' : 'N');
+          }
+          char b = "ACGT"[c % 4];
+          s.push_back(lower ? static_cast<char>(tolower(b)) : b);
+        }
+        seqs.push_back(s);
+      }
+    }
+
+    /// k-mers of s with their base coordinate, from the ASCII.
+    static void gold(std::string const & s, size_t first, std::vector<Kmer> & kmers, std::vector<size_t> & pos) {
+      if (s.size() < Kmer::size) return;
+      using ValIter = ::bliss::iterator::transform_iterator<std::string::const_iterator, ::bliss::common::ASCII2<Alphabet, char> >;
+      using KmerIter = ::bliss::common::KmerGenerationIterator<ValIter, Kmer>;
+      KmerIter it(ValIter(s.begin(), ::bliss::common::ASCII2<Alphabet, char>()), true);
+      KmerIter end(ValIter(s.end(), ::bliss::common::ASCII2<Alphabet, char>()), false);
+      for (size_t j = first; it != end; ++it, ++j) {
+        kmers.push_back(*it);
+        pos.push_back(j);
+      }
+    }
+
+    void check(uint32_t version, bool swap) {
+      std::string fn = temp_name(std::to_string(version) + (swap ? "s" : "n"));
+      write_2bit(fn, seqs, version, swap);
+
+      bliss::io::twobit_file f(fn);
+      ASSERT_EQ(seqs.size(), f.sequences());
+
+      std::vector<Kmer> gold_kmers;
+      std::vector<size_t> gold_pos;
+      size_t total = 0;
+      for (size_t i = 0; i < seqs.size(); ++i) {
+        EXPECT_EQ(std::to_string(i), f.sequence(i).name);
+        EXPECT_EQ(seqs[i].size(), f.sequence(i).length);
+        gold(seqs[i], total, gold_kmers, gold_pos);
+        total += seqs[i].size();
+      }
+      ASSERT_EQ(total, f.size());
+      ASSERT_GT(gold_kmers.size(), 0UL);
+
+      using PosParser = bliss::index::kmer::KmerPositionTupleParser<std::pair<Kmer, bliss::common::LongSequenceKmerId> >;
+
+      // as if read by p ranks.
+      for (size_t p : {1UL, 3UL, 16UL}) {
+        std::vector<Kmer> kmers;
+        std::vector<typename PosParser::value_type> pos;
+        for (size_t r = 0; r < p; ++r) {
+          bliss::io::PackedReadStore<Alphabet> store;
+          f.read(::bliss::partition::range<size_t>(total * r / p, total * (r + 1) / p), Kmer::size, store);
+          store.template generate<bliss::index::kmer::KmerParser<Kmer> >(kmers);
+          store.template generate<PosParser>(pos);
+        }
+        ASSERT_EQ(gold_kmers.size(), kmers.size()) << "ranks " << p;
+        ASSERT_EQ(gold_kmers.size(), pos.size()) << "ranks " << p;
+        for (size_t i = 0; i < gold_kmers.size(); ++i) {
+          ASSERT_EQ(gold_kmers[i], kmers[i]) << "ranks " << p << " kmer " << i;
+          ASSERT_EQ(gold_kmers[i], pos[i].first) << "ranks " << p << " kmer " << i;
+          ASSERT_EQ(gold_pos[i], pos[i].second.get_pos()) << "ranks " << p << " kmer " << i;
+        }
+      }
+
+      std::remove(fn.c_str());
+    }
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(TwoBitFileTest);
+
+TYPED_TEST_P(TwoBitFileTest, read)
+{
+  this->check(0, false);
+  this->check(1, false);
+}
+
+TYPED_TEST_P(TwoBitFileTest, read_swapped)
+{
+  this->check(0, true);
+}
+
+TYPED_TEST_P(TwoBitFileTest, not_2bit)
+{
+  std::string fn = temp_name("bad");
+  {
+    std::ofstream ofs(fn);
+    ofs << ">a\nACGT\n";
+  }
+  EXPECT_THROW(bliss::io::twobit_file f(fn), bliss::io::IOException);
+  std::remove(fn.c_str());
+}
+
+
+// now register the test cases
+REGISTER_TYPED_TEST_CASE_P(TwoBitFileTest, read, read_swapped, not_2bit);
+
+
+typedef ::testing::Types<
+    ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>,
+    ::bliss::common::Kmer<31, ::bliss::common::DNA, uint16_t>,
+    ::bliss::common::Kmer<15, ::bliss::common::DNA5, uint64_t>,
+    ::bliss::common::Kmer<13, ::bliss::common::DNA16, uint64_t>
+> TwoBitFileTestTypes;
+
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, TwoBitFileTest, TwoBitFileTestTypes);
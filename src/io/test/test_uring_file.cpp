@@ -0,0 +1,105 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "bliss-config.hpp"    // for location of data.
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint> // for uint64_t, etc.
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "io/file.hpp"
+
+
+class UringFileTest : public ::testing::TestWithParam<std::string>
+{
+  protected:
+    std::string fileName;
+    ::bliss::io::file_data gold;
+
+    virtual void SetUp()
+    {
+      fileName.assign(PROJ_SRC_DIR);
+      fileName.append(GetParam());
+
+      ::bliss::io::posix_file fobj(fileName);
+      gold = fobj.read_file();
+      ASSERT_TRUE(gold.data.size() > 0);
+    }
+
+    void check(::bliss::io::uring_file & fobj, ::bliss::io::file_data::range_type const & range) {
+      ::bliss::io::file_data::container output;
+      ::bliss::io::file_data::range_type r = fobj.read_range(output, range);
+
+      ASSERT_EQ(range.start, r.start);
+      ASSERT_EQ(std::min(range.end, fobj.size()), r.end);
+      ASSERT_EQ(r.size(), output.size());
+      EXPECT_TRUE(std::equal(output.begin(), output.end(), gold.data.begin() + r.start));
+    }
+};
+
+
+TEST_P(UringFileTest, read_file)
+{
+  ::bliss::io::uring_file fobj(this->fileName);
+  ::bliss::io::file_data fdata = fobj.read_file();
+
+  ASSERT_EQ(this->gold.data.size(), fdata.data.size());
+  EXPECT_EQ(this->gold.valid_range_bytes, fdata.valid_range_bytes);
+  EXPECT_TRUE(std::equal(fdata.data.begin(), fdata.data.end(), this->gold.data.begin()));
+}
+
+TEST_P(UringFileTest, read_range)
+{
+  ::bliss::io::uring_file fobj(this->fileName);
+  size_t s = fobj.size();
+
+  // small chunks and shallow queue, so there are many reads, partial first and last chunks, and resubmits.
+  for (bool fixed : {false, true}) {
+    for (unsigned depth : {1, 3, 16}) {
+      fobj.set_chunk_size(4096);
+      fobj.set_queue_depth(depth);
+      fobj.set_registered_buffers(fixed);
+
+      this->check(fobj, ::bliss::io::file_data::range_type(0, s));
+      this->check(fobj, ::bliss::io::file_data::range_type(1, s / 2 + 7));
+      this->check(fobj, ::bliss::io::file_data::range_type(s / 3, s + 100));
+      if (s > 8192) this->check(fobj, ::bliss::io::file_data::range_type(4096, 8192));
+      this->check(fobj, ::bliss::io::file_data::range_type(s - 1, s));
+    }
+  }
+}
+
+TEST_P(UringFileTest, shared_fd)
+{
+  // composition constructor, as used by partitioned_file.
+  ::bliss::io::posix_file pfile(this->fileName);
+  ::bliss::io::uring_file fobj(open64(this->fileName.c_str(), O_RDONLY), pfile.size());
+
+  fobj.set_chunk_size(8192);
+  this->check(fobj, ::bliss::io::file_data::range_type(100, pfile.size()));
+}
+
+
+INSTANTIATE_TEST_CASE_P(Bliss, UringFileTest, ::testing::Values(
+    std::string("/test/data/test.medium.fastq"),
+    std::string("/test/data/test.debruijn.tiny.fastq"),
+    std::string("/test/data/test.unitiqs.fastq"),
+    std::string("/test/data/test.medium.fasta")
+));
@@ -0,0 +1,296 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    twobit_file.hpp
+ * @ingroup io
+ * @author  tpan
+ * @brief   reader for UCSC .2bit files, which packs the bases directly into a PackedReadStore.
+ * @details .2bit layout (all uint32 in the byte order given by the signature):
+ *
+ *      signature 0x1A412743, version (0, or 1 for 64 bit offsets), sequence count, reserved
+ *      per sequence:  name size (1 byte), name, offset of the sequence record
+ *      sequence record:  dna size, N block count, N block starts, N block sizes,
+ *                        mask block count, mask block starts, mask block sizes, reserved, packed dna
+ *
+ *          the dna is 4 bases per byte, first base in the most significant bits, T=0 C=1 A=2 G=3.  N blocks are
+ *          stored as T.  mask blocks (lower case) do not matter for k-mers and are skipped.
+ *
+ *          the sequences are treated as one concatenated base coordinate, which is partitioned across ranks, so a
+ *          rank reads only about 1/4 byte per base of its part.  for 2 bit alphabets (DNA) a byte is translated to the
+ *          PackedSequenceArena layout with a 256 entry table and words are assembled with shifts; the ASCII translation
+ *          of the FASTA path is skipped.  N block bases are set to ALPHABET::FROM_ASCII['N'], so the k-mers are the same
+ *          as those parsed from the FASTA version of the file.
+ *
+ *          read ids are SequenceId(base coordinate of the sequence start, sequence index), so the position of a k-mer
+ *          is its base coordinate.  use LongSequenceKmerId for positions, since sequences are long.
+ */
+#ifndef SRC_IO_TWOBIT_FILE_HPP_
+#define SRC_IO_TWOBIT_FILE_HPP_
+
+#include <fcntl.h>     // open
+#include <unistd.h>    // pread, close
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <array>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+#include "common/alphabet_traits.hpp"
+#include "io/io_exception.hpp"
+#include "io/packed_read_store.hpp"
+#include "partition/range.hpp"
+
+namespace bliss
+{
+  namespace io
+  {
+
+    /**
+     * @brief UCSC .2bit file.  the header and the sequence index are read on open; the bases are read on demand.
+     */
+    class twobit_file {
+      public:
+        static constexpr uint32_t SIGNATURE = 0x1A412743;
+
+        /// a sequence in the file
+        struct sequence_info {
+            std::string name;
+            /// number of bases
+            size_t length;
+            /// base coordinate of the first base, i.e. sum of the lengths of the earlier sequences
+            size_t first;
+            /// file offset of the packed dna
+            size_t dna_offset;
+            /// N blocks, (start, length), ordered.
+            std::vector<std::pair<size_t, size_t> > n_blocks;
+        };
+
+      protected:
+        int fd;
+        bool swapped;
+        std::vector<sequence_info> seqs;
+        size_t total;
+
+        void read_bytes(void * buf, size_t const & bytes, size_t const & pos) const {
+          size_t done = 0;
+          while (done < bytes) {
+            ssize_t r = pread(fd, reinterpret_cast<unsigned char *>(buf) + done, bytes - done, pos + done);
+            if (r <= 0) throw IOException("twobit_file: unexpected end of file");
+            done += r;
+          }
+        }
+
+        uint32_t read_u32(size_t const & pos) const {
+          uint32_t v;
+          read_bytes(&v, sizeof(uint32_t), pos);
+          return swapped ? __builtin_bswap32(v) : v;
+        }
+
+        uint64_t read_u64(size_t const & pos) const {
+          uint64_t v;
+          read_bytes(&v, sizeof(uint64_t), pos);
+          return swapped ? __builtin_bswap64(v) : v;
+        }
+
+        /// uint32 array of count entries.
+        std::vector<uint32_t> read_u32s(size_t const & count, size_t const & pos) const {
+          std::vector<uint32_t> v(count);
+          if (count == 0) return v;
+          read_bytes(v.data(), count * sizeof(uint32_t), pos);
+          if (swapped) for (auto & x : v) x = __builtin_bswap32(x);
+          return v;
+        }
+
+        /// byte translation table, .2bit byte to 4 characters packed least significant first as PackedSequenceArena does.
+        template <typename ALPHABET>
+        static std::array<uint8_t, 256> make_byte_table() {
+          std::array<uint8_t, 256> t;
+          for (size_t x = 0; x < 256; ++x) {
+            uint8_t v = 0;
+            for (size_t i = 0; i < 4; ++i) {
+              v |= ALPHABET::FROM_ASCII["TCAG"[(x >> (6 - 2 * i)) & 0x3]] << (2 * i);
+            }
+            t[x] = v;
+          }
+          return t;
+        }
+
+        /// bases [a, b) of sequence i as PackedSequenceArena bytes, starting from base a & ~3.  for 2 bit alphabets.
+        template <typename ALPHABET>
+        void decode(size_t const & i, size_t const & a, size_t const & b, std::vector<uint8_t> & buf) const {
+          static const std::array<uint8_t, 256> table = make_byte_table<ALPHABET>();
+
+          size_t a0 = a & ~static_cast<size_t>(0x3);
+          buf.resize((b - a0 + 3) / 4);
+          read_bytes(buf.data(), buf.size(), seqs[i].dna_offset + a0 / 4);
+          for (auto & x : buf) x = table[x];
+
+          // N blocks
+          uint8_t n = ALPHABET::FROM_ASCII['N'];
+          auto it = ::std::upper_bound(seqs[i].n_blocks.begin(), seqs[i].n_blocks.end(), a,
+              [](size_t const & p, std::pair<size_t, size_t> const & blk) { return p < blk.first + blk.second; });
+          for (; (it != seqs[i].n_blocks.end()) && (it->first < b); ++it) {
+            size_t e = ::std::min(b, it->first + it->second);
+            for (size_t p = ::std::max(a, it->first) - a0, pe = e - a0; p < pe; ++p) {
+              unsigned int sh = 2 * (p & 0x3);
+              buf[p / 4] = static_cast<uint8_t>((buf[p / 4] & ~(0x3 << sh)) | (n << sh));
+            }
+          }
+        }
+
+        /// bases [a, b) of sequence i as alphabet values.  for the other alphabets.
+        template <typename ALPHABET>
+        void decode_values(size_t const & i, size_t const & a, size_t const & b, std::vector<uint8_t> & vals) const {
+          size_t a0 = a & ~static_cast<size_t>(0x3);
+          std::vector<uint8_t> bytes((b - a0 + 3) / 4);
+          read_bytes(bytes.data(), bytes.size(), seqs[i].dna_offset + a0 / 4);
+
+          vals.resize(b - a);
+          for (size_t p = a; p < b; ++p) {
+            vals[p - a] = ALPHABET::FROM_ASCII["TCAG"[(bytes[(p - a0) / 4] >> (6 - 2 * ((p - a0) & 0x3))) & 0x3]];
+          }
+          uint8_t n = ALPHABET::FROM_ASCII['N'];
+          for (auto const & blk : seqs[i].n_blocks) {
+            for (size_t p = ::std::max(a, blk.first), e = ::std::min(b, blk.first + blk.second); p < e; ++p) vals[p - a] = n;
+          }
+        }
+
+        template <typename ALPHABET>
+        size_t append(PackedReadStore<ALPHABET> & store, size_t const & i, size_t const & a, size_t const & b, size_t const & k,
+                      std::vector<uint8_t> & buf, ::std::true_type const &) const {
+          decode<ALPHABET>(i, a, b, buf);
+          return store.append_packed(buf.data(), a & 0x3, b - a, seqs[i].first + a, ::bliss::common::SequenceId(seqs[i].first, i), k);
+        }
+        template <typename ALPHABET>
+        size_t append(PackedReadStore<ALPHABET> & store, size_t const & i, size_t const & a, size_t const & b, size_t const & k,
+                      std::vector<uint8_t> & buf, ::std::false_type const &) const {
+          decode_values<ALPHABET>(i, a, b, buf);
+          return store.append_values(buf.begin(), buf.end(), seqs[i].first + a, ::bliss::common::SequenceId(seqs[i].first, i), k);
+        }
+
+      public:
+        /// open filename and read the sequence index.  throws IOException if the file is not a .2bit file.
+        explicit twobit_file(std::string const & filename) : fd(-1), swapped(false), total(0) {
+          fd = ::open(filename.c_str(), O_RDONLY);
+          if (fd < 0) throw IOException("twobit_file: cannot open " + filename);
+
+          try {
+            uint32_t sig;
+            read_bytes(&sig, sizeof(uint32_t), 0);
+            if (sig == SIGNATURE) swapped = false;
+            else if (sig == __builtin_bswap32(SIGNATURE)) swapped = true;
+            else throw IOException("twobit_file: not a .2bit file " + filename);
+
+            uint32_t version = read_u32(4);
+            if (version > 1) throw IOException("twobit_file: unsupported version in " + filename);
+            size_t count = read_u32(8);
+
+            // index
+            size_t pos = 16;
+            seqs.resize(count);
+            for (size_t i = 0; i < count; ++i) {
+              uint8_t len;
+              read_bytes(&len, 1, pos);
+              seqs[i].name.resize(len);
+              if (len > 0) read_bytes(&(seqs[i].name[0]), len, pos + 1);
+              pos += 1 + len;
+              seqs[i].dna_offset = (version == 0) ? read_u32(pos) : read_u64(pos);  // record offset for now
+              pos += (version == 0) ? sizeof(uint32_t) : sizeof(uint64_t);
+            }
+
+            // sequence record headers
+            for (auto & s : seqs) {
+              size_t rec = s.dna_offset;
+              s.length = read_u32(rec);
+              s.first = total;
+              total += s.length;
+
+              size_t n_count = read_u32(rec + 4);
+              std::vector<uint32_t> starts = read_u32s(n_count, rec + 8);
+              std::vector<uint32_t> sizes = read_u32s(n_count, rec + 8 + 4 * n_count);
+              s.n_blocks.reserve(n_count);
+              for (size_t j = 0; j < n_count; ++j) s.n_blocks.emplace_back(starts[j], sizes[j]);
+              ::std::sort(s.n_blocks.begin(), s.n_blocks.end());
+
+              size_t mask_pos = rec + 8 + 8 * n_count;
+              size_t mask_count = read_u32(mask_pos);
+              // skip mask starts and sizes, and the reserved word.
+              s.dna_offset = mask_pos + 4 + 8 * mask_count + 4;
+            }
+          } catch (...) {
+            ::close(fd);
+            fd = -1;
+            throw;
+          }
+        }
+
+        ~twobit_file() {
+          if (fd >= 0) ::close(fd);
+        }
+
+        twobit_file(twobit_file const & other) = delete;
+        twobit_file & operator=(twobit_file const & other) = delete;
+
+        /// total number of bases
+        size_t size() const {
+          return total;
+        }
+
+        /// number of sequences
+        size_t sequences() const {
+          return seqs.size();
+        }
+
+        sequence_info const & sequence(size_t const & i) const {
+          return seqs[i];
+        }
+
+        /**
+         * @brief  append to store the bases for the k-mers that start in the base coordinates [r.start, r.end):
+         *         each sequence's part of [r.start, r.end + k - 1).  parts shorter than k are skipped.
+         * @return number of sequence parts appended.
+         */
+        template <typename ALPHABET>
+        size_t read(::bliss::partition::range<size_t> const & r, size_t k, PackedReadStore<ALPHABET> & store) const {
+          using two_bits = ::std::integral_constant<bool,
+              ::bliss::common::AlphabetTraits<ALPHABET>::getBitsPerChar() == 2>;
+
+          // first sequence that ends after r.start
+          auto it = ::std::upper_bound(seqs.begin(), seqs.end(), r.start,
+              [](size_t const & p, sequence_info const & s) { return p < s.first + s.length; });
+
+          std::vector<uint8_t> buf;
+          size_t n = 0;
+          for (; (it != seqs.end()) && (it->first < r.end); ++it) {
+            size_t a = ::std::max(r.start, it->first) - it->first;
+            size_t b = ::std::min(r.end + k - 1, it->first + it->length) - it->first;
+            if (b - a < k) continue;
+
+            append(store, it - seqs.begin(), a, b, k, buf, two_bits());
+            ++n;
+          }
+          return n;
+        }
+    };
+
+  } // namespace io
+} // namespace bliss
+
+#endif /* SRC_IO_TWOBIT_FILE_HPP_ */
@@ -0,0 +1,187 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    block_iterator.hpp
+ * @ingroup iterators
+ * @author  tpan
+ * @brief   block reads through iterator adaptor chains.
+ * @details a chain such as transform_iterator<filter_iterator<NotEOL, char*>, ASCII2> costs an adaptor dereference,
+ *          an increment, and an end comparison per element at every level, and the compiler rarely vectorizes
+ *          through them.  block_reader<Iter>::read copies up to n elements of [it, end) into a plain array and
+ *          advances it past them.  adaptors with a specialization read a block from their base iterator and then run
+ *          their own operation over the array in a tight loop:
+ *
+ *      transform_iterator  base block, then the functor over the block.
+ *      filter_iterator     base block, then a branch free compaction with the predicate.
+ *      ZipIterator         a block from each component, then pairs them.
+ *
+ *          a random access base is copied directly.  any other iterator, including one2many, many2one and
+ *          concatenating iterators, falls back to reading one element at a time, so every iterator can be read in
+ *          blocks and the specializations are purely an optimization.
+ */
+#ifndef BLOCK_ITERATOR_HPP_
+#define BLOCK_ITERATOR_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#include "iterators/transform_iterator.hpp"
+#include "iterators/filter_iterator.hpp"
+#include "iterators/zip_iterator.hpp"
+
+namespace bliss
+{
+
+  namespace iterator
+  {
+
+    /// number of elements per block used by the adaptor specializations and block_copy.
+    static constexpr size_t BLOCK_SIZE = 256;
+
+    /**
+     * @brief reads blocks of elements from an iterator range.  generic version.
+     * @details random access iterators are copied with a bounded copy_n, others one element at a time.
+     */
+    template <typename Iter>
+    struct block_reader {
+        using value_type = typename ::std::iterator_traits<Iter>::value_type;
+
+        /// copy up to n elements of [it, end) to out and advance it past them.  returns the number copied.
+        static size_t read(Iter & it, Iter const & end, value_type * out, size_t const & n) {
+          return read(it, end, out, n, typename ::std::iterator_traits<Iter>::iterator_category());
+        }
+
+      protected:
+        static size_t read(Iter & it, Iter const & end, value_type * out, size_t const & n,
+                           ::std::random_access_iterator_tag const &) {
+          size_t m = ::std::min(n, static_cast<size_t>(::std::distance(it, end)));
+          ::std::copy_n(it, m, out);
+          it += m;
+          return m;
+        }
+
+        template <typename Tag>
+        static size_t read(Iter & it, Iter const & end, value_type * out, size_t const & n, Tag const &) {
+          size_t i = 0;
+          for (; (i < n) && (it != end); ++i, ++it) out[i] = *it;
+          return i;
+        }
+    };
+
+    /// transform_iterator: read a block of the base, then apply the functor to the whole block.
+    template <typename Iterator, typename Transformer>
+    struct block_reader<transform_iterator<Iterator, Transformer> > {
+        using iterator = transform_iterator<Iterator, Transformer>;
+        using value_type = typename ::std::iterator_traits<iterator>::value_type;
+        using base_value_type = typename ::std::iterator_traits<Iterator>::value_type;
+
+        static size_t read(iterator & it, iterator const & end, value_type * out, size_t const & n) {
+          Iterator & b = it.getBaseIterator();
+          Iterator const & e = end.getBaseIterator();
+          Transformer f = it.getFunctor();
+
+          base_value_type buf[BLOCK_SIZE];
+          size_t total = 0;
+          while (total < n) {
+            size_t m = block_reader<Iterator>::read(b, e, buf, ::std::min(n - total, BLOCK_SIZE));
+            if (m == 0) break;
+            for (size_t i = 0; i < m; ++i) out[total + i] = f(buf[i]);
+            total += m;
+          }
+          return total;
+        }
+    };
+
+    /// filter_iterator: read a block of the base, then keep the elements that pass.
+    template <typename Filter, typename Iterator>
+    struct block_reader<filter_iterator<Filter, Iterator> > {
+        using iterator = filter_iterator<Filter, Iterator>;
+        using value_type = typename ::std::iterator_traits<iterator>::value_type;
+
+        static size_t read(iterator & it, iterator const & end, value_type * out, size_t const & n) {
+          Iterator b = it.getBaseIterator();
+          Iterator const & e = end.getBaseIterator();
+          Filter f = it.getFilter();
+
+          value_type buf[BLOCK_SIZE];
+          size_t total = 0;
+          // never read more base elements than the output has room for, so none that pass are lost.
+          while ((total < n) && (b != e)) {
+            size_t m = block_reader<Iterator>::read(b, e, buf, ::std::min(n - total, BLOCK_SIZE));
+            if (m == 0) break;
+            for (size_t i = 0; i < m; ++i) {
+              out[total] = buf[i];
+              total += f(buf[i]) ? 1 : 0;
+            }
+          }
+          it.seek(b);
+          return total;
+        }
+    };
+
+    /// ZipIterator: read a block of each component and pair them.
+    template <typename FirstIter, typename SecondIter>
+    struct block_reader<ZipIterator<FirstIter, SecondIter> > {
+        using iterator = ZipIterator<FirstIter, SecondIter>;
+        using value_type = typename ::std::iterator_traits<iterator>::value_type;
+        using first_type = typename ::std::iterator_traits<FirstIter>::value_type;
+        using second_type = typename ::std::iterator_traits<SecondIter>::value_type;
+
+        static size_t read(iterator & it, iterator const & end, value_type * out, size_t const & n) {
+          FirstIter & b1 = it.get_first_iterator();
+          SecondIter & b2 = it.get_second_iterator();
+
+          first_type buf1[BLOCK_SIZE];
+          second_type buf2[BLOCK_SIZE];
+          size_t total = 0;
+          while (total < n) {
+            size_t m = block_reader<FirstIter>::read(b1, end.get_first_iterator(), buf1, ::std::min(n - total, BLOCK_SIZE));
+            if (m == 0) break;
+            // the second range is at least as long as the first.
+            m = block_reader<SecondIter>::read(b2, end.get_second_iterator(), buf2, m);
+            for (size_t i = 0; i < m; ++i) out[total + i] = value_type(buf1[i], buf2[i]);
+            total += m;
+          }
+          return total;
+        }
+    };
+
+    /// convenience: read up to n elements of [it, end) into out, advancing it.
+    template <typename Iter>
+    inline size_t read_block(Iter & it, Iter const & end,
+                             typename ::std::iterator_traits<Iter>::value_type * out, size_t const & n) {
+      return block_reader<Iter>::read(it, end, out, n);
+    }
+
+    /// std::copy equivalent that reads the input in blocks.
+    template <typename Iter, typename OutputIter>
+    OutputIter block_copy(Iter first, Iter const & last, OutputIter out) {
+      typename ::std::iterator_traits<Iter>::value_type buf[BLOCK_SIZE];
+      size_t m;
+      while ((m = block_reader<Iter>::read(first, last, buf, BLOCK_SIZE)) > 0) {
+        out = ::std::copy(buf, buf + m, out);
+      }
+      return out;
+    }
+
+  } /* namespace iterator */
+} /* namespace bliss */
+
+#endif /* BLOCK_ITERATOR_HPP_ */
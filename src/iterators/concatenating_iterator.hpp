@@ -130,6 +130,11 @@ namespace bliss
         ConcatenatingIterator(const type& other)
         : ranges(other.ranges), curr_iter_pos(other.curr_iter_pos)
         {
+          // end iterator has no ranges.
+          if (curr_iter_pos < 0) {
+            curr = other.curr;
+            return;
+          }
           // move curr forward the same distance as other.curr - other.starts[curr_iter_pos]
           curr = ranges[curr_iter_pos].first;
           for (auto it = other.ranges[curr_iter_pos].first;
@@ -142,6 +147,11 @@ namespace bliss
         {
           ranges = other.ranges;
           curr_iter_pos = other.curr_iter_pos;
+          // end iterator has no ranges.
+          if (curr_iter_pos < 0) {
+            curr = other.curr;
+            return *this;
+          }
           // move curr forward the same distance as other.curr - other.starts[curr_iter_pos]
           curr = ranges[curr_iter_pos].first;
           for (auto it = other.ranges[curr_iter_pos].first;
@@ -156,6 +166,11 @@ namespace bliss
         {
           curr_iter_pos = other.curr_iter_pos;
 
+          // end iterator has no ranges.
+          if (curr_iter_pos < 0) {
+            curr = std::move(other.curr);
+            return;
+          }
           // move curr forward the same distance as other.curr - other.starts[curr_iter_pos]
           int i = 0;
           for (auto it = other.ranges[curr_iter_pos].first;
@@ -164,7 +179,7 @@ namespace bliss
 
           ranges = std::move(other.ranges);
           curr = ranges[curr_iter_pos].first;
-          for (int j = 0; j < i; ++i, ++curr);
+          for (int j = 0; j < i; ++j, ++curr);
 
         };
 
@@ -173,6 +188,11 @@ namespace bliss
         {
           curr_iter_pos = other.curr_iter_pos;
 
+          // end iterator has no ranges.
+          if (curr_iter_pos < 0) {
+            curr = std::move(other.curr);
+            return *this;
+          }
           // move curr forward the same distance as other.curr - other.starts[curr_iter_pos]
           int i = 0;
           for (auto it = other.ranges[curr_iter_pos].first;
@@ -181,7 +201,7 @@ namespace bliss
 
           ranges = std::move(other.ranges);
           curr = ranges[curr_iter_pos].first;
-          for (int j = 0; j < i; ++i, ++curr);
+          for (int j = 0; j < i; ++j, ++curr);
 
           return *this;
         }
@@ -119,6 +119,21 @@ namespace bliss
           return _curr;
         }
 
+        Filter const & getFilter() const
+        {
+          return _f;
+        }
+
+        /// move to base position pos, then skip forward to the first element that passes.  used by block reads.
+        void seek(Iterator const & pos)
+        {
+          _curr = pos;
+          while (_curr != _end && !_f(*_curr))
+          {
+            ++_curr;
+          }
+        }
+
         /// constructor, for creating start iterator.
         filter_iterator(const Filter & f, Iterator curr,
                         Iterator end)
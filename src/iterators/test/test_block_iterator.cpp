@@ -0,0 +1,126 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * test_block_iterator.cpp
+ * Test block reads through the iterator adaptors against element wise iteration.
+ */
+
+#include "iterators/block_iterator.hpp"
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <list>
+#include <vector>
+#include <random>
+
+using namespace bliss::iterator;
+
+namespace {
+
+  struct NotNewline {
+      bool operator()(char const & c) const {
+        return c != '\n';
+      }
+  };
+
+  struct ToCode {
+      uint8_t operator()(char const & c) const {
+        return static_cast<uint8_t>(c - 'A');
+      }
+  };
+
+  std::vector<char> make_text(size_t const & n) {
+    std::default_random_engine gen(11);
+    std::uniform_int_distribution<int> dist(0, 4);
+    std::vector<char> text(n);
+    for (size_t i = 0; i < n; ++i) {
+      int r = dist(gen);
+      text[i] = (r == 4) ? '\n' : static_cast<char>('A' + r);
+    }
+    return text;
+  }
+
+  /// read all of [it, end) in blocks of n.
+  template <typename Iter>
+  std::vector<typename std::iterator_traits<Iter>::value_type> read_all(Iter it, Iter const & end, size_t const & n) {
+    std::vector<typename std::iterator_traits<Iter>::value_type> out;
+    std::vector<typename std::iterator_traits<Iter>::value_type> buf(n);
+    size_t m;
+    while ((m = read_block(it, end, buf.data(), n)) > 0) {
+      out.insert(out.end(), buf.begin(), buf.begin() + m);
+    }
+    EXPECT_TRUE(it == end);
+    return out;
+  }
+
+}
+
+
+TEST(BlockIteratorTest, transform_filter)
+{
+  using FI = filter_iterator<NotNewline, std::vector<char>::const_iterator>;
+  using TI = transform_iterator<FI, ToCode>;
+
+  for (size_t len : {0UL, 1UL, 255UL, 256UL, 1000UL, 5003UL}) {
+    std::vector<char> text = make_text(len);
+    TI b(FI(NotNewline(), text.cbegin(), text.cend()), ToCode());
+    TI e(FI(NotNewline(), text.cend()), ToCode());
+
+    std::vector<uint8_t> gold(b, e);
+
+    for (size_t n : {1UL, 7UL, 256UL, 1000UL}) {
+      EXPECT_EQ(gold, read_all(b, e, n)) << "len " << len << " block " << n;
+    }
+
+    std::vector<uint8_t> copied;
+    block_copy(b, e, std::back_inserter(copied));
+    EXPECT_EQ(gold, copied);
+  }
+}
+
+TEST(BlockIteratorTest, zip)
+{
+  using ZI = ZipIterator<std::vector<char>::const_iterator, std::vector<int>::const_iterator>;
+
+  std::vector<char> text = make_text(3000);
+  std::vector<int> pos(text.size());
+  for (size_t i = 0; i < pos.size(); ++i) pos[i] = i;
+
+  ZI b(text.cbegin(), pos.cbegin());
+  ZI e(text.cend(), pos.cend());
+
+  std::vector<typename std::iterator_traits<ZI>::value_type> gold(b, e);
+  for (size_t n : {1UL, 7UL, 256UL, 1000UL}) {
+    EXPECT_EQ(gold, read_all(b, e, n)) << "block " << n;
+  }
+}
+
+TEST(BlockIteratorTest, fallback)
+{
+  std::vector<char> text = make_text(1000);
+  std::list<char> l(text.begin(), text.end());
+
+  using FI = filter_iterator<NotNewline, std::list<char>::const_iterator>;
+  FI b(NotNewline(), l.cbegin(), l.cend());
+  FI e(NotNewline(), l.cend());
+
+  std::vector<char> gold(b, e);
+  for (size_t n : {1UL, 7UL, 256UL, 1000UL}) {
+    EXPECT_EQ(gold, read_all(b, e, n)) << "block " << n;
+    EXPECT_EQ(std::vector<char>(text.begin(), text.end()), read_all(l.cbegin(), l.cend(), n));
+  }
+}
@@ -250,6 +250,14 @@ namespace bliss
           return iter2;
         }
 
+        /// mutable accessors, for advancing the components directly (block reads)
+        FirstIter & get_first_iterator() {
+          return iter1;
+        }
+        SecondIter & get_second_iterator() {
+          return iter2;
+        }
+
 
 
 
@@ -28,6 +28,7 @@
 
 #include <stdexcept>
 #include <atomic>
+#include <cstdint>
 #include <cmath>
 #include "bliss-config.hpp"
 #include <type_traits>
@@ -676,6 +677,178 @@ namespace bliss
     };
 
 
+    /**
+     * @class WorkStealingPartitioner
+     * @brief a demand driven partitioner where each partition owns a block of chunks, and steals chunks from other
+     *        partitions when its own are used up.
+     * @details DemandDrivenPartitioner hands out chunks through 1 shared counter, which all threads contend on.
+     *          here each partition starts with the same contiguous block of chunk ids that BlockPartitioner would give it,
+     *          so in the common case a thread only touches its own counter and its own part of the data.
+     *
+     *          the remaining chunk ids of a partition are kept as [begin, end) packed into 1 atomic 64 bit word.
+     *          the owner takes chunks from begin.  a partition with no chunks left takes the back half of a victim's
+     *          remaining chunks, with a CAS on the victim's word.  victims are tried in order of partition id distance,
+     *          so that the stolen chunks are close to the partition's own data, i.e. likely on the same NUMA node when
+     *          threads are bound in order.
+     *
+     *          chunks that are stolen are moved between partitions, so each chunk is returned exactly once.
+     *          returns end when no partition has chunks left.  the ranges of the chunks are the same as DemandDrivenPartitioner's.
+     *
+     *          THREAD SAFE, as long as no 2 concurrent callers request the same partition id.
+     * @tparam Range  type of the range object to be partitioned.
+     */
+    template<typename Range>
+    class WorkStealingPartitioner : public Partitioner<Range, WorkStealingPartitioner<Range> >
+    {
+
+        friend Partitioner<Range, WorkStealingPartitioner<Range> >;
+
+      protected:
+        /**
+         * @typedef BaseClassType
+         * @brief   the superclass type.
+         */
+        using BaseClassType = Partitioner<Range, WorkStealingPartitioner<Range> >;
+
+        /**
+         * @typedef SizeType
+         */
+        using SizeType = typename BaseClassType::SizeType;
+
+        /**
+         * @typedef RangeValueType
+         * @brief   type for the start/end/overlap
+         */
+        using RangeValueType = typename BaseClassType::RangeValueType;
+
+        /**
+         * @brief  remaining chunk ids of a partition, (end << 32) | begin.  padded to a cache line to avoid false sharing.
+         */
+        struct ChunkQueue {
+            std::atomic<uint64_t> ids;
+            char padding[64 - sizeof(std::atomic<uint64_t>)];
+        };
+
+        /**
+         * @var queues
+         * @brief  1 chunk queue per partition.
+         */
+        ChunkQueue *queues;
+
+        static inline uint64_t pack(uint64_t begin, uint64_t end) {
+          return (end << 32) | begin;
+        }
+        static inline uint64_t get_begin(uint64_t ids) {
+          return ids & 0xFFFFFFFFULL;
+        }
+        static inline uint64_t get_end(uint64_t ids) {
+          return ids >> 32;
+        }
+
+      public:
+        WorkStealingPartitioner() : BaseClassType(), queues(nullptr) {};
+
+        /**
+         * @brief default destructor.  cleans up the queues.
+         */
+        virtual ~WorkStealingPartitioner() {
+          if (queues) {
+            delete [] queues;
+            queues = nullptr;
+          }
+        }
+
+
+        /**
+         * @brief configures the partitioner with the source range, number of partitions
+         * @note  should be called by single thread.
+         * @param _src          range object to be partitioned.
+         * @param _nPartitions  the number of partitions to divide this range into
+         * @param _non_overlap_size  size of each chunk for the partitioning.
+         * @param _overlap_size   the size of the overlap region.
+         * @return updated non_overlap_size.
+         */
+        SizeType configure(const Range &_src, const size_t &_nPartitions, const SizeType &_non_overlap_size, const SizeType &_overlap_size = 0) {
+          if (_non_overlap_size <= 0)
+            throw std::invalid_argument("ERROR: partitioner c'tor: non_overlap_size is <= 0");
+
+          this->BaseClassType::configure(_src, _nPartitions, _non_overlap_size, _overlap_size);
+
+          this->nChunks = this->computeNumberOfChunks();
+          if (this->nChunks > 0xFFFFFFFFULL)
+            throw std::invalid_argument("ERROR: work stealing partitioner supports at most 2^32 - 1 chunks");
+
+          if (queues) delete [] queues;
+          queues = new ChunkQueue[this->nPartitions];
+
+          resetImpl();
+
+          return this->non_overlap_size;
+        };
+
+
+      protected:
+
+        /**
+         * @brief       get the next chunk for the partition, from its own chunks first, then by stealing.
+         * @param partId   partition id for the sub range.
+         * @return      range of the chunk.  if no partition has chunks left, return "end".
+         */
+        inline Range getNextImpl(const size_t& partId) {
+
+          // own chunks, from the front.
+          std::atomic<uint64_t> & own = queues[partId].ids;
+          uint64_t ids = own.load(std::memory_order_acquire);
+          while (get_begin(ids) < get_end(ids)) {
+            if (own.compare_exchange_weak(ids, pack(get_begin(ids) + 1, get_end(ids)), std::memory_order_acq_rel))
+              return BaseClassType::computeRangeForChunkId(this->src, 0, get_begin(ids));
+          }
+
+          // steal, nearest partition id first.
+          for (size_t d = 1; d < this->nPartitions; ++d) {
+            if ((partId + d < this->nPartitions) && steal(partId, partId + d, ids))
+              return BaseClassType::computeRangeForChunkId(this->src, 0, get_begin(ids));
+            if ((partId >= d) && steal(partId, partId - d, ids))
+              return BaseClassType::computeRangeForChunkId(this->src, 0, get_begin(ids));
+          }
+
+          return this->end;
+        }
+
+        /**
+         * @brief  take the back half of the victim's chunks.  the first stolen chunk is returned in stolen, the rest go to the thief's queue.
+         * @return true if chunks were stolen.
+         */
+        inline bool steal(const size_t & thief, const size_t & victim, uint64_t & stolen) {
+          std::atomic<uint64_t> & v = queues[victim].ids;
+          uint64_t ids = v.load(std::memory_order_acquire);
+          while (get_begin(ids) < get_end(ids)) {
+            uint64_t mid = get_end(ids) - (get_end(ids) - get_begin(ids) + 1) / 2;
+            if (v.compare_exchange_weak(ids, pack(get_begin(ids), mid), std::memory_order_acq_rel)) {
+              stolen = pack(mid, get_end(ids));
+              // own queue is empty, and thieves do not modify empty queues.
+              queues[thief].ids.store(pack(mid + 1, get_end(ids)), std::memory_order_release);
+              return true;
+            }
+          }
+          return false;
+        }
+
+        /**
+         * @brief resets the partitioner:  each partition gets its block of chunk ids back.
+         */
+        void resetImpl() {
+          if (queues)
+            for (size_t i = 0; i < this->nPartitions; ++i) {
+              queues[i].ids.store(pack((this->nChunks * i) / this->nPartitions, (this->nChunks * (i + 1)) / this->nPartitions),
+                                  std::memory_order_release);
+            }
+        }
+
+
+    };
+
+
   } /* namespace partition */
 } /* namespace bliss */
 
@@ -28,6 +28,7 @@
 #include <cstdint>  // for uint64_t, etc.
 #include <vector>
 #include <limits>
+#include <algorithm>
 
 #ifdef USE_OPENMP
 #include <omp.h>
@@ -503,6 +504,118 @@ TYPED_TEST_P(PartitionTest, demandPartition_openmp){
 }
 #endif
 
+TYPED_TEST_P(PartitionTest, workStealingPartition){
+  typedef bliss::partition::range<TypeParam> RangeType;
+  typedef bliss::partition::WorkStealingPartitioner<range<TypeParam> > PartitionerType;
+  typedef decltype(std::declval<RangeType>().size()) SizeType;
+
+  RangeType src, r;
+
+
+  std::vector<TypeParam> starts =
+  { std::numeric_limits<TypeParam>::min(), std::numeric_limits<TypeParam>::lowest(),
+    0, 1, 2,
+    std::numeric_limits<TypeParam>::max()-2, (std::numeric_limits<TypeParam>::max() / 2) + 1};
+
+  std::vector<SizeType> lens =
+  { 0, 1, 2, 8, 13};
+
+  std::vector<size_t> partitionCount =
+  { 1, 2, 4, 5};
+
+  PartitionerType part;
+  for (auto start : starts)
+  {
+    for (auto len : lens)
+    {
+      src = RangeType(start, static_cast<SizeType>(std::numeric_limits<TypeParam>::max() - start) > len ? start + static_cast<TypeParam>(len) : std::numeric_limits<TypeParam>::max());
+
+      for (auto p : partitionCount)
+      {
+        part.configure(src, p, 1);
+
+        // first chunk of each partition is the start of its block, as in block partitioning.
+        size_t nchunks = static_cast<size_t>(src.size());
+        for (size_t i = 0; i < p; ++i) {
+          if ((nchunks * i) / p == (nchunks * (i+1)) / p) continue;
+          r = part.getNext(i);
+          EXP_EQ(TypeParam, static_cast<TypeParam>(src.start + static_cast<TypeParam>((nchunks * i) / p)), r.start);
+        }
+
+        // partition 0 gets all the rest, by stealing.  every chunk is returned once.
+        part.reset();
+        std::vector<RangeType> chunks;
+        for (r = part.getNext(0); r.size() > 0; r = part.getNext(0)) {
+          chunks.push_back(r);
+        }
+        EXPECT_EQ(nchunks, chunks.size());
+        std::sort(chunks.begin(), chunks.end(), [](RangeType const & x, RangeType const & y){ return x.start < y.start; });
+        for (size_t i = 0; i < chunks.size(); ++i) {
+          EXP_EQ(TypeParam, static_cast<TypeParam>(src.start + static_cast<TypeParam>(i)), chunks[i].start);
+        }
+
+        // all done for the other partitions as well.
+        r = part.getNext(p - 1);
+        EXPECT_EQ(0, r.size());
+      }
+    }
+  }
+}
+
+#ifdef USE_OPENMP
+//test the work stealing partitioning operation. (With openmp threads)
+TYPED_TEST_P(PartitionTest, workStealingPartition_openmp){
+  typedef bliss::partition::range<TypeParam> RangeType;
+  typedef bliss::partition::WorkStealingPartitioner<range<TypeParam> > PartitionerType;
+  typedef decltype(std::declval<RangeType>().size()) SizeType;
+
+  RangeType src;
+
+
+  std::vector<TypeParam> starts =
+  { std::numeric_limits<TypeParam>::min(), 0, 1,
+    std::numeric_limits<TypeParam>::max()-2, (std::numeric_limits<TypeParam>::max() / 2) + 1};
+
+  std::vector<SizeType> lens =
+  { 0, 1, 2, 8, 100};
+
+  //Store the block ranges in a vector
+  std::vector<std::pair<TypeParam, TypeParam>> logRanges;
+
+  PartitionerType part;
+  for (auto start : starts)
+  {
+    for (auto len : lens)
+    {
+      src = RangeType(start, static_cast<SizeType>(std::numeric_limits<TypeParam>::max() - start) >= len ? start + static_cast<TypeParam>(len) : std::numeric_limits<TypeParam>::max());
+
+      part.configure(src, omp_get_max_threads(), 1);
+#pragma omp parallel
+      {
+        size_t block = omp_get_thread_num();
+
+        for (RangeType r = part.getNext(block); r.size() > 0; r = part.getNext(block)) {
+#pragma omp critical
+          logRanges.push_back(std::make_pair(r.start, r.end));
+        }
+      }
+      std::sort(logRanges.begin(), logRanges.end());
+
+      // each chunk exactly once, and together they cover src.
+      EXPECT_EQ(static_cast<size_t>(src.size()), logRanges.size());
+      if (logRanges.size() > 0) {
+        EXP_EQ(TypeParam, src.start, logRanges.front().first);
+        EXP_EQ(TypeParam, src.end, logRanges.back().second);
+      }
+      for(auto it = logRanges.begin(); it != logRanges.end() && std::next(it) != logRanges.end(); it++)
+        EXP_EQ(TypeParam, std::get<1>(*it), std::get<0>(*(std::next(it))));
+
+      logRanges.clear();
+    }
+  }
+}
+#endif
+
 // failed partitions due to asserts.
 TYPED_TEST_P(PartitionTest, badPartitionId){
   typedef bliss::partition::range<TypeParam> RangeType;
@@ -547,9 +660,9 @@ TYPED_TEST_P(PartitionTest, badPartitionId){
 
 // now register the test cases
 #ifdef USE_OPENMP
-REGISTER_TYPED_TEST_CASE_P(PartitionTest, badPartitionId, blockPartition, blockPartition_openmp, cyclicPartition, cyclicPartition_openmp, demandPartition, demandPartition_openmp);
+REGISTER_TYPED_TEST_CASE_P(PartitionTest, badPartitionId, blockPartition, blockPartition_openmp, cyclicPartition, cyclicPartition_openmp, demandPartition, demandPartition_openmp, workStealingPartition, workStealingPartition_openmp);
 #else
-REGISTER_TYPED_TEST_CASE_P(PartitionTest, badPartitionId, blockPartition, cyclicPartition, demandPartition);
+REGISTER_TYPED_TEST_CASE_P(PartitionTest, badPartitionId, blockPartition, cyclicPartition, demandPartition, workStealingPartition);
 #endif
 
 
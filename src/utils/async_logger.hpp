@@ -0,0 +1,395 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    async_logger.hpp
+ * @ingroup utils
+ * @author  tpan
+ * @brief   asynchronous logging engine (BLISS_LOGGING_ASYNC):  per thread lock-free rings of binary records,
+ *          formatted and written by a background thread.
+ * @details the printf and boost engines format and write on the calling thread, and stdio / boost.log serialize
+ *          the writers with a lock.  here the calling thread only fills a fixed size record in its own single producer
+ *          single consumer ring:
+ *            PRINT_*F(fmt, args...)   the format string literal and the raw argument bytes are stored.  snprintf runs
+ *                                     later on the background thread.  c strings are copied into the record.
+ *                                     if the arguments do not fit, the message is formatted eagerly instead.
+ *            PRINT_*(stream expr)     the stream expression is evaluated into a reused thread local ostringstream
+ *                                     and the text is copied into the record.
+ *          messages longer than the record payload are truncated.  a full ring drops the record (never blocks), and
+ *          the drop count is reported in the output.  the background thread merges the rings by timestamp.
+ *
+ *          the logger starts with the first message (or LOG_INIT()), and flushes when the program exits.  fatal
+ *          messages flush before exit().  output goes to stdout, as with the printf engine.
+ */
+#ifndef SRC_UTILS_ASYNC_LOGGER_HPP_
+#define SRC_UTILS_ASYNC_LOGGER_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// number of records per thread ring.  power of 2.
+#ifndef BLISS_ASYNC_LOG_CAPACITY
+#define BLISS_ASYNC_LOG_CAPACITY 1024
+#endif
+
+namespace bliss {
+
+  namespace log {
+
+    namespace async {
+
+      enum severity : uint8_t { FATAL = 0, ERROR = 1, WARNING = 2, INFO = 3, DEBUG = 4, TRACE = 5 };
+
+      struct record;
+      /// formats the record's payload into out.  one instantiation per argument type list.
+      typedef int (*formatter_t)(record const &, char *, size_t);
+
+      /// one log message.  256 bytes, 4 cache lines.
+      struct record {
+          static constexpr size_t payload_size = 224;
+
+          uint64_t ns;              // since logger start
+          uint32_t thread;
+          uint8_t level;
+          char const * fmt;         // format literal, or nullptr if payload is text.
+          formatter_t formatter;
+          char payload[payload_size];
+      };
+      static_assert(sizeof(record) == 256, "async log record should be 256 bytes");
+
+
+      namespace detail {
+
+        /// argument encoding.  trivially copyable values by bytes, c strings by content (with the terminating 0).
+        template <typename T, bool is_str = std::is_same<typename std::decay<T>::type, char const *>::value ||
+                                            std::is_same<typename std::decay<T>::type, char *>::value>
+        struct arg_codec {
+            typedef typename std::decay<T>::type value_type;
+            static_assert(std::is_trivially_copyable<value_type>::value, "async log arguments must be trivially copyable");
+
+            static bool encode(char *& p, char * end, value_type const & v) {
+              if (p + sizeof(value_type) > end) return false;
+              memcpy(p, &v, sizeof(value_type));
+              p += sizeof(value_type);
+              return true;
+            }
+            static char const * decode(char const * p, value_type & v) {
+              memcpy(&v, p, sizeof(value_type));
+              return p + sizeof(value_type);
+            }
+        };
+        template <typename T>
+        struct arg_codec<T, true> {
+            typedef char const * value_type;
+
+            static bool encode(char *& p, char * end, char const * v) {
+              if (v == nullptr) v = "(null)";
+              size_t len = strlen(v) + 1;
+              if (p + len > end) return false;
+              memcpy(p, v, len);
+              p += len;
+              return true;
+            }
+            static char const * decode(char const * p, value_type & v) {
+              v = p;
+              return p + strlen(p) + 1;
+            }
+        };
+
+        inline bool encode(char *&, char *) { return true; }
+        template <typename T, typename... Rest>
+        inline bool encode(char *& p, char * end, T const & v, Rest const &... rest) {
+          return arg_codec<T>::encode(p, end, v) && encode(p, end, rest...);
+        }
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#pragma GCC diagnostic ignored "-Wformat-security"
+        /// decode the arguments one at a time, then call snprintf with all of them.
+        template <typename... Args>
+        struct decoder;
+        template <>
+        struct decoder<> {
+            template <typename... Done>
+            static int apply(char * out, size_t n, char const * fmt, char const *, Done... done) {
+              return snprintf(out, n, fmt, done...);
+            }
+        };
+        template <typename Head, typename... Tail>
+        struct decoder<Head, Tail...> {
+            template <typename... Done>
+            static int apply(char * out, size_t n, char const * fmt, char const * p, Done... done) {
+              typename arg_codec<Head>::value_type v;
+              p = arg_codec<Head>::decode(p, v);
+              return decoder<Tail...>::apply(out, n, fmt, p, done..., v);
+            }
+        };
+#pragma GCC diagnostic pop
+
+        template <typename... Args>
+        int format(record const & r, char * out, size_t n) {
+          return decoder<Args...>::apply(out, n, r.fmt, r.payload);
+        }
+
+        /// single producer (the owning thread), single consumer (whoever holds the logger's drain lock).
+        struct ring {
+            static constexpr size_t capacity = BLISS_ASYNC_LOG_CAPACITY;
+            static_assert((capacity & (capacity - 1)) == 0, "BLISS_ASYNC_LOG_CAPACITY must be a power of 2");
+
+            alignas(64) std::atomic<size_t> head;     // next slot to write.  producer only.
+            alignas(64) std::atomic<size_t> tail;     // next slot to read.  consumer only.
+            alignas(64) std::atomic<size_t> dropped;  // written by producer.
+            size_t reported;                          // consumer only.
+            std::atomic<bool> closed;                 // owning thread exited.
+            uint32_t id;
+            std::vector<record> slots;
+
+            explicit ring(uint32_t _id) : head(0), tail(0), dropped(0), reported(0), closed(false), id(_id),
+                slots(capacity) {}
+
+            /// slot to fill, or nullptr if full.  publish with commit().
+            record * acquire() {
+              size_t h = head.load(std::memory_order_relaxed);
+              if (h - tail.load(std::memory_order_acquire) >= capacity) {
+                dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return nullptr;
+              }
+              return &(slots[h & (capacity - 1)]);
+            }
+            void commit() {
+              head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+
+            /// append all published records to out.
+            size_t pop_all(std::vector<record> & out) {
+              size_t t = tail.load(std::memory_order_relaxed);
+              size_t h = head.load(std::memory_order_acquire);
+              for (size_t i = t; i < h; ++i) out.push_back(slots[i & (capacity - 1)]);
+              tail.store(h, std::memory_order_release);
+              return h - t;
+            }
+        };
+
+      } // namespace detail
+
+
+      /// the logger.  a process wide singleton, with a background thread that drains the thread rings.
+      class logger {
+        protected:
+          std::mutex reg_mutex;        // rings registry.  taken once per thread, and by the consumer.
+          std::vector<std::shared_ptr<detail::ring> > rings;
+          uint32_t next_id;
+
+          std::mutex drain_mutex;      // one consumer at a time:  the background thread or flush().
+          std::vector<record> batch;
+          FILE * out;
+
+          std::atomic<bool> running;
+          std::thread worker;
+          std::chrono::steady_clock::time_point start;
+
+          /// per thread handle.  marks the ring closed when the thread exits, so the consumer can release it.
+          struct handle {
+              std::shared_ptr<detail::ring> r;
+              ~handle() { if (r) r->closed.store(true, std::memory_order_release); }
+          };
+
+          logger() : next_id(0), out(stdout), running(true), start(std::chrono::steady_clock::now()) {
+            worker = std::thread(&logger::run, this);
+          }
+
+          void run() {
+            unsigned int idle = 0;
+            while (running.load(std::memory_order_acquire)) {
+              if (drain() > 0) {
+                idle = 0;
+              } else {
+                // back off from 50us to 6.4ms while idle.  producers never wake the consumer.
+                std::this_thread::sleep_for(std::chrono::microseconds(50UL << std::min(idle, 7U)));
+                ++idle;
+              }
+            }
+            drain();
+          }
+
+          static char const * label(uint8_t level) {
+            static char const * labels[] = { "[fatal]", "[error]", "[warn ]", "[info ]", "[debug]", "[trace]" };
+            return (level <= TRACE) ? labels[level] : "[?????]";
+          }
+
+        public:
+          static logger & instance() {
+            static logger l;
+            return l;
+          }
+
+          ~logger() {
+            running.store(false, std::memory_order_release);
+            if (worker.joinable()) worker.join();
+          }
+
+          /// the calling thread's ring.  registered on first use.
+          detail::ring & local() {
+            static thread_local handle h;
+            if (!h.r) {
+              std::lock_guard<std::mutex> lock(reg_mutex);
+              h.r = std::make_shared<detail::ring>(next_id++);
+              rings.push_back(h.r);
+            }
+            return *(h.r);
+          }
+
+          uint64_t now() const {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+          }
+
+          /// redirect the output.  for testing.
+          void set_output(FILE * f) {
+            std::lock_guard<std::mutex> lock(drain_mutex);
+            out = f;
+          }
+
+          /**
+           * @brief  move all published records from the rings to the output, in timestamp order.
+           * @return the number of records written.
+           */
+          size_t drain() {
+            std::lock_guard<std::mutex> lock(drain_mutex);
+
+            std::vector<std::shared_ptr<detail::ring> > rs;
+            {
+              std::lock_guard<std::mutex> lock(reg_mutex);
+              rs = rings;
+            }
+
+            batch.clear();
+            char line[512];
+            for (size_t i = 0; i < rs.size(); ++i) {
+              rs[i]->pop_all(batch);
+              size_t d = rs[i]->dropped.load(std::memory_order_relaxed);
+              if (d != rs[i]->reported) {
+                fprintf(out, "[warn ] async logger dropped %lu records on thread %u (ring full)\n",
+                        d - rs[i]->reported, rs[i]->id);
+                rs[i]->reported = d;
+              }
+            }
+            std::stable_sort(batch.begin(), batch.end(),
+                             [](record const & x, record const & y) { return x.ns < y.ns; });
+
+            for (size_t i = 0; i < batch.size(); ++i) {
+              record const & r = batch[i];
+              char const * text = r.payload;
+              if (r.fmt != nullptr) {
+                r.formatter(r, line, sizeof(line));
+                text = line;
+              }
+              fprintf(out, "%s (t%u %.6f) %s\n", label(r.level), r.thread, static_cast<double>(r.ns) * 1e-9, text);
+            }
+            if (!batch.empty()) fflush(out);
+
+            // release the rings of exited threads once they are empty.
+            {
+              std::lock_guard<std::mutex> lock(reg_mutex);
+              rings.erase(std::remove_if(rings.begin(), rings.end(), [](std::shared_ptr<detail::ring> const & r) {
+                return r->closed.load(std::memory_order_acquire) &&
+                    (r->tail.load(std::memory_order_relaxed) == r->head.load(std::memory_order_acquire));
+              }), rings.end());
+            }
+            return batch.size();
+          }
+
+          /// log preformatted text.
+          void log_text(uint8_t level, char const * text, size_t len) {
+            detail::ring & rg = local();
+            record * r = rg.acquire();
+            if (r == nullptr) return;
+            r->ns = now();
+            r->thread = rg.id;
+            r->level = level;
+            r->fmt = nullptr;
+            len = std::min(len, record::payload_size - 1);
+            memcpy(r->payload, text, len);
+            r->payload[len] = 0;
+            rg.commit();
+          }
+
+          /// log a printf style message.  formatting is deferred to the background thread when the arguments fit.
+          template <typename... Args>
+          void log_format(uint8_t level, char const * fmt, Args const &... args) {
+            detail::ring & rg = local();
+            record * r = rg.acquire();
+            if (r == nullptr) return;
+            r->ns = now();
+            r->thread = rg.id;
+            r->level = level;
+            char * p = r->payload;
+            if (detail::encode(p, r->payload + record::payload_size, args...)) {
+              r->fmt = fmt;
+              r->formatter = &detail::format<typename std::decay<Args>::type...>;
+            } else {
+              // does not fit.  format now.
+              detail::decoder<>::apply(r->payload, record::payload_size, fmt, nullptr, args...);
+              r->fmt = nullptr;
+            }
+            rg.commit();
+          }
+      };
+
+      /// reused per thread stream for the stream style macros.
+      inline std::ostringstream & thread_stream() {
+        static thread_local std::ostringstream ss;
+        ss.str(std::string());
+        ss.clear();
+        return ss;
+      }
+
+      inline void log_stream(uint8_t level, std::ostringstream & ss) {
+        std::string const & s = ss.str();
+        logger::instance().log_text(level, s.c_str(), s.size());
+      }
+
+      template <typename... Args>
+      inline void logf(uint8_t level, char const * fmt, Args const &... args) {
+        logger::instance().log_format(level, fmt, args...);
+      }
+
+      /// write out everything logged so far, on the calling thread.
+      inline void flush() {
+        logger::instance().drain();
+      }
+
+      /// start the background thread.
+      inline void init() {
+        logger::instance();
+      }
+
+    } // namespace async
+
+  } // namespace log
+
+} // namespace bliss
+
+#endif /* SRC_UTILS_ASYNC_LOGGER_HPP_ */
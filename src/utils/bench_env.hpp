@@ -0,0 +1,257 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    bench_env.hpp
+ * @ingroup utils
+ * @author  tpan
+ * @brief   repeatable starting conditions for benchmarks:  thread pinning, CPU cache flush, page cache clear.
+ * @details a benchmark used as a regression gate has to give the same number on the same code.  the main sources of
+ *          run to run variance that the process can control are migration between cores (and sockets), and whatever
+ *          the previous benchmark left in the caches.
+ *
+ *          settings come from environment variables, so that the benchmark binaries keep their own command lines:
+ *            BLISS_BENCH_CPU            pin the calling thread to this logical CPU.  unset or negative:  not pinned.
+ *            BLISS_BENCH_FLUSH          1:  flush the CPU caches before each benchmark run (see flush_cpu_caches).
+ *            BLISS_BENCH_CLEAR_PAGES    1:  clear the OS page cache once at startup (see clear_page_cache).  slow, as
+ *                                       it allocates and touches all available memory.  for file io benchmarks.
+ *
+ *          drop_file_pages evicts a single file from the page cache, for cold reads between runs of a file io benchmark.
+ */
+#ifndef SRC_UTILS_BENCH_ENV_HPP_
+#define SRC_UTILS_BENCH_ENV_HPP_
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>   // getenv, atoi
+#include <cstring>   // memset
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#include <fcntl.h>   // open, posix_fadvise
+#endif
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#include "utils/memory_usage.hpp"
+
+namespace bliss {
+
+  namespace utils {
+
+    namespace bench {
+
+      /// settings from the environment.
+      struct env {
+          int cpu = -1;
+          bool flush = false;
+          bool clear_pages = false;
+
+          static env from_environment() {
+            env e;
+            char const * s = getenv("BLISS_BENCH_CPU");
+            if ((s != nullptr) && (*s != '\0')) e.cpu = atoi(s);
+            s = getenv("BLISS_BENCH_FLUSH");
+            e.flush = (s != nullptr) && (atoi(s) != 0);
+            s = getenv("BLISS_BENCH_CLEAR_PAGES");
+            e.clear_pages = (s != nullptr) && (atoi(s) != 0);
+            return e;
+          }
+      };
+
+      /// pin the calling thread to a logical CPU.  false if not supported or the CPU is not in the allowed set.
+      inline bool pin_thread(int cpu) {
+#if defined(__linux__)
+        if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return sched_setaffinity(0, sizeof(cpu_set_t), &set) == 0;
+#else
+        return false;
+#endif
+      }
+
+      /// size of the last level cache in bytes.  32MB if unknown.
+      inline size_t last_level_cache_bytes() {
+        long bytes = -1;
+#if defined(__linux__) && defined(_SC_LEVEL3_CACHE_SIZE)
+        bytes = sysconf(_SC_LEVEL3_CACHE_SIZE);
+        if (bytes <= 0) bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+        return (bytes > 0) ? static_cast<size_t>(bytes) : (32UL << 20);
+      }
+
+      /**
+       * @brief  evict the benchmark's data from the CPU caches by writing then reading a buffer of 4x the last
+       *         level cache (or bytes, if not 0).  returns a checksum so the reads are not optimized out.
+       */
+      inline size_t flush_cpu_caches(size_t bytes = 0) {
+        if (bytes == 0) bytes = 4 * last_level_cache_bytes();
+        std::vector<size_t> buf(bytes / sizeof(size_t));
+        for (size_t i = 0; i < buf.size(); ++i) buf[i] = i;
+        size_t sum = 0;
+        for (size_t i = 0; i < buf.size(); i += 8) sum += buf[i];   // one read per 64 byte line.
+        return sum;
+      }
+
+      /// flush_cpu_caches if BLISS_BENCH_FLUSH is set.  for per run setup hooks, e.g. google benchmark's Setup.
+      inline void flush_if_enabled() {
+        static const bool enabled = env::from_environment().flush;
+        static volatile size_t sink = 0;
+        if (enabled) sink = sink + flush_cpu_caches();
+      }
+
+      /**
+       * @brief  clear the disk cache in linux by allocating a bunch of memory.
+       * @details  in 1MB chunks to workaround memory fragmentation preventing allocation.
+       *           can potentially use swap, or if there is not enough physical + swap, be killed.
+       *
+       */
+      inline void clear_page_cache() {
+        size_t avail = ::plog::MemUsage::get_usable_mem();
+        size_t rem = avail;
+
+        size_t minchunk = 1UL << 24;    // 16MB chunks
+        size_t chunk = minchunk;
+
+        size_t maxchunk = std::min(1UL << 36, (avail >> 4));
+        for ( ;chunk < maxchunk; chunk <<= 1) ;   // keep increasing chunks until larger than 1/16 of avail, or until 1GB.
+
+        std::vector<size_t *> dummy;
+
+        size_t nchunks;
+        size_t j = 0, lj;
+
+#if defined(USE_OPENMP)
+        int max_threads = omp_get_max_threads();
+
+        if (max_threads > 8) max_threads -= 2;
+        else if (max_threads > 4) max_threads -= 1;
+#else
+        int max_threads = 1;
+#endif
+
+        printf("begin clearing %lu bytes using %d threads\n", avail, max_threads);
+        size_t iter_cleared = 0;
+
+        while ((chunk >= minchunk) && (rem > minchunk)) {
+          nchunks = rem / chunk;
+
+          iter_cleared = 0;
+          lj = 0;
+#if defined(USE_OPENMP)
+#pragma omp parallel for num_threads(max_threads) shared(nchunks, chunk, dummy) reduction(+:lj, iter_cleared)
+#endif
+          for (size_t i = 0; i < nchunks; ++i) {
+            // (c|m)alloc/free seems to be optimized out.  using new works.
+            size_t * ptr = new size_t[(chunk / sizeof(size_t))];
+
+            iter_cleared += chunk;
+            memset(ptr, 0, chunk);
+            ptr[0] = i;
+
+#if defined(USE_OPENMP)
+#pragma omp critical
+#endif
+            {
+              dummy.push_back(ptr);
+            }
+
+            ++lj;
+          }
+
+          j += lj;
+          rem -= iter_cleared;
+
+          printf("cleared %lu bytes using %lu chunk %lu bytes. total cleared %lu bytes, rem %lu bytes \n", iter_cleared, nchunks, chunk, avail - rem, rem);
+          fflush(stdout);
+
+          // reduce the size of the chunk by 4
+          chunk >>= 4;
+        }
+        printf("finished clearing %lu/%lu bytes with %lu remaining\n", avail - rem, avail, rem);
+        fflush(stdout);
+
+        size_t sum = 0;
+        size_t ii = 0;
+        size_t *ptr;
+        for (; ii < dummy.size(); ++ii) {
+          ptr = dummy[ii];
+
+          if (ptr != nullptr) {
+            sum += ptr[ii >> 10];
+            delete [] ptr;
+            dummy[ii] = nullptr;
+          } else {
+            break;
+          }
+        }
+        printf("\n");
+        printf("disk cache cleared (dummy %lu). %lu blocks %lu bytes\n", sum, j, avail - rem);
+      }
+
+      /**
+       * @brief  evict the clean pages of a file from the page cache, without root.
+       * @details  posix_fadvise(POSIX_FADV_DONTNEED) on the whole file.  pages that are dirty or mapped by a live process
+       *           stay cached.  the page cache is per node, so 1 process per node suffices.
+       * @return true if the advice was accepted.
+       */
+      inline bool drop_file_pages(std::string const & filename) {
+#if defined(__linux__)
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        fdatasync(fd);
+        bool ok = (posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0);
+        close(fd);
+        return ok;
+#else
+        return false;
+#endif
+      }
+
+      /**
+       * @brief  apply the startup settings of e:  clear the page cache, then pin.
+       * @return description of what was applied, for the benchmark report.
+       */
+      inline std::string prepare(env const & e) {
+        std::string desc;
+        if (e.clear_pages) {
+          clear_page_cache();
+          desc += "page cache cleared; ";
+        }
+        if (e.cpu >= 0) {
+          desc += pin_thread(e.cpu) ? ("pinned to cpu " + std::to_string(e.cpu)) :
+              ("pinning to cpu " + std::to_string(e.cpu) + " FAILED");
+        } else {
+          desc += "not pinned";
+        }
+        if (e.flush) desc += "; cpu caches flushed per run";
+        return desc;
+      }
+
+    } // namespace bench
+
+  } // namespace utils
+
+} // namespace bliss
+
+#endif /* SRC_UTILS_BENCH_ENV_HPP_ */
@@ -46,6 +46,7 @@
   #define BL_BENCH_REPORT_MPI(title, rank, comm)          do { BL_TIMER_REPORT_MPI(title, comm); BL_MEMUSE_REPORT_MPI(title, comm); } while (0)
   #define BL_BENCH_REPORT_NAMED(title, name)                    do { BL_TIMER_REPORT_NAMED(title, name); BL_MEMUSE_REPORT_NAMED(title, name); } while (0)
   #define BL_BENCH_REPORT_MPI_NAMED(title, name, comm)          do { BL_TIMER_REPORT_MPI_NAMED(title, name, comm); BL_MEMUSE_REPORT_MPI_NAMED(title, name, comm); } while (0)
+  #define BL_BENCH_EXPORT(filename)                             do { BL_TIMER_EXPORT(filename); } while (0)
 
 #else
 
@@ -63,6 +64,7 @@
   #define BL_BENCH_REPORT_MPI(title, rank, comm)
   #define BL_BENCH_REPORT_NAMED(title, name)
   #define BL_BENCH_REPORT_MPI_NAMED(title, name, comm)
+  #define BL_BENCH_EXPORT(filename)
 #endif
 
 #endif /* SRC_WIP_SYSTEM_UTILS_HPP_ */
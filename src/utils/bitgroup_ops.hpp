@@ -56,6 +56,19 @@
 #include <x86intrin.h>   // all intrinsics.  will be enabled based on compiler flag such as __SSSE3__ internally.
 #endif
 
+// AVX512 bit reverse works on 256 bit registers (VL), and needs byte permute (VBMI) and GF(2) affine byte transform (GFNI).
+// e.g. Ice Lake and Sapphire Rapids.
+#if defined(__AVX2__) && defined(__AVX512VL__) && defined(__AVX512VBMI__) && defined(__GFNI__)
+#define BLISS_BITREV_AVX512
+#endif
+
+// NEON bit reverse works on 128 bit registers, and needs the A64 table lookup (TBL) and per byte bit reverse (RBIT).
+// e.g. AWS Graviton, Ampere Altra, Apple M series.  SVE capable cores (A64FX, Graviton3) use this as well.
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define BLISS_BITREV_NEON
+#endif
+
 #if defined __GNUC__ && __GNUC__>=6
 // disable __m128i and __m256i ignored attribute warning in gcc
   #pragma GCC diagnostic push
@@ -67,7 +80,7 @@
 
 
 
-// done:  3bit reverse - done for SWAR, SSSE3, AVX2
+// done:  3bit reverse - done for SWAR, SSSE3, AVX2, AVX512, NEON
 // done:  see effect of not shifting when working with byte arrays.  okay not to shift, if bit_offset is passed to reverse
 // done:  vector reverse.
 // TODO:  perf compare to old impl - slower.  cause:  branching, and sometimes non-inlining.
@@ -106,6 +119,8 @@ namespace bliss {
       static constexpr unsigned char BIT_REV_SWAR = 1;   // SIMD Within A Register
       static constexpr unsigned char BIT_REV_SSSE3 = 2;
       static constexpr unsigned char BIT_REV_AVX2 = 4;
+      static constexpr unsigned char BIT_REV_AVX512 = 8;  // AVX512 VBMI and GFNI, on __m256i
+      static constexpr unsigned char BIT_REV_NEON = 16;   // aarch64 NEON, on uint8x16_t.  never enabled together with the x86 ones.
 
       // TODO: replace all unsigned char SIMD specifiers.
       // for now, this is used only for the generic operator version of reverse.
@@ -117,10 +132,24 @@ namespace bliss {
     	  using MachineWord = uint64_t;
           static constexpr unsigned char SIMDVal = BIT_REV_SWAR;
       };
+      /// 128 bit NEON.  the x86 SIMD types fall back to this on aarch64.
+      struct BITREV_NEON {
+#if defined(BLISS_BITREV_NEON)
+    	  using MachineWord = uint8x16_t;
+          static constexpr unsigned char SIMDVal = BIT_REV_NEON;
+#else
+    	  using MachineWord = uint64_t;
+          static constexpr unsigned char SIMDVal = BIT_REV_SWAR;
+#endif
+      };
+
       struct BITREV_SSSE3 {
 #if defined(__SSSE3__)
     	  using MachineWord = __m128i;
           static constexpr unsigned char SIMDVal = BIT_REV_SSSE3;
+#elif defined(BLISS_BITREV_NEON)
+    	  using MachineWord = uint8x16_t;
+          static constexpr unsigned char SIMDVal = BIT_REV_NEON;
 #else
     	  using MachineWord = uint64_t;
           static constexpr unsigned char SIMDVal = BIT_REV_SWAR;
@@ -134,22 +163,39 @@ namespace bliss {
 #elif defined(__SSSE3__)
     	  using MachineWord = __m128i;
           static constexpr unsigned char SIMDVal = BIT_REV_SSSE3;
+#elif defined(BLISS_BITREV_NEON)
+    	  using MachineWord = uint8x16_t;
+          static constexpr unsigned char SIMDVal = BIT_REV_NEON;
 #else
     	  using MachineWord = uint64_t;
           static constexpr unsigned char SIMDVal = BIT_REV_SWAR;
 #endif
       };
 
+      /// same machine word as AVX2.  byte permute and GF(2) affine instructions replace the AVX2 shuffles and lookups.
+      struct BITREV_AVX512 {
+#if defined(BLISS_BITREV_AVX512)
+    	  using MachineWord = __m256i;
+          static constexpr unsigned char SIMDVal = BIT_REV_AVX512;
+#else
+    	  using MachineWord = typename BITREV_AVX2::MachineWord;
+          static constexpr unsigned char SIMDVal = BITREV_AVX2::SIMDVal;
+#endif
+      };
+
       /// automatically choose the most appropriate MachineWord and SIMD type based
       /// on supported simd capability and number of bytes to be reversed.
-      template <size_t BYTES, typename MAX_SIMD = BITREV_AVX2>
+      template <size_t BYTES, typename MAX_SIMD = BITREV_AVX512>
       struct BITREV_AUTO_AGGRESSIVE {
     	  using MachineWord =
 #if defined(__AVX2__)
-    			  typename ::std::conditional<((BYTES > 16) && (MAX_SIMD::SIMDVal == BIT_REV_AVX2)), __m256i,
+    			  typename ::std::conditional<((BYTES > 16) && (MAX_SIMD::SIMDVal >= BIT_REV_AVX2)), __m256i,
 #endif
 #if defined(__SSSE3__)
     			    typename ::std::conditional<((BYTES > 8) && (MAX_SIMD::SIMDVal >= BIT_REV_SSSE3)),  __m128i,
+#endif
+#if defined(BLISS_BITREV_NEON)
+    			    typename ::std::conditional<((BYTES > 8) && (MAX_SIMD::SIMDVal == BIT_REV_NEON)),  uint8x16_t,
 #endif
     			    typename ::std::conditional<(BYTES > 4),  uint64_t,
     			        typename ::std::conditional<(BYTES > 2),  uint32_t,
@@ -158,6 +204,9 @@ namespace bliss {
     			          >::type
     			        >::type
   			          >::type
+#if defined(BLISS_BITREV_NEON)
+  			        >::type
+#endif
 #if defined(__SSSE3__)
   			        >::type
 #endif
@@ -170,20 +219,23 @@ namespace bliss {
     			  (BYTES > 16) ?
     					MAX_SIMD::SIMDVal :
     					(BYTES > 8) ?
-    					  ((MAX_SIMD::SIMDVal == BIT_REV_AVX2) ? BIT_REV_SSSE3 : MAX_SIMD::SIMDVal) :
+    					  (((MAX_SIMD::SIMDVal == BIT_REV_AVX2) || (MAX_SIMD::SIMDVal == BIT_REV_AVX512)) ? BIT_REV_SSSE3 : MAX_SIMD::SIMDVal) :
     					  BIT_REV_SWAR;
       };
 
       /// automatically choose the most appropriate MachineWord and SIMD type based
       /// on supported simd capability and number of bytes to be reversed.
-      template <size_t BYTES, typename MAX_SIMD = BITREV_AVX2>
+      template <size_t BYTES, typename MAX_SIMD = BITREV_AVX512>
       struct BITREV_AUTO_CONSERVATIVE {
     	  using MachineWord =
 #if defined(__AVX2__)
-    			  typename ::std::conditional<((BYTES >= 32) && (MAX_SIMD::SIMDVal == BIT_REV_AVX2)), __m256i,
+    			  typename ::std::conditional<((BYTES >= 32) && (MAX_SIMD::SIMDVal >= BIT_REV_AVX2)), __m256i,
 #endif
 #if defined(__SSSE3__)
     			    typename ::std::conditional<((BYTES >= 16) && (MAX_SIMD::SIMDVal >= BIT_REV_SSSE3)),  __m128i,
+#endif
+#if defined(BLISS_BITREV_NEON)
+    			    typename ::std::conditional<((BYTES >= 16) && (MAX_SIMD::SIMDVal == BIT_REV_NEON)),  uint8x16_t,
 #endif
     			    typename ::std::conditional<(BYTES >= 8),  uint64_t,
     			        typename ::std::conditional<(BYTES >= 4),  uint32_t,
@@ -192,6 +244,9 @@ namespace bliss {
     			          >::type
     			        >::type
   			          >::type
+#if defined(BLISS_BITREV_NEON)
+  			        >::type
+#endif
 #if defined(__SSSE3__)
   			        >::type
 #endif
@@ -204,7 +259,7 @@ namespace bliss {
     			  (BYTES >= 32) ?
     					MAX_SIMD::SIMDVal :
     					(BYTES >= 16) ?
-    					  ((MAX_SIMD::SIMDVal == BIT_REV_AVX2) ? BIT_REV_SSSE3 : MAX_SIMD::SIMDVal) :
+    					  (((MAX_SIMD::SIMDVal == BIT_REV_AVX2) || (MAX_SIMD::SIMDVal == BIT_REV_AVX512)) ? BIT_REV_SSSE3 : MAX_SIMD::SIMDVal) :
     					  BIT_REV_SWAR;
       };
 
@@ -655,7 +710,7 @@ namespace bliss {
 
           // for performance testing of the reverse_transform framework
           template <unsigned int BITS = BIT_GROUP_SIZE, typename WORD_TYPE>
-          BITS_INLINE typename std::enable_if<(BITS < 8) && (BITS && (BITS - 1) == 0), WORD_TYPE>::type
+          BITS_INLINE typename std::enable_if<(BITS < 8) && ((BITS & (BITS - 1)) == 0), WORD_TYPE>::type
           reverse_bits_in_byte(WORD_TYPE const &u) const {
             static_assert((::std::is_integral<WORD_TYPE>::value) && (!::std::is_signed<WORD_TYPE>::value), "ERROR: WORD_TYPE has to be unsigned integral type.");
             static_assert(sizeof(WORD_TYPE) <= 8, "ERROR: WORD_TYPE should be primitive and smaller than 8 bytes for SWAR");
@@ -1807,7 +1862,7 @@ namespace bliss {
           }
 
           template <unsigned int BITS = BIT_GROUP_SIZE>
-          BITS_INLINE typename std::enable_if<(BITS < 8) && (BITS && (BITS - 1) == 0), __m256i>::type
+          BITS_INLINE typename std::enable_if<(BITS < 8) && ((BITS & (BITS - 1)) == 0), __m256i>::type
           reverse_bits_in_byte(__m256i const & u) const {
 
             // load from memory in reverse is not appropriate here - since we may not have aligned memory, and we have v instead of a memory location.
@@ -2012,6 +2067,548 @@ template <unsigned int BIT_GROUP_SIZE, bool POW2> const __m256i bitgroup_ops<BIT
 
 #endif
 
+#if defined(BLISS_BITREV_AVX512)
+
+      /**
+       * @brief partial template specialization for AVX512 based bit reverse of __m256i.  defined for bit_group_sizes that are powers of 2 up to 128 bits.
+       * @details  1 byte permute (vpermb, VBMI) reverses the bytes or byte groups across the whole register, so no lane swap is needed,
+       *           and 1 GF(2) affine transform (vgf2p8affineqb, GFNI) reverses the bit groups within each byte, replacing the 2 lookups.
+       *           the affine transform also xors a constant, so the negation for DNA reverse complement is free.  see reverse_not.
+       */
+      template <unsigned int BIT_GROUP_SIZE, bool POW2>
+      struct bitgroup_ops<BIT_GROUP_SIZE, BIT_REV_AVX512, POW2> {
+          static_assert(BIT_GROUP_SIZE > 0, "ERROR: BIT_GROUP_SIZE is 0");
+          static_assert(BIT_GROUP_SIZE < 256, "ERROR: BIT_GROUP_SIZE is greater than number of bits in __m256i");
+          static_assert((BIT_GROUP_SIZE & (BIT_GROUP_SIZE - 1)) == 0, "ERROR: BIT_GROUP_SIZE is has to be powers of 2");
+
+          /// byte permute index that reverses the bit groups if at least a byte, else the bytes.
+          static const __m256i rev_idx;
+          static constexpr unsigned int bitsPerGroup = BIT_GROUP_SIZE;
+          static constexpr unsigned char simd_type = BIT_REV_AVX512;
+
+          /// affine matrix row for output bit i:  output bit i is input bit (groups - 1 - i / BITS) * BITS + i % BITS.  row for bit i is byte 7 - i.
+          template <unsigned int BITS = BIT_GROUP_SIZE>
+          static constexpr uint64_t gf_row(unsigned int i) {
+            return static_cast<uint64_t>(1U << ((8 / BITS - 1 - i / BITS) * BITS + i % BITS)) << ((7 - i) << 3);
+          }
+          /// GF(2) affine matrix that reverses the bit groups within a byte.  e.g. 0x8040201008040201 for 1 bit groups.
+          template <unsigned int BITS = BIT_GROUP_SIZE>
+          static constexpr uint64_t gf_matrix(unsigned int i = 0) {
+            return (i == 8) ? 0 : (gf_row<BITS>(i) | gf_matrix<BITS>(i + 1));
+          }
+
+          static __m256i make_rev_idx() {
+            constexpr uint8_t bytes_per_group = (BIT_GROUP_SIZE < 8) ? 1 : (BIT_GROUP_SIZE >> 3);
+            uint8_t BLISS_ALIGNED_ARRAY(idx, 32, 32);
+            for (uint8_t i = 0; i < 32; ++i) {
+              idx[i] = (31 - i) ^ (bytes_per_group - 1);
+            }
+            return _mm256_load_si256((__m256i*)idx);
+          }
+
+          bitgroup_ops() {}
+
+          static ::std::string toString(__m256i const & v) {
+            uint8_t BLISS_ALIGNED_ARRAY(tmp, 32, 32);
+            _mm256_store_si256((__m256i*)tmp, v);
+            ::std::stringstream ss;
+            for (int i = 31; i >= 0; --i) {
+              ss << std::hex << std::setfill('0') << std::setw(2) << static_cast<size_t>(tmp[i]) << " ";
+            }
+            return ss.str();
+          }
+
+
+          /// reverse function to reverse bits for data types are are not __mm256i   (has to be bigger than at least half)
+          BITS_INLINE uint16_t reverse(uint8_t * out, uint8_t const * in, size_t const & len, uint16_t const bit_offset = 0) const {
+            if ((len << 3) < BIT_GROUP_SIZE) return bit_offset;
+            assert(len <= 32);
+            assert(((len << 3) % BIT_GROUP_SIZE) == 0);
+            assert(bit_offset == 0);
+
+            if (len == 32) {  // full 32 byte array, so directly load and store.
+              _mm256_storeu_si256((__m256i*)out, this->reverse( _mm256_loadu_si256((__m256i*)in) ));
+            } else {
+              // reversed bytes from outside len end up in the low bytes, so copy out only the high len bytes.
+              __m256i w = this->reverse( _mm256_loadu_si256((__m256i*)in) );
+              memcpy(out, reinterpret_cast<uint8_t*>(&w) + 32 - len, len);
+            }
+            return 0;
+          }
+
+          template <unsigned int BITS = BIT_GROUP_SIZE>
+          BITS_INLINE typename std::enable_if<(BITS < 8), __m256i>::type
+          reverse(__m256i const & u) const {
+            return _mm256_gf2p8affine_epi64_epi8(_mm256_permutexvar_epi8(rev_idx, u),
+                                                 _mm256_set1_epi64x(gf_matrix<BITS>()), 0);    // VBMI, GFNI
+          }
+
+          template <unsigned int BITS = BIT_GROUP_SIZE>
+          BITS_INLINE typename std::enable_if<(BITS >= 8) && (BITS < 256), __m256i>::type
+          reverse(__m256i const & u) const {
+            return _mm256_permutexvar_epi8(rev_idx, u);                                          // VBMI
+          }
+
+          /// bit_not(reverse(u)).  for bit groups smaller than a byte, the negation is the affine transform's constant.
+          template <unsigned int BITS = BIT_GROUP_SIZE>
+          BITS_INLINE typename std::enable_if<(BITS < 8), __m256i>::type
+          reverse_not(__m256i const & u) const {
+            return _mm256_gf2p8affine_epi64_epi8(_mm256_permutexvar_epi8(rev_idx, u),
+                                                 _mm256_set1_epi64x(gf_matrix<BITS>()), 0xFF);  // VBMI, GFNI
+          }
+
+          template <unsigned int BITS = BIT_GROUP_SIZE>
+          BITS_INLINE typename std::enable_if<(BITS >= 8) && (BITS < 256), __m256i>::type
+          reverse_not(__m256i const & u) const {
+            return bit_not(_mm256_permutexvar_epi8(rev_idx, u));
+          }
+
+          template <unsigned int BITS = BIT_GROUP_SIZE>
+          BITS_INLINE typename std::enable_if<(BITS < 8) && ((BITS & (BITS - 1)) == 0), __m256i>::type
+          reverse_bits_in_byte(__m256i const & u) const {
+            return _mm256_gf2p8affine_epi64_epi8(u, _mm256_set1_epi64x(gf_matrix<BITS>()), 0);   // GFNI
+          }
+
+      };
+      template <unsigned int BIT_GROUP_SIZE, bool POW2> const __m256i bitgroup_ops<BIT_GROUP_SIZE, BIT_REV_AVX512, POW2>::rev_idx =
+          bitgroup_ops<BIT_GROUP_SIZE, BIT_REV_AVX512, POW2>::make_rev_idx();
+
+
+      /**
+       * @brief partial template specialization for AVX512 based bit reverse in groups of 3 bits.
+       * @details  same steps as AVX2:  swap the high and low bit of each group, then reverse all bits.  the 2 bit shifts across
+       *           the 256 bits use valignq instead of the AVX2 lane permute, the ORs are merged by vpternlog, and the 1 bit reverse is
+       *           the AVX512 one.
+       */
+      template <bool POW2>
+      struct bitgroup_ops<3, BIT_REV_AVX512, POW2> {
+
+          static constexpr unsigned int bitsPerGroup = 3;
+          static constexpr unsigned char simd_type = BIT_REV_AVX512;
+
+          static constexpr uint8_t BLISS_ALIGNED_ARRAY(mask_all, 64, 32) = {0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+                                                                0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+                                                                0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+                                                                0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
+
+          bitgroup_ops<1, BIT_REV_AVX512, true> bit_rev_1;
+
+          static const __m256i mask3lo;
+          static const __m256i mask3mid;
+          static const __m256i mask3hi;
+
+
+          bitgroup_ops() {}
+
+
+          static ::std::string toString(__m256i const & v) {
+            uint8_t BLISS_ALIGNED_ARRAY(tmp, 32, 32);
+            _mm256_store_si256((__m256i*)tmp, v);
+            ::std::stringstream ss;
+            for (int i = 31; i >= 0; --i) {
+              ss << std::hex << std::setfill('0') << std::setw(2) << static_cast<size_t>(tmp[i]) << " ";
+            }
+            return ss.str();
+          }
+
+
+          /// reverse function to reverse bits for data types are are not __mm256i.  see the AVX2 version.
+          BITS_INLINE uint16_t reverse(uint8_t * out, uint8_t const * in, size_t const & len, uint16_t const bit_offset = 0) const {
+            if (len == 0) return bit_offset;
+            assert(len <= 32);
+            assert(bit_offset < 8);
+
+            __m256i v = _mm256_loadu_si256((__m256i*)in);
+
+            if (len < 32)  // reverse may involve bits outside of len, so zero them.
+              v = _mm256_and_si256(v, _mm256_loadu_si256((__m256i*)(mask_all + 32 - len)));
+
+            v = this->reverse( v, bit_offset );
+
+            // save the first and last byte, then copy the data back, finally OR the first and last byte back.
+            uint8_t first = out[0], last = out[len-1];
+
+            if (len == 32) {
+              _mm256_storeu_si256((__m256i*)out, v);
+            } else {
+              memcpy(out, reinterpret_cast<uint8_t*>(&v) + (32 - len), len);
+            }
+
+            out[0] |= first;
+            out[len-1] |= last;
+
+            // return remainder.
+            return ((len << 3) - bit_offset) % 3;
+          }
+
+          BITS_INLINE __m256i reverse(__m256i const & u, uint16_t bit_offset) const {
+            switch (bit_offset % 3) {
+              case 0: return reverse<0>(u); break;
+              case 1: return reverse<1>(u); break;
+              case 2: return reverse<2>(u); break;
+              default: return _mm256_setzero_si256();
+                break;
+            }
+          }
+
+          /// reverse in groups of 3 bits.  NOTE: within the offset or remainder, the middle bit remains,
+          /// while the high and low bits are zeroed during the reversal.  this makes OR'ing with adjacent
+          /// entries simple.
+          template <uint16_t offset = 0>
+          BITS_INLINE __m256i reverse(__m256i const & u) const {
+
+            __m256i lo = _mm256_and_si256(u, mask3lo);
+            __m256i mid = _mm256_and_si256(u, mask3mid);
+            __m256i hi = _mm256_and_si256(u, mask3hi);
+
+            // r is shifted right by 2 bits and l left by 2 bits, across the whole 256 bits.
+            __m256i r, l;
+            switch (offset % 3) {
+            case 2:
+              // rem == 2:                    mid, hi, lo
+              r = mid; l = hi; mid = lo;
+              break;
+            case 1:
+              // rem == 1:                    hi, lo, mid
+              r = lo; l = mid; mid = hi;
+              break;
+            default:
+              // rem == 0:  first 3 bits are: lo, mid, hi in order of significant bits
+              r = hi; l = lo;
+              break;
+            }
+
+            // valignq brings in the next (r) or previous (l) 64 bit word, for the bits that cross word boundaries.
+            __m256i z = _mm256_setzero_si256();
+            __m256i v = _mm256_ternarylogic_epi64(_mm256_srli_epi64(r, 2),
+                                                  _mm256_slli_epi64(_mm256_alignr_epi64(z, r, 1), 62),
+                                                  mid, 0xFE);                                     // a | b | c
+            v = _mm256_ternarylogic_epi64(v,
+                                          _mm256_slli_epi64(l, 2),
+                                          _mm256_srli_epi64(_mm256_alignr_epi64(l, z, 3), 62), 0xFE);
+
+            //========================== then reverse bits in groups of 1.
+            return bit_rev_1.reverse(v);
+          }
+
+      };
+      template <bool POW2> const __m256i bitgroup_ops<3, BIT_REV_AVX512, POW2>::mask3lo  =
+        _mm256_setr_epi32(0x49249249, 0x92492492, 0x24924924, 0x49249249, 0x92492492, 0x24924924, 0x49249249, 0x92492492);
+      template <bool POW2> const __m256i bitgroup_ops<3, BIT_REV_AVX512, POW2>::mask3mid =
+        _mm256_setr_epi32(0x92492492, 0x24924924, 0x49249249, 0x92492492, 0x24924924, 0x49249249, 0x92492492, 0x24924924);
+      template <bool POW2> const __m256i bitgroup_ops<3, BIT_REV_AVX512, POW2>::mask3hi  =
+        _mm256_setr_epi32(0x24924924, 0x49249249, 0x92492492, 0x24924924, 0x49249249, 0x92492492, 0x24924924, 0x49249249);
+      template <bool POW2> constexpr uint8_t bitgroup_ops<3, BIT_REV_AVX512, POW2>::BLISS_ALIGNED_ARRAY(mask_all, 64, 32);
+
+#endif
+
+#if defined(BLISS_BITREV_NEON)
+
+      /// shift right by number of bits.  NEON shifts do not cross the 64 bit lanes either,
+      /// so move the high lane down with 1 ext, then 2 shifts and 1 or.
+      template <>
+      BITS_INLINE uint8x16_t srli(uint8x16_t const & val, uint16_t shift) {
+        if (shift == 0) return val;
+        if (shift >= 128) return vdupq_n_u8(0);
+
+        // high 64 bits moved to the low lane, 0 in the high lane.
+        uint64x2_t tmp = vreinterpretq_u64_u8(vextq_u8(val, vdupq_n_u8(0), 8));
+
+        // ushl with a negative count is a right shift.
+        if (shift < 64)
+          return vreinterpretq_u8_u64(vorrq_u64(vshlq_u64(tmp, vdupq_n_s64(64 - shift)),
+                                                vshlq_u64(vreinterpretq_u64_u8(val), vdupq_n_s64(-static_cast<int64_t>(shift)))));
+        // 64 bit exactly
+        if (shift == 64) return vreinterpretq_u8_u64(tmp);
+
+        return vreinterpretq_u8_u64(vshlq_u64(tmp, vdupq_n_s64(64 - static_cast<int64_t>(shift))));
+      }
+      /// shift right by number of bits.  the shift counts are constants, so the runtime version folds.
+      template <uint16_t SHIFT>
+      BITS_INLINE uint8x16_t srli(uint8x16_t const & val) {
+        return srli(val, SHIFT);
+      }
+
+      /// shift left by number of bits.
+      template <>
+      BITS_INLINE uint8x16_t slli(uint8x16_t const & val, uint16_t shift) {
+        if (shift == 0) return val;
+        if (shift >= 128) return vdupq_n_u8(0);
+
+        // low 64 bits moved to the high lane, 0 in the low lane.
+        uint64x2_t tmp = vreinterpretq_u64_u8(vextq_u8(vdupq_n_u8(0), val, 8));
+
+        if (shift < 64)
+          return vreinterpretq_u8_u64(vorrq_u64(vshlq_u64(tmp, vdupq_n_s64(static_cast<int64_t>(shift) - 64)),
+                                                vshlq_u64(vreinterpretq_u64_u8(val), vdupq_n_s64(shift))));
+        // 64 bit exactly
+        if (shift == 64) return vreinterpretq_u8_u64(tmp);
+
+        return vreinterpretq_u8_u64(vshlq_u64(tmp, vdupq_n_s64(shift - 64)));
+      }
+      /// shift left by number of bits.
+      template <uint16_t SHIFT>
+      BITS_INLINE uint8x16_t slli(uint8x16_t const & val) {
+        return slli(val, SHIFT);
+      }
+
+
+      template <>
+      BITS_INLINE uint8x16_t bit_not(uint8x16_t const & u) {
+        return vmvnq_u8(u);
+      }
+
+      template <typename DEST_WORD_TYPE, typename WORD_TYPE>
+      BITS_INLINE typename ::std::enable_if<::std::is_same<DEST_WORD_TYPE, uint8x16_t>::value, uint8x16_t>::type
+      loadu(WORD_TYPE const * u) {
+        return vld1q_u8(reinterpret_cast<uint8_t const *>(u));
+      }
+      template <typename SRC_WORD_TYPE, typename WORD_TYPE,
+       typename = typename ::std::enable_if<::std::is_same<SRC_WORD_TYPE, uint8x16_t>::value>::type >
+      BITS_INLINE void storeu(WORD_TYPE * u, uint8x16_t const & val) {
+        vst1q_u8(reinterpret_cast<uint8_t *>(u), val);
+      }
+
+      template <>
+      BITS_INLINE uint8x16_t bit_or(uint8x16_t const & u, uint8x16_t const & v) {
+        return vorrq_u8(u, v);
+      }
+      template <>
+      BITS_INLINE uint8x16_t bit_and(uint8x16_t const & u, uint8x16_t const & v) {
+        return vandq_u8(u, v);
+      }
+      template <>
+      BITS_INLINE uint8x16_t bit_xor(uint8x16_t const & u, uint8x16_t const & v) {
+        return veorq_u8(u, v);
+      }
+
+      template <>
+      BITS_INLINE uint8x16_t zero() {
+        return vdupq_n_u8(0);
+      }
+      template <>
+      BITS_INLINE uint8x16_t bit_max() {
+        return vdupq_n_u8(0xFF);
+      }
+
+
+      /// partial template specialization for NEON based bit reverse.  defined only for bit_group_sizes that are powers of 2 up to 128bit.
+      /// the bytes are reversed with 1 table lookup (TBL), and the bits within bytes with RBIT plus at most 3 shift/select ops,
+      /// so no nibble lookup tables as in SSSE3.
+      template <unsigned int BIT_GROUP_SIZE, bool POW2>
+      struct bitgroup_ops<BIT_GROUP_SIZE, BIT_REV_NEON, POW2> {
+          static_assert(BIT_GROUP_SIZE > 0, "ERROR: BIT_GROUP_SIZE is 0");
+          static_assert(BIT_GROUP_SIZE <= 128, "ERROR: BIT_GROUP_SIZE is greater than number of bits in uint8x16_t");
+          static_assert((BIT_GROUP_SIZE & (BIT_GROUP_SIZE - 1)) == 0, "ERROR: BIT_GROUP_SIZE is has to be powers of 2");
+
+          static constexpr unsigned int bitsPerGroup = BIT_GROUP_SIZE;
+          static constexpr unsigned char simd_type = BIT_REV_NEON;
+
+          /// byte index for reversing the bit groups (1 byte for groups of 8 bits or less) with 1 TBL.
+          const uint8x16_t rev_idx;
+
+          /// output byte i comes from input byte 15 - i, with the byte order within a multibyte group kept.
+          static uint8x16_t make_rev_idx() {
+            constexpr uint8_t bytes_per_group = (BIT_GROUP_SIZE < 8) ? 1 : (BIT_GROUP_SIZE >> 3);
+            uint8_t idx[16];
+            for (uint8_t i = 0; i < 16; ++i) {
+              idx[i] = (15 - i) ^ (bytes_per_group - 1);
+            }
+            return vld1q_u8(idx);
+          }
+
+          static ::std::string toString(uint8x16_t const & v) {
+            uint8_t tmp[16];
+            vst1q_u8(tmp, v);
+            ::std::stringstream ss;
+            for (int i = 15; i >= 0; --i) {
+              ss << std::hex << std::setfill('0') << std::setw(2) << static_cast<size_t>(tmp[i]) << " ";
+            }
+            return ss.str();
+          }
+
+          bitgroup_ops() : rev_idx(make_rev_idx()) {}
+
+          /// reverse function to reverse bits for byte arrays up to 16 bytes.
+          BITS_INLINE uint16_t reverse(uint8_t * out, uint8_t const * in, size_t const & len, uint16_t const bit_offset = 0) const {
+            if ((len << 3) < BIT_GROUP_SIZE) return bit_offset; // throw ::std::invalid_argument("ERROR reversing byte array: length is 0");
+            assert ( len <= 16);
+            assert(((len << 3) % BIT_GROUP_SIZE) == 0);
+            assert(bit_offset == 0);
+
+            if (len == 16) { // full 16 byte array and BIT_GROUP_SIZE is power of 2, so directly load and store.
+              vst1q_u8(out, this->reverse(vld1q_u8(in)));
+            } else {
+              // not the full 16 bytes.  copy in and out through a buffer instead of reading past the end of in.
+              uint8_t tmp[16];
+              memcpy(tmp, in, len);
+              vst1q_u8(tmp, this->reverse(vld1q_u8(tmp)));
+              memcpy(out, tmp + 16 - len, len);
+            }
+            return 0;
+          }
+
+          template <unsigned int BITS = BIT_GROUP_SIZE>
+          BITS_INLINE typename std::enable_if<(BITS >= 128), uint8x16_t>::type
+          reverse(uint8x16_t const & u) const {
+            return u;
+          }
+
+          /// groups of less than 8 bits: 1 TBL to reverse the bytes, then reverse the groups within each byte.
+          template <unsigned int BITS = BIT_GROUP_SIZE>
+          BITS_INLINE typename std::enable_if<(BITS < 8), uint8x16_t>::type
+          reverse(uint8x16_t const & u) const {
+            return reverse_bits_in_byte(vqtbl1q_u8(u, rev_idx));
+          }
+
+          /// groups of 8, 16, 32, and 64 bits: 1 TBL.
+          template <unsigned int BITS = BIT_GROUP_SIZE>
+          BITS_INLINE typename std::enable_if<(BITS >= 8) && (BITS < 128), uint8x16_t>::type
+          reverse(uint8x16_t const & u) const {
+            return vqtbl1q_u8(u, rev_idx);
+          }
+
+          /// reverse the bit groups within each byte.
+          /// 1 bit: RBIT.  2 bits: RBIT, then swap adjacent bits with 2 shifts and 1 BSL.  4 bits: swap nibbles with 1 shift and 1 SLI.
+          template <unsigned int BITS = BIT_GROUP_SIZE>
+          BITS_INLINE typename std::enable_if<(BITS < 8) && ((BITS & (BITS - 1)) == 0), uint8x16_t>::type
+          reverse_bits_in_byte(uint8x16_t const & u) const {
+            switch (BIT_GROUP_SIZE) {
+              case 1:
+                return vrbitq_u8(u);
+              case 2:
+              {
+                uint8x16_t r = vrbitq_u8(u);
+                // high bit of each pair takes the low bit, and vice versa.
+                return vbslq_u8(vdupq_n_u8(0xAA), vshlq_n_u8(r, 1), vshrq_n_u8(r, 1));
+              }
+              case 4:
+                // (u << 4) | (u >> 4)
+                return vsliq_n_u8(vshrq_n_u8(u, 4), u, 4);
+              default:
+                return u;
+            }
+          }
+      };
+
+
+      /// partial template specialization for NEON based bit reverse in groups of 3.  same algorithm as SSSE3.
+      template <bool POW2>
+      struct bitgroup_ops<3, BIT_REV_NEON, POW2> {
+
+          static constexpr unsigned int bitsPerGroup = 3;
+          static constexpr unsigned char simd_type = BIT_REV_NEON;
+
+          const uint8x16_t mask3lo;
+          const uint8x16_t mask3mid;
+          const uint8x16_t mask3hi;
+
+          bitgroup_ops<1, BIT_REV_NEON, true> bit_rev_1;
+
+          static uint8x16_t make_mask(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+            uint32_t const m[4] = {a, b, c, d};
+            return vreinterpretq_u8_u32(vld1q_u32(m));
+          }
+
+          bitgroup_ops() :
+            mask3lo( make_mask(0x49249249, 0x92492492, 0x24924924, 0x49249249)),
+            mask3mid(make_mask(0x92492492, 0x24924924, 0x49249249, 0x92492492)),
+            mask3hi( make_mask(0x24924924, 0x49249249, 0x92492492, 0x24924924))
+          {}
+
+          static ::std::string toString(uint8x16_t const & v) {
+            return bitgroup_ops<1, BIT_REV_NEON, true>::toString(v);
+          }
+
+          /// reverse function to reverse bits for byte arrays up to 16 bytes.
+          BITS_INLINE uint16_t reverse(uint8_t * out, uint8_t const * in, size_t const & len, uint16_t const bit_offset = 0) const {
+            if (len == 0) return bit_offset; //throw ::std::invalid_argument("ERROR reversing byte array: length is 0");
+            assert (len <= 16);
+            // enforce bit_offset to be less than 8, since we are ORing the first and last bytes.
+            assert (bit_offset < 8);
+
+            // reverse may involve bits outside of len, so the part outside of len is zeroed.
+            uint8_t tmp[16] = {0};
+            memcpy(tmp, in, len);
+
+            uint8x16_t v = this->reverse( vld1q_u8(tmp) , bit_offset);
+
+            // save the first and last byte, then copy the data back, finally OR the first and last byte back.
+            uint8_t first = out[0], last = out[len-1];
+
+            if (len == 16) {
+              vst1q_u8(out, v);
+            } else {
+              vst1q_u8(tmp, v);
+              memcpy(out, tmp + (16 - len), len);
+            }
+
+            // or back the old values.
+            out[0] |= first;
+            out[len-1] |= last;
+
+            // return remainder.
+            return ((len << 3) - bit_offset) % 3;
+          }
+
+          BITS_INLINE uint8x16_t reverse(uint8x16_t const & u, uint16_t bit_offset) const {
+            switch (bit_offset % 3) {
+              case 0: return reverse<0>(u); break;
+              case 1: return reverse<1>(u); break;
+              case 2: return reverse<2>(u); break;
+              default: return vdupq_n_u8(0);
+                break;
+            }
+          }
+
+          /// reverse in groups of 3 bits.  NOTE: within the offset or remainder, the middle bit remains,
+          /// while the high and low bits are zeroed during the reversal.  this makes OR'ing with adjacent
+          /// entries simple.
+          template <uint16_t offset = 0>
+          BITS_INLINE uint8x16_t reverse(uint8x16_t const & u ) const {
+            // get the individual bits.  3 ANDs.
+            uint8x16_t lo = vandq_u8(u, mask3lo);
+            uint8x16_t mid = vandq_u8(u, mask3mid);
+            uint8x16_t hi = vandq_u8(u, mask3hi);
+
+            uint8x16_t v;
+            // next shift based on the rem bits.  2 cross boundary shifts, + 2 ORs.
+            switch (offset % 3) {
+              case 2:
+                // rem == 2:                    mid, hi, lo
+                v = vorrq_u8(srli<2>(mid), vorrq_u8(lo, slli<2>(hi)));
+                break;
+              case 1:
+                // rem == 1:                    hi, lo, mid
+                v = vorrq_u8(srli<2>(lo), vorrq_u8(hi, slli<2>(mid)));
+                break;
+              default:
+                // rem == 0:  first 3 bits are: lo, mid, hi in order of significant bits
+                v = vorrq_u8(srli<2>(hi), vorrq_u8(mid, slli<2>(lo)));
+                break;
+            }
+
+            //========================== then reverse bits in groups of 1.
+            return bit_rev_1.reverse(v);
+          }
+      };
+
+#endif
+
+      template <typename OP, typename WORD_TYPE>
+      BITS_INLINE auto reverse_not_impl(OP const & op, WORD_TYPE const & v, int) -> decltype(op.reverse_not(v)) {
+        return op.reverse_not(v);
+      }
+      template <typename OP, typename WORD_TYPE>
+      BITS_INLINE WORD_TYPE reverse_not_impl(OP const & op, WORD_TYPE const & v, long) {
+        return bit_not(op.reverse(v));
+      }
+      /// bit_not(op.reverse(v)), e.g. for DNA reverse complement.  in one step if op folds the negation into the reverse, as the AVX512 ops do.
+      template <typename OP, typename WORD_TYPE>
+      BITS_INLINE WORD_TYPE reverse_not(OP const & op, WORD_TYPE const & v) {
+        return reverse_not_impl(op, v, 0);
+      }
+
       /**
        * @brief dispatcher for different bitgroup_ops specializations.  determine the best SIMD_TYPE given the WORD_TYPE, NWORDS, and BIT_GROUP_SIZE
        * @details  requirements:  word type should be unsigned integral,  BIT_GROUP_SIZE should not be more than nbits.
@@ -2021,6 +2618,8 @@ template <unsigned int BIT_GROUP_SIZE, bool POW2> const __m256i bitgroup_ops<BIT
        *            BSWAP |       any        |    <= 8; pow2, 3  |      none        |
        *            SSSE3 |     > 64         |        pow2, 3    |   SSSE3, AVX2    |
        *            AVX2  |     > 128        |        pow2, 3    |      AVX2        |
+       *            AVX512|     > 128        |        pow2, 3    | AVX512 VL+VBMI, GFNI |
+       *            NEON  |     > 64         |        pow2, 3    |  aarch64 NEON    |
        *
        *    if the requirement is not satisfied, then it should fallback to next lowest.
        */
@@ -3114,6 +3713,114 @@ template <unsigned int BIT_GROUP_SIZE, bool POW2> const __m256i bitgroup_ops<BIT
 //
 
 
+#if defined(BLISS_BITREV_NEON)
+      /**
+       * @brief
+       * @details   enabled only if BIT_GROUP_SIZE is power of 2, and greater than 0.
+       * @param out
+       * @param in
+       * @param len      number of words.
+       * @param bit_offset
+       * @return
+       */
+      template <unsigned int BIT_GROUP_SIZE, unsigned char MAX_SIMD_TYPE, typename WORD_TYPE,
+          unsigned int WordsInNeon = sizeof(uint8x16_t) / sizeof(WORD_TYPE)>
+      BITS_INLINE typename std::enable_if<(MAX_SIMD_TYPE == BIT_REV_NEON) &&
+                                          ((BIT_GROUP_SIZE & (BIT_GROUP_SIZE - 1)) == 0), uint16_t>::type
+      reverse(WORD_TYPE * out, WORD_TYPE const * in, size_t const & len, uint16_t bit_offset = 0 ) {
+
+        static_assert(BIT_GROUP_SIZE > 0, "ERROR: BIT_GROUP_SIZE cannot be 0");
+        static_assert(BIT_GROUP_SIZE <= (sizeof(uint64_t) << 3), "ERROR: currenly reverse does not support 128 BIT_GRUOP_SIZE for NEON");
+
+        assert(bit_offset == 0);
+        assert(((len * sizeof(WORD_TYPE) << 3) / BIT_GROUP_SIZE) >= 1);
+
+        size_t rem = len;
+        // pointers
+        uint8_t * w = reinterpret_cast<uint8_t *>(out + len);
+        uint8_t const * u = reinterpret_cast<uint8_t const *>(in);
+
+        bitgroup_ops<BIT_GROUP_SIZE, BIT_REV_NEON> op128;
+
+        for (; rem >= WordsInNeon; rem -= WordsInNeon) {
+          // enough bytes.  do an iteration
+          w -= 16;
+          vst1q_u8(w, op128.reverse(vld1q_u8(u)));
+          u += 16;
+        }
+        if (rem > 0) {  // 0 < rem < WordsInNeon
+          if (len >= WordsInNeon) {  // original length has 16 bytes or more, so avoid memcpy.  duplicate a little work but that's okay.
+            vst1q_u8(reinterpret_cast<uint8_t *>(out),
+                     op128.reverse(vld1q_u8(reinterpret_cast<uint8_t const *>(in + len - WordsInNeon))));
+          } else {  // original length is less than 16 bytes.  let the byte array version copy in and out.
+            op128.reverse(reinterpret_cast<uint8_t *>(out), reinterpret_cast<uint8_t const *>(in), rem * sizeof(WORD_TYPE));
+          }
+        }
+
+        return 0;  // return remainder.
+      }
+
+      template <unsigned int BIT_GROUP_SIZE, unsigned char MAX_SIMD_TYPE, typename WORD_TYPE,
+          unsigned int WordsInNeon = sizeof(uint8x16_t) / sizeof(WORD_TYPE)>
+      BITS_INLINE typename std::enable_if<(MAX_SIMD_TYPE == BIT_REV_NEON) &&
+                                          (BIT_GROUP_SIZE == 3), uint16_t>::type
+      reverse(WORD_TYPE * out, WORD_TYPE const * in, size_t const & len, uint16_t bit_offset = 0 ) {
+
+        size_t bytes = len * sizeof(WORD_TYPE);
+
+        memset(out, 0, bytes);  // needed because we bitwise OR.
+
+        size_t rem = bytes;
+        // pointers
+        uint8_t * w = reinterpret_cast<uint8_t *>(out + len);
+        uint8_t const * u = reinterpret_cast<uint8_t const *>(in);
+        uint16_t init_offset = bit_offset;
+
+        bitgroup_ops<3, BIT_REV_NEON, false> op128;
+        for (; rem >= 16; rem -= 16) {
+
+          // enough bytes.  do an iteration
+          w -= 16;
+          bit_offset = op128.reverse(w, u, 16, bit_offset);
+          u += 16;
+
+          if ((rem > 16) && (bit_offset > 0)) {  // if there is overlap.  adjust
+            u -= 1;
+            rem += 1;
+            w += 1;
+            bit_offset = 8 - bit_offset;
+          } // else no adjustment is needed.
+        }
+        if (rem > 0) {
+          // do another iteration with all the remaining.
+          if (bytes >= 16) {
+            bit_offset = (((bytes - 16) << 3) - init_offset) % 3;
+            bit_offset = (bit_offset == 0) ? 0 : (BIT_GROUP_SIZE - bit_offset);
+            bit_offset = op128.reverse(reinterpret_cast<uint8_t *>(out),
+                                       reinterpret_cast<uint8_t const *>(in) + bytes - 16,
+                                       16, bit_offset);
+          } else {
+            bit_offset = op128.reverse(reinterpret_cast<uint8_t *>(out),
+                                       reinterpret_cast<uint8_t const *>(in) + bytes - rem,
+                                       rem, bit_offset);
+          }
+        }
+        return bit_offset;
+      }
+
+#else
+      template <unsigned int BIT_GROUP_SIZE, unsigned char MAX_SIMD_TYPE, typename WORD_TYPE,
+          unsigned int WordsInNeon = 16 / sizeof(WORD_TYPE)>
+      BITS_INLINE typename std::enable_if<(MAX_SIMD_TYPE == BIT_REV_NEON), uint16_t>::type
+      reverse(WORD_TYPE * out, WORD_TYPE const * in, size_t const & len, uint16_t bit_offset = 0 ) {
+        return reverse<BIT_GROUP_SIZE, BIT_REV_SWAR>(::std::forward<WORD_TYPE *>(out),
+                                                     ::std::forward<WORD_TYPE const *>(in),
+                                                      len,
+                                                      bit_offset);
+      }
+#endif
+
+
 #ifdef __SSSE3__
       /**
        * @brief
@@ -3241,7 +3948,8 @@ template <unsigned int BIT_GROUP_SIZE, bool POW2> const __m256i bitgroup_ops<BIT
           unsigned int WordsInM128 = 16 / sizeof(WORD_TYPE)>
       BITS_INLINE typename std::enable_if<(MAX_SIMD_TYPE == BIT_REV_SSSE3), uint16_t>::type
       reverse(WORD_TYPE * out, WORD_TYPE const * in, size_t const & len, uint16_t bit_offset = 0 ) {
-        return reverse<BIT_GROUP_SIZE, BIT_REV_SWAR>(::std::forward<WORD_TYPE *>(out),
+        // cascade to NEON, which cascades to SWAR if not on aarch64.
+        return reverse<BIT_GROUP_SIZE, BIT_REV_NEON>(::std::forward<WORD_TYPE *>(out),
                                                      ::std::forward<WORD_TYPE const *>(in),
                                                       len,
                                                       bit_offset);
@@ -3262,7 +3970,7 @@ template <unsigned int BIT_GROUP_SIZE, bool POW2> const __m256i bitgroup_ops<BIT
        */
       template <unsigned int BIT_GROUP_SIZE, unsigned char MAX_SIMD_TYPE, typename WORD_TYPE,
           unsigned int WordsInM256 = sizeof(__m256i) / sizeof(WORD_TYPE)>
-      BITS_INLINE typename std::enable_if<(MAX_SIMD_TYPE == BIT_REV_AVX2) &&
+      BITS_INLINE typename std::enable_if<((MAX_SIMD_TYPE == BIT_REV_AVX2) || (MAX_SIMD_TYPE == BIT_REV_AVX512)) &&
                                           ((BIT_GROUP_SIZE & (BIT_GROUP_SIZE - 1)) == 0), uint16_t>::type
       reverse(WORD_TYPE * out, WORD_TYPE const * in, size_t const & len, uint16_t bit_offset = 0 ) {
 
@@ -3285,7 +3993,7 @@ template <unsigned int BIT_GROUP_SIZE, bool POW2> const __m256i bitgroup_ops<BIT
         __m256i * w = reinterpret_cast<__m256i *>(out + len);
         __m256i const * u = reinterpret_cast<__m256i const *>(in);
 
-        bitgroup_ops<BIT_GROUP_SIZE, BIT_REV_AVX2> op256;
+        bitgroup_ops<BIT_GROUP_SIZE, ((MAX_SIMD_TYPE == BIT_REV_AVX512) ? BITREV_AVX512::SIMDVal : BIT_REV_AVX2)> op256;
 
 
         for (; rem >= WordsInM256; rem -= WordsInM256) {
@@ -3312,7 +4020,7 @@ template <unsigned int BIT_GROUP_SIZE, bool POW2> const __m256i bitgroup_ops<BIT
 
       template <unsigned int BIT_GROUP_SIZE, unsigned char MAX_SIMD_TYPE, typename WORD_TYPE,
           unsigned int WordsInM256 = sizeof(__m256i) / sizeof(WORD_TYPE)>
-      BITS_INLINE typename std::enable_if<(MAX_SIMD_TYPE == BIT_REV_AVX2) &&
+      BITS_INLINE typename std::enable_if<((MAX_SIMD_TYPE == BIT_REV_AVX2) || (MAX_SIMD_TYPE == BIT_REV_AVX512)) &&
                                           (BIT_GROUP_SIZE == 3), uint16_t>::type
       reverse(WORD_TYPE * out, WORD_TYPE const * in, size_t const & len, uint16_t bit_offset = 0 ) {
 
@@ -3329,7 +4037,7 @@ template <unsigned int BIT_GROUP_SIZE, bool POW2> const __m256i bitgroup_ops<BIT
         uint16_t init_offset = bit_offset;
 
 
-        bitgroup_ops<3, BIT_REV_AVX2, false> op256;
+        bitgroup_ops<3, ((MAX_SIMD_TYPE == BIT_REV_AVX512) ? BITREV_AVX512::SIMDVal : BIT_REV_AVX2), false> op256;
 
         for (; rem >= 32; rem -= 32) {
           // enough bytes.  do an iteration
@@ -3367,7 +4075,7 @@ template <unsigned int BIT_GROUP_SIZE, bool POW2> const __m256i bitgroup_ops<BIT
 #else
       template <unsigned int BIT_GROUP_SIZE, unsigned char MAX_SIMD_TYPE, typename WORD_TYPE,
           unsigned int WordsInM256 = 32 / sizeof(WORD_TYPE)>
-      BITS_INLINE typename std::enable_if<(MAX_SIMD_TYPE == BIT_REV_AVX2), uint16_t>::type
+      BITS_INLINE typename std::enable_if<(MAX_SIMD_TYPE == BIT_REV_AVX2) || (MAX_SIMD_TYPE == BIT_REV_AVX512), uint16_t>::type
       reverse(WORD_TYPE * out, WORD_TYPE const * in, size_t const & len, uint16_t bit_offset = 0 ) {
         // cascade to SSSE3 and let the choice of implementation be decided there.
         return reverse<BIT_GROUP_SIZE, BIT_REV_SSSE3>( ::std::forward<WORD_TYPE *>(out),
@@ -0,0 +1,325 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    comm_stats.hpp
+ * @ingroup
+ * @author  tpan
+ * @brief   communication volume counters for the all2all exchanges.
+ * @details each exchange is recorded under a label, prefixed by the enclosing scopes of the thread, e.g.
+ *          "find/distribute".  per label, the counters are the number of calls, bytes sent and received, the number
+ *          of non-empty destinations, the largest single message, and the largest per call skew (max / avg bytes per
+ *          destination).  report() reduces them across ranks, and write() exports them as JSON or CSV.
+ *
+ *          the BL_COMM_* macros compile to nothing unless BL_BENCHMARK_COMM is 1.
+ */
+#ifndef SRC_UTILS_COMM_STATS_HPP_
+#define SRC_UTILS_COMM_STATS_HPP_
+
+#include "bliss-logger_config.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <algorithm>
+#include <functional>
+#include <fstream>
+#include <sstream>
+
+#include <mpi.h>
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
+
+
+namespace plog {
+
+/// local counters for 1 label.
+struct comm_counters {
+    uint64_t calls;
+    uint64_t bytes_sent;
+    uint64_t bytes_recv;
+    /// number of non-empty sends, summed over calls.
+    uint64_t messages;
+    /// largest number of bytes sent to 1 destination in 1 call.
+    uint64_t max_message;
+    /// largest (max bytes to 1 destination) / (avg bytes per destination) of a call.  1 is perfectly even.
+    double max_skew;
+
+    comm_counters() : calls(0), bytes_sent(0), bytes_recv(0), messages(0), max_message(0), max_skew(0.0) {}
+};
+
+/// counters for 1 label, reduced across ranks.
+struct comm_summary {
+    std::string label;
+    int procs;
+    uint64_t calls;
+    double sent_min, sent_max, sent_mean;
+    double recv_min, recv_max, recv_mean;
+    /// sent_max / sent_mean.  large values point to ranks that send more than their share.
+    double imbalance;
+    /// total non-empty sends of all ranks.
+    uint64_t messages;
+    uint64_t max_message;
+    double max_skew;
+};
+
+/**
+ * @brief process wide communication counters.  thread safe.
+ */
+class CommStats {
+  protected:
+    std::map<std::string, comm_counters> counters;
+    std::vector<comm_summary> summaries;
+    mutable std::mutex mutex;
+
+    CommStats() {}
+
+    /// enclosing scope labels of this thread, innermost last.
+    static std::vector<std::string> & scopes() {
+      static thread_local std::vector<std::string> s;
+      return s;
+    }
+
+    static std::string escape(std::string const & str) {
+      std::string out;
+      for (char c : str) {
+        if (c == '"' || c == '\\') out.push_back('\\');
+        out.push_back(c);
+      }
+      return out;
+    }
+
+  public:
+    /// labels the exchanges recorded by this thread while in scope.
+    class scope {
+        scope(scope const & other) = delete;
+        scope & operator=(scope const & other) = delete;
+      public:
+        explicit scope(std::string const & label) {
+          std::vector<std::string> & s = scopes();
+          s.push_back(s.empty() ? label : (s.back() + "/" + label));
+        }
+        ~scope() {
+          scopes().pop_back();
+        }
+    };
+
+    static CommStats & get() {
+      static CommStats stats;
+      return stats;
+    }
+
+    /**
+     * @brief record 1 exchange.
+     * @param elem_size  bytes per element.
+     * @param send_counts  elements sent to each rank.
+     * @param recv_elements  total elements received.
+     */
+    template <typename SSIZE>
+    void record(std::string const & label, size_t elem_size,
+                std::vector<SSIZE> const & send_counts, size_t recv_elements) {
+      uint64_t sent = 0, msgs = 0, mx = 0;
+      for (auto c : send_counts) {
+        uint64_t b = static_cast<uint64_t>(c) * elem_size;
+        sent += b;
+        msgs += (c > 0) ? 1 : 0;
+        mx = std::max(mx, b);
+      }
+      double skew = (sent > 0) ? (static_cast<double>(mx) * send_counts.size() / static_cast<double>(sent)) : 0.0;
+
+      std::vector<std::string> const & s = scopes();
+      std::string key = s.empty() ? label : (s.back() + "/" + label);
+
+      std::lock_guard<std::mutex> lock(mutex);
+      comm_counters & c = counters[key];
+      ++c.calls;
+      c.bytes_sent += sent;
+      c.bytes_recv += static_cast<uint64_t>(recv_elements) * elem_size;
+      c.messages += msgs;
+      c.max_message = std::max(c.max_message, mx);
+      c.max_skew = std::max(c.max_skew, skew);
+    }
+
+    /// record 1 exchange, with the elements received from each rank.
+    template <typename SSIZE, typename RSIZE>
+    void record(std::string const & label, size_t elem_size,
+                std::vector<SSIZE> const & send_counts, std::vector<RSIZE> const & recv_counts) {
+      size_t recv = 0;
+      for (auto c : recv_counts) recv += c;
+      record(label, elem_size, send_counts, recv);
+    }
+
+    /// local counters, by label.
+    std::map<std::string, comm_counters> get_counters() const {
+      std::lock_guard<std::mutex> lock(mutex);
+      return counters;
+    }
+
+    /// reduced counters from the last report().  rank 0 only.
+    std::vector<comm_summary> get_summaries() const {
+      std::lock_guard<std::mutex> lock(mutex);
+      return summaries;
+    }
+
+    void reset() {
+      std::lock_guard<std::mutex> lock(mutex);
+      counters.clear();
+      summaries.clear();
+    }
+
+    /**
+     * @brief reduce the counters across ranks into summaries on rank 0.  collective.
+     * @details  uses the labels of rank 0.  labels that only other ranks have are not reported.
+     */
+    void report(::mxx::comm const & comm) {
+      std::map<std::string, comm_counters> local = get_counters();
+
+      // labels of rank 0, newline separated.
+      std::string labels;
+      if (comm.rank() == 0) {
+        for (auto const & c : local) labels.append(c.first).push_back('\n');
+      }
+      unsigned long len = labels.size();
+      MPI_Bcast(&len, 1, MPI_UNSIGNED_LONG, 0, comm);
+      labels.resize(len);
+      if (len > 0) MPI_Bcast(&(labels[0]), len, MPI_CHAR, 0, comm);
+
+      std::vector<std::string> keys;
+      std::istringstream iss(labels);
+      for (std::string l; std::getline(iss, l); ) keys.push_back(l);
+
+      std::vector<double> sent, recv, msgs, mx, skew;
+      for (auto const & k : keys) {
+        auto it = local.find(k);
+        comm_counters c = (it == local.end()) ? comm_counters() : it->second;
+        sent.push_back(c.bytes_sent);
+        recv.push_back(c.bytes_recv);
+        msgs.push_back(c.messages);
+        mx.push_back(c.max_message);
+        skew.push_back(c.max_skew);
+      }
+
+      std::vector<comm_summary> result;
+      if (keys.size() > 0) {
+        auto min_op = [](double const & x, double const & y) { return ::std::min(x, y); };
+        auto max_op = [](double const & x, double const & y) { return ::std::max(x, y); };
+        std::vector<double> sent_min = ::mxx::reduce(sent, 0, min_op, comm);
+        std::vector<double> sent_max = ::mxx::reduce(sent, 0, max_op, comm);
+        std::vector<double> sent_sum = ::mxx::reduce(sent, 0, ::std::plus<double>(), comm);
+        std::vector<double> recv_min = ::mxx::reduce(recv, 0, min_op, comm);
+        std::vector<double> recv_max = ::mxx::reduce(recv, 0, max_op, comm);
+        std::vector<double> recv_sum = ::mxx::reduce(recv, 0, ::std::plus<double>(), comm);
+        std::vector<double> msgs_sum = ::mxx::reduce(msgs, 0, ::std::plus<double>(), comm);
+        std::vector<double> mx_max = ::mxx::reduce(mx, 0, max_op, comm);
+        std::vector<double> skew_max = ::mxx::reduce(skew, 0, max_op, comm);
+
+        if (comm.rank() == 0) {
+          int p = comm.size();
+          for (size_t i = 0; i < keys.size(); ++i) {
+            comm_summary s;
+            s.label = keys[i];
+            s.procs = p;
+            s.calls = local[keys[i]].calls;
+            s.sent_min = sent_min[i];
+            s.sent_max = sent_max[i];
+            s.sent_mean = sent_sum[i] / p;
+            s.recv_min = recv_min[i];
+            s.recv_max = recv_max[i];
+            s.recv_mean = recv_sum[i] / p;
+            s.imbalance = (s.sent_mean > 0.0) ? (s.sent_max / s.sent_mean) : 1.0;
+            s.messages = static_cast<uint64_t>(msgs_sum[i]);
+            s.max_message = static_cast<uint64_t>(mx_max[i]);
+            s.max_skew = skew_max[i];
+            result.push_back(s);
+          }
+        }
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      summaries.swap(result);
+    }
+
+    void write_json(std::ostream & os) const {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::ostringstream out;
+      out.precision(6);
+      out << std::fixed << "[" << std::endl;
+      for (size_t i = 0; i < summaries.size(); ++i) {
+        comm_summary const & s = summaries[i];
+        out << "  {\"label\": \"" << escape(s.label) << "\", \"procs\": " << s.procs << ", \"calls\": " << s.calls <<
+            ", \"sent_min\": " << s.sent_min << ", \"sent_max\": " << s.sent_max << ", \"sent_mean\": " << s.sent_mean <<
+            ", \"recv_min\": " << s.recv_min << ", \"recv_max\": " << s.recv_max << ", \"recv_mean\": " << s.recv_mean <<
+            ", \"imbalance\": " << s.imbalance << ", \"messages\": " << s.messages <<
+            ", \"max_message\": " << s.max_message << ", \"max_skew\": " << s.max_skew <<
+            "}" << (i + 1 < summaries.size() ? "," : "") << std::endl;
+      }
+      out << "]" << std::endl;
+      os << out.str();
+    }
+
+    void write_csv(std::ostream & os) const {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::ostringstream out;
+      out.precision(6);
+      out << std::fixed << "label,procs,calls,sent_min,sent_max,sent_mean,recv_min,recv_max,recv_mean,imbalance,messages,max_message,max_skew" << std::endl;
+      for (auto const & s : summaries) {
+        out << "\"" << s.label << "\"," << s.procs << "," << s.calls << "," <<
+            s.sent_min << "," << s.sent_max << "," << s.sent_mean << "," <<
+            s.recv_min << "," << s.recv_max << "," << s.recv_mean << "," <<
+            s.imbalance << "," << s.messages << "," << s.max_message << "," << s.max_skew << std::endl;
+      }
+      os << out.str();
+    }
+
+    /// write the summaries to file, as CSV if the name ends with ".csv", else as JSON.
+    void write(std::string const & filename) const {
+      std::ofstream ofs(filename);
+      if (!ofs.is_open()) {
+        fprintf(stderr, "ERROR: cannot open communication stats output file %s\n", filename.c_str());
+        return;
+      }
+      if (filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".csv") == 0) write_csv(ofs);
+      else write_json(ofs);
+    }
+};
+
+} // end namespace plog
+
+
+#if BL_BENCHMARK_COMM == 1
+
+#define BL_COMM_SCOPE(label)    ::plog::CommStats::scope label##_comm_scope(#label);
+// recv_counts is a vector of per-rank counts, or the total number of elements received.
+#define BL_COMM_RECORD(label, elem_size, send_counts, recv_counts) \
+  do { ::plog::CommStats::get().record(label, elem_size, send_counts, recv_counts); } while (0)
+#define BL_COMM_RESET()         do { ::plog::CommStats::get().reset(); } while (0)
+// reduce across ranks, then write on rank 0.  collective.
+#define BL_COMM_EXPORT(filename, comm) \
+  do { ::plog::CommStats::get().report(comm); if (comm.rank() == 0) ::plog::CommStats::get().write(filename); } while (0)
+
+#else
+
+#define BL_COMM_SCOPE(label)
+#define BL_COMM_RECORD(label, elem_size, send_counts, recv_counts)
+#define BL_COMM_RESET()
+#define BL_COMM_EXPORT(filename, comm)
+
+#endif
+
+#endif /* SRC_UTILS_COMM_STATS_HPP_ */
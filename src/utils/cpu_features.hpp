@@ -0,0 +1,197 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    cpu_features.hpp
+ * @ingroup utils
+ * @author  tpan
+ * @brief   runtime detection of the SIMD instruction sets of the CPU, for runtime dispatch of SIMD kernels.
+ * @details the SIMD kernels are normally chosen at compile time from the -march flags (__AVX2__ etc).
+ *          when built with BLISS_SIMD_DISPATCH (cmake USE_SIMD_RUNTIME_DISPATCH) for a baseline x86-64 target,
+ *          the array level kernels (DNA encoding, batched reverse complement and canonicalization, batched mix hash,
+ *          the small sort network) are compiled with per function target attributes instead, and one is picked per
+ *          call from cpuid, so one binary runs the best path on each node of a heterogeneous cluster.
+ *
+ *          the has_* functions are constant true for instruction sets enabled at compile time, so a -march=native
+ *          build has no runtime checks.
+ *
+ *          the BLISS_SIMD_MAX environment variable caps the detected instruction sets:
+ *          scalar, ssse3, sse4.2, avx2, or avx512.  for testing the fallback paths on a newer CPU.
+ *
+ *          only kernels that produce the same values on every path are dispatched at runtime.  choices that change
+ *          values or layout, e.g. DistHashHW (CRC32C vs multiply-shift) or the group_hash_map group width,
+ *          stay compile time so that all processes agree.
+ */
+#ifndef SRC_UTILS_CPU_FEATURES_HPP_
+#define SRC_UTILS_CPU_FEATURES_HPP_
+
+#include <cstdint>
+#include <cstdlib>   // getenv
+#include <cstring>   // strcmp
+#include <string>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <cpuid.h>
+#define BLISS_CPUID_X86
+#endif
+
+#if defined(BLISS_SIMD_DISPATCH) && defined(BLISS_CPUID_X86)
+// all intrinsics are declared regardless of -m flags.  they can be used in functions with the matching target attribute.
+#include <x86intrin.h>
+#define BLISS_SIMD_DISPATCH_X86
+#define BLISS_TARGET(isa) __attribute__((target(isa)))
+#else
+#define BLISS_TARGET(isa)
+#endif
+
+namespace bliss {
+
+  namespace utils {
+
+    namespace cpu {
+
+      /// SIMD instruction sets supported by the CPU and enabled by the OS.
+      struct features {
+          bool ssse3 = false;
+          bool sse42 = false;
+          bool avx2 = false;
+          bool avx512f = false;
+          bool avx512dq = false;
+          bool avx512bw = false;
+          bool avx512vl = false;
+          bool avx512vbmi = false;
+          bool gfni = false;
+
+          ::std::string toString() const {
+            ::std::string s;
+            if (ssse3) s += "ssse3 ";
+            if (sse42) s += "sse4.2 ";
+            if (avx2) s += "avx2 ";
+            if (avx512f) s += "avx512f ";
+            if (avx512dq) s += "avx512dq ";
+            if (avx512bw) s += "avx512bw ";
+            if (avx512vl) s += "avx512vl ";
+            if (avx512vbmi) s += "avx512vbmi ";
+            if (gfni) s += "gfni ";
+            return s.empty() ? ::std::string("scalar") : s.substr(0, s.size() - 1);
+          }
+      };
+
+      namespace detail {
+
+        /// clear the instruction sets above max (scalar, ssse3, sse4.2, avx2, avx512).  unknown names leave f unchanged.
+        inline void cap(features & f, char const * max) {
+          int level;
+          if ((strcmp(max, "scalar") == 0) || (strcmp(max, "none") == 0)) level = 0;
+          else if (strcmp(max, "ssse3") == 0) level = 1;
+          else if (strcmp(max, "sse4.2") == 0) level = 2;
+          else if (strcmp(max, "avx2") == 0) level = 3;
+          else return;
+
+          if (level < 1) f.ssse3 = false;
+          if (level < 2) f.sse42 = false;
+          if (level < 3) f.avx2 = false;
+          f.avx512f = f.avx512dq = f.avx512bw = f.avx512vl = f.avx512vbmi = f.gfni = false;
+        }
+
+#if defined(BLISS_CPUID_X86)
+        /// XCR0, the register states the OS saves on context switch.  inline asm, since _xgetbv needs -mxsave.
+        inline uint64_t xgetbv0() {
+          uint32_t lo, hi;
+          __asm__ __volatile__ ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+          return (static_cast<uint64_t>(hi) << 32) | lo;
+        }
+#endif
+
+        inline features detect() {
+          features f;
+#if defined(BLISS_CPUID_X86)
+          unsigned int eax, ebx, ecx, edx;
+          if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+            f.ssse3 = (ecx >> 9) & 1;
+            f.sse42 = (ecx >> 20) & 1;
+            bool avx = (ecx >> 28) & 1;
+            // YMM (bits 1, 2) and ZMM (bits 5, 6, 7) state has to be enabled by the OS as well.
+            uint64_t xcr0 = ((ecx >> 27) & 1) ? xgetbv0() : 0;
+            bool os_ymm = (xcr0 & 0x06) == 0x06;
+            bool os_zmm = (xcr0 & 0xE6) == 0xE6;
+
+            if (__get_cpuid_max(0, nullptr) >= 7) {
+              __cpuid_count(7, 0, eax, ebx, ecx, edx);
+              f.avx2 = avx && os_ymm && ((ebx >> 5) & 1);
+              f.avx512f = os_zmm && ((ebx >> 16) & 1);
+              f.avx512dq = f.avx512f && ((ebx >> 17) & 1);
+              f.avx512bw = f.avx512f && ((ebx >> 30) & 1);
+              f.avx512vl = f.avx512f && ((ebx >> 31) & 1);
+              f.avx512vbmi = f.avx512f && ((ecx >> 1) & 1);
+              f.gfni = (ecx >> 8) & 1;
+            }
+          }
+#endif
+          char const * max = getenv("BLISS_SIMD_MAX");
+          if (max != nullptr) cap(f, max);
+          return f;
+        }
+
+      } // namespace detail
+
+      /// features of the CPU running this process.  detected once.
+      inline features const & get_features() {
+        static features const f = detail::detect();
+        return f;
+      }
+
+      inline bool has_ssse3() {
+#if defined(__SSSE3__)
+        return true;
+#else
+        return get_features().ssse3;
+#endif
+      }
+
+      inline bool has_avx2() {
+#if defined(__AVX2__)
+        return true;
+#else
+        return get_features().avx2;
+#endif
+      }
+
+      /// AVX512 foundation.
+      inline bool has_avx512f() {
+#if defined(__AVX512F__)
+        return true;
+#else
+        return get_features().avx512f;
+#endif
+      }
+
+      /// AVX512 foundation and 64 bit multiply (DQ).
+      inline bool has_avx512dq() {
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+        return true;
+#else
+        return get_features().avx512dq;
+#endif
+      }
+
+    } // namespace cpu
+
+  } // namespace utils
+
+} // namespace bliss
+
+#endif /* SRC_UTILS_CPU_FEATURES_HPP_ */
@@ -0,0 +1,271 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    event_trace.hpp
+ * @ingroup
+ * @author  tpan
+ * @brief   timeline of begin/end events per rank and thread, exported as Chrome trace JSON.
+ * @details the timers report totals per phase.  to see how io, parsing, bucketing, all2all and insert overlap across
+ *          ranks, each timed section is also recorded as 1 event with its start time and duration, tagged with the
+ *          rank and thread.  the file loads in chrome://tracing and in the Perfetto UI (ui.perfetto.dev), which
+ *          reads the Chrome JSON format directly.  ranks are processes (pid), threads are tid.
+ *
+ *          events come from the BL_BENCH / BL_TIMER start-end sections (timer.hpp), including the imxx collectives,
+ *          and from BL_TRACE_SCOPE(name).  the category of a timer event is the timer's scope path.
+ *
+ *          each thread appends to its own buffer, without locks.  the buffer is capped (BLISS_TRACE_MAX_EVENTS,
+ *          default 1M events per thread), and the events can be sampled (BLISS_TRACE_SAMPLE=N keeps every Nth section
+ *          of a thread).  events over the cap are counted as dropped.  write the trace after the parallel regions.
+ *
+ *          BL_TRACE_SYNC(comm) aligns the time origin of the ranks with a barrier.  call it after MPI init.
+ *          BL_TRACE_EXPORT(filename, comm) gathers all ranks into 1 file on rank 0.  collective.
+ *
+ *          the BL_TRACE_* macros compile to nothing unless BL_BENCHMARK_TRACE is 1.
+ */
+#ifndef SRC_UTILS_EVENT_TRACE_HPP_
+#define SRC_UTILS_EVENT_TRACE_HPP_
+
+#include "bliss-logger_config.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+
+
+namespace plog {
+
+/// 1 complete event:  a section with start time and duration.
+struct trace_event {
+    /// ns since the trace origin.
+    uint64_t ts;
+    uint64_t dur;
+    std::string name;
+    std::string cat;
+};
+
+/**
+ * @brief process wide event trace.
+ * @details  the per thread buffers are owned by the trace, so events of exited threads are kept.
+ */
+class EventTrace {
+  protected:
+    struct thread_buffer {
+        std::vector<trace_event> events;
+        uint32_t tid;
+        uint64_t seen;
+        uint64_t dropped;
+
+        explicit thread_buffer(uint32_t _tid) : tid(_tid), seen(0), dropped(0) {}
+    };
+
+    std::vector<std::shared_ptr<thread_buffer> > buffers;
+    mutable std::mutex mutex;    // buffers registry only.
+
+    std::chrono::steady_clock::time_point origin;
+    int rank;
+    uint64_t sample;
+    size_t max_events;
+
+    EventTrace() : origin(std::chrono::steady_clock::now()), rank(0), sample(1), max_events(1UL << 20) {
+      char const * s = getenv("BLISS_TRACE_SAMPLE");
+      if ((s != nullptr) && (atol(s) > 1)) sample = atol(s);
+      s = getenv("BLISS_TRACE_MAX_EVENTS");
+      if ((s != nullptr) && (atol(s) > 0)) max_events = atol(s);
+    }
+
+    /// this thread's buffer.  registered on first use.
+    thread_buffer & local() {
+      static thread_local std::shared_ptr<thread_buffer> b;
+      if (!b) {
+        std::lock_guard<std::mutex> lock(mutex);
+        b = std::make_shared<thread_buffer>(buffers.size());
+        buffers.push_back(b);
+      }
+      return *b;
+    }
+
+    static std::string escape(std::string const & str) {
+      std::string out;
+      for (char c : str) {
+        if (c == '"' || c == '\\') out.push_back('\\');
+        out.push_back(c);
+      }
+      return out;
+    }
+
+    uint64_t since_origin(std::chrono::steady_clock::time_point const & t) const {
+      return (t < origin) ? 0 :
+          std::chrono::duration_cast<std::chrono::nanoseconds>(t - origin).count();
+    }
+
+  public:
+    /// records a section from construction to destruction.
+    class scope {
+        scope(scope const & other) = delete;
+        scope & operator=(scope const & other) = delete;
+        char const * name;
+        std::chrono::steady_clock::time_point t1;
+      public:
+        explicit scope(char const * _name) : name(_name), t1(std::chrono::steady_clock::now()) {}
+        ~scope() {
+          EventTrace::get().complete(name, "scope", t1, std::chrono::steady_clock::now());
+        }
+    };
+
+    static EventTrace & get() {
+      static EventTrace trace;
+      return trace;
+    }
+
+    /// every n-th section of a thread is kept.  1 keeps all.
+    void set_sample(uint64_t n) { sample = (n < 1) ? 1 : n; }
+    /// cap on the number of events per thread.
+    void set_max_events(size_t n) { max_events = n; }
+
+    /// set the rank and a common time origin.  collective.
+    void sync(::mxx::comm const & comm) {
+      rank = comm.rank();
+      comm.barrier();
+      origin = std::chrono::steady_clock::now();
+    }
+
+    /// record the section [t1, t2) of the calling thread, subject to sampling and the cap.
+    void complete(std::string const & name, std::string const & cat,
+                  std::chrono::steady_clock::time_point const & t1, std::chrono::steady_clock::time_point const & t2) {
+      thread_buffer & b = local();
+      if ((b.seen++ % sample) != 0) return;
+      if (b.events.size() >= max_events) {
+        ++b.dropped;
+        return;
+      }
+      trace_event e;
+      e.ts = since_origin(t1);
+      e.dur = (t2 < t1) ? 0 : std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
+      e.name = name;
+      e.cat = cat;
+      b.events.push_back(std::move(e));
+    }
+
+    /// all events of this process.  not synchronized with threads that are still recording.
+    std::vector<trace_event> get_events() const {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::vector<trace_event> out;
+      for (auto const & b : buffers) out.insert(out.end(), b->events.begin(), b->events.end());
+      return out;
+    }
+
+    uint64_t get_dropped() const {
+      std::lock_guard<std::mutex> lock(mutex);
+      uint64_t d = 0;
+      for (auto const & b : buffers) d += b->dropped;
+      return d;
+    }
+
+    void reset() {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto & b : buffers) {
+        b->events.clear();
+        b->seen = 0;
+        b->dropped = 0;
+      }
+    }
+
+    /// this process's events as Chrome trace events, 1 per line, each followed by ",".  timestamps in us.
+    void write_events(std::ostream & os) const {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::ostringstream out;
+      out.precision(3);
+      out << std::fixed;
+      out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << rank <<
+          ", \"args\": {\"name\": \"rank " << rank << "\"}}," << std::endl;
+      for (auto const & b : buffers) {
+        out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << rank << ", \"tid\": " << b->tid <<
+            ", \"args\": {\"name\": \"thread " << b->tid << "\"}}," << std::endl;
+        if (b->dropped > 0) {
+          out << "{\"name\": \"dropped " << b->dropped << " events\", \"ph\": \"i\", \"s\": \"t\", \"ts\": 0, \"pid\": " <<
+              rank << ", \"tid\": " << b->tid << "}," << std::endl;
+        }
+        for (auto const & e : b->events) {
+          out << "{\"name\": \"" << escape(e.name) << "\", \"cat\": \"" << escape(e.cat) <<
+              "\", \"ph\": \"X\", \"ts\": " << (e.ts * 1e-3) << ", \"dur\": " << (e.dur * 1e-3) <<
+              ", \"pid\": " << rank << ", \"tid\": " << b->tid << "}," << std::endl;
+        }
+      }
+      os << out.str();
+    }
+
+    /// write a complete trace file from the given events (as from write_events).
+    static void write_file(std::string const & filename, std::string const & events) {
+      std::ofstream ofs(filename);
+      if (!ofs.is_open()) {
+        fprintf(stderr, "ERROR: cannot open trace output file %s\n", filename.c_str());
+        return;
+      }
+      // drop the last ",".
+      size_t end = events.find_last_of(',');
+      ofs << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << std::endl <<
+          ((end == std::string::npos) ? std::string() : events.substr(0, end)) << std::endl << "]}" << std::endl;
+    }
+
+    /// write this process's trace to file.
+    void write(std::string const & filename) const {
+      std::ostringstream out;
+      write_events(out);
+      write_file(filename, out.str());
+    }
+
+    /// gather the traces of all ranks, and write them to file on rank 0.  collective.
+    void write(std::string const & filename, ::mxx::comm const & comm) const {
+      std::ostringstream out;
+      write_events(out);
+      std::string s = out.str();
+      std::vector<char> mine(s.begin(), s.end());
+      std::vector<char> all = ::mxx::gatherv(mine, 0, comm);
+      if (comm.rank() == 0) write_file(filename, std::string(all.begin(), all.end()));
+    }
+};
+
+} // end namespace plog
+
+
+#if BL_BENCHMARK_TRACE == 1
+
+#define BL_TRACE_SCOPE(name)            ::plog::EventTrace::scope name##_trace_scope(#name);
+#define BL_TRACE_SYNC(comm)             do { ::plog::EventTrace::get().sync(comm); } while (0)
+#define BL_TRACE_RESET()                do { ::plog::EventTrace::get().reset(); } while (0)
+#define BL_TRACE_EXPORT(filename, comm) do { ::plog::EventTrace::get().write(filename, comm); } while (0)
+
+#else
+
+#define BL_TRACE_SCOPE(name)
+#define BL_TRACE_SYNC(comm)
+#define BL_TRACE_RESET()
+#define BL_TRACE_EXPORT(filename, comm)
+
+#endif
+
+#endif /* SRC_UTILS_EVENT_TRACE_HPP_ */
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    gbenchmark_main.cpp
+ * @ingroup utils
+ * @author  tpan
+ * @brief   main for the google benchmark targets (bliss_add_gbenchmark), in place of benchmark_main.
+ * @details applies the BLISS_BENCH_* settings of bench_env.hpp before any benchmark runs, and records them, with the
+ *          cpu frequency governor, in the context of the report, so that a baseline and a new run can be checked
+ *          for the same conditions.  per run cache flushing is done by the benchmarks' Setup hooks, with flush_if_enabled.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <fstream>
+#include <string>
+
+#include "utils/bench_env.hpp"
+
+int main(int argc, char** argv) {
+  ::bliss::utils::bench::env e = ::bliss::utils::bench::env::from_environment();
+  std::string desc = ::bliss::utils::bench::prepare(e);
+
+  ::benchmark::AddCustomContext("bliss_bench_env", desc);
+  std::ifstream gov("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor");
+  std::string governor;
+  if (gov >> governor) ::benchmark::AddCustomContext("cpu_governor", governor);
+
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  ::benchmark::RunSpecifiedBenchmarks();
+  ::benchmark::Shutdown();
+  return 0;
+}
@@ -98,6 +98,8 @@
 #define BLISS_LOGGING_BOOST_CUSTOM   4
 // using printf
 #define BLISS_LOGGING_PRINTF         5
+// per thread lock-free rings, formatted and written by a background thread (utils/async_logger.hpp)
+#define BLISS_LOGGING_ASYNC          6
 
 /// logger verbosity.  these are listed in increasing verbosity. each level include all before it.
 #define BLISS_LOGGER_VERBOSITY_FATAL   0
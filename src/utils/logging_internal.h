@@ -119,6 +119,28 @@
 
 
 
+/*********************************************************************
+ *          asynchronous logging via per thread lock-free rings      *
+ *********************************************************************/
+
+#elif USE_LOGGER == BLISS_LOGGING_ASYNC
+
+// thread safe.  the calling thread only copies the message into its own ring.  see utils/async_logger.hpp
+#include "utils/async_logger.hpp"
+
+#define BLISS_ASYNC_PRINT(level, msg) do { std::ostringstream& ss = ::bliss::log::async::thread_stream(); ss << msg; \
+    ::bliss::log::async::log_stream(level, ss); } while (false)
+
+#define PRINT_FATAL(msg)    do { BLISS_ASYNC_PRINT(::bliss::log::async::FATAL, msg); ::bliss::log::async::flush(); exit(EXIT_FAILURE); } while (false)
+#define PRINT_ERROR(msg)    BLISS_ASYNC_PRINT(::bliss::log::async::ERROR, msg)
+#define PRINT_WARNING(msg)  BLISS_ASYNC_PRINT(::bliss::log::async::WARNING, msg)
+#define PRINT_INFO(msg)     BLISS_ASYNC_PRINT(::bliss::log::async::INFO, msg)
+#define PRINT_DEBUG(msg)    BLISS_ASYNC_PRINT(::bliss::log::async::DEBUG, msg)
+#define PRINT_TRACE(msg)    BLISS_ASYNC_PRINT(::bliss::log::async::TRACE, msg)
+
+#define LOG_INIT() ::bliss::log::async::init()
+
+
 /*********************************************************************
  *                      use boost::log::trivial                      *
  *********************************************************************/
@@ -306,6 +328,19 @@ void init()
 #define PRINT_DEBUGF(msg, ...)   do { printf("[debug] " msg "\n", ##__VA_ARGS__); } while (false)
 #define PRINT_TRACEF(msg, ...)   do { printf("[trace] " msg "\n", ##__VA_ARGS__); } while (false)
 
+#elif USE_LOGGER == BLISS_LOGGING_ASYNC
+
+// the "if (false) printf" is never executed, but keeps the compiler's format checks.
+#define BLISS_ASYNC_PRINTF(level, msg, ...) do { if (false) printf(msg, ##__VA_ARGS__); \
+    ::bliss::log::async::logf(level, msg, ##__VA_ARGS__); } while (false)
+
+#define PRINT_FATALF(msg, ...)   do { BLISS_ASYNC_PRINTF(::bliss::log::async::FATAL, msg, ##__VA_ARGS__); ::bliss::log::async::flush(); exit(EXIT_FAILURE); } while (false)
+#define PRINT_ERRORF(msg, ...)   BLISS_ASYNC_PRINTF(::bliss::log::async::ERROR, msg, ##__VA_ARGS__)
+#define PRINT_WARNINGF(msg, ...) BLISS_ASYNC_PRINTF(::bliss::log::async::WARNING, msg, ##__VA_ARGS__)
+#define PRINT_INFOF(msg, ...)    BLISS_ASYNC_PRINTF(::bliss::log::async::INFO, msg, ##__VA_ARGS__)
+#define PRINT_DEBUGF(msg, ...)   BLISS_ASYNC_PRINTF(::bliss::log::async::DEBUG, msg, ##__VA_ARGS__)
+#define PRINT_TRACEF(msg, ...)   BLISS_ASYNC_PRINTF(::bliss::log::async::TRACE, msg, ##__VA_ARGS__)
+
 
 #else
 #define BLISS_SPRINTF_BUFFER_SIZE 256
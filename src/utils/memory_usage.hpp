@@ -20,6 +20,8 @@
  * @author  tpan
  * @brief   functions to track memory usage during program execution (for marked functional blocks)
  * @details each "mark" call snapshots the current memory usage and peak memory usage.
+ *          it also snapshots the exact bytes held by containers using plog::tracking_allocator, per tag:
+ *          the current bytes, and the peak bytes since the previous mark (or since construction).
  *          relies on http://nadeausoftware.com/articles/2012/07/c_c_tip_how_get_process_resident_set_size_physical_memory_use#GetProcessMemoryInfonbspforpeakandcurrentresidentsetsize
  *
  *          also see http://www.linuxatemyram.com/play.html and
@@ -45,11 +47,14 @@
 #include <string>
 #include <algorithm>  // std::min
 #include <sstream>
+#include <iterator>  // ostream_iterator
 #include <cmath>  // std::sqrt
 
 #include <io/io_exception.hpp>
 #include <mxx/reduction.hpp>
 
+#include "utils/tracking_allocator.hpp"
+
 //http://nadeausoftware.com/articles/2012/07/c_c_tip_how_get_process_resident_set_size_physical_memory_use#GetProcessMemoryInfonbspforpeakandcurrentresidentsetsize
 // note:  reports in bytes.
 #include "getRSS.h"
@@ -113,8 +118,47 @@ class MemUsage {
     std::vector<double> mem_curr;
     std::vector<double> mem_max;
 
+    /// tracked allocation snapshots, [tag][mark], in bytes.
+    std::vector<std::vector<double> > alloc_curr;
+    std::vector<std::vector<double> > alloc_peak;
+    /// peak window of the tracker used by this object.  -1 if none was free.
+    int window;
+
+    /// rows to print:  tags that held any memory during the marks.
+    static std::vector<int> active_tags(std::vector<std::vector<double> > const & peaks) {
+      std::vector<int> tags;
+      int n = ::std::min(static_cast<int>(peaks.size()), ::plog::alloc::tracker::get().num_tags());
+      for (int t = 0; t < n; ++t) {
+        if (::std::any_of(peaks[t].begin(), peaks[t].end(), [](double const & x) { return x > 0.0; }))
+          tags.push_back(t);
+      }
+      return tags;
+    }
+
+    static void print_rows(std::ostream & output, ::std::string const & title, ::std::string const & suffix,
+                           std::vector<int> const & tags, std::vector<std::vector<double> > const & vals) {
+      auto BtoMB = [](double const & x) { return x / (1024.0 * 1024.0); };
+      std::ostream_iterator<double> dit(output, ",");
+      for (auto t : tags) {
+        output << std::endl << "[MEM] " << title << "\talloc_" << ::plog::alloc::tracker::get().name(t) << "_" << suffix << "\t[,";
+        std::transform(vals[t].begin(), vals[t].end(), dit, BtoMB);
+        output << "]";
+      }
+    }
+
   public:
 
+    MemUsage() : alloc_curr(::plog::alloc::MAX_TAGS), alloc_peak(::plog::alloc::MAX_TAGS),
+        window(::plog::alloc::tracker::get().open_window()) {}
+
+    ~MemUsage() {
+      ::plog::alloc::tracker::get().close_window(window);
+    }
+
+    // owns a tracker window.
+    MemUsage(MemUsage const & other) = delete;
+    MemUsage & operator=(MemUsage const & other) = delete;
+
     /// return the program usable ram in bytes.
     static size_t get_usable_mem() {
        FILE *meminfo = fopen("/proc/meminfo", "r");
@@ -158,6 +202,11 @@ class MemUsage {
       names.clear();
       mem_curr.clear();
       mem_max.clear();
+      for (int t = 0; t < ::plog::alloc::MAX_TAGS; ++t) {
+        alloc_curr[t].clear();
+        alloc_peak[t].clear();
+      }
+      if (window >= 0) ::plog::alloc::tracker::get().restart_window(window);
     }
 
 
@@ -166,6 +215,13 @@ class MemUsage {
       names.push_back(name);
       mem_curr.push_back(::getCurrentRSS());
       mem_max.push_back(::getPeakRSS());
+
+      ::plog::alloc::tracker & tr = ::plog::alloc::tracker::get();
+      for (int t = 0; t < ::plog::alloc::MAX_TAGS; ++t) {
+        alloc_curr[t].push_back(tr.current(t));
+        alloc_peak[t].push_back(window >= 0 ? tr.window_peak(window, t) : tr.peak_bytes(t));
+      }
+      if (window >= 0) tr.restart_window(window);
     }
     void collective_mark(::std::string const & name, ::mxx::comm const & comm) {
 
@@ -198,6 +254,10 @@ class MemUsage {
         std::transform(mem_max.begin(), mem_max.end(), dit, BtoMB);
         output << "]";
 
+        std::vector<int> tags = active_tags(alloc_peak);
+        print_rows(output, title, "curr", tags, alloc_curr);
+        print_rows(output, title, "peak", tags, alloc_peak);
+
         // print pending stuff, then print entire string at once (minimizes multiple threads/processes mixing output )
         fflush(stdout);
         printf("%s\n", output.str().c_str());
@@ -308,6 +368,7 @@ class MemUsage {
 
       ::std::vector<double> curr_mins, curr_maxs, curr_means, curr_stdevs;
       ::std::vector<double> peak_mins, peak_maxs, peak_means, peak_stdevs;
+      ::std::vector< ::std::vector<double> > alloc_curr_maxs, alloc_peak_maxs;
       int p = comm.size();
       int rank = comm.rank();
 
@@ -328,6 +389,16 @@ class MemUsage {
         ::std::for_each(mem_max.begin(), mem_max.end(), [](double &x) { x = x*x; });
         peak_stdevs = ::mxx::reduce(mem_max, 0, ::std::plus<double>(), comm);
 
+        // tracked allocations: max over ranks, by tag number.
+        alloc_curr_maxs.resize(alloc_curr.size());
+        alloc_peak_maxs.resize(alloc_peak.size());
+        for (size_t t = 0; t < alloc_curr.size(); ++t) {
+          alloc_curr_maxs[t] = ::mxx::reduce(alloc_curr[t], 0,
+              [](double const & x, double const & y) { return ::std::max(x, y); }, comm);
+          alloc_peak_maxs[t] = ::mxx::reduce(alloc_peak[t], 0,
+              [](double const & x, double const & y) { return ::std::max(x, y); }, comm);
+        }
+
         if (rank == 0) {
 
           ::std::for_each(curr_means.begin(), curr_means.end(), [&p](double & x) { x /= p; });
@@ -387,6 +458,10 @@ class MemUsage {
           std::transform(peak_stdevs.begin(), peak_stdevs.end(), dit, BtoMB);
           output << "]";
 
+          std::vector<int> tags = active_tags(alloc_peak_maxs);
+          print_rows(output, title, "curr_max", tags, alloc_curr_maxs);
+          print_rows(output, title, "peak_max", tags, alloc_peak_maxs);
+
 
           fflush(stdout);
           printf("%s\n", output.str().c_str());
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    perf_counters.hpp
+ * @ingroup
+ * @author  tpan
+ * @brief   hardware performance counters of the calling thread, through linux perf_event_open.
+ * @details counts cycles, instructions, last level cache misses and data TLB misses, user space only, so that
+ *          perf_event_paranoid up to 2 is sufficient.  events that cannot be opened (no permission, no PMU in a VM,
+ *          not linux) read as 0 and are reported as not available.  counts are scaled when the kernel multiplexes
+ *          the events.
+ */
+#ifndef SRC_UTILS_PERF_COUNTERS_HPP_
+#define SRC_UTILS_PERF_COUNTERS_HPP_
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+
+namespace plog {
+
+class PerfCounters {
+  public:
+    enum event { CYCLES = 0, INSTRUCTIONS = 1, LLC_MISSES = 2, DTLB_MISSES = 3, NUM_EVENTS = 4 };
+
+    static char const * name(int const & e) {
+      static char const * names[NUM_EVENTS] = { "cycles", "instructions", "llc_misses", "dtlb_misses" };
+      return names[e];
+    }
+
+  protected:
+    int fds[NUM_EVENTS];
+
+#if defined(__linux__)
+    static int open_event(uint32_t type, uint64_t config) {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = type;
+      attr.config = config;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      // this thread, any cpu.
+      return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+#endif
+
+  public:
+    /// opens and starts the counters for the calling thread.
+    PerfCounters() {
+      for (int i = 0; i < NUM_EVENTS; ++i) fds[i] = -1;
+#if defined(__linux__)
+      fds[CYCLES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+      fds[INSTRUCTIONS] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+      fds[LLC_MISSES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+      fds[DTLB_MISSES] = open_event(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+                                    (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+#endif
+    }
+
+    ~PerfCounters() {
+#if defined(__linux__)
+      for (int i = 0; i < NUM_EVENTS; ++i) {
+        if (fds[i] >= 0) close(fds[i]);
+      }
+#endif
+    }
+
+    PerfCounters(PerfCounters const & other) = delete;
+    PerfCounters & operator=(PerfCounters const & other) = delete;
+
+    bool available(int const & e) const {
+      return fds[e] >= 0;
+    }
+
+    /// true if any event could be opened.
+    bool available() const {
+      for (int i = 0; i < NUM_EVENTS; ++i) {
+        if (fds[i] >= 0) return true;
+      }
+      return false;
+    }
+
+    /// running totals since construction.  0 for events that are not available.
+    void read(uint64_t (&values)[NUM_EVENTS]) const {
+      for (int i = 0; i < NUM_EVENTS; ++i) {
+        values[i] = 0;
+#if defined(__linux__)
+        if (fds[i] < 0) continue;
+        // value, time enabled, time running.
+        uint64_t buf[3] = {0, 0, 0};
+        if (::read(fds[i], buf, sizeof(buf)) != static_cast<ssize_t>(sizeof(buf))) continue;
+        values[i] = ((buf[2] > 0) && (buf[2] < buf[1])) ?
+            static_cast<uint64_t>(static_cast<double>(buf[0]) * buf[1] / buf[2]) : buf[0];
+#endif
+      }
+    }
+};
+
+} // end namespace plog
+
+#endif /* SRC_UTILS_PERF_COUNTERS_HPP_ */
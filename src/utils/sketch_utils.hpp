@@ -0,0 +1,263 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    sketch_utils.hpp
+ * @ingroup utils
+ * @author  tpan
+ * @brief   small streaming sketches: HyperLogLog for distinct counts, count-min for frequencies, Bloom filter for membership.
+ * @details both take hash values rather than keys.  the hash values are remixed internally, so the storage or
+ *          distribution hash of a map can be used directly, even though their high bits are correlated with the rank
+ *          a key was sent to.
+ */
+#ifndef SRC_UTILS_SKETCH_UTILS_HPP_
+#define SRC_UTILS_SKETCH_UTILS_HPP_
+
+#include <cstdint>
+#include <cmath>       // log, pow
+#include <vector>
+#include <algorithm>   // max, min
+#include <limits>
+
+namespace bliss
+{
+  namespace utils
+  {
+    namespace sketch
+    {
+
+      /// 64 bit finalizer (splitmix64).  decorrelates bits of an input hash.
+      inline uint64_t mix64(uint64_t h) {
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+        return h;
+      }
+
+      /**
+       * @brief HyperLogLog distinct count estimator, with 2^P one-byte registers.
+       * @details  standard error is about 1.04 / sqrt(2^P), i.e. 0.8% for the default P = 14 (16KB).
+       *           linear counting is used for small cardinalities.  registers can be merged (max) across ranks.
+       */
+      template <unsigned int P = 14>
+      class hyperloglog {
+          static_assert((P >= 4) && (P <= 18), "HyperLogLog precision should be between 4 and 18");
+
+        public:
+          static constexpr size_t num_registers = (1UL << P);
+
+        protected:
+          std::vector<uint8_t> regs;
+
+          static double alpha() {
+            return (P == 4) ? 0.673 : (P == 5) ? 0.697 : (P == 6) ? 0.709 :
+                0.7213 / (1.0 + 1.079 / static_cast<double>(num_registers));
+          }
+
+        public:
+          hyperloglog() : regs(num_registers, 0) {}
+
+          /// add a hash value.
+          inline void update(uint64_t h) {
+            h = mix64(h);
+            size_t idx = h >> (64 - P);
+            uint64_t w = (h << P) | (1ULL << (P - 1));   // guard bit bounds the rank at 64 - P + 1
+            uint8_t rank = static_cast<uint8_t>(__builtin_clzll(w) + 1);
+            if (rank > regs[idx]) regs[idx] = rank;
+          }
+
+          /// union with another sketch of the same precision.
+          void merge(hyperloglog const & other) {
+            for (size_t i = 0; i < num_registers; ++i) {
+              regs[i] = ::std::max(regs[i], other.regs[i]);
+            }
+          }
+
+          /// estimated number of distinct hash values added.
+          double estimate() const {
+            double sum = 0.0;
+            size_t zeros = 0;
+            for (size_t i = 0; i < num_registers; ++i) {
+              sum += ::std::ldexp(1.0, -static_cast<int>(regs[i]));
+              zeros += (regs[i] == 0);
+            }
+            double m = static_cast<double>(num_registers);
+            double e = alpha() * m * m / sum;
+
+            // small range: linear counting.  64 bit hashes need no large range correction.
+            if ((e <= 2.5 * m) && (zeros > 0)) e = m * ::std::log(m / static_cast<double>(zeros));
+            return e;
+          }
+
+          /// relative standard error of the estimate.
+          static double error() {
+            return 1.04 / ::std::sqrt(static_cast<double>(num_registers));
+          }
+
+          void clear() {
+            ::std::fill(regs.begin(), regs.end(), 0);
+          }
+
+          /// registers, for merging via collectives.
+          std::vector<uint8_t> & registers() { return regs; }
+          std::vector<uint8_t> const & registers() const { return regs; }
+      };
+
+
+      /**
+       * @brief count-min sketch with saturating counters.  estimates never undercount.
+       * @details  rows are indexed by double hashing of one 64 bit hash.  width is rounded up to a power of 2.
+       *           with width w, depth d, and n distinct keys, a key's estimate exceeds its count with probability about
+       *           (1 - exp(-n/w))^d.
+       */
+      template <typename CountType = uint8_t>
+      class count_min {
+        protected:
+          std::vector<CountType> counts;
+          size_t width;
+          size_t mask;
+          size_t depth;
+
+          inline size_t index(size_t const row, uint64_t const h) const {
+            uint64_t h1 = h & 0xFFFFFFFFULL;
+            uint64_t h2 = (h >> 32) | 1;    // odd, so rows differ
+            return row * width + ((h1 + row * h2) & mask);
+          }
+
+        public:
+          count_min(size_t const _width = 1024, size_t const _depth = 4) : width(16), depth(_depth) {
+            while (width < _width) width <<= 1;
+            mask = width - 1;
+            counts.assign(width * depth, 0);
+          }
+
+          /// add a hash value.
+          inline void update(uint64_t h) {
+            h = mix64(h);
+            for (size_t r = 0; r < depth; ++r) {
+              CountType & c = counts[index(r, h)];
+              if (c < ::std::numeric_limits<CountType>::max()) ++c;
+            }
+          }
+
+          /// add a hash value w times.
+          inline void update(uint64_t h, size_t const w) {
+            h = mix64(h);
+            for (size_t r = 0; r < depth; ++r) {
+              CountType & c = counts[index(r, h)];
+              size_t room = ::std::numeric_limits<CountType>::max() - c;
+              c += static_cast<CountType>(::std::min(room, w));
+            }
+          }
+
+          /// estimated count of a hash value.  saturates at max of CountType.
+          inline CountType estimate(uint64_t h) const {
+            h = mix64(h);
+            CountType c = ::std::numeric_limits<CountType>::max();
+            for (size_t r = 0; r < depth; ++r) {
+              c = ::std::min(c, counts[index(r, h)]);
+            }
+            return c;
+          }
+
+          size_t get_width() const { return width; }
+          size_t get_depth() const { return depth; }
+
+          void clear() {
+            ::std::fill(counts.begin(), counts.end(), 0);
+          }
+      };
+
+
+      /**
+       * @brief Bloom filter over hash values.  k probes by double hashing, in a power of 2 sized bit array.
+       */
+      class bloom_filter {
+        protected:
+          std::vector<uint64_t> bits;
+          uint64_t mask;
+          unsigned int k;
+
+          inline uint64_t probe(unsigned int const i, uint64_t const h) const {
+            return ((h & 0xFFFFFFFFULL) + i * ((h >> 32) | 1)) & mask;
+          }
+
+        public:
+          /// size for n distinct values at false positive rate fp.
+          bloom_filter(size_t const n = 1024, double const fp = 0.01) {
+            double m = -static_cast<double>(::std::max(n, static_cast<size_t>(1))) * ::std::log(fp) / (::std::log(2.0) * ::std::log(2.0));
+            uint64_t nbits = 64;
+            while (static_cast<double>(nbits) < m) nbits <<= 1;
+            mask = nbits - 1;
+            bits.assign(nbits / 64, 0);
+            k = ::std::max(1U, static_cast<unsigned int>(::std::round(static_cast<double>(nbits) / ::std::max(n, static_cast<size_t>(1)) * ::std::log(2.0))));
+            k = ::std::min(k, 16U);
+          }
+
+          inline bool test(uint64_t h) const {
+            h = mix64(h);
+            for (unsigned int i = 0; i < k; ++i) {
+              uint64_t b = probe(i, h);
+              if ((bits[b >> 6] & (1ULL << (b & 63))) == 0) return false;
+            }
+            return true;
+          }
+
+          inline void insert(uint64_t h) {
+            h = mix64(h);
+            for (unsigned int i = 0; i < k; ++i) {
+              uint64_t b = probe(i, h);
+              bits[b >> 6] |= (1ULL << (b & 63));
+            }
+          }
+
+          /// insert, and return true if the value was (probably) already present.
+          inline bool test_and_insert(uint64_t h) {
+            h = mix64(h);
+            bool present = true;
+            for (unsigned int i = 0; i < k; ++i) {
+              uint64_t b = probe(i, h);
+              uint64_t m = 1ULL << (b & 63);
+              present &= ((bits[b >> 6] & m) != 0);
+              bits[b >> 6] |= m;
+            }
+            return present;
+          }
+
+          /// union with a filter of the same size.
+          void merge(bloom_filter const & other) {
+            for (size_t i = 0; i < bits.size(); ++i) bits[i] |= other.bits[i];
+          }
+
+          size_t size_bits() const { return bits.size() * 64; }
+          unsigned int num_hashes() const { return k; }
+
+          /// bit words, for merging via collectives (bitwise or).
+          std::vector<uint64_t> & words() { return bits; }
+          std::vector<uint64_t> const & words() const { return bits; }
+
+          void clear() {
+            ::std::fill(bits.begin(), bits.end(), 0);
+          }
+      };
+
+    } // namespace sketch
+  } // namespace utils
+} // namespace bliss
+
+#endif /* SRC_UTILS_SKETCH_UTILS_HPP_ */
@@ -0,0 +1,453 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    stage_pipeline.hpp
+ * @ingroup utils
+ * @author  tpan
+ * @brief   executor for a linear graph of stages connected by bounded lock-free queues.
+ * @details each stage runs its op on its own threads:  a source produces items, a stage turns each item of its input
+ *          queue into at most 1 item of its output queue, and a sink consumes items.  queues have a fixed depth, so a
+ *          fast stage blocks on a full output queue (back-pressure) instead of growing memory.  a queue closes when
+ *          all threads of its producing stage are done, and its consumers stop once it is drained.
+ *
+ *          at most 1 stage can run on the thread that calls run(), with 0 threads.  that is where MPI calls go
+ *          (MPI_THREAD_FUNNELED).  with an agreement function, e.g. mxx::all_of over a communicator, the caller stage
+ *          keeps calling its op, on a default constructed item once its own input is drained, until all processes
+ *          agree that they are done, so collective ops run the same number of rounds everywhere.  an error on 1
+ *          process leaves the others waiting in the collective, as with any failed collective.
+ *
+ *          per stage, the items, the time in op (busy), blocked on an empty input (starved) and blocked on a full
+ *          output (back-pressure) are kept, summed over the stage's threads.  utilization is busy time over threads
+ *          x wall time.  an exception in any stage cancels all queues, and run() rethrows it after the join.
+ */
+#ifndef SRC_UTILS_STAGE_PIPELINE_HPP_
+#define SRC_UTILS_STAGE_PIPELINE_HPP_
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace bliss {
+  namespace concurrent {
+
+    /**
+     * @brief bounded multi-producer multi-consumer queue.  a ring of slots with sequence numbers (D. Vyukov), so
+     *        push and pop are 1 compare-and-swap each when the queue is neither full nor empty.
+     * @details push and pop block with spin, then yield, then short sleeps.  close() ends the pushes:  pop returns
+     *          false once the queue is drained.  cancel() ends both:  push and pop return false right away.
+     */
+    template <typename T>
+    class bounded_queue {
+      protected:
+        struct slot {
+            std::atomic<size_t> seq;
+            T data;
+        };
+
+        std::vector<slot> slots;
+        size_t mask;
+
+        alignas(64) std::atomic<size_t> head;   // next slot to push.
+        alignas(64) std::atomic<size_t> tail;   // next slot to pop.
+        alignas(64) std::atomic<int> producers;
+        std::atomic<bool> closed;
+        std::atomic<bool> cancelled;
+
+        static size_t round_up(size_t n) {
+          size_t p = 2;
+          while (p < n) p <<= 1;
+          return p;
+        }
+
+        /// spin, then yield, then sleep.
+        static void backoff(size_t & tries) {
+          if (tries < 64) {
+            // busy.
+          } else if (tries < 256) {
+            std::this_thread::yield();
+          } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+          }
+          ++tries;
+        }
+
+      public:
+        /// capacity is rounded up to a power of 2, at least 2.
+        explicit bounded_queue(size_t capacity) :
+          slots(round_up(capacity)), mask(slots.size() - 1), head(0), tail(0), producers(0),
+          closed(false), cancelled(false) {
+          for (size_t i = 0; i < slots.size(); ++i) slots[i].seq.store(i, std::memory_order_relaxed);
+        }
+
+        size_t capacity() const {
+          return slots.size();
+        }
+
+        /// false if full.  x is moved only on success.
+        bool try_push(T & x) {
+          size_t pos = head.load(std::memory_order_relaxed);
+          while (true) {
+            slot & s = slots[pos & mask];
+            size_t seq = s.seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+              if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                s.data = std::move(x);
+                s.seq.store(pos + 1, std::memory_order_release);
+                return true;
+              }
+            } else if (diff < 0) {
+              return false;
+            } else {
+              pos = head.load(std::memory_order_relaxed);
+            }
+          }
+        }
+
+        /// false if empty.
+        bool try_pop(T & x) {
+          size_t pos = tail.load(std::memory_order_relaxed);
+          while (true) {
+            slot & s = slots[pos & mask];
+            size_t seq = s.seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+              if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                x = std::move(s.data);
+                s.seq.store(pos + mask + 1, std::memory_order_release);
+                return true;
+              }
+            } else if (diff < 0) {
+              return false;
+            } else {
+              pos = tail.load(std::memory_order_relaxed);
+            }
+          }
+        }
+
+        /// blocks while full.  false if cancelled.
+        bool push(T & x) {
+          size_t tries = 0;
+          while (!try_push(x)) {
+            if (cancelled.load(std::memory_order_acquire)) return false;
+            backoff(tries);
+          }
+          return true;
+        }
+        bool push(T && x) {
+          return push(x);
+        }
+
+        /// blocks while empty.  false if cancelled, or closed and drained.
+        bool pop(T & x) {
+          size_t tries = 0;
+          while (!try_pop(x)) {
+            if (cancelled.load(std::memory_order_acquire)) return false;
+            if (closed.load(std::memory_order_acquire)) return try_pop(x);  // pushes before the close are visible.
+            backoff(tries);
+          }
+          return true;
+        }
+
+        /// no more pushes.
+        void close() {
+          closed.store(true, std::memory_order_release);
+        }
+        void cancel() {
+          cancelled.store(true, std::memory_order_release);
+        }
+        bool is_cancelled() const {
+          return cancelled.load(std::memory_order_acquire);
+        }
+
+        /// the queue closes when the last registered producer is removed.
+        void add_producers(int n) {
+          producers.fetch_add(n, std::memory_order_relaxed);
+        }
+        void remove_producer() {
+          if (producers.fetch_sub(1, std::memory_order_acq_rel) == 1) close();
+        }
+    };
+
+
+    /// counters of 1 stage, summed over its threads.  times in seconds.
+    struct stage_stats {
+        std::string name;
+        int threads;
+        size_t items;
+        double busy;
+        double starved;
+        double blocked;
+        double wall;
+
+        stage_stats() : threads(0), items(0), busy(0.0), starved(0.0), blocked(0.0), wall(0.0) {}
+
+        /// fraction of the stage's thread time spent in op.
+        double utilization() const {
+          double t = static_cast<double>((threads == 0) ? 1 : threads) * wall;
+          return (t > 0.0) ? (busy / t) : 0.0;
+        }
+    };
+
+
+    /**
+     * @brief linear pipeline of stages.  see file description.
+     * @details build with source, stage, and sink, each taking the output queue of the previous one, then run().
+     *          ops are copied into each of the stage's threads, so per thread state (a parser, a buffer) can live in
+     *          the op.
+     */
+    class stage_pipeline {
+      protected:
+        using clock = std::chrono::steady_clock;
+
+        struct stage_entry {
+            stage_stats stats;
+            /// thread body, called with the thread's counters.
+            std::function<void(stage_stats &)> body;
+        };
+
+        std::vector<std::unique_ptr<stage_entry> > stages;
+        std::vector<std::function<void()> > cancels;
+        std::function<bool(bool)> agree;
+        int caller_stage;
+
+        std::mutex mutex;
+        std::exception_ptr error;
+
+        static double seconds(clock::time_point const & a, clock::time_point const & b) {
+          return std::chrono::duration<double>(b - a).count();
+        }
+
+        /// record the first error, and cancel all queues so that the other stages return.
+        void fail(std::exception_ptr e) {
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error) error = e;
+          }
+          for (auto & c : cancels) c();
+        }
+
+        stage_entry & add(std::string const & name, int threads) {
+          if (threads == 0) {
+            assert(caller_stage < 0 && "only 1 stage can run on the caller thread.");
+            caller_stage = static_cast<int>(stages.size());
+          }
+          stages.emplace_back(new stage_entry());
+          stages.back()->stats.name = name;
+          stages.back()->stats.threads = threads;
+          return *(stages.back());
+        }
+
+        /// pop with the caller stage's agreement:  false once all agree that they are drained.
+        template <typename In>
+        bool caller_pop(bounded_queue<In> & in, In & x) {
+          bool has = in.pop(x);
+          if (!agree) return has;
+          if (in.is_cancelled()) return false;
+          if (agree(!has)) return false;
+          if (!has) x = In();
+          return true;
+        }
+
+        template <typename In>
+        bool pop(bounded_queue<In> & in, In & x, bool const & on_caller) {
+          return on_caller ? caller_pop(in, x) : in.pop(x);
+        }
+
+      public:
+        stage_pipeline() : caller_stage(-1) {}
+
+        /**
+         * @brief set the agreement for the caller stage, e.g. [&comm](bool done){ return mxx::all_of(done, comm); }.
+         *        it is called once per round on the caller thread with whether this process's input is drained.
+         */
+        void set_agreement(std::function<bool(bool)> const & _agree) {
+          agree = _agree;
+        }
+
+        /**
+         * @brief stage with no input.  op(Out & out) fills out and returns true, or returns false when done.
+         * @param threads  0 to run on the caller thread.
+         * @param depth    capacity of the output queue.
+         */
+        template <typename Out, typename Op>
+        std::shared_ptr<bounded_queue<Out> > source(std::string const & name, int threads, size_t depth, Op const & op) {
+          auto out = std::make_shared<bounded_queue<Out> >(depth);
+          out->add_producers((threads == 0) ? 1 : threads);
+          stage_entry & s = add(name, threads);
+          s.body = [op, out](stage_stats & st) {
+            Op o(op);
+            Out x;
+            while (true) {
+              auto t0 = clock::now();
+              bool more = o(x);
+              auto t1 = clock::now();
+              st.busy += seconds(t0, t1);
+              if (!more) break;
+              ++st.items;
+              bool ok = out->push(x);
+              st.blocked += seconds(t1, clock::now());
+              if (!ok) break;
+            }
+            out->remove_producer();
+          };
+          cancels.emplace_back([out](){ out->cancel(); });
+          return out;
+        }
+
+        /**
+         * @brief stage from in to a new queue.  op(In & in, Out & out) returns true to push out.
+         * @param threads  0 to run on the caller thread.
+         * @param depth    capacity of the output queue.
+         */
+        template <typename In, typename Out, typename Op>
+        std::shared_ptr<bounded_queue<Out> > stage(std::string const & name, int threads,
+                                                   std::shared_ptr<bounded_queue<In> > const & in, size_t depth, Op const & op) {
+          auto out = std::make_shared<bounded_queue<Out> >(depth);
+          out->add_producers((threads == 0) ? 1 : threads);
+          stage_entry & s = add(name, threads);
+          bool on_caller = (threads == 0);
+          s.body = [this, op, in, out, on_caller](stage_stats & st) {
+            Op o(op);
+            In x;
+            Out y;
+            while (true) {
+              auto t0 = clock::now();
+              bool has = this->pop(*in, x, on_caller);
+              auto t1 = clock::now();
+              st.starved += seconds(t0, t1);
+              if (!has) break;
+              bool emit = o(x, y);
+              auto t2 = clock::now();
+              st.busy += seconds(t1, t2);
+              ++st.items;
+              if (!emit) continue;
+              bool ok = out->push(y);
+              st.blocked += seconds(t2, clock::now());
+              if (!ok) break;
+            }
+            out->remove_producer();
+          };
+          cancels.emplace_back([out](){ out->cancel(); });
+          return out;
+        }
+
+        /**
+         * @brief last stage.  op(In & in) consumes in.
+         * @param threads  0 to run on the caller thread.
+         */
+        template <typename In, typename Op>
+        void sink(std::string const & name, int threads, std::shared_ptr<bounded_queue<In> > const & in, Op const & op) {
+          stage_entry & s = add(name, threads);
+          bool on_caller = (threads == 0);
+          s.body = [this, op, in, on_caller](stage_stats & st) {
+            Op o(op);
+            In x;
+            while (true) {
+              auto t0 = clock::now();
+              bool has = this->pop(*in, x, on_caller);
+              auto t1 = clock::now();
+              st.starved += seconds(t0, t1);
+              if (!has) break;
+              o(x);
+              st.busy += seconds(t1, clock::now());
+              ++st.items;
+            }
+          };
+          cancels.emplace_back([in](){ in->cancel(); });
+        }
+
+        /// run all stages to completion.  rethrows the first exception of any stage.
+        void run() {
+          error = nullptr;
+          auto start = clock::now();
+
+          std::vector<std::thread> workers;
+          std::vector<std::vector<stage_stats> > local(stages.size());
+          for (size_t i = 0; i < stages.size(); ++i) {
+            int n = stages[i]->stats.threads;
+            local[i].resize((n == 0) ? 1 : n);
+          }
+
+          auto runner = [this](size_t i, stage_stats * st) {
+            auto t0 = clock::now();
+            try {
+              stages[i]->body(*st);
+            } catch (...) {
+              this->fail(std::current_exception());
+            }
+            st->wall = seconds(t0, clock::now());
+          };
+
+          for (size_t i = 0; i < stages.size(); ++i) {
+            for (int t = 0; t < stages[i]->stats.threads; ++t) {
+              workers.emplace_back(runner, i, &(local[i][t]));
+            }
+          }
+          if (caller_stage >= 0) runner(caller_stage, &(local[caller_stage][0]));
+          for (auto & w : workers) w.join();
+
+          double wall = seconds(start, clock::now());
+          for (size_t i = 0; i < stages.size(); ++i) {
+            stage_stats & s = stages[i]->stats;
+            s.items = 0;  s.busy = 0.0;  s.starved = 0.0;  s.blocked = 0.0;
+            for (auto const & l : local[i]) {
+              s.items += l.items;
+              s.busy += l.busy;
+              s.starved += l.starved;
+              s.blocked += l.blocked;
+            }
+            s.wall = wall;
+          }
+
+          if (error) std::rethrow_exception(error);
+        }
+
+        /// counters of the last run(), in stage order.
+        std::vector<stage_stats> get_stats() const {
+          std::vector<stage_stats> out;
+          for (auto const & s : stages) out.emplace_back(s->stats);
+          return out;
+        }
+
+        /// 1 line per stage.
+        void report(std::ostream & os, std::string const & name) const {
+          char line[256];
+          for (auto const & s : stages) {
+            snprintf(line, sizeof(line), "%s stage %-12s threads %2d items %10lu busy %8.3fs starved %8.3fs blocked %8.3fs utilization %5.1f%%\n",
+                     name.c_str(), s->stats.name.c_str(), s->stats.threads, s->stats.items, s->stats.busy,
+                     s->stats.starved, s->stats.blocked, 100.0 * s->stats.utilization());
+            os << line;
+          }
+        }
+    };
+
+  } // namespace concurrent
+} // namespace bliss
+
+#endif // SRC_UTILS_STAGE_PIPELINE_HPP_
@@ -224,6 +224,20 @@ class BitReverseTestHelper {
                         rev_arr, 32, bit_offset);
     }
 #endif
+
+#if defined(BLISS_BITREV_NEON)
+    bool is_reverse(uint8x16_t const & orig, uint8x16_t const & rev, uint8_t bit_offset = 0) {
+
+      uint8_t orig_arr[16];
+      uint8_t rev_arr[16];
+
+      vst1q_u8(orig_arr, orig);
+      vst1q_u8(rev_arr, rev);
+
+      return is_reverse(orig_arr,
+                        rev_arr, 16, bit_offset);
+    }
+#endif
 };
 
 
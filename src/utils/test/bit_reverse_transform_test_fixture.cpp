@@ -21,7 +21,7 @@
 
 #include "utils/test/bit_reverse_test_helper.hpp"
 
-//TESTS: Sequential, SWAR/BSWAP, SSSE3, AVX2 versions of bit reverse.
+//TESTS: Sequential, SWAR/BSWAP, SSSE3, AVX2, AVX512, NEON versions of bit reverse.
 //TESTS: for each, test different input (drawing from a 32 byte array),
 //       different offsets, different bit group sizes, different word types, and different byte array lengths.
 //TESTS: reverse entire array via multiplel SWAR, SSSE3, and AVX2 calls.
@@ -369,6 +369,26 @@ TYPED_TEST_P(BitReverseTransformTest, reverse_avx2)
 }
 #endif
 
+#ifdef BLISS_BITREV_AVX512
+TYPED_TEST_P(BitReverseTransformTest, reverse_avx512)
+{
+  using data_type = typename ::std::tuple_element<1, TypeParam>::type;
+  constexpr size_t data_size = ::std::tuple_element<0, TypeParam>::type::bitsPerGroup;
+
+  this->template run_tests<::bliss::utils::bit_ops::BITREV_AVX512, data_type, data_size>();
+}
+#endif
+
+#ifdef BLISS_BITREV_NEON
+TYPED_TEST_P(BitReverseTransformTest, reverse_neon)
+{
+  using data_type = typename ::std::tuple_element<1, TypeParam>::type;
+  constexpr size_t data_size = ::std::tuple_element<0, TypeParam>::type::bitsPerGroup;
+
+  this->template run_tests<::bliss::utils::bit_ops::BITREV_NEON, data_type, data_size>();
+}
+#endif
+
 
 // now register the test cases
 REGISTER_TYPED_TEST_CASE_P(BitReverseTransformTest,
@@ -377,6 +397,12 @@ REGISTER_TYPED_TEST_CASE_P(BitReverseTransformTest,
 #endif
 #ifdef __AVX2__
                            reverse_avx2,
+#endif
+#ifdef BLISS_BITREV_AVX512
+                           reverse_avx512,
+#endif
+#ifdef BLISS_BITREV_NEON
+                           reverse_neon,
 #endif
                            reverse_swar,
                            reverse_seq);
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_async_logger.cpp
+ * @ingroup utils
+ * @author  tpan
+ * @brief   tests for the asynchronous logging engine:  deferred formatting, threads, and dropped records.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils/async_logger.hpp"
+
+namespace {
+
+  /// log to a temp file, flush, and return the lines.
+  struct capture {
+      FILE * f;
+      capture() : f(tmpfile()) {
+        ::bliss::log::async::flush();
+        ::bliss::log::async::logger::instance().set_output(f);
+      }
+      ~capture() {
+        ::bliss::log::async::logger::instance().set_output(stdout);
+        fclose(f);
+      }
+      std::vector<std::string> lines() {
+        ::bliss::log::async::flush();
+        fflush(f);
+        rewind(f);
+        std::vector<std::string> out;
+        char buf[1024];
+        while (fgets(buf, sizeof(buf), f) != nullptr) {
+          std::string s(buf);
+          if (!s.empty() && s.back() == '\n') s.pop_back();
+          out.push_back(s);
+        }
+        return out;
+      }
+  };
+
+  /// the message, after the "[level] (tN seconds) " prefix.
+  std::string message(std::string const & line) {
+    size_t pos = line.find(") ");
+    return (pos == std::string::npos) ? line : line.substr(pos + 2);
+  }
+
+}
+
+TEST(async_logger, deferred_format)
+{
+  capture c;
+
+  char name[16];
+  strcpy(name, "kmer");
+  ::bliss::log::async::logf(::bliss::log::async::INFO, "%s %d %lu %.2f %c", name, -3, 12345678901UL, 0.5, 'x');
+  // the string is copied into the record, not referenced.
+  strcpy(name, "XXXX");
+  ::bliss::log::async::logf(::bliss::log::async::ERROR, "no args");
+
+  std::vector<std::string> lines = c.lines();
+  ASSERT_EQ(2UL, lines.size());
+  EXPECT_EQ(0UL, lines[0].find("[info ]"));
+  EXPECT_EQ("kmer -3 12345678901 0.50 x", message(lines[0]));
+  EXPECT_EQ(0UL, lines[1].find("[error]"));
+  EXPECT_EQ("no args", message(lines[1]));
+}
+
+TEST(async_logger, eager_fallback)
+{
+  capture c;
+
+  // arguments larger than the payload are formatted on the calling thread.
+  std::string big(300, 'a');
+  ::bliss::log::async::logf(::bliss::log::async::DEBUG, "%s!", big.c_str());
+  std::string s("stream ");
+  std::ostringstream & ss = ::bliss::log::async::thread_stream();
+  ss << s << 42;
+  ::bliss::log::async::log_stream(::bliss::log::async::WARNING, ss);
+
+  std::vector<std::string> lines = c.lines();
+  ASSERT_EQ(2UL, lines.size());
+  // truncated to the payload.
+  EXPECT_EQ(::bliss::log::async::record::payload_size - 1, message(lines[0]).size());
+  EXPECT_EQ("stream 42", message(lines[1]));
+}
+
+TEST(async_logger, threads)
+{
+  capture c;
+
+  const int nthreads = 4;
+  const int per_thread = 5000;   // more than a ring holds, so some may be dropped.
+  std::vector<std::thread> ts;
+  for (int t = 0; t < nthreads; ++t) {
+    ts.emplace_back([t, per_thread]() {
+      for (int i = 0; i < per_thread; ++i)
+        ::bliss::log::async::logf(::bliss::log::async::TRACE, "thread %d msg %d", t, i);
+    });
+  }
+  for (size_t t = 0; t < ts.size(); ++t) ts[t].join();
+
+  std::vector<std::string> lines = c.lines();
+  size_t logged = 0, dropped = 0;
+  std::vector<int> last(nthreads, -1);
+  for (size_t i = 0; i < lines.size(); ++i) {
+    unsigned long d;
+    int t, m;
+    if (sscanf(lines[i].c_str(), "[warn ] async logger dropped %lu records", &d) == 1) {
+      dropped += d;
+    } else if (sscanf(message(lines[i]).c_str(), "thread %d msg %d", &t, &m) == 2) {
+      ++logged;
+      ASSERT_TRUE(t >= 0 && t < nthreads);
+      // each thread's records come out in order.
+      EXPECT_LT(last[t], m);
+      last[t] = m;
+    }
+  }
+  EXPECT_EQ(static_cast<size_t>(nthreads * per_thread), logged + dropped);
+}
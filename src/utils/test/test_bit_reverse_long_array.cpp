@@ -69,7 +69,72 @@ TYPED_TEST_P(BitReverseLongArrayTest, reverse_long_array)
   }
 }
 
-REGISTER_TYPED_TEST_CASE_P(BitReverseLongArrayTest, reverse_long_array);
+#ifdef BLISS_BITREV_AVX512
+TYPED_TEST_P(BitReverseLongArrayTest, reverse_long_array_avx512)
+{
+
+  uint8_t BLISS_ALIGNED_ARRAY(out, 128, 32);
+
+  unsigned int max = 128;
+
+  for (unsigned int i = 1; i <= max; ++i ) {
+    if (((i * 8) % TypeParam::bitsPerGroup) != 0) continue;  // i has to be a multiple of bytes for bitsPerGroup.
+
+      for (unsigned int k = 0; k <= (128 - i); ++k) {
+        memset(out, 0, 128);
+
+        bliss::utils::bit_ops::reverse<TypeParam::bitsPerGroup, bliss::utils::bit_ops::BIT_REV_AVX512>(out, this->helper.input + k, i);
+
+        bool same = this->is_reverse(this->helper.input + k, out, i);
+
+        if (!same) {
+
+          printf("array size = %d\n", i);
+        }
+
+        EXPECT_TRUE(same);
+      }
+  }
+}
+#endif
+
+#ifdef BLISS_BITREV_NEON
+TYPED_TEST_P(BitReverseLongArrayTest, reverse_long_array_neon)
+{
+
+  uint8_t BLISS_ALIGNED_ARRAY(out, 128, 32);
+
+  unsigned int max = 128;
+
+  for (unsigned int i = 1; i <= max; ++i ) {
+    if (((i * 8) % TypeParam::bitsPerGroup) != 0) continue;  // i has to be a multiple of bytes for bitsPerGroup.
+
+      for (unsigned int k = 0; k <= (128 - i); ++k) {
+        memset(out, 0, 128);
+
+        bliss::utils::bit_ops::reverse<TypeParam::bitsPerGroup, bliss::utils::bit_ops::BIT_REV_NEON>(out, this->helper.input + k, i);
+
+        bool same = this->is_reverse(this->helper.input + k, out, i);
+
+        if (!same) {
+
+          printf("array size = %d\n", i);
+        }
+
+        EXPECT_TRUE(same);
+      }
+  }
+}
+#endif
+
+REGISTER_TYPED_TEST_CASE_P(BitReverseLongArrayTest,
+#ifdef BLISS_BITREV_AVX512
+                           reverse_long_array_avx512,
+#endif
+#ifdef BLISS_BITREV_NEON
+                           reverse_long_array_neon,
+#endif
+                           reverse_long_array);
 
 
 
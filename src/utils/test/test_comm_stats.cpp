@@ -0,0 +1,88 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_comm_stats.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test the local communication volume counters.
+ * @details
+ */
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+// include files to test
+#include "utils/comm_stats.hpp"
+
+
+TEST(CommStats, record)
+{
+  ::plog::CommStats & stats = ::plog::CommStats::get();
+  stats.reset();
+
+  // 4 ranks, 8 byte elements.  1 destination is empty.
+  std::vector<size_t> send_counts = {10, 0, 30, 40};
+  std::vector<uint32_t> recv_counts = {5, 5, 5, 5};
+  stats.record("distribute", 8, send_counts, recv_counts);
+  stats.record("distribute", 8, std::vector<size_t>(4, 20), 100);
+
+  auto counters = stats.get_counters();
+  ASSERT_EQ(1UL, counters.size());
+  ::plog::comm_counters const & c = counters.at("distribute");
+  EXPECT_EQ(2UL, c.calls);
+  EXPECT_EQ(8UL * (80 + 80), c.bytes_sent);
+  EXPECT_EQ(8UL * (20 + 100), c.bytes_recv);
+  EXPECT_EQ(3UL + 4UL, c.messages);
+  EXPECT_EQ(8UL * 40, c.max_message);
+  // first call: max 40 vs avg 20.
+  EXPECT_DOUBLE_EQ(2.0, c.max_skew);
+}
+
+TEST(CommStats, scopes)
+{
+  ::plog::CommStats & stats = ::plog::CommStats::get();
+  stats.reset();
+
+  std::vector<size_t> counts(2, 1);
+  {
+    ::plog::CommStats::scope find("find");
+    stats.record("distribute", 4, counts, counts);
+    {
+      ::plog::CommStats::scope inner("scatter_compute_gather");
+      stats.record("distribute", 4, counts, counts);
+    }
+    stats.record("respond", 4, counts, counts);
+  }
+  stats.record("distribute", 4, counts, counts);
+
+  auto counters = stats.get_counters();
+  ASSERT_EQ(4UL, counters.size());
+  EXPECT_EQ(1UL, counters.count("find/distribute"));
+  EXPECT_EQ(1UL, counters.count("find/scatter_compute_gather/distribute"));
+  EXPECT_EQ(1UL, counters.count("find/respond"));
+  EXPECT_EQ(1UL, counters.count("distribute"));
+
+  // no sends:  no messages, no skew.
+  stats.reset();
+  stats.record("empty", 4, std::vector<size_t>(3, 0), 0);
+  ::plog::comm_counters const & e = stats.get_counters().at("empty");
+  EXPECT_EQ(0UL, e.messages);
+  EXPECT_EQ(0.0, e.max_skew);
+}
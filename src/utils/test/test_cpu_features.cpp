@@ -0,0 +1,93 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_cpu_features.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   tests the runtime SIMD feature detection used for kernel dispatch.
+ * @details
+ *
+ */
+
+#include "utils/cpu_features.hpp"
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+
+#include "bliss-config.hpp"
+
+TEST(CpuFeatures, matches_compiler_builtin) {
+  // the environment cap would make the comparison meaningless.
+  if (getenv("BLISS_SIMD_MAX") != nullptr) return;
+
+  ::bliss::utils::cpu::features f = ::bliss::utils::cpu::detail::detect();
+#if defined(BLISS_CPUID_X86)
+  __builtin_cpu_init();
+  EXPECT_EQ(__builtin_cpu_supports("ssse3") != 0, f.ssse3);
+  EXPECT_EQ(__builtin_cpu_supports("sse4.2") != 0, f.sse42);
+  EXPECT_EQ(__builtin_cpu_supports("avx2") != 0, f.avx2);
+  EXPECT_EQ(__builtin_cpu_supports("avx512f") != 0, f.avx512f);
+#else
+  EXPECT_EQ(std::string("scalar"), f.toString());
+#endif
+}
+
+TEST(CpuFeatures, compile_flags_imply_runtime) {
+#if defined(__SSSE3__)
+  EXPECT_TRUE(::bliss::utils::cpu::has_ssse3());
+#endif
+#if defined(__AVX2__)
+  EXPECT_TRUE(::bliss::utils::cpu::has_avx2());
+#endif
+
+  // without the cap, an instruction set the binary is compiled for has to be on the CPU.
+  if (getenv("BLISS_SIMD_MAX") != nullptr) return;
+  ::bliss::utils::cpu::features const & f = ::bliss::utils::cpu::get_features();
+#if defined(__SSSE3__)
+  EXPECT_TRUE(f.ssse3);
+#endif
+#if defined(__AVX2__)
+  EXPECT_TRUE(f.avx2);
+#endif
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+  EXPECT_TRUE(f.avx512dq);
+#endif
+}
+
+TEST(CpuFeatures, cap) {
+  ::bliss::utils::cpu::features all;
+  all.ssse3 = all.sse42 = all.avx2 = true;
+  all.avx512f = all.avx512dq = all.avx512bw = all.avx512vl = all.avx512vbmi = all.gfni = true;
+
+  ::bliss::utils::cpu::features f = all;
+  ::bliss::utils::cpu::detail::cap(f, "scalar");
+  EXPECT_EQ(std::string("scalar"), f.toString());
+
+  f = all;
+  ::bliss::utils::cpu::detail::cap(f, "ssse3");
+  EXPECT_EQ(std::string("ssse3"), f.toString());
+
+  f = all;
+  ::bliss::utils::cpu::detail::cap(f, "avx2");
+  EXPECT_EQ(std::string("ssse3 sse4.2 avx2"), f.toString());
+
+  // unknown or "avx512" leaves everything.
+  f = all;
+  ::bliss::utils::cpu::detail::cap(f, "avx512");
+  EXPECT_TRUE(f.avx512vbmi);
+  EXPECT_TRUE(f.gfni);
+}
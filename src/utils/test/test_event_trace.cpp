@@ -0,0 +1,110 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_event_trace.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test the local event trace:  recording, sampling, the cap, and the Chrome trace output.
+ * @details
+ */
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// include files to test
+#include "utils/event_trace.hpp"
+
+
+TEST(EventTrace, complete)
+{
+  ::plog::EventTrace & trace = ::plog::EventTrace::get();
+  trace.reset();
+  trace.set_sample(1);
+  trace.set_max_events(1000);
+
+  auto t1 = std::chrono::steady_clock::now();
+  auto t2 = t1 + std::chrono::microseconds(250);
+  trace.complete("a2a", "insert/distribute", t1, t2);
+  {
+    ::plog::EventTrace::scope s("parse");
+  }
+
+  std::vector<::plog::trace_event> events = trace.get_events();
+  ASSERT_EQ(2UL, events.size());
+  EXPECT_EQ("a2a", events[0].name);
+  EXPECT_EQ("insert/distribute", events[0].cat);
+  EXPECT_EQ(250000UL, events[0].dur);
+  EXPECT_EQ("parse", events[1].name);
+  EXPECT_LE(events[0].ts, events[1].ts);
+}
+
+TEST(EventTrace, sample_and_cap)
+{
+  ::plog::EventTrace & trace = ::plog::EventTrace::get();
+  trace.reset();
+  auto t = std::chrono::steady_clock::now();
+
+  trace.set_sample(4);
+  trace.set_max_events(1000);
+  for (int i = 0; i < 100; ++i) trace.complete("x", "c", t, t);
+  EXPECT_EQ(25UL, trace.get_events().size());
+  EXPECT_EQ(0UL, trace.get_dropped());
+
+  trace.reset();
+  trace.set_sample(1);
+  trace.set_max_events(10);
+  for (int i = 0; i < 100; ++i) trace.complete("x", "c", t, t);
+  EXPECT_EQ(10UL, trace.get_events().size());
+  EXPECT_EQ(90UL, trace.get_dropped());
+
+  trace.set_max_events(1UL << 20);
+  trace.reset();
+}
+
+TEST(EventTrace, threads)
+{
+  ::plog::EventTrace & trace = ::plog::EventTrace::get();
+  trace.reset();
+  trace.set_sample(1);
+
+  std::vector<std::thread> ts;
+  for (int t = 0; t < 4; ++t) {
+    ts.emplace_back([]() {
+      auto now = std::chrono::steady_clock::now();
+      for (int i = 0; i < 100; ++i) ::plog::EventTrace::get().complete("bucket", "t", now, now);
+    });
+  }
+  for (auto & t : ts) t.join();
+  EXPECT_EQ(400UL, trace.get_events().size());
+
+  // 1 thread_name entry per thread, and the events carry their tid.
+  std::ostringstream out;
+  trace.write_events(out);
+  std::string s = out.str();
+  size_t names = 0;
+  for (size_t pos = s.find("\"thread_name\""); pos != std::string::npos; pos = s.find("\"thread_name\"", pos + 1)) ++names;
+  EXPECT_LE(5UL, names);   // this thread, from the earlier tests, and the 4 new ones.
+  EXPECT_NE(std::string::npos, s.find("\"process_name\""));
+  EXPECT_NE(std::string::npos, s.find("\"ph\": \"X\""));
+  trace.reset();
+}
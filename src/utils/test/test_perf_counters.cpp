@@ -0,0 +1,66 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_perf_counters.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test hardware counter reads.  passes trivially where perf events are not available.
+ * @details
+ */
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// include files to test
+#include "utils/perf_counters.hpp"
+
+
+TEST(PerfCounters, monotonic)
+{
+  ::plog::PerfCounters pc;
+  if (!pc.available()) {
+    printf("perf events not available.  skipping.\n");
+    return;
+  }
+
+  uint64_t before[::plog::PerfCounters::NUM_EVENTS], after[::plog::PerfCounters::NUM_EVENTS];
+  pc.read(before);
+
+  // touch memory and do some work.
+  std::vector<uint64_t> data(1 << 20);
+  uint64_t sum = 0;
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = i * 2654435761ULL;
+    sum += data[(i * 4099) & (data.size() - 1)];
+  }
+  EXPECT_NE(1UL, sum);
+
+  pc.read(after);
+  for (int e = 0; e < ::plog::PerfCounters::NUM_EVENTS; ++e) {
+    EXPECT_LE(before[e], after[e]) << ::plog::PerfCounters::name(e);
+    if (!pc.available(e)) {
+      EXPECT_EQ(0UL, after[e]);
+    }
+  }
+  if (pc.available(::plog::PerfCounters::INSTRUCTIONS)) {
+    EXPECT_LT(before[::plog::PerfCounters::INSTRUCTIONS] + data.size(), after[::plog::PerfCounters::INSTRUCTIONS]);
+  }
+}
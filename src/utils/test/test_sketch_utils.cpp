@@ -0,0 +1,113 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// include google test
+#include <gtest/gtest.h>
+#include "utils/sketch_utils.hpp"
+
+#include <random>
+#include <unordered_map>
+#include <cmath>
+
+
+TEST(HyperLogLogTest, estimate)
+{
+  // sequential values, as from an identity hash, are remixed.
+  for (size_t n : {10UL, 1000UL, 50000UL, 1000000UL}) {
+    ::bliss::utils::sketch::hyperloglog<> hll;
+    for (size_t r = 0; r < 3; ++r) {   // repeats do not change the estimate
+      for (size_t i = 0; i < n; ++i) hll.update(i);
+    }
+    double e = hll.estimate();
+    EXPECT_NEAR(static_cast<double>(n), e, std::max(1.0, 4.0 * hll.error() * n)) << "n=" << n;
+  }
+}
+
+TEST(HyperLogLogTest, merge)
+{
+  ::bliss::utils::sketch::hyperloglog<> a, b, all;
+  for (size_t i = 0; i < 200000; ++i) {
+    // overlapping halves
+    if (i < 120000) a.update(i * 7919);
+    if (i >= 80000) b.update(i * 7919);
+    all.update(i * 7919);
+  }
+  a.merge(b);
+  EXPECT_EQ(all.registers(), a.registers());
+  EXPECT_NEAR(200000.0, a.estimate(), 4.0 * a.error() * 200000.0);
+
+  a.clear();
+  EXPECT_EQ(0.0, a.estimate());
+}
+
+TEST(CountMinTest, never_undercounts)
+{
+  std::default_random_engine generator;
+  std::geometric_distribution<uint64_t> distribution(0.01);
+
+  std::unordered_map<uint64_t, size_t> gold;
+  ::bliss::utils::sketch::count_min<uint8_t> cms(8192, 4);
+  for (size_t i = 0; i < 100000; ++i) {
+    uint64_t v = distribution(generator);
+    ++gold[v];
+    cms.update(v);
+  }
+  cms.update(12345678, 3);
+  gold[12345678] += 3;
+
+  size_t exact = 0;
+  for (auto x : gold) {
+    size_t e = cms.estimate(x.first);
+    EXPECT_GE(e, std::min(x.second, static_cast<size_t>(255)));
+    exact += (e == std::min(x.second, static_cast<size_t>(255)));
+  }
+  // few distinct keys compared to width, so nearly all are exact.
+  EXPECT_GT(exact * 10, gold.size() * 9);
+
+  // absent keys mostly estimate 0
+  size_t zeros = 0;
+  for (uint64_t v = 1UL << 40; v < (1UL << 40) + 1000; ++v) zeros += (cms.estimate(v) == 0);
+  EXPECT_GT(zeros, 900UL);
+}
+
+TEST(BloomFilterTest, membership)
+{
+  size_t n = 100000;
+  ::bliss::utils::sketch::bloom_filter bf(n, 0.01);
+  size_t early = 0;
+  for (size_t i = 0; i < n; ++i) {
+    early += bf.test_and_insert(i * 2);   // first sighting reports present only on false positive
+  }
+  EXPECT_LT(early, n * 2 / 100);
+  // no false negatives
+  for (size_t i = 0; i < n; ++i) {
+    ASSERT_TRUE(bf.test(i * 2));
+    ASSERT_TRUE(bf.test_and_insert(i * 2));
+  }
+  // false positive rate near the configured rate
+  size_t fp = 0;
+  for (size_t i = 0; i < n; ++i) fp += bf.test(i * 2 + 1);
+  EXPECT_LT(fp, n * 2 / 100);
+
+  ::bliss::utils::sketch::bloom_filter other(n, 0.01);
+  other.insert(1);
+  bf.merge(other);
+  EXPECT_TRUE(bf.test(1));
+
+  bf.clear();
+  EXPECT_FALSE(bf.test(2));
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_stage_pipeline.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test the bounded queue and the stage pipeline:  ordering, many producers and consumers, back-pressure,
+ *          the caller stage with an agreement, and errors.
+ * @details
+ */
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// include files to test
+#include "utils/stage_pipeline.hpp"
+
+
+TEST(BoundedQueue, fifo)
+{
+  ::bliss::concurrent::bounded_queue<int> q(5);
+  EXPECT_EQ(8UL, q.capacity());
+
+  for (int i = 0; i < 8; ++i) {
+    int x = i;
+    EXPECT_TRUE(q.try_push(x));
+  }
+  int x = 8;
+  EXPECT_FALSE(q.try_push(x));
+
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_TRUE(q.try_pop(x));
+    EXPECT_EQ(i, x);
+  }
+  EXPECT_FALSE(q.try_pop(x));
+
+  // drained after close.
+  q.push(3);
+  q.close();
+  EXPECT_TRUE(q.pop(x));
+  EXPECT_EQ(3, x);
+  EXPECT_FALSE(q.pop(x));
+}
+
+TEST(BoundedQueue, many_producers_consumers)
+{
+  ::bliss::concurrent::bounded_queue<size_t> q(16);
+  size_t const n = 100000;
+  int const p = 4;
+  q.add_producers(p);
+
+  std::atomic<size_t> sum(0), count(0);
+  std::vector<std::thread> ts;
+  for (int t = 0; t < p; ++t) {
+    ts.emplace_back([&q, t, n, p]() {
+      for (size_t i = t; i < n; i += p) q.push(i);
+      q.remove_producer();
+    });
+    ts.emplace_back([&q, &sum, &count]() {
+      size_t x;
+      while (q.pop(x)) {
+        sum += x;
+        ++count;
+      }
+    });
+  }
+  for (auto & t : ts) t.join();
+
+  EXPECT_EQ(n, count.load());
+  EXPECT_EQ(n * (n - 1) / 2, sum.load());
+}
+
+TEST(StagePipeline, stages)
+{
+  size_t const n = 10000;
+  ::bliss::concurrent::stage_pipeline pipe;
+
+  std::atomic<size_t> next(0);
+  auto q1 = pipe.source<size_t>("read", 2, 8, [&next, n](size_t & x) {
+    x = next++;
+    return x < n;
+  });
+  // drop the odd ones.
+  auto q2 = pipe.stage<size_t, std::vector<size_t> >("parse", 4, q1, 8, [](size_t & x, std::vector<size_t> & y) {
+    y.assign(1, x * 2);
+    return (x & 1) == 0;
+  });
+  size_t sum = 0, items = 0;
+  pipe.sink<std::vector<size_t> >("insert", 0, q2, [&sum, &items](std::vector<size_t> & y) {
+    sum += y[0];
+    ++items;
+  });
+  pipe.run();
+
+  EXPECT_EQ(n / 2, items);
+  EXPECT_EQ(2 * (n / 2) * (n / 2 - 1), sum);
+
+  auto stats = pipe.get_stats();
+  ASSERT_EQ(3UL, stats.size());
+  EXPECT_EQ("read", stats[0].name);
+  EXPECT_EQ(n, stats[0].items);
+  EXPECT_EQ(n, stats[1].items);
+  EXPECT_EQ(n / 2, stats[2].items);
+  EXPECT_EQ(4, stats[1].threads);
+  for (auto const & s : stats) {
+    EXPECT_GE(s.utilization(), 0.0);
+    EXPECT_LE(s.utilization(), 1.01);
+  }
+}
+
+TEST(StagePipeline, back_pressure)
+{
+  // a slow sink holds up the source once the queue is full.
+  ::bliss::concurrent::stage_pipeline pipe;
+  int i = 0;
+  auto q = pipe.source<int>("fast", 1, 2, [&i](int & x) {
+    x = i++;
+    return x < 20;
+  });
+  pipe.sink<int>("slow", 1, q, [](int &) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  });
+  pipe.run();
+
+  auto stats = pipe.get_stats();
+  EXPECT_EQ(20UL, stats[1].items);
+  EXPECT_GT(stats[0].blocked, 0.01);
+  EXPECT_GT(stats[1].busy, 0.03);
+}
+
+TEST(StagePipeline, agreement)
+{
+  // the caller stage runs until the agreement says all are done, on empty items after its input is drained.
+  ::bliss::concurrent::stage_pipeline pipe;
+  int i = 0;
+  auto q = pipe.source<std::vector<int> >("read", 1, 4, [&i](std::vector<int> & x) {
+    x.assign(1, i++);
+    return i <= 3;
+  });
+  int rounds = 0, empty = 0;
+  pipe.sink<std::vector<int> >("exchange", 0, q, [&rounds, &empty](std::vector<int> & x) {
+    ++rounds;
+    if (x.empty()) ++empty;
+  });
+  int drained = 0;
+  pipe.set_agreement([&drained](bool done) {
+    // another process still has 2 rounds to go.
+    if (done) ++drained;
+    return drained > 2;
+  });
+  pipe.run();
+
+  EXPECT_EQ(5, rounds);
+  EXPECT_EQ(2, empty);
+}
+
+TEST(StagePipeline, error)
+{
+  ::bliss::concurrent::stage_pipeline pipe;
+  int i = 0;
+  auto q1 = pipe.source<int>("read", 1, 2, [&i](int & x) {
+    x = i++;
+    return true;   // never done.
+  });
+  auto q2 = pipe.stage<int, int>("parse", 2, q1, 2, [](int & x, int & y) {
+    if (x == 100) throw std::runtime_error("bad input");
+    y = x;
+    return true;
+  });
+  pipe.sink<int>("insert", 1, q2, [](int &) {});
+
+  EXPECT_THROW(pipe.run(), std::runtime_error);
+}
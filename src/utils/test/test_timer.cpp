@@ -0,0 +1,102 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_timer.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test timer nesting and the machine readable timing export.
+ * @details
+ */
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// include files to test
+#include "utils/timer.hpp"
+
+
+void timed_inner() {
+  ::plog::Timer distribute("distribute");
+  distribute.start();
+  distribute.end("bucket", 10);
+  distribute.start();
+  distribute.end("a2a", 20);
+  distribute.report("distribute");
+}
+
+TEST(Timer, nested)
+{
+  ::plog::TimingLog::get().clear();
+  {
+    ::plog::Timer insert("insert");
+    EXPECT_EQ("insert", insert.get_path());
+    insert.start();
+    timed_inner();
+    insert.end("distribute", 30);
+
+    ::plog::Timer local("local_insert");
+    EXPECT_EQ("insert/local_insert", local.get_path());
+  }
+  ::plog::Timer after("query");
+  EXPECT_EQ("query", after.get_path());
+
+  // untitled timers do not nest.
+  ::plog::Timer untitled;
+  EXPECT_EQ("", untitled.get_path());
+  ::plog::Timer child("child");
+  EXPECT_EQ("query/child", child.get_path());
+
+  auto records = ::plog::TimingLog::get().get_records();
+  ASSERT_EQ(2UL, records.size());
+  EXPECT_EQ("insert/distribute", records[0].path);
+  EXPECT_EQ("bucket", records[0].phase);
+  EXPECT_EQ("a2a", records[1].phase);
+  EXPECT_EQ(1, records[1].procs);
+  EXPECT_EQ(20.0, records[1].cnt_max);
+  EXPECT_EQ(records[1].dur_min, records[1].dur_max);
+  EXPECT_EQ(1.0, records[1].imbalance);
+}
+
+TEST(Timer, export)
+{
+  ::plog::TimingLog::get().clear();
+  {
+    ::plog::Timer build("build");
+    build.start();
+    build.end("parse \"reads\"", 5);
+    build.report("build");
+  }
+
+  std::ostringstream json;
+  ::plog::TimingLog::get().write_json(json);
+  std::string j = json.str();
+  EXPECT_EQ('[', j[0]);
+  EXPECT_NE(std::string::npos, j.find("\"path\": \"build\""));
+  EXPECT_NE(std::string::npos, j.find("\"phase\": \"parse \\\"reads\\\"\""));
+  EXPECT_NE(std::string::npos, j.find("\"imbalance\": 1.000000000"));
+
+  std::ostringstream csv;
+  ::plog::TimingLog::get().write_csv(csv);
+  std::string c = csv.str();
+  EXPECT_EQ(0UL, c.find("path,title,phase,procs,dur_min,dur_max,dur_mean,dur_stdev,imbalance,"));
+  EXPECT_EQ(2, std::count(c.begin(), c.end(), '\n'));
+}
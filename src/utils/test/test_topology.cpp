@@ -0,0 +1,91 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_topology.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   tests thread placement policies and pinning.
+ * @details the machine's topology is unknown, so the checks are on properties that hold for any topology.
+ *
+ */
+
+#include "utils/topology.hpp"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "bliss-config.hpp"
+
+using namespace ::bliss::utils::topology;
+
+TEST(Topology, allowed) {
+  std::vector<int> cpus = allowed_cpus();
+  ASSERT_FALSE(cpus.empty());
+  EXPECT_TRUE(std::find(cpus.begin(), cpus.end(), current_cpu()) != cpus.end());
+
+  location l = locate(cpus[0]);
+  EXPECT_EQ(cpus[0], l.cpu);
+}
+
+TEST(Topology, assign) {
+  std::vector<int> cpus = allowed_cpus();
+  int n = cpus.size();
+
+  EXPECT_TRUE(assign(cpus, n, NONE).empty());
+
+  for (policy p : {COMPACT, SCATTER}) {
+    // one thread per cpu:  a permutation of the cpus.
+    std::vector<int> a = assign(cpus, n, p);
+    ASSERT_EQ(cpus.size(), a.size());
+    std::sort(a.begin(), a.end());
+    EXPECT_TRUE(a == cpus) << to_string(p);
+
+    // more threads than cpus wrap around.
+    a = assign(cpus, 2 * n + 1, p);
+    ASSERT_EQ(static_cast<size_t>(2 * n + 1), a.size());
+    for (int c : a) EXPECT_TRUE(std::find(cpus.begin(), cpus.end(), c) != cpus.end());
+  }
+
+  // compact fills a node before the next, so the node changes once per node.
+  std::vector<int> c = assign(cpus, n, COMPACT);
+  int changes = 0;
+  for (int i = 1; i < n; ++i) changes += (locate(c[i - 1]).numa_node != locate(c[i]).numa_node);
+  std::vector<int> nodes;
+  for (int x : cpus) nodes.push_back(locate(x).numa_node);
+  std::sort(nodes.begin(), nodes.end());
+  int nnodes = std::unique(nodes.begin(), nodes.end()) - nodes.begin();
+  EXPECT_EQ(nnodes - 1, changes);
+}
+
+TEST(Topology, pin) {
+  std::vector<int> cpus = allowed_cpus();
+
+  // pin to the last allowed cpu, then restore.
+  ASSERT_TRUE(pin_thread(cpus.back()));
+  EXPECT_EQ(cpus.back(), current_cpu());
+  EXPECT_EQ(1UL, allowed_cpus().size());
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int c : cpus) CPU_SET(c, &set);
+  ASSERT_EQ(0, sched_setaffinity(0, sizeof(cpu_set_t), &set));
+
+  std::vector<int> t = pin_omp_threads(NONE);
+  EXPECT_FALSE(t.empty());
+  EXPECT_NE(std::string::npos, describe(t).find("threads 0:"));
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_tracking_allocator.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test the per tag allocation counts of tracking_allocator.
+ * @details
+ */
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <unordered_map>
+#include <vector>
+
+// include files to test
+#include "utils/tracking_allocator.hpp"
+
+struct test_tag {
+    static char const * name() { return "test"; }
+};
+
+TEST(TrackingAllocator, vector)
+{
+  ::plog::alloc::tracker & tr = ::plog::alloc::tracker::get();
+  int t = ::plog::alloc::tag_id<test_tag>();
+  EXPECT_EQ(tr.tag("test"), t);
+  EXPECT_EQ(::plog::alloc::tracker::BUFFER, ::plog::alloc::tag_id<::plog::alloc::buffer_tag>());
+
+  int64_t base = tr.current(t);
+  {
+    ::plog::tracked_vector<uint64_t, test_tag> v;
+    v.reserve(1000);
+    EXPECT_EQ(base + 8000, tr.current(t));
+    {
+      ::plog::tracked_vector<uint64_t, test_tag> w(500);
+      EXPECT_EQ(base + 12000, tr.current(t));
+    }
+    EXPECT_EQ(base + 8000, tr.current(t));
+    EXPECT_LE(base + 12000, tr.peak_bytes(t));
+  }
+  EXPECT_EQ(base, tr.current(t));
+}
+
+TEST(TrackingAllocator, window)
+{
+  ::plog::alloc::tracker & tr = ::plog::alloc::tracker::get();
+  int t = ::plog::alloc::tag_id<::plog::alloc::table_tag>();
+
+  int outer = tr.open_window();
+  ASSERT_LE(0, outer);
+  int64_t base = tr.current(t);
+  {
+    // node allocations of the map are counted through rebind.
+    std::unordered_map<int, int, std::hash<int>, std::equal_to<int>,
+      ::plog::tracking_allocator<std::pair<const int, int>, ::plog::alloc::table_tag> > m;
+    for (int i = 0; i < 100; ++i) m[i] = i;
+    EXPECT_LT(base, tr.current(t));
+  }
+  EXPECT_EQ(base, tr.current(t));
+  int64_t map_peak = tr.window_peak(outer, t);
+  EXPECT_LT(base + 100 * static_cast<int64_t>(sizeof(std::pair<const int, int>)), map_peak);
+
+  // restarting forgets the map.
+  tr.restart_window(outer);
+  int inner = tr.open_window();
+  ASSERT_LE(0, inner);
+  EXPECT_NE(outer, inner);
+  {
+    ::plog::tracked_vector<char, ::plog::alloc::table_tag> v(64);
+  }
+  EXPECT_EQ(base + 64, tr.window_peak(outer, t));
+  EXPECT_EQ(base + 64, tr.window_peak(inner, t));
+  tr.close_window(inner);
+
+  // closed windows are not updated.
+  {
+    ::plog::tracked_vector<char, ::plog::alloc::table_tag> v(128);
+  }
+  EXPECT_EQ(base + 64, tr.window_peak(inner, t));
+  EXPECT_EQ(base + 128, tr.window_peak(outer, t));
+  tr.close_window(outer);
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_tsc_clock.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test that tsc_clock is monotonic and agrees with steady_clock, with or without the TSC.
+ * @details
+ */
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+// include files to test
+#include "utils/tsc_clock.hpp"
+
+
+TEST(TscClock, monotonic)
+{
+  if (!::plog::tsc_clock::available()) printf("invariant TSC not available.  testing the steady_clock fallback.\n");
+  else printf("TSC at %f GHz\n", ::plog::tsc_clock::frequency() * 1e-9);
+
+  ::plog::tsc_clock::time_point t = ::plog::tsc_clock::now();
+  for (int i = 0; i < 100000; ++i) {
+    ::plog::tsc_clock::time_point t2 = ::plog::tsc_clock::now();
+    EXPECT_LE(t, t2);
+    t = t2;
+  }
+}
+
+TEST(TscClock, matches_steady_clock)
+{
+  // same epoch.
+  auto s1 = std::chrono::steady_clock::now();
+  auto t1 = ::plog::tsc_clock::now();
+  auto off = ::plog::tsc_clock::to_steady(t1) - s1;
+  EXPECT_LT(std::chrono::duration_cast<std::chrono::microseconds>(off < off.zero() ? -off : off).count(), 1000);
+
+  // same rate, within 2% over 50 ms.
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  auto s2 = std::chrono::steady_clock::now();
+  auto t2 = ::plog::tsc_clock::now();
+
+  double ds = std::chrono::duration_cast<std::chrono::duration<double> >(s2 - s1).count();
+  double dt = std::chrono::duration_cast<std::chrono::duration<double> >(t2 - t1).count();
+  EXPECT_NEAR(ds, dt, ds * 0.02);
+}
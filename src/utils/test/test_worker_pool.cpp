@@ -0,0 +1,194 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_worker_pool.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test the worker pool:  each tid runs once per loop, on the same threads every loop, range splits, tasks,
+ *          errors, nested loops, and the container loops on the current pool.
+ * @details
+ */
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// include files to test
+#include "utils/worker_pool.hpp"
+#include "containers/fsc_container_utils.hpp"
+
+using ::bliss::concurrent::worker_pool;
+
+
+TEST(WorkerPool, run)
+{
+  worker_pool pool(4, ::bliss::utils::topology::NONE);
+  ASSERT_EQ(4UL, pool.size());
+
+  std::vector<std::thread::id> first(4);
+  pool.run([&first](int tid) { first[tid] = std::this_thread::get_id(); });
+  EXPECT_EQ(std::this_thread::get_id(), first[0]);
+  EXPECT_EQ(4UL, std::set<std::thread::id>(first.begin(), first.end()).size());
+
+  // many small loops, on the same threads.
+  for (int i = 0; i < 2000; ++i) {
+    std::vector<int> seen(4, 0);
+    std::vector<std::thread::id> ids(4);
+    pool.run([&seen, &ids](int tid) { ++seen[tid]; ids[tid] = std::this_thread::get_id(); });
+    ASSERT_EQ(std::vector<int>(4, 1), seen) << "loop " << i;
+    ASSERT_EQ(first, ids) << "loop " << i;
+  }
+
+  // more tids than threads, and fewer.
+  std::vector<std::atomic<int> > seen(11);
+  for (auto & s : seen) s = 0;
+  pool.run(11, [&seen](int tid) { ++seen[tid]; });
+  for (auto & s : seen) EXPECT_EQ(1, s.load());
+  std::atomic<int> two(0);
+  pool.run(2, [&two](int) { ++two; });
+  EXPECT_EQ(2, two.load());
+}
+
+TEST(WorkerPool, parallel_for)
+{
+  worker_pool pool(3, ::bliss::utils::topology::NONE);
+  for (size_t n : {0UL, 1UL, 2UL, 3UL, 10UL, 1000UL}) {
+    std::vector<int> hits(n, 0);
+    std::atomic<size_t> parts(0);
+    pool.parallel_for(::bliss::partition::range<size_t>(5, 5 + n), [&hits, &parts](::bliss::partition::range<size_t> const & r, int) {
+      ++parts;
+      for (size_t i = r.start; i < r.end; ++i) ++hits[i - 5];
+    });
+    EXPECT_EQ(std::vector<int>(n, 1), hits) << "n " << n;
+    EXPECT_EQ(std::min(std::max(n, 1UL), 3UL), parts.load());
+  }
+}
+
+TEST(WorkerPool, submit)
+{
+  worker_pool pool(3, ::bliss::utils::topology::NONE);
+  std::vector<std::future<int> > results;
+  for (int i = 0; i < 100; ++i) results.emplace_back(pool.submit([i]() { return i * i; }));
+  for (int i = 0; i < 100; ++i) EXPECT_EQ(i * i, results[i].get());
+
+  auto bad = pool.submit([]() -> int { throw std::runtime_error("task"); });
+  EXPECT_THROW(bad.get(), std::runtime_error);
+
+  worker_pool single(1, ::bliss::utils::topology::NONE);
+  EXPECT_EQ(7, single.submit([]() { return 7; }).get());
+}
+
+TEST(WorkerPool, errors)
+{
+  worker_pool pool(4, ::bliss::utils::topology::NONE);
+  std::atomic<int> ran(0);
+  EXPECT_THROW(pool.run([&ran](int tid) {
+    ++ran;
+    if (tid == 2) throw std::runtime_error("worker");
+  }), std::runtime_error);
+  EXPECT_EQ(4, ran.load());
+
+  // still usable.
+  ran = 0;
+  pool.run([&ran](int) { ++ran; });
+  EXPECT_EQ(4, ran.load());
+}
+
+TEST(WorkerPool, nested)
+{
+  worker_pool pool(3, ::bliss::utils::topology::NONE);
+  std::vector<std::atomic<int> > inner(9);
+  for (auto & s : inner) s = 0;
+  pool.run([&pool, &inner](int outer) {
+    std::thread::id me = std::this_thread::get_id();
+    EXPECT_EQ(1, ::bliss::concurrent::region_threads());
+    pool.run([&inner, outer, me](int tid) {
+      EXPECT_EQ(me, std::this_thread::get_id());
+      ++inner[outer * 3 + tid];
+    });
+  });
+  for (auto & s : inner) EXPECT_EQ(1, s.load());
+}
+
+TEST(WorkerPool, scope)
+{
+  worker_pool pool(4, ::bliss::utils::topology::NONE);
+  EXPECT_EQ(nullptr, worker_pool::current());
+  {
+    worker_pool::scope s(&pool);
+    EXPECT_EQ(&pool, worker_pool::current());
+    EXPECT_EQ(4, ::bliss::concurrent::region_threads());
+    EXPECT_EQ(4, ::fsc::detail::scan_threads(1UL << 20));
+
+    // the container loops run on the pool's threads.
+    std::vector<std::thread::id> ids(4);
+    pool.run([&ids](int tid) { ids[tid] = std::this_thread::get_id(); });
+    std::mutex m;
+    std::set<std::thread::id> used;
+    size_t n = 1000;
+    std::vector<int> hits(n, 0);
+    ::fsc::detail::for_each_part(n, 4, [&](size_t first, size_t last, int tid) {
+      for (size_t i = first; i < last; ++i) ++hits[i];
+      std::lock_guard<std::mutex> lock(m);
+      used.insert(std::this_thread::get_id());
+      EXPECT_EQ(ids[tid], std::this_thread::get_id());
+    });
+    EXPECT_EQ(std::vector<int>(n, 1), hits);
+    EXPECT_EQ(4UL, used.size());
+
+    {
+      worker_pool::scope none(nullptr);
+      EXPECT_EQ(nullptr, worker_pool::current());
+    }
+    EXPECT_EQ(&pool, worker_pool::current());
+  }
+  EXPECT_EQ(nullptr, worker_pool::current());
+}
+
+TEST(WorkerPool, worker_local)
+{
+  worker_pool pool(3, ::bliss::utils::topology::NONE);
+  worker_pool::scope s(&pool);
+
+  ::bliss::concurrent::worker_local<std::vector<int> > scratch;
+  ASSERT_EQ(3UL, scratch.size());
+  for (int round = 0; round < 10; ++round) {
+    ::bliss::concurrent::parallel_region(3, [&scratch](int tid) { scratch[tid].push_back(tid); });
+  }
+  for (int t = 0; t < 3; ++t) EXPECT_EQ(std::vector<int>(10, t), scratch[t]);
+}
+
+TEST(WorkerPool, pinned)
+{
+  std::vector<int> cpus = ::bliss::utils::topology::allowed_cpus();
+  worker_pool pool(static_cast<int>(std::min(cpus.size(), 4UL)), ::bliss::utils::topology::COMPACT);
+  ASSERT_EQ(pool.size(), pool.cpus().size());
+  EXPECT_EQ(-1, pool.cpus()[0]);
+
+  std::vector<int> actual(pool.size(), -1);
+  pool.run([&actual](int tid) { actual[tid] = ::bliss::utils::topology::current_cpu(); });
+  for (size_t t = 1; t < pool.size(); ++t) {
+    EXPECT_NE(cpus.end(), std::find(cpus.begin(), cpus.end(), pool.cpus()[t]));
+    EXPECT_EQ(pool.cpus()[t], actual[t]);
+  }
+}
@@ -18,8 +18,20 @@
  * @file    timer.hpp
  * @ingroup
  * @author  tpan
- * @brief
- * @details
+ * @brief   phase timers for benchmarking, reported as text per rank or reduced across ranks.
+ * @details timers nest by scope:  a Timer constructed while another is alive is a child of it, and its phases are
+ *          recorded under the path "parent/child".  reports are also kept in the TimingLog, which can be written
+ *          as JSON or CSV for dashboards, e.g. via BL_TIMER_EXPORT(filename) at the end of main.
+ *
+ *          when BL_BENCHMARK_HWC is 1, start/end sections also count cycles, instructions, LLC misses and dTLB
+ *          misses of the calling thread (see perf_counters.hpp), reported as extra hw_* rows.  barrier and loop
+ *          sections are not counted and report 0.
+ *
+ *          when BL_BENCHMARK_TRACE is 1, start/end sections and barriers are also recorded as timeline events
+ *          (see event_trace.hpp).  loop sections are not.
+ *
+ *          when BL_BENCHMARK_TSC is 1, all sections are timed with tsc_clock, i.e. rdtscp with a calibrated rate,
+ *          instead of steady_clock (see tsc_clock.hpp), so that per batch sections in inner loops cost less.
  *
  */
 #ifndef SRC_UTILS_TIMER_HPP_
@@ -36,37 +48,289 @@
 #include <string>
 #include <algorithm>  // std::min
 #include <sstream>
+#include <fstream>
+#include <iterator>
 #include <cmath>
+#include <cstdio>
+#include <mutex>
 
 #include <mxx/reduction.hpp>
 
+#include "utils/perf_counters.hpp"
+#if BL_BENCHMARK_TSC == 1
+#include "utils/tsc_clock.hpp"
+#endif
+#if BL_BENCHMARK_TRACE == 1
+#include "utils/event_trace.hpp"
+#endif
+
 
 namespace plog {
 
+/// clock of the timers.
+#if BL_BENCHMARK_TSC == 1
+typedef tsc_clock bench_clock;
+#else
+typedef std::chrono::steady_clock bench_clock;
+#endif
+
+/// one reported phase.  min/max/mean/stdev are across ranks, and equal to the local values for a serial report.
+struct timing_record {
+    /// timer scope path, e.g. "insert/distribute".
+    std::string path;
+    /// title passed to report.
+    std::string title;
+    std::string phase;
+    int procs;
+    double dur_min, dur_max, dur_mean, dur_stdev;
+    /// dur_max / dur_mean.  1 for a perfectly balanced phase.  large values point to stragglers.
+    double imbalance;
+    double cnt_min, cnt_max, cnt_mean;
+    /// true if hw holds hardware counter values.
+    bool has_hw;
+    /// mean across ranks of each PerfCounters event.
+    double hw[PerfCounters::NUM_EVENTS];
+};
+
+/**
+ * @brief process wide collection of timer reports, for export in a machine readable format.
+ * @details  MPI reports are recorded on rank 0 only.  thread safe.
+ */
+class TimingLog {
+  protected:
+    std::vector<timing_record> records;
+    mutable std::mutex mutex;
+
+    TimingLog() {}
+
+    static std::string escape(std::string const & str) {
+      std::string out;
+      for (char c : str) {
+        if (c == '"' || c == '\\') out.push_back('\\');
+        out.push_back(c);
+      }
+      return out;
+    }
+
+  public:
+    static TimingLog & get() {
+      static TimingLog log;
+      return log;
+    }
+
+    void add(timing_record const & r) {
+      std::lock_guard<std::mutex> lock(mutex);
+      records.push_back(r);
+    }
+
+    void clear() {
+      std::lock_guard<std::mutex> lock(mutex);
+      records.clear();
+    }
+
+    std::vector<timing_record> get_records() const {
+      std::lock_guard<std::mutex> lock(mutex);
+      return records;
+    }
+
+    void write_json(std::ostream & os) const {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::ostringstream out;
+      out.precision(9);
+      out << std::fixed << "[" << std::endl;
+      for (size_t i = 0; i < records.size(); ++i) {
+        timing_record const & r = records[i];
+        out << "  {\"path\": \"" << escape(r.path) << "\", \"title\": \"" << escape(r.title) <<
+            "\", \"phase\": \"" << escape(r.phase) << "\", \"procs\": " << r.procs <<
+            ", \"dur_min\": " << r.dur_min << ", \"dur_max\": " << r.dur_max <<
+            ", \"dur_mean\": " << r.dur_mean << ", \"dur_stdev\": " << r.dur_stdev <<
+            ", \"imbalance\": " << r.imbalance <<
+            ", \"cnt_min\": " << r.cnt_min << ", \"cnt_max\": " << r.cnt_max << ", \"cnt_mean\": " << r.cnt_mean;
+        if (r.has_hw) {
+          for (int e = 0; e < PerfCounters::NUM_EVENTS; ++e) out << ", \"" << PerfCounters::name(e) << "\": " << r.hw[e];
+        }
+        out << "}" << (i + 1 < records.size() ? "," : "") << std::endl;
+      }
+      out << "]" << std::endl;
+      os << out.str();
+    }
+
+    void write_csv(std::ostream & os) const {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::ostringstream out;
+      out.precision(9);
+      out << std::fixed << "path,title,phase,procs,dur_min,dur_max,dur_mean,dur_stdev,imbalance,cnt_min,cnt_max,cnt_mean";
+      for (int e = 0; e < PerfCounters::NUM_EVENTS; ++e) out << "," << PerfCounters::name(e);
+      out << std::endl;
+      for (auto const & r : records) {
+        out << "\"" << r.path << "\",\"" << r.title << "\",\"" << r.phase << "\"," << r.procs << "," <<
+            r.dur_min << "," << r.dur_max << "," << r.dur_mean << "," << r.dur_stdev << "," << r.imbalance << "," <<
+            r.cnt_min << "," << r.cnt_max << "," << r.cnt_mean;
+        // empty fields without hardware counters.
+        for (int e = 0; e < PerfCounters::NUM_EVENTS; ++e) {
+          out << ",";
+          if (r.has_hw) out << r.hw[e];
+        }
+        out << std::endl;
+      }
+      os << out.str();
+    }
+
+    /// write to file, as CSV if the name ends with ".csv", else as JSON.
+    void write(std::string const & filename) const {
+      std::ofstream ofs(filename);
+      if (!ofs.is_open()) {
+        fprintf(stderr, "ERROR: cannot open timing output file %s\n", filename.c_str());
+        return;
+      }
+      if (filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".csv") == 0) write_csv(ofs);
+      else write_json(ofs);
+    }
+};
+
+
 class Timer {
   protected:
-    std::chrono::steady_clock::time_point first, t1, t2;
+    /// paths of the live timers in this thread, innermost last.
+    static std::vector<std::string> & scopes() {
+      static thread_local std::vector<std::string> s;
+      return s;
+    }
+
+    /// path of this timer.  empty for a timer without title, which does not take part in nesting.
+    std::string path;
+
+    bench_clock::time_point first, t1, t2;
     std::vector<std::string> names;
     std::vector<double> durations;
     std::vector<double> cumulative;
     std::vector<double> counts;
     std::chrono::duration<double> time_span;
 
-    std::unordered_map<size_t, std::chrono::steady_clock::time_point> loop_t1;
+    std::unordered_map<size_t, bench_clock::time_point> loop_t1;
     std::unordered_map<size_t, std::chrono::duration<double> > loop_span;
 
+#if BL_BENCHMARK_HWC == 1
+    /// counters are per thread running totals, so 1 set is shared by all timers of a thread.
+    static PerfCounters & hw() {
+      static thread_local PerfCounters pc;
+      return pc;
+    }
+    uint64_t hw_t1[PerfCounters::NUM_EVENTS];
+    std::vector<double> hw_counts[PerfCounters::NUM_EVENTS];
+#endif
+
+    void hw_start() {
+#if BL_BENCHMARK_HWC == 1
+      hw().read(hw_t1);
+#endif
+    }
+    /// append the counts since hw_start, or 0 if the section is not counted.
+    void hw_end(bool const & counted) {
+#if BL_BENCHMARK_HWC == 1
+      uint64_t hw_t2[PerfCounters::NUM_EVENTS];
+      if (counted) hw().read(hw_t2);
+      for (int e = 0; e < PerfCounters::NUM_EVENTS; ++e) {
+        hw_counts[e].push_back(counted ? static_cast<double>(hw_t2[e] - hw_t1[e]) : 0.0);
+      }
+#endif
+    }
+
+    /// the same instant on steady_clock.  bench_clock shares its epoch.
+    static std::chrono::steady_clock::time_point to_steady(bench_clock::time_point const & t) {
+      return std::chrono::steady_clock::time_point(
+          std::chrono::duration_cast<std::chrono::steady_clock::duration>(t.time_since_epoch()));
+    }
+
+    /// add the section [t1, t2) to the event trace, under this timer's path.
+    void trace(::std::string const & name) const {
+#if BL_BENCHMARK_TRACE == 1
+      ::plog::EventTrace::get().complete(name, path.empty() ? ::std::string("bench") : path, to_steady(t1), to_steady(t2));
+#endif
+    }
+
+    /// print rows of hardware counts, 1 per event.
+    void hw_print(std::ostream & output, ::std::string const & title, char const * suffix,
+                  std::vector<double> const * values) const {
+#if BL_BENCHMARK_HWC == 1
+      if (!hw().available()) return;
+      std::ostream_iterator<double> dit(output, ",");
+      output.precision(0);
+      for (int e = 0; e < PerfCounters::NUM_EVENTS; ++e) {
+        output << std::endl << "[TIME] " << title << "\thw_" << PerfCounters::name(e) << suffix << "\t[,";
+        std::copy(values[e].begin(), values[e].end(), dit);
+        output << "]";
+      }
+#endif
+    }
+
+    static double imbalance(double const & max, double const & mean) {
+      return (mean > 0.0) ? (max / mean) : 1.0;
+    }
+
+    void record(::std::string const & title, int p,
+                std::vector<double> const & dur_mins, std::vector<double> const & dur_maxs,
+                std::vector<double> const & dur_means, std::vector<double> const & dur_stdevs,
+                std::vector<double> const & cnt_mins, std::vector<double> const & cnt_maxs,
+                std::vector<double> const & cnt_means, std::vector<double> const * hw_means) const {
+      for (size_t i = 0; i < names.size() && i < dur_mins.size(); ++i) {
+        timing_record r;
+        r.path = path.empty() ? title : path;
+        r.title = title;
+        r.phase = names[i];
+        r.procs = p;
+        r.dur_min = dur_mins[i];
+        r.dur_max = dur_maxs[i];
+        r.dur_mean = dur_means[i];
+        r.dur_stdev = dur_stdevs[i];
+        r.imbalance = imbalance(dur_maxs[i], dur_means[i]);
+        r.cnt_min = cnt_mins[i];
+        r.cnt_max = cnt_maxs[i];
+        r.cnt_mean = cnt_means[i];
+        r.has_hw = (hw_means != nullptr) && (hw_means[0].size() > i);
+        for (int e = 0; e < PerfCounters::NUM_EVENTS; ++e) r.hw[e] = r.has_hw ? hw_means[e][i] : 0.0;
+        TimingLog::get().add(r);
+      }
+    }
+
   public:
     Timer() {
     	reset();
     }
 
+    /// named timer, nested under the innermost live named timer of this thread.
+    explicit Timer(::std::string const & title) {
+      std::vector<std::string> & s = scopes();
+      path = s.empty() ? title : (s.back() + "/" + title);
+      s.push_back(path);
+      reset();
+    }
+
+    ~Timer() {
+      if (path.empty()) return;
+      // timers are scoped locals, so this is normally the back.
+      std::vector<std::string> & s = scopes();
+      auto it = std::find(s.rbegin(), s.rend(), path);
+      if (it != s.rend()) s.erase(std::next(it).base());
+    }
+
+    Timer(Timer const & other) = delete;
+    Timer & operator=(Timer const & other) = delete;
+
+    ::std::string const & get_path() const {
+      return path;
+    }
+
     void reset() {
       names.clear();
       durations.clear();
       cumulative.clear();
       counts.clear();
+#if BL_BENCHMARK_HWC == 1
+      for (int e = 0; e < PerfCounters::NUM_EVENTS; ++e) hw_counts[e].clear();
+#endif
 
-      first = std::chrono::steady_clock::now();
+      first = bench_clock::now();
       loop_t1.clear();
       loop_span.clear();
     }
@@ -75,52 +339,61 @@ class Timer {
 //=========== loop stuff.
     void loop_start(size_t const & id) {
       loop_span[id] = std::chrono::duration<double>::zero();
-      loop_t1[id] = std::chrono::steady_clock::now();
+      loop_t1[id] = bench_clock::now();
     }
     void loop_resume(size_t const & id) {
-      loop_t1[id] = std::chrono::steady_clock::now();
+      loop_t1[id] = bench_clock::now();
     }
     void loop_pause(size_t const & id) {
-      std::chrono::steady_clock::time_point lt2 = std::chrono::steady_clock::now();
+      bench_clock::time_point lt2 = bench_clock::now();
     	loop_span[id] += (std::chrono::duration_cast<std::chrono::duration<double> >(lt2 - loop_t1[id]));
     }
     void loop_end(size_t const & id, ::std::string const & name, double const & n_elem) {
     	names.push_back(name);
     	durations.push_back(loop_span[id].count());
-        std::chrono::steady_clock::time_point lt2 = std::chrono::steady_clock::now();
+        bench_clock::time_point lt2 = bench_clock::now();
     	cumulative.push_back((std::chrono::duration_cast<std::chrono::duration<double> >(lt2 - first)).count());
     	counts.push_back(n_elem);
+    	hw_end(false);
 
     	loop_span.erase(id);
     	loop_t1.erase(id);
     }
 
 //============ timer start
-    void start() { t1 = std::chrono::steady_clock::now(); }
+    void start() {
+      t1 = bench_clock::now();
+      hw_start();
+    }
     void collective_start(::std::string const & name, ::mxx::comm const & comm) {
 
       // time a barrier.
-      t1 = std::chrono::steady_clock::now();
+      t1 = bench_clock::now();
       comm.barrier();
-      t2 = std::chrono::steady_clock::now();
+      t2 = bench_clock::now();
       time_span = (std::chrono::duration_cast<std::chrono::duration<double> >(t2 - t1));
 
       ::std::string tmp("barrier_"); tmp.append(name);
+      trace(tmp);
       names.push_back(tmp);
       durations.push_back(time_span.count());
       cumulative.push_back((std::chrono::duration_cast<std::chrono::duration<double> >(t2 - first)).count());
       counts.push_back(0);
+      hw_end(false);
 
-      t1 = std::chrono::steady_clock::now();
+      t1 = bench_clock::now();
+      hw_start();
     }
     void end(::std::string const & name, double const & n_elem) {
-      t2 = std::chrono::steady_clock::now();
+      t2 = bench_clock::now();
       time_span = (std::chrono::duration_cast<std::chrono::duration<double> >(t2 - t1));
+      trace(name);
 
       names.push_back(name);
       durations.push_back(time_span.count());
       cumulative.push_back((std::chrono::duration_cast<std::chrono::duration<double> >(t2 - first)).count());
       counts.push_back(n_elem);
+      hw_end(true);
     }
     void collective_end(::std::string const & name, double const & n_elem, ::mxx::comm const & comm) {
 
@@ -155,6 +428,16 @@ class Timer {
         std::copy(counts.begin(), counts.end(), dit);
         output << "]";
 
+#if BL_BENCHMARK_HWC == 1
+        hw_print(output, title, "", hw_counts);
+        std::vector<double> const * hw_means = hw().available() ? hw_counts : nullptr;
+#else
+        std::vector<double> const * hw_means = nullptr;
+#endif
+
+        record(title, 1, durations, durations, durations, std::vector<double>(durations.size(), 0.0),
+               counts, counts, counts, hw_means);
+
         // print pending stuff, then print entire string at once (minimizes multiple threads/processes mixing output )
         fflush(stdout);
         printf("%s\n", output.str().c_str());
@@ -266,6 +549,7 @@ class Timer {
       std::vector<double> dur_mins, dur_maxs, dur_means, dur_stdevs;
       std::vector<double> cum_mins, cum_maxs, cum_means, cum_stdevs;
       std::vector<double> cnt_mins, cnt_maxs, cnt_means, cnt_stdevs;
+      std::vector<double> hw_maxs[PerfCounters::NUM_EVENTS], hw_means[PerfCounters::NUM_EVENTS];
       int p = comm.size();
       int rank = comm.rank();
 
@@ -297,8 +581,20 @@ class Timer {
         ::std::for_each(counts.begin(), counts.end(), [](double &x) { x = x*x; });
         cnt_stdevs = ::mxx::reduce(counts, 0, ::std::plus<double>(), comm);
 
+#if BL_BENCHMARK_HWC == 1
+        for (int e = 0; e < PerfCounters::NUM_EVENTS; ++e) {
+          hw_maxs[e] = ::mxx::reduce(hw_counts[e], 0,
+                                     [](double const & x, double const & y) { return ::std::max(x, y); }, comm);
+          hw_means[e] = ::mxx::reduce(hw_counts[e], 0, ::std::plus<double>(), comm);
+        }
+#endif
+
         if (rank == 0) {
 
+          for (int e = 0; e < PerfCounters::NUM_EVENTS; ++e) {
+            ::std::for_each(hw_means[e].begin(), hw_means[e].end(), [&p](double & x) { x /= p; });
+          }
+
           ::std::for_each(dur_means.begin(), dur_means.end(), [&p](double & x) { x /= p; });
           ::std::transform(dur_stdevs.begin(), dur_stdevs.end(), dur_means.begin(), dur_stdevs.begin(),
                            [&p](double const & x, double const & y) { return ::std::sqrt(x / p - y * y); });
@@ -345,6 +641,10 @@ class Timer {
           std::copy(dur_stdevs.begin(), dur_stdevs.end(), dit);
           output << "]" << std::endl;
 
+          output << "[TIME] " << title << "\tdur_imbalance\t[,";
+          std::transform(dur_maxs.begin(), dur_maxs.end(), dur_means.begin(), dit, &Timer::imbalance);
+          output << "]" << std::endl;
+
 
           output.precision(9);
           output << "[TIME] " << title << "\tcum_min2\t[,";
@@ -382,6 +682,16 @@ class Timer {
           std::copy(cnt_stdevs.begin(), cnt_stdevs.end(), dit);
           output << "]";
 
+          hw_print(output, title, "_mean", hw_means);
+          hw_print(output, title, "_max", hw_maxs);
+
+#if BL_BENCHMARK_HWC == 1
+          record(title, p, dur_mins, dur_maxs, dur_means, dur_stdevs, cnt_mins, cnt_maxs, cnt_means,
+                 hw().available() ? hw_means : nullptr);
+#else
+          record(title, p, dur_mins, dur_maxs, dur_means, dur_stdevs, cnt_mins, cnt_maxs, cnt_means, nullptr);
+#endif
+
           fflush(stdout);
           printf("%s\n", output.str().c_str());
           fflush(stdout);
@@ -395,7 +705,7 @@ class Timer {
 
 #if BL_BENCHMARK_TIME == 1
 
-#define BL_TIMER_INIT(title)      ::plog::Timer title##_timer;
+#define BL_TIMER_INIT(title)      ::plog::Timer title##_timer(#title);
 #define BL_TIMER_RESET(title)     do { title##_timer.reset(); } while (0)
 
 #define BL_TIMER_LOOP_START(title, id)     do { title##_timer.loop_start(id); } while (0)
@@ -418,6 +728,9 @@ class Timer {
 #define BL_TIMER_REPORT_MPI(title, comm) do { title##_timer.report(#title, comm); } while (0)
 #define BL_TIMER_REPORT_MPI_NAMED(title, name, comm) do { title##_timer.report(name, comm); } while (0)
 
+// write all reports so far to a JSON file, or CSV if filename ends with .csv.  call on rank 0 for MPI reports.
+#define BL_TIMER_EXPORT(filename) do { ::plog::TimingLog::get().write(filename); } while (0)
+
 
 #else
 
@@ -435,6 +748,7 @@ class Timer {
 #define BL_TIMER_REPORT_MPI(title, comm)
 #define BL_TIMER_REPORT_NAMED(title, name)
 #define BL_TIMER_REPORT_MPI_NAMED(title, name, comm)
+#define BL_TIMER_EXPORT(filename)
 
 #endif
 
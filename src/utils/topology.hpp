@@ -0,0 +1,332 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    topology.hpp
+ * @ingroup utils
+ * @author  tpan
+ * @brief   where ranks and threads run (core, socket, NUMA node), and pinning of the OpenMP threads.
+ * @details on a multi socket node, throughput depends on where the MPI launcher puts the ranks and where the OS puts
+ *          the threads.  this reports the placement, and pins the OpenMP threads of a rank within the CPUs the launcher
+ *          gave it, so that the parallel parsing and insert loops run on fixed cores:
+ *
+ *      COMPACT   threads fill the rank's cores in (socket, NUMA node, core) order, one hardware thread per core before
+ *                the second hyperthreads.  threads share the caches and memory of as few nodes as possible.
+ *      SCATTER   threads round robin over the rank's NUMA nodes, then cores.  more memory bandwidth.
+ *      NONE      leave the threads to the OS.
+ *
+ *          the policy comes from the BLISS_PIN_THREADS environment variable (compact, scatter, none) in
+ *          policy_from_env(), so launch scripts can change it without rebuilding.  pin_omp_threads pins the current
+ *          OpenMP thread pool.  libgomp and libiomp reuse the pool threads, so later parallel regions with at most
+ *          omp_get_max_threads() threads run on the same CPUs.
+ *
+ *          with USE_HWLOC, the topology comes from hwloc.  otherwise from /sys/devices/system/cpu, which has the same
+ *          information on linux but misses e.g. sub-NUMA clustering on some kernels.
+ *
+ *          to keep a rank's local map on its own node, use fsc::numa_allocator with numa::BIND_LOCAL after pinning.
+ */
+#ifndef SRC_UTILS_TOPOLOGY_HPP_
+#define SRC_UTILS_TOPOLOGY_HPP_
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>   // getenv
+#include <cstring>   // strcmp
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <sched.h>
+#include <unistd.h>  // gethostname
+
+#if defined(USE_OPENMP)
+#include <omp.h>
+#endif
+
+#if defined(USE_HWLOC)
+#include <hwloc.h>
+#endif
+
+#if defined(USE_MPI)
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#endif
+
+namespace bliss {
+
+  namespace utils {
+
+    namespace topology {
+
+      enum policy { NONE = 0, COMPACT = 1, SCATTER = 2 };
+
+      /// where a logical CPU is.  -1 if unknown.
+      struct location {
+          int cpu;
+          int core;
+          int package;
+          int numa_node;
+      };
+
+#if defined(USE_HWLOC)
+      namespace detail {
+        /// process wide hwloc topology, loaded on first use.
+        class hwloc_topo {
+          public:
+            hwloc_topology_t topo;
+            bool loaded;
+
+            hwloc_topo() : loaded(false) {
+              if (hwloc_topology_init(&topo) == 0) loaded = (hwloc_topology_load(topo) == 0);
+            }
+            ~hwloc_topo() { hwloc_topology_destroy(topo); }
+
+            static hwloc_topo & get() {
+              static hwloc_topo t;
+              return t;
+            }
+        };
+      } // namespace detail
+#endif
+
+      /// location of logical CPU cpu.
+      inline location locate(int cpu) {
+        location l = {cpu, -1, -1, -1};
+#if defined(USE_HWLOC)
+        detail::hwloc_topo & h = detail::hwloc_topo::get();
+        if (!h.loaded) return l;
+        hwloc_obj_t pu = hwloc_get_pu_obj_by_os_index(h.topo, cpu);
+        if (pu == nullptr) return l;
+        hwloc_obj_t core = hwloc_get_ancestor_obj_by_type(h.topo, HWLOC_OBJ_CORE, pu);
+        hwloc_obj_t pkg = hwloc_get_ancestor_obj_by_type(h.topo, HWLOC_OBJ_PACKAGE, pu);
+        if (core) l.core = core->logical_index;
+        if (pkg) l.package = pkg->logical_index;
+        // NUMA nodes are memory children in hwloc 2, so find the one whose cpuset has the PU.
+        int nnodes = hwloc_get_nbobjs_by_type(h.topo, HWLOC_OBJ_NUMANODE);
+        for (int i = 0; i < nnodes; ++i) {
+          hwloc_obj_t node = hwloc_get_obj_by_type(h.topo, HWLOC_OBJ_NUMANODE, i);
+          if (node && hwloc_bitmap_isset(node->cpuset, cpu)) { l.numa_node = node->os_index; break; }
+        }
+#else
+        std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+        std::ifstream core(base + "/topology/core_id");
+        std::ifstream pkg(base + "/topology/physical_package_id");
+        if (!(core >> l.core)) l.core = -1;
+        if (!(pkg >> l.package)) l.package = -1;
+        for (int n = 0; n < 1024; ++n) {
+          if (access((base + "/node" + std::to_string(n)).c_str(), F_OK) == 0) { l.numa_node = n; break; }
+        }
+        // core_id is per package.  make it unique, as hwloc's logical index is.
+        if ((l.core >= 0) && (l.package >= 0)) l.core += l.package * 4096;
+#endif
+        return l;
+      }
+
+      /// CPUs the calling thread may run on, e.g. as set by the MPI launcher.
+      inline std::vector<int> allowed_cpus() {
+        std::vector<int> cpus;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(cpu_set_t), &set) != 0) return cpus;
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+          if (CPU_ISSET(c, &set)) cpus.push_back(c);
+        }
+        return cpus;
+      }
+
+      /// CPU the calling thread last ran on.
+      inline int current_cpu() {
+        return sched_getcpu();
+      }
+
+      /// pin the calling thread to cpu.
+      inline bool pin_thread(int cpu) {
+#if defined(USE_HWLOC)
+        detail::hwloc_topo & h = detail::hwloc_topo::get();
+        if (h.loaded) {
+          hwloc_bitmap_t set = hwloc_bitmap_alloc();
+          hwloc_bitmap_only(set, cpu);
+          bool ok = hwloc_set_cpubind(h.topo, set, HWLOC_CPUBIND_THREAD) == 0;
+          hwloc_bitmap_free(set);
+          return ok;
+        }
+#endif
+        if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return sched_setaffinity(0, sizeof(cpu_set_t), &set) == 0;
+      }
+
+      /// policy from BLISS_PIN_THREADS:  compact, scatter, or none (default).
+      inline policy policy_from_env() {
+        char const * s = getenv("BLISS_PIN_THREADS");
+        if (s == nullptr) return NONE;
+        if (strcmp(s, "compact") == 0) return COMPACT;
+        if (strcmp(s, "scatter") == 0) return SCATTER;
+        return NONE;
+      }
+
+      inline char const * to_string(policy p) {
+        return (p == COMPACT) ? "compact" : ((p == SCATTER) ? "scatter" : "none");
+      }
+
+      /**
+       * @brief  CPU for each of nthreads threads, chosen from cpus with policy p.  empty for NONE.
+       * @details  threads beyond the number of cpus wrap around.
+       */
+      inline std::vector<int> assign(std::vector<int> const & cpus, int nthreads, policy p) {
+        std::vector<int> out;
+        if ((p == NONE) || cpus.empty() || (nthreads < 1)) return out;
+
+        // (hyperthread rank within core, package, node, core, cpu), so all cores come before their second threads.
+        std::vector<location> locs;
+        for (int c : cpus) locs.push_back(locate(c));
+        std::vector<std::tuple<int, int, int, int, int> > order;
+        for (size_t i = 0; i < locs.size(); ++i) {
+          int sibling = 0;
+          for (size_t j = 0; j < i; ++j) sibling += (locs[j].core == locs[i].core) && (locs[i].core >= 0);
+          order.emplace_back(sibling, locs[i].package, locs[i].numa_node, locs[i].core, locs[i].cpu);
+        }
+        std::sort(order.begin(), order.end());
+
+        if (p == COMPACT) {
+          // fill a node's cores before the next node's:  sort by node first, but keep cores before hyperthreads
+          // within the node.
+          std::stable_sort(order.begin(), order.end(),
+                           [](std::tuple<int, int, int, int, int> const & x, std::tuple<int, int, int, int, int> const & y) {
+            return std::make_tuple(std::get<1>(x), std::get<2>(x), std::get<0>(x)) <
+                std::make_tuple(std::get<1>(y), std::get<2>(y), std::get<0>(y));
+          });
+          for (int t = 0; t < nthreads; ++t) out.push_back(std::get<4>(order[t % order.size()]));
+        } else {
+          // round robin over the nodes, each in the order above.
+          std::vector<std::vector<int> > per_node;
+          std::vector<int> node_ids;
+          for (auto const & o : order) {
+            size_t n = std::find(node_ids.begin(), node_ids.end(), std::get<2>(o)) - node_ids.begin();
+            if (n == node_ids.size()) { node_ids.push_back(std::get<2>(o)); per_node.emplace_back(); }
+            per_node[n].push_back(std::get<4>(o));
+          }
+          std::vector<int> flat;
+          for (size_t i = 0; flat.size() < order.size(); ++i) {
+            for (auto const & v : per_node) {
+              if (i < v.size()) flat.push_back(v[i]);
+            }
+          }
+          for (int t = 0; t < nthreads; ++t) out.push_back(flat[t % flat.size()]);
+        }
+        return out;
+      }
+
+      /**
+       * @brief  pin the OpenMP threads within the calling thread's allowed CPUs, with policy p.
+       * @return CPU of each thread, or the CPUs they last ran on if not pinned (NONE, or pinning failed).
+       */
+      inline std::vector<int> pin_omp_threads(policy p) {
+        std::vector<int> cpus = allowed_cpus();
+#if defined(USE_OPENMP)
+        int nthreads = omp_get_max_threads();
+#else
+        int nthreads = 1;
+#endif
+        std::vector<int> target = assign(cpus, nthreads, p);
+        std::vector<int> actual(nthreads, -1);
+
+#if defined(USE_OPENMP)
+#pragma omp parallel num_threads(nthreads)
+        {
+          int t = omp_get_thread_num();
+#else
+        {
+          int t = 0;
+#endif
+          if (!target.empty()) pin_thread(target[t]);
+          actual[t] = current_cpu();
+        }
+        return actual;
+      }
+
+      /// one line describing this process's placement, with the thread CPUs from pin_omp_threads.
+      inline std::string describe(std::vector<int> const & thread_cpus) {
+        char host[256] = {0};
+        gethostname(host, sizeof(host) - 1);
+
+        std::vector<int> cpus = allowed_cpus();
+        std::vector<int> nodes, packages;
+        for (int c : cpus) {
+          location l = locate(c);
+          if (std::find(nodes.begin(), nodes.end(), l.numa_node) == nodes.end()) nodes.push_back(l.numa_node);
+          if (std::find(packages.begin(), packages.end(), l.package) == packages.end()) packages.push_back(l.package);
+        }
+
+        std::stringstream ss;
+        ss << host << " cpus";
+        // ranges, e.g. 0-7,16-23
+        for (size_t i = 0; i < cpus.size(); ) {
+          size_t j = i;
+          while ((j + 1 < cpus.size()) && (cpus[j + 1] == cpus[j] + 1)) ++j;
+          ss << (i == 0 ? " " : ",") << cpus[i];
+          if (j > i) ss << "-" << cpus[j];
+          i = j + 1;
+        }
+        ss << " sockets";
+        for (size_t i = 0; i < packages.size(); ++i) ss << (i == 0 ? " " : ",") << packages[i];
+        ss << " numa";
+        for (size_t i = 0; i < nodes.size(); ++i) ss << (i == 0 ? " " : ",") << nodes[i];
+        ss << " threads";
+        for (size_t t = 0; t < thread_cpus.size(); ++t) {
+          ss << (t == 0 ? " " : ",") << t << ":" << thread_cpus[t];
+          int n = locate(thread_cpus[t]).numa_node;
+          if (n >= 0) ss << "/n" << n;
+        }
+        return ss.str();
+      }
+
+#if defined(USE_MPI)
+      /**
+       * @brief  print the placement of every rank on rank 0, one line per rank, with the policy.  collective.
+       */
+      inline void log_placement(::mxx::comm const & comm, policy p, std::vector<int> const & thread_cpus) {
+        std::string line = describe(thread_cpus) + "\n";
+        std::vector<char> mine(line.begin(), line.end());
+        std::vector<char> all = ::mxx::gatherv(mine, 0, comm);
+        if (comm.rank() == 0) {
+          printf("PLACEMENT policy %s%s\n", to_string(p),
+#if defined(USE_HWLOC)
+                 " (hwloc)"
+#else
+                 " (sysfs)"
+#endif
+                 );
+          std::string s(all.begin(), all.end());
+          std::stringstream ss(s);
+          std::string l;
+          for (int r = 0; std::getline(ss, l); ++r) printf("PLACEMENT rank %d %s\n", r, l.c_str());
+          fflush(stdout);
+        }
+      }
+#endif
+
+    } // namespace topology
+
+  } // namespace utils
+
+} // namespace bliss
+
+#endif /* SRC_UTILS_TOPOLOGY_HPP_ */
@@ -0,0 +1,248 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    tracking_allocator.hpp
+ * @ingroup
+ * @author  tpan
+ * @brief   allocator adapter that counts the bytes allocated per tag.
+ * @details RSS sampling misses transient peaks and cannot attribute memory to a container.  containers that use
+ *          tracking_allocator<T, Tag> as their allocator (e.g. as the Alloc parameter of the dsc maps, or through
+ *          tracked_vector) update the current and peak bytes of Tag on every allocate and deallocate.
+ *
+ *          besides the all time peak, the tracker has a small number of peak windows.  a window records the peak of
+ *          each tag since it was last restarted, so that nested phases (e.g. MemUsage marks in insert and in the
+ *          distribute it calls) each get their own exact peak.
+ *
+ *          tags are identified by name and numbered in order of first use.  the predefined tags input, buffer,
+ *          table and other are always 0 to 3.  tag numbers are compared across ranks when reducing, so custom tags
+ *          should be first used in the same order on all ranks.
+ */
+#ifndef SRC_UTILS_TRACKING_ALLOCATOR_HPP_
+#define SRC_UTILS_TRACKING_ALLOCATOR_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace plog {
+
+namespace alloc {
+
+  /// maximum number of tags.  tags beyond this are counted as "other".
+  static constexpr int MAX_TAGS = 16;
+  /// maximum number of concurrently open peak windows.
+  static constexpr int MAX_WINDOWS = 32;
+
+  /**
+   * @brief process wide byte counts per tag.  thread safe.
+   */
+  class tracker {
+    protected:
+      std::atomic<int64_t> curr[MAX_TAGS];
+      std::atomic<int64_t> peak[MAX_TAGS];
+      std::atomic<uint64_t> count[MAX_TAGS];
+      std::atomic<int64_t> window_peaks[MAX_WINDOWS][MAX_TAGS];
+      /// bit w set if window w is open.
+      std::atomic<uint32_t> windows;
+
+      std::vector<std::string> names;
+      mutable std::mutex names_mutex;
+
+      static void atomic_max(std::atomic<int64_t> & x, int64_t const & v) {
+        int64_t old = x.load(std::memory_order_relaxed);
+        while ((old < v) && !x.compare_exchange_weak(old, v, std::memory_order_relaxed)) {}
+      }
+
+      tracker() : windows(0) {
+        for (int t = 0; t < MAX_TAGS; ++t) {
+          curr[t] = 0;
+          peak[t] = 0;
+          count[t] = 0;
+          for (int w = 0; w < MAX_WINDOWS; ++w) window_peaks[w][t] = 0;
+        }
+        names = { "input", "buffer", "table", "other" };
+      }
+
+    public:
+      /// numbers of the predefined tags.
+      enum predefined { INPUT = 0, BUFFER = 1, TABLE = 2, OTHER = 3 };
+
+      static tracker & get() {
+        static tracker t;
+        return t;
+      }
+
+      /// number of a tag, registering it on first use.
+      int tag(std::string const & name) {
+        std::lock_guard<std::mutex> lock(names_mutex);
+        for (size_t i = 0; i < names.size(); ++i) {
+          if (names[i] == name) return i;
+        }
+        if (names.size() >= static_cast<size_t>(MAX_TAGS)) return OTHER;
+        names.push_back(name);
+        return names.size() - 1;
+      }
+
+      int num_tags() const {
+        std::lock_guard<std::mutex> lock(names_mutex);
+        return names.size();
+      }
+
+      std::string name(int const & t) const {
+        std::lock_guard<std::mutex> lock(names_mutex);
+        return names[t];
+      }
+
+      void allocated(int const & t, size_t const & bytes) {
+        int64_t c = curr[t].fetch_add(bytes, std::memory_order_relaxed) + static_cast<int64_t>(bytes);
+        count[t].fetch_add(1, std::memory_order_relaxed);
+        atomic_max(peak[t], c);
+
+        uint32_t open = windows.load(std::memory_order_acquire);
+        for (int w = 0; open != 0; ++w, open >>= 1) {
+          if (open & 1) atomic_max(window_peaks[w][t], c);
+        }
+      }
+
+      void deallocated(int const & t, size_t const & bytes) {
+        curr[t].fetch_sub(bytes, std::memory_order_relaxed);
+      }
+
+      /// bytes currently allocated.
+      int64_t current(int const & t) const {
+        return curr[t].load(std::memory_order_relaxed);
+      }
+      /// largest current() since start or reset_peak.
+      int64_t peak_bytes(int const & t) const {
+        return peak[t].load(std::memory_order_relaxed);
+      }
+      /// number of allocate calls.
+      uint64_t allocations(int const & t) const {
+        return count[t].load(std::memory_order_relaxed);
+      }
+      void reset_peak(int const & t) {
+        peak[t].store(curr[t].load(std::memory_order_relaxed), std::memory_order_relaxed);
+      }
+
+      /// open a peak window, starting at the current counts.  returns -1 if all windows are in use.
+      int open_window() {
+        uint32_t open = windows.load(std::memory_order_relaxed);
+        while (true) {
+          int w = 0;
+          while ((w < MAX_WINDOWS) && (open & (1U << w))) ++w;
+          if (w == MAX_WINDOWS) return -1;
+          for (int t = 0; t < MAX_TAGS; ++t) window_peaks[w][t].store(curr[t].load(std::memory_order_relaxed));
+          if (windows.compare_exchange_weak(open, open | (1U << w), std::memory_order_acq_rel)) return w;
+        }
+      }
+      /// largest current() of a tag since the window was opened or restarted.
+      int64_t window_peak(int const & w, int const & t) const {
+        return window_peaks[w][t].load(std::memory_order_relaxed);
+      }
+      void restart_window(int const & w) {
+        for (int t = 0; t < MAX_TAGS; ++t) window_peaks[w][t].store(curr[t].load(std::memory_order_relaxed));
+      }
+      void close_window(int const & w) {
+        if (w >= 0) windows.fetch_and(~(1U << w), std::memory_order_acq_rel);
+      }
+  };
+
+
+  /// predefined tags.
+  struct input_tag {
+      static char const * name() { return "input"; }
+  };
+  struct buffer_tag {
+      static char const * name() { return "buffer"; }
+  };
+  struct table_tag {
+      static char const * name() { return "table"; }
+  };
+  struct other_tag {
+      static char const * name() { return "other"; }
+  };
+
+  /// tag number of a tag type, looked up once.
+  template <typename Tag>
+  int tag_id() {
+    static int const id = tracker::get().tag(Tag::name());
+    return id;
+  }
+
+} // namespace alloc
+
+
+/**
+ * @brief allocator adapter that reports allocations of Base to the tracker, under Tag.
+ * @details  stateless if Base is, so containers with the same Tag can exchange memory.
+ * @tparam Tag   type with a static name() function.
+ * @tparam Base  allocator that does the actual allocation.
+ */
+template <typename T, typename Tag = alloc::other_tag, typename Base = ::std::allocator<T> >
+class tracking_allocator : public Base {
+  public:
+    using value_type = T;
+    using pointer = T*;
+    using const_pointer = T const *;
+    using reference = T&;
+    using const_reference = T const &;
+    using size_type = size_t;
+    using difference_type = ::std::ptrdiff_t;
+
+    template <typename U>
+    struct rebind {
+        using other = tracking_allocator<U, Tag, typename ::std::allocator_traits<Base>::template rebind_alloc<U> >;
+    };
+
+    tracking_allocator() noexcept : Base() {}
+    tracking_allocator(Base const & b) noexcept : Base(b) {}
+    template <typename U, typename B2>
+    tracking_allocator(tracking_allocator<U, Tag, B2> const & other) noexcept : Base(static_cast<B2 const &>(other)) {}
+
+    T * allocate(size_t n) {
+      T * p = ::std::allocator_traits<Base>::allocate(*this, n);
+      alloc::tracker::get().allocated(alloc::tag_id<Tag>(), n * sizeof(T));
+      return p;
+    }
+
+    void deallocate(T * p, size_t n) {
+      alloc::tracker::get().deallocated(alloc::tag_id<Tag>(), n * sizeof(T));
+      ::std::allocator_traits<Base>::deallocate(*this, p, n);
+    }
+};
+
+template <typename T, typename U, typename Tag, typename B1, typename B2>
+bool operator==(tracking_allocator<T, Tag, B1> const & x, tracking_allocator<U, Tag, B2> const & y) {
+  return static_cast<B1 const &>(x) == static_cast<B2 const &>(y);
+}
+template <typename T, typename U, typename Tag, typename B1, typename B2>
+bool operator!=(tracking_allocator<T, Tag, B1> const & x, tracking_allocator<U, Tag, B2> const & y) {
+  return !(x == y);
+}
+
+/// vector whose storage is counted under Tag.
+template <typename T, typename Tag = alloc::other_tag>
+using tracked_vector = ::std::vector<T, tracking_allocator<T, Tag> >;
+
+} // end namespace plog
+
+#endif /* SRC_UTILS_TRACKING_ALLOCATOR_HPP_ */
@@ -24,6 +24,8 @@
 #ifndef TRANSFORM_UTILS_HPP_
 #define TRANSFORM_UTILS_HPP_
 
+#include <utility>  // pair, forward
+
 namespace bliss {
 
   namespace transform
@@ -46,6 +48,27 @@ namespace bliss {
 
   };
 
+  /**
+   * @brief  x = trans(x) for x in [begin, end).  V is Key or a (Key, value) pair.
+   * @details  a transform with a batched form overloads transform_range(Key *, Key *, TRANS const *) in its own namespace,
+   *           which is found by ADL, e.g. bliss::kmer::transform::lex_less.  identity is a no-op.
+   */
+  template <typename TRANS, typename V>
+  inline void transform_range(V * begin, V * end, TRANS const *) {
+    TRANS trans;
+    for (; begin != end; ++begin) {
+      *begin = trans(*begin);
+    }
+  }
+  template <typename V, typename Key>
+  inline void transform_range(V *, V *, identity<Key> const *) {}
+
+  /// in place transform of [begin, end), batched where TRANS supports it.  see transform_range
+  template <typename TRANS, typename V>
+  inline void transform_in_place(V * begin, V * end) {
+    transform_range(begin, end, static_cast<TRANS const *>(nullptr));
+  }
+
   } // namespace filter
 
 } // namespace bliss
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    tsc_clock.hpp
+ * @ingroup
+ * @author  tpan
+ * @brief   std::chrono style clock on the invariant time stamp counter, for timing short sections.
+ * @details steady_clock::now() costs a vDSO call, or a system call where the kernel does not use the TSC as clock
+ *          source, which distorts sections of a few microseconds, e.g. per batch or per round inside insert and
+ *          query loops (see test/benchmark/chrono_vs_time.cpp).  tsc_clock::now() is 1 rdtscp and a multiply.
+ *
+ *          the tick rate is calibrated once per process against steady_clock, over about 20 ms at first use, and
+ *          tsc_clock time points share the steady_clock epoch, so they convert to steady_clock time points, e.g. for
+ *          the event trace.
+ *
+ *          the TSC is used only on x86 with an invariant TSC (constant rate across P- and C-states, synchronized
+ *          across cores).  elsewhere, and in VMs that do not expose it, tsc_clock::now() returns steady_clock::now().
+ *
+ *          Timer uses this clock when built with BL_BENCHMARK_TSC == 1 (cmake ENABLE_TSC_BENCHMARK).
+ */
+#ifndef SRC_UTILS_TSC_CLOCK_HPP_
+#define SRC_UTILS_TSC_CLOCK_HPP_
+
+#include <chrono>
+#include <cstdint>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define BLISS_TSC_X86
+#endif
+
+
+namespace plog {
+
+class tsc_clock {
+  public:
+    typedef int64_t rep;
+    typedef std::nano period;
+    typedef std::chrono::duration<rep, period> duration;
+    typedef std::chrono::time_point<tsc_clock, duration> time_point;
+    static constexpr bool is_steady = true;
+
+  protected:
+    struct calibration {
+        /// true if the invariant TSC is used.
+        bool tsc;
+        double ns_per_tick;
+        uint64_t base_ticks;
+        /// steady_clock time at base_ticks, in ns.
+        rep base_ns;
+
+        calibration() : tsc(has_invariant_tsc()), ns_per_tick(0.0), base_ticks(0), base_ns(0) {
+          if (!tsc) return;
+
+          // spin for about 20 ms.  the 2 ends are each read between 2 steady_clock reads, to bound the error.
+          std::chrono::steady_clock::time_point s1 = std::chrono::steady_clock::now();
+          uint64_t t1 = ticks();
+          std::chrono::steady_clock::time_point s2 = std::chrono::steady_clock::now();
+          std::chrono::steady_clock::time_point s3, s4;
+          uint64_t t2;
+          do {
+            s3 = std::chrono::steady_clock::now();
+            t2 = ticks();
+            s4 = std::chrono::steady_clock::now();
+          } while ((s3 - s2) < std::chrono::milliseconds(20));
+
+          double ns = static_cast<double>(std::chrono::duration_cast<duration>((s3 - s2) + (s4 - s1)).count()) * 0.5;
+          if ((t2 <= t1) || (ns <= 0.0)) {
+            tsc = false;
+            return;
+          }
+          ns_per_tick = ns / static_cast<double>(t2 - t1);
+          base_ticks = t2;
+          base_ns = std::chrono::duration_cast<duration>(s3.time_since_epoch()).count() +
+              std::chrono::duration_cast<duration>(s4 - s3).count() / 2;
+        }
+    };
+
+    static calibration const & get_calibration() {
+      static calibration c;
+      return c;
+    }
+
+  public:
+    /// CPU reports an invariant TSC:  cpuid 0x80000007, EDX bit 8.
+    static bool has_invariant_tsc() {
+#if defined(BLISS_TSC_X86)
+      unsigned int eax, ebx, ecx, edx;
+      if (__get_cpuid_max(0x80000000, nullptr) < 0x80000007) return false;
+      __cpuid(0x80000007, eax, ebx, ecx, edx);
+      return (edx & (1U << 8)) != 0;
+#else
+      return false;
+#endif
+    }
+
+    /// raw counter.  rdtscp waits for the earlier instructions to finish.  0 without the TSC.
+    static uint64_t ticks() {
+#if defined(BLISS_TSC_X86)
+      unsigned int aux;
+      return __rdtscp(&aux);
+#else
+      return 0;
+#endif
+    }
+
+    /// true if now() reads the TSC, false if it falls back to steady_clock.
+    static bool available() {
+      return get_calibration().tsc;
+    }
+
+    /// calibrated tick rate in Hz.  0 without the TSC.
+    static double frequency() {
+      calibration const & c = get_calibration();
+      return c.tsc ? (1e9 / c.ns_per_tick) : 0.0;
+    }
+
+    static time_point now() {
+      calibration const & c = get_calibration();
+      if (!c.tsc)
+        return time_point(std::chrono::duration_cast<duration>(std::chrono::steady_clock::now().time_since_epoch()));
+
+      // signed, since the ticks of another core may be slightly behind base_ticks.
+      int64_t dt = static_cast<int64_t>(ticks() - c.base_ticks);
+      return time_point(duration(c.base_ns + static_cast<rep>(static_cast<double>(dt) * c.ns_per_tick)));
+    }
+
+    /// the same instant as a steady_clock time point.
+    static std::chrono::steady_clock::time_point to_steady(time_point const & t) {
+      return std::chrono::steady_clock::time_point(
+          std::chrono::duration_cast<std::chrono::steady_clock::duration>(t.time_since_epoch()));
+    }
+};
+
+} // end namespace plog
+
+#endif /* SRC_UTILS_TSC_CLOCK_HPP_ */
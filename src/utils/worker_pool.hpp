@@ -0,0 +1,393 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    worker_pool.hpp
+ * @ingroup utils
+ * @author  tpan
+ * @brief   persistent, pinned worker threads for the parallel loops within a rank, in place of OpenMP teams.
+ * @details a rank runs many short parallel loops:  parsing, counting, and the local lookups of every query batch.
+ *          each OpenMP region forks a team whose size and placement depend on the region, and a query loop of many
+ *          small batches pays the fork/join and the thread migration every time.  a worker_pool starts its threads
+ *          once, pins them with the topology policy (BLISS_PIN_THREADS), and keeps them warm between loops:  after a
+ *          loop, a worker spins briefly for the next one before it sleeps.
+ *
+ *          run(f) calls f(tid) once for each tid in [0, size()), on the caller (tid 0) and the workers, and returns
+ *          when all are done.  the caller is not pinned, as it is the MPI thread.  parallel_for splits a
+ *          ::bliss::partition::range among the threads, and submit queues a task and returns its future.  an exception
+ *          in any thread is rethrown by run after the others finish.  run from within a worker, i.e. a nested loop,
+ *          runs all tids on that worker.
+ *
+ *          the loops in ::fsc::detail (for_each_part, and so parallel_lookup and the container scans) and the
+ *          index builds run through parallel_region, which uses the pool made current on the calling thread by a
+ *          worker_pool::scope, and an OpenMP team otherwise.  worker_local keeps 1 object per thread, constructed by
+ *          that thread, so its memory is first touched, and so placed, on the thread's NUMA node.
+ */
+#ifndef SRC_UTILS_WORKER_POOL_HPP_
+#define SRC_UTILS_WORKER_POOL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(USE_OPENMP)
+#include <omp.h>
+#endif
+
+#include "partition/range.hpp"
+#include "utils/topology.hpp"
+
+namespace bliss {
+  namespace concurrent {
+
+    /**
+     * @brief fixed set of pinned threads for fork/join loops and tasks.  see the file comment.
+     * @details  run calls from different threads are serialized.
+     */
+    class worker_pool {
+      protected:
+        /// the pool and tid of the calling thread, if it is a worker.
+        struct membership {
+            worker_pool const * pool;
+            int tid;
+        };
+        static membership & self() {
+          static thread_local membership m = { nullptr, -1 };
+          return m;
+        }
+        static worker_pool * & current_ref() {
+          static thread_local worker_pool * p = nullptr;
+          return p;
+        }
+
+        std::vector<std::thread> threads;
+        /// CPU each thread is pinned to.  -1 for the caller, and with the NONE policy.
+        std::vector<int> thread_cpus;
+
+        std::mutex run_mutex;      // 1 run at a time.
+        std::mutex mutex;          // job, tasks, error.
+        std::condition_variable wake;
+        std::condition_variable done;
+
+        std::function<void(int)> const * job;
+        int job_tids;
+        std::atomic<uint64_t> generation;
+        std::atomic<int> pending;
+        std::exception_ptr error;
+
+        std::deque<std::function<void()> > tasks;
+        bool stopping;
+
+        /// iterations a worker polls for the next loop before it sleeps.
+        static constexpr int spin_limit = 1 << 14;
+
+        /// the tids of a loop over ntids threads that thread tid runs.
+        void run_tids(std::function<void(int)> const & f, int tid, int ntids) {
+          try {
+            for (int t = tid; t < ntids; t += static_cast<int>(this->size())) f(t);
+          } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error) error = std::current_exception();
+          }
+        }
+
+        void worker(int tid) {
+          self().pool = this;
+          self().tid = tid;
+          current_ref() = this;   // parallel_regions inside a loop run serially, not in a new OpenMP team.
+          if (thread_cpus[tid] >= 0) ::bliss::utils::topology::pin_thread(thread_cpus[tid]);
+
+          uint64_t seen = 0;
+          while (true) {
+            // warm:  poll for the next loop, as loops of a query batch come in quick succession.
+            for (int i = 0; (i < spin_limit) && (generation.load(std::memory_order_acquire) == seen); ++i) {
+              if ((i & 255) == 255) std::this_thread::yield();
+            }
+
+            std::function<void()> task;
+            std::function<void(int)> const * f = nullptr;
+            int ntids = 0;
+            {
+              std::unique_lock<std::mutex> lock(mutex);
+              wake.wait(lock, [this, seen]() {
+                return stopping || !tasks.empty() || (generation.load(std::memory_order_relaxed) != seen);
+              });
+              if (generation.load(std::memory_order_relaxed) != seen) {
+                seen = generation.load(std::memory_order_relaxed);
+                f = job;
+                ntids = job_tids;
+              } else if (!tasks.empty()) {
+                task = std::move(tasks.front());
+                tasks.pop_front();
+              } else {
+                return;   // stopping, and nothing left.
+              }
+            }
+
+            if (f != nullptr) {
+              run_tids(*f, tid, ntids);
+              if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(mutex);
+                done.notify_one();
+              }
+            } else {
+              task();   // a packaged_task, which keeps its own exception.
+            }
+          }
+        }
+
+      public:
+        /**
+         * @param nthreads  threads including the caller.  0 for omp_get_max_threads(), or the hardware threads
+         *                  without OpenMP.
+         * @param p         pinning of the workers within the caller's allowed CPUs.  see topology::assign.
+         */
+        explicit worker_pool(int nthreads = 0,
+                             ::bliss::utils::topology::policy p = ::bliss::utils::topology::policy_from_env()) :
+          job(nullptr), job_tids(0), generation(0), pending(0), stopping(false) {
+          if (nthreads < 1) {
+#if defined(USE_OPENMP)
+            nthreads = omp_get_max_threads();
+#else
+            nthreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+#endif
+          }
+          thread_cpus.assign(nthreads, -1);
+          std::vector<int> target = ::bliss::utils::topology::assign(::bliss::utils::topology::allowed_cpus(), nthreads, p);
+          for (int t = 1; t < nthreads; ++t) {
+            if (!target.empty()) thread_cpus[t] = target[t];
+          }
+          threads.reserve(nthreads - 1);
+          for (int t = 1; t < nthreads; ++t) threads.emplace_back(&worker_pool::worker, this, t);
+        }
+
+        worker_pool(worker_pool const &) = delete;
+        worker_pool & operator=(worker_pool const &) = delete;
+
+        /// finishes the queued tasks, then joins.
+        ~worker_pool() {
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+          }
+          wake.notify_all();
+          for (auto & t : threads) t.join();
+          if (current_ref() == this) current_ref() = nullptr;
+        }
+
+        /// threads, including the caller.
+        size_t size() const {
+          return threads.size() + 1;
+        }
+
+        /// CPU each thread is pinned to, -1 if not pinned.  entry 0 is the caller.  see topology::current_cpu to check.
+        std::vector<int> const & cpus() const {
+          return thread_cpus;
+        }
+
+        /// true if the calling thread is a worker of this pool, or the caller inside one of its loops.
+        bool is_worker() const {
+          return self().pool == this;
+        }
+
+        /// f(tid) for each tid in [0, ntids), on all threads, tid 0 on the caller.  blocks until all are done.
+        template <typename F>
+        void run(int ntids, F const & f) {
+          if (ntids < 1) return;
+          std::function<void(int)> fn = std::cref(f);
+
+          // nested, or nothing to share:  all here.
+          if (is_worker() || (threads.empty()) || (ntids == 1)) {
+            for (int t = 0; t < ntids; ++t) fn(t);
+            return;
+          }
+
+          std::lock_guard<std::mutex> serial(run_mutex);
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &fn;
+            job_tids = ntids;
+            error = nullptr;
+            pending.store(static_cast<int>(threads.size()), std::memory_order_relaxed);
+            generation.fetch_add(1, std::memory_order_release);
+          }
+          wake.notify_all();
+
+          // the caller counts as a worker while it runs tid 0, so loops nested in f run serially here.
+          membership outer = self();
+          worker_pool * outer_current = current_ref();
+          self().pool = this;
+          self().tid = 0;
+          current_ref() = this;
+          run_tids(fn, 0, ntids);
+          self() = outer;
+          current_ref() = outer_current;
+
+          for (int i = 0; (i < spin_limit) && (pending.load(std::memory_order_acquire) > 0); ++i) {
+            if ((i & 255) == 255) std::this_thread::yield();
+          }
+          std::exception_ptr e;
+          {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this]() { return pending.load(std::memory_order_acquire) == 0; });
+            job = nullptr;
+            e = error;
+            error = nullptr;
+          }
+          if (e) std::rethrow_exception(e);
+        }
+        /// f(tid) once on each thread.
+        template <typename F>
+        void run(F const & f) {
+          this->run(static_cast<int>(this->size()), f);
+        }
+
+        /// f(part, tid) on size() contiguous parts of r, as even as possible.  blocks until all are done.
+        template <typename T, typename F>
+        void parallel_for(::bliss::partition::range<T> const & r, F const & f) {
+          size_t n = static_cast<size_t>(r.end - r.start);
+          int parts = static_cast<int>(std::min(this->size(), std::max(n, static_cast<size_t>(1))));
+          this->run(parts, [&r, &f, n, parts](int tid) {
+            ::bliss::partition::range<T> part(r.start + static_cast<T>(n * tid / parts),
+                                              r.start + static_cast<T>(n * (tid + 1) / parts));
+            f(part, tid);
+          });
+        }
+
+        /// queue f() for a worker.  runs on the caller if there are no workers.
+        template <typename F>
+        std::future<typename std::result_of<F()>::type> submit(F f) {
+          using R = typename std::result_of<F()>::type;
+          auto task = std::make_shared<std::packaged_task<R()> >(std::move(f));
+          std::future<R> result = task->get_future();
+          if (threads.empty()) {
+            (*task)();
+            return result;
+          }
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.emplace_back([task]() { (*task)(); });
+          }
+          wake.notify_one();
+          return result;
+        }
+
+        /// the pool of the innermost scope on the calling thread, or nullptr.
+        static worker_pool * current() {
+          return current_ref();
+        }
+
+        /// makes pool current on the calling thread, until destroyed.  nullptr for none, e.g. to fall back to OpenMP.
+        class scope {
+            worker_pool * previous;
+            bool active;
+          public:
+            explicit scope(worker_pool * pool) : previous(current_ref()), active(true) {
+              current_ref() = pool;
+            }
+            scope(scope && other) : previous(other.previous), active(other.active) {
+              other.active = false;
+            }
+            scope(scope const &) = delete;
+            scope & operator=(scope const &) = delete;
+            ~scope() {
+              if (active) current_ref() = previous;
+            }
+        };
+    };
+
+
+    /// threads a parallel_region on the calling thread would use by default.
+    inline int region_threads() {
+      worker_pool * pool = worker_pool::current();
+      if (pool != nullptr) return pool->is_worker() ? 1 : static_cast<int>(pool->size());
+#if defined(USE_OPENMP)
+      return omp_get_max_threads();
+#else
+      return 1;
+#endif
+    }
+
+    /**
+     * @brief  f(tid) for each tid in [0, nthreads), in parallel.  on the current worker_pool if there is one, in an
+     *         OpenMP team otherwise, or in order without OpenMP.
+     */
+    template <typename F>
+    void parallel_region(int nthreads, F const & f) {
+      worker_pool * pool = worker_pool::current();
+      if (pool != nullptr) {
+        pool->run(nthreads, f);
+        return;
+      }
+#if defined(USE_OPENMP)
+#pragma omp parallel num_threads(nthreads)
+      {
+        f(omp_get_thread_num());
+      }
+#else
+      for (int tid = 0; tid < nthreads; ++tid) f(tid);
+#endif
+    }
+
+
+    /**
+     * @brief  1 T per thread of a parallel_region, each constructed by its own thread.
+     * @details  the constructor runs in a parallel_region, so with a pinned pool (or pinned OpenMP threads) each
+     *           object's memory is first touched on its thread's NUMA node.  objects are padded against false sharing.
+     */
+    template <typename T>
+    class worker_local {
+      protected:
+        struct holder {
+            T value;
+            char pad[64];   // apart from the next thread's object.
+            holder() : value() {}
+        };
+        std::vector<std::unique_ptr<holder> > items;
+
+      public:
+        explicit worker_local(int nthreads = region_threads()) : items(std::max(nthreads, 1)) {
+          parallel_region(static_cast<int>(items.size()), [this](int tid) {
+            items[tid].reset(new holder());
+          });
+        }
+
+        size_t size() const {
+          return items.size();
+        }
+        T & operator[](int tid) {
+          return items[tid]->value;
+        }
+        T const & operator[](int tid) const {
+          return items[tid]->value;
+        }
+    };
+
+  } // namespace concurrent
+} // namespace bliss
+
+#endif /* SRC_UTILS_WORKER_POOL_HPP_ */
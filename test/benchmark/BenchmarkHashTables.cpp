@@ -2,6 +2,13 @@
 #include <vector>
 #include <random>
 #include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
 
 #if 0
 #include <tommyds/tommyalloc.h>
@@ -15,8 +22,10 @@
 #endif
 
 #include "containers/unordered_vecmap.hpp"
+#include "containers/unordered_grouped_multimap.hpp"
 //#include "containers/hashed_vecmap.hpp"
 #include "containers/densehash_map.hpp"
+#include "containers/group_hash_map.hpp"
 
 #include "common/kmer.hpp"
 #include "common/kmer_transform.hpp"
@@ -29,6 +38,8 @@
 #include "utils/benchmark_utils.hpp"
 #include "utils/transform_utils.hpp"
 
+#include "tclap/CmdLine.h"
+
 // comparison of some hash tables.  note that this is not exhaustive and includes only the well tested ones and my own.  not so much
 // the one-off ones people wrote.
 // see http://preshing.com/20110603/hash-table-performance-tests/  - suggests google sparsehash dense, and Judy array
@@ -293,6 +304,59 @@ void benchmark_unordered_vecmap(size_t const count, size_t const query_frac, ::m
   BL_BENCH_REPORT_MPI_NAMED(map, "unordered_vecmap", comm);
 }
 
+template <typename Kmer, typename Value>
+void benchmark_unordered_grouped_multimap(size_t const count, size_t const query_frac, ::mxx::comm const & comm) {
+  BL_BENCH_INIT(map);
+
+  std::vector<Kmer > query;
+  BL_BENCH_START(map);
+  // no transform involved.
+  ::fsc::unordered_grouped_multimap<Kmer, Value, ::bliss::kmer::hash::farm<Kmer, false> > map(1, count);
+  BL_BENCH_END(map, "reserve", count);
+
+
+  {
+    std::vector<::std::pair<Kmer, Value> > input(count);
+
+    generate_input(input, count);
+    query.resize(count / query_frac);
+    std::transform(input.begin(), input.begin() + input.size() / query_frac, query.begin(),
+                   [](::std::pair<Kmer, Value> const & x){
+      return x.first;
+    });
+
+    BL_BENCH_START(map);
+    map.insert(input.begin(), input.end());
+    map.build();
+    BL_BENCH_END(map, "insert", map.size());
+  }
+
+  BL_BENCH_START(map);
+  size_t result = 0;
+  for (size_t i = 0, max = count / query_frac; i < max; ++i) {
+    auto iters = map.equal_range(query[i]);
+    for (auto it = iters.first; it != iters.second; ++it)
+      result ^= (*it).second;
+  }
+  BL_BENCH_END(map, "find", result);
+
+  BL_BENCH_START(map);
+  result = 0;
+  for (size_t i = 0, max = count / query_frac; i < max; ++i) {
+    result += map.count(query[i]);
+  }
+  BL_BENCH_END(map, "count", result);
+
+  BL_BENCH_START(map);
+  result = 0;
+  for (size_t i = 0, max = count / query_frac; i < max; ++i) {
+    result += map.erase(query[i]);
+  }
+  BL_BENCH_END(map, "erase", result);
+
+  BL_BENCH_REPORT_MPI_NAMED(map, "unordered_grouped_multimap", comm);
+}
+
 //template <typename Kmer, typename Value>
 //void benchmark_hashed_vecmap(size_t const count, size_t const query_frac, ::mxx::comm const & comm) {
 //  BL_BENCH_INIT(map);
@@ -415,6 +479,63 @@ void benchmark_densehash_map(size_t const count, size_t const query_frac, ::mxx:
 }
 
 
+template <typename Kmer, typename Value>
+void benchmark_group_hash_map(size_t const count, size_t const query_frac, ::mxx::comm const & comm) {
+  BL_BENCH_INIT(map);
+
+  std::vector<Kmer> query;
+
+  BL_BENCH_START(map);
+  // no transform involved.  no special keys needed, so full kmers are not split.
+  ::fsc::group_hash_map<Kmer, Value,
+	void,
+	::bliss::transform::identity,
+	::bliss::kmer::hash::farm<Kmer, false>,
+	::std::equal_to<Kmer> > map(count);
+  BL_BENCH_END(map, "reserve", count);
+
+
+  {
+    std::vector<::std::pair<Kmer, Value> > input(count);
+
+    generate_input(input, count);
+    query.resize(count / query_frac);
+    std::transform(input.begin(), input.begin() + input.size() / query_frac, query.begin(),
+                   [](::std::pair<Kmer, Value> const & x){
+      return x.first;
+    });
+
+    BL_BENCH_START(map);
+    map.insert(input.begin(), input.end());
+    BL_BENCH_END(map, "insert", map.size());
+  }
+
+  BL_BENCH_START(map);
+  size_t result = 0;
+  for (size_t i = 0, max = count / query_frac; i < max; ++i) {
+    auto iters = map.equal_range(query[i]);
+    for (auto it = iters.first; it != iters.second; ++it)
+      result ^= it->second;
+  }
+  BL_BENCH_END(map, "find", result);
+
+  BL_BENCH_START(map);
+  result = 0;
+  for (size_t i = 0, max = count / query_frac; i < max; ++i) {
+    result += map.count(query[i]);
+  }
+  BL_BENCH_END(map, "count", result);
+
+  BL_BENCH_START(map);
+  result = map.erase(query.begin(), query.end());
+  map.resize(0);
+  BL_BENCH_END(map, "erase", result);
+
+
+  BL_BENCH_REPORT_MPI_NAMED(map, "group_hash_map", comm);
+}
+
+
 template <typename Kmer, typename Value, bool canonical = false>
 void benchmark_densehash_full_map(size_t const count, size_t const query_frac, ::mxx::comm const & comm) {
   BL_BENCH_INIT(map);
@@ -1163,6 +1284,261 @@ void benchmark_tommytrie(size_t const count, size_t const query_frac, ::mxx::com
 //  BL_BENCH_REPORT_MPI_NAMED(map, "judyhs", comm);
 //}
 
+//================ load factor and skew sweep.
+// the tables above are measured on 1 input with few repeats.  the sweep measures the local k-mer tables
+// over the conditions that decide their production behavior:  load factor, key multiplicity, hash function, and
+// the fraction of finds that hit.  1 CSV row per point, for throughput curves.
+//
+// load factor:  every table gets the same bucket count B and L x B distinct keys, so that the load factor is L without
+//   growing.  the densehash max load factor is set just above L.  group_hash_map stops at 7/8, unordered_map chains.
+//   the realized load factor is reported.
+// multiplicity, per distinct key:
+//   uniform:   all keys appear m times.
+//   zipf:      the key of rank r appears max(1, m / r^s) times, i.e. a few highly repetitive keys.
+//   spectrum:  multiplicities drawn from a k-mer spectrum histogram file, lines of "multiplicity count", e.g. from
+//              jellyfish histo.
+//   the entries are inserted in random order.
+// hit ratio:  the fraction of find queries that are present.  present queries are drawn uniformly from the keys.
+
+struct sweep_point {
+    std::string map;
+    std::string hash;
+    std::string dist;
+    double target_lf;
+    double lf;
+    size_t buckets;
+    size_t distinct;
+    size_t entries;
+    double hit_ratio;
+    double insert_s;
+    double find_s;
+    size_t queries;
+    size_t found;
+};
+
+/// multiplicity of each of n distinct keys.
+std::vector<uint32_t> sweep_multiplicities(size_t const n, std::string const & dist, uint32_t const m, double const s,
+                                           std::vector<std::pair<uint32_t, double> > const & spectrum) {
+  std::vector<uint32_t> mult(n, std::max(1U, m));
+  if (dist == "zipf") {
+    for (size_t r = 0; r < n; ++r)
+      mult[r] = std::max(1U, static_cast<uint32_t>(static_cast<double>(m) / std::pow(static_cast<double>(r + 1), s)));
+  } else if (dist == "spectrum" && !spectrum.empty()) {
+    std::vector<double> w;
+    for (auto const & x : spectrum) w.push_back(x.second);
+    std::discrete_distribution<size_t> pick(w.begin(), w.end());
+    std::mt19937_64 gen(31);
+    for (size_t r = 0; r < n; ++r) mult[r] = std::max(1U, spectrum[pick(gen)].first);
+  }
+  return mult;
+}
+
+/// "multiplicity count" lines.
+std::vector<std::pair<uint32_t, double> > read_spectrum(std::string const & filename) {
+  std::vector<std::pair<uint32_t, double> > spectrum;
+  if (filename.empty()) return spectrum;
+  std::ifstream ifs(filename);
+  uint32_t m;
+  double c;
+  while (ifs >> m >> c) {
+    if (m > 0 && c > 0) spectrum.emplace_back(m, c);
+  }
+  return spectrum;
+}
+
+template <typename Kmer>
+Kmer sweep_random_kmer(std::mt19937_64 & gen) {
+  Kmer k;
+  for (size_t j = 0; j < Kmer::nWords; ++j) k.getDataRef()[j] = static_cast<typename Kmer::KmerWordType>(gen());
+  k.sanitize();
+  return k;
+}
+
+template <typename Map>
+struct sweep_table;
+
+/// densehash:  grows above its max load factor, so set it just above the target.
+template <typename Kmer, typename Value, typename Hash>
+struct sweep_table<::fsc::densehash_map<Kmer, Value, ::bliss::kmer::hash::sparsehash::special_keys<Kmer, false>,
+                                        ::bliss::transform::identity, Hash> > {
+    using map_type = ::fsc::densehash_map<Kmer, Value, ::bliss::kmer::hash::sparsehash::special_keys<Kmer, false>,
+                                          ::bliss::transform::identity, Hash>;
+    static char const * name() { return "densehash_map"; }
+    static void prepare(map_type & map, size_t const buckets, double const lf) {
+      map.set_max_load_factor(std::min(0.98, lf + 0.02));
+      map.resize(static_cast<size_t>(lf * buckets));
+    }
+};
+/// group_hash_map:  fixed max load factor of 7/8.
+template <typename Kmer, typename Value, typename Hash>
+struct sweep_table<::fsc::group_hash_map<Kmer, Value, void, ::bliss::transform::identity, Hash, ::std::equal_to<Kmer> > > {
+    using map_type = ::fsc::group_hash_map<Kmer, Value, void, ::bliss::transform::identity, Hash, ::std::equal_to<Kmer> >;
+    static char const * name() { return "group_hash_map"; }
+    static void prepare(map_type & map, size_t const buckets, double const) {
+      map.resize(buckets - buckets / 8 - 1);
+    }
+};
+/// unordered_map:  chained, so the load factor is the mean chain length.
+template <typename Kmer, typename Value, typename Hash>
+struct sweep_table<::std::unordered_map<Kmer, Value, Hash> > {
+    using map_type = ::std::unordered_map<Kmer, Value, Hash>;
+    static char const * name() { return "unordered_map"; }
+    static void prepare(map_type & map, size_t const buckets, double const) {
+      map.max_load_factor(1.0);
+      map.rehash(buckets);
+    }
+};
+
+template <typename Map, typename Kmer, typename Value>
+sweep_point sweep_one(std::string const & hash_name, std::string const & dist, double const lf, double const hit_ratio,
+                      size_t const buckets, size_t const nqueries, std::vector<uint32_t> const & mult) {
+  sweep_point p;
+  p.map = sweep_table<Map>::name();
+  p.hash = hash_name;
+  p.dist = dist;
+  p.target_lf = lf;
+  p.hit_ratio = hit_ratio;
+  p.distinct = static_cast<size_t>(lf * buckets);
+
+  std::mt19937_64 gen(17);
+  std::vector<Kmer> keys(p.distinct);
+  for (auto & k : keys) k = sweep_random_kmer<Kmer>(gen);
+
+  std::vector<::std::pair<Kmer, Value> > input;
+  for (size_t i = 0; i < p.distinct; ++i)
+    for (uint32_t j = 0; j < mult[i]; ++j) input.emplace_back(keys[i], static_cast<Value>(i));
+  std::shuffle(input.begin(), input.end(), gen);
+  p.entries = input.size();
+
+  // hit_ratio of the queries from the keys, the rest new random k-mers.
+  std::vector<Kmer> query(nqueries);
+  std::uniform_int_distribution<size_t> pick(0, p.distinct - 1);
+  std::uniform_real_distribution<double> coin(0.0, 1.0);
+  std::mt19937_64 qgen(71);
+  for (auto & q : query) q = (coin(qgen) < hit_ratio) ? keys[pick(qgen)] : sweep_random_kmer<Kmer>(qgen);
+
+  Map map;
+  sweep_table<Map>::prepare(map, buckets, lf);
+
+  auto t0 = std::chrono::steady_clock::now();
+  map.insert(input.begin(), input.end());
+  auto t1 = std::chrono::steady_clock::now();
+  size_t found = 0;
+  for (auto const & q : query) found += (map.find(q) != map.end());
+  auto t2 = std::chrono::steady_clock::now();
+
+  p.buckets = map.bucket_count();
+  p.lf = static_cast<double>(map.size()) / static_cast<double>(p.buckets);
+  p.insert_s = std::chrono::duration_cast<std::chrono::duration<double> >(t1 - t0).count();
+  p.find_s = std::chrono::duration_cast<std::chrono::duration<double> >(t2 - t1).count();
+  p.queries = nqueries;
+  p.found = found;
+  return p;
+}
+
+void sweep_print(std::ostream & os, sweep_point const & p, bool const header) {
+  if (header)
+    os << "map,hash,dist,target_lf,lf,buckets,distinct,entries,hit_ratio,insert_s,insert_per_s,find_s,find_per_s,found" << std::endl;
+  os << p.map << "," << p.hash << "," << p.dist << "," << p.target_lf << "," << p.lf << "," << p.buckets << "," <<
+      p.distinct << "," << p.entries << "," << p.hit_ratio << "," << p.insert_s << "," <<
+      (p.insert_s > 0 ? p.entries / p.insert_s : 0.0) << "," << p.find_s << "," <<
+      (p.find_s > 0 ? p.queries / p.find_s : 0.0) << "," << p.found << std::endl;
+}
+
+template <typename Kmer, typename Value, typename Hash>
+void sweep_hash(std::string const & hash_name, std::vector<std::string> const & maps, std::vector<std::string> const & dists,
+                std::vector<double> const & lfs, std::vector<double> const & hits, size_t const buckets, size_t const nqueries,
+                uint32_t const m, double const s, std::vector<std::pair<uint32_t, double> > const & spectrum,
+                std::ostream & os, bool & header) {
+  using DenseMap = ::fsc::densehash_map<Kmer, Value, ::bliss::kmer::hash::sparsehash::special_keys<Kmer, false>,
+      ::bliss::transform::identity, Hash>;
+  using GroupMap = ::fsc::group_hash_map<Kmer, Value, void, ::bliss::transform::identity, Hash, ::std::equal_to<Kmer> >;
+  using StdMap = ::std::unordered_map<Kmer, Value, Hash>;
+
+  for (auto const & map : maps) {
+    for (auto const & dist : dists) {
+      for (double lf : lfs) {
+        // group_hash_map cannot exceed 7/8.
+        if (map == "group_hash_map" && lf > 0.87) continue;
+        std::vector<uint32_t> mult = sweep_multiplicities(static_cast<size_t>(lf * buckets), dist, m, s, spectrum);
+        for (double hit : hits) {
+          sweep_point p;
+          if (map == "densehash_map")
+            p = sweep_one<DenseMap, Kmer, Value>(hash_name, dist, lf, hit, buckets, nqueries, mult);
+          else if (map == "group_hash_map")
+            p = sweep_one<GroupMap, Kmer, Value>(hash_name, dist, lf, hit, buckets, nqueries, mult);
+          else if (map == "unordered_map")
+            p = sweep_one<StdMap, Kmer, Value>(hash_name, dist, lf, hit, buckets, nqueries, mult);
+          else continue;
+          sweep_print(os, p, header);
+          header = false;
+        }
+      }
+    }
+  }
+}
+
+template <typename T>
+std::vector<T> sweep_list(std::string const & str) {
+  std::vector<T> out;
+  std::stringstream ss(str);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (item.empty()) continue;
+    std::stringstream is(item);
+    T x;
+    is >> x;
+    out.push_back(x);
+  }
+  return out;
+}
+
+/// run the sweep on 1 process, as the tables are local.  rows go to stdout and to output if not empty.
+void sweep(std::string const & maps_str, std::string const & hashes_str, std::string const & dists_str,
+           std::string const & lfs_str, std::string const & hits_str, size_t const buckets, size_t const nqueries,
+           uint32_t const m, double const s, std::string const & spectrum_file, std::string const & output) {
+  using Kmer = ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>;
+  using Value = size_t;
+
+  auto maps = sweep_list<std::string>(maps_str);
+  auto hashes = sweep_list<std::string>(hashes_str);
+  auto dists = sweep_list<std::string>(dists_str);
+  auto lfs = sweep_list<double>(lfs_str);
+  auto hits = sweep_list<double>(hits_str);
+  auto spectrum = read_spectrum(spectrum_file);
+  if (spectrum.empty() && std::find(dists.begin(), dists.end(), "spectrum") != dists.end()) {
+    printf("no spectrum file given (-S).  skipping the spectrum distribution.\n");
+    dists.erase(std::remove(dists.begin(), dists.end(), "spectrum"), dists.end());
+  }
+
+  std::ofstream ofs;
+  if (!output.empty()) ofs.open(output);
+
+  std::ostringstream os;
+  bool header = true;
+  for (auto const & h : hashes) {
+    if (h == "identity")
+      sweep_hash<Kmer, Value, ::bliss::kmer::hash::identity<Kmer, false> >(h, maps, dists, lfs, hits, buckets, nqueries, m, s, spectrum, os, header);
+    else if (h == "murmur")
+      sweep_hash<Kmer, Value, ::bliss::kmer::hash::murmur<Kmer, false> >(h, maps, dists, lfs, hits, buckets, nqueries, m, s, spectrum, os, header);
+    else if (h == "farm")
+      sweep_hash<Kmer, Value, ::bliss::kmer::hash::farm<Kmer, false> >(h, maps, dists, lfs, hits, buckets, nqueries, m, s, spectrum, os, header);
+#if defined(__SSE4_2__)
+    else if (h == "crc")
+      sweep_hash<Kmer, Value, ::bliss::kmer::hash::crc32c<Kmer, false> >(h, maps, dists, lfs, hits, buckets, nqueries, m, s, spectrum, os, header);
+#endif
+    else {
+      printf("hash %s not available.  skipping.\n", h.c_str());
+      continue;
+    }
+    printf("%s", os.str().c_str());
+    fflush(stdout);
+    if (ofs.is_open()) ofs << os.str();
+    os.str("");
+  }
+}
+
+
 int main(int argc, char** argv) {
 
   size_t count = 10000000;
@@ -1175,6 +1551,63 @@ int main(int argc, char** argv) {
 
   if (comm.rank() == 0) printf("EXECUTING %s\n", argv[0]);
 
+  // sweep mode.  see the sweep section above.
+  bool sweep_mode = false;
+  std::string sweep_maps, sweep_hashes, sweep_dists, sweep_lfs, sweep_hits, sweep_spectrum, sweep_output;
+  size_t sweep_buckets = 0, sweep_queries = 0;
+  uint32_t sweep_mult = 0;
+  double sweep_s = 0.0;
+  try {
+    TCLAP::CmdLine cmd("Benchmark local hash tables.  without --sweep, compares the tables on 1 input.", ' ', "0.1");
+
+    TCLAP::SwitchArg sweepArg("W", "sweep", "sweep load factor, multiplicity, hash, and hit ratio", cmd, false);
+    TCLAP::ValueArg<std::string> mapsArg("M", "maps", "comma separated:  densehash_map, group_hash_map, unordered_map",
+                                         false, "densehash_map,group_hash_map,unordered_map", "string", cmd);
+    TCLAP::ValueArg<std::string> hashesArg("H", "hashes", "comma separated:  identity, murmur, farm, crc", false,
+                                           "identity,murmur,farm,crc", "string", cmd);
+    TCLAP::ValueArg<std::string> distsArg("D", "dists", "comma separated multiplicity distributions:  uniform, zipf, spectrum",
+                                          false, "uniform,zipf", "string", cmd);
+    TCLAP::ValueArg<std::string> lfsArg("L", "load-factors", "comma separated load factors", false,
+                                        "0.3,0.5,0.6,0.7,0.8,0.85,0.9,0.95", "string", cmd);
+    TCLAP::ValueArg<std::string> hitsArg("R", "hit-ratios", "comma separated fractions of finds that hit", false,
+                                         "0,0.5,1", "string", cmd);
+    TCLAP::ValueArg<size_t> bucketsArg("B", "buckets", "bucket count of every table", false, 1UL << 22, "size_t", cmd);
+    TCLAP::ValueArg<size_t> queriesArg("Q", "queries", "finds per point", false, 1UL << 22, "size_t", cmd);
+    TCLAP::ValueArg<uint32_t> multArg("m", "multiplicity", "uniform:  multiplicity.  zipf:  top multiplicity", false, 1000, "uint32_t", cmd);
+    TCLAP::ValueArg<double> zipfArg("s", "zipf", "zipf exponent", false, 1.0, "double", cmd);
+    TCLAP::ValueArg<std::string> spectrumArg("S", "spectrum", "k-mer spectrum histogram, lines of \"multiplicity count\"",
+                                             false, "", "string", cmd);
+    TCLAP::ValueArg<std::string> outputArg("O", "output", "sweep CSV output file", false, "", "string", cmd);
+
+    cmd.parse(argc, argv);
+
+    sweep_mode = sweepArg.getValue();
+    sweep_maps = mapsArg.getValue();
+    sweep_hashes = hashesArg.getValue();
+    sweep_dists = distsArg.getValue();
+    sweep_lfs = lfsArg.getValue();
+    sweep_hits = hitsArg.getValue();
+    sweep_buckets = bucketsArg.getValue();
+    sweep_queries = queriesArg.getValue();
+    sweep_mult = multArg.getValue();
+    sweep_s = zipfArg.getValue();
+    sweep_spectrum = spectrumArg.getValue();
+    sweep_output = outputArg.getValue();
+  } catch (TCLAP::ArgException &e)  // catch any exceptions
+  {
+    std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+    exit(-1);
+  }
+
+  if (sweep_mode) {
+    // local tables, so rank 0 only.
+    if (comm.rank() == 0)
+      sweep(sweep_maps, sweep_hashes, sweep_dists, sweep_lfs, sweep_hits, sweep_buckets, sweep_queries,
+            sweep_mult, sweep_s, sweep_spectrum, sweep_output);
+    comm.barrier();
+    return 0;
+  }
+
   comm.barrier();
 
 
@@ -1211,6 +1644,18 @@ int main(int argc, char** argv) {
   benchmark_densehash_full_map<FullKmer, size_t, false>(count, query_frac, comm);
   BL_BENCH_COLLECTIVE_END(test, "densehash_full_map", count, comm);
 
+  BL_BENCH_START(test);
+  benchmark_group_hash_map<Kmer, size_t>(count, query_frac, comm);
+  BL_BENCH_COLLECTIVE_END(test, "group_hash_map", count, comm);
+
+  BL_BENCH_START(test);
+  benchmark_group_hash_map<DNA5Kmer, size_t>(count, query_frac, comm);
+  BL_BENCH_COLLECTIVE_END(test, "group_hash_map_DNA5", count, comm);
+
+  BL_BENCH_START(test);
+  benchmark_group_hash_map<FullKmer, size_t>(count, query_frac, comm);
+  BL_BENCH_COLLECTIVE_END(test, "group_hash_map_full", count, comm);
+
 
   BL_BENCH_START(test);
   benchmark_unordered_multimap<Kmer, size_t>(count, query_frac, comm);
@@ -1258,6 +1703,10 @@ int main(int argc, char** argv) {
   benchmark_unordered_vecmap<Kmer, size_t>(count, query_frac, comm);
   BL_BENCH_COLLECTIVE_END(test, "unordered_vecmap", count, comm);
 
+  BL_BENCH_START(test);
+  benchmark_unordered_grouped_multimap<Kmer, size_t>(count, query_frac, comm);
+  BL_BENCH_COLLECTIVE_END(test, "unordered_grouped_multimap", count, comm);
+
 //  BL_BENCH_START(test);
 //  benchmark_hashed_vecmap<Kmer, size_t>(count, query_frac, comm);
 //  BL_BENCH_COLLECTIVE_END(test, "hashed_vecmap", count, comm);
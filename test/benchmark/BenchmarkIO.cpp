@@ -0,0 +1,383 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    BenchmarkIO.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   file reader benchmark matrix:  backend x parser x thread count, with cold page cache between runs.
+ * @details each run opens the file with 1 backend, loads the block partition of each process (record aligned for
+ *          FASTQ and FASTA), then counts the records in the partition with T threads.  raw records are lines, FASTA
+ *          records are '>' headers, FASTQ records are found as partitioned_file finds them at partition boundaries.
+ *          the count touches every byte, so lazily mapped backends pay for their page faults.
+ *
+ *          before each run, 1 process per node evicts the file from the page cache (-C file, posix_fadvise) or clears
+ *          the whole page cache as utils/clear_cache does (-C all, slow).  -C none measures warm reads.
+ *
+ *          reports per configuration the bytes and records over all processes, and GB/s and records/s over the slowest
+ *          process, best and mean of the repeats.  -O writes the same as CSV.
+ *
+ *          backends:  mmap, posix, stdio, uring, fd_mmap, fd_posix (shared descriptor), aggregated (node aggregated
+ *          reads), mpiio, and gzip for .gz/.bgz input when built with USE_ZLIB.
+ */
+
+#include "bliss-config.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils/logging.h"
+
+#include "io/file.hpp"
+#include "io/fastq_loader.hpp"
+#include "io/fasta_loader.hpp"
+#if defined(USE_ZLIB)
+#include "io/gzip_file.hpp"
+#endif
+
+#include "utils/bench_env.hpp"
+#include "utils/file_utils.hpp"
+
+#include "tclap/CmdLine.h"
+
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+
+enum parser_kind { RAW = 0, FASTQ = 1, FASTA = 2 };
+static char const * parser_names[] = { "raw", "fastq", "fasta" };
+
+enum cold_kind { COLD_NONE = 0, COLD_FILE = 1, COLD_ALL = 2 };
+
+/// timing of 1 run on this process.
+struct io_run {
+    double load;     // open and read_file, s
+    double count;    // record count, s
+    size_t bytes;
+    size_t records;
+};
+
+using range_type = ::bliss::io::file_data::range_type;
+using iter_type = ::bliss::io::file_data::const_iterator;
+
+
+/// lines ending in [b, e).  with the last line of the file unterminated, 1 line short.
+size_t count_lines(::bliss::io::file_data const & part, size_t const & b, size_t const & e) {
+  iter_type it = part.in_mem_cbegin() + (b - part.in_mem_range_bytes.start);
+  return std::count(it, it + (e - b), '\n');
+}
+
+/// FASTA headers, i.e. '>' at a line start, in [b, e).
+size_t count_fasta(::bliss::io::file_data const & part, size_t const & b, size_t const & e) {
+  if (b >= e) return 0;
+  iter_type it = part.in_mem_cbegin() + (b - part.in_mem_range_bytes.start);
+  iter_type end = it + (e - b);
+  size_t n = 0;
+  unsigned char prev = (b == part.in_mem_range_bytes.start) ? '\n' : *(it - 1);
+  for (; it != end; ++it) {
+    n += ((*it == '>') && (prev == '\n'));
+    prev = *it;
+  }
+  return n;
+}
+
+/// FASTQ records that start in [b, e):  the first record at or after b, then 4 lines per record.
+size_t count_fastq(::bliss::io::file_data const & part, size_t const & b, size_t const & e) {
+  if (b >= e) return 0;
+  // the valid range starts at a record.  inside it, the search starts after a newline, so start 1 before b.
+  size_t pos = b;
+  if (b > part.getRange().start) {
+    ::bliss::io::FASTQParser<iter_type> parser;
+    try {
+      pos = parser.find_first_record(part.in_mem_cbegin(), part.parent_range_bytes, part.in_mem_range_bytes,
+                                     range_type(b - 1, part.in_mem_range_bytes.end));
+    } catch (std::exception const &) {
+      return 0;
+    }
+  }
+
+  iter_type start = part.in_mem_cbegin();
+  iter_type last = part.in_mem_cend();
+  iter_type it = start + (pos - part.in_mem_range_bytes.start);
+  size_t n = 0;
+  while ((it < last) && (static_cast<size_t>(it - start) + part.in_mem_range_bytes.start < e)) {
+    ++n;
+    for (int l = 0; (l < 4) && (it != last); ++l) {
+      it = std::find(it, last, '\n');
+      if (it != last) ++it;
+    }
+  }
+  return n;
+}
+
+/// records in the valid range of part, with nthreads threads on equal byte ranges.
+size_t count_records(::bliss::io::file_data const & part, int const & parser, int const & nthreads) {
+  range_type valid = part.getRange();
+  if (valid.size() == 0) return 0;
+
+  std::vector<size_t> counts(nthreads, 0);
+  std::vector<std::thread> threads;
+  size_t step = (valid.size() + nthreads - 1) / nthreads;
+  for (int t = 0; t < nthreads; ++t) {
+    size_t b = std::min(valid.end, valid.start + t * step);
+    size_t e = std::min(valid.end, b + step);
+    threads.emplace_back([&part, &counts, parser, t, b, e]() {
+      counts[t] = (parser == FASTQ) ? count_fastq(part, b, e) :
+          ((parser == FASTA) ? count_fasta(part, b, e) : count_lines(part, b, e));
+    });
+  }
+  for (auto & th : threads) th.join();
+
+  size_t n = 0;
+  for (auto c : counts) n += c;
+  return n;
+}
+
+
+/// evict the file on 1 process per node, then wait for all.
+void make_cold(std::string const & filename, int const & cold, ::mxx::comm const & comm, ::mxx::comm const & node) {
+  if (cold != COLD_NONE && node.rank() == 0) {
+    if (cold == COLD_ALL) ::bliss::utils::bench::clear_page_cache();
+    else if (!::bliss::utils::bench::drop_file_pages(filename))
+      fprintf(stderr, "WARNING: rank %d could not evict %s from the page cache\n", comm.rank(), filename.c_str());
+  }
+  comm.barrier();
+}
+
+template <typename FileType>
+io_run run_once(std::string const & filename, int const & parser, int const & nthreads, ::mxx::comm const & comm) {
+  io_run r;
+  comm.barrier();
+  auto t0 = std::chrono::steady_clock::now();
+  ::bliss::io::file_data partition;
+  {
+    FileType fobj(filename, 0, comm);
+    partition = fobj.read_file();
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  r.records = count_records(partition, parser, nthreads);
+  auto t2 = std::chrono::steady_clock::now();
+
+  r.load = std::chrono::duration_cast<std::chrono::duration<double> >(t1 - t0).count();
+  r.count = std::chrono::duration_cast<std::chrono::duration<double> >(t2 - t1).count();
+  r.bytes = partition.getRange().size();
+  return r;
+}
+
+/// backend with the file parser for parser.  false if the backend does not apply.
+template <template <typename> class FileParser>
+bool run_parsed(std::string const & backend, std::string const & filename, int const & parser, int const & nthreads,
+                ::mxx::comm const & comm, io_run & r) {
+  using namespace ::bliss::io;
+  bool gz = (::bliss::utils::file::get_file_extension(filename) == "gz") ||
+      (::bliss::utils::file::get_file_extension(filename) == "bgz");
+
+  if (backend == "gzip") {
+#if defined(USE_ZLIB)
+    if (!gz) return false;
+    r = run_once<parallel::partitioned_file<gzip_file, FileParser> >(filename, parser, nthreads, comm);
+    return true;
+#else
+    return false;
+#endif
+  }
+  if (gz) return false;
+
+  if (backend == "mmap") r = run_once<parallel::partitioned_file<mmap_file, FileParser> >(filename, parser, nthreads, comm);
+  else if (backend == "posix") r = run_once<parallel::partitioned_file<posix_file, FileParser> >(filename, parser, nthreads, comm);
+  else if (backend == "stdio") r = run_once<parallel::partitioned_file<stdio_file, FileParser> >(filename, parser, nthreads, comm);
+  else if (backend == "uring") r = run_once<parallel::partitioned_file<uring_file, FileParser> >(filename, parser, nthreads, comm);
+  else if (backend == "fd_mmap")
+    r = run_once<parallel::partitioned_file<mmap_file, FileParser, parallel::base_shared_fd_file> >(filename, parser, nthreads, comm);
+  else if (backend == "fd_posix")
+    r = run_once<parallel::partitioned_file<posix_file, FileParser, parallel::base_shared_fd_file> >(filename, parser, nthreads, comm);
+  else if (backend == "aggregated") r = run_once<parallel::node_aggregated_file<FileParser> >(filename, parser, nthreads, comm);
+  else if (backend == "mpiio") r = run_once<parallel::mpiio_file<FileParser> >(filename, parser, nthreads, comm);
+  else return false;
+  return true;
+}
+
+bool run_backend(std::string const & backend, std::string const & filename, int const & parser, int const & nthreads,
+                 ::mxx::comm const & comm, io_run & r) {
+  switch (parser) {
+    case FASTQ: return run_parsed<::bliss::io::FASTQParser>(backend, filename, parser, nthreads, comm, r);
+    case FASTA: return run_parsed<::bliss::io::FASTAParser>(backend, filename, parser, nthreads, comm, r);
+    default: return run_parsed<::bliss::io::BaseFileParser>(backend, filename, parser, nthreads, comm, r);
+  }
+}
+
+std::vector<std::string> split_list(std::string const & s) {
+  std::vector<std::string> out;
+  std::stringstream ss(s);
+  std::string item;
+  while (std::getline(ss, item, ',')) if (!item.empty()) out.push_back(item);
+  return out;
+}
+
+
+/**
+ *
+ * @param argc
+ * @param argv
+ * @return
+ */
+int main(int argc, char** argv) {
+
+  //////////////// init logging
+  LOG_INIT();
+
+  //////////////// initialize MPI
+
+  mxx::env e(argc, argv);
+  mxx::comm comm;
+  mxx::comm node = comm.split_shared();
+
+  //////////////// parse parameters
+
+  std::string filename(PROJ_SRC_DIR);
+  filename.append("/test/data/natural.fastq");
+  std::string backends("mmap,posix,stdio,uring,fd_mmap,fd_posix,aggregated,mpiio,gzip");
+  std::string parsers;
+  std::string thread_counts("1,2,4");
+  std::string cold_mode("file");
+  std::string out_file;
+  int repeats = 3;
+
+  try {
+    TCLAP::CmdLine cmd("Benchmark file readers:  backend x parser x threads, cold page cache", ' ', "0.1");
+
+    TCLAP::ValueArg<std::string> fileArg("F", "file", "input file path", false, filename, "string", cmd);
+    TCLAP::ValueArg<std::string> backendArg("B", "backends", "comma separated backends", false, backends, "string", cmd);
+    TCLAP::ValueArg<std::string> parserArg("P", "parsers", "comma separated raw,fastq,fasta.  default:  raw and the one of the file extension",
+                                           false, parsers, "string", cmd);
+    TCLAP::ValueArg<std::string> threadArg("T", "threads", "comma separated thread counts for record counting", false, thread_counts, "string", cmd);
+    TCLAP::ValueArg<std::string> coldArg("C", "cold", "page cache before each run:  none, file (evict the file), all (clear the page cache)",
+                                         false, cold_mode, "string", cmd);
+    TCLAP::ValueArg<int> repeatArg("R", "repeats", "runs per configuration", false, repeats, "int", cmd);
+    TCLAP::ValueArg<std::string> outArg("O", "output", "CSV output file", false, out_file, "string", cmd);
+
+    cmd.parse(argc, argv);
+
+    filename = fileArg.getValue();
+    backends = backendArg.getValue();
+    parsers = parserArg.getValue();
+    thread_counts = threadArg.getValue();
+    cold_mode = coldArg.getValue();
+    repeats = std::max(1, repeatArg.getValue());
+    out_file = outArg.getValue();
+
+  } catch (TCLAP::ArgException &e)  // catch any exceptions
+  {
+    std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+    exit(-1);
+  }
+
+  int cold = (cold_mode == "all") ? COLD_ALL : ((cold_mode == "none") ? COLD_NONE : COLD_FILE);
+
+  // parsers from the file extension, e.g. x.fastq or x.fastq.gz.
+  std::vector<int> parser_ids;
+  if (parsers.empty()) {
+    parser_ids.push_back(RAW);
+    if (filename.find(".fastq") != std::string::npos || filename.find(".fq") != std::string::npos) parser_ids.push_back(FASTQ);
+    else if (filename.find(".fasta") != std::string::npos || filename.find(".fa") != std::string::npos) parser_ids.push_back(FASTA);
+  } else {
+    for (auto const & p : split_list(parsers)) {
+      for (int i = 0; i < 3; ++i) if (p == parser_names[i]) parser_ids.push_back(i);
+    }
+  }
+  std::vector<int> threads;
+  for (auto const & t : split_list(thread_counts)) threads.push_back(std::max(1, atoi(t.c_str())));
+
+  std::ostringstream csv;
+  csv << "backend,parser,threads,procs,bytes,records,load_s_best,count_s_best,total_s_best,total_s_mean,GBps_best,GBps_mean,"
+      "records_per_s_best,records_per_s_mean" << std::endl;
+  if (comm.rank() == 0)
+    printf("file %s, %d procs, cold %s, %d repeats\n", filename.c_str(), comm.size(), cold_mode.c_str(), repeats);
+
+  for (auto const & backend : split_list(backends)) {
+    for (int parser : parser_ids) {
+      for (int nthreads : threads) {
+
+        std::vector<double> totals;
+        double best_load = 0.0, best_count = 0.0, best_total = 0.0;
+        size_t bytes = 0, records = 0;
+        bool ran = true;
+
+        for (int rep = 0; rep < repeats && ran; ++rep) {
+          make_cold(filename, cold, comm, node);
+
+          io_run r;
+          ran = run_backend(backend, filename, parser, nthreads, comm, r);
+          if (!ran) break;
+
+          // the slowest process decides.
+          double load = ::mxx::allreduce(r.load, ::mxx::max<double>(), comm);
+          double count = ::mxx::allreduce(r.count, ::mxx::max<double>(), comm);
+          double total = ::mxx::allreduce(r.load + r.count, ::mxx::max<double>(), comm);
+          bytes = ::mxx::allreduce(r.bytes, comm);
+          records = ::mxx::allreduce(r.records, comm);
+
+          totals.push_back(total);
+          if (rep == 0 || total < best_total) {
+            best_total = total;
+            best_load = load;
+            best_count = count;
+          }
+        }
+        if (!ran) {
+          if (comm.rank() == 0) printf("%-10s %-5s skipped (not built, or not for this file)\n", backend.c_str(), parser_names[parser]);
+          break;   // same for all thread counts.
+        }
+
+        double mean_total = 0.0;
+        for (auto t : totals) mean_total += t;
+        mean_total /= totals.size();
+
+        double gbps_best = (best_total > 0) ? (bytes / best_total * 1e-9) : 0.0;
+        double gbps_mean = (mean_total > 0) ? (bytes / mean_total * 1e-9) : 0.0;
+        double rps_best = (best_total > 0) ? (records / best_total) : 0.0;
+        double rps_mean = (mean_total > 0) ? (records / mean_total) : 0.0;
+
+        if (comm.rank() == 0) {
+          printf("%-10s %-5s T=%-3d %12lu bytes %10lu records  load %8.4fs count %8.4fs  %7.3f GB/s (mean %7.3f)  %12.0f rec/s (mean %12.0f)\n",
+                 backend.c_str(), parser_names[parser], nthreads, bytes, records, best_load, best_count,
+                 gbps_best, gbps_mean, rps_best, rps_mean);
+          fflush(stdout);
+        }
+        csv << backend << "," << parser_names[parser] << "," << nthreads << "," << comm.size() << "," << bytes << "," <<
+            records << "," << best_load << "," << best_count << "," << best_total << "," << mean_total << "," <<
+            gbps_best << "," << gbps_mean << "," << rps_best << "," << rps_mean << std::endl;
+      }
+    }
+  }
+
+  if (comm.rank() == 0 && !out_file.empty()) {
+    std::ofstream ofs(out_file);
+    ofs << csv.str();
+  }
+
+  comm.barrier();
+
+  return 0;
+}
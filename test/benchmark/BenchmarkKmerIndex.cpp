@@ -61,13 +61,17 @@
 #include "index/kmer_index.hpp"
 
 #include "utils/benchmark_utils.hpp"
+#include "utils/event_trace.hpp"
 #include "utils/exception_handling.hpp"
 
 #include "tclap/CmdLine.h"
+#include "utils/topology.hpp"
 
 #include "mxx/env.hpp"
 #include "mxx/comm.hpp"
 
+#include "query_workload.hpp"
+
 // ================ define preproc macro constants
 // needed as #if can only calculate constant int expressions
 #define FASTA 1
@@ -80,6 +84,7 @@
 #define STD 21
 #define MURMUR 22
 #define FARM 23
+#define MINIMIZER 24
 
 #define POS 31
 #define POSQUAL 32
@@ -110,10 +115,13 @@ using Alphabet = bliss::common::DNA5;
 using Alphabet = bliss::common::DNA;
 #endif
 
-#if defined(pK)
-using KmerType = bliss::common::Kmer<pK, Alphabet, WordType>;
+// k is fixed at compile time by pK, or selected at runtime (-k) from the precompiled sizes when pK is 0 or undefined.
+#if defined(pK) && (pK > 0)
+using KmerSizes = bliss::index::kmer::KmerSizes<pK>;
+#define DEFAULT_K pK
 #else
-using KmerType = bliss::common::Kmer<21, Alphabet, WordType>;
+using KmerSizes = bliss::index::kmer::DefaultKmerSizes;
+#define DEFAULT_K 21
 #endif
 
 //============== index input file format
@@ -128,8 +136,16 @@ using KmerType = bliss::common::Kmer<21, Alphabet, WordType>;
 
 
 // ============  index value type
+// pQUAL = 8 or 16 stores quantized k-mer quality scores.
+#if defined(pQUAL) && (pQUAL == 8)
+using QualType = uint8_t;
+#elif defined(pQUAL) && (pQUAL == 16)
+using QualType = uint16_t;
+#else
 using QualType = float;
-using KmerInfoType = std::pair<IdType, QualType>;
+#endif
+// flat and trivially copyable, see common/packed_pair.hpp.
+using KmerInfoType = bliss::common::packed_pair<IdType, QualType>;
 using CountType = uint32_t;
 
 #if (pINDEX == POS)
@@ -170,6 +186,9 @@ using CountType = uint32_t;
 #elif (pDistHash == MURMUR)
 	template <typename KM>
 	using DistHash = bliss::kmer::hash::murmur<KM, true>;
+#elif (pDistHash == MINIMIZER)
+	template <typename KM>
+	using DistHash = bliss::kmer::hash::minimizer<KM, true>;
 #else // if (pDistHash == FARM)
 	template <typename KM>
 	using DistHash = bliss::kmer::hash::farm<KM, true>;
@@ -209,9 +228,11 @@ using CountType = uint32_t;
 
 	// DEFINE THE MAP TYPE base on the type of data to be stored.
 	#if (pINDEX == POS) || (pINDEX == POSQUAL)  // multimap
+		template <typename KmerType>
 		using MapType = ::dsc::sorted_multimap<
 				KmerType, ValType, MapParams>;
 	#elif (pINDEX == COUNT)  // map
+		template <typename KmerType>
 		using MapType = ::dsc::counting_sorted_map<
 				KmerType, ValType, MapParams>;
 	#endif
@@ -232,9 +253,11 @@ using CountType = uint32_t;
 
 	// DEFINE THE MAP TYPE base on the type of data to be stored.
 	#if (pINDEX == POS) || (pINDEX == POSQUAL)  // multimap
+		template <typename KmerType>
 		using MapType = ::dsc::multimap<
 				KmerType, ValType, MapParams>;
 	#elif (pINDEX == COUNT)  // map
+		template <typename KmerType>
 		using MapType = ::dsc::counting_map<
 				KmerType, ValType, MapParams>;
 	#endif
@@ -246,14 +269,17 @@ using CountType = uint32_t;
   #if (pKmerStore == SINGLE)  // single stranded
     template <typename Key>
     using MapParams = ::bliss::index::kmer::SingleStrandHashMapParams<Key, DistHash, StoreHash, DistTrans>;
+    template <typename KmerType>
     using SpecialKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false>;
   #elif (pKmerStore == CANONICAL)
     template <typename Key>
     using MapParams = ::bliss::index::kmer::CanonicalHashMapParams<Key, DistHash, StoreHash>;
+    template <typename KmerType>
     using SpecialKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true>;
   #elif (pKmerStore == BIMOLECULE)  // bimolecule
     template <typename Key>
     using MapParams = ::bliss::index::kmer::BimoleculeHashMapParams<Key, DistHash, StoreHash>;
+    template <typename KmerType>
     using SpecialKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false>;
   #endif
 
@@ -266,6 +292,7 @@ using CountType = uint32_t;
 //
 //   #elif (pMAP == UNORDERED)
     #if (pMAP == UNORDERED)
+      template <typename KmerType>
       using MapType = ::dsc::unordered_multimap<
           KmerType, ValType, MapParams>;
 //    #elif (pMAP == COMPACTVEC)
@@ -275,14 +302,17 @@ using CountType = uint32_t;
 //      using MapType = ::dsc::unordered_multimap_hashvec<
 //          KmerType, ValType, MapParams>;
     #elif (pMAP == DENSEHASH)
+      template <typename KmerType>
       using MapType = ::dsc::densehash_multimap<
-          KmerType, ValType, MapParams, SpecialKeys>;
+          KmerType, ValType, MapParams, SpecialKeys<KmerType> >;
     #endif
   #elif (pINDEX == COUNT)  // map
     #if (pMAP == DENSEHASH)
+      template <typename KmerType>
       using MapType = ::dsc::counting_densehash_map<
-        KmerType, ValType, MapParams, SpecialKeys>;
+        KmerType, ValType, MapParams, SpecialKeys<KmerType> >;
     #else
+      template <typename KmerType>
       using MapType = ::dsc::counting_unordered_map<
         KmerType, ValType, MapParams>;
     #endif
@@ -297,13 +327,32 @@ using CountType = uint32_t;
 //================ FINALLY, the actual index type.
 
 #if (pINDEX == POS)
-	using IndexType = bliss::index::kmer::PositionIndex<MapType>;
+	template <typename KmerType>
+	using IndexType = bliss::index::kmer::PositionIndex<MapType<KmerType> >;
 
 #elif (pINDEX == POSQUAL)
-  using IndexType = bliss::index::kmer::PositionQualityIndex<MapType>;
+  // pFUSED=1 selects the single pass parser, for comparison with the zip iterator based one.
+  #if defined(pFUSED) && (pFUSED == 1)
+    #if defined(pQUAL) && ((pQUAL == 8) || (pQUAL == 16))
+    template <typename KmerType>
+    using IndexType = bliss::index::kmer::FusedPositionQualityIndex<MapType<KmerType>, bliss::index::QuantizedIllumina18QualityScoreCodec>;
+    #else
+    template <typename KmerType>
+    using IndexType = bliss::index::kmer::FusedPositionQualityIndex<MapType<KmerType> >;
+    #endif
+  #else
+    #if defined(pQUAL) && ((pQUAL == 8) || (pQUAL == 16))
+    template <typename KmerType>
+    using IndexType = bliss::index::kmer::PositionQualityIndex<MapType<KmerType>, bliss::index::QuantizedIllumina18QualityScoreCodec>;
+    #else
+    template <typename KmerType>
+    using IndexType = bliss::index::kmer::PositionQualityIndex<MapType<KmerType> >;
+    #endif
+  #endif
 
 #elif (pINDEX == COUNT)  // map
-	using IndexType = bliss::index::kmer::CountIndex<MapType>;
+	template <typename KmerType>
+	using IndexType = bliss::index::kmer::CountIndex<MapType<KmerType> >;
 #endif
 
 
@@ -392,6 +441,226 @@ void sample(std::vector<KmerType> &query, size_t n, unsigned int seed, mxx::comm
 }
 
 
+/// build, query, and erase an index of KmerType.  instantiated for each k in KmerSizes.
+/// find_overlap where the map has it.  the multimaps' find is already the overlapped find.
+template <typename IndexT, typename KmerType>
+auto find_overlap_or_find(IndexT const & idx, std::vector<KmerType> & query, int)
+-> decltype(idx.find_overlap(query), void()) {
+  idx.find_overlap(query);
+}
+template <typename IndexT, typename KmerType>
+void find_overlap_or_find(IndexT const & idx, std::vector<KmerType> & query, long) {
+  idx.find(query);
+}
+
+/// streaming count query of a FASTQ file where the map has count_async.  the reads whose k-mers are all in the index
+/// are counted.  returns the number of reads and k-mers queried.
+template <typename IndexT>
+auto count_reads_or_skip(IndexT const & idx, std::string const & queryname, size_t const & block_size, size_t & hits,
+                         mxx::comm const &, int)
+-> decltype(idx.count_async(std::vector<typename IndexT::KmerType>()), std::pair<size_t, size_t>()) {
+  auto read_op = [&hits](size_t const &, size_t const * first, size_t const * last) {
+    if (std::find(first, last, 0UL) == last) ++hits;
+  };
+  return idx.template count_reads_posix<bliss::io::FASTQParser, bliss::io::SequencesIterator>(queryname, block_size, read_op);
+}
+template <typename IndexT>
+std::pair<size_t, size_t> count_reads_or_skip(IndexT const &, std::string const &, size_t const &, size_t &,
+                                              mxx::comm const & comm, long) {
+  if (comm.rank() == 0) printf("streaming query needs a map with count_async.  skipped.\n");
+  return std::make_pair(0UL, 0UL);
+}
+
+/// print per batch latency percentiles, in milliseconds.
+void report_latency(std::string const & name, std::vector<double> const & times, mxx::comm const & comm) {
+  if (comm.rank() != 0) return;
+  workload::latency l = workload::summarize(times);
+  printf("replay %-13s batches %lu  mean %.3f  p50 %.3f  p90 %.3f  p99 %.3f  max %.3f ms\n", name.c_str(), l.count,
+         l.mean * 1000.0, l.p50 * 1000.0, l.p90 * 1000.0, l.p99 * 1000.0, l.max * 1000.0);
+}
+
+
+template <typename KmerType>
+struct BenchmarkIndex {
+  static int run(std::string const & filename, std::string const & queryname,
+                 int sample_ratio, int reader_algo, size_t chunk_size, int nthreads,
+                 bool replay, workload::params const & wp, std::string const & trace,
+                 size_t stream_block, mxx::comm const & comm) {
+
+    using IndexT = IndexType<KmerType>;
+
+    if (comm.rank() == 0) printf("k = %u, %u bit kmer storage\n", KmerType::size,
+        bliss::index::kmer::kmer_storage_bits<KmerType::size, Alphabet, WordType>::value);
+
+    // ================  read and get file
+    IndexT idx(comm);
+
+    BL_BENCH_INIT(test);
+
+    if (comm.rank() == 0) printf("reading query %s via posix\n", queryname.c_str());
+    BL_BENCH_START(test);
+    auto query = readForQuery_posix<IndexT>(queryname, comm);
+    BL_BENCH_COLLECTIVE_END(test, "read_query", query.size(), comm);
+
+    BL_BENCH_START(test);
+    sample(query, query.size() / sample_ratio, comm.rank(), comm);
+    BL_BENCH_COLLECTIVE_END(test, "sample", query.size(), comm);
+
+
+    if (chunk_size > 0) {
+  	  BL_BENCH_START(test);
+  	  if (reader_algo == 5) {
+  		if (comm.rank() == 0) printf("streaming build from %s via mmap, chunk %lu\n", filename.c_str(), chunk_size);
+  		idx.template build_mmap<PARSER_TYPE, bliss::io::SequencesIterator>(filename, comm, chunk_size);
+  	  } else if (reader_algo == 7) {
+  		if (comm.rank() == 0) printf("streaming build from %s via posix, chunk %lu\n", filename.c_str(), chunk_size);
+  		idx.template build_posix<PARSER_TYPE, bliss::io::SequencesIterator>(filename, comm, chunk_size);
+  	  } else if (reader_algo == 10) {
+  		if (comm.rank() == 0) printf("streaming build from %s via mpiio, chunk %lu\n", filename.c_str(), chunk_size);
+  		idx.template build_mpiio<PARSER_TYPE, bliss::io::SequencesIterator>(filename, comm, chunk_size);
+  	  } else {
+  		throw std::invalid_argument("missing file reader type");
+  	  }
+  	  BL_BENCH_COLLECTIVE_END(test, "build_chunked", idx.local_size(), comm);
+
+  	  size_t total = idx.size();
+  	  if (comm.rank() == 0) printf("total size after streaming build is %lu\n", total);
+    } else {
+  	  ::std::vector<typename IndexT::KmerParserType::value_type> temp;
+
+  	  BL_BENCH_START(test);
+  //	  if (reader_algo == 2)
+  //	  {
+  //		if (comm.rank() == 0) printf("reading %s via fileloader\n", filename.c_str());
+  //
+  //		idx.read_file<PARSER_TYPE, typename IndexT::KmerParserType>(filename, temp, comm);
+  //
+  //	  } else
+  	  if (reader_algo == 5) {
+  		if (comm.rank() == 0) printf("reading %s via mmap, %d threads\n", filename.c_str(), nthreads);
+  		::bliss::io::KmerFileHelper::read_file_mmap<typename IndexT::KmerParserType, PARSER_TYPE, bliss::io::SequencesIterator>(filename, temp, comm, nthreads);
+
+  	  } else if (reader_algo == 7) {
+  		if (comm.rank() == 0) printf("reading %s via posix, %d threads\n", filename.c_str(), nthreads);
+  		::bliss::io::KmerFileHelper::read_file_posix<typename IndexT::KmerParserType, PARSER_TYPE, bliss::io::SequencesIterator>(filename, temp, comm, nthreads);
+
+  	  } else if (reader_algo == 10){
+  		if (comm.rank() == 0) printf("reading %s via mpiio, %d threads\n", filename.c_str(), nthreads);
+  		::bliss::io::KmerFileHelper::read_file_mpiio<typename IndexT::KmerParserType, PARSER_TYPE, bliss::io::SequencesIterator>(filename, temp, comm, nthreads);
+  	  } else {
+  		throw std::invalid_argument("missing file reader type");
+  	  }
+  	  BL_BENCH_COLLECTIVE_END(test, "read", temp.size(), comm);
+
+  	  size_t total = mxx::allreduce(temp.size(), comm);
+  	  if (comm.rank() == 0) printf("total size is %lu\n", total);
+
+  	  BL_BENCH_START(test);
+  	  idx.insert(temp);
+  	  BL_BENCH_COLLECTIVE_END(test, "insert", idx.local_size(), comm);
+
+      total = idx.size();
+      if (comm.rank() == 0) printf("total size after insert/rehash is %lu\n", total);
+    }
+
+    {
+
+  	  {
+  		  auto lquery = query;
+  		  BL_BENCH_START(test);
+  		  auto counts = idx.count(lquery);
+  		  BL_BENCH_COLLECTIVE_END(test, "count", counts.size(), comm);
+  	  }
+  	  {
+  		  auto lquery = query;
+  		  BL_BENCH_START(test);
+  		  auto found = idx.find(lquery);
+  		  BL_BENCH_COLLECTIVE_END(test, "find", found.size(), comm);
+  	  }
+#if 0
+  	  // separate test because of it being potentially very slow depending on imbalance.
+  	  {
+  		  auto lquery = query;
+
+  	  BL_BENCH_START(test);
+  	  auto found = idx.find_collective(lquery);
+  	  BL_BENCH_COLLECTIVE_END(test, "find_collective", found.size(), comm);
+  	  }
+  	    {
+  	      auto lquery = query;
+
+  	    BL_BENCH_START(test);
+  	    auto found = idx.find_overlap(lquery);
+  	    BL_BENCH_COLLECTIVE_END(test, "find_overlap", found.size(), comm);
+  	    }
+      // separate test because of it being potentially very slow depending on imbalance.
+      {
+        auto lquery = query;
+
+      BL_BENCH_START(test);
+      auto found = idx.find_sendrecv(lquery);
+      BL_BENCH_COLLECTIVE_END(test, "find_sendrecv", found.size(), comm);
+      }
+#endif
+
+#if (pPARSER == FASTQ)
+  	  // streaming query of the whole query file, per read, in bounded memory.
+  	  if (stream_block > 0) {
+  		  if (comm.rank() == 0) printf("streaming count query of %s via posix, block %lu bytes\n", queryname.c_str(), stream_block);
+  		  size_t hits = 0;
+  		  BL_BENCH_START(test);
+  		  auto read = count_reads_or_skip(idx, queryname, stream_block, hits, comm, 0);
+  		  BL_BENCH_COLLECTIVE_END(test, "count_reads", read.second, comm);
+
+  		  read.first = mxx::allreduce(read.first, comm);
+  		  hits = mxx::allreduce(hits, comm);
+  		  if (comm.rank() == 0) printf("streamed %lu reads, %lu with all k-mers in the index\n", read.first, hits);
+  	  }
+#endif
+
+  	  // query workload replay, with per batch latency.
+  	  if (replay) {
+  		  std::vector<std::vector<KmerType> > batches;
+  		  BL_BENCH_START(test);
+  		  if (trace.empty()) batches = workload::synthesize(query, wp, comm);
+  		  else batches = workload::read_trace<KmerType>(trace, comm);
+  		  BL_BENCH_COLLECTIVE_END(test, "workload", batches.size(), comm);
+
+  		  if (comm.rank() == 0) {
+  			  if (trace.empty()) printf("replaying synthetic queries:  hit ratio %f, zipf %f, batch %lu\n", wp.hit_ratio, wp.zipf, wp.batch_size);
+  			  else printf("replaying query trace %s\n", trace.c_str());
+  		  }
+
+  		  BL_BENCH_START(test);
+  		  auto t = workload::replay(batches, [&idx](std::vector<KmerType> & q) { idx.find(q); }, comm);
+  		  BL_BENCH_COLLECTIVE_END(test, "replay_find", t.size(), comm);
+  		  report_latency("find", t, comm);
+
+  		  BL_BENCH_START(test);
+  		  t = workload::replay(batches, [&idx](std::vector<KmerType> & q) { idx.count(q); }, comm);
+  		  BL_BENCH_COLLECTIVE_END(test, "replay_count", t.size(), comm);
+  		  report_latency("count", t, comm);
+
+  		  BL_BENCH_START(test);
+  		  t = workload::replay(batches, [&idx](std::vector<KmerType> & q) { find_overlap_or_find(idx, q, 0); }, comm);
+  		  BL_BENCH_COLLECTIVE_END(test, "replay_overlap", t.size(), comm);
+  		  report_latency("find_overlap", t, comm);
+  	  }
+
+  	  BL_BENCH_START(test);
+  	  idx.erase(query);
+  	  BL_BENCH_COLLECTIVE_END(test, "erase", idx.local_size(), comm);
+
+    }
+
+
+    BL_BENCH_REPORT_MPI_NAMED(test, "app", comm);
+
+    return 0;
+  }
+};
+
+
 /**
  *
  * @param argc
@@ -413,6 +682,14 @@ int main(int argc, char** argv) {
 
   comm.barrier();
 
+  // pin the OpenMP threads per BLISS_PIN_THREADS, and log where every rank and thread runs.
+  {
+    ::bliss::utils::topology::policy pin = ::bliss::utils::topology::policy_from_env();
+    ::bliss::utils::topology::log_placement(comm, pin, ::bliss::utils::topology::pin_omp_threads(pin));
+  }
+  // common time origin for the event trace of all ranks.
+  BL_TRACE_SYNC(comm);
+
 
   //////////////// parse parameters
 
@@ -428,6 +705,18 @@ int main(int argc, char** argv) {
   int sample_ratio = 100;
 
   int reader_algo = -1;
+
+  size_t chunk_size = 0;
+
+  int nthreads = 1;
+
+  unsigned int k = DEFAULT_K;
+
+  bool replay = false;
+  workload::params wp;
+  std::string trace;
+  std::string timeline;
+  size_t stream_block = 0;
   // Wrap everything in a try block.  Do this every time,
   // because exceptions will be thrown for problems.
   try {
@@ -454,6 +743,37 @@ int main(int argc, char** argv) {
                                  "query-sample", "sampling ratio for the query kmers. default=100",
                                  false, sample_ratio, "int", cmd);
 
+    TCLAP::ValueArg<size_t> chunkArg("C",
+                                 "chunk", "number of kmers to parse and insert per round in streaming build. default=0 (parse all, then insert)",
+                                 false, chunk_size, "size_t", cmd);
+
+    TCLAP::ValueArg<int> threadArg("T",
+                                 "threads", "number of OpenMP threads for parsing FASTQ within each process's block. default=1",
+                                 false, nthreads, "int", cmd);
+
+    TCLAP::ValueArg<unsigned int> kArg("k",
+                                 "kmer-size", "k-mer size.  must be one of the precompiled sizes. default=" + std::to_string(DEFAULT_K),
+                                 false, k, "unsigned int", cmd);
+
+    // query workload replay
+    TCLAP::SwitchArg replayArg("W", "workload", "replay synthetic query batches and report per batch latency percentiles", cmd, false);
+    TCLAP::ValueArg<std::string> traceArg("", "trace",
+                                 "query trace to replay instead of synthetic batches:  one k-mer per line, empty line ends a batch",
+                                 false, "", "string", cmd);
+    TCLAP::ValueArg<double> hitArg("", "hit-ratio", "fraction of synthetic queries in the index. default=0.5",
+                                 false, wp.hit_ratio, "double", cmd);
+    TCLAP::ValueArg<double> zipfArg("", "zipf", "Zipf exponent of synthetic query popularity, 0 for uniform. default=1",
+                                 false, wp.zipf, "double", cmd);
+    TCLAP::ValueArg<size_t> batchArg("B", "batch", "synthetic queries per batch per rank. default=1024",
+                                 false, wp.batch_size, "size_t", cmd);
+    TCLAP::ValueArg<size_t> batchesArg("", "batches", "synthetic batches per rank. default=100",
+                                 false, wp.batches, "size_t", cmd);
+    TCLAP::ValueArg<size_t> streamArg("", "stream-block",
+                                 "bytes per block per rank for a streaming per read count query of the query FASTQ file. default=0 (none)",
+                                 false, stream_block, "size_t", cmd);
+    TCLAP::ValueArg<std::string> timelineArg("", "timeline",
+                                 "Chrome trace json of the benchmark sections of all ranks (with ENABLE_TRACE_BENCHMARK). default none",
+                                 false, "", "string", cmd);
 
     // Parse the argv array.
     cmd.parse( argc, argv );
@@ -466,6 +786,18 @@ int main(int argc, char** argv) {
     filename = fileArg.getValue();
     reader_algo = algoArg.getValue();
     sample_ratio = sampleArg.getValue();
+    chunk_size = chunkArg.getValue();
+    nthreads = threadArg.getValue();
+    k = kArg.getValue();
+
+    trace = traceArg.getValue();
+    replay = replayArg.getValue() || !trace.empty();
+    wp.hit_ratio = hitArg.getValue();
+    wp.zipf = zipfArg.getValue();
+    wp.batch_size = batchArg.getValue();
+    wp.batches = batchesArg.getValue();
+    timeline = timelineArg.getValue();
+    stream_block = streamArg.getValue();
 
     // set the default for query to filename, and reparse
 
@@ -483,108 +815,14 @@ int main(int argc, char** argv) {
 
 
 
-  // ================  read and get file
-  IndexType idx(comm);
-
-  BL_BENCH_INIT(test);
-
-  if (comm.rank() == 0) printf("reading query %s via posix\n", queryname.c_str());
-  BL_BENCH_START(test);
-  auto query = readForQuery_posix<IndexType>(queryname, comm);
-  BL_BENCH_COLLECTIVE_END(test, "read_query", query.size(), comm);
-
-  BL_BENCH_START(test);
-  sample(query, query.size() / sample_ratio, comm.rank(), comm);
-  BL_BENCH_COLLECTIVE_END(test, "sample", query.size(), comm);
-
-
-  {
-	  ::std::vector<typename IndexType::KmerParserType::value_type> temp;
-
-	  BL_BENCH_START(test);
-//	  if (reader_algo == 2)
-//	  {
-//		if (comm.rank() == 0) printf("reading %s via fileloader\n", filename.c_str());
-//
-//		idx.read_file<PARSER_TYPE, typename IndexType::KmerParserType>(filename, temp, comm);
-//
-//	  } else
-	  if (reader_algo == 5) {
-		if (comm.rank() == 0) printf("reading %s via mmap\n", filename.c_str());
-		::bliss::io::KmerFileHelper::read_file_mmap<typename IndexType::KmerParserType, PARSER_TYPE, bliss::io::SequencesIterator>(filename, temp, comm);
-
-	  } else if (reader_algo == 7) {
-		if (comm.rank() == 0) printf("reading %s via posix\n", filename.c_str());
-		::bliss::io::KmerFileHelper::read_file_posix<typename IndexType::KmerParserType, PARSER_TYPE, bliss::io::SequencesIterator>(filename, temp, comm);
-
-	  } else if (reader_algo == 10){
-		if (comm.rank() == 0) printf("reading %s via mpiio\n", filename.c_str());
-		::bliss::io::KmerFileHelper::read_file_mpiio<typename IndexType::KmerParserType, PARSER_TYPE, bliss::io::SequencesIterator>(filename, temp, comm);
-	  } else {
-		throw std::invalid_argument("missing file reader type");
-	  }
-	  BL_BENCH_COLLECTIVE_END(test, "read", temp.size(), comm);
-
-	  size_t total = mxx::allreduce(temp.size(), comm);
-	  if (comm.rank() == 0) printf("total size is %lu\n", total);
-
-	  BL_BENCH_START(test);
-	  idx.insert(temp);
-	  BL_BENCH_COLLECTIVE_END(test, "insert", idx.local_size(), comm);
-
-    total = idx.size();
-    if (comm.rank() == 0) printf("total size after insert/rehash is %lu\n", total);
-  }
-
-  {
-
-	  {
-		  auto lquery = query;
-		  BL_BENCH_START(test);
-		  auto counts = idx.count(lquery);
-		  BL_BENCH_COLLECTIVE_END(test, "count", counts.size(), comm);
-	  }
-	  {
-		  auto lquery = query;
-		  BL_BENCH_START(test);
-		  auto found = idx.find(lquery);
-		  BL_BENCH_COLLECTIVE_END(test, "find", found.size(), comm);
-	  }
-#if 0
-	  // separate test because of it being potentially very slow depending on imbalance.
-	  {
-		  auto lquery = query;
-
-	  BL_BENCH_START(test);
-	  auto found = idx.find_collective(lquery);
-	  BL_BENCH_COLLECTIVE_END(test, "find_collective", found.size(), comm);
-	  }
-	    {
-	      auto lquery = query;
-
-	    BL_BENCH_START(test);
-	    auto found = idx.find_overlap(lquery);
-	    BL_BENCH_COLLECTIVE_END(test, "find_overlap", found.size(), comm);
-	    }
-    // separate test because of it being potentially very slow depending on imbalance.
-    {
-      auto lquery = query;
-
-    BL_BENCH_START(test);
-    auto found = idx.find_sendrecv(lquery);
-    BL_BENCH_COLLECTIVE_END(test, "find_sendrecv", found.size(), comm);
-    }
-#endif
-
-	  BL_BENCH_START(test);
-	  idx.erase(query);
-	  BL_BENCH_COLLECTIVE_END(test, "erase", idx.local_size(), comm);
+  // ================  run for the selected k
+  bliss::index::kmer::dispatch_k<BenchmarkIndex, Alphabet, WordType>(k, KmerSizes(),
+      filename, queryname, sample_ratio, reader_algo, chunk_size, nthreads, replay, wp, trace, stream_block, comm);
 
+  if (!timeline.empty()) {
+    BL_TRACE_EXPORT(timeline, comm);
   }
 
-  
-  BL_BENCH_REPORT_MPI_NAMED(test, "app", comm);
-
 
   // mpi cleanup is automatic
   comm.barrier();
@@ -0,0 +1,305 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    BenchmarkMapMemory.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   exact heap footprint of the local k-mer stores, for capacity planning.
+ * @details profile_mem_usage.cpp and BenchmarkHashTables.cpp see memory only as RSS deltas, which include allocator
+ *          slack and pages that were freed but not returned.  here the global operator new and delete are replaced
+ *          with counting versions, so every byte requested through std::allocator (and so by the sparsehash tables,
+ *          the std containers and the fsc containers) is counted.  malloc overhead is not included.
+ *
+ *          input:  n k-mer occurrences of n / m distinct random k-mers, each with 1 to 2m - 1 occurrences (m on
+ *          average), shuffled.  the value of an occurrence is its index.  maps keep one value per distinct k-mer,
+ *          multimaps keep all.  the input is allocated before measuring.
+ *
+ *          for each store, built by a range insert into a default constructed store (mphf_map from the distinct
+ *          pairs):
+ *            steady      live bytes after the build.
+ *            B/key       steady / distinct k-mers.
+ *            B/occ       steady / occurrences.
+ *            load        the store's load_factor(), if it has one.
+ *            peak        most live bytes during the build, including rehashing and staging.
+ *            peak/steady
+ *          with -o, the same table is written as csv.
+ *
+ *          the densehash maps are unsplit for k = 31, and split into lower and upper tables for k = 32, where every
+ *          bit pattern is a valid k-mer and the empty and deleted keys must be taken from the other half.
+ */
+
+#include "bliss-config.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_hash.hpp"
+
+#include "containers/densehash_map.hpp"
+#include "containers/unordered_vecmap.hpp"
+#include "containers/group_hash_map.hpp"
+#include "containers/compressed_multimap.hpp"
+#include "containers/mphf_map.hpp"
+
+#include "tclap/CmdLine.h"
+
+
+// ================ counting global operator new and delete.
+// each block carries its size in a header, so that delete can subtract it.
+namespace memcount {
+  size_t live = 0;
+  size_t peak = 0;
+
+  constexpr size_t header = 16;   // keeps the 16 byte alignment of malloc.
+
+  inline void * allocate(size_t n) {
+    void * p = ::std::malloc(n + header);
+    if (p == nullptr) return nullptr;
+    *static_cast<size_t *>(p) = n;
+    live += n;
+    if (live > peak) peak = live;
+    return static_cast<char *>(p) + header;
+  }
+  inline void deallocate(void * p) {
+    if (p == nullptr) return;
+    char * b = static_cast<char *>(p) - header;
+    live -= *reinterpret_cast<size_t *>(b);
+    ::std::free(b);
+  }
+  inline void reset_peak() { peak = live; }
+} // namespace memcount
+
+void * operator new(size_t n) {
+  void * p = memcount::allocate(n);
+  if (p == nullptr) throw ::std::bad_alloc();
+  return p;
+}
+void * operator new[](size_t n) {
+  return operator new(n);
+}
+void * operator new(size_t n, ::std::nothrow_t const &) noexcept {
+  return memcount::allocate(n);
+}
+void * operator new[](size_t n, ::std::nothrow_t const &) noexcept {
+  return memcount::allocate(n);
+}
+void operator delete(void * p) noexcept { memcount::deallocate(p); }
+void operator delete[](void * p) noexcept { memcount::deallocate(p); }
+void operator delete(void * p, ::std::nothrow_t const &) noexcept { memcount::deallocate(p); }
+void operator delete[](void * p, ::std::nothrow_t const &) noexcept { memcount::deallocate(p); }
+#if defined(__cpp_sized_deallocation)
+void operator delete(void * p, size_t) noexcept { memcount::deallocate(p); }
+void operator delete[](void * p, size_t) noexcept { memcount::deallocate(p); }
+#endif
+
+
+using Value = uint32_t;
+
+/// one row of the report.
+struct footprint {
+    std::string name;
+    unsigned int k;
+    size_t distinct;
+    size_t occurrences;
+    size_t steady;
+    size_t peak;
+    double load;   // negative if the store has no load factor.
+};
+
+template <typename Kmer>
+struct input {
+    std::vector<std::pair<Kmer, Value> > occurrences;
+    std::vector<std::pair<Kmer, Value> > distinct;   // first occurrence of each k-mer.
+};
+
+/// n occurrences, about n / m distinct k-mers.
+template <typename Kmer>
+input<Kmer> generate_input(size_t const n, size_t const m, unsigned int const seed) {
+  std::mt19937_64 gen(seed);
+
+  input<Kmer> in;
+  in.occurrences.reserve(n);
+  while (in.occurrences.size() < n) {
+    Kmer km;
+    for (size_t j = 0; j < Kmer::nWords; ++j) {
+      km.getDataRef()[j] = static_cast<typename Kmer::KmerWordType>(gen());
+    }
+    km.sanitize();
+
+    size_t reps = 1 + gen() % (2 * m - 1);
+    for (size_t r = 0; (r < reps) && (in.occurrences.size() < n); ++r) {
+      in.occurrences.emplace_back(km, 0);
+    }
+  }
+  std::shuffle(in.occurrences.begin(), in.occurrences.end(), gen);
+  for (size_t i = 0; i < n; ++i) in.occurrences[i].second = i;
+
+  // random words may repeat a k-mer by chance, so dedupe rather than count the draws.
+  in.distinct = in.occurrences;
+  std::stable_sort(in.distinct.begin(), in.distinct.end(),
+                   [](std::pair<Kmer, Value> const & x, std::pair<Kmer, Value> const & y) { return x.first < y.first; });
+  in.distinct.erase(std::unique(in.distinct.begin(), in.distinct.end(),
+                                [](std::pair<Kmer, Value> const & x, std::pair<Kmer, Value> const & y) { return x.first == y.first; }),
+                    in.distinct.end());
+  in.distinct.shrink_to_fit();
+  return in;
+}
+
+// load factor, if the store has one.  densehash_map's is not const.
+template <typename Map>
+auto load_factor(Map & map, int) -> decltype(static_cast<double>(map.load_factor())) {
+  return static_cast<double>(map.load_factor());
+}
+template <typename Map>
+double load_factor(Map &, long) {
+  return -1.0;
+}
+
+/**
+ * @brief  footprint of a store built by build(), which returns a new Map.
+ */
+template <typename Map, typename Kmer, typename Build>
+footprint measure(std::string const & name, input<Kmer> const & in, Build const & build) {
+  footprint f;
+  f.name = name;
+  f.k = Kmer::size;
+  f.distinct = in.distinct.size();
+  f.occurrences = in.occurrences.size();
+
+  size_t base = memcount::live;
+  memcount::reset_peak();
+  Map * map = build();
+  f.steady = memcount::live - base;
+  f.peak = memcount::peak - base;
+  f.load = load_factor(*map, 0);
+  delete map;
+
+  if (memcount::live != base) {
+    fprintf(stderr, "WARNING: %s leaked %ld bytes\n", name.c_str(), static_cast<long>(memcount::live - base));
+  }
+  return f;
+}
+
+// non-const input:  unordered_compact_vecmap::insert forwards the values out of the range.
+template <typename Map, typename Kmer>
+footprint measure_insert(std::string const & name, input<Kmer> & in) {
+  return measure<Map>(name, in, [&in]() {
+    Map * map = new Map();
+    map->insert(in.occurrences.begin(), in.occurrences.end());
+    return map;
+  });
+}
+
+template <typename Kmer>
+void benchmark(size_t const n, size_t const m, unsigned int const seed, std::vector<footprint> & rows) {
+  using Hash = ::bliss::kmer::hash::farm<Kmer, false>;
+  using Special = ::bliss::kmer::hash::sparsehash::special_keys<Kmer, false>;
+
+  input<Kmer> in = generate_input<Kmer>(n, m, seed);
+  std::string split = Special::need_to_split ? "split" : "unsplit";
+
+  // maps
+  rows.emplace_back(measure_insert<std::map<Kmer, Value>, Kmer>("std::map", in));
+  rows.emplace_back(measure_insert<std::unordered_map<Kmer, Value, Hash>, Kmer>("std::unordered_map", in));
+  rows.emplace_back(measure_insert<::fsc::densehash_map<Kmer, Value, Special, ::bliss::transform::identity, Hash>, Kmer>(
+      "densehash_map_" + split, in));
+  rows.emplace_back(measure_insert<::fsc::group_hash_map<Kmer, Value, void, ::bliss::transform::identity, Hash,
+                                                         ::std::equal_to<Kmer> >, Kmer>("group_hash_map", in));
+  using MPHF = ::fsc::mphf_map<Kmer, Value, Hash>;
+  rows.emplace_back(measure<MPHF>("mphf_map", in, [&in]() { return new MPHF(in.distinct); }));
+
+  // multimaps
+  rows.emplace_back(measure_insert<std::unordered_multimap<Kmer, Value, Hash>, Kmer>("std::unordered_multimap", in));
+  rows.emplace_back(measure_insert<::fsc::densehash_multimap<Kmer, Value, Special, ::bliss::transform::identity, Hash>, Kmer>(
+      "densehash_multimap_" + split, in));
+  rows.emplace_back(measure_insert<::fsc::unordered_vecmap<Kmer, Value, Hash>, Kmer>("unordered_vecmap", in));
+  rows.emplace_back(measure_insert<::fsc::unordered_compact_vecmap<Kmer, Value, Hash>, Kmer>("unordered_compact_vecmap", in));
+  using CMM = ::fsc::compressed_multimap<Kmer, Value, Hash>;
+  rows.emplace_back(measure<CMM>("compressed_multimap", in, [&in]() {
+    CMM * map = new CMM();
+    map->insert(in.occurrences.begin(), in.occurrences.end());
+    map->build();   // staged entries are encoded on first query.
+    return map;
+  }));
+}
+
+
+int main(int argc, char** argv) {
+
+  size_t count = 10000000;
+  size_t mult = 4;
+  unsigned int seed = 23;
+  std::string csv;
+
+  try {
+    TCLAP::CmdLine cmd("Exact heap footprint of the local k-mer stores", ' ', "0.1");
+
+    TCLAP::ValueArg<size_t> countArg("c", "count", "number of k-mer occurrences. default=10000000", false, count, "size_t", cmd);
+    TCLAP::ValueArg<size_t> multArg("m", "multiplicity", "average occurrences per distinct k-mer. default=4",
+                                    false, mult, "size_t", cmd);
+    TCLAP::ValueArg<unsigned int> seedArg("", "seed", "random seed. default=23", false, seed, "unsigned int", cmd);
+    TCLAP::ValueArg<std::string> csvArg("o", "output", "csv output file. default none", false, "", "string", cmd);
+
+    cmd.parse(argc, argv);
+
+    count = countArg.getValue();
+    mult = std::max(static_cast<size_t>(1), multArg.getValue());
+    seed = seedArg.getValue();
+    csv = csvArg.getValue();
+
+  } catch (TCLAP::ArgException &e)  // catch any exceptions
+  {
+    std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+    exit(-1);
+  }
+
+  printf("EXECUTING %s:  %lu occurrences, multiplicity %lu, seed %u\n", argv[0], count, mult, seed);
+
+  std::vector<footprint> rows;
+  benchmark<::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t> >(count, mult, seed, rows);
+  benchmark<::bliss::common::Kmer<32, ::bliss::common::DNA, uint64_t> >(count, mult, seed, rows);
+
+  FILE * out = csv.empty() ? nullptr : fopen(csv.c_str(), "w");
+  if (out) fprintf(out, "store,k,distinct,occurrences,steady_bytes,bytes_per_key,bytes_per_occurrence,load_factor,peak_bytes,peak_over_steady\n");
+  printf("%-30s %3s %10s %12s %14s %8s %8s %6s %14s %8s\n",
+         "store", "k", "distinct", "occurrences", "steady", "B/key", "B/occ", "load", "peak", "peak/st");
+  for (auto const & f : rows) {
+    double per_key = static_cast<double>(f.steady) / static_cast<double>(std::max(f.distinct, static_cast<size_t>(1)));
+    double per_occ = static_cast<double>(f.steady) / static_cast<double>(std::max(f.occurrences, static_cast<size_t>(1)));
+    double ratio = (f.steady == 0) ? 0.0 : static_cast<double>(f.peak) / static_cast<double>(f.steady);
+    std::string load = (f.load < 0.0) ? std::string("-") : std::to_string(f.load).substr(0, 5);
+
+    printf("%-30s %3u %10lu %12lu %14lu %8.2f %8.2f %6s %14lu %8.3f\n", f.name.c_str(), f.k, f.distinct, f.occurrences,
+           f.steady, per_key, per_occ, load.c_str(), f.peak, ratio);
+    if (out) fprintf(out, "%s,%u,%lu,%lu,%lu,%f,%f,%s,%lu,%f\n", f.name.c_str(), f.k, f.distinct, f.occurrences,
+                     f.steady, per_key, per_occ, (f.load < 0.0) ? "" : std::to_string(f.load).c_str(), f.peak, ratio);
+  }
+  if (out) fclose(out);
+
+  return 0;
+}
@@ -0,0 +1,386 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    BenchmarkScaling.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   strong and weak scaling of k-mer index build and query, on synthetic reads.
+ * @details reads come from bliss::io::ReadSimulator, generated in memory on each rank, so runs are reproducible
+ *          without input files.  in one mpirun, the benchmark is repeated on the first p ranks for each p in the rank
+ *          list (default 1, 2, 4, ... up to the communicator size), while the other ranks wait.
+ *
+ *          strong scaling keeps the genome fixed.  weak scaling uses genome * p, so the reads per rank are fixed.
+ *
+ *          phases, each timed as the max over ranks of the best of the repetitions:
+ *            simulate    generate and pack the reads of the rank.
+ *            generate    k-mer tuples from the packed reads.
+ *            insert      distribute and insert into the index.
+ *            count, find a 1 / sample fraction of the rank's k-mers.
+ *          for each p, rank 0 prints time, speedup and parallel efficiency per phase and in total, relative to the
+ *          smallest p:  strong E = (T0 p0) / (T p), weak E = T0 / T.  with -o, the same table is written as csv.
+ *
+ *          index type is chosen at compile time as in BenchmarkKmerIndex.cpp:  pDNA, pK, pKmerStore, pMAP
+ *          (SORTED, UNORDERED, DENSEHASH) and pINDEX (COUNT, POS).
+ */
+
+#include "bliss-config.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "utils/logging.h"
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "io/read_simulator.hpp"
+#include "index/kmer_index.hpp"
+
+#include "tclap/CmdLine.h"
+#include "utils/topology.hpp"
+
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+// ================ define preproc macro constants, same as BenchmarkKmerIndex.cpp
+#define POS 31
+#define COUNT 33
+
+#define SORTED 41
+#define UNORDERED 46
+#define DENSEHASH 47
+
+#define SINGLE 51
+#define CANONICAL 52
+#define BIMOLECULE 53
+
+#if !defined(pDNA)
+#define pDNA 4
+#endif
+#if !defined(pK)
+#define pK 31
+#endif
+#if !defined(pKmerStore)
+#define pKmerStore CANONICAL
+#endif
+#if !defined(pMAP)
+#define pMAP DENSEHASH
+#endif
+#if !defined(pINDEX)
+#define pINDEX COUNT
+#endif
+
+#if (pDNA == 16)
+using Alphabet = bliss::common::DNA16;
+#elif (pDNA == 5)
+using Alphabet = bliss::common::DNA5;
+#else
+using Alphabet = bliss::common::DNA;
+#endif
+
+using KmerType = bliss::common::Kmer<pK, Alphabet, uint64_t>;
+using IdType = bliss::common::ShortSequenceKmerId;
+
+#if (pINDEX == POS)
+using ValType = IdType;
+#else
+using ValType = uint32_t;
+#endif
+
+#if (pMAP == SORTED)
+  #if (pKmerStore == SINGLE)
+    template <typename Key>
+    using MapParams = ::bliss::index::kmer::SingleStrandSortedMapParams<Key>;
+  #elif (pKmerStore == CANONICAL)
+    template <typename Key>
+    using MapParams = ::bliss::index::kmer::CanonicalSortedMapParams<Key>;
+  #else
+    template <typename Key>
+    using MapParams = ::bliss::index::kmer::BimoleculeSortedMapParams<Key>;
+  #endif
+
+  #if (pINDEX == POS)
+    using MapType = ::dsc::sorted_multimap<KmerType, ValType, MapParams>;
+  #else
+    using MapType = ::dsc::counting_sorted_map<KmerType, ValType, MapParams>;
+  #endif
+#else
+  #if (pKmerStore == SINGLE)
+    template <typename Key>
+    using MapParams = ::bliss::index::kmer::SingleStrandHashMapParams<Key>;
+    using SpecialKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false>;
+  #elif (pKmerStore == CANONICAL)
+    template <typename Key>
+    using MapParams = ::bliss::index::kmer::CanonicalHashMapParams<Key>;
+    using SpecialKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true>;
+  #else
+    template <typename Key>
+    using MapParams = ::bliss::index::kmer::BimoleculeHashMapParams<Key>;
+    using SpecialKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false>;
+  #endif
+
+  #if (pINDEX == POS) && (pMAP == DENSEHASH)
+    using MapType = ::dsc::densehash_multimap<KmerType, ValType, MapParams, SpecialKeys>;
+  #elif (pINDEX == POS)
+    using MapType = ::dsc::unordered_multimap<KmerType, ValType, MapParams>;
+  #elif (pMAP == DENSEHASH)
+    using MapType = ::dsc::counting_densehash_map<KmerType, ValType, MapParams, SpecialKeys>;
+  #else
+    using MapType = ::dsc::counting_unordered_map<KmerType, ValType, MapParams>;
+  #endif
+#endif
+
+#if (pINDEX == POS)
+using IndexType = bliss::index::kmer::PositionIndex<MapType>;
+#else
+using IndexType = bliss::index::kmer::CountIndex<MapType>;
+#endif
+
+
+/// phase names, in order.
+static const std::vector<std::string> phases = {"simulate", "generate", "insert", "count", "find"};
+
+
+/// seconds since start
+inline double elapsed(std::chrono::steady_clock::time_point const & start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief  one repetition on comm.  returns the max over ranks of the time of each phase, and the global k-mer count.
+ */
+std::vector<double> run_once(bliss::io::ReadSimulator const & sim, size_t sample, mxx::comm const & comm,
+                             size_t & total_kmers, size_t & distinct_kmers) {
+  std::vector<double> t(phases.size(), 0.0);
+  std::chrono::steady_clock::time_point start;
+
+  // simulate
+  comm.barrier();
+  start = std::chrono::steady_clock::now();
+  bliss::io::PackedReadStore<Alphabet> store;
+  sim.fill(store, KmerType::size, comm.rank(), comm.size());
+  t[0] = elapsed(start);
+
+  // generate
+  comm.barrier();
+  start = std::chrono::steady_clock::now();
+  std::vector<typename IndexType::KmerParserType::value_type> temp;
+  store.template generate<typename IndexType::KmerParserType>(temp);
+  t[1] = elapsed(start);
+
+  // query:  every sample-th k-mer of the rank, taken before the insert consumes temp.
+  std::vector<KmerType> query;
+  query.reserve(temp.size() / sample + 1);
+  for (size_t i = 0; i < temp.size(); i += sample) query.emplace_back(temp[i].first);
+  total_kmers = mxx::allreduce(temp.size(), comm);
+
+  // insert
+  IndexType idx(comm);
+  comm.barrier();
+  start = std::chrono::steady_clock::now();
+  idx.insert(temp);
+  t[2] = elapsed(start);
+  distinct_kmers = idx.size();
+
+  // count
+  {
+    auto q = query;
+    comm.barrier();
+    start = std::chrono::steady_clock::now();
+    auto counts = idx.count(q);
+    t[3] = elapsed(start);
+  }
+  // find
+  {
+    auto q = query;
+    comm.barrier();
+    start = std::chrono::steady_clock::now();
+    auto found = idx.find(q);
+    t[4] = elapsed(start);
+  }
+
+  for (size_t j = 0; j < t.size(); ++j) t[j] = mxx::allreduce(t[j], mxx::max<double>(), comm);
+  return t;
+}
+
+
+/// parse a comma separated list of rank counts.
+std::vector<int> parse_ranks(std::string const & s) {
+  std::vector<int> out;
+  std::stringstream ss(s);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (!item.empty()) out.push_back(std::stoi(item));
+  }
+  return out;
+}
+
+
+int main(int argc, char** argv) {
+
+  //////////////// init logging
+  LOG_INIT();
+
+  //////////////// initialize MPI and openMP
+  mxx::env e(argc, argv);
+  mxx::comm comm;
+
+  if (comm.rank() == 0) printf("EXECUTING %s\n", argv[0]);
+  comm.barrier();
+
+  // pin the OpenMP threads per BLISS_PIN_THREADS, and log where every rank and thread runs.
+  {
+    ::bliss::utils::topology::policy pin = ::bliss::utils::topology::policy_from_env();
+    ::bliss::utils::topology::log_placement(comm, pin, ::bliss::utils::topology::pin_omp_threads(pin));
+  }
+
+  //////////////// parse parameters
+  bliss::io::ReadSimulator::params sp;
+  bool weak = false;
+  std::vector<int> ranks;
+  int reps = 3;
+  size_t sample = 100;
+  std::string csv;
+
+  try {
+    TCLAP::CmdLine cmd("Strong and weak scaling of k-mer index build and query on synthetic reads", ' ', "0.1");
+
+    TCLAP::ValueArg<uint64_t> genomeArg("G", "genome", "genome length.  per rank for weak scaling. default=1000000",
+                                        false, sp.genome_length, "uint64_t", cmd);
+    TCLAP::ValueArg<size_t> lenArg("L", "read-length", "read length. default=100", false, sp.read_length, "size_t", cmd);
+    TCLAP::ValueArg<double> covArg("c", "coverage", "coverage. default=10", false, sp.coverage, "double", cmd);
+    TCLAP::ValueArg<double> errArg("e", "error-rate", "per base substitution rate. default=0", false, sp.error_rate, "double", cmd);
+    TCLAP::ValueArg<double> repArg("r", "repeat-fraction", "fraction of the genome in repeats. default=0",
+                                   false, sp.repeat_fraction, "double", cmd);
+    TCLAP::ValueArg<size_t> repLenArg("", "repeat-length", "repeat segment length. default=500",
+                                      false, sp.repeat_length, "size_t", cmd);
+    TCLAP::ValueArg<size_t> repUnitsArg("", "repeat-units", "number of distinct repeats. default=16",
+                                        false, sp.repeat_units, "size_t", cmd);
+    TCLAP::ValueArg<double> skewArg("s", "skew", "fraction of reads from the hot region. default=0", false, sp.skew, "double", cmd);
+    TCLAP::ValueArg<double> hotArg("", "hot-fraction", "fraction of the genome that is hot. default=0.01",
+                                   false, sp.hot_fraction, "double", cmd);
+    TCLAP::ValueArg<uint64_t> seedArg("", "seed", "random seed. default=42", false, sp.seed, "uint64_t", cmd);
+    TCLAP::SwitchArg weakArg("W", "weak", "weak scaling:  genome length is per rank", cmd, false);
+    TCLAP::ValueArg<std::string> ranksArg("P", "ranks", "comma separated rank counts. default=1,2,4,... up to the number of ranks",
+                                          false, "", "string", cmd);
+    TCLAP::ValueArg<int> repsArg("R", "repeat", "repetitions per rank count, best is reported. default=3", false, reps, "int", cmd);
+    TCLAP::ValueArg<size_t> sampleArg("S", "query-sample", "query every S-th k-mer. default=100", false, sample, "size_t", cmd);
+    TCLAP::ValueArg<std::string> csvArg("o", "output", "csv output file. default none", false, "", "string", cmd);
+
+    cmd.parse( argc, argv );
+
+    sp.genome_length = genomeArg.getValue();
+    sp.read_length = lenArg.getValue();
+    sp.coverage = covArg.getValue();
+    sp.error_rate = errArg.getValue();
+    sp.repeat_fraction = repArg.getValue();
+    sp.repeat_length = repLenArg.getValue();
+    sp.repeat_units = repUnitsArg.getValue();
+    sp.skew = skewArg.getValue();
+    sp.hot_fraction = hotArg.getValue();
+    sp.seed = seedArg.getValue();
+    weak = weakArg.getValue();
+    ranks = parse_ranks(ranksArg.getValue());
+    reps = std::max(1, repsArg.getValue());
+    sample = std::max(static_cast<size_t>(1), sampleArg.getValue());
+    csv = csvArg.getValue();
+
+  } catch (TCLAP::ArgException &e)  // catch any exceptions
+  {
+    std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+    exit(-1);
+  }
+
+  if (ranks.empty()) {
+    for (int p = 1; p < comm.size(); p <<= 1) ranks.push_back(p);
+    ranks.push_back(comm.size());
+  }
+  std::sort(ranks.begin(), ranks.end());
+  ranks.erase(std::unique(ranks.begin(), ranks.end()), ranks.end());
+  ranks.erase(std::remove_if(ranks.begin(), ranks.end(), [&comm](int p) { return (p < 1) || (p > comm.size()); }), ranks.end());
+
+  if (comm.rank() == 0) {
+    printf("%s scaling, k = %u, genome %lu%s, read length %lu, coverage %f, error %f, repeat %f, skew %f, seed %lu\n",
+           (weak ? "weak" : "strong"), KmerType::size, sp.genome_length, (weak ? " per rank" : ""), sp.read_length,
+           sp.coverage, sp.error_rate, sp.repeat_fraction, sp.skew, sp.seed);
+  }
+
+  //////////////// run for each rank count
+  // times[i][j]:  rank count i, phase j.  the last column is the total.
+  std::vector<std::vector<double> > times;
+  std::vector<size_t> totals, distincts;
+
+  for (int p : ranks) {
+    bliss::io::ReadSimulator::params rp = sp;
+    if (weak) rp.genome_length = sp.genome_length * p;
+    bliss::io::ReadSimulator sim(rp);
+
+    std::vector<double> best(phases.size() + 1, std::numeric_limits<double>::max());
+    size_t total = 0, distinct = 0;
+
+    mxx::comm sub = comm.split(comm.rank() < p ? 1 : 0);
+    if (comm.rank() < p) {
+      for (int rep = 0; rep < reps; ++rep) {
+        std::vector<double> t = run_once(sim, sample, sub, total, distinct);
+        double sum = 0.0;
+        for (size_t j = 0; j < t.size(); ++j) {
+          best[j] = std::min(best[j], t[j]);
+          sum += t[j];
+        }
+        best.back() = std::min(best.back(), sum);
+      }
+    }
+    comm.barrier();
+
+    times.push_back(best);
+    totals.push_back(total);
+    distincts.push_back(distinct);
+    if (comm.rank() == 0) printf("p = %d:  %lu k-mers, index size %lu\n", p, total, distinct);
+  }
+
+  //////////////// report, relative to the smallest rank count
+  if (comm.rank() == 0) {
+    FILE * out = csv.empty() ? nullptr : fopen(csv.c_str(), "w");
+    if (out) fprintf(out, "mode,ranks,phase,seconds,speedup,efficiency,kmers,entries\n");
+
+    printf("%-6s %-10s %12s %10s %10s\n", "ranks", "phase", "seconds", "speedup", "efficiency");
+    for (size_t i = 0; i < ranks.size(); ++i) {
+      for (size_t j = 0; j <= phases.size(); ++j) {
+        std::string name = (j < phases.size()) ? phases[j] : std::string("total");
+        double t0 = times[0][j];
+        double t = times[i][j];
+        // speedup in work per unit time.  strong:  T0 / T.  weak:  the work grows with p.
+        double speedup = (t > 0.0) ? (weak ? (t0 * ranks[i]) / (t * ranks[0]) : t0 / t) : 0.0;
+        double efficiency = speedup * ranks[0] / ranks[i];
+        printf("%-6d %-10s %12.6f %10.3f %10.3f\n", ranks[i], name.c_str(), t, speedup, efficiency);
+        if (out) fprintf(out, "%s,%d,%s,%f,%f,%f,%lu,%lu\n", (weak ? "weak" : "strong"), ranks[i], name.c_str(),
+                         t, speedup, efficiency, totals[i], distincts[i]);
+      }
+    }
+    if (out) fclose(out);
+  }
+
+  // mpi cleanup is automatic
+  comm.barrier();
+
+  return 0;
+}
@@ -28,6 +28,7 @@
 #include <iostream>
 #include <cstring>
 #include "utils/benchmark_utils.hpp"
+#include "utils/tsc_clock.hpp"
 
 timespec operator-(timespec end, timespec start)
 {
@@ -64,12 +65,30 @@ int main(int argc, char** argv) {
     iters = atoi(argv[2]);
   }
 
+  // -t:  clock_gettime.  -r:  tsc_clock.  else:  the timer macros.
   bool chron = true;
+  bool tsc = false;
   if (argc > 1) {
     if (strncmp(argv[1], "-t", 2) == 0) chron = false;
+    if (strncmp(argv[1], "-r", 2) == 0) tsc = true;
   }
   double dummy = 0;
-  if (chron) {
+  if (tsc) {
+
+    ::plog::tsc_clock::duration duration = ::plog::tsc_clock::duration::zero();
+
+    for (int i = 0; i < iters; ++i) {
+      ::plog::tsc_clock::time_point start = ::plog::tsc_clock::now();
+
+      dummy += 0.00001;
+
+      duration += ::plog::tsc_clock::now() - start;
+    }
+
+    std::cout << "elapsed: " << duration.count() << "ns" << (::plog::tsc_clock::available() ? "" : " (no invariant TSC)") <<
+        " TSC " << ::plog::tsc_clock::frequency() << " Hz" << std::endl;
+
+  } else if (chron) {
 
 
     BL_TIMER_INIT(test);
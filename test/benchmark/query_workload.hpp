@@ -0,0 +1,206 @@
+/*
+ * Copyright 2016 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    query_workload.hpp
+ * @ingroup
+ * @author  tpan
+ * @brief   query batches for the distributed map benchmarks, replayed from a trace or synthesized, and per batch latency.
+ * @details synthesized workload:  each rank issues batches of batch_size k-mers.  a hit is drawn from a pool of k-mers
+ *          in the index, shared by all ranks (taken from rank 0), with Zipf(zipf) popularity over the pool, so hot keys
+ *          are hot on every rank.  zipf = 0 is uniform.  a miss is a random k-mer, which for k >= 21 is almost never in
+ *          the index.
+ *
+ *          trace file:  ASCII, one k-mer per line.  an empty line or a line starting with '#' ends a batch.  batch i
+ *          is issued by rank i % p.  lines shorter than k are skipped, longer ones are truncated to k.
+ *
+ *          every batch is a collective call, so all ranks issue the same number of batches, padding with empty ones.
+ *          the latency of a batch is the max over ranks.
+ */
+#ifndef BENCHMARK_QUERY_WORKLOAD_HPP_
+#define BENCHMARK_QUERY_WORKLOAD_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+namespace workload {
+
+  struct params {
+      /// fraction of queries that are in the index.
+      double hit_ratio;
+      /// Zipf exponent of the hit key popularity.  0 is uniform.
+      double zipf;
+      size_t batch_size;
+      /// number of batches per rank.
+      size_t batches;
+      /// most k-mers in the shared hit pool.
+      size_t pool_size;
+      unsigned int seed;
+
+      params() : hit_ratio(0.5), zipf(1.0), batch_size(1024), batches(100), pool_size(1 << 20), seed(17) {}
+  };
+
+  /// random k-mer from ACGT.
+  template <typename KmerType, typename RNG>
+  KmerType random_kmer(RNG & gen) {
+    KmerType km;
+    for (unsigned int i = 0; i < KmerType::size; ++i) {
+      km.nextFromChar(KmerType::KmerAlphabet::FROM_ASCII[static_cast<unsigned char>("ACGT"[gen() & 0x3])]);
+    }
+    return km;
+  }
+
+  /**
+   * @brief  synthesize this rank's batches.  collective.
+   * @param keys   k-mers in the index, e.g. a sample of the index's input.  rank 0's are the hit pool.
+   */
+  template <typename KmerType>
+  std::vector<std::vector<KmerType> > synthesize(std::vector<KmerType> const & keys, params const & p,
+                                                 mxx::comm const & comm) {
+    // shared pool of hits, in a random order so that popularity is not related to the key order.
+    std::vector<KmerType> pool;
+    if (comm.rank() == 0) {
+      pool = keys;
+      std::sort(pool.begin(), pool.end());
+      pool.erase(std::unique(pool.begin(), pool.end()), pool.end());
+      std::shuffle(pool.begin(), pool.end(), std::mt19937(p.seed));
+      if (pool.size() > p.pool_size) pool.resize(p.pool_size);
+    }
+    size_t n = pool.size();
+    mxx::bcast(n, 0, comm);
+    pool.resize(n);
+    if (n > 0) mxx::bcast(pool.data(), n, 0, comm);
+
+    // Zipf cdf over the pool.
+    std::vector<double> cdf(n);
+    double sum = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+      sum += 1.0 / std::pow(static_cast<double>(i + 1), p.zipf);
+      cdf[i] = sum;
+    }
+
+    std::mt19937_64 gen(p.seed + 7919 * comm.rank());
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+
+    std::vector<std::vector<KmerType> > batches(p.batches);
+    for (auto & b : batches) {
+      b.reserve(p.batch_size);
+      for (size_t i = 0; i < p.batch_size; ++i) {
+        if ((n > 0) && (u(gen) < p.hit_ratio)) {
+          size_t j = std::lower_bound(cdf.begin(), cdf.end(), u(gen) * sum) - cdf.begin();
+          b.emplace_back(pool[std::min(j, n - 1)]);
+        } else {
+          b.emplace_back(random_kmer<KmerType>(gen));
+        }
+      }
+    }
+    return batches;
+  }
+
+  /// read this rank's batches from a trace file.
+  template <typename KmerType>
+  std::vector<std::vector<KmerType> > read_trace(std::string const & filename, mxx::comm const & comm) {
+    std::ifstream in(filename);
+    if (!in.good()) throw std::invalid_argument("cannot open query trace " + filename);
+
+    std::vector<std::vector<KmerType> > batches;
+    std::vector<KmerType> batch;
+    size_t id = 0;
+    std::string line;
+    bool more = true;
+    while (more) {
+      more = static_cast<bool>(std::getline(in, line));
+      if (!more || line.empty() || (line[0] == '#')) {
+        if (!batch.empty()) {
+          if ((id % comm.size()) == static_cast<size_t>(comm.rank())) batches.emplace_back(std::move(batch));
+          batch.clear();
+          ++id;
+        }
+        continue;
+      }
+      if (line.size() < KmerType::size) continue;
+
+      KmerType km;
+      for (unsigned int i = 0; i < KmerType::size; ++i) {
+        km.nextFromChar(KmerType::KmerAlphabet::FROM_ASCII[static_cast<unsigned char>(line[i])]);
+      }
+      batch.emplace_back(km);
+    }
+    return batches;
+  }
+
+  /// latency percentiles, in seconds.
+  struct latency {
+      size_t count;
+      double mean, p50, p90, p99, max;
+  };
+
+  /// nearest rank percentiles.
+  inline latency summarize(std::vector<double> t) {
+    latency l = {t.size(), 0.0, 0.0, 0.0, 0.0, 0.0};
+    if (t.empty()) return l;
+
+    std::sort(t.begin(), t.end());
+    for (double x : t) l.mean += x;
+    l.mean /= t.size();
+    auto pct = [&t](double q) { return t[std::min(t.size() - 1, static_cast<size_t>(std::ceil(q * t.size())) - 1)]; };
+    l.p50 = pct(0.50);
+    l.p90 = pct(0.90);
+    l.p99 = pct(0.99);
+    l.max = t.back();
+    return l;
+  }
+
+  /**
+   * @brief  issue the batches with op, which takes a std::vector<KmerType> &.  collective.
+   * @return latency of each batch, max over ranks.  same on all ranks.
+   */
+  template <typename KmerType, typename Op>
+  std::vector<double> replay(std::vector<std::vector<KmerType> > const & batches, Op const & op, mxx::comm const & comm) {
+    size_t n = mxx::allreduce(batches.size(), mxx::max<size_t>(), comm);
+
+    std::vector<double> times(n, 0.0);
+    std::vector<KmerType> q;
+    for (size_t i = 0; i < n; ++i) {
+      // the ops reorder their input.
+      if (i < batches.size()) q = batches[i];
+      else q.clear();
+
+      comm.barrier();
+      auto start = std::chrono::steady_clock::now();
+      op(q);
+      times[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    if (n > 0) {
+      times = mxx::allreduce(times, [](double const & x, double const & y) { return std::max(x, y); }, comm);
+    }
+    return times;
+  }
+
+} // namespace workload
+
+#endif // BENCHMARK_QUERY_WORKLOAD_HPP_
@@ -50,6 +50,7 @@
 #include "index/kmer_index.hpp"
 #include "debruijn/de_bruijn_construct_engine.hpp"
 #include "debruijn/de_bruijn_nodes_distributed.hpp"
+#include "debruijn/de_bruijn_compaction.hpp"
 
 #include "utils/benchmark_utils.hpp"
 
@@ -75,6 +76,9 @@ std::vector<KmerType> readForQuery(const std::string & filename, MPI_Comm comm)
 
 
 
+template <typename K>
+using MapParams = ::bliss::index::kmer::BimoleculeHashMapParams<K>;
+
 template<typename KmerType>
 void sample(std::vector<KmerType> &query, size_t n, unsigned int seed) {
 	std::shuffle(query.begin(), query.begin() + ::std::min(4 * n, query.size()),
@@ -96,6 +100,11 @@ void testDeBruijnGraph(const mxx::comm& comm, const std::string & filename, cons
 	idx.template build_posix<SeqParser, ::bliss::io::SequencesIterator>(filename, comm);
 	BL_BENCH_END(test, "build", idx.local_size());
 
+	BL_BENCH_COLLECTIVE_START(test, "compact", comm);
+	::bliss::de_bruijn::unitig_compaction<typename NodeMapType::KmerType, MapParams> compaction(comm);
+	auto unitigs = compaction.compact(idx.get_map());
+	BL_BENCH_END(test, "compact", unitigs.size());
+
 	BL_BENCH_START(test);
 	auto query = readForQuery<NodeMapType>(filename, comm);
 	BL_BENCH_END(test, "read query", query.size());
@@ -125,13 +134,14 @@ using Alphabet = bliss::common::DNA;
 using KmerType = bliss::common::Kmer<21, Alphabet, WordType>;
 using EdgeEncoder = bliss::common::DNA16;
 
-template <typename K>
-using MapParams = ::bliss::index::kmer::BimoleculeHashMapParams<K>;
-
 template <typename EdgeEnc>
 using CountNodeMapType = bliss::de_bruijn::de_bruijn_nodes_distributed<
 		KmerType, bliss::de_bruijn::node::edge_counts<EdgeEnc, int32_t>, MapParams >;
 
+template <typename EdgeEnc>
+using PackedCountNodeMapType = bliss::de_bruijn::de_bruijn_nodes_distributed<
+    KmerType, bliss::de_bruijn::node::packed_edge_counts<EdgeEnc, 4>, MapParams >;
+
 template <typename EdgeEnc>
 using ExistNodeMapType = bliss::de_bruijn::de_bruijn_nodes_distributed<
     KmerType, bliss::de_bruijn::node::edge_exists<EdgeEnc>, MapParams >;
@@ -194,6 +204,12 @@ int main(int argc, char** argv) {
 	  ::std::cerr<<"Using DNA16 to present each edge" << ::std::endl;
 	testDeBruijnGraph< bliss::de_bruijn::de_bruijn_engine<CountNodeMapType>, bliss::io::FASTQParser >(comm, filename, ::std::string("ST, hash, dbg construction, count."));
 
+#ifdef USE_MPI
+  if (rank == 0)
+#endif
+    ::std::cerr<<"Using DNA16 to represent each edge, 4 bit counts" << ::std::endl;
+  testDeBruijnGraph< bliss::de_bruijn::de_bruijn_engine<PackedCountNodeMapType>, bliss::io::FASTQParser >(comm, filename, ::std::string("ST, hash, dbg construction, packed count."));
+
 //
 //	::std::cerr<<"Using ASCII to present each edge" << ::std::endl;
 //	testDeBruijnGraph< bliss::de_bruijn::de_bruijn_engine_ascii<CountNodeMapType>, bliss::io::FASTQParser >(comm, filename, ::std::string("ST, hash, dbg construction, count."));
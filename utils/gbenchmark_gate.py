@@ -0,0 +1,186 @@
+#!/usr/bin/env python
+#
+# Copyright 2016 Georgia Institute of Technology
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Performance regression gate for the google benchmark json results (gbenchmark-json target).
+
+usage:  gbenchmark_gate.py BASELINE CURRENT [--threshold 0.05] [--confidence 0.95]
+
+BASELINE and CURRENT are both json files, or both directories of them (matched by file name).  each benchmark needs its
+repetitions (--benchmark_repetitions=N), as the individual "iteration" runs, not only the aggregates.
+
+throughput per repetition is items_per_second, else bytes_per_second, else 1 / real_time.  for each benchmark in
+both runs, the relative change of the mean throughput, new / base - 1, gets a confidence interval from the
+Welch t distribution (delta method for the ratio).  a benchmark regresses when the change is below -threshold AND
+the whole interval is below 0, i.e. the slowdown is larger than the threshold and not noise.  with fewer than 2
+repetitions on either side there is no interval, and only the threshold is checked, marked "(no stats)".
+
+the coefficient of variation of each side is printed, so that noisy benchmarks are visible.
+exit status 1 if any benchmark regressed, 2 on bad input.
+"""
+
+from __future__ import print_function
+
+import argparse
+import json
+import math
+import os
+import sys
+
+
+# two sided t critical values, by degrees of freedom, for 90, 95 and 99% confidence.
+T_TABLE = {
+    0.90: [6.314, 2.920, 2.353, 2.132, 2.015, 1.943, 1.895, 1.860, 1.833, 1.812,
+           1.796, 1.782, 1.771, 1.761, 1.753, 1.746, 1.740, 1.734, 1.729, 1.725,
+           1.721, 1.717, 1.714, 1.711, 1.708, 1.706, 1.703, 1.701, 1.699, 1.697],
+    0.95: [12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+           2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+           2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042],
+    0.99: [63.657, 9.925, 5.841, 4.604, 4.032, 3.707, 3.499, 3.355, 3.250, 3.169,
+           3.106, 3.055, 3.012, 2.977, 2.947, 2.921, 2.898, 2.878, 2.861, 2.845,
+           2.831, 2.819, 2.807, 2.797, 2.787, 2.779, 2.771, 2.763, 2.756, 2.750],
+}
+Z = {0.90: 1.645, 0.95: 1.960, 0.99: 2.576}
+
+
+def t_critical(confidence, df):
+    """two sided t critical value.  df is rounded down, and above 30 the normal value is used."""
+    table = T_TABLE[confidence]
+    d = int(math.floor(df))
+    if d < 1:
+        return table[0]
+    if d <= len(table):
+        return table[d - 1]
+    return Z[confidence]
+
+
+def throughput(run):
+    for key in ('items_per_second', 'bytes_per_second'):
+        if key in run:
+            return float(run[key])
+    # real_time is in time_unit, but the unit is the same for both sides of a comparison.
+    return 1.0 / float(run['real_time'])
+
+
+def load(path):
+    """(file name, benchmark name) -> list of per repetition throughputs.  path is a json file or a directory of them.
+    for a single file the file name is empty, so that two files are compared by benchmark name only."""
+    files = {}
+    if os.path.isdir(path):
+        for f in sorted(os.listdir(path)):
+            if f.endswith('.json'):
+                files[f] = os.path.join(path, f)
+    else:
+        files[''] = path
+
+    results = {}
+    for name, f in files.items():
+        with open(f) as fin:
+            data = json.load(fin)
+        for run in data.get('benchmarks', []):
+            if run.get('run_type', 'iteration') != 'iteration' or run.get('error_occurred', False):
+                continue
+            key = run.get('run_name', run['name'])
+            results.setdefault((name, key), []).append(throughput(run))
+    return results
+
+
+def mean_var(xs):
+    m = sum(xs) / len(xs)
+    v = sum((x - m) ** 2 for x in xs) / (len(xs) - 1) if len(xs) > 1 else 0.0
+    return m, v
+
+
+def compare(base, new, confidence):
+    """relative change of the mean, its confidence interval (None without stats), and the cv of each side."""
+    mb, vb = mean_var(base)
+    mn, vn = mean_var(new)
+    change = mn / mb - 1.0
+    cv_b = math.sqrt(vb) / mb
+    cv_n = math.sqrt(vn) / mn
+    if len(base) < 2 or len(new) < 2:
+        return change, None, cv_b, cv_n
+
+    sb = vb / len(base)
+    sn = vn / len(new)
+    if sb + sn == 0.0:
+        return change, (change, change), cv_b, cv_n
+    # Welch-Satterthwaite degrees of freedom.
+    df = (sb + sn) ** 2 / ((sb ** 2) / (len(base) - 1) + (sn ** 2) / (len(new) - 1))
+    # standard error of mn / mb, delta method.
+    ratio = mn / mb
+    se = ratio * math.sqrt(sn / (mn ** 2) + sb / (mb ** 2))
+    h = t_critical(confidence, df) * se
+    return change, (change - h, change + h), cv_b, cv_n
+
+
+def main():
+    parser = argparse.ArgumentParser(description='performance regression gate for google benchmark json results')
+    parser.add_argument('baseline', help='baseline json file or directory')
+    parser.add_argument('current', help='new json file or directory')
+    parser.add_argument('--threshold', type=float, default=0.05,
+                        help='largest allowed relative throughput loss. default 0.05')
+    parser.add_argument('--confidence', type=float, default=0.95, choices=sorted(T_TABLE.keys()),
+                        help='confidence level of the interval. default 0.95')
+    args = parser.parse_args()
+
+    try:
+        base = load(args.baseline)
+        new = load(args.current)
+    except (IOError, OSError, ValueError, KeyError) as e:
+        print('error reading benchmark results: %s' % e, file=sys.stderr)
+        return 2
+    if not base:
+        print('no benchmark results in baseline %s' % args.baseline, file=sys.stderr)
+        return 2
+
+    regressions = 0
+    print('%-60s %5s %5s %9s %21s %7s %7s  %s' % ('benchmark', 'n_old', 'n_new', 'change', 'interval', 'cv_old',
+                                                  'cv_new', 'verdict'))
+    for key in sorted(base.keys()):
+        name = key[1]
+        if key not in new:
+            print('%-60s missing from the new results' % name)
+            continue
+        change, ci, cv_b, cv_n = compare(base[key], new[key], args.confidence)
+
+        if ci is None:
+            bad = change < -args.threshold
+            interval = '(no stats)'
+        else:
+            bad = (change < -args.threshold) and (ci[1] < 0.0)
+            interval = '[%+.3f, %+.3f]' % ci
+        if bad:
+            regressions += 1
+            verdict = 'REGRESSION'
+        elif ci is not None and ci[0] > 0.0:
+            verdict = 'faster'
+        else:
+            verdict = 'ok'
+        print('%-60s %5d %5d %+9.3f %21s %7.3f %7.3f  %s' % (name[:60], len(base[key]), len(new[key]), change, interval,
+                                                           cv_b, cv_n, verdict))
+
+    for key in sorted(set(new.keys()) - set(base.keys())):
+        print('%-60s not in the baseline' % key[1])
+
+    if regressions > 0:
+        print('%d benchmark(s) regressed by more than %.1f%%' % (regressions, 100.0 * args.threshold))
+        return 1
+    print('no regressions beyond %.1f%%' % (100.0 * args.threshold))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())